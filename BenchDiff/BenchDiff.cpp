@@ -0,0 +1,421 @@
+//. BenchDiff : compares two LivenessBench runs and flags regressions.
+//.
+//. BenchDiff <baseline.json> <candidate.json> [options]
+//. BenchDiff --store <dir> [options]     the newest run in dir against the one before it
+//.   --threshold <pct>     smallest change that counts as a regression (5)
+//.   --alpha <a>           significance level of the tests (0.05)
+//.   --resamples <n>       bootstrap resamples for the percentiles (2000)
+//.   --json <file>         write the diff as JSON to file ("-" = stdout)
+//.
+//. Runs are the reports LivenessBench writes with --json or keeps with --store. Results
+//. are matched by endpoint, transport and load. For each pair :
+//.   throughput   Welch's t-test over the requests per window_ms window of both runs (the
+//.                first and last window, ramp-up and tail, are left out)
+//.   p50 p90 p99  bootstrap of the percentile difference over the latency samples of both
+//.                runs : the (1 - alpha) interval and the share of resamples on either side
+//.                of zero give the significance
+//. A change is a regression when it is significant and worse than threshold percent
+//. (throughput down, latency up); it is "better" in the other direction. Reports without
+//. samples (older benches) are compared by value only.
+//. The metadata of both runs is printed side by side : revision, server build and its
+//. allocator (MiAlloc.h : a system run against a mimalloc one), SDK release, server host,
+//. bench options. A different server host or bench config is
+//. reported, the numbers may then not be comparable.
+//. Exit status : 0 no regression, 1 regression, 2 bad arguments or unreadable runs.
+
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Path.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/JSON/Stringifier.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define LD_THRESHOLD_PCT	5.0
+#define LD_ALPHA			0.05
+#define LD_RESAMPLES		2000
+#define LD_MIN_SAMPLES		30		//. fewer latencies or windows : no test
+
+using namespace Poco;
+
+struct DiffOptions {
+	std::string		baselinePath;
+	std::string		candidatePath;
+	std::string		storeDir;
+	std::string		jsonPath;
+	double			threshold;
+	double			alpha;
+	int				resamples;
+};
+
+//. one compared measure of a result pair.
+struct Measure {
+	const char*		name;
+	bool			higherBetter;
+	double			base;
+	double			cand;
+	double			changePct;
+	double			lo;				//. interval of the difference, NAN without samples
+	double			hi;
+	double			p;				//. NAN without samples
+	const char*		verdict;		//. "regression", "better", "same", "n/a"
+};
+
+static std::string read_file(const std::string& p_strPath)
+{
+	std::ifstream in(p_strPath, std::ios::binary);
+	std::ostringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+static JSON::Object::Ptr load_run(const std::string& p_strPath)
+{
+	JSON::Parser parser;
+	return parser.parse(read_file(p_strPath)).extract<JSON::Object::Ptr>();
+}
+
+//. continued fraction of the regularized incomplete beta function (Lentz).
+static double beta_cf(double a, double b, double x)
+{
+	const double tiny = 1e-300;
+	double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0);
+	if (std::fabs(d) < tiny) d = tiny;
+	d = 1.0 / d;
+	double h = d;
+	for (int m = 1; m <= 300; m++) {
+		double m2 = 2.0 * m;
+		double aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+		d = 1.0 + aa * d; if (std::fabs(d) < tiny) d = tiny;
+		c = 1.0 + aa / c; if (std::fabs(c) < tiny) c = tiny;
+		d = 1.0 / d;
+		h *= d * c;
+		aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+		d = 1.0 + aa * d; if (std::fabs(d) < tiny) d = tiny;
+		c = 1.0 + aa / c; if (std::fabs(c) < tiny) c = tiny;
+		d = 1.0 / d;
+		double del = d * c;
+		h *= del;
+		if (std::fabs(del - 1.0) < 1e-12) break;
+	}
+	return h;
+}
+
+static double beta_inc(double a, double b, double x)
+{
+	if (x <= 0) return 0;
+	if (x >= 1) return 1;
+	double bt = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log(1.0 - x));
+	if (x < (a + 1.0) / (a + b + 2.0)) return bt * beta_cf(a, b, x) / a;
+	return 1.0 - bt * beta_cf(b, a, 1.0 - x) / b;
+}
+
+//. two-sided p of Welch's t-test; p_dDiff receives mean(b) - mean(a).
+static double welch_p(const std::vector<double>& a, const std::vector<double>& b, double& p_dDiff, double& p_dSe, double& p_dDf)
+{
+	auto moments = [](const std::vector<double>& v, double& mean, double& var) {
+		mean = 0;
+		for (double x : v) mean += x;
+		mean /= v.size();
+		var = 0;
+		for (double x : v) var += (x - mean) * (x - mean);
+		var /= v.size() - 1;
+	};
+	double ma, va, mb, vb;
+	moments(a, ma, va);
+	moments(b, mb, vb);
+	double sa = va / a.size(), sb = vb / b.size();
+	p_dDiff = mb - ma;
+	p_dSe = std::sqrt(sa + sb);
+	if (p_dSe <= 0) {
+		p_dDf = (double)(a.size() + b.size() - 2);
+		return p_dDiff == 0 ? 1.0 : 0.0;
+	}
+	p_dDf = (sa + sb) * (sa + sb) / (sa * sa / (a.size() - 1) + sb * sb / (b.size() - 1));
+	double t = p_dDiff / p_dSe;
+	return beta_inc(p_dDf / 2.0, 0.5, p_dDf / (p_dDf + t * t));
+}
+
+//. two-sided t quantile by bisection on welch_p's tail : the interval half-width factor.
+static double t_crit(double p_dDf, double p_dAlpha)
+{
+	double lo = 0, hi = 1000;
+	for (int i = 0; i < 100; i++) {
+		double mid = (lo + hi) / 2;
+		if (beta_inc(p_dDf / 2.0, 0.5, p_dDf / (p_dDf + mid * mid)) > p_dAlpha) lo = mid;
+		else hi = mid;
+	}
+	return (lo + hi) / 2;
+}
+
+static double quantile(std::vector<double>& p_v, double p_dQ)
+{
+	size_t at = (size_t)(p_dQ * (p_v.size() - 1) + 0.5);
+	std::nth_element(p_v.begin(), p_v.begin() + at, p_v.end());
+	return p_v[at];
+}
+
+static std::vector<double> number_array(JSON::Object::Ptr p_r, const char* p_pszKey)
+{
+	std::vector<double> v;
+	JSON::Array::Ptr a = p_r->getArray(p_pszKey);
+	if (a.isNull()) return v;
+	for (size_t i = 0; i < a->size(); i++) v.push_back(a->getElement<double>((unsigned int)i));
+	return v;
+}
+
+//. requests per second of every full window.
+static std::vector<double> window_rps(JSON::Object::Ptr p_r)
+{
+	std::vector<double> counts = number_array(p_r, "window_counts");
+	double ms = p_r->optValue<double>("window_ms", 0.0);
+	std::vector<double> v;
+	if (ms <= 0 || counts.size() < 3) return v;
+	for (size_t i = 1; i + 1 < counts.size(); i++) v.push_back(counts[i] * 1000.0 / ms);
+	return v;
+}
+
+static void judge(Measure& p_m, const DiffOptions& p_opt)
+{
+	p_m.changePct = p_m.base != 0 ? 100.0 * (p_m.cand - p_m.base) / p_m.base : 0.0;
+	if (std::isnan(p_m.p)) {
+		p_m.verdict = "n/a";
+		return;
+	}
+	double worse = p_m.higherBetter ? -p_m.changePct : p_m.changePct;
+	if (p_m.p >= p_opt.alpha || std::fabs(p_m.changePct) < p_opt.threshold) p_m.verdict = "same";
+	else p_m.verdict = worse > 0 ? "regression" : "better";
+}
+
+static void compare_result(JSON::Object::Ptr b, JSON::Object::Ptr c, const DiffOptions& p_opt, std::mt19937_64& p_rng, std::vector<Measure>& p_vOut)
+{
+	Measure tp = { "throughput_rps", true, b->optValue<double>("throughput_rps", 0.0), c->optValue<double>("throughput_rps", 0.0), 0, NAN, NAN, NAN, "" };
+	std::vector<double> wb = window_rps(b), wc = window_rps(c);
+	if (wb.size() >= LD_MIN_SAMPLES && wc.size() >= LD_MIN_SAMPLES) {
+		double diff, se, df;
+		tp.p = welch_p(wb, wc, diff, se, df);
+		double half = t_crit(df, p_opt.alpha) * se;
+		tp.lo = diff - half;
+		tp.hi = diff + half;
+	}
+	judge(tp, p_opt);
+	p_vOut.push_back(tp);
+
+	static const char* lv_szKeys[] = { "p50_ms", "p90_ms", "p99_ms" };
+	static const double lv_dQ[] = { 0.50, 0.90, 0.99 };
+	Measure lat[3];
+	for (int k = 0; k < 3; k++) lat[k] = { lv_szKeys[k], false, b->optValue<double>(lv_szKeys[k], 0.0), c->optValue<double>(lv_szKeys[k], 0.0), 0, NAN, NAN, NAN, "" };
+	std::vector<double> sb = number_array(b, "latency_sample_ms"), sc = number_array(c, "latency_sample_ms");
+	if (sb.size() >= LD_MIN_SAMPLES && sc.size() >= LD_MIN_SAMPLES) {
+		//. one resample of each run serves the three percentiles.
+		std::vector<double> diffs[3];
+		std::vector<double> rb(sb.size()), rc(sc.size());
+		std::uniform_int_distribution<size_t> pickB(0, sb.size() - 1), pickC(0, sc.size() - 1);
+		for (int r = 0; r < p_opt.resamples; r++) {
+			for (size_t i = 0; i < rb.size(); i++) rb[i] = sb[pickB(p_rng)];
+			for (size_t i = 0; i < rc.size(); i++) rc[i] = sc[pickC(p_rng)];
+			for (int k = 0; k < 3; k++) diffs[k].push_back(quantile(rc, lv_dQ[k]) - quantile(rb, lv_dQ[k]));
+		}
+		for (int k = 0; k < 3; k++) {
+			std::vector<double>& d = diffs[k];
+			std::sort(d.begin(), d.end());
+			size_t nBelow = std::lower_bound(d.begin(), d.end(), 0.0) - d.begin();
+			size_t nAbove = d.end() - std::upper_bound(d.begin(), d.end(), 0.0);
+			lat[k].lo = d[(size_t)(p_opt.alpha / 2 * (d.size() - 1))];
+			lat[k].hi = d[(size_t)((1 - p_opt.alpha / 2) * (d.size() - 1))];
+			lat[k].p = std::min(1.0, 2.0 * (double)std::min(d.size() - nAbove, d.size() - nBelow) / d.size());
+		}
+	}
+	for (int k = 0; k < 3; k++) {
+		judge(lat[k], p_opt);
+		p_vOut.push_back(lat[k]);
+	}
+}
+
+//. "a.b.c" of a report's meta, "" when missing.
+static std::string meta_string(JSON::Object::Ptr p_report, const std::string& p_strPath)
+{
+	JSON::Object::Ptr o = p_report->getObject("meta");
+	std::istringstream parts(p_strPath);
+	std::string strPart, strLast;
+	std::vector<std::string> v;
+	while (std::getline(parts, strPart, '.')) v.push_back(strPart);
+	for (size_t i = 0; i + 1 < v.size() && !o.isNull(); i++) o = o->getObject(v[i]);
+	if (o.isNull() || v.empty() || !o->has(v.back())) return "";
+	return o->get(v.back()).toString();
+}
+
+static bool print_meta(JSON::Object::Ptr p_base, JSON::Object::Ptr p_cand, JSON::Object::Ptr p_out)
+{
+	static const char* lv_szPaths[] = { "revision", "time", "server.build.version", "server.build.allocator", "server.sdk.version", "server.host.node", "server.host.os",
+		"server.host.processors", "server.host.cpu_features", "server.config.version", "config.args" };
+	bool bComparable = true;
+	JSON::Object::Ptr meta = new JSON::Object;
+	for (const char* pszPath : lv_szPaths) {
+		std::string a = meta_string(p_base, pszPath), b = meta_string(p_cand, pszPath);
+		if (a.empty() && b.empty()) continue;
+		bool bSame = a == b;
+		std::string strPath = pszPath;
+		//. the run is expected to differ in these, not in where or how it ran.
+		bool bExpected = strPath == "revision" || strPath == "time" || strPath == "server.build.version" || strPath == "server.build.allocator" || strPath == "server.sdk.version" || strPath == "server.config.version";
+		if (!bSame && !bExpected) bComparable = false;
+		printf("%-26s %-30s %s%s\n", pszPath, a.empty() ? "-" : a.c_str(), b.empty() ? "-" : b.c_str(), bSame ? "" : (bExpected ? "" : "   (differs)"));
+		JSON::Array::Ptr pair = new JSON::Array;
+		pair->add(a);
+		pair->add(b);
+		meta->set(pszPath, pair);
+	}
+	p_out->set("meta", meta);
+	p_out->set("comparable", bComparable);
+	if (!bComparable) printf("the runs differ in host or bench options : the numbers may not be comparable\n");
+	return bComparable;
+}
+
+static void usage()
+{
+	std::cout << "BenchDiff <baseline.json> <candidate.json> | --store dir\n"
+		"          [--threshold pct] [--alpha a] [--resamples n] [--json file|-]" << std::endl;
+}
+
+static bool parse_args(int argc, char** argv, DiffOptions& o)
+{
+	o.threshold = LD_THRESHOLD_PCT;
+	o.alpha = LD_ALPHA;
+	o.resamples = LD_RESAMPLES;
+	std::vector<std::string> vFiles;
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "--help" || a == "-h") return false;
+		if (a.compare(0, 2, "--") != 0) { vFiles.push_back(a); continue; }
+		if (i + 1 >= argc) { std::cout << "missing value for " << a << std::endl; return false; }
+		std::string v = argv[++i];
+		if (a == "--store") o.storeDir = v;
+		else if (a == "--threshold") o.threshold = NumberParser::parseFloat(v);
+		else if (a == "--alpha") o.alpha = NumberParser::parseFloat(v);
+		else if (a == "--resamples") o.resamples = std::max(100, NumberParser::parse(v));
+		else if (a == "--json") o.jsonPath = v;
+		else { std::cout << "unknown option " << a << std::endl; return false; }
+	}
+	if (o.alpha <= 0 || o.alpha >= 1) return false;
+	if (!o.storeDir.empty()) {
+		if (!vFiles.empty()) return false;
+		//. LivenessBench names them by UTC time first : name order is run order.
+		std::vector<std::string> vRuns;
+		for (DirectoryIterator it(o.storeDir), end; it != end; ++it) {
+			if (it->isFile() && Path(it->path()).getExtension() == "json") vRuns.push_back(it->path());
+		}
+		std::sort(vRuns.begin(), vRuns.end());
+		if (vRuns.size() < 2) { std::cout << o.storeDir << " holds fewer than two runs" << std::endl; return false; }
+		o.baselinePath = vRuns[vRuns.size() - 2];
+		o.candidatePath = vRuns.back();
+		return true;
+	}
+	if (vFiles.size() != 2) return false;
+	o.baselinePath = vFiles[0];
+	o.candidatePath = vFiles[1];
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	DiffOptions opt;
+	JSON::Object::Ptr base, cand;
+	try {
+		if (!parse_args(argc, argv, opt)) { usage(); return 2; }
+		base = load_run(opt.baselinePath);
+		cand = load_run(opt.candidatePath);
+	}
+	catch (const Exception& ex) {
+		std::cout << ex.displayText() << std::endl;
+		usage();
+		return 2;
+	}
+	JSON::Array::Ptr baseResults = base->getArray("results"), candResults = cand->getArray("results");
+	if (baseResults.isNull() || candResults.isNull()) {
+		std::cout << "not a LivenessBench report : no results" << std::endl;
+		return 2;
+	}
+
+	JSON::Object::Ptr out = new JSON::Object;
+	out->set("baseline", opt.baselinePath);
+	out->set("candidate", opt.candidatePath);
+	out->set("threshold_pct", opt.threshold);
+	out->set("alpha", opt.alpha);
+	printf("%-26s %-30s %s\n", "", opt.baselinePath.c_str(), opt.candidatePath.c_str());
+	print_meta(base, cand, out);
+	printf("\n");
+
+	std::mt19937_64 rng(1);		//. the same report for the same runs
+	JSON::Array::Ptr diffs = new JSON::Array;
+	int nRegressions = 0;
+	for (size_t i = 0; i < candResults->size(); i++) {
+		JSON::Object::Ptr c = candResults->getObject((unsigned int)i);
+		std::string strEndpoint = c->optValue<std::string>("endpoint", ""), strTransport = c->optValue<std::string>("transport", "tcp"), strLoad = c->optValue<std::string>("load", "closed");
+		JSON::Object::Ptr b;
+		for (size_t j = 0; j < baseResults->size() && b.isNull(); j++) {
+			JSON::Object::Ptr x = baseResults->getObject((unsigned int)j);
+			if (x->optValue<std::string>("endpoint", "") == strEndpoint && x->optValue<std::string>("transport", "tcp") == strTransport
+				&& x->optValue<std::string>("load", "closed") == strLoad) b = x;
+		}
+		if (b.isNull()) {
+			printf("%s %s %s : not in the baseline\n", strEndpoint.c_str(), strTransport.c_str(), strLoad.c_str());
+			continue;
+		}
+		std::vector<Measure> vMeasures;
+		compare_result(b, c, opt, rng, vMeasures);
+		printf("%s %s %s\n", strEndpoint.c_str(), strTransport.c_str(), strLoad.c_str());
+		JSON::Object::Ptr d = new JSON::Object;
+		d->set("endpoint", strEndpoint);
+		d->set("transport", strTransport);
+		d->set("load", strLoad);
+		JSON::Array::Ptr measures = new JSON::Array;
+		for (const Measure& m : vMeasures) {
+			if (std::isnan(m.p)) printf("  %-15s %10.2f -> %10.2f  (%+6.1f%%)  %-26s %s\n", m.name, m.base, m.cand, m.changePct, "no samples", m.verdict);
+			else {
+				char szCi[64];
+				snprintf(szCi, sizeof(szCi), "[%+.2f, %+.2f] p=%.3f", m.lo, m.hi, m.p);
+				printf("  %-15s %10.2f -> %10.2f  (%+6.1f%%)  %-26s %s\n", m.name, m.base, m.cand, m.changePct, szCi, m.verdict);
+			}
+			if (strcmp(m.verdict, "regression") == 0) nRegressions++;
+			JSON::Object::Ptr o = new JSON::Object;
+			o->set("name", m.name);
+			o->set("baseline", m.base);
+			o->set("candidate", m.cand);
+			o->set("change_pct", m.changePct);
+			if (!std::isnan(m.p)) {
+				o->set("diff_low", m.lo);
+				o->set("diff_high", m.hi);
+				o->set("p", m.p);
+			}
+			o->set("verdict", m.verdict);
+			measures->add(o);
+		}
+		d->set("measures", measures);
+		diffs->add(d);
+	}
+	out->set("results", diffs);
+	out->set("regressions", nRegressions);
+	printf("\n%d regression%s beyond %.1f%% at alpha %.3f\n", nRegressions, nRegressions == 1 ? "" : "s", opt.threshold, opt.alpha);
+
+	if (opt.jsonPath == "-") {
+		JSON::Stringifier::stringify(out, std::cout, 2);
+		std::cout << std::endl;
+	}
+	else if (!opt.jsonPath.empty()) {
+		std::ofstream file(opt.jsonPath);
+		JSON::Stringifier::stringify(out, file, 2);
+	}
+	return nRegressions > 0 ? 1 : 0;
+}
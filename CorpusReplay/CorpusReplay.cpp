@@ -0,0 +1,761 @@
+//. CorpusReplay : open-loop replay of a packed image corpus for capacity planning.
+//.
+//. The corpus is one file (see "pack") that is memory-mapped, so images are handed to the
+//. SDK or the socket straight from the mapped pages and the file system stays out of the
+//. numbers. Requests are released on a fixed schedule at the target rate whether or not
+//. earlier ones have finished (open loop); latency is measured from the scheduled arrival,
+//. so queueing in front of a saturated target shows up instead of being hidden.
+//.
+//. CorpusReplay pack <dir> <file>      packs the .jpg/.jpeg/.png/.bmp files of dir
+//. CorpusReplay run [options]
+//.   --corpus <file>       packed corpus (corpus.pack)
+//.   --target <t>          inproc | http (inproc)
+//.   --qps <n>             target arrival rate (20)
+//.   --duration <sec>      length of the run (30)
+//.   --arrival <a>         poisson | uniform inter-arrival times (poisson)
+//.   --workers <n>         in-process pipelines / HTTP connections (8)
+//.   --backlog <n>         arrivals waiting for a worker before new ones are dropped (1000)
+//.   --host <h>            server host for http (127.0.0.1)
+//.   --port <p>            server port for http (8092)
+//.   --json <file>         write the report as JSON ("-" = stdout)
+//. CorpusReplay capture <file> [options]
+//.   replays a request capture of the server ([capture], MiCapture.h) over HTTP : each
+//.   record is sent at its recorded offset from the first one, with its method, URI and
+//.   headers. The body is the recorded one, else the corpus image with the recorded
+//.   XXH64, else zeros of the recorded length.
+//.   --speed <x>           arrival offsets are divided by x (1)
+//.   --corpus, --workers, --backlog, --host, --port, --json as for run; the corpus is
+//.   optional here.
+//.
+//. Corpus file : "MICORPUS" | u64 count | u64 index offset | images, 64-byte aligned |
+//.               count x { u64 offset, u64 length }, little endian.
+
+#include <windows.h>
+#include "FaceSdkApi.h"
+#include "MiConf.h"
+#include "MiHash.h"
+#include "licenseproc.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/File.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Path.h"
+#include "Poco/String.h"
+#include "Poco/SharedMemory.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Stringifier.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <sstream>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LD_CORPUS_MAGIC		"MICORPUS"
+#define LD_CORPUS_ALIGN		64
+#define LD_API_MULTIPART	"/api/check_liveness"
+#define LD_BOUNDARY			"----CorpusReplayBoundary3c9e"
+
+using namespace Poco;
+using namespace Poco::Net;
+
+typedef std::chrono::steady_clock Clock;
+
+struct ReplayOptions {
+	std::string		corpus;
+	std::string		target;
+	double			qps;
+	int				durationSec;
+	std::string		arrival;
+	int				workers;
+	int				backlog;
+	std::string		host;
+	int				port;
+	std::string		jsonPath;
+	double			speed;			//. capture : arrival offsets divided by this
+};
+
+struct CorpusEntry {
+	uint64_t	offset;
+	uint64_t	length;
+};
+
+//. read-only view of a packed corpus.
+class MappedCorpus {
+public:
+	bool open(const std::string& p_strPath, std::string& p_strErr)
+	{
+		try {
+			m_pMap.reset(new SharedMemory(File(p_strPath), SharedMemory::AM_READ));
+		}
+		catch (const Exception& ex) {
+			p_strErr = ex.displayText();
+			return false;
+		}
+		const char* p = m_pMap->begin();
+		size_t n = (size_t)(m_pMap->end() - p);
+		if (n < 24 || memcmp(p, LD_CORPUS_MAGIC, 8) != 0) { p_strErr = "not a packed corpus"; return false; }
+		uint64_t count = 0, index = 0;
+		memcpy(&count, p + 8, 8);
+		memcpy(&index, p + 16, 8);
+		if (count == 0 || index > n || (n - index) / sizeof(CorpusEntry) < count) { p_strErr = "corrupt corpus index"; return false; }
+		m_vEntries.resize((size_t)count);
+		memcpy(m_vEntries.data(), p + index, (size_t)count * sizeof(CorpusEntry));
+		for (const CorpusEntry& e : m_vEntries) {
+			if (e.offset > index || e.length > index - e.offset) { p_strErr = "corpus entry out of range"; return false; }
+		}
+		return true;
+	}
+
+	size_t size() const { return m_vEntries.size(); }
+	const uint8_t* data(size_t p_nIndex) const { return (const uint8_t*)m_pMap->begin() + m_vEntries[p_nIndex].offset; }
+	size_t length(size_t p_nIndex) const { return (size_t)m_vEntries[p_nIndex].length; }
+
+	//. touches every page once so the first pass is not a page-fault benchmark.
+	void prefault() const
+	{
+		volatile uint8_t sum = 0;
+		for (const char* p = m_pMap->begin(); p < m_pMap->end(); p += 4096) sum += (uint8_t)*p;
+	}
+
+private:
+	std::unique_ptr<SharedMemory>	m_pMap;
+	std::vector<CorpusEntry>		m_vEntries;
+};
+
+static std::string read_file(const std::string& p_strPath)
+{
+	std::ifstream in(p_strPath, std::ios::binary);
+	std::ostringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+static int pack(const std::string& p_strDir, const std::string& p_strOut)
+{
+	File dir(p_strDir);
+	if (!dir.exists() || !dir.isDirectory()) { printf("no directory %s\n", p_strDir.c_str()); return 2; }
+
+	std::ofstream out(p_strOut, std::ios::binary | std::ios::trunc);
+	if (!out) { printf("cannot write %s\n", p_strOut.c_str()); return 1; }
+	char header[24] = { 0 };
+	out.write(header, sizeof(header));
+
+	std::vector<CorpusEntry> vIndex;
+	uint64_t pos = sizeof(header);
+	for (DirectoryIterator it(p_strDir), end; it != end; ++it) {
+		if (!it->isFile()) continue;
+		std::string ext = Poco::toLower(Path(it->path()).getExtension());
+		if (ext != "jpg" && ext != "jpeg" && ext != "png" && ext != "bmp") continue;
+		std::string data = read_file(it->path());
+		if (data.empty()) continue;
+		uint64_t pad = (LD_CORPUS_ALIGN - pos % LD_CORPUS_ALIGN) % LD_CORPUS_ALIGN;
+		if (pad > 0) { std::string zeros((size_t)pad, '\0'); out.write(zeros.data(), zeros.size()); pos += pad; }
+		vIndex.push_back({ pos, (uint64_t)data.size() });
+		out.write(data.data(), data.size());
+		pos += data.size();
+	}
+	if (vIndex.empty()) { printf("no images in %s\n", p_strDir.c_str()); return 2; }
+
+	uint64_t index = pos, count = vIndex.size();
+	out.write((const char*)vIndex.data(), vIndex.size() * sizeof(CorpusEntry));
+	memcpy(header, LD_CORPUS_MAGIC, 8);
+	memcpy(header + 8, &count, 8);
+	memcpy(header + 16, &index, 8);
+	out.seekp(0);
+	out.write(header, sizeof(header));
+	out.close();
+	printf("packed %llu images, %.1f MB into %s\n", (unsigned long long)count, pos / (1024.0 * 1024.0), p_strOut.c_str());
+	return 0;
+}
+
+struct Arrival {
+	size_t				image;
+	Clock::time_point	due;
+};
+
+struct WorkerStats {
+	std::vector<double>	latMs;			//. from the scheduled arrival
+	std::vector<double>	serviceMs;		//. from the moment a worker took it
+	uint64_t			ok;
+	uint64_t			errors;
+	WorkerStats() : ok(0), errors(0) {}
+};
+
+//. arrivals waiting for a worker; full = the target is behind by more than --backlog.
+class ArrivalQueue {
+public:
+	explicit ArrivalQueue(size_t p_nMax) : m_nMax(p_nMax), m_bClosed(false) {}
+
+	bool push(const Arrival& p_a)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if (m_queue.size() >= m_nMax) return false;
+			m_queue.push_back(p_a);
+		}
+		m_cv.notify_one();
+		return true;
+	}
+
+	bool pop(Arrival& p_a)
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+		m_cv.wait(lock, [this] { return m_bClosed || !m_queue.empty(); });
+		if (m_queue.empty()) return false;
+		p_a = m_queue.front();
+		m_queue.pop_front();
+		return true;
+	}
+
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bClosed = true;
+		}
+		m_cv.notify_all();
+	}
+
+private:
+	size_t					m_nMax;
+	bool					m_bClosed;
+	std::deque<Arrival>		m_queue;
+	std::mutex				m_mtx;
+	std::condition_variable	m_cv;
+};
+
+//. one worker's target : an SDK pipeline or a keep-alive connection.
+class ReplayTarget {
+public:
+	virtual ~ReplayTarget() {}
+	virtual bool check(const uint8_t* p_pData, size_t p_nLen) = 0;
+};
+
+class InProcessTarget : public ReplayTarget {
+public:
+	explicit InProcessTarget(CPipeline_t* p_pPipe) : m_pPipe(p_pPipe) {}
+	~InProcessTarget() { if (m_pPipe != NULL) face_sdk_api().pipeline_destroy(m_pPipe); }
+
+	bool check(const uint8_t* p_pData, size_t p_nLen) override
+	{
+		int err = OK;
+		CImage_t* image = face_sdk_api().image_create_bytes(p_pData, p_nLen, &err, m_szMsg);
+		if (image == NULL) return false;
+		face_sdk_api().pipeline_check_liveness(m_pPipe, image, NULL, &err, m_szMsg);
+		face_sdk_api().image_destroy(image);
+		return err == OK;
+	}
+
+private:
+	CPipeline_t*	m_pPipe;
+	char			m_szMsg[MESSAGE_BUFFER_SIZE];
+};
+
+class HttpTarget : public ReplayTarget {
+public:
+	HttpTarget(const std::string& p_strHost, int p_nPort) : m_session(p_strHost, (Poco::UInt16)p_nPort)
+	{
+		m_session.setKeepAlive(true);
+		m_session.setTimeout(Timespan(120, 0));
+		m_strHead = std::string("--") + LD_BOUNDARY + "\r\n"
+			"Content-Disposition: form-data; name=\"image\"; filename=\"image\"\r\n"
+			"Content-Type: application/octet-stream\r\n\r\n";
+		m_strTail = std::string("\r\n--") + LD_BOUNDARY + "--\r\n";
+	}
+
+	//. the multipart framing is written around the mapped bytes, the image is not copied.
+	bool check(const uint8_t* p_pData, size_t p_nLen) override
+	{
+		HTTPRequest req(HTTPRequest::HTTP_POST, LD_API_MULTIPART, HTTPMessage::HTTP_1_1);
+		req.setKeepAlive(true);
+		req.setContentType(std::string("multipart/form-data; boundary=") + LD_BOUNDARY);
+		req.setContentLength((std::streamsize)(m_strHead.size() + p_nLen + m_strTail.size()));
+		try {
+			std::ostream& os = m_session.sendRequest(req);
+			os.write(m_strHead.data(), m_strHead.size());
+			os.write((const char*)p_pData, p_nLen);
+			os.write(m_strTail.data(), m_strTail.size());
+			HTTPResponse rsp;
+			std::istream& is = m_session.receiveResponse(rsp);
+			is.ignore(std::numeric_limits<std::streamsize>::max());
+			return rsp.getStatus() == HTTPResponse::HTTP_OK;
+		}
+		catch (const Exception&) {
+			m_session.reset();
+			return false;
+		}
+	}
+
+private:
+	HTTPClientSession	m_session;
+	std::string			m_strHead;
+	std::string			m_strTail;
+};
+
+static double percentile(const std::vector<double>& p_vSorted, double p_dQ)
+{
+	if (p_vSorted.empty()) return 0;
+	size_t idx = (size_t)(p_dQ * (p_vSorted.size() - 1) + 0.5);
+	return p_vSorted[std::min(idx, p_vSorted.size() - 1)];
+}
+
+static void put_latency(JSON::Object::Ptr p_r, const std::string& p_strPrefix, std::vector<double>& p_v)
+{
+	std::sort(p_v.begin(), p_v.end());
+	double sum = 0;
+	for (double v : p_v) sum += v;
+	p_r->set(p_strPrefix + "mean_ms", p_v.empty() ? 0.0 : sum / p_v.size());
+	p_r->set(p_strPrefix + "p50_ms", percentile(p_v, 0.50));
+	p_r->set(p_strPrefix + "p90_ms", percentile(p_v, 0.90));
+	p_r->set(p_strPrefix + "p99_ms", percentile(p_v, 0.99));
+	p_r->set(p_strPrefix + "p999_ms", percentile(p_v, 0.999));
+	p_r->set(p_strPrefix + "max_ms", p_v.empty() ? 0.0 : p_v.back());
+}
+
+static JSON::Object::Ptr replay(const ReplayOptions& p_opt, const MappedCorpus& p_corpus, std::vector<std::unique_ptr<ReplayTarget>>& p_vTargets)
+{
+	ArrivalQueue queue((size_t)p_opt.backlog);
+	std::vector<WorkerStats> stats(p_vTargets.size());
+	std::vector<std::thread> threads;
+
+	for (size_t w = 0; w < p_vTargets.size(); w++) {
+		threads.emplace_back([&, w] {
+			Arrival a;
+			while (queue.pop(a)) {
+				Clock::time_point start = Clock::now();
+				bool bOk = p_vTargets[w]->check(p_corpus.data(a.image), p_corpus.length(a.image));
+				Clock::time_point done = Clock::now();
+				stats[w].latMs.push_back(std::chrono::duration<double, std::milli>(done - a.due).count());
+				stats[w].serviceMs.push_back(std::chrono::duration<double, std::milli>(done - start).count());
+				if (bOk) stats[w].ok++;
+				else stats[w].errors++;
+			}
+		});
+	}
+
+	//. the schedule is fixed up front : a late arrival is released at once, not pushed back.
+	std::mt19937_64 rng(20240917);
+	std::exponential_distribution<double> expo(p_opt.qps);
+	Clock::time_point start = Clock::now(), last = start + std::chrono::seconds(p_opt.durationSec);
+	Clock::time_point due = start;
+	uint64_t nOffered = 0, nDropped = 0;
+	while (due < last) {
+		std::this_thread::sleep_until(due);
+		if (!queue.push({ (size_t)(nOffered % p_corpus.size()), due })) nDropped++;
+		nOffered++;
+		double gap = p_opt.arrival == "uniform" ? 1.0 / p_opt.qps : expo(rng);
+		due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap));
+	}
+	queue.close();
+	for (auto& t : threads) t.join();
+	double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::vector<double> lat, service;
+	uint64_t ok = 0, errors = 0;
+	for (auto& s : stats) {
+		lat.insert(lat.end(), s.latMs.begin(), s.latMs.end());
+		service.insert(service.end(), s.serviceMs.begin(), s.serviceMs.end());
+		ok += s.ok;
+		errors += s.errors;
+	}
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("target", p_opt.target);
+	r->set("arrival", p_opt.arrival);
+	r->set("workers", (int)p_vTargets.size());
+	r->set("offered_qps", p_opt.qps);
+	r->set("offered", nOffered);
+	r->set("dropped", nDropped);
+	r->set("completed", (uint64_t)lat.size());
+	r->set("ok", ok);
+	r->set("errors", errors);
+	r->set("elapsed_sec", elapsed);
+	r->set("achieved_qps", elapsed > 0 ? lat.size() / elapsed : 0.0);
+	put_latency(r, "", lat);
+	put_latency(r, "service_", service);
+	return r;
+}
+
+//. one record of a capture file (MiCapture.h).
+struct CapturedRequest {
+	uint64_t	arrivalUs;
+	uint32_t	flags;
+	uint64_t	bodyLen;
+	uint64_t	hash;
+	std::string	method;
+	std::string	uri;
+	std::vector<std::pair<std::string, std::string>>	headers;
+	std::string	body;
+};
+
+enum BodySource { BODY_RECORDED = 0, BODY_CORPUS, BODY_ZEROS, BODY_NONE, BODY_SOURCE_COUNT };
+
+static bool take(const char*& p, const char* p_pEnd, void* p_pOut, size_t p_nLen)
+{
+	if ((size_t)(p_pEnd - p) < p_nLen) return false;
+	memcpy(p_pOut, p, p_nLen);
+	p += p_nLen;
+	return true;
+}
+
+static bool take_text(const char*& p, const char* p_pEnd, std::string& p_strOut)
+{
+	uint16_t n = 0;
+	if (!take(p, p_pEnd, &n, sizeof(n)) || (size_t)(p_pEnd - p) < n) return false;
+	p_strOut.assign(p, n);
+	p += n;
+	return true;
+}
+
+static bool load_capture(const std::string& p_strPath, std::vector<CapturedRequest>& p_vOut, std::string& p_strErr)
+{
+	std::string data = read_file(p_strPath);
+	if (data.size() < 16 || memcmp(data.data(), GD_CAPTURE_MAGIC, 8) != 0) { p_strErr = "not a capture file"; return false; }
+	const char* p = data.data() + 16;
+	const char* pEnd = data.data() + data.size();
+	while (p < pEnd) {
+		uint32_t nSize = 0;
+		//. a record cut short by a stopped server ends the file.
+		if (!take(p, pEnd, &nSize, sizeof(nSize)) || (size_t)(pEnd - p) < nSize) break;
+		const char* q = p;
+		const char* qEnd = p + nSize;
+		p = qEnd;
+		CapturedRequest r;
+		uint16_t nHeaders = 0;
+		if (!take(q, qEnd, &r.arrivalUs, 8) || !take(q, qEnd, &r.flags, 4) || !take(q, qEnd, &r.bodyLen, 8) || !take(q, qEnd, &r.hash, 8)
+			|| !take_text(q, qEnd, r.method) || !take_text(q, qEnd, r.uri) || !take(q, qEnd, &nHeaders, 2)) {
+			p_strErr = "corrupt record " + std::to_string(p_vOut.size());
+			return false;
+		}
+		for (uint16_t i = 0; i < nHeaders; i++) {
+			std::pair<std::string, std::string> h;
+			if (!take_text(q, qEnd, h.first) || !take_text(q, qEnd, h.second)) { p_strErr = "corrupt record " + std::to_string(p_vOut.size()); return false; }
+			r.headers.push_back(h);
+		}
+		if (r.flags & GD_CAPTURE_FLAG_BODY) r.body.assign(q, qEnd);
+		p_vOut.push_back(std::move(r));
+	}
+	if (p_vOut.empty()) { p_strErr = "no records"; return false; }
+	return true;
+}
+
+//. headers the session sets itself, and the ones the server did not record.
+static bool replay_header(const std::pair<std::string, std::string>& p_h)
+{
+	if (p_h.second.empty()) return false;
+	return Poco::icompare(p_h.first, HTTPMessage::CONTENT_LENGTH) != 0 && Poco::icompare(p_h.first, HTTPMessage::TRANSFER_ENCODING) != 0
+		&& Poco::icompare(p_h.first, HTTPMessage::CONNECTION) != 0 && Poco::icompare(p_h.first, HTTPRequest::HOST) != 0;
+}
+
+static JSON::Object::Ptr replay_capture(const ReplayOptions& p_opt, const std::vector<CapturedRequest>& p_vRecords, const MappedCorpus* p_pCorpus)
+{
+	//. the body each record is sent with; zeros are shared between records of one length.
+	std::unordered_map<uint64_t, size_t> byHash;
+	if (p_pCorpus != NULL) {
+		for (size_t i = 0; i < p_pCorpus->size(); i++) byHash.emplace(mi_hash64(p_pCorpus->data(i), p_pCorpus->length(i)), i);
+	}
+	std::vector<const char*> vBody(p_vRecords.size(), (const char*)NULL);
+	std::vector<size_t> vBodyLen(p_vRecords.size(), 0);
+	std::unordered_map<uint64_t, std::string> zeros;
+	uint64_t nBySource[BODY_SOURCE_COUNT] = { 0 };
+	for (size_t i = 0; i < p_vRecords.size(); i++) {
+		const CapturedRequest& r = p_vRecords[i];
+		std::unordered_map<uint64_t, size_t>::const_iterator it;
+		if (r.flags & GD_CAPTURE_FLAG_BODY) {
+			vBody[i] = r.body.data();
+			vBodyLen[i] = r.body.size();
+			nBySource[BODY_RECORDED]++;
+		}
+		else if ((r.flags & GD_CAPTURE_FLAG_HASH) && (it = byHash.find(r.hash)) != byHash.end()) {
+			vBody[i] = (const char*)p_pCorpus->data(it->second);
+			vBodyLen[i] = p_pCorpus->length(it->second);
+			nBySource[BODY_CORPUS]++;
+		}
+		else if (r.bodyLen != UINT64_MAX && r.bodyLen > 0) {
+			std::string& z = zeros[r.bodyLen];
+			if (z.empty()) z.assign((size_t)r.bodyLen, '\0');
+			vBody[i] = z.data();
+			vBodyLen[i] = z.size();
+			nBySource[BODY_ZEROS]++;
+		}
+		else nBySource[BODY_NONE]++;
+	}
+
+	ArrivalQueue queue((size_t)p_opt.backlog);
+	std::vector<WorkerStats> stats((size_t)p_opt.workers);
+	std::vector<std::thread> threads;
+	for (size_t w = 0; w < stats.size(); w++) {
+		threads.emplace_back([&, w] {
+			HTTPClientSession session(p_opt.host, (Poco::UInt16)p_opt.port);
+			session.setKeepAlive(true);
+			session.setTimeout(Timespan(120, 0));
+			Arrival a;
+			while (queue.pop(a)) {
+				const CapturedRequest& r = p_vRecords[a.image];
+				Clock::time_point start = Clock::now();
+				bool bOk = false;
+				try {
+					HTTPRequest req(r.method, r.uri, HTTPMessage::HTTP_1_1);
+					for (const auto& h : r.headers) {
+						if (replay_header(h)) req.add(h.first, h.second);
+					}
+					req.setKeepAlive(true);
+					req.setContentLength((std::streamsize)vBodyLen[a.image]);
+					std::ostream& os = session.sendRequest(req);
+					if (vBodyLen[a.image] > 0) os.write(vBody[a.image], (std::streamsize)vBodyLen[a.image]);
+					HTTPResponse rsp;
+					std::istream& is = session.receiveResponse(rsp);
+					is.ignore(std::numeric_limits<std::streamsize>::max());
+					bOk = rsp.getStatus() < HTTPResponse::HTTP_BAD_REQUEST;
+				}
+				catch (const Exception&) {
+					session.reset();
+				}
+				Clock::time_point done = Clock::now();
+				stats[w].latMs.push_back(std::chrono::duration<double, std::milli>(done - a.due).count());
+				stats[w].serviceMs.push_back(std::chrono::duration<double, std::milli>(done - start).count());
+				if (bOk) stats[w].ok++;
+				else stats[w].errors++;
+			}
+		});
+	}
+
+	//. the recorded schedule, released open loop like run; the first record is at 0.
+	uint64_t nFirstUs = p_vRecords.front().arrivalUs;
+	for (const CapturedRequest& r : p_vRecords) nFirstUs = std::min(nFirstUs, r.arrivalUs);
+	std::vector<size_t> order(p_vRecords.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return p_vRecords[a].arrivalUs < p_vRecords[b].arrivalUs; });
+	Clock::time_point start = Clock::now();
+	uint64_t nOffered = 0, nDropped = 0;
+	for (size_t i : order) {
+		double offset = (p_vRecords[i].arrivalUs - nFirstUs) / 1e6 / p_opt.speed;
+		Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset));
+		std::this_thread::sleep_until(due);
+		if (!queue.push({ i, due })) nDropped++;
+		nOffered++;
+	}
+	queue.close();
+	for (auto& t : threads) t.join();
+	double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	double recorded = (p_vRecords[order.back()].arrivalUs - nFirstUs) / 1e6;
+
+	std::vector<double> lat, service;
+	uint64_t ok = 0, errors = 0;
+	for (auto& s : stats) {
+		lat.insert(lat.end(), s.latMs.begin(), s.latMs.end());
+		service.insert(service.end(), s.serviceMs.begin(), s.serviceMs.end());
+		ok += s.ok;
+		errors += s.errors;
+	}
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("target", std::string("capture"));
+	r->set("workers", p_opt.workers);
+	r->set("speed", p_opt.speed);
+	r->set("recorded_sec", recorded);
+	r->set("offered_qps", recorded > 0 ? nOffered * p_opt.speed / recorded : 0.0);
+	r->set("offered", nOffered);
+	r->set("dropped", nDropped);
+	r->set("completed", (uint64_t)lat.size());
+	r->set("ok", ok);
+	r->set("errors", errors);
+	r->set("elapsed_sec", elapsed);
+	r->set("achieved_qps", elapsed > 0 ? lat.size() / elapsed : 0.0);
+	r->set("bodies_recorded", nBySource[BODY_RECORDED]);
+	r->set("bodies_corpus", nBySource[BODY_CORPUS]);
+	r->set("bodies_zeros", nBySource[BODY_ZEROS]);
+	r->set("bodies_empty", nBySource[BODY_NONE]);
+	put_latency(r, "", lat);
+	put_latency(r, "service_", service);
+	return r;
+}
+
+static void usage()
+{
+	std::cout << "CorpusReplay pack <dir> <file>\n"
+		"CorpusReplay run [--corpus file] [--target inproc|http] [--qps n] [--duration sec]\n"
+		"                 [--arrival poisson|uniform] [--workers n] [--backlog n]\n"
+		"                 [--host h] [--port p] [--json file|-]\n"
+		"CorpusReplay capture <file> [--speed x] [--corpus file] [--workers n] [--backlog n]\n"
+		"                 [--host h] [--port p] [--json file|-]" << std::endl;
+}
+
+static bool parse_args(int argc, char** argv, int p_nFirst, ReplayOptions& o)
+{
+	o.corpus = "corpus.pack";
+	o.target = "inproc";
+	o.qps = 20;
+	o.durationSec = 30;
+	o.arrival = "poisson";
+	o.workers = 8;
+	o.backlog = 1000;
+	o.host = "127.0.0.1";
+	o.port = 8092;
+	o.speed = 1;
+
+	for (int i = p_nFirst; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "--help" || a == "-h") return false;
+		if (i + 1 >= argc) { std::cout << "missing value for " << a << std::endl; return false; }
+		std::string v = argv[++i];
+		if (a == "--corpus") o.corpus = v;
+		else if (a == "--target") o.target = v;
+		else if (a == "--qps") o.qps = NumberParser::parseFloat(v);
+		else if (a == "--duration") o.durationSec = NumberParser::parse(v);
+		else if (a == "--arrival") o.arrival = v;
+		else if (a == "--workers") o.workers = std::max(1, NumberParser::parse(v));
+		else if (a == "--backlog") o.backlog = std::max(1, NumberParser::parse(v));
+		else if (a == "--host") o.host = v;
+		else if (a == "--port") o.port = NumberParser::parse(v);
+		else if (a == "--json") o.jsonPath = v;
+		else if (a == "--speed") o.speed = NumberParser::parseFloat(v);
+		else { std::cout << "unknown option " << a << std::endl; return false; }
+	}
+	return o.qps > 0 && o.durationSec > 0 && o.speed > 0 && (o.target == "inproc" || o.target == "http") && (o.arrival == "poisson" || o.arrival == "uniform");
+}
+
+//. one pipeline per worker, the way the server's pipeline pool runs them.
+static bool make_inproc_targets(int p_nWorkers, std::vector<std::unique_ptr<ReplayTarget>>& p_vOut, const MappedCorpus& p_corpus)
+{
+	setting_init(1);
+	const char* pszMissing = NULL;
+	if (face_sdk_api_publish(g_hFaceDll, &pszMissing) == false) {
+		printf("FaceSDK entry point not found : %s\n", pszMissing);
+		return false;
+	}
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	CInitConfig_t* config = face_sdk_api().config_create(GD_SDK_CONFIG_DIR, GD_SDK_CONFIG_NAME, &err, msg);
+	if (config == NULL) {
+		printf("config_create(%s, %s) failed : %s\n", GD_SDK_CONFIG_DIR, GD_SDK_CONFIG_NAME, msg);
+		return false;
+	}
+	for (int i = 0; i < p_nWorkers; i++) {
+		CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, config, &err, msg);
+		if (pipe == NULL) {
+			printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+			break;
+		}
+		p_vOut.emplace_back(new InProcessTarget(pipe));
+		//. first call compiles / allocates lazily, keep it out of the numbers.
+		p_vOut.back()->check(p_corpus.data(0), p_corpus.length(0));
+	}
+	face_sdk_api().config_destroy(config);
+	return !p_vOut.empty();
+}
+
+static void write_json(JSON::Object::Ptr p_r, const std::string& p_strPath)
+{
+	if (p_strPath.empty()) return;
+	if (p_strPath == "-") {
+		JSON::Stringifier::stringify(p_r, std::cout, 2);
+		std::cout << std::endl;
+	}
+	else {
+		std::ofstream out(p_strPath);
+		JSON::Stringifier::stringify(p_r, out, 2);
+	}
+}
+
+static int run_capture(const std::string& p_strFile, const ReplayOptions& p_opt, bool p_bCorpus)
+{
+	std::vector<CapturedRequest> records;
+	std::string strErr;
+	if (!load_capture(p_strFile, records, strErr)) {
+		printf("%s : %s\n", p_strFile.c_str(), strErr.c_str());
+		return 2;
+	}
+	MappedCorpus corpus;
+	if (p_bCorpus) {
+		if (!corpus.open(p_opt.corpus, strErr)) {
+			printf("%s : %s\n", p_opt.corpus.c_str(), strErr.c_str());
+			return 2;
+		}
+		corpus.prefault();
+	}
+
+	JSON::Object::Ptr r = replay_capture(p_opt, records, p_bCorpus ? &corpus : NULL);
+	r->set("capture", p_strFile);
+	printf("capture %8.1f offered %8.1f achieved req/s  p50 %7.2f  p99 %7.2f  p999 %7.2f ms  service p50 %7.2f ms  (ok %llu, err %llu, dropped %llu)\n",
+		r->getValue<double>("offered_qps"), r->getValue<double>("achieved_qps"),
+		r->getValue<double>("p50_ms"), r->getValue<double>("p99_ms"), r->getValue<double>("p999_ms"), r->getValue<double>("service_p50_ms"),
+		(unsigned long long)r->getValue<uint64_t>("ok"), (unsigned long long)r->getValue<uint64_t>("errors"),
+		(unsigned long long)r->getValue<uint64_t>("dropped"));
+	printf("bodies : %llu recorded, %llu from the corpus, %llu zeros, %llu empty\n",
+		(unsigned long long)r->getValue<uint64_t>("bodies_recorded"), (unsigned long long)r->getValue<uint64_t>("bodies_corpus"),
+		(unsigned long long)r->getValue<uint64_t>("bodies_zeros"), (unsigned long long)r->getValue<uint64_t>("bodies_empty"));
+	write_json(r, p_opt.jsonPath);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	std::string mode = argc > 1 ? argv[1] : "";
+	if (mode == "pack") {
+		if (argc != 4) { usage(); return 2; }
+		return pack(argv[2], argv[3]);
+	}
+	if (mode != "run" && mode != "capture") { usage(); return 2; }
+	if (mode == "capture" && argc < 3) { usage(); return 2; }
+
+	ReplayOptions opt;
+	try {
+		if (!parse_args(argc, argv, mode == "capture" ? 3 : 2, opt)) { usage(); return 2; }
+	}
+	catch (const Exception& ex) {
+		std::cout << ex.displayText() << std::endl;
+		usage();
+		return 2;
+	}
+	if (mode == "capture") {
+		bool bCorpus = false;
+		for (int i = 3; i < argc; i++) bCorpus = bCorpus || strcmp(argv[i], "--corpus") == 0;
+		return run_capture(argv[2], opt, bCorpus);
+	}
+
+	MappedCorpus corpus;
+	std::string strErr;
+	if (!corpus.open(opt.corpus, strErr)) {
+		printf("%s : %s\n", opt.corpus.c_str(), strErr.c_str());
+		return 2;
+	}
+	corpus.prefault();
+
+	std::vector<std::unique_ptr<ReplayTarget>> targets;
+	if (opt.target == "inproc") {
+		if (!make_inproc_targets(opt.workers, targets, corpus)) return 1;
+	}
+	else {
+		for (int i = 0; i < opt.workers; i++) targets.emplace_back(new HttpTarget(opt.host, opt.port));
+	}
+
+	JSON::Object::Ptr r = replay(opt, corpus, targets);
+	r->set("corpus", opt.corpus);
+	r->set("images", (uint64_t)corpus.size());
+	targets.clear();
+
+	printf("%-7s %8.1f offered %8.1f achieved req/s  p50 %7.2f  p99 %7.2f  p999 %7.2f ms  service p50 %7.2f ms  (ok %llu, err %llu, dropped %llu)\n",
+		opt.target.c_str(), opt.qps, r->getValue<double>("achieved_qps"),
+		r->getValue<double>("p50_ms"), r->getValue<double>("p99_ms"), r->getValue<double>("p999_ms"), r->getValue<double>("service_p50_ms"),
+		(unsigned long long)r->getValue<uint64_t>("ok"), (unsigned long long)r->getValue<uint64_t>("errors"),
+		(unsigned long long)r->getValue<uint64_t>("dropped"));
+
+	write_json(r, opt.jsonPath);
+	return 0;
+}
@@ -0,0 +1,1356 @@
+//. LivenessBench : HTTP load generator for IDLiveFaceCmd.
+//.
+//. LivenessBench [options]
+//.   --host <h>            server host (127.0.0.1)
+//.   --port <p>            server port (8092)
+//.   --endpoint <e>        multipart | base64 | raw | pixels | both | all (both); both = multipart
+//.                         and base64, all = the four : raw posts the image file as the body,
+//.                         pixels a BGR frame of about the image's size (X-Width / X-Height)
+//.   --concurrency <n>     client connections / threads (8)
+//.   --requests <n>        requests per endpoint (1000), ignored with --duration
+//.   --duration <sec>      run each endpoint for a fixed time instead
+//.   --warmup <n>          requests per connection sent before measuring (5)
+//.   --keepalive <0|1>     reuse connections (1)
+//.   --corpus <dir>        directory of images to send (../images)
+//.   --sizes <k,k,...>     add synthetic payloads of these sizes in KB (none)
+//.   --json <file>         write the report as JSON to file ("-" = stdout)
+//.   --unix <path>         the server's server.local_socket
+//.   --transport <t>       tcp | unix | both (tcp); both runs every endpoint over each, to
+//.                         compare the local socket with loopback TCP
+//.   --tls-handshakes <n>  instead : n TLS connections to --port (the server's tls.port),
+//.                         one GET of the version each, reporting handshakes/s and latency
+//.   --tls-resume <0|1>    offer each thread's last session on its next connection (1)
+//.   --baseline <file>     a previous --json report : prints the p50 / p99 change of every
+//.                         endpoint against it (e.g. [cores] enable off, then on)
+//.   --rate <rps>          open loop instead : requests start at this rate whatever the answers,
+//.                         latency counted from the scheduled start (a late client thread shows
+//.                         as latency, not as a lower rate); --concurrency bounds the threads
+//.   --offered <pct>       closed loop first, then open loop at pct % of the throughput it found,
+//.                         e.g. 120 for a server kept 20 % over capacity
+//.   --deadline-ms <ms>    sends X-Deadline-Ms and reports goodput : 200 answers within ms per
+//.                         second ([batch] order = fifo, then edf, with --baseline compares them)
+//.   --idle <n>            first opens n keep-alive connections (one GET of the version each) and
+//.                         holds them idle through the run : reports how many opened, how long it
+//.                         took, the server's resident memory per connection (mi_process_rss_bytes)
+//.                         and how many were still open at the end (server.mode = classic, then
+//.                         proactor; 10k needs the open file limit raised on both sides)
+//.   --api-key <key>       sends X-Api-Key : the run is charged to, and routed as, that tenant
+//.                         (e.g. one per [precision] mode, then BenchDiff between them)
+//.   --batch <n>           posts n corpus images per request to /api/check_liveness_batch
+//.                         instead (multipart : n "image" parts, base64 : {"images":[...]})
+//.   --accept <type>       sends Accept, e.g. application/cbor or application/msgpack against
+//.                         application/json : the report has the response bytes per request, so
+//.                         with --batch and --baseline the result encodings compare end to end
+//.   --store <dir>         also keeps the report in dir as <utc time>-<revision>.json, the run
+//.                         history BenchDiff compares
+//.   --revision <rev>      source revision measured (MI_BENCH_REVISION, else GIT_COMMIT, else
+//.                         "unknown"), e.g. --revision $(git rev-parse HEAD)
+//.   --soak <hours>        instead : steady load on the first selected endpoint for hours (closed
+//.                         loop, or open with --rate), sampled every --soak-interval : the server's
+//.                         resident memory, C heap (allocated and free), handles and the latency
+//.                         of the last interval; reports their growth per hour (least squares,
+//.                         first sample left out as warm-up) to catch leaks and fragmentation
+//.   --soak-interval <sec> sample period of --soak (60)
+//.   --unique <0|1>        make every single-image request a new upload (1) : 16 bytes that
+//.                         change per request follow the image (pixels : replace its last 16),
+//.                         so the server's result cache, coalescing and Redis cache miss and
+//.                         the run measures the checks; 0 replays the corpus as it is
+//.
+//. Reports throughput and p50/p90/p99/p999 latency per endpoint, or for --tls-handshakes
+//. the handshake rate, its latency and how many handshakes were resumed. TLS needs a
+//. build with OpenSSL (MI_HAS_OPENSSL=1, libssl / libcrypto linked).
+//. The report carries the server's core partition (mi_cores_processors on /metrics), so
+//. runs compared with --baseline show what they were run against. From a server counting
+//. allocations ([stats] allocations, GD_ALLOC_COUNT build) each result also has its
+//. allocations and bytes per request, from /stats before and after the run.
+//. Every report also has a "meta" object : revision, time, the client host, the bench
+//. options, and from the server's /health its build (GD_ID_VERSION), SDK release, host
+//. fingerprint and config version. Each result keeps a random sample of its latencies
+//. and its completions per window_ms window, from which BenchDiff tests whether two
+//. runs really differ. With the server's [cache] on, each result has its cache_hit_ratio
+//. from /api/cache_stats before and after the run, warm-up included.
+
+#include "Poco/Base64Encoder.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Environment.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Path.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/JSON/Stringifier.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef MI_HAS_OPENSSL
+#define MI_HAS_OPENSSL		0
+#endif
+#if MI_HAS_OPENSSL
+#include <openssl/ssl.h>
+#endif
+
+#define LD_BENCH_VERSION	"1.0.1.5"		//. GD_ID_VERSION the bench was written against
+#define LD_API_MULTIPART	"/api/check_liveness"
+#define LD_API_BASE64		"/api/check_liveness_base64"
+#define LD_API_BATCH		"/api/check_liveness_batch"
+#define LD_API_RAW			"/api/check_liveness_raw"
+#define LD_API_PIXELS		"/api/check_liveness_pixels"
+#define LD_API_VERSION		"/api/check_liveness_version"
+#define LD_API_METRICS		"/metrics"
+#define LD_API_HEALTH		"/health"
+#define LD_API_STATS		"/stats"
+#define LD_API_CACHE_STATS	"/api/cache_stats"
+#define LD_DEADLINE_HEADER	"X-Deadline-Ms"		//. GD_ADMISSION_HEADER
+#define LD_API_KEY_HEADER	"X-Api-Key"			//. GD_LANE_KEY_HEADER
+#define LD_CORES_METRIC		"mi_cores_processors{set=\""
+#define LD_RSS_METRIC		"mi_process_rss_bytes"
+#define LD_HEAP_METRIC		"mi_process_heap_allocated_bytes"
+#define LD_HEAP_FREE_METRIC	"mi_process_heap_free_bytes"
+#define LD_HANDLES_METRIC	"mi_process_handles"
+#define LD_CPU_METRIC		"process_cpu_seconds_total"
+#define LD_INGEST_CPU_METRIC	"mi_stage_cpu_seconds_total{stage=\"ingest\"}"	//. [metrics] stage_cpu
+#define LD_BOUNDARY			"----LivenessBenchBoundary7d1f"
+#define LD_SAMPLE_KEEP		10000		//. latencies kept per result for BenchDiff
+#define LD_WINDOW_MS		250			//. throughput series resolution
+#define LD_UNIQUE_BYTES		16			//. --unique : run nonce and request number
+#define LD_REVISION_ENV		"MI_BENCH_REVISION"
+
+using namespace Poco;
+using namespace Poco::Net;
+
+struct BenchOptions {
+	std::string			host;
+	int					port;
+	std::string			endpoint;
+	int					concurrency;
+	int					requests;
+	int					durationSec;
+	int					warmup;
+	bool				keepAlive;
+	std::string			corpus;
+	std::vector<int>	sizesKb;
+	std::string			jsonPath;
+	std::string			unixPath;
+	std::string			transport;
+	int					tlsHandshakes;		//. > 0 : handshake benchmark instead of the endpoints
+	bool				tlsResume;
+	std::string			baselinePath;
+	double				rate;				//. > 0 : open loop at this many requests per second
+	int					offeredPct;			//. > 0 : open loop at this share of the closed loop's throughput
+	int					deadlineMs;			//. > 0 : X-Deadline-Ms and goodput
+	std::string			apiKey;				//. X-Api-Key, empty = none
+	int					batch;				//. > 0 : images per request on LD_API_BATCH
+	std::string			accept;				//. Accept, empty = none
+	int					idle;				//. idle keep-alive connections held through the run
+	std::string			storeDir;
+	std::string			revision;
+	double				soakHours;			//. > 0 : soak run instead of the endpoints
+	int					soakIntervalSec;
+	bool				unique;				//. every single-image request a new upload
+};
+
+//. the request bodies of one image, in the order of lv_szBodies.
+enum BodyKind {
+	LD_BODY_MULTIPART = 0,
+	LD_BODY_BASE64,
+	LD_BODY_RAW,
+	LD_BODY_PIXELS,
+	LD_BODY_COUNT
+};
+
+static const char* lv_szBodies[LD_BODY_COUNT] = { "multipart", "base64", "raw", "pixels" };
+
+struct Payload {
+	std::string		name;
+	size_t			rawSize;
+	int				images;
+	std::string		multipartBody;
+	std::string		base64Body;
+	std::string		rawBody;			//. single image only, as are the pixels
+	std::string		pixelBody;			//. BGR, pixelWidth * pixelHeight * 3
+	int				pixelWidth;
+	int				pixelHeight;
+	//. --unique : where the image ends in multipartBody, and in base64Body where its whole
+	//. 3-byte groups end, followed by base64TailLen characters of its last base64Tail bytes.
+	size_t			multipartSplit;
+	size_t			base64Split;
+	size_t			base64TailLen;
+	std::string		base64Tail;
+};
+
+struct WorkerStats {
+	std::vector<double>	latMs;
+	uint64_t			ok;
+	uint64_t			httpError;
+	uint64_t			ioError;
+	uint64_t			bytesSent;
+	uint64_t			bytesReceived;		//. response bodies
+	uint64_t			good;				//. ok within --deadline-ms
+	std::vector<uint32_t>	windows;		//. answers per LD_WINDOW_MS since the start
+	WorkerStats() : ok(0), httpError(0), ioError(0), bytesSent(0), bytesReceived(0), good(0) {}
+};
+
+static std::string read_file(const std::string& p_strPath)
+{
+	std::ifstream in(p_strPath, std::ios::binary);
+	std::ostringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+static void put_base64(std::ostream& p_os, const std::string& p_strData)
+{
+	Base64Encoder enc(p_os);
+	enc.rdbuf()->setLineLength(0);
+	enc.write(p_strData.data(), p_strData.size());
+	enc.close();
+}
+
+//. one request's bodies : a single image, or with p_bBatch all of p_vFiles (name, data) for LD_API_BATCH.
+static Payload make_payload(const std::vector<std::pair<std::string, std::string>>& p_vFiles, bool p_bBatch)
+{
+	Payload p;
+	p.name = p_vFiles.front().first;
+	p.rawSize = 0;
+	p.images = (int)p_vFiles.size();
+	p.multipartSplit = p.base64Split = p.base64TailLen = 0;
+
+	std::ostringstream mp;
+	for (auto& f : p_vFiles) {
+		mp << "--" << LD_BOUNDARY << "\r\n"
+			<< "Content-Disposition: form-data; name=\"image\"; filename=\"" << f.first << "\"\r\n"
+			<< "Content-Type: application/octet-stream\r\n\r\n";
+		mp.write(f.second.data(), f.second.size());
+		p.multipartSplit = (size_t)mp.tellp();
+		mp << "\r\n";
+		p.rawSize += f.second.size();
+	}
+	mp << "--" << LD_BOUNDARY << "--\r\n";
+	p.multipartBody = mp.str();
+
+	std::ostringstream b64;
+	if (p_bBatch) {
+		b64 << "{\"images\":[";
+		for (size_t i = 0; i < p_vFiles.size(); i++) {
+			b64 << (i > 0 ? ",\"" : "\"");
+			put_base64(b64, p_vFiles[i].second);
+			b64 << "\"";
+		}
+		b64 << "]}";
+	}
+	else {
+		const std::string& data = p_vFiles.front().second;
+		size_t nWhole = data.size() / 3 * 3;
+		b64 << "{\"image\":\"";
+		put_base64(b64, data.substr(0, nWhole));
+		p.base64Split = (size_t)b64.tellp();
+		p.base64Tail = data.substr(nWhole);
+		put_base64(b64, p.base64Tail);
+		p.base64TailLen = (size_t)b64.tellp() - p.base64Split;
+		b64 << "\"}";
+	}
+	p.base64Body = b64.str();
+
+	p.pixelWidth = p.pixelHeight = 0;
+	if (p_bBatch) return p;
+	p.rawBody = p_vFiles.front().second;
+	//. a square frame of about the file's bytes : the upload a client that decoded it itself
+	//. would send for the same transfer, not the image's real geometry.
+	int side = std::max(16, (int)std::sqrt(p.rawSize / 3.0));
+	p.pixelWidth = p.pixelHeight = side;
+	p.pixelBody.resize((size_t)side * side * 3);
+	uint32_t x = 88675123u;
+	for (size_t k = 0; k < p.pixelBody.size(); k++) {
+		x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+		p.pixelBody[k] = (char)x;
+	}
+	return p;
+}
+
+static bool load_payloads(const BenchOptions& p_opt, std::vector<Payload>& p_vOut)
+{
+	std::vector<std::pair<std::string, std::string>> vFiles;
+	File dir(p_opt.corpus);
+	if (dir.exists() && dir.isDirectory()) {
+		for (DirectoryIterator it(p_opt.corpus), end; it != end; ++it) {
+			if (!it->isFile()) continue;
+			std::string ext = Path(it->path()).getExtension();
+			if (ext != "jpg" && ext != "jpeg" && ext != "png" && ext != "bmp" && ext != "JPG" && ext != "PNG") continue;
+			vFiles.emplace_back(Path(it->path()).getFileName(), read_file(it->path()));
+		}
+	}
+	//. synthetic payloads exercise ingest/decode cost at a given size; the SDK rejects them.
+	for (size_t i = 0; i < p_opt.sizesKb.size(); i++) {
+		std::string data((size_t)p_opt.sizesKb[i] * 1024, '\0');
+		uint32_t x = 2463534242u + (uint32_t)i;
+		for (size_t k = 0; k < data.size(); k++) {
+			x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+			data[k] = (char)x;
+		}
+		vFiles.emplace_back("synthetic_" + std::to_string(p_opt.sizesKb[i]) + "k.bin", data);
+	}
+	if (vFiles.empty()) return false;
+	if (p_opt.batch <= 0) {
+		for (auto& f : vFiles) p_vOut.push_back(make_payload(std::vector<std::pair<std::string, std::string>>(1, f), false));
+		return true;
+	}
+	//. --batch : the corpus in order, each request the next n files (wrapping round).
+	size_t nRequests = std::max((size_t)1, (vFiles.size() + p_opt.batch - 1) / p_opt.batch);
+	for (size_t r = 0; r < nRequests; r++) {
+		std::vector<std::pair<std::string, std::string>> vBatch;
+		for (int k = 0; k < p_opt.batch; k++) vBatch.push_back(vFiles[(r * p_opt.batch + k) % vFiles.size()]);
+		p_vOut.push_back(make_payload(vBatch, true));
+	}
+	return true;
+}
+
+//. HTTP over a Unix domain socket : every (re)connect goes to the socket path.
+class LocalClientSession : public HTTPClientSession {
+public:
+	LocalClientSession(const std::string& p_strHost, const std::string& p_strPath) : HTTPClientSession(p_strHost), m_strPath(p_strPath) {}
+
+protected:
+	void connect(const SocketAddress&) override
+	{
+#if defined(POCO_HAS_UNIX_SOCKET)
+		StreamSocket socket;
+		socket.connect(SocketAddress(SocketAddress::UNIX_LOCAL, m_strPath));
+		socket.setReceiveTimeout(getTimeout());
+		attachSocket(socket);
+#else
+		throw NotImplementedException("Unix domain sockets are not available in this build");
+#endif
+	}
+
+private:
+	std::string		m_strPath;
+};
+
+static const char* endpoint_path(const BenchOptions& p_opt, BodyKind p_body)
+{
+	if (p_opt.batch > 0) return LD_API_BATCH;
+	static const char* szPaths[LD_BODY_COUNT] = { LD_API_MULTIPART, LD_API_BASE64, LD_API_RAW, LD_API_PIXELS };
+	return szPaths[p_body];
+}
+
+//. the report's name of the endpoint; the two bodies of LD_API_BATCH are told apart.
+static std::string endpoint_label(const BenchOptions& p_opt, BodyKind p_body)
+{
+	std::string str = endpoint_path(p_opt, p_body);
+	if (p_opt.batch > 0 && p_body == LD_BODY_BASE64) str += " (base64)";
+	return str;
+}
+
+//. p_tStart : when the request was due, the latency counts from there.
+//. --unique : a nonce of the run and the number of the request, never the same twice.
+static std::string unique_bytes()
+{
+	static const uint64_t lv_nRun = std::random_device()() ^ (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+	static std::atomic<uint64_t> lv_nNext(0);
+	uint64_t v[2] = { lv_nRun, lv_nNext.fetch_add(1) };
+	return std::string((const char*)v, sizeof(v));
+}
+
+static bool send_one(HTTPClientSession& p_session, const BenchOptions& p_opt, BodyKind p_body, const Payload& p_payload, WorkerStats& p_stats, bool p_bRecord,
+	std::chrono::steady_clock::time_point p_tStart = std::chrono::steady_clock::time_point())
+{
+	const std::string* bodies[LD_BODY_COUNT] = { &p_payload.multipartBody, &p_payload.base64Body, &p_payload.rawBody, &p_payload.pixelBody };
+	const std::string& body = *bodies[p_body];
+	//. --unique : the body is sent as body[0, nSplit) + strInsert + body[nResume, size).
+	std::string strInsert;
+	size_t nSplit = body.size(), nResume = body.size();
+	if (p_opt.unique && p_payload.images == 1 && body.size() >= LD_UNIQUE_BYTES) {
+		std::string strUnique = unique_bytes();
+		if (p_body == LD_BODY_MULTIPART) {
+			nSplit = nResume = p_payload.multipartSplit;
+			strInsert = strUnique;
+		}
+		else if (p_body == LD_BODY_BASE64) {
+			nSplit = p_payload.base64Split;
+			nResume = nSplit + p_payload.base64TailLen;
+			std::ostringstream b64;
+			put_base64(b64, p_payload.base64Tail + strUnique);
+			strInsert = b64.str();
+		}
+		else if (p_body == LD_BODY_PIXELS) {
+			nSplit = body.size() - LD_UNIQUE_BYTES;
+			strInsert = strUnique;
+		}
+		else {
+			strInsert = strUnique;
+		}
+	}
+	size_t nBody = nSplit + strInsert.size() + (body.size() - nResume);
+	HTTPRequest req(HTTPRequest::HTTP_POST, endpoint_path(p_opt, p_body), HTTPMessage::HTTP_1_1);
+	req.setKeepAlive(p_opt.keepAlive);
+	if (p_body == LD_BODY_MULTIPART) req.setContentType(std::string("multipart/form-data; boundary=") + LD_BOUNDARY);
+	else if (p_body == LD_BODY_BASE64) req.setContentType("application/json");
+	else req.setContentType("application/octet-stream");
+	if (p_body == LD_BODY_PIXELS) {
+		req.set("X-Width", std::to_string(p_payload.pixelWidth));
+		req.set("X-Height", std::to_string(p_payload.pixelHeight));
+	}
+	req.setContentLength((std::streamsize)nBody);
+	if (p_opt.deadlineMs > 0) req.set(LD_DEADLINE_HEADER, std::to_string(p_opt.deadlineMs));
+	if (!p_opt.apiKey.empty()) req.set(LD_API_KEY_HEADER, p_opt.apiKey);
+	if (!p_opt.accept.empty()) req.set("Accept", p_opt.accept);
+
+	auto start = p_tStart != std::chrono::steady_clock::time_point() ? p_tStart : std::chrono::steady_clock::now();
+	try {
+		std::ostream& os = p_session.sendRequest(req);
+		os.write(body.data(), nSplit);
+		os.write(strInsert.data(), strInsert.size());
+		os.write(body.data() + nResume, body.size() - nResume);
+
+		HTTPResponse rsp;
+		std::istream& is = p_session.receiveResponse(rsp);
+		std::ostringstream sink;
+		StreamCopier::copyStream(is, sink);
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!p_bRecord) return true;
+		p_stats.latMs.push_back(ms);
+		p_stats.bytesSent += nBody;
+		p_stats.bytesReceived += (uint64_t)sink.tellp();
+		if (rsp.getStatus() == HTTPResponse::HTTP_OK) {
+			p_stats.ok++;
+			if (p_opt.deadlineMs <= 0 || ms <= p_opt.deadlineMs) p_stats.good++;
+		}
+		else {
+			p_stats.httpError++;
+		}
+		if (!p_opt.keepAlive) p_session.reset();
+		return true;
+	}
+	catch (const Exception&) {
+		if (p_bRecord) p_stats.ioError++;
+		p_session.reset();
+		return false;
+	}
+}
+
+static double percentile(const std::vector<double>& p_vSorted, double p_dQ)
+{
+	if (p_vSorted.empty()) return 0;
+	size_t idx = (size_t)(p_dQ * (p_vSorted.size() - 1) + 0.5);
+	return p_vSorted[std::min(idx, p_vSorted.size() - 1)];
+}
+
+//. totals of the server's "allocations" on /stats ([stats] allocations, MiAlloc.h).
+struct ServerAllocs {
+	double	requests;
+	double	count;
+	double	bytes;
+	ServerAllocs() : requests(-1), count(0), bytes(0) {}
+};
+
+//. requests < 0 when the server does not count allocations.
+static ServerAllocs server_allocs(const BenchOptions& p_opt)
+{
+	ServerAllocs a;
+	try {
+		HTTPClientSession session(p_opt.host, (Poco::UInt16)p_opt.port);
+		session.setTimeout(Timespan(5, 0));
+		HTTPRequest req(HTTPRequest::HTTP_GET, LD_API_STATS, HTTPMessage::HTTP_1_1);
+		session.sendRequest(req);
+		HTTPResponse res;
+		std::string strBody;
+		StreamCopier::copyToString(session.receiveResponse(res), strBody);
+		if (res.getStatus() != HTTPResponse::HTTP_OK) return a;
+		JSON::Parser parser;
+		JSON::Object::Ptr stats = parser.parse(strBody).extract<JSON::Object::Ptr>();
+		JSON::Object::Ptr allocs = stats->getObject("allocations");
+		if (allocs.isNull()) return a;
+		a.requests = allocs->getValue<double>("requests");
+		a.count = allocs->getValue<double>("count_per_request") * a.requests;
+		a.bytes = allocs->getValue<double>("bytes_per_request") * a.requests;
+	}
+	catch (const Exception&) {
+	}
+	return a;
+}
+
+//. hits and misses of the server's result cache ([cache] enable); hits < 0 when it is off.
+struct ServerCache {
+	double	hits;
+	double	misses;
+	ServerCache() : hits(-1), misses(0) {}
+};
+
+static ServerCache server_cache(const BenchOptions& p_opt)
+{
+	ServerCache c;
+	try {
+		HTTPClientSession session(p_opt.host, (Poco::UInt16)p_opt.port);
+		session.setTimeout(Timespan(5, 0));
+		HTTPRequest req(HTTPRequest::HTTP_GET, LD_API_CACHE_STATS, HTTPMessage::HTTP_1_1);
+		session.sendRequest(req);
+		HTTPResponse res;
+		std::string strBody;
+		StreamCopier::copyToString(session.receiveResponse(res), strBody);
+		if (res.getStatus() != HTTPResponse::HTTP_OK) return c;
+		JSON::Parser parser;
+		JSON::Object::Ptr stats = parser.parse(strBody).extract<JSON::Object::Ptr>();
+		if (!stats->optValue<bool>("enabled", false)) return c;
+		c.hits = stats->getValue<double>("hits");
+		c.misses = stats->getValue<double>("misses");
+	}
+	catch (const Exception&) {
+	}
+	return c;
+}
+
+//. p_dRate > 0 : open loop, request n due at start + n / p_dRate.
+static JSON::Object::Ptr run_endpoint(const BenchOptions& p_opt, BodyKind p_body, bool p_bUnix, const std::vector<Payload>& p_vPayloads, double p_dRate = 0)
+{
+	std::vector<WorkerStats> stats(p_opt.concurrency);
+	std::vector<std::thread> threads;
+	std::atomic<int> nextReq(0);
+	std::atomic<bool> stop(false);
+
+	ServerAllocs allocsBefore = server_allocs(p_opt);
+	ServerCache cacheBefore = server_cache(p_opt);
+	std::chrono::steady_clock::time_point start;
+	std::atomic<int> warmed(0);
+	std::atomic<bool> go(p_dRate <= 0);
+	auto worker = [&](int p_nId) {
+		std::unique_ptr<HTTPClientSession> pSession(p_bUnix ? new LocalClientSession(p_opt.host, p_opt.unixPath) : new HTTPClientSession(p_opt.host, (Poco::UInt16)p_opt.port));
+		HTTPClientSession& session = *pSession;
+		session.setKeepAlive(p_opt.keepAlive);
+		session.setTimeout(Timespan(120, 0));
+		for (int i = 0; i < p_opt.warmup; i++) {
+			send_one(session, p_opt, p_body, p_vPayloads[(p_nId + i) % p_vPayloads.size()], stats[p_nId], false);
+		}
+		warmed++;
+		while (!go.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		while (!stop.load(std::memory_order_relaxed)) {
+			int n = nextReq.fetch_add(1);
+			if (p_opt.durationSec <= 0 && n >= p_opt.requests) break;
+			std::chrono::steady_clock::time_point due;
+			if (p_dRate > 0) {
+				due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(n / p_dRate));
+				if (p_opt.durationSec > 0 && due >= start + std::chrono::seconds(p_opt.durationSec)) break;
+				std::this_thread::sleep_until(due);
+			}
+			size_t nBefore = stats[p_nId].latMs.size();
+			send_one(session, p_opt, p_body, p_vPayloads[n % p_vPayloads.size()], stats[p_nId], true, due);
+			if (stats[p_nId].latMs.size() == nBefore) continue;
+			size_t w = (size_t)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / LD_WINDOW_MS);
+			if (stats[p_nId].windows.size() <= w) stats[p_nId].windows.resize(w + 1, 0);
+			stats[p_nId].windows[w]++;
+		}
+	};
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < p_opt.concurrency; i++) threads.emplace_back(worker, i);
+	if (p_dRate > 0) {
+		//. the open loop's schedule starts once every thread has warmed up.
+		while (warmed.load() < p_opt.concurrency) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		start = std::chrono::steady_clock::now();
+		go = true;
+	}
+	if (p_opt.durationSec > 0) {
+		std::this_thread::sleep_for(std::chrono::seconds(p_opt.durationSec));
+		stop = true;
+	}
+	for (auto& t : threads) t.join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<double> all;
+	WorkerStats total;
+	for (auto& s : stats) {
+		all.insert(all.end(), s.latMs.begin(), s.latMs.end());
+		total.ok += s.ok;
+		total.httpError += s.httpError;
+		total.ioError += s.ioError;
+		total.bytesSent += s.bytesSent;
+		total.bytesReceived += s.bytesReceived;
+		total.good += s.good;
+		if (total.windows.size() < s.windows.size()) total.windows.resize(s.windows.size(), 0);
+		for (size_t w = 0; w < s.windows.size(); w++) total.windows[w] += s.windows[w];
+	}
+	//. a uniform sample of the answers, independent of which thread or when.
+	JSON::Array::Ptr sample = new JSON::Array;
+	{
+		std::vector<double> v(all);
+		std::mt19937_64 rng(v.size());
+		size_t nKeep = std::min(v.size(), (size_t)LD_SAMPLE_KEEP);
+		for (size_t i = 0; i < nKeep; i++) {
+			std::swap(v[i], v[i + (size_t)(rng() % (v.size() - i))]);
+			sample->add(std::round(v[i] * 1000.0) / 1000.0);
+		}
+	}
+	JSON::Array::Ptr windows = new JSON::Array;
+	for (uint32_t n : total.windows) windows->add(n);
+	std::sort(all.begin(), all.end());
+
+	double sum = 0;
+	for (double v : all) sum += v;
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("endpoint", endpoint_label(p_opt, p_body));
+	r->set("transport", p_bUnix ? "unix" : "tcp");
+	r->set("load", p_dRate > 0 ? "open" : "closed");
+	if (p_dRate > 0) r->set("offered_rps", p_dRate);
+	r->set("requests", (uint64_t)all.size());
+	r->set("ok", total.ok);
+	r->set("http_errors", total.httpError);
+	r->set("io_errors", total.ioError);
+	r->set("elapsed_sec", elapsed);
+	r->set("throughput_rps", elapsed > 0 ? all.size() / elapsed : 0.0);
+	if (p_opt.deadlineMs > 0) {
+		r->set("deadline_ms", p_opt.deadlineMs);
+		r->set("good", total.good);
+		r->set("goodput_rps", elapsed > 0 ? total.good / elapsed : 0.0);
+	}
+	r->set("upload_mb_per_sec", elapsed > 0 ? total.bytesSent / elapsed / (1024.0 * 1024.0) : 0.0);
+	r->set("download_mb_per_sec", elapsed > 0 ? total.bytesReceived / elapsed / (1024.0 * 1024.0) : 0.0);
+	r->set("response_bytes_per_request", all.empty() ? 0.0 : (double)total.bytesReceived / all.size());
+	if (p_opt.batch > 0) {
+		r->set("images_per_request", p_opt.batch);
+		r->set("images_per_sec", elapsed > 0 ? all.size() * (double)p_opt.batch / elapsed : 0.0);
+	}
+	if (!p_opt.accept.empty()) r->set("accept", p_opt.accept);
+	r->set("mean_ms", all.empty() ? 0.0 : sum / all.size());
+	r->set("min_ms", all.empty() ? 0.0 : all.front());
+	r->set("p50_ms", percentile(all, 0.50));
+	r->set("p90_ms", percentile(all, 0.90));
+	r->set("p99_ms", percentile(all, 0.99));
+	r->set("p999_ms", percentile(all, 0.999));
+	r->set("max_ms", all.empty() ? 0.0 : all.back());
+	r->set("window_ms", LD_WINDOW_MS);
+	r->set("window_counts", windows);
+	r->set("latency_sample_ms", sample);
+	//. the warm-up requests are in both, the server's other traffic too.
+	ServerAllocs allocsAfter = allocsBefore.requests >= 0 ? server_allocs(p_opt) : ServerAllocs();
+	if (allocsAfter.requests > allocsBefore.requests) {
+		double n = allocsAfter.requests - allocsBefore.requests;
+		r->set("server_allocs_per_request", (allocsAfter.count - allocsBefore.count) / n);
+		r->set("server_alloc_bytes_per_request", (allocsAfter.bytes - allocsBefore.bytes) / n);
+	}
+	r->set("unique", p_opt.unique);
+	ServerCache cacheAfter = cacheBefore.hits >= 0 ? server_cache(p_opt) : ServerCache();
+	double nLookups = (cacheAfter.hits - cacheBefore.hits) + (cacheAfter.misses - cacheBefore.misses);
+	if (cacheAfter.hits >= 0 && nLookups > 0) r->set("cache_hit_ratio", (cacheAfter.hits - cacheBefore.hits) / nLookups);
+	return r;
+}
+
+#if MI_HAS_OPENSSL
+struct TlsStats {
+	std::vector<double>	handshakeMs;
+	uint64_t			resumed;
+	uint64_t			failed;
+	TlsStats() : resumed(0), failed(0) {}
+};
+
+//. one connection : handshake (timed), GET of the version so TLS 1.3 tickets arrive, close.
+//. p_ppSession in : the session to offer, out : the one to offer next time.
+static void tls_one(SSL_CTX* p_pCtx, const BenchOptions& p_opt, SSL_SESSION** p_ppSession, TlsStats& p_stats)
+{
+	SSL* pSsl = NULL;
+	try {
+		StreamSocket socket;
+		socket.connect(SocketAddress(p_opt.host, (Poco::UInt16)p_opt.port), Timespan(10, 0));
+		socket.setNoDelay(true);
+		pSsl = SSL_new(p_pCtx);
+		SSL_set_fd(pSsl, (int)socket.impl()->sockfd());
+		SSL_set_tlsext_host_name(pSsl, p_opt.host.c_str());
+		if (*p_ppSession != NULL) SSL_set_session(pSsl, *p_ppSession);
+
+		auto start = std::chrono::steady_clock::now();
+		if (SSL_connect(pSsl) != 1) throw IOException("SSL_connect");
+		p_stats.handshakeMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		if (SSL_session_reused(pSsl)) p_stats.resumed++;
+
+		std::string req = std::string("GET ") + LD_API_VERSION + " HTTP/1.1\r\nHost: " + p_opt.host + "\r\nConnection: close\r\n\r\n";
+		if (SSL_write(pSsl, req.data(), (int)req.size()) <= 0) throw IOException("SSL_write");
+		char buf[4096];
+		while (SSL_read(pSsl, buf, sizeof(buf)) > 0) {}
+
+		if (p_opt.tlsResume) {
+			SSL_SESSION* pNext = SSL_get1_session(pSsl);
+			if (pNext != NULL) {
+				if (*p_ppSession != NULL) SSL_SESSION_free(*p_ppSession);
+				*p_ppSession = pNext;
+			}
+		}
+		SSL_shutdown(pSsl);
+	}
+	catch (const Exception&) {
+		p_stats.failed++;
+	}
+	if (pSsl != NULL) SSL_free(pSsl);
+}
+#endif
+
+static JSON::Object::Ptr run_tls(const BenchOptions& p_opt)
+{
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("endpoint", "tls_handshake");
+#if MI_HAS_OPENSSL
+	SSL_CTX* pCtx = SSL_CTX_new(TLS_client_method());
+	SSL_CTX_set_min_proto_version(pCtx, TLS1_2_VERSION);
+	SSL_CTX_set_verify(pCtx, SSL_VERIFY_NONE, NULL);		//. measures the handshake, not the PKI
+	SSL_CTX_set_session_cache_mode(pCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+	std::vector<TlsStats> stats(p_opt.concurrency);
+	std::vector<std::thread> threads;
+	std::atomic<int> next(0);
+	auto worker = [&](int p_nId) {
+		SSL_SESSION* pSession = NULL;
+		while (next.fetch_add(1) < p_opt.tlsHandshakes) tls_one(pCtx, p_opt, &pSession, stats[p_nId]);
+		if (pSession != NULL) SSL_SESSION_free(pSession);
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < p_opt.concurrency; i++) threads.emplace_back(worker, i);
+	for (auto& t : threads) t.join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	SSL_CTX_free(pCtx);
+
+	std::vector<double> all;
+	TlsStats total;
+	for (auto& s : stats) {
+		all.insert(all.end(), s.handshakeMs.begin(), s.handshakeMs.end());
+		total.resumed += s.resumed;
+		total.failed += s.failed;
+	}
+	std::sort(all.begin(), all.end());
+
+	//. every thread's first connection has nothing to resume.
+	uint64_t resumable = all.size() > (size_t)p_opt.concurrency ? all.size() - p_opt.concurrency : 0;
+	r->set("handshakes", (uint64_t)all.size());
+	r->set("resumed", total.resumed);
+	r->set("failed", total.failed);
+	r->set("resume_offered", p_opt.tlsResume);
+	r->set("resumption_rate", p_opt.tlsResume && resumable > 0 ? (double)total.resumed / resumable : 0.0);
+	r->set("elapsed_sec", elapsed);
+	r->set("handshakes_per_sec", elapsed > 0 ? all.size() / elapsed : 0.0);
+	r->set("p50_ms", percentile(all, 0.50));
+	r->set("p90_ms", percentile(all, 0.90));
+	r->set("p99_ms", percentile(all, 0.99));
+	r->set("max_ms", all.empty() ? 0.0 : all.back());
+#else
+	r->set("error", "built without OpenSSL (MI_HAS_OPENSSL)");
+#endif
+	return r;
+}
+
+static void write_json(const BenchOptions& p_opt, JSON::Object::Ptr p_report)
+{
+	if (p_opt.jsonPath.empty()) return;
+	if (p_opt.jsonPath == "-") {
+		JSON::Stringifier::stringify(p_report, std::cout, 2);
+		std::cout << std::endl;
+	}
+	else {
+		std::ofstream out(p_opt.jsonPath);
+		JSON::Stringifier::stringify(p_report, out, 2);
+	}
+}
+
+//. the server's /metrics text, empty when it cannot be read ([metrics] disabled, older server).
+static std::string server_metrics(const BenchOptions& p_opt)
+{
+	try {
+		HTTPClientSession session(p_opt.host, (Poco::UInt16)p_opt.port);
+		session.setTimeout(Timespan(5, 0));
+		HTTPRequest req(HTTPRequest::HTTP_GET, LD_API_METRICS, HTTPMessage::HTTP_1_1);
+		session.sendRequest(req);
+		HTTPResponse res;
+		std::string strBody;
+		StreamCopier::copyToString(session.receiveResponse(res), strBody);
+		return res.getStatus() == HTTPResponse::HTTP_OK ? strBody : "";
+	}
+	catch (const Exception&) {
+		return "";
+	}
+}
+
+//. the server's /health document (also sent with 503), NULL when it cannot be read.
+static JSON::Object::Ptr server_health(const BenchOptions& p_opt)
+{
+	try {
+		HTTPClientSession session(p_opt.host, (Poco::UInt16)p_opt.port);
+		session.setTimeout(Timespan(5, 0));
+		HTTPRequest req(HTTPRequest::HTTP_GET, LD_API_HEALTH, HTTPMessage::HTTP_1_1);
+		session.sendRequest(req);
+		HTTPResponse res;
+		std::string strBody;
+		StreamCopier::copyToString(session.receiveResponse(res), strBody);
+		JSON::Parser parser;
+		return parser.parse(strBody).extract<JSON::Object::Ptr>();
+	}
+	catch (const Exception&) {
+		return NULL;
+	}
+}
+
+//. what was measured, on what : the "meta" object of a report.
+static JSON::Object::Ptr run_meta(const BenchOptions& p_opt, int p_argc, char** p_argv)
+{
+	JSON::Object::Ptr meta = new JSON::Object;
+	meta->set("revision", p_opt.revision);
+	meta->set("time", DateTimeFormatter::format(Timestamp(), DateTimeFormat::ISO8601_FORMAT));
+	meta->set("bench_version", LD_BENCH_VERSION);
+	JSON::Object::Ptr client = new JSON::Object;
+	client->set("node", Environment::nodeName());
+	client->set("os", Environment::osName() + " " + Environment::osVersion());
+	client->set("processors", (int)Environment::processorCount());
+	meta->set("client", client);
+	std::string strArgs;
+	//. the key is a secret : masked, so runs of two tenants keep the same args.
+	for (int i = 1; i < p_argc; i++) strArgs += (i > 1 ? " " : "") + std::string(i > 1 && strcmp(p_argv[i - 1], "--api-key") == 0 ? "*" : p_argv[i]);
+	JSON::Object::Ptr config = new JSON::Object;
+	config->set("args", strArgs);
+	config->set("endpoint", p_opt.endpoint);
+	config->set("transport", p_opt.transport);
+	config->set("concurrency", p_opt.concurrency);
+	config->set("requests", p_opt.requests);
+	config->set("duration_sec", p_opt.durationSec);
+	config->set("warmup", p_opt.warmup);
+	config->set("keep_alive", p_opt.keepAlive);
+	config->set("corpus", p_opt.corpus);
+	config->set("rate", p_opt.rate);
+	config->set("offered_pct", p_opt.offeredPct);
+	config->set("deadline_ms", p_opt.deadlineMs);
+	config->set("batch", p_opt.batch);
+	config->set("accept", p_opt.accept);
+	meta->set("config", config);
+	JSON::Object::Ptr health = server_health(p_opt);
+	if (!health.isNull()) {
+		JSON::Object::Ptr server = new JSON::Object;
+		if (health->has("build")) server->set("build", health->getObject("build"));
+		if (health->has("sdk")) server->set("sdk", health->getObject("sdk"));
+		if (health->has("host")) server->set("host", health->getObject("host"));
+		if (health->has("config")) server->set("config", health->getObject("config"));
+		meta->set("server", server);
+	}
+	return meta;
+}
+
+//. --store : the report as <dir>/<utc yyyymmdd-hhmmss>-<revision>.json.
+static void store_report(const BenchOptions& p_opt, JSON::Object::Ptr p_report)
+{
+	if (p_opt.storeDir.empty()) return;
+	try {
+		File(p_opt.storeDir).createDirectories();
+		std::string strRev = p_opt.revision.substr(0, 12);
+		for (char& c : strRev) if (!isalnum((unsigned char)c) && c != '-' && c != '.') c = '_';
+		Path path(Path(p_opt.storeDir).makeDirectory(), DateTimeFormatter::format(Timestamp(), "%Y%m%d-%H%M%S") + "-" + strRev + ".json");
+		std::ofstream out(path.toString());
+		JSON::Stringifier::stringify(p_report, out, 2);
+		std::cout << "stored " << path.toString() << std::endl;
+	}
+	catch (const Exception& ex) {
+		std::cout << "store " << p_opt.storeDir << " : " << ex.displayText() << std::endl;
+	}
+}
+
+//. value of the unlabelled metric p_pszName, -1 when it is not there.
+static double metric_value(const std::string& p_strMetrics, const char* p_pszName)
+{
+	std::istringstream lines(p_strMetrics);
+	std::string strLine;
+	while (std::getline(lines, strLine)) {
+		if (strLine.compare(0, strlen(p_pszName), p_pszName) == 0 && strLine.size() > strlen(p_pszName) && strLine[strlen(p_pszName)] == ' ') {
+			return atof(strLine.c_str() + strlen(p_pszName) + 1);
+		}
+	}
+	return -1;
+}
+
+//. the server's CPU seconds so far : the whole process, and the handling threads' ingest
+//. stage (body read, multipart / base64 decode) with [metrics] stage_cpu; -1 = not there.
+struct ServerCpu {
+	double	total;
+	double	ingest;
+};
+
+static ServerCpu server_cpu(const BenchOptions& p_opt)
+{
+	std::string strMetrics = server_metrics(p_opt);
+	ServerCpu c;
+	c.total = metric_value(strMetrics, LD_CPU_METRIC);
+	c.ingest = metric_value(strMetrics, LD_INGEST_CPU_METRIC);
+	return c;
+}
+
+//. server CPU ms per request of the run p_r, its warm-up requests included : what one upload
+//. format costs the server against another, apart from the client's side of the latency.
+static void add_server_cpu(const BenchOptions& p_opt, const ServerCpu& p_before, const ServerCpu& p_after, JSON::Object::Ptr p_r)
+{
+	double n = (double)p_r->getValue<uint64_t>("requests") + (double)p_opt.warmup * p_opt.concurrency;
+	if (n <= 0) return;
+	if (p_before.total >= 0 && p_after.total >= p_before.total) p_r->set("server_cpu_ms_per_request", (p_after.total - p_before.total) * 1000.0 / n);
+	if (p_before.ingest >= 0 && p_after.ingest >= p_before.ingest) p_r->set("server_ingest_cpu_ms_per_request", (p_after.ingest - p_before.ingest) * 1000.0 / n);
+}
+
+//. "io=2 inference=14" from the server's /metrics, "off" without a partition, empty when
+//. the metrics cannot be read.
+static std::string server_cores(const BenchOptions& p_opt)
+{
+	std::string strBody = server_metrics(p_opt);
+	std::string strOut;
+	bool bAny = false;
+	std::istringstream lines(strBody);
+	std::string strLine;
+	while (std::getline(lines, strLine)) {
+		if (strLine.compare(0, strlen(LD_CORES_METRIC), LD_CORES_METRIC) != 0) continue;
+		size_t nameEnd = strLine.find('"', strlen(LD_CORES_METRIC));
+		size_t space = strLine.rfind(' ');
+		if (nameEnd == std::string::npos || space == std::string::npos) continue;
+		int n = (int)atof(strLine.c_str() + space + 1);
+		if (n > 0) bAny = true;
+		if (!strOut.empty()) strOut += " ";
+		strOut += strLine.substr(strlen(LD_CORES_METRIC), nameEnd - strlen(LD_CORES_METRIC)) + "=" + std::to_string(n);
+	}
+	return strOut.empty() ? "" : (bAny ? strOut : "off");
+}
+
+//. --idle : opens the connections into p_vSockets, each answered once so the server holds
+//. it as a kept-alive connection between requests.
+static JSON::Object::Ptr open_idle(const BenchOptions& p_opt, std::vector<StreamSocket>& p_vSockets)
+{
+	double rssBefore = metric_value(server_metrics(p_opt), LD_RSS_METRIC);
+	std::string req = std::string("GET ") + LD_API_VERSION + " HTTP/1.1\r\nHost: " + p_opt.host + "\r\nConnection: keep-alive\r\n\r\n";
+	uint64_t failed = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < p_opt.idle; i++) {
+		try {
+			StreamSocket socket;
+			socket.connect(SocketAddress(p_opt.host, (Poco::UInt16)p_opt.port), Timespan(10, 0));
+			socket.setReceiveTimeout(Timespan(10, 0));
+			socket.sendBytes(req.data(), (int)req.size());
+			//. the version answer is small : its headers and body come in one read or two.
+			std::string strIn;
+			char buf[4096];
+			while (strIn.find("\r\n\r\n") == std::string::npos) {
+				int n = socket.receiveBytes(buf, sizeof(buf));
+				if (n <= 0) throw IOException("closed");
+				strIn.append(buf, n);
+			}
+			p_vSockets.push_back(socket);
+		}
+		catch (const Exception&) {
+			failed++;
+		}
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double rssAfter = metric_value(server_metrics(p_opt), LD_RSS_METRIC);
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("requested", p_opt.idle);
+	r->set("opened", (uint64_t)p_vSockets.size());
+	r->set("failed", failed);
+	r->set("open_sec", elapsed);
+	if (rssBefore >= 0 && rssAfter >= 0) {
+		r->set("server_rss_before_mb", rssBefore / (1024.0 * 1024.0));
+		r->set("server_rss_after_mb", rssAfter / (1024.0 * 1024.0));
+		r->set("server_bytes_per_connection", p_vSockets.empty() ? 0.0 : (rssAfter - rssBefore) / p_vSockets.size());
+	}
+	return r;
+}
+
+//. idle connections the server has not closed : a closed one reads as readable (end of stream).
+static uint64_t idle_alive(std::vector<StreamSocket>& p_vSockets)
+{
+	uint64_t alive = 0;
+	for (StreamSocket& s : p_vSockets) {
+		try {
+			if (!s.poll(Timespan(0), Socket::SELECT_READ | Socket::SELECT_ERROR)) alive++;
+		}
+		catch (const Exception&) {
+		}
+	}
+	return alive;
+}
+
+//. least-squares slope of p_vY over p_vX, 0 with fewer than two points.
+static double slope(const std::vector<double>& p_vX, const std::vector<double>& p_vY)
+{
+	size_t n = p_vX.size();
+	if (n < 2) return 0;
+	double mx = 0, my = 0;
+	for (size_t i = 0; i < n; i++) { mx += p_vX[i]; my += p_vY[i]; }
+	mx /= n;
+	my /= n;
+	double sxy = 0, sxx = 0;
+	for (size_t i = 0; i < n; i++) {
+		sxy += (p_vX[i] - mx) * (p_vY[i] - my);
+		sxx += (p_vX[i] - mx) * (p_vX[i] - mx);
+	}
+	return sxx > 0 ? sxy / sxx : 0;
+}
+
+//. --soak : back-to-back --soak-interval runs of one endpoint, each followed by a read of the
+//. server's memory and handle gauges. Every run opens its connections anew, which the
+//. handle count then also shows if the server does not release them.
+static JSON::Object::Ptr run_soak(const BenchOptions& p_opt, BodyKind p_body, bool p_bUnix, const std::vector<Payload>& p_vPayloads)
+{
+	static const char* szSeries[] = { "rss_mb", "heap_allocated_mb", "heap_free_mb", "handles", "p50_ms", "p99_ms", "throughput_rps" };
+	const int nSeries = (int)(sizeof(szSeries) / sizeof(szSeries[0]));
+	BenchOptions seg = p_opt;
+	seg.durationSec = std::max(p_opt.soakIntervalSec, 1);
+	auto start = std::chrono::steady_clock::now();
+	auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(p_opt.soakHours * 3600.0));
+	std::vector<double> vHours;
+	std::vector<std::vector<double>> vValues(nSeries);
+	std::vector<std::vector<double>> vKnown(nSeries);		//. hours of the samples the server reported, per series
+	JSON::Array::Ptr samples = new JSON::Array;
+	uint64_t nErrors = 0;
+	printf("%8s %10s %10s %10s %8s %9s %9s %9s\n", "hours", "rss MB", "heap MB", "free MB", "handles", "p50 ms", "p99 ms", "req/s");
+	for (int i = 0; std::chrono::steady_clock::now() < end; i++) {
+		seg.warmup = i == 0 ? p_opt.warmup : 0;
+		JSON::Object::Ptr r = run_endpoint(seg, p_body, p_bUnix, p_vPayloads, p_opt.rate);
+		std::string strMetrics = server_metrics(p_opt);
+		double hours = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 3600.0;
+		double rss = metric_value(strMetrics, LD_RSS_METRIC), heap = metric_value(strMetrics, LD_HEAP_METRIC);
+		double heapFree = metric_value(strMetrics, LD_HEAP_FREE_METRIC), handles = metric_value(strMetrics, LD_HANDLES_METRIC);
+		double v[] = { rss >= 0 ? rss / (1024.0 * 1024.0) : -1, heap >= 0 ? heap / (1024.0 * 1024.0) : -1, heapFree >= 0 ? heapFree / (1024.0 * 1024.0) : -1,
+			handles, r->getValue<double>("p50_ms"), r->getValue<double>("p99_ms"), r->getValue<double>("throughput_rps") };
+		nErrors += r->getValue<uint64_t>("http_errors") + r->getValue<uint64_t>("io_errors");
+
+		JSON::Object::Ptr sample = new JSON::Object;
+		sample->set("hours", hours);
+		for (int k = 0; k < nSeries; k++) {
+			if (v[k] < 0) continue;
+			sample->set(szSeries[k], v[k]);
+			//. the first interval warms the server up, its growth is not a leak.
+			if (i == 0) continue;
+			vKnown[k].push_back(hours);
+			vValues[k].push_back(v[k]);
+		}
+		samples->add(sample);
+		printf("%8.2f %10.1f %10.1f %10.1f %8.0f %9.2f %9.2f %9.1f\n", hours, v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+		fflush(stdout);
+	}
+
+	JSON::Object::Ptr slopes = new JSON::Object;
+	for (int k = 0; k < nSeries; k++) {
+		if (vValues[k].size() >= 2) slopes->set(std::string(szSeries[k]) + "_per_hour", slope(vKnown[k], vValues[k]));
+	}
+	JSON::Object::Ptr soak = new JSON::Object;
+	soak->set("endpoint", endpoint_label(p_opt, p_body));
+	soak->set("transport", p_bUnix ? "unix" : "tcp");
+	soak->set("load", p_opt.rate > 0 ? "open" : "closed");
+	soak->set("hours", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 3600.0);
+	soak->set("interval_sec", seg.durationSec);
+	soak->set("errors", nErrors);
+	soak->set("samples", samples);
+	soak->set("slopes", slopes);
+	return soak;
+}
+
+//. adds the baseline latencies and the change to every result the baseline has too.
+static void compare_baseline(const BenchOptions& p_opt, JSON::Array::Ptr p_results)
+{
+	JSON::Object::Ptr pBase;
+	try {
+		JSON::Parser parser;
+		pBase = parser.parse(read_file(p_opt.baselinePath)).extract<JSON::Object::Ptr>();
+	}
+	catch (const Exception& ex) {
+		std::cout << "baseline " << p_opt.baselinePath << " : " << ex.displayText() << std::endl;
+		return;
+	}
+	JSON::Array::Ptr pBaseResults = pBase->getArray("results");
+	if (pBaseResults.isNull()) return;
+	std::string strBaseCores = pBase->optValue<std::string>("server_cores", "");
+	std::cout << "against " << p_opt.baselinePath << (strBaseCores.empty() ? "" : " (cores " + strBaseCores + ")") << " :" << std::endl;
+	for (size_t i = 0; i < p_results->size(); i++) {
+		JSON::Object::Ptr r = p_results->getObject((unsigned int)i);
+		for (size_t j = 0; j < pBaseResults->size(); j++) {
+			JSON::Object::Ptr b = pBaseResults->getObject((unsigned int)j);
+			if (b->optValue<std::string>("endpoint", "") != r->getValue<std::string>("endpoint") || b->optValue<std::string>("transport", "tcp") != r->getValue<std::string>("transport")
+				|| b->optValue<std::string>("load", "closed") != r->getValue<std::string>("load")) continue;
+			double p50 = b->optValue<double>("p50_ms", 0.0), p99 = b->optValue<double>("p99_ms", 0.0);
+			double p50Change = p50 > 0 ? 100.0 * (r->getValue<double>("p50_ms") - p50) / p50 : 0.0;
+			double p99Change = p99 > 0 ? 100.0 * (r->getValue<double>("p99_ms") - p99) / p99 : 0.0;
+			r->set("baseline_p50_ms", p50);
+			r->set("baseline_p99_ms", p99);
+			r->set("p99_change_pct", p99Change);
+			printf("%-28s %-4s p50 %7.2f -> %7.2f (%+.1f%%)  p99 %7.2f -> %7.2f (%+.1f%%) ms\n",
+				r->getValue<std::string>("endpoint").c_str(), r->getValue<std::string>("transport").c_str(),
+				p50, r->getValue<double>("p50_ms"), p50Change, p99, r->getValue<double>("p99_ms"), p99Change);
+			if (r->has("goodput_rps") && b->has("goodput_rps")) {
+				double good = b->getValue<double>("goodput_rps");
+				r->set("baseline_goodput_rps", good);
+				printf("%-28s %-4s goodput %8.1f -> %8.1f req/s (%+.1f%%) within %d ms\n", "", r->getValue<std::string>("load").c_str(),
+					good, r->getValue<double>("goodput_rps"), good > 0 ? 100.0 * (r->getValue<double>("goodput_rps") - good) / good : 0.0,
+					r->getValue<int>("deadline_ms"));
+			}
+			break;
+		}
+	}
+}
+
+static void usage()
+{
+	std::cout << "LivenessBench [--host h] [--port p] [--endpoint multipart|base64|raw|pixels|both|all] [--concurrency n]\n"
+		"              [--requests n | --duration sec] [--warmup n] [--keepalive 0|1]\n"
+		"              [--corpus dir] [--sizes kb,kb,...] [--json file|-]\n"
+		"              [--unix path] [--transport tcp|unix|both] [--tls-handshakes n [--tls-resume 0|1]]\n"
+		"              [--baseline report.json] [--rate rps | --offered pct] [--deadline-ms ms] [--idle n]\n"
+		"              [--api-key key] [--batch n] [--accept type]\n"
+		"              [--store dir] [--revision rev] [--soak hours [--soak-interval sec]] [--unique 0|1]" << std::endl;
+}
+
+static bool parse_args(int argc, char** argv, BenchOptions& o)
+{
+	o.host = "127.0.0.1";
+	o.port = 8092;
+	o.endpoint = "both";
+	o.concurrency = 8;
+	o.requests = 1000;
+	o.durationSec = 0;
+	o.warmup = 5;
+	o.keepAlive = true;
+	o.corpus = "../images";
+	o.transport = "tcp";
+	o.tlsHandshakes = 0;
+	o.tlsResume = true;
+	o.rate = 0;
+	o.offeredPct = 0;
+	o.deadlineMs = 0;
+	o.idle = 0;
+	o.soakHours = 0;
+	o.soakIntervalSec = 60;
+	o.batch = 0;
+	o.unique = true;
+	o.revision = Environment::get(LD_REVISION_ENV, Environment::get("GIT_COMMIT", "unknown"));
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "--help" || a == "-h") return false;
+		if (i + 1 >= argc) { std::cout << "missing value for " << a << std::endl; return false; }
+		std::string v = argv[++i];
+		if (a == "--host") o.host = v;
+		else if (a == "--port") o.port = NumberParser::parse(v);
+		else if (a == "--endpoint") o.endpoint = v;
+		else if (a == "--concurrency") o.concurrency = std::max(1, NumberParser::parse(v));
+		else if (a == "--requests") o.requests = NumberParser::parse(v);
+		else if (a == "--duration") o.durationSec = NumberParser::parse(v);
+		else if (a == "--warmup") o.warmup = NumberParser::parse(v);
+		else if (a == "--keepalive") o.keepAlive = NumberParser::parse(v) != 0;
+		else if (a == "--corpus") o.corpus = v;
+		else if (a == "--json") o.jsonPath = v;
+		else if (a == "--unix") o.unixPath = v;
+		else if (a == "--transport") o.transport = v;
+		else if (a == "--tls-handshakes") o.tlsHandshakes = NumberParser::parse(v);
+		else if (a == "--tls-resume") o.tlsResume = NumberParser::parse(v) != 0;
+		else if (a == "--baseline") o.baselinePath = v;
+		else if (a == "--rate") o.rate = NumberParser::parseFloat(v);
+		else if (a == "--offered") o.offeredPct = NumberParser::parse(v);
+		else if (a == "--deadline-ms") o.deadlineMs = NumberParser::parse(v);
+		else if (a == "--api-key") o.apiKey = v;
+		else if (a == "--batch") o.batch = std::max(0, NumberParser::parse(v));
+		else if (a == "--accept") o.accept = v;
+		else if (a == "--idle") o.idle = std::max(0, NumberParser::parse(v));
+		else if (a == "--store") o.storeDir = v;
+		else if (a == "--revision") o.revision = v;
+		else if (a == "--soak") o.soakHours = NumberParser::parseFloat(v);
+		else if (a == "--soak-interval") o.soakIntervalSec = NumberParser::parse(v);
+		else if (a == "--unique") o.unique = NumberParser::parse(v) != 0;
+		else if (a == "--sizes") {
+			StringTokenizer tok(v, ",", StringTokenizer::TOK_TRIM | StringTokenizer::TOK_IGNORE_EMPTY);
+			for (auto& t : tok) o.sizesKb.push_back(NumberParser::parse(t));
+		}
+		else { std::cout << "unknown option " << a << std::endl; return false; }
+	}
+	if (o.transport != "tcp" && o.transport != "unix" && o.transport != "both") return false;
+	if (o.rate > 0 && o.offeredPct > 0) { std::cout << "--rate and --offered exclude each other" << std::endl; return false; }
+	if (o.soakHours > 0 && o.offeredPct > 0) { std::cout << "--soak runs closed loop or at --rate, not --offered" << std::endl; return false; }
+	if (o.transport != "tcp" && o.unixPath.empty()) { std::cout << "--transport " << o.transport << " needs --unix" << std::endl; return false; }
+	if (o.batch > 0 && o.endpoint != "multipart" && o.endpoint != "base64" && o.endpoint != "both") {
+		std::cout << "--batch posts multipart or base64 bodies" << std::endl;
+		return false;
+	}
+	if (o.endpoint == "both" || o.endpoint == "all") return true;
+	for (int b = 0; b < LD_BODY_COUNT; b++) if (o.endpoint == lv_szBodies[b]) return true;
+	return false;
+}
+
+//. whether --endpoint runs the body p_body.
+static bool endpoint_selected(const BenchOptions& p_opt, BodyKind p_body)
+{
+	if (p_opt.endpoint == "all") return true;
+	if (p_opt.endpoint == "both") return p_body == LD_BODY_MULTIPART || p_body == LD_BODY_BASE64;
+	return p_opt.endpoint == lv_szBodies[p_body];
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions opt;
+	try {
+		if (!parse_args(argc, argv, opt)) { usage(); return 2; }
+	}
+	catch (const Exception& ex) {
+		std::cout << ex.displayText() << std::endl;
+		usage();
+		return 2;
+	}
+
+	if (opt.tlsHandshakes > 0) {
+		JSON::Object::Ptr report = new JSON::Object;
+		report->set("bench_version", LD_BENCH_VERSION);
+		report->set("host", opt.host);
+		report->set("port", opt.port);
+		report->set("concurrency", opt.concurrency);
+		report->set("meta", run_meta(opt, argc, argv));
+		JSON::Object::Ptr r = run_tls(opt);
+		JSON::Array::Ptr results = new JSON::Array;
+		results->add(r);
+		report->set("results", results);
+		if (r->has("error")) {
+			std::cout << r->getValue<std::string>("error") << std::endl;
+			return 2;
+		}
+		printf("%-28s %8.1f hs/s   p50 %7.2f  p90 %7.2f  p99 %7.2f ms  (resumed %llu = %.1f%%, failed %llu)\n",
+			"tls_handshake", r->getValue<double>("handshakes_per_sec"),
+			r->getValue<double>("p50_ms"), r->getValue<double>("p90_ms"), r->getValue<double>("p99_ms"),
+			(unsigned long long)r->getValue<uint64_t>("resumed"), 100.0 * r->getValue<double>("resumption_rate"),
+			(unsigned long long)r->getValue<uint64_t>("failed"));
+		write_json(opt, report);
+		store_report(opt, report);
+		return 0;
+	}
+
+	std::vector<Payload> payloads;
+	if (!load_payloads(opt, payloads)) {
+		std::cout << "no payloads : corpus " << opt.corpus << " has no images and --sizes is empty" << std::endl;
+		return 2;
+	}
+
+	JSON::Object::Ptr report = new JSON::Object;
+	report->set("bench_version", LD_BENCH_VERSION);
+	report->set("host", opt.host);
+	report->set("port", opt.port);
+	report->set("concurrency", opt.concurrency);
+	report->set("keep_alive", opt.keepAlive);
+	report->set("payloads", (int)payloads.size());
+	report->set("meta", run_meta(opt, argc, argv));
+	std::string strCores = server_cores(opt);
+	if (!strCores.empty()) {
+		report->set("server_cores", strCores);
+		std::cout << "server cores : " << strCores << std::endl;
+	}
+	std::vector<StreamSocket> idleSockets;
+	JSON::Object::Ptr idle;
+	if (opt.idle > 0) {
+		idle = open_idle(opt, idleSockets);
+		report->set("idle", idle);
+		printf("idle connections : %llu of %d open in %.1f s (failed %llu)", (unsigned long long)idle->getValue<uint64_t>("opened"), opt.idle,
+			idle->getValue<double>("open_sec"), (unsigned long long)idle->getValue<uint64_t>("failed"));
+		if (idle->has("server_bytes_per_connection")) {
+			printf(", server rss %.1f -> %.1f MB, %.0f bytes per connection", idle->getValue<double>("server_rss_before_mb"),
+				idle->getValue<double>("server_rss_after_mb"), idle->getValue<double>("server_bytes_per_connection"));
+		}
+		printf("\n");
+	}
+	JSON::Array::Ptr results = new JSON::Array;
+
+	if (opt.soakHours > 0) {
+		//. the first endpoint and transport selected.
+		bool bUnix = opt.transport == "unix";
+		int body = 0;
+		while (!endpoint_selected(opt, (BodyKind)body)) body++;
+		JSON::Object::Ptr soak = run_soak(opt, (BodyKind)body, bUnix, payloads);
+		report->set("soak", soak);
+		report->set("results", results);
+		JSON::Object::Ptr slopes = soak->getObject("slopes");
+		printf("growth per hour :");
+		std::vector<std::string> vNames;
+		slopes->getNames(vNames);
+		for (const std::string& name : vNames) printf(" %s %+.3f", name.substr(0, name.size() - strlen("_per_hour")).c_str(), slopes->getValue<double>(name));
+		printf("  (errors %llu)\n", (unsigned long long)soak->getValue<uint64_t>("errors"));
+		write_json(opt, report);
+		store_report(opt, report);
+		return 0;
+	}
+
+	for (int t = 0; t < 2; t++) {
+		bool bUnix = t == 1;
+		if (opt.transport != "both" && (opt.transport == "unix") != bUnix) continue;
+		for (int e = 0; e < LD_BODY_COUNT; e++) {
+			BodyKind body = (BodyKind)e;
+			if (!endpoint_selected(opt, body)) continue;
+			ServerCpu cpu = server_cpu(opt);
+			if (opt.rate > 0) {
+				JSON::Object::Ptr open = run_endpoint(opt, body, bUnix, payloads, opt.rate);
+				add_server_cpu(opt, cpu, server_cpu(opt), open);
+				results->add(open);
+				continue;
+			}
+			JSON::Object::Ptr closed = run_endpoint(opt, body, bUnix, payloads);
+			ServerCpu cpuClosed = server_cpu(opt);
+			add_server_cpu(opt, cpu, cpuClosed, closed);
+			results->add(closed);
+			if (opt.offeredPct > 0) {
+				JSON::Object::Ptr open = run_endpoint(opt, body, bUnix, payloads, closed->getValue<double>("throughput_rps") * opt.offeredPct / 100.0);
+				add_server_cpu(opt, cpuClosed, server_cpu(opt), open);
+				results->add(open);
+			}
+		}
+	}
+	report->set("results", results);
+
+	for (size_t i = 0; i < results->size(); i++) {
+		JSON::Object::Ptr r = results->getObject((unsigned int)i);
+		printf("%-28s %-4s %8.1f req/s  p50 %7.2f  p90 %7.2f  p99 %7.2f  p999 %7.2f ms  (ok %llu, http err %llu, io err %llu)\n",
+			r->getValue<std::string>("endpoint").c_str(), r->getValue<std::string>("transport").c_str(), r->getValue<double>("throughput_rps"),
+			r->getValue<double>("p50_ms"), r->getValue<double>("p90_ms"), r->getValue<double>("p99_ms"), r->getValue<double>("p999_ms"),
+			(unsigned long long)r->getValue<uint64_t>("ok"), (unsigned long long)r->getValue<uint64_t>("http_errors"),
+			(unsigned long long)r->getValue<uint64_t>("io_errors"));
+		if (r->has("server_allocs_per_request")) {
+			printf("%-28s %-4s server allocations %.1f, %.0f bytes per request\n", "", r->getValue<std::string>("transport").c_str(),
+				r->getValue<double>("server_allocs_per_request"), r->getValue<double>("server_alloc_bytes_per_request"));
+		}
+		if (r->has("cache_hit_ratio")) {
+			printf("%-28s %-4s result cache hits %.1f%%%s\n", "", r->getValue<std::string>("transport").c_str(), 100.0 * r->getValue<double>("cache_hit_ratio"),
+				r->getValue<bool>("unique") ? "" : " (--unique 0 : the corpus replayed, latencies include cached answers)");
+		}
+		if (r->has("server_cpu_ms_per_request")) {
+			printf("%-28s %-4s server cpu %.2f ms per request", "", r->getValue<std::string>("transport").c_str(), r->getValue<double>("server_cpu_ms_per_request"));
+			if (r->has("server_ingest_cpu_ms_per_request")) printf(", ingest %.3f ms", r->getValue<double>("server_ingest_cpu_ms_per_request"));
+			printf(", upload %.1f MB/s\n", r->getValue<double>("upload_mb_per_sec"));
+		}
+		if (r->getValue<std::string>("load") == "open" || r->has("goodput_rps")) {
+			printf("%-28s %-4s", "", r->getValue<std::string>("load").c_str());
+			if (r->has("offered_rps")) printf(" offered %8.1f req/s", r->getValue<double>("offered_rps"));
+			if (r->has("goodput_rps")) printf("  goodput %8.1f req/s within %d ms", r->getValue<double>("goodput_rps"), r->getValue<int>("deadline_ms"));
+			printf("\n");
+		}
+	}
+	if (!opt.baselinePath.empty()) compare_baseline(opt, results);
+	if (idle) {
+		uint64_t alive = idle_alive(idleSockets);
+		idle->set("alive_at_end", alive);
+		printf("idle connections still open after the run : %llu of %llu\n", (unsigned long long)alive, (unsigned long long)idleSockets.size());
+	}
+
+	write_json(opt, report);
+	store_report(opt, report);
+	return 0;
+}
@@ -0,0 +1,1516 @@
+//. SdkBench : in-process FaceSDK micro-benchmark.
+//.
+//. Loads the SDK the same way IDLiveFaceCmd does (setting_init + face_sdk_api_publish) and times
+//. the individual C API calls on an image corpus, so thread / stream / batch settings
+//. can be chosen per hardware SKU without the HTTP layer in the way.
+//.
+//. SdkBench [options]
+//.   --corpus <dir>        images to use (../images); 24-bit .bmp files also feed image_create_pixels;
+//.                         .webp / .heic / .heif / .avif files are decoded by the server codecs
+//.                         (MiCodecs.h) into image_create_pixels, against image_create_bytes of the rest
+//.   --iters <n>           timed iterations per image and measurement (20)
+//.   --batch <n,n,...>     batch sizes for the *_batch calls (1,2,4,8)
+//.   --threads <n,...>     set_num_threads(ENGINE) values to sweep, 0 = SDK auto (0)
+//.   --streams <n,...>     set_ov_num_throughput_streams values to sweep, -2 = leave default (-2)
+//.   --detector <name>     detection engine (BaseNnetDetector)
+//.   --quality <name>      quality engine (ExpositionQualityEngine)
+//.   --json <file>         write results as JSON ("-" = stdout)
+//.   --crop <min_side>     compare the face-crop fast path (MiFaceCrop.h) with the full-image
+//.                         path on images whose long side is >= min_side (0 = all)
+//.   --blueprint <dir>     also time the idliveface::Blueprint engine on this init data;
+//.                         --threads values are passed as CreateRuntimeConfiguration cores
+//.   --labeled <dir>       accuracy + latency over a labeled corpus : dir/genuine and dir/spoof
+//.                         (or dir/attack). APCER / BPCER at the 0.5 thresholds of the server
+//.                         verdict, for every calibration (Tolerance) x os (Domain) meta and,
+//.                         with --blueprint, every Tolerance x Domain of FaceAnalysisParameters
+//.   --cache-dir <dir>     OpenVINO compiled-model cache (MiModelCache.h) : times setting_init and,
+//.                         with --blueprint, Blueprint + first Analyze as time to ready, "cold" when
+//.                         the directory held no blobs ("cached" otherwise). Run twice to compare
+//.   --kernels <w>x<h>     time the dispatched kernels (MiCpu.h : base64, color, orientation,
+//.                         prefilter, resize) on a synthetic frame of that size, every variant the CPU runs
+//.   --upright <1..8>      EXIF orientation handling (MiOrient.h) : the 24-bit .bmp images are
+//.                         stored as a camera with that orientation would, then checked as they
+//.                         are (the SDK finds the rotation) and turned upright first
+//.   --multipart <mb,...>  multipart upload parsing of a body with one file part of each size :
+//.                         MiMultipart.h against Poco HTMLForm + StreamCopier into a string
+//.   --ingest <kb,...>     server CPU per upload format for an image of each size, e.g.
+//.                         200,1024,4096,12288 : multipart (Poco HTMLForm against MiMultipart.h),
+//.                         base64 JSON (Poco JSON + Base64Decoder against MiJsonScan.h), the raw
+//.                         body (StreamCopier against the chunked read of the raw endpoint) and a
+//.                         pixel frame of the same bytes; wall and thread CPU ms per request, MB/s
+//.   --json-scan <mb,...>  a {"image":"<base64>"} body of each size with calibration, os and
+//.                         request_id beside it : Poco::JSON::Parser (DOM only, then with the
+//.                         image decoded) against MiJsonScan.h reading the same fields
+//.   --map <threads,...>   shared-state map (MiShardedMap.h) against Poco AccessExpireLRUCache :
+//.                         90 % find / 10 % insert over a key set twice the capacity,
+//.                         e.g. 16,32,64
+//.   --cpp <n,...>         pipeline_check_liveness_batch2 through the C API against the facesdk::
+//.                         C++ Pipeline::checkLivenessBatch (MiCppBackend.h) at these batch sizes,
+//.                         per call arrays / ImagePtr vectors built as the server does, e.g.
+//.                         1,2,4,8,16,32,64
+//.   --verdict <n,...>     batch verdicts (MiVerdictBatch.h) of n synthetic results : every
+//.                         variant of the SoA kernel against the per-result policy, e.g. 256,1000,10000
+//.   --buckets <n,...>     [batch] buckets (MiBuckets.h) : per-bucket batch2 throughput, then every
+//.                         batch size up to the largest as one call against the padded / split
+//.                         calls planned from those timings, e.g. 1,4,8,16
+//.   --wait-policy <p>     [sdk] wait_policy (MiWait.h) for this run : active or passive
+//.   --tbb-max-threads <n> [sdk] tbb_max_threads for this run (builds with MI_HAS_TBB)
+//.   --idle-gaps <ms,...>  latency against idle CPU : after each pause of that length, the process
+//.                         CPU the waiting SDK threads burnt (in cores) and the latency of the check
+//.                         that ends it, against a check right before; run once per --wait-policy
+
+#include <windows.h>
+#include "FaceSdkApi.h"
+#include "MiBase64.h"
+#include "MiBuckets.h"
+#include "MiCodecs.h"
+#include "MiColor.h"
+#include "MiConf.h"
+#include "MiCpu.h"
+#include "MiFaceCrop.h"
+#include "MiHash.h"
+#include "MiJsonScan.h"
+#include "MiModelCache.h"
+#include "MiMultipart.h"
+#include "MiOrient.h"
+#include "MiPlatform.h"
+#include "MiPrefilter.h"
+#include "MiResize.h"
+#include "MiShardedMap.h"
+#include "MiVerdictBatch.h"
+#include "MiWait.h"
+#include "licenseproc.h"
+#include "Poco/AccessExpireLRUCache.h"
+#include "Poco/Base64Decoder.h"
+#include "Poco/Base64Encoder.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Environment.h"
+#include "Poco/File.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/MessageHeader.h"
+#include "Poco/Net/PartHandler.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Path.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/JSON/Stringifier.h"
+#include <facesdk/FaceSDK.h>
+#include <idliveface/idliveface.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Poco;
+
+struct SdkBenchOptions {
+	std::string			corpus;
+	int					iters;
+	std::vector<int>	batches;
+	std::vector<int>	threads;
+	std::vector<int>	streams;
+	std::string			detector;
+	std::string			quality;
+	std::string			jsonPath;
+	std::string			blueprint;
+	int					cropMinSide;		//. -1 = no crop comparison
+	std::string			labeled;
+	std::string			cacheDir;
+	int					kernelWidth;		//. 0 = no kernel benchmark
+	int					kernelHeight;
+	int					upright;			//. EXIF orientation, 0 = no upright comparison
+	std::vector<int>	multipartMb;		//. file part sizes, empty = no multipart comparison
+	std::vector<int>	ingestKb;			//. image sizes, empty = no upload format comparison
+	std::vector<int>	jsonScanMb;			//. body sizes, empty = no JSON parser comparison
+	std::vector<int>	mapThreads;			//. thread counts, empty = no map comparison
+	std::vector<int>	verdictSizes;		//. batch sizes, empty = no verdict comparison
+	std::vector<int>	cppBatches;			//. batch sizes, empty = no C / C++ API comparison
+	std::string			buckets;			//. [batch] buckets, empty = no bucket comparison
+	std::string			waitPolicy;			//. empty = the runtime defaults
+	int					tbbMaxThreads;
+	std::vector<int>	idleGaps;			//. pauses in ms, empty = no idle measurement
+};
+
+struct CorpusImage {
+	std::string				path;
+	std::string				bytes;
+	std::vector<uint8_t>	bgr;		//. filled for 24-bit BMP only
+	size_t					rows;
+	size_t					cols;
+};
+
+struct LabeledImage {
+	std::string		path;
+	std::string		bytes;
+	bool			genuine;
+};
+
+//. outcome counts of one accuracy sweep point.
+struct AccuracyStats {
+	size_t				genuine;
+	size_t				spoof;
+	size_t				genuineRejected;	//. BPCER numerator : genuine not accepted (invalid included)
+	size_t				spoofAccepted;		//. APCER numerator
+	size_t				invalid;			//. SDK error or bad quality, any label
+	std::vector<double>	ms;
+	AccuracyStats() : genuine(0), spoof(0), genuineRejected(0), spoofAccepted(0), invalid(0) {}
+};
+
+#define LD_THRESHOLD	0.5		//. probability and quality thresholds of mi_result_verdict / OnProcessImage
+
+static JSON::Array::Ptr lv_results = new JSON::Array;
+
+static std::string read_file(const std::string& p_strPath)
+{
+	std::ifstream in(p_strPath, std::ios::binary);
+	std::ostringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+//. uncompressed 24-bit BMP -> top-down BGR888
+static bool bmp_to_bgr(const std::string& p_strData, CorpusImage& p_img)
+{
+	if (p_strData.size() < 54 || p_strData[0] != 'B' || p_strData[1] != 'M') return false;
+	const uint8_t* d = (const uint8_t*)p_strData.data();
+	uint32_t offset = *(const uint32_t*)(d + 10);
+	int32_t width = *(const int32_t*)(d + 18);
+	int32_t height = *(const int32_t*)(d + 22);
+	uint16_t bpp = *(const uint16_t*)(d + 28);
+	uint32_t compression = *(const uint32_t*)(d + 30);
+	if (bpp != 24 || compression != 0 || width <= 0 || height == 0) return false;
+
+	bool bottomUp = height > 0;
+	size_t rows = (size_t)(bottomUp ? height : -height);
+	size_t cols = (size_t)width;
+	size_t stride = (cols * 3 + 3) & ~(size_t)3;
+	if (offset + stride * rows > p_strData.size()) return false;
+
+	p_img.bgr.resize(rows * cols * 3);
+	for (size_t r = 0; r < rows; r++) {
+		const uint8_t* src = d + offset + stride * (bottomUp ? rows - 1 - r : r);
+		memcpy(&p_img.bgr[r * cols * 3], src, cols * 3);
+	}
+	p_img.rows = rows;
+	p_img.cols = cols;
+	return true;
+}
+
+//. p_vCodec : the uploads the SDK does not read (MiCodecs.h), timed by bench_decode only.
+static void load_corpus(const std::string& p_strDir, std::vector<CorpusImage>& p_vOut, std::vector<CorpusImage>& p_vCodec)
+{
+	File dir(p_strDir);
+	if (!dir.exists() || !dir.isDirectory()) return;
+	for (DirectoryIterator it(p_strDir), end; it != end; ++it) {
+		if (!it->isFile()) continue;
+		std::string ext = Poco::toLower(Path(it->path()).getExtension());
+		bool bCodec = ext == "webp" || ext == "heic" || ext == "heif" || ext == "avif";
+		if (!bCodec && ext != "jpg" && ext != "jpeg" && ext != "png" && ext != "bmp") continue;
+		CorpusImage img;
+		img.path = it->path();
+		img.bytes = read_file(img.path);
+		img.rows = img.cols = 0;
+		if (ext == "bmp") bmp_to_bgr(img.bytes, img);
+		(bCodec ? p_vCodec : p_vOut).push_back(img);
+	}
+}
+
+static void load_labeled(const std::string& p_strDir, std::vector<LabeledImage>& p_vOut)
+{
+	const char* szLabels[] = { "genuine", "spoof", "attack" };
+	for (const char* pszLabel : szLabels) {
+		std::string strDir = Path(p_strDir).append(pszLabel).toString();
+		File dir(strDir);
+		if (!dir.exists() || !dir.isDirectory()) continue;
+		for (DirectoryIterator it(strDir), end; it != end; ++it) {
+			if (!it->isFile()) continue;
+			std::string ext = Poco::toLower(Path(it->path()).getExtension());
+			if (ext != "jpg" && ext != "jpeg" && ext != "png" && ext != "bmp") continue;
+			LabeledImage img;
+			img.path = it->path();
+			img.bytes = read_file(img.path);
+			img.genuine = strcmp(pszLabel, "genuine") == 0;
+			p_vOut.push_back(img);
+		}
+	}
+}
+
+static double percentile(std::vector<double>& p_v, double p_dQ)
+{
+	if (p_v.empty()) return 0;
+	std::sort(p_v.begin(), p_v.end());
+	size_t idx = (size_t)(p_dQ * (p_v.size() - 1) + 0.5);
+	return p_v[std::min(idx, p_v.size() - 1)];
+}
+
+static void report_accuracy(const std::string& p_strEngine, const std::string& p_strTolerance, const std::string& p_strDomain, AccuracyStats& p_stats)
+{
+	double apcer = p_stats.spoof > 0 ? (double)p_stats.spoofAccepted / p_stats.spoof : 0;
+	double bpcer = p_stats.genuine > 0 ? (double)p_stats.genuineRejected / p_stats.genuine : 0;
+	size_t n = p_stats.genuine + p_stats.spoof;
+	double invalid = n > 0 ? (double)p_stats.invalid / n : 0;
+	double p50 = percentile(p_stats.ms, 0.50), p90 = percentile(p_stats.ms, 0.90), p99 = percentile(p_stats.ms, 0.99);
+	printf("%-10s tolerance %-8s domain %-7s : APCER %6.2f%% BPCER %6.2f%% invalid %6.2f%%  p50 %8.2f p90 %8.2f p99 %8.2f ms\n",
+		p_strEngine.c_str(), p_strTolerance.c_str(), p_strDomain.c_str(), apcer * 100, bpcer * 100, invalid * 100, p50, p90, p99);
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("name", "accuracy " + p_strEngine);
+	r->set("tolerance", p_strTolerance);
+	r->set("domain", p_strDomain);
+	r->set("genuine", (uint64_t)p_stats.genuine);
+	r->set("spoof", (uint64_t)p_stats.spoof);
+	r->set("apcer", apcer);
+	r->set("bpcer", bpcer);
+	r->set("invalid_rate", invalid);
+	r->set("p50_ms", p50);
+	r->set("p90_ms", p90);
+	r->set("p99_ms", p99);
+	lv_results->add(r);
+}
+
+static void report(const std::string& p_strName, int p_nThreads, int p_nStreams, int p_nBatch, size_t p_nImages, double p_dMs)
+{
+	double msPerImage = p_nImages > 0 ? p_dMs / p_nImages : 0;
+	double ips = p_dMs > 0 ? p_nImages * 1000.0 / p_dMs : 0;
+	printf("%-34s threads %3d streams %3d batch %3d : %9.3f ms/img %9.1f img/s\n", p_strName.c_str(), p_nThreads, p_nStreams, p_nBatch, msPerImage, ips);
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("name", p_strName);
+	r->set("threads", p_nThreads);
+	r->set("streams", p_nStreams);
+	r->set("batch", p_nBatch);
+	r->set("images", (uint64_t)p_nImages);
+	r->set("ms_per_image", msPerImage);
+	r->set("images_per_sec", ips);
+	lv_results->add(r);
+}
+
+template <typename F>
+static double time_ms(F p_fn)
+{
+	auto start = std::chrono::steady_clock::now();
+	p_fn();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//. p_before : cache content when the timed step started, no blobs = the models were compiled.
+static void report_startup(const std::string& p_strName, const MiModelCacheStats& p_before, const std::string& p_strDir, double p_dMs)
+{
+	MiModelCacheStats after = mi_model_cache_stats(p_strDir);
+	const char* pszCache = p_before.blobs > 0 ? "cached" : "cold";
+	printf("%-34s %-6s : %9.1f ms, cache %d blobs %llu bytes\n", p_strName.c_str(), pszCache, p_dMs, after.blobs, (unsigned long long)after.bytes);
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("name", p_strName);
+	r->set("cache", std::string(pszCache));
+	r->set("ms", p_dMs);
+	r->set("cache_blobs", after.blobs);
+	r->set("cache_bytes", after.bytes);
+	lv_results->add(r);
+}
+
+static void bench_startup_blueprint(const SdkBenchOptions& p_opt, const std::vector<CorpusImage>& p_vImages)
+{
+	MiModelCacheStats before = mi_model_cache_stats(p_opt.cacheDir);
+	try {
+		double ms = time_ms([&] {
+			idliveface::RuntimeConfiguration rc = idliveface::CreateRuntimeConfiguration(0);
+			rc.parameters[GD_MODEL_CACHE_PARAMETER] = p_opt.cacheDir;
+			idliveface::Blueprint blueprint(p_opt.blueprint, rc);
+			idliveface::ImageDecoder decoder = blueprint.CreateImageDecoder();
+			idliveface::FaceAnalyzer analyzer = blueprint.CreateFaceAnalyzer();
+			const CorpusImage& img = p_vImages[0];
+			analyzer.Analyze(decoder.Decode((const uint8_t*)img.bytes.data(), img.bytes.size()));
+		});
+		report_startup("startup blueprint", before, p_opt.cacheDir, ms);
+	}
+	catch (const std::exception& e) {
+		printf("startup blueprint (%s) : %s\n", p_opt.blueprint.c_str(), e.what());
+	}
+}
+
+static void bench_decode(const SdkBenchOptions& p_opt, const std::vector<CorpusImage>& p_vImages, const std::vector<CorpusImage>& p_vCodec)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE];
+	size_t n = 0, nPixels = 0;
+	double msBytes = 0, msPath = 0, msPixels = 0;
+
+	for (const CorpusImage& img : p_vImages) {
+		for (int i = 0; i < p_opt.iters; i++) {
+			msBytes += time_ms([&] { CImage_t* p = face_sdk_api().image_create_bytes((const uint8_t*)img.bytes.data(), img.bytes.size(), &err, msg); if (p) face_sdk_api().image_destroy(p); });
+			msPath += time_ms([&] { CImage_t* p = face_sdk_api().image_create_path(img.path.c_str(), &err, msg); if (p) face_sdk_api().image_destroy(p); });
+			n++;
+			if (!img.bgr.empty()) {
+				msPixels += time_ms([&] { CImage_t* p = face_sdk_api().image_create_pixels(img.bgr.data(), img.rows, img.cols, BGR888, &err, msg); if (p) face_sdk_api().image_destroy(p); });
+				nPixels++;
+			}
+		}
+	}
+	report("image_create_bytes", -1, -1, 1, n, msBytes);
+	report("image_create_path", -1, -1, 1, n, msPath);
+	if (nPixels > 0) report("image_create_pixels", -1, -1, 1, nPixels, msPixels);
+	else printf("image_create_pixels : skipped, no 24-bit .bmp in corpus\n");
+
+	//. what the server does with a WebP / HEIC / AVIF upload, per format.
+	size_t nCodec[MI_CODEC_COUNT] = {};
+	double msCodec[MI_CODEC_COUNT] = {}, msCreate[MI_CODEC_COUNT] = {};
+	for (const CorpusImage& img : p_vCodec) {
+		const uint8_t* pData = (const uint8_t*)img.bytes.data();
+		int f = mi_codec_of(pData, img.bytes.size());
+		if (f < 0) {
+			printf("%s : no decoder in this build / on this host\n", img.path.c_str());
+			continue;
+		}
+		for (int i = 0; i < p_opt.iters; i++) {
+			DecodedFrame frame;
+			bool bOk = false;
+			msCodec[f] += time_ms([&] { bOk = mi_codec_decode(pData, img.bytes.size(), frame); });
+			if (!bOk) {
+				printf("%s : decode failed\n", img.path.c_str());
+				break;
+			}
+			msCreate[f] += time_ms([&] { CImage_t* p = face_sdk_api().image_create_pixels(frame.pixels.data(), (size_t)frame.height, (size_t)frame.width, BGR888, &err, msg); if (p) face_sdk_api().image_destroy(p); });
+			nCodec[f]++;
+		}
+	}
+	for (int f = 0; f < MI_CODEC_COUNT; f++) {
+		if (nCodec[f] == 0) continue;
+		std::string strName = mi_codec_name(f);
+		report(strName + " decode", -1, -1, 1, nCodec[f], msCodec[f]);
+		report(strName + " decode + create_pixels", -1, -1, 1, nCodec[f], msCodec[f] + msCreate[f]);
+	}
+}
+
+//. synthetic NV12 / I420 / BGR frames; kernels do not depend on content.
+static void bench_kernels(const SdkBenchOptions& p_opt)
+{
+	int w = p_opt.kernelWidth, h = p_opt.kernelHeight;
+	int cw = (w + 1) / 2, ch = (h + 1) / 2;
+	std::vector<uint8_t> y((size_t)w * h), uv((size_t)cw * 2 * ch), u((size_t)cw * ch), v((size_t)cw * ch);
+	std::vector<uint8_t> bgr((size_t)w * h * 3), rotated((size_t)w * h * 3), small((size_t)(w / 3) * (h / 3) * 3);
+	for (size_t i = 0; i < y.size(); i++) y[i] = (uint8_t)(16 + i * 7 % 220);
+	for (size_t i = 0; i < uv.size(); i++) uv[i] = (uint8_t)(64 + i * 13 % 128);
+	for (size_t i = 0; i < u.size(); i++) { u[i] = uv[i * 2]; v[i] = uv[i * 2 + 1]; }
+
+	//. the frame's pixels as a base64 upload body.
+	std::string b64;
+	{
+		std::ostringstream ss;
+		Poco::Base64Encoder enc(ss, Poco::BASE64_NO_PADDING);
+		enc.rdbuf()->setLineLength(0);
+		enc.write((const char*)bgr.data(), (std::streamsize)bgr.size());
+		enc.close();
+		b64 = ss.str();
+	}
+	std::string decoded;
+
+	//. every variant of every dispatched kernel the CPU runs (MiCpu.h), then back to the best.
+	printf("%s\n", ("cpu features : " + mi_cpu_feature_names(mi_cpu_features())).c_str());
+	for (MiCpuKernel* k : mi_cpu_kernels()) {
+		std::string strKernel = k->name;
+		for (int var = 0; var < k->count; var++) {
+			if (!mi_cpu_bind(k, var)) {
+				printf("kernel %s %s : skipped, needs %s\n", k->name, k->variants[var], mi_cpu_feature_names(k->needs[var]).c_str());
+				continue;
+			}
+			std::string suffix = std::string(" ") + k->variants[var];
+			if (strKernel == "base64") {
+				double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) { Base64StreamDecoder dec(&decoded, b64.size() / 4 * 3); dec.feed(b64.data(), b64.size()); dec.finish(); } });
+				report("kernel base64 decode" + suffix, 1, -1, 1, p_opt.iters, ms);
+			}
+			else if (strKernel == "color") {
+				double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) mi_color_nv12(y.data(), w, uv.data(), cw * 2, w, h, bgr.data(), (size_t)w * 3, BGR888); });
+				report("kernel nv12->bgr" + suffix, 1, -1, 1, p_opt.iters, ms);
+				ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) mi_color_i420(y.data(), w, u.data(), cw, v.data(), cw, w, h, bgr.data(), (size_t)w * 3, BGR888); });
+				report("kernel i420->bgr" + suffix, 1, -1, 1, p_opt.iters, ms);
+				ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) mi_color_swap_rb(bgr.data(), bgr.data(), (size_t)w * h); });
+				report("kernel rgb<->bgr" + suffix, 1, -1, 1, p_opt.iters, ms);
+			}
+			else if (strKernel == "orient") {
+				//. 6 : phone held upright, the usual rotated upload; 3 : the flip kernel.
+				double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) mi_orient_bgr(bgr.data(), w, h, (size_t)w * 3, 6, rotated.data(), (size_t)h * 3); });
+				report("kernel rotate 90" + suffix, 1, -1, 1, p_opt.iters, ms);
+				ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) mi_orient_bgr(bgr.data(), w, h, (size_t)w * 3, 3, rotated.data(), (size_t)w * 3); });
+				report("kernel rotate 180" + suffix, 1, -1, 1, p_opt.iters, ms);
+			}
+			else if (strKernel == "prefilter") {
+				//. the whole judgement at the default gray side, reduction included.
+				PrefilterThresholds t = { GD_PREFILTER_SIDE, GD_PREFILTER_MIN_SHARPNESS, GD_PREFILTER_DARK_LEVEL, GD_PREFILTER_DARK_PERCENT };
+				double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) mi_prefilter_judge(bgr.data(), w, h, (size_t)w * 3, BGR888, t); });
+				report("kernel prefilter" + suffix, 1, -1, 1, p_opt.iters, ms);
+			}
+			else if (strKernel == "resize" && w >= 3 && h >= 3) {
+				double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) mi_resize_bgr(bgr.data(), w, h, (size_t)w * 3, small.data(), w / 3, h / 3, (size_t)(w / 3) * 3); });
+				report("kernel resize 1/3" + suffix, 1, -1, 1, p_opt.iters, ms);
+			}
+		}
+		mi_cpu_bind(k, k->best);
+	}
+}
+
+//. the upload path MiMultipart.h replaced : the file part copied out of the part stream.
+class CopyPartHandler : public Poco::Net::PartHandler {
+public:
+	void handlePart(const Poco::Net::MessageHeader&, std::istream& p_stream) override
+	{
+		std::ostringstream out;
+		Poco::StreamCopier::copyStream(p_stream, out);
+		data = out.str();
+	}
+	std::string		data;
+};
+
+static void bench_multipart(const SdkBenchOptions& p_opt)
+{
+	const std::string strBoundary = "----SdkBenchBoundary7MA4YWxkTrZu0gW";
+	for (int mb : p_opt.multipartMb) {
+		//. JPEG-like payload : every byte value, CR and '-' included.
+		std::string file((size_t)mb * 1024 * 1024, 0);
+		uint32_t x = 2463534242u;
+		for (size_t i = 0; i < file.size(); i++) {
+			x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+			file[i] = (char)x;
+		}
+		std::string body = "--" + strBoundary + "\r\nContent-Disposition: form-data; name=\"meta\"\r\n\r\n{\"os\":\"ANDROID\"}\r\n"
+			"--" + strBoundary + "\r\nContent-Disposition: form-data; name=\"image\"; filename=\"face.jpg\"\r\nContent-Type: image/jpeg\r\n\r\n"
+			+ file + "\r\n--" + strBoundary + "--\r\n";
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST, "/check_liveness");
+		request.setContentType("multipart/form-data; boundary=" + strBoundary);
+		std::string suffix = " " + std::to_string(mb) + " MB";
+
+		size_t nBad = 0;
+		double ms = time_ms([&] {
+			for (int i = 0; i < p_opt.iters; i++) {
+				std::istringstream in(body);
+				CopyPartHandler part;
+				Poco::Net::HTMLForm form(request, in, part);
+				nBad += part.data.size() != file.size();
+			}
+		});
+		report("multipart htmlform" + suffix, 1, -1, 1, p_opt.iters, ms);
+
+		//. the server reuses a pooled buffer; its capacity survives the iterations here too.
+		std::string image;
+		std::map<std::string, std::string> fields;
+		ms = time_ms([&] {
+			for (int i = 0; i < p_opt.iters; i++) {
+				std::istringstream in(body);
+				MultipartSink sink;
+				sink.next = [&image](size_t p_nIndex) { return p_nIndex == 0 ? &image : NULL; };
+				sink.fields = &fields;
+				sink.sizeHint = body.size();
+				std::string strErr;
+				if (!mi_multipart_read(in, strBoundary, sink, strErr) || image.size() != file.size()) nBad++;
+			}
+		});
+		report("multipart scanner" + suffix, 1, -1, 1, p_opt.iters, ms);
+		if (nBad > 0) printf("multipart%s : %zu parses lost the file part\n", suffix.c_str(), nBad);
+	}
+}
+
+static void report_ingest(const std::string& p_strName, int p_nKb, int p_nIters, double p_dMs, double p_dCpuMs)
+{
+	double ms = p_nIters > 0 ? p_dMs / p_nIters : 0;
+	double cpuMs = p_nIters > 0 ? p_dCpuMs / p_nIters : 0;
+	double mbps = p_dMs > 0 ? p_nKb / 1024.0 * p_nIters * 1000.0 / p_dMs : 0;
+	printf("%-34s %6d KB : %9.3f ms/req %9.3f cpu ms/req %9.1f MB/s\n", p_strName.c_str(), p_nKb, ms, cpuMs, mbps);
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("name", p_strName);
+	r->set("kb", p_nKb);
+	r->set("requests", p_nIters);
+	r->set("ms_per_request", ms);
+	r->set("cpu_ms_per_request", cpuMs);
+	r->set("mb_per_sec", mbps);
+	lv_results->add(r);
+}
+
+//. what each upload format costs the handling thread before the image reaches the SDK : the
+//. body parsed the way the server did before the streaming parsers and the way it does now.
+//. Single-threaded, bodies in memory, so the socket does not blur the parse cost.
+static void bench_ingest(const SdkBenchOptions& p_opt)
+{
+	const std::string strBoundary = "----SdkBenchBoundary7MA4YWxkTrZu0gW";
+	for (int kb : p_opt.ingestKb) {
+		std::string file((size_t)kb * 1024, 0);
+		uint32_t x = 2463534242u;
+		for (size_t i = 0; i < file.size(); i++) {
+			x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+			file[i] = (char)x;
+		}
+		std::string multipart = "--" + strBoundary + "\r\nContent-Disposition: form-data; name=\"meta\"\r\n\r\n{\"os\":\"ANDROID\"}\r\n"
+			"--" + strBoundary + "\r\nContent-Disposition: form-data; name=\"image\"; filename=\"face.jpg\"\r\nContent-Type: image/jpeg\r\n\r\n"
+			+ file + "\r\n--" + strBoundary + "--\r\n";
+		std::ostringstream b64;
+		b64 << "{\"meta\":{\"os\":\"ANDROID\"},\"image\":\"";
+		{
+			Base64Encoder enc(b64);
+			enc.rdbuf()->setLineLength(0);
+			enc.write(file.data(), file.size());
+			enc.close();
+		}
+		b64 << "\"}";
+		std::string json = b64.str();
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST, "/check_liveness");
+		request.setContentType("multipart/form-data; boundary=" + strBoundary);
+
+		size_t nBad = 0;
+		//. the streaming paths decode into a buffer reused across requests, as the server's pool does.
+		std::string image;
+		auto run = [&](const char* p_pszName, const std::function<void()>& p_fn) {
+			uint64_t nCpu = mi_thread_cpu_ns();
+			double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) p_fn(); });
+			report_ingest(p_pszName, kb, p_opt.iters, ms, (mi_thread_cpu_ns() - nCpu) / 1e6);
+		};
+
+		run("ingest multipart htmlform", [&] {
+			std::istringstream in(multipart);
+			CopyPartHandler part;
+			Poco::Net::HTMLForm form(request, in, part);
+			nBad += part.data.size() != file.size();
+		});
+		run("ingest multipart scanner", [&] {
+			std::istringstream in(multipart);
+			std::vector<uint64_t> hashes;
+			std::map<std::string, std::string> fields;
+			MultipartSink sink;
+			sink.next = [&image](size_t p_nIndex) { return p_nIndex == 0 ? &image : NULL; };
+			sink.fields = &fields;
+			sink.hashes = &hashes;
+			sink.sizeHint = multipart.size();
+			std::string strErr;
+			if (!mi_multipart_read(in, strBoundary, sink, strErr) || image.size() != file.size()) nBad++;
+		});
+		run("ingest base64 poco json", [&] {
+			std::istringstream in(json);
+			JSON::Parser parser;
+			JSON::Object::Ptr root = parser.parse(in).extract<JSON::Object::Ptr>();
+			std::istringstream enc(root->getValue<std::string>("image"));
+			Base64Decoder dec(enc);
+			std::ostringstream out;
+			StreamCopier::copyStream(dec, out);
+			nBad += out.str().size() != file.size();
+		});
+		run("ingest base64 scanner", [&] {
+			std::istringstream in(json);
+			std::map<std::string, std::string> other;
+			uint64_t hash = 0;
+			std::string strErr;
+			if (!json_extract_base64_field(in, "image", &image, json.size(), strErr, &other, &hash) || image.size() != file.size()) nBad++;
+		});
+		run("ingest raw streamcopier", [&] {
+			std::istringstream in(file);
+			std::string out;
+			StreamCopier::copyToString(in, out);
+			nBad += out.size() != file.size();
+		});
+		//. InputRaw (MIServer.cpp) : 16 KB reads into the reserved buffer, hashed on the way.
+		run("ingest raw chunked", [&] {
+			std::istringstream in(file);
+			image.clear();
+			image.reserve(file.size());
+			Hash64Stream hash;
+			char buf[16384];
+			while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+				image.append(buf, (size_t)in.gcount());
+				hash.update(buf, (size_t)in.gcount());
+			}
+			nBad += image.size() != file.size();
+		});
+		//. GD_API_PIXELS : the frame's known size read in one go, nothing to parse.
+		run("ingest pixels", [&] {
+			std::istringstream in(file);
+			image.resize(file.size());
+			in.read(&image[0], (std::streamsize)image.size());
+			nBad += (size_t)in.gcount() != file.size();
+		});
+		if (nBad > 0) printf("ingest %d KB : %zu parses lost the image\n", kb, nBad);
+	}
+}
+
+//. the lazy scanner against the DOM the base64 endpoint used to build for the same fields.
+static void bench_json_scan(const SdkBenchOptions& p_opt)
+{
+	for (int mb : p_opt.jsonScanMb) {
+		//. a base64 text of about mb MB, its image 3/4 of that.
+		std::string file((size_t)mb * 1024 * 1024 / 4 * 3, 0);
+		uint32_t x = 2463534242u;
+		for (size_t i = 0; i < file.size(); i++) {
+			x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+			file[i] = (char)x;
+		}
+		std::ostringstream os;
+		os << "{\"calibration\":\"soft\",\"os\":\"android\",\"image\":\"";
+		{
+			Base64Encoder enc(os);
+			enc.rdbuf()->setLineLength(0);
+			enc.write(file.data(), file.size());
+			enc.close();
+		}
+		os << "\",\"request_id\":\"bench-0001\"}";
+		std::string body = os.str();
+		int kb = (int)(body.size() / 1024);
+
+		size_t nBad = 0;
+		std::string image;
+		auto run = [&](const char* p_pszName, const std::function<void()>& p_fn) {
+			uint64_t nCpu = mi_thread_cpu_ns();
+			double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) p_fn(); });
+			report_ingest(p_pszName, kb, p_opt.iters, ms, (mi_thread_cpu_ns() - nCpu) / 1e6);
+		};
+		run("json poco dom", [&] {
+			std::istringstream in(body);
+			JSON::Parser parser;
+			JSON::Object::Ptr root = parser.parse(in).extract<JSON::Object::Ptr>();
+			nBad += root->getValue<std::string>("request_id") != "bench-0001" || root->getValue<std::string>("calibration") != "soft";
+		});
+		run("json poco dom + base64", [&] {
+			std::istringstream in(body);
+			JSON::Parser parser;
+			JSON::Object::Ptr root = parser.parse(in).extract<JSON::Object::Ptr>();
+			std::istringstream enc(root->getValue<std::string>("image"));
+			Base64Decoder dec(enc);
+			std::ostringstream out;
+			StreamCopier::copyStream(dec, out);
+			nBad += out.str().size() != file.size() || root->getValue<std::string>("os") != "android";
+		});
+		run("json scanner + base64", [&] {
+			std::istringstream in(body);
+			std::map<std::string, std::string> fields;
+			std::string strErr, strId, strOs;
+			if (!json_extract_base64_field(in, "image", &image, body.size(), strErr, &fields) || image.size() != file.size()) nBad++;
+			else if (!json_string_value(fields["request_id"], strId) || strId != "bench-0001" || !json_string_value(fields["os"], strOs)) nBad++;
+		});
+		if (nBad > 0) printf("json-scan %d MB : %zu parses lost a field\n", mb, nBad);
+	}
+}
+
+#define LD_MAP_CAPACITY		65536
+#define LD_MAP_OPS			200000		//. per thread and iteration
+
+//. p_fnOp(key, insert) -> hit on p_nThreads threads, each with its own key stream; Mops/s overall.
+template <typename F>
+static void run_map(const std::string& p_strName, int p_nThreads, int p_nIters, F p_fnOp)
+{
+	double ms = time_ms([&] {
+		std::vector<std::thread> vThreads;
+		std::atomic<uint64_t> nHits(0);
+		for (int t = 0; t < p_nThreads; t++) {
+			vThreads.emplace_back([&, t] {
+				uint64_t x = 0x9e3779b97f4a7c15ULL * (t + 1), nLocal = 0;
+				for (int n = 0; n < p_nIters * LD_MAP_OPS; n++) {
+					x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+					nLocal += p_fnOp(x % (LD_MAP_CAPACITY * 2), (x >> 40) % 10 == 0);
+				}
+				nHits += nLocal;
+			});
+		}
+		for (auto& th : vThreads) th.join();
+		//. the hit count is only there to keep the lookups from being optimised away.
+		if (nHits == 0) printf("%s : no hits\n", p_strName.c_str());
+	});
+	double nOps = (double)p_nThreads * p_nIters * LD_MAP_OPS;
+	double mops = ms > 0 ? nOps / ms / 1000.0 : 0;
+	printf("%-34s threads %3d : %9.2f Mops/s\n", p_strName.c_str(), p_nThreads, mops);
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("name", p_strName);
+	r->set("threads", p_nThreads);
+	r->set("ops", (uint64_t)nOps);
+	r->set("mops_per_sec", mops);
+	lv_results->add(r);
+}
+
+static void bench_map(const SdkBenchOptions& p_opt)
+{
+	for (int nThreads : p_opt.mapThreads) {
+		//. the result cache's shape : 16 shards, CLOCK eviction, a TTL on every entry.
+		ShardedMap<uint64_t, uint64_t> sharded(LD_MAP_CAPACITY, 16);
+		const auto ttl = std::chrono::seconds(300);
+		run_map("map sharded", nThreads, p_opt.iters, [&](uint64_t p_nKey, bool p_bInsert) {
+			uint64_t v;
+			if (p_bInsert) {
+				sharded.insert(p_nKey, p_nKey, ttl);
+				return false;
+			}
+			return sharded.find(p_nKey, v);
+		});
+
+		Poco::AccessExpireLRUCache<uint64_t, uint64_t> lru(LD_MAP_CAPACITY, 300 * 1000);
+		run_map("map poco lru", nThreads, p_opt.iters, [&](uint64_t p_nKey, bool p_bInsert) {
+			if (p_bInsert) {
+				lru.add(p_nKey, p_nKey);
+				return false;
+			}
+			return !lru.get(p_nKey).isNull();
+		});
+	}
+}
+
+//. mi_verdict_of / mi_verdict_uncertain one result at a time, the path the batch kernel replaced.
+static void verdict_aos(const VerdictPolicy& p_policy, const CPipelineResult_t* p_pResults, const int* p_pErrors, size_t p_nCount, uint8_t* p_pVerdicts, uint8_t* p_pUncertain)
+{
+	for (size_t i = 0; i < p_nCount; i++) {
+		const CPipelineResult_t& r = p_pResults[i];
+		float p = r.liveness_result.probability;
+		int v;
+		if (p_pErrors[i] != OK) v = MI_VERDICT_REJECTED;
+		else if ((r.quality_result.ok && !r.liveness_result.ok) || r.quality_result.score < p_policy.qualityMin) v = MI_VERDICT_BAD_QUALITY;
+		else v = p >= p_policy.genuineMin ? MI_VERDICT_GENUINE : MI_VERDICT_SPOOFED;
+		p_pVerdicts[i] = (uint8_t)v;
+		p_pUncertain[i] = v <= MI_VERDICT_SPOOFED && p >= p_policy.uncertainLow && p < p_policy.uncertainHigh ? 1 : 0;
+	}
+}
+
+//. synthetic results : errors, quality-gated, NaN probabilities and values on the thresholds included.
+static void bench_verdict(const SdkBenchOptions& p_opt)
+{
+	VerdictPolicy policy;
+	policy.uncertainLow = 0.4f;
+	policy.uncertainHigh = 0.6f;
+	MiCpuKernel* pKernel = NULL;
+	for (MiCpuKernel* k : mi_cpu_kernels()) if (strcmp(k->name, "verdict") == 0) pKernel = k;
+	if (pKernel == NULL) return;
+	for (int nSize : p_opt.verdictSizes) {
+		if (nSize < 1) continue;
+		size_t n = (size_t)nSize;
+		std::vector<CPipelineResult_t> results(n);
+		std::vector<int> errors(n, OK);
+		uint32_t seed = 12345;
+		for (size_t i = 0; i < n; i++) {
+			seed = seed * 1664525u + 1013904223u;
+			CPipelineResult_t& r = results[i];
+			r.liveness_result.probability = (seed >> 8) % 1001 / 1000.0f;
+			r.liveness_result.score = r.liveness_result.probability * 8 - 4;
+			r.liveness_result.ok = (seed & 31) != 0;
+			r.quality_result.score = (seed >> 4) % 1001 / 1000.0f;
+			r.quality_result.ok = true;
+			r.quality_result.class_ = r.quality_result.score >= 0.5f;
+			if ((seed & 63) == 1) errors[i] = FACE_NOT_FOUND;
+			if ((seed & 127) == 2) r.liveness_result.probability = std::numeric_limits<float>::quiet_NaN();
+			if ((seed & 127) == 3) r.liveness_result.probability = policy.genuineMin;
+		}
+		std::vector<uint8_t> expect(n), expectUnc(n), got(n), gotUnc(n);
+		int iters = p_opt.iters * (int)std::max<size_t>(1, 100000 / n);
+		double ms = time_ms([&] { for (int i = 0; i < iters; i++) verdict_aos(policy, results.data(), errors.data(), n, expect.data(), expectUnc.data()); });
+		report("verdict per result", -1, -1, nSize, n * iters, ms);
+		for (int var = 0; var < pKernel->count; var++) {
+			if (!mi_cpu_bind(pKernel, var)) {
+				printf("verdict %s : skipped, needs %s\n", pKernel->variants[var], mi_cpu_feature_names(pKernel->needs[var]).c_str());
+				continue;
+			}
+			ms = time_ms([&] { for (int i = 0; i < iters; i++) mi_verdict_batch(policy, results.data(), errors.data(), n, got.data(), gotUnc.data()); });
+			if (got != expect || gotUnc != expectUnc) printf("verdict %s : MISMATCH with the per-result verdicts\n", pKernel->variants[var]);
+			report(std::string("verdict batch ") + pKernel->variants[var], -1, -1, nSize, n * iters, ms);
+		}
+		mi_cpu_bind(pKernel, pKernel->best);
+	}
+}
+
+static void bench_engines(const SdkBenchOptions& p_opt, CInitConfig_t* p_pConfig, const std::vector<const CImage_t*>& p_vImages, int p_nThreads, int p_nStreams)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	size_t n = p_vImages.size() * p_opt.iters;
+
+	CDetectEngine_t* det = face_sdk_api().detection_create(p_opt.detector.c_str(), p_pConfig, &err, msg);
+	if (det != NULL) {
+		double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) for (auto img : p_vImages) { CDetectionResult_t* r = face_sdk_api().detect(det, img, &err, msg); if (r) face_sdk_api().CDetectionResult_destroy(r); } });
+		report("detect", p_nThreads, p_nStreams, 1, n, ms);
+		ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) for (auto img : p_vImages) { CBoundingBoxes_t* r = face_sdk_api().detect_only_bounding_box(det, img, &err, msg); if (r) face_sdk_api().CBoundingBoxes_destroy(r); } });
+		report("detect_only_bounding_box", p_nThreads, p_nStreams, 1, n, ms);
+	}
+	else {
+		printf("detection_create(%s) failed : %s\n", p_opt.detector.c_str(), msg);
+	}
+
+	CQualityEngine_t* qual = face_sdk_api().quality_create(p_opt.quality.c_str(), p_pConfig, &err, msg);
+	if (qual != NULL) {
+		double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) for (auto img : p_vImages) face_sdk_api().check_quality(qual, img, &err, msg); });
+		report("check_quality", p_nThreads, p_nStreams, 1, n, ms);
+	}
+	else {
+		printf("quality_create(%s) failed : %s\n", p_opt.quality.c_str(), msg);
+	}
+
+	CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, p_pConfig, &err, msg);
+	if (pipe != NULL) {
+		//. first call compiles / allocates lazily, keep it out of the numbers.
+		face_sdk_api().pipeline_check_liveness(pipe, p_vImages[0], NULL, &err, msg);
+		double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) for (auto img : p_vImages) face_sdk_api().pipeline_check_liveness(pipe, img, NULL, &err, msg); });
+		report("pipeline_check_liveness", p_nThreads, p_nStreams, 1, n, ms);
+	}
+	else {
+		printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+	}
+
+	//. batch variants : the corpus is cycled to fill each batch.
+	for (int b : p_opt.batches) {
+		if (b < 1) continue;
+		std::vector<const CImage_t*> batch(b);
+		for (int k = 0; k < b; k++) batch[k] = p_vImages[k % p_vImages.size()];
+		std::vector<int> errors(b, OK);
+		std::vector<std::string> msgBufs(b, std::string(MESSAGE_BUFFER_SIZE, '\0'));
+		std::vector<char*> msgs(b);
+		for (int k = 0; k < b; k++) msgs[k] = &msgBufs[k][0];
+		size_t nb = (size_t)b * p_opt.iters;
+
+		if (det != NULL) {
+			double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) { CDetectionResult_t* r = face_sdk_api().detect_batch(det, batch.data(), b, errors.data(), msgs.data()); if (r) face_sdk_api().CDetectionResult_destroy_array(r, b); } });
+			report("detect_batch", p_nThreads, p_nStreams, b, nb, ms);
+			ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) { CBoundingBoxes_t* r = face_sdk_api().detect_only_bounding_box_batch(det, batch.data(), b, errors.data(), msgs.data()); if (r) face_sdk_api().CBoundingBoxes_destroy_array(r, b); } });
+			report("detect_only_bounding_box_batch", p_nThreads, p_nStreams, b, nb, ms);
+		}
+		if (qual != NULL) {
+			double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) { CQualityResult_t* r = face_sdk_api().check_quality_batch(qual, batch.data(), b, errors.data(), msgs.data()); if (r) face_sdk_api().CQualityResult_destroy_array(r); } });
+			report("check_quality_batch", p_nThreads, p_nStreams, b, nb, ms);
+		}
+		if (pipe != NULL) {
+			double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) { CPipelineResult_t* r = face_sdk_api().pipeline_check_liveness_batch2(pipe, batch.data(), b, NULL, errors.data(), msgs.data()); if (r) face_sdk_api().CPipelineResult_destroy_array(r); } });
+			report("pipeline_check_liveness_batch2", p_nThreads, p_nStreams, b, nb, ms);
+		}
+	}
+
+	if (pipe != NULL) face_sdk_api().pipeline_destroy(pipe);
+	if (qual != NULL) face_sdk_api().quality_destroy(qual);
+	if (det != NULL) face_sdk_api().detection_destroy(det);
+}
+
+//. the same batches through the C wrapper and the C++ API it wraps. Each C call builds the
+//. const CImage_t* / errors / messages arrays and destroys its result array, each C++ call
+//. builds its std::vector<ImagePtr>, as LegacyBackend / CppBackend::check_batch do.
+static void bench_cpp(const SdkBenchOptions& p_opt, CInitConfig_t* p_pConfig, const std::vector<const CImage_t*>& p_vImages, const std::vector<CorpusImage>& p_vCorpus)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, p_pConfig, &err, msg);
+	if (pipe == NULL) {
+		printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+		return;
+	}
+	try {
+		facesdk::InitConfigPtr config = facesdk::InitConfig::createConfig(GD_SDK_CONFIG_DIR, GD_SDK_CONFIG_NAME);
+		facesdk::PipelinePtr pipeline = facesdk::FaceSDK::getPipeline(GD_SDK_PIPELINE_NAME, config);
+		std::vector<facesdk::ImagePtr> images;
+		for (const CorpusImage& img : p_vCorpus) {
+			try {
+				images.push_back(facesdk::Image::createImage((const uint8_t*)img.bytes.data(), img.bytes.size()));
+			}
+			catch (const facesdk::FaceException&) {
+			}
+		}
+		if (images.empty()) {
+			printf("cpp : no decodable image in corpus\n");
+			face_sdk_api().pipeline_destroy(pipe);
+			return;
+		}
+		//. first calls compile / allocate lazily, keep them out of the numbers.
+		face_sdk_api().pipeline_check_liveness(pipe, p_vImages[0], NULL, &err, msg);
+		pipeline->checkLivenessBatch({ images[0] });
+
+		for (int b : p_opt.cppBatches) {
+			if (b < 1) continue;
+			size_t nb = (size_t)b * p_opt.iters;
+			double drift = 0;
+			double msC = time_ms([&] {
+				for (int i = 0; i < p_opt.iters; i++) {
+					std::vector<const CImage_t*> batch(b);
+					for (int k = 0; k < b; k++) batch[k] = p_vImages[k % p_vImages.size()];
+					std::vector<int> errors(b, OK);
+					std::vector<std::string> msgBufs(b, std::string(MESSAGE_BUFFER_SIZE, '\0'));
+					std::vector<char*> msgs(b);
+					for (int k = 0; k < b; k++) msgs[k] = &msgBufs[k][0];
+					CPipelineResult_t* r = face_sdk_api().pipeline_check_liveness_batch2(pipe, batch.data(), b, NULL, errors.data(), msgs.data());
+					if (r) face_sdk_api().CPipelineResult_destroy_array(r);
+				}
+			});
+			double msCpp = time_ms([&] {
+				for (int i = 0; i < p_opt.iters; i++) {
+					std::vector<facesdk::ImagePtr> batch;
+					batch.reserve(b);
+					for (int k = 0; k < b; k++) batch.push_back(images[k % images.size()]);
+					std::vector<facesdk::OptionalPipelineResult> r = pipeline->checkLivenessBatch(batch);
+				}
+			});
+			report("pipeline_check_liveness_batch2 (C)", -1, -1, b, nb, msC);
+			report("Pipeline::checkLivenessBatch (C++)", -1, -1, b, nb, msCpp);
+
+			//. both APIs answer the same : the C wrapper only marshals.
+			if (p_vImages.size() == images.size()) {
+				size_t m = std::min((size_t)b, images.size());
+				std::vector<const CImage_t*> cbatch(p_vImages.begin(), p_vImages.begin() + m);
+				std::vector<int> errors(m, OK);
+				CPipelineResult_t* r = face_sdk_api().pipeline_check_liveness_batch2(pipe, cbatch.data(), m, NULL, errors.data(), NULL);
+				std::vector<facesdk::ImagePtr> batch(images.begin(), images.begin() + m);
+				std::vector<facesdk::OptionalPipelineResult> out = pipeline->checkLivenessBatch(batch);
+				for (size_t k = 0; r != NULL && k < out.size(); k++) {
+					if (!out[k].ok() || errors[k] != OK) continue;
+					double d = out[k].value().liveness_result.probability - r[k].liveness_result.probability;
+					drift = std::max(drift, d < 0 ? -d : d);
+				}
+				if (r) face_sdk_api().CPipelineResult_destroy_array(r);
+				printf("cpp batch %3d : C++ / C time %.3f, max |probability delta| %.6f\n", b, msC > 0 ? msCpp / msC : 0.0, drift);
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		printf("cpp : %s\n", e.what());
+	}
+	face_sdk_api().pipeline_destroy(pipe);
+}
+
+//. one pipeline_check_liveness_batch2 of p_nCount images, p_nSlots - p_nCount of them repeats.
+static void bucket_call(CPipeline_t* p_pPipe, const std::vector<const CImage_t*>& p_vImages, size_t p_nCount, size_t p_nSlots)
+{
+	std::vector<const CImage_t*> batch(p_nSlots);
+	for (size_t k = 0; k < p_nSlots; k++) batch[k] = p_vImages[(k < p_nCount ? k : 0) % p_vImages.size()];
+	std::vector<int> errors(p_nSlots, OK);
+	std::vector<std::string> msgBufs(p_nSlots, std::string(MESSAGE_BUFFER_SIZE, '\0'));
+	std::vector<char*> msgs(p_nSlots);
+	for (size_t k = 0; k < p_nSlots; k++) msgs[k] = &msgBufs[k][0];
+	CPipelineResult_t* r = face_sdk_api().pipeline_check_liveness_batch2(p_pPipe, batch.data(), p_nSlots, NULL, errors.data(), msgs.data());
+	if (r) face_sdk_api().CPipelineResult_destroy_array(r);
+}
+
+//. [batch] buckets (MiBuckets.h) : the cost table of the bucket shapes on a pipeline compiled
+//. for the largest, then every batch size up to it as one call of its own size against the
+//. padded / split calls the batcher would plan from that table.
+static void bench_buckets(const SdkBenchOptions& p_opt, CInitConfig_t* p_pConfig, const std::vector<const CImage_t*>& p_vImages)
+{
+	BatchBuckets buckets;
+	buckets.init(p_opt.buckets, 0);
+	if (!buckets.enabled()) return;
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	face_sdk_api().set_ov_max_batch_size(buckets.largest());
+	CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, p_pConfig, &err, msg);
+	if (pipe == NULL) {
+		printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+		return;
+	}
+	//. as the warm-up : the fastest call per bucket, the first ones compile.
+	for (int b : buckets.sizes()) {
+		bucket_call(pipe, p_vImages, b, b);
+		for (int i = 0; i < p_opt.iters; i++) {
+			double ms = time_ms([&] { bucket_call(pipe, p_vImages, b, b); });
+			buckets.measure(b, ms / 1000.0);
+		}
+		double ms = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) bucket_call(pipe, p_vImages, b, b); });
+		report("bucket batch2", -1, -1, b, (size_t)b * p_opt.iters, ms);
+	}
+
+	std::vector<int> calls;
+	for (int n = 1; n <= buckets.largest(); n++) {
+		buckets.plan(n, calls);
+		bucket_call(pipe, p_vImages, n, n);
+		double msOne = time_ms([&] { for (int i = 0; i < p_opt.iters; i++) bucket_call(pipe, p_vImages, n, n); });
+		double msPlan = time_ms([&] {
+			for (int i = 0; i < p_opt.iters; i++) {
+				int at = 0;
+				for (int c : calls) {
+					int take = std::min(c, n - at);
+					bucket_call(pipe, p_vImages, take, c);
+					at += take;
+				}
+			}
+		});
+		report("unbucketed batch2", -1, -1, n, (size_t)n * p_opt.iters, msOne);
+		report("bucketed batch2 plan", -1, -1, n, (size_t)n * p_opt.iters, msPlan);
+		std::string strPlan;
+		for (int c : calls) strPlan += (strPlan.empty() ? "" : " + ") + std::to_string(c);
+		printf("buckets %3d : plan %s, planned / unbucketed time %.3f\n", n, strPlan.c_str(), msOne > 0 ? msPlan / msOne : 0.0);
+	}
+	face_sdk_api().pipeline_destroy(pipe);
+}
+
+//. full decode + liveness against crop + liveness on the same uploads, with the
+//. probability drift the crop introduces.
+static void bench_crop(const SdkBenchOptions& p_opt, CInitConfig_t* p_pConfig, const std::vector<CorpusImage>& p_vImages)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+
+	CropSettings crop;
+	crop.margin = (float)GD_CROP_MARGIN;
+	crop.targetSize = GD_CROP_TARGET_SIZE;
+	crop.minImageSide = p_opt.cropMinSide;
+	crop.detectSide = GD_CROP_DETECT_SIDE;
+	crop.detectors = 1;
+	crop.detector = p_opt.detector;
+	std::string strErr;
+	if (!mi_crop_init(GD_SDK_CONFIG_DIR, GD_SDK_CONFIG_NAME, crop, strErr)) {
+		printf("crop : %s\n", strErr.c_str());
+		return;
+	}
+	CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, p_pConfig, &err, msg);
+	if (pipe == NULL) {
+		printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+		mi_crop_shutdown();
+		return;
+	}
+
+	size_t n = 0;
+	double msFull = 0, msCrop = 0, drift = 0;
+	for (const CorpusImage& img : p_vImages) {
+		CropFrame frame;
+		if (!mi_crop_encoded((const uint8_t*)img.bytes.data(), img.bytes.size(), frame)) continue;
+		CPipelineResult_t full = {}, cut = {};
+		for (int i = 0; i < p_opt.iters; i++) {
+			msFull += time_ms([&] {
+				CImage_t* p = face_sdk_api().image_create_bytes((const uint8_t*)img.bytes.data(), img.bytes.size(), &err, msg);
+				if (p) { full = face_sdk_api().pipeline_check_liveness(pipe, p, NULL, &err, msg); face_sdk_api().image_destroy(p); }
+			});
+			msCrop += time_ms([&] {
+				CropFrame f;
+				if (!mi_crop_encoded((const uint8_t*)img.bytes.data(), img.bytes.size(), f)) return;
+				CImage_t* p = face_sdk_api().image_create_pixels(f.pixels.data(), (size_t)f.height, (size_t)f.width, BGR888, &err, msg);
+				if (p) { cut = face_sdk_api().pipeline_check_liveness(pipe, p, NULL, &err, msg); face_sdk_api().image_destroy(p); }
+			});
+			n++;
+		}
+		double d = full.liveness_result.probability - cut.liveness_result.probability;
+		drift += d < 0 ? -d : d;
+	}
+	if (n > 0) {
+		report("full image + liveness", -1, -1, 1, n, msFull);
+		report("face crop + liveness", -1, -1, 1, n, msCrop);
+		printf("face crop : mean |probability delta| %.4f over %zu images\n", drift * p_opt.iters / n, n / p_opt.iters);
+	}
+	else {
+		printf("face crop : no image qualified (min side %d, face found, no EXIF rotation)\n", p_opt.cropMinSide);
+	}
+	face_sdk_api().pipeline_destroy(pipe);
+	mi_crop_shutdown();
+}
+
+//. the same photo stored rotated : checked as stored against turned upright first, with the
+//. probability drift between the two.
+static void bench_upright(const SdkBenchOptions& p_opt, CInitConfig_t* p_pConfig, const std::vector<CorpusImage>& p_vImages)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, p_pConfig, &err, msg);
+	if (pipe == NULL) {
+		printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+		return;
+	}
+
+	size_t n = 0;
+	double msStored = 0, msUpright = 0, msTurn = 0, drift = 0;
+	for (const CorpusImage& img : p_vImages) {
+		if (img.bgr.empty()) continue;
+		//. the corpus image is the upright view; store it as the camera would have.
+		int w = (int)img.cols, h = (int)img.rows, sw = 0, sh = 0, uw = 0, uh = 0;
+		int stored = mi_orient_inverse(p_opt.upright);
+		mi_orient_size(stored, w, h, sw, sh);
+		std::vector<uint8_t> pixels((size_t)sw * sh * 3), upright((size_t)w * h * 3);
+		mi_orient_bgr(img.bgr.data(), w, h, (size_t)w * 3, stored, pixels.data(), (size_t)sw * 3);
+		mi_orient_size(p_opt.upright, sw, sh, uw, uh);
+
+		CPipelineResult_t asStored = {}, turned = {};
+		for (int i = 0; i < p_opt.iters; i++) {
+			msStored += time_ms([&] {
+				CImage_t* p = face_sdk_api().image_create_pixels(pixels.data(), (size_t)sh, (size_t)sw, BGR888, &err, msg);
+				if (p) { asStored = face_sdk_api().pipeline_check_liveness(pipe, p, NULL, &err, msg); face_sdk_api().image_destroy(p); }
+			});
+			msUpright += time_ms([&] {
+				msTurn += time_ms([&] { mi_orient_bgr(pixels.data(), sw, sh, (size_t)sw * 3, p_opt.upright, upright.data(), (size_t)uw * 3); });
+				CImage_t* p = face_sdk_api().image_create_pixels(upright.data(), (size_t)uh, (size_t)uw, BGR888, &err, msg);
+				if (p) { turned = face_sdk_api().pipeline_check_liveness(pipe, p, NULL, &err, msg); face_sdk_api().image_destroy(p); }
+			});
+			n++;
+		}
+		double d = asStored.liveness_result.probability - turned.liveness_result.probability;
+		drift += d < 0 ? -d : d;
+	}
+	if (n > 0) {
+		std::string suffix = " (orientation " + std::to_string(p_opt.upright) + ")";
+		report("stored rotated + liveness" + suffix, -1, -1, 1, n, msStored);
+		report("turned upright + liveness" + suffix, -1, -1, 1, n, msUpright);
+		report("upright turn only" + suffix, -1, -1, 1, n, msTurn);
+		printf("upright : mean |probability delta| %.4f over %zu images\n", drift * p_opt.iters / n, n / p_opt.iters);
+	}
+	else {
+		printf("upright : skipped, no 24-bit .bmp in corpus\n");
+	}
+	face_sdk_api().pipeline_destroy(pipe);
+}
+
+static void report_idle(int p_nGapMs, int p_nIters, double p_dIdleCpuMs, double p_dWarmMs, std::vector<double>& p_vWakeMs)
+{
+	std::sort(p_vWakeMs.begin(), p_vWakeMs.end());
+	double cores = p_nIters > 0 && p_nGapMs > 0 ? p_dIdleCpuMs / ((double)p_nGapMs * p_nIters) : 0;
+	double warm = p_nIters > 0 ? p_dWarmMs / p_nIters : 0;
+	double wake = 0;
+	for (double ms : p_vWakeMs) wake += ms;
+	wake = p_vWakeMs.empty() ? 0 : wake / p_vWakeMs.size();
+	double p99 = p_vWakeMs.empty() ? 0 : p_vWakeMs[(p_vWakeMs.size() - 1) * 99 / 100];
+	printf("idle gap %6d ms : %6.2f cores idle %9.3f ms warm %9.3f ms after (p99 %9.3f)\n", p_nGapMs, cores, warm, wake, p99);
+
+	JSON::Object::Ptr r = new JSON::Object;
+	r->set("name", "idle gap");
+	r->set("gap_ms", p_nGapMs);
+	r->set("wait_policy", mi_wait_passive() ? "passive" : "active");
+	r->set("checks", p_nIters);
+	r->set("idle_cores", cores);
+	r->set("warm_ms_per_check", warm);
+	r->set("ms_after_gap", wake);
+	r->set("p99_ms_after_gap", p99);
+	lv_results->add(r);
+}
+
+//. what waiting costs between bursts : a warm check, a pause with nothing to do while the
+//. process CPU is read (this thread sleeps, the rest is the SDK's threads), then the check
+//. that meets whatever state the pause left its threads in.
+static void bench_idle(const SdkBenchOptions& p_opt, CInitConfig_t* p_pConfig, const std::vector<const CImage_t*>& p_vImages)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, p_pConfig, &err, msg);
+	if (pipe == NULL) {
+		printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+		return;
+	}
+	for (const CImage_t* img : p_vImages) face_sdk_api().pipeline_check_liveness(pipe, img, NULL, &err, msg);
+
+	for (int gap : p_opt.idleGaps) {
+		double idleCpuMs = 0, warmMs = 0;
+		std::vector<double> vWakeMs;
+		for (int i = 0; i < p_opt.iters; i++) {
+			const CImage_t* img = p_vImages[i % p_vImages.size()];
+			warmMs += time_ms([&] { face_sdk_api().pipeline_check_liveness(pipe, img, NULL, &err, msg); });
+			uint64_t nCpu = mi_process_cpu_ns();
+			std::this_thread::sleep_for(std::chrono::milliseconds(gap));
+			idleCpuMs += (mi_process_cpu_ns() - nCpu) / 1e6;
+			vWakeMs.push_back(time_ms([&] { face_sdk_api().pipeline_check_liveness(pipe, img, NULL, &err, msg); }));
+		}
+		report_idle(gap, p_opt.iters, idleCpuMs, warmMs, vWakeMs);
+	}
+	face_sdk_api().pipeline_destroy(pipe);
+}
+
+//. image_create_bytes + pipeline_check_liveness per labeled image, once per meta.
+static void bench_accuracy(CInitConfig_t* p_pConfig, const std::vector<LabeledImage>& p_vImages)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	CPipeline_t* pipe = face_sdk_api().pipeline_create(GD_SDK_PIPELINE_NAME, p_pConfig, &err, msg);
+	if (pipe == NULL) {
+		printf("pipeline_create(%s) failed : %s\n", GD_SDK_PIPELINE_NAME, msg);
+		return;
+	}
+
+	const CALIBRATION_t calibrations[] = { REGULAR, SOFT, HARDENED };
+	const char* szTolerance[] = { "regular", "soft", "hardened" };
+	//. the C meta has no domain, its os DESKTOP is the desktop web-camera domain.
+	const char* szDomain[] = { "general", "desktop" };
+	//. first call compiles / allocates lazily, keep it out of the numbers.
+	CImage_t* pWarm = face_sdk_api().image_create_bytes((const uint8_t*)p_vImages[0].bytes.data(), p_vImages[0].bytes.size(), &err, msg);
+	if (pWarm) { face_sdk_api().pipeline_check_liveness(pipe, pWarm, NULL, &err, msg); face_sdk_api().image_destroy(pWarm); }
+	for (int c = 0; c < 3; c++) {
+		for (int d = 0; d < 2; d++) {
+			CMeta_t meta = face_sdk_api().get_default_meta();
+			meta.calibration = calibrations[c];
+			if (d == 1) meta.os = DESKTOP;
+			AccuracyStats stats;
+			for (const LabeledImage& img : p_vImages) {
+				CPipelineResult_t result = {};
+				double ms = time_ms([&] {
+					CImage_t* p = face_sdk_api().image_create_bytes((const uint8_t*)img.bytes.data(), img.bytes.size(), &err, msg);
+					if (p) { result = face_sdk_api().pipeline_check_liveness(pipe, p, &meta, &err, msg); face_sdk_api().image_destroy(p); }
+				});
+				stats.ms.push_back(ms);
+				bool bValid = err == OK && result.quality_result.score >= LD_THRESHOLD;
+				bool bAccepted = bValid && result.liveness_result.probability >= LD_THRESHOLD;
+				if (!bValid) stats.invalid++;
+				if (img.genuine) { stats.genuine++; if (!bAccepted) stats.genuineRejected++; }
+				else { stats.spoof++; if (bAccepted) stats.spoofAccepted++; }
+			}
+			report_accuracy("c_api", szTolerance[c], szDomain[d], stats);
+		}
+	}
+	face_sdk_api().pipeline_destroy(pipe);
+}
+
+//. the same sweep through FaceAnalyzer::Analyze and its FaceAnalysisParameters.
+static void bench_accuracy_blueprint(const SdkBenchOptions& p_opt, const std::vector<LabeledImage>& p_vImages)
+{
+	try {
+		idliveface::Blueprint blueprint(p_opt.blueprint);
+		idliveface::ImageDecoder decoder = blueprint.CreateImageDecoder();
+		idliveface::FaceAnalyzer analyzer = blueprint.CreateFaceAnalyzer();
+
+		const idliveface::Tolerance tolerances[] = { idliveface::Tolerance::kRegular, idliveface::Tolerance::kSoft, idliveface::Tolerance::kHardened };
+		const char* szTolerance[] = { "regular", "soft", "hardened" };
+		const idliveface::Domain domains[] = { idliveface::Domain::kGeneral, idliveface::Domain::kDesktop };
+		const char* szDomain[] = { "general", "desktop" };
+		//. first call compiles the models.
+		try {
+			analyzer.Analyze(decoder.Decode((const uint8_t*)p_vImages[0].bytes.data(), p_vImages[0].bytes.size()));
+		}
+		catch (const std::exception&) {
+		}
+		for (int t = 0; t < 3; t++) {
+			for (int d = 0; d < 2; d++) {
+				idliveface::FaceAnalysisParameters params;
+				params.tolerance = tolerances[t];
+				params.domain = domains[d];
+				AccuracyStats stats;
+				for (const LabeledImage& img : p_vImages) {
+					idliveface::FaceStatus status = idliveface::FaceStatus::kInvalid;
+					double ms = time_ms([&] {
+						try {
+							status = analyzer.Analyze(decoder.Decode((const uint8_t*)img.bytes.data(), img.bytes.size()), params).status;
+						}
+						catch (const std::exception&) {
+							status = idliveface::FaceStatus::kInvalid;
+						}
+					});
+					stats.ms.push_back(ms);
+					bool bAccepted = status == idliveface::FaceStatus::kGenuine;
+					if (status == idliveface::FaceStatus::kInvalid) stats.invalid++;
+					if (img.genuine) { stats.genuine++; if (!bAccepted) stats.genuineRejected++; }
+					else { stats.spoof++; if (bAccepted) stats.spoofAccepted++; }
+				}
+				report_accuracy("blueprint", szTolerance[t], szDomain[d], stats);
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		printf("blueprint (%s) : %s\n", p_opt.blueprint.c_str(), e.what());
+	}
+}
+
+static void bench_blueprint(const SdkBenchOptions& p_opt, const std::vector<CorpusImage>& p_vImages, int p_nCores)
+{
+	try {
+		idliveface::RuntimeConfiguration rc = idliveface::CreateRuntimeConfiguration(p_nCores < 0 ? 0 : p_nCores);
+		idliveface::Blueprint blueprint(p_opt.blueprint, rc);
+		idliveface::ImageDecoder decoder = blueprint.CreateImageDecoder();
+		idliveface::FaceAnalyzer analyzer = blueprint.CreateFaceAnalyzer();
+
+		std::vector<idliveface::Image> images;
+		size_t n = 0;
+		double msDecode = 0, msAnalyze = 0;
+		for (const CorpusImage& img : p_vImages) {
+			for (int i = 0; i < p_opt.iters; i++) {
+				msDecode += time_ms([&] { decoder.Decode((const uint8_t*)img.bytes.data(), img.bytes.size()); });
+			}
+			images.push_back(decoder.Decode((const uint8_t*)img.bytes.data(), img.bytes.size()));
+		}
+		//. first call compiles the models.
+		analyzer.Analyze(images[0]);
+		for (const idliveface::Image& image : images) {
+			for (int i = 0; i < p_opt.iters; i++) {
+				msAnalyze += time_ms([&] { analyzer.Analyze(image); });
+				n++;
+			}
+		}
+		printf("blueprint runtime : worker_threads %d backend_threads %d backend_invocations %d\n",
+			rc.worker_threads, rc.backend_threads, rc.backend_invocations);
+		report("blueprint Decode", p_nCores, -1, 1, n, msDecode);
+		report("blueprint Analyze", p_nCores, -1, 1, n, msAnalyze);
+	}
+	catch (const std::exception& e) {
+		printf("blueprint (%s) : %s\n", p_opt.blueprint.c_str(), e.what());
+	}
+}
+
+static std::vector<int> parse_list(const std::string& p_strText)
+{
+	std::vector<int> v;
+	StringTokenizer tok(p_strText, ",", StringTokenizer::TOK_TRIM | StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& t : tok) v.push_back(NumberParser::parse(t));
+	return v;
+}
+
+static bool parse_args(int argc, char** argv, SdkBenchOptions& o)
+{
+	o.corpus = "../images";
+	o.iters = 20;
+	o.batches = { 1, 2, 4, 8 };
+	o.threads = { 0 };
+	o.streams = { -2 };
+	o.detector = "BaseNnetDetector";
+	o.cropMinSide = -1;
+	o.kernelWidth = o.kernelHeight = 0;
+	o.upright = 0;
+	o.tbbMaxThreads = 0;
+	o.quality = "ExpositionQualityEngine";
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "--help" || a == "-h" || i + 1 >= argc) return false;
+		std::string v = argv[++i];
+		if (a == "--corpus") o.corpus = v;
+		else if (a == "--iters") o.iters = NumberParser::parse(v);
+		else if (a == "--batch") o.batches = parse_list(v);
+		else if (a == "--threads") o.threads = parse_list(v);
+		else if (a == "--streams") o.streams = parse_list(v);
+		else if (a == "--detector") o.detector = v;
+		else if (a == "--quality") o.quality = v;
+		else if (a == "--json") o.jsonPath = v;
+		else if (a == "--blueprint") o.blueprint = v;
+		else if (a == "--crop") o.cropMinSide = NumberParser::parse(v);
+		else if (a == "--labeled") o.labeled = v;
+		else if (a == "--cache-dir") o.cacheDir = v;
+		else if (a == "--multipart") o.multipartMb = parse_list(v);
+		else if (a == "--ingest") o.ingestKb = parse_list(v);
+		else if (a == "--json-scan") o.jsonScanMb = parse_list(v);
+		else if (a == "--map") o.mapThreads = parse_list(v);
+		else if (a == "--verdict") o.verdictSizes = parse_list(v);
+		else if (a == "--cpp") o.cppBatches = parse_list(v);
+		else if (a == "--buckets") o.buckets = v;
+		else if (a == "--wait-policy") o.waitPolicy = Poco::toLower(v);
+		else if (a == "--tbb-max-threads") o.tbbMaxThreads = NumberParser::parse(v);
+		else if (a == "--idle-gaps") o.idleGaps = parse_list(v);
+		else if (a == "--upright") {
+			o.upright = NumberParser::parse(v);
+			if (o.upright < 1 || o.upright > 8) return false;
+		}
+		else if (a == "--kernels") {
+			StringTokenizer size(v, "x", StringTokenizer::TOK_TRIM);
+			if (size.count() != 2) return false;
+			o.kernelWidth = NumberParser::parse(size[0]);
+			o.kernelHeight = NumberParser::parse(size[1]);
+			if (o.kernelWidth < 1 || o.kernelHeight < 1) return false;
+		}
+		else return false;
+	}
+	return o.iters > 0;
+}
+
+int main(int argc, char** argv)
+{
+	SdkBenchOptions opt;
+	try {
+		if (!parse_args(argc, argv, opt)) {
+			printf("SdkBench [--corpus dir] [--iters n] [--batch n,...] [--threads n,...] [--streams n,...]\n"
+				"         [--detector name] [--quality name] [--json file|-] [--crop min_side] [--blueprint dir]\n"
+				"         [--labeled dir] [--cache-dir dir] [--kernels WxH] [--upright 1..8] [--multipart mb,...]\n"
+				"         [--ingest kb,...] [--json-scan mb,...] [--map threads,...] [--verdict n,...] [--cpp n,...] [--buckets n,...]\n");
+			return 2;
+		}
+	}
+	catch (const Exception& ex) {
+		printf("%s\n", ex.displayText().c_str());
+		return 2;
+	}
+
+	std::vector<CorpusImage> corpus, codecCorpus;
+	load_corpus(opt.corpus, corpus, codecCorpus);
+	if (corpus.empty()) {
+		printf("no images in %s\n", opt.corpus.c_str());
+		return 2;
+	}
+
+	//. the SDK's runtimes read their wait settings once, when they load.
+	if (!opt.waitPolicy.empty() || opt.tbbMaxThreads > 0) {
+		mi_wait_init(opt.waitPolicy.empty() ? "active" : opt.waitPolicy, opt.tbbMaxThreads);
+		if (mi_wait_passive() && !Environment::has("FACESDK_OV_BIND_THREADS")) Environment::set("FACESDK_OV_BIND_THREADS", "0");
+	}
+	//. setting_init builds the global pipeline : with a cache directory that is the time to ready.
+	MiModelCacheStats cacheBefore = { 0, 0 };
+	if (!opt.cacheDir.empty()) {
+		if (!mi_model_cache_init(opt.cacheDir)) return 2;
+		cacheBefore = mi_model_cache_stats(opt.cacheDir);
+	}
+	double msInit = time_ms([] { setting_init(1); });
+	if (!opt.cacheDir.empty()) report_startup("startup legacy setting_init", cacheBefore, opt.cacheDir, msInit);
+	const char* pszMissing = NULL;
+	if (face_sdk_api_publish(g_hFaceDll, &pszMissing) == false) {
+		printf("FaceSDK entry point not found : %s\n", pszMissing);
+		return 1;
+	}
+
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	CInitConfig_t* config = face_sdk_api().config_create(GD_SDK_CONFIG_DIR, GD_SDK_CONFIG_NAME, &err, msg);
+	if (config == NULL) {
+		printf("config_create(%s, %s) failed : %s\n", GD_SDK_CONFIG_DIR, GD_SDK_CONFIG_NAME, msg);
+		return 1;
+	}
+
+	mi_codecs_init("webp,heif,avif");
+	bench_decode(opt, corpus, codecCorpus);
+	if (opt.kernelWidth > 0) bench_kernels(opt);
+	if (!opt.multipartMb.empty()) bench_multipart(opt);
+	if (!opt.ingestKb.empty()) bench_ingest(opt);
+	if (!opt.jsonScanMb.empty()) bench_json_scan(opt);
+	if (!opt.mapThreads.empty()) bench_map(opt);
+	if (!opt.verdictSizes.empty()) bench_verdict(opt);
+
+	std::vector<CImage_t*> owned;
+	std::vector<const CImage_t*> images;
+	for (const CorpusImage& img : corpus) {
+		CImage_t* p = face_sdk_api().image_create_bytes((const uint8_t*)img.bytes.data(), img.bytes.size(), &err, msg);
+		if (p == NULL) { printf("skip %s : %s\n", img.path.c_str(), msg); continue; }
+		owned.push_back(p);
+		images.push_back(p);
+	}
+	if (images.empty()) {
+		printf("no decodable image in corpus\n");
+		return 1;
+	}
+
+	//. engines are rebuilt for every sweep point since OpenVINO reads these when compiling.
+	for (int t : opt.threads) {
+		for (int s : opt.streams) {
+			ThreadingLevel_t level = ENGINE;
+			face_sdk_api().set_num_threads((unsigned int)(t < 0 ? 0 : t), &level, &err, msg);
+			if (s >= -1) face_sdk_api().set_ov_num_throughput_streams(s);
+			bench_engines(opt, config, images, t, s);
+		}
+	}
+
+	if (opt.cropMinSide >= 0) bench_crop(opt, config, corpus);
+	if (!opt.cppBatches.empty()) bench_cpp(opt, config, images, corpus);
+	if (!opt.buckets.empty()) bench_buckets(opt, config, images);
+	if (opt.upright > 0) bench_upright(opt, config, corpus);
+	if (!opt.idleGaps.empty()) bench_idle(opt, config, images);
+
+	std::vector<LabeledImage> labeled;
+	if (!opt.labeled.empty()) {
+		load_labeled(opt.labeled, labeled);
+		if (labeled.size() < 2) printf("labeled : no images in %s/genuine or %s/spoof\n", opt.labeled.c_str(), opt.labeled.c_str());
+		else bench_accuracy(config, labeled);
+	}
+
+	for (CImage_t* p : owned) face_sdk_api().image_destroy(p);
+	face_sdk_api().config_destroy(config);
+
+	if (!opt.blueprint.empty()) {
+		if (!opt.cacheDir.empty()) bench_startup_blueprint(opt, corpus);
+		for (int t : opt.threads) bench_blueprint(opt, corpus, t);
+		if (labeled.size() >= 2) bench_accuracy_blueprint(opt, labeled);
+	}
+
+	if (!opt.jsonPath.empty()) {
+		JSON::Object::Ptr root = new JSON::Object;
+		root->set("corpus", opt.corpus);
+		root->set("images", (int)images.size());
+		root->set("iters", opt.iters);
+		root->set("results", lv_results);
+		if (opt.jsonPath == "-") {
+			JSON::Stringifier::stringify(root, std::cout, 2);
+			std::cout << std::endl;
+		}
+		else {
+			std::ofstream out(opt.jsonPath);
+			JSON::Stringifier::stringify(root, out, 2);
+		}
+	}
+	return 0;
+}
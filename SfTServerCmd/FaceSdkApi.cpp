@@ -0,0 +1,138 @@
+#include "FaceSdkApi.h"
+#include "MiSdkCall.h"
+#include "MiLock.h"
+#include "licenseproc.h"
+#include <memory>
+#include <vector>
+
+static const FaceSdkApi lv_apiEmpty = { 0 };
+std::atomic<const FaceSdkApi*> g_pFaceApi(&lv_apiEmpty);
+
+//. every table ever published; kept until exit since a request may still be calling through an older one.
+static MI_MUTEX(lv_mtxApi, "face_sdk_api");
+static std::vector<std::unique_ptr<FaceSdkApi>> lv_vApi;
+
+#define LD_RESOLVE(name)															\
+	api.name = (name##_t)(mi_module_symbol(p_hDll, #name));						\
+	if (api.name == NULL) {															\
+		if (p_ppszMissing != NULL) *p_ppszMissing = #name;							\
+		return false;																\
+	}
+
+bool face_sdk_api_load(MiModule p_hDll, FaceSdkApi* p_pApi, const char** p_ppszMissing)
+{
+	if (p_hDll == NULL || p_pApi == NULL) {
+		if (p_ppszMissing != NULL) *p_ppszMissing = "module";
+		return false;
+	}
+
+	FaceSdkApi api = { 0 };
+	api.module = p_hDll;
+
+	LD_RESOLVE(get_default_meta);
+
+	LD_RESOLVE(config_create);
+	LD_RESOLVE(config_create2);
+	LD_RESOLVE(config_destroy);
+
+	LD_RESOLVE(image_create_bytes);
+	LD_RESOLVE(image_create_path);
+	LD_RESOLVE(image_create_pixels);
+	LD_RESOLVE(image_destroy);
+	LD_RESOLVE(image_batch_create);
+	LD_RESOLVE(image_batch_destroy);
+
+	LD_RESOLVE(detection_create);
+	LD_RESOLVE(detection_destroy);
+	LD_RESOLVE(detect);
+	LD_RESOLVE(detect_batch);
+	LD_RESOLVE(detect_only_bounding_box);
+	LD_RESOLVE(detect_only_bounding_box_batch);
+	LD_RESOLVE(CDetectionResult_destroy);
+	LD_RESOLVE(CDetectionResult_destroy_array);
+	LD_RESOLVE(CBoundingBoxes_destroy);
+	LD_RESOLVE(CBoundingBoxes_destroy_array);
+
+	LD_RESOLVE(quality_create);
+	LD_RESOLVE(quality_destroy);
+	LD_RESOLVE(check_quality);
+	LD_RESOLVE(check_quality_batch);
+	LD_RESOLVE(CQualityResult_destroy_array);
+
+	LD_RESOLVE(pipeline_create);
+	LD_RESOLVE(pipeline_destroy);
+	LD_RESOLVE(pipeline_check_liveness);
+	LD_RESOLVE(pipeline_check_liveness_batch);
+	LD_RESOLVE(pipeline_check_liveness_batch2);
+	LD_RESOLVE(CPipelineResult_destroy_array);
+
+	LD_RESOLVE(set_num_threads);
+	LD_RESOLVE(set_ov_num_throughput_streams);
+	LD_RESOLVE(set_ov_bind_threads);
+	LD_RESOLVE(set_ov_max_batch_size);
+	LD_RESOLVE(set_enable_logging);
+	LD_RESOLVE(set_num_pipeline_execution_streams);
+	LD_RESOLVE(set_enable_face_occlusion_detection);
+	LD_RESOLVE(set_enable_closed_eyes_detection);
+	LD_RESOLVE(get_license_info);
+	LD_RESOLVE(set_message_buffer_size);
+
+	*p_pApi = api;
+	return true;
+}
+
+bool face_sdk_api_publish(MiModule p_hDll, const char** p_ppszMissing)
+{
+	MiLockGuard lock(lv_mtxApi);
+	if (p_hDll != NULL && g_pFaceApi.load(std::memory_order_relaxed)->module == p_hDll) {
+		return true;
+	}
+	std::unique_ptr<FaceSdkApi> pApi(new FaceSdkApi());
+	if (face_sdk_api_load(p_hDll, pApi.get(), p_ppszMissing) == false) {
+		return false;
+	}
+	lv_vApi.push_back(std::move(pApi));
+	g_pFaceApi.store(lv_vApi.back().get(), std::memory_order_release);
+	return true;
+}
+
+bool face_sdk_api_refresh()
+{
+	return face_sdk_api_publish(g_hFaceDll);
+}
+
+std::string face_sdk_version()
+{
+	return mi_module_version(face_sdk_api().module);
+}
+
+//. STATUS enum of FaceSDK_C_Api.h in declaration order.
+static const char* lv_szStatus[] = {
+	"FACE_TOO_CLOSE", "FACE_CLOSE_TO_BORDER", "FACE_CROPPED", "FACE_NOT_FOUND", "TOO_MANY_FACES",
+	"FACE_TOO_SMALL", "FACE_ANGLE_TOO_LARGE", "FAILED_TO_READ_IMAGE", "FAILED_TO_WRITE_IMAGE",
+	"FAILED_TO_READ_MODEL", "FAILED_TO_BUILD_INTERPRETER", "FAILED_TO_INVOKE_INTERPRETER",
+	"FAILED_TO_ALLOCATE", "INVALID_CONFIG", "NO_SUCH_OBJECT_IN_BUILD",
+	"FAILED_TO_PREPROCESS_IMAGE_WHILE_PREDICT", "FAILED_TO_PREPROCESS_IMAGE_WHILE_DETECT",
+	"FAILED_TO_PREDICT_LANDMARKS", "INVALID_FUSE_MODE", "NULLPTR", "LICENSE_ERROR", "INVALID_META",
+	"UNKNOWN", "OK", "FACE_IS_OCCLUDED", "FAILED_TO_FETCH_COREML_DECRYPTION_KEY", "EYES_CLOSED"
+};
+
+const char* face_sdk_status_name(int p_nStatus)
+{
+	const int n = (int)(sizeof(lv_szStatus) / sizeof(lv_szStatus[0]));
+	return (p_nStatus >= 0 && p_nStatus < n) ? lv_szStatus[p_nStatus] : "OTHER";
+}
+
+//. SdkCall order, see MiSdkCall.h
+static const char* lv_szCalls[MI_SDK_CALL_COUNT] = {
+	"image_create_bytes", "image_create_path", "image_create_pixels",
+	"pipeline_check_liveness", "pipeline_check_liveness_batch", "pipeline_check_liveness_batch2",
+	"detect", "detect_batch", "detect_only_bounding_box", "detect_only_bounding_box_batch",
+	"check_quality", "check_quality_batch",
+	"Image::createImage", "Pipeline::checkLiveness", "Pipeline::checkLivenessBatch"
+};
+
+const char* mi_sdk_call_name(int p_nCall)
+{
+	return (p_nCall >= 0 && p_nCall < MI_SDK_CALL_COUNT) ? lv_szCalls[p_nCall] : "unknown";
+}
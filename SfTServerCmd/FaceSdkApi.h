@@ -0,0 +1,151 @@
+#pragma once
+
+#include "MiPlatform.h"
+#include <atomic>
+#include <string>
+#include <facesdk/FaceSDK_C_Api.h>
+
+//. FaceSDK C entry points resolved from g_hFaceDll.
+typedef CMeta_t (*get_default_meta_t)();
+
+typedef CInitConfig_t* (*config_create_t)(const char* folder, const char* config_name, int* err, char* msg);
+typedef CInitConfig_t* (*config_create2_t)(const char* file_path, int* err, char* msg);
+typedef void (*config_destroy_t)(CInitConfig_t* config);
+
+typedef CImage_t* (*image_create_bytes_t)(const uint8_t* bytes, size_t size, int* err, char* msg);
+typedef CImage_t* (*image_create_path_t)(const char* path, int* err, char* msg);
+typedef CImage_t* (*image_create_pixels_t)(const uint8_t* data, size_t rows, size_t cols, COLOR_ENCODING_t format, int* err, char* msg);
+typedef void (*image_destroy_t)(CImage_t* image);
+typedef CImageBatch_t* (*image_batch_create_t)(CImage_t** images, size_t num_images, const uint64_t* timestamps, int* err, char* msg);
+typedef void (*image_batch_destroy_t)(CImageBatch_t* image_batch);
+
+typedef CDetectEngine_t* (*detection_create_t)(const char* name, const CInitConfig_t* config, int* err, char* msg);
+typedef void (*detection_destroy_t)(CDetectEngine_t* engine);
+typedef CDetectionResult_t* (*detect_t)(const CDetectEngine_t* engine, const CImage_t* image, int* err, char* msg);
+typedef CDetectionResult_t* (*detect_batch_t)(const CDetectEngine_t* engine, const CImage_t** images, size_t num_images, int* errors, char** msg);
+typedef CBoundingBoxes_t* (*detect_only_bounding_box_t)(const CDetectEngine_t* engine, const CImage_t* image, int* err, char* msg);
+typedef CBoundingBoxes_t* (*detect_only_bounding_box_batch_t)(const CDetectEngine_t* engine, const CImage_t** images, size_t num_images, int* errors, char** msg);
+typedef void (*CDetectionResult_destroy_t)(CDetectionResult_t* result);
+typedef void (*CDetectionResult_destroy_array_t)(CDetectionResult_t* result, size_t size);
+typedef void (*CBoundingBoxes_destroy_t)(CBoundingBoxes_t* result);
+typedef void (*CBoundingBoxes_destroy_array_t)(CBoundingBoxes_t* result, size_t size);
+
+typedef CQualityEngine_t* (*quality_create_t)(const char* name, const CInitConfig_t* config, int* err, char* msg);
+typedef void (*quality_destroy_t)(CQualityEngine_t* engine);
+typedef CQualityResult_t (*check_quality_t)(const CQualityEngine_t* engine, const CImage_t* image, int* err, char* msg);
+typedef CQualityResult_t* (*check_quality_batch_t)(const CQualityEngine_t* engine, const CImage_t** images, size_t num_images, int* errors, char** msg);
+typedef void (*CQualityResult_destroy_array_t)(CQualityResult_t* result);
+
+typedef CPipeline_t* (*pipeline_create_t)(const char* name, const CInitConfig_t* config, int* err, char* msg);
+typedef void (*pipeline_destroy_t)(CPipeline_t* engine);
+typedef CPipelineResult_t (*pipeline_check_liveness_t)(const CPipeline_t* engine, const CImage_t* image, const CMeta_t* meta, int* err, char* msg);
+typedef CPipelineResult_t (*pipeline_check_liveness_batch_t)(const CPipeline_t* engine, const CImageBatch_t* image_batch, const CMeta_t* meta, int* err, char* msg);
+typedef CPipelineResult_t* (*pipeline_check_liveness_batch2_t)(const CPipeline_t* engine, const CImage_t** images, size_t num_images, const CMeta_t* meta, int* errors, char** msg);
+typedef void (*CPipelineResult_destroy_array_t)(CPipelineResult_t* result);
+
+typedef void (*set_num_threads_t)(unsigned int num_threads, const ThreadingLevel_t* threading_level, int* err, char* msg);
+typedef void (*set_ov_num_throughput_streams_t)(int ov_num_throughput_streams);
+typedef void (*set_ov_bind_threads_t)(bool ov_bind_threads);
+typedef void (*set_ov_max_batch_size_t)(unsigned int ov_max_batch_size);
+typedef void (*set_enable_logging_t)(bool enable_logging);
+typedef void (*set_num_pipeline_execution_streams_t)(unsigned int num_pipeline_execution_streams);
+typedef void (*set_enable_face_occlusion_detection_t)(bool enabled);
+typedef void (*set_enable_closed_eyes_detection_t)(bool enabled);
+typedef void (*get_license_info_t)(char* license_info, size_t license_info_length, int* err, char* msg);
+typedef void (*set_message_buffer_size_t)(size_t size);
+
+//. Dispatch table filled once from the loaded DLL. Handlers call through face_sdk_api()
+//. instead of looking symbols up per request.
+struct FaceSdkApi {
+	MiModule							module;
+
+	get_default_meta_t					get_default_meta;
+
+	config_create_t						config_create;
+	config_create2_t					config_create2;
+	config_destroy_t					config_destroy;
+
+	image_create_bytes_t				image_create_bytes;
+	image_create_path_t					image_create_path;
+	image_create_pixels_t				image_create_pixels;
+	image_destroy_t						image_destroy;
+	image_batch_create_t				image_batch_create;
+	image_batch_destroy_t				image_batch_destroy;
+
+	detection_create_t					detection_create;
+	detection_destroy_t					detection_destroy;
+	detect_t							detect;
+	detect_batch_t						detect_batch;
+	detect_only_bounding_box_t			detect_only_bounding_box;
+	detect_only_bounding_box_batch_t	detect_only_bounding_box_batch;
+	CDetectionResult_destroy_t			CDetectionResult_destroy;
+	CDetectionResult_destroy_array_t	CDetectionResult_destroy_array;
+	CBoundingBoxes_destroy_t			CBoundingBoxes_destroy;
+	CBoundingBoxes_destroy_array_t		CBoundingBoxes_destroy_array;
+
+	quality_create_t					quality_create;
+	quality_destroy_t					quality_destroy;
+	check_quality_t						check_quality;
+	check_quality_batch_t				check_quality_batch;
+	CQualityResult_destroy_array_t		CQualityResult_destroy_array;
+
+	pipeline_create_t					pipeline_create;
+	pipeline_destroy_t					pipeline_destroy;
+	pipeline_check_liveness_t			pipeline_check_liveness;
+	pipeline_check_liveness_batch_t		pipeline_check_liveness_batch;
+	pipeline_check_liveness_batch2_t	pipeline_check_liveness_batch2;
+	CPipelineResult_destroy_array_t		CPipelineResult_destroy_array;
+
+	set_num_threads_t					set_num_threads;
+	set_ov_num_throughput_streams_t		set_ov_num_throughput_streams;
+	set_ov_bind_threads_t				set_ov_bind_threads;
+	set_ov_max_batch_size_t				set_ov_max_batch_size;
+	set_enable_logging_t				set_enable_logging;
+	set_num_pipeline_execution_streams_t set_num_pipeline_execution_streams;
+	set_enable_face_occlusion_detection_t set_enable_face_occlusion_detection;
+	set_enable_closed_eyes_detection_t	set_enable_closed_eyes_detection;
+	get_license_info_t					get_license_info;
+	set_message_buffer_size_t			set_message_buffer_size;
+};
+
+//. Table in use; a refresh publishes a new one and never writes a published table, so a
+//. request may keep the reference for the whole call. Empty (all NULL) until the first publish.
+extern std::atomic<const FaceSdkApi*> g_pFaceApi;
+
+inline const FaceSdkApi& face_sdk_api()
+{
+	return *g_pFaceApi.load(std::memory_order_acquire);
+}
+
+//. The SDK reports a missing/expired license through the message text, not always with
+//. LICENSE_ERROR; the text is only read when the call failed.
+inline bool face_sdk_is_license_error(int p_nErr, const char* p_pszMsg)
+{
+	if (p_nErr == OK) return false;
+	if (p_nErr == LICENSE_ERROR) return true;
+	return p_pszMsg != NULL && p_pszMsg[0] != 0 && mi_stricmp(p_pszMsg, "License error: license is not installed") == 0;
+}
+
+//. STATUS of a call outcome, LICENSE_ERROR for a license failure whatever code it came with.
+inline int face_sdk_status(int p_nErr, const char* p_pszMsg)
+{
+	return face_sdk_is_license_error(p_nErr, p_pszMsg) ? LICENSE_ERROR : p_nErr;
+}
+
+//. STATUS value as its enum name, "OTHER" when out of range.
+const char* face_sdk_status_name(int p_nStatus);
+
+//. Resolves every entry point from p_hDll into p_pApi.
+//. Returns false and the first missing symbol name in p_ppszMissing when one cannot be found.
+bool face_sdk_api_load(MiModule p_hDll, FaceSdkApi* p_pApi, const char** p_ppszMissing = NULL);
+
+//. Resolves p_hDll into a new table and publishes it as face_sdk_api(); nothing is published
+//. when a symbol is missing. Serialized, and a no-op when p_hDll is already the published module.
+bool face_sdk_api_publish(MiModule p_hDll, const char** p_ppszMissing = NULL);
+
+//. Publishes g_hFaceDll again when setting_init has reloaded it.
+bool face_sdk_api_refresh();
+
+//. Version of the loaded SDK library ("1.2.3.4"), empty when it carries none (mi_module_version).
+//. The C API has no version call of its own.
+std::string face_sdk_version();
@@ -1,40 +1,281 @@
 
 #include <fstream>
 #include "MIServer.h"
-#include <facesdk/FaceSDK_C_Api.h>
+#include "FaceSdkApi.h"
+#include "MiAdmission.h"
+#include "MiAnalyze.h"
+#include "MiAudit.h"
+#include "MiBackend.h"
+#include "MiBatcher.h"
+#include "MiCamera.h"
+#include "MiCapture.h"
+#include "MiCost.h"
+#include "MiCluster.h"
+#include "MiCoalesce.h"
+#include "MiCodecs.h"
+#include "MiDecode.h"
+#include "MiDetect.h"
+#include "MiDevice.h"
+#include "MiExecutor.h"
+#include "MiFaceCrop.h"
+#include "MiFaces.h"
+#include "MiGate.h"
+#include "MiDedup.h"
+#include "MiHash.h"
+#include "MiResultJson.h"
+#include "MiResultStream.h"
+#include "MiInference.h"
+#include "MiJobs.h"
+#include "MiJsonScan.h"
+#include "MiLanes.h"
+#include "MiLicense.h"
+#include "MiLimiter.h"
+#include "MiMemBudget.h"
+#include "MiMetrics.h"
+#include "MiModelMap.h"
+#include "MiMsgBuffers.h"
+#include "MiMultipart.h"
+#include "MiOnboard.h"
+#include "MiOtlp.h"
+#include "MiRequestProfile.h"
+#include "MiSession.h"
+#include "Poco/NumberParser.h"
+#include "MiPhash.h"
+#include "MiPipelinePool.h"
+#include "MiPrecision.h"
+#include "MiPixelPool.h"
+#include "MiProfile.h"
+#include "MiLock.h"
+#include "MiIdle.h"
+#include "MiSaturation.h"
+#include "MiBrownout.h"
+#include "MiBurst.h"
+#include "MiFetch.h"
+#include "MiProgressive.h"
+#include "MiQuality.h"
+#include "MiRedis.h"
+#include "MiResultCache.h"
+#include "MiSdkCall.h"
+#include "MiShadow.h"
+#include "MiShm.h"
+#include "MiStages.h"
+#include "MiSettings.h"
+#include "MiStartup.h"
+#include "MiSupervisor.h"
+#include "MiValidation.h"
+#include "MiVerdict.h"
+#include "MiVerdictBatch.h"
+#include "MiVideo.h"
+#include "MiWarmup.h"
+#include "MiWatchdog.h"
 #include "licenseproc.h"
 
-#ifdef WIN64
-#include <windows.h>
-#else
-#include <ctime>
-#endif
+#include "MiPlatform.h"
 
 uint64_t getMilliseconds() {
-#ifdef WIN64
-	return GetTickCount64();
-#else
-	struct timespec ts;
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-#endif
+	return mi_tick_ms();
 }
 
-typedef CPipeline_t* (*pipeline_create_t)(const char* name, const CInitConfig_t* config, int* err, char* msg);
-typedef void (*pipeline_destroy_t)(CPipeline_t* engine);
-typedef CImage_t* (*image_create_path_t)(const char* path, int* err, char* msg);
-typedef CPipelineResult_t(*pipeline_check_liveness_t)(const CPipeline_t* engine, const CImage_t* image, const CMeta_t* meta, int* err, char* msg);
-typedef void (*image_destroy_t)(CImage_t* image);
-
-extern HMODULE      g_hFaceDll;
+extern MiModule     g_hFaceDll;
 extern CPipeline_t* g_pPipeline;
 
 
 
-ST_RESPONSE* lv_pstRes = NULL;
 #define LD_MAX_TRIAL_COUNT 100
 int lv_nTrialCount = 50 * 2;
 
+POCO_IMPLEMENT_EXCEPTION(TooLargeException, Poco::DataException, "Payload too large")
+POCO_IMPLEMENT_EXCEPTION(FetchException, Poco::IOException, "Image fetch failed")
+
+//. the rest of the body may be unread, the connection is not reused.
+static void send_too_large(HTTPServerResponse& response, const std::string& p_strText)
+{
+	response.setStatus(HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE);
+	mi_headers_apply(response, MI_HEADERS_TEXT);
+	response.setKeepAlive(false);
+	response.sendBuffer(p_strText.data(), p_strText.size());
+}
+
+//. the declared body length, the size hint the readers reserve : a Content-Length past
+//. server.max_body_mb throws TooLargeException before anything is allocated for it.
+static size_t body_length(HTTPServerRequest& request)
+{
+	if (!request.hasContentLength()) return 0;
+	Poco::Int64 nLength = request.getContentLength64();
+	if (nLength < 0) return 0;
+	if ((Poco::UInt64)nLength > (Poco::UInt64)mi_config().maxBodyMb * 1024 * 1024) throw TooLargeException("Content-Length exceeds server.max_body_mb");
+	return (size_t)nLength;
+}
+
+static void check_image_size(const std::string& p_strImage)
+{
+	std::string strWhy;
+	if (!mi_image_allowed((const uint8_t*)p_strImage.data(), p_strImage.size(), strWhy)) throw TooLargeException(strWhy);
+}
+
+//. true once the header was read or GD_IMAGE_SNIFF_MAX_BYTES arrived without one, so an
+//. image over the limits stops the upload as soon as its header is in.
+static bool sniff_image(const std::string& p_strData)
+{
+	ImageInfo info;
+	if (!mi_image_info((const uint8_t*)p_strData.data(), p_strData.size(), info)) return p_strData.size() >= GD_IMAGE_SNIFF_MAX_BYTES;
+	std::string strWhy;
+	if (!mi_image_size_allowed(info.width, info.height, strWhy)) throw TooLargeException(strWhy);
+	return true;
+}
+
+//. multipart upload (MiMultipart.h) : file part i is read into p_fnNext(i), the other
+//. fields into p_pFields (NULL = skipped), the hash of each file part into p_pHashes (NULL =
+//. not hashed). Returns false when a file part found no buffer.
+static bool read_multipart(HTTPServerRequest& request, std::istream& p_in, const std::function<std::string*(size_t)>& p_fnNext, size_t p_nSizeHint,
+	std::map<std::string, std::string>* p_pFields, std::vector<uint64_t>* p_pHashes = NULL)
+{
+	std::string strBoundary, strErr;
+	if (!mi_multipart_boundary(request.getContentType(), strBoundary)) throw Poco::DataFormatException("no boundary in multipart Content-Type");
+	MultipartSink sink;
+	sink.next = p_fnNext;
+	sink.sniff = sniff_image;
+	sink.fields = p_pFields;
+	sink.sizeHint = p_nSizeHint;
+	sink.hashes = p_pHashes;
+	if (!mi_multipart_read(p_in, strBoundary, sink, strErr)) throw Poco::DataFormatException(strErr);
+	return !sink.overflow;
+}
+
+//. a single image upload : the first file part, later ones are skipped.
+static void read_multipart_image(HTTPServerRequest& request, std::istream& p_in, std::string* p_pImage, size_t p_nSizeHint, uint64_t* p_pHash = NULL)
+{
+	std::vector<uint64_t> vHash;
+	read_multipart(request, p_in, [p_pImage](size_t p_nIndex) { return p_nIndex == 0 ? p_pImage : NULL; }, p_nSizeHint, NULL, p_pHash != NULL ? &vHash : NULL);
+	if (p_pHash != NULL && !vHash.empty()) *p_pHash = vHash.front();
+}
+
+//. Body formats of OnProcessImage : the endpoint it is timed as, whether a Content-Encoding
+//. is accepted, and read(), which fills p_pImage with the encoded image or throws, and
+//. p_pHash with its mi_hash64 (ResultCache::make_key), taken while the body was read.
+struct InputMultipart {
+	static const MiEndpoint endpoint = MI_EP_CHECK;
+	static const bool coded = false;
+	static void read(HTTPServerRequest& request, std::istream& p_in, std::string* p_pImage, size_t p_nSizeHint, uint64_t* p_pHash)
+	{
+		read_multipart_image(request, p_in, p_pImage, p_nSizeHint, p_pHash);
+	}
+};
+
+//. {"image":"<base64>"} : the field is decoded while the body streams in, no intermediate
+//. copies and no DOM; a gzip / deflate body is inflated chunk by chunk on the way. The
+//. small string fields next to it stand in for their headers : "calibration" and "os"
+//. (GD_META_CALIBRATION_HEADER / GD_META_OS_HEADER, mi_meta_of) and "request_id"
+//. (GD_REQUEST_ID_HEADER, mi_request_rename); a header or query parameter sent wins.
+struct InputBase64Json {
+	static const MiEndpoint endpoint = MI_EP_CHECK_BASE64;
+	static const bool coded = true;
+	static void read(HTTPServerRequest& request, std::istream& p_in, std::string* p_pImage, size_t p_nSizeHint, uint64_t* p_pHash)
+	{
+		std::string strErr;
+		std::map<std::string, std::string> fields;
+		if (!json_extract_base64_field(p_in, "image", p_pImage, p_nSizeHint, strErr, &fields, p_pHash)) throw Poco::DataFormatException(strErr);
+		if (fields.empty()) return;
+		std::string strValue;
+		auto it = fields.find("calibration");
+		if (it != fields.end() && json_string_value(it->second, strValue) && !request.has(GD_META_CALIBRATION_HEADER)) request.set(GD_META_CALIBRATION_HEADER, strValue);
+		it = fields.find("os");
+		if (it != fields.end() && json_string_value(it->second, strValue) && !request.has(GD_META_OS_HEADER)) request.set(GD_META_OS_HEADER, strValue);
+		it = fields.find("request_id");
+		if (it != fields.end() && json_string_value(it->second, strValue)) mi_request_rename(request, strValue);
+	}
+};
+
+//. the image file itself (Content-Type image/... or application/octet-stream).
+struct InputRaw {
+	static const MiEndpoint endpoint = MI_EP_CHECK_RAW;
+	static const bool coded = true;
+	static void read(HTTPServerRequest&, std::istream& p_in, std::string* p_pImage, size_t p_nSizeHint, uint64_t* p_pHash = NULL)
+	{
+		std::string& out = *p_pImage;
+		out.clear();
+		if (p_nSizeHint > 0) out.reserve(p_nSizeHint);
+		Hash64Stream hash;
+		char buf[16384];
+		while (p_in.read(buf, sizeof(buf)) || p_in.gcount() > 0) {
+			out.append(buf, (size_t)p_in.gcount());
+			if (p_pHash != NULL) hash.update(buf, (size_t)p_in.gcount());
+		}
+		if (p_pHash != NULL) *p_pHash = hash.digest();
+	}
+};
+
+//. {"url":"http://..."} : the server fetches the image itself (MiFetch.h), straight into
+//. the upload buffer; no client upload hop for images already in object storage.
+struct InputUrlJson {
+	static const MiEndpoint endpoint = MI_EP_CHECK_URL;
+	static const bool coded = true;
+	static void read(HTTPServerRequest&, std::istream& p_in, std::string* p_pImage, size_t, uint64_t* p_pHash)
+	{
+		Parser parser;
+		Object::Ptr root = parser.parse(p_in).extract<Object::Ptr>();
+		std::string strUrl = root->optValue<std::string>("url", "");
+		if (strUrl.empty()) throw FetchException("missing \"url\"", HTTPResponse::HTTP_BAD_REQUEST);
+		std::string strErr;
+		switch (mi_fetch(strUrl, p_pImage, strErr)) {
+		case MI_FETCH_OK: break;
+		case MI_FETCH_DENIED: throw FetchException(strErr, HTTPResponse::HTTP_FORBIDDEN);
+		case MI_FETCH_TOO_LARGE: throw TooLargeException(strErr);
+		case MI_FETCH_TIMEOUT: throw FetchException(strErr, HTTPResponse::HTTP_GATEWAY_TIMEOUT);
+		default: throw FetchException(strErr, HTTPResponse::HTTP_BAD_GATEWAY);
+		}
+		//. the fetch fills the buffer out of sight, hashed in one pass after it.
+		*p_pHash = mi_hash64(p_pImage->data(), p_pImage->size());
+	}
+};
+
+//. records on the request the image it hands the SDK, for the micro-batcher's [batch] dedup :
+//. p_nWidth > 0 for decoded pixels, hashed here, 0 for the upload itself (p_nHash).
+static void submit_image(const uint8_t* p_pData, size_t p_nLen, int p_nWidth, uint64_t p_nHash)
+{
+	RequestContext* ctx = mi_context();
+	if (ctx == NULL) return;
+	if (g_pBatcher == NULL || !g_Settings.batchDedup) {
+		ctx->imageSize = 0;
+		return;
+	}
+	ctx->imageHash = p_nWidth > 0 ? mi_hash64(p_pData, p_nLen, (uint64_t)p_nWidth) : p_nHash;
+	ctx->imageSize = p_nWidth > 0 ? (uint64_t)p_nLen | MI_IMAGE_PIXELS : (uint64_t)p_nLen;
+	mi_digest256(p_pData, p_nLen, ctx->imageDigest);
+}
+
+//. near-duplicate lookup of a face crop (MiPhash.h) : marks the response of a near repeat and,
+//. with mode = reuse, returns true with the earlier verdict. p_pHash receives the crop's hash.
+//. the result variant of the request and its tenant : near repeats are only looked for among
+//. the same tenant's uploads checked the same way.
+static uint64_t phash_variant(const CMeta_t* p_pMeta)
+{
+	RequestContext* ctx = mi_context();
+	return mi_result_variant(p_pMeta) | ((uint64_t)(ctx != NULL ? ctx->tenant + 1 : 0) << 48);
+}
+
+static bool phash_lookup(const CropFrame& p_crop, bool p_bRgb, uint64_t p_nVariant, CPipelineResult_t* p_pResult, uint64_t* p_pHash)
+{
+	*p_pHash = mi_phash_bgr(p_crop.pixels.data(), p_crop.width, p_crop.height, (size_t)p_crop.width * 3, p_bRgb);
+	int nDistance = 0;
+	CPipelineResult_t near;
+	if (!mi_phash_find(*p_pHash, p_nVariant, &near, &nDistance)) {
+		mi_metrics_phash(MI_PHASH_MISS);
+		return false;
+	}
+	RequestContext* ctx = mi_context();
+	if (ctx != NULL) ctx->nearDistance = nDistance;
+	//. a re-capture, screen replay or print of a genuine selfie is a near repeat of it : only
+	//. rejections are reused, a genuine one is checked again.
+	if (!mi_phash_reuse() || mi_verdict_of(mi_verdict_policy(), near, OK) == MI_VERDICT_GENUINE) {
+		mi_metrics_phash(MI_PHASH_FLAGGED);
+		return false;
+	}
+	mi_metrics_phash(MI_PHASH_REUSED);
+	*p_pResult = near;
+	return true;
+}
+
 std::string replaceAll(std::string original, const std::string& search, const std::string& replace) {
 	size_t pos = 0;
 	while ((pos = original.find(search, pos)) != std::string::npos) {
@@ -44,270 +285,2624 @@ std::string replaceAll(std::string original, const std::string& search, const st
 	return original;
 }
 
-// Critical section object
-CRITICAL_SECTION g_cs;
+void mi_services_start()
+{
+	//. first read inline, then the refresher keeps the snapshot current.
+	g_License.refresh();
+	g_License.start((unsigned int)std::max(g_Settings.licenseMaxPollSec, 1) * 1000, (unsigned int)std::max(g_Settings.licenseBackoffMinMs, 0),
+		(unsigned int)std::max(g_Settings.licenseBackoffMaxMs, 0), (unsigned int)std::max(g_Settings.licenseGraceSec, 0) * 1000);
+	mi_startup_phase("license");
 
-unsigned int TF_READ_LIC(void*) {
-	INT64 nSts = 0;
-	ST_RESPONSE* p = (ST_RESPONSE*)malloc(sizeof(ST_RESPONSE));
+	if (g_Settings.tenantsEnable) {
+		mi_tenants_init(g_Settings.tenantsRequireKey, g_Settings.tenantsDefaultRate, g_Settings.tenantsDefaultBurst, g_Settings.tenantsDefaultConcurrency, g_Settings.tenantsList);
+	}
+	mi_meta_init(g_Settings.metaDefault, g_Settings.metaTenants);
+	//. the first configuration snapshot, once the tenants its tables are indexed by exist.
+	mi_config_publish(g_Settings);
+	mi_validation_init(g_Settings.validationProfiles, g_Settings.validationTenants);
+	mi_shm_init(g_Settings.shmEnable);
+	mi_compress_init(g_Settings.compressEnable, g_Settings.compressMinBytes, g_Settings.compressLevel);
+	mi_headers_init(g_Settings.corsAllowOrigin, g_Settings.corsAllowHeaders, g_Settings.corsMaxAgeSec);
+	mi_pixel_pool_init(g_Settings.pixelPoolEnable, (size_t)g_Settings.pixelPoolMaxMb * 1024 * 1024, g_Settings.pixelPoolIdleSec, g_Settings.pixelPoolLargePages);
 
-	InitializeCriticalSection(&g_cs);
+	//. owns g_pPipeline from here on and repairs license errors in the background.
+	g_Supervisor.start();
 
-	while (TRUE)
-	{
-		Sleep(10 * 1000);
+	//. elastic : max_size slots, pool.size of them loaded now.
+	bool bElastic = g_Settings.poolElastic && !g_Settings.poolShared && g_Settings.poolMaxSize > g_Settings.poolSize;
+	if (g_Settings.poolElastic && !bElastic) cout << "pool.elastic needs pool.max_size above pool.size and pool.shared off, fixed pool" << endl;
+	int nPoolSlots = bElastic ? g_Settings.poolMaxSize : g_Settings.poolSize;
+	if (nPoolSlots > 1) {
+		std::string strPoolErr;
+		g_pPool = new PipelinePool;
+		if (g_pPool->create(nPoolSlots, g_Settings.poolEngineThreads, g_Settings.poolCoresPerSlot, g_Settings.poolShared, strPoolErr, bElastic ? g_Settings.poolSize : 0) == false) {
+			cout << "Pipeline pool creation failed : " << strPoolErr << endl;
+			delete g_pPool;
+			g_pPool = NULL;
+		}
+		else if (bElastic) {
+			PoolElastic elastic;
+			elastic.minSlots = g_Settings.poolSize;
+			elastic.maxSlots = g_Settings.poolMaxSize;
+			elastic.waitMs = g_Settings.poolElasticWaitMs;
+			elastic.idleSec = g_Settings.poolElasticIdleSec;
+			elastic.spares = g_Settings.poolElasticSpares;
+			g_pPool->elastic_start(elastic);
+		}
+	}
+	mi_startup_phase("pipeline_pool");
+
+	if (g_Settings.watchdogEnable) {
+		WatchdogSettings watchdog;
+		watchdog.decodeMs = g_Settings.watchdogDecodeMs;
+		watchdog.queueMs = g_Settings.watchdogQueueMs;
+		watchdog.livenessMs = g_Settings.watchdogLivenessMs;
+		watchdog.threads = g_Settings.watchdogThreads;
+		mi_watchdog_init(watchdog);
+	}
+
+	if (g_Settings.executorEnable) {
+		int nEngine = g_Settings.poolEngineThreads > 0 ? g_Settings.poolEngineThreads : g_Settings.numThreadsEngine;
+		g_pExecutor = new Executor(mi_executor_threads(g_Settings.executorThreads, nEngine, g_pPool != NULL ? g_pPool->size() : 1));
+		g_pExecutor->start();
+	}
+	if (g_Settings.limiterEnable) {
+		mi_limiter_init(g_Settings.limiterMin, g_Settings.limiterMax, g_Settings.limiterInitial, g_Settings.limiterWindowMs);
+	}
+	if (g_Settings.stagesEnable) {
+		//. classic mode sends from the Poco threads.
+		int nSend = mi_settings_worker_pool() ? g_Settings.stagesSendThreads : 0;
+		mi_stages_start(g_Settings.stagesInferThreads, g_Settings.stagesInferQueue, nSend, g_Settings.stagesSendQueue);
+	}
 
-		memset(p, 0, sizeof(ST_RESPONSE));
-		p->m_nProduct = GD_PRODUCT_LIVENESS_FACE;
-		if ((nSts = mil_read_license(p)) <= 0) {
-			if (lv_pstRes != NULL) free(lv_pstRes);
-			lv_pstRes = NULL;
+	if (g_Settings.cropEnable) {
+		CropSettings crop;
+		crop.margin = (float)g_Settings.cropMargin;
+		crop.targetSize = g_Settings.cropTargetSize;
+		crop.minImageSide = g_Settings.cropMinImageSide;
+		crop.detectSide = g_Settings.cropDetectSide;
+		crop.detectors = g_Settings.cropDetectors;
+		crop.detector = g_Settings.cropDetector;
+		std::string strCropErr;
+		if (!mi_crop_init(g_Settings.configDir, g_Settings.configName, crop, strCropErr)) {
+			cout << "Face crop disabled : " << strCropErr << endl;
 		}
-		else {
-			if (lv_pstRes == NULL) {
-				lv_pstRes = (ST_RESPONSE*)malloc(sizeof(ST_RESPONSE));
-			}
-			memcpy(lv_pstRes, p, sizeof(ST_RESPONSE));
+	}
+	if (g_Settings.facesEnable) {
+		mi_faces_init(true, g_Settings.facesMax);
+		if (!mi_faces_enabled()) cout << "Faces disabled : needs [crop] enable" << endl;
+	}
+
+	if (g_Settings.decodeEnable) mi_decode_init(g_Settings.decodeTargetSide, g_Settings.decodeUpright);
+	mi_codecs_init(g_Settings.decodeFormats);
+
+	if (g_Settings.gateEnable) {
+		GateSettings gate;
+		gate.maxFaces = g_Settings.gateMaxFaces;
+		gate.minQuality = (float)g_Settings.gateMinQuality;
+		gate.engines = g_Settings.gateEngines;
+		gate.detector = g_Settings.gateDetector;
+		gate.quality = g_Settings.gateQuality;
+		std::string strGateErr;
+		if (!mi_gate_init(g_Settings.configDir, g_Settings.configName, gate, strGateErr)) {
+			cout << "Gate disabled : " << strGateErr << endl;
 		}
 	}
-	free(p); // Clean up allocated memory
-	DeleteCriticalSection(&g_cs);
 
-}
+	//. before [analyze] switches the occlusion / closed-eyes models on.
+	if (g_Settings.detectEnable) {
+		DetectSettings detect;
+		detect.engines = g_Settings.detectEngines;
+		detect.detector = g_Settings.detectDetector;
+		detect.lazy = g_Settings.detectLazy;
+		detect.idleEvictMs = g_Settings.detectIdleEvictS * 1000;
+		std::string strDetectErr;
+		if (!mi_detect_init(g_Settings.configDir, g_Settings.configName, detect, strDetectErr)) {
+			cout << "Detect disabled : " << strDetectErr << endl;
+		}
+	}
 
-void ClaHTTPServerWrapper::launch() {
-	
-	if (lv_pstRes == NULL) {
-		lv_pstRes = (ST_RESPONSE*)malloc(sizeof(ST_RESPONSE));
-		lv_pstRes->m_nProduct = GD_PRODUCT_LIVENESS_FACE;
-		if (mil_read_license(lv_pstRes) <= 0) {
-			free(lv_pstRes);
-			lv_pstRes = NULL;
+	if (g_Settings.qualityEnable) {
+		QualitySettings quality;
+		quality.engines = g_Settings.qualityEngines;
+		quality.engine = g_Settings.qualityEngine;
+		quality.lazy = g_Settings.qualityLazy;
+		quality.idleEvictMs = g_Settings.qualityIdleEvictS * 1000;
+		std::string strQualityErr;
+		if (!mi_quality_init(g_Settings.configDir, g_Settings.configName, quality, strQualityErr)) {
+			cout << "Quality disabled : " << strQualityErr << endl;
+		}
+	}
+	if (g_Settings.burstEnable) {
+		BurstSettings burst;
+		burst.topK = g_Settings.burstTopK;
+		burst.sizeWeight = g_Settings.burstSizeWeight;
+		burst.faceSize = g_Settings.burstFaceSize;
+		burst.fused = g_Settings.burstFused;
+		mi_burst_init(true, burst);
+		if (!mi_burst_enabled()) cout << "Burst disabled : needs [quality] enable" << endl;
+	}
+	if (g_Settings.onboardEnable) {
+		mi_onboard_init(true);
+		if (!mi_onboard_enabled()) cout << "Onboarding disabled : needs [quality] enable" << endl;
+	}
+	if (g_Settings.videoEnable) {
+		VideoSettings video;
+		video.keyframes = g_Settings.videoSampling != "every_n";
+		video.everyN = g_Settings.videoEveryN;
+		video.intervalMs = g_Settings.videoIntervalMs;
+		video.maxFrames = g_Settings.videoMaxFrames;
+		video.maxSeconds = g_Settings.videoMaxSeconds;
+		video.hardware = g_Settings.videoHardware;
+		std::string strVideoErr;
+		if (!mi_video_init(true, video, strVideoErr)) cout << "Video disabled : " << strVideoErr << endl;
+	}
+
+	if (g_Settings.analyzeEnable) {
+		AnalyzeSettings analyze;
+		analyze.engines = g_Settings.analyzeEngines;
+		analyze.detector = g_Settings.analyzeDetector;
+		analyze.occlusion = g_Settings.analyzeOcclusion;
+		analyze.closedEyes = g_Settings.analyzeClosedEyes;
+		analyze.brownoutEngines = g_Settings.brownoutEnable ? g_Settings.brownoutAnalyzeEngines : 0;
+		std::string strAnalyzeErr;
+		if (!mi_analyze_init(g_Settings.configDir, g_Settings.configName, analyze, strAnalyzeErr)) {
+			cout << "Analyze disabled : " << strAnalyzeErr << endl;
+		}
+	}
+
+	mi_startup_phase("engines");
+
+	std::string strBackendErr;
+	g_pBackend = mi_backend_create(g_Settings.backendEngine, strBackendErr);
+	if (g_pBackend == NULL) {
+		cout << "Backend " << g_Settings.backendEngine << " unavailable : " << strBackendErr << ", using legacy" << endl;
+		g_pBackend = mi_backend_create("legacy", strBackendErr);
+	}
+	if (g_Settings.deviceGpu) {
+		DeviceSettings device;
+		device.gpuConfig = g_Settings.deviceGpuConfig;
+		device.gpuPipelines = g_Settings.deviceGpuPipelines;
+		device.gpuMinBatch = g_Settings.deviceGpuMinBatch;
+		device.gpuMaxQueue = g_Settings.deviceGpuMaxQueue;
+		device.cpuBusy = g_Settings.deviceCpuBusy;
+		device.gpuLazy = g_Settings.deviceGpuLazy;
+		device.gpuIdleEvictMs = g_Settings.deviceGpuIdleEvictS * 1000;
+		std::string strDeviceErr;
+		InferenceBackend* pDispatch = mi_device_create(g_pBackend, device, strDeviceErr);
+		if (pDispatch != NULL) g_pBackend = pDispatch;
+		else cout << "GPU pipelines unavailable : " << strDeviceErr << ", CPU only" << endl;
+	}
+
+	if (g_Settings.precisionEnable) {
+		std::string strPrecisionErr;
+		g_pBackend = mi_precision_backend(g_pBackend, g_Settings.precisionModes, g_Settings.precisionTenants, strPrecisionErr);
+		if (!strPrecisionErr.empty()) cout << "Precision pools disabled : " << strPrecisionErr << endl;
+	}
+	if (g_Settings.shadowEnable) {
+		ShadowSettings shadow;
+		shadow.engine = g_Settings.shadowEngine;
+		shadow.samplePercent = g_Settings.shadowSamplePercent;
+		shadow.queue = g_Settings.shadowQueue;
+		shadow.blueprint = mi_blueprint_settings();
+		shadow.blueprint.cascadePipeline.clear();		//. compares whole pipelines
+		if (!g_Settings.shadowDataDir.empty()) shadow.blueprint.dataDir = g_Settings.shadowDataDir;
+		if (!g_Settings.shadowPipeline.empty()) shadow.blueprint.pipeline = g_Settings.shadowPipeline;
+		if (!g_Settings.shadowProfile.empty()) shadow.blueprint.profile = g_Settings.shadowProfile == "default" ? "" : g_Settings.shadowProfile;
+		if (!g_Settings.shadowParameters.empty()) shadow.blueprint.parameters = g_Settings.shadowParameters;
+		if (g_Settings.shadowCpuCores > 0) shadow.blueprint.cpuCores = g_Settings.shadowCpuCores;
+		if (g_Settings.shadowWorkerThreads > 0) shadow.blueprint.workerThreads = g_Settings.shadowWorkerThreads;
+		if (g_Settings.shadowThreads > 0) shadow.blueprint.backendThreads = g_Settings.shadowThreads;
+		if (g_Settings.shadowInvocations > 0) shadow.blueprint.backendInvocations = g_Settings.shadowInvocations;
+		std::string strShadowErr;
+		g_pBackend = mi_shadow_backend(g_pBackend, shadow, strShadowErr);
+		if (!strShadowErr.empty()) cout << "Shadow disabled : " << strShadowErr << endl;
+	}
+
+	if (g_Settings.memoryBudgetMb > 0) {
+		mi_membudget_init((size_t)g_Settings.memoryBudgetMb * 1024 * 1024);
+		g_pBackend = mi_membudget_backend(g_pBackend);
+	}
+	//. outermost : a rejected image takes no memory permit and reaches no shadow.
+	if (g_Settings.prefilterEnable) {
+		g_pBackend = mi_prefilter_backend(g_pBackend);
+		cout << "Prefilter : gray side " << g_Settings.prefilterSide << ", min sharpness " << g_Settings.prefilterMinSharpness
+			<< ", dark " << g_Settings.prefilterDarkPercent << " % below " << g_Settings.prefilterDarkLevel << ", audit " << g_Settings.prefilterAuditPercent << " %" << endl;
+	}
+	mi_startup_phase("backend");
+	mi_model_map_report();
+
+	mi_cost_init(g_Settings.costEnable, g_Settings.costHeader);
+	mi_request_profile_init(g_Settings.requestProfileEnable, g_Settings.requestProfileAdminKey);
+	if (g_Settings.metricsEnable) mi_metrics_init(g_Settings.metricsStageCpu);
+	//. always : the core records the /metrics histograms and counters as well.
+	mi_stats_init(g_Settings.statsSlotSec);
+	if (g_Settings.statsAllocations && !GD_ALLOC_COUNT) cout << "stats.allocations needs a build with MI_ALLOC_COUNT, allocation counting off" << endl;
+	mi_alloc_count_init(g_Settings.statsAllocations);
+	BackendRuntime runtime = g_pBackend->runtime();
+	mi_metrics_backend(g_pBackend->name(), runtime.profile, runtime.workerThreads, runtime.backendThreads, runtime.backendInvocations);
+	mi_trace_init(g_Settings.traceSampleEvery, g_Settings.traceFollowParent);
+	if (!g_Settings.traceOtlpEndpoint.empty()) {
+		OtlpSettings otlp;
+		otlp.endpoint = g_Settings.traceOtlpEndpoint;
+		otlp.service = g_Settings.traceOtlpService;
+		otlp.batch = g_Settings.traceOtlpBatch;
+		otlp.intervalMs = g_Settings.traceOtlpIntervalMs;
+		otlp.queue = g_Settings.traceOtlpQueue;
+		std::string strOtlpErr;
+		if (!mi_otlp_start(otlp, strOtlpErr)) cout << "OTLP export disabled : " << strOtlpErr << endl;
+	}
+	mi_image_limits_init(g_Settings.maxImageSide, g_Settings.maxImageMpix, g_Settings.minImageSide);
+	if (g_Settings.accessLogEnable) {
+		AccessLogSettings access;
+		access.path = g_Settings.accessLogPath;
+		access.rotation = g_Settings.accessLogRotation;
+		access.purgeCount = g_Settings.accessLogPurgeCount;
+		access.sampleEvery = g_Settings.accessLogSampleEvery;
+		access.errors = g_Settings.accessLogErrors;
+		access.summarySec = g_Settings.accessLogSummarySec;
+		std::string strAccessErr;
+		if (!mi_access_log_init(access, strAccessErr)) cout << "Access log disabled : " << strAccessErr << endl;
+	}
+	if (g_Settings.captureEnable) {
+		CaptureSettings capture;
+		capture.path = g_Settings.capturePath;
+		capture.sampleEvery = g_Settings.captureSampleEvery;
+		capture.body = g_Settings.captureBody;
+		capture.maxBodyKb = g_Settings.captureMaxBodyKb;
+		capture.maxMb = g_Settings.captureMaxMb;
+		capture.queueMb = g_Settings.captureQueueMb;
+		capture.redact = g_Settings.captureRedact;
+		std::string strCaptureErr;
+		if (!mi_capture_init(capture, strCaptureErr)) cout << "Capture disabled : " << strCaptureErr << endl;
+	}
+	if (g_Settings.auditEnable) {
+		AuditSettings audit;
+		audit.sink = g_Settings.auditSink;
+		audit.connect = g_Settings.auditConnect;
+		audit.table = g_Settings.auditTable;
+		audit.batchRows = g_Settings.auditBatchRows;
+		audit.flushMs = g_Settings.auditFlushMs;
+		audit.queueRows = g_Settings.auditQueueRows;
+		audit.sdkVersion = face_sdk_version();
+		std::string strAuditErr;
+		if (!mi_audit_init(audit, strAuditErr)) cout << "Audit database not reachable yet : " << strAuditErr << endl;
+	}
+
+	int nConcurrency = g_Settings.admissionConcurrency;
+	if (nConcurrency <= 0) nConcurrency = mi_settings_worker_pool() ? g_Settings.inferenceWorkers : g_Settings.maxThreads;
+	if (g_Settings.admissionEnable) mi_admission_init(nConcurrency, g_Settings.admissionMaxWaitMs, g_Settings.admissionDefaultDeadlineMs);
+	if (g_Settings.brownoutEnable && !g_Settings.saturationEnable) cout << "Brownout disabled : needs [saturation] enable" << endl;
+	mi_brownout_init(g_Settings.brownoutEnable && g_Settings.saturationEnable, g_Settings.brownoutEnter, g_Settings.brownoutExit,
+		g_Settings.brownoutHoldSec, g_Settings.brownoutBatchWaitMs);
+	mi_saturation_init(g_Settings.saturationEnable, nConcurrency, g_Settings.saturationSloMs, g_Settings.saturationWindowSec);
+	mi_context_init(g_Settings.admissionEnable ? g_Settings.admissionDegradeMs : 0, g_Settings.cancelOnDisconnect);
+
+	if (g_Settings.lanesEnable) {
+		mi_lanes_init(g_Settings.laneWeightInteractive, g_Settings.laneWeightBulk, g_Settings.laneBulkKeys);
+		//. reactor and proactor modes schedule the lanes in their worker pool.
+		if (!mi_settings_worker_pool()) {
+			int nPermits = g_Settings.lanePermits;
+			if (nPermits <= 0) nPermits = (g_pPool != NULL ? g_pPool->size() : 1) * (g_Settings.batchEnable ? g_Settings.batchMaxSize : 1);
+			g_pLaneGate = new LaneGate(nPermits);
+		}
+	}
+
+	if (g_Settings.cacheEnable && g_Settings.cacheMaxMb > 0 && g_Settings.cacheTtlSec > 0) {
+		g_pResultCache = new ResultCache((size_t)g_Settings.cacheMaxMb * 1024 * 1024, g_Settings.cacheTtlSec, g_Settings.cacheShards);
+	}
+	mi_coalesce_init(g_Settings.cacheCoalesce);
+	if (g_Settings.sessionEnable && g_Settings.sessionFrames > 0 && g_Settings.sessionTtlSec > 0) {
+		g_pSessionStore = new SessionStore((size_t)g_Settings.sessionMaxMb * 1024 * 1024, g_Settings.sessionMaxSessions, g_Settings.sessionTtlSec,
+			std::max(g_Settings.sessionMaxFrames, g_Settings.sessionFrames), g_Settings.sessionShards);
+	}
+	//. the hashes come from the face crop, nothing to index without it.
+	if (g_Settings.phashEnable && !g_Settings.cropEnable) cout << "phash.enable needs crop.enable, near-duplicate index off" << endl;
+	mi_phash_init(g_Settings.phashEnable && g_Settings.cropEnable, g_Settings.phashMode == "reuse", g_Settings.phashMaxDistance, (size_t)(g_Settings.phashMaxEntries > 0 ? g_Settings.phashMaxEntries : 0), g_Settings.phashTtlSec);
+
+	if (g_Settings.redisEnable) {
+		std::string strRedisErr;
+		if (!mi_redis_init(g_Settings.redisHost, g_Settings.redisPort, g_Settings.redisPool, g_Settings.redisTimeoutMs, g_Settings.redisPrefix, strRedisErr)) {
+			cout << "Redis " << g_Settings.redisHost << ":" << g_Settings.redisPort << " not reachable yet : " << strRedisErr << endl;
 		}
 	}
 
-	DWORD dwTID = 0;
-	CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)TF_READ_LIC, NULL, 0, &dwTID);
+	if (g_Settings.batchEnable) {
+		g_pBatcher = new LivenessBatcher(g_Settings.batchMaxSize, g_Settings.batchMaxWaitMs, g_Settings.batchWorkers,
+			g_Settings.batchAdaptive, g_Settings.batchP99Ms, g_Settings.batchAdaptMs, g_Settings.batchBuckets,
+			g_Settings.batchOrder == "edf", g_Settings.batchStarveMs);
+		g_pBatcher->start();
+	}
+	if (g_Settings.fetchEnable) {
+		FetchSettings fetch;
+		fetch.hosts = g_Settings.fetchHosts;
+		fetch.maxMb = g_Settings.fetchMaxMb;
+		fetch.timeoutMs = g_Settings.fetchTimeoutMs;
+		fetch.keepAlive = g_Settings.fetchKeepAlive;
+		fetch.idleSec = g_Settings.fetchIdleSec;
+		if (fetch.hosts.empty()) cout << "Fetch : fetch.hosts is empty, every URL is refused" << endl;
+		mi_fetch_init(true, fetch);
+	}
+	//. after the pools and caches it trims.
+	mi_idle_init(g_Settings.idleEnable, g_Settings.idleAfterSec, g_Settings.idlePoolKeep);
+	mi_startup_phase("services");
+}
+
+void ClaHTTPServerWrapper::launch() {
+
+	mi_router_init();
+	mi_services_start();
+	//. runs while the server starts listening, GD_API_READY reports when it is done.
+	mi_warmup_start();
+	mi_health_start();
+	if (g_Settings.clusterEnable) {
+		ClusterSettings cluster;
+		cluster.transport = g_Settings.clusterTransport;
+		cluster.node = g_Settings.clusterNode;
+		cluster.peers = g_Settings.clusterPeers;
+		cluster.intervalMs = g_Settings.clusterIntervalMs;
+		cluster.slots = g_Settings.admissionConcurrency;
+		if (cluster.slots <= 0) cluster.slots = mi_settings_worker_pool() ? g_Settings.inferenceWorkers : g_Settings.maxThreads;
+		cluster.device = g_Settings.deviceGpu ? "gpu" : "cpu";
+		cluster.engine = g_Settings.backendEngine;
+		std::string strClusterErr;
+		if (!mi_cluster_start(cluster, strClusterErr)) cout << "Cluster announcements disabled : " << strClusterErr << endl;
+	}
+	if (g_Settings.jobsEnable) {
+		std::string strJobsErr;
+		if (!mi_jobs_start(strJobsErr)) cout << "Jobs disabled : " << strJobsErr << endl;
+	}
+	if (g_Settings.cameraEnable) {
+		CameraSettings camera;
+		camera.urls = g_Settings.cameraUrls;
+		camera.webhook = g_Settings.cameraWebhook;
+		camera.intervalMs = g_Settings.cameraIntervalMs;
+		camera.side = g_Settings.cameraSide;
+		camera.minQuality = (float)g_Settings.cameraMinQuality;
+		camera.cooldownMs = g_Settings.cameraCooldownMs;
+		camera.reconnectMs = g_Settings.cameraReconnectMs;
+		camera.hardware = g_Settings.cameraHardware;
+		camera.prefilter.side = g_Settings.prefilterSide;
+		camera.prefilter.minSharpness = g_Settings.prefilterMinSharpness;
+		camera.prefilter.darkLevel = g_Settings.prefilterDarkLevel;
+		camera.prefilter.darkPercent = g_Settings.prefilterDarkPercent;
+		std::string strCameraErr;
+		if (!mi_camera_start(camera, strCameraErr)) cout << "Camera disabled : " << strCameraErr << endl;
+	}
 	run();
+	mi_camera_stop();
+	mi_jobs_stop();
+	mi_cluster_stop();
+	mi_health_stop();
+	mi_warmup_stop();
+	mi_services_stop();
+}
+
+void mi_services_stop()
+{
+	mi_idle_shutdown();
+	mi_fetch_shutdown();
+	mi_saturation_shutdown();
+	mi_redis_shutdown();
+	mi_shm_shutdown();
+
+	if (g_pBatcher != NULL) {
+		g_pBatcher->stop();
+		delete g_pBatcher;
+		g_pBatcher = NULL;
+	}
+	delete g_pBackend;
+	g_pBackend = NULL;
+	mi_stages_stop();
+	if (g_pExecutor != NULL) {
+		g_pExecutor->stop();
+		delete g_pExecutor;
+		g_pExecutor = NULL;
+	}
+	mi_crop_shutdown();
+	mi_video_shutdown();
+	mi_gate_shutdown();
+	mi_pixel_pool_shutdown();
+	mi_analyze_shutdown();
+	mi_detect_shutdown();
+	mi_quality_shutdown();
+	mi_otlp_stop();
+	mi_access_log_shutdown();
+	mi_capture_shutdown();
+	mi_audit_shutdown();
+	mi_stats_shutdown();
+	mi_watchdog_shutdown();
+	if (g_pPool != NULL) {
+		delete g_pPool;
+		g_pPool = NULL;
+	}
+	if (g_pResultCache != NULL) {
+		delete g_pResultCache;
+		g_pResultCache = NULL;
+	}
+	if (g_pLaneGate != NULL) {
+		delete g_pLaneGate;
+		g_pLaneGate = NULL;
+	}
+	g_Supervisor.stop();
+	g_License.stop();
+}
+
+static thread_local void* lv_pHandlerBlock = NULL;
+
+void* MyRequestHandler::operator new(size_t p_nSize)
+{
+	void* p = lv_pHandlerBlock;
+	if (p != NULL) {
+		lv_pHandlerBlock = NULL;
+		return p;
+	}
+	return ::operator new(p_nSize);
+}
+
+void MyRequestHandler::operator delete(void* p_pMem)
+{
+	if (p_pMem == NULL) return;
+	if (lv_pHandlerBlock == NULL) {
+		lv_pHandlerBlock = p_pMem;
+		return;
+	}
+	::operator delete(p_pMem);
+}
+
+void mi_router_init()
+{
+	g_Router.add("GET", GD_API_VERSION, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnVersion(req, res); });
+	g_Router.add("POST", GD_API_VERSION, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnVersion(req, res); });
+	g_Router.add("GET", GD_API_STATUS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnStatus(req, res); });
+	g_Router.add("POST", GD_API_STATUS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnStatus(req, res); });
+	g_Router.add("POST", GD_API_FULL_PROCESS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessImage<InputMultipart>(req, res); });
+	g_Router.add("POST", GD_API_FULL_PROCESS_BASE64, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessImage<InputBase64Json>(req, res); });
+	g_Router.add("POST", GD_API_FULL_PROCESS_URL, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessImage<InputUrlJson>(req, res); });
+	g_Router.add("POST", GD_API_FULL_PROCESS_RAW, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessImage<InputRaw>(req, res); });
+	g_Router.add("POST", GD_API_BATCH, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessBatch(req, res); });
+	g_Router.add("GET", GD_API_METRICS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { mi_metrics_handle(req, res); });
+	g_Router.add("GET", GD_API_STATS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnStats(req, res); });
+	g_Router.add("GET", GD_API_TRACE, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnTrace(req, res); });
+	g_Router.add("GET", GD_API_PROFILE, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnProfile(req, res); });
+	g_Router.add("GET", GD_API_LOCKS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnLocks(req, res); });
+	g_Router.add("GET", GD_API_SATURATION, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnSaturation(req, res); });
+	g_Router.add("GET", GD_API_CACHE_STATS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnCacheStats(req, res); });
+	g_Router.add("GET", GD_API_READY, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnReady(req, res); });
+	g_Router.add("GET", GD_API_HEALTH, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnHealth(req, res); });
+	g_Router.add("GET", GD_API_ADMIN_RELOAD, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnReload(req, res); });
+	g_Router.add("POST", GD_API_ADMIN_RELOAD, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnReload(req, res); });
+	g_Router.add("GET", GD_API_ADMIN_CONFIG, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnConfig(req, res); });
+	g_Router.add("POST", GD_API_ADMIN_CONFIG, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnConfig(req, res); });
+	g_Router.add("POST", GD_API_SEQUENCE, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessSequence(req, res); });
+	g_Router.add("POST", GD_API_BURST, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessBurst(req, res); });
+	g_Router.add("POST", GD_API_FACES, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessFaces(req, res); });
+	g_Router.add("POST", GD_API_ONBOARD, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessOnboard(req, res); });
+	g_Router.add("POST", GD_API_VIDEO, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessVideo(req, res); });
+	g_Router.add("POST", GD_API_SESSION, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessSession(req, res); });
+	g_Router.add("GET", GD_API_STREAM, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (tt.admitted()) h.OnStream(req, res); });
+	g_Router.add("POST", GD_API_SHM, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessShm(req, res); });
+	g_Router.add("POST", GD_API_ANALYZE, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnAnalyze(req, res); });
+	g_Router.add("POST", GD_API_DETECT, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (tt.admitted()) h.OnDetect(req, res); });
+	g_Router.add("POST", GD_API_QUALITY, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (tt.admitted()) h.OnQuality(req, res); });
+	g_Router.add("POST", GD_API_JOBS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (tt.admitted()) h.OnJobSubmit(req, res); });
+	g_Router.add("GET", GD_API_JOBS "/*", [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnJobStatus(req, res); });
+	g_Router.add("POST", GD_API_PIXELS, [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { TenantTicket tt(req, res); if (!tt.admitted()) return; AdmissionTicket t(req, res); if (t.admitted()) h.OnProcessPixels(req, res); });
+
+	//. CORS preflight on every API path.
+	const char* szPaths[] = { GD_API_VERSION, GD_API_STATUS, GD_API_FULL_PROCESS, GD_API_FULL_PROCESS_BASE64, GD_API_FULL_PROCESS_RAW, GD_API_FULL_PROCESS_URL, GD_API_BATCH, GD_API_SEQUENCE, GD_API_BURST, GD_API_FACES, GD_API_ONBOARD, GD_API_VIDEO, GD_API_SESSION, GD_API_PIXELS, GD_API_CACHE_STATS, GD_API_READY, GD_API_JOBS, GD_API_ANALYZE, GD_API_DETECT, GD_API_QUALITY };
+	for (size_t i = 0; i < sizeof(szPaths) / sizeof(szPaths[0]); i++) {
+		g_Router.add("OPTIONS", szPaths[i], [](MyRequestHandler& h, HTTPServerRequest& req, HTTPServerResponse& res) { h.OnOptions(req, res); });
+	}
 }
 
 void MyRequestHandler::OnVersion(HTTPServerRequest& request, HTTPServerResponse& response)
 {
 	response.setStatus(HTTPResponse::HTTP_OK);
-	response.setContentType("text/plain");
-
-	response.set("Access-Control-Allow-Origin", "*");
-	response.set("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-	response.set("Access-Control-Allow-Headers", "Content-Type, Authorization");
+	mi_headers_apply(response, MI_HEADERS_TEXT);
 
-	ostream& ostr = response.send();
-	char szOut[MAX_PATH]; memset(szOut, 0, sizeof(szOut));
-	sprintf_s(szOut, "Version : %s\nUpdate : %s", GD_ID_VERSION, GD_ID_UPDATE);
-	ostr << szOut;
+	char szOut[260]; memset(szOut, 0, sizeof(szOut));
+	snprintf(szOut, sizeof(szOut), "Version : %s\nUpdate : %s", GD_ID_VERSION, GD_ID_UPDATE);
+	response.sendBuffer(szOut, strlen(szOut));
 }
-void MyRequestHandler::OnProcessProc(HTTPServerRequest& request, HTTPServerResponse& response, Poco::Dynamic::Var procName, int base64)
+//. per request GD_RESPONSE_SCHEMA_HEADER, else [response] schema, see MiResultJson.h.
+static ResultSchema request_schema(HTTPServerRequest& request)
 {
-	char        msg[MESSAGE_BUFFER_SIZE];
-	int         err = OK;
-	// Get the current time point
-	auto now = std::chrono::system_clock::now();
+	ResultSchema def = mi_result_schema(mi_config().responseSchema, MI_SCHEMA_LEGACY);
+	if (!request.has(GD_RESPONSE_SCHEMA_HEADER)) return def;
+	return mi_result_schema(Poco::toLower(request.get(GD_RESPONSE_SCHEMA_HEADER)), def);
+}
 
-	// Convert the time point to a time_t object
-	std::time_t now_c = std::chrono::system_clock::to_time_t(now);
+//. body encoding of the result (MiResultJson.h) the client's Accept asks for.
+static ResultEncoding request_encoding(HTTPServerRequest& request)
+{
+	return mi_result_encoding(request.get("Accept", HTTPMessage::EMPTY));
+}
 
+template <class Input>
+void MyRequestHandler::OnProcessImage(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(Input::endpoint);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
 #ifdef NDEBUG
-	if (lv_pstRes == NULL || lv_pstRes->m_lExpire < now_c) {
+	if (!g_License.valid()) {
+		//. pick up a newly installed license without waiting for the next poll.
+		g_License.wake();
 		OnNoLicense(request, response); 
 		return;
 	}
 #endif
-	//EnterCriticalSection(&g_cs);
 
-	pipeline_destroy_t pipeline_destroy = (pipeline_destroy_t)(GetProcAddress(g_hFaceDll, "pipeline_destroy"));
-	image_create_path_t image_create_path = (image_create_path_t)(GetProcAddress(g_hFaceDll, "image_create_path"));
-	pipeline_check_liveness_t pipeline_check_liveness = (pipeline_check_liveness_t)(GetProcAddress(g_hFaceDll, "pipeline_check_liveness"));
-	image_destroy_t image_destroy = (image_destroy_t)(GetProcAddress(g_hFaceDll, "image_destroy"));
+	ContentCoding coding = MI_CODING_IDENTITY;
+	if (!mi_request_coding(request, &coding) || (!Input::coded && coding != MI_CODING_IDENTITY)) {
+		response.setStatus(HTTPResponse::HTTP_UNSUPPORTEDMEDIATYPE);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.setKeepAlive(false);
+		const char* pszText = "Unsupported Content-Encoding";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
 
-	std::string FileImage = "";
+	size_t nLength = 0;
+	try {
+		nLength = body_length(request);
+	}
+	catch (const TooLargeException& ex) {
+		send_too_large(response, ex.displayText());
+		return;
+	}
+	PooledBuffer imageBuf(g_BufferPool, nLength);
+	std::string& FileImage = *imageBuf;
+	uint64_t nUploadHash = 0;
+	StageTimer tIngest(MI_STAGE_INGEST);
 	try {
-		if (base64 == 0) {
-			MyPartHandler hPart;
-			Poco::Net::HTMLForm form(request, request.stream(), hPart);
-			Object::Ptr jsonResponse = new Poco::JSON::Object();
-			FileImage = hPart.fileData();
+		//. body bytes past server.max_body_mb (inflated or chunked) end the stream.
+		RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+		try {
+			Input::read(request, body.stream(), imageBuf.get(), nLength, &nUploadHash);
 		}
-		else {
-			std::string encodedImage;
-			std::istream& input = request.stream();
-			std::ostringstream ss;
-			StreamCopier::copyStream(input, ss);
-			std::string data = ss.str();
-
-			Parser parser;
-			auto result = parser.parse(data);
-			Object::Ptr object = result.extract<Object::Ptr>();
-			encodedImage = object->getValue<std::string>("image");
-
-			// Decode Base64
-			std::istringstream istr(encodedImage);
-			Poco::Base64Decoder decoder(istr);
-			std::vector<char> decodedBytes((std::istreambuf_iterator<char>(decoder)), std::istreambuf_iterator<char>());
-
-			// Print decoded bytes as a string (for demonstration purposes)
-			std::string decodedImage(decodedBytes.begin(), decodedBytes.end());
-			FileImage = decodedImage;
+		catch (const Exception&) {
+			if (!body.overflow()) throw;		//. TooLargeException from the part sniffer included
 		}
+		if (body.overflow()) {
+			tIngest.stop();
+			send_too_large(response, "Body exceeds server.max_body_mb");
+			return;
+		}
+	}
+	catch (const TooLargeException& ex)
+	{
+		tIngest.stop();
+		send_too_large(response, ex.displayText());
+		return;
+	}
+	catch (const FetchException& ex)
+	{
+		tIngest.stop();
+		response.setStatus((HTTPResponse::HTTPStatus)ex.code());
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer(ex.message().data(), ex.message().size());
+		return;
 	}
 	catch (const Exception& ex)
 	{
-		FileImage = "";
+		FileImage.clear();
+	}
+	tIngest.stop();
+	std::string strTooLarge;
+	if (!mi_image_allowed((const uint8_t*)FileImage.data(), FileImage.size(), strTooLarge)) {
+		send_too_large(response, strTooLarge);
+		return;
+	}
+	//. the client has given up while the body was read, skip the SDK.
+	if (mi_admission_expired()) {
+		mi_admission_reject(response, 0, "Deadline exceeded");
+		return;
 	}
+#if GD_USE_TEMP_FILE
+	//. debug only : keep a copy of the upload on disk and let the SDK read it back.
 	uint64_t milliseconds = getMilliseconds();
-	std::string millisecondsStr = std::to_string(milliseconds);
+	std::string millisecondsStr = std::to_string(milliseconds) + "_" + std::to_string(mi_thread_id());
 	std::string filePath = millisecondsStr + "output_file.dat";
 	std::ofstream outFile(filePath, std::ios::binary);
 	outFile.write(FileImage.c_str(), FileImage.size());
 	outFile.close();
+#endif
 
 	try
 	{
 		// Send POST request
-		std::string strRsp;
 		HTTPServerResponse::HTTPStatus status = HTTPResponse::HTTP_OK;
-		std::string out;
-		std::ostringstream oss;
 		CPipelineResult_t result;
 
-		for (int i = 0; i < 2; i++) {
-			pipeline_destroy_t pipeline_destroy = (pipeline_destroy_t)(GetProcAddress(g_hFaceDll, "pipeline_destroy"));
-			image_create_path_t image_create_path = (image_create_path_t)(GetProcAddress(g_hFaceDll, "image_create_path"));
-			pipeline_check_liveness_t pipeline_check_liveness = (pipeline_check_liveness_t)(GetProcAddress(g_hFaceDll, "pipeline_check_liveness"));
-			image_destroy_t image_destroy = (image_destroy_t)(GetProcAddress(g_hFaceDll, "image_destroy"));
+		//. a retry of the same upload with the same calibration reuses the earlier verdict.
+		const CMeta_t* pMeta = mi_meta_of(request);
+		ResultKey cacheKey;
+		bool bCached = false;
+		if ((g_pResultCache != NULL || mi_coalesce_enabled()) && !FileImage.empty()) {
+			cacheKey = ResultCache::make_key(FileImage.data(), FileImage.size(), nUploadHash, mi_result_variant(pMeta));
+			if (g_pResultCache != NULL) bCached = g_pResultCache->find(cacheKey, &result);
+		}
+		if (!FileImage.empty()) mi_audit_image_hash(nUploadHash);
+		//. the same upload already in the pipeline on this node : wait for its outcome.
+		FlightTicket flight;
+		if (!bCached && mi_coalesce_enabled() && !FileImage.empty()) {
+			flight.join(cacheKey);
+			if (flight.follower()) bCached = flight.wait(&result, &err, msg);
+		}
+		//. then the other nodes : their verdict, or wait while one of them checks this upload.
+		RedisClaim claim = MI_REDIS_OFF;
+		if (!bCached && g_pResultCache != NULL && !FileImage.empty() && mi_redis_enabled() && g_Settings.redisCache) {
+			claim = mi_redis_cache_claim(cacheKey, &result);
+			if (claim == MI_REDIS_BUSY) bCached = mi_redis_cache_wait(cacheKey, &result);
+			else bCached = (claim == MI_REDIS_HIT);
+			if (bCached) g_pResultCache->insert(cacheKey, result);
+		}
 
-			CImage_t* image = image_create_path(filePath.c_str(), &err, msg);
-			result = pipeline_check_liveness(g_pPipeline, image, NULL, &err, msg);
-			image_destroy(image);
+		//. a verdict of the canary or of a generation swapped out meanwhile is only this request's.
+		unsigned int nGeneration = g_Supervisor.generation();
+		bool bShare = true;
+		if (!bCached) {
+			LanePermit permit(mi_lane_of(request));
+#if GD_USE_TEMP_FILE
+			StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+			ImageHandle image = mi_image_decode_path(filePath.c_str(), &err, msg);
+			tCreate.stop();
 
-			char license[256] = "License error: license is not installed";
-			if (_stricmp((const char*)msg, license) == 0) {
-				pipeline_destroy(g_pPipeline);
-				setting_init(1);
+			StageTimer tLiveness(MI_STAGE_LIVENESS);
+			result = mi_check_liveness(image ? image->get() : NULL, &err, msg, pMeta);
+			tLiveness.stop();
+#else
+			//. large photos are reduced to the face first, large JPEGs decoded at a reduced scale and
+			//. rotated ones turned upright;
+			//. otherwise decode straight from the request buffer.
+			CropFrame crop;
+			bool bCrop = false;
+			if (mi_crop_enabled()) {
+				StageTimer tCrop(MI_STAGE_CROP);
+				bCrop = mi_crop_encoded((const uint8_t*)FileImage.data(), FileImage.size(), crop);
+			}
+			//. a near repeat of an earlier crop may take its verdict.
+			uint64_t nPhash = 0;
+			bool bNear = bCrop && mi_phash_enabled() && phash_lookup(crop, false, phash_variant(pMeta), &result, &nPhash);
+			DecodedFrame decoded;
+			if (bNear) err = OK;
+			else if (bCrop) {
+				submit_image(crop.pixels.data(), crop.pixels.size(), crop.width, 0);
+				result = g_pBackend->check_pixels(crop.pixels.data(), crop.width, crop.height, BGR888, pMeta, &err, msg);
+			}
+			else if (mi_progressive_take(FileImage, decoded) || mi_decode_jpeg_scaled((const uint8_t*)FileImage.data(), FileImage.size(), decoded)) {
+				submit_image(decoded.pixels.data(), decoded.pixels.size(), decoded.width, 0);
+				result = g_pBackend->check_pixels(decoded.pixels.data(), decoded.width, decoded.height, BGR888, pMeta, &err, msg);
 			}
 			else {
-				break;
+				submit_image((const uint8_t*)FileImage.data(), FileImage.size(), 0, nUploadHash);
+				result = g_pBackend->check((const uint8_t*)FileImage.data(), FileImage.size(), pMeta, &err, msg);
 			}
-		}
-		//.
-		Object::Ptr root = new Object;
-		root->set("score ", result.liveness_result.score);
-		root->set("probability ", result.liveness_result.probability);
-		root->set("quality ", result.quality_result.score);
+			RequestContext* ctx = mi_context();
+			bShare = !(ctx != NULL && ctx->canary) && g_Supervisor.generation() == nGeneration;
+			if (bShare && bCrop && !bNear && err == OK && mi_phash_enabled()) mi_phash_insert(nPhash, phash_variant(pMeta), result);
+#endif
+			mi_metrics_status(err);
+			if (mi_watchdog_timed_out() >= 0) status = HTTPResponse::HTTP_GATEWAY_TIMEOUT;
 
-		//.
-		if (result.quality_result.score < 0.5) {
-			root->set("liveness result ", "Image has a bad quality");
-		}
-		else if (result.liveness_result.probability >= 0.5) {
-			root->set("liveness result ", "Image is genuine");
-		}
-		else {
-			root->set("liveness result ", "Image is spoofed");
+			if (g_pResultCache != NULL && err == OK && bShare) g_pResultCache->insert(cacheKey, result);
+			if (claim == MI_REDIS_CLAIMED) {
+				if (err == OK && bShare) mi_redis_cache_put(cacheKey, result);
+				else mi_redis_cache_release(cacheKey);
+			}
 		}
+		//. unshared, the followers check on their own (FlightTicket's destructor).
+		if (bShare) flight.publish(result, err, msg);
 		//.
-		if (err == OK) {
-			root->set("state ", "OK");
-		}
-		else {
-			root->set("state ", msg);
-		}
-		
-		Stringifier::stringify(root, oss);
-		out = oss.str();
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ArenaString out;
+		out.reserve(GD_RESULT_JSON_RESERVE);
+		mi_result_body(request_schema(request), request_encoding(request), out, result, err, msg);
+		tSerialize.stop();
 
-		//.
+#if GD_USE_TEMP_FILE
 		std::remove(filePath.c_str());
+#endif
 
 		response.setStatus(status);
-		response.setContentType("application/json");
-		response.setContentLength(out.length());
-
-		response.set("Access-Control-Allow-Origin", "*");
-		response.set("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-		response.set("Access-Control-Allow-Headers", "Content-Type, Authorization");
+		mi_headers_apply(response, mi_result_headers(request_encoding(request)));
 
-		response.send() << out.c_str();
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
 
 	}
 	catch (const Exception& ex)
 	{
 		response.setStatus(HTTPResponse::HTTP_CONFLICT);
-		response.setContentType("application/json");
+		mi_headers_apply(response, MI_HEADERS_JSON);
 
-		response.set("Access-Control-Allow-Origin", "*");
-		response.set("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-		response.set("Access-Control-Allow-Headers", "Content-Type, Authorization");
-
-		response.setContentLength(ex.displayText().length());
-		response.send() << ex.displayText();
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
 	}
 
-	//LeaveCriticalSection(&g_cs);
 
 }
 
-void MyRequestHandler::OnUnknown(HTTPServerRequest& request, HTTPServerResponse& response)
+//. multipart with one file part per image, or {"images": ["<base64>", ...]}.
+//. p_pFields receives the other form fields / top-level JSON values (raw JSON text),
+//. p_pHashes the mi_hash64 of every image, taken as it was read (MiHash.h).
+//. Bodies over server.max_body_mb and images over the image limits throw TooLargeException.
+static void read_image_list(HTTPServerRequest& request, const std::function<std::string*(size_t)>& p_fnNext, std::map<std::string, std::string>* p_pFields,
+	std::vector<uint64_t>* p_pHashes = NULL)
 {
-	response.setStatus(HTTPResponse::HTTP_OK);
-	response.setContentType("text/plain");
-
-	response.set("Access-Control-Allow-Origin", "*");
-	response.set("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-	response.set("Access-Control-Allow-Headers", "Content-Type, Authorization");
+	ArenaVector<std::string*> vImages;
+	std::vector<uint64_t> vHashes;
+	auto fnNext = [&](size_t p_nIndex) -> std::string* {
+		std::string* pImage = p_fnNext(p_nIndex);
+		if (pImage != NULL) vImages.push_back(pImage);
+		return pImage;
+	};
+	if (request.getContentType().find("multipart/") != std::string::npos) {
+		//. query parameters first, form fields of the same name replace them.
+		if (p_pFields != NULL) {
+			Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+			for (size_t i = 0; i < params.size(); i++) (*p_pFields)[params[i].first] = params[i].second;
+		}
+		RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+		bool bFits = true;
+		try {
+			bFits = read_multipart(request, body.stream(), fnNext, 0, p_pFields, &vHashes);
+		}
+		catch (const Exception&) {
+			if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+			throw;
+		}
+		if (!bFits) throw Poco::DataFormatException("too many images");
+	}
+	else {
+		ContentCoding coding = MI_CODING_IDENTITY;
+		if (!mi_request_coding(request, &coding)) throw Poco::DataFormatException("unsupported Content-Encoding");
+		size_t nLength = body_length(request);
+		RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+		std::string strErr;
+		bool bOk = json_extract_base64_array(body.stream(), "images", fnNext, nLength, strErr, p_pFields, &vHashes);
+		if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+		if (!bOk) throw Poco::DataFormatException(strErr);
+	}
+	for (size_t i = 0; i < vImages.size(); i++) {
+		check_image_size(*vImages[i]);
+		mi_audit_image_hash(vHashes[i]);
+	}
+	if (p_pHashes != NULL) p_pHashes->swap(vHashes);
+}
 
-	ostream& ostr = response.send();
-	ostr << "Not found";
+//. "[0, 33, 66]" or "0,33,66"
+static void parse_timestamps(const std::string& p_strText, ArenaVector<uint64_t>& p_vOut)
+{
+	p_vOut.clear();
+	const char* p = p_strText.c_str();
+	while (*p != 0) {
+		if (*p >= '0' && *p <= '9') {
+			char* end = NULL;
+			p_vOut.push_back((uint64_t)strtoull(p, &end, 10));
+			p = end;
+		}
+		else if (*p == '[' || *p == ']' || *p == ',' || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+			p++;
+		}
+		else {
+			throw Poco::DataFormatException("invalid timestamps");
+		}
+	}
 }
 
-void MyRequestHandler::OnNoLicense(HTTPServerRequest& request, HTTPServerResponse& response)
+void MyRequestHandler::OnProcessBatch(HTTPServerRequest& request, HTTPServerResponse& response)
 {
-	response.setStatus(HTTPResponse::HTTP_OK);
-	response.setContentType("text/plain");
+	RequestTimer reqTimer(MI_EP_BATCH);
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	//. a streamed body holds one step of results, it may take larger batches.
+	size_t nStep = g_Settings.responseStreamImages > 0 ? (size_t)g_Settings.responseStreamImages : 0;
+	size_t nMax = nStep > 0 ? std::max((size_t)GD_BATCH_REQUEST_MAX, (size_t)g_Settings.responseStreamMax) : (size_t)GD_BATCH_REQUEST_MAX;
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs, nMax](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= nMax) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	try
+	{
+		StageTimer tIngest(MI_STAGE_INGEST);
+		std::vector<uint64_t> vHashes;
+		read_image_list(request, fnNext, NULL, &vHashes);
+		tIngest.stop();
+		if (vBufs.empty()) throw Poco::DataFormatException("no image in request");
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		size_t n = vBufs.size();
+		bool bNdjson = request.get("Accept", HTTPMessage::EMPTY).find(GD_NDJSON_TYPE) != std::string::npos;
+		bool bStream = nStep > 0 && n > nStep;
+		if (!bStream) nStep = n;
+		ResultStream out(request, response, request_schema(request), request_encoding(request), bStream, bNdjson, nStep);
+		ArenaVector<CPipelineResult_t> results(nStep);
+		ArenaVector<int> errors(nStep);
+		ArenaVector<uint8_t> verdicts(nStep), uncertain(nStep);
+		MsgBuffers msgs(nStep);
+		std::vector<const std::string*> data;
+		for (size_t at = 0; at < n; at += nStep) {
+			//. the rest of a streamed body has no reader.
+			if (at > 0 && mi_context_client_gone(MI_CANCEL_DISPATCH)) return;
+			size_t m = std::min(nStep, n - at);
+			data.resize(m);
+			for (size_t i = 0; i < m; i++) data[i] = vBufs[at + i]->get();
+			std::fill(errors.begin(), errors.end(), OK);
+
+			LanePermit permit(mi_lane_of(request));
+			mi_dedup_check_batch(g_pBackend, MI_DEDUP_REQUEST, data, vHashes.size() == n ? vHashes.data() + at : NULL, mi_meta_of(request), results.data(), errors.data(), msgs.data());
+			permit.release();
+			for (size_t i = 0; i < m; i++) mi_metrics_status(errors[i]);
+			//. the images of a step are not needed once it is checked.
+			for (size_t i = 0; i < m; i++) vBufs[at + i].reset();
+
+			StageTimer tSerialize(MI_STAGE_SERIALIZE);
+			mi_verdict_batch(mi_verdict_policy(), results.data(), errors.data(), m, verdicts.data(), uncertain.data());
+			for (size_t i = 0; i < m; i++) {
+				ResultExtra extra;
+				extra.index = (int)(at + i);
+				extra.error = errors[i];
+				extra.verdict = verdicts[i];
+				extra.uncertain = uncertain[i];
+				out.put(results[i], errors[i], msgs[i], extra);
+			}
+			tSerialize.stop();
+			out.flush();
+		}
+		out.finish();
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		//. a streamed body already has its status : it ends short.
+		if (response.sent()) return;
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
 
-	response.set("Access-Control-Allow-Origin", "*");
-	response.set("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-	response.set("Access-Control-Allow-Headers", "Content-Type, Authorization");
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
 
-	ostream& ostr = response.send();
-	ostr << "Please input license.";
+//. required size_t header.
+static size_t shm_header(HTTPServerRequest& p_request, const char* p_pszName)
+{
+	Poco::UInt64 n = 0;
+	if (!p_request.has(p_pszName) || !Poco::NumberParser::tryParseUnsigned64(p_request.get(p_pszName), n)) {
+		throw Poco::DataFormatException(std::string("invalid ") + p_pszName);
+	}
+	return (size_t)n;
 }
 
-void MyRequestHandler::OnStatus(HTTPServerRequest& request, HTTPServerResponse& response)
+void MyRequestHandler::OnProcessShm(HTTPServerRequest& request, HTTPServerResponse& response)
 {
-	response.setStatus(HTTPResponse::HTTP_OK);
-	response.setContentType("text/plain");
+	RequestTimer reqTimer(MI_EP_SHM);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
+	if (!mi_shm_enabled() || !mi_local_client(request.clientAddress())) {
+		response.setStatus(HTTPResponse::HTTP_FORBIDDEN);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer("shm ingestion is local only", 27);
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	try
+	{
+		StageTimer tIngest(MI_STAGE_INGEST);
+		size_t nLength = shm_header(request, GD_SHM_HEADER_LENGTH);
+		std::string strErr;
+		const uint8_t* pData = mi_shm_view(request.get(GD_SHM_HEADER_SEGMENT, ""), shm_header(request, GD_SHM_HEADER_SIZE),
+			shm_header(request, GD_SHM_HEADER_OFFSET), nLength, strErr);
+		if (pData == NULL) throw Poco::DataFormatException(strErr);
+		tIngest.stop();
+		if (!mi_image_allowed(pData, nLength, strErr)) throw TooLargeException(strErr);
 
-	response.set("Access-Control-Allow-Origin", "*");
-	response.set("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-	response.set("Access-Control-Allow-Headers", "Content-Type, Authorization");
+		LanePermit permit(mi_lane_of(request));
+		CPipelineResult_t result = g_pBackend->check(pData, nLength, mi_meta_of(request), &err, msg);
+		permit.release();
+		mi_metrics_status(err);
 
-	ostream& ostr = response.send();
-	
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ArenaString out;
+		out.reserve(GD_RESULT_JSON_RESERVE);
+		mi_result_body(request_schema(request), request_encoding(request), out, result, err, msg);
+		tSerialize.stop();
 
-	if (lv_pstRes == NULL) {
-		//. no license
-		ostr << "License not found";
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, mi_result_headers(request_encoding(request)));
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
 	}
-	else {
-		time_t t = lv_pstRes->m_lExpire;
-		struct tm timeinfo;
-		localtime_s(&timeinfo, &t);
-		char szTime[260]; memset(szTime, 0, sizeof(szTime));
-		if (lv_pstRes->m_lExpire < 32503622400) {
-			strftime(szTime, 260, "License valid : %Y-%m-%d", &timeinfo);
-		}
-		else {
-			sprintf_s(szTime, 260, "License valid : NO LIMIT");
-		}
-		ostr << szTime;
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
 	}
+	catch (const Exception& ex)
+	{
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnAnalyze(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_ANALYZE);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
+	if (!mi_analyze_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "analyze is disabled";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	CDetectionResult_t* detection = NULL;
+	try
+	{
+		//. one file part, or {"image":"<base64>"} as GD_API_FULL_PROCESS_BASE64.
+		size_t nLength = body_length(request);
+		PooledBuffer imageBuf(g_BufferPool, nLength);
+		std::string& FileImage = *imageBuf;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		if (request.getContentType().find("multipart/") != std::string::npos) {
+			RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+			try {
+				read_multipart_image(request, body.stream(), imageBuf.get(), nLength);
+			}
+			catch (const Exception&) {
+				if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+				throw;
+			}
+		}
+		else {
+			ContentCoding coding = MI_CODING_IDENTITY;
+			if (!mi_request_coding(request, &coding)) throw Poco::DataFormatException("unsupported Content-Encoding");
+			RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+			std::string strErr;
+			bool bOk = json_extract_base64_field(body.stream(), "image", &FileImage, nLength, strErr);
+			if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+			if (!bOk) throw Poco::DataFormatException(strErr);
+		}
+		tIngest.stop();
+		if (FileImage.empty()) throw Poco::DataFormatException("no image in request");
+		check_image_size(FileImage);
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		std::string strFields;
+		Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+		for (size_t i = 0; i < params.size(); i++) {
+			if (params[i].first == "fields") strFields = params[i].second;
+		}
+		unsigned nFields = mi_analyze_fields(strFields, GD_ANALYZE_FIELDS_DEFAULT);
+
+		//. decoded once, the detector and the pipeline share the image.
+		LanePermit permit(mi_lane_of(request));
+		MemoryPermit memory(mi_membudget_estimate((const uint8_t*)FileImage.data(), FileImage.size()));
+		StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+		ImageHandle image = mi_image_decode((const uint8_t*)FileImage.data(), FileImage.size(), &err, msg);
+		tCreate.stop();
+		if (!image) throw Poco::DataFormatException(msg);
+
+		int detectErr = OK;
+		char detectMsg[MESSAGE_BUFFER_SIZE]; memset(detectMsg, 0, sizeof(detectMsg));
+		detection = mi_analyze_detect(image->get(), &nFields, &detectErr, detectMsg);
+		if (detection == NULL) throw Poco::RuntimeException(detectMsg);
+
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		CPipelineResult_t result = mi_check_liveness(image->get(), &err, msg, mi_meta_of(request));
+		tLiveness.stop();
+		permit.release();
+		image.reset();
+		memory.release();
+		mi_metrics_status(err);
+
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ArenaString out;
+		out.reserve(GD_RESULT_JSON_RESERVE);
+		out.append("{\"liveness\":");
+		mi_result_body(request_schema(request), request_encoding(request), out, result, err, msg);
+		mi_analyze_json(out, detection, nFields);
+		out.push_back('}');
+		tSerialize.stop();
+		face_sdk_api().CDetectionResult_destroy(detection);
+		detection = NULL;
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, mi_result_headers(request_encoding(request)));
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		if (detection != NULL) face_sdk_api().CDetectionResult_destroy(detection);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+//. budget share of decoding every buffer of a batch body, see MiMemBudget.h
+static size_t decoded_bytes(const ArenaVector<std::unique_ptr<PooledBuffer>>& p_vBufs)
+{
+	size_t nBytes = 0;
+	for (size_t i = 0; i < p_vBufs.size(); i++) {
+		const std::string& data = **p_vBufs[i];
+		nBytes += mi_membudget_estimate((const uint8_t*)data.data(), data.size());
+	}
+	return nBytes;
+}
+
+//. decodes every buffer of a batch body, in parallel on the executor (MiExecutor.h);
+//. a failed one is NULL with its STATUS in p_vErrors.
+static void create_images(const ArenaVector<std::unique_ptr<PooledBuffer>>& p_vBufs, ArenaVector<const CImage_t*>& p_vImages, ArenaVector<int>& p_vErrors, MsgBuffers& p_vMsgs)
+{
+	RequestContext* ctx = mi_context();
+	StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+	p_vImages.assign(p_vBufs.size(), NULL);
+	mi_parallel_for(p_vBufs.size(), [&](size_t i) {
+		const std::string& data = **p_vBufs[i];
+		mi_image_count_decode(data.data(), ctx);
+		p_vImages[i] = FaceSdk::image_create_bytes((const uint8_t*)data.data(), data.size(), &p_vErrors[i], p_vMsgs[i]);
+	});
+}
+
+static void destroy_images(ArenaVector<const CImage_t*>& p_vImages)
+{
+	for (size_t i = 0; i < p_vImages.size(); i++) {
+		if (p_vImages[i] != NULL) face_sdk_api().image_destroy((CImage_t*)p_vImages[i]);
+	}
+	p_vImages.clear();
+}
+
+void MyRequestHandler::OnDetect(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_DETECT);
+	if (!mi_detect_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "detect is disabled";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= GD_BATCH_REQUEST_MAX) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	ArenaVector<const CImage_t*> images;
+	try
+	{
+		StageTimer tIngest(MI_STAGE_INGEST);
+		read_image_list(request, fnNext, NULL);
+		tIngest.stop();
+		if (vBufs.empty()) throw Poco::DataFormatException("no image in request");
+
+		bool bLandmarks = false;
+		Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+		for (size_t i = 0; i < params.size(); i++) {
+			if (params[i].first == "landmarks") bLandmarks = (params[i].second == "1" || params[i].second == "true");
+		}
+
+		//. an image that does not decode keeps its STATUS, the others are detected together.
+		size_t n = vBufs.size();
+		ArenaVector<int> errors(n, OK);
+		MsgBuffers msgs(n);
+		MemoryPermit memory(decoded_bytes(vBufs));
+		create_images(vBufs, images, errors, msgs);
+
+		ArenaString out;
+		out.reserve(n * GD_RESULT_JSON_RESERVE);
+		mi_detect_batch_json(out, images.data(), n, bLandmarks, errors.data(), msgs.data());
+		destroy_images(images);
+		memory.release();
+		for (size_t i = 0; i < n; i++) mi_metrics_status(errors[i]);
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		destroy_images(images);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnQuality(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_QUALITY);
+	if (!mi_quality_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "quality is disabled";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= GD_BATCH_REQUEST_MAX) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	ArenaVector<const CImage_t*> images;
+	try
+	{
+		StageTimer tIngest(MI_STAGE_INGEST);
+		read_image_list(request, fnNext, NULL);
+		tIngest.stop();
+		if (vBufs.empty()) throw Poco::DataFormatException("no image in request");
+
+		size_t n = vBufs.size();
+		ArenaVector<int> errors(n, OK);
+		MsgBuffers msgs(n);
+		MemoryPermit memory(decoded_bytes(vBufs));
+		create_images(vBufs, images, errors, msgs);
+
+		ArenaString out;
+		out.reserve(n * GD_RESULT_JSON_RESERVE);
+		mi_quality_batch_json(out, images.data(), n, errors.data(), msgs.data());
+		destroy_images(images);
+		memory.release();
+		for (size_t i = 0; i < n; i++) mi_metrics_status(errors[i]);
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		destroy_images(images);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnJobSubmit(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_JOBS);
+	if (!mi_jobs_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer("jobs disabled", 13);
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= GD_BATCH_REQUEST_MAX) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	try
+	{
+		std::map<std::string, std::string> fields;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		read_image_list(request, fnNext, &fields);
+		tIngest.stop();
+		if (vBufs.empty()) throw Poco::DataFormatException("no image in request");
+
+		//. form field as is, JSON string without its quotes.
+		std::string strCallback;
+		auto itCb = fields.find("callback");
+		if (itCb != fields.end()) strCallback = itCb->second;
+		if (strCallback.size() >= 2 && strCallback.front() == '"' && strCallback.back() == '"') strCallback = strCallback.substr(1, strCallback.size() - 2);
+		if (!strCallback.empty() && strCallback.compare(0, 7, "http://") != 0) throw Poco::DataFormatException("callback must be an http:// URL");
+
+		std::vector<const std::string*> data(vBufs.size());
+		for (size_t i = 0; i < vBufs.size(); i++) data[i] = vBufs[i]->get();
+		std::string strErr;
+		std::string strId = mi_jobs_submit(data, mi_meta_of(request), request_schema(request), strCallback, strErr);
+		if (strId.empty()) {
+			response.setStatus(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+			response.set("Retry-After", "1");
+			mi_headers_apply(response, MI_HEADERS_TEXT);
+			response.sendBuffer(strErr.data(), strErr.size());
+			return;
+		}
+
+		std::string out = "{\"id\":\"" + strId + "\",\"images\":" + std::to_string(vBufs.size()) + ",\"status\":\"queued\"}";
+		response.setStatus(HTTPResponse::HTTP_ACCEPTED);
+		response.set("Location", std::string(GD_API_JOBS) + "/" + strId);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnJobStatus(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	std::string strPath = Router::path_of(request.getURI()).str();
+	std::string strId = strPath.substr(strPath.rfind('/') + 1);
+
+	ArenaString out;
+	if (!mi_jobs_status(strId, out)) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer("unknown job", 11);
+		return;
+	}
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnProcessSequence(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_SEQUENCE);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= GD_BATCH_REQUEST_MAX) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	ArenaVector<CImage_t*> images;
+	try
+	{
+		//. frames of one capture in order, "timestamps" optional (ms, one per frame).
+		std::map<std::string, std::string> fields;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		read_image_list(request, fnNext, &fields);
+		tIngest.stop();
+		if (vBufs.empty()) throw Poco::DataFormatException("no image in request");
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		ArenaVector<uint64_t> timestamps;
+		auto itTs = fields.find("timestamps");
+		if (itTs != fields.end()) parse_timestamps(itTs->second, timestamps);
+		if (!timestamps.empty() && timestamps.size() != vBufs.size()) {
+			throw Poco::DataFormatException("timestamps count does not match frame count");
+		}
+
+		LanePermit permit(mi_lane_of(request));
+		MemoryPermit memory(decoded_bytes(vBufs));
+		StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+		for (size_t i = 0; i < vBufs.size(); i++) {
+			const std::string& data = **vBufs[i];
+			mi_image_count_decode(data.data());
+			CImage_t* image = FaceSdk::image_create_bytes((const uint8_t*)data.data(), data.size(), &err, msg);
+			if (image == NULL) throw Poco::DataFormatException("frame " + std::to_string(i) + " : " + msg);
+			images.push_back(image);
+		}
+
+		tCreate.stop();
+
+		//. short of budget : no fusion, the last frame decides alone. With an uncertain band
+		//. the last frame goes first and the frames are fused only when it is borderline.
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		const VerdictPolicy& policy = mi_verdict_policy();
+		bool bFused = images.size() < 2 || !mi_context_degrade(MI_DEGRADE_FUSION);
+		CPipelineResult_t result;
+		if (images.size() >= 2 && (!bFused || policy.has_band())) {
+			result = mi_check_liveness(images.back(), &err, msg, mi_meta_of(request));
+			if (bFused && (err != OK || mi_verdict_uncertain(policy, result, err))) {
+				mi_metrics_verdict_recheck();
+				err = OK;
+				msg[0] = '\0';
+			}
+			else {
+				bFused = false;
+			}
+		}
+		if (bFused) result = mi_check_liveness_sequence(images.data(), images.size(), timestamps.empty() ? NULL : timestamps.data(), mi_meta_of(request), &err, msg);
+		tLiveness.stop();
+		permit.release();
+		mi_metrics_status(err);
+
+		for (size_t i = 0; i < images.size(); i++) face_sdk_api().image_destroy(images[i]);
+		images.clear();
+		memory.release();
+
+		//.
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ResultExtra extra;
+		extra.frames = bFused ? (int)vBufs.size() : 1;
+		ArenaString out;
+		out.reserve(GD_RESULT_JSON_RESERVE);
+		mi_result_body(request_schema(request), request_encoding(request), out, result, err, msg, extra);
+		tSerialize.stop();
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, mi_result_headers(request_encoding(request)));
+
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		for (size_t i = 0; i < images.size(); i++) face_sdk_api().image_destroy(images[i]);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnProcessBurst(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_BURST);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
+	if (!mi_burst_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "burst is disabled ([burst] enable, [quality] enable)";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= GD_BATCH_REQUEST_MAX) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	ArenaVector<const CImage_t*> images;
+	try
+	{
+		std::map<std::string, std::string> fields;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		read_image_list(request, fnNext, &fields);
+		tIngest.stop();
+		if (vBufs.empty()) throw Poco::DataFormatException("no image in request");
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		const BurstSettings& settings = mi_burst_settings();
+		size_t nTopK = (size_t)settings.topK;
+		bool bFused = settings.fused;
+		Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+		for (size_t i = 0; i < params.size(); i++) {
+			if (params[i].first == "top_k") nTopK = (size_t)std::max(NumberParser::parse(params[i].second), 1);
+			else if (params[i].first == "mode") bFused = params[i].second == "fused";
+		}
+		ArenaVector<uint64_t> timestamps;
+		auto itTs = fields.find("timestamps");
+		if (itTs != fields.end()) parse_timestamps(itTs->second, timestamps);
+		if (!timestamps.empty() && timestamps.size() != vBufs.size()) {
+			throw Poco::DataFormatException("timestamps count does not match frame count");
+		}
+
+		size_t n = vBufs.size();
+		ArenaVector<int> errors(n, OK);
+		MsgBuffers msgs(n);
+		MemoryPermit memory(decoded_bytes(vBufs));
+		create_images(vBufs, images, errors, msgs);
+
+		//. every frame is ranked, only the selected ones reach the pipeline.
+		ArenaVector<BurstFrame> frames(n);
+		ArenaVector<size_t> selected(n);
+		size_t nSelected = mi_burst_select(images.data(), n, nTopK, frames.data(), errors.data(), msgs.data(), selected.data());
+		ArenaVector<const CImage_t*> checked(nSelected);
+		for (size_t k = 0; k < nSelected; k++) checked[k] = images[selected[k]];
+
+		bFused = bFused && nSelected >= 2;
+		ArenaVector<CPipelineResult_t> results(bFused ? 1 : nSelected);
+		ArenaVector<int> resultErrors(results.size(), OK);
+		MsgBuffers resultMsgs(std::max(results.size(), (size_t)1));
+		if (nSelected > 0) {
+			LanePermit permit(mi_lane_of(request));
+			StageTimer tLiveness(MI_STAGE_LIVENESS);
+			if (bFused) {
+				ArenaVector<uint64_t> stamps;
+				for (size_t k = 0; k < nSelected && !timestamps.empty(); k++) stamps.push_back(timestamps[selected[k]]);
+				results[0] = mi_check_liveness_sequence((CImage_t**)checked.data(), nSelected, stamps.empty() ? NULL : stamps.data(), mi_meta_of(request), &resultErrors[0], resultMsgs[0]);
+			}
+			else {
+				mi_check_liveness_batch(checked.data(), nSelected, mi_meta_of(request), results.data(), resultErrors.data(), resultMsgs.data());
+			}
+			tLiveness.stop();
+			permit.release();
+			for (size_t k = 0; k < results.size(); k++) mi_metrics_status(resultErrors[k]);
+		}
+		destroy_images(images);
+		memory.release();
+
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ResultSchema schema = request_schema(request);
+		ArenaString out;
+		out.reserve((n + results.size()) * GD_RESULT_JSON_RESERVE);
+		out.append("{\"frames\":[");
+		for (size_t i = 0; i < n; i++) {
+			if (i > 0) out.push_back(',');
+			out.append("{\"index\":");
+			mi_json_put_int(out, (int)i);
+			out.append(",\"status\":");
+			mi_json_put_string(out, face_sdk_status_name(errors[i]));
+			if (errors[i] != OK) {
+				out.append(",\"message\":");
+				mi_json_put_string(out, msgs[i]);
+			}
+			else {
+				out.append(",\"usable\":");
+				out.append(frames[i].usable ? "true" : "false");
+				out.append(",\"score\":");
+				mi_json_put_float(out, frames[i].quality);
+				out.append(",\"face_area\":");
+				mi_json_put_int(out, (int)frames[i].faceArea);
+			}
+			out.append(",\"checked\":");
+			out.append(frames[i].selected ? "true" : "false");
+			out.push_back('}');
+		}
+		out.append("],\"results\":[");
+		for (size_t k = 0; k < results.size(); k++) {
+			if (k > 0) out.push_back(',');
+			ResultExtra extra;
+			if (bFused) extra.frames = (int)nSelected;
+			else extra.index = (int)selected[k];
+			mi_json_result(schema, out, results[k], resultErrors[k], resultMsgs[k], extra);
+		}
+		//. liveness checks the selection saved, the reason for this endpoint.
+		out.append("],\"checked\":");
+		mi_json_put_int(out, (int)nSelected);
+		out.append(",\"skipped\":");
+		mi_json_put_int(out, (int)(n - nSelected));
+		out.append(",\"saved\":");
+		mi_json_put_float(out, (float)(n - nSelected) / (float)n);
+		out.push_back('}');
+		tSerialize.stop();
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		destroy_images(images);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnProcessSession(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_SESSION);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+	if (g_pSessionStore == NULL) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer("session store is disabled ([session] enable)", 44);
+		return;
+	}
+
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= GD_BATCH_REQUEST_MAX) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	std::vector<SessionFrame> frames;
+	try
+	{
+		const std::string& strId = request.get(GD_SESSION_HEADER, "");
+		if (strId.empty() || strId.size() > 128) throw Poco::DataFormatException(GD_SESSION_HEADER " is required (up to 128 characters)");
+
+		//. one or more frames in order, "timestamps" optional (ms, one per frame), "final" closes.
+		std::map<std::string, std::string> fields;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		read_image_list(request, fnNext, &fields);
+		tIngest.stop();
+		auto itFinal = fields.find("final");
+		bool bFinal = itFinal != fields.end() && (itFinal->second == "1" || Poco::icompare(itFinal->second, "true") == 0);
+		if (vBufs.empty() && !bFinal) throw Poco::DataFormatException("no image in request");
+
+		ArenaVector<uint64_t> timestamps;
+		auto itTs = fields.find("timestamps");
+		if (itTs != fields.end()) parse_timestamps(itTs->second, timestamps);
+		if (!timestamps.empty() && timestamps.size() != vBufs.size()) {
+			throw Poco::DataFormatException("timestamps count does not match frame count");
+		}
+
+		//. decoded now, while the rest of the capture is still on its way.
+		size_t nHeld = 0;
+		{
+			StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+			for (size_t i = 0; i < vBufs.size(); i++) {
+				const std::string& data = **vBufs[i];
+				SessionFrame frame;
+				mi_image_count_decode(data.data());
+				frame.image = FaceSdk::image_create_bytes((const uint8_t*)data.data(), data.size(), &err, msg);
+				if (frame.image == NULL) throw Poco::DataFormatException("frame " + std::to_string(i) + " : " + msg);
+				frame.timestamp = timestamps.empty() ? 0 : timestamps[i];
+				frame.bytes = mi_membudget_estimate((const uint8_t*)data.data(), data.size());
+				nHeld = g_pSessionStore->add(strId, frame);
+			}
+		}
+		vBufs.clear();
+
+		if (!bFinal && (int)nHeld < g_Settings.sessionFrames) {
+			ArenaString out;
+			out.reserve(128);
+			out.append("{\"session\":");
+			mi_json_put_string(out, strId.c_str());
+			out.append(",\"frames\":");
+			mi_json_put_int(out, (int)nHeld);
+			out.append(",\"needed\":");
+			mi_json_put_int(out, g_Settings.sessionFrames);
+			out.push_back('}');
+			response.setStatus(HTTPResponse::HTTP_ACCEPTED);
+			mi_headers_apply(response, MI_HEADERS_JSON);
+			mi_send_body(request, response, out.data(), out.size());
+			return;
+		}
+
+		if (!g_pSessionStore->take(strId, frames) || frames.empty()) throw Poco::DataFormatException("no frames held for this session (expired or evicted)");
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			for (size_t i = 0; i < frames.size(); i++) face_sdk_api().image_destroy(frames[i].image);
+			return;
+		}
+
+		ArenaVector<CImage_t*> images;
+		ArenaVector<uint64_t> stamps;
+		bool bStamps = true;
+		for (size_t i = 0; i < frames.size(); i++) {
+			images.push_back(frames[i].image);
+			stamps.push_back(frames[i].timestamp);
+			if (frames[i].timestamp == 0) bStamps = false;
+		}
+
+		LanePermit permit(mi_lane_of(request));
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		CPipelineResult_t result;
+		if (images.size() == 1) result = mi_check_liveness(images[0], &err, msg, mi_meta_of(request));
+		else result = mi_check_liveness_sequence(images.data(), images.size(), bStamps ? stamps.data() : NULL, mi_meta_of(request), &err, msg);
+		tLiveness.stop();
+		permit.release();
+		mi_metrics_status(err);
+
+		for (size_t i = 0; i < frames.size(); i++) face_sdk_api().image_destroy(frames[i].image);
+		frames.clear();
+
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ResultExtra extra;
+		extra.frames = (int)images.size();
+		ArenaString out;
+		out.reserve(GD_RESULT_JSON_RESERVE);
+		mi_result_body(request_schema(request), request_encoding(request), out, result, err, msg, extra);
+		tSerialize.stop();
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, mi_result_headers(request_encoding(request)));
+
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		for (size_t i = 0; i < frames.size(); i++) face_sdk_api().image_destroy(frames[i].image);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+//. positive integer header, p_nDefault when absent.
+static int pixels_header(HTTPServerRequest& p_request, const char* p_pszName, int p_nDefault)
+{
+	if (!p_request.has(p_pszName)) return p_nDefault;
+	int n = 0;
+	if (!Poco::NumberParser::tryParse(p_request.get(p_pszName), n) || n <= 0) {
+		throw Poco::DataFormatException(std::string("invalid ") + p_pszName);
+	}
+	return n;
+}
+
+void MyRequestHandler::OnProcessPixels(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_PIXELS);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	try
+	{
+		int nWidth = pixels_header(request, GD_PIXELS_HEADER_WIDTH, 0);
+		int nHeight = pixels_header(request, GD_PIXELS_HEADER_HEIGHT, 0);
+		if (nWidth <= 0 || nHeight <= 0 || nWidth > 16384 || nHeight > 16384) {
+			throw Poco::DataFormatException("X-Width and X-Height are required (1 .. 16384)");
+		}
+		COLOR_ENCODING_t encoding = BGR888;
+		bool bYuv = false, bNv12 = false;
+		if (request.has(GD_PIXELS_HEADER_FORMAT)) {
+			std::string fmt = Poco::toLower(request.get(GD_PIXELS_HEADER_FORMAT));
+			if (fmt == "rgb") encoding = RGB888;
+			else if (fmt == "nv12" || fmt == "i420") { bYuv = true; bNv12 = fmt == "nv12"; }
+			else if (fmt != "bgr") throw Poco::DataFormatException("X-Pixel-Format must be bgr, rgb, nv12 or i420");
+		}
+		size_t nRow = (size_t)nWidth * (bYuv ? 1 : 3);
+		size_t nStride = (size_t)pixels_header(request, GD_PIXELS_HEADER_STRIDE, (int)nRow);
+		if (nStride < nRow) throw Poco::DataFormatException(bYuv ? "X-Stride is smaller than width" : "X-Stride is smaller than width * 3");
+
+		std::string strWhy;
+		if (!mi_image_size_allowed(nWidth, nHeight, strWhy)) throw TooLargeException(strWhy);
+
+		//. the last row may omit its padding.
+		size_t nNeed = nStride * (size_t)(nHeight - 1) + nRow;
+		size_t nChromaStride = 0, nChromaRows = (size_t)(nHeight + 1) / 2;
+		if (bYuv) {
+			//. full Y plane, then the UV plane (nv12) or the U and V planes (i420).
+			size_t nChromaRow = bNv12 ? (size_t)(nWidth + 1) / 2 * 2 : (size_t)(nWidth + 1) / 2;
+			nChromaStride = (size_t)pixels_header(request, GD_PIXELS_HEADER_CHROMA_STRIDE, (int)(bNv12 ? nStride : (nStride + 1) / 2));
+			if (nChromaStride < nChromaRow) throw Poco::DataFormatException("X-Chroma-Stride is smaller than the chroma row");
+			size_t nPlane = nChromaStride * nChromaRows;
+			nNeed = nStride * nHeight + (bNv12 ? 0 : nPlane) + nPlane - nChromaStride + nChromaRow;
+		}
+		if (nNeed > (size_t)mi_config().maxBodyMb * 1024 * 1024) throw TooLargeException("X-Stride * X-Height exceeds server.max_body_mb");
+		PooledBuffer pixelBuf(g_BufferPool, nNeed);
+		std::string& pixels = *pixelBuf;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		pixels.resize(nNeed);
+		request.stream().read(&pixels[0], (std::streamsize)nNeed);
+		if ((size_t)request.stream().gcount() != nNeed) throw Poco::DataFormatException("body is shorter than X-Stride * X-Height");
+		//. pack padded rows in place; image_create_pixels takes contiguous rows.
+		if (!bYuv && nStride != nRow) {
+			for (int r = 1; r < nHeight; r++) memmove(&pixels[r * nRow], &pixels[r * nStride], nRow);
+		}
+		tIngest.stop();
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		MiYuvFrame yuv;
+		if (bYuv) {
+			const uint8_t* base = (const uint8_t*)pixels.data();
+			yuv.nv12 = bNv12;
+			yuv.width = nWidth;
+			yuv.height = nHeight;
+			yuv.y = base;
+			yuv.yStride = nStride;
+			yuv.u = base + nStride * nHeight;
+			yuv.uStride = yuv.vStride = nChromaStride;
+			yuv.v = bNv12 ? NULL : yuv.u + nChromaStride * nChromaRows;
+		}
+
+		LanePermit permit(mi_lane_of(request));
+		CropFrame crop;
+		bool bCrop = false;
+		if (mi_crop_enabled()) {
+			StageTimer tCrop(MI_STAGE_CROP);
+			bCrop = bYuv ? mi_crop_yuv(yuv, crop) : mi_crop_pixels((const uint8_t*)pixels.data(), nWidth, nHeight, nRow, encoding, crop);
+		}
+		//. near repeat of an earlier face crop.
+		CPipelineResult_t result;
+		const CMeta_t* pMeta = mi_meta_of(request);
+		uint64_t nPhash = 0;
+		bool bFace = bCrop && mi_phash_enabled();
+		bool bNear = bFace && phash_lookup(crop, !bYuv && encoding == RGB888, phash_variant(pMeta), &result, &nPhash);
+		//. no face crop : the whole frame goes to BGR.
+		if (bYuv && !bCrop) {
+			StageTimer tConvert(MI_STAGE_CONVERT);
+			crop.width = nWidth;
+			crop.height = nHeight;
+			crop.pixels.resize((size_t)nWidth * nHeight * 3);
+			mi_color_yuv_rect(yuv, 0, 0, nWidth, nHeight, crop.pixels.data(), (size_t)nWidth * 3, BGR888);
+			bCrop = true;
+		}
+		if (bNear) err = OK;
+		else if (bCrop) result = g_pBackend->check_pixels(crop.pixels.data(), crop.width, crop.height, encoding, pMeta, &err, msg);
+		else result = g_pBackend->check_pixels((const uint8_t*)pixels.data(), nWidth, nHeight, encoding, pMeta, &err, msg);
+		if (bFace && !bNear && err == OK) mi_phash_insert(nPhash, phash_variant(pMeta), result);
+		permit.release();
+		mi_metrics_status(err);
+
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ArenaString out;
+		out.reserve(GD_RESULT_JSON_RESERVE);
+		mi_result_body(request_schema(request), request_encoding(request), out, result, err, msg);
+		tSerialize.stop();
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, mi_result_headers(request_encoding(request)));
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnProcessFaces(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_FACES);
+	if (!mi_faces_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "faces is disabled ([faces] enable, [crop] enable)";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	try
+	{
+		//. raw pixels with X-Width / X-Height, else one file part or {"image":"<base64>"} as GD_API_ANALYZE.
+		bool bPixels = request.has(GD_PIXELS_HEADER_WIDTH);
+		int nWidth = 0, nHeight = 0;
+		COLOR_ENCODING_t encoding = BGR888;
+		size_t nLength = body_length(request);
+		if (bPixels) {
+			nWidth = pixels_header(request, GD_PIXELS_HEADER_WIDTH, 0);
+			nHeight = pixels_header(request, GD_PIXELS_HEADER_HEIGHT, 0);
+			if (nWidth <= 0 || nHeight <= 0 || nWidth > 16384 || nHeight > 16384) {
+				throw Poco::DataFormatException("X-Width and X-Height are required (1 .. 16384)");
+			}
+			if (request.has(GD_PIXELS_HEADER_FORMAT)) {
+				std::string fmt = Poco::toLower(request.get(GD_PIXELS_HEADER_FORMAT));
+				if (fmt == "rgb") encoding = RGB888;
+				else if (fmt != "bgr") throw Poco::DataFormatException("X-Pixel-Format must be bgr or rgb");
+			}
+			std::string strWhy;
+			if (!mi_image_size_allowed(nWidth, nHeight, strWhy)) throw TooLargeException(strWhy);
+			nLength = (size_t)nWidth * nHeight * 3;
+			if (nLength > (size_t)mi_config().maxBodyMb * 1024 * 1024) throw TooLargeException("X-Width * X-Height * 3 exceeds server.max_body_mb");
+		}
+		PooledBuffer imageBuf(g_BufferPool, nLength);
+		std::string& FileImage = *imageBuf;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		if (bPixels) {
+			FileImage.resize(nLength);
+			request.stream().read(&FileImage[0], (std::streamsize)nLength);
+			if ((size_t)request.stream().gcount() != nLength) throw Poco::DataFormatException("body is shorter than X-Width * X-Height * 3");
+		}
+		else if (request.getContentType().find("multipart/") != std::string::npos) {
+			RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+			try {
+				read_multipart_image(request, body.stream(), imageBuf.get(), nLength);
+			}
+			catch (const Exception&) {
+				if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+				throw;
+			}
+		}
+		else {
+			ContentCoding coding = MI_CODING_IDENTITY;
+			if (!mi_request_coding(request, &coding)) throw Poco::DataFormatException("unsupported Content-Encoding");
+			RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+			std::string strErr;
+			bool bOk = json_extract_base64_field(body.stream(), "image", &FileImage, nLength, strErr);
+			if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+			if (!bOk) throw Poco::DataFormatException(strErr);
+		}
+		tIngest.stop();
+		if (FileImage.empty()) throw Poco::DataFormatException("no image in request");
+		if (!bPixels) check_image_size(FileImage);
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		//. one detection, then every face crop in one batched call.
+		LanePermit permit(mi_lane_of(request));
+		MemoryPermit memory(bPixels ? nLength : mi_membudget_estimate((const uint8_t*)FileImage.data(), FileImage.size()));
+		std::vector<FaceCrop> crops;
+		size_t nFound = 0;
+		StageTimer tCrop(MI_STAGE_CROP);
+		bool bCrop = bPixels
+			? mi_crop_faces_pixels((const uint8_t*)FileImage.data(), nWidth, nHeight, (size_t)nWidth * 3, encoding, mi_faces_max(), crops, &nFound)
+			: mi_crop_faces_encoded((const uint8_t*)FileImage.data(), FileImage.size(), mi_faces_max(), crops, &nFound);
+		tCrop.stop();
+		if (!bCrop) throw Poco::DataFormatException(bPixels ? "face detection failed" : "image cannot be cropped (format, EXIF rotation or a build without WIC)");
+
+		size_t n = crops.size();
+		ArenaVector<CPipelineResult_t> results(n);
+		ArenaVector<int> errors(n, OK);
+		MsgBuffers msgs(std::max(n, (size_t)1));
+		if (n > 0) {
+			StageTimer tLiveness(MI_STAGE_LIVENESS);
+			mi_faces_check(crops, bPixels ? encoding : BGR888, mi_meta_of(request), results.data(), errors.data(), msgs.data());
+			tLiveness.stop();
+			for (size_t i = 0; i < n; i++) mi_metrics_status(errors[i]);
+		}
+		permit.release();
+		memory.release();
+		mi_metrics_faces(n, nFound - n);
+
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ResultSchema schema = request_schema(request);
+		ArenaString out;
+		out.reserve((n + 1) * GD_RESULT_JSON_RESERVE);
+		out.append("{\"faces\":[");
+		for (size_t i = 0; i < n; i++) {
+			if (i > 0) out.push_back(',');
+			out.append("{\"box\":");
+			mi_analyze_box_json(out, crops[i].box);
+			out.append(",\"result\":");
+			ResultExtra extra;
+			extra.index = (int)i;
+			mi_json_result(schema, out, results[i], errors[i], msgs[i], extra);
+			out.push_back('}');
+		}
+		out.append("],\"found\":");
+		mi_json_put_int(out, (int)nFound);
+		out.append(",\"checked\":");
+		mi_json_put_int(out, (int)n);
+		out.push_back('}');
+		tSerialize.stop();
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnProcessOnboard(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_ONBOARD);
+	if (!mi_onboard_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "onboarding is disabled ([onboard] enable, [quality] enable)";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	ArenaVector<std::unique_ptr<PooledBuffer>> vBufs;
+	auto fnNext = [&vBufs](size_t p_nIndex) -> std::string* {
+		if (p_nIndex >= 2) return NULL;
+		vBufs.emplace_back(new PooledBuffer(g_BufferPool, 0));
+		return vBufs.back()->get();
+	};
+
+	ArenaVector<const CImage_t*> images;
+	try
+	{
+		StageTimer tIngest(MI_STAGE_INGEST);
+		read_image_list(request, fnNext, NULL);
+		tIngest.stop();
+		if (vBufs.size() != 2) throw Poco::DataFormatException("two images expected : the selfie, then the ID portrait");
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		ArenaVector<int> errors(2, OK);
+		MsgBuffers msgs(2);
+		MemoryPermit memory(decoded_bytes(vBufs));
+		create_images(vBufs, images, errors, msgs);
+
+		//. the portrait side runs on a worker : its text is built in heap strings and its
+		//. message buffers are leased there, neither may touch this thread's arena.
+		const CImage_t* pId = images[1];
+		int idErr = errors[1];
+		std::string strIdMsg(msgs[1]);
+		std::string strQuality, strDetect;
+		auto fnId = [pId, idErr, &strIdMsg, &strQuality, &strDetect]() {
+			if (pId == NULL) return;
+			const CImage_t* ids[1] = { pId };
+			int qualityErr = idErr;
+			MsgBuffers qualityMsgs(1);
+			ArenaString quality;
+			mi_quality_batch_json(quality, ids, 1, &qualityErr, qualityMsgs.data());
+			//. the one item of the batch array.
+			strQuality.assign(quality.data() + 1, quality.size() - 2);
+			if (mi_detect_enabled()) {
+				int detectErr = idErr;
+				MsgBuffers detectMsgs(1);
+				ArenaString detect;
+				mi_detect_batch_json(detect, ids, 1, false, &detectErr, detectMsgs.data());
+				strDetect.assign(detect.data() + 1, detect.size() - 2);
+			}
+		};
+
+		CPipelineResult_t result;
+		memset(&result, 0, sizeof(result));
+		int err = errors[0];
+		char* msg = msgs[0];
+		auto fnSelfie = [&]() {
+			if (images[0] == NULL) return;
+			LanePermit permit(mi_lane_of(request));
+			StageTimer tLiveness(MI_STAGE_LIVENESS);
+			result = mi_check_liveness(images[0], &err, msg, mi_meta_of(request));
+			tLiveness.stop();
+			mi_metrics_status(err);
+		};
+		mi_onboard_run(fnSelfie, fnId);
+		destroy_images(images);
+		memory.release();
+
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ArenaString out;
+		out.reserve(2 * GD_RESULT_JSON_RESERVE);
+		out.append("{\"selfie\":");
+		mi_json_result(request_schema(request), out, result, err, msg);
+		out.append(",\"id\":");
+		if (pId == NULL) {
+			out.append("{\"status\":");
+			mi_json_put_string(out, face_sdk_status_name(idErr));
+			out.append(",\"message\":");
+			mi_json_put_string(out, strIdMsg.c_str());
+			out.push_back('}');
+		}
+		else {
+			out.append("{\"quality\":");
+			out.append(strQuality.data(), strQuality.size());
+			if (!strDetect.empty()) {
+				out.append(",\"detection\":");
+				out.append(strDetect.data(), strDetect.size());
+			}
+			out.push_back('}');
+		}
+		out.push_back('}');
+		tSerialize.stop();
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		destroy_images(images);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnProcessVideo(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	RequestTimer reqTimer(MI_EP_VIDEO);
+	char        msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int         err = OK;
+	if (!mi_video_enabled()) {
+		response.setStatus(MI_HAS_MF ? HTTPResponse::HTTP_NOT_FOUND : HTTPResponse::HTTP_NOT_IMPLEMENTED);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = MI_HAS_MF ? "video is disabled ([video] enable)" : "video decode needs Media Foundation (Windows builds)";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+
+	ArenaVector<const CImage_t*> images;
+	try
+	{
+		//. one file part, or the clip itself as the body.
+		size_t nLength = body_length(request);
+		PooledBuffer videoBuf(g_BufferPool, nLength);
+		std::string& video = *videoBuf;
+		StageTimer tIngest(MI_STAGE_INGEST);
+		{
+			RequestBody body(request, (size_t)mi_config().maxBodyMb * 1024 * 1024);
+			try {
+				if (request.getContentType().find("multipart/") != std::string::npos) read_multipart_image(request, body.stream(), videoBuf.get(), nLength);
+				else InputRaw::read(request, body.stream(), videoBuf.get(), nLength);
+			}
+			catch (const Exception&) {
+				if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+				throw;
+			}
+			if (body.overflow()) throw TooLargeException("body exceeds server.max_body_mb");
+		}
+		tIngest.stop();
+		if (video.empty()) throw Poco::DataFormatException("no video in request");
+		if (mi_admission_expired()) {
+			mi_admission_reject(response, 0, "Deadline exceeded");
+			return;
+		}
+
+		VideoSettings settings = mi_video_settings();
+		Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+		for (size_t i = 0; i < params.size(); i++) {
+			if (params[i].first == "sampling") settings.keyframes = params[i].second != "every_n";
+			else if (params[i].first == "every_n") settings.everyN = std::max(NumberParser::parse(params[i].second), 1);
+			else if (params[i].first == "max_frames") settings.maxFrames = std::min(std::max(NumberParser::parse(params[i].second), 1), mi_video_settings().maxFrames);
+		}
+
+		LanePermit permit(mi_lane_of(request));
+		std::vector<VideoFrame> frames;
+		std::string strErr;
+		StageTimer tDecode(MI_STAGE_DECODE);
+		if (!mi_video_frames((const uint8_t*)video.data(), video.size(), settings, frames, strErr)) throw Poco::DataFormatException(strErr);
+		tDecode.stop();
+
+		size_t n = frames.size();
+		size_t nBytes = 0;
+		for (size_t i = 0; i < n; i++) nBytes += frames[i].pixels.size();
+		MemoryPermit memory(nBytes);
+		ArenaVector<uint64_t> timestamps(n);
+		StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+		for (size_t i = 0; i < n; i++) {
+			const VideoFrame& f = frames[i];
+			CImage_t* image = FaceSdk::image_create_pixels(f.pixels.data(), (size_t)f.height, (size_t)f.width, BGR888, &err, msg);
+			if (image == NULL) throw Poco::DataFormatException(msg);
+			images.push_back(image);
+			timestamps[i] = f.timestampMs;
+		}
+		tCreate.stop();
+
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		CPipelineResult_t result = mi_check_liveness_sequence((CImage_t**)images.data(), n, timestamps.data(), mi_meta_of(request), &err, msg);
+		tLiveness.stop();
+		permit.release();
+		destroy_images(images);
+		memory.release();
+		mi_metrics_status(err);
+
+		StageTimer tSerialize(MI_STAGE_SERIALIZE);
+		ArenaString out;
+		out.reserve(GD_RESULT_JSON_RESERVE + n * 48);
+		out.append("{\"frames\":[");
+		for (size_t i = 0; i < n; i++) {
+			if (i > 0) out.push_back(',');
+			out.append("{\"timestamp\":");
+			mi_json_put_int(out, (int)frames[i].timestampMs);
+			out.append(",\"key\":");
+			out.append(frames[i].key ? "true" : "false");
+			out.push_back('}');
+		}
+		out.append("],\"result\":");
+		ResultExtra extra;
+		extra.frames = (int)n;
+		mi_result_body(request_schema(request), request_encoding(request), out, result, err, msg, extra);
+		out.push_back('}');
+		tSerialize.stop();
+
+		response.setStatus(HTTPResponse::HTTP_OK);
+		mi_headers_apply(response, mi_result_headers(request_encoding(request)));
+
+		StageTimer tSend(MI_STAGE_SEND);
+		mi_send_body(request, response, out.data(), out.size());
+	}
+	catch (const TooLargeException& ex)
+	{
+		send_too_large(response, ex.displayText());
+	}
+	catch (const Exception& ex)
+	{
+		destroy_images(images);
+
+		response.setStatus(HTTPResponse::HTTP_CONFLICT);
+		mi_headers_apply(response, MI_HEADERS_JSON);
+
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnStream(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	if (mi_settings_worker_pool()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_IMPLEMENTED);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "streams need server.mode = classic";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		OnNoLicense(request, response);
+		return;
+	}
+#endif
+	try {
+		mi_stream_serve(request, response, request_schema(request));
+	}
+	catch (const Exception& ex)
+	{
+		//. not a valid upgrade request, nothing was sent yet.
+		if (response.sent()) return;
+		response.setStatus(HTTPResponse::HTTP_BAD_REQUEST);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const std::string& text = ex.displayText();
+		response.sendBuffer(text.data(), text.size());
+	}
+}
+
+void MyRequestHandler::OnCacheStats(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	Object::Ptr root = new Object;
+	root->set("enabled", g_pResultCache != NULL);
+	if (g_pResultCache != NULL) {
+		root->set("hits", g_pResultCache->hits());
+		root->set("misses", g_pResultCache->misses());
+		root->set("evictions", g_pResultCache->evictions());
+		root->set("entries", (uint64_t)g_pResultCache->entries());
+		root->set("capacity", (uint64_t)g_pResultCache->max_entries());
+	}
+	ArenaOStream oss;
+	Stringifier::stringify(root, oss);
+	const ArenaString& out = oss.str();
+
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnStats(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	if (!g_Settings.statsEnable) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer("stats disabled", 14);
+		return;
+	}
+	ArenaString out;
+	mi_stats_json(out);
+
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnTrace(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	int nSeconds = 10;
+	Poco::URI uri(request.getURI());
+	Poco::URI::QueryParameters params = uri.getQueryParameters();
+	for (size_t i = 0; i < params.size(); i++) {
+		if (params[i].first == "seconds") Poco::NumberParser::tryParse(params[i].second, nSeconds);
+	}
+	if (nSeconds < 1) nSeconds = 1;
+
+	ArenaOStream oss;
+	mi_trace_dump(oss, nSeconds);
+	const ArenaString& out = oss.str();
+
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnProfile(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	const char* pszRefused = NULL;
+	if (!g_Settings.profileEnable) pszRefused = "profiling is disabled ([profile] enable)";
+	else if (!g_Settings.profileAllowRemote && !mi_local_client(request.clientAddress())) pszRefused = "profiling is only accepted from localhost";
+	if (pszRefused != NULL) {
+		response.setStatus(HTTPResponse::HTTP_FORBIDDEN);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer(pszRefused, strlen(pszRefused));
+		return;
+	}
+
+	int nSeconds = 10, nHz = g_Settings.profileHz;
+	Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+	for (size_t i = 0; i < params.size(); i++) {
+		if (params[i].first == "seconds") Poco::NumberParser::tryParse(params[i].second, nSeconds);
+		else if (params[i].first == "hz") Poco::NumberParser::tryParse(params[i].second, nHz);
+	}
+	nSeconds = std::min(std::max(nSeconds, 1), std::max(g_Settings.profileMaxSeconds, 1));
+	nHz = std::min(std::max(nHz, 1), 1000);
+
+	std::string strOut, strErr;
+	if (!mi_profile_capture(nSeconds, nHz, strOut, strErr)) {
+		response.setStatus(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer(strErr.data(), strErr.size());
+		return;
+	}
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_TEXT);
+	mi_send_body(request, response, strOut.data(), strOut.size());
+}
+
+void MyRequestHandler::OnLocks(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	const char* pszRefused = NULL;
+	int nStatus = HTTPResponse::HTTP_FORBIDDEN;
+	if (!mi_lock_profiling()) {
+		pszRefused = "lock profiling is not compiled in (cmake -DMI_LOCK_PROFILE=ON)";
+		nStatus = HTTPResponse::HTTP_NOT_FOUND;
+	}
+	else if (!g_Settings.profileAllowRemote && !mi_local_client(request.clientAddress())) pszRefused = "lock profiling is only accepted from localhost";
+	if (pszRefused != NULL) {
+		response.setStatus((HTTPResponse::HTTPStatus)nStatus);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		response.sendBuffer(pszRefused, strlen(pszRefused));
+		return;
+	}
+
+	std::vector<LockSnapshot> vLocks;
+	mi_lock_snapshot(vLocks);
+	Array::Ptr arr = new Array;
+	for (const LockSnapshot& l : vLocks) {
+		Object::Ptr o = new Object;
+		o->set("name", l.name);
+		o->set("acquired", (Poco::UInt64)l.acquired);
+		o->set("contended", (Poco::UInt64)l.contended);
+		o->set("contended_ratio", l.acquired ? (double)l.contended / l.acquired : 0.0);
+		o->set("wait_ms", l.waitNs / 1e6);
+		o->set("max_wait_ms", l.maxWaitNs / 1e6);
+		o->set("avg_wait_us", l.contended ? l.waitNs / 1e3 / l.contended : 0.0);
+		o->set("hold_ms", l.holdNs / 1e6);
+		o->set("avg_hold_us", l.acquired ? l.holdNs / 1e3 / l.acquired : 0.0);
+		arr->add(o);
+	}
+	Object::Ptr root = new Object;
+	root->set("locks", arr);
+
+	//. the figures shown are the ones before the reset.
+	Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+	for (size_t i = 0; i < params.size(); i++) {
+		if (params[i].first == "reset" && params[i].second != "0") mi_lock_reset();
+	}
+
+	ArenaOStream oss;
+	Stringifier::stringify(root, oss);
+	const ArenaString& out = oss.str();
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnSaturation(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	if (!mi_saturation_enabled()) {
+		response.setStatus(HTTPResponse::HTTP_NOT_FOUND);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "saturation is disabled ([saturation] enable)";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+
+	SaturationSample sample;
+	mi_saturation_get(sample);
+	Object::Ptr root = new Object;
+	root->set("saturation", sample.saturation);
+	root->set("utilization", sample.utilization);
+	root->set("queue_wait_ms", sample.queueWaitMs);
+	root->set("slo_ms", sample.sloMs);
+	root->set("slots", sample.slots);
+	root->set("inflight", sample.inflight);
+	root->set("brownout", mi_brownout_active());
+	ArenaOStream oss;
+	Stringifier::stringify(root, oss);
+	const ArenaString& out = oss.str();
+
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnUnknown(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_TEXT);
+
+	response.sendBuffer("Not found", 9);
+}
+
+void MyRequestHandler::OnOptions(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	response.setStatus(HTTPResponse::HTTP_NO_CONTENT);
+	mi_headers_apply(response, MI_HEADERS_PREFLIGHT);
+
+	response.setContentLength(0);
+	response.send();
+}
+
+void MyRequestHandler::OnMethodNotAllowed(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	response.setStatus(HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+	mi_headers_apply(response, MI_HEADERS_TEXT);
+	response.set("Allow", g_Router.allowed(request.getURI()));
+
+	response.sendBuffer("Method not allowed", 18);
+}
+
+void MyRequestHandler::OnNoLicense(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_TEXT);
+
+	response.sendBuffer("Please input license.", 21);
+}
+
+void MyRequestHandler::OnReady(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	bool bReady = mi_ready();
+	response.setStatus(bReady ? HTTPResponse::HTTP_OK : HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+	mi_headers_apply(response, MI_HEADERS_TEXT);
+
+	const char* pszText = bReady ? "ready" : (mi_draining() ? "draining" : "warming up");
+	response.sendBuffer(pszText, strlen(pszText));
+}
+
+void MyRequestHandler::OnHealth(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	bool bHealthy = false;
+	Object::Ptr root = mi_health_report(bHealthy);
+	ArenaOStream oss;
+	Stringifier::stringify(root, oss);
+	const ArenaString& out = oss.str();
+
+	response.setStatus(bHealthy ? HTTPResponse::HTTP_OK : HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnReload(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	if (!g_Settings.reloadAllowRemote && !mi_local_client(request.clientAddress())) {
+		response.setStatus(HTTPResponse::HTTP_FORBIDDEN);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "reload is only accepted from localhost";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+
+	bool bStart = request.getMethod() == HTTPRequest::HTTP_POST;
+	if (bStart) {
+		//. canary controls act on the canary alone, a bare POST reloads.
+		bool bCanary = false;
+		Poco::URI::QueryParameters params = Poco::URI(request.getURI()).getQueryParameters();
+		for (size_t i = 0; i < params.size(); i++) {
+			if (params[i].first == "canary") g_Supervisor.set_canary_percent(atoi(params[i].second.c_str()));
+			else if (params[i].first == "promote" && params[i].second != "0") g_Supervisor.promote();
+			else if (params[i].first == "rollback" && params[i].second != "0") g_Supervisor.rollback();
+			else continue;
+			bCanary = true;
+		}
+		if (!bCanary) g_Supervisor.reload();
+	}
+
+	Object::Ptr root = new Object;
+	root->set("generation", g_Supervisor.generation());
+	root->set("canary_generation", g_Supervisor.canary_generation());
+	root->set("canary_percent", g_Supervisor.canary_percent());
+	root->set("reloading", bStart || g_Supervisor.reloading());
+	root->set("last_error", g_Supervisor.last_error());
+	ArenaOStream oss;
+	Stringifier::stringify(root, oss);
+	const ArenaString& out = oss.str();
+
+	response.setStatus(bStart ? HTTPResponse::HTTP_ACCEPTED : HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnConfig(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	if (!g_Settings.reloadAllowRemote && !mi_local_client(request.clientAddress())) {
+		response.setStatus(HTTPResponse::HTTP_FORBIDDEN);
+		mi_headers_apply(response, MI_HEADERS_TEXT);
+		const char* pszText = "reload is only accepted from localhost";
+		response.sendBuffer(pszText, strlen(pszText));
+		return;
+	}
+
+	std::string strErr;
+	bool bOk = request.getMethod() != HTTPRequest::HTTP_POST || mi_config_reload(strErr);
+	//. the new snapshot, not the one this request pinned.
+	ConfigSnapshotRef pConfig = mi_config_current();
+
+	Object::Ptr root = new Object;
+	root->set("version", pConfig ? pConfig->version : 0);
+	root->set("source", pConfig ? pConfig->settings.source : g_Settings.source);
+	if (!bOk) root->set("error", strErr);
+	ArenaOStream oss;
+	Stringifier::stringify(root, oss);
+	const ArenaString& out = oss.str();
+
+	response.setStatus(bOk ? HTTPResponse::HTTP_OK : HTTPResponse::HTTP_UNPROCESSABLE_ENTITY);
+	mi_headers_apply(response, MI_HEADERS_JSON);
+	mi_send_body(request, response, out.data(), out.size());
+}
+
+void MyRequestHandler::OnStatus(HTTPServerRequest& request, HTTPServerResponse& response)
+{
+	response.setStatus(HTTPResponse::HTTP_OK);
+	mi_headers_apply(response, MI_HEADERS_TEXT);
+
+	std::shared_ptr<const std::string> pStatus = g_License.status();
+	response.sendBuffer(pStatus->data(), pStatus->size());
 }
\ No newline at end of file
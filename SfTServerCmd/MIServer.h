@@ -1,6 +1,32 @@
 #pragma once
 
 #include "MiConf.h"
+#include "MiAccessLog.h"
+#include "MiBinaryServer.h"
+#include "MiCompress.h"
+#include "MiConfig.h"
+#include "MiConnection.h"
+#include "MiContext.h"
+#include "MiHeaders.h"
+#include "MiHealth.h"
+#include "MiHttp2Server.h"
+#include "MiImage.h"
+#include "MiImageInfo.h"
+#include "MiSettings.h"
+#include "MiArena.h"
+#include "MiBufferPool.h"
+#include "MiCapture.h"
+#include "MiRouter.h"
+#include "MiMeta.h"
+#include "MiMetrics.h"
+#include "MiNuma.h"
+#include "MiProactorServer.h"
+#include "MiReactorServer.h"
+#include "MiStartup.h"
+#include "MiStream.h"
+#include "MiTenants.h"
+#include "MiTls.h"
+#include "MiWarmup.h"
 #include "Poco/Net/HTTPServer.h"
 #include "Poco/Net/HTTPRequestHandler.h"
 #include "Poco/Net/HTTPServerRequest.h"
@@ -17,8 +43,6 @@
 #include "Poco/Net/MessageHeader.h"
 #include "Poco/Net/MediaType.h"
 #include <Poco/Net/NameValueCollection.h>
-#include <Poco/Net/HTMLForm.h>
-#include "Poco/Net/PartHandler.h"
 #include <Poco/StringTokenizer.h>
 
 #include <Poco/Net/MessageHeader.h>
@@ -34,6 +58,7 @@
 #include "Poco/Base64Encoder.h"
 #include <iostream>
 #include "../cmn/MiKeyMgr.h"
+#include <functional>
 #include <unordered_map>
 #include <string>
 
@@ -51,134 +76,296 @@ using namespace std;
 class MyRequestHandler : public HTTPRequestHandler {
 public:
 	void OnVersion(HTTPServerRequest& request, HTTPServerResponse& response);
-	//. 	
-	void OnProcessProc(HTTPServerRequest& request, HTTPServerResponse& response, Poco::Dynamic::Var procName, int base64 = 0);
+	//. one encoded image checked : Input is the body format (InputMultipart, InputBase64Json,
+	//. InputRaw in MIServer.cpp), one instantiation per endpoint so the per-format reading
+	//. is bound at compile time.
+	template <class Input>
+	void OnProcessImage(HTTPServerRequest& request, HTTPServerResponse& response);
 
 	void OnUnknown(HTTPServerRequest& request, HTTPServerResponse& response);
 	void OnNoLicense(HTTPServerRequest& request, HTTPServerResponse& response);
 	void OnStatus(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. load balancer readiness : 200 once the warm-up has finished, 503 before.
+	void OnReady(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. JSON readiness report, see MiHealth.h
+	void OnHealth(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. POST starts a pipeline generation reload (202), GET reports its state.
+	void OnReload(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. POST reads the settings file again into a new configuration snapshot, GET reports its version.
+	void OnConfig(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. several images in one request, evaluated with one batched SDK call.
+	void OnProcessBatch(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. frames of one capture fused into a single verdict.
+	void OnProcessSequence(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. quality-ranks a burst of frames and checks the best few, see MiBurst.h
+	void OnProcessBurst(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnProcessFaces(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnProcessOnboard(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnProcessVideo(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnProcessSession(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. one decoded 24-bit or NV12 / I420 frame (octet-stream body, GD_PIXELS_HEADER_* geometry).
+	void OnProcessPixels(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. GD_API_SHM : image in the local proxy's shared memory, see MiShm.h
+	void OnProcessShm(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. GD_API_ANALYZE : liveness plus the detected faces of one image, see MiAnalyze.h
+	void OnAnalyze(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. GD_API_DETECT : face boxes of a batch body, no liveness, see MiDetect.h
+	void OnDetect(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. GD_API_QUALITY : quality verdicts of a batch body, see MiQuality.h
+	void OnQuality(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. GD_API_JOBS : queues the images of a batch body (202), GD_API_JOBS/<id> : its state and results.
+	void OnJobSubmit(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnJobStatus(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnStream(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnCacheStats(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. rolling 1m / 5m / 15m rps, error rate and latency quantiles, see MiStats.h
+	void OnStats(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. sampled request spans as Chrome trace-event JSON, ?seconds=N
+	void OnTrace(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. collapsed CPU stacks of the process, ?seconds=N&hz=H, see MiProfile.h
+	void OnProfile(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. wait / hold time and contention per named lock, ?reset=1, see MiLock.h
+	void OnLocks(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. autoscaling signal as JSON, see MiSaturation.h
+	void OnSaturation(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnOptions(HTTPServerRequest& request, HTTPServerResponse& response);
+	void OnMethodNotAllowed(HTTPServerRequest& request, HTTPServerResponse& response);
 public:
 	void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override {
+		//. request-scoped scratch is released here in one step, see MiArena.h.
+		ArenaScope arena;
+		mi_numa_pin_thread();
+		RequestScope ctx(request);
+		AccessScope access(request, response);
 		try {
-			OutputDebugStringA(request.getURI().c_str());
-			if (request.getURI().compare(GD_API_VERSION) == 0) {
-				OnVersion(request, response);
+			CaptureScope capture(request, response);
+			HTTPServerRequest& req = capture.request();
+			//. a declared body over the limit is refused before any of it is read.
+			if (request.hasContentLength() && request.getContentLength64() > (Poco::Int64)g_Settings.maxBodyMb * 1024 * 1024) {
+				response.setStatus(HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE);
+				mi_headers_apply(response, MI_HEADERS_TEXT);
+				response.setKeepAlive(false);
+				const char* pszText = "Body exceeds server.max_body_mb";
+				response.sendBuffer(pszText, strlen(pszText));
 				return;
 			}
-			if (request.getURI().compare(GD_API_FULL_PROCESS) == 0) {
-				OnProcessProc(request, response, "FullProcess");
+			bool bPathKnown = false;
+			RouteFn fn = g_Router.find(req.getMethod(), req.getURI(), &bPathKnown);
+			if (fn != NULL) {
+				fn(*this, req, response);
 				return;
 			}
-			if (request.getURI().compare(GD_API_FULL_PROCESS_BASE64) == 0) {
-				OnProcessProc(request, response, "FullProcess", 1);
-				return;
-			}
-			if (request.getURI().compare(GD_API_STATUS) == 0 ){
-				OnStatus(request, response);
+			if (bPathKnown) {
+				OnMethodNotAllowed(req, response);
 				return;
 			}
 
-			OnUnknown(request, response);
+			OnUnknown(req, response);
 		}
 		catch (Poco::Exception& ex) {
+			if (response.sent()) return;
+			std::string text = "Error: " + ex.displayText();
 			response.setStatus(HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
-			response.send() << "Error: " << ex.displayText();
+			mi_headers_apply(response, MI_HEADERS_TEXT);
+			response.sendBuffer(text.data(), text.size());
 		}
 
 	}
+
+	//. the server deletes the handler after every request; keep one block per
+	//. worker thread so the factory does not hit the heap each time.
+	static void* operator new(size_t p_nSize);
+	static void operator delete(void* p_pMem);
 };
 
+//. registers the API routes in g_Router, called once before the server starts.
+void mi_router_init();
+
+//. everything the routes run on - license refresher, supervisor, pool, engines, backend,
+//. caches, batcher - from g_Settings, and its teardown. launch() serves on them,
+//. SfTServerCmd --batch (MiBatchCli.h) uses them without a listener.
+void mi_services_start();
+void mi_services_stop();
+
 // Define a request handler factory to create instances of MyRequestHandler
 class MyRequestHandlerFactory : public HTTPRequestHandlerFactory {
 public:
 	HTTPRequestHandler* createRequestHandler(const HTTPServerRequest&) override {
 		return new MyRequestHandler;
 	}
+	//. kept-alive connections close after the request they are serving.
+	void drain() {
+		const bool bAbort = false;
+		serverStopped(this, bAbort);
+	}
 };
 // Define the main application class
 class ClaHTTPServerWrapper : public ServerApplication {
 public:
 	void launch();
 protected:
+	//. after the main listener, on the reactor's workers when there are any; a failure leaves HTTP/1.1 serving.
+	static void start_http2() {
+		if (!g_Settings.http2Enable) return;
+		std::string strErr;
+		if (mi_http2_start(strErr)) cout << "HTTP/2 (h2c) on port " << g_Settings.http2Port << "." << endl;
+		else cout << "HTTP/2 listener failed : " << strErr << endl;
+	}
+
 	int main(const vector<string>&) override {
-		// Set up server parameters
-		HTTPServerParams* params = new HTTPServerParams;
-		params->setMaxQueued(100);
-		params->setMaxThreads(16);
+		if (g_Settings.binaryEnable) {
+			std::string strErr;
+			if (!mi_binary_start(strErr)) {
+				cout << "Binary server failed : " << strErr << endl;
+				return Application::EXIT_SOFTWARE;
+			}
+			cout << "Binary protocol on port " << g_Settings.binaryPort << "." << endl;
+		}
 
-		// Create a new HTTPServer instance
-		HTTPServer server(new MyRequestHandlerFactory, ServerSocket(GD_PORT_IN), params);
+		if (g_Settings.serverMode == "reactor") {
+			std::string strErr;
+			if (!mi_reactor_start(strErr)) {
+				cout << "Reactor server failed : " << strErr << endl;
+				return Application::EXIT_SOFTWARE;
+			}
+			cout << "Server started on port " << g_Settings.port << " (reactor, " << g_Settings.ioThreads << " io / " << g_Settings.inferenceWorkers << " inference threads)." << endl;
+			if (!g_Settings.localSocket.empty()) cout << "Local socket " << g_Settings.localSocket << "." << endl;
+			if (g_Settings.tlsEnable) cout << "TLS listener needs server.mode = classic, not started." << endl;
+			start_http2();
+			mi_startup_listening();
+			waitForTerminationRequest();
+			mi_ready_drain();
+			mi_http2_stop();
+			mi_reactor_drain(g_Settings.drainSec);
+			mi_reactor_stop();
+			mi_binary_stop();
+			cout << "Server stopped." << endl;
+			return Application::EXIT_OK;
+		}
+
+		if (g_Settings.serverMode == "proactor") {
+			std::string strErr;
+			if (!mi_proactor_start(strErr)) {
+				cout << "Proactor server failed : " << strErr << endl;
+				return Application::EXIT_SOFTWARE;
+			}
+			cout << "Server started on port " << g_Settings.port << " (proactor, " << g_Settings.ioThreads << " io / " << g_Settings.inferenceWorkers << " inference threads)." << endl;
+			if (!g_Settings.localSocket.empty()) cout << "Local socket " << g_Settings.localSocket << "." << endl;
+			if (g_Settings.tlsEnable) cout << "TLS listener needs server.mode = classic, not started." << endl;
+			start_http2();
+			mi_startup_listening();
+			waitForTerminationRequest();
+			mi_ready_drain();
+			mi_http2_stop();
+			mi_proactor_drain(g_Settings.drainSec);
+			mi_proactor_stop();
+			mi_binary_stop();
+			cout << "Server stopped." << endl;
+			return Application::EXIT_OK;
+		}
 
-		// Start the server
-		server.start();
-		cout << "Server started on port " << GD_PORT_IN << "." << endl;
+		// Set up server parameters : p_nShare listeners split max_threads and max_queued
+		auto makeParams = [](int p_nShare) {
+			HTTPServerParams* params = new HTTPServerParams;
+			params->setMaxQueued(std::max(1, g_Settings.maxQueued / p_nShare));
+			params->setMaxThreads(std::max(1, g_Settings.maxThreads / p_nShare));
+			params->setThreadIdleTime(Poco::Timespan(g_Settings.threadIdleSec, 0));
+			params->setKeepAlive(g_Settings.keepAlive);
+			params->setMaxKeepAliveRequests(g_Settings.maxKeepAliveRequests);
+			params->setKeepAliveTimeout(Poco::Timespan(g_Settings.keepAliveTimeoutSec, 0));
+			params->setTimeout(Poco::Timespan(g_Settings.timeoutSec, 0));
+			return HTTPServerParams::Ptr(params);
+		};
+
+		// Create the HTTP servers : HTTP connections with the [server] socket options, one
+		// per SO_REUSEPORT listen socket (server.listeners), each with its own accept thread
+		HTTPServerParams::Ptr pParams = makeParams(1);
+		MyRequestHandlerFactory* pFactory = new MyRequestHandlerFactory;
+		HTTPRequestHandlerFactory::Ptr pFactoryRef(pFactory);
+		int nListeners = mi_listeners();
+		HTTPServerParams::Ptr pListenParams = nListeners > 1 ? makeParams(nListeners) : pParams;
+		std::vector<std::unique_ptr<TCPServer>> vServers;
+		for (int i = 0; i < nListeners; i++) {
+			vServers.emplace_back(new TCPServer(new TunedConnectionFactory(pListenParams, pFactoryRef), mi_listen_socket(), pListenParams));
+			vServers.back()->setConnectionFilter(new AcceptStamp);
+			mi_metrics_bind_server(vServers.back().get(), i);
+		}
+
+		// Start the servers
+		for (auto& s : vServers) s->start();
+		cout << "Server started on port " << g_Settings.port;
+		if (nListeners > 1) cout << " (" << nListeners << " SO_REUSEPORT listeners)";
+		else if (mi_reuse_port()) cout << " (SO_REUSEPORT)";
+		cout << "." << endl;
+		if (g_Settings.listeners > 1 && !mi_reuse_port()) cout << "server.listeners needs server.reuse_port on Linux, one listener." << endl;
+
+		// Local socket : the same factory and parameters for a co-located caller
+		std::unique_ptr<TCPServer> pLocalServer;
+		if (!g_Settings.localSocket.empty()) {
+			try {
+				pLocalServer.reset(new TCPServer(new TunedConnectionFactory(pParams, pFactoryRef), mi_local_listen_socket(), pParams));
+				pLocalServer->setConnectionFilter(new AcceptStamp);
+				pLocalServer->start();
+				cout << "Local socket " << g_Settings.localSocket << "." << endl;
+			}
+			catch (Poco::Exception& ex) {
+				cout << "Local socket failed : " << ex.displayText() << endl;
+			}
+		}
+
+		// HTTPS on tls.port : the same factory and parameters, sockets that speak TLS
+		std::unique_ptr<TCPServer> pTlsServer;
+		if (g_Settings.tlsEnable) {
+			std::string strErr;
+			try {
+				if (mi_tls_init(strErr)) {
+					pTlsServer.reset(new TCPServer(new TunedConnectionFactory(pParams, pFactoryRef), mi_tls_listen_socket(), pParams));
+					pTlsServer->start();
+					cout << "TLS on port " << g_Settings.tlsPort << " (" << mi_tls_cipher_order() << " cipher order)." << endl;
+				}
+			}
+			catch (Poco::Exception& ex) {
+				strErr = ex.displayText();
+			}
+			if (!pTlsServer) cout << "TLS listener failed : " << strErr << endl;
+		}
+		start_http2();
+		mi_startup_listening();
 
 		// Wait for CTRL-C or termination signal
 		waitForTerminationRequest();
 
+		// Drain : no new connections, the open ones finish their current request
+		mi_ready_drain();
+		mi_http2_stop();
+		for (auto& s : vServers) s->stop();
+		if (pTlsServer) pTlsServer->stop();
+		if (pLocalServer) pLocalServer->stop();
+		pFactory->drain();
+		auto connections = [&]() {
+			int n = 0;
+			for (auto& s : vServers) n += s->currentConnections();
+			return n;
+		};
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(g_Settings.drainSec);
+		while ((connections() > 0 || (pTlsServer && pTlsServer->currentConnections() > 0) || (pLocalServer && pLocalServer->currentConnections() > 0))
+			&& std::chrono::steady_clock::now() < deadline) {
+			Poco::Thread::sleep(50);
+		}
+		cout << "Server drained, " << connections() << " connection(s) left." << endl;
+
 		// Stop the server
-		server.stop();
+		for (int i = 0; i < nListeners; i++) mi_metrics_bind_server(NULL, i);
+		if (pLocalServer) mi_local_socket_remove();
+		mi_binary_stop();
 		cout << "Server stopped." << endl;
 
 		return Application::EXIT_OK;
 	}
 };
 
-class MyPartHandler : public Poco::Net::PartHandler
-{
-public:
-	void handlePart(const Poco::Net::MessageHeader& header, std::istream& stream) override
-	{
-		if (header.has("Content-Disposition"))
-		{
-			std::string disposition = header.get("Content-Disposition");
-			if (disposition.find("form-data") != std::string::npos)
-			{
-				std::string name = extractParameter(disposition, "name");
-				std::string filename = extractParameter(disposition, "filename");
-
-				if (!filename.empty())
-				{
-					// Handle file part
-					std::ostringstream binaryStream;
-					Poco::StreamCopier::copyStream(stream, binaryStream);
-					_fileData = binaryStream.str();
-					_filename = filename;
-
-					// Encode the binary data to base64
-					std::ostringstream base64Stream;
-					Poco::Base64Encoder base64Encoder(base64Stream);
-					base64Encoder << _fileData;
-					base64Encoder.close();
-					_base64Data = base64Stream.str();
-				}
-			}
-		}
-	}
+//. body or image over the [server] limits, answered with 413.
+POCO_DECLARE_EXCEPTION(, TooLargeException, Poco::DataException)
+//. image URL that could not be fetched (MiFetch.h), answered with code() as the HTTP status.
+POCO_DECLARE_EXCEPTION(, FetchException, Poco::IOException)
 
-	const std::string& fileData() const { return _fileData; }
-	const std::string& base64Data() const { return _base64Data; }
-	const std::string& filename() const { return _filename; }
-
-private:
-	std::string _fileData;
-	std::string _base64Data;
-	std::string _filename;
-
-	std::string extractParameter(const std::string& headerValue, const std::string& paramName)
-	{
-		std::string param = paramName + "=\"";
-		size_t startPos = headerValue.find(param);
-		if (startPos != std::string::npos)
-		{
-			startPos += param.length();
-			size_t endPos = headerValue.find("\"", startPos);
-			if (endPos != std::string::npos)
-			{
-				return headerValue.substr(startPos, endPos - startPos);
-			}
-		}
-		return "";
-	}
-
-};
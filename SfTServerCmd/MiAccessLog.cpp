@@ -0,0 +1,311 @@
+#include "MiAccessLog.h"
+#include "MiConf.h"
+#include "MiMetrics.h"
+#include "FaceSdkApi.h"
+#include "Poco/AsyncChannel.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/FileChannel.h"
+#include "Poco/Message.h"
+#include "Poco/Path.h"
+#include "Poco/Timestamp.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define LD_RING_SIZE	GD_ACCESS_LOG_RING
+
+struct AccessRecord {
+	int64_t		tsMs;			//. system clock at the end of the request
+	char		id[48];
+	char		method[8];
+	char		path[64];
+	const char*	endpoint;		//. NULL when no RequestTimer ran
+	int			status;
+	int64_t		bytesIn;		//. -1 without Content-Length
+	int64_t		totalUs;
+	int64_t		decodeUs;
+	int64_t		inferenceUs;
+	int			images;
+	int			decodes;		//. uploads decoded (MiImage.h)
+	const char*	verdict;		//. of the last image, NULL without a result
+	int			err;			//. first STATUS other than OK, else OK
+};
+
+//. written by one request thread, read by the writer thread.
+struct AccessRing {
+	std::atomic<uint64_t>	head;
+	std::atomic<uint64_t>	tail;
+	AccessRecord			slots[LD_RING_SIZE];
+	AccessRing() : head(0), tail(0) {}
+};
+
+static AccessLogSettings						lv_settings;
+static std::atomic<bool>						lv_bEnabled(false);
+static std::atomic<uint64_t>					lv_nRequests(0);		//. ended, for the sampling
+static std::atomic<uint64_t>					lv_nIds(0);				//. ids of requests without GD_REQUEST_ID_HEADER
+static Poco::AutoPtr<Poco::AsyncChannel>		lv_pChannel;
+static std::mutex								lv_mtxRings;		//. ring registration and draining only
+static std::vector<std::unique_ptr<AccessRing>>	lv_vRings;
+static std::thread								lv_writer;
+static std::mutex								lv_mtxWriter;
+static std::condition_variable					lv_cvWriter;
+static bool										lv_bStop = false;
+static const std::string						lv_strNoId;
+
+static thread_local AccessRing*								lv_pRing = NULL;
+static thread_local bool									lv_bActive = false;
+static thread_local AccessRecord							lv_cur;
+static thread_local std::chrono::steady_clock::time_point	lv_start;
+
+static AccessRing* thread_ring()
+{
+	if (lv_pRing == NULL) {
+		//. rings outlive their threads, the writer may still be reading one.
+		std::unique_ptr<AccessRing> p(new AccessRing);
+		std::lock_guard<std::mutex> lock(lv_mtxRings);
+		lv_pRing = p.get();
+		lv_vRings.push_back(std::move(p));
+	}
+	return lv_pRing;
+}
+
+//. copies p_str so it can be written into a JSON string as is.
+static void copy_safe(char* p_pszDst, size_t p_nSize, const std::string& p_str, size_t p_nEnd = std::string::npos)
+{
+	size_t n = p_str.size() < p_nEnd ? p_str.size() : p_nEnd;
+	if (n > p_nSize - 1) n = p_nSize - 1;
+	for (size_t i = 0; i < n; i++) {
+		unsigned char c = (unsigned char)p_str[i];
+		p_pszDst[i] = (c < 0x20 || c >= 0x7f || c == '"' || c == '\\') ? '_' : (char)c;
+	}
+	p_pszDst[n] = 0;
+}
+
+static int64_t to_ms10(int64_t p_nUs)
+{
+	return (p_nUs + 50) / 100;		//. tenths of a millisecond
+}
+
+static void write_record(const AccessRecord& p_r, std::string& p_line)
+{
+	char	buf[512];
+	int64_t	total = to_ms10(p_r.totalUs), decode = to_ms10(p_r.decodeUs), inference = to_ms10(p_r.inferenceUs);
+
+	p_line = "{\"ts\":\"";
+	p_line += Poco::DateTimeFormatter::format(Poco::Timestamp(p_r.tsMs * 1000), "%Y-%m-%dT%H:%M:%S.%iZ");
+	snprintf(buf, sizeof(buf), "\",\"id\":\"%s\",\"method\":\"%s\",\"path\":\"%s\",\"endpoint\":", p_r.id, p_r.method, p_r.path);
+	p_line += buf;
+	if (p_r.endpoint != NULL) { p_line += '"'; p_line += p_r.endpoint; p_line += '"'; }
+	else p_line += "null";
+	snprintf(buf, sizeof(buf), ",\"status\":%d,\"bytes_in\":%lld,\"total_ms\":%lld.%d,\"decode_ms\":%lld.%d,\"inference_ms\":%lld.%d,\"images\":%d,\"decodes\":%d,\"verdict\":",
+		p_r.status, (long long)p_r.bytesIn, (long long)(total / 10), (int)(total % 10), (long long)(decode / 10), (int)(decode % 10),
+		(long long)(inference / 10), (int)(inference % 10), p_r.images, p_r.decodes);
+	p_line += buf;
+	if (p_r.verdict != NULL) { p_line += '"'; p_line += p_r.verdict; p_line += '"'; }
+	else p_line += "null";
+	p_line += ",\"err\":";
+	if (p_r.images > 0) p_line += std::to_string(p_r.err);
+	else p_line += "null";
+	p_line += '}';
+}
+
+static void drain()
+{
+	std::string line;
+	std::lock_guard<std::mutex> lock(lv_mtxRings);
+	for (auto& pRing : lv_vRings) {
+		uint64_t tail = pRing->tail.load(std::memory_order_relaxed);
+		uint64_t head = pRing->head.load(std::memory_order_acquire);
+		for (; tail < head; tail++) {
+			write_record(pRing->slots[tail % LD_RING_SIZE], line);
+			lv_pChannel->log(Poco::Message("access", line, Poco::Message::PRIO_INFORMATION));
+		}
+		pRing->tail.store(tail, std::memory_order_release);
+	}
+}
+
+static void write_summary()
+{
+	std::string line = "{\"ts\":\"";
+	line += Poco::DateTimeFormatter::format(Poco::Timestamp(), "%Y-%m-%dT%H:%M:%S.%iZ");
+	line += "\",\"summary_sec\":";
+	line += std::to_string(lv_settings.summarySec);
+	line += ',';
+	mi_stats_summary(line, lv_settings.summarySec);
+	line += '}';
+	lv_pChannel->log(Poco::Message("access", line, Poco::Message::PRIO_INFORMATION));
+}
+
+static void writer_loop()
+{
+	std::chrono::steady_clock::time_point nextSummary = std::chrono::steady_clock::now() + std::chrono::seconds(lv_settings.summarySec);
+	std::unique_lock<std::mutex> lock(lv_mtxWriter);
+	while (!lv_bStop) {
+		lv_cvWriter.wait_for(lock, std::chrono::milliseconds(GD_ACCESS_LOG_FLUSH_MS));
+		lock.unlock();
+		drain();
+		if (lv_settings.summarySec > 0 && std::chrono::steady_clock::now() >= nextSummary) {
+			write_summary();
+			nextSummary += std::chrono::seconds(lv_settings.summarySec);
+		}
+		lock.lock();
+	}
+}
+
+bool mi_access_log_init(const AccessLogSettings& p_settings, std::string& p_strErr)
+{
+	lv_settings = p_settings;
+	if (lv_settings.sampleEvery < 1) lv_settings.sampleEvery = 1;
+
+	try {
+		Poco::Path path(lv_settings.path);
+		path.makeAbsolute();
+		Poco::File(path.parent()).createDirectories();
+
+		Poco::AutoPtr<Poco::FileChannel> pFile(new Poco::FileChannel(path.toString()));
+		if (!lv_settings.rotation.empty()) {
+			pFile->setProperty(Poco::FileChannel::PROP_ROTATION, lv_settings.rotation);
+			pFile->setProperty(Poco::FileChannel::PROP_ARCHIVE, "timestamp");
+			if (lv_settings.purgeCount > 0) pFile->setProperty(Poco::FileChannel::PROP_PURGECOUNT, std::to_string(lv_settings.purgeCount));
+		}
+		pFile->setProperty(Poco::FileChannel::PROP_FLUSH, "false");
+		pFile->open();		//. a bad path fails here and not on the writer thread
+		lv_pChannel = new Poco::AsyncChannel(pFile);
+		lv_pChannel->open();
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		lv_pChannel = NULL;
+		return false;
+	}
+
+	lv_bStop = false;
+	lv_writer = std::thread(writer_loop);
+	lv_bEnabled.store(true, std::memory_order_release);
+	return true;
+}
+
+void mi_access_log_shutdown()
+{
+	if (!lv_bEnabled.exchange(false)) return;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxWriter);
+		lv_bStop = true;
+	}
+	lv_cvWriter.notify_one();
+	if (lv_writer.joinable()) lv_writer.join();
+	drain();
+	lv_pChannel->close();		//. the async channel writes its queue before it stops
+	lv_pChannel = NULL;
+}
+
+void mi_request_id(const Poco::Net::HTTPServerRequest& p_request, char* p_pszId, size_t p_nSize)
+{
+	const std::string& strId = p_request.get(GD_REQUEST_ID_HEADER, lv_strNoId);
+	if (!strId.empty()) copy_safe(p_pszId, p_nSize, strId);
+	else snprintf(p_pszId, p_nSize, "%016llx", (unsigned long long)(lv_nIds.fetch_add(1, std::memory_order_relaxed) + 1));
+}
+
+void mi_request_rename(const Poco::Net::HTTPServerRequest& p_request, const std::string& p_strId)
+{
+	if (p_strId.empty() || p_request.has(GD_REQUEST_ID_HEADER)) return;
+	char szId[48];
+	copy_safe(szId, sizeof(szId), p_strId);
+	RequestContext* ctx = mi_context();
+	if (ctx != NULL) snprintf(ctx->traceId, sizeof(ctx->traceId), "%s", szId);
+	if (lv_bActive) snprintf(lv_cur.id, sizeof(lv_cur.id), "%s", szId);
+	mi_audit_rename(szId);
+}
+
+void mi_access_log_begin(const Poco::Net::HTTPServerRequest& p_request, const char* p_pszId)
+{
+	lv_bActive = lv_bEnabled.load(std::memory_order_acquire);
+	if (!lv_bActive) return;
+
+	lv_start = std::chrono::steady_clock::now();
+	AccessRecord& r = lv_cur;
+	snprintf(r.id, sizeof(r.id), "%s", p_pszId);
+	copy_safe(r.method, sizeof(r.method), p_request.getMethod());
+	const std::string& strUri = p_request.getURI();
+	copy_safe(r.path, sizeof(r.path), strUri, strUri.find('?'));
+	r.endpoint = NULL;
+	r.bytesIn = p_request.getContentLength64();
+	r.decodeUs = 0;
+	r.inferenceUs = 0;
+	r.images = 0;
+	r.verdict = NULL;
+	r.err = OK;
+}
+
+void mi_access_log_end(int p_nStatus)
+{
+	if (!lv_bActive) return;
+	lv_bActive = false;
+
+	uint64_t n = lv_nRequests.fetch_add(1, std::memory_order_relaxed) + 1;
+	bool bLog = n % (uint64_t)lv_settings.sampleEvery == 0 || (lv_settings.errors && p_nStatus >= 400);
+	if (!bLog) return;
+
+	AccessRecord& r = lv_cur;
+	r.status = p_nStatus;
+	RequestContext* ctx = mi_context();
+	r.decodes = ctx != NULL ? ctx->decodes.load(std::memory_order_relaxed) : 0;
+	r.totalUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - lv_start).count();
+	r.tsMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	AccessRing* pRing = thread_ring();
+	uint64_t head = pRing->head.load(std::memory_order_relaxed);
+	if (head - pRing->tail.load(std::memory_order_acquire) >= LD_RING_SIZE) {
+		mi_metrics_access_drop();
+		return;
+	}
+	pRing->slots[head % LD_RING_SIZE] = r;
+	pRing->head.store(head + 1, std::memory_order_release);
+}
+
+void mi_access_log_endpoint(int p_nEndpoint)
+{
+	if (lv_bActive && lv_cur.endpoint == NULL) lv_cur.endpoint = mi_metrics_endpoint_name((MiEndpoint)p_nEndpoint);
+}
+
+void mi_access_log_stage(int p_nStage, double p_dSec)
+{
+	if (!lv_bActive) return;
+	int64_t us = (int64_t)(p_dSec * 1e6);
+	switch (p_nStage) {
+	case MI_STAGE_INGEST:
+	case MI_STAGE_IMAGE_CREATE:
+	case MI_STAGE_CROP:
+	case MI_STAGE_DECODE:
+	case MI_STAGE_CONVERT:
+		lv_cur.decodeUs += us;
+		break;
+	case MI_STAGE_LIVENESS:
+	case MI_STAGE_GATE:
+	case MI_STAGE_PREFILTER:
+	case MI_STAGE_ANALYZE:
+	case MI_STAGE_DETECT:
+	case MI_STAGE_QUALITY:
+		lv_cur.inferenceUs += us;
+		break;
+	default:
+		break;
+	}
+}
+
+void mi_access_log_result(const char* p_pszVerdict, int p_nErr)
+{
+	if (!lv_bActive) return;
+	lv_cur.images++;
+	lv_cur.verdict = p_pszVerdict;
+	if (lv_cur.err == OK) lv_cur.err = p_nErr;
+}
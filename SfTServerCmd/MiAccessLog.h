@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include "MiAudit.h"
+#include "MiContext.h"
+#include "MiStats.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+//. Structured access log ([access_log] settings), one JSON line per logged request :
+//. {"ts","id","method","path","endpoint","status","bytes_in","total_ms","decode_ms",
+//.  "inference_ms","images","decodes","verdict","err"}.
+//. The request thread only fills a thread-local record (stages via StageTimer, results via
+//. mi_json_result) and at the end copies it into its own ring (single producer / single
+//. consumer, no lock). A background thread drains the rings, formats the lines and hands
+//. them to a Poco::AsyncChannel in front of a rotating Poco::FileChannel, so neither the
+//. formatting nor the file write runs on a request thread. A full ring drops the record
+//. (mi_access_log_dropped_total on /metrics).
+//. One request in sample_every is logged; with errors, every status >= 400 is logged too.
+//. Every summary_sec the writer adds a per-endpoint summary line taken from the statistics core.
+
+struct AccessLogSettings {
+	std::string	path;
+	std::string	rotation;		//. FileChannel "rotation", e.g. "100 M", "daily"
+	int			purgeCount;		//. rotated files kept, 0 = all
+	int			sampleEvery;	//. 1 = every request
+	bool		errors;			//. status >= 400 bypasses the sampling
+	int			summarySec;		//. period of the summary lines (MiStats.h), 0 = none
+};
+
+bool mi_access_log_init(const AccessLogSettings& p_settings, std::string& p_strErr);
+//. writes what the rings still hold and closes the file.
+void mi_access_log_shutdown();
+
+//. GD_REQUEST_ID_HEADER when the client sent one, else a server counter; shared with MiAudit.
+void mi_request_id(const Poco::Net::HTTPServerRequest& p_request, char* p_pszId, size_t p_nSize);
+//. p_strId from the body of a request without GD_REQUEST_ID_HEADER (a JSON "request_id") :
+//. its context, access log record and audit rows take it. Ignored with the header.
+void mi_request_rename(const Poco::Net::HTTPServerRequest& p_request, const std::string& p_strId);
+
+//. starts / ends the record of the calling thread; p_nStatus is the HTTP status sent.
+void mi_access_log_begin(const Poco::Net::HTTPServerRequest& p_request, const char* p_pszId);
+void mi_access_log_end(int p_nStatus);
+
+//. no-ops outside a request begun on this thread.
+//. p_nEndpoint is a MiEndpoint, p_nStage a MiStage (MiMetrics.h).
+void mi_access_log_endpoint(int p_nEndpoint);
+void mi_access_log_stage(int p_nStage, double p_dSec);
+//. one image result; p_pszVerdict is a string literal (mi_result_verdict).
+void mi_access_log_result(const char* p_pszVerdict, int p_nErr);
+
+//. scoped request record (access log, audit rows, /stats errors) for handleRequest.
+class AccessScope {
+public:
+	AccessScope(const Poco::Net::HTTPServerRequest& p_request, const Poco::Net::HTTPServerResponse& p_response) : m_response(p_response)
+	{
+		//. the trace id of the request context (MiContext.h) when there is one.
+		char szId[48];
+		RequestContext* ctx = mi_context();
+		if (ctx != NULL) snprintf(szId, sizeof(szId), "%s", ctx->traceId);
+		else mi_request_id(p_request, szId, sizeof(szId));
+		mi_access_log_begin(p_request, szId);
+		mi_audit_begin(szId);
+	}
+	~AccessScope()
+	{
+		mi_audit_end();
+		mi_access_log_end((int)m_response.getStatus());
+		mi_stats_status((int)m_response.getStatus());
+	}
+
+private:
+	const Poco::Net::HTTPServerResponse& m_response;
+};
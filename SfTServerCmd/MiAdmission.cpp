@@ -0,0 +1,155 @@
+#include "MiAdmission.h"
+#include "MiConf.h"
+#include "MiContext.h"
+#include "MiHeaders.h"
+#include "MiMetrics.h"
+#include "Poco/NumberParser.h"
+#include <atomic>
+
+using namespace std::chrono;
+
+static bool							lv_bEnabled = false;
+static int							lv_nConcurrency = 1;
+static int							lv_nMaxWaitMs = 0;
+static int							lv_nDefaultDeadlineMs = 0;
+static std::atomic<int>				lv_nInflight(0);
+static std::atomic<int64_t>			lv_lServiceUs(0);		//. EWMA of the handler time
+
+static thread_local steady_clock::time_point	lv_tArrival;
+
+void mi_admission_init(int p_nConcurrency, int p_nMaxWaitMs, int p_nDefaultDeadlineMs)
+{
+	lv_nConcurrency = p_nConcurrency > 0 ? p_nConcurrency : 1;
+	lv_nMaxWaitMs = p_nMaxWaitMs;
+	lv_nDefaultDeadlineMs = p_nDefaultDeadlineMs;
+	lv_bEnabled = true;
+}
+
+//. budget of the request in ms, 0 = none.
+static int deadline_ms(const Poco::Net::HTTPRequest& p_request)
+{
+	int ms = 0;
+	const std::string& s = p_request.get(GD_ADMISSION_HEADER, "");
+	if (!s.empty() && Poco::NumberParser::tryParse(s, ms) && ms > 0) return ms;
+	return lv_nDefaultDeadlineMs > 0 ? lv_nDefaultDeadlineMs : 0;
+}
+
+//. expected time until a request with p_nAhead requests before it completes.
+static int64_t estimate_us(int p_nAhead)
+{
+	int64_t service = lv_lServiceUs.load(std::memory_order_relaxed);
+	int waves = p_nAhead / lv_nConcurrency;
+	return service * (1 + waves);
+}
+
+//. p_lElapsedUs : time the request has already spent since arrival.
+static bool decide(int p_nDeadlineMs, int p_nAhead, int64_t p_lElapsedUs, int* p_pRetryAfterSec)
+{
+	int64_t service = lv_lServiceUs.load(std::memory_order_relaxed);
+	int64_t est = estimate_us(p_nAhead);
+	int64_t wait = est - service;
+	*p_pRetryAfterSec = (int)((wait + 999999) / 1000000);
+	if (*p_pRetryAfterSec < 1) *p_pRetryAfterSec = 1;
+
+	if (p_nDeadlineMs > 0) return p_lElapsedUs + est <= (int64_t)p_nDeadlineMs * 1000;
+	if (lv_nMaxWaitMs > 0) return wait <= (int64_t)lv_nMaxWaitMs * 1000;
+	return true;
+}
+
+bool mi_admission_precheck(const Poco::Net::HTTPRequest& p_request, int p_nQueued, int* p_pRetryAfterSec)
+{
+	if (!lv_bEnabled) return true;
+	int ahead = lv_nInflight.load(std::memory_order_relaxed) + p_nQueued;
+	if (decide(deadline_ms(p_request), ahead, 0, p_pRetryAfterSec)) return true;
+	mi_metrics_admission_reject(MI_REJECT_OVERLOAD);
+	return false;
+}
+
+void mi_admission_set_arrival(steady_clock::time_point p_tArrival)
+{
+	lv_tArrival = p_tArrival;
+}
+
+steady_clock::time_point mi_admission_arrival()
+{
+	return lv_tArrival;
+}
+
+bool mi_admission_expired()
+{
+	if (mi_context_client_gone(MI_CANCEL_DISPATCH)) return true;
+	RequestContext* ctx = mi_context();
+	if (ctx == NULL || !ctx->has_deadline()) return false;
+	if (steady_clock::now() <= ctx->deadline) return false;
+	mi_metrics_admission_reject(MI_REJECT_EXPIRED);
+	return true;
+}
+
+void mi_admission_reject(Poco::Net::HTTPServerResponse& p_response, int p_nRetryAfterSec, const char* p_pszReason)
+{
+	p_response.setStatus(Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+	mi_headers_apply(p_response, MI_HEADERS_TEXT);
+	if (p_nRetryAfterSec > 0) p_response.set("Retry-After", std::to_string(p_nRetryAfterSec));
+	p_response.sendBuffer(p_pszReason, strlen(p_pszReason));
+}
+
+int mi_admission_inflight()
+{
+	return lv_nInflight.load(std::memory_order_relaxed);
+}
+
+int64_t mi_admission_service_us()
+{
+	return lv_lServiceUs.load(std::memory_order_relaxed);
+}
+
+AdmissionTicket::AdmissionTicket(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response)
+	: m_bAdmitted(false), m_tStart(steady_clock::now())
+{
+	//. the client left while the request waited for a worker : nobody reads the answer.
+	if (mi_context_client_gone(MI_CANCEL_ADMISSION)) {
+		lv_tArrival = steady_clock::time_point();
+		p_response.setKeepAlive(false);
+		mi_admission_reject(p_response, 0, "Client disconnected");
+		return;
+	}
+	if (!lv_bEnabled) {
+		m_bAdmitted = true;
+		lv_nInflight.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	steady_clock::time_point arrival = lv_tArrival != steady_clock::time_point() ? lv_tArrival : m_tStart;
+	lv_tArrival = steady_clock::time_point();
+
+	int ms = deadline_ms(p_request);
+	RequestContext* ctx = mi_context();
+	if (ctx != NULL) ctx->deadline = ms > 0 ? arrival + milliseconds(ms) : steady_clock::time_point();
+
+	int retryAfter = 0;
+	int64_t elapsed = duration_cast<microseconds>(m_tStart - arrival).count();
+	int ahead = lv_nInflight.load(std::memory_order_relaxed);
+	if (ms > 0 && elapsed >= (int64_t)ms * 1000) {
+		//. expired while queued, the client has most likely given up.
+		mi_metrics_admission_reject(MI_REJECT_EXPIRED);
+		mi_admission_reject(p_response, 0, "Deadline exceeded");
+		return;
+	}
+	if (!decide(ms, ahead, elapsed, &retryAfter)) {
+		mi_metrics_admission_reject(MI_REJECT_OVERLOAD);
+		mi_admission_reject(p_response, retryAfter, "Server busy");
+		return;
+	}
+	m_bAdmitted = true;
+	lv_nInflight.fetch_add(1, std::memory_order_relaxed);
+}
+
+AdmissionTicket::~AdmissionTicket()
+{
+	if (!m_bAdmitted) return;
+	lv_nInflight.fetch_sub(1, std::memory_order_relaxed);
+
+	//. EWMA with alpha 1/8; racing updates only lose a sample.
+	int64_t sample = duration_cast<microseconds>(steady_clock::now() - m_tStart).count();
+	int64_t old = lv_lServiceUs.load(std::memory_order_relaxed);
+	lv_lServiceUs.store(old == 0 ? sample : old + (sample - old) / 8, std::memory_order_relaxed);
+}
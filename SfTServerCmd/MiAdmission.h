@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+//. Admission control for the inference endpoints.
+//. The expected completion time of a new request is estimated from the recent handler
+//. time (EWMA) and the number of requests ahead of it. A request whose deadline cannot
+//. be met is answered at once with 503 and Retry-After instead of timing out in a queue.
+//. The deadline is the client's GD_ADMISSION_HEADER budget in milliseconds, else
+//. [admission] default_deadline_ms; without either, [admission] max_wait_ms bounds the
+//. estimated queue wait alone.
+
+//. until this has run every request is admitted ([admission] enable = false).
+void mi_admission_init(int p_nConcurrency, int p_nMaxWaitMs, int p_nDefaultDeadlineMs);
+
+//. reactor mode : decides from the header alone, before the body is received and
+//. queued. p_nQueued is the number of requests already waiting for a worker.
+//. Returns false with the Retry-After seconds when the request should be refused.
+bool mi_admission_precheck(const Poco::Net::HTTPRequest& p_request, int p_nQueued, int* p_pRetryAfterSec);
+
+//. reactor mode : time the request was received; consumed by the next AdmissionTicket
+//. on this thread so the queue wait counts against the deadline.
+void mi_admission_set_arrival(std::chrono::steady_clock::time_point p_tArrival);
+//. the time set above for the request on this thread, epoch when none (classic mode).
+std::chrono::steady_clock::time_point mi_admission_arrival();
+
+//. true when the deadline of the request handled on this thread (MiContext.h) has passed
+//. or its client has disconnected; checked before a pipeline call so stale work is dropped.
+bool mi_admission_expired();
+
+//. admitted inference requests still in their handler, counted with admission disabled too
+//. (the free slots of the cluster announcement, MiCluster.h).
+int mi_admission_inflight();
+//. handler time of the admitted requests (EWMA), 0 before the first one; kept with admission disabled too.
+int64_t mi_admission_service_us();
+
+//. 503 with Retry-After (0 = header omitted).
+void mi_admission_reject(Poco::Net::HTTPServerResponse& p_response, int p_nRetryAfterSec, const char* p_pszReason);
+
+//. one inference request from admission to the end of the handler.
+//. A rejected ticket has already sent its 503; a request whose client has disconnected in
+//. the meantime is rejected too, with admission disabled as well.
+class AdmissionTicket {
+public:
+	AdmissionTicket(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response);
+	~AdmissionTicket();
+
+	bool admitted() const { return m_bAdmitted; }
+
+private:
+	AdmissionTicket(const AdmissionTicket&) = delete;
+	AdmissionTicket& operator=(const AdmissionTicket&) = delete;
+
+	bool									m_bAdmitted;
+	std::chrono::steady_clock::time_point	m_tStart;
+};
@@ -0,0 +1,315 @@
+#include "MiAlloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#if GD_ALLOC_COUNT
+#include "MiMetrics.h"
+#include "MiResultJson.h"
+#include "MiStats.h"
+#include <charconv>
+#ifndef _WIN32
+#include <malloc.h>		//. malloc_usable_size
+#endif
+#endif
+
+#ifndef MI_HAS_MIMALLOC
+#define MI_HAS_MIMALLOC		0
+#endif
+
+#if MI_HAS_MIMALLOC && defined(_WIN32) && !defined(POCO_STATIC)
+//. the Poco DLLs allocate with their own CRT operator new : strings, header values and exceptions
+//. built there and freed here (or the reverse) would reach mi_free with a CRT block.
+#error "MI_HAS_MIMALLOC on Windows needs Poco linked statically (POCO_STATIC), see MiAlloc.h"
+#endif
+
+#if MI_HAS_MIMALLOC
+#include <mimalloc.h>
+
+//. -1 = not decided yet, 0 = CRT heap, 1 = mimalloc.
+static std::atomic<int> lv_nUse(-1);
+
+static bool use_mimalloc()
+{
+	int n = lv_nUse.load(std::memory_order_relaxed);
+	if (n < 0) {
+		//. getenv does not allocate; threads racing here reach the same answer.
+		const char* psz = getenv(LD_ALLOCATOR_ENV);
+		n = psz != NULL && strcmp(psz, "system") == 0 ? 0 : 1;
+		lv_nUse.store(n, std::memory_order_relaxed);
+	}
+	return n == 1;
+}
+#else
+static bool use_mimalloc() { return false; }
+#endif
+
+#if MI_HAS_MIMALLOC || GD_ALLOC_COUNT
+
+#if GD_ALLOC_COUNT
+
+//. allocations of the request running on this thread, [MI_STAGE_COUNT] = outside any stage.
+struct AllocTally {
+	uint64_t	count;
+	uint64_t	bytes;
+	int64_t		live;
+	int64_t		peak;
+	uint64_t	stageCount[MI_STAGE_COUNT + 1];
+	uint64_t	stageBytes[MI_STAGE_COUNT + 1];
+};
+
+//. zero-initialized PODs : no dynamic TLS initializer runs inside operator new.
+static thread_local AllocTally	lv_tally;
+static thread_local int			lv_nStage = MI_STAGE_COUNT;
+static thread_local bool		lv_bInRequest = false;
+static std::atomic<bool>		lv_bCount(false);
+static std::atomic<int64_t>		lv_nMaxPeak(0);
+//. core counters : requests, allocations, bytes, peak sum, then count / bytes per stage.
+static int						lv_nCounters = -1;
+
+#define LD_ALLOC_C_REQUESTS		0
+#define LD_ALLOC_C_COUNT		1
+#define LD_ALLOC_C_BYTES		2
+#define LD_ALLOC_C_PEAK			3
+#define LD_ALLOC_C_STAGES		4
+#define LD_ALLOC_C_TOTAL		(LD_ALLOC_C_STAGES + 2 * (MI_STAGE_COUNT + 1))
+
+static size_t usable_size(void* p_p)
+{
+#if MI_HAS_MIMALLOC
+	if (use_mimalloc()) return mi_usable_size(p_p);
+#endif
+#ifdef _WIN32
+	return _msize(p_p);
+#else
+	return malloc_usable_size(p_p);
+#endif
+}
+
+static inline void tally_alloc(size_t p_nUsable)
+{
+	AllocTally& t = lv_tally;
+	t.count++;
+	t.bytes += p_nUsable;
+	t.live += (int64_t)p_nUsable;
+	if (t.live > t.peak) t.peak = t.live;
+	t.stageCount[lv_nStage]++;
+	t.stageBytes[lv_nStage] += p_nUsable;
+}
+
+static inline void tally_free(size_t p_nUsable)
+{
+	lv_tally.live -= (int64_t)p_nUsable;
+}
+
+#define LD_COUNTING()		(lv_bInRequest && lv_bCount.load(std::memory_order_relaxed))
+
+#else
+#define LD_COUNTING()		false
+static inline void tally_alloc(size_t) {}
+static inline void tally_free(size_t) {}
+static size_t usable_size(void*) { return 0; }
+#endif
+
+static void* alloc(size_t p_nSize)
+{
+	void* p = NULL;
+#if MI_HAS_MIMALLOC
+	if (use_mimalloc()) p = mi_malloc(p_nSize);
+	else
+#endif
+	p = malloc(p_nSize == 0 ? 1 : p_nSize);
+	if (p == NULL) throw std::bad_alloc();
+	if (LD_COUNTING()) tally_alloc(usable_size(p));
+	return p;
+}
+
+static void* alloc_aligned(size_t p_nSize, size_t p_nAlign)
+{
+	void* p = NULL;
+#if MI_HAS_MIMALLOC
+	if (use_mimalloc()) p = mi_malloc_aligned(p_nSize, p_nAlign);
+	else
+#endif
+	{
+#ifdef _WIN32
+		p = _aligned_malloc(p_nSize == 0 ? 1 : p_nSize, p_nAlign);
+#else
+		if (posix_memalign(&p, p_nAlign < sizeof(void*) ? sizeof(void*) : p_nAlign, p_nSize == 0 ? 1 : p_nSize) != 0) p = NULL;
+#endif
+	}
+	if (p == NULL) throw std::bad_alloc();
+	//. the requested size : _aligned_msize needs the alignment and offset back.
+	if (LD_COUNTING()) tally_alloc(p_nSize);
+	return p;
+}
+
+static void release(void* p_p)
+{
+	if (p_p == NULL) return;
+	if (LD_COUNTING()) tally_free(usable_size(p_p));
+#if MI_HAS_MIMALLOC
+	if (use_mimalloc()) { mi_free(p_p); return; }
+#endif
+	free(p_p);
+}
+
+static void release_aligned(void* p_p, size_t p_nSize)
+{
+	if (p_p == NULL) return;
+	if (LD_COUNTING()) tally_free(p_nSize);
+#if MI_HAS_MIMALLOC
+	if (use_mimalloc()) { mi_free(p_p); return; }
+#endif
+#ifdef _WIN32
+	_aligned_free(p_p);
+#else
+	free(p_p);
+#endif
+}
+
+void* operator new(size_t p_nSize) { return alloc(p_nSize); }
+void* operator new[](size_t p_nSize) { return alloc(p_nSize); }
+void* operator new(size_t p_nSize, const std::nothrow_t&) noexcept { try { return alloc(p_nSize); } catch (...) { return NULL; } }
+void* operator new[](size_t p_nSize, const std::nothrow_t&) noexcept { try { return alloc(p_nSize); } catch (...) { return NULL; } }
+void operator delete(void* p_p) noexcept { release(p_p); }
+void operator delete[](void* p_p) noexcept { release(p_p); }
+void operator delete(void* p_p, size_t) noexcept { release(p_p); }
+void operator delete[](void* p_p, size_t) noexcept { release(p_p); }
+void operator delete(void* p_p, const std::nothrow_t&) noexcept { release(p_p); }
+void operator delete[](void* p_p, const std::nothrow_t&) noexcept { release(p_p); }
+
+void* operator new(size_t p_nSize, std::align_val_t p_align) { return alloc_aligned(p_nSize, (size_t)p_align); }
+void* operator new[](size_t p_nSize, std::align_val_t p_align) { return alloc_aligned(p_nSize, (size_t)p_align); }
+void* operator new(size_t p_nSize, std::align_val_t p_align, const std::nothrow_t&) noexcept { try { return alloc_aligned(p_nSize, (size_t)p_align); } catch (...) { return NULL; } }
+void* operator new[](size_t p_nSize, std::align_val_t p_align, const std::nothrow_t&) noexcept { try { return alloc_aligned(p_nSize, (size_t)p_align); } catch (...) { return NULL; } }
+//. unsized aligned deletes cannot give the live bytes back : counted as 0.
+void operator delete(void* p_p, std::align_val_t) noexcept { release_aligned(p_p, 0); }
+void operator delete[](void* p_p, std::align_val_t) noexcept { release_aligned(p_p, 0); }
+void operator delete(void* p_p, size_t p_nSize, std::align_val_t) noexcept { release_aligned(p_p, p_nSize); }
+void operator delete[](void* p_p, size_t p_nSize, std::align_val_t) noexcept { release_aligned(p_p, p_nSize); }
+
+#endif
+
+const char* mi_alloc_name()
+{
+	return use_mimalloc() ? "mimalloc" : "system";
+}
+
+void mi_alloc_log()
+{
+#if MI_HAS_MIMALLOC
+	if (use_mimalloc()) printf("Allocator : mimalloc %d (%s=system for the CRT heap)\n", mi_version(), LD_ALLOCATOR_ENV);
+	else printf("Allocator : system (%s set)\n", LD_ALLOCATOR_ENV);
+#else
+	if (getenv(LD_ALLOCATOR_ENV) != NULL) printf("Allocator : system, %s ignored (built without mimalloc)\n", LD_ALLOCATOR_ENV);
+#endif
+#if GD_ALLOC_COUNT
+	printf("Allocator : allocation counting compiled in ([stats] allocations)\n");
+#endif
+}
+
+void mi_alloc_collect()
+{
+#if MI_HAS_MIMALLOC
+	//. this thread's heap and the abandoned segments; other threads purge theirs as they allocate.
+	if (use_mimalloc()) mi_collect(true);
+#endif
+}
+
+#if GD_ALLOC_COUNT
+
+void mi_alloc_count_init(bool p_bEnable)
+{
+	if (!p_bEnable) return;
+	if (lv_nCounters < 0) lv_nCounters = mi_stats_counters(LD_ALLOC_C_TOTAL);
+	if (lv_nCounters < 0) {
+		printf("Allocation counting off : the statistics core has no counters left\n");
+		return;
+	}
+	lv_bCount.store(true, std::memory_order_relaxed);
+}
+
+int mi_alloc_stage(int p_nStage)
+{
+	int nPrev = lv_nStage;
+	lv_nStage = p_nStage >= 0 && p_nStage < MI_STAGE_COUNT ? p_nStage : MI_STAGE_COUNT;
+	return nPrev;
+}
+
+void mi_alloc_request_begin()
+{
+	if (!lv_bCount.load(std::memory_order_relaxed)) return;
+	memset(&lv_tally, 0, sizeof(lv_tally));
+	lv_nStage = MI_STAGE_COUNT;
+	lv_bInRequest = true;
+}
+
+void mi_alloc_request_end()
+{
+	if (!lv_bInRequest) return;
+	lv_bInRequest = false;
+	//. a copy : mi_stats_add may allocate its thread's shard.
+	AllocTally t = lv_tally;
+	mi_stats_add(lv_nCounters + LD_ALLOC_C_REQUESTS);
+	mi_stats_add(lv_nCounters + LD_ALLOC_C_COUNT, t.count);
+	mi_stats_add(lv_nCounters + LD_ALLOC_C_BYTES, t.bytes);
+	mi_stats_add(lv_nCounters + LD_ALLOC_C_PEAK, (uint64_t)t.peak);
+	for (int s = 0; s <= MI_STAGE_COUNT; s++) {
+		if (t.stageCount[s] == 0) continue;
+		mi_stats_add(lv_nCounters + LD_ALLOC_C_STAGES + 2 * s, t.stageCount[s]);
+		mi_stats_add(lv_nCounters + LD_ALLOC_C_STAGES + 2 * s + 1, t.stageBytes[s]);
+	}
+	int64_t nMax = lv_nMaxPeak.load(std::memory_order_relaxed);
+	while (t.peak > nMax && !lv_nMaxPeak.compare_exchange_weak(nMax, t.peak, std::memory_order_relaxed)) {}
+}
+
+static void put_u64(ArenaString& p_out, const char* p_pszKey, uint64_t p_n, bool p_bComma = true)
+{
+	if (p_bComma) p_out.push_back(',');
+	mi_json_put_string(p_out, p_pszKey);
+	p_out.push_back(':');
+	char buf[24];
+	std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), p_n);
+	p_out.append(buf, (size_t)(r.ptr - buf));
+}
+
+static void put_avg(ArenaString& p_out, const char* p_pszKey, uint64_t p_nSum, uint64_t p_nRequests, bool p_bComma = true)
+{
+	if (p_bComma) p_out.push_back(',');
+	mi_json_put_string(p_out, p_pszKey);
+	p_out.push_back(':');
+	mi_json_put_float(p_out, p_nRequests > 0 ? (float)((double)p_nSum / (double)p_nRequests) : 0.0f);
+}
+
+void mi_alloc_json(ArenaString& p_out)
+{
+	if (!lv_bCount.load(std::memory_order_relaxed)) return;
+	mi_stats_collect();
+	uint64_t nRequests = mi_stats_counter(lv_nCounters + LD_ALLOC_C_REQUESTS);
+	p_out.push_back(',');
+	mi_json_put_string(p_out, "allocations");
+	p_out.append(":{");
+	put_u64(p_out, "requests", nRequests, false);
+	put_avg(p_out, "count_per_request", mi_stats_counter(lv_nCounters + LD_ALLOC_C_COUNT), nRequests);
+	put_avg(p_out, "bytes_per_request", mi_stats_counter(lv_nCounters + LD_ALLOC_C_BYTES), nRequests);
+	put_avg(p_out, "peak_live_bytes_per_request", mi_stats_counter(lv_nCounters + LD_ALLOC_C_PEAK), nRequests);
+	put_u64(p_out, "max_peak_live_bytes", (uint64_t)lv_nMaxPeak.load(std::memory_order_relaxed));
+	p_out.append(",\"stages\":{");
+	bool bFirst = true;
+	for (int s = 0; s <= MI_STAGE_COUNT; s++) {
+		uint64_t nCount = mi_stats_counter(lv_nCounters + LD_ALLOC_C_STAGES + 2 * s);
+		if (nCount == 0) continue;
+		if (!bFirst) p_out.push_back(',');
+		bFirst = false;
+		mi_json_put_string(p_out, s < MI_STAGE_COUNT ? mi_metrics_stage_name((MiStage)s) : "other");
+		p_out.append(":{");
+		put_avg(p_out, "count_per_request", nCount, nRequests, false);
+		put_avg(p_out, "bytes_per_request", mi_stats_counter(lv_nCounters + LD_ALLOC_C_STAGES + 2 * s + 1), nRequests);
+		p_out.push_back('}');
+	}
+	p_out.append("}}");
+}
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include "MiArena.h"
+
+//. Allocator behind the server's operator new / delete.
+//. Built with MI_HAS_MIMALLOC (cmake -DMI_ALLOCATOR=mimalloc, or the define and mimalloc.lib
+//. in the vcxproj), every C++ allocation of the process goes to mimalloc's thread-local
+//. heaps : the many small JSON / string blocks of 16+ request threads no longer meet on the
+//. CRT heap lock, and multi-MB upload buffers come from its segments. MI_ALLOCATOR=system
+//. in the environment keeps the CRT heap instead. The choice is made at the first
+//. allocation, before main reads the ini, and holds for the life of the process : a block
+//. must go back to the allocator it came from.
+//. malloc / free of the SDK, OpenVINO and C libraries keep their heaps; pixel buffers stay
+//. on mi_aligned_alloc (MiPixelPool.h). A build without mimalloc ignores the switch.
+//. Only the executable's operators are replaced, so every module that allocates C++ objects the
+//. server frees must be linked into it : Linux (one global operator new for the process), or
+//. Windows with a static Poco (POCO_STATIC). The dynamic vcpkg Poco DLLs (poco_x64-windows) keep
+//. the CRT's operator new of their own; such a build is refused.
+//.
+//. Allocation counting (GD_ALLOC_COUNT, cmake -DMI_ALLOC_COUNT=ON, then [stats] allocations) :
+//. operator new also counts, per thread, the allocations and bytes (usable size) and the net
+//. bytes still live. RequestTimer (MiMetrics.h) brackets a request on its thread, StageTimer
+//. tags the stage the allocations are charged to ("other" outside any stage). At the end of
+//. a request the tally goes to the statistics core and GD_API_STATS shows, since start, the
+//. allocations, bytes and peak live bytes per request and the allocations of each stage.
+//. Work a request hands to another thread (batcher, stages) counts there, outside it; a block
+//. freed on another thread than it came from lowers that thread's live bytes. Blocks of the
+//. arenas (MiArena.h) count once per chunk. Without GD_ALLOC_COUNT none of this is compiled.
+
+#define LD_ALLOCATOR_ENV	"MI_ALLOCATOR"
+
+#ifndef GD_ALLOC_COUNT
+#define GD_ALLOC_COUNT		0
+#endif
+
+//. "mimalloc" or "system".
+const char* mi_alloc_name();
+
+//. "Allocator : mimalloc 217 (MI_ALLOCATOR=system for the CRT heap)".
+void mi_alloc_log();
+
+//. returns the allocator's free memory to the OS (mimalloc : mi_collect), idle trimming (MiIdle.h).
+void mi_alloc_collect();
+
+#if GD_ALLOC_COUNT
+//. [stats] allocations; after mi_stats_init (the counters live in the statistics core).
+void mi_alloc_count_init(bool p_bEnable);
+//. sets the stage (a MiStage) the calling thread's allocations are charged to, returns the previous one.
+int mi_alloc_stage(int p_nStage);
+//. bracket one request on the calling thread.
+void mi_alloc_request_begin();
+void mi_alloc_request_end();
+//. appends ,"allocations":{...} to a GD_API_STATS document, nothing when counting is off.
+void mi_alloc_json(ArenaString& p_out);
+#else
+inline void mi_alloc_count_init(bool) {}
+inline int mi_alloc_stage(int) { return 0; }
+inline void mi_alloc_request_begin() {}
+inline void mi_alloc_request_end() {}
+inline void mi_alloc_json(ArenaString&) {}
+#endif
@@ -0,0 +1,216 @@
+#include "MiAnalyze.h"
+#include "MiBrownout.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "MiResultJson.h"
+#include "MiSdkCall.h"
+#include "MiLock.h"
+#include <string.h>
+#include <vector>
+
+static AnalyzeSettings				lv_settings;
+static CInitConfig_t*				lv_pConfig = NULL;
+static MI_MUTEX(lv_mtx, "analyze");
+
+//. detectors shared by the request threads, one set with the [analyze] models and one
+//. without the occlusion / closed-eyes ones for brownout (MiBrownout.h).
+struct AnalyzePool {
+	std::vector<CDetectEngine_t*>	vFree;
+	size_t							nEngines = 0;
+	MiCondition						cv;
+};
+static AnalyzePool					lv_full;
+static AnalyzePool					lv_brownout;
+
+class AnalyzeLease {
+public:
+	explicit AnalyzeLease(AnalyzePool& p_pool)
+		: m_pool(p_pool)
+	{
+		MiUniqueLock lock(lv_mtx);
+		m_pool.cv.wait(lock, [this] { return !m_pool.vFree.empty(); });
+		m_pDetector = m_pool.vFree.back();
+		m_pool.vFree.pop_back();
+	}
+	~AnalyzeLease()
+	{
+		{
+			MiLockGuard lock(lv_mtx);
+			m_pool.vFree.push_back(m_pDetector);
+		}
+		m_pool.cv.notify_one();
+	}
+	const CDetectEngine_t* detector() const { return m_pDetector; }
+
+private:
+	AnalyzePool&		m_pool;
+	CDetectEngine_t*	m_pDetector;
+};
+
+static bool analyze_build(AnalyzePool& p_pool, int p_nEngines, bool p_bOcclusion, bool p_bClosedEyes, std::string& p_strErr)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	face_sdk_api().set_enable_face_occlusion_detection(p_bOcclusion);
+	face_sdk_api().set_enable_closed_eyes_detection(p_bClosedEyes);
+	for (int i = 0; i < p_nEngines; i++) {
+		CDetectEngine_t* pDetector = face_sdk_api().detection_create(lv_settings.detector.c_str(), lv_pConfig, &err, msg);
+		if (pDetector == NULL) {
+			p_strErr = msg;
+			return false;
+		}
+		p_pool.vFree.push_back(pDetector);
+	}
+	p_pool.nEngines = p_pool.vFree.size();
+	return true;
+}
+
+static void analyze_release(AnalyzePool& p_pool)
+{
+	for (CDetectEngine_t* pDetector : p_pool.vFree) face_sdk_api().detection_destroy(pDetector);
+	p_pool.vFree.clear();
+	p_pool.nEngines = 0;
+}
+
+bool mi_analyze_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const AnalyzeSettings& p_settings, std::string& p_strErr)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	lv_settings = p_settings;
+	if (lv_settings.engines < 1) lv_settings.engines = 1;
+	if (lv_settings.brownoutEngines < 0) lv_settings.brownoutEngines = 0;
+
+	lv_pConfig = face_sdk_api().config_create(p_strConfigDir.c_str(), p_strConfigName.c_str(), &err, msg);
+	if (lv_pConfig == NULL) {
+		p_strErr = msg;
+		return false;
+	}
+	//. the check pipelines are built by now, the extra models load into these detectors only.
+	//. The brownout set goes first : the switches stay as [analyze] has them.
+	bool bExtra = lv_settings.occlusion || lv_settings.closedEyes;
+	if ((bExtra && lv_settings.brownoutEngines > 0 && !analyze_build(lv_brownout, lv_settings.brownoutEngines, false, false, p_strErr))
+		|| !analyze_build(lv_full, lv_settings.engines, lv_settings.occlusion, lv_settings.closedEyes, p_strErr)) {
+		mi_analyze_shutdown();
+		return false;
+	}
+	return true;
+}
+
+void mi_analyze_shutdown()
+{
+	MiLockGuard lock(lv_mtx);
+	analyze_release(lv_full);
+	analyze_release(lv_brownout);
+	if (lv_pConfig != NULL) {
+		face_sdk_api().config_destroy(lv_pConfig);
+		lv_pConfig = NULL;
+	}
+}
+
+bool mi_analyze_enabled()
+{
+	return lv_full.nEngines > 0;
+}
+
+unsigned mi_analyze_fields(const std::string& p_strList, unsigned p_nDefault)
+{
+	static const struct { const char* name; unsigned field; } names[] = {
+		{ "box", MI_ANALYZE_BOX }, { "pose", MI_ANALYZE_POSE }, { "occlusion", MI_ANALYZE_OCCLUSION },
+		{ "closed_eyes", MI_ANALYZE_CLOSED_EYES }, { "landmarks", MI_ANALYZE_LANDMARKS },
+		{ "all", MI_ANALYZE_BOX | MI_ANALYZE_POSE | MI_ANALYZE_OCCLUSION | MI_ANALYZE_CLOSED_EYES | MI_ANALYZE_LANDMARKS }
+	};
+	unsigned nFields = 0;
+	size_t pos = 0;
+	while (pos < p_strList.size()) {
+		size_t end = p_strList.find(',', pos);
+		if (end == std::string::npos) end = p_strList.size();
+		std::string strName = p_strList.substr(pos, end - pos);
+		for (const auto& n : names) {
+			if (strName == n.name) nFields |= n.field;
+		}
+		pos = end + 1;
+	}
+	return nFields == 0 ? p_nDefault : nFields;
+}
+
+CDetectionResult_t* mi_analyze_detect(const CImage_t* p_pImage, unsigned* p_pFields, int* p_pErr, char* p_pszMsg)
+{
+	StageTimer tDetect(MI_STAGE_ANALYZE);
+	//. decided once : the fields must match the detector the lease hands out.
+	bool bBrownout = mi_brownout_active();
+	if (bBrownout) {
+		unsigned nFields = *p_pFields & ~(unsigned)(MI_ANALYZE_LANDMARKS | MI_ANALYZE_OCCLUSION | MI_ANALYZE_CLOSED_EYES);
+		if (nFields != *p_pFields || lv_brownout.nEngines > 0) mi_context_mark(MI_DEGRADE_BROWNOUT);
+		*p_pFields = nFields;
+	}
+	AnalyzeLease lease(bBrownout && lv_brownout.nEngines > 0 ? lv_brownout : lv_full);
+	return FaceSdk::detect(lease.detector(), p_pImage, p_pErr, p_pszMsg);
+}
+
+void mi_analyze_face_json(ArenaString& p_out, const CFaceParameters_t& p_face, unsigned p_nFields)
+{
+	p_out.append("{\"interpupillary_distance\":");
+	mi_json_put_float(p_out, p_face.interpupillary_distance);
+	if (p_nFields & MI_ANALYZE_BOX) {
+		p_out.append(",\"box\":");
+		mi_analyze_box_json(p_out, p_face.bounding_box);
+	}
+	if (p_nFields & MI_ANALYZE_POSE) {
+		p_out.append(",\"pose\":{\"yaw\":");
+		mi_json_put_float(p_out, p_face.head_pose.yaw);
+		p_out.append(",\"pitch\":");
+		mi_json_put_float(p_out, p_face.head_pose.pitch);
+		p_out.append(",\"roll\":");
+		mi_json_put_float(p_out, p_face.head_pose.roll);
+		p_out.push_back('}');
+	}
+	if (p_nFields & MI_ANALYZE_OCCLUSION) {
+		p_out.append(",\"occlusion\":");
+		mi_json_put_float(p_out, p_face.occlusion_probability);
+	}
+	if (p_nFields & MI_ANALYZE_CLOSED_EYES) {
+		p_out.append(",\"closed_eyes\":");
+		mi_json_put_float(p_out, p_face.closed_eyes_probability);
+	}
+	if (p_nFields & MI_ANALYZE_LANDMARKS) {
+		p_out.append(",\"landmarks\":[");
+		for (int k = 0; k < 68; k++) {
+			if (k > 0) p_out.push_back(',');
+			p_out.push_back('[');
+			mi_json_put_int(p_out, p_face.keypoints.landmarks68[k][0]);
+			p_out.push_back(',');
+			mi_json_put_int(p_out, p_face.keypoints.landmarks68[k][1]);
+			p_out.push_back(']');
+		}
+		p_out.push_back(']');
+	}
+	p_out.push_back('}');
+}
+
+void mi_analyze_box_json(ArenaString& p_out, const CBoundingBox_t& p_box)
+{
+	p_out.push_back('[');
+	mi_json_put_int(p_out, p_box.left_top_x); p_out.push_back(',');
+	mi_json_put_int(p_out, p_box.left_top_y); p_out.push_back(',');
+	mi_json_put_int(p_out, p_box.bottom_right_x); p_out.push_back(',');
+	mi_json_put_int(p_out, p_box.bottom_right_y); p_out.push_back(']');
+}
+
+void mi_analyze_json(ArenaString& p_out, const CDetectionResult_t* p_pDetection, unsigned p_nFields)
+{
+	//. a probability the detector was not built for is meaningless, leave it out.
+	if (!lv_settings.occlusion) p_nFields &= ~(unsigned)MI_ANALYZE_OCCLUSION;
+	if (!lv_settings.closedEyes) p_nFields &= ~(unsigned)MI_ANALYZE_CLOSED_EYES;
+
+	p_out.append(",\"orientation\":");
+	mi_json_put_int(p_out, p_pDetection != NULL ? p_pDetection->orientation : 0);
+	p_out.append(",\"faces\":[");
+	unsigned nFaces = p_pDetection != NULL ? p_pDetection->num_faces : 0;
+	for (unsigned i = 0; i < nFaces; i++) {
+		if (i > 0) p_out.push_back(',');
+		mi_analyze_face_json(p_out, p_pDetection->faces[i], p_nFields);
+	}
+	p_out.push_back(']');
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include "FaceSdkApi.h"
+#include "MiArena.h"
+
+//. Per-face analysis for GD_API_ANALYZE ([analyze] settings) : the upload is decoded once,
+//. the detector and the liveness pipeline both run on that CImage_t, and the response
+//. carries the liveness result next to what the detector found for every face
+//. (box, head pose, interpupillary distance, occlusion / closed-eyes probabilities, landmarks).
+//. set_enable_face_occlusion_detection / set_enable_closed_eyes_detection are process-wide
+//. SDK switches : they are set from [analyze] right before the analysis detectors are built,
+//. after the check pipelines, so only this endpoint pays for the extra models.
+//. Engines are shared by the request threads like the gate engines (MiGate.h).
+
+struct AnalyzeSettings {
+	int			engines;		//. detectors shared by the request threads
+	std::string	detector;		//. detection_create name
+	bool		occlusion;		//. set_enable_face_occlusion_detection
+	bool		closedEyes;		//. set_enable_closed_eyes_detection
+	int			brownoutEngines;	//. detectors without those two models for brownout, 0 = none
+};
+
+//. parts of a face written by mi_analyze_json, GD_ANALYZE_FIELDS_DEFAULT when the request names none.
+enum AnalyzeField {
+	MI_ANALYZE_BOX			= 1,
+	MI_ANALYZE_POSE			= 2,
+	MI_ANALYZE_OCCLUSION	= 4,	//. only with AnalyzeSettings::occlusion
+	MI_ANALYZE_CLOSED_EYES	= 8,	//. only with AnalyzeSettings::closedEyes
+	MI_ANALYZE_LANDMARKS	= 16
+};
+
+bool mi_analyze_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const AnalyzeSettings& p_settings, std::string& p_strErr);
+void mi_analyze_shutdown();
+bool mi_analyze_enabled();
+
+//. "box,pose,occlusion,closed_eyes,landmarks" (or "all") to an AnalyzeField mask, p_nDefault when empty.
+unsigned mi_analyze_fields(const std::string& p_strList, unsigned p_nDefault);
+
+//. detects the faces of p_pImage; NULL with p_pErr / p_pszMsg set on failure.
+//. In brownout (MiBrownout.h) the landmarks, occlusion and closed-eyes fields are cleared
+//. from *p_pFields, a brownout detector is used when there are some, and the request is
+//. marked as served in brownout.
+//. The caller releases the result with face_sdk_api().CDetectionResult_destroy.
+CDetectionResult_t* mi_analyze_detect(const CImage_t* p_pImage, unsigned* p_pFields, int* p_pErr, char* p_pszMsg);
+
+//. one face as {"interpupillary_distance":..,"box":[x1,y1,x2,y2],"pose":{..},...}, and a box alone.
+void mi_analyze_face_json(ArenaString& p_out, const CFaceParameters_t& p_face, unsigned p_nFields);
+void mi_analyze_box_json(ArenaString& p_out, const CBoundingBox_t& p_box);
+
+//. appends ,"orientation":N,"faces":[...] to an object already open in p_out.
+void mi_analyze_json(ArenaString& p_out, const CDetectionResult_t* p_pDetection, unsigned p_nFields);
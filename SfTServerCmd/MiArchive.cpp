@@ -0,0 +1,167 @@
+#include "MiArchive.h"
+#include "Poco/Exception.h"
+#include "Poco/Path.h"
+#include "Poco/String.h"
+#include "Poco/Zip/ZipArchive.h"
+#include "Poco/Zip/ZipStream.h"
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+#define LD_TAR_BLOCK		512
+
+bool Archive::is_archive(const std::string& p_strPath)
+{
+	std::string strExt = Poco::toLower(Poco::Path(p_strPath).getExtension());
+	return strExt == "zip" || strExt == "tar";
+}
+
+Archive* Archive::open(const std::string& p_strPath, bool (*p_fnKeep)(const std::string&))
+{
+	if (!is_archive(p_strPath)) return NULL;
+	std::unique_ptr<Archive> p(new Archive(p_strPath));
+	bool bZip = Poco::toLower(Poco::Path(p_strPath).getExtension()) == "zip";
+	if (!(bZip ? p->index_zip(p_fnKeep) : p->index_tar(p_fnKeep))) return NULL;
+	return p.release();
+}
+
+Archive::Archive(const std::string& p_strPath)
+	: m_strPath(p_strPath)
+{
+}
+
+Archive::~Archive()
+{
+}
+
+bool Archive::index_zip(bool (*p_fnKeep)(const std::string&))
+{
+	std::ifstream in(m_strPath, std::ios::binary);
+	if (!in) return false;
+	try {
+		m_pZip.reset(new Poco::Zip::ZipArchive(in));
+	}
+	catch (Poco::Exception& ex) {
+		printf("Archive : %s : %s\n", m_strPath.c_str(), ex.displayText().c_str());
+		return false;
+	}
+	for (auto it = m_pZip->headerBegin(); it != m_pZip->headerEnd(); ++it) {
+		const Poco::Zip::ZipLocalFileHeader& h = it->second;
+		if (!h.isFile() || (p_fnKeep != NULL && !p_fnKeep(h.getFileName()))) continue;
+		Entry e = { h.getFileName(), 0, h.getUncompressedSize(), &h };
+		m_vEntries.push_back(e);
+	}
+	return true;
+}
+
+//. an octal field, NUL or space terminated; base-256 (GNU, high bit set) for large sizes.
+static bool tar_number(const char* p_pField, size_t p_nLen, uint64_t& p_out)
+{
+	p_out = 0;
+	if ((unsigned char)p_pField[0] & 0x80) {
+		for (size_t i = 1; i < p_nLen; i++) p_out = (p_out << 8) | (unsigned char)p_pField[i];
+		return true;
+	}
+	size_t i = 0;
+	while (i < p_nLen && p_pField[i] == ' ') i++;
+	for (; i < p_nLen && p_pField[i] != '\0' && p_pField[i] != ' '; i++) {
+		if (p_pField[i] < '0' || p_pField[i] > '7') return false;
+		p_out = (p_out << 3) | (uint64_t)(p_pField[i] - '0');
+	}
+	return true;
+}
+
+static std::string tar_string(const char* p_pField, size_t p_nLen)
+{
+	return std::string(p_pField, strnlen(p_pField, p_nLen));
+}
+
+bool Archive::index_tar(bool (*p_fnKeep)(const std::string&))
+{
+	std::ifstream in(m_strPath, std::ios::binary);
+	if (!in) return false;
+	char block[LD_TAR_BLOCK];
+	uint64_t offset = 0;
+	std::string strLongName;
+	for (;;) {
+		if (!in.read(block, LD_TAR_BLOCK)) break;		//. truncated : keep what was indexed
+		offset += LD_TAR_BLOCK;
+		if (block[0] == '\0') break;					//. end-of-archive blocks
+		uint64_t size = 0;
+		if (!tar_number(block + 124, 12, size)) {
+			printf("Archive : %s : bad tar header at %llu\n", m_strPath.c_str(), (unsigned long long)(offset - LD_TAR_BLOCK));
+			return false;
+		}
+		char type = block[156];
+		if (type == 'L') {
+			//. GNU long name : the name of the next entry is this entry's data.
+			strLongName.resize((size_t)size);
+			if (!in.read(&strLongName[0], (std::streamsize)size)) return false;
+			strLongName.resize(strnlen(strLongName.c_str(), strLongName.size()));
+		}
+		else {
+			std::string strName;
+			if (!strLongName.empty()) strName.swap(strLongName);
+			else {
+				strName = tar_string(block, 100);
+				//. ustar splits long paths into prefix/name.
+				if (memcmp(block + 257, "ustar", 5) == 0 && block[345] != '\0') strName = tar_string(block + 345, 155) + "/" + strName;
+			}
+			if ((type == '0' || type == '\0') && (p_fnKeep == NULL || p_fnKeep(strName))) {
+				Entry e = { strName, offset, size, NULL };
+				m_vEntries.push_back(e);
+			}
+		}
+		offset += (size + LD_TAR_BLOCK - 1) / LD_TAR_BLOCK * LD_TAR_BLOCK;
+		in.seekg((std::streamoff)offset);
+	}
+	return true;
+}
+
+std::istream* Archive::borrow()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if (!m_vFree.empty()) {
+			std::istream* p = m_vFree.back().release();
+			m_vFree.pop_back();
+			return p;
+		}
+	}
+	return new std::ifstream(m_strPath, std::ios::binary);
+}
+
+void Archive::give_back(std::istream* p_pIn)
+{
+	p_pIn->clear();
+	std::lock_guard<std::mutex> lock(m_mtx);
+	m_vFree.emplace_back(p_pIn);
+}
+
+bool Archive::read(size_t i, std::string& p_out)
+{
+	const Entry& e = m_vEntries[i];
+	std::istream* pIn = borrow();
+	bool bOk = false;
+	p_out.clear();
+	try {
+		if (e.zip != NULL) {
+			Poco::Zip::ZipInputStream zis(*pIn, *e.zip, true);
+			p_out.resize((size_t)e.size);
+			bOk = e.size > 0 && zis.read(&p_out[0], (std::streamsize)e.size);
+			//. reading to the end is what checks the CRC.
+			if (bOk) bOk = zis.peek() == std::char_traits<char>::eof();
+		}
+		else if (*pIn && pIn->seekg((std::streamoff)e.offset)) {
+			p_out.resize((size_t)e.size);
+			bOk = e.size > 0 && pIn->read(&p_out[0], (std::streamsize)e.size);
+		}
+	}
+	catch (Poco::Exception& ex) {
+		printf("Archive : %s : %s\n", e.name.c_str(), ex.displayText().c_str());
+		bOk = false;
+	}
+	if (!bOk) p_out.clear();
+	give_back(pIn);
+	return bOk;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Poco { namespace Zip { class ZipArchive; class ZipLocalFileHeader; } }
+
+//. Images packed in one archive, read in place by the batch mode (MiBatchCli.h) with no
+//. extraction to disk : a .zip through Poco::Zip (stored or deflated entries), a plain
+//. .tar (ustar, GNU long names) by its 512-byte headers. open() indexes the entries once
+//. - the local headers of a zip, the header chain of a tar - and read() pulls one entry
+//. from its offset, so any number of threads read at once, each on a handle borrowed
+//. from the archive's pool of open streams. Compressed tars (.tar.gz) cannot be read
+//. at an offset and are refused.
+class Archive {
+public:
+	//. NULL when p_strPath is not a .zip / .tar or cannot be indexed; p_fnKeep picks the
+	//. entries by name (all files when NULL).
+	static Archive* open(const std::string& p_strPath, bool (*p_fnKeep)(const std::string&) = NULL);
+	static bool is_archive(const std::string& p_strPath);
+	~Archive();
+
+	//. entries are files only : by name for a zip, in stored order for a tar.
+	size_t size() const { return m_vEntries.size(); }
+	const std::string& name(size_t i) const { return m_vEntries[i].name; }
+	//. the entry's bytes into p_out (its capacity reused); false and p_out empty when the
+	//. archive cannot be read there or a zip entry fails its CRC.
+	bool read(size_t i, std::string& p_out);
+
+private:
+	struct Entry {
+		std::string							name;
+		uint64_t							offset;		//. tar : data start
+		uint64_t							size;
+		const Poco::Zip::ZipLocalFileHeader*	zip;		//. zip : the header in m_pZip
+	};
+
+	explicit Archive(const std::string& p_strPath);
+	bool index_zip(bool (*p_fnKeep)(const std::string&));
+	bool index_tar(bool (*p_fnKeep)(const std::string&));
+	std::istream* borrow();
+	void give_back(std::istream* p_pIn);
+
+	std::string									m_strPath;
+	std::vector<Entry>							m_vEntries;
+	std::unique_ptr<Poco::Zip::ZipArchive>		m_pZip;
+	std::mutex									m_mtx;
+	std::vector<std::unique_ptr<std::istream>>	m_vFree;
+};
@@ -0,0 +1,107 @@
+#include "MiArena.h"
+#include "MiConf.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+
+static thread_local Arena	lv_arena(GD_ARENA_CHUNK, GD_ARENA_RETAIN);
+static thread_local int		lv_nDepth = 0;
+
+Arena::Arena(size_t p_nChunk, size_t p_nRetain)
+	: m_nChunk(p_nChunk), m_nRetain(p_nRetain), m_pUsed(NULL), m_pFree(NULL), m_nFree(0), m_pCur(NULL), m_pEnd(NULL)
+{
+}
+
+Arena::~Arena()
+{
+	reset();
+	while (m_pFree != NULL) {
+		Chunk* next = m_pFree->next;
+		free(m_pFree);
+		m_pFree = next;
+	}
+}
+
+Arena::Chunk* Arena::new_chunk(size_t p_nSize)
+{
+	Chunk* c = (Chunk*)malloc(sizeof(Chunk) + p_nSize);
+	if (c == NULL) throw std::bad_alloc();
+	c->size = p_nSize;
+	return c;
+}
+
+void* Arena::allocate(size_t p_nSize, size_t p_nAlign)
+{
+	if (p_nAlign < alignof(max_align_t)) p_nAlign = alignof(max_align_t);
+	if (m_pCur != NULL) {
+		char* p = (char*)(((uintptr_t)m_pCur + p_nAlign - 1) & ~(uintptr_t)(p_nAlign - 1));
+		if (p + p_nSize <= m_pEnd) {
+			m_pCur = p + p_nSize;
+			return p;
+		}
+	}
+
+	//. oversized : own block behind the current chunk, which stays current.
+	size_t nNeed = p_nSize + p_nAlign;
+	if (nNeed > m_nChunk) {
+		Chunk* c = new_chunk(nNeed);
+		if (m_pUsed != NULL) {
+			c->next = m_pUsed->next;
+			m_pUsed->next = c;
+		}
+		else {
+			c->next = NULL;
+			m_pUsed = c;
+		}
+		return (void*)(((uintptr_t)(c + 1) + p_nAlign - 1) & ~(uintptr_t)(p_nAlign - 1));
+	}
+
+	Chunk* c = m_pFree;
+	if (c != NULL) {
+		m_pFree = c->next;
+		m_nFree -= c->size;
+	}
+	else {
+		c = new_chunk(m_nChunk);
+	}
+	c->next = m_pUsed;
+	m_pUsed = c;
+	m_pCur = (char*)(c + 1);
+	m_pEnd = m_pCur + c->size;
+
+	char* p = (char*)(((uintptr_t)m_pCur + p_nAlign - 1) & ~(uintptr_t)(p_nAlign - 1));
+	m_pCur = p + p_nSize;
+	return p;
+}
+
+void Arena::reset()
+{
+	while (m_pUsed != NULL) {
+		Chunk* next = m_pUsed->next;
+		if (m_pUsed->size == m_nChunk && m_nFree + m_nChunk <= m_nRetain) {
+			m_pUsed->next = m_pFree;
+			m_pFree = m_pUsed;
+			m_nFree += m_nChunk;
+		}
+		else {
+			free(m_pUsed);
+		}
+		m_pUsed = next;
+	}
+	m_pCur = m_pEnd = NULL;
+}
+
+Arena* mi_arena_active()
+{
+	return lv_nDepth > 0 ? &lv_arena : NULL;
+}
+
+ArenaScope::ArenaScope()
+{
+	lv_nDepth++;
+}
+
+ArenaScope::~ArenaScope()
+{
+	if (--lv_nDepth == 0) lv_arena.reset();
+}
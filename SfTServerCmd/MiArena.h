@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stddef.h>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+//. Per-thread bump arena for request-scoped scratch memory (response text, batch
+//. result arrays, message buffers). ArenaScope in MyRequestHandler::handleRequest
+//. marks the request; everything taken from the arena inside it is released at once
+//. when the outermost scope ends, so 16 worker threads never meet in malloc for
+//. these buffers and long uptimes do not fragment the heap with them.
+//. Chunks of GD_ARENA_CHUNK bytes are reused across requests up to GD_ARENA_RETAIN
+//. per thread; larger requests get a dedicated block freed at the end of the scope.
+//. Outside a scope the allocator falls back to the heap, so the same containers are
+//. safe in warm-up and background threads.
+
+class Arena {
+public:
+	Arena(size_t p_nChunk, size_t p_nRetain);
+	~Arena();
+
+	void* allocate(size_t p_nSize, size_t p_nAlign);
+	//. drops every allocation; standard chunks are kept for the next request.
+	void reset();
+
+private:
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	struct Chunk {
+		Chunk*	next;
+		size_t	size;
+	};
+	Chunk* new_chunk(size_t p_nSize);
+
+	size_t	m_nChunk;
+	size_t	m_nRetain;
+	Chunk*	m_pUsed;		//. current chunk first
+	Chunk*	m_pFree;
+	size_t	m_nFree;		//. bytes on m_pFree
+	char*	m_pCur;
+	char*	m_pEnd;
+};
+
+//. arena of the calling thread while an ArenaScope is open, NULL otherwise.
+Arena* mi_arena_active();
+
+//. request boundary; nested scopes share the outermost one.
+class ArenaScope {
+public:
+	ArenaScope();
+	~ArenaScope();
+private:
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+//. STL allocator bound to the arena active at construction (heap when none).
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	ArenaAllocator() : m_pArena(mi_arena_active()) {}
+	template <typename U> ArenaAllocator(const ArenaAllocator<U>& p_other) : m_pArena(p_other.arena()) {}
+
+	T* allocate(size_t p_nCount)
+	{
+		if (m_pArena == NULL) return static_cast<T*>(::operator new(p_nCount * sizeof(T)));
+		return static_cast<T*>(m_pArena->allocate(p_nCount * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* p_p, size_t)
+	{
+		if (m_pArena == NULL) ::operator delete(p_p);
+	}
+
+	Arena* arena() const { return m_pArena; }
+
+	template <typename U> bool operator==(const ArenaAllocator<U>& p_other) const { return m_pArena == p_other.arena(); }
+	template <typename U> bool operator!=(const ArenaAllocator<U>& p_other) const { return m_pArena != p_other.arena(); }
+
+private:
+	Arena* m_pArena;
+};
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+//. ostringstream replacement whose text lives in the arena.
+class ArenaStreamBuf : public std::streambuf {
+public:
+	const ArenaString& str() const { return m_str; }
+
+protected:
+	int_type overflow(int_type p_c) override
+	{
+		if (!traits_type::eq_int_type(p_c, traits_type::eof())) m_str.push_back(traits_type::to_char_type(p_c));
+		return traits_type::not_eof(p_c);
+	}
+	std::streamsize xsputn(const char* p_p, std::streamsize p_n) override
+	{
+		m_str.append(p_p, (size_t)p_n);
+		return p_n;
+	}
+
+private:
+	ArenaString m_str;
+};
+
+class ArenaOStream : public std::ostream {
+public:
+	ArenaOStream() : std::ostream(NULL) { rdbuf(&m_buf); }
+
+	const ArenaString& str() const { return m_buf.str(); }
+
+private:
+	ArenaStreamBuf m_buf;
+};
@@ -0,0 +1,259 @@
+#include "MiAudit.h"
+#include "MiAuditSink.h"
+#include "MiHash.h"
+#include "MiMetrics.h"
+#include "Poco/Data/ODBC/Connector.h"
+#include "Poco/Data/Session.h"
+#include "Poco/DateTime.h"
+#include "Poco/Exception.h"
+#include "Poco/Timestamp.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using namespace Poco::Data::Keywords;
+
+static AuditSettings							lv_settings;
+static std::atomic<bool>						lv_bEnabled(false);
+static std::mutex								lv_mtxQueue;
+static std::deque<AuditRow>						lv_queue;			//. the writer erases from the front only
+static std::atomic<size_t>						lv_nQueued(0);
+static std::thread								lv_writer;
+static std::condition_variable					lv_cvWriter;
+static bool										lv_bStop = false;
+static std::unique_ptr<AuditSink>				lv_pSink;			//. writer thread only
+static bool										lv_bFailing = false;	//. the last insert failed, logged once
+
+static thread_local bool									lv_bActive = false;
+static thread_local char									lv_szId[48];
+static thread_local std::chrono::steady_clock::time_point	lv_start;
+static thread_local std::vector<uint64_t>					lv_vHashes;
+static thread_local size_t									lv_nResults = 0;
+
+//. rows of a SQL table through Poco::Data::ODBC, one transaction per batch.
+class OdbcSink : public AuditSink {
+public:
+	explicit OdbcSink(const AuditSettings& p_settings)
+		: m_strConnect(p_settings.connect), m_strSdk(p_settings.sdkVersion)
+	{
+		m_strInsert = "INSERT INTO " + p_settings.table
+			+ " (ts, request_id, image_hash, verdict, status, score, probability, quality, latency_ms, sdk_version)"
+			+ " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+		Poco::Data::ODBC::Connector::registerConnector();
+	}
+	~OdbcSink()
+	{
+		m_pSession.reset();
+		Poco::Data::ODBC::Connector::unregisterConnector();
+	}
+
+	bool connect(std::string& p_strErr) override
+	{
+		try {
+			m_pSession.reset(new Poco::Data::Session(Poco::Data::ODBC::Connector::KEY, m_strConnect));
+			return true;
+		}
+		catch (Poco::Exception& ex) {
+			p_strErr = ex.displayText();
+			m_pSession.reset();
+			return false;
+		}
+	}
+
+	bool insert(const std::vector<AuditRow>& p_vRows, std::string& p_strErr) override
+	{
+		if (m_pSession == NULL && !connect(p_strErr)) return false;
+
+		size_t n = p_vRows.size();
+		std::vector<Poco::DateTime> vTs;
+		std::vector<std::string> vId, vHash, vVerdict, vStatus, vSdk(n, m_strSdk);
+		std::vector<double> vScore, vProbability, vQuality, vLatency;
+		vTs.reserve(n); vId.reserve(n); vHash.reserve(n); vVerdict.reserve(n); vStatus.reserve(n);
+		vScore.reserve(n); vProbability.reserve(n); vQuality.reserve(n); vLatency.reserve(n);
+		for (const AuditRow& r : p_vRows) {
+			vTs.push_back(Poco::DateTime(Poco::Timestamp(r.tsUs)));
+			vId.push_back(r.id);
+			vHash.push_back(mi_audit_hash_hex(r));
+			vVerdict.push_back(r.verdict != NULL ? r.verdict : "");
+			vStatus.push_back(face_sdk_status_name(r.err));
+			vScore.push_back(r.score);
+			vProbability.push_back(r.probability);
+			vQuality.push_back(r.quality);
+			vLatency.push_back((double)r.latencyUs / 1000.0);
+		}
+
+		try {
+			m_pSession->begin();
+			*m_pSession << m_strInsert, use(vTs), use(vId), use(vHash), use(vVerdict), use(vStatus),
+				use(vScore), use(vProbability), use(vQuality), use(vLatency), use(vSdk), now;
+			m_pSession->commit();
+			return true;
+		}
+		catch (Poco::Exception& ex) {
+			p_strErr = ex.displayText();
+			try {
+				if (m_pSession->isTransaction()) m_pSession->rollback();
+			}
+			catch (Poco::Exception&) {
+			}
+			//. the connection may be gone, the next flush opens a new one.
+			m_pSession.reset();
+			return false;
+		}
+	}
+
+private:
+	std::string								m_strConnect;
+	std::string								m_strSdk;
+	std::string								m_strInsert;
+	std::unique_ptr<Poco::Data::Session>	m_pSession;
+};
+
+//. writes batches until the queue is empty or an insert fails.
+static void flush()
+{
+	std::vector<AuditRow> vRows;
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> lock(lv_mtxQueue);
+			if (lv_queue.empty()) return;
+			size_t n = lv_queue.size() < (size_t)lv_settings.batchRows ? lv_queue.size() : (size_t)lv_settings.batchRows;
+			vRows.assign(lv_queue.begin(), lv_queue.begin() + n);
+		}
+		std::string strErr;
+		if (!lv_pSink->insert(vRows, strErr)) {
+			if (!lv_bFailing) std::cout << "Audit insert failed, rows kept for the next flush : " << strErr << std::endl;
+			lv_bFailing = true;
+			return;
+		}
+		if (lv_bFailing) std::cout << "Audit insert resumed" << std::endl;
+		lv_bFailing = false;
+		std::lock_guard<std::mutex> lock(lv_mtxQueue);
+		lv_queue.erase(lv_queue.begin(), lv_queue.begin() + vRows.size());
+		lv_nQueued.store(lv_queue.size(), std::memory_order_relaxed);
+	}
+}
+
+static void writer_loop()
+{
+	std::unique_lock<std::mutex> lock(lv_mtxQueue);
+	while (!lv_bStop) {
+		lv_cvWriter.wait_for(lock, std::chrono::milliseconds(lv_settings.flushMs), [] { return lv_bStop || lv_queue.size() >= (size_t)lv_settings.batchRows; });
+		lock.unlock();
+		flush();
+		lock.lock();
+	}
+}
+
+bool mi_audit_init(const AuditSettings& p_settings, std::string& p_strErr)
+{
+	lv_settings = p_settings;
+	if (lv_settings.batchRows < 1) lv_settings.batchRows = 1;
+	if (lv_settings.flushMs < 1) lv_settings.flushMs = 1;
+	if (lv_settings.queueRows < lv_settings.batchRows) lv_settings.queueRows = lv_settings.batchRows;
+	if (lv_settings.sink == "mongodb") lv_pSink.reset(mi_audit_mongo_sink(lv_settings));
+	else if (lv_settings.sink == "odbc") lv_pSink.reset(new OdbcSink(lv_settings));
+	else {
+		p_strErr = "unknown sink " + lv_settings.sink;
+		return false;
+	}
+	//. an unreachable database is not fatal, the rows wait in the queue until it is back.
+	bool bOk = lv_pSink->connect(p_strErr);
+
+	lv_bStop = false;
+	lv_writer = std::thread(writer_loop);
+	lv_bEnabled.store(true, std::memory_order_release);
+	return bOk;
+}
+
+void mi_audit_shutdown()
+{
+	if (!lv_bEnabled.exchange(false)) return;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxQueue);
+		lv_bStop = true;
+	}
+	lv_cvWriter.notify_one();
+	if (lv_writer.joinable()) lv_writer.join();
+	flush();
+	lv_pSink.reset();
+}
+
+bool mi_audit_enabled()
+{
+	return lv_bEnabled.load(std::memory_order_acquire);
+}
+
+size_t mi_audit_queued()
+{
+	return lv_nQueued.load(std::memory_order_relaxed);
+}
+
+void mi_audit_begin(const char* p_pszId)
+{
+	lv_bActive = lv_bEnabled.load(std::memory_order_acquire);
+	if (!lv_bActive) return;
+	lv_start = std::chrono::steady_clock::now();
+	snprintf(lv_szId, sizeof(lv_szId), "%s", p_pszId);
+	lv_vHashes.clear();
+	lv_nResults = 0;
+}
+
+void mi_audit_rename(const char* p_pszId)
+{
+	if (lv_bActive) snprintf(lv_szId, sizeof(lv_szId), "%s", p_pszId);
+}
+
+void mi_audit_end()
+{
+	lv_bActive = false;
+}
+
+void mi_audit_image(const void* p_pData, size_t p_nLen)
+{
+	if (lv_bActive) lv_vHashes.push_back(mi_hash64(p_pData, p_nLen));
+}
+
+void mi_audit_image_hash(uint64_t p_nHash)
+{
+	if (lv_bActive) lv_vHashes.push_back(p_nHash);
+}
+
+void mi_audit_result(const CPipelineResult_t& p_result, int p_nErr, const char* p_pszVerdict)
+{
+	if (!lv_bActive) return;
+
+	AuditRow r;
+	r.tsUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	memcpy(r.id, lv_szId, sizeof(r.id));
+	size_t i = lv_nResults++;
+	r.bHash = i < lv_vHashes.size();
+	r.hash = r.bHash ? lv_vHashes[i] : 0;
+	r.verdict = p_pszVerdict;
+	r.err = p_nErr;
+	r.score = p_result.liveness_result.score;
+	r.probability = p_result.liveness_result.probability;
+	r.quality = p_result.quality_result.score;
+	r.latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - lv_start).count();
+
+	bool bWake = false;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxQueue);
+		if (lv_queue.size() >= (size_t)lv_settings.queueRows) {
+			mi_metrics_audit_drop();
+			return;
+		}
+		lv_queue.push_back(r);
+		lv_nQueued.store(lv_queue.size(), std::memory_order_relaxed);
+		bWake = lv_queue.size() == (size_t)lv_settings.batchRows;
+	}
+	if (bWake) lv_cvWriter.notify_one();
+}
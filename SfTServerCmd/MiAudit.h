@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "FaceSdkApi.h"
+
+//. Audit trail of verdicts ([audit] settings) in a SQL database through Poco::Data::ODBC,
+//. or in a MongoDB collection through Poco::MongoDB (sink, see MiAuditSink.h).
+//. One row (document) per image result :
+//.   ts, request_id, image_hash, verdict, status, score, probability, quality, latency_ms, sdk_version
+//. The table is not created by the server, see IDLiveFaceCmd.ini for a definition.
+//. Request threads only append a row to a bounded queue (mi_json_result); a background
+//. thread takes up to batch_rows of them every flush_ms and inserts them in one transaction
+//. (one insert command of batch_rows documents for MongoDB).
+//. A failed insert keeps the rows and reconnects at the next flush; rows beyond queue_rows
+//. are dropped (mi_audit_dropped_total on /metrics), the request path never waits on SQL.
+
+struct AuditSettings {
+	std::string	sink;			//. odbc | mongodb
+	std::string	connect;		//. ODBC connection string, e.g. "DSN=idlive;UID=audit;PWD=...",
+								//. or a mongodb:// URI naming the database
+	std::string	table;			//. table, or collection
+	int			batchRows;		//. rows per transaction
+	int			flushMs;
+	int			queueRows;		//. rows waiting at most
+	std::string	sdkVersion;
+};
+
+bool mi_audit_init(const AuditSettings& p_settings, std::string& p_strErr);
+//. inserts what is still queued and disconnects.
+void mi_audit_shutdown();
+bool mi_audit_enabled();
+
+//. rows waiting for the writer.
+size_t mi_audit_queued();
+
+//. starts / ends the rows of the calling thread; p_pszId is the request id of the access log.
+void mi_audit_begin(const char* p_pszId);
+void mi_audit_end();
+//. the id given late, from the request body (mi_request_rename).
+void mi_audit_rename(const char* p_pszId);
+
+//. no-ops outside a request begun on this thread.
+//. the uploads in the order their results follow; mi_audit_image hashes like ResultCache::make_key.
+void mi_audit_image(const void* p_pData, size_t p_nLen);
+void mi_audit_image_hash(uint64_t p_nHash);
+//. one image result, queued with the hash of the matching upload.
+void mi_audit_result(const CPipelineResult_t& p_result, int p_nErr, const char* p_pszVerdict);
@@ -0,0 +1,96 @@
+#include "MiAuditSink.h"
+#include "Poco/Exception.h"
+#include "Poco/MongoDB/Connection.h"
+#include "Poco/MongoDB/Database.h"
+#include "Poco/MongoDB/OpMsgMessage.h"
+#include "Poco/Timestamp.h"
+#include "Poco/URI.h"
+#include <memory>
+
+//. documents of a collection, one insert command (OP_MSG, unordered) per batch. The
+//. database is the path of the mongodb:// URI; credentials and connectTimeoutMS /
+//. socketTimeoutMS in the URI are applied by Poco::MongoDB::Connection.
+class MongoSink : public AuditSink {
+public:
+	explicit MongoSink(const AuditSettings& p_settings)
+		: m_strUri(p_settings.connect), m_strCollection(p_settings.table), m_strSdk(p_settings.sdkVersion)
+	{
+		try {
+			std::string strPath = Poco::URI(m_strUri).getPath();
+			m_strDatabase = strPath.size() > 1 ? strPath.substr(1) : std::string();
+		}
+		catch (Poco::Exception&) {
+		}
+	}
+
+	bool connect(std::string& p_strErr) override
+	{
+		if (m_strDatabase.empty()) {
+			p_strErr = "the mongodb:// URI names no database";
+			return false;
+		}
+		try {
+			m_pConnection.reset(new Poco::MongoDB::Connection());
+			m_pConnection->connect(m_strUri, m_factory);
+			return true;
+		}
+		catch (Poco::Exception& ex) {
+			p_strErr = ex.displayText();
+			m_pConnection.reset();
+			return false;
+		}
+	}
+
+	bool insert(const std::vector<AuditRow>& p_vRows, std::string& p_strErr) override
+	{
+		if (m_pConnection == NULL && !connect(p_strErr)) return false;
+
+		Poco::MongoDB::Database db(m_strDatabase);
+		Poco::SharedPtr<Poco::MongoDB::OpMsgMessage> request = db.createOpMsgMessage(m_strCollection);
+		request->setCommandName(Poco::MongoDB::OpMsgMessage::CMD_INSERT);
+		request->body().add("ordered", false);
+		for (const AuditRow& r : p_vRows) {
+			Poco::MongoDB::Document::Ptr doc = new Poco::MongoDB::Document();
+			doc->add("ts", Poco::Timestamp(r.tsUs))
+				.add("request_id", std::string(r.id))
+				.add("image_hash", mi_audit_hash_hex(r))
+				.add("verdict", std::string(r.verdict != NULL ? r.verdict : ""))
+				.add("status", std::string(face_sdk_status_name(r.err)))
+				.add("score", (double)r.score)
+				.add("probability", (double)r.probability)
+				.add("quality", (double)r.quality)
+				.add("latency_ms", (double)r.latencyUs / 1000.0)
+				.add("sdk_version", m_strSdk);
+			request->documents().push_back(doc);
+		}
+
+		try {
+			Poco::MongoDB::OpMsgMessage response;
+			m_pConnection->sendRequest(*request, response);
+			if (!response.responseOk()) {
+				p_strErr = "insert refused : " + response.body().toString();
+				return false;
+			}
+			return true;
+		}
+		catch (Poco::Exception& ex) {
+			p_strErr = ex.displayText();
+			//. the connection may be gone, the next flush opens a new one.
+			m_pConnection.reset();
+			return false;
+		}
+	}
+
+private:
+	std::string										m_strUri;
+	std::string										m_strDatabase;
+	std::string										m_strCollection;
+	std::string										m_strSdk;
+	Poco::MongoDB::Connection::SocketFactory		m_factory;
+	std::unique_ptr<Poco::MongoDB::Connection>		m_pConnection;
+};
+
+AuditSink* mi_audit_mongo_sink(const AuditSettings& p_settings)
+{
+	return new MongoSink(p_settings);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "MiAudit.h"
+
+//. Where the audit writer thread (MiAudit.cpp) stores its batches : [audit] sink = odbc
+//. (a SQL table, MiAudit.cpp) or mongodb (a collection, MiAuditMongo.cpp). The queue, the
+//. batching and the retry of a failed batch are the writer's; a sink only connects and
+//. stores one batch. Only the writer thread calls it.
+
+struct AuditRow {
+	int64_t		tsUs;			//. system clock when the result was written
+	char		id[48];
+	uint64_t	hash;
+	bool		bHash;			//. false when the upload was not seen (hash column empty)
+	const char*	verdict;
+	int			err;
+	float		score;
+	float		probability;
+	float		quality;
+	int64_t		latencyUs;		//. from the start of the request
+};
+
+class AuditSink {
+public:
+	virtual ~AuditSink() {}
+	//. false with p_strErr when the store cannot be reached.
+	virtual bool connect(std::string& p_strErr) = 0;
+	//. all of p_vRows or none, false with p_strErr; the next call connects again.
+	virtual bool insert(const std::vector<AuditRow>& p_vRows, std::string& p_strErr) = 0;
+};
+
+AuditSink* mi_audit_mongo_sink(const AuditSettings& p_settings);
+
+inline std::string mi_audit_hash_hex(const AuditRow& p_r)
+{
+	if (!p_r.bHash) return std::string();
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)p_r.hash);
+	return buf;
+}
@@ -0,0 +1,230 @@
+#include "MiAutoTune.h"
+#include "FaceSdkApi.h"
+#include "MiConf.h"
+#include "MiSettings.h"
+#include "MiWarmup.h"
+#include "Poco/Exception.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/JSON/Stringifier.h"
+#include "Poco/NumberParser.h"
+#include "Poco/StringTokenizer.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct TunePoint {
+	int		engineThreads;		//. -1 = not tuned
+	int		ovStreams;			//. -2 = not tuned
+	int		executionStreams;	//. -1 = not tuned
+	int		poolSize;
+	double	throughput;			//. checks / s
+	double	p99Ms;
+};
+
+//. "0,2,4" -> values >= p_nMin; an empty list yields p_nUnset (the knob is not tuned).
+static std::vector<int> parse_candidates(const std::string& p_strList, int p_nMin, int p_nUnset)
+{
+	std::vector<int> v;
+	Poco::StringTokenizer tok(p_strList, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& t : tok) {
+		int n = 0;
+		if (Poco::NumberParser::tryParse(t, n) && n >= p_nMin) v.push_back(n);
+	}
+	if (v.empty()) v.push_back(p_nUnset);
+	return v;
+}
+
+//. a persisted result is reused only on the same host shape, build and grid.
+static std::string fingerprint()
+{
+	const MiSettings& s = g_Settings;
+	std::ostringstream ss;
+	ss << "cores=" << std::thread::hardware_concurrency() << ";version=" << GD_ID_VERSION
+		<< ";config=" << s.configDir << "/" << s.configName << ";pipeline=" << s.pipelineName
+		<< ";grid=" << s.autotuneEngineThreads << "|" << s.autotuneOvStreams << "|" << s.autotuneExecutionStreams << "|" << s.autotunePoolSizes
+		<< ";p99=" << s.autotuneP99Ms;
+	return ss.str();
+}
+
+static void apply(const TunePoint& p_point)
+{
+	MiSettings& s = g_Settings;
+	if (p_point.engineThreads >= 0) s.numThreadsEngine = p_point.engineThreads;
+	if (p_point.ovStreams >= -1) s.ovNumThroughputStreams = p_point.ovStreams;
+	if (p_point.executionStreams >= 0) s.numPipelineExecutionStreams = p_point.executionStreams;
+	s.poolSize = p_point.poolSize;
+	s.maxThreads = std::max(p_point.poolSize * GD_AUTOTUNE_THREADS_PER_SLOT, GD_AUTOTUNE_MIN_THREADS);
+}
+
+static void print_point(const char* p_pszWhat, const TunePoint& p_point)
+{
+	std::cout << "Auto-tune " << p_pszWhat << " : engine_threads " << p_point.engineThreads << ", ov_streams " << p_point.ovStreams
+		<< ", execution_streams " << p_point.executionStreams << ", pool " << p_point.poolSize << " : "
+		<< (int)p_point.throughput << " checks/s, p99 " << p_point.p99Ms << " ms" << std::endl;
+}
+
+bool mi_autotune_load()
+{
+	if (!g_Settings.autotuneEnable) return false;
+	std::ifstream in(g_Settings.autotuneFile);
+	if (!in) return false;
+	try {
+		Poco::JSON::Parser parser;
+		Poco::JSON::Object::Ptr root = parser.parse(in).extract<Poco::JSON::Object::Ptr>();
+		if (root->optValue<std::string>("fingerprint", "") != fingerprint()) {
+			std::cout << "Auto-tune : " << g_Settings.autotuneFile << " was made for another host or grid, tuning again" << std::endl;
+			return false;
+		}
+		TunePoint point;
+		point.engineThreads = root->getValue<int>("engine_threads");
+		point.ovStreams = root->getValue<int>("ov_streams");
+		point.executionStreams = root->getValue<int>("execution_streams");
+		point.poolSize = root->getValue<int>("pool_size");
+		point.throughput = root->optValue<double>("throughput", 0);
+		point.p99Ms = root->optValue<double>("p99_ms", 0);
+		if (point.poolSize < 1) return false;
+		apply(point);
+		print_point("reused", point);
+		return true;
+	}
+	catch (const Poco::Exception& ex) {
+		std::cout << "Auto-tune : cannot read " << g_Settings.autotuneFile << " : " << ex.displayText() << std::endl;
+		return false;
+	}
+}
+
+static void save(const TunePoint& p_point)
+{
+	Poco::JSON::Object root;
+	root.set("fingerprint", fingerprint());
+	root.set("engine_threads", p_point.engineThreads);
+	root.set("ov_streams", p_point.ovStreams);
+	root.set("execution_streams", p_point.executionStreams);
+	root.set("pool_size", p_point.poolSize);
+	root.set("max_threads", g_Settings.maxThreads);
+	root.set("throughput", p_point.throughput);
+	root.set("p99_ms", p_point.p99Ms);
+	std::ofstream out(g_Settings.autotuneFile);
+	if (!out) {
+		std::cout << "Auto-tune : cannot write " << g_Settings.autotuneFile << std::endl;
+		return;
+	}
+	Poco::JSON::Stringifier::stringify(root, out, 2);
+}
+
+//. one sweep point : the SDK values are global, the pipelines built afterwards compile with them.
+static bool measure(CInitConfig_t* p_pConfig, const CImage_t* p_pImage, TunePoint& p_point)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	if (p_point.engineThreads >= 0) { ThreadingLevel_t l = ENGINE; face_sdk_api().set_num_threads((unsigned int)p_point.engineThreads, &l, &err, msg); }
+	if (p_point.ovStreams >= -1) face_sdk_api().set_ov_num_throughput_streams(p_point.ovStreams);
+	if (p_point.executionStreams >= 0) face_sdk_api().set_num_pipeline_execution_streams((unsigned int)p_point.executionStreams);
+
+	std::vector<CPipeline_t*> vPipes;
+	for (int i = 0; i < p_point.poolSize; i++) {
+		CPipeline_t* p = face_sdk_api().pipeline_create(g_Settings.pipelineName.c_str(), p_pConfig, &err, msg);
+		if (p == NULL) break;
+		//. the first call compiles, keep it out of the numbers.
+		face_sdk_api().pipeline_check_liveness(p, p_pImage, NULL, &err, msg);
+		vPipes.push_back(p);
+	}
+	bool bOk = (int)vPipes.size() == p_point.poolSize;
+	if (bOk) {
+		std::vector<std::vector<double>> vLat(vPipes.size());
+		auto start = std::chrono::steady_clock::now();
+		auto deadline = start + std::chrono::milliseconds(g_Settings.autotuneDurationMs);
+		std::vector<std::thread> vThreads;
+		for (size_t i = 0; i < vPipes.size(); i++) {
+			vThreads.emplace_back([&, i] {
+				int nErr = OK;
+				char szMsg[MESSAGE_BUFFER_SIZE];
+				for (auto t = std::chrono::steady_clock::now(); t < deadline; ) {
+					face_sdk_api().pipeline_check_liveness(vPipes[i], p_pImage, NULL, &nErr, szMsg);
+					auto done = std::chrono::steady_clock::now();
+					vLat[i].push_back(std::chrono::duration<double, std::milli>(done - t).count());
+					t = done;
+				}
+			});
+		}
+		for (auto& t : vThreads) t.join();
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<double> all;
+		for (auto& v : vLat) all.insert(all.end(), v.begin(), v.end());
+		std::sort(all.begin(), all.end());
+		p_point.throughput = elapsed > 0 ? all.size() / elapsed : 0;
+		p_point.p99Ms = all.empty() ? 0 : all[std::min((size_t)(0.99 * (all.size() - 1) + 0.5), all.size() - 1)];
+		bOk = !all.empty();
+	}
+	for (CPipeline_t* p : vPipes) face_sdk_api().pipeline_destroy(p);
+	return bOk;
+}
+
+void mi_autotune_run()
+{
+	const MiSettings& s = g_Settings;
+	if (!s.autotuneEnable) return;
+
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	CInitConfig_t* config = face_sdk_api().config_create(s.configDir.c_str(), s.configName.c_str(), &err, msg);
+	if (config == NULL) {
+		std::cout << "Auto-tune skipped, config_create : " << msg << std::endl;
+		return;
+	}
+	CImage_t* image = mi_warmup_image();
+	if (image == NULL) {
+		std::cout << "Auto-tune skipped : no warm-up image" << std::endl;
+		face_sdk_api().config_destroy(config);
+		return;
+	}
+
+	std::vector<int> vEngine = parse_candidates(s.autotuneEngineThreads, 0, -1);
+	std::vector<int> vStreams = parse_candidates(s.autotuneOvStreams, -1, -2);
+	std::vector<int> vExecution = parse_candidates(s.autotuneExecutionStreams, 0, -1);
+	std::vector<int> vPool = parse_candidates(s.autotunePoolSizes, 1, s.poolSize > 0 ? s.poolSize : 1);
+
+	auto start = std::chrono::steady_clock::now();
+	bool bHave = false, bHaveFit = false;
+	TunePoint best = {}, fastest = {};
+	for (int e : vEngine) {
+		for (int o : vStreams) {
+			for (int x : vExecution) {
+				for (int n : vPool) {
+					TunePoint point = { e, o, x, n, 0, 0 };
+					if (!measure(config, image, point)) {
+						print_point("failed", point);
+						continue;
+					}
+					print_point("point", point);
+					bool bFits = point.p99Ms <= s.autotuneP99Ms;
+					//. highest throughput within the p99 target, else the lowest p99.
+					if (bFits && (!bHaveFit || point.throughput > best.throughput)) { best = point; bHaveFit = true; }
+					if (!bHave || point.p99Ms < fastest.p99Ms) { fastest = point; bHave = true; }
+				}
+			}
+		}
+	}
+	face_sdk_api().image_destroy(image);
+	face_sdk_api().config_destroy(config);
+
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	if (!bHave) {
+		std::cout << "Auto-tune : no point could be measured in " << ms << " ms, settings unchanged" << std::endl;
+		return;
+	}
+	if (!bHaveFit) {
+		std::cout << "Auto-tune : no point meets p99 " << s.autotuneP99Ms << " ms, using the lowest p99" << std::endl;
+		best = fastest;
+	}
+	apply(best);
+	save(best);
+	std::cout << "Auto-tune done in " << ms << " ms, result in " << s.autotuneFile << std::endl;
+	print_point("chosen", best);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+//. Startup auto-tune ([autotune] settings) of the threading knobs that are otherwise set by
+//. hand per SKU : sdk.num_threads_engine, sdk.ov_num_throughput_streams,
+//. sdk.num_pipeline_execution_streams, pool.size and server.max_threads.
+//. The first start sweeps the candidate grid : every point builds pool.size pipelines with
+//. its SDK values, drives them with one thread each on the warm-up image for duration_ms and
+//. keeps the highest throughput whose p99 stays within p99_ms (the lowest p99 when none
+//. does). The winner goes to [autotune] file together with a fingerprint (cores, server
+//. version, SDK config, grid); later starts with the same fingerprint reuse it without a sweep.
+//. Only the SDK values the winner sets are tuned, [sdk] values of -1 stay untouched otherwise;
+//. server.max_threads becomes pool.size * GD_AUTOTUNE_THREADS_PER_SLOT.
+
+//. before mi_settings_export_sdk_env : a persisted result for this host goes into
+//. g_Settings so the dll already loads with it. false = none (or [autotune] disabled).
+bool mi_autotune_load();
+
+//. after face_sdk_api_load, when mi_autotune_load found nothing : sweeps, persists and
+//. updates g_Settings. The global pipeline built by setting_init keeps the values it was
+//. created with until the next start (or reload); pool slots are created with the winner.
+void mi_autotune_run();
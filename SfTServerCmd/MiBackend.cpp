@@ -0,0 +1,240 @@
+#include "MiBackend.h"
+#include "MiBlueprint.h"
+#include "MiConfig.h"
+#include "MiExecutor.h"
+#include "MiGate.h"
+#include "MiContext.h"
+#include "MiCppBackend.h"
+#include "MiImage.h"
+#include "MiImageInfo.h"
+#include "MiInference.h"
+#include "MiMetrics.h"
+#include "MiPrefilter.h"
+#include "MiSdkCall.h"
+#include "MiWatchdog.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+InferenceBackend* g_pBackend = NULL;
+
+//. liveness only when the gate lets it through; both look at the one decoded image.
+CPipelineResult_t LegacyBackend::gated_liveness(const ImageHandle& p_image, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	const CImage_t* pImage = p_image ? p_image->get() : NULL;
+	if (mi_gate_check(pImage, result, p_pErr, p_pszMsg)) {
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		if (!mi_watchdog_enabled()) result = liveness(pImage, p_pMeta, p_pErr, p_pszMsg);
+		else result = mi_watchdog_liveness(p_image, p_pMeta, p_pErr, p_pszMsg, [this](const CImage_t* p_pImg, const CMeta_t* p_pM, int* p_pE, char* p_pszM) {
+			return liveness(p_pImg, p_pM, p_pE, p_pszM);
+		});
+	}
+	return result;
+}
+
+CPipelineResult_t LegacyBackend::liveness(const CImage_t* p_pImage, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	return mi_check_liveness(p_pImage, p_pErr, p_pszMsg, p_pMeta);
+}
+
+void LegacyBackend::liveness_batch(const CImage_t** p_ppImages, size_t p_nCount, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs)
+{
+	mi_check_liveness_batch(p_ppImages, p_nCount, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+}
+
+bool mi_backend_screened_out(const uint8_t* p_pData, size_t p_nLen, int* p_pErr, char* p_pszMsg)
+{
+	ImageInfo info;
+	std::string strWhy;
+	if (!mi_image_info(p_pData, p_nLen, info) || !mi_image_too_small(info, strWhy)) return false;
+	*p_pErr = FACE_TOO_SMALL;
+	snprintf(p_pszMsg, MESSAGE_BUFFER_SIZE, "%s", strWhy.c_str());
+	return true;
+}
+
+CPipelineResult_t LegacyBackend::check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	if (mi_backend_screened_out(p_pData, p_nLen, p_pErr, p_pszMsg)) {
+		CPipelineResult_t result;
+		memset(&result, 0, sizeof(result));
+		return result;
+	}
+	StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+	auto start = std::chrono::steady_clock::now();
+	ImageHandle image = mi_image_decode(p_pData, p_nLen, p_pErr, p_pszMsg);
+	tCreate.stop();
+	if (image && mi_watchdog_expired(MI_WATCH_DECODE, start, p_pErr, p_pszMsg)) {
+		CPipelineResult_t result;
+		memset(&result, 0, sizeof(result));
+		return result;
+	}
+	return gated_liveness(image, p_pMeta, p_pErr, p_pszMsg);
+}
+
+CPipelineResult_t LegacyBackend::check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+	auto start = std::chrono::steady_clock::now();
+	ImageHandle image = mi_image_pixels(p_pPixels, p_nWidth, p_nHeight, p_encoding, p_pErr, p_pszMsg);
+	tCreate.stop();
+	if (image && mi_watchdog_expired(MI_WATCH_DECODE, start, p_pErr, p_pszMsg)) {
+		CPipelineResult_t result;
+		memset(&result, 0, sizeof(result));
+		return result;
+	}
+	return gated_liveness(image, p_pMeta, p_pErr, p_pszMsg);
+}
+
+void LegacyBackend::check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs)
+{
+	size_t n = p_vData.size();
+	std::vector<ImageHandle> images(n);
+	std::vector<char> screened(n, 0);
+
+	//. the images are decoded in parallel on the executor, see MiExecutor.h
+	//. with [watchdog] decode_ms, the images not started by then are answered with a timeout.
+	RequestContext* ctx = mi_context();
+	StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+	auto start = std::chrono::steady_clock::now();
+	mi_parallel_for(n, [&](size_t i) {
+		const uint8_t* pData = (const uint8_t*)p_vData[i]->data();
+		if (mi_backend_screened_out(pData, p_vData[i]->size(), &p_pErrors[i], p_ppszMsgs[i])
+			|| mi_watchdog_expired(MI_WATCH_DECODE, start, &p_pErrors[i], p_ppszMsgs[i], ctx)) {
+			memset(&p_pResults[i], 0, sizeof(p_pResults[i]));
+			screened[i] = 1;
+			return;
+		}
+		images[i] = mi_image_decode(pData, p_vData[i]->size(), &p_pErrors[i], p_ppszMsgs[i], ctx);
+	});
+	tCreate.stop();
+
+	//. only the images that pass the gate are batched.
+	std::vector<size_t> pass;
+	std::vector<const CImage_t*> batch;
+	for (size_t i = 0; i < n; i++) {
+		if (screened[i]) continue;
+		const CImage_t* pImage = images[i] ? images[i]->get() : NULL;
+		if (pImage == NULL || mi_gate_check(pImage, p_pResults[i], &p_pErrors[i], p_ppszMsgs[i])) {
+			pass.push_back(i);
+			batch.push_back(pImage);
+		}
+	}
+	if (!batch.empty()) {
+		std::vector<CPipelineResult_t> results(batch.size());
+		std::vector<int> errors(batch.size(), OK);
+		std::vector<char*> msgs(batch.size());
+		for (size_t j = 0; j < pass.size(); j++) {
+			errors[j] = p_pErrors[pass[j]];
+			msgs[j] = p_ppszMsgs[pass[j]];
+		}
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		liveness_batch(batch.data(), batch.size(), p_pMeta, results.data(), errors.data(), msgs.data());
+		tLiveness.stop();
+		for (size_t j = 0; j < pass.size(); j++) {
+			p_pResults[pass[j]] = results[j];
+			p_pErrors[pass[j]] = errors[j];
+		}
+	}
+}
+
+//. the SDK's answer on an image the prefilter judged.
+static PrefilterSdk prefilter_sdk(const CPipelineResult_t& p_result, int p_nErr)
+{
+	if (p_nErr != OK) return MI_PREFILTER_SDK_REJECTED;
+	return mi_verdict_of(mi_verdict_policy(), p_result, p_nErr) == MI_VERDICT_BAD_QUALITY ? MI_PREFILTER_SDK_BAD_QUALITY : MI_PREFILTER_SDK_USABLE;
+}
+
+class PrefilterBackend : public InferenceBackend {
+public:
+	explicit PrefilterBackend(InferenceBackend* p_pInner) : m_pInner(p_pInner), m_nRejects(0) {}
+	~PrefilterBackend() { delete m_pInner; }
+
+	const char* name() const override { return m_pInner->name(); }
+
+	//. the SDK decodes these, the prefilter has no pixels to look at.
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		return m_pInner->check(p_pData, p_nLen, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		const MiSettings& s = mi_config();
+		PrefilterThresholds t;
+		t.side = s.prefilterSide;
+		t.minSharpness = s.prefilterMinSharpness;
+		t.darkLevel = s.prefilterDarkLevel;
+		t.darkPercent = s.prefilterDarkPercent;
+		StageTimer tPrefilter(MI_STAGE_PREFILTER);
+		PrefilterOutcome outcome = mi_prefilter_judge(p_pPixels, p_nWidth, p_nHeight, (size_t)p_nWidth * 3, p_encoding, t);
+		tPrefilter.stop();
+		mi_metrics_prefilter(outcome);
+		if (outcome == MI_PREFILTER_SKIPPED) return m_pInner->check_pixels(p_pPixels, p_nWidth, p_nHeight, p_encoding, p_pMeta, p_pErr, p_pszMsg);
+
+		bool bReject = outcome != MI_PREFILTER_PASS;
+		if (bReject && !audit(s.prefilterAuditPercent)) {
+			//. answered as the gate's quality stage : "bad quality", stage "quality".
+			CPipelineResult_t result;
+			memset(&result, 0, sizeof(result));
+			result.quality_result.ok = true;
+			*p_pErr = OK;
+			return result;
+		}
+		CPipelineResult_t result = m_pInner->check_pixels(p_pPixels, p_nWidth, p_nHeight, p_encoding, p_pMeta, p_pErr, p_pszMsg);
+		mi_metrics_prefilter_agreement(bReject, prefilter_sdk(result, *p_pErr));
+		return result;
+	}
+
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override
+	{
+		m_pInner->check_batch(p_vData, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+	}
+
+	void warm_up(int p_nIterations) override { m_pInner->warm_up(p_nIterations); }
+	BackendRuntime runtime() const override { return m_pInner->runtime(); }
+
+private:
+	//. every rejection advances the count, one goes to the SDK each time it crosses another 100 %.
+	bool audit(double p_dPercent)
+	{
+		if (p_dPercent <= 0) return false;
+		if (p_dPercent >= 100) return true;
+		uint64_t nMilli = (uint64_t)(p_dPercent * 1000 + 0.5);
+		uint64_t n = m_nRejects.fetch_add(1, std::memory_order_relaxed);
+		return (n + 1) * nMilli / 100000 != n * nMilli / 100000;
+	}
+
+	InferenceBackend*		m_pInner;
+	std::atomic<uint64_t>	m_nRejects;
+};
+
+InferenceBackend* mi_prefilter_backend(InferenceBackend* p_pInner)
+{
+	return new PrefilterBackend(p_pInner);
+}
+
+InferenceBackend* mi_backend_create(const std::string& p_strEngine, std::string& p_strErr)
+{
+	return mi_backend_create(p_strEngine, mi_blueprint_settings(), p_strErr);
+}
+
+InferenceBackend* mi_backend_create(const std::string& p_strEngine, const BlueprintSettings& p_blueprint, std::string& p_strErr)
+{
+	if (p_strEngine.empty() || p_strEngine == "legacy") return new LegacyBackend;
+	if (p_strEngine == "blueprint") {
+		BlueprintBackend* p = new BlueprintBackend;
+		if (p->start(p_blueprint, p_strErr)) return p;
+		delete p;
+		return NULL;
+	}
+	if (p_strEngine == "cpp") {
+		CppBackend* p = new CppBackend;
+		if (p->start(p_strErr)) return p;
+		delete p;
+		return NULL;
+	}
+	p_strErr = "unknown engine " + p_strEngine;
+	return NULL;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiImage.h"
+
+//. Inference engine behind the check endpoints, chosen once at startup by
+//. [backend] engine :
+//. - "legacy"    : image_create_bytes + the CPipeline_t C API (batcher, pool, supervisor).
+//. - "blueprint" : idliveface::Blueprint / FaceAnalyzer / ImageDecoder, see MiBlueprint.h.
+//. - "cpp"       : the legacy pipeline through the facesdk:: C++ API, see MiCppBackend.h.
+//. Results are returned as CPipelineResult_t + STATUS so the cache and the JSON
+//. writers stay engine independent. GD_API_SEQUENCE always runs on the legacy API.
+//. p_pMeta is a prebuilt MiMeta.h entry (NULL = pipeline defaults); the blueprint
+//. engine has no calibration input and ignores it.
+//. runtime configuration in effect, reported on GD_API_METRICS.
+struct BackendRuntime {
+	std::string		profile;				//. [backend] profile, empty = engine defaults
+	int				workerThreads;
+	int				backendThreads;
+	int				backendInvocations;
+	BackendRuntime() : workerThreads(0), backendThreads(0), backendInvocations(0) {}
+};
+
+class InferenceBackend {
+public:
+	virtual ~InferenceBackend() {}
+
+	virtual const char* name() const = 0;
+
+	//. decodes one encoded upload (JPEG, PNG ...) and checks it.
+	virtual CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) = 0;
+
+	//. p_nWidth * p_nHeight * 3 contiguous bytes, no decode.
+	virtual CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) = 0;
+
+	//. p_vData.size() uploads; p_ppszMsgs holds one MESSAGE_BUFFER_SIZE buffer per image.
+	virtual void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) = 0;
+
+	//. dummy checks before ready; the legacy pipelines are warmed by MiWarmup itself.
+	virtual void warm_up(int p_nIterations) {}
+
+	virtual BackendRuntime runtime() const { return BackendRuntime(); }
+};
+
+//. CPipeline_t path : batcher / pool / supervisor as configured, see MiInference.h.
+//. liveness / liveness_batch run the gated images; other pipeline sets override them (MiDevice.h).
+class LegacyBackend : public InferenceBackend {
+public:
+	const char* name() const override { return "legacy"; }
+
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override;
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override;
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override;
+
+protected:
+	virtual CPipelineResult_t liveness(const CImage_t* p_pImage, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg);
+	//. p_ppImages may hold NULL entries (decode failures), see mi_check_liveness_batch.
+	virtual void liveness_batch(const CImage_t** p_ppImages, size_t p_nCount, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs);
+
+private:
+	CPipelineResult_t gated_liveness(const ImageHandle& p_image, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg);
+};
+
+//. FACE_TOO_SMALL from the header alone when the image is below server.min_image_side.
+bool mi_backend_screened_out(const uint8_t* p_pData, size_t p_nLen, int* p_pErr, char* p_pszMsg);
+
+//. p_pInner behind the blur / darkness prefilter (MiPrefilter.h) on check_pixels, thresholds
+//. from mi_config(); takes ownership.
+InferenceBackend* mi_prefilter_backend(InferenceBackend* p_pInner);
+
+struct BlueprintSettings;
+
+//. NULL and p_strErr set when the engine is unknown or cannot be initialised.
+//. The blueprint engine is built from the [backend] values, or from p_blueprint.
+InferenceBackend* mi_backend_create(const std::string& p_strEngine, std::string& p_strErr);
+InferenceBackend* mi_backend_create(const std::string& p_strEngine, const BlueprintSettings& p_blueprint, std::string& p_strErr);
+
+extern InferenceBackend* g_pBackend;
@@ -0,0 +1,161 @@
+#include "MiBase64.h"
+#include "MiCpu.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_BASE64_SSE 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define LD_TARGET_SSE41
+#else
+#define LD_TARGET_SSE41 __attribute__((target("ssse3,sse4.1")))
+#endif
+#else
+#define LD_BASE64_SSE 0
+#endif
+
+static const uint8_t LD_INVALID = 0xFF;
+static const uint8_t LD_SPACE = 0xFE;
+static const uint8_t LD_PAD = 0xFD;
+
+struct Base64Table {
+	uint8_t v[256];
+	Base64Table() {
+		memset(v, LD_INVALID, sizeof(v));
+		const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (int i = 0; i < 64; i++) v[(uint8_t)alphabet[i]] = (uint8_t)i;
+		v[(uint8_t)' '] = v[(uint8_t)'\t'] = v[(uint8_t)'\r'] = v[(uint8_t)'\n'] = LD_SPACE;
+		v[(uint8_t)'='] = LD_PAD;
+	}
+};
+static const Base64Table lv_table;
+
+//. 16 characters into 12 bytes or false; NULL = scalar only.
+typedef bool (*DecodeBlockFn)(const char* p_pIn, uint8_t* p_pOut);
+static DecodeBlockFn lv_fnBlock = NULL;
+
+#if LD_BASE64_SSE
+//. Decodes 16 base64 characters into 12 bytes (W. Mula's pshufb bitmask method).
+//. Returns false when the block holds anything but the 64 alphabet characters.
+//. Writes 16 bytes to p_pOut, the last 4 are scratch.
+LD_TARGET_SSE41 static bool decode_block_sse(const char* p_pIn, uint8_t* p_pOut)
+{
+	const __m128i input = _mm_loadu_si128((const __m128i*)p_pIn);
+	const __m128i higher_nibble = _mm_and_si128(_mm_srli_epi32(input, 4), _mm_set1_epi8(0x0f));
+	const __m128i lower_nibble = _mm_and_si128(input, _mm_set1_epi8(0x0f));
+
+	const __m128i shiftLUT = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i maskLUT = _mm_setr_epi8(
+		(char)0xa8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8,
+		(char)0xf8, (char)0xf8, (char)0xf0, (char)0x54, (char)0x50, (char)0x50, (char)0x50, (char)0x54);
+	const __m128i bitposLUT = _mm_setr_epi8(
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	const __m128i sh = _mm_shuffle_epi8(shiftLUT, higher_nibble);
+	const __m128i eq_2f = _mm_cmpeq_epi8(input, _mm_set1_epi8(0x2f));
+	const __m128i shift = _mm_blendv_epi8(sh, _mm_set1_epi8(16), eq_2f);
+	const __m128i M = _mm_shuffle_epi8(maskLUT, lower_nibble);
+	const __m128i bit = _mm_shuffle_epi8(bitposLUT, higher_nibble);
+	const __m128i non_match = _mm_cmpeq_epi8(_mm_and_si128(M, bit), _mm_setzero_si128());
+	if (_mm_movemask_epi8(non_match) != 0) return false;
+
+	const __m128i values = _mm_add_epi8(input, shift);
+	const __m128i merge_ab_bc = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+	const __m128i merged = _mm_madd_epi16(merge_ab_bc, _mm_set1_epi32(0x00011000));
+	const __m128i packed = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	_mm_storeu_si128((__m128i*)p_pOut, packed);
+	return true;
+}
+#endif
+
+static void bind_base64(int p_nVariant)
+{
+#if LD_BASE64_SSE
+	lv_fnBlock = p_nVariant == 1 ? decode_block_sse : NULL;
+#else
+	(void)p_nVariant;
+	lv_fnBlock = NULL;
+#endif
+}
+
+static const char* const lv_szVariants[] = { "scalar", "sse4.1" };
+static const uint32_t lv_nNeeds[] = { 0, MI_CPU_SSSE3 | MI_CPU_SSE41 };
+static MiCpuKernel lv_kernel = { "base64", LD_BASE64_SSE ? 2 : 1, lv_szVariants, lv_nNeeds, bind_base64, 0, 0 };
+static const bool lv_bRegistered = mi_cpu_register(&lv_kernel);
+
+Base64StreamDecoder::Base64StreamDecoder(std::string* p_pOut, size_t p_nSizeHint, Hash64Stream* p_pHash)
+	: m_pOut(p_pOut), m_pHash(p_pHash), m_nLen(0), m_nAccum(0), m_nBits(0), m_nPad(0)
+{
+	//. +16 leaves room for the scratch tail of the vector store.
+	m_pOut->resize(p_nSizeHint + 16);
+}
+
+void Base64StreamDecoder::reserve(size_t p_nExtra)
+{
+	size_t need = m_nLen + p_nExtra + 16;
+	if (m_pOut->size() < need) {
+		size_t grow = m_pOut->size() * 2;
+		m_pOut->resize(grow > need ? grow : need);
+	}
+}
+
+bool Base64StreamDecoder::feed(const char* p_pszData, size_t p_nLen)
+{
+	reserve(base64_decoded_bound(p_nLen));
+	uint8_t* out = (uint8_t*)&(*m_pOut)[0];
+	size_t nFrom = m_nLen;
+
+	while (p_nLen > 0) {
+		if (lv_fnBlock != NULL && m_nBits == 0 && m_nPad == 0) {
+			while (p_nLen >= 16 && lv_fnBlock(p_pszData, out + m_nLen)) {
+				m_nLen += 12;
+				p_pszData += 16;
+				p_nLen -= 16;
+			}
+			if (p_nLen == 0) break;
+		}
+		size_t used = 0;
+		if (!feed_scalar(p_pszData, p_nLen, used)) return false;
+		p_pszData += used;
+		p_nLen -= used;
+	}
+	if (m_pHash != NULL) m_pHash->update(out + nFrom, m_nLen - nFrom);
+	return true;
+}
+
+//. decodes up to the next quad boundary (or the end of input), so the caller
+//. can hand aligned groups back to the vector path.
+bool Base64StreamDecoder::feed_scalar(const char* p_pszData, size_t p_nLen, size_t& p_nUsed)
+{
+	uint8_t* out = (uint8_t*)&(*m_pOut)[0];
+	size_t i = 0;
+	while (i < p_nLen) {
+		uint8_t v = lv_table.v[(uint8_t)p_pszData[i++]];
+		if (v < 64) {
+			if (m_nPad != 0) return false;
+			m_nAccum = (m_nAccum << 6) | v;
+			m_nBits += 6;
+			if (m_nBits >= 8) {
+				m_nBits -= 8;
+				out[m_nLen++] = (uint8_t)(m_nAccum >> m_nBits);
+			}
+		}
+		else if (v == LD_PAD) {
+			if (++m_nPad > 2) return false;
+		}
+		else if (v != LD_SPACE) {
+			return false;
+		}
+		if (m_nBits == 0) break;
+	}
+	p_nUsed = i;
+	return true;
+}
+
+bool Base64StreamDecoder::finish()
+{
+	//. leftover bits must be padding zeros of a 2- or 3-char final quad.
+	bool ok = (m_nBits == 0 || m_nBits == 2 || m_nBits == 4) && (m_nAccum & ((1u << m_nBits) - 1)) == 0;
+	m_pOut->resize(m_nLen);
+	return ok;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "MiHash.h"
+
+//. Incremental base64 decoder writing into one caller-owned buffer.
+//. Input may arrive in arbitrary pieces; ASCII whitespace is skipped.
+//. Full 16-character groups are decoded with SSSE3/SSE4.1 when the CPU has it (MiCpu.h).
+class Base64StreamDecoder {
+public:
+	//. p_pOut receives the decoded bytes starting at offset 0. p_nSizeHint is the
+	//. expected decoded size, used to size the buffer once up front. p_pHash, when given,
+	//. is fed the bytes each feed() decodes, while they are still in cache.
+	Base64StreamDecoder(std::string* p_pOut, size_t p_nSizeHint, Hash64Stream* p_pHash = NULL);
+
+	//. returns false on a character outside the base64 alphabet.
+	bool feed(const char* p_pszData, size_t p_nLen);
+
+	//. validates the tail and trims the buffer to the decoded size.
+	bool finish();
+
+	size_t size() const { return m_nLen; }
+
+private:
+	bool feed_scalar(const char* p_pszData, size_t p_nLen, size_t& p_nUsed);
+	void reserve(size_t p_nExtra);
+
+	std::string*	m_pOut;
+	Hash64Stream*	m_pHash;
+	size_t			m_nLen;
+	uint32_t		m_nAccum;
+	int				m_nBits;
+	int				m_nPad;
+};
+
+//. Upper bound of the decoded size of p_nEncoded base64 characters.
+inline size_t base64_decoded_bound(size_t p_nEncoded) { return (p_nEncoded / 4 + 1) * 3; }
@@ -0,0 +1,712 @@
+#include "MiBatchCli.h"
+#include "FaceSdkApi.h"
+#include "MIServer.h"
+#include "MiArchive.h"
+#include "MiBackend.h"
+#include "MiBufferPool.h"
+#include "MiDedup.h"
+#include "MiHash.h"
+#include "MiLicense.h"
+#include "MiMeta.h"
+#include "MiMsgBuffers.h"
+#include "MiParquet.h"
+#include "MiPipelinePool.h"
+#include "MiResultJson.h"
+#include "MiSettings.h"
+#include "Poco/File.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Path.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/String.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LD_BATCH_OUT_DEFAULT	"verdicts.csv"
+#define LD_BATCH_CHUNK			16
+#define LD_BATCH_PROGRESS_SEC	5
+#define LD_BATCH_READERS		8
+#define LD_BATCH_ROW_GROUP		65536
+#define LD_BATCH_CSV_HEADER		"path,verdict,probability,score,quality,status,message\n"
+
+struct BatchOptions {
+	std::string		input;
+	std::string		out;
+	bool			resume;
+	bool			jsonl;
+	bool			parquet;
+	int				rowGroup;
+	int				chunk;
+	int				workers;		//. 0 = pool size
+	int				readers;
+	int				readAhead;		//. chunks, 0 = 2 x workers
+	std::string		meta;
+	int				progressSec;
+};
+
+//. what the output holds : the first items inputs of input, in bytes bytes.
+struct BatchCheckpoint {
+	std::string		input;
+	uint64_t		items;
+	uint64_t		bytes;
+};
+
+static bool parse_options(int argc, char* argv[], BatchOptions& o)
+{
+	o.out = LD_BATCH_OUT_DEFAULT;
+	o.resume = false;
+	o.chunk = LD_BATCH_CHUNK;
+	o.workers = 0;
+	o.readers = LD_BATCH_READERS;
+	o.readAhead = 0;
+	o.meta = g_Settings.metaDefault;
+	o.progressSec = LD_BATCH_PROGRESS_SEC;
+	o.rowGroup = LD_BATCH_ROW_GROUP;
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "--resume") {
+			o.resume = true;
+			continue;
+		}
+		if (i + 1 >= argc) return false;
+		std::string v = argv[++i];
+		int n = 0;
+		if (a == "--batch") o.input = v;
+		else if (a == "--out") o.out = v;
+		else if (a == "--meta") o.meta = v;
+		else if (a == "--chunk" && Poco::NumberParser::tryParse(v, n) && n > 0) o.chunk = n;
+		else if (a == "--workers" && Poco::NumberParser::tryParse(v, n) && n > 0) o.workers = n;
+		else if (a == "--readers" && Poco::NumberParser::tryParse(v, n) && n > 0) o.readers = n;
+		else if (a == "--read-ahead" && Poco::NumberParser::tryParse(v, n) && n > 0) o.readAhead = n;
+		else if (a == "--progress-sec" && Poco::NumberParser::tryParse(v, n) && n > 0) o.progressSec = n;
+		else if (a == "--row-group" && Poco::NumberParser::tryParse(v, n) && n > 0) o.rowGroup = n;
+		else return false;
+	}
+	std::string strExt = Poco::toLower(Poco::Path(o.out).getExtension());
+	o.jsonl = strExt == "jsonl" || strExt == "ndjson";
+	o.parquet = strExt == "parquet";
+	return !o.input.empty();
+}
+
+static bool image_extension(const std::string& p_strPath)
+{
+	std::string strExt = Poco::toLower(Poco::Path(p_strPath).getExtension());
+	return strExt == "jpg" || strExt == "jpeg" || strExt == "png" || strExt == "bmp";
+}
+
+//. a directory tree on p_nThreads threads : each lists one directory at a time and
+//. queues the subdirectories it finds for any of them.
+static void scan_tree(const std::string& p_strRoot, int p_nThreads, std::vector<std::string>& p_vPaths)
+{
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::vector<std::string> vDirs(1, p_strRoot);
+	int nBusy = 0;
+	auto fnScan = [&]() {
+		std::unique_lock<std::mutex> lock(mtx);
+		for (;;) {
+			cv.wait(lock, [&] { return !vDirs.empty() || nBusy == 0; });
+			if (vDirs.empty()) return;
+			std::string strDir = vDirs.back();
+			vDirs.pop_back();
+			nBusy++;
+			lock.unlock();
+			std::vector<std::string> vSub, vFiles;
+			try {
+				Poco::DirectoryIterator end;
+				for (Poco::DirectoryIterator it(strDir); it != end; ++it) {
+					if (it->isDirectory()) vSub.push_back(it.path().toString());
+					else if (it->isFile() && image_extension(it.path().toString())) vFiles.push_back(it.path().toString());
+				}
+			}
+			catch (Poco::Exception& ex) {
+				printf("Batch : skipping %s : %s\n", strDir.c_str(), ex.displayText().c_str());
+			}
+			lock.lock();
+			vDirs.insert(vDirs.end(), vSub.begin(), vSub.end());
+			p_vPaths.insert(p_vPaths.end(), vFiles.begin(), vFiles.end());
+			nBusy--;
+			cv.notify_all();
+		}
+	};
+	std::vector<std::thread> vThreads;
+	for (int i = 0; i < p_nThreads; i++) vThreads.emplace_back(fnScan);
+	for (auto& t : vThreads) t.join();
+}
+
+//. the images of a directory tree, an archive or a manifest, in a stable order (resume
+//. counts on it); for an archive p_pArchive is set and the paths are its entry names.
+static bool list_inputs(const std::string& p_strInput, int p_nThreads, std::vector<std::string>& p_vPaths, std::unique_ptr<Archive>& p_pArchive)
+{
+	Poco::File input(p_strInput);
+	if (!input.exists()) return false;
+	if (input.isFile() && Archive::is_archive(p_strInput)) {
+		p_pArchive.reset(Archive::open(p_strInput, image_extension));
+		if (!p_pArchive) return false;
+		for (size_t i = 0; i < p_pArchive->size(); i++) p_vPaths.push_back(p_pArchive->name(i));
+		return true;
+	}
+	if (input.isDirectory()) {
+		scan_tree(p_strInput, p_nThreads, p_vPaths);
+		std::sort(p_vPaths.begin(), p_vPaths.end());
+		return true;
+	}
+
+	std::ifstream in(p_strInput);
+	if (!in) return false;
+	Poco::Path base = Poco::Path(p_strInput).makeAbsolute().parent();
+	std::string strLine;
+	while (std::getline(in, strLine)) {
+		size_t end = strLine.find_first_of(",\t\r");
+		std::string strPath = Poco::trim(strLine.substr(0, end));
+		if (strPath.empty() || strPath[0] == '#') continue;
+		Poco::Path path(strPath);
+		p_vPaths.push_back(path.isAbsolute() ? strPath : Poco::Path(base, path).toString());
+	}
+	return true;
+}
+
+static bool read_checkpoint(const std::string& p_strPath, BatchCheckpoint& p_ckpt)
+{
+	std::ifstream in(p_strPath);
+	if (!in) return false;
+	std::string strLine;
+	bool bItems = false, bBytes = false;
+	while (std::getline(in, strLine)) {
+		size_t eq = strLine.find('=');
+		if (eq == std::string::npos) continue;
+		std::string strKey = strLine.substr(0, eq), strValue = strLine.substr(eq + 1);
+		if (strKey == "input") p_ckpt.input = strValue;
+		else if (strKey == "items") bItems = Poco::NumberParser::tryParseUnsigned64(strValue, p_ckpt.items);
+		else if (strKey == "bytes") bBytes = Poco::NumberParser::tryParseUnsigned64(strValue, p_ckpt.bytes);
+	}
+	return bItems && bBytes;
+}
+
+//. written aside and renamed over, a crash leaves the old checkpoint or the new one.
+static void write_checkpoint(const std::string& p_strPath, const BatchCheckpoint& p_ckpt)
+{
+	std::string strTmp = p_strPath + ".tmp";
+	{
+		std::ofstream out(strTmp, std::ios::trunc);
+		out << "input=" << p_ckpt.input << "\nitems=" << p_ckpt.items << "\nbytes=" << p_ckpt.bytes << "\n";
+	}
+	Poco::File(strTmp).renameTo(p_strPath);
+}
+
+static void csv_field(std::string& p_out, const std::string& p_strValue)
+{
+	if (p_strValue.find_first_of(",\"\r\n") == std::string::npos) {
+		p_out += p_strValue;
+		return;
+	}
+	p_out += '"';
+	for (char c : p_strValue) {
+		if (c == '"') p_out += '"';
+		p_out += c;
+	}
+	p_out += '"';
+}
+
+static void csv_float(std::string& p_out, float p_f)
+{
+	char sz[32];
+	snprintf(sz, sizeof(sz), "%.6g", p_f);
+	p_out += sz;
+}
+
+static void format_result(const BatchOptions& p_opt, std::string& p_out, const std::string& p_strPath, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg)
+{
+	if (p_opt.jsonl) {
+		ArenaString line;
+		line += "{\"path\":";
+		mi_json_put_string(line, p_strPath.c_str());
+		line += ",\"result\":";
+		mi_json_result(MI_SCHEMA_V2, line, p_result, p_nErr, p_pszMsg);
+		line += "}\n";
+		p_out.append(line.data(), line.size());
+		return;
+	}
+	csv_field(p_out, p_strPath);
+	p_out += ',';
+	p_out += mi_result_verdict(p_result, p_nErr);
+	p_out += ',';
+	if (p_nErr == OK) {
+		csv_float(p_out, p_result.liveness_result.probability);
+		p_out += ',';
+		csv_float(p_out, p_result.liveness_result.score);
+		p_out += ',';
+		csv_float(p_out, p_result.quality_result.score);
+	}
+	else p_out += ",,";
+	p_out += ',';
+	p_out += face_sdk_status_name(face_sdk_status(p_nErr, p_pszMsg));
+	p_out += ',';
+	if (p_nErr != OK) csv_field(p_out, p_pszMsg);
+	p_out += '\n';
+}
+
+//. one line of a Parquet output, see ParquetSink.
+struct BatchRow {
+	uint64_t		hash;
+	std::string		verdict;
+	bool			ok;
+	float			probability, score, quality;
+	std::string		status;
+	std::string		message;
+	float			latencyMs;
+};
+
+static void make_row(BatchRow& p_row, uint64_t p_nHash, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, float p_fLatencyMs)
+{
+	p_row.hash = p_nHash;
+	p_row.verdict = mi_result_verdict(p_result, p_nErr);
+	p_row.ok = p_nErr == OK;
+	p_row.probability = p_result.liveness_result.probability;
+	p_row.score = p_result.liveness_result.score;
+	p_row.quality = p_result.quality_result.score;
+	p_row.status = face_sdk_status_name(face_sdk_status(p_nErr, p_pszMsg));
+	if (!p_row.ok) p_row.message = p_pszMsg;
+	p_row.latencyMs = p_fLatencyMs;
+}
+
+//. chunks complete out of order; the written prefix grows only in input order.
+class BatchWriter {
+public:
+	BatchWriter(std::ofstream& p_out, const std::string& p_strCheckpoint, const BatchCheckpoint& p_start)
+		: m_out(p_out), m_strCheckpoint(p_strCheckpoint), m_ckpt(p_start), m_nNext(0), m_bFailed(false) {}
+
+	void deliver(size_t p_nChunk, size_t p_nItems, std::string& p_strText)
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_pending[p_nChunk].first = p_nItems;
+		m_pending[p_nChunk].second.swap(p_strText);
+		bool bWrote = false;
+		for (auto it = m_pending.find(m_nNext); it != m_pending.end(); it = m_pending.find(m_nNext)) {
+			m_out.write(it->second.second.data(), (std::streamsize)it->second.second.size());
+			m_ckpt.items += it->second.first;
+			m_ckpt.bytes += it->second.second.size();
+			m_pending.erase(it);
+			m_nNext++;
+			bWrote = true;
+		}
+		if (!bWrote) return;
+		//. the lines reach the file before the checkpoint counts them.
+		m_out.flush();
+		if (!m_out) m_bFailed = true;
+		else write_checkpoint(m_strCheckpoint, m_ckpt);
+	}
+	bool failed() const { return m_bFailed; }
+
+private:
+	std::ofstream&								m_out;
+	std::string									m_strCheckpoint;
+	BatchCheckpoint								m_ckpt;
+	size_t										m_nNext;		//. next chunk to write
+	std::map<size_t, std::pair<size_t, std::string>>	m_pending;
+	std::mutex									m_mtx;
+	bool										m_bFailed;
+};
+
+//. The Parquet output : workers hand over the rows of a chunk and go back to inference;
+//. the chunks are put back in input order and one thread encodes them into the columns and
+//. writes a row group every p_nRowGroup rows, the footer when finish() is called.
+class ParquetSink {
+public:
+	ParquetSink(const std::vector<std::string>& p_vPaths, size_t p_nFirst, size_t p_nChunk, size_t p_nRowGroup)
+		: m_vPaths(p_vPaths), m_nFirst(p_nFirst), m_nChunk(p_nChunk), m_nRowGroup(p_nRowGroup), m_writer(columns()),
+		  m_nNext(0), m_bDone(false), m_bFailed(false) {}
+	~ParquetSink() { finish(); }
+
+	bool open(const std::string& p_strPath)
+	{
+		if (!m_writer.open(p_strPath)) return false;
+		m_thread = std::thread(&ParquetSink::write_loop, this);
+		return true;
+	}
+	void deliver(size_t p_nChunk, std::vector<BatchRow>& p_vRows)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_pending[p_nChunk].swap(p_vRows);
+			for (auto it = m_pending.find(m_nNext); it != m_pending.end(); it = m_pending.find(m_nNext)) {
+				m_ready.emplace_back(m_nNext, std::move(it->second));
+				m_pending.erase(it);
+				m_nNext++;
+			}
+		}
+		m_cv.notify_one();
+	}
+	bool failed() const { return m_bFailed; }
+	//. writes what is left and the footer; false when the file could not be written.
+	bool finish()
+	{
+		if (!m_thread.joinable()) return !m_bFailed;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bDone = true;
+		}
+		m_cv.notify_one();
+		m_thread.join();
+		if (!m_writer.close()) m_bFailed = true;
+		return !m_bFailed;
+	}
+
+private:
+	enum { C_PATH, C_HASH, C_VERDICT, C_PROBABILITY, C_SCORE, C_QUALITY, C_STATUS, C_MESSAGE, C_LATENCY };
+
+	static std::vector<ParquetColumn> columns()
+	{
+		return {
+			{ "path", MI_PARQUET_STRING, false },
+			{ "hash", MI_PARQUET_INT64, false },
+			{ "verdict", MI_PARQUET_STRING, false },
+			{ "probability", MI_PARQUET_FLOAT, true },
+			{ "score", MI_PARQUET_FLOAT, true },
+			{ "quality", MI_PARQUET_FLOAT, true },
+			{ "status", MI_PARQUET_STRING, false },
+			{ "message", MI_PARQUET_STRING, true },
+			{ "latency_ms", MI_PARQUET_FLOAT, false }
+		};
+	}
+
+	void write_loop()
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+		for (;;) {
+			m_cv.wait(lock, [&] { return m_bDone || !m_ready.empty(); });
+			if (m_ready.empty()) return;
+			std::pair<size_t, std::vector<BatchRow>> chunk = std::move(m_ready.front());
+			m_ready.pop_front();
+			lock.unlock();
+			size_t first = m_nFirst + chunk.first * m_nChunk;
+			for (size_t i = 0; i < chunk.second.size(); i++) {
+				const BatchRow& r = chunk.second[i];
+				m_writer.put_string(C_PATH, m_vPaths[first + i]);
+				m_writer.put_int64(C_HASH, (int64_t)r.hash);
+				m_writer.put_string(C_VERDICT, r.verdict);
+				if (r.ok) {
+					m_writer.put_float(C_PROBABILITY, r.probability);
+					m_writer.put_float(C_SCORE, r.score);
+					m_writer.put_float(C_QUALITY, r.quality);
+					m_writer.put_null(C_MESSAGE);
+				}
+				else {
+					m_writer.put_null(C_PROBABILITY);
+					m_writer.put_null(C_SCORE);
+					m_writer.put_null(C_QUALITY);
+					m_writer.put_string(C_MESSAGE, r.message);
+				}
+				m_writer.put_string(C_STATUS, r.status);
+				m_writer.put_float(C_LATENCY, r.latencyMs);
+				m_writer.end_row();
+				if (m_writer.rows() >= m_nRowGroup && !m_writer.flush()) m_bFailed = true;
+			}
+			lock.lock();
+		}
+	}
+
+	const std::vector<std::string>&		m_vPaths;
+	size_t								m_nFirst;
+	size_t								m_nChunk;
+	size_t								m_nRowGroup;
+	ParquetWriter						m_writer;
+	size_t								m_nNext;		//. next chunk to queue
+	std::map<size_t, std::vector<BatchRow>>	m_pending;
+	std::deque<std::pair<size_t, std::vector<BatchRow>>>	m_ready;
+	std::mutex							m_mtx;
+	std::condition_variable				m_cv;
+	std::thread							m_thread;
+	bool								m_bDone;
+	std::atomic<bool>					m_bFailed;
+};
+
+//. into p_out as it is, so a pooled buffer keeps its capacity.
+static bool read_file(const std::string& p_strPath, std::string& p_out)
+{
+	p_out.clear();
+	std::ifstream in(p_strPath, std::ios::binary | std::ios::ate);
+	if (!in) return false;
+	std::streamoff n = in.tellg();
+	if (n <= 0 || !in.seekg(0)) return false;
+	p_out.resize((size_t)n);
+	if (!in.read(&p_out[0], n)) {
+		p_out.clear();
+		return false;
+	}
+	return true;
+}
+
+//. the bytes of input i : a file, or an entry of the archive.
+typedef std::function<bool(size_t, std::string&)> BatchReadFn;
+
+//. Reads the inputs of the chunks ahead of the workers : p_nReaders threads take the
+//. next input of the window (the chunks the workers have claimed plus p_nAhead more)
+//. into a g_BufferPool buffer and a chunk is handed out once all its inputs are in.
+//. Workers claim chunks in input order and give the buffers back.
+class ChunkReader {
+public:
+	ChunkReader(BatchReadFn p_fnRead, size_t p_nFirst, size_t p_nCount, size_t p_nChunk, int p_nReaders, int p_nAhead)
+		: m_fnRead(p_fnRead), m_nFirst(p_nFirst), m_nChunk(p_nChunk), m_nFiles(p_nCount),
+		  m_nAhead((size_t)p_nAhead), m_nNextFile(0), m_nClaimed(0), m_bStop(false)
+	{
+		m_nChunks = (m_nFiles + m_nChunk - 1) / m_nChunk;
+		for (int i = 0; i < p_nReaders; i++) m_vThreads.emplace_back(&ChunkReader::read_loop, this);
+	}
+	~ChunkReader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bStop = true;
+		}
+		m_cvSpace.notify_all();
+		for (auto& t : m_vThreads) t.join();
+		for (auto& slot : m_slots) {
+			for (std::string* p : slot.second.data) {
+				if (p != NULL) g_BufferPool.release(p);
+			}
+		}
+	}
+
+	//. the next chunk in input order and its inputs' bytes (empty = unreadable), each to be
+	//. released to g_BufferPool; false once every chunk has been handed out.
+	bool take(size_t& p_nIndex, std::vector<std::string*>& p_vData)
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+		if (m_nClaimed >= m_nChunks) return false;
+		size_t c = m_nClaimed++;
+		m_cvSpace.notify_all();
+		m_cvReady.wait(lock, [&] {
+			auto it = m_slots.find(c);
+			return it != m_slots.end() && it->second.pending == 0;
+		});
+		auto it = m_slots.find(c);
+		p_vData.swap(it->second.data);
+		m_slots.erase(it);
+		p_nIndex = c;
+		return true;
+	}
+
+private:
+	struct Slot {
+		std::vector<std::string*>	data;
+		size_t						pending;		//. inputs still being read
+	};
+
+	void read_loop()
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+		for (;;) {
+			m_cvSpace.wait(lock, [&] { return m_bStop || m_nNextFile >= m_nFiles || m_nNextFile / m_nChunk < m_nClaimed + m_nAhead; });
+			if (m_bStop || m_nNextFile >= m_nFiles) return;
+			size_t f = m_nNextFile++;
+			size_t c = f / m_nChunk;
+			auto it = m_slots.find(c);
+			if (it == m_slots.end()) {
+				Slot slot;
+				slot.pending = std::min(m_nChunk, m_nFiles - c * m_nChunk);
+				slot.data.resize(slot.pending, NULL);
+				it = m_slots.emplace(c, std::move(slot)).first;
+			}
+			lock.unlock();
+			std::string* pBuf = g_BufferPool.acquire(0);
+			m_fnRead(m_nFirst + f, *pBuf);
+			lock.lock();
+			Slot& slot = m_slots[c];
+			slot.data[f % m_nChunk] = pBuf;
+			if (--slot.pending == 0) m_cvReady.notify_all();
+		}
+	}
+
+	BatchReadFn						m_fnRead;
+	size_t							m_nFirst;
+	size_t							m_nChunk;
+	size_t							m_nFiles;
+	size_t							m_nChunks;
+	size_t							m_nAhead;
+	size_t							m_nNextFile;	//. relative to m_nFirst
+	size_t							m_nClaimed;		//. chunks handed to workers (or waited for)
+	bool							m_bStop;
+	std::map<size_t, Slot>			m_slots;
+	std::mutex						m_mtx;
+	std::condition_variable			m_cvSpace;
+	std::condition_variable			m_cvReady;
+	std::vector<std::thread>		m_vThreads;
+};
+
+static int run_batch(const BatchOptions& p_opt)
+{
+	std::vector<std::string> vPaths;
+	std::unique_ptr<Archive> pArchive;
+	if (!list_inputs(p_opt.input, p_opt.readers, vPaths, pArchive)) {
+		printf("Batch : cannot read %s\n", p_opt.input.c_str());
+		return 1;
+	}
+	std::string strInput = Poco::Path(p_opt.input).makeAbsolute().toString();
+	std::string strCheckpoint = p_opt.out + ".ckpt";
+	if (p_opt.parquet && p_opt.resume) {
+		printf("Batch : --resume cannot continue a .parquet output\n");
+		return 2;
+	}
+
+	BatchCheckpoint start = { strInput, 0, 0 };
+	if (p_opt.resume) {
+		BatchCheckpoint ckpt;
+		if (!read_checkpoint(strCheckpoint, ckpt)) {
+			printf("Batch : no checkpoint %s, starting over\n", strCheckpoint.c_str());
+		}
+		else if (ckpt.input != strInput || ckpt.items > vPaths.size()) {
+			printf("Batch : %s is for %s, not this input\n", strCheckpoint.c_str(), ckpt.input.c_str());
+			return 1;
+		}
+		else {
+			//. lines written after the last checkpoint are checked again.
+			Poco::File(p_opt.out).setSize(ckpt.bytes);
+			start = ckpt;
+		}
+	}
+	std::ofstream out;
+	if (!p_opt.parquet) out.open(p_opt.out, std::ios::binary | (start.items > 0 ? std::ios::app : std::ios::trunc));
+	if (!p_opt.parquet && !out) {
+		printf("Batch : cannot write %s\n", p_opt.out.c_str());
+		return 1;
+	}
+	if (start.bytes == 0 && !p_opt.jsonl && !p_opt.parquet) {
+		out << LD_BATCH_CSV_HEADER;
+		start.bytes = strlen(LD_BATCH_CSV_HEADER);
+	}
+
+	int nCalibration = -1, nOs = -1;
+	if (!p_opt.meta.empty() && !mi_meta_parse(p_opt.meta, &nCalibration, &nOs)) {
+		printf("Batch : unknown meta %s\n", p_opt.meta.c_str());
+		return 2;
+	}
+	const CMeta_t* pMeta = mi_meta_get(nCalibration, nOs);
+
+	size_t nTotal = vPaths.size() - (size_t)start.items;
+	size_t nChunk = (size_t)p_opt.chunk;
+	int nWorkers = p_opt.workers > 0 ? p_opt.workers : (g_pPool != NULL ? g_pPool->size() : 1);
+	int nAhead = p_opt.readAhead > 0 ? p_opt.readAhead : 2 * nWorkers;
+	printf("Batch : %zu images (%llu done before), %d workers x %zu per chunk, %d readers %d chunks ahead -> %s\n", nTotal,
+		(unsigned long long)start.items, nWorkers, nChunk, p_opt.readers, nAhead, p_opt.out.c_str());
+
+	BatchWriter writer(out, strCheckpoint, start);
+	std::unique_ptr<ParquetSink> pParquet;
+	if (p_opt.parquet) {
+		pParquet.reset(new ParquetSink(vPaths, (size_t)start.items, nChunk, (size_t)p_opt.rowGroup));
+		if (!pParquet->open(p_opt.out)) {
+			printf("Batch : cannot write %s\n", p_opt.out.c_str());
+			return 1;
+		}
+	}
+	auto fnFailed = [&]() { return writer.failed() || (pParquet && pParquet->failed()); };
+	BatchReadFn fnRead = [&](size_t i, std::string& out) { return pArchive ? pArchive->read(i, out) : read_file(vPaths[i], out); };
+	ChunkReader reader(fnRead, (size_t)start.items, nTotal, nChunk, p_opt.readers, nAhead);
+	std::atomic<size_t> nDone(0), nErrors(0), nDuplicates(0);
+	auto fnWork = [&]() {
+		size_t c = 0;
+		std::vector<std::string*> vData;
+		while (!fnFailed() && reader.take(c, vData)) {
+			size_t first = (size_t)start.items + c * nChunk;
+			size_t n = vData.size();
+			//. an unreadable input is an empty upload the SDK rejects like a corrupt one.
+			std::vector<const std::string*> vRefs(vData.begin(), vData.end());
+			std::vector<CPipelineResult_t> results(n);
+			std::vector<int> errors(n, OK);
+			MsgBuffers msgs(n);
+			std::vector<uint64_t> hashes;
+			if (pParquet || g_Settings.batchDedup) {
+				hashes.resize(n);
+				for (size_t i = 0; i < n; i++) hashes[i] = mi_hash64(vData[i]->data(), vData[i]->size());
+			}
+			auto tCheck = std::chrono::steady_clock::now();
+			//. the same selfie under several records of a chunk is checked once.
+			nDuplicates += mi_dedup_check_batch(g_pBackend, MI_DEDUP_BULK, vRefs, hashes.empty() ? NULL : hashes.data(), pMeta, results.data(), errors.data(), msgs.data());
+			float fLatencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tCheck).count();
+			for (std::string* p : vData) g_BufferPool.release(p);
+			vData.clear();
+
+			size_t nBad = 0;
+			for (size_t i = 0; i < n; i++) {
+				if (errors[i] != OK) nBad++;
+			}
+			if (pParquet) {
+				std::vector<BatchRow> vRows(n);
+				for (size_t i = 0; i < n; i++) make_row(vRows[i], hashes[i], results[i], errors[i], msgs[i], fLatencyMs);
+				pParquet->deliver(c, vRows);
+			}
+			else {
+				std::string strText;
+				for (size_t i = 0; i < n; i++) format_result(p_opt, strText, vPaths[first + i], results[i], errors[i], msgs[i]);
+				writer.deliver(c, n, strText);
+			}
+			nDone += n;
+			nErrors += nBad;
+		}
+	};
+
+	auto t0 = std::chrono::steady_clock::now();
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool bFinished = false;
+	std::thread progress([&]() {
+		std::unique_lock<std::mutex> lock(mtx);
+		while (!cv.wait_for(lock, std::chrono::seconds(p_opt.progressSec), [&] { return bFinished; })) {
+			double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			size_t done = nDone.load();
+			double ips = sec > 0 ? done / sec : 0;
+			double eta = ips > 0 ? (nTotal - done) / ips : 0;
+			printf("Batch : %zu / %zu, %.1f img/s, %zu errors, eta %.0f s\n", done, nTotal, ips, nErrors.load(), eta);
+			fflush(stdout);
+		}
+	});
+
+	std::vector<std::thread> vWorkers;
+	for (int i = 0; i < nWorkers; i++) vWorkers.emplace_back(fnWork);
+	for (auto& t : vWorkers) t.join();
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		bFinished = true;
+	}
+	cv.notify_all();
+	progress.join();
+	bool bFailed = writer.failed() || (pParquet && !pParquet->finish());
+
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	printf("Batch %s : %zu images in %.1f s (%.1f img/s), %zu errors, %zu duplicates (%.1f %%)\n", bFailed ? "stopped, output not writable" : "done",
+		nDone.load(), sec, sec > 0 ? nDone.load() / sec : 0, nErrors.load(), nDuplicates.load(), nDone.load() > 0 ? 100.0 * nDuplicates.load() / nDone.load() : 0.0);
+	return bFailed ? 1 : 0;
+}
+
+int mi_batch_main(int argc, char* argv[])
+{
+	BatchOptions opt;
+	if (!parse_options(argc, argv, opt)) {
+		printf("SfTServerCmd --batch <dir|archive|manifest> [--out file.csv|file.jsonl|file.parquet] [--resume] [--chunk n] [--workers n]\n"
+			"             [--readers n] [--read-ahead chunks] [--meta calibration/os] [--progress-sec n] [--row-group rows]\n");
+		return 2;
+	}
+	//. the decode of a chunk is the parallel part, see MiExecutor.h
+	g_Settings.executorEnable = true;
+	mi_services_start();
+	int nExit = 1;
+#ifdef NDEBUG
+	if (!g_License.valid()) printf("Batch : %s\n", g_License.status()->c_str());
+	else
+#endif
+	nExit = run_batch(opt);
+	mi_services_stop();
+	return nExit;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+//. SfTServerCmd --batch <dir|archive|manifest> [options] : offline re-verification of an archive
+//. without the HTTP layer. The services of the server come up as configured (pool,
+//. executor, backend, [meta], [verdict]) but no listener; the images are read by
+//. --readers threads ahead of the inference, and each chunk goes through one check_batch
+//. call on one of --workers threads - decoded in parallel on the executor (forced on),
+//. then pipeline_check_liveness_batch2 on a pool slot. Verdicts are written in input order.
+//. The readers keep up to --read-ahead chunks of files in memory beyond those being
+//. checked, file by file, so the latency of a network share overlaps with inference
+//. (plain blocking reads on many threads : the same overlap as overlapped I/O or
+//. io_uring without the platform split). A directory is scanned by the readers too.
+//.   <dir>                 every .jpg / .jpeg / .png / .bmp below it, sorted by path
+//.   <archive>             every image entry of a .zip or .tar, read in place into pooled
+//.                         buffers (MiArchive.h) : no extraction, no temp files
+//.   <manifest>            one image path per line (relative to the manifest's directory),
+//.                         anything after a ',' or a tab ignored, '#' lines skipped
+//.   --out <file>          verdicts.csv; a .jsonl name writes one v2 result object per line, a
+//.                         .parquet name a Parquet file (MiParquet.h) : path, hash (mi_hash64 of
+//.                         the bytes), verdict, probability, score, quality (null on an error),
+//.                         status, message, latency_ms (the check_batch call of its chunk),
+//.                         encoded and written by its own thread so the workers never wait on it
+//.   --row-group <n>       rows per Parquet row group (65536)
+//.   --resume              continue after <out>.ckpt : the output is cut back to what the
+//.                         checkpoint covers and the images it counts are skipped (not for
+//.                         .parquet, whose footer is only written at the end)
+//.   --chunk <n>           images per check_batch call (16)
+//.   --workers <n>         chunks in flight (pool.size)
+//.   --readers <n>         concurrent file reads (8)
+//.   --read-ahead <n>      chunks read ahead of the workers (2 x workers)
+//.   --meta <spec>         calibration[/os] of every image ([meta] default)
+//.   --progress-sec <n>    progress line interval (5)
+//. The checkpoint is rewritten after every chunk that completes the written prefix.
+//. With [batch] dedup the identical images of a chunk are checked once (MiDedup.h); the
+//. summary line reports how many images were duplicates and their share of the total.
+
+//. exit code of the process : 0 done, 1 failure, 2 usage.
+int mi_batch_main(int argc, char* argv[]);
@@ -0,0 +1,120 @@
+#include "MiBatchWindow.h"
+#include <algorithm>
+
+using namespace std::chrono;
+
+#define LD_RATE_WEIGHT		0.3		//. of the last interval in the arrival rate
+#define LD_COST_WEIGHT		0.2		//. of the last dispatch in the cost of its size
+#define LD_MARGIN_MIN		0.1
+#define LD_LATENCY_MAX		4096	//. images kept per interval for the p99
+
+BatchWindow::BatchWindow(size_t p_nMaxBatch, unsigned int p_nMaxWaitMs, int p_nWorkers, bool p_bAdaptive, double p_dP99Ms, int p_nAdaptMs)
+	: m_nMaxBatch(p_nMaxBatch > 0 ? p_nMaxBatch : 1)
+	, m_dMaxWaitSec(p_nMaxWaitMs / 1000.0)
+	, m_nWorkers(p_nWorkers > 0 ? p_nWorkers : 1)
+	, m_bAdaptive(p_bAdaptive && p_dP99Ms > 0 && p_nAdaptMs > 0)
+	, m_dP99Sec(p_dP99Ms / 1000.0)
+	, m_adaptEvery(p_nAdaptMs)
+	, m_nTarget(m_nMaxBatch)
+	, m_nWaitUs((int64_t)p_nMaxWaitMs * 1000)
+	, m_nTargetOut((int64_t)m_nMaxBatch)
+	, m_nRateOut(0)
+	, m_nP99Out(0)
+	, m_lastAdapt(steady_clock::now())
+	, m_nArrivals(0)
+	, m_dRate(-1)
+	, m_dMargin(1.0)
+	, m_vCost(m_nMaxBatch + 1, 0.0)
+{
+	m_vLatency.reserve(LD_LATENCY_MAX);
+}
+
+void BatchWindow::arrival()
+{
+	m_nArrivals++;
+}
+
+void BatchWindow::batch(size_t p_nSize, double p_dSec)
+{
+	if (p_nSize == 0 || p_nSize > m_nMaxBatch || p_dSec <= 0) return;
+	double& c = m_vCost[p_nSize];
+	c = c > 0 ? c + LD_COST_WEIGHT * (p_dSec - c) : p_dSec;
+}
+
+void BatchWindow::latency(double p_dSec)
+{
+	if (m_vLatency.size() < LD_LATENCY_MAX) m_vLatency.push_back(p_dSec);
+}
+
+double BatchWindow::cost(size_t p_nSize) const
+{
+	if (m_vCost[p_nSize] > 0) return m_vCost[p_nSize];
+	//. least squares line through the sizes seen.
+	double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (size_t i = 1; i <= m_nMaxBatch; i++) {
+		if (m_vCost[i] <= 0) continue;
+		n++;
+		sx += i;
+		sy += m_vCost[i];
+		sxx += (double)i * i;
+		sxy += i * m_vCost[i];
+	}
+	if (n == 0) return 0;
+	if (n == 1) return sy * p_nSize / sx;		//. no batching gain assumed
+	double slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+	double base = (sy - slope * sx) / n;
+	double c = base + slope * p_nSize;
+	//. never cheaper than the cheapest size seen.
+	double low = sy;
+	for (size_t i = 1; i <= m_nMaxBatch; i++) {
+		if (m_vCost[i] > 0) low = std::min(low, m_vCost[i]);
+	}
+	return std::max(c, low);
+}
+
+void BatchWindow::adapt(steady_clock::time_point p_now)
+{
+	if (!m_bAdaptive || p_now - m_lastAdapt < m_adaptEvery) return;
+	double interval = duration<double>(p_now - m_lastAdapt).count();
+	double rate = m_nArrivals / interval;
+	m_dRate = m_dRate < 0 ? rate : m_dRate + LD_RATE_WEIGHT * (rate - m_dRate);
+	m_nArrivals = 0;
+	m_lastAdapt = p_now;
+
+	//. observed p99 steers how much of the budget the model may use.
+	if (!m_vLatency.empty()) {
+		size_t k = (size_t)(0.99 * (m_vLatency.size() - 1));
+		std::nth_element(m_vLatency.begin(), m_vLatency.begin() + k, m_vLatency.end());
+		double p99 = m_vLatency[k];
+		m_nP99Out.store((int64_t)(p99 * 1e6), std::memory_order_relaxed);
+		if (p99 > m_dP99Sec) m_dMargin = std::max(LD_MARGIN_MIN, m_dMargin * 0.8);
+		else if (p99 < 0.8 * m_dP99Sec) m_dMargin = std::min(1.0, m_dMargin * 1.05);
+		m_vLatency.clear();
+	}
+	m_nRateOut.store((int64_t)(m_dRate + 0.5), std::memory_order_relaxed);
+
+	double budget = m_dP99Sec * m_dMargin;
+	size_t nBest = 1;
+	double bestWait = 0, bestCapacity = 0;
+	for (size_t n = 1; n <= m_nMaxBatch; n++) {
+		double c = cost(n);
+		if (c <= 0) break;
+		double wait = 0;
+		if (n > 1) {
+			if (m_dRate <= 0) break;
+			wait = (n - 1) / m_dRate;
+			if (wait > m_dMaxWaitSec) break;
+		}
+		if (wait + c > budget && n > 1) continue;
+		double capacity = m_nWorkers * n / c;
+		if (capacity > bestCapacity * 1.02) {
+			nBest = n;
+			bestWait = wait;
+			bestCapacity = capacity;
+		}
+	}
+	if (bestCapacity == 0) return;		//. no cost seen yet, keep the window
+	m_nTarget = nBest;
+	m_nWaitUs.store((int64_t)(bestWait * 1e6), std::memory_order_relaxed);
+	m_nTargetOut.store((int64_t)nBest, std::memory_order_relaxed);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+//. Batch window of the micro-batcher (MiBatcher.h). Fixed, a batch is flushed at max_size
+//. images or when its oldest image has waited max_wait_ms. With [batch] adaptive both are
+//. picked online every adapt_ms from what the batcher saw :
+//. - the arrival rate (images per second, moving average over the intervals);
+//. - the cost of a dispatch per batch size (moving average per size; sizes not seen yet
+//.   from a line through the ones seen, or proportional to the one size seen);
+//. - the p99 of the images' time in the batcher (queued to answered) over the interval.
+//. For every size n up to max_size the wait to collect n images at the arrival rate is
+//. (n - 1) / rate, capped at max_wait_ms; the sizes whose wait + cost fits the budget
+//. (p99_ms, scaled down while the observed p99 is over it and back up when well under)
+//. are candidates, and the one with the highest capacity workers * n / cost wins, ties to
+//. the smaller n. At low load only n = 1 fits and images no longer wait at all; at peak
+//. the batches grow as fast as they fill. A dispatch still takes up to max_size images
+//. once they queue up, which is how the costs of the larger sizes are learned.
+//. The choice is on GD_API_METRICS : mi_batch_window_microseconds, mi_batch_target_size,
+//. mi_batch_arrivals_per_second and mi_batch_p99_microseconds.
+//. Not thread safe : the batcher calls it under its lock; the exported values are atomic.
+
+class BatchWindow {
+public:
+	//. p_dP99Ms <= 0 or p_nAdaptMs <= 0 keeps the window fixed.
+	BatchWindow(size_t p_nMaxBatch, unsigned int p_nMaxWaitMs, int p_nWorkers, bool p_bAdaptive, double p_dP99Ms, int p_nAdaptMs);
+
+	bool adaptive() const { return m_bAdaptive; }
+
+	void arrival();
+	//. one dispatch of p_nSize images that took p_dSec.
+	void batch(size_t p_nSize, double p_dSec);
+	//. one image answered p_dSec after it was queued.
+	void latency(double p_dSec);
+	//. picks the window again once adapt_ms has passed since the last time.
+	void adapt(std::chrono::steady_clock::time_point p_now);
+
+	//. images at which a queue is flushed at once.
+	size_t target() const { return m_nTarget; }
+	//. longest wait of the oldest image.
+	std::chrono::microseconds wait() const { return std::chrono::microseconds(m_nWaitUs); }
+
+	//. any thread.
+	int64_t window_us() const { return m_nWaitUs.load(std::memory_order_relaxed); }
+	int64_t target_size() const { return (int64_t)m_nTargetOut.load(std::memory_order_relaxed); }
+	int64_t arrivals_per_sec() const { return m_nRateOut.load(std::memory_order_relaxed); }
+	int64_t p99_us() const { return m_nP99Out.load(std::memory_order_relaxed); }
+
+	//. estimated dispatch seconds of p_nSize images (1 .. max_size), <= 0 when nothing is known.
+	double cost(size_t p_nSize) const;
+
+private:
+	size_t									m_nMaxBatch;
+	double									m_dMaxWaitSec;
+	int										m_nWorkers;
+	bool									m_bAdaptive;
+	double									m_dP99Sec;
+	std::chrono::milliseconds				m_adaptEvery;
+
+	size_t									m_nTarget;
+	std::atomic<int64_t>					m_nWaitUs;
+	std::atomic<int64_t>					m_nTargetOut;
+	std::atomic<int64_t>					m_nRateOut;
+	std::atomic<int64_t>					m_nP99Out;
+
+	std::chrono::steady_clock::time_point	m_lastAdapt;
+	uint64_t								m_nArrivals;		//. since m_lastAdapt
+	double									m_dRate;			//. images per second, < 0 = no interval yet
+	double									m_dMargin;			//. share of p99_ms the model may plan with
+	std::vector<double>						m_vCost;			//. seconds per dispatch by size, 0 = not seen
+	std::vector<double>						m_vLatency;			//. seconds, this interval
+};
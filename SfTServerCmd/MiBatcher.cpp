@@ -0,0 +1,326 @@
+#include "MiBatcher.h"
+#include "MiBrownout.h"
+#include "MiContext.h"
+#include "MiDedup.h"
+#include "MiLimiter.h"
+#include "MiMetrics.h"
+#include "MiMsgBuffers.h"
+#include "MiPipelinePool.h"
+#include "MiSdkCall.h"
+#include "MiSettings.h"
+#include "MiSupervisor.h"
+#include <algorithm>
+#include <stdio.h>
+
+LivenessBatcher* g_pBatcher = NULL;
+
+LivenessBatcher::LivenessBatcher(size_t p_nMaxBatch, unsigned int p_nMaxWaitMs, int p_nWorkers, bool p_bAdaptive, double p_dP99Ms, int p_nAdaptMs,
+	const std::string& p_strBuckets, bool p_bEdf, int p_nStarveMs)
+	: m_nMaxBatch(p_nMaxBatch > 0 ? p_nMaxBatch : 1)
+	, m_nMaxWaitMs(p_nMaxWaitMs)
+	, m_nWorkers(p_nWorkers > 0 ? p_nWorkers : 1)
+	, m_bStop(false)
+	, m_bEdf(p_bEdf)
+	, m_starve(p_nStarveMs > 0 ? p_nStarveMs : 0)
+	, m_nQueued(0)
+	, m_window(m_nMaxBatch, p_nMaxWaitMs, m_nWorkers, p_bAdaptive, p_dP99Ms, p_nAdaptMs)
+{
+	m_buckets.init(p_strBuckets, (int)m_nMaxBatch);
+	if (m_buckets.enabled()) mi_metrics_batch_buckets(m_buckets.sizes());
+}
+
+LivenessBatcher::~LivenessBatcher()
+{
+	stop();
+}
+
+void LivenessBatcher::start()
+{
+	MiLockGuard lock(m_mtx);
+	if (!m_threads.empty()) return;
+	m_bStop = false;
+	for (int i = 0; i < m_nWorkers; i++) {
+		m_threads.emplace_back(&LivenessBatcher::run, this);
+	}
+}
+
+void LivenessBatcher::stop()
+{
+	{
+		MiLockGuard lock(m_mtx);
+		m_bStop = true;
+	}
+	m_cvQueue.notify_all();
+	for (auto& t : m_threads) {
+		if (t.joinable()) t.join();
+	}
+	m_threads.clear();
+}
+
+CPipelineResult_t LivenessBatcher::check(const CImage_t* p_pImage, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	Item item;
+	memset(&item.result, 0, sizeof(item.result));
+	item.image = p_pImage;
+	item.meta = p_pMeta;
+	item.ctx = mi_context();
+	item.hash = item.ctx != NULL ? item.ctx->imageHash : 0;
+	item.size = item.ctx != NULL ? item.ctx->imageSize : 0;
+	if (item.size != 0) memcpy(item.digest, item.ctx->imageDigest, sizeof(item.digest));
+	item.err = OK;
+	item.msg[0] = 0;
+	item.done = false;
+	item.batch = 0;
+	item.queued = std::chrono::steady_clock::now();
+	item.deadline = (item.ctx != NULL && item.ctx->has_deadline()) ? item.ctx->deadline : std::chrono::steady_clock::time_point();
+	item.due = item.queued + m_starve;
+	if (item.deadline != std::chrono::steady_clock::time_point() && (m_starve.count() == 0 || item.deadline < item.due)) item.due = item.deadline;
+	else if (m_starve.count() == 0) item.due = std::chrono::steady_clock::time_point::max();
+	std::chrono::steady_clock::time_point limit = mi_context_hold_limit();
+
+	MiUniqueLock lock(m_mtx);
+	if (m_bStop) {
+		lock.unlock();
+		PipelineRef ref = g_Supervisor.current();
+		return FaceSdk::pipeline_check_liveness(ref->pipeline, p_pImage, p_pMeta, p_pErr, p_pszMsg);
+	}
+	item.flushBy = item.queued + m_window.wait();
+	int nBrownoutMs = mi_brownout_batch_wait_ms();
+	if (nBrownoutMs >= 0 && item.queued + std::chrono::milliseconds(nBrownoutMs) < item.flushBy) {
+		item.flushBy = item.queued + std::chrono::milliseconds(nBrownoutMs);
+		mi_context_mark(MI_DEGRADE_BROWNOUT);
+	}
+	if (limit != std::chrono::steady_clock::time_point() && limit < item.flushBy) item.flushBy = limit;
+	m_window.arrival();
+	std::deque<Item*>& queue = m_queues[mi_meta_index(p_pMeta)];
+	if (m_bEdf) {
+		//. ties and later arrivals stay behind, so equal dues keep arrival order.
+		std::deque<Item*>::iterator it = queue.end();
+		while (it != queue.begin() && (*(it - 1))->due > item.due) --it;
+		queue.insert(it, &item);
+	}
+	else {
+		queue.push_back(&item);
+	}
+	m_nQueued++;
+	m_cvQueue.notify_one();
+	m_cvDone.wait(lock, [&item] { return item.done; });
+	lock.unlock();
+	//. the batch call runs on the batcher thread for several requests : each traced one
+	//. records its wait and its share as its own spans.
+	if (item.dispatched != std::chrono::steady_clock::time_point() && mi_trace_active()) {
+		mi_trace_record("batch_queue", item.queued, item.dispatched);
+		mi_trace_record("batch_call", item.dispatched, item.answered);
+	}
+	if (item.batch > 0) mi_request_profile_batch(item.batch);
+
+	if (p_pErr != NULL) *p_pErr = item.err;
+	if (p_pszMsg != NULL) memcpy(p_pszMsg, item.msg, MESSAGE_BUFFER_SIZE);
+	return item.result;
+}
+
+int LivenessBatcher::ready_queue(std::chrono::steady_clock::time_point* p_pNext)
+{
+	//. flushBy is not ordered within a queue once deadlines shorten it, scan the items.
+	int earliest = -1;
+	std::chrono::steady_clock::time_point flushBy;
+	for (int i = 0; i < MI_META_COUNT; i++) {
+		if (m_queues[i].empty()) continue;
+		if (m_queues[i].size() >= m_window.target()) return i;
+		for (const Item* p : m_queues[i]) {
+			if (earliest < 0 || p->flushBy < flushBy) {
+				earliest = i;
+				flushBy = p->flushBy;
+			}
+		}
+	}
+	if (earliest < 0) return -1;
+	if (m_bStop || flushBy <= std::chrono::steady_clock::now()) return earliest;
+	*p_pNext = flushBy;
+	return -1;
+}
+
+void LivenessBatcher::run()
+{
+	std::vector<Item*> batch, live;
+	batch.reserve(m_nMaxBatch);
+	live.reserve(m_nMaxBatch);
+
+	MiUniqueLock lock(m_mtx);
+	while (true) {
+		m_cvQueue.wait(lock, [this] { return m_bStop || m_nQueued > 0; });
+		if (m_bStop && m_nQueued == 0) break;
+
+		//. hold a batch open until it is full or its oldest image has waited long enough.
+		std::chrono::steady_clock::time_point next;
+		int q = ready_queue(&next);
+		if (q < 0) {
+			m_cvQueue.wait_until(lock, next);
+			continue;
+		}
+
+		batch.clear();
+		std::deque<Item*>& queue = m_queues[q];
+		if (m_bEdf) {
+			shed(queue);
+			if (queue.empty()) continue;
+		}
+		while (!queue.empty() && batch.size() < m_nMaxBatch) {
+			batch.push_back(queue.front());
+			queue.pop_front();
+		}
+		m_nQueued -= batch.size();
+
+		lock.unlock();
+		live.clear();
+		for (Item* p : batch) {
+			if (p->ctx == NULL || !mi_context_client_gone(MI_CANCEL_BATCH, p->ctx)) {
+				live.push_back(p);
+				continue;
+			}
+			p->err = UNKNOWN;
+			snprintf(p->msg, MESSAGE_BUFFER_SIZE, "client disconnected");
+		}
+		std::chrono::steady_clock::time_point dispatched = std::chrono::steady_clock::now();
+		double sec = live.empty() ? 0.0 : dispatch(live, live.front()->meta);
+		lock.lock();
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		m_window.batch(live.size(), sec);
+		for (Item* p : live) {
+			p->dispatched = dispatched;
+			p->answered = now;
+			p->batch = live.size();
+		}
+		for (Item* p : batch) {
+			m_window.latency(std::chrono::duration<double>(now - p->queued).count());
+			p->done = true;
+		}
+		m_window.adapt(now);
+		m_cvDone.notify_all();
+	}
+}
+
+void LivenessBatcher::shed(std::deque<Item*>& p_queue)
+{
+	double cost = m_window.cost(std::min(p_queue.size(), m_nMaxBatch));
+	if (cost <= 0) return;		//. nothing dispatched yet
+	std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now()
+		+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(cost));
+	size_t nShed = 0;
+	for (std::deque<Item*>::iterator it = p_queue.begin(); it != p_queue.end(); ) {
+		Item* p = *it;
+		if (p->deadline == std::chrono::steady_clock::time_point() || p->deadline >= finish) {
+			++it;
+			continue;
+		}
+		p->err = UNKNOWN;
+		snprintf(p->msg, MESSAGE_BUFFER_SIZE, "Deadline exceeded");
+		p->done = true;
+		mi_metrics_admission_reject(MI_REJECT_EXPIRED);
+		it = p_queue.erase(it);
+		nShed++;
+	}
+	if (nShed == 0) return;
+	m_nQueued -= nShed;
+	m_cvDone.notify_all();
+}
+
+double LivenessBatcher::dispatch(std::vector<Item*>& p_vBatch, const CMeta_t* p_pMeta)
+{
+	//. the repeats of an image wait for the first one's answer instead of a slot.
+	std::vector<Item*> vUnique;
+	std::vector<size_t> vFirst;
+	size_t nDup = 0;
+	if (g_Settings.batchDedup && p_vBatch.size() > 1) {
+		std::vector<std::pair<uint64_t, uint64_t>> vKeys(p_vBatch.size());
+		for (size_t i = 0; i < p_vBatch.size(); i++) vKeys[i] = std::make_pair(p_vBatch[i]->hash, p_vBatch[i]->size);
+		nDup = mi_dedup_plan(vKeys, vFirst);
+		//. XXH64 collisions can be crafted : another client's image must not take this verdict.
+		for (size_t i = 0; i < p_vBatch.size() && nDup > 0; i++) {
+			if (vFirst[i] == i || memcmp(p_vBatch[i]->digest, p_vBatch[vFirst[i]]->digest, MI_DIGEST_SIZE) == 0) continue;
+			vFirst[i] = i;
+			nDup--;
+		}
+	}
+	if (nDup > 0) {
+		for (size_t i = 0; i < p_vBatch.size(); i++) {
+			if (vFirst[i] == i) vUnique.push_back(p_vBatch[i]);
+		}
+		mi_metrics_batch_duplicates(MI_DEDUP_BATCHER, nDup);
+	}
+	std::vector<Item*>& vCall = nDup > 0 ? vUnique : p_vBatch;
+
+	size_t n = vCall.size();
+	std::vector<int> calls;
+	if (m_buckets.enabled()) m_buckets.plan(n, calls);
+	else calls.push_back((int)n);
+
+	std::unique_ptr<LimitScope> limit(new LimitScope(n));
+	std::unique_ptr<PipelineLease> lease;
+	PipelineRef ref;
+	if (g_pPool != NULL) {
+		lease.reset(new PipelineLease(g_pPool));
+		ref = lease->ref();
+	}
+	else {
+		ref = g_Supervisor.current();
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool bLicense = false;
+	size_t at = 0;
+	for (int size : calls) {
+		size_t take = std::min((size_t)size, n - at);
+		if (take == 0) break;
+		if (call(ref->pipeline, &vCall[at], take, (size_t)size, p_pMeta)) bLicense = true;
+		if (m_buckets.enabled()) mi_metrics_batch_bucket(size, (int)(size - take));
+		at += take;
+	}
+	for (size_t i = 0; i < p_vBatch.size() && nDup > 0; i++) {
+		Item* p = p_vBatch[i];
+		const Item* first = p_vBatch[vFirst[i]];
+		if (first == p) continue;
+		p->result = first->result;
+		p->err = first->err;
+		memcpy(p->msg, first->msg, MESSAGE_BUFFER_SIZE);
+	}
+	//. each image's request pays an equal share of the calls (MiCost.h).
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	for (size_t i = 0; i < p_vBatch.size(); i++) mi_cost_infer(p_vBatch[i]->ctx, sec / p_vBatch.size());
+	if (bLicense) g_Supervisor.report(ref);
+	lease.reset();
+	limit.reset();
+	return sec;
+}
+
+bool LivenessBatcher::call(CPipeline_t* p_pPipeline, Item** p_ppItems, size_t p_nCount, size_t p_nSlots, const CMeta_t* p_pMeta)
+{
+	std::vector<const CImage_t*> images(p_nSlots, p_ppItems[0]->image);
+	std::vector<int> errors(p_nSlots, OK);
+	std::vector<char*> msgs(p_nSlots);
+	MsgBuffers pad(p_nSlots - p_nCount);
+	for (size_t i = 0; i < p_nSlots; i++) {
+		if (i < p_nCount) images[i] = p_ppItems[i]->image;
+		msgs[i] = i < p_nCount ? p_ppItems[i]->msg : pad[i - p_nCount];
+	}
+
+	//. the SDK reads one meta per image, padding slots included.
+	std::vector<CMeta_t> metas(p_pMeta != NULL ? p_nSlots : 0, p_pMeta != NULL ? *p_pMeta : CMeta_t());
+
+	CPipelineResult_t* results = FaceSdk::pipeline_check_liveness_batch2(p_pPipeline, images.data(), p_nSlots, p_pMeta != NULL ? metas.data() : NULL, errors.data(), msgs.data());
+	bool bLicense = false;
+	for (size_t i = 0; i < p_nCount; i++) {
+		if (face_sdk_is_license_error(errors[i], msgs[i])) bLicense = true;
+		if (results != NULL) {
+			p_ppItems[i]->result = results[i];
+			p_ppItems[i]->err = errors[i];
+		}
+		else {
+			p_ppItems[i]->err = (errors[i] != OK) ? errors[i] : UNKNOWN;
+		}
+	}
+	if (results != NULL) {
+		face_sdk_api().CPipelineResult_destroy_array(results);
+	}
+	return bLicense;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiBatchWindow.h"
+#include "MiBuckets.h"
+#include "MiContext.h"
+#include "MiMeta.h"
+#include "MiLock.h"
+
+//. Collects single-image liveness checks from concurrent request threads and
+//. submits them to the SDK as one pipeline_check_liveness_batch2 call. The SDK marks that entry
+//. point deprecated and an image waits up to m_nMaxWaitMs for company, so [batch] is off by
+//. default and suits only loads with many concurrent requests.
+//. A batch is flushed when it holds m_nMaxBatch images or when an image has waited
+//. m_nMaxWaitMs milliseconds; an image is held no later than its request's deadline less
+//. [admission] degrade_ms (MiContext.h), so a short budget is not spent waiting for company.
+//. Images wait in one queue per MiMeta.h entry and a batch only holds images of one
+//. queue, so requests with another calibration never shrink each other's batches.
+//. Images of requests whose client has disconnected (MiContext.h) are taken out of a batch
+//. before it is dispatched and answered UNKNOWN.
+//. With [batch] adaptive the flush size and wait follow the load (MiBatchWindow.h); with
+//. [batch] buckets a batch runs as calls of the compiled shapes (MiBuckets.h).
+//. [batch] order = edf keeps each queue earliest deadline first instead of in arrival order,
+//. an image due at its deadline or starve_ms after it was queued, whichever is sooner, so
+//. images without a deadline or with a long one are not passed over forever. Images that
+//. cannot finish before their deadline any more (now + the window's cost of the batch) are
+//. answered "Deadline exceeded" instead of taking a slot, as mi_rejected_total{reason=
+//. "expired"}. Under overload that spends the SDK on images still able to make it.
+//. With [batch] dedup, equal images of one batch (RequestContext::imageHash : the bytes or the
+//. decoded pixels the request submits, not its upload, confirmed by its SHA-256 digest) take one
+//. slot of the call and share its result (MiDedup.h). One upload checked as a crop, at a reduced scale or in full stays apart.
+class LivenessBatcher {
+public:
+	LivenessBatcher(size_t p_nMaxBatch, unsigned int p_nMaxWaitMs, int p_nWorkers = 1, bool p_bAdaptive = false, double p_dP99Ms = 0, int p_nAdaptMs = 0,
+		const std::string& p_strBuckets = std::string(), bool p_bEdf = false, int p_nStarveMs = 0);
+	~LivenessBatcher();
+
+	void start();
+	void stop();
+
+	//. blocks the calling thread until the image has been evaluated as part of a batch.
+	CPipelineResult_t check(const CImage_t* p_pImage, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg);
+
+	const BatchWindow& window() const { return m_window; }
+	//. the shape buckets, measured by the warm-up.
+	BatchBuckets& buckets() { return m_buckets; }
+
+private:
+	struct Item {
+		const CImage_t*		image;
+		const CMeta_t*		meta;
+		RequestContext*		ctx;		//. of the waiting request thread, NULL outside one
+		uint64_t			hash;		//. of the image handed to the SDK, size 0 = unknown
+		uint64_t			size;
+		uint8_t				digest[MI_DIGEST_SIZE];	//. a hash match shares a result only when this matches too
+		CPipelineResult_t	result;
+		int					err;
+		char				msg[MESSAGE_BUFFER_SIZE];
+		bool				done;
+		std::chrono::steady_clock::time_point queued;
+		std::chrono::steady_clock::time_point flushBy;	//. latest time to dispatch it
+		std::chrono::steady_clock::time_point deadline;	//. of the request, epoch = none
+		std::chrono::steady_clock::time_point due;		//. edf order
+		std::chrono::steady_clock::time_point dispatched;	//. traced : its batch left the queue
+		std::chrono::steady_clock::time_point answered;		//. traced : the batch call returned
+		size_t				batch;		//. images of its batch call, 0 = not dispatched
+	};
+
+	void run();
+	//. seconds of the SDK calls. Equal uploads are checked once, with [batch] dedup.
+	double dispatch(std::vector<Item*>& p_vBatch, const CMeta_t* p_pMeta);
+	//. one pipeline_check_liveness_batch2 of p_nSlots images : the p_nCount items, then
+	//. repeats of the first as padding. true when it failed on the license.
+	bool call(CPipeline_t* p_pPipeline, Item** p_ppItems, size_t p_nCount, size_t p_nSlots, const CMeta_t* p_pMeta);
+	//. queue to flush now (full, or holding an image past its flushBy), else -1 and p_pNext
+	//. set to the earliest flushBy.
+	int ready_queue(std::chrono::steady_clock::time_point* p_pNext);
+	//. edf : answers the images of p_queue that can no longer make their deadline.
+	void shed(std::deque<Item*>& p_queue);
+
+	size_t						m_nMaxBatch;
+	unsigned int				m_nMaxWaitMs;
+	int							m_nWorkers;
+	bool						m_bStop;
+	bool						m_bEdf;
+	std::chrono::milliseconds	m_starve;
+
+	MI_MUTEX(m_mtx, "batcher");
+	MiCondition					m_cvQueue;
+	MiCondition					m_cvDone;
+	std::deque<Item*>			m_queues[MI_META_COUNT];	//. by mi_meta_index
+	size_t						m_nQueued;
+	BatchWindow					m_window;			//. under m_mtx
+	BatchBuckets				m_buckets;
+	std::vector<std::thread>	m_threads;
+};
+
+extern LivenessBatcher* g_pBatcher;
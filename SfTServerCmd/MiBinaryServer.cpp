@@ -0,0 +1,236 @@
+#include "MiBinaryServer.h"
+#include "MiBackend.h"
+#include "MiConfig.h"
+#include "MiConnection.h"
+#include "MiGate.h"
+#include "MiImageInfo.h"
+#include "MiLicense.h"
+#include "MiMeta.h"
+#include "MiMetrics.h"
+#include "MiSettings.h"
+#include "MiWorkerPool.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/TCPServer.h"
+#include "Poco/Net/TCPServerConnection.h"
+#include "Poco/Net/TCPServerConnectionFactory.h"
+#include "Poco/Net/TCPServerParams.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+using Poco::Net::StreamSocket;
+
+static Poco::Net::TCPServer*	lv_pServer = NULL;
+static WorkerPool*				lv_pWorkers = NULL;
+
+//. state shared by a connection and the jobs it has in flight.
+struct BinaryChannel {
+	StreamSocket				socket;
+	std::mutex					sendMtx;
+	std::mutex					mtx;
+	std::condition_variable		cv;
+	int							inflight;
+	bool						broken;		//. a send failed, stop reading
+
+	explicit BinaryChannel(const StreamSocket& p_socket) : socket(p_socket), inflight(0), broken(false) {}
+
+	void send(const BinaryResult& p_result)
+	{
+		std::lock_guard<std::mutex> lock(sendMtx);
+		if (broken) return;
+		try {
+			const char* p = (const char*)&p_result;
+			int nLeft = (int)sizeof(p_result);
+			while (nLeft > 0) {
+				int n = socket.sendBytes(p, nLeft);
+				if (n <= 0) throw Poco::IOException("send");
+				p += n;
+				nLeft -= n;
+			}
+		}
+		catch (Poco::Exception&) {
+			broken = true;
+		}
+	}
+};
+
+//. one in-flight request; released when the job finishes or is dropped unrun at stop.
+class InflightSlot {
+public:
+	explicit InflightSlot(const std::shared_ptr<BinaryChannel>& p_pChannel) : m_pChannel(p_pChannel) {}
+	~InflightSlot()
+	{
+		std::lock_guard<std::mutex> lock(m_pChannel->mtx);
+		m_pChannel->inflight--;
+		m_pChannel->cv.notify_all();
+	}
+
+	BinaryChannel& channel() { return *m_pChannel; }
+
+private:
+	std::shared_ptr<BinaryChannel>	m_pChannel;
+};
+
+static BinaryResult make_result(uint64_t p_nId, BinaryCode p_code)
+{
+	BinaryResult r;
+	memset(&r, 0, sizeof(r));
+	r.magic = MI_BIN_RESULT_MAGIC;
+	r.code = (uint32_t)p_code;
+	r.request_id = p_nId;
+	r.status = OK;
+	return r;
+}
+
+//. header meta over meta.default, only where it tightens it (mi_meta_override); values out of
+//. range are ignored.
+static const CMeta_t* header_meta(const BinaryRequestHeader& p_header)
+{
+	return mi_meta_override(mi_meta_default(), p_header.calibration < MI_META_CALIBRATIONS - 1 ? p_header.calibration : -1,
+		p_header.os < MI_META_OSES - 1 ? p_header.os : -1);
+}
+
+static void run_job(BinaryChannel& p_channel, const BinaryRequestHeader& p_header, const std::shared_ptr<std::string>& p_pImage,
+	std::chrono::steady_clock::time_point p_tArrival)
+{
+	RequestTimer reqTimer(MI_EP_BINARY);
+	BinaryResult r = make_result(p_header.request_id, MI_BIN_OK);
+#ifdef NDEBUG
+	if (!g_License.valid()) {
+		g_License.wake();
+		r.code = MI_BIN_NO_LICENSE;
+	}
+	else
+#endif
+	{
+		char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+		int err = OK;
+		try {
+			CPipelineResult_t result = g_pBackend->check((const uint8_t*)p_pImage->data(), p_pImage->size(), header_meta(p_header), &err, msg);
+			mi_metrics_status(err);
+			r.status = err;
+			r.probability = result.liveness_result.probability;
+			r.score = result.liveness_result.score;
+			r.quality = result.quality_result.score;
+			r.liveness_ok = result.liveness_result.ok ? 1 : 0;
+			r.stage = (uint8_t)mi_gate_stage(result, err);
+		}
+		catch (Poco::Exception&) {
+			r.code = MI_BIN_ERROR;
+		}
+	}
+	r.elapsed_us = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - p_tArrival).count();
+	p_channel.send(r);
+}
+
+//. reads frames and hands them to the workers; the reader blocks at max_inflight.
+class BinaryConnection : public Poco::Net::TCPServerConnection {
+public:
+	explicit BinaryConnection(const StreamSocket& p_socket) : Poco::Net::TCPServerConnection(p_socket) {}
+
+	void run() override
+	{
+		mi_socket_tune(socket());
+		std::shared_ptr<BinaryChannel> pChannel = std::make_shared<BinaryChannel>(socket());
+		size_t nMaxImage = (size_t)mi_config().maxBodyMb * 1024 * 1024;
+		int nMaxInflight = g_Settings.binaryMaxInflight > 0 ? g_Settings.binaryMaxInflight : 1;
+
+		try {
+			for (;;) {
+				BinaryRequestHeader header;
+				if (!receive(&header, sizeof(header))) break;
+				if (header.magic != MI_BIN_REQUEST_MAGIC || header.image_len == 0) {
+					pChannel->send(make_result(header.request_id, MI_BIN_BAD_REQUEST));
+					break;
+				}
+				if (header.image_len > nMaxImage) {
+					pChannel->send(make_result(header.request_id, MI_BIN_TOO_LARGE));
+					break;
+				}
+				std::shared_ptr<std::string> pImage = std::make_shared<std::string>(header.image_len, '\0');
+				if (!receive(&(*pImage)[0], header.image_len)) break;
+				std::string strWhy;
+				if (!mi_image_allowed((const uint8_t*)pImage->data(), pImage->size(), strWhy)) {
+					//. the frame was read whole, the connection stays usable.
+					pChannel->send(make_result(header.request_id, MI_BIN_TOO_LARGE));
+					continue;
+				}
+				auto tArrival = std::chrono::steady_clock::now();
+
+				{
+					std::unique_lock<std::mutex> lock(pChannel->mtx);
+					pChannel->cv.wait(lock, [&]() { return pChannel->inflight < nMaxInflight; });
+					if (pChannel->broken) break;
+					pChannel->inflight++;
+				}
+				std::shared_ptr<InflightSlot> pSlot = std::make_shared<InflightSlot>(pChannel);
+				if (!lv_pWorkers->submit([pSlot, header, pImage, tArrival]() { run_job(pSlot->channel(), header, pImage, tArrival); })) {
+					pChannel->send(make_result(header.request_id, MI_BIN_BUSY));
+				}
+			}
+		}
+		catch (Poco::Exception&) {
+		}
+
+		//. the jobs write to this socket; it closes when the connection object goes.
+		std::unique_lock<std::mutex> lock(pChannel->mtx);
+		pChannel->cv.wait(lock, [&]() { return pChannel->inflight == 0; });
+	}
+
+private:
+	//. false on EOF or timeout.
+	bool receive(void* p_pBuffer, size_t p_nLen)
+	{
+		char* p = (char*)p_pBuffer;
+		while (p_nLen > 0) {
+			int n = socket().receiveBytes(p, (int)std::min<size_t>(p_nLen, 1 << 20));
+			if (n <= 0) return false;
+			p += n;
+			p_nLen -= n;
+		}
+		return true;
+	}
+};
+
+bool mi_binary_start(std::string& p_strErr)
+{
+	if (lv_pServer != NULL) return true;
+	if (g_pBackend == NULL) {
+		p_strErr = "no inference backend";
+		return false;
+	}
+	try {
+		Poco::Net::ServerSocket socket = mi_listen_socket(g_Settings.binaryPort);
+
+		lv_pWorkers = new WorkerPool(g_Settings.binaryWorkers > 0 ? g_Settings.binaryWorkers : 1, g_Settings.binaryQueue);
+		lv_pWorkers->start();
+
+		Poco::Net::TCPServerParams* pParams = new Poco::Net::TCPServerParams;
+		pParams->setMaxThreads(g_Settings.binaryMaxConnections);
+		pParams->setMaxQueued(g_Settings.binaryMaxConnections);
+		lv_pServer = new Poco::Net::TCPServer(new Poco::Net::TCPServerConnectionFactoryImpl<BinaryConnection>(), socket, pParams);
+		lv_pServer->start();
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		mi_binary_stop();
+		return false;
+	}
+	return true;
+}
+
+void mi_binary_stop()
+{
+	if (lv_pServer != NULL) {
+		lv_pServer->stop();
+		delete lv_pServer;
+		lv_pServer = NULL;
+	}
+	if (lv_pWorkers != NULL) {
+		lv_pWorkers->stop();
+		delete lv_pWorkers;
+		lv_pWorkers = NULL;
+	}
+}
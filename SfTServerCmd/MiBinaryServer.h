@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+//. Binary front end for service-to-service calls ([binary]) : a plain TCP protocol on
+//. its own port with no JSON, no base64 and no HTTP parsing. One connection carries many
+//. requests; up to binary.max_inflight of them run concurrently on binary.workers
+//. inference threads and their results come back as they finish, matched by request_id.
+//. Frames are packed little endian :
+//.   request  : BinaryRequestHeader, then header.image_len bytes of the encoded image
+//.   response : BinaryResult
+//. A frame with a bad magic or an image above server.max_body_mb closes the connection
+//. after an MI_BIN_BAD_REQUEST / MI_BIN_TOO_LARGE result; an image whose header is above
+//. server.max_image_side / max_image_mpix gets MI_BIN_TOO_LARGE and the connection stays open.
+
+#define MI_BIN_REQUEST_MAGIC	0x3142494Du		//. "MIB1"
+#define MI_BIN_RESULT_MAGIC		0x3152494Du		//. "MIR1"
+
+enum BinaryCode {
+	MI_BIN_OK = 0,				//. SDK ran, see status
+	MI_BIN_BUSY,				//. worker queue full, retry later
+	MI_BIN_BAD_REQUEST,
+	MI_BIN_TOO_LARGE,
+	MI_BIN_NO_LICENSE,
+	MI_BIN_ERROR				//. exception in the SDK call
+};
+
+#pragma pack(push, 1)
+struct BinaryRequestHeader {
+	uint32_t	magic;			//. MI_BIN_REQUEST_MAGIC
+	uint32_t	image_len;
+	uint64_t	request_id;		//. echoed in the result
+	int32_t		calibration;	//. CALIBRATION_t, -1 = pipeline default
+	int32_t		os;				//. OS_t, -1 = pipeline default
+};
+
+struct BinaryResult {
+	uint32_t	magic;			//. MI_BIN_RESULT_MAGIC
+	uint32_t	code;			//. BinaryCode
+	uint64_t	request_id;
+	int32_t		status;			//. STATUS of the SDK call
+	float		probability;
+	float		score;
+	float		quality;
+	uint8_t		liveness_ok;
+	uint8_t		stage;			//. GateStage that decided the result
+	uint16_t	reserved;
+	uint32_t	elapsed_us;		//. server time from the end of the frame to the result
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BinaryRequestHeader) == 24, "BinaryRequestHeader layout");
+static_assert(sizeof(BinaryResult) == 40, "BinaryResult layout");
+
+//. listens on binary.port and starts the workers; call after launch.
+bool mi_binary_start(std::string& p_strErr);
+void mi_binary_stop();
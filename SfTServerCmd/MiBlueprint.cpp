@@ -0,0 +1,377 @@
+#include "MiBlueprint.h"
+#include "MiConf.h"
+#include "MiImage.h"
+#include "MiMetrics.h"
+#include "MiModelCache.h"
+#include "MiSettings.h"
+#include "MiValidation.h"
+#include "MiVerdict.h"
+#include "MiWait.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include <idliveface/idliveface.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <thread>
+
+using namespace idliveface;
+
+static void set_message(char* p_pszMsg, const std::string& p_strMsg)
+{
+	if (p_pszMsg == NULL) return;
+	strncpy(p_pszMsg, p_strMsg.c_str(), MESSAGE_BUFFER_SIZE - 1);
+	p_pszMsg[MESSAGE_BUFFER_SIZE - 1] = '\0';
+}
+
+static int status_of(Validation p_v)
+{
+	switch (p_v) {
+	case Validation::kFaceNotFound:				return FACE_NOT_FOUND;
+	case Validation::kTooManyFaces:				return TOO_MANY_FACES;
+	case Validation::kSmallFaceSize:
+	case Validation::kSmallRelativeFaceSize:
+	case Validation::kSmallPupillaryDistance:	return FACE_TOO_SMALL;
+	case Validation::kLargeFaceRotationAngle:	return FACE_ANGLE_TOO_LARGE;
+	case Validation::kFaceTooClose:				return FACE_TOO_CLOSE;
+	case Validation::kFaceCloseToBorder:		return FACE_CLOSE_TO_BORDER;
+	case Validation::kFaceCropped:				return FACE_CROPPED;
+	case Validation::kFaceOccluded:				return FACE_IS_OCCLUDED;
+	case Validation::kEyesClosed:				return EYES_CLOSED;
+	default:									return UNKNOWN;
+	}
+}
+
+static CPipelineResult_t to_pipeline_result(const FaceAnalysisResult& p_res, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+
+	if (p_res.status == FaceStatus::kInvalid) {
+		Validation v = p_res.failed_validations.empty() ? Validation::kFaceNotFound : p_res.failed_validations[0];
+		std::ostringstream oss;
+		oss << p_res.failed_validations;
+		*p_pErr = status_of(v);
+		set_message(p_pszMsg, oss.str());
+		return result;
+	}
+
+	float p = p_res.genuine_probability.has_value() ? p_res.genuine_probability.value() : 0.0f;
+	result.liveness_result.probability = p;
+	result.liveness_result.score = p;
+	result.liveness_result.ok = true;
+	result.quality_result.score = 1.0f;
+	result.quality_result.class_ = true;
+	result.quality_result.ok = true;
+	*p_pErr = OK;
+	return result;
+}
+
+//. false for an unknown profile name; p_rc is left as CreateRuntimeConfiguration made it.
+static bool apply_profile(RuntimeConfiguration& p_rc, const std::string& p_strProfile, int p_nCores)
+{
+	int cores = p_nCores > 0 ? p_nCores : (int)std::thread::hardware_concurrency();
+	if (cores < 1) cores = 1;
+
+	if (p_strProfile.empty()) return true;
+	if (p_strProfile == "latency") {
+		//. decode / post-processing of the next request overlap the single inference.
+		p_rc.worker_threads = 2;
+		p_rc.backend_threads = cores;
+		p_rc.backend_invocations = 1;
+		return true;
+	}
+	if (p_strProfile == "throughput") {
+		p_rc.worker_threads = cores;
+		p_rc.backend_threads = 1;
+		p_rc.backend_invocations = cores;
+		return true;
+	}
+	return false;
+}
+
+//. "key=value,key=value" into RuntimeConfiguration::parameters.
+static void apply_parameters(RuntimeConfiguration& p_rc, const std::string& p_strParams)
+{
+	Poco::StringTokenizer tok(p_strParams, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& t : tok) {
+		size_t eq = t.find('=');
+		if (eq == std::string::npos) continue;
+		p_rc.parameters[Poco::trim(t.substr(0, eq))] = Poco::trim(t.substr(eq + 1));
+	}
+}
+
+BlueprintSettings mi_blueprint_settings()
+{
+	BlueprintSettings s;
+	s.dataDir = g_Settings.backendDataDir;
+	s.pipeline = g_Settings.backendPipeline;
+	s.profile = g_Settings.backendProfile;
+	s.parameters = g_Settings.backendParameters;
+	s.cpuCores = g_Settings.backendCpuCores;
+	s.workerThreads = g_Settings.backendWorkerThreads;
+	s.backendThreads = g_Settings.backendThreads;
+	s.backendInvocations = g_Settings.backendInvocations;
+	s.cascadePipeline = g_Settings.backendCascadePipeline;
+	s.cascadeMargin = g_Settings.backendCascadeMargin;
+	s.validationPool = g_Settings.validationPool;
+	return s;
+}
+
+BlueprintBackend::BlueprintBackend() : m_dCascadeMargin(0.0), m_dFullSec(0.0), m_nProfileTick(0), m_nProfilePool(0)
+{
+}
+
+BlueprintBackend::~BlueprintBackend()
+{
+	m_pDecoder.reset();
+	m_pCascade.reset();
+	m_vProfiles.clear();
+	m_pAnalyzer.reset();
+	m_pBlueprint.reset();
+}
+
+bool BlueprintBackend::start(const BlueprintSettings& p_settings, std::string& p_strErr)
+{
+	try {
+		RuntimeConfiguration rc = CreateRuntimeConfiguration(p_settings.cpuCores);
+		std::string profile = p_settings.profile;
+		if (!apply_profile(rc, profile, p_settings.cpuCores)) {
+			std::cout << "Blueprint backend : unknown profile " << profile << ", using the SDK defaults" << std::endl;
+			profile.clear();
+		}
+		if (p_settings.workerThreads > 0) rc.worker_threads = p_settings.workerThreads;
+		if (p_settings.backendThreads > 0) rc.backend_threads = p_settings.backendThreads;
+		if (p_settings.backendInvocations > 0) rc.backend_invocations = p_settings.backendInvocations;
+		//. compiled blobs next to the legacy ones; backend.parameters may point elsewhere.
+		if (!mi_model_cache_dir().empty()) rc.parameters[GD_MODEL_CACHE_PARAMETER] = mi_model_cache_dir();
+		//. weights and blobs mapped, shared with the other workers on the host (MiModelMap.h).
+		rc.parameters[GD_MODEL_MMAP_PARAMETER] = g_Settings.modelMmap ? "YES" : "NO";
+		if (mi_wait_passive()) rc.parameters[GD_WAIT_BIND_PARAMETER] = "NO";
+		apply_parameters(rc, p_settings.parameters);
+
+		std::string dir = p_settings.dataDir.empty() ? g_Settings.configDir : p_settings.dataDir;
+		m_pBlueprint.reset(new Blueprint(dir, rc));
+		m_pAnalyzer.reset(new FaceAnalyzer(p_settings.pipeline.empty()
+			? m_pBlueprint->CreateFaceAnalyzer() : m_pBlueprint->CreateFaceAnalyzer(p_settings.pipeline)));
+		m_pDecoder.reset(new ImageDecoder(m_pBlueprint->CreateImageDecoder()));
+		m_dCascadeMargin = p_settings.cascadeMargin;
+		m_nProfilePool = p_settings.validationPool > 0 ? (size_t)p_settings.validationPool : 0;
+		if (!p_settings.cascadePipeline.empty() && m_dCascadeMargin > 0.0) m_pCascade.reset(create_cascade(p_settings.cascadePipeline));
+
+		m_runtime.profile = profile;
+		m_runtime.workerThreads = rc.worker_threads;
+		m_runtime.backendThreads = rc.backend_threads;
+		m_runtime.backendInvocations = rc.backend_invocations;
+
+		std::cout << "Blueprint backend : " << GetReleaseInfo() << ", pipeline " << m_pAnalyzer->GetPipeline() << ", " << rc << std::endl;
+		if (m_pCascade) std::cout << "Blueprint backend : cascade from " << m_pCascade->GetPipeline() << ", margin " << m_dCascadeMargin << std::endl;
+		return true;
+	}
+	catch (const std::exception& e) {
+		p_strErr = e.what();
+		return false;
+	}
+}
+
+std::shared_ptr<FaceAnalyzer> BlueprintBackend::profile_analyzer(int p_nProfile)
+{
+	std::lock_guard<std::mutex> lock(m_profileMutex);
+	m_nProfileTick++;
+	for (auto& e : m_vProfiles) {
+		if (e.profile != p_nProfile) continue;
+		e.used = m_nProfileTick;
+		return e.analyzer;
+	}
+
+	const ValidationProfile& profile = mi_validation_profile_at(p_nProfile);
+	std::shared_ptr<FaceAnalyzer> p;
+	//. the analyzer takes the Blueprint's validation state when it is created; the state is
+	//. put back for the next profile, the main analyzer already has its own.
+	try {
+		for (auto v : profile.suppress) m_pBlueprint->SuppressValidation(v);
+		m_pBlueprint->OverrideValidationParameters(profile.parameters);
+		p.reset(new FaceAnalyzer(m_pBlueprint->CreateFaceAnalyzer(m_pAnalyzer->GetPipeline())));
+	}
+	catch (const std::exception& e) {
+		std::cout << "Blueprint backend : validation profile " << profile.name << " : " << e.what() << ", using the default validations" << std::endl;
+	}
+	try {
+		for (auto v : profile.suppress) m_pBlueprint->SuppressValidation(v, false);
+		m_pBlueprint->OverrideValidationParameters(CustomValidationParameters());
+	}
+	catch (const std::exception&) {
+	}
+
+	//. analyzers in use by other requests stay alive through their shared_ptr.
+	if (m_vProfiles.size() >= m_nProfilePool) {
+		size_t lru = 0;
+		for (size_t i = 1; i < m_vProfiles.size(); i++) if (m_vProfiles[i].used < m_vProfiles[lru].used) lru = i;
+		m_vProfiles.erase(m_vProfiles.begin() + lru);
+	}
+	ProfileAnalyzer e;
+	e.profile = p_nProfile;
+	e.analyzer = p;
+	e.used = m_nProfileTick;
+	m_vProfiles.push_back(e);
+	return p;
+}
+
+//. seconds of one call of p_analyzer on p_image after a first, untimed one.
+static double time_analyzer(FaceAnalyzer& p_analyzer, const Image& p_image)
+{
+	p_analyzer.Analyze(p_image);
+	auto start = std::chrono::steady_clock::now();
+	p_analyzer.Analyze(p_image);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+FaceAnalyzer* BlueprintBackend::create_cascade(const std::string& p_strPipeline)
+{
+	std::string main = m_pAnalyzer->GetPipeline();
+	if (p_strPipeline != "auto") {
+		if (p_strPipeline == main) {
+			std::cout << "Blueprint backend : cascade pipeline is the main one, cascade off" << std::endl;
+			return NULL;
+		}
+		return new FaceAnalyzer(m_pBlueprint->CreateFaceAnalyzer(p_strPipeline));
+	}
+
+	//. a real face (warmup.image) runs every stage, the synthetic frame may stop at detection.
+	std::vector<uint8_t> pixels((size_t)480 * 640 * 3, 128);
+	Image image = g_Settings.warmupImage.empty() ? Image(pixels.data(), 640, 480, PixelFormat::kBGR) : m_pDecoder->DecodeFile(g_Settings.warmupImage);
+	double best = time_analyzer(*m_pAnalyzer, image);
+	m_dFullSec.store(best, std::memory_order_relaxed);
+	std::unique_ptr<FaceAnalyzer> pBest;
+	for (auto& pipeline : m_pBlueprint->GetAvailablePipelines()) {
+		if (pipeline == main) continue;
+		std::unique_ptr<FaceAnalyzer> p(new FaceAnalyzer(m_pBlueprint->CreateFaceAnalyzer(pipeline)));
+		double sec = time_analyzer(*p, image);
+		if (sec < best) {
+			best = sec;
+			pBest = std::move(p);
+		}
+	}
+	if (!pBest) std::cout << "Blueprint backend : no pipeline faster than " << main << ", cascade off" << std::endl;
+	return pBest.release();
+}
+
+//. domain / tolerance of the request's verdict policy, see MiVerdict.h
+static FaceAnalysisParameters analysis_parameters()
+{
+	const VerdictPolicy& policy = mi_verdict_policy();
+	FaceAnalysisParameters params;
+	if (policy.domain >= 0) params.domain = (Domain)policy.domain;
+	if (policy.tolerance >= 0) params.tolerance = (Tolerance)policy.tolerance;
+	return params;
+}
+
+FaceAnalysisResult BlueprintBackend::analyze(const Image& p_image)
+{
+	FaceAnalysisParameters params = analysis_parameters();
+	int profile = m_nProfilePool > 0 ? mi_validation_profile() : -1;
+	if (profile >= 0) {
+		std::shared_ptr<FaceAnalyzer> p = profile_analyzer(profile);
+		if (p) return p->Analyze(p_image, params);
+	}
+	if (!m_pCascade) return m_pAnalyzer->Analyze(p_image, params);
+
+	auto start = std::chrono::steady_clock::now();
+	FaceAnalysisResult res = m_pCascade->Analyze(p_image, params);
+	auto first = std::chrono::steady_clock::now();
+	double firstSec = std::chrono::duration<double>(first - start).count();
+	bool borderline = res.status != FaceStatus::kInvalid && res.genuine_probability.has_value()
+		&& std::fabs(res.genuine_probability.value() - mi_verdict_policy().genuineMin) < m_dCascadeMargin;
+	if (!borderline) {
+		mi_metrics_cascade(false, firstSec, m_dFullSec.load(std::memory_order_relaxed));
+		return res;
+	}
+
+	res = m_pAnalyzer->Analyze(p_image, params);
+	double fullSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - first).count();
+	//. racy read-modify-write, a lost update only delays the mean.
+	double mean = m_dFullSec.load(std::memory_order_relaxed);
+	m_dFullSec.store(mean == 0.0 ? fullSec : mean + (fullSec - mean) * 0.05, std::memory_order_relaxed);
+	mi_metrics_cascade(true, firstSec, fullSec);
+	return res;
+}
+
+CPipelineResult_t BlueprintBackend::check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+	try {
+		StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+		mi_image_count_decode(p_pData);
+		DecodedFrame frame;
+		Image image = mi_image_codec_decode(p_pData, p_nLen, frame) ? Image(frame.pixels.data(), frame.width, frame.height, PixelFormat::kBGR) : m_pDecoder->Decode(p_pData, p_nLen);
+		tCreate.stop();
+
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		return to_pipeline_result(analyze(image), p_pErr, p_pszMsg);
+	}
+	catch (const ImageDecodingException& e) {
+		*p_pErr = FAILED_TO_READ_IMAGE;
+		set_message(p_pszMsg, e.what());
+	}
+	catch (const LicenseExpiredException& e) {
+		*p_pErr = LICENSE_ERROR;
+		set_message(p_pszMsg, e.what());
+	}
+	catch (const std::exception& e) {
+		*p_pErr = UNKNOWN;
+		set_message(p_pszMsg, e.what());
+	}
+	return result;
+}
+
+CPipelineResult_t BlueprintBackend::check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+	try {
+		StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+		Image image(p_pPixels, p_nWidth, p_nHeight, p_encoding == RGB888 ? PixelFormat::kRGB : PixelFormat::kBGR);
+		tCreate.stop();
+
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		return to_pipeline_result(analyze(image), p_pErr, p_pszMsg);
+	}
+	catch (const LicenseExpiredException& e) {
+		*p_pErr = LICENSE_ERROR;
+		set_message(p_pszMsg, e.what());
+	}
+	catch (const std::exception& e) {
+		*p_pErr = UNKNOWN;
+		set_message(p_pszMsg, e.what());
+	}
+	return result;
+}
+
+void BlueprintBackend::check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs)
+{
+	//. the analyzer has no batch call; each image is spread over its worker threads.
+	for (size_t i = 0; i < p_vData.size(); i++) {
+		p_pResults[i] = check((const uint8_t*)p_vData[i]->data(), p_vData[i]->size(), p_pMeta, &p_pErrors[i], p_ppszMsgs[i]);
+	}
+}
+
+void BlueprintBackend::warm_up(int p_nIterations)
+{
+	const int rows = 480, cols = 640;
+	std::vector<uint8_t> pixels((size_t)rows * cols * 3, 128);
+	try {
+		Image image(pixels.data(), cols, rows, PixelFormat::kBGR);
+		for (int i = 0; i < p_nIterations; i++) m_pAnalyzer->Analyze(image);
+		if (m_pCascade) {
+			for (int i = 0; i < p_nIterations; i++) m_pCascade->Analyze(image);
+			//. the saved-time estimate starts from a warm main-pipeline call.
+			if (m_dFullSec.load(std::memory_order_relaxed) == 0.0) m_dFullSec.store(time_analyzer(*m_pAnalyzer, image), std::memory_order_relaxed);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "Warm-up : blueprint backend : " << e.what() << std::endl;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MiBackend.h"
+
+namespace idliveface {
+	class Blueprint;
+	class FaceAnalyzer;
+	class Image;
+	class ImageDecoder;
+	struct FaceAnalysisResult;
+}
+
+//. InferenceBackend on the native IDLive Face API (idliveface.lib). One Blueprint is
+//. built from [backend] data_dir with a RuntimeConfiguration from the [backend] thread
+//. settings; its FaceAnalyzer and ImageDecoder are shared by all request threads and
+//. parallelise internally (worker_threads / backend_invocations), so the legacy batcher
+//. and pipeline pool are not used on this path.
+//. [backend] profile presets the RuntimeConfiguration for a deployment, over
+//. cpu_cores (0 = all) :
+//. - "latency"    : one backend invocation using every core, for few concurrent requests.
+//. - "throughput" : one backend invocation per core with one thread each.
+//. The explicit thread settings and backend.parameters still override the preset.
+//. Mapping to CPipelineResult_t : probability = genuine_probability, score = the same
+//. value (the engine does not expose the raw classifier output), quality 1 / 0 for a
+//. valid / invalid face; the first failed validation becomes the STATUS.
+//. [backend] cascade_pipeline names a cheaper pipeline that answers first ("auto" = the
+//. fastest other one of GetAvailablePipelines on a synthetic frame); only a probability
+//. within cascade_margin of the policy's genuine_min (MiVerdict.h) is analysed again on
+//. the main pipeline, whose answer replaces it. An invalid face is not escalated.
+//. Tenants with a validation profile (MiValidation.h) are analysed on the profile's own
+//. analyzer of the main pipeline, without the cascade; [validation] pool caps these.
+//. what start builds the Blueprint from; mi_blueprint_settings gives the [backend] values.
+struct BlueprintSettings {
+	std::string		dataDir;				//. empty = sdk.config_dir
+	std::string		pipeline;				//. empty = its default
+	std::string		profile;				//. "latency" / "throughput", empty = SDK defaults
+	std::string		parameters;				//. RuntimeConfiguration::parameters, "k=v,k=v"
+	int				cpuCores;				//. CreateRuntimeConfiguration, 0 = all
+	int				workerThreads;			//. RuntimeConfiguration overrides, 0 = from cpuCores
+	int				backendThreads;
+	int				backendInvocations;
+	std::string		cascadePipeline;		//. first-pass pipeline, empty = no cascade, "auto" = fastest other
+	double			cascadeMargin;			//. escalate when |probability - genuine_min| < margin
+	int				validationPool;			//. analyzers of validation profiles kept, 0 = profiles off
+	BlueprintSettings() : cpuCores(0), workerThreads(0), backendThreads(0), backendInvocations(0), cascadeMargin(0.0), validationPool(0) {}
+};
+
+BlueprintSettings mi_blueprint_settings();
+
+class BlueprintBackend : public InferenceBackend {
+public:
+	BlueprintBackend();
+	~BlueprintBackend();
+
+	bool start(const BlueprintSettings& p_settings, std::string& p_strErr);
+
+	const char* name() const override { return "blueprint"; }
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override;
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override;
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override;
+	void warm_up(int p_nIterations) override;
+	BackendRuntime runtime() const override { return m_runtime; }
+
+private:
+	//. one image on the cascade, or on the main analyzer alone.
+	idliveface::FaceAnalysisResult analyze(const idliveface::Image& p_image);
+	//. the cascade_pipeline analyzer, resolving "auto"; NULL leaves the cascade off.
+	idliveface::FaceAnalyzer* create_cascade(const std::string& p_strPipeline);
+	//. the cached analyzer of validation profile p_nProfile, built on a miss; NULL when it fails.
+	std::shared_ptr<idliveface::FaceAnalyzer> profile_analyzer(int p_nProfile);
+
+	struct ProfileAnalyzer {
+		int											profile;
+		std::shared_ptr<idliveface::FaceAnalyzer>	analyzer;	//. NULL = failed to build, not retried
+		uint64_t									used;
+	};
+
+	std::unique_ptr<idliveface::Blueprint>		m_pBlueprint;
+	std::unique_ptr<idliveface::FaceAnalyzer>	m_pAnalyzer;
+	std::unique_ptr<idliveface::FaceAnalyzer>	m_pCascade;		//. first pass, NULL = off
+	std::unique_ptr<idliveface::ImageDecoder>	m_pDecoder;
+	BackendRuntime								m_runtime;
+	double										m_dCascadeMargin;
+	std::atomic<double>							m_dFullSec;		//. running mean of a main-pipeline call, for the saved time
+	std::mutex									m_profileMutex;	//. m_vProfiles and the Blueprint's validation state
+	std::vector<ProfileAnalyzer>				m_vProfiles;
+	uint64_t									m_nProfileTick;
+	size_t										m_nProfilePool;
+};
@@ -0,0 +1,61 @@
+#include "MiBrownout.h"
+#include "MiPlatform.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+static bool						lv_bEnable = false;
+static double					lv_dEnter = 0;
+static double					lv_dExit = 0;
+static uint64_t					lv_nHoldMs = 0;
+static int						lv_nBatchWaitMs = 0;
+static std::atomic<bool>		lv_bActive(false);
+static std::atomic<uint64_t>	lv_nEntries(0);
+//. saturation thread only.
+static uint64_t					lv_nChangedMs = 0;
+
+void mi_brownout_init(bool p_bEnable, double p_dEnter, double p_dExit, int p_nHoldSec, int p_nBatchWaitMs)
+{
+	if (!p_bEnable || p_dEnter <= 0) return;
+	lv_dEnter = p_dEnter;
+	//. exit above enter would leave the mode on the next sample.
+	lv_dExit = std::min(p_dExit, p_dEnter);
+	lv_nHoldMs = (uint64_t)std::max(p_nHoldSec, 0) * 1000;
+	lv_nBatchWaitMs = std::max(p_nBatchWaitMs, 0);
+	lv_nChangedMs = 0;
+	lv_bEnable = true;
+}
+
+void mi_brownout_update(double p_dSaturation)
+{
+	if (!lv_bEnable) return;
+	uint64_t nNow = mi_tick_ms();
+	if (lv_nChangedMs != 0 && nNow - lv_nChangedMs < lv_nHoldMs) return;
+	bool bActive = lv_bActive.load(std::memory_order_relaxed);
+	if (!bActive && p_dSaturation >= lv_dEnter) {
+		lv_bActive.store(true, std::memory_order_relaxed);
+		lv_nEntries.fetch_add(1, std::memory_order_relaxed);
+		lv_nChangedMs = nNow;
+		std::cout << "Brownout : entered at saturation " << p_dSaturation << std::endl;
+	}
+	else if (bActive && p_dSaturation < lv_dExit) {
+		lv_bActive.store(false, std::memory_order_relaxed);
+		lv_nChangedMs = nNow;
+		std::cout << "Brownout : left at saturation " << p_dSaturation << std::endl;
+	}
+}
+
+bool mi_brownout_active()
+{
+	return lv_bActive.load(std::memory_order_relaxed);
+}
+
+int mi_brownout_batch_wait_ms()
+{
+	return mi_brownout_active() ? lv_nBatchWaitMs : -1;
+}
+
+uint64_t mi_brownout_entries()
+{
+	return lv_nEntries.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+//. Brownout mode ([brownout] settings, needs [saturation]). When the saturation signal
+//. (MiSaturation.h) stays above enter, the server trades optional work for capacity until
+//. it falls below exit again :
+//. - GD_API_ANALYZE runs on its brownout detectors, built without the occlusion and
+//.   closed-eyes models (analyze_engines of them, MiAnalyze.h), and leaves the landmarks,
+//.   occlusion and closed-eyes fields out whatever the request asked for,
+//. - the batcher holds a request at most batch_wait_ms for a fuller batch,
+//. - no check is sampled for shadow traffic (MiShadow.h).
+//. The mode is entered or left at most once per hold_sec, so a signal hovering around a
+//. threshold does not flap. A request served in brownout carries "brownout" in
+//. GD_DEGRADED_HEADER (and "degraded":true in the v2 schema, MiContext.h); mi_brownout_active
+//. and mi_brownout_entries_total are on GD_API_METRICS, "brownout" on GD_API_HEALTH.
+
+void mi_brownout_init(bool p_bEnable, double p_dEnter, double p_dExit, int p_nHoldSec, int p_nBatchWaitMs);
+
+//. a new saturation sample (the saturation thread).
+void mi_brownout_update(double p_dSaturation);
+
+bool mi_brownout_active();
+//. batch wait cap in brownout, -1 outside it.
+int mi_brownout_batch_wait_ms();
+uint64_t mi_brownout_entries();
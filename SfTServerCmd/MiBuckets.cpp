@@ -0,0 +1,76 @@
+#include "MiBuckets.h"
+#include "Poco/NumberParser.h"
+#include "Poco/StringTokenizer.h"
+#include <algorithm>
+
+BatchBuckets::BatchBuckets()
+{
+	for (int i = 0; i < MI_BUCKETS_MAX; i++) m_nBestNs[i].store(0, std::memory_order_relaxed);
+}
+
+void BatchBuckets::init(const std::string& p_strList, int p_nMax)
+{
+	m_vSizes.clear();
+	Poco::StringTokenizer tok(p_strList, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (const std::string& t : tok) {
+		int n = 0;
+		if (Poco::NumberParser::tryParse(t, n) && n > 0 && (p_nMax <= 0 || n <= p_nMax)) m_vSizes.push_back(n);
+	}
+	std::sort(m_vSizes.begin(), m_vSizes.end());
+	m_vSizes.erase(std::unique(m_vSizes.begin(), m_vSizes.end()), m_vSizes.end());
+	if (m_vSizes.size() > MI_BUCKETS_MAX) m_vSizes.resize(MI_BUCKETS_MAX);
+	//. a single image has to fit somewhere.
+	if (!m_vSizes.empty() && m_vSizes.front() != 1) {
+		m_vSizes.insert(m_vSizes.begin(), 1);
+		if (m_vSizes.size() > MI_BUCKETS_MAX) m_vSizes.pop_back();
+	}
+	for (int i = 0; i < MI_BUCKETS_MAX; i++) m_nBestNs[i].store(0, std::memory_order_relaxed);
+}
+
+void BatchBuckets::measure(int p_nSize, double p_dSec)
+{
+	std::vector<int>::const_iterator it = std::find(m_vSizes.begin(), m_vSizes.end(), p_nSize);
+	if (it == m_vSizes.end() || p_dSec <= 0) return;
+	std::atomic<uint64_t>& best = m_nBestNs[it - m_vSizes.begin()];
+	uint64_t ns = (uint64_t)(p_dSec * 1e9);
+	if (ns == 0) ns = 1;
+	uint64_t cur = best.load(std::memory_order_relaxed);
+	while ((cur == 0 || ns < cur) && !best.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {}
+}
+
+double BatchBuckets::measured(size_t p_nBucket) const
+{
+	return p_nBucket < m_vSizes.size() ? m_nBestNs[p_nBucket].load(std::memory_order_relaxed) * 1e-9 : 0;
+}
+
+double BatchBuckets::cost(size_t p_nBucket) const
+{
+	//. mixing measured and assumed costs would compare seconds with images.
+	for (size_t i = 0; i < m_vSizes.size(); i++) {
+		if (measured(i) <= 0) return m_vSizes[p_nBucket];
+	}
+	return measured(p_nBucket);
+}
+
+void BatchBuckets::plan(size_t p_nImages, std::vector<int>& p_vCalls) const
+{
+	p_vCalls.clear();
+	if (m_vSizes.empty() || p_nImages == 0) return;
+	//. best[k] : least cost of k images, choice[k] the first call of it.
+	std::vector<double> best(p_nImages + 1, 0.0);
+	std::vector<int> choice(p_nImages + 1, 0);
+	for (size_t k = 1; k <= p_nImages; k++) {
+		best[k] = -1;
+		for (size_t b = 0; b < m_vSizes.size(); b++) {
+			size_t size = (size_t)m_vSizes[b];
+			double c = cost(b) + best[k > size ? k - size : 0];
+			if (best[k] < 0 || c < best[k]) {
+				best[k] = c;
+				choice[k] = (int)size;
+			}
+		}
+	}
+	//. the padded call, if any, goes last.
+	for (size_t k = p_nImages; k > 0; k -= std::min(k, (size_t)choice[k])) p_vCalls.push_back(choice[k]);
+	std::sort(p_vCalls.begin(), p_vCalls.end(), std::greater<int>());
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+//. Shape buckets of the micro-batcher ([batch] buckets, e.g. "1,4,8,16") : OpenVINO runs a
+//. batch fastest at the shapes it compiled (sdk.ov_max_batch_size, by default the largest
+//. bucket), so a batch of n images is run as pipeline_check_liveness_batch2 calls of bucket
+//. sizes only. plan() picks the calls of least total cost from the table : a call may be
+//. padded (its last images repeated, their results dropped) when running the next bucket up
+//. costs less than splitting the leftover. The table holds the fastest call per bucket the
+//. warm-up measured (MiWarmup.h); until then a call is taken to cost its size, which never
+//. pads. Calls per bucket and padded images are on GD_API_METRICS (mi_batch_bucket_calls_total,
+//. mi_batch_padded_images_total); SdkBench --buckets measures the same table and compares
+//. the plans with one call per batch.
+
+#define MI_BUCKETS_MAX		16
+
+class BatchBuckets {
+public:
+	BatchBuckets();
+
+	//. p_strList : sizes separated by commas, those above p_nMax dropped; empty = off.
+	void init(const std::string& p_strList, int p_nMax);
+	bool enabled() const { return !m_vSizes.empty(); }
+	//. ascending.
+	const std::vector<int>& sizes() const { return m_vSizes; }
+	int largest() const { return m_vSizes.empty() ? 0 : m_vSizes.back(); }
+
+	//. one call of bucket p_nSize took p_dSec; any thread.
+	void measure(int p_nSize, double p_dSec);
+	//. seconds of one call of bucket index p_nBucket, 0 = not measured.
+	double measured(size_t p_nBucket) const;
+
+	//. bucket sizes of the calls for p_nImages images, in order; their sum is at least
+	//. p_nImages, the excess is padding.
+	void plan(size_t p_nImages, std::vector<int>& p_vCalls) const;
+
+private:
+	//. planning cost of bucket index p_nBucket.
+	double cost(size_t p_nBucket) const;
+
+	std::vector<int>		m_vSizes;
+	std::atomic<uint64_t>	m_nBestNs[MI_BUCKETS_MAX];		//. 0 = not measured
+};
@@ -0,0 +1,72 @@
+#include "MiBufferPool.h"
+#include "MiConf.h"
+#include "MiNuma.h"
+
+BufferPool g_BufferPool(GD_BUFFER_POOL_SIZE, GD_BUFFER_POOL_MAX_KEEP);
+
+BufferPool::BufferPool(size_t p_nMaxBuffers, size_t p_nMaxKeep)
+	: m_vFree(GD_NUMA_MAX_NODES), m_nMaxBuffers(p_nMaxBuffers), m_nMaxKeep(p_nMaxKeep)
+{
+}
+
+BufferPool::~BufferPool()
+{
+	for (size_t n = 0; n < m_vFree.size(); n++) {
+		for (size_t i = 0; i < m_vFree[n].size(); i++) delete m_vFree[n][i];
+	}
+	m_vFree.clear();
+}
+
+std::string* BufferPool::acquire(size_t p_nSizeHint)
+{
+	std::string* pBuf = NULL;
+	int node = mi_numa_current_node();
+	{
+		MiLockGuard lock(m_mtx);
+		std::vector<std::string*>& vFree = m_vFree[node];
+		if (!vFree.empty()) {
+			pBuf = vFree.back();
+			vFree.pop_back();
+		}
+	}
+	if (pBuf == NULL) pBuf = new std::string();
+
+	pBuf->clear();
+	if (p_nSizeHint > pBuf->capacity()) pBuf->reserve(p_nSizeHint);
+	return pBuf;
+}
+
+void BufferPool::release(std::string* p_pBuf)
+{
+	if (p_pBuf == NULL) return;
+
+	if (p_pBuf->capacity() <= m_nMaxKeep) {
+		p_pBuf->clear();
+		int node = mi_numa_current_node();
+		MiLockGuard lock(m_mtx);
+		std::vector<std::string*>& vFree = m_vFree[node];
+		if (vFree.size() < m_nMaxBuffers) {
+			vFree.push_back(p_pBuf);
+			return;
+		}
+	}
+	delete p_pBuf;
+}
+
+size_t BufferPool::trim()
+{
+	std::vector<std::string*> vFree;
+	{
+		MiLockGuard lock(m_mtx);
+		for (size_t n = 0; n < m_vFree.size(); n++) {
+			vFree.insert(vFree.end(), m_vFree[n].begin(), m_vFree[n].end());
+			m_vFree[n].clear();
+		}
+	}
+	size_t nBytes = 0;
+	for (size_t i = 0; i < vFree.size(); i++) {
+		nBytes += vFree[i]->capacity();
+		delete vFree[i];
+	}
+	return nBytes;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MiLock.h"
+#include <string>
+#include <vector>
+
+//. Free list of upload buffers reused across requests so an image body does not
+//. cost a fresh allocation (and its page faults) every time.
+//. Buffers above m_nMaxKeep bytes of capacity are freed instead of kept.
+//. With NUMA placement (MiNuma.h) each node has its own free list : a buffer goes back
+//. to the list of the node it was released on and is handed out there again, so its
+//. pages stay local to the threads of that node.
+class BufferPool {
+public:
+	BufferPool(size_t p_nMaxBuffers, size_t p_nMaxKeep);
+	~BufferPool();
+
+	//. returns an empty buffer with at least p_nSizeHint bytes reserved.
+	std::string* acquire(size_t p_nSizeHint);
+	void release(std::string* p_pBuf);
+	//. frees every buffer on the free lists, returns their capacity in bytes.
+	size_t trim();
+
+private:
+	MI_MUTEX(m_mtx, "buffer_pool");
+	std::vector<std::vector<std::string*>>	m_vFree;	//. per NUMA node
+	size_t						m_nMaxBuffers;		//. per node
+	size_t						m_nMaxKeep;
+};
+
+//. RAII borrow of one pooled buffer.
+class PooledBuffer {
+public:
+	PooledBuffer(BufferPool& p_pool, size_t p_nSizeHint) : m_pool(p_pool), m_pBuf(p_pool.acquire(p_nSizeHint)) {}
+	~PooledBuffer() { m_pool.release(m_pBuf); }
+
+	std::string& operator*() const { return *m_pBuf; }
+	std::string* get() const { return m_pBuf; }
+
+private:
+	PooledBuffer(const PooledBuffer&) = delete;
+	PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+	BufferPool&		m_pool;
+	std::string*	m_pBuf;
+};
+
+extern BufferPool g_BufferPool;
@@ -0,0 +1,65 @@
+#include "MiBurst.h"
+#include "MiDetect.h"
+#include "MiMetrics.h"
+#include "MiQuality.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+static bool				lv_bEnable = false;
+static BurstSettings	lv_settings;
+
+void mi_burst_init(bool p_bEnable, const BurstSettings& p_settings)
+{
+	lv_settings = p_settings;
+	lv_settings.topK = std::max(lv_settings.topK, 1);
+	lv_settings.sizeWeight = std::min(std::max(lv_settings.sizeWeight, 0.0), 1.0);
+	lv_bEnable = p_bEnable;
+}
+
+bool mi_burst_enabled()
+{
+	return lv_bEnable && mi_quality_enabled();
+}
+
+const BurstSettings& mi_burst_settings()
+{
+	return lv_settings;
+}
+
+size_t mi_burst_select(const CImage_t** p_ppImages, size_t p_nCount, size_t p_nTopK, BurstFrame* p_pFrames, int* p_pErrors, char** p_ppszMsgs, size_t* p_pSelected)
+{
+	std::vector<float> vScores(p_nCount);
+	std::unique_ptr<bool[]> pUsable(new bool[p_nCount]);
+	std::vector<double> vAreas(p_nCount, 0.0);
+	mi_quality_scores(p_ppImages, p_nCount, vScores.data(), pUsable.get(), p_pErrors, p_ppszMsgs);
+	bool bSize = lv_settings.faceSize && lv_settings.sizeWeight > 0 && mi_detect_enabled();
+	if (bSize) mi_detect_face_areas(p_ppImages, p_nCount, vAreas.data());
+
+	double dMaxArea = 0;
+	for (size_t i = 0; i < p_nCount; i++) dMaxArea = std::max(dMaxArea, vAreas[i]);
+	double w = dMaxArea > 0 ? lv_settings.sizeWeight : 0;
+	std::vector<size_t> vOrder;
+	for (size_t i = 0; i < p_nCount; i++) {
+		BurstFrame& f = p_pFrames[i];
+		f.quality = vScores[i];
+		f.usable = pUsable[i];
+		f.faceArea = vAreas[i];
+		f.rank = (1 - w) * f.quality + (dMaxArea > 0 ? w * f.faceArea / dMaxArea : 0);
+		f.selected = false;
+		if (p_ppImages[i] != NULL && p_pErrors[i] == OK) vOrder.push_back(i);
+	}
+	//. usable frames first; ties keep capture order.
+	std::stable_sort(vOrder.begin(), vOrder.end(), [p_pFrames](size_t a, size_t b) {
+		if (p_pFrames[a].usable != p_pFrames[b].usable) return p_pFrames[a].usable;
+		return p_pFrames[a].rank > p_pFrames[b].rank;
+	});
+	if (vOrder.size() > p_nTopK) vOrder.resize(p_nTopK);
+	std::sort(vOrder.begin(), vOrder.end());
+	for (size_t k = 0; k < vOrder.size(); k++) {
+		p_pFrames[vOrder[k]].selected = true;
+		p_pSelected[k] = vOrder[k];
+	}
+	mi_metrics_burst(vOrder.size(), p_nCount - vOrder.size());
+	return vOrder.size();
+}
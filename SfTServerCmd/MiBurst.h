@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include "FaceSdkApi.h"
+
+//. Best-frame selection for GD_API_BURST ([burst] settings, needs [quality]) : kiosks send
+//. a burst of 10 - 20 frames, only a few of which are worth a liveness check. Every frame
+//. goes through one check_quality_batch call and, with face_size and [detect] on, one
+//. detect_only_bounding_box_batch call; frames are ranked usable first, then by
+//.   rank = (1 - size_weight) * quality score + size_weight * face area / largest face area
+//. and the top_k best (?top_k=N per request) are checked, in capture order : each on its own
+//. in one batched call, or with fused (?mode=fused) as one sequence (image_batch_create).
+//. The response lists every frame's score and whether it was checked, and how many liveness
+//. checks the selection saved; mi_burst_frames_total{outcome} counts checked and skipped frames.
+
+struct BurstSettings {
+	int		topK;
+	double	sizeWeight;		//. share of the face size in the rank, 0 .. 1
+	bool	faceSize;		//. detect the faces for their size ([detect] engines)
+	bool	fused;			//. the selected frames make one sequence
+	BurstSettings() : topK(3), sizeWeight(0.3), faceSize(true), fused(false) {}
+};
+
+struct BurstFrame {
+	float	quality;
+	bool	usable;
+	double	faceArea;		//. largest face in pixels, 0 = not detected
+	double	rank;
+	bool	selected;
+};
+
+void mi_burst_init(bool p_bEnable, const BurstSettings& p_settings);
+bool mi_burst_enabled();
+const BurstSettings& mi_burst_settings();
+
+//. scores the p_nCount decoded frames (NULL = not decoded, STATUS in p_pErrors) into p_pFrames
+//. and writes the indices of the at most p_nTopK best to p_pSelected in capture order;
+//. returns their count. Frames the quality engine failed on are never selected.
+size_t mi_burst_select(const CImage_t** p_ppImages, size_t p_nCount, size_t p_nTopK, BurstFrame* p_pFrames, int* p_pErrors, char** p_ppszMsgs, size_t* p_pSelected);
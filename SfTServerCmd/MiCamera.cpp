@@ -0,0 +1,340 @@
+#include "MiCamera.h"
+#include "MiConf.h"
+#include "MiConfig.h"
+#include "MiInference.h"
+#include "MiLanes.h"
+#include "MiLock.h"
+#include "MiMetrics.h"
+#include "MiMsgBuffers.h"
+#include "MiMultipart.h"
+#include "MiPlatform.h"
+#include "MiQuality.h"
+#include "MiResize.h"
+#include "MiResultJson.h"
+#include "MiSdkCall.h"
+#include "MiVideo.h"
+#if MI_HAS_WIC
+#include "MiWic.h"
+#endif
+#include "Poco/Exception.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/URI.h"
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+struct Camera {
+	int				index;
+	std::string		url;
+	std::thread		thread;
+	uint64_t		frames;			//. frames read from the stream
+	uint64_t		nextMs;			//. mi_tick_ms before which frames are dropped
+};
+
+static CameraSettings						lv_settings;
+static std::vector<std::unique_ptr<Camera>>	lv_vCameras;
+static std::atomic<bool>					lv_bStop(false);
+static std::atomic<int>						lv_nConnected(0);
+static MI_MUTEX(lv_mtx, "camera");
+static MiCondition							lv_cv;
+
+static const char* lv_szOutcomes[MI_CAMERA_COUNT] = { "dropped", "prefilter", "quality", "checked" };
+
+//. largest JPEG part accepted from a camera.
+static const size_t lv_nMaxFrame = 16 * 1024 * 1024;
+
+//. scales p_nWidth x p_nHeight so the long side is at most p_nSide.
+static void fit(int p_nWidth, int p_nHeight, int p_nSide, int& p_nOutW, int& p_nOutH)
+{
+	int longSide = p_nWidth > p_nHeight ? p_nWidth : p_nHeight;
+	if (longSide <= p_nSide) {
+		p_nOutW = p_nWidth;
+		p_nOutH = p_nHeight;
+		return;
+	}
+	p_nOutW = (int)((long long)p_nWidth * p_nSide / longSide); if (p_nOutW < 1) p_nOutW = 1;
+	p_nOutH = (int)((long long)p_nHeight * p_nSide / longSide); if (p_nOutH < 1) p_nOutH = 1;
+}
+
+//. scaled BGR copy of a JPEG frame, the full frame is never converted.
+static bool jpeg_small(const uint8_t* p_pData, size_t p_nLen, PixelBuffer& p_out, int& p_nWidth, int& p_nHeight)
+{
+#if MI_HAS_WIC
+	ComRef<IWICStream> stream;
+	ComRef<IWICBitmapDecoder> decoder;
+	ComRef<IWICBitmapFrameDecode> frame;
+	if (!mi_wic_open(p_pData, p_nLen, stream, decoder, frame)) return false;
+	UINT w = 0, h = 0;
+	if (FAILED(frame->GetSize(&w, &h)) || w == 0 || h == 0) return false;
+	fit((int)w, (int)h, lv_settings.side, p_nWidth, p_nHeight);
+	p_out.resize((size_t)p_nWidth * p_nHeight * 3);
+	IWICImagingFactory* factory = mi_wic_factory();
+	ComRef<IWICBitmapScaler> scaler;
+	ComRef<IWICFormatConverter> conv;
+	if (FAILED(factory->CreateBitmapScaler(&scaler.p))) return false;
+	if (FAILED(scaler->Initialize(frame.p, (UINT)p_nWidth, (UINT)p_nHeight, WICBitmapInterpolationModeFant))) return false;
+	if (FAILED(factory->CreateFormatConverter(&conv.p))) return false;
+	if (FAILED(conv->Initialize(scaler.p, GUID_WICPixelFormat24bppBGR, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom))) return false;
+	return SUCCEEDED(conv->CopyPixels(NULL, (UINT)p_nWidth * 3, (UINT)p_out.size(), p_out.data()));
+#else
+	(void)p_pData; (void)p_nLen; (void)p_out; (void)p_nWidth; (void)p_nHeight;
+	return false;
+#endif
+}
+
+static void post_webhook(const std::string& p_strBody)
+{
+	if (lv_settings.webhook.empty()) return;
+	try {
+		Poco::URI uri(lv_settings.webhook);
+		if (uri.getScheme() != "http") return;
+		Poco::Net::HTTPClientSession session(uri.getHost(), uri.getPort());
+		session.setTimeout(Poco::Timespan(GD_JOBS_CALLBACK_TIMEOUT_SEC, 0));
+		Poco::Net::HTTPRequest req(Poco::Net::HTTPRequest::HTTP_POST, uri.getPathAndQuery().empty() ? "/" : uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+		req.setContentType("application/json");
+		req.setContentLength((std::streamsize)p_strBody.size());
+		session.sendRequest(req).write(p_strBody.data(), (std::streamsize)p_strBody.size());
+		Poco::Net::HTTPResponse resp;
+		session.receiveResponse(resp);
+	}
+	catch (Poco::Exception&) {
+		//. best effort, the next qualifying frame is checked again.
+	}
+}
+
+//. one frame of a camera : a JPEG (p_pJpeg) or decoded BGR pixels (p_pFrame).
+static void on_frame(Camera& p_cam, const uint8_t* p_pJpeg, size_t p_nJpegLen, const VideoFrame* p_pFrame)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	p_cam.frames++;
+	uint64_t nNow = mi_tick_ms();
+	if (nNow < p_cam.nextMs) {
+		mi_metrics_camera(MI_CAMERA_DROPPED);
+		return;
+	}
+	p_cam.nextMs = nNow + (uint64_t)lv_settings.intervalMs;
+
+	//. screened copy.
+	PixelBuffer small;
+	int sw = 0, sh = 0;
+	bool bSmall = false;
+	if (p_pFrame != NULL) {
+		fit(p_pFrame->width, p_pFrame->height, lv_settings.side, sw, sh);
+		small.resize((size_t)sw * sh * 3);
+		mi_resize_bgr(p_pFrame->pixels.data(), p_pFrame->width, p_pFrame->height, (size_t)p_pFrame->width * 3, small.data(), sw, sh, (size_t)sw * 3);
+		bSmall = true;
+	}
+	else {
+		bSmall = jpeg_small(p_pJpeg, p_nJpegLen, small, sw, sh);
+	}
+	if (bSmall) {
+		PrefilterOutcome outcome = mi_prefilter_judge(small.data(), sw, sh, (size_t)sw * 3, BGR888, lv_settings.prefilter);
+		if (outcome == MI_PREFILTER_BLUR || outcome == MI_PREFILTER_DARK) {
+			mi_metrics_camera(MI_CAMERA_PREFILTER);
+			return;
+		}
+	}
+
+	float score = 0;
+	bool usable = false;
+	{
+		const CImage_t* image = bSmall
+			? FaceSdk::image_create_pixels(small.data(), (size_t)sh, (size_t)sw, BGR888, &err, msg)
+			: FaceSdk::image_create_bytes(p_pJpeg, p_nJpegLen, &err, msg);
+		if (image == NULL) return;
+		MsgBuffers msgs(1);
+		int qualityErr = OK;
+		mi_quality_scores(&image, 1, &score, &usable, &qualityErr, msgs.data());
+		face_sdk_api().image_destroy((CImage_t*)image);
+	}
+	if (!usable || score < lv_settings.minQuality) {
+		mi_metrics_camera(MI_CAMERA_QUALITY);
+		return;
+	}
+
+	//. liveness at full resolution.
+	CImage_t* image = p_pFrame != NULL
+		? FaceSdk::image_create_pixels(p_pFrame->pixels.data(), (size_t)p_pFrame->height, (size_t)p_pFrame->width, BGR888, &err, msg)
+		: FaceSdk::image_create_bytes(p_pJpeg, p_nJpegLen, &err, msg);
+	if (image == NULL) return;
+	CPipelineResult_t result;
+	{
+		LanePermit permit(MI_LANE_BULK);
+		result = mi_check_liveness(image, &err, msg);
+	}
+	face_sdk_api().image_destroy(image);
+	mi_metrics_status(err);
+	mi_metrics_camera(MI_CAMERA_CHECKED);
+	p_cam.nextMs = mi_tick_ms() + (uint64_t)std::max(lv_settings.cooldownMs, lv_settings.intervalMs);
+
+	ArenaString out;
+	out.reserve(GD_RESULT_JSON_RESERVE);
+	out.append("{\"camera\":");
+	mi_json_put_int(out, p_cam.index);
+	out.append(",\"frame\":");
+	mi_json_put_int(out, (int)p_cam.frames);
+	out.append(",\"timestamp\":");
+	mi_json_put_int(out, (int)(p_pFrame != NULL ? p_pFrame->timestampMs : 0));
+	out.append(",\"quality\":");
+	mi_json_put_float(out, score);
+	out.append(",\"result\":");
+	mi_json_result(mi_result_schema(mi_config().responseSchema, MI_SCHEMA_LEGACY), out, result, err, msg);
+	out.push_back('}');
+	post_webhook(std::string(out.data(), out.size()));
+}
+
+//. header line without its CR LF; false at the end of the stream.
+static bool read_line(std::istream& p_in, std::string& p_strLine)
+{
+	if (!std::getline(p_in, p_strLine)) return false;
+	if (!p_strLine.empty() && p_strLine.back() == '\r') p_strLine.pop_back();
+	return true;
+}
+
+//. reads multipart/x-mixed-replace parts until the stream ends or the server stops.
+static void mjpeg_run(Camera& p_cam)
+{
+	Poco::URI uri(p_cam.url);
+	Poco::Net::HTTPClientSession session(uri.getHost(), uri.getPort());
+	session.setTimeout(Poco::Timespan(5, 0));
+	Poco::Net::HTTPRequest req(Poco::Net::HTTPRequest::HTTP_GET, uri.getPathAndQuery().empty() ? "/" : uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+	session.sendRequest(req);
+	Poco::Net::HTTPResponse resp;
+	std::istream& in = session.receiveResponse(resp);
+	if (resp.getStatus() != Poco::Net::HTTPResponse::HTTP_OK) throw Poco::IOException("camera answered " + std::to_string((int)resp.getStatus()));
+	std::string strBoundary;
+	if (!mi_multipart_boundary(resp.getContentType(), strBoundary)) throw Poco::DataFormatException("not an MJPEG stream : " + resp.getContentType());
+	std::string strDelim = "--" + strBoundary;
+
+	lv_nConnected++;
+	struct Connected { ~Connected() { lv_nConnected--; } } connected;
+	std::string line, frame;
+	while (!lv_bStop.load(std::memory_order_relaxed)) {
+		//. up to the next boundary (some cameras leave out the leading dashes).
+		bool bPart = false;
+		while (read_line(in, line)) {
+			if (line == strDelim || line == strBoundary) {
+				bPart = true;
+				break;
+			}
+		}
+		if (!bPart) return;
+		size_t nLength = 0;
+		while (read_line(in, line) && !line.empty()) {
+			size_t colon = line.find(':');
+			if (colon != std::string::npos && Poco::icompare(line.substr(0, colon), "Content-Length") == 0) {
+				unsigned nParsed = 0;
+				if (Poco::NumberParser::tryParseUnsigned(Poco::trim(line.substr(colon + 1)), nParsed)) nLength = nParsed;
+			}
+		}
+		if (nLength > lv_nMaxFrame) throw Poco::DataFormatException("MJPEG part too large");
+		frame.clear();
+		if (nLength > 0) {
+			frame.resize(nLength);
+			in.read(&frame[0], (std::streamsize)nLength);
+			if ((size_t)in.gcount() != nLength) return;
+		}
+		else {
+			//. no Content-Length : up to the JPEG end marker.
+			char c = 0, prev = 0;
+			while (in.get(c)) {
+				frame.push_back(c);
+				if ((unsigned char)prev == 0xFF && (unsigned char)c == 0xD9) break;
+				if (frame.size() > lv_nMaxFrame) throw Poco::DataFormatException("MJPEG part too large");
+				prev = c;
+			}
+		}
+		if (!frame.empty()) on_frame(p_cam, (const uint8_t*)frame.data(), frame.size(), NULL);
+	}
+}
+
+static void rtsp_run(Camera& p_cam)
+{
+	std::string strErr;
+	VideoLive* pLive = mi_video_live_open(p_cam.url, lv_settings.hardware, strErr);
+	if (pLive == NULL) throw Poco::IOException(strErr);
+	lv_nConnected++;
+	VideoFrame frame;
+	while (!lv_bStop.load(std::memory_order_relaxed) && mi_video_live_next(pLive, frame, strErr)) on_frame(p_cam, NULL, 0, &frame);
+	lv_nConnected--;
+	mi_video_live_close(pLive);
+}
+
+static void camera_loop(Camera* p_pCam)
+{
+	bool bRtsp = Poco::toLower(Poco::URI(p_pCam->url).getScheme()) == "rtsp";
+	while (!lv_bStop.load(std::memory_order_relaxed)) {
+		try {
+			if (bRtsp) rtsp_run(*p_pCam);
+			else mjpeg_run(*p_pCam);
+		}
+		catch (const Poco::Exception& ex) {
+			std::cout << "Camera " << p_pCam->index << " : " << ex.displayText() << std::endl;
+		}
+		MiUniqueLock lock(lv_mtx);
+		lv_cv.wait_for(lock, std::chrono::milliseconds(lv_settings.reconnectMs), [] { return lv_bStop.load(); });
+	}
+}
+
+bool mi_camera_start(const CameraSettings& p_settings, std::string& p_strErr)
+{
+	if (!mi_quality_enabled()) {
+		p_strErr = "needs [quality] enable";
+		return false;
+	}
+	lv_settings = p_settings;
+	lv_settings.intervalMs = std::max(lv_settings.intervalMs, 1);
+	lv_settings.side = std::max(lv_settings.side, 64);
+	lv_settings.reconnectMs = std::max(lv_settings.reconnectMs, 100);
+	lv_bStop = false;
+	Poco::StringTokenizer tok(p_settings.urls, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (const std::string& url : tok) {
+		std::unique_ptr<Camera> pCam(new Camera);
+		pCam->index = (int)lv_vCameras.size();
+		pCam->url = url;
+		pCam->frames = 0;
+		pCam->nextMs = 0;
+		lv_vCameras.push_back(std::move(pCam));
+	}
+	if (lv_vCameras.empty()) {
+		p_strErr = "no camera urls";
+		return false;
+	}
+	for (std::unique_ptr<Camera>& pCam : lv_vCameras) pCam->thread = std::thread(camera_loop, pCam.get());
+	return true;
+}
+
+void mi_camera_stop()
+{
+	{
+		MiLockGuard lock(lv_mtx);
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	for (std::unique_ptr<Camera>& pCam : lv_vCameras) {
+		if (pCam->thread.joinable()) pCam->thread.join();
+	}
+	lv_vCameras.clear();
+}
+
+int mi_camera_connected()
+{
+	return lv_nConnected.load();
+}
+
+const char* mi_camera_outcome_name(int p_nOutcome)
+{
+	return p_nOutcome >= 0 && p_nOutcome < MI_CAMERA_COUNT ? lv_szOutcomes[p_nOutcome] : "unknown";
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include "MiPrefilter.h"
+
+//. Pull-mode ingestion for fixed kiosks ([camera] settings) : instead of one HTTP request
+//. per frame, a worker thread per camera reads its stream continuously and only calls the
+//. liveness pipeline when a usable face is in front of it.
+//.   http://  : MJPEG (multipart/x-mixed-replace), one JPEG per part;
+//.   rtsp://  : a Media Foundation source reader (MiVideo.h), Windows builds only.
+//. At most one frame per interval_ms is looked at, the others are read off the stream and
+//. dropped. That frame is reduced to a copy of at most side pixels (WIC scaled decode for
+//. JPEG, mi_resize_bgr for decoded frames), screened by the blur / darkness prefilter with the
+//. [prefilter] thresholds and by the [quality] engine (usable and score >= min_quality).
+//. Only a frame that passes both goes to liveness at full resolution, on the bulk lane so
+//. the cameras never crowd out interactive requests, and the camera then rests cooldown_ms.
+//. Every result is POSTed as JSON to webhook : {"camera","frame","timestamp","quality","result"}.
+//. Builds without WIC cannot make the copy of a JPEG and run the quality engine on the full
+//. frame instead, without the prefilter.
+//. mi_camera_frames_total{outcome} and mi_camera_connected on GD_API_METRICS.
+
+struct CameraSettings {
+	std::string			urls;			//. comma-separated camera streams
+	std::string			webhook;		//. http URL the results are POSTed to
+	int					intervalMs;		//. frames looked at, at most one per interval
+	int					side;			//. long side of the screened copy
+	float				minQuality;
+	int					cooldownMs;		//. after a liveness check
+	int					reconnectMs;	//. wait before opening a lost stream again
+	bool				hardware;		//. rtsp : hardware decoder transforms
+	PrefilterThresholds	prefilter;
+};
+
+enum CameraOutcome {
+	MI_CAMERA_DROPPED = 0,		//. arrived within interval_ms or the cooldown
+	MI_CAMERA_PREFILTER,		//. blurred or dark
+	MI_CAMERA_QUALITY,			//. no usable face
+	MI_CAMERA_CHECKED,			//. went to liveness
+	MI_CAMERA_COUNT
+};
+
+//. starts one worker per URL; false when there is none or [quality] is off.
+bool mi_camera_start(const CameraSettings& p_settings, std::string& p_strErr);
+void mi_camera_stop();
+
+//. cameras whose stream is open right now.
+int mi_camera_connected();
+const char* mi_camera_outcome_name(int p_nOutcome);
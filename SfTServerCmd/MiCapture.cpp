@@ -0,0 +1,209 @@
+#include "MiCapture.h"
+#include "MiAdmission.h"
+#include "MiConf.h"
+#include "MiConnection.h"
+#include "MiHash.h"
+#include "MiReactorHttp.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+static CaptureSettings							lv_settings;
+static std::atomic<bool>						lv_bEnabled(false);
+static std::atomic<unsigned long long>			lv_nSeen(0);		//. capturable requests, for the sampling
+static std::atomic<unsigned long long>			lv_nRecords(0);
+static std::atomic<unsigned long long>			lv_nDropped(0);
+static steady_clock::time_point					lv_tStart;
+static std::ofstream							lv_file;
+static std::thread								lv_writer;
+static std::mutex								lv_mtx;
+static std::condition_variable					lv_cv;
+static std::deque<std::string>					lv_queue;
+static size_t									lv_nQueued = 0;		//. bytes in lv_queue
+static std::vector<std::string>					lv_vRedact;			//. header names, GD_CAPTURE_REDACT and redact
+static bool										lv_bStop = false;
+
+template <class T>
+static void put(std::string& p_out, T p_value)
+{
+	p_out.append((const char*)&p_value, sizeof(p_value));
+}
+
+static void put_text(std::string& p_out, const std::string& p_strText)
+{
+	uint16_t n = (uint16_t)std::min(p_strText.size(), (size_t)UINT16_MAX);
+	put(p_out, n);
+	p_out.append(p_strText.data(), n);
+}
+
+static bool redacted(const std::string& p_strName)
+{
+	for (const std::string& s : lv_vRedact) {
+		if (Poco::icompare(p_strName, s) == 0) return true;
+	}
+	return false;
+}
+
+static void writer_run()
+{
+	uint64_t nWritten = (uint64_t)lv_file.tellp();
+	uint64_t nMax = (uint64_t)lv_settings.maxMb * 1024 * 1024;
+	std::unique_lock<std::mutex> lock(lv_mtx);
+	while (true) {
+		lv_cv.wait(lock, [] { return lv_bStop || !lv_queue.empty(); });
+		if (lv_queue.empty()) break;
+		std::deque<std::string> batch;
+		batch.swap(lv_queue);
+		lv_nQueued = 0;
+		lock.unlock();
+		for (const std::string& rec : batch) {
+			if (nMax > 0 && nWritten + rec.size() > nMax) {
+				if (lv_bEnabled.exchange(false)) std::cout << "Capture : " << lv_settings.path << " reached max_mb, recording stopped" << std::endl;
+				break;
+			}
+			lv_file.write(rec.data(), (std::streamsize)rec.size());
+			nWritten += rec.size();
+			lv_nRecords.fetch_add(1, std::memory_order_relaxed);
+		}
+		lv_file.flush();
+		lock.lock();
+	}
+}
+
+bool mi_capture_init(const CaptureSettings& p_settings, std::string& p_strErr)
+{
+	lv_settings = p_settings;
+	if (lv_settings.sampleEvery < 1) lv_settings.sampleEvery = 1;
+	lv_vRedact.clear();
+	Poco::StringTokenizer names(std::string(GD_CAPTURE_REDACT) + "," + lv_settings.redact, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	lv_vRedact.assign(names.begin(), names.end());
+	lv_file.open(lv_settings.path, std::ios::binary | std::ios::trunc);
+	if (!lv_file) {
+		p_strErr = "cannot write " + lv_settings.path;
+		return false;
+	}
+	uint64_t nStartUs = (uint64_t)duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+	lv_file.write(GD_CAPTURE_MAGIC, 8);
+	lv_file.write((const char*)&nStartUs, sizeof(nStartUs));
+	lv_tStart = steady_clock::now();
+
+	lv_bStop = false;
+	lv_writer = std::thread(writer_run);
+	lv_bEnabled = true;
+	std::cout << "Capture : one request in " << lv_settings.sampleEvery << (lv_settings.body ? " with bodies" : ", body hashes") << " to " << lv_settings.path << std::endl;
+	return true;
+}
+
+void mi_capture_shutdown()
+{
+	lv_bEnabled = false;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		if (!lv_writer.joinable()) return;
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	lv_writer.join();
+	lv_file.close();
+}
+
+unsigned long long mi_capture_records()
+{
+	return lv_nRecords.load(std::memory_order_relaxed);
+}
+
+unsigned long long mi_capture_dropped()
+{
+	return lv_nDropped.load(std::memory_order_relaxed);
+}
+
+//. one record; p_pBody NULL when the body is not at hand.
+static void record(const Poco::Net::HTTPServerRequest& p_request, steady_clock::time_point p_tArrival, const std::string* p_pBody)
+{
+	uint64_t nLen = p_pBody != NULL ? p_pBody->size() : (p_request.hasContentLength() ? (uint64_t)p_request.getContentLength64() : UINT64_MAX);
+	bool bBody = p_pBody != NULL && lv_settings.body && p_pBody->size() <= (size_t)lv_settings.maxBodyKb * 1024;
+	uint32_t nFlags = (p_pBody != NULL ? GD_CAPTURE_FLAG_HASH : 0) | (bBody ? GD_CAPTURE_FLAG_BODY : 0);
+
+	std::string rec;
+	rec.reserve(512 + (bBody ? p_pBody->size() : 0));
+	put(rec, (uint32_t)0);
+	put(rec, (uint64_t)std::max((int64_t)0, (int64_t)duration_cast<microseconds>(p_tArrival - lv_tStart).count()));
+	put(rec, nFlags);
+	put(rec, nLen);
+	put(rec, p_pBody != NULL ? mi_hash64(p_pBody->data(), p_pBody->size()) : (uint64_t)0);
+	put_text(rec, p_request.getMethod());
+	put_text(rec, p_request.getURI());
+	put(rec, (uint16_t)std::min(p_request.size(), (size_t)UINT16_MAX));
+	size_t nHeaders = 0;
+	for (Poco::Net::NameValueCollection::ConstIterator it = p_request.begin(); it != p_request.end() && nHeaders < UINT16_MAX; ++it, nHeaders++) {
+		put_text(rec, it->first);
+		put_text(rec, redacted(it->first) ? std::string() : it->second);
+	}
+	if (bBody) rec.append(*p_pBody);
+	uint32_t nSize = (uint32_t)(rec.size() - sizeof(uint32_t));
+	memcpy(&rec[0], &nSize, sizeof(nSize));
+
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		if (lv_nQueued + rec.size() > (size_t)lv_settings.queueMb * 1024 * 1024) {
+			lv_nDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		lv_nQueued += rec.size();
+		lv_queue.push_back(std::move(rec));
+	}
+	lv_cv.notify_one();
+}
+
+CaptureScope::CaptureScope(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response)
+	: m_request(p_request)
+{
+	if (!lv_bEnabled.load(std::memory_order_relaxed)) return;
+	const std::string& strMethod = p_request.getMethod();
+	if (strMethod != Poco::Net::HTTPRequest::HTTP_POST && strMethod != Poco::Net::HTTPRequest::HTTP_PUT) return;
+	if (lv_nSeen.fetch_add(1, std::memory_order_relaxed) % (unsigned long long)lv_settings.sampleEvery != 0) return;
+
+	steady_clock::time_point arrival = mi_admission_arrival();
+	if (arrival == steady_clock::time_point()) arrival = steady_clock::now();
+
+	ReactorServerRequest* pBuffered = dynamic_cast<ReactorServerRequest*>(&p_request);
+	if (pBuffered != NULL) {
+		record(p_request, arrival, &pBuffered->body());
+		return;
+	}
+	//. classic : the body is read here once and the routes read it back from memory.
+	if (!p_request.hasContentLength() || p_request.getContentLength64() > (Poco::Int64)lv_settings.maxBodyKb * 1024) {
+		record(p_request, arrival, NULL);
+		return;
+	}
+	m_pBuffered.reset(new ReactorServerRequest(p_response, p_request.clientAddress(), p_request.serverAddress(), p_request.serverParams()));
+	static_cast<Poco::Net::HTTPRequest&>(*m_pBuffered) = p_request;
+	std::string& body = m_pBuffered->body();
+	body.resize((size_t)p_request.getContentLength64());
+	p_request.stream().read(&body[0], (std::streamsize)body.size());
+	body.resize((size_t)p_request.stream().gcount());
+	m_pBuffered->set_socket(mi_request_socket(p_request));
+	m_pBuffered->open_body();
+	record(p_request, arrival, &body);
+}
+
+CaptureScope::~CaptureScope()
+{
+}
+
+Poco::Net::HTTPServerRequest& CaptureScope::request()
+{
+	if (m_pBuffered) return *m_pBuffered;
+	return m_request;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+class ReactorServerRequest;
+
+//. Request capture ([capture] settings) for reproducing a latency incident offline : one
+//. POST / PUT request in sample_every is recorded with its arrival time, method, URI,
+//. headers, body length and XXH64 of the body (MiHash.h), with body = true the body
+//. itself up to max_body_kb. CorpusReplay capture <file> sends the records again with
+//. the recorded gaps between arrivals.
+//. The request thread serializes the record into a bounded queue (queue_mb) and a writer
+//. thread appends it to the file; a full queue drops the record (mi_capture_dropped_total).
+//. Writing stops once the file holds max_mb. Arrival is when the header was received
+//. (reactor / HTTP/2), else when a request thread took the connection.
+//. Bodies are read where they are buffered : reactor and HTTP/2 requests always; in classic
+//. mode a sampled request with a Content-Length up to max_body_kb is read into memory
+//. first and served from there, a larger or chunked one is recorded without its hash.
+//. The values of the GD_CAPTURE_REDACT headers (the API and admin keys, Authorization, Cookie)
+//. and of the ones in redact are recorded empty.
+//.
+//. File : GD_CAPTURE_MAGIC | u64 start (unix us) | records, little endian. Record :
+//.   u32 size of the rest | u64 arrival (us since start) | u32 flags (GD_CAPTURE_FLAG_*) |
+//.   u64 body length (UINT64_MAX = unknown) | u64 XXH64 of the body |
+//.   u16 + method | u16 + uri | u16 header count | { u16 + name, u16 + value } | body
+
+struct CaptureSettings {
+	std::string	path;
+	int			sampleEvery;	//. 1 = every request
+	bool		body;			//. record bodies, not only their hash
+	int			maxBodyKb;
+	int			maxMb;			//. file size at which recording stops
+	int			queueMb;		//. records waiting for the writer
+	std::string	redact;			//. header names besides GD_CAPTURE_REDACT, "name, name, ..."
+};
+
+bool mi_capture_init(const CaptureSettings& p_settings, std::string& p_strErr);
+//. writes what is queued and closes the file.
+void mi_capture_shutdown();
+
+unsigned long long mi_capture_records();
+unsigned long long mi_capture_dropped();
+
+//. around the handling of one request (MyRequestHandler::handleRequest) : records it
+//. when it is sampled. request() is what the routes read, the buffered copy when a
+//. classic request had its body read for the record.
+class CaptureScope {
+public:
+	CaptureScope(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response);
+	~CaptureScope();
+
+	Poco::Net::HTTPServerRequest& request();
+
+private:
+	CaptureScope(const CaptureScope&) = delete;
+	CaptureScope& operator=(const CaptureScope&) = delete;
+
+	Poco::Net::HTTPServerRequest&			m_request;
+	std::unique_ptr<ReactorServerRequest>	m_pBuffered;
+};
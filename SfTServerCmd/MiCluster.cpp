@@ -0,0 +1,155 @@
+#include "MiCluster.h"
+#include "MiAdmission.h"
+#include "MiConf.h"
+#include "MiLimiter.h"
+#include "MiMetrics.h"
+#include "MiRedis.h"
+#include "MiSettings.h"
+#include "MiWarmup.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/DNS.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Redis/Command.h"
+#include "Poco/StringTokenizer.h"
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static ClusterSettings							lv_settings;
+static bool										lv_bRedis = false;
+static std::vector<Poco::Net::SocketAddress>	lv_vPeers;
+static Poco::Net::DatagramSocket				lv_socket;
+static std::mutex								lv_mtx;
+static std::condition_variable					lv_cv;
+static bool										lv_bStop = false;
+static std::thread								lv_thread;
+static std::atomic<unsigned long long>			lv_nSeq(0);
+static std::atomic<unsigned long long>			lv_nErrors(0);
+
+std::string mi_cluster_line()
+{
+	int slots = lv_settings.slots > 0 ? lv_settings.slots : 1;
+	int free = slots - mi_admission_inflight();
+	if (free < 0) free = 0;
+	int queue = mi_metrics_http_queued() + mi_limiter_waiting();
+
+	char sz[128];
+	snprintf(sz, sizeof(sz), " slots=%d free=%d queue=%d device=", slots, free, queue);
+	std::string line = "mi-node node=" + lv_settings.node + sz + lv_settings.device + " engine=" + lv_settings.engine;
+	line += mi_ready() ? " ready=1" : " ready=0";
+	line += " seq=" + std::to_string(lv_nSeq.fetch_add(1, std::memory_order_relaxed) + 1);
+	return line;
+}
+
+unsigned long long mi_cluster_errors()
+{
+	return lv_nErrors.load(std::memory_order_relaxed);
+}
+
+static bool redis_command(const Poco::Redis::Array& p_command)
+{
+	RedisConn conn;
+	if (!conn.valid()) return false;
+	try {
+		std::vector<Poco::Redis::Array> cmds(1, p_command);
+		conn.pipeline(cmds);
+		return true;
+	}
+	catch (Poco::Exception&) {
+		return false;
+	}
+}
+
+static void announce()
+{
+	std::string line = mi_cluster_line();
+	bool bOk = true;
+	if (lv_bRedis) {
+		bOk = redis_command(Poco::Redis::Command::hset(mi_redis_key(GD_CLUSTER_REDIS_KIND, ""), lv_settings.node, line));
+	}
+	else {
+		for (const Poco::Net::SocketAddress& peer : lv_vPeers) {
+			try {
+				lv_socket.sendTo(line.data(), (int)line.size(), peer);
+			}
+			catch (Poco::Exception&) {
+				bOk = false;
+			}
+		}
+	}
+	if (!bOk) lv_nErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void announce_run()
+{
+	std::unique_lock<std::mutex> lock(lv_mtx);
+	while (!lv_bStop) {
+		lock.unlock();
+		announce();
+		lock.lock();
+		lv_cv.wait_for(lock, std::chrono::milliseconds(lv_settings.intervalMs), [] { return lv_bStop; });
+	}
+}
+
+bool mi_cluster_start(const ClusterSettings& p_settings, std::string& p_strErr)
+{
+	lv_settings = p_settings;
+	if (lv_settings.intervalMs < GD_CLUSTER_MIN_INTERVAL_MS) lv_settings.intervalMs = GD_CLUSTER_MIN_INTERVAL_MS;
+	if (lv_settings.node.empty()) {
+		try {
+			lv_settings.node = Poco::Net::DNS::hostName();
+		}
+		catch (Poco::Exception&) {
+			lv_settings.node = "localhost";
+		}
+		lv_settings.node += ":" + std::to_string(g_Settings.port);
+	}
+
+	if (lv_settings.transport == "redis") {
+		if (!mi_redis_enabled()) {
+			p_strErr = "transport redis needs [redis] enable";
+			return false;
+		}
+		lv_bRedis = true;
+	}
+	else if (lv_settings.transport == "udp") {
+		Poco::StringTokenizer tok(lv_settings.peers, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+		try {
+			for (const std::string& peer : tok) lv_vPeers.push_back(Poco::Net::SocketAddress(peer));
+		}
+		catch (Poco::Exception& ex) {
+			p_strErr = "peer " + ex.displayText();
+			lv_vPeers.clear();
+			return false;
+		}
+		if (lv_vPeers.empty()) {
+			p_strErr = "transport udp needs peers";
+			return false;
+		}
+	}
+	else {
+		p_strErr = "unknown transport " + lv_settings.transport;
+		return false;
+	}
+
+	lv_bStop = false;
+	lv_thread = std::thread(announce_run);
+	std::cout << "Cluster : announcing " << lv_settings.node << " over " << lv_settings.transport << " every " << lv_settings.intervalMs << " ms" << std::endl;
+	return true;
+}
+
+void mi_cluster_stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		if (!lv_thread.joinable()) return;
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	lv_thread.join();
+	//. the proxy stops routing here at once instead of when the entry goes stale.
+	if (lv_bRedis) redis_command(Poco::Redis::Command::hdel(mi_redis_key(GD_CLUSTER_REDIS_KIND, ""), lv_settings.node));
+}
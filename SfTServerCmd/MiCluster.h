@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+//. Cluster membership ([cluster]) : every announce interval_ms this node publishes its
+//. spare capacity for the proxy (mi_id_svc, MI_PROXY_REGISTRY), which routes by it instead
+//. of by its own count of requests in flight. One text line per node :
+//.   mi-node node=<host:port> slots=<n> free=<n> queue=<n> device=<cpu|gpu> engine=<name> ready=<0|1> seq=<n>
+//. - slots : inference requests this node runs at once (admission concurrency);
+//.   free : slots minus the inference requests in flight; queue : connections waiting for
+//.   a worker plus pipeline calls waiting for a limiter permit.
+//. - seq grows with every announcement : a reader takes a line whose seq did not move
+//.   as stale, so no clocks are compared between hosts.
+//. Transports :
+//. - "redis" : HSET <redis.prefix>cluster <node> <line> through the [redis] pool, HDEL at
+//.   shutdown. Needs [redis] enable.
+//. - "udp"   : one datagram with the line to every peers host:port (the proxies' registry
+//.   ports), fire and forget.
+//. node is the address the proxy reaches this node at, empty = host name : server.port.
+
+struct ClusterSettings {
+	std::string		transport;		//. "redis" / "udp"
+	std::string		node;
+	std::string		peers;			//. udp : "host:port,host:port"
+	int				intervalMs;
+	int				slots;
+	std::string		device;
+	std::string		engine;
+};
+
+//. false and p_strErr when the transport is unknown or a peer does not resolve.
+bool mi_cluster_start(const ClusterSettings& p_settings, std::string& p_strErr);
+void mi_cluster_stop();
+
+//. the line announced now.
+std::string mi_cluster_line();
+//. announcements that could not be sent, for GD_API_METRICS.
+unsigned long long mi_cluster_errors();
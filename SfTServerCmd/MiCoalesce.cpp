@@ -0,0 +1,97 @@
+#include "MiCoalesce.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "MiLock.h"
+#include <string.h>
+#include <unordered_map>
+
+struct Flight {
+	MI_MUTEX(mtx, "coalesce.flight");
+	MiCondition					cv;
+	bool						done;
+	bool						ok;			//. false = the leader gave up
+	int							tenant;		//. of the leader, -1 = none
+	CPipelineResult_t			result;
+	int							err;
+	char						msg[MESSAGE_BUFFER_SIZE];
+	Flight() : done(false), ok(false), tenant(-1), err(OK) { memset(&result, 0, sizeof(result)); msg[0] = 0; }
+};
+
+static bool																lv_bEnabled = false;
+static MI_MUTEX(lv_mtx, "coalesce");
+static std::unordered_map<ResultKey, std::shared_ptr<Flight>, ResultKeyHash>	lv_flights;
+
+void mi_coalesce_init(bool p_bEnable)
+{
+	lv_bEnabled = p_bEnable;
+}
+
+bool mi_coalesce_enabled()
+{
+	return lv_bEnabled;
+}
+
+FlightTicket::~FlightTicket()
+{
+	if (leader()) finish(NULL, OK, NULL);
+}
+
+void FlightTicket::join(const ResultKey& p_key)
+{
+	m_key = p_key;
+	MiLockGuard lock(lv_mtx);
+	auto it = lv_flights.find(p_key);
+	if (it != lv_flights.end()) {
+		m_pFlight = it->second;
+		m_bLeader = false;
+		return;
+	}
+	m_pFlight = std::make_shared<Flight>();
+	RequestContext* ctx = mi_context();
+	m_pFlight->tenant = ctx != NULL ? ctx->tenant : -1;
+	m_bLeader = true;
+	lv_flights.emplace(p_key, m_pFlight);
+}
+
+bool FlightTicket::wait(CPipelineResult_t* p_pResult, int* p_pErr, char* p_pszMsg)
+{
+	if (!follower()) return false;
+	RequestContext* ctx = mi_context();
+	std::chrono::steady_clock::time_point limit = mi_context_hold_limit();
+	MiUniqueLock lock(m_pFlight->mtx);
+	if (limit == std::chrono::steady_clock::time_point()) m_pFlight->cv.wait(lock, [this] { return m_pFlight->done; });
+	else if (!m_pFlight->cv.wait_until(lock, limit, [this] { return m_pFlight->done; })) return false;
+	if (!m_pFlight->ok) return false;
+	if (m_pFlight->err != OK && m_pFlight->tenant != (ctx != NULL ? ctx->tenant : -1)) return false;
+	*p_pResult = m_pFlight->result;
+	*p_pErr = m_pFlight->err;
+	memcpy(p_pszMsg, m_pFlight->msg, MESSAGE_BUFFER_SIZE);
+	mi_metrics_coalesced();
+	return true;
+}
+
+void FlightTicket::publish(const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg)
+{
+	if (leader()) finish(&p_result, p_nErr, p_pszMsg);
+}
+
+void FlightTicket::finish(const CPipelineResult_t* p_pResult, int p_nErr, const char* p_pszMsg)
+{
+	//. later arrivals start a new flight from here on.
+	{
+		MiLockGuard lock(lv_mtx);
+		lv_flights.erase(m_key);
+	}
+	{
+		MiLockGuard lock(m_pFlight->mtx);
+		if (p_pResult != NULL) {
+			m_pFlight->ok = true;
+			m_pFlight->result = *p_pResult;
+			m_pFlight->err = p_nErr;
+			memcpy(m_pFlight->msg, p_pszMsg, MESSAGE_BUFFER_SIZE);
+		}
+		m_pFlight->done = true;
+	}
+	m_pFlight->cv.notify_all();
+	m_pFlight.reset();
+}
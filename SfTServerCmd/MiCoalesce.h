@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include "FaceSdkApi.h"
+#include "MiResultCache.h"
+
+//. Single-flight checks ([cache] coalesce) : identical uploads that arrive while the first
+//. of them is still in the pipeline (client retries, double submits) wait for its outcome
+//. instead of running the SDK again. The key is the ResultKey of the result cache (content
+//. digest, size, calibration), so only uploads the cache would have answered are merged;
+//. unlike the cache, errors are shared too, but only with followers of the leader's tenant :
+//. another tenant's request checks itself rather than take a failure of someone else's.
+//. A leader that fails without an outcome (exception) lets its followers check themselves,
+//. and a follower stops waiting at its request's hold limit (deadline less the degrade
+//. margin, mi_context_hold_limit) to check itself instead of blocking behind a stuck leader.
+
+void mi_coalesce_init(bool p_bEnable);
+bool mi_coalesce_enabled();
+
+struct Flight;
+
+//. one request's part in a flight; inactive until join.
+class FlightTicket {
+public:
+	FlightTicket() : m_bLeader(false) {}
+	~FlightTicket();
+
+	//. leader of p_key, or follower when a check of the same key is running.
+	void join(const ResultKey& p_key);
+	bool leader() const { return m_pFlight != NULL && m_bLeader; }
+	bool follower() const { return m_pFlight != NULL && !m_bLeader; }
+
+	//. follower : the leader's outcome, false when it ended without one, failed for another
+	//. tenant, or did not end before the request's hold limit.
+	bool wait(CPipelineResult_t* p_pResult, int* p_pErr, char* p_pszMsg);
+	//. leader : hands the outcome to the followers and ends the flight.
+	void publish(const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg);
+
+private:
+	FlightTicket(const FlightTicket&) = delete;
+	FlightTicket& operator=(const FlightTicket&) = delete;
+
+	void finish(const CPipelineResult_t* p_pResult, int p_nErr, const char* p_pszMsg);
+
+	std::shared_ptr<Flight>	m_pFlight;
+	ResultKey				m_key;
+	bool					m_bLeader;
+};
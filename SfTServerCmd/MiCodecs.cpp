@@ -0,0 +1,176 @@
+#include "MiCodecs.h"
+#include "MiColor.h"
+#include "MiConf.h"
+#include "MiImageInfo.h"
+#include "MiOrient.h"
+#include "MiPlatform.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#if MI_HAS_WIC
+#include "MiWic.h"
+#endif
+#if MI_HAS_LIBWEBP
+#include <webp/decode.h>
+#endif
+#if MI_HAS_LIBHEIF
+#include <libheif/heif.h>
+#endif
+#include <iostream>
+
+static const char*	lv_szNames[MI_CODEC_COUNT] = { "webp", "heif", "avif" };
+static bool			lv_bOn[MI_CODEC_COUNT] = { false, false, false };		//. enabled and a decoder found
+
+const char* mi_codec_name(int p_nFormat)
+{
+	return p_nFormat >= 0 && p_nFormat < MI_CODEC_COUNT ? lv_szNames[p_nFormat] : "unknown";
+}
+
+#if MI_HAS_WIC
+//. whether this host has a WIC decoder for p_container (the Store extensions for HEIF).
+static bool wic_has(const GUID& p_container)
+{
+	IWICImagingFactory* factory = mi_wic_factory();
+	ComRef<IWICBitmapDecoder> decoder;
+	return factory != NULL && SUCCEEDED(factory->CreateDecoder(p_container, NULL, &decoder.p));
+}
+
+static bool wic_decode(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out)
+{
+	ComRef<IWICStream> stream;
+	ComRef<IWICBitmapDecoder> decoder;
+	ComRef<IWICBitmapFrameDecode> frame;
+	if (!mi_wic_open(p_pData, p_nLen, stream, decoder, frame)) return false;
+	UINT w = 0, h = 0;
+	std::string strWhy;
+	if (FAILED(frame->GetSize(&w, &h)) || w == 0 || h == 0 || (uint64_t)w * h * 3 > 0xFFFFFFFFu || !mi_image_size_allowed((int)w, (int)h, strWhy)) return false;
+	//. the codecs hand out YUV or BGRA : one conversion pass to packed BGR.
+	ComRef<IWICFormatConverter> converter;
+	if (FAILED(mi_wic_factory()->CreateFormatConverter(&converter.p))) return false;
+	if (FAILED(converter->Initialize(frame.p, GUID_WICPixelFormat24bppBGR, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom))) return false;
+	p_out.pixels.resize((size_t)w * h * 3);
+	if (FAILED(converter->CopyPixels(NULL, w * 3, (UINT)(w * h * 3), p_out.pixels.data()))) return false;
+	p_out.width = (int)w;
+	p_out.height = (int)h;
+	p_out.orientation = mi_wic_orientation(frame.p);
+	return true;
+}
+#endif
+
+#if MI_HAS_LIBWEBP
+static bool webp_decode(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out)
+{
+	int w = 0, h = 0;
+	std::string strWhy;
+	if (!WebPGetInfo(p_pData, p_nLen, &w, &h) || w <= 0 || h <= 0 || !mi_image_size_allowed(w, h, strWhy)) return false;
+	p_out.pixels.resize((size_t)w * h * 3);
+	if (WebPDecodeBGRInto(p_pData, p_nLen, p_out.pixels.data(), p_out.pixels.size(), w * 3) == NULL) return false;
+	p_out.width = w;
+	p_out.height = h;
+	return true;
+}
+#endif
+
+#if MI_HAS_LIBHEIF
+//. the primary image, irot / imir applied by libheif; RGB rows swapped to BGR (MiColor.h).
+static bool heif_decode(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out)
+{
+	heif_context* ctx = heif_context_alloc();
+	heif_image_handle* handle = NULL;
+	heif_image* image = NULL;
+	bool bOk = false;
+	std::string strWhy;
+	if (heif_context_read_from_memory_without_copy(ctx, p_pData, p_nLen, NULL).code == heif_error_Ok
+		&& heif_context_get_primary_image_handle(ctx, &handle).code == heif_error_Ok
+		&& mi_image_size_allowed(heif_image_handle_get_width(handle), heif_image_handle_get_height(handle), strWhy)
+		&& heif_decode_image(handle, &image, heif_colorspace_RGB, heif_chroma_interleaved_RGB, NULL).code == heif_error_Ok) {
+		int stride = 0;
+		const uint8_t* px = heif_image_get_plane_readonly(image, heif_channel_interleaved, &stride);
+		int w = heif_image_get_width(image, heif_channel_interleaved), h = heif_image_get_height(image, heif_channel_interleaved);
+		if (px != NULL && w > 0 && h > 0) {
+			p_out.pixels.resize((size_t)w * h * 3);
+			for (int y = 0; y < h; y++) mi_color_swap_rb(px + (size_t)y * stride, p_out.pixels.data() + (size_t)y * w * 3, (size_t)w);
+			p_out.width = w;
+			p_out.height = h;
+			bOk = true;
+		}
+	}
+	if (image != NULL) heif_image_release(image);
+	if (handle != NULL) heif_image_handle_release(handle);
+	heif_context_free(ctx);
+	return bOk;
+}
+#endif
+
+//. a decoder for p_nFormat in this build and on this host.
+static bool has_decoder(int p_nFormat)
+{
+#if MI_HAS_WIC
+	return wic_has(p_nFormat == MI_CODEC_WEBP ? GUID_ContainerFormatWebp : GUID_ContainerFormatHeif);
+#else
+	if (p_nFormat == MI_CODEC_WEBP) return MI_HAS_LIBWEBP != 0;
+	return MI_HAS_LIBHEIF != 0;
+#endif
+}
+
+void mi_codecs_init(const std::string& p_strFormats)
+{
+#if MI_HAS_LIBHEIF
+	heif_init(NULL);
+#endif
+	Poco::StringTokenizer items(p_strFormats, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : items) {
+		std::string strName = Poco::toLower(item);
+		int f = 0;
+		while (f < MI_CODEC_COUNT && strName != lv_szNames[f]) f++;
+		if (f == MI_CODEC_COUNT) {
+			std::cout << "Decode : unknown format " << item << std::endl;
+			continue;
+		}
+		lv_bOn[f] = has_decoder(f);
+		if (!lv_bOn[f]) std::cout << "Decode : no " << strName << " decoder on this host, left to the SDK" << std::endl;
+	}
+}
+
+int mi_codec_of(const uint8_t* p_pData, size_t p_nLen)
+{
+	int f = -1;
+	switch (mi_image_format(p_pData, p_nLen)) {
+	case MI_IMAGE_WEBP: f = MI_CODEC_WEBP; break;
+	case MI_IMAGE_HEIF: f = MI_CODEC_HEIF; break;
+	case MI_IMAGE_AVIF: f = MI_CODEC_AVIF; break;
+	default: return -1;
+	}
+	return lv_bOn[f] ? f : -1;
+}
+
+bool mi_codec_decode(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out)
+{
+	int f = mi_codec_of(p_pData, p_nLen);
+	if (f < 0) return false;
+	bool bOk = false;
+	p_out.scale = 1;
+	p_out.orientation = 1;
+#if MI_HAS_WIC
+	bOk = wic_decode(p_pData, p_nLen, p_out);
+#else
+#if MI_HAS_LIBWEBP
+	if (f == MI_CODEC_WEBP) bOk = webp_decode(p_pData, p_nLen, p_out);
+#endif
+#if MI_HAS_LIBHEIF
+	if (f != MI_CODEC_WEBP) bOk = heif_decode(p_pData, p_nLen, p_out);
+#endif
+#endif
+	//. WIC leaves the EXIF orientation to the reader, as for JPEG (MiDecode.h).
+	if (bOk && p_out.orientation != 1) {
+		int ow = 0, oh = 0;
+		mi_orient_size(p_out.orientation, p_out.width, p_out.height, ow, oh);
+		PixelBuffer upright((size_t)ow * oh * 3);
+		bOk = mi_orient_bgr(p_out.pixels.data(), p_out.width, p_out.height, (size_t)p_out.width * 3, p_out.orientation, upright.data(), (size_t)ow * 3);
+		if (bOk) {
+			p_out.pixels.swap(upright);
+			p_out.width = ow;
+			p_out.height = oh;
+		}
+	}
+	return bOk;
+}
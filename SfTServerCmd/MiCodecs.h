@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "MiDecode.h"
+
+//. Upload formats the SDK does not read, decoded here into BGR pixels that the backends
+//. hand to image_create_pixels / idliveface::Image ([decode] formats) : WebP (Android, about
+//. 30 % smaller than the JPEG of the same frame), HEIC (the iPhone camera's own format, no
+//. JPEG conversion on the device) and AVIF.
+//. Windows : WIC with the system codecs, which decode on their own SIMD / GPU paths - WebP
+//. is built in since 1809, HEIC needs the HEIF and HEVC Video Extensions, AVIF the AV1 Video
+//. Extension (through the same HEIF decoder). Linux : libwebp (CMake MI_WEBP) and libheif
+//. (MI_HEIF, on libde265 / dav1d) when the build has them.
+//. A format without a decoder, or an upload it fails on, goes to the SDK as before, which
+//. refuses it. The frame comes out upright (EXIF orientation, HEIF irot / imir).
+//. mi_decode_formats_total{format,result} on GD_API_METRICS; the decode is part of the
+//. image_create stage. SdkBench times the decode against JPEG on the corpus files.
+
+enum CodecFormat {
+	MI_CODEC_WEBP = 0,
+	MI_CODEC_HEIF,
+	MI_CODEC_AVIF,
+	MI_CODEC_COUNT
+};
+
+const char* mi_codec_name(int p_nFormat);
+
+//. p_strFormats : "webp,heif,avif" ([decode] formats), empty = none. Prints the formats
+//. enabled without a decoder in this build / on this host.
+void mi_codecs_init(const std::string& p_strFormats);
+
+//. the CodecFormat of p_pData when it is enabled and has a decoder, -1 otherwise.
+int mi_codec_of(const uint8_t* p_pData, size_t p_nLen);
+
+//. false when p_pData is not such an upload or its decode failed. p_out.orientation : the
+//. EXIF orientation the pixels were turned from. Counts nothing : the server goes through
+//. mi_image_codec_decode (MiImage.h), SdkBench calls it directly.
+bool mi_codec_decode(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out);
@@ -0,0 +1,273 @@
+#include "MiColor.h"
+#include "MiCpu.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_COLOR_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define LD_TARGET_SSSE3
+#define LD_TARGET_AVX2
+#else
+#define LD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define LD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define LD_COLOR_X86 0
+#endif
+
+//. BT.601 limited range in 1.6 fixed point : 1.164 (Y - 16) + 1.596 V', 0.392 U' + 0.813 V', 2.017 U'.
+//. 1.164 * 64 = 74.5 is taken as 74 y + y / 2, so white (235) reaches 255.
+#define LD_CY	74
+#define LD_CRV	102
+#define LD_CGU	25
+#define LD_CGV	52
+#define LD_CBU	129
+
+static MiColorIsa lv_nIsa = MI_COLOR_SCALAR;
+
+static inline uint8_t clamp8(int p_nValue)
+{
+	return (uint8_t)(p_nValue < 0 ? 0 : p_nValue > 255 ? 255 : p_nValue);
+}
+
+//. p_nUVStep : 2 for NV12 (p_pV = p_pU + 1), 1 for I420.
+static void yuv_row_scalar(const uint8_t* p_pY, const uint8_t* p_pU, const uint8_t* p_pV, int p_nUVStep, uint8_t* p_pDst, int p_nFrom, int p_nWidth, bool p_bRgb)
+{
+	for (int x = p_nFrom; x < p_nWidth; x++) {
+		int y = p_pY[x] - 16;
+		int c = y * LD_CY + (y >> 1) + 32;
+		int d = p_pU[(x >> 1) * p_nUVStep] - 128;
+		int e = p_pV[(x >> 1) * p_nUVStep] - 128;
+		uint8_t b = clamp8((c + LD_CBU * d) >> 6);
+		uint8_t g = clamp8((c - LD_CGU * d - LD_CGV * e) >> 6);
+		uint8_t r = clamp8((c + LD_CRV * e) >> 6);
+		uint8_t* out = p_pDst + (size_t)x * 3;
+		out[0] = p_bRgb ? r : b;
+		out[1] = g;
+		out[2] = p_bRgb ? b : r;
+	}
+}
+
+static void yuv_row_plain(const uint8_t* p_pY, const uint8_t* p_pU, const uint8_t* p_pV, int p_nUVStep, uint8_t* p_pDst, int p_nWidth, bool p_bRgb)
+{
+	yuv_row_scalar(p_pY, p_pU, p_pV, p_nUVStep, p_pDst, 0, p_nWidth, p_bRgb);
+}
+
+//. pixels done by the vector part, the caller finishes the row.
+static size_t swap_rb_none(const uint8_t*, uint8_t*, size_t)
+{
+	return 0;
+}
+
+//. bound by bind_color (MiCpu.h).
+typedef void (*YuvRowFn)(const uint8_t* p_pY, const uint8_t* p_pU, const uint8_t* p_pV, int p_nUVStep, uint8_t* p_pDst, int p_nWidth, bool p_bRgb);
+typedef size_t (*SwapRbFn)(const uint8_t* p_pSrc, uint8_t* p_pDst, size_t p_nPixels);
+static YuvRowFn lv_fnYuvRow = yuv_row_plain;
+static SwapRbFn lv_fnSwapRb = swap_rb_none;
+
+#if LD_COLOR_X86
+
+//. 8 pixels of p_fst (low 8 bytes : first channel, high 8 : G) and p_lst (low 8 : last
+//. channel) into 24 packed bytes.
+LD_TARGET_SSSE3 static inline void store_packed8(__m128i p_fst, __m128i p_lst, uint8_t* p_pDst)
+{
+	const __m128i m0a = _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5);
+	const __m128i m0b = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+	const __m128i m1a = _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i m1b = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+	_mm_storeu_si128((__m128i*)p_pDst, _mm_or_si128(_mm_shuffle_epi8(p_fst, m0a), _mm_shuffle_epi8(p_lst, m0b)));
+	_mm_storel_epi64((__m128i*)(p_pDst + 16), _mm_or_si128(_mm_shuffle_epi8(p_fst, m1a), _mm_shuffle_epi8(p_lst, m1b)));
+}
+
+//. 8 chroma bytes of pixels x .. x + 7 as NV12 order (u0 v0 u1 v1 ...).
+LD_TARGET_SSSE3 static inline __m128i load_uv4(const uint8_t* p_pU, const uint8_t* p_pV, int p_nUVStep, int p_nX)
+{
+	if (p_nUVStep == 2) return _mm_loadl_epi64((const __m128i*)(p_pU + p_nX));
+	int u, v;
+	memcpy(&u, p_pU + p_nX / 2, 4);
+	memcpy(&v, p_pV + p_nX / 2, 4);
+	return _mm_unpacklo_epi8(_mm_cvtsi32_si128(u), _mm_cvtsi32_si128(v));
+}
+
+LD_TARGET_SSSE3 static void yuv_row_ssse3(const uint8_t* p_pY, const uint8_t* p_pU, const uint8_t* p_pV, int p_nUVStep, uint8_t* p_pDst, int p_nWidth, bool p_bRgb)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i y16 = _mm_set1_epi16(16), c128 = _mm_set1_epi16(128), round = _mm_set1_epi16(32);
+	const __m128i cy = _mm_set1_epi16(LD_CY), crv = _mm_set1_epi16(LD_CRV), cgu = _mm_set1_epi16(LD_CGU), cgv = _mm_set1_epi16(LD_CGV), cbu = _mm_set1_epi16(LD_CBU);
+	const __m128i dupU = _mm_setr_epi8(0, -1, 0, -1, 2, -1, 2, -1, 4, -1, 4, -1, 6, -1, 6, -1);
+	const __m128i dupV = _mm_setr_epi8(1, -1, 1, -1, 3, -1, 3, -1, 5, -1, 5, -1, 7, -1, 7, -1);
+	int x = 0;
+	for (; x + 8 <= p_nWidth; x += 8) {
+		__m128i y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p_pY + x)), zero);
+		__m128i uv = load_uv4(p_pU, p_pV, p_nUVStep, x);
+		__m128i d = _mm_sub_epi16(_mm_shuffle_epi8(uv, dupU), c128);
+		__m128i e = _mm_sub_epi16(_mm_shuffle_epi8(uv, dupV), c128);
+		y = _mm_sub_epi16(y, y16);
+		__m128i c = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(y, cy), _mm_srai_epi16(y, 1)), round);
+		//. saturation only clips values that end above 255 anyway.
+		__m128i b = _mm_srai_epi16(_mm_adds_epi16(c, _mm_mullo_epi16(d, cbu)), 6);
+		__m128i g = _mm_srai_epi16(_mm_subs_epi16(c, _mm_add_epi16(_mm_mullo_epi16(d, cgu), _mm_mullo_epi16(e, cgv))), 6);
+		__m128i r = _mm_srai_epi16(_mm_adds_epi16(c, _mm_mullo_epi16(e, crv)), 6);
+		if (p_bRgb) store_packed8(_mm_packus_epi16(r, g), _mm_packus_epi16(b, b), p_pDst + (size_t)x * 3);
+		else store_packed8(_mm_packus_epi16(b, g), _mm_packus_epi16(r, r), p_pDst + (size_t)x * 3);
+	}
+	yuv_row_scalar(p_pY, p_pU, p_pV, p_nUVStep, p_pDst, x, p_nWidth, p_bRgb);
+}
+
+LD_TARGET_AVX2 static void yuv_row_avx2(const uint8_t* p_pY, const uint8_t* p_pU, const uint8_t* p_pV, int p_nUVStep, uint8_t* p_pDst, int p_nWidth, bool p_bRgb)
+{
+	const __m256i y16 = _mm256_set1_epi16(16), c128 = _mm256_set1_epi16(128), round = _mm256_set1_epi16(32);
+	const __m256i cy = _mm256_set1_epi16(LD_CY), crv = _mm256_set1_epi16(LD_CRV), cgu = _mm256_set1_epi16(LD_CGU), cgv = _mm256_set1_epi16(LD_CGV), cbu = _mm256_set1_epi16(LD_CBU);
+	const __m128i dupU = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+	const __m128i dupV = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+	int x = 0;
+	for (; x + 16 <= p_nWidth; x += 16) {
+		__m256i y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p_pY + x)));
+		__m128i uv = p_nUVStep == 2 ? _mm_loadu_si128((const __m128i*)(p_pU + x))
+			: _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p_pU + x / 2)), _mm_loadl_epi64((const __m128i*)(p_pV + x / 2)));
+		__m256i d = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(uv, dupU)), c128);
+		__m256i e = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(uv, dupV)), c128);
+		y = _mm256_sub_epi16(y, y16);
+		__m256i c = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(y, cy), _mm256_srai_epi16(y, 1)), round);
+		__m256i b = _mm256_srai_epi16(_mm256_adds_epi16(c, _mm256_mullo_epi16(d, cbu)), 6);
+		__m256i g = _mm256_srai_epi16(_mm256_subs_epi16(c, _mm256_add_epi16(_mm256_mullo_epi16(d, cgu), _mm256_mullo_epi16(e, cgv))), 6);
+		__m256i r = _mm256_srai_epi16(_mm256_adds_epi16(c, _mm256_mullo_epi16(e, crv)), 6);
+		//. packus works per 128-bit lane : lane 0 holds pixels 0..7, lane 1 pixels 8..15.
+		__m256i fst = p_bRgb ? _mm256_packus_epi16(r, g) : _mm256_packus_epi16(b, g);
+		__m256i lst = p_bRgb ? _mm256_packus_epi16(b, b) : _mm256_packus_epi16(r, r);
+		uint8_t* out = p_pDst + (size_t)x * 3;
+		store_packed8(_mm256_castsi256_si128(fst), _mm256_castsi256_si128(lst), out);
+		store_packed8(_mm256_extracti128_si256(fst, 1), _mm256_extracti128_si256(lst, 1), out + 24);
+	}
+	yuv_row_ssse3(p_pY + x, p_nUVStep == 2 ? p_pU + x : p_pU + x / 2, p_nUVStep == 2 ? p_pV + x : p_pV + x / 2, p_nUVStep, p_pDst + (size_t)x * 3, p_nWidth - x, p_bRgb);
+}
+
+//. 4 pixels per 16-byte step; the last 4 bytes go back unchanged, so in place is safe.
+LD_TARGET_SSSE3 static size_t swap_rb_ssse3(const uint8_t* p_pSrc, uint8_t* p_pDst, size_t p_nPixels)
+{
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+	size_t nBytes = p_nPixels * 3, i = 0;
+	for (; i + 16 <= nBytes; i += 12) {
+		_mm_storeu_si128((__m128i*)(p_pDst + i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p_pSrc + i)), mask));
+	}
+	return i / 3;
+}
+
+#endif
+
+static void bind_color(int p_nVariant)
+{
+	lv_nIsa = (MiColorIsa)p_nVariant;
+	lv_fnYuvRow = yuv_row_plain;
+	lv_fnSwapRb = swap_rb_none;
+#if LD_COLOR_X86
+	if (p_nVariant == MI_COLOR_AVX2) lv_fnYuvRow = yuv_row_avx2;
+	else if (p_nVariant == MI_COLOR_SSSE3) lv_fnYuvRow = yuv_row_ssse3;
+	//. memory bound : the 16-byte kernel already saturates it, AVX2 adds nothing here.
+	if (p_nVariant >= MI_COLOR_SSSE3) lv_fnSwapRb = swap_rb_ssse3;
+#endif
+}
+
+static const char* const lv_szVariants[] = { "scalar", "ssse3", "avx2" };
+static const uint32_t lv_nNeeds[] = { 0, MI_CPU_SSSE3, MI_CPU_SSSE3 | MI_CPU_AVX2 };
+static MiCpuKernel lv_kernel = { "color", LD_COLOR_X86 ? 3 : 1, lv_szVariants, lv_nNeeds, bind_color, 0, 0 };
+static const bool lv_bRegistered = mi_cpu_register(&lv_kernel);
+
+static void yuv_rows(const uint8_t* p_pY, size_t p_nYStride, const uint8_t* p_pU, const uint8_t* p_pV, size_t p_nUVStride, int p_nUVStep,
+	int p_nWidth, int p_nHeight, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding)
+{
+	bool bRgb = p_encoding == RGB888;
+	for (int row = 0; row < p_nHeight; row++) {
+		const uint8_t* y = p_pY + (size_t)row * p_nYStride;
+		const uint8_t* u = p_pU + (size_t)(row >> 1) * p_nUVStride;
+		const uint8_t* v = p_pV + (size_t)(row >> 1) * p_nUVStride;
+		lv_fnYuvRow(y, u, v, p_nUVStep, p_pDst + (size_t)row * p_nDstStride, p_nWidth, bRgb);
+	}
+}
+
+void mi_color_nv12(const uint8_t* p_pY, size_t p_nYStride, const uint8_t* p_pUV, size_t p_nUVStride,
+	int p_nWidth, int p_nHeight, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding)
+{
+	yuv_rows(p_pY, p_nYStride, p_pUV, p_pUV + 1, p_nUVStride, 2, p_nWidth, p_nHeight, p_pDst, p_nDstStride, p_encoding);
+}
+
+void mi_color_i420(const uint8_t* p_pY, size_t p_nYStride, const uint8_t* p_pU, size_t p_nUStride, const uint8_t* p_pV, size_t p_nVStride,
+	int p_nWidth, int p_nHeight, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding)
+{
+	//. encoders give U and V the same stride; convert row pairs one by one otherwise.
+	if (p_nUStride == p_nVStride) {
+		yuv_rows(p_pY, p_nYStride, p_pU, p_pV, p_nUStride, 1, p_nWidth, p_nHeight, p_pDst, p_nDstStride, p_encoding);
+		return;
+	}
+	for (int row = 0; row < p_nHeight; row += 2) {
+		yuv_rows(p_pY + (size_t)row * p_nYStride, p_nYStride, p_pU + (size_t)(row >> 1) * p_nUStride, p_pV + (size_t)(row >> 1) * p_nVStride, 0, 1,
+			p_nWidth, p_nHeight - row < 2 ? 1 : 2, p_pDst + (size_t)row * p_nDstStride, p_nDstStride, p_encoding);
+	}
+}
+
+void mi_color_swap_rb(const uint8_t* p_pSrc, uint8_t* p_pDst, size_t p_nPixels)
+{
+	size_t i = lv_fnSwapRb(p_pSrc, p_pDst, p_nPixels);
+	for (; i < p_nPixels; i++) {
+		const uint8_t* s = p_pSrc + i * 3;
+		uint8_t* d = p_pDst + i * 3;
+		uint8_t first = s[0];
+		d[0] = s[2];
+		d[1] = s[1];
+		d[2] = first;
+	}
+}
+
+void mi_color_yuv_rect(const MiYuvFrame& p_frame, int p_nX, int p_nY, int p_nW, int p_nH, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding)
+{
+	const uint8_t* y = p_frame.y + (size_t)p_nY * p_frame.yStride + p_nX;
+	size_t row = (size_t)(p_nY / 2);
+	if (p_frame.nv12) {
+		mi_color_nv12(y, p_frame.yStride, p_frame.u + row * p_frame.uStride + p_nX, p_frame.uStride, p_nW, p_nH, p_pDst, p_nDstStride, p_encoding);
+		return;
+	}
+	mi_color_i420(y, p_frame.yStride, p_frame.u + row * p_frame.uStride + p_nX / 2, p_frame.uStride,
+		p_frame.v + row * p_frame.vStride + p_nX / 2, p_frame.vStride, p_nW, p_nH, p_pDst, p_nDstStride, p_encoding);
+}
+
+void mi_color_yuv_nearest(const MiYuvFrame& p_frame, int p_nW, int p_nH, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding)
+{
+	bool bRgb = p_encoding == RGB888;
+	for (int oy = 0; oy < p_nH; oy++) {
+		int sy = (int)(((long long)oy * 2 + 1) * p_frame.height / (2LL * p_nH));
+		const uint8_t* yRow = p_frame.y + (size_t)sy * p_frame.yStride;
+		const uint8_t* uRow = p_frame.u + (size_t)(sy >> 1) * p_frame.uStride;
+		const uint8_t* vRow = p_frame.nv12 ? uRow + 1 : p_frame.v + (size_t)(sy >> 1) * p_frame.vStride;
+		int step = p_frame.nv12 ? 2 : 1;
+		uint8_t* out = p_pDst + (size_t)oy * p_nDstStride;
+		for (int ox = 0; ox < p_nW; ox++) {
+			int sx = (int)(((long long)ox * 2 + 1) * p_frame.width / (2LL * p_nW));
+			//. one pixel at a time through the row kernel keeps the arithmetic in one place.
+			uint8_t pix[3];
+			yuv_row_scalar(yRow + sx, uRow + (sx >> 1) * step, vRow + (sx >> 1) * step, step, pix, 0, 1, bRgb);
+			out[ox * 3 + 0] = pix[0];
+			out[ox * 3 + 1] = pix[1];
+			out[ox * 3 + 2] = pix[2];
+		}
+	}
+}
+
+MiColorIsa mi_color_isa()
+{
+	return lv_nIsa;
+}
+
+bool mi_color_set_isa(MiColorIsa p_isa)
+{
+	return mi_cpu_bind(&lv_kernel, p_isa);
+}
+
+const char* mi_color_isa_name(MiColorIsa p_isa)
+{
+	switch (p_isa) {
+	case MI_COLOR_AVX2: return "avx2";
+	case MI_COLOR_SSSE3: return "ssse3";
+	default: return "scalar";
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <facesdk/FaceSDK_C_Api.h>
+
+//. Color conversion kernels of the pixel-ingestion path, producing the packed 24-bit
+//. rows image_create_pixels takes (RGB888 / BGR888). NV12 and I420 are BT.601 limited
+//. range as camera encoders emit them, chroma shared by 2 x 2 pixels; a crop starting at
+//. an even x / y is just an offset into the planes. Kernels are bound once at startup (MiCpu.h) :
+//. AVX2 (16 pixels per step), SSSE3 (8) or scalar, all three bit-exact.
+//. Resizing stays with mi_resize_bgr (MiResize.h).
+
+enum MiColorIsa {
+	MI_COLOR_SCALAR = 0,
+	MI_COLOR_SSSE3,
+	MI_COLOR_AVX2
+};
+
+//. RGB888 <-> BGR888 of p_nPixels pixels; p_pSrc == p_pDst converts in place.
+void mi_color_swap_rb(const uint8_t* p_pSrc, uint8_t* p_pDst, size_t p_nPixels);
+
+//. Y plane + interleaved UV plane (half width / height, U first).
+void mi_color_nv12(const uint8_t* p_pY, size_t p_nYStride, const uint8_t* p_pUV, size_t p_nUVStride,
+	int p_nWidth, int p_nHeight, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding);
+
+//. Y, U and V planes (U / V half width / height).
+void mi_color_i420(const uint8_t* p_pY, size_t p_nYStride, const uint8_t* p_pU, size_t p_nUStride, const uint8_t* p_pV, size_t p_nVStride,
+	int p_nWidth, int p_nHeight, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding);
+
+//. planes of one 4:2:0 frame.
+struct MiYuvFrame {
+	bool			nv12;		//. false = I420
+	int				width;
+	int				height;
+	const uint8_t*	y;
+	size_t			yStride;
+	const uint8_t*	u;			//. NV12 : the interleaved UV plane
+	size_t			uStride;
+	const uint8_t*	v;			//. NV12 : unused
+	size_t			vStride;
+};
+
+//. the p_nW x p_nH rectangle at p_nX, p_nY (both even) of p_frame.
+void mi_color_yuv_rect(const MiYuvFrame& p_frame, int p_nX, int p_nY, int p_nW, int p_nH, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding);
+
+//. p_frame point-sampled down to p_nW x p_nH (detection copies, no filtering); scalar.
+void mi_color_yuv_nearest(const MiYuvFrame& p_frame, int p_nW, int p_nH, uint8_t* p_pDst, size_t p_nDstStride, COLOR_ENCODING_t p_encoding);
+
+//. kernels in use; mi_color_set_isa forces a lower level (benchmarks), false when the CPU lacks it.
+MiColorIsa mi_color_isa();
+bool mi_color_set_isa(MiColorIsa p_isa);
+const char* mi_color_isa_name(MiColorIsa p_isa);
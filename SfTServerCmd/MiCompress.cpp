@@ -0,0 +1,148 @@
+#include "MiCompress.h"
+#include "MiArena.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+
+using Poco::DeflatingOutputStream;
+using Poco::DeflatingStreamBuf;
+using Poco::InflatingInputStream;
+using Poco::InflatingStreamBuf;
+
+static bool		lv_bEnabled = false;
+static size_t	lv_nMinBytes = 0;
+static int		lv_nLevel = Z_DEFAULT_COMPRESSION;
+
+void mi_compress_init(bool p_bEnable, int p_nMinBytes, int p_nLevel)
+{
+	lv_bEnabled = p_bEnable;
+	lv_nMinBytes = p_nMinBytes > 0 ? (size_t)p_nMinBytes : 0;
+	lv_nLevel = (p_nLevel >= 1 && p_nLevel <= 9) ? p_nLevel : Z_DEFAULT_COMPRESSION;
+}
+
+ContentCoding mi_accept_coding(const Poco::Net::HTTPServerRequest& p_request)
+{
+	const std::string& strAccept = p_request.get("Accept-Encoding", Poco::Net::HTTPMessage::EMPTY);
+	if (strAccept.empty()) return MI_CODING_IDENTITY;
+
+	//. "gzip;q=0.8, deflate, br;q=0" : keep the coding with the highest q
+	ContentCoding best = MI_CODING_IDENTITY;
+	double bestQ = 0.0;
+	Poco::StringTokenizer items(strAccept, ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM);
+	for (size_t i = 0; i < items.count(); i++) {
+		Poco::StringTokenizer parts(items[i], ";", Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM);
+		if (parts.count() == 0) continue;
+		double q = 1.0;
+		for (size_t k = 1; k < parts.count(); k++) {
+			if (parts[k].size() > 2 && (parts[k][0] == 'q' || parts[k][0] == 'Q') && parts[k][1] == '=') {
+				if (!Poco::NumberParser::tryParseFloat(parts[k].substr(2), q)) q = 0.0;
+			}
+		}
+		ContentCoding coding;
+		if (Poco::icompare(parts[0], "gzip") == 0 || Poco::icompare(parts[0], "x-gzip") == 0) coding = MI_CODING_GZIP;
+		else if (Poco::icompare(parts[0], "deflate") == 0) coding = MI_CODING_DEFLATE;
+		else if (parts[0] == "*") coding = MI_CODING_GZIP;
+		else continue;
+		if (q > bestQ || (q == bestQ && q > 0.0 && coding == MI_CODING_GZIP)) {
+			best = coding;
+			bestQ = q;
+		}
+	}
+	return bestQ > 0.0 ? best : MI_CODING_IDENTITY;
+}
+
+void mi_send_body(const Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, const char* p_pData, size_t p_nLength)
+{
+	//. a profiled JSON body gets its "profile" member (MiRequestProfile.h).
+	RequestContext* ctx = mi_context();
+	std::string strProfiled;
+	if (ctx != NULL && ctx->profile && p_response.getContentType().find("json") != std::string::npos
+		&& mi_request_profile_body(*ctx, p_pData, p_nLength, strProfiled)) {
+		p_pData = strProfiled.data();
+		p_nLength = strProfiled.size();
+	}
+
+	ContentCoding coding = (lv_bEnabled && p_nLength >= lv_nMinBytes) ? mi_accept_coding(p_request) : MI_CODING_IDENTITY;
+	if (lv_bEnabled) p_response.set("Vary", "Accept-Encoding");
+	if (coding == MI_CODING_IDENTITY) {
+		p_response.sendBuffer(p_pData, p_nLength);
+		return;
+	}
+
+	StageTimer tCompress(MI_STAGE_COMPRESS);
+	ArenaOStream oss;
+	{
+		DeflatingOutputStream deflater(oss, coding == MI_CODING_GZIP ? DeflatingStreamBuf::STREAM_GZIP : DeflatingStreamBuf::STREAM_ZLIB, lv_nLevel);
+		deflater.write(p_pData, (std::streamsize)p_nLength);
+		deflater.close();
+	}
+	const ArenaString& out = oss.str();
+	tCompress.stop();
+	mi_metrics_compress(p_nLength, out.size());
+
+	p_response.set("Content-Encoding", coding == MI_CODING_GZIP ? "gzip" : "deflate");
+	p_response.sendBuffer(out.data(), out.size());
+}
+
+std::ostream& mi_send_stream(const Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, std::unique_ptr<DeflatingOutputStream>& p_pDeflater)
+{
+	ContentCoding coding = lv_bEnabled ? mi_accept_coding(p_request) : MI_CODING_IDENTITY;
+	if (lv_bEnabled) p_response.set("Vary", "Accept-Encoding");
+	if (coding != MI_CODING_IDENTITY) p_response.set("Content-Encoding", coding == MI_CODING_GZIP ? "gzip" : "deflate");
+	p_response.setChunkedTransferEncoding(true);
+	std::ostream& out = p_response.send();
+	p_pDeflater.reset();
+	if (coding == MI_CODING_IDENTITY) return out;
+	p_pDeflater.reset(new DeflatingOutputStream(out, coding == MI_CODING_GZIP ? DeflatingStreamBuf::STREAM_GZIP : DeflatingStreamBuf::STREAM_ZLIB, lv_nLevel));
+	return *p_pDeflater;
+}
+
+bool mi_request_coding(const Poco::Net::HTTPServerRequest& p_request, ContentCoding* p_pCoding)
+{
+	const std::string& strCoding = p_request.get("Content-Encoding", Poco::Net::HTTPMessage::EMPTY);
+	std::string strTrim = Poco::trim(strCoding);
+	if (strTrim.empty() || Poco::icompare(strTrim, "identity") == 0) *p_pCoding = MI_CODING_IDENTITY;
+	else if (Poco::icompare(strTrim, "gzip") == 0 || Poco::icompare(strTrim, "x-gzip") == 0) *p_pCoding = MI_CODING_GZIP;
+	else if (Poco::icompare(strTrim, "deflate") == 0) *p_pCoding = MI_CODING_DEFLATE;
+	else {
+		*p_pCoding = MI_CODING_IDENTITY;
+		return false;
+	}
+	return true;
+}
+
+RequestBody::RequestBody(Poco::Net::HTTPServerRequest& p_request, size_t p_nMaxBytes)
+	: m_in(p_request.stream()), m_coding(MI_CODING_IDENTITY)
+{
+	mi_request_coding(p_request, &m_coding);
+	if (m_coding == MI_CODING_IDENTITY) {
+		//. a Content-Length beyond the limit got 413 before the handler ran.
+		if (p_request.hasContentLength()) return;
+		m_buf.open(&m_in, p_nMaxBytes);
+	}
+	else {
+		m_pInflater.reset(new InflatingInputStream(m_in, m_coding == MI_CODING_GZIP ? InflatingStreamBuf::STREAM_GZIP : InflatingStreamBuf::STREAM_ZLIB));
+		m_buf.open(m_pInflater.get(), p_nMaxBytes);
+	}
+	m_pLimited.reset(new std::istream(&m_buf));
+}
+
+RequestBody::LimitedBuf::int_type RequestBody::LimitedBuf::underflow()
+{
+	if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+	if (m_pSrc == NULL || m_bOverflow) return traits_type::eof();
+
+	m_pSrc->read(m_chunk, sizeof(m_chunk));
+	size_t n = (size_t)m_pSrc->gcount();
+	if (n == 0) return traits_type::eof();
+	if (n > m_nLeft) {
+		m_bOverflow = true;
+		return traits_type::eof();
+	}
+	m_nLeft -= n;
+	setg(m_chunk, m_chunk, m_chunk + n);
+	return traits_type::to_int_type(*gptr());
+}
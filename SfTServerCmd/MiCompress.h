@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include "Poco/DeflatingStream.h"
+#include "Poco/InflatingStream.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+//. Response compression ([compress]) : bodies of at least min_bytes go out gzip or
+//. deflate (zlib) encoded when the client's Accept-Encoding allows it. Small single
+//. results are sent as they are, compressing them costs more time than it saves.
+//. Request bodies sent with Content-Encoding: gzip / deflate are inflated on the fly
+//. by RequestBody, the JSON scanners read the plain text from it.
+
+enum ContentCoding {
+	MI_CODING_IDENTITY = 0,
+	MI_CODING_GZIP,
+	MI_CODING_DEFLATE
+};
+
+//. p_nLevel : zlib level 1..9, anything else = zlib default.
+void mi_compress_init(bool p_bEnable, int p_nMinBytes, int p_nLevel);
+
+//. best coding the request accepts; gzip wins over deflate at equal q.
+ContentCoding mi_accept_coding(const Poco::Net::HTTPServerRequest& p_request);
+
+//. Sends p_pData as the body, compressed when enabled, large enough and accepted.
+//. Status and content type must be set before.
+void mi_send_body(const Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, const char* p_pData, size_t p_nLength);
+
+//. Starts a body of unknown length : chunked transfer encoding, compressed when enabled and
+//. accepted (whatever its size, a streamed body is a large one). Returns the stream to write,
+//. p_pDeflater when compressed; close it (through p_pDeflater) to end the body.
+//. Status and content type must be set before.
+std::ostream& mi_send_stream(const Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, std::unique_ptr<Poco::DeflatingOutputStream>& p_pDeflater);
+
+//. coding of the request body; false for anything but identity / gzip / deflate.
+bool mi_request_coding(const Poco::Net::HTTPServerRequest& p_request, ContentCoding* p_pCoding);
+
+//. Request body as plain bytes : request.stream() itself, or an inflater over it that
+//. stops after p_nMaxBytes of output so a small compressed body cannot expand without
+//. bound. Chunked identity bodies (no Content-Length) are cut at p_nMaxBytes the same way.
+//. Check mi_request_coding first, unsupported codings are read as identity.
+class RequestBody {
+public:
+	RequestBody(Poco::Net::HTTPServerRequest& p_request, size_t p_nMaxBytes);
+
+	std::istream& stream() { return m_pLimited ? *m_pLimited : m_in; }
+	ContentCoding coding() const { return m_coding; }
+	//. the (inflated) body went past p_nMaxBytes; the rest of it was not read.
+	bool overflow() const { return m_buf.overflow(); }
+
+private:
+	//. forwards the inflater in chunks and ends the stream at the limit.
+	class LimitedBuf : public std::streambuf {
+	public:
+		LimitedBuf() : m_pSrc(NULL), m_nLeft(0), m_bOverflow(false) {}
+		void open(std::istream* p_pSrc, size_t p_nMax) { m_pSrc = p_pSrc; m_nLeft = p_nMax; }
+		bool overflow() const { return m_bOverflow; }
+	protected:
+		int_type underflow() override;
+	private:
+		std::istream*	m_pSrc;
+		size_t			m_nLeft;
+		bool			m_bOverflow;
+		char			m_chunk[16 * 1024];
+	};
+
+	std::istream&									m_in;
+	ContentCoding									m_coding;
+	LimitedBuf										m_buf;
+	std::unique_ptr<Poco::InflatingInputStream>		m_pInflater;
+	std::unique_ptr<std::istream>					m_pLimited;
+};
@@ -4,6 +4,33 @@
 #define GD_API_STATUS					"/api/check_liveness_status"
 #define GD_API_FULL_PROCESS				"/api/check_liveness"
 #define GD_API_FULL_PROCESS_BASE64		"/api/check_liveness_base64"
+#define GD_API_FULL_PROCESS_RAW			"/api/check_liveness_raw"		//. the image file as the body
+#define GD_API_FULL_PROCESS_URL			"/api/check_liveness_url"		//. {"url":...} fetched by the server
+#define GD_API_BATCH					"/api/check_liveness_batch"
+#define GD_API_SEQUENCE					"/api/check_liveness_sequence"
+#define GD_API_BURST					"/api/check_liveness_burst"
+#define GD_API_FACES					"/api/check_liveness_faces"		//. every face of a group photo
+#define GD_API_ONBOARD					"/api/check_onboarding"			//. selfie liveness + ID portrait quality
+#define GD_API_VIDEO					"/api/check_liveness_video"		//. sampled frames of a short clip
+#define GD_API_PIXELS					"/api/check_liveness_pixels"
+#define GD_API_CACHE_STATS				"/api/cache_stats"
+#define GD_API_METRICS					"/metrics"
+#define GD_API_STATS					"/stats"
+#define GD_API_TRACE					"/debug/trace"
+#define GD_API_PROFILE					"/debug/profile"
+#define GD_API_LOCKS					"/debug/locks"
+#define GD_API_SATURATION				"/metrics/saturation"
+#define GD_API_READY					"/ready"
+#define GD_API_ADMIN_RELOAD				"/admin/reload"
+#define GD_API_ADMIN_CONFIG				"/admin/config"
+#define GD_API_STREAM					"/api/check_liveness_stream"
+#define GD_API_JOBS						"/api/jobs"
+#define GD_API_SHM						"/api/check_liveness_shm"
+#define GD_API_ANALYZE					"/api/analyze"
+#define GD_API_DETECT					"/api/detect"
+#define GD_API_QUALITY					"/api/quality"
+#define GD_API_SESSION					"/api/check_liveness_session"
+#define GD_API_HEALTH					"/health"
 
 
 #define GD_ID_VERSION			"1.0.1.5"
@@ -11,3 +38,568 @@
 
 
 #define GD_PORT_IN				8092
+
+//. front end : "classic" = Poco HTTPServer (thread per connection), "reactor" = MiReactorServer.h
+#define GD_SERVER_MODE			"classic"
+#define GD_SERVER_IO_THREADS	2		//. reactor threads receiving and sending
+#define GD_SERVER_WORKERS		4		//. inference threads behind the reactors
+#define GD_SERVER_QUEUE			64		//. complete requests waiting for a worker
+#define GD_SERVER_INGEST_HIGH_MB	512		//. reactor : request bodies held before reads pause, 0 = never
+#define GD_SERVER_INGEST_LOW_MB		384		//. reads resume once the bodies held are back under
+#define GD_SERVER_MAX_BODY_MB	32		//. 413 beyond, checked before reading and while streaming
+#define GD_SERVER_MAX_IMAGE_SIDE	12000	//. longest side of an upload from its header, 0 = no limit
+#define GD_SERVER_MAX_IMAGE_MPIX	50		//. megapixels of an upload, 0 = no limit
+#define GD_SERVER_MIN_IMAGE_SIDE	0		//. smaller uploads get FACE_TOO_SMALL without a decode, 0 = off
+#define GD_IMAGE_SNIFF_MAX_BYTES	(256 * 1024)	//. upload prefix searched for the header (EXIF may come first)
+#define GD_SERVER_TCP_NODELAY	1
+#define GD_SERVER_LISTEN_BACKLOG	64
+#define GD_SERVER_REUSE_PORT	0		//. SO_REUSEPORT on the listen sockets (Linux), see MiConnection.h
+#define GD_SERVER_LISTENERS		1		//. listen sockets on server.port, > 1 needs reuse_port
+#define GD_SERVER_DRAIN_SEC		20		//. shutdown waits this long for requests in flight
+
+//. runtime settings file, see MiSettings.h
+#define GD_CONFIG_FILE_INI		"IDLiveFaceCmd.ini"
+#define GD_CONFIG_FILE_JSON		"IDLiveFaceCmd.json"
+
+//. 1 : write each upload to a temp file and decode with image_create_path (debug only)
+//. 0 : decode the request buffer in memory with image_create_bytes
+#define GD_USE_TEMP_FILE		0
+
+//. micro-batching of concurrent liveness checks into pipeline_check_liveness_batch2
+#define GD_BATCH_ENABLE			0		//. off : the deprecated batch2 entry point and a fill wait per image
+#define GD_BATCH_MAX_SIZE		8		//. images per batch
+#define GD_BATCH_MAX_WAIT_MS	2		//. max wait of the oldest image before flush
+#define GD_BATCH_WORKERS		1		//. batches in flight at once
+#define GD_BATCH_ADAPTIVE		0		//. size and wait picked from the load, see MiBatchWindow.h
+#define GD_BATCH_P99_MS			50		//. target p99 of an image's time in the batcher
+#define GD_BATCH_ADAPT_MS		250		//. how often the window is picked again
+#define GD_BATCH_BUCKETS		""		//. compiled call sizes, e.g. "1,4,8", see MiBuckets.h
+#define GD_BATCH_ORDER			"fifo"	//. "fifo" / "edf" (earliest deadline first)
+#define GD_BATCH_STARVE_MS		250		//. edf : longest an image is passed over, 0 = no limit
+#define GD_BATCH_DEDUP			1		//. identical images of a batch checked once, see MiDedup.h
+
+//. GD_API_PIXELS : raw 24-bit frame in the body, geometry in these headers
+#define GD_PIXELS_HEADER_WIDTH		"X-Width"
+#define GD_PIXELS_HEADER_HEIGHT		"X-Height"
+#define GD_PIXELS_HEADER_STRIDE		"X-Stride"			//. bytes per row, default width * 3 (Y plane : width)
+#define GD_PIXELS_HEADER_FORMAT		"X-Pixel-Format"	//. "bgr" (default) / "rgb" / "nv12" / "i420"
+#define GD_PIXELS_HEADER_CHROMA_STRIDE	"X-Chroma-Stride"	//. nv12 / i420 : bytes per chroma row, default X-Stride (nv12) or half of it (i420)
+
+//. WebSocket streams, see MiStream.h
+#define GD_STREAM_FUSION_FRAMES		0					//. 0 / 1 = every frame on its own
+#define GD_STREAM_FUSION_MAX		16
+#define GD_STREAM_IDLE_SEC			30					//. closed after this long without a frame
+
+//. shared-memory ingestion from a local proxy, see MiShm.h
+#define GD_SHM_ENABLE				false
+#define GD_SHM_PREFIX				"MiLiveIngest"
+#define GD_SHM_HEADER_SEGMENT		"X-Shm-Segment"
+#define GD_SHM_HEADER_SIZE			"X-Shm-Size"		//. bytes of the whole segment
+#define GD_SHM_HEADER_OFFSET		"X-Shm-Offset"
+#define GD_SHM_HEADER_LENGTH		"X-Shm-Length"		//. bytes of the image
+
+//. asynchronous jobs, see MiJobs.h
+#define GD_JOBS_ENABLE				false
+#define GD_JOBS_DIR					"jobs"				//. spool of the uploaded images and results
+#define GD_JOBS_MAX_QUEUED			10000				//. images waiting over all jobs, more get 503
+#define GD_JOBS_BATCH_SIZE			32					//. images per check_batch call
+#define GD_JOBS_RETENTION_SEC		3600				//. finished jobs are kept this long
+#define GD_JOBS_CALLBACK_TIMEOUT_SEC	5
+#define GD_JOBS_REDIS_POLL_MS		100					//. idle poll of the Redis queue
+
+//. shared Redis tier, see MiRedis.h
+#define GD_REDIS_ENABLE				false
+#define GD_REDIS_HOST				"127.0.0.1"
+#define GD_REDIS_PORT				6379
+#define GD_REDIS_POOL				8					//. connections per node
+#define GD_REDIS_TIMEOUT_MS			50					//. connect / receive, a slower Redis counts as a miss
+#define GD_REDIS_PREFIX				"mi:"
+#define GD_REDIS_CACHE				true
+#define GD_REDIS_JOBS				false
+#define GD_REDIS_CLAIM_MS			2000				//. other nodes wait this long for a claimed check
+#define GD_REDIS_POLL_MS			5
+
+//. cluster membership, see MiCluster.h
+#define GD_CLUSTER_ENABLE			false
+#define GD_CLUSTER_TRANSPORT		"redis"
+#define GD_CLUSTER_NODE				""					//. host name : server.port
+#define GD_CLUSTER_PEERS			""
+#define GD_CLUSTER_INTERVAL_MS		1000
+#define GD_CLUSTER_MIN_INTERVAL_MS	100
+#define GD_CLUSTER_REDIS_KIND		"cluster"			//. hash <redis.prefix>cluster
+
+//. binary service protocol, see MiBinaryServer.h
+#define GD_BINARY_ENABLE			false
+#define GD_BINARY_PORT				8093
+#define GD_BINARY_WORKERS			4
+#define GD_BINARY_QUEUE				64
+#define GD_BINARY_MAX_INFLIGHT		8					//. requests per connection
+#define GD_BINARY_MAX_CONNECTIONS	16
+
+//. h2c front end on nghttp2, see MiHttp2Server.h
+#ifndef MI_HAS_NGHTTP2
+#define MI_HAS_NGHTTP2				0					//. CMake MI_HTTP2 sets it when nghttp2 is found
+#endif
+#define GD_HTTP2_ENABLE				false
+#define GD_HTTP2_PORT				8094
+#define GD_HTTP2_MAX_CONNECTIONS	64
+#define GD_HTTP2_MAX_STREAMS		32					//. concurrent requests per connection
+#define GD_HTTP2_WINDOW_KB			1024				//. an upload of this size needs no WINDOW_UPDATE
+
+//. HTTPS listener on OpenSSL, see MiTls.h
+#ifndef MI_HAS_OPENSSL
+#define MI_HAS_OPENSSL				0					//. CMake MI_TLS sets it when OpenSSL is found
+#endif
+#define GD_TLS_ENABLE				false
+#define GD_TLS_PORT					8443
+#define GD_TLS_SESSION_CACHE		20480				//. server-side sessions kept for resumption, 0 = tickets only
+#define GD_TLS_SESSION_TIMEOUT_SEC	7200
+#define GD_TLS_TICKETS				true
+#define GD_TLS_HANDSHAKE_SEC		10
+
+//. image fetch from object storage, see MiFetch.h
+#ifndef MI_HAS_NETSSL
+#define MI_HAS_NETSSL				0					//. CMake MI_FETCH_HTTPS sets it when Poco NetSSL is found
+#endif
+#define GD_FETCH_ENABLE				false
+#define GD_FETCH_MAX_MB				20
+#define GD_FETCH_TIMEOUT_MS			5000
+#define GD_FETCH_KEEP_ALIVE			8					//. idle connections kept per host
+#define GD_FETCH_IDLE_SEC			30
+
+//. response compression, see MiCompress.h
+#define GD_COMPRESS_ENABLE			true
+#define GD_COMPRESS_MIN_BYTES		4096				//. smaller bodies are sent as they are
+#define GD_COMPRESS_LEVEL			6					//. zlib 1 (fast) .. 9 (small)
+
+//. CORS response headers, see MiHeaders.h
+#define GD_CORS_ALLOW_ORIGIN		"*"
+#define GD_CORS_ALLOW_METHODS		"GET, POST, PUT, DELETE, OPTIONS"
+#define GD_CORS_ALLOW_HEADERS		"Content-Type, Authorization, X-Api-Key, X-Priority, X-Deadline-Ms, X-Response-Schema, X-Width, X-Height, X-Stride, X-Pixel-Format, X-Calibration, X-Device-Os, X-Request-Id"
+#define GD_CORS_MAX_AGE_SEC			86400				//. preflight cache, 0 = no Access-Control-Max-Age
+
+//. result JSON schema, see MiResultJson.h
+#define GD_RESPONSE_SCHEMA			"legacy"			//. "legacy" / "v2"
+#define GD_RESPONSE_SCHEMA_HEADER	"X-Response-Schema"	//. per-request override
+#define GD_RESULT_JSON_RESERVE		320					//. bytes reserved per result object
+#define GD_RESPONSE_STREAM_IMAGES	8					//. images per step of a streamed GD_API_BATCH, 0 = never stream
+#define GD_RESPONSE_STREAM_MAX		256					//. images of a streamed GD_API_BATCH request
+#define GD_NDJSON_TYPE				"application/x-ndjson"	//. Accept of clients reading one result per line
+#define GD_CBOR_TYPE				"application/cbor"		//. binary result encodings, see MiResultJson.h
+#define GD_MSGPACK_TYPE				"application/msgpack"
+
+//. verdict thresholds, see MiVerdict.h
+#define GD_VERDICT_QUALITY_MIN		0.5					//. quality score below : bad quality
+#define GD_VERDICT_GENUINE_MIN		0.5					//. liveness probability from : genuine
+#define GD_VALIDATION_POOL			4					//. blueprint analyzers kept for validation profiles
+
+//. images accepted by one GD_API_BATCH request
+#define GD_BATCH_REQUEST_MAX	16
+
+//. SDK message buffers a thread holds per nesting level, see MiMsgBuffers.h; the largest usual batch
+#define GD_MSG_BUFFERS_PER_LEVEL	GD_JOBS_BATCH_SIZE
+
+//. SDK config used for pipelines created outside setting_init
+#define GD_SDK_CONFIG_DIR		"data"
+#define GD_SDK_CONFIG_NAME		"pipeline.xml"
+#define GD_SDK_PIPELINE_NAME	"ConfigurablePipeline"
+
+//. inference engine of the check endpoints : "legacy" (CPipeline_t) or "blueprint" (idliveface.h), see MiBackend.h
+#define GD_BACKEND_ENGINE		"legacy"
+#define GD_BACKEND_PROFILE		""		//. blueprint RuntimeConfiguration preset : "latency" / "throughput", see MiBlueprint.h
+#define GD_BACKEND_CASCADE_MARGIN	0.15	//. blueprint cascade : escalate within this of verdict.genuine_min
+
+//. second engine replaying sampled checks, see MiShadow.h
+#define GD_SHADOW_ENABLE			0
+#define GD_SHADOW_ENGINE			"blueprint"
+#define GD_SHADOW_SAMPLE_PERCENT	1.0
+#define GD_SHADOW_QUEUE				16
+
+//. CPU + GPU pipelines with per-call dispatch, see MiDevice.h
+#define GD_DEVICE_GPU			0
+#define GD_DEVICE_GPU_CONFIG	"pipeline_gpu.xml"
+#define GD_DEVICE_GPU_PIPELINES	1
+#define GD_DEVICE_GPU_MIN_BATCH	4		//. smaller batches stay on the CPU
+#define GD_DEVICE_GPU_MAX_QUEUE	4		//. GPU calls in flight beyond which batches stay on the CPU
+#define GD_DEVICE_CPU_BUSY		0		//. CPU calls in flight from which single images spill to the GPU, 0 = never
+#define GD_DEVICE_GPU_LAZY		0		//. build the GPU pipelines on the first GPU call, see MiLazyPool.h
+#define GD_DEVICE_GPU_IDLE_EVICT_S	0	//. release them again after that long unused, 0 = never
+
+//. face-crop fast path for large uploads, see MiFaceCrop.h
+#define GD_CROP_ENABLE			0
+#define GD_CROP_MARGIN			0.6		//. box fraction added on each side
+#define GD_CROP_TARGET_SIZE		512		//. long side of the crop handed to the pipeline
+#define GD_CROP_MIN_IMAGE_SIDE	1600	//. smaller images take the full path
+#define GD_CROP_DETECT_SIDE		640		//. long side of the detection copy
+#define GD_CROP_DETECTORS		2
+#define GD_CROP_DETECTOR		"BaseNnetDetector"
+
+//. DCT-scaled JPEG decode, see MiDecode.h
+#define GD_DECODE_ENABLE		0
+#define GD_DECODE_TARGET_SIDE	1280	//. decoded long side kept at least this large
+#define GD_DECODE_UPRIGHT		1		//. EXIF-rotated JPEGs decoded and turned upright before the SDK
+#define GD_DECODE_PROGRESSIVE	0		//. reactor mode : decode a JPEG upload while it is received, see MiProgressive.h
+#define GD_DECODE_PROGRESSIVE_MIN_KB	512		//. smaller bodies arrive too fast to gain anything
+#define GD_DECODE_PROGRESSIVE_THREADS	4		//. uploads decoded while received at once
+
+//. WebP / HEIC / AVIF uploads decoded by the server, see MiCodecs.h
+#ifndef MI_HAS_LIBWEBP
+#define MI_HAS_LIBWEBP			0		//. CMake MI_WEBP sets it when libwebp is found
+#endif
+#ifndef MI_HAS_LIBHEIF
+#define MI_HAS_LIBHEIF			0		//. CMake MI_HEIF sets it when libheif is found
+#endif
+#define GD_DECODE_FORMATS		"webp,heif,avif"
+
+//. detection / quality gate before liveness, see MiGate.h
+#define GD_GATE_ENABLE			0
+#define GD_GATE_MAX_FACES		1		//. 0 = any number of faces
+#define GD_GATE_MIN_QUALITY		0.5		//. same threshold as the "bad quality" verdict, < 0 = detection only
+#define GD_GATE_ENGINES			2
+#define GD_GATE_DETECTOR		"BaseNnetDetector"
+#define GD_GATE_QUALITY			"ExpositionQualityEngine"
+
+//. blur / darkness prefilter before the SDK, see MiPrefilter.h
+#define GD_PREFILTER_ENABLE			0
+#define GD_PREFILTER_SIDE			256		//. long side of the gray copy
+#define GD_PREFILTER_MIN_SHARPNESS	20.0	//. Laplacian variance, <= 0 = no blur check
+#define GD_PREFILTER_DARK_LEVEL		40		//. luma below counts as dark
+#define GD_PREFILTER_DARK_PERCENT	95.0	//. <= 0 = no darkness check
+#define GD_PREFILTER_AUDIT_PERCENT	5.0		//. rejections still checked by the SDK, 100 = measure only
+
+//. per-face analysis endpoint, see MiAnalyze.h
+#define GD_ANALYZE_ENABLE		0
+#define GD_ANALYZE_ENGINES		2
+#define GD_ANALYZE_DETECTOR		"BaseNnetDetector"
+#define GD_ANALYZE_OCCLUSION	1
+#define GD_ANALYZE_CLOSED_EYES	1
+#define GD_ANALYZE_FIELDS_DEFAULT	(MI_ANALYZE_BOX | MI_ANALYZE_POSE | MI_ANALYZE_OCCLUSION | MI_ANALYZE_CLOSED_EYES)
+
+//. detection-only batch endpoint, see MiDetect.h
+#define GD_DETECT_ENABLE		0
+#define GD_DETECT_ENGINES		2
+#define GD_DETECT_DETECTOR		"BaseNnetDetector"
+#define GD_DETECT_LAZY			0		//. build the detectors on the first request
+#define GD_DETECT_IDLE_EVICT_S	0		//. release them again after that long unused, 0 = never
+
+//. quality-only batch endpoint, see MiQuality.h
+#define GD_QUALITY_ENABLE		0
+#define GD_QUALITY_ENGINES		2
+#define GD_QUALITY_ENGINE		"ExpositionQualityEngine"
+#define GD_QUALITY_LAZY			0		//. build the engines on the first request
+#define GD_QUALITY_IDLE_EVICT_S	0		//. release them again after that long unused, 0 = never
+#define GD_QUALITY_WORKERS		2		//. reactor mode : threads of the quality worker pool
+#define GD_QUALITY_QUEUE		64
+
+//. best-frame selection of a burst, see MiBurst.h
+#define GD_BURST_ENABLE			0
+#define GD_BURST_TOP_K			3		//. frames checked for liveness
+#define GD_BURST_SIZE_WEIGHT	0.3		//. share of the face size in the rank
+#define GD_BURST_FACE_SIZE		1		//. rank by face size too (needs [detect])
+#define GD_BURST_FUSED			0		//. the selected frames as one sequence
+
+//. per-face liveness of a group photo, see MiFaces.h
+#define GD_FACES_ENABLE			0
+#define GD_FACES_MAX			16		//. largest faces checked, the rest are dropped
+
+//. selfie plus ID portrait, see MiOnboard.h
+#define GD_ONBOARD_ENABLE		0
+
+//. sampled frames of a video upload, see MiVideo.h
+#define GD_VIDEO_ENABLE			0
+#define GD_VIDEO_SAMPLING		"keyframes"		//. keyframes | every_n
+#define GD_VIDEO_EVERY_N		5
+#define GD_VIDEO_INTERVAL_MS	250			//. keyframes : seek step
+#define GD_VIDEO_MAX_FRAMES		8
+#define GD_VIDEO_MAX_SECONDS	10
+#define GD_VIDEO_HARDWARE		1			//. hardware decoder transforms when available
+
+//. pulled camera streams, see MiCamera.h
+#define GD_CAMERA_ENABLE		0
+#define GD_CAMERA_URLS			""			//. comma-separated http:// (MJPEG) or rtsp:// streams
+#define GD_CAMERA_WEBHOOK		""
+#define GD_CAMERA_INTERVAL_MS	200			//. at most one frame looked at per interval
+#define GD_CAMERA_SIDE			480			//. long side of the screened copy
+#define GD_CAMERA_MIN_QUALITY	0.5
+#define GD_CAMERA_COOLDOWN_MS	3000		//. after a liveness check
+#define GD_CAMERA_RECONNECT_MS	2000
+#define GD_CAMERA_HARDWARE		1
+
+//. pipeline pool (1 = only the pipeline built by setting_init)
+#define GD_POOL_SIZE			1
+#define GD_POOL_ENGINE_THREADS	0		//. set_num_threads(..., ENGINE), 0 = SDK default
+#define GD_POOL_CORES_PER_SLOT	0		//. pin borrowing thread to a core group, 0 = no pinning
+#define GD_POOL_SHARED			0		//. all slots on one pipeline, weights loaded once
+//. elastic pool, see MiPipelinePool.h
+#define GD_POOL_ELASTIC				0
+#define GD_POOL_MAX_SIZE			0		//. slots at most, 0 = pool.size
+#define GD_POOL_ELASTIC_WAIT_MS		20		//. mean acquire wait that adds a slot
+#define GD_POOL_ELASTIC_IDLE_SEC	120		//. unborrowed that long, a slot beyond pool.size is parked
+#define GD_POOL_ELASTIC_SPARES		1		//. parked slots kept loaded for an instant grow
+#define GD_POOL_ELASTIC_TICK_MS		500
+
+//. work-stealing executor of the batch decodes, see MiExecutor.h
+#define GD_EXECUTOR_ENABLE		1
+#define GD_EXECUTOR_THREADS		0		//. 0 = the cores left by the SDK engine threads
+
+//. adaptive limit of the pipeline calls in flight, see MiLimiter.h
+#define GD_LIMITER_ENABLE		0
+#define GD_LIMITER_MIN			1
+#define GD_LIMITER_MAX			0		//. 0 = cores
+#define GD_LIMITER_INITIAL		0		//. 0 = a quarter of the cores
+#define GD_LIMITER_WINDOW_MS	1000
+#define GD_LIMITER_MIN_SAMPLES	8		//. calls a window needs before it moves the limit
+
+//. stage-pipelined execution, see MiStages.h
+#define GD_STAGES_ENABLE		0
+#define GD_STAGES_INFER_THREADS	0		//. 0 = one per pipeline of the pool
+#define GD_STAGES_INFER_QUEUE	64
+#define GD_STAGES_SEND_THREADS	1		//. reactor mode only
+#define GD_STAGES_SEND_QUEUE	256
+
+//. multipart upload reader, see MiMultipart.h
+#define GD_MULTIPART_FIELD_MAX		(64 * 1024)		//. bytes of one non-file form field
+#define GD_MULTIPART_FIELDS_MAX		100
+#define GD_MULTIPART_HEADER_MAX		(16 * 1024)		//. header block of one part
+#define GD_MULTIPART_BOUNDARY_MAX	200
+
+//. reusable upload buffers
+#define GD_BUFFER_POOL_SIZE		64						//. buffers kept on the free list
+#define GD_BUFFER_POOL_MAX_KEEP	(16 * 1024 * 1024)		//. larger buffers are freed on release
+
+//. size-class pool of decoded pixel buffers, see MiPixelPool.h
+#define GD_PIXEL_POOL_ENABLE	1
+#define GD_PIXEL_POOL_MAX_MB	256						//. free buffers kept in all
+#define GD_PIXEL_POOL_IDLE_S	30						//. free buffers unused that long are released, 0 = never
+#define GD_PIXEL_POOL_MIN_BYTES	(64 * 1024)				//. smallest class, smaller buffers are not pooled
+#define GD_PIXEL_POOL_MAX_BYTES	(1024 * 1024 * 1024)	//. largest class
+#define GD_PIXEL_POOL_ALIGN		64
+#define GD_PIXEL_POOL_LARGE_PAGES	0					//. back large classes by large pages
+#define GD_PIXEL_POOL_LARGE_MIN_BYTES	(8 * 1024 * 1024)	//. smallest class on large pages, a quarter page of slack at most
+
+//. NUMA placement of request threads, pipeline slots and upload buffers, see MiNuma.h
+#define GD_NUMA_ENABLE			0
+#define GD_NUMA_MAX_NODES		8		//. nodes past this share the placement of the last ones
+
+//. io / inference core partition of the reactor mode, see MiCores.h
+#define GD_CORES_ENABLE			false
+#define GD_CORES_IO				2		//. processors for the acceptor and reactors
+
+//. per-thread request arena, see MiArena.h
+#define GD_ARENA_CHUNK			(64 * 1024)				//. bump chunk size
+#define GD_ARENA_RETAIN			(1024 * 1024)			//. chunks kept per thread between requests
+
+//. result cache for repeated uploads of the same image
+#define GD_CACHE_ENABLE			1
+#define GD_CACHE_TTL_SEC		60
+#define GD_CACHE_MAX_MB			16
+#define GD_CACHE_SHARDS			16
+#define GD_CACHE_COALESCE		1				//. identical uploads in flight share one check, see MiCoalesce.h
+
+//. frames of one capture over several requests, see MiSession.h
+#define GD_SESSION_HEADER		"X-Session-Id"
+#define GD_SESSION_ENABLE		false
+#define GD_SESSION_FRAMES		5				//. fused once this many have arrived
+#define GD_SESSION_MAX_FRAMES	16				//. held per session, the oldest go first
+#define GD_SESSION_TTL_SEC		30
+#define GD_SESSION_MAX_MB		256				//. decoded frames of all sessions
+#define GD_SESSION_MAX_SESSIONS	4096
+#define GD_SESSION_SHARDS		16
+
+//. near-duplicate index of face crops, see MiPhash.h
+#define GD_PHASH_ENABLE			0
+#define GD_PHASH_MODE			"flag"			//. "flag" / "reuse"
+#define GD_PHASH_MAX_DISTANCE	6				//. bits, at most 7
+#define GD_PHASH_MAX_ENTRIES	100000
+#define GD_PHASH_TTL_SEC		3600
+#define GD_PHASH_HEADER			"X-Near-Duplicate"	//. Hamming distance to the earlier upload
+
+//. Prometheus metrics on GD_API_METRICS
+#define GD_METRICS_ENABLE		1
+#define GD_METRICS_STAGE_CPU	1		//. thread CPU time of each stage, two clock reads per stage
+//. rolling latency / error windows on GD_API_STATS, see MiStats.h
+#define GD_STATS_ENABLE			1
+#define GD_STATS_SLOT_SEC		10		//. granularity of the 1m / 5m / 15m windows
+#define GD_STATS_ALLOCATIONS	0		//. allocation counts per request and stage, needs a GD_ALLOC_COUNT build (MiAlloc.h)
+//. FaceSDK call timing and outcomes (MiSdkCall.h); 0 compiles the facade down to the bare calls
+#ifndef GD_SDK_INSTRUMENT
+#define GD_SDK_INSTRUMENT		1
+#endif
+
+//. request tracing : one request in GD_TRACE_SAMPLE_EVERY is recorded, 0 = off
+#define GD_TRACE_SAMPLE_EVERY	100
+#define GD_TRACE_RING_SIZE		4096	//. spans kept per thread
+#define GD_TRACE_FOLLOW_PARENT	1		//. an inbound sampled traceparent is always recorded
+//. OTLP/HTTP JSON export of the spans (MiOtlp.h), "" = off
+#define GD_TRACE_OTLP_ENDPOINT		""
+#define GD_TRACE_OTLP_SERVICE		"idliveface"
+#define GD_TRACE_OTLP_BATCH			512
+#define GD_TRACE_OTLP_INTERVAL_MS	1000
+#define GD_TRACE_OTLP_QUEUE			8192
+
+//. sampling profile on GD_API_PROFILE, see MiProfile.h
+#define GD_PROFILE_MAX_SECONDS	60
+#define GD_PROFILE_HZ			99
+
+//. idle trimming of pools, caches and heaps, see MiIdle.h
+#define GD_IDLE_ENABLE			0
+#define GD_IDLE_AFTER_SEC		900
+#define GD_IDLE_POOL_KEEP		0		//. pipeline pool slots kept loaded when idle, 0 = all
+
+//. budget of decoded images in memory, see MiMemBudget.h
+#define GD_MEMORY_BUDGET_MB			0		//. 0 = no budget
+#define GD_MEMORY_UNKNOWN_RATIO		10		//. decoded bytes per encoded byte when the header is not understood
+
+//. JSON-lines access log, see MiAccessLog.h
+#define GD_ACCESS_LOG_ENABLE		0
+#define GD_ACCESS_LOG_PATH			"logs/access.log"
+#define GD_ACCESS_LOG_ROTATION		"100 M"
+#define GD_ACCESS_LOG_PURGE_COUNT	10
+#define GD_ACCESS_LOG_SAMPLE_EVERY	1
+#define GD_ACCESS_LOG_ERRORS		1		//. status >= 400 always logged
+#define GD_ACCESS_LOG_SUMMARY_SEC	0		//. per-endpoint summary line period, 0 = none
+#define GD_ACCESS_LOG_RING			1024	//. records waiting per thread
+#define GD_ACCESS_LOG_FLUSH_MS		200		//. writer wake-up period
+#define GD_REQUEST_ID_HEADER		"X-Request-Id"	//. logged as "id", a counter without it
+
+//. sampled request capture for CorpusReplay capture, see MiCapture.h
+#define GD_CAPTURE_ENABLE			0
+#define GD_CAPTURE_PATH				"logs/capture.bin"
+#define GD_CAPTURE_SAMPLE_EVERY		1
+#define GD_CAPTURE_BODY				0		//. 0 = body hashes only
+#define GD_CAPTURE_MAX_BODY_KB		8192
+#define GD_CAPTURE_MAX_MB			1024
+#define GD_CAPTURE_QUEUE_MB			64
+//. header values never recorded; [capture] redact adds to them.
+#define GD_CAPTURE_REDACT			GD_LANE_KEY_HEADER ", " GD_REQUEST_PROFILE_KEY_HEADER ", Authorization, Proxy-Authorization, Cookie"
+#define GD_CAPTURE_MAGIC			"MICAPT01"	//. 8 bytes, file header
+#define GD_CAPTURE_FLAG_HASH		1		//. record flags : XXH64 of the body is set
+#define GD_CAPTURE_FLAG_BODY		2		//. the body follows the headers
+
+//. per-request cost for chargeback, see MiCost.h
+#define GD_COST_ENABLE				0
+#define GD_COST_HEADER_ENABLE		1		//. cost in the response headers
+#define GD_COST_HEADER				"Server-Timing"
+
+//. per-request debug profile (?profile=1), see MiRequestProfile.h
+#define GD_REQUEST_PROFILE_ENABLE		0
+#define GD_REQUEST_PROFILE_PARAM		"profile"		//. query parameter, 1 asks for the profile
+#define GD_REQUEST_PROFILE_KEY_HEADER	"X-Admin-Key"	//. carries [request_profile] admin_key
+#define GD_REQUEST_PROFILE_MAX_SPANS	256				//. spans kept per request, later ones dropped
+
+//. verdict audit rows through ODBC or MongoDB, see MiAudit.h
+#define GD_AUDIT_ENABLE				0
+#define GD_AUDIT_SINK				"odbc"	//. odbc | mongodb
+#define GD_AUDIT_CONNECT			""
+#define GD_AUDIT_TABLE				"mi_audit"
+#define GD_AUDIT_BATCH_ROWS			500		//. rows per transaction
+#define GD_AUDIT_FLUSH_MS			1000
+#define GD_AUDIT_QUEUE_ROWS			100000
+
+//. admission control of the inference endpoints, see MiAdmission.h
+#define GD_ADMISSION_ENABLE				1
+#define GD_ADMISSION_HEADER				"X-Deadline-Ms"		//. client budget in ms
+#define GD_ADMISSION_MAX_WAIT_MS		0		//. bound on the estimated queue wait without a deadline, 0 = none
+#define GD_ADMISSION_DEFAULT_DEADLINE_MS	0		//. deadline of requests without the header, 0 = none
+#define GD_ADMISSION_CONCURRENCY		0		//. requests served in parallel, 0 = server.inference_workers / max_threads
+#define GD_ADMISSION_DEGRADE_MS			0		//. budget left below which optional steps are skipped, 0 = never, see MiContext.h
+
+//. per-stage timeouts and the SDK call watchdog, see MiWatchdog.h
+#define GD_WATCHDOG_ENABLE				0
+#define GD_WATCHDOG_DECODE_MS			0		//. decode of the uploads, 0 = no limit
+#define GD_WATCHDOG_QUEUE_MS			0		//. wait for a free pipeline pool slot, 0 = no limit
+#define GD_WATCHDOG_LIVENESS_MS			5000	//. one liveness call, 0 = not watched
+#define GD_WATCHDOG_THREADS				64		//. watched calls running at once, stuck ones included
+#define GD_WATCHDOG_TICK_MS				100		//. scan of the pool slots for stuck calls
+
+//. autoscaling signal on GD_API_METRICS and GD_API_SATURATION, see MiSaturation.h
+#define GD_SATURATION_ENABLE			1
+#define GD_SATURATION_SLO_MS			500		//. queue wait that adds 1 to the saturation
+#define GD_SATURATION_WINDOW_SEC		10		//. smoothing
+#define GD_SATURATION_TICK_MS			100
+
+//. cheaper serving while saturated, see MiBrownout.h
+#define GD_BROWNOUT_ENABLE				0
+#define GD_BROWNOUT_ENTER				1.2		//. saturation at which brownout starts
+#define GD_BROWNOUT_EXIT				0.9		//. and below which it ends
+#define GD_BROWNOUT_HOLD_SEC			10		//. least time between two switches
+#define GD_BROWNOUT_BATCH_WAIT_MS		0		//. batch wait cap in brownout
+#define GD_BROWNOUT_ANALYZE_ENGINES		1		//. analyze detectors without the extra models
+#define GD_DEGRADED_HEADER				"X-Degraded"	//. steps skipped for the deadline
+
+//. priority lanes of the inference work, see MiLanes.h
+#define GD_LANE_ENABLE				1
+#define GD_LANE_HEADER				"X-Priority"	//. "interactive" / "bulk"
+#define GD_LANE_KEY_HEADER			"X-Api-Key"
+
+//. tenants, see MiTenants.h ; the key is GD_LANE_KEY_HEADER
+#define GD_TENANTS_ENABLE			false
+#define GD_TENANTS_REQUIRE_KEY		false
+#define GD_TENANTS_RATE				0					//. requests per second of the default tenant, 0 = unlimited
+#define GD_TENANTS_BURST			0					//. 0 = rate
+#define GD_TENANTS_CONCURRENCY		0					//. 0 = unlimited
+
+//. calibration meta, see MiMeta.h
+#define GD_META_DEFAULT				""					//. "" = pipeline defaults, e.g. "soft" / "hardened/ios"
+#define GD_META_TENANTS				""					//. "key=soft,key2=hardened/android"
+#define GD_META_CALIBRATION_HEADER	"X-Calibration"		//. regular / soft / hardened
+#define GD_META_OS_HEADER			"X-Device-Os"		//. android / ios / desktop / unknown
+#define GD_LANE_WEIGHT_INTERACTIVE	8
+#define GD_LANE_WEIGHT_BULK			1
+#define GD_LANE_PERMITS				0		//. classic mode SDK slots, 0 = pool size * batch size
+
+//. warm-up of every pipeline before GD_API_READY reports ready
+#define GD_WARMUP_ENABLE		1
+#define GD_WARMUP_ITERATIONS	2		//. rounds over all batch sizes per pipeline
+
+//. GD_API_HEALTH and its background self-test, see MiHealth.h
+#define GD_HEALTH_SELFTEST_SEC		30		//. 0 = no self-test
+#define GD_HEALTH_FAIL_AFTER		2		//. failed self-tests in a row before GD_API_HEALTH answers 503
+
+//. hot reload of the SDK data into a new pipeline generation, see MiSupervisor.h
+#define GD_RELOAD_WATCH			0		//. watch sdk.config_dir for changes
+#define GD_RELOAD_DEBOUNCE_MS	2000	//. quiet time after the last change before reloading
+#define GD_RELOAD_CANARY_PERCENT	0	//. share of the checks a reloaded generation gets first, 0 = switch at once
+
+//. startup sweep of the threading knobs, see MiAutoTune.h
+#define GD_AUTOTUNE_ENABLE				0
+#define GD_AUTOTUNE_FILE				"autotune.json"
+#define GD_AUTOTUNE_DURATION_MS			2000	//. per grid point
+#define GD_AUTOTUNE_P99_MS				500
+#define GD_AUTOTUNE_ENGINE_THREADS		"0,2,4"
+#define GD_AUTOTUNE_OV_STREAMS			"-1,1,2"
+#define GD_AUTOTUNE_EXECUTION_STREAMS	""
+#define GD_AUTOTUNE_POOL_SIZES			"1,2,4"
+#define GD_AUTOTUNE_THREADS_PER_SLOT	4		//. server.max_threads per pool slot
+#define GD_AUTOTUNE_MIN_THREADS			16
+
+//. OpenVINO compiled-model cache, see MiModelCache.h
+#define GD_MODEL_CACHE_STAMP		"release.txt"	//. IDLive Face version the blobs were compiled by
+#define GD_MODEL_CACHE_PARAMETER	"CACHE_DIR"		//. blueprint RuntimeConfiguration::parameters key
+
+//. how the SDK's inference threads wait for work, see MiWait.h
+#ifndef MI_HAS_TBB
+#define MI_HAS_TBB					0					//. CMake MI_TBB sets it when TBB is found
+#endif
+#define GD_WAIT_POLICY				"active"			//. active or passive
+#define GD_WAIT_TBB_MAX_THREADS		0					//. TBB workers of the process, 0 = TBB default
+#define GD_WAIT_BIND_PARAMETER		"CPU_BIND_THREAD"	//. blueprint RuntimeConfiguration::parameters key, NO when passive
+
+//. model files mapped read-only and shared across workers, see MiModelMap.h
+#define GD_MODEL_MMAP				1
+#define GD_MODEL_MMAP_PARAMETER		"ENABLE_MMAP"	//. blueprint RuntimeConfiguration::parameters key
+
+//. precision pools, see MiPrecision.h
+#define GD_PRECISION_ENABLE			0
+#define GD_PRECISION_PARAMETER		"INFERENCE_PRECISION_HINT"	//. RuntimeConfiguration::parameters key of precision=
+
+//. lazily built engine pools, see MiLazyPool.h
+#define GD_LAZY_RETRY_MS		(5 * 1000)	//. a failed build is not retried sooner
+#define GD_LAZY_EVICT_POLL_MS	1000
+
+//. license refresher, see MiLicense.h; a request without a valid license also wakes it
+#define GD_LICENSE_MAX_POLL_SEC		300
+#define GD_LICENSE_BACKOFF_MIN_MS	500
+#define GD_LICENSE_BACKOFF_MAX_MS	(30 * 1000)
+#define GD_LICENSE_GRACE_SEC		300
+#define GD_LICENSE_NO_LIMIT		32503622400LL	//. expiry from 3000-01-01 on means no limit
@@ -0,0 +1,47 @@
+#include "MiConfig.h"
+#include "MiContext.h"
+#include <atomic>
+#include <iostream>
+
+static ConfigSnapshotRef				lv_pCurrent;		//. atomic_load / atomic_store
+static std::atomic<uint64_t>			lv_nVersion(0);
+
+static thread_local ConfigSnapshotRef	lv_pThread;			//. outside a request
+
+void mi_config_publish(const MiSettings& p_settings)
+{
+	std::shared_ptr<ConfigSnapshot> p = std::make_shared<ConfigSnapshot>();
+	p->settings = p_settings;
+	const MiSettings& s = p->settings;
+	p->verdicts = mi_verdict_build(s.verdictQualityMin, s.verdictGenuineMin, s.verdictUncertainBand, s.verdictDomain, s.verdictTolerance, s.verdictTenants);
+	p->version = ++lv_nVersion;
+	std::atomic_store_explicit(&lv_pCurrent, ConfigSnapshotRef(p), std::memory_order_release);
+}
+
+bool mi_config_reload(std::string& p_strErr)
+{
+	MiSettings s;
+	if (!mi_settings_read(g_Settings.source, s, p_strErr)) return false;
+	mi_config_publish(s);
+	std::cout << "Config : version " << lv_nVersion.load() << " from " << (s.source.empty() ? "defaults" : s.source) << std::endl;
+	return true;
+}
+
+ConfigSnapshotRef mi_config_current()
+{
+	return std::atomic_load_explicit(&lv_pCurrent, std::memory_order_acquire);
+}
+
+const ConfigSnapshot* mi_config_snapshot()
+{
+	RequestContext* ctx = mi_context();
+	if (ctx != NULL && ctx->config) return ctx->config.get();
+	lv_pThread = mi_config_current();
+	return lv_pThread.get();
+}
+
+const MiSettings& mi_config()
+{
+	const ConfigSnapshot* p = mi_config_snapshot();
+	return p != NULL ? p->settings : g_Settings;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MiSettings.h"
+#include "MiVerdict.h"
+
+//. Runtime configuration snapshots : a reload (GD_API_ADMIN_CONFIG POST) reads the settings
+//. file again and builds a new ConfigSnapshot with the tables compiled from it (verdict
+//. policies per tenant), which is never changed afterwards and is published with one atomic
+//. store. RequestScope pins the current snapshot into the request context once, so a request
+//. sees one configuration from its first stage to its response whatever reloads happen
+//. meanwhile, and no reader takes a lock : the old snapshot is freed when its last request ends.
+//. What follows a reload is what requests read through mi_config() / mi_config_snapshot() :
+//. body limits (server.max_body_mb), the default response schema, the [verdict] and the
+//. [prefilter] thresholds. Everything sized or started at launch (ports, threads, pools, queues, the
+//. [tenants] list and its buckets) keeps g_Settings and needs a restart.
+
+struct ConfigSnapshot {
+	uint64_t					version;		//. 1 = the settings read at startup
+	MiSettings					settings;
+	std::vector<VerdictPolicy>	verdicts;		//. by tenant index (MiTenants.h), [0] = default
+};
+
+typedef std::shared_ptr<const ConfigSnapshot> ConfigSnapshotRef;
+
+//. compiles p_settings into the next snapshot and publishes it; the tenants must be set up.
+void mi_config_publish(const MiSettings& p_settings);
+//. reads g_Settings.source again and publishes it; false with the reason on a file that
+//. cannot be read, the current snapshot stays.
+bool mi_config_reload(std::string& p_strErr);
+
+//. the latest snapshot, NULL before the first publish.
+ConfigSnapshotRef mi_config_current();
+//. snapshot of the request on this thread; outside a request the thread pins the latest one
+//. itself, until its next call. NULL before the first publish.
+const ConfigSnapshot* mi_config_snapshot();
+//. settings of mi_config_snapshot(), g_Settings before the first publish.
+const MiSettings& mi_config();
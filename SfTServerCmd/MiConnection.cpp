@@ -0,0 +1,133 @@
+#include "MiConnection.h"
+#include "MiMetrics.h"
+#include "MiReactorHttp.h"
+#include "MiSettings.h"
+#include "Poco/Net/HTTPServerConnection.h"
+#include "Poco/Net/HTTPServerRequestImpl.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/File.h"
+#include "MiLock.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+static MI_MUTEX(lv_mtxStamps, "connection.stamps");
+static std::unordered_map<poco_socket_t, std::chrono::steady_clock::time_point>	lv_mapStamps;
+
+void mi_socket_tune(Poco::Net::StreamSocket& p_socket)
+{
+	try {
+		//. TCP_NODELAY does not exist on the local socket; on Linux it would throw on every accept.
+		bool bTcp = true;
+#if defined(POCO_HAS_UNIX_SOCKET)
+		bTcp = p_socket.address().family() != Poco::Net::SocketAddress::UNIX_LOCAL;
+#endif
+		if (g_Settings.tcpNoDelay && bTcp) p_socket.setNoDelay(true);
+		if (g_Settings.sendBufferKb > 0) p_socket.setSendBufferSize(g_Settings.sendBufferKb * 1024);
+		if (g_Settings.recvBufferKb > 0) p_socket.setReceiveBufferSize(g_Settings.recvBufferKb * 1024);
+	}
+	catch (Poco::Exception&) {
+		//. a refused option keeps the OS default, the connection is still usable.
+	}
+}
+
+bool mi_reuse_port()
+{
+#if defined(POCO_OS_FAMILY_UNIX)
+	return g_Settings.reusePort;
+#else
+	return false;
+#endif
+}
+
+Poco::Net::ServerSocket mi_listen_socket(int p_nPort)
+{
+	Poco::Net::ServerSocket socket;
+	socket.bind(Poco::Net::SocketAddress(Poco::Net::IPAddress(), (Poco::UInt16)(p_nPort > 0 ? p_nPort : g_Settings.port)), true, mi_reuse_port());
+	socket.listen(g_Settings.listenBacklog > 0 ? g_Settings.listenBacklog : 64);
+	return socket;
+}
+
+int mi_listeners()
+{
+	if (!mi_reuse_port()) return 1;
+	return std::max(1, std::min(g_Settings.listeners, MI_LISTENERS_MAX));
+}
+
+Poco::Net::ServerSocket mi_local_listen_socket()
+{
+#if defined(POCO_HAS_UNIX_SOCKET)
+	//. a file left by a killed process makes bind fail with EADDRINUSE.
+	mi_local_socket_remove();
+	Poco::Net::ServerSocket socket;
+	socket.bind(Poco::Net::SocketAddress(Poco::Net::SocketAddress::UNIX_LOCAL, g_Settings.localSocket));
+	socket.listen(g_Settings.listenBacklog > 0 ? g_Settings.listenBacklog : 64);
+	return socket;
+#else
+	throw Poco::NotImplementedException("Unix domain sockets are not available in this build");
+#endif
+}
+
+void mi_local_socket_remove()
+{
+	try {
+		Poco::File file(g_Settings.localSocket);
+		if (!g_Settings.localSocket.empty() && file.exists()) file.remove();
+	}
+	catch (Poco::Exception&) {
+	}
+}
+
+bool mi_local_client(const Poco::Net::SocketAddress& p_addr)
+{
+#if defined(POCO_HAS_UNIX_SOCKET)
+	if (p_addr.family() == Poco::Net::SocketAddress::UNIX_LOCAL) return true;
+#endif
+	return p_addr.host().isLoopback();
+}
+
+Poco::Net::StreamSocket* mi_request_socket(Poco::Net::HTTPServerRequest& p_request)
+{
+	Poco::Net::HTTPServerRequestImpl* pClassic = dynamic_cast<Poco::Net::HTTPServerRequestImpl*>(&p_request);
+	if (pClassic != NULL) return &pClassic->socket();
+	ReactorServerRequest* pReactor = dynamic_cast<ReactorServerRequest*>(&p_request);
+	return pReactor != NULL ? pReactor->socket() : NULL;
+}
+
+bool mi_socket_closed(Poco::Net::StreamSocket& p_socket)
+{
+	try {
+		if (!p_socket.poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_READ | Poco::Net::Socket::SELECT_ERROR)) return false;
+		//. readable : either the next pipelined request or the end of the stream.
+		char c;
+		return p_socket.receiveBytes(&c, 1, MSG_PEEK) <= 0;
+	}
+	catch (Poco::Exception&) {
+		return true;
+	}
+}
+
+bool AcceptStamp::accept(const Poco::Net::StreamSocket& p_socket)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	MiLockGuard lock(lv_mtxStamps);
+	lv_mapStamps[p_socket.impl()->sockfd()] = now;
+	return true;
+}
+
+Poco::Net::TCPServerConnection* TunedConnectionFactory::createConnection(const Poco::Net::StreamSocket& p_socket)
+{
+	std::chrono::steady_clock::time_point stamp;
+	{
+		MiLockGuard lock(lv_mtxStamps);
+		auto it = lv_mapStamps.find(p_socket.impl()->sockfd());
+		if (it != lv_mapStamps.end()) {
+			stamp = it->second;
+			lv_mapStamps.erase(it);
+		}
+	}
+	if (stamp != std::chrono::steady_clock::time_point()) mi_metrics_accept_wait(std::chrono::duration<double>(std::chrono::steady_clock::now() - stamp).count());
+	Poco::Net::StreamSocket socket(p_socket);
+	mi_socket_tune(socket);
+	return new Poco::Net::HTTPServerConnection(socket, m_pParams, m_pFactory);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/TCPServer.h"
+#include "Poco/Net/TCPServerConnectionFactory.h"
+
+//. Client connection setup shared by both server modes ([server] settings) :
+//. TCP_NODELAY so a small JSON response is not held back by Nagle while the client
+//. waits for it on a kept-alive connection, optional socket buffer sizes, and the
+//. listen backlog for bursts of new connections from a gateway.
+//. Keep-alive itself is HTTPServerParams (classic) / ReactorConnection (reactor) / ProactorConnection (proactor).
+//. server.local_socket adds a Unix domain socket listener on the same handlers, for a
+//. sidecar caller on the same host (no TCP / loopback stack in the way).
+//. server.reuse_port (Linux) binds every listen socket with SO_REUSEPORT : the kernel then
+//. spreads new connections over all the sockets bound to the port, in this process
+//. (server.listeners sockets, each with its own accept thread, classic and proactor modes)
+//. and in other processes started with the same setting (MI_SERVER_REUSE_PORT=1), which
+//. replaces the mi_id_svc workers-behind-a-proxy layout on a Linux host. Every process
+//. binds the binary, HTTP/2 and TLS ports the same way. Windows has no balancing
+//. SO_REUSEPORT : there the setting is ignored and a single listener is used.
+
+#define MI_LISTENERS_MAX		16
+
+//. applies the [server] socket options to an accepted connection.
+void mi_socket_tune(Poco::Net::StreamSocket& p_socket);
+
+//. server.reuse_port where the OS balances over SO_REUSEPORT sockets.
+bool mi_reuse_port();
+//. listening socket on [server] port (or p_nPort) with [server] listen_backlog and reuse_port.
+Poco::Net::ServerSocket mi_listen_socket(int p_nPort = 0);
+//. listen sockets on [server] port : server.listeners with reuse_port, else 1.
+int mi_listeners();
+//. listening socket on [server] local_socket (a Unix domain socket), throws where unsupported.
+Poco::Net::ServerSocket mi_local_listen_socket();
+//. deletes the local_socket file after its listener stopped.
+void mi_local_socket_remove();
+//. a loopback TCP peer or one on the local socket : what "localhost only" routes accept.
+bool mi_local_client(const Poco::Net::SocketAddress& p_addr);
+
+//. connection of a request for mi_socket_closed : the classic server's and the reactor's,
+//. NULL for HTTP/2 streams (one socket for many requests).
+Poco::Net::StreamSocket* mi_request_socket(Poco::Net::HTTPServerRequest& p_request);
+//. the peer closed or reset the connection (a pending next request does not count). Does not
+//. block or consume anything. A client that half-closes after sending its request reads as
+//. closed, see [server] cancel_on_disconnect.
+bool mi_socket_closed(Poco::Net::StreamSocket& p_socket);
+
+//. stamps every connection the classic server accepts (TCPServer::setConnectionFilter, on
+//. the accept thread); TunedConnectionFactory takes the stamp back when a worker thread
+//. picks the connection up, which gives the time it waited in the max_queued queue
+//. (mi_http_accept_wait_seconds). Stamps are kept by descriptor : a refused connection's
+//. is overwritten by the next one the OS gives that descriptor.
+class AcceptStamp : public Poco::Net::TCPServerConnectionFilter {
+public:
+	bool accept(const Poco::Net::StreamSocket& p_socket) override;
+};
+
+//. HTTPServerConnectionFactory with mi_socket_tune on every accepted socket.
+class TunedConnectionFactory : public Poco::Net::TCPServerConnectionFactory {
+public:
+	TunedConnectionFactory(Poco::Net::HTTPServerParams::Ptr p_pParams, Poco::Net::HTTPRequestHandlerFactory::Ptr p_pFactory)
+		: m_pParams(p_pParams), m_pFactory(p_pFactory) {}
+
+	Poco::Net::TCPServerConnection* createConnection(const Poco::Net::StreamSocket& p_socket) override;
+
+private:
+	Poco::Net::HTTPServerParams::Ptr			m_pParams;
+	Poco::Net::HTTPRequestHandlerFactory::Ptr	m_pFactory;
+};
@@ -0,0 +1,135 @@
+#include "MiContext.h"
+#include "MiAccessLog.h"
+#include "MiAdmission.h"
+#include "MiConfig.h"
+#include "MiConnection.h"
+#include "MiMetrics.h"
+#include "MiOtlp.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace std::chrono;
+
+static int								lv_nDegradeMs = 0;
+static bool								lv_bCancel = false;
+static thread_local RequestContext*		lv_pCurrent = NULL;
+static const std::string				lv_strEmpty;
+
+static const char* lv_szSteps[MI_DEGRADE_COUNT] = { "gate", "fusion", "scale", "brownout" };
+
+long long RequestContext::remaining_ms() const
+{
+	if (!has_deadline()) return 1LL << 40;
+	return duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+}
+
+void mi_context_init(int p_nDegradeMs, bool p_bCancel)
+{
+	lv_nDegradeMs = p_nDegradeMs > 0 ? p_nDegradeMs : 0;
+	lv_bCancel = p_bCancel;
+}
+
+RequestContext* mi_context()
+{
+	return lv_pCurrent;
+}
+
+static void context_record(RequestContext* p_pCtx, DegradeStep p_step)
+{
+	if ((p_pCtx->degraded & p_step) != 0) return;
+	p_pCtx->degraded |= p_step;
+	for (int i = 0; i < MI_DEGRADE_COUNT; i++) {
+		if (p_step == (1 << i)) mi_metrics_degrade(i);
+	}
+}
+
+bool mi_context_degrade(DegradeStep p_step)
+{
+	RequestContext* ctx = lv_pCurrent;
+	if (lv_nDegradeMs == 0 || ctx == NULL || !ctx->has_deadline()) return false;
+	if (ctx->remaining_ms() >= lv_nDegradeMs) return false;
+	context_record(ctx, p_step);
+	return true;
+}
+
+void mi_context_mark(DegradeStep p_step)
+{
+	if (lv_pCurrent != NULL) context_record(lv_pCurrent, p_step);
+}
+
+bool mi_context_client_gone(int p_nAt, RequestContext* p_pCtx)
+{
+	RequestContext* ctx = p_pCtx != NULL ? p_pCtx : lv_pCurrent;
+	if (ctx == NULL || ctx->client == NULL) return false;
+	if (ctx->gone.load(std::memory_order_relaxed)) return true;
+	if (!mi_socket_closed(*ctx->client)) return false;
+	//. the request thread and the batcher may both find it : counted once.
+	if (!ctx->gone.exchange(true)) mi_metrics_cancel(p_nAt);
+	return true;
+}
+
+bool RequestContext::decoded(const void* p_pSource)
+{
+	decodes.fetch_add(1, std::memory_order_relaxed);
+	if (p_pSource == NULL) return false;
+	for (int i = 0; i < MI_CONTEXT_SOURCES; i++) {
+		const void* p = sources[i].load(std::memory_order_acquire);
+		if (p == NULL && sources[i].compare_exchange_strong(p, p_pSource, std::memory_order_acq_rel)) return false;
+		if (p == p_pSource) return true;
+	}
+	return false;
+}
+
+steady_clock::time_point mi_context_hold_limit()
+{
+	RequestContext* ctx = lv_pCurrent;
+	if (ctx == NULL || !ctx->has_deadline()) return steady_clock::time_point();
+	return ctx->deadline - milliseconds(lv_nDegradeMs);
+}
+
+void mi_context_degraded_text(unsigned p_nSteps, char* p_pszOut, size_t p_nSize)
+{
+	size_t n = 0;
+	p_pszOut[0] = 0;
+	for (int i = 0; i < MI_DEGRADE_COUNT; i++) {
+		if ((p_nSteps & (1u << i)) == 0) continue;
+		int w = snprintf(p_pszOut + n, p_nSize - n, "%s%s", n > 0 ? "," : "", lv_szSteps[i]);
+		if (w < 0 || (size_t)w >= p_nSize - n) break;
+		n += (size_t)w;
+	}
+}
+
+const char* mi_degrade_step_name(int p_nStep)
+{
+	return p_nStep >= 0 && p_nStep < MI_DEGRADE_COUNT ? lv_szSteps[p_nStep] : "unknown";
+}
+
+RequestScope::RequestScope(Poco::Net::HTTPServerRequest& p_request)
+	: m_pPrev(lv_pCurrent)
+{
+	mi_request_id(p_request, m_ctx.traceId, sizeof(m_ctx.traceId));
+	m_ctx.config = mi_config_current();
+	if (lv_bCancel) m_ctx.client = mi_request_socket(p_request);
+	mi_cost_begin(m_ctx, p_request);
+	lv_pCurrent = &m_ctx;
+	mi_request_profile_begin(m_ctx, p_request, mi_admission_arrival());
+	mi_trace_begin(m_ctx.trace, p_request.get(MI_TRACEPARENT_HEADER, lv_strEmpty), mi_admission_arrival());
+}
+
+RequestScope::~RequestScope()
+{
+	mi_trace_end(m_ctx.trace);
+	mi_cost_end(m_ctx);
+	lv_pCurrent = m_pPrev;
+}
+
+ContextBorrow::ContextBorrow(RequestContext* p_pCtx)
+	: m_pPrev(lv_pCurrent)
+{
+	lv_pCurrent = p_pCtx;
+}
+
+ContextBorrow::~ContextBorrow()
+{
+	lv_pCurrent = m_pPrev;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "MiCost.h"
+#include "MiHash.h"
+#include "MiRequestProfile.h"
+#include "MiTrace.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/StreamSocket.h"
+
+//. Request context : what the stages of one request need to know about it, created by
+//. RequestScope in MyRequestHandler::handleRequest and reached with mi_context() from
+//. the request thread (decode, lanes, batcher, gate), like the other per-request state.
+//. AdmissionTicket fills the deadline (X-Deadline-Ms / [admission] default_deadline_ms),
+//. TenantTicket the tenant, the trace id is the X-Request-Id of the access log, the
+//. configuration snapshot current when the request started stays its own (MiConfig.h), and
+//. its traceparent decides its spans (MiTrace.h).
+//. With [admission] degrade_ms, a stage finding less budget left skips its optional work
+//. (DegradeStep) and the response says so in GD_DEGRADED_HEADER ("gate,fusion") and, in
+//. the v2 schema, "degraded":true; the batcher stops holding such a request for a fuller
+//. batch. mi_degraded_total on /metrics counts the skipped steps.
+//. With [server] cancel_on_disconnect the connection of the request is kept too : a client
+//. that gave up and closed it no longer costs a check. Admission (after the wait for a
+//. worker), mi_admission_expired (before the SDK calls) and the batcher (before a batch is
+//. dispatched) drop such a request, mi_cancelled_total{at} counts them. Off by default : a
+//. client that half-closes after sending its request cannot be told from one that left.
+
+enum DegradeStep {
+	MI_DEGRADE_GATE		= 1,	//. detection / quality pre-checks, liveness still runs (MiGate.h)
+	MI_DEGRADE_FUSION	= 2,	//. sequence checked on its last frame only
+	MI_DEGRADE_SCALE	= 4,	//. JPEG decoded one DCT scale smaller (MiDecode.h)
+	MI_DEGRADE_BROWNOUT	= 8,	//. served in brownout mode, whatever the budget (MiBrownout.h)
+	MI_DEGRADE_COUNT	= 4
+};
+
+#define MI_CONTEXT_SOURCES	8		//. decoded uploads told apart for the repeats (MiImage.h)
+#define MI_IMAGE_PIXELS		(1ULL << 63)	//. RequestContext::imageSize of decoded pixels, never equal to an upload's
+
+struct ConfigSnapshot;	//. MiConfig.h
+
+struct RequestContext {
+	std::chrono::steady_clock::time_point	deadline;	//. epoch = none
+	int										tenant;		//. MiTenants.h index, -1 = none
+	char									traceId[48];
+	unsigned								degraded;	//. DegradeStep bits skipped so far
+	int										nearDistance;	//. GD_PHASH_HEADER bits (MiPhash.h), -1 = none
+	uint64_t								imageHash;		//. mi_hash64 of the image handed to the SDK (MiDedup.h)
+	uint64_t								imageSize;		//. its size, MI_IMAGE_PIXELS set for pixels, 0 = none
+	uint8_t									imageDigest[MI_DIGEST_SIZE];	//. mi_digest256 of it, confirms a duplicate
+	Poco::Net::StreamSocket*				client;		//. connection to probe, NULL = not probed
+	std::atomic<bool>						gone;		//. the client was found disconnected, also by the batcher thread
+	int										timeout;	//. MiWatchdog.h WatchStage it ran out of, -1 = none
+	bool									canary;		//. checked by the [reload] canary, its result is not shared
+	//. uploads decoded for the request, also from the executor threads decoding a batch.
+	std::atomic<int>						decodes;
+	std::atomic<const void*>				sources[MI_CONTEXT_SOURCES];
+	RequestCost								cost;		//. [cost], see MiCost.h
+	std::shared_ptr<const ConfigSnapshot>	config;		//. pinned for the whole request, see MiConfig.h
+	TraceState								trace;		//. W3C trace of the request, see MiTrace.h
+	std::unique_ptr<RequestProfile>			profile;	//. ?profile=1, NULL = none, see MiRequestProfile.h
+
+	RequestContext() : tenant(-1), degraded(0), nearDistance(-1), imageHash(0), imageSize(0), client(NULL), gone(false), timeout(-1), canary(false), decodes(0)
+	{
+		traceId[0] = 0;
+		for (int i = 0; i < MI_CONTEXT_SOURCES; i++) sources[i].store(NULL, std::memory_order_relaxed);
+	}
+
+	bool has_deadline() const { return deadline != std::chrono::steady_clock::time_point(); }
+	//. counts one decode of p_pSource; true when the request had decoded it already
+	//. (only the first MI_CONTEXT_SOURCES sources are told apart).
+	bool decoded(const void* p_pSource);
+	//. budget left in ms (negative once past), a large value without a deadline.
+	long long remaining_ms() const;
+};
+
+//. p_nDegradeMs : remaining budget below which optional steps are skipped, 0 = never.
+//. p_bCancel : probe the client connection of requests (mi_context_client_gone).
+void mi_context_init(int p_nDegradeMs, bool p_bCancel);
+
+//. context of the request handled on this thread, NULL outside one (jobs, warm-up).
+RequestContext* mi_context();
+
+//. true when the current request is short of budget : p_step is recorded as skipped.
+bool mi_context_degrade(DegradeStep p_step);
+//. records p_step on the current request regardless of its budget (a server-wide mode).
+void mi_context_mark(DegradeStep p_step);
+
+//. true once the client of p_pCtx (the current request when NULL) has closed or reset its
+//. connection, so its work can stop; counted at p_nAt (a MiMetrics.h MiCancel) the first time.
+//. p_pCtx may be the context of a request thread waiting on the caller (batcher).
+bool mi_context_client_gone(int p_nAt, RequestContext* p_pCtx = NULL);
+
+//. deadline of the current request less the degrade margin, epoch when there is none;
+//. work held for throughput (batching) should not outlast it.
+std::chrono::steady_clock::time_point mi_context_hold_limit();
+
+//. "gate" / "fusion" / "scale" / "brownout" of step bit p_nStep.
+const char* mi_degrade_step_name(int p_nStep);
+
+//. "gate,fusion" of the skipped steps into p_pszOut, empty when none.
+void mi_context_degraded_text(unsigned p_nSteps, char* p_pszOut, size_t p_nSize);
+
+//. installs the context of one request on the calling thread.
+class RequestScope {
+public:
+	explicit RequestScope(Poco::Net::HTTPServerRequest& p_request);
+	~RequestScope();
+
+	RequestContext& context() { return m_ctx; }
+
+private:
+	RequestScope(const RequestScope&) = delete;
+	RequestScope& operator=(const RequestScope&) = delete;
+
+	RequestContext		m_ctx;
+	RequestContext*		m_pPrev;
+};
+
+//. installs the context of a request handled on another thread for one call made on
+//. its behalf (MiStages.h); that thread waits for the call, so the context is not shared.
+class ContextBorrow {
+public:
+	explicit ContextBorrow(RequestContext* p_pCtx);
+	~ContextBorrow();
+
+private:
+	ContextBorrow(const ContextBorrow&) = delete;
+	ContextBorrow& operator=(const ContextBorrow&) = delete;
+
+	RequestContext*		m_pPrev;
+};
@@ -0,0 +1,91 @@
+#include "MiCores.h"
+#include "MiPlatform.h"
+#include <stdint.h>
+#include <stdio.h>
+
+static bool			lv_bEnabled = false;
+static uint64_t		lv_nMasks[MI_CORES_SET_COUNT];
+static MiAffinity	lv_affinity[MI_CORES_SET_COUNT];
+
+static int popcount(uint64_t p_nMask)
+{
+	int n = 0;
+	for (; p_nMask != 0; p_nMask &= p_nMask - 1) n++;
+	return n;
+}
+
+//. "0-1,4" from the bits of p_nMask.
+static std::string cpu_list(uint64_t p_nMask)
+{
+	std::string strList;
+	for (int i = 0; i < 64; i++) {
+		if (!(p_nMask & ((uint64_t)1 << i))) continue;
+		int j = i;
+		while (j + 1 < 64 && (p_nMask & ((uint64_t)1 << (j + 1)))) j++;
+		if (!strList.empty()) strList += ",";
+		strList += std::to_string(i);
+		if (j > i) strList += "-" + std::to_string(j);
+		i = j;
+	}
+	return strList;
+}
+
+void mi_cores_init(bool p_bEnable, int p_nIoCores)
+{
+	lv_bEnabled = false;
+	if (!p_bEnable || p_nIoCores <= 0) return;
+
+	uint64_t nProcess = mi_process_affinity_mask();
+	if (popcount(nProcess) <= p_nIoCores) {
+		printf("Cores : %d processor(s) available, cores.io = %d leaves none for inference, partition off\n", popcount(nProcess), p_nIoCores);
+		return;
+	}
+	uint64_t nIo = 0;
+	int nTaken = 0;
+	for (int i = 0; i < 64 && nTaken < p_nIoCores; i++) {
+		if (!(nProcess & ((uint64_t)1 << i))) continue;
+		nIo |= (uint64_t)1 << i;
+		nTaken++;
+	}
+	lv_nMasks[MI_CORES_IO] = nIo;
+	lv_nMasks[MI_CORES_INFERENCE] = nProcess & ~nIo;
+	for (int i = 0; i < MI_CORES_SET_COUNT; i++) mi_affinity_from_mask(lv_nMasks[i], lv_affinity[i]);
+	lv_bEnabled = true;
+
+	//. the threads the main thread starts from here on inherit it (Linux).
+	mi_cores_pin(MI_CORES_INFERENCE);
+	printf("Cores : %s\n", mi_cores_describe().c_str());
+}
+
+bool mi_cores_enabled()
+{
+	return lv_bEnabled;
+}
+
+void mi_cores_pin(MiCoreSet p_set)
+{
+	if (!lv_bEnabled) return;
+	mi_thread_set_affinity(lv_affinity[p_set]);
+}
+
+int mi_cores_count(MiCoreSet p_set)
+{
+	return lv_bEnabled ? popcount(lv_nMasks[p_set]) : 0;
+}
+
+const char* mi_cores_set_name(int p_nSet)
+{
+	static const char* s_names[MI_CORES_SET_COUNT] = { "io", "inference" };
+	return p_nSet >= 0 && p_nSet < MI_CORES_SET_COUNT ? s_names[p_nSet] : "unknown";
+}
+
+std::string mi_cores_describe()
+{
+	if (!lv_bEnabled) return "";
+	std::string strOut;
+	for (int i = 0; i < MI_CORES_SET_COUNT; i++) {
+		if (!strOut.empty()) strOut += ", ";
+		strOut += std::string(mi_cores_set_name(i)) + " " + cpu_list(lv_nMasks[i]);
+	}
+	return strOut;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+//. Core partition ([cores], server.mode = reactor) : the first cores.io processors the
+//. process may run on are kept for the threads that move bytes, the others for the ones
+//. that compute, so socket work does not preempt the SDK's TBB workers and the reactors
+//. are not starved by them.
+//. - io : the acceptor and the io_threads reactors (ParallelSocketAcceptor), the [stages]
+//.   send threads;
+//. - inference : the inference_workers and quality workers, the decode executor, the
+//.   [stages] decode and pipeline threads.
+//. The main thread is pinned to the inference processors at startup : on Linux every
+//. thread started afterwards inherits them, the SDK's TBB workers included. On Windows a
+//. new thread keeps the process affinity, so only the threads above are placed (TBB
+//. follows the process mask there).
+//. Processors 0..63 (group 0 on Windows). Off with [numa] enable, or when fewer than
+//. cores.io + 1 processors are available. Counts per set in mi_cores_processors{set}.
+
+enum MiCoreSet {
+	MI_CORES_IO = 0,
+	MI_CORES_INFERENCE,
+	MI_CORES_SET_COUNT
+};
+
+void mi_cores_init(bool p_bEnable, int p_nIoCores);
+bool mi_cores_enabled();
+
+//. pins the calling thread to p_set; no-op when off.
+void mi_cores_pin(MiCoreSet p_set);
+
+//. processors of p_set, 0 when off.
+int mi_cores_count(MiCoreSet p_set);
+const char* mi_cores_set_name(int p_nSet);
+//. "io 0-1, inference 2-15", empty when off.
+std::string mi_cores_describe();
@@ -0,0 +1,90 @@
+#include "MiCost.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "MiSdkCall.h"
+#include <stdio.h>
+
+static bool		lv_bEnabled = false;
+static bool		lv_bHeader = false;
+
+void mi_cost_init(bool p_bEnable, bool p_bHeader)
+{
+	lv_bEnabled = p_bEnable;
+	lv_bHeader = p_bEnable && p_bHeader;
+}
+
+bool mi_cost_enabled()
+{
+	return lv_bEnabled;
+}
+
+//. the stages the access log counts as decode.
+static bool decode_stage(int p_nStage)
+{
+	switch (p_nStage) {
+	case MI_STAGE_INGEST:
+	case MI_STAGE_IMAGE_CREATE:
+	case MI_STAGE_CROP:
+	case MI_STAGE_DECODE:
+	case MI_STAGE_CONVERT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void mi_cost_stage(int p_nStage, uint64_t p_nCpuNs)
+{
+	RequestContext* ctx = lv_bEnabled ? mi_context() : NULL;
+	if (ctx == NULL || p_nStage < 0 || p_nStage >= MI_STAGE_COUNT) return;
+	ctx->cost.stages.fetch_or(1u << p_nStage, std::memory_order_relaxed);
+	if (p_nCpuNs != 0 && decode_stage(p_nStage)) ctx->cost.decodeCpuNs.fetch_add(p_nCpuNs, std::memory_order_relaxed);
+}
+
+void mi_cost_sdk_call(int p_nCall, double p_dSec)
+{
+	//. image creation decodes, its CPU is in the stage that made it.
+	if (!lv_bEnabled || p_nCall <= MI_SDK_IMAGE_CREATE_PIXELS || p_nCall == MI_SDK_CPP_CREATE_IMAGE) return;
+	//. the batcher's thread has no context, it charges the shares itself.
+	mi_cost_infer(mi_context(), p_dSec);
+}
+
+void mi_cost_infer(RequestContext* p_pCtx, double p_dSec)
+{
+	if (!lv_bEnabled || p_pCtx == NULL || p_dSec <= 0) return;
+	p_pCtx->cost.inferNs.fetch_add((uint64_t)(p_dSec * 1e9), std::memory_order_relaxed);
+}
+
+void mi_cost_begin(RequestContext& p_ctx, const Poco::Net::HTTPServerRequest& p_request)
+{
+	if (lv_bEnabled && p_request.hasContentLength()) p_ctx.cost.bytes.store((uint64_t)p_request.getContentLength64(), std::memory_order_relaxed);
+}
+
+void mi_cost_end(RequestContext& p_ctx)
+{
+	if (!lv_bEnabled) return;
+	const RequestCost& c = p_ctx.cost;
+	mi_metrics_tenant_cost(p_ctx.tenant, c.decodeCpuNs.load(std::memory_order_relaxed) * 1e-9, c.inferNs.load(std::memory_order_relaxed) * 1e-9,
+		c.bytes.load(std::memory_order_relaxed), c.stages.load(std::memory_order_relaxed));
+}
+
+std::string mi_cost_header(const RequestContext& p_ctx)
+{
+	if (!lv_bHeader) return std::string();
+	const RequestCost& c = p_ctx.cost;
+	char sz[128];
+	snprintf(sz, sizeof(sz), "decode;dur=%.2f, infer;dur=%.2f, bytes;desc=\"%llu\", stages;desc=\"",
+		c.decodeCpuNs.load(std::memory_order_relaxed) * 1e-6, c.inferNs.load(std::memory_order_relaxed) * 1e-6,
+		(unsigned long long)c.bytes.load(std::memory_order_relaxed));
+	std::string strOut = sz;
+	unsigned nStages = c.stages.load(std::memory_order_relaxed);
+	bool bFirst = true;
+	for (int i = 0; i < MI_STAGE_COUNT; i++) {
+		if ((nStages & (1u << i)) == 0) continue;
+		if (!bFirst) strOut += ",";
+		strOut += mi_metrics_stage_name((MiStage)i);
+		bFirst = false;
+	}
+	strOut += "\"";
+	return strOut;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include "Poco/Net/HTTPServerRequest.h"
+
+struct RequestContext;
+
+//. Per-request cost model ([cost] settings) for chargeback across tenants. Each request
+//. adds up in its RequestContext (MiContext.h) :
+//. - decode : thread CPU of the stages that turn the upload into pixels (ingest,
+//.   image_create, crop, decode, convert; the decode_ms of the access log), read by StageTimer;
+//. - infer : time of the SDK calls made for it past image creation (MiSdkCall.h); a batch of
+//.   the micro-batcher (MiBatcher.h) is charged to its images in equal shares, so the share
+//.   of a request falls as the batches fill;
+//. - bytes : the declared upload, the Content-Length (bytes_in of the access log);
+//. - stages : the MiStage steps that ran ("ingest,gate,liveness"), how far the gate, the
+//.   crop path and the cascade took it.
+//. With header the response has them in GD_COST_HEADER as of when its headers are written :
+//.   Server-Timing: decode;dur=1.84, infer;dur=12.30, bytes;desc="183422", stages;desc="ingest,liveness"
+//. When the request ends they are added to its tenant (MiTenants.h, "none" without [tenants]
+//. or for a refused key) : mi_tenant_decode_cpu_seconds_total, mi_tenant_inference_seconds_total,
+//. mi_tenant_bytes_total and mi_tenant_stage_requests_total{stage} on GD_API_METRICS.
+//. infer needs the timed SDK facade (GD_SDK_INSTRUMENT); work a request hands to another
+//. thread is charged there only where that thread installs its context (MiStages.h).
+
+struct RequestCost {
+	std::atomic<uint64_t>	decodeCpuNs;
+	std::atomic<uint64_t>	inferNs;
+	std::atomic<uint64_t>	bytes;
+	std::atomic<unsigned>	stages;			//. 1 << MiStage of the stages run
+
+	RequestCost() : decodeCpuNs(0), inferNs(0), bytes(0), stages(0) {}
+};
+
+void mi_cost_init(bool p_bEnable, bool p_bHeader);
+bool mi_cost_enabled();
+
+//. one p_nStage (a MiStage) of the current request that took p_nCpuNs of thread CPU,
+//. 0 when it was not read.
+void mi_cost_stage(int p_nStage, uint64_t p_nCpuNs);
+//. p_dSec of one SdkCall (MiSdkCall.h) made on the current request's behalf.
+void mi_cost_sdk_call(int p_nCall, double p_dSec);
+//. p_dSec of inference charged to p_pCtx, a request waiting on the calling thread.
+void mi_cost_infer(RequestContext* p_pCtx, double p_dSec);
+
+//. RequestScope : the start and the end of the request of p_ctx.
+void mi_cost_begin(RequestContext& p_ctx, const Poco::Net::HTTPServerRequest& p_request);
+void mi_cost_end(RequestContext& p_ctx);
+
+//. GD_COST_HEADER value of p_ctx so far, empty when the header is off.
+std::string mi_cost_header(const RequestContext& p_ctx);
@@ -0,0 +1,222 @@
+#include "MiCppBackend.h"
+#include "MiContext.h"
+#include "MiExecutor.h"
+#include "MiImage.h"
+#include "MiMetrics.h"
+#include "MiSdkCall.h"
+#include "MiSettings.h"
+#include <facesdk/FaceSDK.h>
+#include <iostream>
+#include <string.h>
+
+static void set_message(char* p_pszMsg, const std::string& p_strMsg)
+{
+	if (p_pszMsg == NULL) return;
+	strncpy(p_pszMsg, p_strMsg.c_str(), MESSAGE_BUFFER_SIZE - 1);
+	p_pszMsg[MESSAGE_BUFFER_SIZE - 1] = '\0';
+}
+
+//. FaceException::STATUS has the values of the C STATUS.
+static void set_status(int p_nStatus, const std::string& p_strMsg, int* p_pErr, char* p_pszMsg)
+{
+	set_message(p_pszMsg, p_strMsg);
+	*p_pErr = face_sdk_status(p_nStatus, p_pszMsg);
+}
+
+static facesdk::Meta to_meta(const CMeta_t* p_pMeta)
+{
+	facesdk::Meta meta;
+	if (p_pMeta == NULL) return meta;
+	if (p_pMeta->os_version != NULL) meta.os_version = p_pMeta->os_version;
+	meta.os = (facesdk::Meta::OS)p_pMeta->os;
+	meta.manufacture = (facesdk::Meta::MANUFACTURE)p_pMeta->manufacture;
+	meta.model = (facesdk::Meta::MODEL)p_pMeta->model;
+	meta.calibration = (facesdk::Meta::CALIBRATION)p_pMeta->calibration;
+	return meta;
+}
+
+static CPipelineResult_t to_pipeline_result(const facesdk::PipelineResult& p_res)
+{
+	CPipelineResult_t result;
+	result.liveness_result.score = p_res.liveness_result.score;
+	result.liveness_result.probability = p_res.liveness_result.probability;
+	result.liveness_result.ok = true;
+	result.quality_result.score = p_res.quality_result.score;
+	result.quality_result.class_ = p_res.quality_result.class_;
+	result.quality_result.ok = true;
+	return result;
+}
+
+//. p_fnCreate() as one Image::createImage call; an empty ImagePtr with *p_pErr when it throws.
+template <class F>
+static facesdk::ImagePtr create_image(F p_fnCreate, int* p_pErr, char* p_pszMsg)
+{
+	SdkCallScope scope(MI_SDK_CPP_CREATE_IMAGE);
+	facesdk::ImagePtr image;
+	*p_pErr = OK;
+	try {
+		image = p_fnCreate();
+		if (!image || image->empty()) {
+			image.reset();
+			set_status(FAILED_TO_READ_IMAGE, "empty image", p_pErr, p_pszMsg);
+		}
+	}
+	catch (const facesdk::FaceException& e) {
+		set_status((int)e.status(), e.what(), p_pErr, p_pszMsg);
+	}
+	catch (const std::exception& e) {
+		set_status(UNKNOWN, e.what(), p_pErr, p_pszMsg);
+	}
+	scope.done(p_pErr, &p_pszMsg, 1);
+	return image;
+}
+
+bool CppBackend::start(std::string& p_strErr)
+{
+	try {
+		m_pConfig = facesdk::InitConfig::createConfig(g_Settings.configDir, g_Settings.configName);
+		m_pPipeline = facesdk::FaceSDK::getPipeline(g_Settings.pipelineName, m_pConfig);
+		std::cout << "C++ backend : FaceSDK " << facesdk::FaceSDK::getVersion() << ", pipeline " << g_Settings.pipelineName << std::endl;
+		return true;
+	}
+	catch (const std::exception& e) {
+		p_strErr = e.what();
+		return false;
+	}
+}
+
+CPipelineResult_t CppBackend::liveness(facesdk::ImagePtr p_image, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+	SdkCallScope scope(MI_SDK_CPP_CHECK_LIVENESS);
+	try {
+		result = to_pipeline_result(m_pPipeline->checkLiveness(std::move(p_image), to_meta(p_pMeta)));
+		*p_pErr = OK;
+	}
+	catch (const facesdk::FaceException& e) {
+		set_status((int)e.status(), e.what(), p_pErr, p_pszMsg);
+	}
+	catch (const std::exception& e) {
+		set_status(UNKNOWN, e.what(), p_pErr, p_pszMsg);
+	}
+	scope.done(p_pErr, &p_pszMsg, 1);
+	return result;
+}
+
+CPipelineResult_t CppBackend::check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+	if (mi_backend_screened_out(p_pData, p_nLen, p_pErr, p_pszMsg)) return result;
+
+	StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+	mi_image_count_decode(p_pData);
+	facesdk::ImagePtr image = create_image([&] { return facesdk::Image::createImage(p_pData, p_nLen); }, p_pErr, p_pszMsg);
+	tCreate.stop();
+	if (!image) return result;
+
+	StageTimer tLiveness(MI_STAGE_LIVENESS);
+	return liveness(std::move(image), p_pMeta, p_pErr, p_pszMsg);
+}
+
+CPipelineResult_t CppBackend::check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+
+	StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+	facesdk::Image::COLOR_ENCODING format = p_encoding == RGB888 ? facesdk::Image::RGB888 : facesdk::Image::BGR888;
+	facesdk::ImagePtr image = create_image([&] { return facesdk::Image::createImage(p_pPixels, (size_t)p_nHeight, (size_t)p_nWidth, format); }, p_pErr, p_pszMsg);
+	tCreate.stop();
+	if (!image) return result;
+
+	StageTimer tLiveness(MI_STAGE_LIVENESS);
+	return liveness(std::move(image), p_pMeta, p_pErr, p_pszMsg);
+}
+
+void CppBackend::check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs)
+{
+	size_t n = p_vData.size();
+	std::vector<facesdk::ImagePtr> images(n);
+	memset(p_pResults, 0, n * sizeof(CPipelineResult_t));
+
+	//. decoded in parallel on the executor like the legacy engine, see MiExecutor.h
+	RequestContext* ctx = mi_context();
+	StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+	mi_parallel_for(n, [&](size_t i) {
+		const uint8_t* pData = (const uint8_t*)p_vData[i]->data();
+		size_t nLen = p_vData[i]->size();
+		if (mi_backend_screened_out(pData, nLen, &p_pErrors[i], p_ppszMsgs[i])) return;
+		mi_image_count_decode(pData, ctx);
+		images[i] = create_image([&] { return facesdk::Image::createImage(pData, nLen); }, &p_pErrors[i], p_ppszMsgs[i]);
+	});
+	tCreate.stop();
+
+	//. the decoded images are moved into the batch, no reference count traffic per image.
+	std::vector<size_t> pass;
+	std::vector<facesdk::ImagePtr> batch;
+	pass.reserve(n);
+	batch.reserve(n);
+	for (size_t i = 0; i < n; i++) {
+		if (!images[i]) continue;
+		pass.push_back(i);
+		batch.push_back(std::move(images[i]));
+	}
+	if (batch.empty()) return;
+
+	std::vector<facesdk::Meta> metas;
+	if (p_pMeta != NULL) metas.assign(batch.size(), to_meta(p_pMeta));
+
+	StageTimer tLiveness(MI_STAGE_LIVENESS);
+	SdkCallScope scope(MI_SDK_CPP_CHECK_LIVENESS_BATCH);
+	try {
+		std::vector<facesdk::OptionalPipelineResult> out = m_pPipeline->checkLivenessBatch(batch, metas);
+		for (size_t j = 0; j < pass.size(); j++) {
+			size_t i = pass[j];
+			if (j >= out.size()) set_status(UNKNOWN, "no result", &p_pErrors[i], p_ppszMsgs[i]);
+			else if (!out[j].ok()) set_status((int)out[j].status().code, out[j].status().message, &p_pErrors[i], p_ppszMsgs[i]);
+			else {
+				p_pResults[i] = to_pipeline_result(out[j].value());
+				p_pErrors[i] = OK;
+			}
+		}
+	}
+	catch (const facesdk::FaceException& e) {
+		for (size_t i : pass) set_status((int)e.status(), e.what(), &p_pErrors[i], p_ppszMsgs[i]);
+	}
+	catch (const std::exception& e) {
+		for (size_t i : pass) set_status(UNKNOWN, e.what(), &p_pErrors[i], p_ppszMsgs[i]);
+	}
+	batch.clear();
+	tLiveness.stop();
+
+	//. one observation for the call, the statuses of the batched images.
+	std::vector<int> errors(pass.size());
+	std::vector<char*> msgs(pass.size());
+	for (size_t j = 0; j < pass.size(); j++) {
+		errors[j] = p_pErrors[pass[j]];
+		msgs[j] = p_ppszMsgs[pass[j]];
+	}
+	scope.done(errors.data(), msgs.data(), pass.size());
+}
+
+void CppBackend::warm_up(int p_nIterations)
+{
+	const int rows = 480, cols = 640;
+	std::vector<uint8_t> pixels((size_t)rows * cols * 3, 128);
+	try {
+		facesdk::ImagePtr image = facesdk::Image::createImage(pixels.data(), rows, cols, facesdk::Image::BGR888);
+		//. a synthetic frame has no face : the detector still runs and every call throws.
+		for (int i = 0; i < p_nIterations; i++) {
+			try {
+				m_pPipeline->checkLiveness(image);
+			}
+			catch (const facesdk::FaceException&) {
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "Warm-up : cpp backend : " << e.what() << std::endl;
+	}
+}
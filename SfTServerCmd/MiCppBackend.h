@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "MiBackend.h"
+
+namespace facesdk {
+	class Pipeline;
+	struct Image;
+	struct InitConfig;
+}
+
+//. InferenceBackend on the facesdk:: C++ API the C wrapper is built on (FaceSDK.h, exported
+//. by idliveface_c_legacy.lib) : the sdk.config_dir / config_name / pipeline_name pipeline
+//. of the legacy engine, without the C marshalling. Images are facesdk::ImagePtr and a
+//. batch is a std::vector<ImagePtr> moved into Pipeline::checkLivenessBatch, which answers
+//. one OptionalPipelineResult per image; no const CImage_t** / int* / char** arrays or
+//. CPipelineResult_destroy_array per call.
+//. SDK errors arrive as FaceException, whose STATUS has the values of the C STATUS.
+//. One Pipeline is shared by the request threads like the supervisor's global one; the
+//. batcher, pool, gate and supervisor of the legacy engine are not used on this path.
+//. Calls are timed as Image::createImage / Pipeline::checkLiveness[Batch] (MiSdkCall.h).
+class CppBackend : public InferenceBackend {
+public:
+	bool start(std::string& p_strErr);
+
+	const char* name() const override { return "cpp"; }
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override;
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override;
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override;
+	void warm_up(int p_nIterations) override;
+
+private:
+	CPipelineResult_t liveness(std::shared_ptr<facesdk::Image> p_image, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg);
+
+	std::shared_ptr<facesdk::InitConfig>	m_pConfig;
+	std::shared_ptr<facesdk::Pipeline>		m_pPipeline;
+};
@@ -0,0 +1,154 @@
+#include "MiCpu.h"
+#include <stdio.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_CPU_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define LD_CPU_X86 0
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+static const char* lv_szFeatures[MI_CPU_FEATURE_COUNT] = { "sse2", "ssse3", "sse4.1", "sse4.2", "avx2", "avx512", "aes", "neon" };
+
+#if LD_CPU_X86
+
+static void cpuid(unsigned int p_nLeaf, unsigned int p_nSub, unsigned int p_regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4] = { 0 };
+	__cpuidex(info, (int)p_nLeaf, (int)p_nSub);
+	for (int i = 0; i < 4; i++) p_regs[i] = (unsigned int)info[i];
+#else
+	p_regs[0] = p_regs[1] = p_regs[2] = p_regs[3] = 0;
+	__cpuid_count(p_nLeaf, p_nSub, p_regs[0], p_regs[1], p_regs[2], p_regs[3]);
+#endif
+}
+
+//. register state the OS saves on a context switch; only valid with OSXSAVE.
+static uint64_t xcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int lo = 0, hi = 0;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static uint32_t detect_features()
+{
+	unsigned int r[4];
+	cpuid(0, 0, r);
+	unsigned int nMaxLeaf = r[0];
+	cpuid(1, 0, r);
+	uint32_t n = 0;
+	if (r[3] & (1u << 26)) n |= MI_CPU_SSE2;
+	if (r[2] & (1u << 9)) n |= MI_CPU_SSSE3;
+	if (r[2] & (1u << 19)) n |= MI_CPU_SSE41;
+	if (r[2] & (1u << 20)) n |= MI_CPU_SSE42;
+	if (r[2] & (1u << 25)) n |= MI_CPU_AES;
+	bool bOsxsave = (r[2] & (1u << 27)) != 0;
+	bool bAvx = (r[2] & (1u << 28)) != 0;
+	uint64_t xcr = bOsxsave ? xcr0() : 0;
+	//. xmm + ymm state; avx-512 adds the opmask and both zmm halves.
+	bool bYmm = (xcr & 0x06) == 0x06;
+	bool bZmm = (xcr & 0xE6) == 0xE6;
+	if (nMaxLeaf >= 7) {
+		cpuid(7, 0, r);
+		if (bAvx && bYmm && (r[1] & (1u << 5))) n |= MI_CPU_AVX2;
+		const unsigned int nAvx512 = (1u << 16) | (1u << 30) | (1u << 31);
+		if (bZmm && (n & MI_CPU_AVX2) && (r[1] & nAvx512) == nAvx512) n |= MI_CPU_AVX512;
+	}
+	return n;
+}
+
+#else
+
+static uint32_t detect_features()
+{
+	uint32_t n = 0;
+#if defined(__aarch64__) || defined(_M_ARM64)
+	n |= MI_CPU_NEON;
+#if defined(__linux__) && defined(HWCAP_AES)
+	if (getauxval(AT_HWCAP) & HWCAP_AES) n |= MI_CPU_AES;
+#endif
+#endif
+	return n;
+}
+
+#endif
+
+uint32_t mi_cpu_features()
+{
+	static const uint32_t nFeatures = detect_features();
+	return nFeatures;
+}
+
+std::string mi_cpu_feature_names(uint32_t p_nFeatures)
+{
+	std::string s;
+	for (int i = 0; i < MI_CPU_FEATURE_COUNT; i++) {
+		if ((p_nFeatures & (1u << i)) == 0) continue;
+		if (!s.empty()) s += ' ';
+		s += lv_szFeatures[i];
+	}
+	return s.empty() ? "none" : s;
+}
+
+//. function local : kernels register from the static initialisers of other modules.
+static std::vector<MiCpuKernel*>& kernels()
+{
+	static std::vector<MiCpuKernel*> v;
+	return v;
+}
+
+bool mi_cpu_register(MiCpuKernel* p_pKernel)
+{
+	p_pKernel->best = 0;
+	for (int i = p_pKernel->count - 1; i > 0; i--) {
+		if (mi_cpu_has(p_pKernel->needs[i])) {
+			p_pKernel->best = i;
+			break;
+		}
+	}
+	p_pKernel->bound = -1;
+	mi_cpu_bind(p_pKernel, p_pKernel->best);
+	kernels().push_back(p_pKernel);
+	return true;
+}
+
+const std::vector<MiCpuKernel*>& mi_cpu_kernels()
+{
+	return kernels();
+}
+
+bool mi_cpu_bind(MiCpuKernel* p_pKernel, int p_nVariant)
+{
+	if (p_nVariant < 0 || p_nVariant >= p_pKernel->count || !mi_cpu_has(p_pKernel->needs[p_nVariant])) return false;
+	p_pKernel->bind(p_nVariant);
+	p_pKernel->bound = p_nVariant;
+	return true;
+}
+
+void mi_cpu_log()
+{
+	std::string s = "CPU : " + mi_cpu_feature_names(mi_cpu_features()) + ", kernels";
+	const std::vector<MiCpuKernel*>& v = kernels();
+	for (size_t i = 0; i < v.size(); i++) {
+		s += i == 0 ? " " : ", ";
+		s += v[i]->name;
+		s += ' ';
+		s += v[i]->variants[v[i]->bound];
+	}
+	printf("%s\n", s.c_str());
+}
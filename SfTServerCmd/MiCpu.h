@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//. CPU features, detected once on first use, and the kernels that have more than one
+//. implementation (base64 blocks, color conversion, orientation ...). A module describes
+//. its variants from the plainest up with the features each needs and a bind function
+//. pointing its kernel pointers at one of them; registering binds the best variant the
+//. CPU runs. mi_cpu_log prints the features and the variants bound at startup, and
+//. benchmarks rebind each variant in turn (SdkBench --kernels).
+//. x86-64 vector extensions count only when the OS saves their registers (XCR0), so a
+//. VM that hides AVX state falls back cleanly; on ARM64 NEON is the baseline.
+
+enum MiCpuFeature {
+	MI_CPU_SSE2		= 1 << 0,
+	MI_CPU_SSSE3	= 1 << 1,
+	MI_CPU_SSE41	= 1 << 2,
+	MI_CPU_SSE42	= 1 << 3,
+	MI_CPU_AVX2		= 1 << 4,
+	MI_CPU_AVX512	= 1 << 5,		//. F + BW + VL
+	MI_CPU_AES		= 1 << 6,		//. AES-NI / ARMv8 crypto
+	MI_CPU_NEON		= 1 << 7,
+	MI_CPU_FEATURE_COUNT = 8
+};
+
+uint32_t mi_cpu_features();
+//. every feature of p_nFeatures present.
+inline bool mi_cpu_has(uint32_t p_nFeatures) { return (mi_cpu_features() & p_nFeatures) == p_nFeatures; }
+//. "sse2 ssse3 ..." of p_nFeatures, "none" when empty.
+std::string mi_cpu_feature_names(uint32_t p_nFeatures);
+
+//. one dispatched kernel family, a static of its module.
+struct MiCpuKernel {
+	const char*			name;
+	int					count;
+	const char* const*	variants;		//. plainest first
+	const uint32_t*		needs;			//. features of each variant
+	void				(*bind)(int p_nVariant);
+	int					bound;			//. variant in use
+	int					best;			//. best one the CPU runs
+};
+
+//. adds p_pKernel and binds its best variant; for a static initialiser of the module.
+bool mi_cpu_register(MiCpuKernel* p_pKernel);
+const std::vector<MiCpuKernel*>& mi_cpu_kernels();
+//. rebinds p_pKernel to p_nVariant (benchmarks); false when the CPU lacks it.
+bool mi_cpu_bind(MiCpuKernel* p_pKernel, int p_nVariant);
+
+//. "CPU : <features>, kernels base64 sse4.1, color avx2, ..."
+void mi_cpu_log();
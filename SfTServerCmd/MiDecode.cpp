@@ -0,0 +1,137 @@
+#include "MiDecode.h"
+#include "MiContext.h"
+#include "MiImage.h"
+#include "MiImageInfo.h"
+#include "MiMetrics.h"
+#include "MiOrient.h"
+#include "MiPlatform.h"
+#if MI_HAS_WIC
+#include "MiWic.h"
+#endif
+
+static int lv_nTargetSide = 0;
+static bool lv_bUpright = false;
+
+void mi_decode_init(int p_nTargetSide, bool p_bUpright)
+{
+	lv_nTargetSide = p_nTargetSide;
+	lv_bUpright = p_bUpright;
+}
+
+bool mi_decode_enabled()
+{
+	return lv_nTargetSide > 0;
+}
+
+#if MI_HAS_WIC
+//. largest DCT scale denominator keeping the long side >= p_nTarget, 1 = none.
+static int pick_scale(UINT p_nWidth, UINT p_nHeight, int p_nTarget)
+{
+	UINT longSide = p_nWidth > p_nHeight ? p_nWidth : p_nHeight;
+	for (int d = 8; d >= 2; d /= 2) {
+		if ((int)((longSide + d - 1) / d) >= p_nTarget) return d;
+	}
+	return 1;
+}
+
+//. false for header values the scaled decode does not take.
+static bool takes_header(const ImageInfo& p_info)
+{
+	if (p_info.format != MI_IMAGE_JPEG) return false;
+	if (p_info.orientation != 1 && !lv_bUpright) return false;
+	if (p_info.orientation == 1 && pick_scale((UINT)p_info.width, (UINT)p_info.height, lv_nTargetSide) == 1) return false;
+	return true;
+}
+
+//. p_timer is stopped before the upright turn, MI_STAGE_CONVERT times that.
+static bool decode_frame(IWICBitmapFrameDecode* p_pFrame, bool p_bDegrade, StageTimer& p_timer, DecodedFrame& p_out)
+{
+	UINT w = 0, h = 0;
+	if (FAILED(p_pFrame->GetSize(&w, &h)) || w == 0 || h == 0) return false;
+	int scale = pick_scale(w, h, lv_nTargetSide);
+	int orientation = mi_wic_orientation(p_pFrame);
+	if (orientation != 1 && !lv_bUpright) return false;
+	if (scale == 1 && orientation == 1) return false;
+	//. short of budget : one more halving, the pipeline runs on a quarter of the pixels.
+	if (p_bDegrade && scale > 1 && scale < 8 && mi_context_degrade(MI_DEGRADE_SCALE)) scale *= 2;
+
+	ComRef<IWICBitmapSourceTransform> transform;
+	if (FAILED(p_pFrame->QueryInterface(IID_IWICBitmapSourceTransform, (void**)&transform.p))) return false;
+	//. the decoder rounds up to the nearest size it produces natively.
+	UINT sw = (w + scale - 1) / scale, sh = (h + scale - 1) / scale;
+	if (FAILED(transform->GetClosestSize(&sw, &sh)) || sw == 0 || sh == 0) return false;
+
+	//. colour JPEGs come out as BGR, grayscale ones as 8 bpp and are expanded.
+	WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR;
+	if (FAILED(transform->GetClosestPixelFormat(&format))) return false;
+	bool bGray = IsEqualGUID(format, GUID_WICPixelFormat8bppGray);
+	if (!bGray && !IsEqualGUID(format, GUID_WICPixelFormat24bppBGR)) return false;
+
+	size_t nRow = (size_t)sw * (bGray ? 1 : 3);
+	p_out.pixels.resize((size_t)sw * sh * 3);
+	if (FAILED(transform->CopyPixels(NULL, sw, sh, &format, WICBitmapTransformRotate0, (UINT)nRow, (UINT)(nRow * sh), p_out.pixels.data()))) return false;
+	if (bGray) {
+		//. in place from the end, the gray rows occupy the first third.
+		uint8_t* px = p_out.pixels.data();
+		for (size_t i = (size_t)sw * sh; i-- > 0; ) px[i * 3] = px[i * 3 + 1] = px[i * 3 + 2] = px[i];
+	}
+	p_out.width = (int)sw;
+	p_out.height = (int)sh;
+	p_out.scale = scale;
+	p_out.orientation = 1;
+	p_timer.stop();
+	mi_metrics_decode(scale, p_out.pixels.size());
+
+	if (orientation != 1) {
+		StageTimer tConvert(MI_STAGE_CONVERT);
+		int ow = 0, oh = 0;
+		mi_orient_size(orientation, p_out.width, p_out.height, ow, oh);
+		PixelBuffer upright((size_t)ow * oh * 3);
+		if (!mi_orient_bgr(p_out.pixels.data(), p_out.width, p_out.height, (size_t)p_out.width * 3, orientation, upright.data(), (size_t)ow * 3)) return false;
+		p_out.pixels.swap(upright);
+		p_out.width = ow;
+		p_out.height = oh;
+		p_out.orientation = orientation;
+		mi_metrics_upright(orientation);
+	}
+	return true;
+}
+#endif
+
+bool mi_decode_jpeg_scaled(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out)
+{
+#if MI_HAS_WIC
+	if (!mi_decode_enabled()) return false;
+
+	//. other formats, rotated ones without upright and small upright JPEGs are known from the header.
+	ImageInfo info;
+	if (mi_image_info(p_pData, p_nLen, info) && !takes_header(info)) return false;
+
+	StageTimer tDecode(MI_STAGE_DECODE);
+	bool bJpeg = false;
+	ComRef<IWICStream> stream;
+	ComRef<IWICBitmapDecoder> decoder;
+	ComRef<IWICBitmapFrameDecode> frame;
+	if (!mi_wic_open(p_pData, p_nLen, stream, decoder, frame, &bJpeg) || !bJpeg) return false;
+	mi_image_count_decode(p_pData);
+	return decode_frame(frame.p, true, tDecode, p_out);
+#else
+	//. no scaled JPEG decoder without WIC, the SDK decodes the full image.
+	return false;
+#endif
+}
+
+#if MI_HAS_WIC
+bool mi_decode_jpeg_stream(IStream* p_pStream, const ImageInfo& p_info, DecodedFrame& p_out)
+{
+	if (!mi_decode_enabled() || !takes_header(p_info)) return false;
+
+	StageTimer tDecode(MI_STAGE_DECODE);
+	bool bJpeg = false;
+	ComRef<IWICBitmapDecoder> decoder;
+	ComRef<IWICBitmapFrameDecode> frame;
+	if (!mi_wic_open_stream(p_pStream, decoder, frame, &bJpeg) || !bJpeg) return false;
+	mi_image_count_decode(p_pStream);
+	return decode_frame(frame.p, false, tDecode, p_out);
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "MiImageInfo.h"
+#include "MiPixelPool.h"
+#include "MiPlatform.h"
+
+//. Downscaled JPEG decode for oversized uploads ([decode] settings).
+//. The WIC JPEG decoder scales by 1/2, 1/4 or 1/8 in the DCT domain
+//. (IWICBitmapSourceTransform), so only the reduced frame is ever reconstructed.
+//. The largest factor is chosen whose result still has a long side of at least
+//. target_side, i.e. the frame on which the smallest accepted face keeps the
+//. resolution the pipeline needs. The frame is then checked with image_create_pixels.
+//. A request short of its deadline (MiContext.h) decodes one DCT scale
+//. smaller (down to 1/8) when it is scaled at all.
+//. With upright set, EXIF-rotated JPEGs are decoded too (at full size when they would not
+//. shrink) and turned upright with mi_orient_bgr, so the SDK never searches the rotation.
+//. Returns false (caller decodes the full image with the SDK) for other formats,
+//. upright uploads that would not shrink, rotated ones without upright, decode errors,
+//. and always on builds without WIC (Linux).
+
+struct DecodedFrame {
+	PixelBuffer				pixels;		//. packed BGR rows
+	int						width;
+	int						height;
+	int						scale;		//. 1, 2, 4 or 8
+	int						orientation;	//. EXIF orientation applied to the pixels, 1 = none
+	DecodedFrame() : width(0), height(0), scale(1), orientation(1) {}
+};
+
+void mi_decode_init(int p_nTargetSide, bool p_bUpright);
+bool mi_decode_enabled();
+
+bool mi_decode_jpeg_scaled(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out);
+
+#if MI_HAS_WIC
+//. the same decode from p_pStream, whose Read may block until the bytes arrive (MiProgressive.h).
+//. p_info is the header already sniffed from its first bytes. No degrade step : it runs
+//. while the body is received, before the request has a context.
+bool mi_decode_jpeg_stream(IStream* p_pStream, const ImageInfo& p_info, DecodedFrame& p_out);
+#endif
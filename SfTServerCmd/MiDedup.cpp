@@ -0,0 +1,84 @@
+#include "MiDedup.h"
+#include "MiHash.h"
+#include "MiMetrics.h"
+#include "MiSettings.h"
+#include <string.h>
+#include <unordered_map>
+
+const char* mi_dedup_path_name(int p_nPath)
+{
+	static const char* szNames[MI_DEDUP_COUNT] = { "batcher", "request", "jobs", "bulk" };
+	return p_nPath >= 0 && p_nPath < MI_DEDUP_COUNT ? szNames[p_nPath] : "unknown";
+}
+
+size_t mi_dedup_plan(const std::vector<std::pair<uint64_t, uint64_t>>& p_vKeys, std::vector<size_t>& p_vFirst)
+{
+	size_t n = p_vKeys.size();
+	p_vFirst.resize(n);
+	std::unordered_map<uint64_t, size_t> seen(n * 2);
+	size_t nDup = 0;
+	for (size_t i = 0; i < n; i++) {
+		p_vFirst[i] = i;
+		if (p_vKeys[i].second == 0) continue;
+		auto it = seen.emplace(p_vKeys[i].first, i).first;
+		//. same hash, another size : a collision, checked on its own.
+		if (it->second != i && p_vKeys[it->second].second == p_vKeys[i].second) {
+			p_vFirst[i] = it->second;
+			nDup++;
+		}
+	}
+	return nDup;
+}
+
+size_t mi_dedup_check_batch(InferenceBackend* p_pBackend, DedupPath p_path, const std::vector<const std::string*>& p_vData, const uint64_t* p_pHashes,
+	const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs)
+{
+	size_t n = p_vData.size();
+	if (!g_Settings.batchDedup || n < 2) {
+		p_pBackend->check_batch(p_vData, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+		return 0;
+	}
+	std::vector<std::pair<uint64_t, uint64_t>> vKeys(n);
+	for (size_t i = 0; i < n; i++) {
+		const std::string& data = *p_vData[i];
+		vKeys[i].first = p_pHashes != NULL ? p_pHashes[i] : mi_hash64(data.data(), data.size());
+		vKeys[i].second = data.size();
+	}
+	std::vector<size_t> vFirst;
+	size_t nDup = mi_dedup_plan(vKeys, vFirst);
+	//. XXH64 collisions can be crafted : a duplicate shares a result only when its bytes are equal.
+	for (size_t i = 0; i < n && nDup > 0; i++) {
+		if (vFirst[i] == i || memcmp(p_vData[i]->data(), p_vData[vFirst[i]]->data(), p_vData[i]->size()) == 0) continue;
+		vFirst[i] = i;
+		nDup--;
+	}
+	if (nDup == 0) {
+		p_pBackend->check_batch(p_vData, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+		return 0;
+	}
+
+	//. the unique images keep the message buffers of their first occurrence.
+	std::vector<const std::string*> vUnique;
+	std::vector<char*> vMsgs;
+	std::vector<size_t> vSlot(n);
+	vUnique.reserve(n - nDup);
+	vMsgs.reserve(n - nDup);
+	for (size_t i = 0; i < n; i++) {
+		if (vFirst[i] != i) continue;
+		vSlot[i] = vUnique.size();
+		vUnique.push_back(p_vData[i]);
+		vMsgs.push_back(p_ppszMsgs[i]);
+	}
+	std::vector<CPipelineResult_t> vResults(vUnique.size());
+	std::vector<int> vErrors(vUnique.size(), OK);
+	p_pBackend->check_batch(vUnique, p_pMeta, vResults.data(), vErrors.data(), vMsgs.data());
+
+	for (size_t i = 0; i < n; i++) {
+		size_t first = vFirst[i];
+		p_pResults[i] = vResults[vSlot[first]];
+		p_pErrors[i] = vErrors[vSlot[first]];
+		if (first != i) memcpy(p_ppszMsgs[i], p_ppszMsgs[first], MESSAGE_BUFFER_SIZE);
+	}
+	mi_metrics_batch_duplicates(p_path, nDup);
+	return nDup;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiBackend.h"
+
+//. Duplicates within one batch ([batch] dedup) : the same selfie attached to several records
+//. of a bulk archive, or sent twice in one batch request. An image whose content hash
+//. (mi_hash64, MiHash.h) and size match an earlier image of its batch, and whose bytes (or,
+//. in the batcher, SHA-256 digest) then compare equal, is not sent to the SDK; it takes that
+//. image's result, error and message. The batch endpoints, the jobs worker and
+//. the bulk mode go through mi_dedup_check_batch; the micro-batcher (MiBatcher.h) plans its
+//. batches with the hash of the image each request submitted (RequestContext::imageHash) :
+//. the upload when the SDK decodes it, else the pixels the server decoded, so an upload
+//. cropped, scaled or degraded differently by two requests is not shared between them.
+//. mi_batch_duplicates_total{path} on GD_API_METRICS; the bulk mode prints its ratio.
+
+enum DedupPath {
+	MI_DEDUP_BATCHER = 0,		//. micro-batches of single-image requests
+	MI_DEDUP_REQUEST,			//. GD_API_BATCH and the other multi-image requests
+	MI_DEDUP_JOBS,
+	MI_DEDUP_BULK,
+	MI_DEDUP_COUNT
+};
+
+const char* mi_dedup_path_name(int p_nPath);
+
+//. p_vKeys : (hash, size) of each image, size 0 = unknown, never a duplicate. p_vFirst[i]
+//. is the index of the first image with the key of image i (i itself for the first one);
+//. the caller confirms the content before sharing a result.
+//. Returns the number of duplicates.
+size_t mi_dedup_plan(const std::vector<std::pair<uint64_t, uint64_t>>& p_vKeys, std::vector<size_t>& p_vFirst);
+
+//. p_pBackend->check_batch of the first image of every key only, the duplicates answered
+//. from it. p_pHashes : mi_hash64 of each image, taken when it was read; NULL = hashed here.
+//. A plain check_batch with [batch] dedup off. Returns the number of duplicates.
+size_t mi_dedup_check_batch(InferenceBackend* p_pBackend, DedupPath p_path, const std::vector<const std::string*>& p_vData, const uint64_t* p_pHashes,
+	const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs);
@@ -0,0 +1,182 @@
+#include "MiDetect.h"
+#include "MiAnalyze.h"
+#include "MiLazyPool.h"
+#include "MiMetrics.h"
+#include "MiMsgBuffers.h"
+#include "MiResultJson.h"
+#include "MiSdkCall.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static CInitConfig_t*	lv_pConfig = NULL;
+static LazyPool*		lv_pPool = NULL;
+
+static bool build_engines(const std::string& p_strConfigDir, const std::string& p_strConfigName, const DetectSettings& p_settings, std::vector<void*>& p_vEngines, std::string& p_strErr)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+	int		nEngines = p_settings.engines < 1 ? 1 : p_settings.engines;
+
+	lv_pConfig = face_sdk_api().config_create(p_strConfigDir.c_str(), p_strConfigName.c_str(), &err, msg);
+	if (lv_pConfig == NULL) {
+		p_strErr = msg;
+		return false;
+	}
+	for (int i = 0; i < nEngines; i++) {
+		CDetectEngine_t* pDetector = face_sdk_api().detection_create(p_settings.detector.c_str(), lv_pConfig, &err, msg);
+		if (pDetector == NULL) {
+			p_strErr = msg;
+			break;
+		}
+		p_vEngines.push_back(pDetector);
+	}
+	if ((int)p_vEngines.size() == nEngines) return true;
+	for (void* p : p_vEngines) face_sdk_api().detection_destroy((CDetectEngine_t*)p);
+	p_vEngines.clear();
+	face_sdk_api().config_destroy(lv_pConfig);
+	lv_pConfig = NULL;
+	return false;
+}
+
+static void release_engines(std::vector<void*>& p_vEngines)
+{
+	for (void* p : p_vEngines) face_sdk_api().detection_destroy((CDetectEngine_t*)p);
+	if (lv_pConfig != NULL) face_sdk_api().config_destroy(lv_pConfig);
+	lv_pConfig = NULL;
+}
+
+bool mi_detect_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const DetectSettings& p_settings, std::string& p_strErr)
+{
+	LazyPool::BuildFn build = [=](std::vector<void*>& p_vEngines, std::string& p_strBuildErr) {
+		return build_engines(p_strConfigDir, p_strConfigName, p_settings, p_vEngines, p_strBuildErr);
+	};
+	lv_pPool = new LazyPool("detect", build, release_engines, p_settings.idleEvictMs);
+	if (p_settings.lazy || lv_pPool->build(p_strErr)) return true;
+	mi_detect_shutdown();
+	return false;
+}
+
+void mi_detect_shutdown()
+{
+	delete lv_pPool;
+	lv_pPool = NULL;
+}
+
+bool mi_detect_enabled()
+{
+	return lv_pPool != NULL;
+}
+
+void mi_detect_face_areas(const CImage_t** p_ppImages, size_t p_nCount, double* p_pAreas)
+{
+	std::vector<const CImage_t*> vImages;
+	std::vector<size_t> vSlot;
+	for (size_t i = 0; i < p_nCount; i++) {
+		p_pAreas[i] = 0;
+		if (p_ppImages[i] == NULL) continue;
+		vImages.push_back(p_ppImages[i]);
+		vSlot.push_back(i);
+	}
+	size_t n = vImages.size();
+	if (n == 0) return;
+	std::vector<int> vErrors(n, OK);
+	MsgBuffers msgs(n);
+
+	StageTimer tDetect(MI_STAGE_DETECT);
+	LazyLease<CDetectEngine_t> lease(*lv_pPool);
+	if (lease.get() == NULL) return;
+	CBoundingBoxes_t* pBoxes = FaceSdk::detect_only_bounding_box_batch(lease.get(), vImages.data(), n, vErrors.data(), msgs.data());
+	if (pBoxes == NULL) return;
+	for (size_t k = 0; k < n; k++) {
+		if (vErrors[k] != OK) continue;
+		for (unsigned f = 0; f < pBoxes[k].num_boxes; f++) {
+			const CBoundingBox_t& b = pBoxes[k].boxes[f];
+			double dArea = (double)(b.bottom_right_x - b.left_top_x) * (double)(b.bottom_right_y - b.left_top_y);
+			if (dArea > p_pAreas[vSlot[k]]) p_pAreas[vSlot[k]] = dArea;
+		}
+	}
+	face_sdk_api().CBoundingBoxes_destroy_array(pBoxes, n);
+}
+
+static void put_item_head(ArenaString& p_out, size_t p_nIndex, int p_nErr, const char* p_pszMsg)
+{
+	p_out.append("{\"index\":");
+	mi_json_put_int(p_out, (int)p_nIndex);
+	p_out.append(",\"status\":");
+	mi_json_put_string(p_out, face_sdk_status_name(p_nErr));
+	if (p_nErr != OK) {
+		p_out.append(",\"message\":");
+		mi_json_put_string(p_out, p_pszMsg);
+	}
+}
+
+void mi_detect_batch_json(ArenaString& p_out, const CImage_t** p_ppImages, size_t p_nCount, bool p_bLandmarks, int* p_pErrors, char** p_ppszMsgs)
+{
+	//. the SDK gets the decoded images only, packed; vSlot maps them back.
+	std::vector<const CImage_t*> vImages;
+	std::vector<size_t> vSlot;
+	for (size_t i = 0; i < p_nCount; i++) {
+		if (p_ppImages[i] == NULL) continue;
+		vImages.push_back(p_ppImages[i]);
+		vSlot.push_back(i);
+	}
+	size_t n = vImages.size();
+	std::vector<int> vErrors(n, OK);
+	std::vector<char*> vMsgs(n);
+	for (size_t k = 0; k < n; k++) vMsgs[k] = p_ppszMsgs[vSlot[k]];
+
+	CDetectionResult_t* pFull = NULL;
+	CBoundingBoxes_t* pBoxes = NULL;
+	if (n > 0) {
+		StageTimer tDetect(MI_STAGE_DETECT);
+		LazyLease<CDetectEngine_t> lease(*lv_pPool);
+		if (lease.get() == NULL) {
+			for (size_t k = 0; k < n; k++) {
+				vErrors[k] = UNKNOWN;
+				snprintf(vMsgs[k], MESSAGE_BUFFER_SIZE, "%s", lease.error().c_str());
+			}
+		}
+		else if (p_bLandmarks) pFull = FaceSdk::detect_batch(lease.get(), vImages.data(), n, vErrors.data(), vMsgs.data());
+		else pBoxes = FaceSdk::detect_only_bounding_box_batch(lease.get(), vImages.data(), n, vErrors.data(), vMsgs.data());
+		if (pFull == NULL && pBoxes == NULL) {
+			for (size_t k = 0; k < n; k++) {
+				if (vErrors[k] == OK) vErrors[k] = UNKNOWN;
+			}
+		}
+	}
+	for (size_t k = 0; k < n; k++) p_pErrors[vSlot[k]] = vErrors[k];
+
+	const unsigned nFields = MI_ANALYZE_BOX | MI_ANALYZE_POSE | MI_ANALYZE_LANDMARKS;
+	p_out.push_back('[');
+	size_t k = 0;
+	for (size_t i = 0; i < p_nCount; i++) {
+		if (i > 0) p_out.push_back(',');
+		put_item_head(p_out, i, p_pErrors[i], p_ppszMsgs[i]);
+		bool bDetected = k < n && vSlot[k] == i;
+		if (bDetected && p_pErrors[i] == OK) {
+			p_out.append(",\"faces\":[");
+			if (pFull != NULL) {
+				const CDetectionResult_t& r = pFull[k];
+				for (unsigned f = 0; f < r.num_faces; f++) {
+					if (f > 0) p_out.push_back(',');
+					mi_analyze_face_json(p_out, r.faces[f], nFields);
+				}
+			}
+			else {
+				const CBoundingBoxes_t& r = pBoxes[k];
+				for (unsigned f = 0; f < r.num_boxes; f++) {
+					if (f > 0) p_out.push_back(',');
+					mi_analyze_box_json(p_out, r.boxes[f]);
+				}
+			}
+			p_out.push_back(']');
+		}
+		if (bDetected) k++;
+		p_out.push_back('}');
+	}
+	p_out.push_back(']');
+
+	if (pFull != NULL) face_sdk_api().CDetectionResult_destroy_array(pFull, n);
+	if (pBoxes != NULL) face_sdk_api().CBoundingBoxes_destroy_array(pBoxes, n);
+}
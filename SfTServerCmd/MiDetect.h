@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include "FaceSdkApi.h"
+#include "MiArena.h"
+
+//. Detection-only batches for GD_API_DETECT ([detect] settings) : callers that only need
+//. face boxes (portrait cropping ...) skip the liveness pipeline. A request's images go to
+//. the SDK in one detect_only_bounding_box_batch call, or detect_batch when landmarks are
+//. asked for, and the results are released with one *_destroy_array call.
+//. The detectors are a pool of their own, apart from the crop / gate / analyze engines,
+//. built at init or with lazy on the first request (MiLazyPool.h).
+
+struct DetectSettings {
+	int			engines;		//. detectors shared by the request threads
+	std::string	detector;		//. detection_create name
+	bool		lazy;			//. built on the first request, see MiLazyPool.h
+	int			idleEvictMs;	//. 0 = kept until shutdown
+};
+
+bool mi_detect_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const DetectSettings& p_settings, std::string& p_strErr);
+void mi_detect_shutdown();
+bool mi_detect_enabled();
+
+//. area in pixels of the largest face of each of p_nCount images (one
+//. detect_only_bounding_box_batch call), 0 for NULL entries, no face or a failed call.
+void mi_detect_face_areas(const CImage_t** p_ppImages, size_t p_nCount, double* p_pAreas);
+
+//. appends [{"index":0,"status":"OK","faces":[...]}, ...] for p_nCount images. NULL entries
+//. keep the STATUS already in p_pErrors / p_ppszMsgs (decode failures). Faces are boxes
+//. [x1,y1,x2,y2], or with p_bLandmarks objects with box, pose and the 68 landmarks.
+void mi_detect_batch_json(ArenaString& p_out, const CImage_t** p_ppImages, size_t p_nCount, bool p_bLandmarks, int* p_pErrors, char** p_ppszMsgs);
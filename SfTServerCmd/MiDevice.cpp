@@ -0,0 +1,217 @@
+#include "MiDevice.h"
+#include "MiLazyPool.h"
+#include "MiMetrics.h"
+#include "MiSdkCall.h"
+#include "MiSettings.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static const char* lv_szDevices[MI_DEVICE_COUNT] = { "cpu", "gpu" };
+
+const char* mi_device_name(MiDevice p_device)
+{
+	return lv_szDevices[p_device];
+}
+
+//. the legacy flow on a pipeline set of its own, borrowed one call at a time.
+class GpuBackend : public LegacyBackend {
+public:
+	GpuBackend() : m_pConfig(NULL), m_nPipelines(0) {}
+	~GpuBackend()
+	{
+		delete m_pPool;
+	}
+
+	const char* name() const override { return "gpu"; }
+
+	bool start(const DeviceSettings& p_settings, std::string& p_strErr)
+	{
+		m_settings = p_settings;
+		m_nPipelines = p_settings.gpuPipelines < 1 ? 1 : p_settings.gpuPipelines;
+		m_pPool = new LazyPool("gpu",
+			[this](std::vector<void*>& p_vPipelines, std::string& p_strBuildErr) { return build(p_vPipelines, p_strBuildErr); },
+			[this](std::vector<void*>& p_vPipelines) { release(p_vPipelines); },
+			p_settings.gpuIdleEvictMs);
+		return p_settings.gpuLazy || m_pPool->build(p_strErr);
+	}
+
+	size_t pipelines() const { return m_nPipelines; }
+
+protected:
+	CPipelineResult_t liveness(const CImage_t* p_pImage, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		LazyLease<CPipeline_t> lease(*m_pPool);
+		if (lease.get() == NULL) {
+			CPipelineResult_t result;
+			memset(&result, 0, sizeof(result));
+			*p_pErr = UNKNOWN;
+			snprintf(p_pszMsg, MESSAGE_BUFFER_SIZE, "%s", lease.error().c_str());
+			return result;
+		}
+		return FaceSdk::pipeline_check_liveness(lease.get(), p_pImage, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	void liveness_batch(const CImage_t** p_ppImages, size_t p_nCount, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override
+	{
+		//. compact the decodable images, the SDK call takes no holes.
+		std::vector<size_t> index;
+		std::vector<const CImage_t*> images;
+		for (size_t i = 0; i < p_nCount; i++) {
+			memset(&p_pResults[i], 0, sizeof(CPipelineResult_t));
+			if (p_ppImages[i] == NULL) continue;
+			index.push_back(i);
+			images.push_back(p_ppImages[i]);
+		}
+		if (images.empty()) return;
+
+		size_t n = images.size();
+		std::vector<int> errors(n, OK);
+		std::vector<char*> msgs(n);
+		for (size_t j = 0; j < n; j++) msgs[j] = p_ppszMsgs[index[j]];
+		//. the SDK reads one meta per image.
+		std::vector<CMeta_t> metas(p_pMeta != NULL ? n : 0, p_pMeta != NULL ? *p_pMeta : CMeta_t());
+
+		CPipelineResult_t* results = NULL;
+		{
+			LazyLease<CPipeline_t> lease(*m_pPool);
+			if (lease.get() == NULL) {
+				for (size_t j = 0; j < n; j++) snprintf(msgs[j], MESSAGE_BUFFER_SIZE, "%s", lease.error().c_str());
+			}
+			else results = FaceSdk::pipeline_check_liveness_batch2(lease.get(), images.data(), n, p_pMeta != NULL ? metas.data() : NULL, errors.data(), msgs.data());
+		}
+		for (size_t j = 0; j < n; j++) {
+			p_pErrors[index[j]] = results != NULL ? errors[j] : UNKNOWN;
+			if (results != NULL) p_pResults[index[j]] = results[j];
+		}
+		if (results != NULL) face_sdk_api().CPipelineResult_destroy_array(results);
+	}
+
+private:
+	bool build(std::vector<void*>& p_vPipelines, std::string& p_strErr)
+	{
+		char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+		int		err = OK;
+
+		m_pConfig = face_sdk_api().config_create(g_Settings.configDir.c_str(), m_settings.gpuConfig.c_str(), &err, msg);
+		if (m_pConfig == NULL) {
+			p_strErr = msg;
+			return false;
+		}
+		for (size_t i = 0; i < m_nPipelines; i++) {
+			CPipeline_t* p = face_sdk_api().pipeline_create(g_Settings.pipelineName.c_str(), m_pConfig, &err, msg);
+			if (p == NULL) {
+				p_strErr = msg;
+				release(p_vPipelines);
+				p_vPipelines.clear();
+				return false;
+			}
+			p_vPipelines.push_back(p);
+		}
+		return true;
+	}
+
+	void release(std::vector<void*>& p_vPipelines)
+	{
+		for (void* p : p_vPipelines) face_sdk_api().pipeline_destroy((CPipeline_t*)p);
+		if (m_pConfig != NULL) face_sdk_api().config_destroy(m_pConfig);
+		m_pConfig = NULL;
+	}
+
+	DeviceSettings				m_settings;
+	CInitConfig_t*				m_pConfig;
+	size_t						m_nPipelines;
+	LazyPool*					m_pPool = NULL;
+};
+
+class DeviceBackend : public InferenceBackend {
+public:
+	DeviceBackend(InferenceBackend* p_pCpu, GpuBackend* p_pGpu, const DeviceSettings& p_settings)
+		: m_pCpu(p_pCpu), m_pGpu(p_pGpu), m_settings(p_settings)
+	{
+		for (int i = 0; i < MI_DEVICE_COUNT; i++) m_nInflight[i] = 0;
+	}
+	~DeviceBackend()
+	{
+		delete m_pGpu;
+		delete m_pCpu;
+	}
+
+	const char* name() const override { return m_pCpu->name(); }
+
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		Ticket t(*this, pick_single());
+		return backend(t.device())->check(p_pData, p_nLen, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		Ticket t(*this, pick_single());
+		return backend(t.device())->check_pixels(p_pPixels, p_nWidth, p_nHeight, p_encoding, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override
+	{
+		Ticket t(*this, pick_batch(p_vData.size()));
+		backend(t.device())->check_batch(p_vData, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+	}
+
+	void warm_up(int p_nIterations) override { m_pCpu->warm_up(p_nIterations); }
+	BackendRuntime runtime() const override { return m_pCpu->runtime(); }
+
+private:
+	//. one call on one device : in-flight count and busy time.
+	class Ticket {
+	public:
+		Ticket(DeviceBackend& p_owner, MiDevice p_device) : m_owner(p_owner), m_device(p_device), m_start(std::chrono::steady_clock::now())
+		{
+			mi_metrics_device_inflight(m_device, ++m_owner.m_nInflight[m_device]);
+		}
+		~Ticket()
+		{
+			mi_metrics_device_inflight(m_device, --m_owner.m_nInflight[m_device]);
+			mi_metrics_device_call(m_device, std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count());
+		}
+		MiDevice device() const { return m_device; }
+
+	private:
+		DeviceBackend&							m_owner;
+		MiDevice								m_device;
+		std::chrono::steady_clock::time_point	m_start;
+	};
+
+	InferenceBackend* backend(MiDevice p_device) const
+	{
+		return p_device == MI_DEVICE_GPU ? (InferenceBackend*)m_pGpu : m_pCpu;
+	}
+
+	MiDevice pick_single() const
+	{
+		if (m_settings.cpuBusy > 0 && m_nInflight[MI_DEVICE_CPU].load() >= m_settings.cpuBusy
+			&& m_nInflight[MI_DEVICE_GPU].load() < (int)m_pGpu->pipelines()) return MI_DEVICE_GPU;
+		return MI_DEVICE_CPU;
+	}
+
+	MiDevice pick_batch(size_t p_nImages) const
+	{
+		if ((int)p_nImages >= m_settings.gpuMinBatch && m_nInflight[MI_DEVICE_GPU].load() < m_settings.gpuMaxQueue) return MI_DEVICE_GPU;
+		return MI_DEVICE_CPU;
+	}
+
+	InferenceBackend*	m_pCpu;
+	GpuBackend*			m_pGpu;
+	DeviceSettings		m_settings;
+	std::atomic<int>	m_nInflight[MI_DEVICE_COUNT];
+};
+
+InferenceBackend* mi_device_create(InferenceBackend* p_pCpu, const DeviceSettings& p_settings, std::string& p_strErr)
+{
+	GpuBackend* pGpu = new GpuBackend;
+	if (!pGpu->start(p_settings, p_strErr)) {
+		delete pGpu;
+		return NULL;
+	}
+	return new DeviceBackend(p_pCpu, pGpu, p_settings);
+}
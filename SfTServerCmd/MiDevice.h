@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include "MiBackend.h"
+
+//. CPU + GPU dispatch for the legacy engine ([device] settings). The SDK picks the
+//. OpenVINO device from its pipeline config, so the GPU pipelines are built from a
+//. second config in sdk.config_dir (gpu_config, whose engines name the GPU plugin of
+//. libs/plugins.xml) next to the CPU pipelines of the batcher / pool.
+//. Dispatch per call, by the number of calls in flight on each device :
+//. - batches of at least gpu_min_batch images go to the GPU unless gpu_max_queue calls
+//.   already run or wait there;
+//. - single images stay on the CPU, they spill to an idle GPU pipeline only once
+//.   cpu_busy calls are in flight on the CPU (0 = never).
+//. Gate, crop and decode apply on both devices. Busy time, calls and calls in flight per
+//. device are on GD_API_METRICS (mi_device_*). With gpu_lazy the GPU pipelines are built by
+//. the first call dispatched there (MiLazyPool.h), a failed build fails that call.
+
+enum MiDevice {
+	MI_DEVICE_CPU = 0,
+	MI_DEVICE_GPU,
+	MI_DEVICE_COUNT
+};
+
+struct DeviceSettings {
+	std::string	gpuConfig;		//. config_create name of the GPU pipelines
+	int			gpuPipelines;
+	int			gpuMinBatch;
+	int			gpuMaxQueue;
+	int			cpuBusy;
+	bool		gpuLazy;		//. GPU pipelines built on the first GPU call, see MiLazyPool.h
+	int			gpuIdleEvictMs;
+};
+
+//. wraps p_pCpu (owned from then on) in the dispatcher. NULL and p_strErr set when the
+//. GPU pipelines cannot be built; p_pCpu is left to the caller then.
+InferenceBackend* mi_device_create(InferenceBackend* p_pCpu, const DeviceSettings& p_settings, std::string& p_strErr);
+
+const char* mi_device_name(MiDevice p_device);
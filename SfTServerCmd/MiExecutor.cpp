@@ -0,0 +1,190 @@
+#include "MiExecutor.h"
+#include "MiCores.h"
+#include "MiLock.h"
+#include <exception>
+
+Executor* g_pExecutor = NULL;
+
+//. worker index of the calling thread in lv_pOwner, -1 on other threads.
+static thread_local Executor*	lv_pOwner = NULL;
+static thread_local int			lv_nWorker = -1;
+
+//. one parallel_for : indices are claimed from next by the caller and the helper tasks,
+//. the caller waits for done to reach count. Helpers running after the last index was
+//. claimed leave without touching fn, which lives on the caller's stack.
+struct ForGroup {
+	size_t									count;
+	const std::function<void(size_t)>*		fn;
+	std::atomic<size_t>						next;
+	std::atomic<size_t>						done;
+	std::exception_ptr						error;
+	MI_MUTEX(mtx, "executor.group");
+	MiCondition								cv;
+
+	ForGroup(size_t p_nCount, const std::function<void(size_t)>* p_fn) : count(p_nCount), fn(p_fn), next(0), done(0) {}
+
+	void work()
+	{
+		size_t i;
+		while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+			try {
+				(*fn)(i);
+			}
+			catch (...) {
+				MiLockGuard lock(mtx);
+				if (!error) error = std::current_exception();
+			}
+			if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+				MiLockGuard lock(mtx);
+				cv.notify_all();
+			}
+		}
+	}
+};
+
+Executor::Executor(int p_nThreads)
+	: m_nThreads(p_nThreads > 0 ? p_nThreads : 1)
+	, m_bStop(false)
+	, m_nNext(0)
+	, m_nPending(0)
+	, m_nSteals(0)
+	, m_nTasks(0)
+{
+	for (int i = 0; i < m_nThreads; i++) m_vWorkers.emplace_back(new Worker);
+}
+
+Executor::~Executor()
+{
+	stop();
+}
+
+void Executor::start()
+{
+	MiLockGuard lock(m_mtxIdle);
+	if (!m_threads.empty()) return;
+	m_bStop = false;
+	for (int i = 0; i < m_nThreads; i++) {
+		m_threads.emplace_back(&Executor::run, this, i);
+	}
+}
+
+void Executor::stop()
+{
+	{
+		MiLockGuard lock(m_mtxIdle);
+		m_bStop = true;
+	}
+	m_cvIdle.notify_all();
+	for (auto& t : m_threads) {
+		if (t.joinable()) t.join();
+	}
+	m_threads.clear();
+}
+
+void Executor::submit(std::function<void()> p_fn)
+{
+	bool bInline;
+	{
+		MiLockGuard lock(m_mtxIdle);
+		bInline = m_bStop || m_threads.empty();
+	}
+	if (bInline) {
+		p_fn();
+		return;
+	}
+	int w = lv_pOwner == this ? lv_nWorker : (int)(m_nNext.fetch_add(1, std::memory_order_relaxed) % (unsigned)m_nThreads);
+	{
+		MiLockGuard lock(m_vWorkers[w]->mtx);
+		m_vWorkers[w]->tasks.push_back(std::move(p_fn));
+	}
+	m_nPending.fetch_add(1, std::memory_order_release);
+	{
+		//. taken so a worker between its last look and its wait cannot miss the wake-up.
+		MiLockGuard lock(m_mtxIdle);
+	}
+	m_cvIdle.notify_one();
+}
+
+bool Executor::take(int p_nIndex, std::function<void()>& p_fn)
+{
+	if (m_nPending.load(std::memory_order_acquire) <= 0) return false;
+	{
+		Worker& own = *m_vWorkers[p_nIndex];
+		MiLockGuard lock(own.mtx);
+		if (!own.tasks.empty()) {
+			p_fn = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			m_nPending.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	for (int k = 1; k < m_nThreads; k++) {
+		Worker& victim = *m_vWorkers[(p_nIndex + k) % m_nThreads];
+		MiLockGuard lock(victim.mtx);
+		if (!victim.tasks.empty()) {
+			p_fn = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			m_nPending.fetch_sub(1, std::memory_order_relaxed);
+			m_nSteals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void Executor::run(int p_nIndex)
+{
+	mi_cores_pin(MI_CORES_INFERENCE);
+	lv_pOwner = this;
+	lv_nWorker = p_nIndex;
+	std::function<void()> fn;
+	while (true) {
+		if (take(p_nIndex, fn)) {
+			fn();
+			fn = nullptr;
+			m_nTasks.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+		MiUniqueLock lock(m_mtxIdle);
+		//. queued work is finished before the workers leave.
+		if (m_nPending.load(std::memory_order_acquire) > 0) continue;
+		if (m_bStop) break;
+		m_cvIdle.wait(lock, [this] { return m_bStop || m_nPending.load(std::memory_order_acquire) > 0; });
+	}
+	lv_pOwner = NULL;
+	lv_nWorker = -1;
+}
+
+void Executor::parallel_for(size_t p_nCount, const std::function<void(size_t)>& p_fn)
+{
+	if (p_nCount == 0) return;
+	auto group = std::make_shared<ForGroup>(p_nCount, &p_fn);
+	size_t nHelpers = p_nCount - 1 < (size_t)m_nThreads ? p_nCount - 1 : (size_t)m_nThreads;
+	for (size_t i = 0; i < nHelpers; i++) {
+		submit([group] { group->work(); });
+	}
+	group->work();
+	{
+		MiUniqueLock lock(group->mtx);
+		group->cv.wait(lock, [&group] { return group->done.load(std::memory_order_acquire) == group->count; });
+	}
+	if (group->error) std::rethrow_exception(group->error);
+}
+
+int mi_executor_threads(int p_nThreads, int p_nEngineThreads, int p_nPipelines)
+{
+	if (p_nThreads > 0) return p_nThreads;
+	int cores = (int)std::thread::hardware_concurrency();
+	if (cores <= 0) cores = 1;
+	int n = p_nEngineThreads > 0 ? cores - p_nEngineThreads * (p_nPipelines > 0 ? p_nPipelines : 1) : cores / 4;
+	return n > 0 ? n : 1;
+}
+
+void mi_parallel_for(size_t p_nCount, const std::function<void(size_t)>& p_fn)
+{
+	if (g_pExecutor == NULL || p_nCount < 2) {
+		for (size_t i = 0; i < p_nCount; i++) p_fn(i);
+		return;
+	}
+	g_pExecutor->parallel_for(p_nCount, p_fn);
+}
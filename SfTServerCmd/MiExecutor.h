@@ -0,0 +1,69 @@
+#pragma once
+
+#include "MiLock.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//. Work-stealing executor for the CPU work around the SDK calls ([executor] settings) :
+//. decoding the images of a batch body, image creation in the backends. Each worker owns
+//. a deque; work submitted from a worker goes to the back of its own deque and is taken
+//. from there (newest first, still in cache), idle workers steal the oldest task from the
+//. front of another worker's deque. Work submitted from other threads is dealt round robin.
+//. The worker count is taken out of the same cores the SDK's TBB arenas use : by default
+//. the cores left after sdk.num_threads_engine x pipelines, a quarter of them when the SDK
+//. sizes itself, so the two pools do not oversubscribe the machine.
+//. The request threads (Poco / the reactor's WorkerPool) stay as they are : they admit,
+//. read and answer requests and hand the parallel parts here.
+
+class Executor {
+public:
+	explicit Executor(int p_nThreads);
+	~Executor();
+
+	void start();
+	void stop();
+
+	//. runs p_fn on a worker; on the calling thread once the executor is stopped.
+	void submit(std::function<void()> p_fn);
+
+	//. p_fn(0) .. p_fn(p_nCount - 1) on the workers and the calling thread, returns when all
+	//. have run. The caller takes indices too, so nested calls from a worker cannot deadlock.
+	void parallel_for(size_t p_nCount, const std::function<void(size_t)>& p_fn);
+
+	int threads() const { return m_nThreads; }
+	unsigned long long steals() const { return m_nSteals.load(std::memory_order_relaxed); }
+	unsigned long long tasks() const { return m_nTasks.load(std::memory_order_relaxed); }
+
+private:
+	struct Worker {
+		MI_MUTEX(mtx, "executor.worker");
+		std::deque<std::function<void()>>	tasks;
+	};
+
+	void run(int p_nIndex);
+	//. next task for worker p_nIndex : its own newest, else the oldest of another one.
+	bool take(int p_nIndex, std::function<void()>& p_fn);
+
+	int									m_nThreads;
+	bool								m_bStop;
+	std::vector<std::unique_ptr<Worker>> m_vWorkers;
+	std::vector<std::thread>			m_threads;
+	std::atomic<unsigned int>			m_nNext;		//. round robin of outside submits
+	std::atomic<int>					m_nPending;		//. queued, not yet taken
+	std::atomic<unsigned long long>		m_nSteals;
+	std::atomic<unsigned long long>		m_nTasks;
+	MI_MUTEX(m_mtxIdle, "executor.idle");
+	MiCondition							m_cvIdle;
+};
+
+extern Executor* g_pExecutor;
+
+//. worker count for [executor] threads = p_nThreads (0 = auto, see above).
+int mi_executor_threads(int p_nThreads, int p_nEngineThreads, int p_nPipelines);
+
+//. g_pExecutor->parallel_for, or a plain loop without an executor or for a single item.
+void mi_parallel_for(size_t p_nCount, const std::function<void(size_t)>& p_fn);
@@ -0,0 +1,369 @@
+#include "MiFaceCrop.h"
+#include "MiImage.h"
+#include "MiImageInfo.h"
+#include "MiResize.h"
+#include "MiPlatform.h"
+#include "MiSdkCall.h"
+#include "MiLock.h"
+#if MI_HAS_WIC
+#include "MiWic.h"
+#endif
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static CropSettings						lv_settings;
+static CInitConfig_t*					lv_pConfig = NULL;
+static std::vector<CDetectEngine_t*>	lv_vFree;
+static size_t							lv_nDetectors = 0;
+static MI_MUTEX(lv_mtx, "face_crop");
+static MiCondition						lv_cv;
+
+//. RAII borrow of one detector.
+class DetectorLease {
+public:
+	DetectorLease()
+	{
+		MiUniqueLock lock(lv_mtx);
+		lv_cv.wait(lock, [] { return !lv_vFree.empty(); });
+		m_pEngine = lv_vFree.back();
+		lv_vFree.pop_back();
+	}
+	~DetectorLease()
+	{
+		{
+			MiLockGuard lock(lv_mtx);
+			lv_vFree.push_back(m_pEngine);
+		}
+		lv_cv.notify_one();
+	}
+	CDetectEngine_t* engine() const { return m_pEngine; }
+
+private:
+	CDetectEngine_t* m_pEngine;
+};
+
+bool mi_crop_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const CropSettings& p_settings, std::string& p_strErr)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	lv_settings = p_settings;
+	if (lv_settings.detectors < 1) lv_settings.detectors = 1;
+	if (lv_settings.targetSize < 64) lv_settings.targetSize = 64;
+	if (lv_settings.detectSide < 64) lv_settings.detectSide = 64;
+
+	lv_pConfig = face_sdk_api().config_create(p_strConfigDir.c_str(), p_strConfigName.c_str(), &err, msg);
+	if (lv_pConfig == NULL) {
+		p_strErr = msg;
+		return false;
+	}
+	for (int i = 0; i < lv_settings.detectors; i++) {
+		CDetectEngine_t* p = face_sdk_api().detection_create(lv_settings.detector.c_str(), lv_pConfig, &err, msg);
+		if (p == NULL) {
+			p_strErr = msg;
+			mi_crop_shutdown();
+			return false;
+		}
+		lv_vFree.push_back(p);
+	}
+	lv_nDetectors = lv_vFree.size();
+	return true;
+}
+
+void mi_crop_shutdown()
+{
+	MiLockGuard lock(lv_mtx);
+	for (CDetectEngine_t* p : lv_vFree) face_sdk_api().detection_destroy(p);
+	lv_vFree.clear();
+	lv_nDetectors = 0;
+	if (lv_pConfig != NULL) {
+		face_sdk_api().config_destroy(lv_pConfig);
+		lv_pConfig = NULL;
+	}
+}
+
+bool mi_crop_enabled()
+{
+	return lv_nDetectors > 0;
+}
+
+//. faces of a packed frame in its own coordinates, largest first.
+static bool detect_boxes(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, std::vector<CBoundingBox_t>& p_vBoxes)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	p_vBoxes.clear();
+	CImage_t* image = FaceSdk::image_create_pixels(p_pPixels, (size_t)p_nHeight, (size_t)p_nWidth, p_encoding, &err, msg);
+	if (image == NULL) return false;
+
+	CBoundingBoxes_t* boxes = NULL;
+	{
+		DetectorLease lease;
+		boxes = FaceSdk::detect_only_bounding_box(lease.engine(), image, &err, msg);
+	}
+	face_sdk_api().image_destroy(image);
+	if (boxes == NULL) return false;
+
+	for (unsigned int i = 0; i < boxes->num_boxes; i++) {
+		const CBoundingBox_t& b = boxes->boxes[i];
+		if (b.bottom_right_x > b.left_top_x && b.bottom_right_y > b.left_top_y) p_vBoxes.push_back(b);
+	}
+	face_sdk_api().CBoundingBoxes_destroy(boxes);
+	std::stable_sort(p_vBoxes.begin(), p_vBoxes.end(), [](const CBoundingBox_t& a, const CBoundingBox_t& b) {
+		return (long)(a.bottom_right_x - a.left_top_x) * (a.bottom_right_y - a.left_top_y) > (long)(b.bottom_right_x - b.left_top_x) * (b.bottom_right_y - b.left_top_y);
+	});
+	return true;
+}
+
+//. largest face of a packed frame, in its own coordinates.
+static bool detect_largest(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, CBoundingBox_t& p_box)
+{
+	std::vector<CBoundingBox_t> vBoxes;
+	if (!detect_boxes(p_pPixels, p_nWidth, p_nHeight, p_encoding, vBoxes) || vBoxes.empty()) return false;
+	p_box = vBoxes[0];
+	return true;
+}
+
+//. detection box scaled by p_dScale back to the full frame.
+static CBoundingBox_t scale_box(const CBoundingBox_t& p_box, double p_dScale)
+{
+	CBoundingBox_t b;
+	b.left_top_x = (int)(p_box.left_top_x * p_dScale);
+	b.left_top_y = (int)(p_box.left_top_y * p_dScale);
+	b.bottom_right_x = (int)(p_box.bottom_right_x * p_dScale);
+	b.bottom_right_y = (int)(p_box.bottom_right_y * p_dScale);
+	return b;
+}
+
+struct CropRect {
+	int x, y, w, h;
+};
+
+//. detection box (scaled by p_dScale back to the full frame) widened by the margin.
+static CropRect crop_rect(const CBoundingBox_t& p_box, double p_dScale, int p_nWidth, int p_nHeight)
+{
+	double x0 = p_box.left_top_x * p_dScale, y0 = p_box.left_top_y * p_dScale;
+	double x1 = p_box.bottom_right_x * p_dScale, y1 = p_box.bottom_right_y * p_dScale;
+	double side = (x1 - x0 > y1 - y0 ? x1 - x0 : y1 - y0) * (1.0 + 2.0 * lv_settings.margin);
+	double cx = (x0 + x1) / 2, cy = (y0 + y1) / 2;
+
+	CropRect r;
+	r.x = (int)(cx - side / 2); if (r.x < 0) r.x = 0;
+	r.y = (int)(cy - side / 2); if (r.y < 0) r.y = 0;
+	int xe = (int)(cx + side / 2); if (xe > p_nWidth) xe = p_nWidth;
+	int ye = (int)(cy + side / 2); if (ye > p_nHeight) ye = p_nHeight;
+	r.w = xe - r.x;
+	r.h = ye - r.y;
+	return r;
+}
+
+//. scales p_nWidth x p_nHeight so the long side is at most p_nSide.
+static void fit(int p_nWidth, int p_nHeight, int p_nSide, int& p_nOutW, int& p_nOutH)
+{
+	int longSide = p_nWidth > p_nHeight ? p_nWidth : p_nHeight;
+	if (longSide <= p_nSide) {
+		p_nOutW = p_nWidth;
+		p_nOutH = p_nHeight;
+		return;
+	}
+	p_nOutW = (int)((long long)p_nWidth * p_nSide / longSide); if (p_nOutW < 1) p_nOutW = 1;
+	p_nOutH = (int)((long long)p_nHeight * p_nSide / longSide); if (p_nOutH < 1) p_nOutH = 1;
+}
+
+//. p_pSrc (packed rows of p_nStride bytes) resized into p_out to fit targetSize.
+static void emit(const uint8_t* p_pSrc, int p_nWidth, int p_nHeight, size_t p_nStride, CropFrame& p_out)
+{
+	fit(p_nWidth, p_nHeight, lv_settings.targetSize, p_out.width, p_out.height);
+	p_out.pixels.resize((size_t)p_out.width * p_out.height * 3);
+	if (p_out.width == p_nWidth && p_out.height == p_nHeight) {
+		for (int y = 0; y < p_nHeight; y++) memcpy(&p_out.pixels[(size_t)y * p_nWidth * 3], p_pSrc + (size_t)y * p_nStride, (size_t)p_nWidth * 3);
+		return;
+	}
+	mi_resize_bgr(p_pSrc, p_nWidth, p_nHeight, p_nStride, p_out.pixels.data(), p_out.width, p_out.height, (size_t)p_out.width * 3);
+}
+
+bool mi_crop_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding, CropFrame& p_out)
+{
+	if (!mi_crop_enabled()) return false;
+	if ((p_nWidth > p_nHeight ? p_nWidth : p_nHeight) < lv_settings.minImageSide) return false;
+
+	int dw = 0, dh = 0;
+	fit(p_nWidth, p_nHeight, lv_settings.detectSide, dw, dh);
+	PixelBuffer small((size_t)dw * dh * 3);
+	mi_resize_bgr(p_pPixels, p_nWidth, p_nHeight, p_nStride, small.data(), dw, dh, (size_t)dw * 3);
+
+	CBoundingBox_t box;
+	if (!detect_largest(small.data(), dw, dh, p_encoding, box)) return false;
+
+	CropRect r = crop_rect(box, (double)p_nWidth / dw, p_nWidth, p_nHeight);
+	if (r.w <= 0 || r.h <= 0) return false;
+	emit(p_pPixels + (size_t)r.y * p_nStride + (size_t)r.x * 3, r.w, r.h, p_nStride, p_out);
+	return true;
+}
+
+bool mi_crop_faces_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding, size_t p_nMaxFaces, std::vector<FaceCrop>& p_vOut, size_t* p_pFound)
+{
+	p_vOut.clear();
+	*p_pFound = 0;
+	if (!mi_crop_enabled()) return false;
+
+	int dw = 0, dh = 0;
+	fit(p_nWidth, p_nHeight, lv_settings.detectSide, dw, dh);
+	PixelBuffer small((size_t)dw * dh * 3);
+	mi_resize_bgr(p_pPixels, p_nWidth, p_nHeight, p_nStride, small.data(), dw, dh, (size_t)dw * 3);
+
+	std::vector<CBoundingBox_t> vBoxes;
+	if (!detect_boxes(small.data(), dw, dh, p_encoding, vBoxes)) return false;
+	*p_pFound = vBoxes.size();
+	double dScale = (double)p_nWidth / dw;
+	for (size_t i = 0; i < vBoxes.size() && p_vOut.size() < p_nMaxFaces; i++) {
+		CropRect r = crop_rect(vBoxes[i], dScale, p_nWidth, p_nHeight);
+		if (r.w <= 0 || r.h <= 0) continue;
+		p_vOut.emplace_back();
+		p_vOut.back().box = scale_box(vBoxes[i], dScale);
+		emit(p_pPixels + (size_t)r.y * p_nStride + (size_t)r.x * 3, r.w, r.h, p_nStride, p_vOut.back().frame);
+	}
+	return true;
+}
+
+bool mi_crop_yuv(const MiYuvFrame& p_frame, CropFrame& p_out)
+{
+	if (!mi_crop_enabled()) return false;
+	if ((p_frame.width > p_frame.height ? p_frame.width : p_frame.height) < lv_settings.minImageSide) return false;
+
+	int dw = 0, dh = 0;
+	fit(p_frame.width, p_frame.height, lv_settings.detectSide, dw, dh);
+	PixelBuffer small((size_t)dw * dh * 3);
+	mi_color_yuv_nearest(p_frame, dw, dh, small.data(), (size_t)dw * 3, BGR888);
+
+	CBoundingBox_t box;
+	if (!detect_largest(small.data(), dw, dh, BGR888, box)) return false;
+
+	CropRect r = crop_rect(box, (double)p_frame.width / dw, p_frame.width, p_frame.height);
+	//. chroma is shared by 2 x 2 pixels, the rectangle starts on an even pixel.
+	r.w += r.x & 1; r.x &= ~1;
+	r.h += r.y & 1; r.y &= ~1;
+	if (r.w <= 0 || r.h <= 0) return false;
+
+	PixelBuffer face((size_t)r.w * r.h * 3);
+	mi_color_yuv_rect(p_frame, r.x, r.y, r.w, r.h, face.data(), (size_t)r.w * 3, BGR888);
+	emit(face.data(), r.w, r.h, (size_t)r.w * 3, p_out);
+	return true;
+}
+
+#if MI_HAS_WIC
+//. decoded upload of the encoded path : the cached full-resolution bitmap and the
+//. detection copy scaled from it.
+struct WicFrame {
+	ComRef<IWICStream>				stream;
+	ComRef<IWICBitmapDecoder>		decoder;
+	ComRef<IWICBitmapFrameDecode>	frame;
+	ComRef<IWICBitmap>				bitmap;
+	UINT							width, height;
+	PixelBuffer						small;
+	int								dw, dh;
+	WicFrame() : width(0), height(0), dw(0), dh(0) {}
+};
+
+//. false for what the encoded path leaves to the full image; p_nMinSide is the long side below
+//. which it does not pay.
+static bool wic_prepare(const uint8_t* p_pData, size_t p_nLen, int p_nMinSide, WicFrame& p_wic)
+{
+	//. small and rotated photos are known from the header, without opening a decoder.
+	ImageInfo info;
+	if (mi_image_info(p_pData, p_nLen, info) && (info.long_side() < p_nMinSide || info.orientation != 1)) return false;
+
+	//. a missing WIC only disables the encoded path.
+	if (!mi_wic_open(p_pData, p_nLen, p_wic.stream, p_wic.decoder, p_wic.frame)) return false;
+	IWICImagingFactory* factory = mi_wic_factory();
+
+	UINT w = 0, h = 0;
+	if (FAILED(p_wic.frame->GetSize(&w, &h)) || w == 0 || h == 0) return false;
+	if ((int)(w > h ? w : h) < p_nMinSide) return false;
+	p_wic.width = w;
+	p_wic.height = h;
+
+	//. rotated photos keep the full path.
+	if (mi_wic_rotated(p_wic.frame.p)) return false;
+
+	//. the frame is decoded once into a cached bitmap that both passes below read, rather
+	//. than once by the scaler and again by the face rectangle converter.
+	if (FAILED(factory->CreateBitmapFromSource(p_wic.frame.p, WICBitmapCacheOnDemand, &p_wic.bitmap.p))) return false;
+	mi_image_count_decode(p_pData);
+
+	//. detection copy scaled from the decoded bitmap.
+	fit((int)w, (int)h, lv_settings.detectSide, p_wic.dw, p_wic.dh);
+	p_wic.small.resize((size_t)p_wic.dw * p_wic.dh * 3);
+	ComRef<IWICBitmapScaler> scaler;
+	ComRef<IWICFormatConverter> conv;
+	if (FAILED(factory->CreateBitmapScaler(&scaler.p))) return false;
+	if (FAILED(scaler->Initialize(p_wic.bitmap.p, (UINT)p_wic.dw, (UINT)p_wic.dh, WICBitmapInterpolationModeFant))) return false;
+	if (FAILED(factory->CreateFormatConverter(&conv.p))) return false;
+	if (FAILED(conv->Initialize(scaler.p, GUID_WICPixelFormat24bppBGR, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom))) return false;
+	if (FAILED(conv->CopyPixels(NULL, (UINT)p_wic.dw * 3, (UINT)p_wic.small.size(), p_wic.small.data()))) return false;
+	return true;
+}
+
+//. only the face rectangle is converted at full resolution.
+static bool wic_face(WicFrame& p_wic, const CropRect& p_rect, CropFrame& p_out)
+{
+	PixelBuffer face((size_t)p_rect.w * p_rect.h * 3);
+	ComRef<IWICFormatConverter> conv;
+	WICRect rc = { p_rect.x, p_rect.y, p_rect.w, p_rect.h };
+	if (FAILED(mi_wic_factory()->CreateFormatConverter(&conv.p))) return false;
+	if (FAILED(conv->Initialize(p_wic.bitmap.p, GUID_WICPixelFormat24bppBGR, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom))) return false;
+	if (FAILED(conv->CopyPixels(&rc, (UINT)p_rect.w * 3, (UINT)face.size(), face.data()))) return false;
+	emit(face.data(), p_rect.w, p_rect.h, (size_t)p_rect.w * 3, p_out);
+	return true;
+}
+#endif
+
+bool mi_crop_encoded(const uint8_t* p_pData, size_t p_nLen, CropFrame& p_out)
+{
+#if MI_HAS_WIC
+	if (!mi_crop_enabled()) return false;
+
+	WicFrame wic;
+	if (!wic_prepare(p_pData, p_nLen, lv_settings.minImageSide, wic)) return false;
+
+	CBoundingBox_t box;
+	if (!detect_largest(wic.small.data(), wic.dw, wic.dh, BGR888, box)) return false;
+	CropRect r = crop_rect(box, (double)wic.width / wic.dw, (int)wic.width, (int)wic.height);
+	if (r.w <= 0 || r.h <= 0) return false;
+	return wic_face(wic, r, p_out);
+#else
+	//. no decoder without WIC; raw pixel uploads still take mi_crop_pixels.
+	return false;
+#endif
+}
+
+bool mi_crop_faces_encoded(const uint8_t* p_pData, size_t p_nLen, size_t p_nMaxFaces, std::vector<FaceCrop>& p_vOut, size_t* p_pFound)
+{
+	p_vOut.clear();
+	*p_pFound = 0;
+#if MI_HAS_WIC
+	if (!mi_crop_enabled()) return false;
+
+	//. a group photo is cropped whatever its size.
+	WicFrame wic;
+	if (!wic_prepare(p_pData, p_nLen, 0, wic)) return false;
+
+	std::vector<CBoundingBox_t> vBoxes;
+	if (!detect_boxes(wic.small.data(), wic.dw, wic.dh, BGR888, vBoxes)) return false;
+	*p_pFound = vBoxes.size();
+	double dScale = (double)wic.width / wic.dw;
+	for (size_t i = 0; i < vBoxes.size() && p_vOut.size() < p_nMaxFaces; i++) {
+		CropRect r = crop_rect(vBoxes[i], dScale, (int)wic.width, (int)wic.height);
+		if (r.w <= 0 || r.h <= 0) continue;
+		p_vOut.emplace_back();
+		p_vOut.back().box = scale_box(vBoxes[i], dScale);
+		if (!wic_face(wic, r, p_vOut.back().frame)) return false;
+	}
+	return true;
+#else
+	(void)p_pData; (void)p_nLen; (void)p_nMaxFaces;
+	return false;
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiColor.h"
+#include "MiPixelPool.h"
+
+//. Face-crop fast path : large uploads are reduced to the face before liveness.
+//. The face is found with detect_only_bounding_box on a copy scaled to detect_side,
+//. the largest box is widened by margin (fraction of the box on each side), cut from
+//. the full-resolution frame and downscaled with mi_resize_bgr so its long side is
+//. at most target_size. The pipeline then runs on a frame of a few hundred KB instead
+//. of a 12 MP decode.
+//. Encoded uploads are decoded with WIC : the detection copy comes from the scaled
+//. decode path and only the face rectangle is converted at full resolution. Every
+//. function returns false when the fast path does not apply (small image, no face,
+//. EXIF rotation, unknown format); the caller then uses the full image.
+//. Builds without WIC (Linux) crop raw pixel uploads only.
+//. NV12 / I420 uploads are likewise detected on a point-sampled BGR copy; only the face
+//. rectangle is converted from YUV at full resolution (MiColor.h).
+//. Group photos (GD_API_FACES, MiFaces.h) take every face instead of the largest : one
+//. detection on the scaled copy, then each box is cropped the same way.
+//. Independent of g_Settings so SdkBench can time it against the full path.
+
+struct CropSettings {
+	float		margin;
+	int			targetSize;
+	int			minImageSide;	//. images whose long side is below this are not cropped
+	int			detectSide;
+	int			detectors;		//. CDetectEngine_t instances shared by the request threads
+	std::string	detector;		//. detection_create name
+};
+
+struct CropFrame {
+	PixelBuffer				pixels;		//. rows packed, channel order of the source (BGR for WIC)
+	int						width;
+	int						height;
+	CropFrame() : width(0), height(0) {}
+};
+
+struct FaceCrop {
+	CropFrame				frame;
+	CBoundingBox_t			box;		//. detection box in full-frame pixels, before the margin
+};
+
+bool mi_crop_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const CropSettings& p_settings, std::string& p_strErr);
+void mi_crop_shutdown();
+bool mi_crop_enabled();
+
+bool mi_crop_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding, CropFrame& p_out);
+//. p_out is BGR888.
+bool mi_crop_yuv(const MiYuvFrame& p_frame, CropFrame& p_out);
+bool mi_crop_encoded(const uint8_t* p_pData, size_t p_nLen, CropFrame& p_out);
+
+//. the at most p_nMaxFaces largest faces, largest first; *p_pFound is how many were detected.
+//. true with no crops when there is no face; false as above (never for a small image).
+bool mi_crop_faces_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding, size_t p_nMaxFaces, std::vector<FaceCrop>& p_vOut, size_t* p_pFound);
+bool mi_crop_faces_encoded(const uint8_t* p_pData, size_t p_nLen, size_t p_nMaxFaces, std::vector<FaceCrop>& p_vOut, size_t* p_pFound);
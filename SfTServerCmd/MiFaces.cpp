@@ -0,0 +1,39 @@
+#include "MiFaces.h"
+#include "MiInference.h"
+#include "MiMetrics.h"
+#include "MiSdkCall.h"
+#include <algorithm>
+
+static bool		lv_bEnable = false;
+static size_t	lv_nMaxFaces = 0;
+
+void mi_faces_init(bool p_bEnable, int p_nMaxFaces)
+{
+	lv_nMaxFaces = (size_t)std::max(p_nMaxFaces, 1);
+	lv_bEnable = p_bEnable;
+}
+
+bool mi_faces_enabled()
+{
+	return lv_bEnable && mi_crop_enabled();
+}
+
+size_t mi_faces_max()
+{
+	return lv_nMaxFaces;
+}
+
+void mi_faces_check(const std::vector<FaceCrop>& p_vCrops, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs)
+{
+	size_t n = p_vCrops.size();
+	std::vector<const CImage_t*> images(n, NULL);
+	for (size_t i = 0; i < n; i++) {
+		const CropFrame& f = p_vCrops[i].frame;
+		p_pErrors[i] = OK;
+		images[i] = FaceSdk::image_create_pixels(f.pixels.data(), (size_t)f.height, (size_t)f.width, p_encoding, &p_pErrors[i], p_ppszMsgs[i]);
+	}
+	mi_check_liveness_batch(images.data(), n, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+	for (size_t i = 0; i < n; i++) {
+		if (images[i] != NULL) face_sdk_api().image_destroy((CImage_t*)images[i]);
+	}
+}
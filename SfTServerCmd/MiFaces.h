@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiFaceCrop.h"
+
+//. Per-face liveness of a group photo for GD_API_FACES ([faces] settings, needs [crop]) :
+//. where the gate answers TOO_MANY_FACES, group enrollment wants a result for everyone in
+//. the picture. The upload is detected once on the crop detectors (mi_crop_faces_*), each
+//. face is cut out with the crop margin, and all crops go to the pipeline in one
+//. pipeline_check_liveness_batch2 call, so N faces cost one batched call rather than N
+//. requests. Results are keyed by the face's bounding box in the uploaded image; at most
+//. max_faces faces are checked, largest first, the rest are only counted.
+//. mi_faces_total{outcome=checked|dropped} on GD_API_METRICS.
+
+void mi_faces_init(bool p_bEnable, int p_nMaxFaces);
+bool mi_faces_enabled();
+size_t mi_faces_max();
+
+//. checks p_nCount crops in one batched call; a crop the SDK refuses keeps its STATUS in
+//. p_pErrors like a decode failure of a batch.
+void mi_faces_check(const std::vector<FaceCrop>& p_vCrops, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs);
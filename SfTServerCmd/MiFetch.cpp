@@ -0,0 +1,257 @@
+#include "MiFetch.h"
+#include "MiConf.h"
+#include "MiLock.h"
+#include "MiMetrics.h"
+#include "MiPlatform.h"
+#include "Poco/Exception.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/URI.h"
+#if MI_HAS_NETSSL
+#include "Poco/Net/Context.h"
+#include "Poco/Net/HTTPSClientSession.h"
+#include "Poco/Net/SSLManager.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+struct FetchIdle {
+	std::unique_ptr<Poco::Net::HTTPClientSession>	session;
+	uint64_t										since;		//. mi_tick_ms when it was given back
+};
+
+static bool								lv_bEnable = false;
+static FetchSettings					lv_settings;
+static size_t							lv_nMaxBytes = 0;
+static std::vector<std::string>			lv_vExact;
+static std::vector<std::string>			lv_vSuffix;			//. ".example.com" of "*.example.com"
+static MI_MUTEX(lv_mtx, "fetch");
+//. under lv_mtx, newest last; by "scheme://host:port".
+static std::map<std::string, std::vector<FetchIdle>>	lv_mapIdle;
+static int								lv_nIdle = 0;
+static std::atomic<uint64_t>			lv_nConnections(0);
+#if MI_HAS_NETSSL
+static Poco::Net::Context::Ptr			lv_pContext;
+#endif
+
+static const char* lv_szResults[MI_FETCH_COUNT] = { "ok", "denied", "too_large", "failed", "timeout" };
+
+static bool host_allowed(const std::string& p_strHost)
+{
+	std::string strHost = Poco::toLower(p_strHost);
+	for (const std::string& s : lv_vExact) {
+		if (strHost == s) return true;
+	}
+	for (const std::string& s : lv_vSuffix) {
+		if (strHost.size() > s.size() && strHost.compare(strHost.size() - s.size(), s.size(), s) == 0) return true;
+	}
+	return false;
+}
+
+//. drops the idle connections of p_vIdle past idle_sec, oldest first.
+static void idle_prune(std::vector<FetchIdle>& p_vIdle, uint64_t p_nNow)
+{
+	uint64_t nIdleMs = (uint64_t)lv_settings.idleSec * 1000;
+	size_t n = 0;
+	while (n < p_vIdle.size() && p_nNow - p_vIdle[n].since >= nIdleMs) n++;
+	p_vIdle.erase(p_vIdle.begin(), p_vIdle.begin() + (std::ptrdiff_t)n);
+	lv_nIdle -= (int)n;
+}
+
+static std::unique_ptr<Poco::Net::HTTPClientSession> session_take(const std::string& p_strKey, const Poco::URI& p_uri, bool p_bHttps, bool* p_pReused)
+{
+	{
+		MiLockGuard lock(lv_mtx);
+		std::map<std::string, std::vector<FetchIdle>>::iterator it = lv_mapIdle.find(p_strKey);
+		if (it != lv_mapIdle.end()) {
+			idle_prune(it->second, mi_tick_ms());
+			if (!it->second.empty()) {
+				std::unique_ptr<Poco::Net::HTTPClientSession> pSession = std::move(it->second.back().session);
+				it->second.pop_back();
+				lv_nIdle--;
+				*p_pReused = true;
+				return pSession;
+			}
+		}
+	}
+	*p_pReused = false;
+	std::unique_ptr<Poco::Net::HTTPClientSession> pSession;
+#if MI_HAS_NETSSL
+	if (p_bHttps) pSession.reset(new Poco::Net::HTTPSClientSession(p_uri.getHost(), p_uri.getPort(), lv_pContext));
+#else
+	(void)p_bHttps;
+#endif
+	if (!pSession) pSession.reset(new Poco::Net::HTTPClientSession(p_uri.getHost(), p_uri.getPort()));
+	pSession->setKeepAlive(true);
+	pSession->setKeepAliveTimeout(Poco::Timespan(lv_settings.idleSec, 0));
+	pSession->setTimeout(Poco::Timespan((long)lv_settings.timeoutMs * 1000));
+	lv_nConnections.fetch_add(1, std::memory_order_relaxed);
+	return pSession;
+}
+
+static void session_give(const std::string& p_strKey, std::unique_ptr<Poco::Net::HTTPClientSession> p_pSession)
+{
+	if (lv_settings.keepAlive <= 0) return;
+	MiLockGuard lock(lv_mtx);
+	std::vector<FetchIdle>& vIdle = lv_mapIdle[p_strKey];
+	uint64_t nNow = mi_tick_ms();
+	idle_prune(vIdle, nNow);
+	if ((int)vIdle.size() >= lv_settings.keepAlive) return;
+	FetchIdle idle;
+	idle.session = std::move(p_pSession);
+	idle.since = nNow;
+	vIdle.push_back(std::move(idle));
+	lv_nIdle++;
+}
+
+static FetchResult fetch_get(const std::string& p_strUrl, std::string* p_pOut, std::string& p_strErr)
+{
+	Poco::URI uri;
+	try {
+		uri = Poco::URI(p_strUrl);
+	}
+	catch (const Poco::Exception&) {
+		p_strErr = "invalid url";
+		return MI_FETCH_DENIED;
+	}
+	std::string strScheme = Poco::toLower(uri.getScheme());
+	bool bHttps = strScheme == "https";
+	if (strScheme != "http" && !(bHttps && MI_HAS_NETSSL)) {
+		p_strErr = MI_HAS_NETSSL ? "url must be http or https" : "url must be http";
+		return MI_FETCH_DENIED;
+	}
+	if (uri.getHost().empty() || !uri.getUserInfo().empty() || !host_allowed(uri.getHost())) {
+		p_strErr = "host not allowed : " + uri.getHost();
+		return MI_FETCH_DENIED;
+	}
+	std::string strKey = strScheme + "://" + Poco::toLower(uri.getHost()) + ":" + std::to_string(uri.getPort());
+	std::string strPath = uri.getPathEtc().empty() ? "/" : uri.getPathEtc();
+
+	for (int nAttempt = 0; nAttempt < 2; nAttempt++) {
+		bool bReused = false, bAnswered = false;
+		std::unique_ptr<Poco::Net::HTTPClientSession> pSession = session_take(strKey, uri, bHttps, &bReused);
+		p_pOut->clear();
+		try {
+			Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, strPath, Poco::Net::HTTPMessage::HTTP_1_1);
+			request.setKeepAlive(true);
+			pSession->sendRequest(request);
+			Poco::Net::HTTPResponse response;
+			std::istream& in = pSession->receiveResponse(response);
+			bAnswered = true;
+			//. a read error ends the body with its exception, not a short read.
+			in.exceptions(std::ios::badbit);
+			if (response.getStatus() < 200 || response.getStatus() >= 300) {
+				p_strErr = "upstream answered " + std::to_string((int)response.getStatus()) + " " + response.getReason();
+				return MI_FETCH_FAILED;
+			}
+			if (response.hasContentLength()) {
+				Poco::Int64 nLength = response.getContentLength64();
+				if ((Poco::UInt64)nLength > lv_nMaxBytes) {
+					p_strErr = "image exceeds fetch.max_mb";
+					return MI_FETCH_TOO_LARGE;
+				}
+				p_pOut->reserve((size_t)nLength);
+			}
+			char buf[16384];
+			while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+				if (p_pOut->size() + (size_t)in.gcount() > lv_nMaxBytes) {
+					p_strErr = "image exceeds fetch.max_mb";
+					return MI_FETCH_TOO_LARGE;
+				}
+				p_pOut->append(buf, (size_t)in.gcount());
+			}
+			if (response.hasContentLength() && (Poco::Int64)p_pOut->size() != response.getContentLength64()) {
+				p_strErr = "upstream body cut short";
+				return MI_FETCH_FAILED;
+			}
+			if (response.getKeepAlive()) session_give(strKey, std::move(pSession));
+			return MI_FETCH_OK;
+		}
+		catch (const Poco::TimeoutException& ex) {
+			p_strErr = ex.displayText();
+			return MI_FETCH_TIMEOUT;
+		}
+		catch (const Poco::Exception& ex) {
+			//. a kept connection the store has closed meanwhile : once more on a new one.
+			if (bReused && !bAnswered) continue;
+			p_strErr = ex.displayText();
+			return MI_FETCH_FAILED;
+		}
+	}
+	p_strErr = "connection lost";
+	return MI_FETCH_FAILED;
+}
+
+void mi_fetch_init(bool p_bEnable, const FetchSettings& p_settings)
+{
+	if (!p_bEnable) return;
+	lv_settings = p_settings;
+	lv_settings.timeoutMs = std::max(lv_settings.timeoutMs, 1);
+	lv_settings.idleSec = std::max(lv_settings.idleSec, 1);
+	lv_nMaxBytes = (size_t)std::max(lv_settings.maxMb, 1) * 1024 * 1024;
+	lv_vExact.clear();
+	lv_vSuffix.clear();
+	Poco::StringTokenizer tok(p_settings.hosts, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (const std::string& host : tok) {
+		std::string strHost = Poco::toLower(host);
+		if (strHost.compare(0, 2, "*.") == 0) lv_vSuffix.push_back(strHost.substr(1));
+		else lv_vExact.push_back(strHost);
+	}
+#if MI_HAS_NETSSL
+	Poco::Net::initializeSSL();
+	lv_pContext = new Poco::Net::Context(Poco::Net::Context::TLS_CLIENT_USE, "", Poco::Net::Context::VERIFY_RELAXED, 9, true);
+#endif
+	lv_bEnable = true;
+}
+
+void mi_fetch_shutdown()
+{
+	if (!lv_bEnable) return;
+	{
+		MiLockGuard lock(lv_mtx);
+		lv_mapIdle.clear();
+		lv_nIdle = 0;
+	}
+#if MI_HAS_NETSSL
+	lv_pContext = NULL;
+	Poco::Net::uninitializeSSL();
+#endif
+	lv_bEnable = false;
+}
+
+bool mi_fetch_enabled()
+{
+	return lv_bEnable;
+}
+
+FetchResult mi_fetch(const std::string& p_strUrl, std::string* p_pOut, std::string& p_strErr)
+{
+	FetchResult result = MI_FETCH_DENIED;
+	if (!lv_bEnable) p_strErr = "fetch is disabled ([fetch] enable)";
+	else result = fetch_get(p_strUrl, p_pOut, p_strErr);
+	if (result != MI_FETCH_OK) p_pOut->clear();
+	mi_metrics_fetch(result);
+	return result;
+}
+
+const char* mi_fetch_result_name(int p_nResult)
+{
+	return p_nResult >= 0 && p_nResult < MI_FETCH_COUNT ? lv_szResults[p_nResult] : "unknown";
+}
+
+uint64_t mi_fetch_connections()
+{
+	return lv_nConnections.load(std::memory_order_relaxed);
+}
+
+int mi_fetch_idle()
+{
+	MiLockGuard lock(lv_mtx);
+	return lv_nIdle;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+//. Server-side fetch of the image for GD_API_FULL_PROCESS_URL ([fetch] settings) : callers
+//. whose selfie already sits in object storage send {"url":"http://..."} instead of
+//. downloading and re-uploading it. Only hosts on the allow-list are fetched ("name" exact,
+//. "*.suffix" any subdomain), redirects are not followed, and a body over max_mb is refused
+//. from its Content-Length or cut while it streams. The response body is read straight into
+//. the request's pooled upload buffer, which goes to decode as an upload would.
+//. Connections are kept alive per scheme / host / port, at most keep_alive idle ones each for
+//. idle_sec; a kept connection the store closed meanwhile is retried once on a new one.
+//. https needs a build with Poco NetSSL (CMake MI_FETCH_HTTPS, MI_HAS_NETSSL); without it
+//. only http URLs are accepted, for in-network endpoints (MinIO, VPC endpoints, a TLS egress
+//. proxy ...). mi_fetch_total{result} and mi_fetch_connections_total on GD_API_METRICS.
+
+struct FetchSettings {
+	std::string	hosts;			//. comma-separated allow-list, empty = nothing is fetched
+	int			maxMb;
+	int			timeoutMs;		//. connect / send / receive, each
+	int			keepAlive;		//. idle connections kept per host
+	int			idleSec;		//. reuse window of an idle connection
+};
+
+enum FetchResult {
+	MI_FETCH_OK = 0,
+	MI_FETCH_DENIED,			//. bad URL, scheme or host off the allow-list
+	MI_FETCH_TOO_LARGE,			//. over max_mb
+	MI_FETCH_FAILED,			//. connection error or a non-2xx answer
+	MI_FETCH_TIMEOUT,
+	MI_FETCH_COUNT
+};
+
+void mi_fetch_init(bool p_bEnable, const FetchSettings& p_settings);
+void mi_fetch_shutdown();
+bool mi_fetch_enabled();
+
+//. GETs p_strUrl into p_pOut (cleared first); p_strErr says why on anything but MI_FETCH_OK.
+FetchResult mi_fetch(const std::string& p_strUrl, std::string* p_pOut, std::string& p_strErr);
+
+//. metric label of a FetchResult.
+const char* mi_fetch_result_name(int p_nResult);
+//. connections opened so far (the rest of the fetches reused one), idle ones now.
+uint64_t mi_fetch_connections();
+int mi_fetch_idle();
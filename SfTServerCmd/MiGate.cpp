@@ -0,0 +1,147 @@
+#include "MiGate.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "MiSdkCall.h"
+#include "MiLock.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const char* lv_szStages[MI_GATE_COUNT] = { "detection", "quality", "liveness" };
+
+//. one detector and one quality engine, borrowed together.
+struct GateEngines {
+	CDetectEngine_t*	detector;
+	CQualityEngine_t*	quality;
+};
+
+static GateSettings					lv_settings;
+static CInitConfig_t*				lv_pConfig = NULL;
+static std::vector<GateEngines>		lv_vFree;
+static size_t						lv_nEngines = 0;
+static MI_MUTEX(lv_mtx, "gate");
+static MiCondition					lv_cv;
+
+class GateLease {
+public:
+	GateLease()
+	{
+		MiUniqueLock lock(lv_mtx);
+		lv_cv.wait(lock, [] { return !lv_vFree.empty(); });
+		m_engines = lv_vFree.back();
+		lv_vFree.pop_back();
+	}
+	~GateLease()
+	{
+		{
+			MiLockGuard lock(lv_mtx);
+			lv_vFree.push_back(m_engines);
+		}
+		lv_cv.notify_one();
+	}
+	const GateEngines& engines() const { return m_engines; }
+
+private:
+	GateEngines m_engines;
+};
+
+static void destroy_engines(const GateEngines& p_engines)
+{
+	if (p_engines.detector != NULL) face_sdk_api().detection_destroy(p_engines.detector);
+	if (p_engines.quality != NULL) face_sdk_api().quality_destroy(p_engines.quality);
+}
+
+bool mi_gate_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const GateSettings& p_settings, std::string& p_strErr)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	lv_settings = p_settings;
+	if (lv_settings.engines < 1) lv_settings.engines = 1;
+
+	lv_pConfig = face_sdk_api().config_create(p_strConfigDir.c_str(), p_strConfigName.c_str(), &err, msg);
+	if (lv_pConfig == NULL) {
+		p_strErr = msg;
+		return false;
+	}
+	for (int i = 0; i < lv_settings.engines; i++) {
+		GateEngines e = { NULL, NULL };
+		e.detector = face_sdk_api().detection_create(lv_settings.detector.c_str(), lv_pConfig, &err, msg);
+		if (e.detector != NULL && lv_settings.minQuality >= 0) {
+			e.quality = face_sdk_api().quality_create(lv_settings.quality.c_str(), lv_pConfig, &err, msg);
+		}
+		if (e.detector == NULL || (lv_settings.minQuality >= 0 && e.quality == NULL)) {
+			p_strErr = msg;
+			destroy_engines(e);
+			mi_gate_shutdown();
+			return false;
+		}
+		lv_vFree.push_back(e);
+	}
+	lv_nEngines = lv_vFree.size();
+	return true;
+}
+
+void mi_gate_shutdown()
+{
+	MiLockGuard lock(lv_mtx);
+	for (const GateEngines& e : lv_vFree) destroy_engines(e);
+	lv_vFree.clear();
+	lv_nEngines = 0;
+	if (lv_pConfig != NULL) {
+		face_sdk_api().config_destroy(lv_pConfig);
+		lv_pConfig = NULL;
+	}
+}
+
+bool mi_gate_enabled()
+{
+	return lv_nEngines > 0;
+}
+
+bool mi_gate_check(const CImage_t* p_pImage, CPipelineResult_t& p_result, int* p_pErr, char* p_pszMsg)
+{
+	//. a broken image is reported by the pipeline as before.
+	if (!mi_gate_enabled() || p_pImage == NULL) return true;
+	//. short of budget : the pipeline's own quality check has to do.
+	if (mi_context_degrade(MI_DEGRADE_GATE)) return true;
+
+	StageTimer tGate(MI_STAGE_GATE);
+	GateLease lease;
+	int err = OK;
+
+	CBoundingBoxes_t* boxes = FaceSdk::detect_only_bounding_box(lease.engines().detector, p_pImage, &err, p_pszMsg);
+	if (boxes == NULL) return true;
+	unsigned int nFaces = boxes->num_boxes;
+	face_sdk_api().CBoundingBoxes_destroy(boxes);
+
+	memset(&p_result, 0, sizeof(p_result));
+	if (nFaces == 0 || (lv_settings.maxFaces > 0 && nFaces > (unsigned int)lv_settings.maxFaces)) {
+		*p_pErr = nFaces == 0 ? FACE_NOT_FOUND : TOO_MANY_FACES;
+		if (nFaces == 0) snprintf(p_pszMsg, MESSAGE_BUFFER_SIZE, "Face not found");
+		else snprintf(p_pszMsg, MESSAGE_BUFFER_SIZE, "Too many faces (%u)", nFaces);
+		mi_metrics_gate_reject(MI_GATE_DETECTION);
+		return false;
+	}
+	if (lease.engines().quality == NULL) return true;
+
+	CQualityResult_t q = FaceSdk::check_quality(lease.engines().quality, p_pImage, &err, p_pszMsg);
+	if (err != OK || !q.ok || q.score >= lv_settings.minQuality) return true;
+
+	p_result.quality_result = q;
+	*p_pErr = OK;
+	mi_metrics_gate_reject(MI_GATE_QUALITY);
+	return false;
+}
+
+GateStage mi_gate_stage(const CPipelineResult_t& p_result, int p_nErr)
+{
+	if (p_nErr == FACE_NOT_FOUND || p_nErr == TOO_MANY_FACES) return MI_GATE_DETECTION;
+	if (p_nErr == OK && p_result.quality_result.ok && !p_result.liveness_result.ok) return MI_GATE_QUALITY;
+	return MI_GATE_LIVENESS;
+}
+
+const char* mi_gate_stage_name(GateStage p_stage)
+{
+	return lv_szStages[p_stage];
+}
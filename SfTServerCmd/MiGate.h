@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include "FaceSdkApi.h"
+
+//. Early rejection cascade in front of liveness ([gate] settings) :
+//. 1. detect_only_bounding_box : no face -> FACE_NOT_FOUND, more than max_faces -> TOO_MANY_FACES
+//. 2. check_quality            : score below min_quality -> bad quality, err stays OK
+//. Liveness runs only when both pass, so bad captures never reach the pipeline.
+//. A request short of its deadline skips the gate (MI_DEGRADE_GATE, MiContext.h).
+//. A rejected result carries liveness_result.ok = false; mi_gate_stage tells the
+//. response which stage decided, for gated and ungated (pipeline) results alike.
+//. Engines are shared by the request threads like the crop detectors (MiFaceCrop.h).
+
+struct GateSettings {
+	int			maxFaces;		//. 0 = no limit
+	float		minQuality;		//. < 0 = no quality gate
+	int			engines;		//. detector / quality instances shared by the request threads
+	std::string	detector;		//. detection_create name
+	std::string	quality;		//. quality_create name
+};
+
+enum GateStage {
+	MI_GATE_DETECTION = 0,
+	MI_GATE_QUALITY,
+	MI_GATE_LIVENESS,			//. passed the gates (or gate off), liveness decided
+	MI_GATE_COUNT
+};
+
+bool mi_gate_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const GateSettings& p_settings, std::string& p_strErr);
+void mi_gate_shutdown();
+bool mi_gate_enabled();
+
+//. true = run liveness. false = p_result / p_pErr / p_pszMsg hold the rejection.
+bool mi_gate_check(const CImage_t* p_pImage, CPipelineResult_t& p_result, int* p_pErr, char* p_pszMsg);
+
+//. stage that produced p_result / p_nErr.
+GateStage mi_gate_stage(const CPipelineResult_t& p_result, int p_nErr);
+const char* mi_gate_stage_name(GateStage p_stage);
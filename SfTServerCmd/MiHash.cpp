@@ -0,0 +1,143 @@
+#include "MiHash.h"
+#include "Poco/SHA2Engine.h"
+#include <string.h>
+
+#define LD_P1	0x9E3779B185EBCA87ULL
+#define LD_P2	0xC2B2AE3D27D4EB4FULL
+#define LD_P3	0x165667B19E3779F9ULL
+#define LD_P4	0x85EBCA77C2B2AE63ULL
+#define LD_P5	0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+static inline uint64_t read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint32_t read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+static inline uint64_t round64(uint64_t acc, uint64_t input)
+{
+	acc += input * LD_P2;
+	acc = rotl64(acc, 31);
+	return acc * LD_P1;
+}
+
+static inline uint64_t merge64(uint64_t acc, uint64_t val)
+{
+	acc ^= round64(0, val);
+	return acc * LD_P1 + LD_P4;
+}
+
+//. the four lanes over every whole 32-byte stripe of [p, end), returns where the stripes stop.
+static inline const uint8_t* stripes(uint64_t* v, const uint8_t* p, const uint8_t* end)
+{
+	const uint8_t* limit = end - 32;
+	uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+	do {
+		v1 = round64(v1, read64(p)); p += 8;
+		v2 = round64(v2, read64(p)); p += 8;
+		v3 = round64(v3, read64(p)); p += 8;
+		v4 = round64(v4, read64(p)); p += 8;
+	} while (p <= limit);
+	v[0] = v1; v[1] = v2; v[2] = v3; v[3] = v4;
+	return p;
+}
+
+static inline void init_lanes(uint64_t* v, uint64_t p_nSeed)
+{
+	v[0] = p_nSeed + LD_P1 + LD_P2;
+	v[1] = p_nSeed + LD_P2;
+	v[2] = p_nSeed;
+	v[3] = p_nSeed - LD_P1;
+}
+
+//. the lanes (NULL under 32 bytes), the length, the last < 32 bytes and the avalanche.
+static uint64_t finish(const uint64_t* v, uint64_t p_nSeed, uint64_t p_nTotal, const uint8_t* p, const uint8_t* end)
+{
+	uint64_t h;
+	if (v != NULL) {
+		h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+		h = merge64(h, v[0]);
+		h = merge64(h, v[1]);
+		h = merge64(h, v[2]);
+		h = merge64(h, v[3]);
+	}
+	else {
+		h = p_nSeed + LD_P5;
+	}
+	h += p_nTotal;
+
+	while (p + 8 <= end) {
+		h ^= round64(0, read64(p));
+		h = rotl64(h, 27) * LD_P1 + LD_P4;
+		p += 8;
+	}
+	if (p + 4 <= end) {
+		h ^= (uint64_t)read32(p) * LD_P1;
+		h = rotl64(h, 23) * LD_P2 + LD_P3;
+		p += 4;
+	}
+	while (p < end) {
+		h ^= (*p) * LD_P5;
+		h = rotl64(h, 11) * LD_P1;
+		p++;
+	}
+
+	h ^= h >> 33;
+	h *= LD_P2;
+	h ^= h >> 29;
+	h *= LD_P3;
+	h ^= h >> 32;
+	return h;
+}
+
+uint64_t mi_hash64(const void* p_pData, size_t p_nLen, uint64_t p_nSeed)
+{
+	const uint8_t* p = (const uint8_t*)p_pData;
+	const uint8_t* end = p + p_nLen;
+	if (p_nLen < 32) return finish(NULL, p_nSeed, p_nLen, p, end);
+	uint64_t v[4];
+	init_lanes(v, p_nSeed);
+	p = stripes(v, p, end);
+	return finish(v, p_nSeed, p_nLen, p, end);
+}
+
+void Hash64Stream::reset(uint64_t p_nSeed)
+{
+	init_lanes(m_v, p_nSeed);
+	m_nSeed = p_nSeed;
+	m_nTotal = 0;
+	m_nMem = 0;
+}
+
+void Hash64Stream::update(const void* p_pData, size_t p_nLen)
+{
+	const uint8_t* p = (const uint8_t*)p_pData;
+	const uint8_t* end = p + p_nLen;
+	m_nTotal += p_nLen;
+	if (m_nMem + p_nLen < 32) {
+		if (p_nLen > 0) memcpy(m_mem + m_nMem, p, p_nLen);
+		m_nMem += p_nLen;
+		return;
+	}
+	if (m_nMem > 0) {
+		size_t n = 32 - m_nMem;
+		memcpy(m_mem + m_nMem, p, n);
+		stripes(m_v, m_mem, m_mem + 32);
+		p += n;
+		m_nMem = 0;
+	}
+	if (end - p >= 32) p = stripes(m_v, p, end);
+	m_nMem = (size_t)(end - p);
+	if (m_nMem > 0) memcpy(m_mem, p, m_nMem);
+}
+
+uint64_t Hash64Stream::digest() const
+{
+	return finish(m_nTotal >= 32 ? m_v : NULL, m_nSeed, m_nTotal, m_mem, m_mem + m_nMem);
+}
+
+void mi_digest256(const void* p_pData, size_t p_nLen, uint8_t* p_pOut)
+{
+	Poco::SHA2Engine engine(Poco::SHA2Engine::SHA_256);
+	engine.update(p_pData, (unsigned)p_nLen);
+	const Poco::DigestEngine::Digest& d = engine.digest();
+	memcpy(p_pOut, d.data(), MI_DIGEST_SIZE);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//. XXH64 of p_nLen bytes. Fast enough to fingerprint a whole upload per request
+//. (several GB/s), not a cryptographic hash.
+uint64_t mi_hash64(const void* p_pData, size_t p_nLen, uint64_t p_nSeed = 0);
+
+#define MI_DIGEST_SIZE	32
+
+//. SHA-256 of p_nLen bytes into p_pOut, where two uploads must not be told apart by a hash an
+//. attacker can collide (ResultCache keys). Far slower than mi_hash64.
+void mi_digest256(const void* p_pData, size_t p_nLen, uint8_t* p_pOut);
+
+//. The same XXH64 fed piece by piece : digest() equals mi_hash64 of everything update()
+//. was given. The body readers (MiMultipart.h, MiJsonScan.h, MiBase64.h) run it over each
+//. piece of an upload right after it lands in the buffer, while it is still in cache, so the
+//. upload's hash is ready with the body and no second pass reads it back from memory.
+class Hash64Stream {
+public:
+	explicit Hash64Stream(uint64_t p_nSeed = 0) { reset(p_nSeed); }
+
+	void reset(uint64_t p_nSeed = 0);
+	void update(const void* p_pData, size_t p_nLen);
+	uint64_t digest() const;
+	//. bytes given so far.
+	uint64_t size() const { return m_nTotal; }
+
+private:
+	uint64_t	m_v[4];
+	uint64_t	m_nSeed;
+	uint64_t	m_nTotal;
+	uint8_t		m_mem[32];		//. the start of a stripe not yet complete
+	size_t		m_nMem;
+};
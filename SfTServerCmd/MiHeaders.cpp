@@ -0,0 +1,69 @@
+#include "MiHeaders.h"
+#include "MiConf.h"
+#include "MiContext.h"
+#include <utility>
+#include <vector>
+
+struct HeaderSet {
+	std::vector<std::pair<std::string, std::string>>	fields;
+	std::string											text;		//. "Name: value\r\n" per field
+};
+
+static HeaderSet lv_sets[MI_HEADERS_COUNT];
+
+static void add(HeaderSet& p_set, const std::string& p_strName, const std::string& p_strValue)
+{
+	p_set.fields.push_back(std::make_pair(p_strName, p_strValue));
+	p_set.text += p_strName + ": " + p_strValue + "\r\n";
+}
+
+void mi_headers_init(const std::string& p_strOrigin, const std::string& p_strAllowHeaders, int p_nMaxAgeSec)
+{
+	for (int i = 0; i < MI_HEADERS_COUNT; i++) {
+		HeaderSet& s = lv_sets[i];
+		s.fields.clear();
+		s.text.clear();
+		add(s, "Access-Control-Allow-Origin", p_strOrigin);
+		add(s, "Access-Control-Allow-Methods", GD_CORS_ALLOW_METHODS);
+		add(s, "Access-Control-Allow-Headers", p_strAllowHeaders);
+		add(s, "Access-Control-Expose-Headers", GD_DEGRADED_HEADER ", " GD_PHASH_HEADER ", " GD_COST_HEADER);
+	}
+	add(lv_sets[MI_HEADERS_JSON], "Content-Type", "application/json");
+	add(lv_sets[MI_HEADERS_TEXT], "Content-Type", "text/plain");
+	add(lv_sets[MI_HEADERS_CBOR], "Content-Type", GD_CBOR_TYPE);
+	add(lv_sets[MI_HEADERS_MSGPACK], "Content-Type", GD_MSGPACK_TYPE);
+	if (p_nMaxAgeSec > 0) add(lv_sets[MI_HEADERS_PREFLIGHT], "Access-Control-Max-Age", std::to_string(p_nMaxAgeSec));
+}
+
+void mi_headers_apply(Poco::Net::HTTPResponse& p_response, HeaderBlock p_block)
+{
+	const HeaderSet& s = lv_sets[p_block];
+	//. optional steps the request skipped for its deadline.
+	char szDegraded[64] = { 0 };
+	RequestContext* ctx = mi_context();
+	if (ctx != NULL && ctx->degraded != 0) mi_context_degraded_text(ctx->degraded, szDegraded, sizeof(szDegraded));
+
+	//. near repeat of an earlier upload (MiPhash.h).
+	std::string strNear = ctx != NULL && ctx->nearDistance >= 0 ? std::to_string(ctx->nearDistance) : std::string();
+
+	//. what the request has cost so far (MiCost.h), its spans instead when profiled (MiRequestProfile.h).
+	std::string strCost = ctx == NULL ? std::string() : ctx->profile ? mi_request_profile_header(*ctx) : mi_cost_header(*ctx);
+
+	HeaderBlockSink* pSink = dynamic_cast<HeaderBlockSink*>(&p_response);
+	if (pSink != NULL) {
+		if (szDegraded[0] == 0 && strNear.empty() && strCost.empty()) {
+			pSink->set_header_block(s.text);
+			return;
+		}
+		std::string strBlock = s.text;
+		if (szDegraded[0] != 0) strBlock += std::string(GD_DEGRADED_HEADER ": ") + szDegraded + "\r\n";
+		if (!strNear.empty()) strBlock += GD_PHASH_HEADER ": " + strNear + "\r\n";
+		if (!strCost.empty()) strBlock += GD_COST_HEADER ": " + strCost + "\r\n";
+		pSink->set_header_block(strBlock);
+		return;
+	}
+	for (size_t i = 0; i < s.fields.size(); i++) p_response.set(s.fields[i].first, s.fields[i].second);
+	if (szDegraded[0] != 0) p_response.set(GD_DEGRADED_HEADER, szDegraded);
+	if (!strNear.empty()) p_response.set(GD_PHASH_HEADER, strNear);
+	if (!strCost.empty()) p_response.set(GD_COST_HEADER, strCost);
+}
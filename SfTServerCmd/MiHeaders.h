@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include "Poco/Net/HTTPResponse.h"
+
+//. Fixed response header sets, built once at startup by mi_headers_init ([cors]) :
+//. every handler used to rebuild the same three Access-Control-* strings per response.
+//. The reactor's responses take a block as one pre-serialized "Name: value\r\n..."
+//. string appended to the head in a single write; Poco's classic responses get the
+//. prebuilt name / value strings.
+//. MI_HEADERS_PREFLIGHT answers OPTIONS with Access-Control-Max-Age so browsers cache
+//. the preflight instead of sending one before every liveness call.
+//. A request that skipped optional steps for its deadline also gets GD_DEGRADED_HEADER
+//. (MiContext.h), with [cost] header its cost so far in GD_COST_HEADER (MiCost.h); both
+//. are exposed to browser clients.
+
+enum HeaderBlock {
+	MI_HEADERS_CORS = 0,		//. CORS only (content type set by the handler)
+	MI_HEADERS_JSON,			//. CORS + Content-Type: application/json
+	MI_HEADERS_TEXT,			//. CORS + Content-Type: text/plain
+	MI_HEADERS_CBOR,			//. CORS + Content-Type: GD_CBOR_TYPE
+	MI_HEADERS_MSGPACK,			//. CORS + Content-Type: GD_MSGPACK_TYPE
+	MI_HEADERS_PREFLIGHT,		//. CORS + Access-Control-Max-Age
+	MI_HEADERS_COUNT
+};
+
+//. response that accepts a serialized block instead of individual headers.
+class HeaderBlockSink {
+public:
+	virtual ~HeaderBlockSink() {}
+	//. replaces any block set before on the same response.
+	virtual void set_header_block(const std::string& p_strBlock) = 0;
+};
+
+//. call before the server starts; p_nMaxAgeSec <= 0 omits Access-Control-Max-Age.
+void mi_headers_init(const std::string& p_strOrigin, const std::string& p_strAllowHeaders, int p_nMaxAgeSec);
+
+void mi_headers_apply(Poco::Net::HTTPResponse& p_response, HeaderBlock p_block);
@@ -0,0 +1,258 @@
+#include "MiHealth.h"
+#include "MiAlloc.h"
+#include "MiBrownout.h"
+#include "FaceSdkApi.h"
+#include "MiConf.h"
+#include "MiConfig.h"
+#include "MiCpu.h"
+#include "MiInference.h"
+#include "MiLicense.h"
+#include "MiMetrics.h"
+#include "MiPipelinePool.h"
+#include "MiPlatform.h"
+#include "MiSettings.h"
+#include "MiSupervisor.h"
+#include "MiWarmup.h"
+#include "MiWatchdog.h"
+#include "MiWorkerPool.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/Environment.h"
+#include "Poco/Timestamp.h"
+#include <idliveface/idliveface.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static const char* lv_szSelfTest[MI_HEALTH_SELFTEST_COUNT] = { "ok", "failed", "skipped" };
+
+//. what the self-test thread last saw; probes copy it under the lock.
+struct HealthState {
+	int				nLast;				//. HealthSelfTest, -1 = none yet
+	int				nFailures;			//. failed in a row
+	uint64_t		nAtMs;				//. mi_tick_ms of the last run
+	double			dMs;				//. duration of the last run
+	std::string		strError;			//. last failure
+	std::string		strLicenseInfo;		//. get_license_info
+};
+
+static std::mutex				lv_mtx;
+static std::condition_variable	lv_cv;
+static bool						lv_bStop = false;
+static std::thread				lv_thread;
+static HealthState				lv_state = { -1, 0, 0, 0, "", "" };
+static std::string				lv_strRelease;
+static std::string				lv_strReleaseExpiry;
+static std::atomic<uint64_t>	lv_nAnsweredMs(0);		//. mi_tick_ms of the last answered check, 0 = none
+
+const char* mi_health_selftest_name(int p_nResult)
+{
+	return p_nResult >= 0 && p_nResult < MI_HEALTH_SELFTEST_COUNT ? lv_szSelfTest[p_nResult] : "unknown";
+}
+
+//. a verdict or a face condition : the models ran.
+static bool answered(int p_nErr)
+{
+	return p_nErr == OK || (p_nErr >= FACE_TOO_CLOSE && p_nErr <= FACE_ANGLE_TOO_LARGE) || p_nErr == FACE_IS_OCCLUDED || p_nErr == EYES_CLOSED;
+}
+
+void mi_health_checked(const int* p_pErrors, size_t p_nCount)
+{
+	for (size_t i = 0; i < p_nCount; i++) {
+		if (answered(p_pErrors[i])) {
+			lv_nAnsweredMs.store(mi_tick_ms(), std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+static std::string license_info()
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	char info[1024]; memset(info, 0, sizeof(info));
+	face_sdk_api().get_license_info(info, sizeof(info) - 1, &err, msg);
+	return err == OK ? std::string(info) : std::string();
+}
+
+static void selftest_once(const CImage_t* p_pImage)
+{
+	uint64_t now = mi_tick_ms();
+	uint64_t nAnswered = lv_nAnsweredMs.load(std::memory_order_relaxed);
+	int nResult = MI_HEALTH_SELFTEST_SKIPPED;
+	double ms = 0;
+	std::string strError;
+	if (nAnswered == 0 || now - nAnswered >= (uint64_t)g_Settings.healthSelftestSec * 1000) {
+		int err = OK;
+		char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+		auto start = std::chrono::steady_clock::now();
+		if (p_pImage != NULL) mi_check_liveness(p_pImage, &err, msg);
+		else {
+			err = FAILED_TO_ALLOCATE;
+			strcpy(msg, "no warm-up image");
+		}
+		ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		nResult = answered(err) ? MI_HEALTH_SELFTEST_OK : MI_HEALTH_SELFTEST_FAILED;
+		if (nResult == MI_HEALTH_SELFTEST_FAILED) strError = std::string(face_sdk_status_name(face_sdk_status(err, msg))) + " : " + msg;
+	}
+	std::string strInfo = license_info();
+	mi_metrics_health_selftest(nResult);
+
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	lv_state.strLicenseInfo = strInfo;
+	if (nResult == MI_HEALTH_SELFTEST_SKIPPED) {
+		//. traffic answered : as good as a passed self-test.
+		lv_state.nFailures = 0;
+		if (lv_state.nLast != MI_HEALTH_SELFTEST_OK) lv_state.nLast = MI_HEALTH_SELFTEST_SKIPPED;
+		return;
+	}
+	lv_state.nLast = nResult;
+	lv_state.nAtMs = now;
+	lv_state.dMs = ms;
+	if (nResult == MI_HEALTH_SELFTEST_OK) lv_state.nFailures = 0;
+	else {
+		lv_state.nFailures++;
+		lv_state.strError = strError;
+	}
+}
+
+static void selftest_run()
+{
+	CImage_t* image = NULL;
+	std::unique_lock<std::mutex> lock(lv_mtx);
+	while (!lv_bStop) {
+		lv_cv.wait_for(lock, std::chrono::seconds(g_Settings.healthSelftestSec), [] { return lv_bStop; });
+		if (lv_bStop || !mi_ready()) continue;
+		lock.unlock();
+		//. decoded once, on the first run after the warm-up.
+		if (image == NULL) image = mi_warmup_image();
+		selftest_once(image);
+		lock.lock();
+	}
+	lock.unlock();
+	if (image != NULL) face_sdk_api().image_destroy(image);
+}
+
+void mi_health_start()
+{
+	try {
+		idliveface::ReleaseInfo info = idliveface::GetReleaseInfo();
+		lv_strRelease = info.version;
+		lv_strReleaseExpiry = info.expiration_date;
+	}
+	catch (const std::exception&) {
+	}
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		lv_state.strLicenseInfo = license_info();
+	}
+	if (g_Settings.healthSelftestSec <= 0) return;
+	lv_bStop = false;
+	lv_thread = std::thread(selftest_run);
+}
+
+void mi_health_stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	if (lv_thread.joinable()) lv_thread.join();
+}
+
+Poco::JSON::Object::Ptr mi_health_report(bool& p_bHealthy)
+{
+	HealthState state;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		state = lv_state;
+	}
+	uint64_t now = mi_tick_ms();
+	bool bReady = mi_ready();
+	bool bLicense = g_License.valid();
+	bool bSelfTest = g_Settings.healthFailAfter <= 0 || state.nFailures < g_Settings.healthFailAfter;
+	p_bHealthy = bReady && bLicense && bSelfTest;
+
+	Poco::JSON::Object::Ptr root = new Poco::JSON::Object;
+	const char* pszStatus = "ok";
+	if (mi_draining()) pszStatus = "draining";
+	else if (!bReady) pszStatus = "warming_up";
+	else if (!bLicense) pszStatus = "no_license";
+	else if (!bSelfTest) pszStatus = "failing";
+	root->set("status", pszStatus);
+	root->set("generation", g_Supervisor.generation());
+	root->set("brownout", mi_brownout_active());
+
+	Poco::JSON::Object::Ptr pool = new Poco::JSON::Object;
+	pool->set("size", g_pPool != NULL ? g_pPool->size() : 1);
+	pool->set("busy", g_pPool != NULL ? g_pPool->busy() : -1);
+	pool->set("active", g_pPool != NULL ? g_pPool->active() : 1);
+	pool->set("shared", g_pPool != NULL && g_pPool->shared());
+	root->set("pool", pool);
+
+	Poco::JSON::Object::Ptr queue = new Poco::JSON::Object;
+	queue->set("connections", mi_metrics_http_queued());
+	queue->set("workers", g_pWorkerPool != NULL ? g_pWorkerPool->queued() : 0);
+	root->set("queue", queue);
+
+	Poco::JSON::Object::Ptr watchdog = new Poco::JSON::Object;
+	watchdog->set("enabled", mi_watchdog_enabled());
+	watchdog->set("abandoned", mi_watchdog_abandoned());
+	watchdog->set("replaced", (Poco::UInt64)mi_watchdog_replaced());
+	root->set("watchdog", watchdog);
+
+	uint64_t nAnswered = lv_nAnsweredMs.load(std::memory_order_relaxed);
+	root->set("last_inference_age_ms", nAnswered != 0 ? (Poco::Int64)(now - nAnswered) : (Poco::Int64)-1);
+
+	Poco::JSON::Object::Ptr selftest = new Poco::JSON::Object;
+	selftest->set("enabled", g_Settings.healthSelftestSec > 0);
+	selftest->set("last", state.nLast >= 0 ? mi_health_selftest_name(state.nLast) : "none");
+	selftest->set("age_ms", state.nAtMs != 0 ? (Poco::Int64)(now - state.nAtMs) : (Poco::Int64)-1);
+	selftest->set("duration_ms", state.dMs);
+	selftest->set("failures", state.nFailures);
+	if (!state.strError.empty()) selftest->set("last_error", state.strError);
+	root->set("selftest", selftest);
+
+	Poco::JSON::Object::Ptr license = new Poco::JSON::Object;
+	license->set("state", mi_license_status_name(g_License.status_code()));
+	std::shared_ptr<const ST_RESPONSE> pSnap = g_License.snapshot();
+	if (pSnap && (INT64)pSnap->m_lExpire < GD_LICENSE_NO_LIMIT) {
+		Poco::Timestamp expire = Poco::Timestamp::fromEpochTime((time_t)pSnap->m_lExpire);
+		license->set("expires", Poco::DateTimeFormatter::format(expire, Poco::DateTimeFormat::ISO8601_FORMAT));
+		license->set("expires_in_sec", (Poco::Int64)pSnap->m_lExpire - (Poco::Int64)time(NULL));
+	}
+	else if (pSnap) license->set("expires", "never");
+	if (!state.strLicenseInfo.empty()) license->set("info", state.strLicenseInfo);
+	root->set("license", license);
+
+	Poco::JSON::Object::Ptr sdk = new Poco::JSON::Object;
+	sdk->set("version", lv_strRelease);
+	sdk->set("expiration_date", lv_strReleaseExpiry);
+	root->set("sdk", sdk);
+
+	//. what a benchmark run records about the server it measured (LivenessBench --store).
+	Poco::JSON::Object::Ptr build = new Poco::JSON::Object;
+	build->set("version", GD_ID_VERSION);
+	build->set("update", GD_ID_UPDATE);
+	build->set("allocator", mi_alloc_name());
+	root->set("build", build);
+	Poco::JSON::Object::Ptr host = new Poco::JSON::Object;
+	host->set("node", Poco::Environment::nodeName());
+	host->set("os", Poco::Environment::osName() + " " + Poco::Environment::osVersion());
+	host->set("arch", Poco::Environment::osArchitecture());
+	host->set("processors", (int)Poco::Environment::processorCount());
+	host->set("cpu_features", mi_cpu_feature_names(mi_cpu_features()));
+	root->set("host", host);
+	ConfigSnapshotRef pConfig = mi_config_current();
+	Poco::JSON::Object::Ptr config = new Poco::JSON::Object;
+	config->set("source", g_Settings.source.empty() ? std::string("defaults") : g_Settings.source);
+	config->set("version", pConfig ? (Poco::UInt64)pConfig->version : (Poco::UInt64)0);
+	root->set("config", config);
+	return root;
+}
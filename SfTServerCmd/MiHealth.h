@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include "Poco/JSON/Object.h"
+
+//. GD_API_HEALTH : one JSON document for load balancers and operators. Everything in it
+//. is read from state the server keeps anyway - pool slots held, queued connections and
+//. worker tasks, the age of the last check the pipeline answered, the license record,
+//. the SDK release, the build, host and config version - plus the outcome of a background
+//. self-test, so a probe never waits for an inference slot nor takes one.
+//. The self-test runs the warm-up image (mi_warmup_image) through mi_check_liveness
+//. every health.selftest_sec once the server is ready. While traffic keeps the last
+//. answered check younger than that it is skipped : the traffic already proves the
+//. pipeline. health.fail_after failed self-tests in a row turn the answer into 503,
+//. as do a missing or expired license and a server warming up or draining.
+//. "Answered" means the pipeline returned a verdict or a face condition (FACE_NOT_FOUND
+//. and the like), not an engine, license or allocation error.
+
+enum HealthSelfTest {
+	MI_HEALTH_SELFTEST_OK = 0,
+	MI_HEALTH_SELFTEST_FAILED,
+	MI_HEALTH_SELFTEST_SKIPPED,		//. traffic answered within the interval
+	MI_HEALTH_SELFTEST_COUNT
+};
+
+//. metric label of a HealthSelfTest.
+const char* mi_health_selftest_name(int p_nResult);
+
+//. starts / stops the self-test thread ([health] selftest_sec > 0).
+void mi_health_start();
+void mi_health_stop();
+
+//. p_nCount STATUS values the pipeline returned, from MiInference.h.
+void mi_health_checked(const int* p_pErrors, size_t p_nCount);
+
+//. the GD_API_HEALTH document; p_bHealthy false = 503.
+Poco::JSON::Object::Ptr mi_health_report(bool& p_bHealthy);
@@ -0,0 +1,389 @@
+#include "MiHttp2Server.h"
+#include "MIServer.h"
+#include "MiAdmission.h"
+#include "MiConnection.h"
+#include "MiReactorHttp.h"
+#include "MiStages.h"
+#include "MiWorkerPool.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/TCPServer.h"
+#include "Poco/Net/TCPServerConnection.h"
+#include "Poco/Net/TCPServerConnectionFactory.h"
+#include "Poco/Net/TCPServerParams.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#if MI_HAS_NGHTTP2
+#include <nghttp2/nghttp2.h>
+#endif
+
+#if MI_HAS_NGHTTP2
+static Poco::Net::TCPServer*	lv_pServer = NULL;
+static WorkerPool*				lv_pWorkers = NULL;		//. own pool, NULL = g_pWorkerPool
+static HTTPServerParams::Ptr	lv_pParams;
+
+#define LD_READ_CHUNK		(64 * 1024)
+
+//. one request stream; the worker holds it through the shared_ptr after the stream closed.
+struct Http2Job {
+	ReactorServerResponse					response;
+	ReactorServerRequest					request;
+	std::chrono::steady_clock::time_point	arrival;	//. headers received
+	Http2Job(const SocketAddress& p_client, const SocketAddress& p_server, const HTTPServerParams& p_params)
+		: request(response, p_client, p_server, p_params) {}
+};
+
+struct Http2Stream {
+	std::shared_ptr<Http2Job>	job;
+	bool						tooLarge;		//. body past server.max_body_mb, answered 413
+	bool						dispatched;
+	std::string					out;			//. response body being sent
+	size_t						outPos;
+	std::vector<std::string>	headers;		//. name, value pairs backing the nghttp2_nv of the response
+	Http2Stream() : tooLarge(false), dispatched(false), outPos(0) {}
+};
+
+//. state shared by a connection's reading thread and the workers answering its streams;
+//. every session call and every socket write happens under mtx.
+struct Http2Channel {
+	StreamSocket							socket;
+	SocketAddress							client;
+	SocketAddress							server;
+	std::mutex								mtx;
+	nghttp2_session*						session;
+	std::map<int32_t, Http2Stream>			streams;
+	bool									closed;
+
+	explicit Http2Channel(const StreamSocket& p_socket)
+		: socket(p_socket), client(p_socket.peerAddress()), server(p_socket.address()), session(NULL), closed(false) {}
+	~Http2Channel() { if (session != NULL) nghttp2_session_del(session); }
+
+	//. writes what the session has queued. mtx must be held; false once the connection is done.
+	bool flush()
+	{
+		if (closed) return false;
+		for (;;) {
+			const uint8_t* data = NULL;
+			ssize_t n = nghttp2_session_mem_send(session, &data);
+			if (n < 0) return fail();
+			if (n == 0) break;
+			try {
+				socket.sendBytes(data, (int)n);
+			}
+			catch (Poco::Exception&) {
+				return fail();
+			}
+		}
+		if (!nghttp2_session_want_read(session) && !nghttp2_session_want_write(session)) return fail();
+		return true;
+	}
+
+	bool fail()
+	{
+		closed = true;
+		return false;
+	}
+
+	//. a worker's answer to stream p_nId. Takes mtx.
+	void complete(int32_t p_nId, const std::shared_ptr<Http2Job>& p_pJob);
+	//. answers without a worker. mtx must be held.
+	void reply(int32_t p_nId, HTTPResponse::HTTPStatus p_status, int p_nRetryAfterSec = 0);
+	//. hands the ended request of p_nId to the workers. mtx must be held.
+	void dispatch(int32_t p_nId, const std::shared_ptr<Http2Channel>& p_pSelf);
+
+	std::weak_ptr<Http2Channel>				self;
+};
+
+static ssize_t read_body(nghttp2_session*, int32_t p_nId, uint8_t* p_pBuf, size_t p_nLen, uint32_t* p_pFlags, nghttp2_data_source* p_pSource, void*)
+{
+	Http2Stream* s = (Http2Stream*)p_pSource->ptr;
+	size_t n = std::min(p_nLen, s->out.size() - s->outPos);
+	memcpy(p_pBuf, s->out.data() + s->outPos, n);
+	s->outPos += n;
+	if (s->outPos >= s->out.size()) *p_pFlags |= NGHTTP2_DATA_FLAG_EOF;
+	return (ssize_t)n;
+}
+
+//. HTTP/1.1-only fields must not appear in an HTTP/2 response.
+static bool connection_specific(const std::string& p_strName)
+{
+	return p_strName == "connection" || p_strName == "keep-alive" || p_strName == "transfer-encoding" || p_strName == "upgrade" || p_strName == "proxy-connection";
+}
+
+//. lower-case name and value of one response header into p_vOut.
+static void add_header(std::vector<std::string>& p_vOut, const std::string& p_strName, const std::string& p_strValue)
+{
+	std::string name = Poco::toLower(p_strName);
+	if (connection_specific(name) || name == "content-length") return;
+	p_vOut.push_back(name);
+	p_vOut.push_back(p_strValue);
+}
+
+//. submits status, headers and p_strBody on stream p_nId. mtx must be held.
+static void submit(Http2Channel& p_channel, int32_t p_nId, const ReactorServerResponse& p_response, std::string&& p_strBody, bool p_bHead)
+{
+	auto it = p_channel.streams.find(p_nId);
+	if (it == p_channel.streams.end()) return;
+	Http2Stream& s = it->second;
+	s.out = p_bHead ? std::string() : std::move(p_strBody);
+	s.outPos = 0;
+	s.headers.clear();
+	s.headers.push_back(":status");
+	s.headers.push_back(std::to_string((int)p_response.getStatus()));
+	for (auto& h : p_response) add_header(s.headers, h.first, h.second);
+	//. the static header block (MiHeaders.h) is "Name: value\r\n" lines.
+	if (p_response.header_block() != NULL) {
+		const std::string& block = *p_response.header_block();
+		size_t pos = 0;
+		while (pos < block.size()) {
+			size_t end = block.find("\r\n", pos);
+			if (end == std::string::npos) end = block.size();
+			size_t colon = block.find(':', pos);
+			if (colon != std::string::npos && colon < end) add_header(s.headers, block.substr(pos, colon - pos), Poco::trim(block.substr(colon + 1, end - colon - 1)));
+			pos = end + 2;
+		}
+	}
+	s.headers.push_back("content-length");
+	s.headers.push_back(std::to_string(s.out.size()));
+
+	std::vector<nghttp2_nv> nva(s.headers.size() / 2);
+	for (size_t i = 0; i < nva.size(); i++) {
+		const std::string& name = s.headers[i * 2];
+		const std::string& value = s.headers[i * 2 + 1];
+		nva[i].name = (uint8_t*)name.data();
+		nva[i].namelen = name.size();
+		nva[i].value = (uint8_t*)value.data();
+		nva[i].valuelen = value.size();
+		nva[i].flags = NGHTTP2_NV_FLAG_NO_COPY_NAME | NGHTTP2_NV_FLAG_NO_COPY_VALUE;
+	}
+	nghttp2_data_provider prd;
+	prd.source.ptr = &s;
+	prd.read_callback = read_body;
+	nghttp2_submit_response(p_channel.session, p_nId, nva.data(), nva.size(), s.out.empty() ? NULL : &prd);
+}
+
+void Http2Channel::complete(int32_t p_nId, const std::shared_ptr<Http2Job>& p_pJob)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	if (closed) return;
+	bool bHead = p_pJob->request.getMethod() == HTTPRequest::HTTP_HEAD;
+	submit(*this, p_nId, p_pJob->response, p_pJob->response.body(), bHead);
+	flush();
+}
+
+void Http2Channel::reply(int32_t p_nId, HTTPResponse::HTTPStatus p_status, int p_nRetryAfterSec)
+{
+	ReactorServerResponse resp;
+	resp.setStatusAndReason(p_status);
+	if (p_nRetryAfterSec > 0) resp.set("Retry-After", std::to_string(p_nRetryAfterSec));
+	mi_headers_apply(resp, MI_HEADERS_TEXT);
+	submit(*this, p_nId, resp, std::string(resp.getReason()), false);
+}
+
+void Http2Channel::dispatch(int32_t p_nId, const std::shared_ptr<Http2Channel>& p_pSelf)
+{
+	Http2Stream& s = streams[p_nId];
+	if (s.dispatched || !s.job) return;
+	s.dispatched = true;
+	if (s.tooLarge) {
+		reply(p_nId, HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE);
+		return;
+	}
+	std::shared_ptr<Http2Job> job = s.job;
+	ReactorServerRequest& req = job->request;
+	//. HTTP/2 need not send content-length; the handlers size their buffers from it.
+	if (!req.hasContentLength()) req.setContentLength64((Poco::Int64)req.body().size());
+	req.open_body();
+	int lane = g_Settings.lanesEnable ? mi_lane_of(req) : MI_LANE_INTERACTIVE;
+	WorkerPool* pPool = lv_pWorkers != NULL ? lv_pWorkers : g_pWorkerPool;
+	std::shared_ptr<Http2Channel> self = p_pSelf;
+	bool bQueued = pPool->submit([self, job, p_nId]() {
+		MyRequestHandler handler;
+		mi_admission_set_arrival(job->arrival);
+		handler.handleRequest(job->request, job->response);
+		mi_admission_set_arrival(std::chrono::steady_clock::time_point());
+		mi_stage_send([self, job, p_nId]() { self->complete(p_nId, job); });
+	}, lane);
+	if (!bQueued) reply(p_nId, HTTPResponse::HTTP_SERVICE_UNAVAILABLE, 1);
+}
+
+static int on_begin_headers(nghttp2_session*, const nghttp2_frame* p_pFrame, void* p_pUser)
+{
+	if (p_pFrame->hd.type != NGHTTP2_HEADERS || p_pFrame->headers.cat != NGHTTP2_HCAT_REQUEST) return 0;
+	Http2Channel* c = (Http2Channel*)p_pUser;
+	Http2Stream& s = c->streams[p_pFrame->hd.stream_id];
+	s.job = std::make_shared<Http2Job>(c->client, c->server, *lv_pParams);
+	s.job->arrival = std::chrono::steady_clock::now();
+	s.job->request.setVersion(HTTPMessage::HTTP_1_1);
+	return 0;
+}
+
+static int on_header(nghttp2_session*, const nghttp2_frame* p_pFrame, const uint8_t* p_pName, size_t p_nName, const uint8_t* p_pValue, size_t p_nValue, uint8_t, void* p_pUser)
+{
+	Http2Channel* c = (Http2Channel*)p_pUser;
+	auto it = c->streams.find(p_pFrame->hd.stream_id);
+	if (it == c->streams.end() || !it->second.job) return 0;
+	ReactorServerRequest& req = it->second.job->request;
+	std::string name((const char*)p_pName, p_nName), value((const char*)p_pValue, p_nValue);
+	if (name == ":method") req.setMethod(value);
+	else if (name == ":path") req.setURI(value);
+	else if (name == ":authority") req.setHost(value);
+	else if (name[0] != ':') req.add(name, value);
+	return 0;
+}
+
+static int on_data_chunk(nghttp2_session*, uint8_t, int32_t p_nId, const uint8_t* p_pData, size_t p_nLen, void* p_pUser)
+{
+	Http2Channel* c = (Http2Channel*)p_pUser;
+	auto it = c->streams.find(p_nId);
+	if (it == c->streams.end() || !it->second.job) return 0;
+	Http2Stream& s = it->second;
+	std::string& body = s.job->request.body();
+	if (s.tooLarge || body.size() + p_nLen > (size_t)mi_config().maxBodyMb * 1024 * 1024) {
+		s.tooLarge = true;
+		body.clear();
+		return 0;
+	}
+	if (body.empty() && s.job->request.hasContentLength()) body.reserve((size_t)std::min<Poco::Int64>(s.job->request.getContentLength64(), (Poco::Int64)mi_config().maxBodyMb * 1024 * 1024));
+	body.append((const char*)p_pData, p_nLen);
+	return 0;
+}
+
+static int on_frame_recv(nghttp2_session*, const nghttp2_frame* p_pFrame, void* p_pUser)
+{
+	if ((p_pFrame->hd.type == NGHTTP2_HEADERS || p_pFrame->hd.type == NGHTTP2_DATA) && (p_pFrame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+		Http2Channel* c = (Http2Channel*)p_pUser;
+		if (c->streams.count(p_pFrame->hd.stream_id) != 0) c->dispatch(p_pFrame->hd.stream_id, c->self.lock());
+	}
+	return 0;
+}
+
+static int on_stream_close(nghttp2_session*, int32_t p_nId, uint32_t, void* p_pUser)
+{
+	//. a worker still running it keeps its job; complete() then finds no stream.
+	((Http2Channel*)p_pUser)->streams.erase(p_nId);
+	return 0;
+}
+
+//. reads the connection and feeds its session until either side ends it.
+class Http2Connection : public Poco::Net::TCPServerConnection {
+public:
+	explicit Http2Connection(const StreamSocket& p_socket) : Poco::Net::TCPServerConnection(p_socket) {}
+
+	void run() override
+	{
+		mi_socket_tune(socket());
+		std::shared_ptr<Http2Channel> pChannel = std::make_shared<Http2Channel>(socket());
+		pChannel->self = pChannel;
+		if (!open(*pChannel)) return;
+
+		std::vector<uint8_t> buf(LD_READ_CHUNK);
+		socket().setReceiveTimeout(Poco::Timespan(g_Settings.keepAliveTimeoutSec, 0));
+		for (;;) {
+			int n = 0;
+			try {
+				n = socket().receiveBytes(buf.data(), (int)buf.size());
+			}
+			catch (Poco::TimeoutException&) {
+				//. idle : a connection with streams in flight stays open.
+				std::lock_guard<std::mutex> lock(pChannel->mtx);
+				if (pChannel->streams.empty()) break;
+				continue;
+			}
+			catch (Poco::Exception&) {
+				break;
+			}
+			if (n <= 0) break;
+			std::lock_guard<std::mutex> lock(pChannel->mtx);
+			if (nghttp2_session_mem_recv(pChannel->session, buf.data(), (size_t)n) < 0 || !pChannel->flush()) break;
+		}
+
+		//. the workers still answering find the channel closed; the socket goes with this object.
+		std::lock_guard<std::mutex> lock(pChannel->mtx);
+		if (!pChannel->closed) {
+			nghttp2_session_terminate_session(pChannel->session, NGHTTP2_NO_ERROR);
+			pChannel->flush();
+		}
+		pChannel->closed = true;
+	}
+
+private:
+	static bool open(Http2Channel& p_channel)
+	{
+		nghttp2_session_callbacks* cbs = NULL;
+		if (nghttp2_session_callbacks_new(&cbs) != 0) return false;
+		nghttp2_session_callbacks_set_on_begin_headers_callback(cbs, on_begin_headers);
+		nghttp2_session_callbacks_set_on_header_callback(cbs, on_header);
+		nghttp2_session_callbacks_set_on_data_chunk_recv_callback(cbs, on_data_chunk);
+		nghttp2_session_callbacks_set_on_frame_recv_callback(cbs, on_frame_recv);
+		nghttp2_session_callbacks_set_on_stream_close_callback(cbs, on_stream_close);
+		int rv = nghttp2_session_server_new(&p_channel.session, cbs, &p_channel);
+		nghttp2_session_callbacks_del(cbs);
+		if (rv != 0) return false;
+
+		//. a large window lets an upload arrive without waiting for WINDOW_UPDATE round trips.
+		int32_t window = g_Settings.http2WindowKb * 1024;
+		nghttp2_settings_entry iv[2] = {
+			{ NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, (uint32_t)g_Settings.http2MaxStreams },
+			{ NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, (uint32_t)window }
+		};
+		if (nghttp2_submit_settings(p_channel.session, NGHTTP2_FLAG_NONE, iv, 2) != 0) return false;
+		nghttp2_session_set_local_window_size(p_channel.session, NGHTTP2_FLAG_NONE, 0, window);
+		std::lock_guard<std::mutex> lock(p_channel.mtx);
+		return p_channel.flush();
+	}
+};
+#endif
+
+bool mi_http2_start(std::string& p_strErr)
+{
+#if MI_HAS_NGHTTP2
+	if (lv_pServer != NULL) return true;
+	try {
+		lv_pParams = new HTTPServerParams;
+		lv_pParams->setTimeout(Poco::Timespan(g_Settings.timeoutSec, 0));
+
+		Poco::Net::ServerSocket socket = mi_listen_socket(g_Settings.http2Port);
+
+		//. the reactor's inference queues when there are any.
+		if (g_pWorkerPool == NULL) {
+			int workers = g_Settings.http2Workers > 0 ? g_Settings.http2Workers : g_Settings.inferenceWorkers;
+			lv_pWorkers = new WorkerPool(workers > 0 ? workers : 1, g_Settings.inferenceQueue);
+			lv_pWorkers->start();
+		}
+
+		Poco::Net::TCPServerParams* pParams = new Poco::Net::TCPServerParams;
+		pParams->setMaxThreads(g_Settings.http2MaxConnections);
+		pParams->setMaxQueued(g_Settings.http2MaxConnections);
+		lv_pServer = new Poco::Net::TCPServer(new Poco::Net::TCPServerConnectionFactoryImpl<Http2Connection>(), socket, pParams);
+		lv_pServer->start();
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		mi_http2_stop();
+		return false;
+	}
+	return true;
+#else
+	p_strErr = "built without nghttp2 (MI_HAS_NGHTTP2)";
+	return false;
+#endif
+}
+
+void mi_http2_stop()
+{
+#if MI_HAS_NGHTTP2
+	if (lv_pServer != NULL) {
+		lv_pServer->stop();
+		delete lv_pServer;
+		lv_pServer = NULL;
+	}
+	if (lv_pWorkers != NULL) {
+		lv_pWorkers->stop();
+		delete lv_pWorkers;
+		lv_pWorkers = NULL;
+	}
+#endif
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+//. HTTP/2 front end ([http2]) : cleartext HTTP/2 with prior knowledge (h2c) on its own
+//. port, on nghttp2. A browser or mobile client multiplexes its concurrent checks as
+//. streams of one connection; every stream that has ended its request runs the usual
+//. MyRequestHandler routes on the inference workers (the reactor's g_pWorkerPool in
+//. server.mode = reactor, else http2.workers of its own) and its response goes back on
+//. the same connection as it finishes. One thread per connection reads and feeds the
+//. session; workers write their responses under the session lock.
+//. Up to http2.max_streams streams per connection (SETTINGS_MAX_CONCURRENT_STREAMS), bodies
+//. above server.max_body_mb get 413, a full worker queue gets 503.
+//. TLS (h2 by ALPN) is left to the terminating proxy in front, which speaks h2c to this port.
+//. Builds without nghttp2 (MI_HAS_NGHTTP2 = 0) refuse to start the listener.
+
+//. listens on http2.port; call after launch.
+bool mi_http2_start(std::string& p_strErr);
+void mi_http2_stop();
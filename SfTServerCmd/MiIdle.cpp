@@ -0,0 +1,142 @@
+#include "MiIdle.h"
+#include "MiAlloc.h"
+#include "MiBufferPool.h"
+#include "MiLock.h"
+#include "MiPipelinePool.h"
+#include "MiPixelPool.h"
+#include "MiPlatform.h"
+#include "MiResultCache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+static bool						lv_bEnable = false;
+static uint64_t					lv_nAfterMs = 0;
+static int						lv_nPoolKeep = 0;
+static std::atomic<uint64_t>	lv_nLastMs(0);			//. start of the last request
+static std::atomic<bool>		lv_bTrimmed(false);
+static std::atomic<uint64_t>	lv_nWakeMs(0);			//. set by the waking request, taken by the thread
+static std::atomic<uint64_t>	lv_nTrims(0);
+static std::atomic<uint64_t>	lv_nReleased(0);
+static std::atomic<int64_t>		lv_nRestoreMs(-1);
+static std::atomic<int64_t>		lv_nWakeRequestMs(-1);
+static MI_MUTEX(lv_mtx, "idle");
+static MiCondition				lv_cv;
+static bool						lv_bStop = false;
+static std::thread				lv_thread;
+
+static void idle_trim(uint64_t p_nQuietMs)
+{
+	size_t nRss = mi_rss();
+	size_t nBuffers = g_BufferPool.trim();
+	size_t nPixels = mi_pixel_pool_trim();
+	size_t nExpired = g_pResultCache != NULL ? g_pResultCache->compact() : 0;
+	int nParked = (lv_nPoolKeep > 0 && g_pPool != NULL) ? g_pPool->park(lv_nPoolKeep) : 0;
+	mi_alloc_collect();
+	mi_trim_working_set();
+	size_t nAfter = mi_rss();
+
+	lv_nReleased.store(nRss > nAfter ? nRss - nAfter : 0, std::memory_order_relaxed);
+	lv_nTrims.fetch_add(1, std::memory_order_relaxed);
+	std::cout << "Idle : trimmed after " << p_nQuietMs / 1000 << " s without requests, upload buffers " << (nBuffers >> 20)
+		<< " MB, pixel buffers " << (nPixels >> 20) << " MB, " << nExpired << " expired cache entries, "
+		<< nParked << " pipeline slots parked, resident " << (nRss >> 20) << " -> " << (nAfter >> 20) << " MB" << std::endl;
+}
+
+static void idle_restore(uint64_t p_nWakeMs)
+{
+	int nRestored = g_pPool != NULL ? g_pPool->unpark() : 0;
+	int64_t nMs = (int64_t)(mi_tick_ms() - p_nWakeMs);
+	lv_nRestoreMs.store(nMs, std::memory_order_relaxed);
+	std::cout << "Idle : woken, " << nRestored << " pipeline slots restored in " << nMs << " ms" << std::endl;
+}
+
+static void idle_loop()
+{
+	MiUniqueLock lock(lv_mtx);
+	uint64_t nPollMs = std::min<uint64_t>(std::max<uint64_t>(lv_nAfterMs / 4, 100), 1000);
+	while (!lv_bStop) {
+		lv_cv.wait_for(lock, std::chrono::milliseconds(nPollMs));
+		if (lv_bStop) break;
+		uint64_t nWake = lv_nWakeMs.exchange(0);
+		lock.unlock();
+		if (nWake != 0) {
+			idle_restore(nWake);
+		}
+		else if (!lv_bTrimmed.load()) {
+			uint64_t nNow = mi_tick_ms(), nLast = lv_nLastMs.load(std::memory_order_relaxed);
+			if (nNow > nLast && nNow - nLast >= lv_nAfterMs) {
+				//. set first : a request arriving during the trim wakes it again.
+				lv_bTrimmed.store(true);
+				idle_trim(nNow - nLast);
+			}
+		}
+		lock.lock();
+	}
+}
+
+void mi_idle_init(bool p_bEnable, int p_nAfterSec, int p_nPoolKeep)
+{
+	if (!p_bEnable || p_nAfterSec <= 0) return;
+	lv_nAfterMs = (uint64_t)p_nAfterSec * 1000;
+	lv_nPoolKeep = p_nPoolKeep > 0 ? p_nPoolKeep : 0;
+	lv_nLastMs = mi_tick_ms();
+	lv_bStop = false;
+	lv_bEnable = true;
+	lv_thread = std::thread(idle_loop);
+}
+
+void mi_idle_shutdown()
+{
+	if (!lv_bEnable) return;
+	{
+		MiLockGuard lock(lv_mtx);
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	if (lv_thread.joinable()) lv_thread.join();
+	lv_bEnable = false;
+}
+
+bool mi_idle_request()
+{
+	if (!lv_bEnable) return false;
+	uint64_t nNow = mi_tick_ms();
+	lv_nLastMs.store(nNow, std::memory_order_relaxed);
+	if (!lv_bTrimmed.load(std::memory_order_relaxed) || !lv_bTrimmed.exchange(false)) return false;
+	lv_nWakeMs.store(nNow);
+	lv_cv.notify_one();
+	return true;
+}
+
+void mi_idle_woken(double p_dSeconds)
+{
+	lv_nWakeRequestMs.store((int64_t)(p_dSeconds * 1000), std::memory_order_relaxed);
+}
+
+bool mi_idle_trimmed()
+{
+	return lv_bTrimmed.load(std::memory_order_relaxed);
+}
+
+uint64_t mi_idle_trims()
+{
+	return lv_nTrims.load(std::memory_order_relaxed);
+}
+
+uint64_t mi_idle_released_bytes()
+{
+	return lv_nReleased.load(std::memory_order_relaxed);
+}
+
+int64_t mi_idle_restore_ms()
+{
+	return lv_nRestoreMs.load(std::memory_order_relaxed);
+}
+
+int64_t mi_idle_wake_request_ms()
+{
+	return lv_nWakeRequestMs.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+//. Idle trimming ([idle] settings). A node sized for the daytime peak keeps, through a quiet
+//. night, its pooled upload and pixel buffers, the expired entries of the result cache, the
+//. free pages of the heaps and every pipeline instance of the pool. After after_sec without
+//. an API request the idle thread gives them back :
+//. - frees the free lists of g_BufferPool and of the pixel pool (MiPixelPool.h),
+//. - drops the expired result cache entries (the live ones are kept),
+//. - with pool_keep > 0, parks the pipeline pool slots from pool_keep on (PipelinePool::park),
+//.   which frees their model weights and engine buffers,
+//. - returns the free heap pages (mi_alloc_collect, mi_trim_working_set).
+//. The pools fill again as requests need them. The first request after a trim wakes the idle
+//. thread, which recreates the parked pipelines in the background; meanwhile requests share
+//. the slots left. The time to restore the pool and the duration of the waking request are
+//. logged and on GD_API_METRICS (mi_idle_*), next to the resident bytes each trim released.
+//. OpenVINO's thread arenas belong to the SDK and are not touched.
+
+void mi_idle_init(bool p_bEnable, int p_nAfterSec, int p_nPoolKeep);
+void mi_idle_shutdown();
+
+//. an API request starts (RequestTimer, MiMetrics.h); true when it woke a trimmed server.
+bool mi_idle_request();
+//. the request that woke the server took p_dSeconds.
+void mi_idle_woken(double p_dSeconds);
+
+bool mi_idle_trimmed();
+uint64_t mi_idle_trims();
+//. resident bytes the last trim released.
+uint64_t mi_idle_released_bytes();
+//. of the last wake, -1 before the first one.
+int64_t mi_idle_restore_ms();
+int64_t mi_idle_wake_request_ms();
@@ -0,0 +1,53 @@
+#include "MiImage.h"
+#include "MiCodecs.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "MiSdkCall.h"
+
+SharedImage::~SharedImage()
+{
+	if (m_pImage != NULL) face_sdk_api().image_destroy(m_pImage);
+}
+
+static ImageHandle wrap(CImage_t* p_pImage)
+{
+	if (p_pImage == NULL) return ImageHandle();
+	return std::make_shared<const SharedImage>(p_pImage);
+}
+
+ImageHandle mi_image_decode(const uint8_t* p_pData, size_t p_nLen, int* p_pErr, char* p_pszMsg, RequestContext* p_pCtx)
+{
+	mi_image_count_decode(p_pData, p_pCtx);
+	DecodedFrame frame;
+	if (mi_image_codec_decode(p_pData, p_nLen, frame))
+		return wrap(FaceSdk::image_create_pixels(frame.pixels.data(), (size_t)frame.height, (size_t)frame.width, BGR888, p_pErr, p_pszMsg));
+	return wrap(FaceSdk::image_create_bytes(p_pData, p_nLen, p_pErr, p_pszMsg));
+}
+
+bool mi_image_codec_decode(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out)
+{
+	int nFormat = mi_codec_of(p_pData, p_nLen);
+	if (nFormat < 0) return false;
+	bool bOk = mi_codec_decode(p_pData, p_nLen, p_out);
+	mi_metrics_decode_format(nFormat, bOk);
+	if (bOk && p_out.orientation != 1) mi_metrics_upright(p_out.orientation);
+	return bOk;
+}
+
+ImageHandle mi_image_decode_path(const char* p_pszPath, int* p_pErr, char* p_pszMsg)
+{
+	mi_image_count_decode(p_pszPath);
+	return wrap(FaceSdk::image_create_path(p_pszPath, p_pErr, p_pszMsg));
+}
+
+ImageHandle mi_image_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, int* p_pErr, char* p_pszMsg)
+{
+	return wrap(FaceSdk::image_create_pixels(p_pPixels, (size_t)p_nHeight, (size_t)p_nWidth, p_encoding, p_pErr, p_pszMsg));
+}
+
+void mi_image_count_decode(const void* p_pSource, RequestContext* p_pCtx)
+{
+	RequestContext* ctx = p_pCtx != NULL ? p_pCtx : mi_context();
+	bool bRepeat = ctx != NULL && ctx->decoded(p_pSource);
+	mi_metrics_image_decode(bRepeat);
+}
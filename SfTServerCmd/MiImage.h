@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include "FaceSdkApi.h"
+#include "MiDecode.h"
+
+struct RequestContext;
+
+//. Decode-once image of a request : one CImage_t shared by every engine that looks at the
+//. upload (the gate's detection and quality checks, the /api/analyze detector, liveness),
+//. released with image_destroy by the last holder. Handles live within the request that
+//. made them; the engines take the const CImage_t* of get() and never destroy it.
+//. Every decode of an encoded upload is tallied on its request context : the SDK decodes
+//. below, the DCT-scaled and cropping WIC decodes (MiDecode.h, MiFaceCrop.h), the server
+//. codecs (MiCodecs.h) and the blueprint ImageDecoder. A decode of a source the request already decoded is a repeat :
+//. mi_image_decodes_total{decode="first"|"repeat"} on /metrics (repeat should stay 0), and
+//. "decodes" in the access log per request.
+
+class SharedImage {
+public:
+	//. takes ownership of p_pImage.
+	explicit SharedImage(CImage_t* p_pImage) : m_pImage(p_pImage) {}
+	~SharedImage();
+
+	const CImage_t* get() const { return m_pImage; }
+
+private:
+	SharedImage(const SharedImage&) = delete;
+	SharedImage& operator=(const SharedImage&) = delete;
+
+	CImage_t*	m_pImage;
+};
+
+typedef std::shared_ptr<const SharedImage> ImageHandle;
+
+//. decodes p_pData (counted on p_pCtx, the current request when NULL); an empty handle
+//. with *p_pErr / p_pszMsg when the SDK refuses it. p_pCtx lets executor threads decode
+//. for the request thread waiting on them (mi_parallel_for).
+ImageHandle mi_image_decode(const uint8_t* p_pData, size_t p_nLen, int* p_pErr, char* p_pszMsg, RequestContext* p_pCtx = NULL);
+ImageHandle mi_image_decode_path(const char* p_pszPath, int* p_pErr, char* p_pszMsg);
+//. WebP / HEIC / AVIF into BGR pixels (MiCodecs.h), counted on mi_decode_formats_total;
+//. false for other uploads. Not counted as a decode : the caller does that for either path.
+bool mi_image_codec_decode(const uint8_t* p_pData, size_t p_nLen, DecodedFrame& p_out);
+//. wraps p_nWidth * p_nHeight decoded pixels : not a decode.
+ImageHandle mi_image_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, int* p_pErr, char* p_pszMsg);
+
+//. one decode of the upload at p_pSource for p_pCtx (the current request when NULL);
+//. p_pSource NULL for a new upload in a reused buffer (WebSocket frames).
+void mi_image_count_decode(const void* p_pSource, RequestContext* p_pCtx = NULL);
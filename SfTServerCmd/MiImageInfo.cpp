@@ -0,0 +1,199 @@
+#include "MiImageInfo.h"
+#include <string.h>
+
+static int	lv_nMaxSide = 0;
+static int	lv_nMaxMpix = 0;
+static int	lv_nMinSide = 0;
+
+static uint32_t be16(const uint8_t* p) { return ((uint32_t)p[0] << 8) | p[1]; }
+static uint32_t be32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+static uint32_t le16(const uint8_t* p) { return ((uint32_t)p[1] << 8) | p[0]; }
+static uint32_t le24(const uint8_t* p) { return ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0]; }
+static uint32_t le32(const uint8_t* p) { return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0]; }
+
+//. tag 0x0112 of IFD0 in an APP1 "Exif\0\0" segment body, 1 when absent.
+static int exif_orientation(const uint8_t* p_pSeg, size_t p_nLen)
+{
+	if (p_nLen < 14 || memcmp(p_pSeg, "Exif\0\0", 6) != 0) return 1;
+	const uint8_t* t = p_pSeg + 6;
+	size_t n = p_nLen - 6;
+	bool bLe = t[0] == 'I' && t[1] == 'I';
+	if (!bLe && !(t[0] == 'M' && t[1] == 'M')) return 1;
+	uint32_t ifd = bLe ? le32(t + 4) : be32(t + 4);
+	if ((size_t)ifd + 2 > n) return 1;
+	uint32_t nEntries = bLe ? le16(t + ifd) : be16(t + ifd);
+	for (uint32_t i = 0; i < nEntries; i++) {
+		size_t e = (size_t)ifd + 2 + (size_t)i * 12;
+		if (e + 12 > n) break;
+		uint32_t tag = bLe ? le16(t + e) : be16(t + e);
+		if (tag != 0x0112) continue;
+		int v = (int)(bLe ? le16(t + e + 8) : be16(t + e + 8));
+		return (v >= 1 && v <= 8) ? v : 1;
+	}
+	return 1;
+}
+
+//. walks the marker segments up to the first start-of-frame.
+static bool jpeg_info(const uint8_t* p_pData, size_t p_nLen, ImageInfo& p_info)
+{
+	size_t pos = 2;
+	while (pos + 4 <= p_nLen) {
+		if (p_pData[pos] != 0xFF) return false;
+		uint8_t marker = p_pData[pos + 1];
+		if (marker == 0xFF) { pos++; continue; }		//. fill byte
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { pos += 2; continue; }
+		if (marker == 0xD9 || marker == 0xDA) return false;		//. no frame header before the scan
+		uint32_t nSeg = be16(p_pData + pos + 2);
+		if (marker == 0xE1 && nSeg >= 2 && pos + 2 + nSeg <= p_nLen) p_info.orientation = exif_orientation(p_pData + pos + 4, nSeg - 2);
+		bool bSof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+		if (bSof) {
+			if (pos + 9 > p_nLen) return false;
+			p_info.height = (int)be16(p_pData + pos + 5);
+			p_info.width = (int)be16(p_pData + pos + 7);
+			p_info.format = MI_IMAGE_JPEG;
+			return true;
+		}
+		pos += 2 + nSeg;
+	}
+	return false;
+}
+
+static bool webp_info(const uint8_t* p_pData, size_t p_nLen, ImageInfo& p_info)
+{
+	if (p_nLen < 30) return false;
+	const uint8_t* c = p_pData + 12;
+	if (memcmp(c, "VP8 ", 4) == 0) {
+		p_info.width = (int)(le16(p_pData + 26) & 0x3FFF);
+		p_info.height = (int)(le16(p_pData + 28) & 0x3FFF);
+		p_info.format = MI_IMAGE_WEBP;
+		return true;
+	}
+	if (memcmp(c, "VP8L", 4) == 0) {
+		uint32_t bits = le32(p_pData + 21);
+		p_info.width = (int)(bits & 0x3FFF) + 1;
+		p_info.height = (int)((bits >> 14) & 0x3FFF) + 1;
+		p_info.format = MI_IMAGE_WEBP;
+		return true;
+	}
+	if (memcmp(c, "VP8X", 4) == 0) {
+		p_info.width = (int)le24(p_pData + 24) + 1;
+		p_info.height = (int)le24(p_pData + 27) + 1;
+		p_info.format = MI_IMAGE_WEBP;
+		return true;
+	}
+	return false;
+}
+
+//. the brands of the ftyp box tell HEIC from AVIF; the size is the largest ispe property of
+//. the meta box that follows it (tiles and thumbnails have smaller ones). Until the whole
+//. meta box is there : false, the upload passes as an unknown format. The orientation
+//. (irot / imir) is left to the decoder.
+//. MI_IMAGE_HEIF / MI_IMAGE_AVIF by the major and compatible brands of the ftyp box.
+static ImageFormat heif_brand(const uint8_t* p_pData, size_t p_nLen)
+{
+	size_t nFtyp = be32(p_pData);
+	if (nFtyp < 16 || nFtyp > p_nLen) return MI_IMAGE_UNKNOWN;
+	bool bHeif = false, bAvif = false;
+	for (size_t b = 8; b + 4 <= nFtyp; b += 4) {
+		if (b == 12) continue;		//. minor version
+		const char* brand = (const char*)p_pData + b;
+		if (memcmp(brand, "avif", 4) == 0 || memcmp(brand, "avis", 4) == 0) bAvif = true;
+		else if (memcmp(brand, "heic", 4) == 0 || memcmp(brand, "heix", 4) == 0 || memcmp(brand, "heim", 4) == 0 || memcmp(brand, "heis", 4) == 0
+			|| memcmp(brand, "hevc", 4) == 0 || memcmp(brand, "hevx", 4) == 0 || memcmp(brand, "mif1", 4) == 0 || memcmp(brand, "msf1", 4) == 0) bHeif = true;
+	}
+	return bAvif ? MI_IMAGE_AVIF : bHeif ? MI_IMAGE_HEIF : MI_IMAGE_UNKNOWN;
+}
+
+static bool heif_info(const uint8_t* p_pData, size_t p_nLen, ImageInfo& p_info)
+{
+	ImageFormat format = heif_brand(p_pData, p_nLen);
+	if (format == MI_IMAGE_UNKNOWN) return false;
+	size_t nFtyp = be32(p_pData);
+	if (nFtyp + 8 > p_nLen || memcmp(p_pData + nFtyp + 4, "meta", 4) != 0) return false;
+	size_t nMeta = be32(p_pData + nFtyp);
+	if (nMeta < 8 || nFtyp + nMeta > p_nLen) return false;
+	uint32_t w = 0, h = 0;
+	for (size_t i = nFtyp + 12; i + 16 <= nFtyp + nMeta; i++) {
+		if (memcmp(p_pData + i, "ispe", 4) != 0 || be32(p_pData + i - 4) != 20) continue;
+		uint32_t iw = be32(p_pData + i + 8), ih = be32(p_pData + i + 12);
+		if ((uint64_t)iw * ih > (uint64_t)w * h) { w = iw; h = ih; }
+	}
+	if (w == 0 || h == 0 || w > 0x7FFFFFFF || h > 0x7FFFFFFF) return false;
+	p_info.width = (int)w;
+	p_info.height = (int)h;
+	p_info.format = format;
+	return true;
+}
+
+ImageFormat mi_image_format(const uint8_t* p_pData, size_t p_nLen)
+{
+	if (p_pData == NULL || p_nLen < 16) return MI_IMAGE_UNKNOWN;
+	if (memcmp(p_pData, "RIFF", 4) == 0 && memcmp(p_pData + 8, "WEBP", 4) == 0) return MI_IMAGE_WEBP;
+	if (p_nLen >= 24 && memcmp(p_pData + 4, "ftyp", 4) == 0) return heif_brand(p_pData, p_nLen);
+	ImageInfo info;
+	return mi_image_info(p_pData, p_nLen, info) ? info.format : MI_IMAGE_UNKNOWN;
+}
+
+bool mi_image_info(const uint8_t* p_pData, size_t p_nLen, ImageInfo& p_info)
+{
+	if (p_pData == NULL || p_nLen < 10) return false;
+
+	if (p_pData[0] == 0xFF && p_pData[1] == 0xD8) return jpeg_info(p_pData, p_nLen, p_info);
+	if (p_nLen >= 24 && memcmp(p_pData, "\x89PNG\r\n\x1a\n", 8) == 0) {
+		p_info.width = (int)be32(p_pData + 16);
+		p_info.height = (int)be32(p_pData + 20);
+		p_info.format = MI_IMAGE_PNG;
+		return true;
+	}
+	if (p_nLen >= 26 && p_pData[0] == 'B' && p_pData[1] == 'M') {
+		int32_t w = (int32_t)le32(p_pData + 18), h = (int32_t)le32(p_pData + 22);
+		p_info.width = w < 0 ? -w : w;
+		p_info.height = h < 0 ? -h : h;		//. negative = top-down rows
+		p_info.format = MI_IMAGE_BMP;
+		return true;
+	}
+	if (memcmp(p_pData, "GIF8", 4) == 0) {
+		p_info.width = (int)le16(p_pData + 6);
+		p_info.height = (int)le16(p_pData + 8);
+		p_info.format = MI_IMAGE_GIF;
+		return true;
+	}
+	if (p_nLen >= 16 && memcmp(p_pData, "RIFF", 4) == 0 && memcmp(p_pData + 8, "WEBP", 4) == 0) return webp_info(p_pData, p_nLen, p_info);
+	if (p_nLen >= 24 && memcmp(p_pData + 4, "ftyp", 4) == 0) return heif_info(p_pData, p_nLen, p_info);
+	return false;
+}
+
+void mi_image_limits_init(int p_nMaxSide, int p_nMaxMpix, int p_nMinSide)
+{
+	lv_nMaxSide = p_nMaxSide > 0 ? p_nMaxSide : 0;
+	lv_nMaxMpix = p_nMaxMpix > 0 ? p_nMaxMpix : 0;
+	lv_nMinSide = p_nMinSide > 0 ? p_nMinSide : 0;
+}
+
+bool mi_image_too_small(const ImageInfo& p_info, std::string& p_strWhy)
+{
+	if (lv_nMinSide == 0 || p_info.long_side() >= lv_nMinSide) return false;
+	p_strWhy = "image side " + std::to_string(p_info.long_side()) + " is below server.min_image_side";
+	return true;
+}
+
+bool mi_image_size_allowed(int p_nWidth, int p_nHeight, std::string& p_strWhy)
+{
+	if (lv_nMaxSide > 0 && (p_nWidth > lv_nMaxSide || p_nHeight > lv_nMaxSide)) {
+		p_strWhy = "image side " + std::to_string(p_nWidth > p_nHeight ? p_nWidth : p_nHeight) + " exceeds server.max_image_side";
+		return false;
+	}
+	if (lv_nMaxMpix > 0 && (long long)p_nWidth * p_nHeight > (long long)lv_nMaxMpix * 1000000) {
+		p_strWhy = "image of " + std::to_string(p_nWidth) + "x" + std::to_string(p_nHeight) + " exceeds server.max_image_mpix";
+		return false;
+	}
+	return true;
+}
+
+bool mi_image_allowed(const uint8_t* p_pData, size_t p_nLen, std::string& p_strWhy)
+{
+	if (lv_nMaxSide == 0 && lv_nMaxMpix == 0) return true;
+	ImageInfo info;
+	if (!mi_image_info(p_pData, p_nLen, info)) return true;
+	return mi_image_size_allowed(info.width, info.height, p_strWhy);
+}
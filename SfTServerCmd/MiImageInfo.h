@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//. Format, dimensions and EXIF orientation read from the encoded header (JPEG SOF / APP1,
+//. PNG IHDR, BMP, GIF, WebP, HEIF / AVIF ftyp + ispe) without decoding anything. It needs the first few KB only, so
+//. multipart uploads are sniffed while they stream in (GD_IMAGE_SNIFF_MAX_BYTES) and the
+//. routing uses it instead of opening a WIC decoder : too large uploads are refused, too
+//. small ones answered FACE_TOO_SMALL without a decode, the crop and scaled-decode paths skip
+//. images they would not take. Limits are [server] max_image_side / max_image_mpix /
+//. min_image_side; formats it does not know pass and are left to the SDK.
+
+enum ImageFormat {
+	MI_IMAGE_UNKNOWN = 0,
+	MI_IMAGE_JPEG,
+	MI_IMAGE_PNG,
+	MI_IMAGE_BMP,
+	MI_IMAGE_GIF,
+	MI_IMAGE_WEBP,
+	MI_IMAGE_HEIF,		//. HEIC / HEIF still image (iPhone camera)
+	MI_IMAGE_AVIF
+};
+
+struct ImageInfo {
+	ImageFormat	format;
+	int			width;
+	int			height;
+	int			orientation;	//. EXIF 1..8, 1 = upright (also when absent)
+	ImageInfo() : format(MI_IMAGE_UNKNOWN), width(0), height(0), orientation(1) {}
+	int long_side() const { return width > height ? width : height; }
+};
+
+//. false when p_pData is not one of the formats above or its header is cut short.
+bool mi_image_info(const uint8_t* p_pData, size_t p_nLen, ImageInfo& p_info);
+
+//. the format from the magic bytes alone (HEIF / AVIF : the ftyp brands), for uploads whose
+//. header mi_image_info cannot size.
+ImageFormat mi_image_format(const uint8_t* p_pData, size_t p_nLen);
+
+//. 0 = no limit.
+void mi_image_limits_init(int p_nMaxSide, int p_nMaxMpix, int p_nMinSide);
+
+//. the long side is below server.min_image_side, no face in it can be large enough.
+bool mi_image_too_small(const ImageInfo& p_info, std::string& p_strWhy);
+
+//. false with p_strWhy set when the image is larger than the limits.
+bool mi_image_size_allowed(int p_nWidth, int p_nHeight, std::string& p_strWhy);
+bool mi_image_allowed(const uint8_t* p_pData, size_t p_nLen, std::string& p_strWhy);
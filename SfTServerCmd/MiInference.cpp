@@ -0,0 +1,187 @@
+#include "MiInference.h"
+#include "MiBatcher.h"
+#include "MiHealth.h"
+#include "MiLimiter.h"
+#include "MiMetrics.h"
+#include "MiPipelinePool.h"
+#include "MiRequestProfile.h"
+#include "MiSdkCall.h"
+#include "MiStages.h"
+#include "MiSupervisor.h"
+#include "MiWatchdog.h"
+#include <chrono>
+#include <vector>
+
+//. the canary's verdicts stay with the requests it checked (MiResultCache.h).
+static void mark_canary(const PipelineRef& p_canary)
+{
+	RequestContext* ctx = p_canary ? mi_context() : NULL;
+	if (ctx != NULL) ctx->canary = true;
+}
+
+CPipelineResult_t mi_check_liveness(const CImage_t* p_pImage, int* p_pErr, char* p_pszMsg, const CMeta_t* p_pMeta)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+
+	auto start = std::chrono::steady_clock::now();
+	PipelineRef canary = g_Supervisor.canary();
+	mark_canary(canary);
+	if (canary) {
+		mi_stage_infer([&]() {
+			LimitScope limit;
+			result = FaceSdk::pipeline_check_liveness(canary->pipeline, p_pImage, p_pMeta, p_pErr, p_pszMsg);
+			if (face_sdk_is_license_error(*p_pErr, p_pszMsg)) g_Supervisor.report(canary);
+		});
+	}
+	else if (p_pImage != NULL && g_pBatcher != NULL) {
+		//. the batcher reports license errors of its batches itself; its threads are
+		//. the infer stage of the batched calls (MiStages.h).
+		result = g_pBatcher->check(p_pImage, p_pMeta, p_pErr, p_pszMsg);
+	}
+	else {
+		mi_stage_infer([&]() {
+			LimitScope limit;
+			if (g_pPool != NULL) {
+				PipelineLease lease(g_pPool, mi_watchdog_queue_limit());
+				if (!lease.ok()) {
+					mi_watchdog_timeout(MI_WATCH_QUEUE, p_pErr, p_pszMsg);
+					return;
+				}
+				if (mi_watchdog_watched()) lease.watch();
+				result = FaceSdk::pipeline_check_liveness(lease.pipeline(), p_pImage, p_pMeta, p_pErr, p_pszMsg);
+				if (face_sdk_is_license_error(*p_pErr, p_pszMsg)) g_Supervisor.report(lease.ref());
+			}
+			else {
+				PipelineRef ref = g_Supervisor.current();
+				result = FaceSdk::pipeline_check_liveness(ref->pipeline, p_pImage, p_pMeta, p_pErr, p_pszMsg);
+				if (face_sdk_is_license_error(*p_pErr, p_pszMsg)) g_Supervisor.report(ref);
+			}
+		});
+	}
+	//. the batcher tells its own batch size.
+	if (canary || p_pImage == NULL || g_pBatcher == NULL) mi_request_profile_batch(1);
+	int err = p_pErr != NULL ? *p_pErr : OK;
+	mi_metrics_generation((bool)canary, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), &err, 1);
+	mi_health_checked(&err, 1);
+	return result;
+}
+
+static CPipelineResult_t* run_batch2(const PipelineRef& p_ref, std::vector<const CImage_t*>& p_vImages, const CMeta_t* p_pMeta, std::vector<int>& p_vErrors,
+	std::vector<char*>& p_vMsgs)
+{
+	//. the SDK reads one meta per image.
+	std::vector<CMeta_t> metas(p_pMeta != NULL ? p_vImages.size() : 0, p_pMeta != NULL ? *p_pMeta : CMeta_t());
+	CPipelineResult_t* results = FaceSdk::pipeline_check_liveness_batch2(p_ref->pipeline, p_vImages.data(), p_vImages.size(), p_pMeta != NULL ? metas.data() : NULL,
+		p_vErrors.data(), p_vMsgs.data());
+	for (size_t i = 0; i < p_vMsgs.size(); i++) {
+		if (face_sdk_is_license_error(p_vErrors[i], p_vMsgs[i])) {
+			g_Supervisor.report(p_ref);
+			break;
+		}
+	}
+	return results;
+}
+
+void mi_check_liveness_batch(const CImage_t** p_ppImages, size_t p_nCount, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs)
+{
+	//. compact the decodable images, the SDK call takes no holes.
+	std::vector<size_t> index;
+	std::vector<const CImage_t*> images;
+	for (size_t i = 0; i < p_nCount; i++) {
+		memset(&p_pResults[i], 0, sizeof(CPipelineResult_t));
+		if (p_ppImages[i] == NULL) continue;
+		index.push_back(i);
+		images.push_back(p_ppImages[i]);
+	}
+	if (images.empty()) return;
+
+	size_t n = images.size();
+	std::vector<int> errors(n, OK);
+	std::vector<char*> msgs(n);
+	for (size_t k = 0; k < n; k++) {
+		msgs[k] = p_ppszMsgs[index[k]];
+		msgs[k][0] = 0;
+	}
+
+	CPipelineResult_t* results = NULL;
+	auto start = std::chrono::steady_clock::now();
+	PipelineRef canary = g_Supervisor.canary();
+	mark_canary(canary);
+	mi_stage_infer([&]() {
+		LimitScope limit(n);
+		if (canary) {
+			results = run_batch2(canary, images, p_pMeta, errors, msgs);
+		}
+		else if (g_pPool != NULL) {
+			PipelineLease lease(g_pPool, mi_watchdog_queue_limit());
+			if (!lease.ok()) {
+				mi_watchdog_timeout(MI_WATCH_QUEUE, &errors[0], msgs[0]);
+				for (size_t k = 1; k < n; k++) {
+					errors[k] = errors[0];
+					memcpy(msgs[k], msgs[0], MESSAGE_BUFFER_SIZE);
+				}
+				return;
+			}
+			results = run_batch2(lease.ref(), images, p_pMeta, errors, msgs);
+		}
+		else {
+			results = run_batch2(g_Supervisor.current(), images, p_pMeta, errors, msgs);
+		}
+	});
+
+	for (size_t k = 0; k < n; k++) {
+		if (results != NULL) {
+			p_pResults[index[k]] = results[k];
+			p_pErrors[index[k]] = errors[k];
+		}
+		else {
+			p_pErrors[index[k]] = (errors[k] != OK) ? errors[k] : UNKNOWN;
+		}
+	}
+	if (results != NULL) {
+		face_sdk_api().CPipelineResult_destroy_array(results);
+	}
+	mi_request_profile_batch(n);
+	mi_metrics_generation((bool)canary, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), errors.data(), n);
+	mi_health_checked(errors.data(), n);
+}
+
+CPipelineResult_t mi_check_liveness_sequence(CImage_t** p_ppImages, size_t p_nCount, const uint64_t* p_pTimestamps, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg)
+{
+	CPipelineResult_t result;
+	memset(&result, 0, sizeof(result));
+
+	CImageBatch_t* batch = face_sdk_api().image_batch_create(p_ppImages, p_nCount, p_pTimestamps, p_pErr, p_pszMsg);
+	if (batch == NULL) return result;
+
+	auto start = std::chrono::steady_clock::now();
+	PipelineRef canary = g_Supervisor.canary();
+	mark_canary(canary);
+	mi_request_profile_batch(p_nCount);
+	mi_stage_infer([&]() {
+		LimitScope limit(p_nCount);
+		if (canary) {
+			result = FaceSdk::pipeline_check_liveness_batch(canary->pipeline, batch, p_pMeta, p_pErr, p_pszMsg);
+			if (face_sdk_is_license_error(*p_pErr, p_pszMsg)) g_Supervisor.report(canary);
+		}
+		else if (g_pPool != NULL) {
+			PipelineLease lease(g_pPool, mi_watchdog_queue_limit());
+			if (!lease.ok()) {
+				mi_watchdog_timeout(MI_WATCH_QUEUE, p_pErr, p_pszMsg);
+				return;
+			}
+			result = FaceSdk::pipeline_check_liveness_batch(lease.pipeline(), batch, p_pMeta, p_pErr, p_pszMsg);
+			if (face_sdk_is_license_error(*p_pErr, p_pszMsg)) g_Supervisor.report(lease.ref());
+		}
+		else {
+			PipelineRef ref = g_Supervisor.current();
+			result = FaceSdk::pipeline_check_liveness_batch(ref->pipeline, batch, p_pMeta, p_pErr, p_pszMsg);
+			if (face_sdk_is_license_error(*p_pErr, p_pszMsg)) g_Supervisor.report(ref);
+		}
+	});
+	face_sdk_api().image_batch_destroy(batch);
+	mi_metrics_generation((bool)canary, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), p_pErr, 1);
+	mi_health_checked(p_pErr, 1);
+	return result;
+}
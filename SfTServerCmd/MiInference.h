@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FaceSdkApi.h"
+
+//. Runs one liveness check through whatever execution path is configured
+//. (micro-batcher, pipeline pool or the supervisor's global pipeline). A license
+//. error is returned to the caller and reported to g_Supervisor, which rebuilds
+//. in the background. p_pMeta is a prebuilt MiMeta.h entry, NULL = pipeline defaults;
+//. the micro-batcher only batches images with the same one.
+//. A call g_Supervisor.canary() routes to the canary generation runs on that pipeline
+//. alone, the same for the two calls below.
+CPipelineResult_t mi_check_liveness(const CImage_t* p_pImage, int* p_pErr, char* p_pszMsg, const CMeta_t* p_pMeta = NULL);
+
+//. Evaluates p_nCount images in one pipeline_check_liveness_batch2 call on a pooled
+//. (or the global) pipeline. NULL entries are skipped and keep the error already in
+//. p_pErrors. p_ppszMsgs holds p_nCount buffers of MESSAGE_BUFFER_SIZE bytes.
+void mi_check_liveness_batch(const CImage_t** p_ppImages, size_t p_nCount, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs);
+
+//. Fuses p_nCount frames of one capture into a single verdict with
+//. image_batch_create + pipeline_check_liveness_batch. p_pTimestamps
+//. (milliseconds, may be NULL) gives the capture time of each frame.
+CPipelineResult_t mi_check_liveness_sequence(CImage_t** p_ppImages, size_t p_nCount, const uint64_t* p_pTimestamps, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg);
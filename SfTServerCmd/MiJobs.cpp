@@ -0,0 +1,618 @@
+#include "MiJobs.h"
+#include "MiBackend.h"
+#include "MiConf.h"
+#include "MiDedup.h"
+#include "MiLanes.h"
+#include "MiMeta.h"
+#include "MiMetrics.h"
+#include "MiMsgBuffers.h"
+#include "MiRedis.h"
+#include "MiSettings.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Environment.h"
+#include "Poco/File.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Path.h"
+#include "Poco/Redis/Command.h"
+#include "Poco/Redis/Type.h"
+#include "Poco/URI.h"
+#include "Poco/UUIDGenerator.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+enum JobState {
+	MI_JOB_QUEUED = 0,
+	MI_JOB_RUNNING,
+	MI_JOB_DONE
+};
+
+static const char* lv_szStates[] = { "queued", "running", "done" };
+
+struct JobItem {
+	CPipelineResult_t	result;
+	int					err;
+	char				msg[MESSAGE_BUFFER_SIZE];
+};
+
+struct Job {
+	std::string				id;
+	std::string				dir;		//. spool directory, empty for jobs taken from Redis
+	int						images;
+	int						metaIndex;
+	ResultSchema			schema;
+	std::string				callback;
+	JobState				state;
+	int						next;		//. first image not yet handed to a batch
+	int						done;
+	std::vector<JobItem>	items;
+	std::vector<std::string>	data;	//. images of a job taken from Redis
+	std::string				resultJson;	//. once done
+	std::chrono::steady_clock::time_point	finished;
+};
+
+static bool										lv_bEnabled = false;
+static bool										lv_bStop = false;
+static std::string								lv_strDir;
+static std::mutex								lv_mtx;
+static std::condition_variable					lv_cv;
+static std::map<std::string, std::shared_ptr<Job>>	lv_mapJobs;
+static std::deque<std::shared_ptr<Job>>			lv_queue;		//. jobs with images not yet batched
+static int										lv_nQueued = 0;	//. images not yet done
+static std::thread								lv_worker;
+static bool										lv_bShared = false;	//. queue in Redis, see MiRedis.h
+static bool										lv_bKick = false;	//. a job went to the Redis queue
+static std::string								lv_strRunning;		//. this node's list of taken jobs
+
+using Poco::Redis::Array;
+using Poco::Redis::BulkString;
+using Poco::Redis::Command;
+
+static std::string image_path(const Job& p_job, int p_nIndex)
+{
+	return p_job.dir + "/" + std::to_string(p_nIndex) + ".img";
+}
+
+static bool write_file(const std::string& p_strPath, const char* p_pData, size_t p_nLen)
+{
+	std::ofstream out(p_strPath, std::ios::binary | std::ios::trunc);
+	out.write(p_pData, (std::streamsize)p_nLen);
+	return (bool)out;
+}
+
+static bool read_file(const std::string& p_strPath, std::string& p_strOut)
+{
+	std::ifstream in(p_strPath, std::ios::binary);
+	if (!in) return false;
+	std::ostringstream ss;
+	ss << in.rdbuf();
+	p_strOut = ss.str();
+	return true;
+}
+
+static std::string json_escape(const std::string& p_str)
+{
+	std::string out;
+	for (char c : p_str) {
+		if (c == '"' || c == '\\') out.push_back('\\');
+		if ((unsigned char)c >= 0x20) out.push_back(c);
+	}
+	return out;
+}
+
+//. lv_mtx held.
+static void build_result(Job& p_job)
+{
+	ArenaString out;
+	out.reserve(64 + (size_t)p_job.images * GD_RESULT_JSON_RESERVE);
+	out += "{\"id\":\"";
+	out += p_job.id.c_str();
+	out += "\",\"status\":\"done\",\"images\":";
+	out += std::to_string(p_job.images).c_str();
+	out += ",\"results\":[";
+	for (int i = 0; i < p_job.images; i++) {
+		ResultExtra extra;
+		extra.index = i;
+		extra.error = p_job.items[i].err;
+		if (i > 0) out.push_back(',');
+		mi_json_result(p_job.schema, out, p_job.items[i].result, p_job.items[i].err, p_job.items[i].msg, extra);
+	}
+	out += "]}";
+	p_job.resultJson.assign(out.data(), out.size());
+}
+
+static void post_callback(const std::string& p_strUrl, const std::string& p_strBody)
+{
+	try {
+		Poco::URI uri(p_strUrl);
+		if (uri.getScheme() != "http") return;
+		Poco::Net::HTTPClientSession session(uri.getHost(), uri.getPort());
+		session.setTimeout(Poco::Timespan(GD_JOBS_CALLBACK_TIMEOUT_SEC, 0));
+		Poco::Net::HTTPRequest req(Poco::Net::HTTPRequest::HTTP_POST, uri.getPathAndQuery().empty() ? "/" : uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+		req.setContentType("application/json");
+		req.setContentLength((std::streamsize)p_strBody.size());
+		session.sendRequest(req).write(p_strBody.data(), (std::streamsize)p_strBody.size());
+		Poco::Net::HTTPResponse resp;
+		session.receiveResponse(resp);
+	}
+	catch (Poco::Exception&) {
+		//. best effort, the result stays available by polling.
+	}
+}
+
+//. the job's last image is done : persist the result, drop the images, call back.
+static void finish(const std::shared_ptr<Job>& p_pJob)
+{
+	std::string strBody;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		build_result(*p_pJob);
+		p_pJob->state = MI_JOB_DONE;
+		p_pJob->finished = std::chrono::steady_clock::now();
+		p_pJob->items.clear();
+		p_pJob->items.shrink_to_fit();
+		strBody = p_pJob->resultJson;
+	}
+	if (p_pJob->dir.empty()) {
+		p_pJob->data.clear();
+		p_pJob->data.shrink_to_fit();
+		//. result, state, images, counter and the taken entry in one round trip.
+		RedisConn conn;
+		if (conn.valid()) {
+			try {
+				std::vector<Array> cmds;
+				cmds.push_back(Command::set(mi_redis_key("jobres:", p_pJob->id), strBody, true, Poco::Timespan(g_Settings.jobsRetentionSec, 0)));
+				cmds.push_back(Command::hset(mi_redis_key("job:", p_pJob->id), "state", "done"));
+				cmds.push_back(Command::expire(mi_redis_key("job:", p_pJob->id), g_Settings.jobsRetentionSec));
+				cmds.push_back(Command::del(mi_redis_key("jobimg:", p_pJob->id)));
+				cmds.push_back(Command::decr(mi_redis_key("jobs:", "queued"), p_pJob->images));
+				cmds.push_back(Command::lrem(lv_strRunning, 1, p_pJob->id));
+				conn.pipeline(cmds);
+			}
+			catch (Poco::Exception&) {
+			}
+		}
+	}
+	else {
+		write_file(p_pJob->dir + "/result.json", strBody.data(), strBody.size());
+		for (int i = 0; i < p_pJob->images; i++) Poco::File(image_path(*p_pJob, i)).remove();
+	}
+	if (!p_pJob->callback.empty()) post_callback(p_pJob->callback, strBody);
+}
+
+//. done jobs past retention_sec leave memory and disk. lv_mtx held.
+static void expire(std::vector<std::string>& p_vDirs)
+{
+	auto now = std::chrono::steady_clock::now();
+	for (auto it = lv_mapJobs.begin(); it != lv_mapJobs.end();) {
+		Job& job = *it->second;
+		if (job.state == MI_JOB_DONE && now - job.finished > std::chrono::seconds(g_Settings.jobsRetentionSec)) {
+			if (!job.dir.empty()) p_vDirs.push_back(job.dir);
+			it = lv_mapJobs.erase(it);
+		}
+		else ++it;
+	}
+}
+
+struct BatchEntry {
+	std::shared_ptr<Job>	job;
+	int						index;
+};
+
+static std::shared_ptr<Job> make_job(const std::string& p_strId, int p_nImages, int p_nMeta, ResultSchema p_schema, const std::string& p_strCallback)
+{
+	std::shared_ptr<Job> pJob = std::make_shared<Job>();
+	pJob->id = p_strId;
+	pJob->dir = lv_strDir + "/" + p_strId;
+	pJob->images = p_nImages;
+	pJob->metaIndex = p_nMeta;
+	pJob->schema = p_schema;
+	pJob->callback = p_strCallback;
+	pJob->state = MI_JOB_QUEUED;
+	pJob->next = 0;
+	pJob->done = 0;
+	pJob->items.resize(p_nImages);
+	for (int i = 0; i < p_nImages; i++) {
+		memset(&pJob->items[i].result, 0, sizeof(CPipelineResult_t));
+		pJob->items[i].err = OK;
+		pJob->items[i].msg[0] = 0;
+	}
+	return pJob;
+}
+
+static std::string hash_field(const Array& p_values, size_t p_nIndex)
+{
+	if (p_values.getType(p_nIndex) != Poco::Redis::RedisTypeTraits<BulkString>::TypeId) return "";
+	BulkString value = p_values.get<BulkString>(p_nIndex);
+	return value.isNull() ? "" : value.value();
+}
+
+//. moves jobs from the Redis queue to this node while it has less than a batch to do.
+//. RPOPLPUSH keeps each one in lv_strRunning until its result is stored, so the jobs of
+//. a node that dies go back to the queue when it starts again.
+static void take_shared(size_t p_nBatch)
+{
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> lock(lv_mtx);
+			if (lv_bStop || (size_t)lv_nQueued >= p_nBatch) return;
+		}
+		RedisConn conn;
+		if (!conn.valid()) return;
+		try {
+			std::vector<Array> cmds(1, Command::rpoplpush(mi_redis_key("jobs:", "queue"), lv_strRunning));
+			Array replies = conn.pipeline(cmds);
+			std::string strId = hash_field(replies, 0);
+			if (strId.empty()) return;
+
+			Command::StringVec fields;
+			fields.push_back("images");
+			fields.push_back("meta");
+			fields.push_back("schema");
+			fields.push_back("callback");
+			cmds.clear();
+			cmds.push_back(Command::hmget(mi_redis_key("job:", strId), fields));
+			cmds.push_back(Command::lrange(mi_redis_key("jobimg:", strId)));
+			cmds.push_back(Command::hset(mi_redis_key("job:", strId), "state", "running"));
+			replies = conn.pipeline(cmds);
+
+			Array header = replies.get<Array>(0);
+			Array images = replies.get<Array>(1);
+			int n = atoi(hash_field(header, 0).c_str());
+			if (n <= 0 || images.size() != (size_t)n) {
+				//. expired or half written : nothing to check.
+				cmds.clear();
+				cmds.push_back(Command::lrem(lv_strRunning, 1, strId));
+				conn.pipeline(cmds);
+				continue;
+			}
+			std::shared_ptr<Job> pJob = make_job(strId, n, atoi(hash_field(header, 1).c_str()), (ResultSchema)atoi(hash_field(header, 2).c_str()), hash_field(header, 3));
+			pJob->dir.clear();
+			pJob->data.resize(n);
+			for (int i = 0; i < n; i++) pJob->data[i] = hash_field(images, i);
+
+			std::lock_guard<std::mutex> lock(lv_mtx);
+			lv_mapJobs[strId] = pJob;
+			lv_queue.push_back(pJob);
+			lv_nQueued += n;
+		}
+		catch (Poco::Exception&) {
+			return;
+		}
+	}
+}
+
+static void run()
+{
+	size_t nBatch = g_Settings.jobsBatchSize > 0 ? (size_t)g_Settings.jobsBatchSize : 1;
+	std::vector<BatchEntry> batch;
+	std::vector<std::string> data;
+	std::vector<std::string> expired;
+	for (;;) {
+		int metaIndex = 0;
+		batch.clear();
+		expired.clear();
+		if (lv_bShared) take_shared(nBatch);
+		{
+			std::unique_lock<std::mutex> lock(lv_mtx);
+			lv_cv.wait_for(lock, lv_bShared ? std::chrono::milliseconds(GD_JOBS_REDIS_POLL_MS) : std::chrono::milliseconds(1000), []() { return lv_bStop || lv_bKick || !lv_queue.empty(); });
+			if (lv_bStop) return;
+			lv_bKick = false;
+			expire(expired);
+
+			//. images of the queued jobs in order, one calibration per batch.
+			if (!lv_queue.empty()) metaIndex = lv_queue.front()->metaIndex;
+			for (auto it = lv_queue.begin(); it != lv_queue.end() && batch.size() < nBatch;) {
+				Job& job = **it;
+				if (job.metaIndex != metaIndex) { ++it; continue; }
+				job.state = MI_JOB_RUNNING;
+				while (job.next < job.images && batch.size() < nBatch) batch.push_back(BatchEntry{ *it, job.next++ });
+				if (job.next >= job.images) it = lv_queue.erase(it);
+				else ++it;
+			}
+		}
+		for (size_t i = 0; i < expired.size(); i++) {
+			try {
+				Poco::File(expired[i]).remove(true);
+			}
+			catch (Poco::Exception&) {
+			}
+		}
+		if (batch.empty()) continue;
+
+		size_t n = batch.size();
+		data.resize(n);
+		std::vector<const std::string*> ptrs(n);
+		for (size_t i = 0; i < n; i++) {
+			const Job& job = *batch[i].job;
+			if (job.dir.empty()) {
+				ptrs[i] = &job.data[batch[i].index];
+				continue;
+			}
+			if (!read_file(image_path(job, batch[i].index), data[i])) data[i].clear();
+			ptrs[i] = &data[i];
+		}
+		std::vector<CPipelineResult_t> results(n);
+		std::vector<int> errors(n, OK);
+		MsgBuffers msgs(n);
+
+		{
+			LanePermit permit(MI_LANE_BULK);
+			try {
+				mi_dedup_check_batch(g_pBackend, MI_DEDUP_JOBS, ptrs, NULL, mi_meta_at(metaIndex), results.data(), errors.data(), msgs.data());
+			}
+			catch (Poco::Exception&) {
+				for (size_t i = 0; i < n; i++) errors[i] = UNKNOWN;
+			}
+		}
+		for (size_t i = 0; i < n; i++) mi_metrics_status(errors[i]);
+
+		std::vector<std::shared_ptr<Job>> finished;
+		{
+			std::lock_guard<std::mutex> lock(lv_mtx);
+			for (size_t i = 0; i < n; i++) {
+				Job& job = *batch[i].job;
+				JobItem& item = job.items[batch[i].index];
+				item.result = results[i];
+				item.err = errors[i];
+				if (errors[i] != OK) memcpy(item.msg, msgs[i], MESSAGE_BUFFER_SIZE);
+				else item.msg[0] = '\0';
+				lv_nQueued--;
+				if (++job.done == job.images) finished.push_back(batch[i].job);
+			}
+		}
+		for (size_t i = 0; i < finished.size(); i++) finish(finished[i]);
+	}
+}
+
+//. jobs left by the previous run.
+static void load_spool()
+{
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(lv_strDir); it != end; ++it) {
+		if (!it->isDirectory()) continue;
+		std::string strId = it.name();
+		std::string strJob;
+		if (!read_file(it->path() + "/job.json", strJob)) continue;
+		try {
+			Poco::JSON::Parser parser;
+			Poco::JSON::Object::Ptr obj = parser.parse(strJob).extract<Poco::JSON::Object::Ptr>();
+			std::shared_ptr<Job> pJob = make_job(strId, obj->getValue<int>("images"), obj->optValue<int>("meta", 0),
+				(ResultSchema)obj->optValue<int>("schema", MI_SCHEMA_LEGACY), obj->optValue<std::string>("callback", ""));
+			std::string strResult;
+			if (read_file(pJob->dir + "/result.json", strResult)) {
+				pJob->state = MI_JOB_DONE;
+				pJob->done = pJob->images;
+				pJob->items.clear();
+				pJob->resultJson = strResult;
+				pJob->finished = std::chrono::steady_clock::now();
+			}
+			else {
+				lv_queue.push_back(pJob);
+				lv_nQueued += pJob->images;
+			}
+			lv_mapJobs[strId] = pJob;
+		}
+		catch (Poco::Exception&) {
+		}
+	}
+}
+
+bool mi_jobs_start(std::string& p_strErr)
+{
+	if (lv_bEnabled) return true;
+	lv_bShared = mi_redis_enabled() && g_Settings.redisJobs;
+	if (lv_bShared) {
+		lv_strRunning = mi_redis_key("jobs:running:", Poco::Environment::nodeName() + ":" + std::to_string(g_Settings.port));
+		//. jobs this node had taken before it stopped.
+		try {
+			RedisConn conn;
+			if (!conn.valid()) throw Poco::Redis::RedisException("no connection");
+			std::vector<Array> cmds(1, Command::rpoplpush(lv_strRunning, mi_redis_key("jobs:", "queue")));
+			while (!hash_field(conn.pipeline(cmds), 0).empty()) {}
+		}
+		catch (Poco::Exception& ex) {
+			p_strErr = ex.displayText();
+			return false;
+		}
+		lv_bStop = false;
+		lv_worker = std::thread(run);
+		lv_bEnabled = true;
+		return true;
+	}
+	try {
+		lv_strDir = Poco::Path(g_Settings.jobsDir).absolute().toString(Poco::Path::PATH_UNIX);
+		if (!lv_strDir.empty() && lv_strDir.back() == '/') lv_strDir.pop_back();
+		Poco::File(lv_strDir).createDirectories();
+		load_spool();
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		return false;
+	}
+	lv_bStop = false;
+	lv_worker = std::thread(run);
+	lv_bEnabled = true;
+	return true;
+}
+
+void mi_jobs_stop()
+{
+	if (!lv_bEnabled) return;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	if (lv_worker.joinable()) lv_worker.join();
+	lv_bEnabled = false;
+}
+
+bool mi_jobs_enabled()
+{
+	return lv_bEnabled;
+}
+
+//. header, images and queue entry in one round trip; the counter bounds the images of
+//. all nodes.
+static std::string submit_shared(const std::vector<const std::string*>& p_vImages, const CMeta_t* p_pMeta, ResultSchema p_schema,
+	const std::string& p_strCallback, std::string& p_strErr)
+{
+	int n = (int)p_vImages.size();
+	RedisConn conn;
+	if (!conn.valid()) {
+		p_strErr = "job queue unavailable";
+		return "";
+	}
+	std::string strId = Poco::UUIDGenerator::defaultGenerator().createRandom().toString();
+	try {
+		std::vector<Array> cmds(1, Command::incr(mi_redis_key("jobs:", "queued"), n));
+		Poco::Int64 nQueued = conn.pipeline(cmds).get<Poco::Int64>(0);
+		if (nQueued > g_Settings.jobsMaxQueued) {
+			cmds[0] = Command::decr(mi_redis_key("jobs:", "queued"), n);
+			conn.pipeline(cmds);
+			p_strErr = "job queue is full";
+			return "";
+		}
+
+		std::map<std::string, std::string> header;
+		header["images"] = std::to_string(n);
+		header["meta"] = std::to_string(mi_meta_index(p_pMeta));
+		header["schema"] = std::to_string((int)p_schema);
+		header["callback"] = p_strCallback;
+		header["state"] = "queued";
+		Command::StringVec images(n);
+		for (int i = 0; i < n; i++) images[i] = *p_vImages[i];
+
+		cmds.clear();
+		cmds.push_back(Command::hmset(mi_redis_key("job:", strId), header));
+		cmds.push_back(Command::rpush(mi_redis_key("jobimg:", strId), images));
+		cmds.push_back(Command::lpush(mi_redis_key("jobs:", "queue"), strId));
+		conn.pipeline(cmds);
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		return "";
+	}
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		lv_bKick = true;
+	}
+	lv_cv.notify_one();
+	return strId;
+}
+
+std::string mi_jobs_submit(const std::vector<const std::string*>& p_vImages, const CMeta_t* p_pMeta, ResultSchema p_schema,
+	const std::string& p_strCallback, std::string& p_strErr)
+{
+	int n = (int)p_vImages.size();
+	if (lv_bShared) return submit_shared(p_vImages, p_pMeta, p_schema, p_strCallback, p_strErr);
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		if (lv_nQueued + n > g_Settings.jobsMaxQueued) {
+			p_strErr = "job queue is full";
+			return "";
+		}
+	}
+
+	std::string strId = Poco::UUIDGenerator::defaultGenerator().createRandom().toString();
+	std::shared_ptr<Job> pJob = make_job(strId, n, mi_meta_index(p_pMeta), p_schema, p_strCallback);
+	try {
+		Poco::File(pJob->dir).createDirectories();
+		for (int i = 0; i < n; i++) {
+			if (!write_file(image_path(*pJob, i), p_vImages[i]->data(), p_vImages[i]->size())) throw Poco::WriteFileException(image_path(*pJob, i));
+		}
+		//. written last : a job without it is not picked up after a restart.
+		std::string strJob = "{\"images\":" + std::to_string(n) + ",\"meta\":" + std::to_string(pJob->metaIndex) + ",\"schema\":" + std::to_string((int)p_schema)
+			+ ",\"callback\":\"" + json_escape(p_strCallback) + "\"}";
+		if (!write_file(pJob->dir + "/job.json", strJob.data(), strJob.size())) throw Poco::WriteFileException(pJob->dir + "/job.json");
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		try {
+			Poco::File(pJob->dir).remove(true);
+		}
+		catch (Poco::Exception&) {
+		}
+		return "";
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		lv_mapJobs[strId] = pJob;
+		lv_queue.push_back(pJob);
+		lv_nQueued += n;
+	}
+	lv_cv.notify_one();
+	return strId;
+}
+
+//. a job queued or finished by another node.
+static bool status_shared(const std::string& p_strId, ArenaString& p_out)
+{
+	RedisConn conn;
+	if (!conn.valid()) return false;
+	try {
+		Command::StringVec fields;
+		fields.push_back("images");
+		fields.push_back("state");
+		std::vector<Array> cmds;
+		cmds.push_back(Command::get(mi_redis_key("jobres:", p_strId)));
+		cmds.push_back(Command::hmget(mi_redis_key("job:", p_strId), fields));
+		Array replies = conn.pipeline(cmds);
+		std::string strResult = hash_field(replies, 0);
+		if (!strResult.empty()) {
+			p_out.assign(strResult.data(), strResult.size());
+			return true;
+		}
+		Array header = replies.get<Array>(1);
+		std::string strImages = hash_field(header, 0);
+		if (strImages.empty()) return false;
+		std::string strState = hash_field(header, 1);
+		p_out += "{\"id\":\"";
+		p_out += p_strId.c_str();
+		p_out += "\",\"status\":\"";
+		p_out += strState.empty() ? lv_szStates[MI_JOB_QUEUED] : strState.c_str();
+		p_out += "\",\"images\":";
+		p_out += strImages.c_str();
+		p_out += ",\"done\":0}";
+		return true;
+	}
+	catch (Poco::Exception&) {
+		return false;
+	}
+}
+
+bool mi_jobs_status(const std::string& p_strId, ArenaString& p_out)
+{
+	std::unique_lock<std::mutex> lock(lv_mtx);
+	auto it = lv_mapJobs.find(p_strId);
+	if (it == lv_mapJobs.end()) {
+		lock.unlock();
+		return lv_bShared && status_shared(p_strId, p_out);
+	}
+	const Job& job = *it->second;
+	if (job.state == MI_JOB_DONE) {
+		p_out.assign(job.resultJson.data(), job.resultJson.size());
+		return true;
+	}
+	p_out += "{\"id\":\"";
+	p_out += job.id.c_str();
+	p_out += "\",\"status\":\"";
+	p_out += lv_szStates[job.state];
+	p_out += "\",\"images\":";
+	p_out += std::to_string(job.images).c_str();
+	p_out += ",\"done\":";
+	p_out += std::to_string(job.done).c_str();
+	p_out += "}";
+	return true;
+}
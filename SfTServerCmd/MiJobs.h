@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiArena.h"
+#include "MiResultJson.h"
+
+//. Asynchronous checks ([jobs]) : GD_API_JOBS stores the uploaded images of a job under
+//. jobs.dir and answers 202 with its id at once; GET GD_API_JOBS/<id> returns the state
+//. and, once done, the results in the order of the upload. A job may name a callback
+//. URL (http only), which gets the same JSON by POST when the job is done.
+//. One worker thread drains the queue in batches of up to jobs.batch_size images through
+//. the backend check_batch, across job boundaries, on the bulk lane : interactive
+//. requests keep their weighted share of the SDK and the jobs take the idle capacity.
+//. The spool survives a restart : unfinished jobs are queued again from their images,
+//. finished ones are served from their result file until jobs.retention_sec has passed.
+//. With redis.jobs the queue, images and results live in Redis instead (MiRedis.h) : any
+//. node takes queued jobs and answers for the jobs of the others.
+
+//. scans jobs.dir and starts the worker; call after the backend is up.
+bool mi_jobs_start(std::string& p_strErr);
+void mi_jobs_stop();
+bool mi_jobs_enabled();
+
+//. Writes the images and queues the job. Returns the id, empty when the queue already
+//. holds jobs.max_queued images (p_strErr tells why).
+std::string mi_jobs_submit(const std::vector<const std::string*>& p_vImages, const CMeta_t* p_pMeta, ResultSchema p_schema,
+	const std::string& p_strCallback, std::string& p_strErr);
+
+//. {"id","status","images","done"[,"results"]} of a job; false when the id is unknown.
+bool mi_jobs_status(const std::string& p_strId, ArenaString& p_out);
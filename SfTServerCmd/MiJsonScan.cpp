@@ -0,0 +1,290 @@
+#include "MiJsonScan.h"
+#include "MiBase64.h"
+#include <map>
+#include <memory>
+
+#define LD_SCAN_CHUNK		(64 * 1024)
+#define LD_MAX_KEY_LEN		256
+#define LD_ELEMENT_HINT		(1024 * 1024)
+#define LD_MAX_CAPTURE		(64 * 1024)
+
+enum ScanState {
+	S_START,
+	S_KEY_OR_END,
+	S_KEY,
+	S_KEY_ESC,
+	S_COLON,
+	S_VALUE,
+	S_ARRAY,
+	S_FIELD,
+	S_FIELD_ESC,
+	S_SKIP_STRING,
+	S_SKIP_STRING_ESC,
+	S_SKIP_NESTED,
+	S_SKIP_SCALAR,
+	S_AFTER_VALUE,
+	S_DONE
+};
+
+static inline bool is_ws(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+static void drain(std::istream& p_in, char* p_pBuf)
+{
+	while (p_in.good()) p_in.read(p_pBuf, LD_SCAN_CHUNK);
+}
+
+//. shared state machine. In array mode the target field (or a bare top-level array)
+//. may hold a list of strings; every string is decoded into the buffer p_fnNext returns,
+//. and its hash appended to p_pHashes (NULL = not hashed).
+static bool scan_base64(std::istream& p_in, const std::string& p_strField, bool p_bArray,
+	const std::function<std::string*(size_t)>& p_fnNext, size_t p_nSizeHint, size_t& p_nFound,
+	std::map<std::string, std::string>* p_pOther, std::vector<uint64_t>* p_pHashes, std::string& p_strErr)
+{
+	Hash64Stream hash;
+	Hash64Stream* pHash = p_pHashes != NULL ? &hash : NULL;
+	std::string buffer(LD_SCAN_CHUNK, '\0');
+	char* buf = &buffer[0];
+
+	std::unique_ptr<Base64StreamDecoder> decoder;
+	ScanState state = S_START;
+	std::string key;
+	bool inArray = false;		//. inside the target array
+	bool topArray = false;		//. the target array is the whole body
+	int depth = 0;
+	bool nestedInString = false, nestedEsc = false;
+	std::string* pCapture = NULL;	//. raw text of the other top-level value being skipped
+
+	p_nFound = 0;
+
+#define LD_FAIL(text)	{ p_strErr = (text); drain(p_in, buf); return false; }
+
+	while (state != S_DONE && p_in.good()) {
+		p_in.read(buf, LD_SCAN_CHUNK);
+		std::streamsize got = p_in.gcount();
+		const char* p = buf;
+		const char* end = buf + got;
+
+		while (p < end && state != S_DONE) {
+			if (state == S_FIELD) {
+				//. hot loop : hand the whole run up to the next quote/escape to the decoder.
+				const char* q = p;
+				while (q < end && *q != '"' && *q != '\\') q++;
+				if (q > p && !decoder->feed(p, q - p)) LD_FAIL("invalid base64 in field " + p_strField);
+				p = q;
+				if (p == end) break;
+				if (*p == '"') {
+					if (!decoder->finish()) LD_FAIL("truncated base64 in field " + p_strField);
+					decoder.reset();
+					if (pHash != NULL) p_pHashes->push_back(hash.digest());
+					p_nFound++;
+					state = inArray ? S_ARRAY : S_AFTER_VALUE;
+				}
+				else {
+					state = S_FIELD_ESC;
+				}
+				p++;
+				continue;
+			}
+
+			char c = *p++;
+			if (pCapture != NULL) {
+				bool bEnd = (state == S_SKIP_SCALAR && (c == ',' || c == '}' || is_ws(c)))
+					|| state == S_AFTER_VALUE || state == S_KEY_OR_END || state == S_DONE;
+				if (bEnd) pCapture = NULL;
+				else if (pCapture->size() < LD_MAX_CAPTURE) *pCapture += c;
+			}
+			switch (state) {
+			case S_START:
+				if (c == '{') state = S_KEY_OR_END;
+				else if (c == '[' && p_bArray) { inArray = true; topArray = true; state = S_ARRAY; }
+				else if (!is_ws(c)) LD_FAIL("body is not a JSON object");
+				break;
+			case S_KEY_OR_END:
+				if (c == '"') { key.clear(); state = S_KEY; }
+				else if (c == '}') state = S_DONE;
+				else if (c != ',' && !is_ws(c)) LD_FAIL("malformed JSON key");
+				break;
+			case S_KEY:
+				if (c == '"') state = S_COLON;
+				else if (c == '\\') state = S_KEY_ESC;
+				else if (key.size() < LD_MAX_KEY_LEN) key += c;
+				break;
+			case S_KEY_ESC:
+				if (key.size() < LD_MAX_KEY_LEN) key += c;
+				state = S_KEY;
+				break;
+			case S_COLON:
+				if (c == ':') state = S_VALUE;
+				else if (!is_ws(c)) LD_FAIL("malformed JSON, ':' expected");
+				break;
+			case S_VALUE:
+				if (is_ws(c)) break;
+				if (p_nFound == 0 && key == p_strField && c == '"') {
+					std::string* pOut = p_fnNext(0);
+					if (pOut == NULL) LD_FAIL("too many images");
+					hash.reset();
+					decoder.reset(new Base64StreamDecoder(pOut, p_nSizeHint, pHash));
+					state = S_FIELD;
+				}
+				else if (p_nFound == 0 && key == p_strField && c == '[' && p_bArray) {
+					inArray = true;
+					state = S_ARRAY;
+				}
+				else {
+					if (p_pOther != NULL && !key.empty()) {
+						pCapture = &(*p_pOther)[key];
+						pCapture->assign(1, c);
+					}
+					if (c == '"') state = S_SKIP_STRING;
+					else if (c == '{' || c == '[') { depth = 1; nestedInString = false; nestedEsc = false; state = S_SKIP_NESTED; }
+					else state = S_SKIP_SCALAR;
+				}
+				break;
+			case S_ARRAY:
+				if (c == '"') {
+					std::string* pOut = p_fnNext(p_nFound);
+					if (pOut == NULL) LD_FAIL("too many images");
+					hash.reset();
+					decoder.reset(new Base64StreamDecoder(pOut, p_nSizeHint, pHash));
+					state = S_FIELD;
+				}
+				else if (c == ']') {
+					inArray = false;
+					state = topArray ? S_DONE : S_AFTER_VALUE;
+				}
+				else if (c != ',' && !is_ws(c)) LD_FAIL("array of base64 strings expected in " + p_strField);
+				break;
+			case S_FIELD_ESC:
+				//. JSON allows "\/" and escaped line breaks inside the base64 text.
+				if (c == '/') decoder->feed("/", 1);
+				else if (c != 'n' && c != 'r' && c != 't') LD_FAIL("invalid escape in field " + p_strField);
+				state = S_FIELD;
+				break;
+			case S_SKIP_STRING:
+				if (c == '"') state = S_AFTER_VALUE;
+				else if (c == '\\') state = S_SKIP_STRING_ESC;
+				break;
+			case S_SKIP_STRING_ESC:
+				state = S_SKIP_STRING;
+				break;
+			case S_SKIP_NESTED:
+				if (nestedInString) {
+					if (nestedEsc) nestedEsc = false;
+					else if (c == '\\') nestedEsc = true;
+					else if (c == '"') nestedInString = false;
+				}
+				else if (c == '"') nestedInString = true;
+				else if (c == '{' || c == '[') depth++;
+				else if ((c == '}' || c == ']') && --depth == 0) state = S_AFTER_VALUE;
+				break;
+			case S_SKIP_SCALAR:
+				if (c == ',') state = S_KEY_OR_END;
+				else if (c == '}') state = S_DONE;
+				else if (is_ws(c)) state = S_AFTER_VALUE;
+				break;
+			case S_AFTER_VALUE:
+				if (c == ',') state = S_KEY_OR_END;
+				else if (c == '}') state = S_DONE;
+				else if (!is_ws(c)) LD_FAIL("malformed JSON after value");
+				break;
+			default:
+				break;
+			}
+		}
+	}
+#undef LD_FAIL
+	drain(p_in, buf);
+
+	if (decoder) {
+		p_strErr = "truncated base64 in field " + p_strField;
+		return false;
+	}
+	if (p_nFound == 0) {
+		p_strErr = "field not found : " + p_strField;
+		return false;
+	}
+	return true;
+}
+
+static void put_utf8(std::string& p_str, uint32_t p_nCode)
+{
+	if (p_nCode < 0x80) p_str += (char)p_nCode;
+	else if (p_nCode < 0x800) { p_str += (char)(0xC0 | (p_nCode >> 6)); p_str += (char)(0x80 | (p_nCode & 0x3F)); }
+	else if (p_nCode < 0x10000) { p_str += (char)(0xE0 | (p_nCode >> 12)); p_str += (char)(0x80 | ((p_nCode >> 6) & 0x3F)); p_str += (char)(0x80 | (p_nCode & 0x3F)); }
+	else {
+		p_str += (char)(0xF0 | (p_nCode >> 18)); p_str += (char)(0x80 | ((p_nCode >> 12) & 0x3F));
+		p_str += (char)(0x80 | ((p_nCode >> 6) & 0x3F)); p_str += (char)(0x80 | (p_nCode & 0x3F));
+	}
+}
+
+//. 4 hex digits at p_p, false when they are not.
+static bool hex4(const char* p_p, uint32_t& p_nOut)
+{
+	p_nOut = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = p_p[i];
+		int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+		if (v < 0) return false;
+		p_nOut = (p_nOut << 4) | (uint32_t)v;
+	}
+	return true;
+}
+
+bool json_string_value(const std::string& p_strRaw, std::string& p_strOut)
+{
+	p_strOut.clear();
+	size_t n = p_strRaw.size();
+	if (n < 2 || p_strRaw[0] != '"' || p_strRaw[n - 1] != '"') return false;
+	const char* p = p_strRaw.c_str() + 1;
+	const char* end = p_strRaw.c_str() + n - 1;
+	while (p < end) {
+		char c = *p++;
+		if (c != '\\') { p_strOut += c; continue; }
+		if (p == end) return false;
+		c = *p++;
+		switch (c) {
+		case '"': case '\\': case '/': p_strOut += c; break;
+		case 'b': p_strOut += '\b'; break;
+		case 'f': p_strOut += '\f'; break;
+		case 'n': p_strOut += '\n'; break;
+		case 'r': p_strOut += '\r'; break;
+		case 't': p_strOut += '\t'; break;
+		case 'u': {
+			uint32_t code, low;
+			if (end - p < 4 || !hex4(p, code)) return false;
+			p += 4;
+			//. a surrogate pair is one code point.
+			if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u' && hex4(p + 2, low) && low >= 0xDC00 && low < 0xE000) {
+				code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				p += 6;
+			}
+			put_utf8(p_strOut, code);
+			break;
+		}
+		default: return false;
+		}
+	}
+	return true;
+}
+
+bool json_extract_base64_field(std::istream& p_in, const std::string& p_strField, std::string* p_pOut,
+	size_t p_nContentLength, std::string& p_strErr, std::map<std::string, std::string>* p_pOther, uint64_t* p_pHash)
+{
+	size_t nFound = 0;
+	size_t nHint = p_nContentLength > 0 ? base64_decoded_bound(p_nContentLength) : LD_ELEMENT_HINT;
+	std::vector<uint64_t> vHash;
+	bool ok = scan_base64(p_in, p_strField, false, [p_pOut](size_t) { return p_pOut; }, nHint, nFound, p_pOther, p_pHash != NULL ? &vHash : NULL, p_strErr);
+	if (!ok) p_pOut->clear();
+	else if (p_pHash != NULL) *p_pHash = vHash.front();
+	return ok;
+}
+
+bool json_extract_base64_array(std::istream& p_in, const std::string& p_strField,
+	const std::function<std::string*(size_t)>& p_fnNext, size_t p_nContentLength, std::string& p_strErr,
+	std::map<std::string, std::string>* p_pOther, std::vector<uint64_t>* p_pHashes)
+{
+	size_t nFound = 0;
+	size_t nHint = p_nContentLength > 0 ? base64_decoded_bound(p_nContentLength) : LD_ELEMENT_HINT;
+	if (nHint > LD_ELEMENT_HINT) nHint = LD_ELEMENT_HINT;
+	return scan_base64(p_in, p_strField, true, p_fnNext, nHint, nFound, p_pOther, p_pHashes, p_strErr);
+}
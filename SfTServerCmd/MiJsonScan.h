@@ -0,0 +1,29 @@
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+//. Streams a JSON request body and base64-decodes the top-level string field
+//. p_strField straight into p_pOut, without building a DOM or copying the body.
+//. p_nContentLength (0 if unknown) sizes the output buffer once.
+//. The rest of the body is drained so the connection can be reused.
+//. When p_pOther is given, the raw JSON text of every other top-level value
+//. (up to 64 KB each) is stored in it by key, for small side fields such as meta.
+//. p_pHash receives mi_hash64 of the decoded field, computed as it is decoded (MiHash.h).
+bool json_extract_base64_field(std::istream& p_in, const std::string& p_strField, std::string* p_pOut,
+	size_t p_nContentLength, std::string& p_strErr, std::map<std::string, std::string>* p_pOther = NULL, uint64_t* p_pHash = NULL);
+
+//. Same for a field holding an array of base64 strings, or for a body that is a bare
+//. top-level array. p_fnNext is called at the start of every element with its index
+//. and returns the buffer that element is decoded into (NULL rejects the element).
+//. p_pHashes receives the hash of every element, in order.
+bool json_extract_base64_array(std::istream& p_in, const std::string& p_strField,
+	const std::function<std::string*(size_t)>& p_fnNext, size_t p_nContentLength, std::string& p_strErr,
+	std::map<std::string, std::string>* p_pOther = NULL, std::vector<uint64_t>* p_pHashes = NULL);
+
+//. the text of a JSON string as p_pOther holds it ("soft", quotes and escapes included),
+//. unescaped into p_strOut (\uXXXX as UTF-8). false when p_strRaw is not a string.
+bool json_string_value(const std::string& p_strRaw, std::string& p_strOut);
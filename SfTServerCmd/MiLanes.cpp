@@ -0,0 +1,101 @@
+#include "MiLanes.h"
+#include "MiConf.h"
+#include "MiContext.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+
+LaneGate* g_pLaneGate = NULL;
+
+static const char* lv_szLanes[MI_LANE_COUNT] = { "interactive", "bulk" };
+static int lv_nWeights[MI_LANE_COUNT] = { GD_LANE_WEIGHT_INTERACTIVE, GD_LANE_WEIGHT_BULK };
+static std::set<std::string> lv_setBulkKeys;
+
+void mi_lanes_init(int p_nWeightInteractive, int p_nWeightBulk, const std::string& p_strBulkKeys)
+{
+	lv_nWeights[MI_LANE_INTERACTIVE] = p_nWeightInteractive > 0 ? p_nWeightInteractive : 1;
+	lv_nWeights[MI_LANE_BULK] = p_nWeightBulk > 0 ? p_nWeightBulk : 1;
+	lv_setBulkKeys.clear();
+	Poco::StringTokenizer tok(p_strBulkKeys, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& key : tok) lv_setBulkKeys.insert(key);
+}
+
+MiLane mi_lane_of(const Poco::Net::HTTPRequest& p_request)
+{
+	//. the key and the endpoint decide; the header can only move a request down.
+	if (!lv_setBulkKeys.empty()) {
+		const std::string& key = p_request.get(GD_LANE_KEY_HEADER, "");
+		if (!key.empty() && lv_setBulkKeys.count(key) != 0) return MI_LANE_BULK;
+	}
+	const std::string& uri = p_request.getURI();
+	if (uri.compare(0, uri.find('?'), GD_API_BATCH) == 0) return MI_LANE_BULK;
+	const std::string& prio = p_request.get(GD_LANE_HEADER, "");
+	if (Poco::icompare(prio, "bulk") == 0 || Poco::icompare(prio, "low") == 0) return MI_LANE_BULK;
+	return MI_LANE_INTERACTIVE;
+}
+
+const char* mi_lane_name(int p_nLane)
+{
+	return lv_szLanes[p_nLane];
+}
+
+LaneScheduler::LaneScheduler()
+{
+	for (int i = 0; i < MI_LANE_COUNT; i++) m_nCurrent[i] = 0;
+}
+
+int LaneScheduler::pick(const bool* p_bReady)
+{
+	int best = -1;
+	int total = 0;
+	for (int i = 0; i < MI_LANE_COUNT; i++) {
+		if (!p_bReady[i]) continue;
+		m_nCurrent[i] += lv_nWeights[i];
+		total += lv_nWeights[i];
+		if (best < 0 || m_nCurrent[i] > m_nCurrent[best]) best = i;
+	}
+	if (best >= 0) m_nCurrent[best] -= total;
+	return best;
+}
+
+LaneGate::LaneGate(int p_nPermits)
+	: m_nFree(p_nPermits > 0 ? p_nPermits : 1), m_nTicket(0)
+{
+}
+
+void LaneGate::enter(int p_nLane)
+{
+	MiUniqueLock lock(m_mtx);
+	bool bQueued = false;
+	for (int i = 0; i < MI_LANE_COUNT; i++) bQueued |= !m_waiting[i].empty();
+	if (m_nFree > 0 && !bQueued) {
+		m_nFree--;
+		return;
+	}
+	unsigned long long ticket = ++m_nTicket;
+	RequestContext* ctx = mi_context();
+	Waiter w = { ctx != NULL && ctx->has_deadline() ? ctx->deadline : std::chrono::steady_clock::time_point::max(), ticket };
+	std::deque<Waiter>& lane = m_waiting[p_nLane];
+	auto it = lane.end();
+	while (it != lane.begin() && (it - 1)->deadline > w.deadline) --it;
+	lane.insert(it, w);
+	m_cv.wait(lock, [this, ticket] { return m_granted.count(ticket) != 0; });
+	m_granted.erase(ticket);
+}
+
+void LaneGate::leave()
+{
+	{
+		MiLockGuard lock(m_mtx);
+		bool bReady[MI_LANE_COUNT];
+		for (int i = 0; i < MI_LANE_COUNT; i++) bReady[i] = !m_waiting[i].empty();
+		int lane = m_sched.pick(bReady);
+		if (lane < 0) {
+			m_nFree++;
+			return;
+		}
+		//. the permit passes straight to the chosen waiter.
+		m_granted.insert(m_waiting[lane].front().ticket);
+		m_waiting[lane].pop_front();
+	}
+	m_cv.notify_all();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <set>
+#include <string>
+#include "Poco/Net/HTTPRequest.h"
+#include "MiLock.h"
+
+//. Priority lanes for inference work. Interactive checks and bulk re-verification
+//. share the SDK through weighted fair scheduling, so a backlog of bulk requests
+//. only takes its weight share of the inference slots.
+enum MiLane {
+	MI_LANE_INTERACTIVE = 0,
+	MI_LANE_BULK,
+	MI_LANE_COUNT
+};
+
+//. p_strBulkKeys : comma separated X-Api-Key values always routed to the bulk lane.
+void mi_lanes_init(int p_nWeightInteractive, int p_nWeightBulk, const std::string& p_strBulkKeys);
+
+//. lane of a request : bulk for one of the bulk keys as API key or for GD_API_BATCH, else
+//. GD_LANE_HEADER "bulk" / "low" lowers it to bulk. The header never raises a request, so a
+//. bulk key cannot put itself in the interactive lane.
+MiLane mi_lane_of(const Poco::Net::HTTPRequest& p_request);
+const char* mi_lane_name(int p_nLane);
+
+//. smooth weighted round robin over the lanes that have work (nginx upstream algorithm),
+//. bursts of one lane are interleaved instead of served back to back.
+class LaneScheduler {
+public:
+	LaneScheduler();
+
+	//. p_bReady[i] : lane i has work. Returns the lane to serve, -1 when none is ready.
+	int pick(const bool* p_bReady);
+
+private:
+	int		m_nCurrent[MI_LANE_COUNT];
+};
+
+//. classic mode : bounds the threads inside the SDK section to p_nPermits and hands a
+//. freed permit to the waiting lane chosen by the scheduler. Within a lane the earliest
+//. deadline (MiContext.h) goes first, requests without one in arrival order after them.
+class LaneGate {
+public:
+	explicit LaneGate(int p_nPermits);
+
+	void enter(int p_nLane);
+	void leave();
+
+private:
+	struct Waiter {
+		std::chrono::steady_clock::time_point	deadline;	//. max = none
+		unsigned long long						ticket;
+	};
+
+	int							m_nFree;
+	unsigned long long			m_nTicket;
+	MI_MUTEX(m_mtx, "lanes");
+	MiCondition					m_cv;
+	std::deque<Waiter>			m_waiting[MI_LANE_COUNT];
+	std::set<unsigned long long> m_granted;
+	LaneScheduler				m_sched;
+};
+
+extern LaneGate* g_pLaneGate;
+
+//. RAII permit of g_pLaneGate; no-op when the gate is off (reactor mode schedules
+//. the lanes in g_pWorkerPool instead).
+class LanePermit {
+public:
+	explicit LanePermit(int p_nLane) : m_pGate(g_pLaneGate) { if (m_pGate != NULL) m_pGate->enter(p_nLane); }
+	~LanePermit() { release(); }
+
+	void release() { if (m_pGate != NULL) { m_pGate->leave(); m_pGate = NULL; } }
+
+private:
+	LanePermit(const LanePermit&) = delete;
+	LanePermit& operator=(const LanePermit&) = delete;
+
+	LaneGate*	m_pGate;
+};
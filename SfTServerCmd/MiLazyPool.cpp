@@ -0,0 +1,163 @@
+#include "MiLazyPool.h"
+#include "MiConf.h"
+#include "MiLock.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+//. reaper of the pools with an idle timeout.
+static MI_MUTEX(lv_mtx, "lazy_pool.reaper");
+static MiCondition				lv_cv;
+static std::vector<LazyPool*>	lv_vPools;
+static std::thread				lv_reaper;
+static bool						lv_bStop = false;
+
+static void reaper_loop()
+{
+	MiUniqueLock lock(lv_mtx);
+	while (!lv_bStop) {
+		lv_cv.wait_for(lock, std::chrono::milliseconds(GD_LAZY_EVICT_POLL_MS), [] { return lv_bStop; });
+		if (lv_bStop) break;
+		for (LazyPool* p : lv_vPools) p->evict_idle();
+	}
+}
+
+static void register_pool(LazyPool* p_pPool)
+{
+	MiLockGuard lock(lv_mtx);
+	lv_vPools.push_back(p_pPool);
+	if (!lv_reaper.joinable()) {
+		lv_bStop = false;
+		lv_reaper = std::thread(reaper_loop);
+	}
+}
+
+static void unregister_pool(LazyPool* p_pPool)
+{
+	std::thread reaper;
+	{
+		MiLockGuard lock(lv_mtx);
+		auto it = std::find(lv_vPools.begin(), lv_vPools.end(), p_pPool);
+		if (it == lv_vPools.end()) return;
+		lv_vPools.erase(it);
+		if (!lv_vPools.empty()) return;
+		lv_bStop = true;
+		reaper.swap(lv_reaper);
+	}
+	lv_cv.notify_all();
+	if (reaper.joinable()) reaper.join();
+}
+
+LazyPool::LazyPool(const std::string& p_strName, BuildFn p_build, ReleaseFn p_release, int p_nIdleEvictMs)
+	: m_strName(p_strName), m_build(p_build), m_release(p_release), m_nIdleEvictMs(p_nIdleEvictMs), m_bBuilding(false)
+{
+	if (m_nIdleEvictMs > 0) register_pool(this);
+}
+
+LazyPool::~LazyPool()
+{
+	if (m_nIdleEvictMs > 0) unregister_pool(this);
+	MiLockGuard lock(m_mtx);
+	if (!m_vAll.empty()) m_release(m_vAll);
+	m_vAll.clear();
+	m_vFree.clear();
+}
+
+bool LazyPool::build_locked(MiUniqueLock& p_lock, std::string& p_strErr)
+{
+	for (;;) {
+		if (!m_vAll.empty()) return true;
+		if (m_bBuilding) {
+			m_cv.wait(p_lock);
+			continue;
+		}
+		if (!m_strErr.empty() && std::chrono::steady_clock::now() < m_retryAt) {
+			p_strErr = m_strErr;
+			return false;
+		}
+
+		m_bBuilding = true;
+		p_lock.unlock();
+		auto start = std::chrono::steady_clock::now();
+		std::vector<void*> vEngines;
+		std::string strErr;
+		bool bOk = m_build(vEngines, strErr) && !vEngines.empty();
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		p_lock.lock();
+		m_bBuilding = false;
+
+		if (bOk) {
+			m_vAll = vEngines;
+			m_vFree = vEngines;
+			m_strErr.clear();
+			m_lastUse = std::chrono::steady_clock::now();
+			std::cout << "Engines " << m_strName << " : " << m_vAll.size() << " built in " << ms << " ms" << std::endl;
+		}
+		else {
+			m_strErr = strErr.empty() ? std::string("no engine built") : strErr;
+			m_retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(GD_LAZY_RETRY_MS);
+			std::cout << "Engines " << m_strName << " : " << m_strErr << std::endl;
+			p_strErr = m_strErr;
+		}
+		m_cv.notify_all();
+		return bOk;
+	}
+}
+
+bool LazyPool::build(std::string& p_strErr)
+{
+	MiUniqueLock lock(m_mtx);
+	return build_locked(lock, p_strErr);
+}
+
+void* LazyPool::acquire(std::string& p_strErr)
+{
+	MiUniqueLock lock(m_mtx);
+	for (;;) {
+		if (!build_locked(lock, p_strErr)) return NULL;
+		//. an engine out keeps the pool from being evicted, so m_vAll stays while we wait.
+		m_cv.wait(lock, [this] { return !m_vFree.empty() || m_vAll.empty(); });
+		if (m_vFree.empty()) continue;
+		void* p = m_vFree.back();
+		m_vFree.pop_back();
+		return p;
+	}
+}
+
+void LazyPool::release(void* p_pEngine)
+{
+	{
+		MiLockGuard lock(m_mtx);
+		m_vFree.push_back(p_pEngine);
+		m_lastUse = std::chrono::steady_clock::now();
+	}
+	m_cv.notify_one();
+}
+
+bool LazyPool::built() const
+{
+	MiLockGuard lock(m_mtx);
+	return !m_vAll.empty();
+}
+
+void LazyPool::evict_idle()
+{
+	std::vector<void*> vEngines;
+	{
+		MiLockGuard lock(m_mtx);
+		if (m_vAll.empty() || m_bBuilding || m_vFree.size() != m_vAll.size()) return;
+		if (std::chrono::steady_clock::now() - m_lastUse < std::chrono::milliseconds(m_nIdleEvictMs)) return;
+		vEngines.swap(m_vAll);
+		m_vFree.clear();
+		//. a caller arriving now waits until the release below is done, then rebuilds.
+		m_bBuilding = true;
+	}
+	size_t n = vEngines.size();
+	m_release(vEngines);
+	{
+		MiLockGuard lock(m_mtx);
+		m_bBuilding = false;
+	}
+	m_cv.notify_all();
+	std::cout << "Engines " << m_strName << " : " << n << " released after " << m_nIdleEvictMs / 1000 << " s idle" << std::endl;
+}
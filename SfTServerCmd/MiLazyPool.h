@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MiLock.h"
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+//. Engine pools built on first use (detect.lazy, quality.lazy, device.gpu_lazy) : a
+//. deployment that never calls /api/detect, /api/quality or never sends a GPU-sized batch
+//. spends neither the memory nor the startup time of those engines.
+//. Single flight : the first acquire builds the whole pool (config + engines) outside the
+//. lock, concurrent callers wait for that build instead of starting their own. A failed
+//. build is not retried before GD_LAZY_RETRY_MS, the callers get its error meanwhile.
+//. Idle eviction : with p_nIdleEvictMs > 0 a pool nobody borrowed from for that long is
+//. released again (one reaper thread for all pools) and rebuilt by the next acquire.
+
+class LazyPool {
+public:
+	//. builds every engine of the pool; false with p_strErr leaves nothing allocated.
+	typedef std::function<bool(std::vector<void*>& p_vEngines, std::string& p_strErr)>	BuildFn;
+	//. destroys what BuildFn made.
+	typedef std::function<void(std::vector<void*>& p_vEngines)>						ReleaseFn;
+
+	LazyPool(const std::string& p_strName, BuildFn p_build, ReleaseFn p_release, int p_nIdleEvictMs);
+	~LazyPool();
+
+	//. eager pools : builds now (no-op when built).
+	bool build(std::string& p_strErr);
+	//. waits for a free engine, building the pool first if needed; NULL and p_strErr when it cannot be built.
+	void* acquire(std::string& p_strErr);
+	void release(void* p_pEngine);
+
+	bool built() const;
+	void evict_idle();
+
+private:
+	bool build_locked(MiUniqueLock& p_lock, std::string& p_strErr);
+
+	std::string								m_strName;
+	BuildFn									m_build;
+	ReleaseFn								m_release;
+	int										m_nIdleEvictMs;
+
+	mutable MI_MUTEX(m_mtx, "lazy_pool");
+	MiCondition								m_cv;
+	std::vector<void*>						m_vAll;
+	std::vector<void*>						m_vFree;
+	bool									m_bBuilding;
+	std::string								m_strErr;		//. last failed build
+	std::chrono::steady_clock::time_point	m_retryAt;
+	std::chrono::steady_clock::time_point	m_lastUse;
+};
+
+//. one engine of p_pool for the scope; get() is NULL when the pool could not be built.
+template <typename T>
+class LazyLease {
+public:
+	explicit LazyLease(LazyPool& p_pool) : m_pool(p_pool), m_pEngine((T*)p_pool.acquire(m_strErr)) {}
+	~LazyLease() { if (m_pEngine != NULL) m_pool.release(m_pEngine); }
+	T* get() const { return m_pEngine; }
+	const std::string& error() const { return m_strErr; }
+
+private:
+	LazyPool&	m_pool;
+	std::string	m_strErr;
+	T*			m_pEngine;
+};
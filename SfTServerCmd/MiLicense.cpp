@@ -0,0 +1,163 @@
+#include "MiLicense.h"
+#include "MiConf.h"
+#include "MiMetrics.h"
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+
+LicenseState g_License;
+
+static const char* lv_szStatus[MI_LICENSE_COUNT] = { "none", "valid", "grace", "expired" };
+
+const char* mi_license_status_name(int p_nStatus)
+{
+	return p_nStatus >= 0 && p_nStatus < MI_LICENSE_COUNT ? lv_szStatus[p_nStatus] : "unknown";
+}
+
+LicenseState::LicenseState()
+	: m_pStatus(std::make_shared<const std::string>("License not found")), m_nDeadlineMs(0), m_nStatus(MI_LICENSE_NONE),
+	m_nReadMs(0), m_nGoodMs(0), m_nFailures(0),
+	m_nMaxPollMs(GD_LICENSE_MAX_POLL_SEC * 1000), m_nBackoffMinMs(GD_LICENSE_BACKOFF_MIN_MS), m_nBackoffMaxMs(GD_LICENSE_BACKOFF_MAX_MS),
+	m_nGraceMs(GD_LICENSE_GRACE_SEC * 1000), m_bStop(false), m_bWake(false)
+{
+}
+
+LicenseState::~LicenseState()
+{
+	stop();
+}
+
+void LicenseState::publish(std::shared_ptr<const ST_RESPONSE> p_pSnap)
+{
+	uint64_t deadline = 0;
+	std::string strStatus = "License not found";
+	if (p_pSnap) {
+		INT64 expire = (INT64)p_pSnap->m_lExpire;
+		if (expire < GD_LICENSE_NO_LIMIT) {
+			//. valid through the second it expires at.
+			INT64 left = expire + 1 - (INT64)time(NULL);
+			deadline = left > 0 ? mi_tick_ms() + (uint64_t)left * 1000 : 0;
+
+			struct tm timeinfo;
+			mi_localtime((time_t)expire, &timeinfo);
+			char szTime[260]; memset(szTime, 0, sizeof(szTime));
+			strftime(szTime, sizeof(szTime), "License valid : %Y-%m-%d", &timeinfo);
+			strStatus = szTime;
+		}
+		else {
+			deadline = UINT64_MAX;
+			strStatus = "License valid : NO LIMIT";
+		}
+	}
+
+	std::atomic_store_explicit(&m_pSnap, p_pSnap, std::memory_order_release);
+	std::atomic_store_explicit(&m_pStatus, std::make_shared<const std::string>(strStatus), std::memory_order_release);
+	m_nDeadlineMs.store(deadline, std::memory_order_relaxed);
+}
+
+void LicenseState::set_status(int p_nStatus)
+{
+	if (m_nStatus.exchange(p_nStatus, std::memory_order_relaxed) == p_nStatus) return;
+	mi_metrics_license_status(p_nStatus);
+}
+
+bool LicenseState::refresh()
+{
+	std::shared_ptr<ST_RESPONSE> p = std::make_shared<ST_RESPONSE>();
+	memset(p.get(), 0, sizeof(ST_RESPONSE));
+	p->m_nProduct = GD_PRODUCT_LIVENESS_FACE;
+
+	auto start = std::chrono::steady_clock::now();
+	INT64 nSts = mil_read_license(p.get());
+	mi_metrics_license(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	m_nReadMs = mi_tick_ms();
+
+	if (nSts > 0) {
+		m_nFailures = 0;
+		m_nGoodMs = m_nReadMs;
+		publish(p);
+		set_status(m_nDeadlineMs.load(std::memory_order_relaxed) > m_nReadMs ? MI_LICENSE_VALID : MI_LICENSE_EXPIRED);
+		return true;
+	}
+
+	m_nFailures++;
+	if (snapshot() && m_nReadMs - m_nGoodMs < m_nGraceMs) {
+		//. keeps the last good license, it still stops at its own expiry.
+		set_status(MI_LICENSE_GRACE);
+		return false;
+	}
+	publish(std::shared_ptr<const ST_RESPONSE>());
+	set_status(MI_LICENSE_NONE);
+	return false;
+}
+
+uint64_t LicenseState::next_delay() const
+{
+	uint64_t delay = m_nMaxPollMs;
+	if (m_nFailures > 0) {
+		unsigned int shift = std::min(m_nFailures - 1, 20u);
+		delay = std::min<uint64_t>((uint64_t)m_nBackoffMinMs << shift, m_nBackoffMaxMs);
+		//. the last attempt of the grace window comes when it ends.
+		if (m_nStatus.load(std::memory_order_relaxed) == MI_LICENSE_GRACE) delay = std::min(delay, m_nGoodMs + m_nGraceMs - m_nReadMs);
+	}
+	else if (m_nStatus.load(std::memory_order_relaxed) == MI_LICENSE_VALID) {
+		//. re-read right when the license expires, a renewal is picked up then.
+		uint64_t deadline = m_nDeadlineMs.load(std::memory_order_relaxed);
+		if (deadline > m_nReadMs) delay = std::min(delay, deadline - m_nReadMs);
+	}
+	return std::max<uint64_t>(delay, m_nBackoffMinMs);
+}
+
+void LicenseState::start(unsigned int p_nMaxPollMs, unsigned int p_nBackoffMinMs, unsigned int p_nBackoffMaxMs, unsigned int p_nGraceMs)
+{
+	if (m_thread.joinable()) return;
+
+	m_nMaxPollMs = std::max(p_nMaxPollMs, 1000u);
+	m_nBackoffMinMs = std::max(p_nBackoffMinMs, 10u);
+	m_nBackoffMaxMs = std::max(p_nBackoffMaxMs, m_nBackoffMinMs);
+	m_nGraceMs = p_nGraceMs;
+	m_bStop = false;
+	m_thread = std::thread(&LicenseState::run, this);
+}
+
+void LicenseState::stop()
+{
+	{
+		MiLockGuard lock(m_mtx);
+		m_bStop = true;
+	}
+	m_cv.notify_all();
+	if (m_thread.joinable()) m_thread.join();
+}
+
+void LicenseState::wake()
+{
+	{
+		MiLockGuard lock(m_mtx);
+		//. every unlicensed request wakes, the refresher needs to hear it once.
+		if (m_bWake) return;
+		m_bWake = true;
+	}
+	m_cv.notify_all();
+}
+
+void LicenseState::run()
+{
+	MiUniqueLock lock(m_mtx);
+	while (!m_bStop) {
+		uint64_t due = m_nReadMs + next_delay();
+		if (m_bWake) due = std::min<uint64_t>(due, m_nReadMs + m_nBackoffMinMs);
+		uint64_t now = mi_tick_ms();
+		if (now < due) {
+			//. a wake or stop notifies, the due time is worked out again.
+			m_cv.wait_for(lock, std::chrono::milliseconds(due - now));
+			continue;
+		}
+		m_bWake = false;
+
+		lock.unlock();
+		refresh();
+		lock.lock();
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include "MiPlatform.h"
+#include "../cmn/MiKeyMgr.h"
+#include "MiLock.h"
+
+//. License state shared by the request threads.
+//. The refresher thread reads the license into a new immutable ST_RESPONSE and
+//. publishes it with one atomic store; readers never see a half-written record.
+//. Publishing also turns the expiry into a deadline on the monotonic tick (mi_tick_ms)
+//. and renders the /status text, so a request neither converts a wall-clock time nor
+//. formats a date : the check is one relaxed load against the tick. Every read
+//. derives the deadline again, which absorbs changes of the system clock.
+//. Reads follow the license instead of a fixed period ([license] settings) : a valid
+//. one is read again when it expires and at least every max_poll_sec, a failed read
+//. is retried after backoff_min_ms, doubling up to backoff_max_ms. A failed read keeps
+//. the last good license for grace_sec before requests get OnNoLicense, so a transient
+//. read error does not stop the traffic. Request wakes are honoured at most once per
+//. backoff_min_ms. mi_license_state and mi_license_transitions_total{state} are on
+//. GD_API_METRICS.
+
+enum LicenseStatus {
+	MI_LICENSE_NONE = 0,		//. no license could be read
+	MI_LICENSE_VALID,			//. read and not expired
+	MI_LICENSE_GRACE,			//. read failed, the last good license is kept
+	MI_LICENSE_EXPIRED,			//. read, but past its expiry
+	MI_LICENSE_COUNT
+};
+
+const char* mi_license_status_name(int p_nStatus);
+
+class LicenseState {
+public:
+	LicenseState();
+	~LicenseState();
+
+	//. reads the license once and publishes the result.
+	bool refresh();
+
+	//. starts / stops the background refresher, intervals in ms.
+	void start(unsigned int p_nMaxPollMs, unsigned int p_nBackoffMinMs, unsigned int p_nBackoffMaxMs, unsigned int p_nGraceMs);
+	void stop();
+
+	//. asks the refresher to re-read the license now instead of at the next poll.
+	void wake();
+
+	//. true while a license is installed and not expired.
+	bool valid() const { return mi_tick_ms() < m_nDeadlineMs.load(std::memory_order_relaxed); }
+
+	//. LicenseStatus of the last read.
+	int status_code() const { return m_nStatus.load(std::memory_order_relaxed); }
+
+	//. "License valid : ..." / "License not found", as /status answers.
+	std::shared_ptr<const std::string> status() const { return std::atomic_load_explicit(&m_pStatus, std::memory_order_acquire); }
+
+	//. current record, NULL when no license is installed.
+	std::shared_ptr<const ST_RESPONSE> snapshot() const { return std::atomic_load_explicit(&m_pSnap, std::memory_order_acquire); }
+
+private:
+	void run();
+	void publish(std::shared_ptr<const ST_RESPONSE> p_pSnap);
+	void set_status(int p_nStatus);
+	//. ms from the last read to the next one.
+	uint64_t next_delay() const;
+
+	std::shared_ptr<const ST_RESPONSE>	m_pSnap;
+	std::shared_ptr<const std::string>	m_pStatus;
+	std::atomic<uint64_t>				m_nDeadlineMs;		//. mi_tick_ms the license expires at, 0 = none
+	std::atomic<int>					m_nStatus;
+
+	//. written by refresh only, i.e. by launch before start and then by the refresher.
+	uint64_t					m_nReadMs;			//. last read
+	uint64_t					m_nGoodMs;			//. last successful read
+	unsigned int				m_nFailures;		//. failed reads in a row
+
+	unsigned int				m_nMaxPollMs;
+	unsigned int				m_nBackoffMinMs;
+	unsigned int				m_nBackoffMaxMs;
+	unsigned int				m_nGraceMs;
+	bool						m_bStop;
+	bool						m_bWake;
+	MI_MUTEX(m_mtx, "license");
+	MiCondition					m_cv;
+	std::thread					m_thread;
+};
+
+extern LicenseState g_License;
@@ -0,0 +1,167 @@
+#include "MiLimiter.h"
+#include "MiConf.h"
+#include "MiLock.h"
+#include <chrono>
+#include <math.h>
+#include <thread>
+
+using namespace std::chrono;
+
+struct LimiterState {
+	MI_MUTEX(mtx, "limiter");
+	MiCondition					cv;
+	int							nMin;
+	int							nMax;
+	int							nLimit;
+	int							nInflight;
+	unsigned long long			nTicket;		//. handed to the next waiter
+	unsigned long long			nServing;		//. waiter allowed to take the next permit
+	long long					nWindowUs;
+	long long					tWindowStart;
+	double						sumUs;
+	long long					nSamples;
+	long long					minUs;
+	int							maxInflight;	//. busiest moment of the window
+	long long					noLoadUs;
+	unsigned long long			nOversubscribed;
+};
+
+static LimiterState*	lv_pState = NULL;
+
+static long long now_us()
+{
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void mi_limiter_init(int p_nMin, int p_nMax, int p_nInitial, int p_nWindowMs)
+{
+	int cores = (int)std::thread::hardware_concurrency();
+	if (cores <= 0) cores = 1;
+	LimiterState* s = new LimiterState;
+	s->nMin = p_nMin > 0 ? p_nMin : 1;
+	s->nMax = p_nMax > 0 ? p_nMax : cores;
+	if (s->nMax < s->nMin) s->nMax = s->nMin;
+	s->nLimit = p_nInitial > 0 ? p_nInitial : (cores / 4 > s->nMin ? cores / 4 : s->nMin);
+	if (s->nLimit < s->nMin) s->nLimit = s->nMin;
+	if (s->nLimit > s->nMax) s->nLimit = s->nMax;
+	s->nInflight = 0;
+	s->nTicket = 0;
+	s->nServing = 0;
+	s->nWindowUs = (long long)(p_nWindowMs > 0 ? p_nWindowMs : GD_LIMITER_WINDOW_MS) * 1000;
+	s->tWindowStart = now_us();
+	s->sumUs = 0;
+	s->nSamples = 0;
+	s->minUs = 0;
+	s->maxInflight = 0;
+	s->noLoadUs = 0;
+	s->nOversubscribed = 0;
+	lv_pState = s;
+}
+
+int mi_limiter_limit()
+{
+	LimiterState* s = lv_pState;
+	if (s == NULL) return 0;
+	MiLockGuard lock(s->mtx);
+	return s->nLimit;
+}
+
+int mi_limiter_inflight()
+{
+	LimiterState* s = lv_pState;
+	if (s == NULL) return 0;
+	MiLockGuard lock(s->mtx);
+	return s->nInflight;
+}
+
+int mi_limiter_waiting()
+{
+	LimiterState* s = lv_pState;
+	if (s == NULL) return 0;
+	MiLockGuard lock(s->mtx);
+	return (int)(s->nTicket - s->nServing);
+}
+
+long long mi_limiter_noload_us()
+{
+	LimiterState* s = lv_pState;
+	if (s == NULL) return 0;
+	MiLockGuard lock(s->mtx);
+	return s->noLoadUs;
+}
+
+unsigned long long mi_limiter_oversubscribed()
+{
+	LimiterState* s = lv_pState;
+	if (s == NULL) return 0;
+	MiLockGuard lock(s->mtx);
+	return s->nOversubscribed;
+}
+
+//. end of a window : moves the limit by the calls queued inside the SDK section. Under s->mtx.
+static void update_limit(LimiterState* s, long long p_tNow)
+{
+	double avgUs = s->sumUs / (double)s->nSamples;
+	//. the no-load time only falls at once; it rises 1/256 per window so a slower SDK
+	//. generation (reload, thermal throttling) is not read as queueing for ever.
+	if (s->noLoadUs == 0 || s->minUs < s->noLoadUs) s->noLoadUs = s->minUs;
+	else s->noLoadUs += (s->minUs - s->noLoadUs + 255) / 256;
+
+	double lg = log10((double)s->nLimit);
+	double alpha = lg > 1 ? lg : 1;
+	double beta = 2 * lg > 2 ? 2 * lg : 2;
+	double queue = avgUs > 0 ? s->nLimit * (1.0 - (double)s->noLoadUs / avgUs) : 0;
+
+	int nOld = s->nLimit;
+	if (queue > beta) {
+		if (s->nLimit > s->nMin) s->nLimit--;
+		s->nOversubscribed++;
+	}
+	else if (queue < alpha && s->maxInflight * 2 >= s->nLimit && s->nLimit < s->nMax) {
+		s->nLimit++;
+	}
+	s->tWindowStart = p_tNow;
+	s->sumUs = 0;
+	s->nSamples = 0;
+	s->minUs = 0;
+	s->maxInflight = s->nInflight;
+	if (s->nLimit > nOld) s->cv.notify_all();
+}
+
+LimitScope::LimitScope(size_t p_nImages)
+	: m_bActive(lv_pState != NULL)
+	, m_nImages(p_nImages > 0 ? p_nImages : 1)
+	, m_nStartUs(0)
+{
+	if (!m_bActive) return;
+	LimiterState* s = lv_pState;
+	MiUniqueLock lock(s->mtx);
+	if (s->nTicket != s->nServing || s->nInflight >= s->nLimit) {
+		unsigned long long ticket = s->nTicket++;
+		s->cv.wait(lock, [s, ticket] { return s->nServing == ticket && s->nInflight < s->nLimit; });
+		s->nServing++;
+		//. the next waiter may fit as well.
+		s->cv.notify_all();
+	}
+	s->nInflight++;
+	if (s->nInflight > s->maxInflight) s->maxInflight = s->nInflight;
+	lock.unlock();
+	m_nStartUs = now_us();
+}
+
+LimitScope::~LimitScope()
+{
+	if (!m_bActive) return;
+	long long tNow = now_us();
+	long long us = (tNow - m_nStartUs) / (long long)m_nImages;
+	LimiterState* s = lv_pState;
+	{
+		MiLockGuard lock(s->mtx);
+		s->nInflight--;
+		s->sumUs += (double)us;
+		s->nSamples++;
+		if (s->minUs == 0 || us < s->minUs) s->minUs = us > 0 ? us : 1;
+		if (tNow - s->tWindowStart >= s->nWindowUs && s->nSamples >= GD_LIMITER_MIN_SAMPLES) update_limit(s, tNow);
+	}
+	s->cv.notify_all();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+//. Adaptive limit of the pipeline calls in flight ([limiter] settings), Vegas style.
+//. Every call records its latency; each window_ms the shortest latency seen (the
+//. no-load time, drifting up slowly so it follows the SDK data) is set against the
+//. window's average. Their ratio says how many calls the SDK section queues inside
+//. itself : fewer than alpha (log10 limit, at least 1) raises the limit by one, more than
+//. beta (twice that) lowers it and counts as an oversubscribed window. The limit thus
+//. settles at the knee where more parallel calls only add latency; callers above it
+//. wait for a permit (the Poco / worker threads stay where they are), earlier calls
+//. first. A window whose busiest moment used less than half the limit does not raise it.
+//. Bounded by [min_limit, max_limit], max_limit defaulting to the core count.
+//. mi_limiter_* on /metrics.
+
+//. until this has run LimitScope does nothing ([limiter] enable = false).
+//. p_nMax <= 0 = cores, p_nInitial <= 0 = the larger of p_nMin and a quarter of the cores.
+void mi_limiter_init(int p_nMin, int p_nMax, int p_nInitial, int p_nWindowMs);
+
+int mi_limiter_limit();
+int mi_limiter_inflight();
+int mi_limiter_waiting();
+long long mi_limiter_noload_us();			//. 0 until the first window
+unsigned long long mi_limiter_oversubscribed();	//. windows that lowered the limit
+
+//. permit for one pipeline call of p_nImages images, the latency recorded per image.
+class LimitScope {
+public:
+	explicit LimitScope(size_t p_nImages = 1);
+	~LimitScope();
+
+private:
+	LimitScope(const LimitScope&) = delete;
+	LimitScope& operator=(const LimitScope&) = delete;
+
+	bool		m_bActive;
+	size_t		m_nImages;
+	long long	m_nStartUs;
+};
@@ -0,0 +1,117 @@
+#include "MiLock.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string.h>
+
+#if GD_LOCK_PROFILE
+//. one LockStats per name, never freed : the locks point into it.
+static std::mutex				lv_mtxRegistry;
+static std::deque<LockStats>	lv_dqStats;
+
+static uint64_t lock_now_ns()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static LockStats* lock_register(const char* p_pszName)
+{
+	std::lock_guard<std::mutex> lock(lv_mtxRegistry);
+	for (LockStats& s : lv_dqStats) {
+		if (s.name == p_pszName) return &s;
+	}
+	lv_dqStats.emplace_back();
+	lv_dqStats.back().name = p_pszName;
+	return &lv_dqStats.back();
+}
+
+MiMutex::MiMutex(const char* p_pszName)
+	: m_pStats(lock_register(p_pszName))
+{
+}
+
+void MiMutex::lock()
+{
+	if (!m_mtx.try_lock()) {
+		uint64_t nStart = lock_now_ns();
+		m_mtx.lock();
+		m_nAcquiredNs = lock_now_ns();
+		uint64_t nWait = m_nAcquiredNs - nStart;
+		m_pStats->contended.fetch_add(1, std::memory_order_relaxed);
+		m_pStats->waitNs.fetch_add(nWait, std::memory_order_relaxed);
+		uint64_t nMax = m_pStats->maxWaitNs.load(std::memory_order_relaxed);
+		while (nWait > nMax && !m_pStats->maxWaitNs.compare_exchange_weak(nMax, nWait, std::memory_order_relaxed)) {}
+	}
+	else {
+		m_nAcquiredNs = lock_now_ns();
+	}
+	m_pStats->acquired.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool MiMutex::try_lock()
+{
+	if (!m_mtx.try_lock()) return false;
+	m_nAcquiredNs = lock_now_ns();
+	m_pStats->acquired.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void MiMutex::unlock()
+{
+	uint64_t nHold = lock_now_ns() - m_nAcquiredNs;
+	m_mtx.unlock();
+	m_pStats->holdNs.fetch_add(nHold, std::memory_order_relaxed);
+}
+
+bool mi_lock_profiling()
+{
+	return true;
+}
+
+void mi_lock_snapshot(std::vector<LockSnapshot>& p_vOut)
+{
+	p_vOut.clear();
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxRegistry);
+		for (const LockStats& s : lv_dqStats) {
+			LockSnapshot snap;
+			snap.name = s.name;
+			snap.acquired = s.acquired.load(std::memory_order_relaxed);
+			snap.contended = s.contended.load(std::memory_order_relaxed);
+			snap.waitNs = s.waitNs.load(std::memory_order_relaxed);
+			snap.holdNs = s.holdNs.load(std::memory_order_relaxed);
+			snap.maxWaitNs = s.maxWaitNs.load(std::memory_order_relaxed);
+			p_vOut.push_back(snap);
+		}
+	}
+	std::sort(p_vOut.begin(), p_vOut.end(), [](const LockSnapshot& a, const LockSnapshot& b) {
+		return a.waitNs != b.waitNs ? a.waitNs > b.waitNs : strcmp(a.name.c_str(), b.name.c_str()) < 0;
+	});
+}
+
+void mi_lock_reset()
+{
+	std::lock_guard<std::mutex> lock(lv_mtxRegistry);
+	for (LockStats& s : lv_dqStats) {
+		s.acquired = 0;
+		s.contended = 0;
+		s.waitNs = 0;
+		s.holdNs = 0;
+		s.maxWaitNs = 0;
+	}
+}
+#else
+bool mi_lock_profiling()
+{
+	return false;
+}
+
+void mi_lock_snapshot(std::vector<LockSnapshot>& p_vOut)
+{
+	p_vOut.clear();
+}
+
+void mi_lock_reset()
+{
+}
+#endif
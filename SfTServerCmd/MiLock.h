@@ -0,0 +1,79 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+//. Locks of the request path, declared with a name :
+//.     static MI_MUTEX(lv_mtx, "gate");        MI_MUTEX(m_mtx, "batcher");
+//.     MiLockGuard lock(lv_mtx);   MiUniqueLock lock(m_mtx);   MiCondition m_cv;
+//. A release build (GD_LOCK_PROFILE 0) compiles them to std::mutex, std::lock_guard,
+//. std::unique_lock and std::condition_variable : the name is dropped, nothing is counted.
+//.
+//. Lock profiling (GD_LOCK_PROFILE, cmake -DMI_LOCK_PROFILE=ON) : MiMutex counts, per name,
+//. the acquisitions, the contended ones (the lock was held by another thread), the time spent
+//. waiting for it and the time it was held, and the longest wait. Every lock of one name adds
+//. to the same figures (the shards of a MiShardedMap, the states of every limiter) and the
+//. figures outlive the locks. GD_API_LOCKS shows them, the most waited for first. A contended
+//. acquisition costs two clock reads more than std::mutex, every release one; the condition
+//. variables become std::condition_variable_any, and a wait on one ends a hold and starts a
+//. new one (contended if it had to wait for the lock again after the notify).
+
+#ifndef GD_LOCK_PROFILE
+#define GD_LOCK_PROFILE		0
+#endif
+
+struct LockStats
+{
+	std::string				name;
+	std::atomic<uint64_t>	acquired{ 0 };
+	std::atomic<uint64_t>	contended{ 0 };
+	std::atomic<uint64_t>	waitNs{ 0 };
+	std::atomic<uint64_t>	holdNs{ 0 };
+	std::atomic<uint64_t>	maxWaitNs{ 0 };
+};
+
+struct LockSnapshot
+{
+	std::string	name;
+	uint64_t	acquired, contended, waitNs, holdNs, maxWaitNs;
+};
+
+#if GD_LOCK_PROFILE
+class MiMutex
+{
+public:
+	explicit MiMutex(const char* p_pszName);
+	MiMutex(const MiMutex&) = delete;
+	MiMutex& operator=(const MiMutex&) = delete;
+
+	void lock();
+	bool try_lock();
+	void unlock();
+
+private:
+	std::mutex		m_mtx;
+	LockStats*		m_pStats;
+	//. only touched by the owner.
+	uint64_t		m_nAcquiredNs = 0;
+};
+
+typedef std::condition_variable_any	MiCondition;
+#define MI_MUTEX(var, name)			MiMutex var{ name }
+#else
+typedef std::mutex					MiMutex;
+typedef std::condition_variable		MiCondition;
+#define MI_MUTEX(var, name)			std::mutex var
+#endif
+
+typedef std::lock_guard<MiMutex>	MiLockGuard;
+typedef std::unique_lock<MiMutex>	MiUniqueLock;
+
+//. true when the build counts (GD_LOCK_PROFILE).
+bool mi_lock_profiling();
+//. every named lock seen since start (or the last reset), most waited for first; empty when not counting.
+void mi_lock_snapshot(std::vector<LockSnapshot>& p_vOut);
+void mi_lock_reset();
@@ -0,0 +1,126 @@
+#include "MiMemBudget.h"
+#include "MiConf.h"
+#include "MiImageInfo.h"
+#include "MiLock.h"
+#include <atomic>
+
+static size_t					lv_nCapacity = 0;		//. 0 = off
+static size_t					lv_nUsed = 0;
+static std::atomic<size_t>		lv_nUsedSeen(0);		//. lv_nUsed for the metrics, read without the lock
+static std::atomic<size_t>		lv_nPeak(0);
+static std::atomic<int>			lv_nWaiting(0);
+static unsigned long long		lv_nNextTicket = 0;
+static unsigned long long		lv_nServing = 0;		//. ticket allowed to take the next share
+static MI_MUTEX(lv_mtx, "memory_budget");
+static MiCondition				lv_cv;
+
+void mi_membudget_init(size_t p_nBytes)
+{
+	lv_nCapacity = p_nBytes;
+}
+
+bool mi_membudget_enabled()
+{
+	return lv_nCapacity > 0;
+}
+
+size_t mi_membudget_capacity()
+{
+	return lv_nCapacity;
+}
+
+size_t mi_membudget_used()
+{
+	return lv_nUsedSeen.load(std::memory_order_relaxed);
+}
+
+size_t mi_membudget_peak()
+{
+	return lv_nPeak.load(std::memory_order_relaxed);
+}
+
+int mi_membudget_waiting()
+{
+	return lv_nWaiting.load(std::memory_order_relaxed);
+}
+
+size_t mi_membudget_estimate(const uint8_t* p_pData, size_t p_nLen)
+{
+	ImageInfo info;
+	if (mi_image_info(p_pData, p_nLen, info)) return (size_t)info.width * (size_t)info.height * 3;
+	return p_nLen * GD_MEMORY_UNKNOWN_RATIO;
+}
+
+MemoryPermit::MemoryPermit(size_t p_nBytes) : m_nBytes(0)
+{
+	if (lv_nCapacity == 0 || p_nBytes == 0) return;
+	m_nBytes = p_nBytes < lv_nCapacity ? p_nBytes : lv_nCapacity;
+
+	//. tickets keep the order of arrival, a large image is not starved by small ones.
+	MiUniqueLock lock(lv_mtx);
+	unsigned long long nTicket = lv_nNextTicket++;
+	if (nTicket != lv_nServing || lv_nUsed + m_nBytes > lv_nCapacity) {
+		lv_nWaiting.fetch_add(1, std::memory_order_relaxed);
+		lv_cv.wait(lock, [&] { return nTicket == lv_nServing && lv_nUsed + m_nBytes <= lv_nCapacity; });
+		lv_nWaiting.fetch_sub(1, std::memory_order_relaxed);
+	}
+	lv_nServing++;
+	lv_nUsed += m_nBytes;
+	lv_nUsedSeen.store(lv_nUsed, std::memory_order_relaxed);
+	if (lv_nUsed > lv_nPeak.load(std::memory_order_relaxed)) lv_nPeak.store(lv_nUsed, std::memory_order_relaxed);
+	lock.unlock();
+	//. the next ticket may fit as well.
+	lv_cv.notify_all();
+}
+
+void MemoryPermit::release()
+{
+	if (m_nBytes == 0) return;
+	{
+		MiLockGuard lock(lv_mtx);
+		lv_nUsed -= m_nBytes;
+		lv_nUsedSeen.store(lv_nUsed, std::memory_order_relaxed);
+	}
+	m_nBytes = 0;
+	lv_cv.notify_all();
+}
+
+class BudgetBackend : public InferenceBackend {
+public:
+	explicit BudgetBackend(InferenceBackend* p_pInner) : m_pInner(p_pInner) {}
+	~BudgetBackend() { delete m_pInner; }
+
+	const char* name() const override { return m_pInner->name(); }
+
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		MemoryPermit permit(mi_membudget_estimate(p_pData, p_nLen));
+		return m_pInner->check(p_pData, p_nLen, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	//. the caller's pixels exist already, the permit covers the SDK's copy.
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		MemoryPermit permit((size_t)p_nWidth * (size_t)p_nHeight * 3);
+		return m_pInner->check_pixels(p_pPixels, p_nWidth, p_nHeight, p_encoding, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override
+	{
+		size_t nBytes = 0;
+		for (const std::string* pData : p_vData) nBytes += mi_membudget_estimate((const uint8_t*)pData->data(), pData->size());
+		MemoryPermit permit(nBytes);
+		m_pInner->check_batch(p_vData, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+	}
+
+	void warm_up(int p_nIterations) override { m_pInner->warm_up(p_nIterations); }
+	BackendRuntime runtime() const override { return m_pInner->runtime(); }
+
+private:
+	InferenceBackend*	m_pInner;
+};
+
+InferenceBackend* mi_membudget_backend(InferenceBackend* p_pInner)
+{
+	return new BudgetBackend(p_pInner);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "MiBackend.h"
+
+//. Budget of decoded images alive at once ([memory] budget_mb). Every decode takes a
+//. permit weighted by the pixels its upload will become (width * height * 3 from the
+//. encoded header, MiImageInfo.h) and waits, first come first served, until that much of
+//. the budget is free; an image larger than the whole budget runs alone. The engines
+//. decode inside InferenceBackend calls, so the budget wraps g_pBackend; the endpoints
+//. that decode through the SDK themselves (analyze, detect, quality, sequence) take
+//. their permits around image_create_* / image_destroy.
+//. Used, peak and waiting are exported on GD_API_METRICS.
+
+void mi_membudget_init(size_t p_nBytes);
+bool mi_membudget_enabled();
+
+size_t mi_membudget_capacity();
+size_t mi_membudget_used();
+size_t mi_membudget_peak();
+int mi_membudget_waiting();
+
+//. decoded bytes of one encoded upload; p_nLen * GD_MEMORY_UNKNOWN_RATIO when the header is not understood.
+size_t mi_membudget_estimate(const uint8_t* p_pData, size_t p_nLen);
+
+//. RAII share of the budget; no-op while the budget is off.
+class MemoryPermit {
+public:
+	explicit MemoryPermit(size_t p_nBytes);
+	~MemoryPermit() { release(); }
+
+	void release();
+
+private:
+	MemoryPermit(const MemoryPermit&) = delete;
+	MemoryPermit& operator=(const MemoryPermit&) = delete;
+
+	size_t	m_nBytes;		//. 0 once released
+};
+
+//. p_pInner with every check under a MemoryPermit; takes ownership.
+InferenceBackend* mi_membudget_backend(InferenceBackend* p_pInner);
@@ -0,0 +1,130 @@
+#include "MiMeta.h"
+#include "MiConf.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/URI.h"
+#include <map>
+
+static CMeta_t						lv_metas[MI_META_COUNT];
+static bool							lv_bReady = false;
+static const CMeta_t*				lv_pDefault = NULL;
+static std::map<std::string, const CMeta_t*>	lv_mapTenants;		//. X-Api-Key -> entry
+
+static const char* lv_szCalibrations[] = { "regular", "soft", "hardened" };
+static const char* lv_szOses[] = { "android", "ios", "desktop", "unknown" };
+
+static int find_name(const std::string& p_strName, const char** p_ppszNames, int p_nCount)
+{
+	for (int i = 0; i < p_nCount; i++) {
+		if (Poco::icompare(p_strName, p_ppszNames[i]) == 0) return i;
+	}
+	return -2;
+}
+
+bool mi_meta_parse(const std::string& p_strSpec, int* p_pCalibration, int* p_pOs)
+{
+	*p_pCalibration = -1;
+	*p_pOs = -1;
+	std::string strSpec = Poco::trim(p_strSpec);
+	size_t slash = strSpec.find('/');
+	std::string strCal = Poco::trim(strSpec.substr(0, slash));
+	std::string strOs = slash == std::string::npos ? "" : Poco::trim(strSpec.substr(slash + 1));
+	if (!strCal.empty() && (*p_pCalibration = find_name(strCal, lv_szCalibrations, 3)) < -1) return false;
+	if (!strOs.empty() && (*p_pOs = find_name(strOs, lv_szOses, 4)) < -1) return false;
+	return true;
+}
+
+void mi_meta_init(const std::string& p_strDefault, const std::string& p_strTenants)
+{
+	CMeta_t base = face_sdk_api().get_default_meta();
+	for (int c = 0; c < MI_META_CALIBRATIONS; c++) {
+		for (int o = 0; o < MI_META_OSES; o++) {
+			CMeta_t& m = lv_metas[c * MI_META_OSES + o];
+			m = base;
+			if (c > 0) m.calibration = (CALIBRATION_t)(c - 1);
+			if (o > 0) m.os = (OS_t)(o - 1);
+		}
+	}
+	lv_bReady = true;
+
+	int cal, os;
+	lv_pDefault = mi_meta_parse(p_strDefault, &cal, &os) ? mi_meta_get(cal, os) : NULL;
+
+	//. "key=soft, key2=hardened/ios"
+	lv_mapTenants.clear();
+	Poco::StringTokenizer tok(p_strTenants, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : tok) {
+		size_t eq = item.find('=');
+		if (eq == std::string::npos) continue;
+		if (mi_meta_parse(item.substr(eq + 1), &cal, &os)) lv_mapTenants[Poco::trim(item.substr(0, eq))] = mi_meta_get(cal, os);
+	}
+}
+
+const CMeta_t* mi_meta_get(int p_nCalibration, int p_nOs)
+{
+	if (!lv_bReady || (p_nCalibration < 0 && p_nOs < 0)) return NULL;
+	if (p_nCalibration >= MI_META_CALIBRATIONS - 1 || p_nOs >= MI_META_OSES - 1) return NULL;
+	return &lv_metas[(p_nCalibration + 1) * MI_META_OSES + (p_nOs + 1)];
+}
+
+int mi_meta_index(const CMeta_t* p_pMeta)
+{
+	return p_pMeta == NULL ? 0 : (int)(p_pMeta - lv_metas);
+}
+
+const CMeta_t* mi_meta_at(int p_nIndex)
+{
+	if (!lv_bReady || p_nIndex <= 0 || p_nIndex >= MI_META_COUNT) return NULL;
+	return &lv_metas[p_nIndex];
+}
+
+//. soft < regular < hardened; the pipeline default (-1) is regular.
+static int strictness(int p_nCalibration)
+{
+	switch (p_nCalibration) {
+	case SOFT: return 0;
+	case HARDENED: return 2;
+	default: return 1;
+	}
+}
+
+const CMeta_t* mi_meta_override(const CMeta_t* p_pBase, int p_nCalibration, int p_nOs)
+{
+	int index = mi_meta_index(p_pBase);
+	int cal = index / MI_META_OSES - 1;
+	int os = index % MI_META_OSES - 1;
+	if (p_nCalibration >= 0 && strictness(p_nCalibration) > strictness(cal)) cal = p_nCalibration;
+	if (p_nOs >= 0 && os < 0) os = p_nOs;
+	return mi_meta_get(cal, os);
+}
+
+const CMeta_t* mi_meta_default()
+{
+	return lv_pDefault;
+}
+
+const CMeta_t* mi_meta_of(const Poco::Net::HTTPRequest& p_request)
+{
+	const CMeta_t* pBase = lv_pDefault;
+	if (!lv_mapTenants.empty()) {
+		const std::string& key = p_request.get(GD_LANE_KEY_HEADER, Poco::Net::HTTPMessage::EMPTY);
+		auto it = key.empty() ? lv_mapTenants.end() : lv_mapTenants.find(key);
+		if (it != lv_mapTenants.end()) pBase = it->second;
+	}
+
+	std::string strCal = p_request.get(GD_META_CALIBRATION_HEADER, Poco::Net::HTTPMessage::EMPTY);
+	std::string strOs = p_request.get(GD_META_OS_HEADER, Poco::Net::HTTPMessage::EMPTY);
+	const std::string& uri = p_request.getURI();
+	if (uri.find('?') != std::string::npos) {
+		Poco::URI::QueryParameters params = Poco::URI(uri).getQueryParameters();
+		for (size_t i = 0; i < params.size(); i++) {
+			if (params[i].first == "calibration") strCal = params[i].second;
+			else if (params[i].first == "os") strOs = params[i].second;
+		}
+	}
+	if (!strCal.empty() || !strOs.empty()) {
+		int cal, os;
+		if (mi_meta_parse(strCal + "/" + strOs, &cal, &os)) return mi_meta_override(pBase, cal, os);
+	}
+	return pBase;
+}
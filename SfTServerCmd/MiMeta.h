@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include "FaceSdkApi.h"
+#include "Poco/Net/HTTPRequest.h"
+
+//. Calibration meta per request ([meta]). Every calibration / os combination is built
+//. once by mi_meta_init from get_default_meta() and never changes afterwards, so a
+//. request only carries a pointer into that table : no CMeta_t is built per request
+//. and the micro-batcher groups its batches by pointer.
+//. A request gets the entry of its X-Api-Key in meta.tenants, else meta.default. The client
+//. may tighten it with GD_META_CALIBRATION_HEADER / GD_META_OS_HEADER (or ?calibration= /
+//. ?os=) but not loosen it : a calibration only when stricter (soft < regular < hardened, the
+//. pipeline default counting as regular), an os only when the tenant's entry leaves it open.
+//. The entry for "no override" is NULL, the pipeline then uses its own defaults.
+
+//. -1 = default of the value, then the CALIBRATION_t / OS_t values.
+#define MI_META_CALIBRATIONS	4
+#define MI_META_OSES			5
+#define MI_META_COUNT			(MI_META_CALIBRATIONS * MI_META_OSES)
+
+//. after the SDK dll is loaded. p_strDefault / p_strTenants : see IDLiveFaceCmd.ini [meta].
+void mi_meta_init(const std::string& p_strDefault, const std::string& p_strTenants);
+
+//. "soft", "hardened/ios", "/android" ... false on an unknown name; missing parts stay -1.
+bool mi_meta_parse(const std::string& p_strSpec, int* p_pCalibration, int* p_pOs);
+
+//. prebuilt entry, NULL when both are -1 (or mi_meta_init has not run).
+const CMeta_t* mi_meta_get(int p_nCalibration, int p_nOs);
+
+//. position of a prebuilt entry in the table, 0 for NULL.
+int mi_meta_index(const CMeta_t* p_pMeta);
+//. entry at a position from mi_meta_index (NULL for 0 or out of range).
+const CMeta_t* mi_meta_at(int p_nIndex);
+
+//. entry for a request, see above. Unknown header values fall back to the tenant / default.
+const CMeta_t* mi_meta_of(const Poco::Net::HTTPRequest& p_request);
+
+//. p_pBase with a client's calibration / os (-1 = none) applied where they may, see above.
+const CMeta_t* mi_meta_override(const CMeta_t* p_pBase, int p_nCalibration, int p_nOs);
+//. meta.default.
+const CMeta_t* mi_meta_default();
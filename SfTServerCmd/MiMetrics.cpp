@@ -0,0 +1,1175 @@
+#include "MiMetrics.h"
+#include "FaceSdkApi.h"
+#include "MiAudit.h"
+#include "MiBatcher.h"
+#include "MiBrownout.h"
+#include "MiCamera.h"
+#include "MiCapture.h"
+#include "MiCluster.h"
+#include "MiCodecs.h"
+#include "MiConnection.h"
+#include "MiContext.h"
+#include "MiCores.h"
+#include "MiDedup.h"
+#include "MiDevice.h"
+#include "MiExecutor.h"
+#include "MiFetch.h"
+#include "MiHealth.h"
+#include "MiIdle.h"
+#include "MiLicense.h"
+#include "MiLimiter.h"
+#include "MiStages.h"
+#include "MiStartup.h"
+#include "MiStats.h"
+#include "MiMemBudget.h"
+#include "MiModelMap.h"
+#include "MiOtlp.h"
+#include "MiPhash.h"
+#include "MiPrefilter.h"
+#include "MiPipelinePool.h"
+#include "MiPrecision.h"
+#include "MiProactorServer.h"
+#include "MiProgressive.h"
+#include "MiReactorServer.h"
+#include "MiSaturation.h"
+#include "MiSession.h"
+#include "MiTls.h"
+#include "MiPixelPool.h"
+#include "MiPlatform.h"
+#include "MiSdkCall.h"
+#include "MiShadow.h"
+#include "MiStream.h"
+#include "MiSupervisor.h"
+#include "MiTenants.h"
+#include "MiVerdict.h"
+#include "MiWatchdog.h"
+#include "Poco/Prometheus/CallbackMetric.h"
+#include "Poco/Prometheus/Counter.h"
+#include "Poco/Prometheus/Gauge.h"
+#include "Poco/Prometheus/Histogram.h"
+#include "Poco/Prometheus/MetricsRequestHandler.h"
+#include "Poco/Prometheus/ProcessCollector.h"
+#include "Poco/NumberFormatter.h"
+#include <array>
+#include <atomic>
+
+using namespace Poco::Prometheus;
+
+static const char* lv_szStages[MI_STAGE_COUNT] = { "ingest", "image_create", "liveness", "serialize", "send", "crop", "gate", "decode", "compress", "analyze", "detect", "quality", "convert", "prefilter" };
+static const char* lv_szRejects[MI_REJECT_COUNT] = { "overload", "expired" };
+static const char* lv_szCancels[MI_CANCEL_COUNT] = { "admission", "dispatch", "batch" };
+static const char* lv_szEndpoints[MI_EP_COUNT] = { "check_liveness", "check_liveness_base64", "check_liveness_batch", "check_liveness_sequence", "check_liveness_pixels", "binary", "stream", "jobs", "shm", "analyze", "detect", "quality", "session", "check_liveness_raw", "check_liveness_url", "check_liveness_burst", "check_liveness_faces", "check_onboarding", "check_liveness_video" };
+
+#define LD_STATUS_COUNT	(EYES_CLOSED + 1)
+
+//. a sample name of a core metric, handed to the exporter only (not registered).
+class MetricPart : public Metric {
+public:
+	MetricPart(Type p_type, const std::string& p_strName, const std::string& p_strHelp = std::string()) : Metric(p_type, p_strName, nullptr)
+	{
+		if (!p_strHelp.empty()) setHelp(p_strHelp);
+	}
+	void exportTo(Exporter&) const override {}
+};
+
+//. histogram recorded by the statistics core (MiStats.h), one series per label value.
+class CoreHistogram : public Metric {
+public:
+	CoreHistogram(const std::string& p_strName, const std::string& p_strHelp, const std::string& p_strLabel, MiStatsGroup p_group, const std::vector<std::string>& p_vValues)
+		: Metric(Type::HISTOGRAM, p_strName), m_bucket(Type::HISTOGRAM, p_strName + "_bucket"), m_sum(Type::HISTOGRAM, p_strName + "_sum"),
+		m_count(Type::HISTOGRAM, p_strName + "_count"), m_strLabel(p_strLabel), m_group(p_group), m_vValues(p_vValues)
+	{
+		setHelp(p_strHelp);
+		int nBounds = 0;
+		const double* pBounds = mi_stats_bounds(&nBounds);
+		for (int i = 0; i < nBounds; i++) m_vBounds.push_back(Poco::NumberFormatter::format(pBounds[i]));
+		m_vBounds.push_back("+Inf");
+	}
+	void exportTo(Exporter& p_exporter) const override
+	{
+		const std::vector<std::string> vBucketLabels = { m_strLabel, "le" }, vLabels = { m_strLabel };
+		StatsHistogram h;
+		p_exporter.writeHeader(*this);
+		for (size_t i = 0; i < m_vValues.size(); i++) {
+			mi_stats_histogram(m_group, (int)i, h);
+			for (size_t b = 0; b < m_vBounds.size(); b++) p_exporter.writeSample(m_bucket, vBucketLabels, { m_vValues[i], m_vBounds[b] }, (Poco::UInt64)h.le[b]);
+			p_exporter.writeSample(m_sum, vLabels, { m_vValues[i] }, h.sum);
+			p_exporter.writeSample(m_count, vLabels, { m_vValues[i] }, (Poco::UInt64)h.count);
+		}
+	}
+
+private:
+	MetricPart					m_bucket, m_sum, m_count;
+	std::string					m_strLabel;
+	MiStatsGroup				m_group;
+	std::vector<std::string>	m_vValues;
+	std::vector<std::string>	m_vBounds;
+};
+
+//. counters recorded by the statistics core, one core counter per label set; the exported
+//. value is the count times p_dScale. p_bSeenOnly leaves out the label sets still at 0.
+class CoreCounter : public Metric {
+public:
+	CoreCounter(const std::string& p_strName, const std::string& p_strHelp, const std::vector<std::string>& p_vLabels,
+		const std::vector<std::vector<std::string>>& p_vValues, double p_dScale = 1.0, bool p_bSeenOnly = false)
+		: Metric(Type::COUNTER, p_strName), m_vLabels(p_vLabels), m_vValues(p_vValues), m_dScale(p_dScale), m_bSeenOnly(p_bSeenOnly)
+	{
+		setHelp(p_strHelp);
+		m_nFirst = mi_stats_counters((int)p_vValues.size());
+	}
+	//. core counter of label set p_n, -1 (mi_stats_add ignores it) when the core ran out.
+	int id(int p_n) const { return m_nFirst < 0 ? -1 : m_nFirst + p_n; }
+	void exportTo(Exporter& p_exporter) const override
+	{
+		p_exporter.writeHeader(*this);
+		for (size_t i = 0; i < m_vValues.size(); i++) {
+			uint64_t n = mi_stats_counter(id((int)i));
+			if (m_bSeenOnly && n == 0) continue;
+			p_exporter.writeSample(*this, m_vLabels, m_vValues[i], (double)n * m_dScale);
+		}
+	}
+
+private:
+	std::vector<std::string>				m_vLabels;
+	std::vector<std::vector<std::string>>	m_vValues;
+	double									m_dScale;
+	bool									m_bSeenOnly;
+	int										m_nFirst;
+};
+
+//. startup phases and milestones (MiStartup.h), read at export : phases end after mi_metrics_init.
+class StartupMetric : public Metric {
+public:
+	StartupMetric()
+		: Metric(Type::GAUGE, "mi_startup_phase_seconds"), m_milestones(Type::GAUGE, "mi_startup_seconds", "Time from process start to listen, ready and the first answered request"),
+		m_model(Type::GAUGE, "mi_startup_model_bytes", "Model files on disk, their resident pages mapped shared with the other workers, and the resident set, once the engines are built")
+	{
+		setHelp("Time spent in each startup phase");
+	}
+	void exportTo(Exporter& p_exporter) const override
+	{
+		StartupTimes times;
+		mi_startup_times(times);
+		const std::vector<std::string> vPhase = { "phase" }, vMilestone = { "milestone" };
+		p_exporter.writeHeader(*this);
+		for (size_t i = 0; i < times.phases.size(); i++) p_exporter.writeSample(*this, vPhase, { times.phases[i].first }, times.phases[i].second);
+		p_exporter.writeHeader(m_milestones);
+		if (times.listen >= 0) p_exporter.writeSample(m_milestones, vMilestone, { "listen" }, times.listen);
+		if (times.ready >= 0) p_exporter.writeSample(m_milestones, vMilestone, { "ready" }, times.ready);
+		if (times.firstInference >= 0) p_exporter.writeSample(m_milestones, vMilestone, { "first_inference" }, times.firstInference);
+		MiModelMapStats model = mi_model_map_stats();
+		if (!model.measured) return;
+		const std::vector<std::string> vKind = { "kind" };
+		p_exporter.writeHeader(m_model);
+		p_exporter.writeSample(m_model, vKind, { "disk" }, (double)model.diskBytes);
+		p_exporter.writeSample(m_model, vKind, { "shared" }, (double)model.sharedBytes);
+		p_exporter.writeSample(m_model, vKind, { "resident" }, (double)model.rss);
+	}
+
+private:
+	MetricPart	m_milestones;
+	MetricPart	m_model;
+};
+
+//. mi_saturation and its two terms, see MiSaturation.h.
+class SaturationMetric : public Metric {
+public:
+	SaturationMetric()
+		: Metric(Type::GAUGE, "mi_saturation"), m_utilization(Type::GAUGE, "mi_saturation_utilization", "Busy share of the inference slots, smoothed"),
+		m_queueWait(Type::GAUGE, "mi_saturation_queue_wait_seconds", "Estimated queue wait of a new inference request, smoothed")
+	{
+		setHelp("Utilization of the inference slots plus the estimated queue wait over the SLO, the autoscaling signal");
+	}
+	void exportTo(Exporter& p_exporter) const override
+	{
+		if (!mi_saturation_enabled()) return;
+		SaturationSample sample;
+		mi_saturation_get(sample);
+		const std::vector<std::string> vNone;
+		p_exporter.writeHeader(*this);
+		p_exporter.writeSample(*this, vNone, vNone, sample.saturation);
+		p_exporter.writeHeader(m_utilization);
+		p_exporter.writeSample(m_utilization, vNone, vNone, sample.utilization);
+		p_exporter.writeHeader(m_queueWait);
+		p_exporter.writeSample(m_queueWait, vNone, vNone, sample.queueWaitMs / 1000);
+	}
+
+private:
+	MetricPart	m_utilization;
+	MetricPart	m_queueWait;
+};
+
+static std::vector<std::string> label_values(const char* const* p_pszNames, int p_nCount)
+{
+	return std::vector<std::string>(p_pszNames, p_pszNames + p_nCount);
+}
+
+struct TenantCostSamples {
+	CounterSample*								decode;
+	CounterSample*								infer;
+	CounterSample*								bytes;
+	std::array<CounterSample*, MI_STAGE_COUNT>	stages;
+};
+
+struct MiMetrics {
+	CoreHistogram*		request;
+	CoreHistogram*		stage;
+	CoreCounter*		stageCpu;			//. microseconds
+	StartupMetric*		startup;
+	SaturationMetric*	saturation;
+	Histogram*			license;
+	Gauge*				licenseStatus;
+	Counter*			licenseTransitions;
+	CounterSample*		licenseTransitionsSample[MI_LICENSE_COUNT];
+	CoreCounter*		status;				//. last = out of range
+	Counter*			rejected;
+	Counter*			cancelled;
+	Counter*			gated;
+	Counter*			prefiltered;
+	Counter*			prefilterAgreement;
+	Counter*			decoded;
+	Counter*			upright;
+	Counter*			decodeFormats;
+	Counter*			watchdogTimeouts;
+	Counter*			degraded;
+	Counter*			compressed;
+	Counter*			streamDropped;
+	Counter*			ingestPauses;
+	CallbackIntGauge*	ingestBytes;
+	CallbackIntGauge*	ingestPaused;
+	Counter*			accessDropped;
+	Counter*			coalesced;
+	Counter*			auditDropped;
+	Counter*			tenant;
+	Counter*			tenantDecode;
+	Counter*			tenantInfer;
+	Counter*			tenantBytes;
+	Counter*			tenantStages;
+	Counter*			deviceBusy;
+	Counter*			deviceCalls;
+	Counter*			batchBucketCalls;
+	Counter*			batchPadded;
+	Counter*			batchDuplicates;
+	CounterSample*		batchDuplicatesSample[MI_DEDUP_COUNT];
+	Gauge*				deviceInflight;
+	ProcessCollector*	process;
+
+	CoreHistogram*		sdkCall;
+	//. [call][status, last = out of range] at call * (LD_STATUS_COUNT + 1) + status; only the pairs seen are exported.
+	CoreCounter*		sdkCalls;
+	CounterSample*		rejectedSample[MI_REJECT_COUNT];
+	CounterSample*		cancelledSample[MI_CANCEL_COUNT];
+	CounterSample*		gatedSample[MI_GATE_COUNT];
+	CounterSample*		prefilteredSample[MI_PREFILTER_COUNT];
+	CounterSample*		prefilterAgreementSample[2][MI_PREFILTER_SDK_COUNT];		//. pass, reject
+	Counter*			phash;
+	CounterSample*		phashSample[MI_PHASH_COUNT];
+	CallbackIntGauge*	phashEntries;
+	Counter*			shadow;
+	CounterSample*		shadowSample[3];			//. agree, disagree, dropped
+	Histogram*			shadowDuration;
+	HistogramSample*	shadowDurationSample[2];	//. primary, shadow
+	CallbackIntGauge*	shadowQueued;
+	CoreCounter*		verdicts;
+	CoreCounter*		imageDecodes;		//. first, repeat
+	Counter*			uncertain;
+	CounterSample*		uncertainSample[2];			//. reported, rechecked
+	Counter*			cascade;
+	CounterSample*		cascadeSample[2];			//. accepted, escalated
+	Counter*			cascadeSeconds;
+	CounterSample*		cascadeSecondsSample[2];	//. saved, spent
+	Histogram*			cascadeDuration;
+	HistogramSample*	cascadeDurationSample[2];	//. first, full
+	Counter*			progressive;
+	CounterSample*		progressiveSample[MI_PROGRESSIVE_COUNT];
+	Counter*			sessionEvents;
+	CounterSample*		sessionEventsSample[MI_SESSION_COUNT];
+	CallbackIntGauge*	sessionActive;
+	CallbackIntGauge*	sessionBytes;
+	Counter*			burstFrames;
+	CounterSample*		burstFramesSample[2];		//. checked, skipped
+	Counter*			faces;
+	CounterSample*		facesSample[2];				//. checked, dropped
+	Counter*			onboardOverlap;
+	Counter*			videoFrames;
+	CounterSample*		videoFramesSample[2];		//. key, delta
+	Counter*			cameraFrames;
+	CounterSample*		cameraFramesSample[MI_CAMERA_COUNT];
+	CallbackIntGauge*	cameraConnected;
+	Counter*			precision;
+	std::vector<CounterSample*>	precisionSample;	//. by mi_precision_modes index
+	Counter*			fetch;
+	CounterSample*		fetchSample[MI_FETCH_COUNT];
+	CallbackIntCounter*	fetchConnections;
+	CallbackIntGauge*	fetchIdle;
+	Counter*			tlsHandshakes;
+	CounterSample*		tlsHandshakesSample[MI_TLS_COUNT];
+	Histogram*			tlsDuration;
+	HistogramSample*	tlsDurationSample[MI_TLS_COUNT];
+	Counter*			healthSelftests;
+	CounterSample*		healthSelftestsSample[MI_HEALTH_SELFTEST_COUNT];
+	Counter*			generationChecks;
+	CounterSample*		generationChecksSample[2][3];	//. [current, canary][ok, rejected, error]
+	Histogram*			generationDuration;
+	HistogramSample*	generationDurationSample[2];
+	CallbackIntGauge*	canaryGeneration;
+	CallbackIntGauge*	canaryPercent;
+	CounterSample*		decodedSample[4];			//. 1/2, 1/4, 1/8, other
+	CounterSample*		uprightSample[9];			//. by EXIF orientation, 2 .. 8 used
+	CounterSample*		decodeFormatSample[MI_CODEC_COUNT][2];	//. [format][ok, error]
+	CounterSample*		watchdogTimeoutSample[MI_WATCH_COUNT];
+	CounterSample*		degradedSample[MI_DEGRADE_COUNT];
+	CounterSample*		compressedSample[2];		//. in, out
+	CounterSample*		deviceBusySample[MI_DEVICE_COUNT];
+	CounterSample*		deviceCallsSample[MI_DEVICE_COUNT];
+	GaugeSample*		deviceInflightSample[MI_DEVICE_COUNT];
+	Gauge*				stageQueue;
+	GaugeSample*		stageQueueSample[MI_PIPE_COUNT];
+	std::vector<std::array<CounterSample*, MI_TENANT_RESULT_COUNT>>	tenantSample;	//. [0] = unknown key, then by tenant
+	std::vector<TenantCostSamples>	tenantCostSample;	//. [0] = none, then by tenant
+	std::vector<std::pair<int, CounterSample*>>	batchBucketSample;	//. by bucket size
+
+	CallbackIntGauge*	httpQueued;
+	CallbackIntGauge*	httpConnections;
+	CallbackIntGauge*	httpThreads;
+	CallbackIntCounter*	httpRefused;
+	CallbackIntCounter*	httpAccepted;
+	CallbackIntGauge*	httpMaxThreads;
+	Histogram*			httpAcceptWait;
+	CallbackIntGauge*	generation;
+	CallbackIntGauge*	decodePeak;
+	CallbackIntGauge*	streams;
+	CallbackIntGauge*	memoryBudget;
+	CallbackIntGauge*	memoryUsed;
+	CallbackIntGauge*	memoryPeak;
+	CallbackIntGauge*	memoryWaiting;
+	CallbackIntGauge*	auditQueued;
+	CallbackIntGauge*	executorThreads;
+	CallbackIntCounter*	executorSteals;
+	CallbackIntGauge*	limiterLimit;
+	CallbackIntGauge*	limiterInflight;
+	CallbackIntGauge*	limiterWaiting;
+	CallbackIntGauge*	limiterNoLoad;
+	CallbackIntCounter*	limiterOversubscribed;
+	CallbackIntGauge*	pixelPoolBytes;
+	CallbackIntCounter*	pixelPoolHits;
+	CallbackIntCounter*	pixelPoolMisses;
+	CallbackIntCounter*	clusterErrors;
+	CallbackIntCounter*	captureRecords;
+	CallbackIntCounter*	captureDropped;
+	CallbackIntCounter*	otlpExported;
+	CallbackIntCounter*	otlpDropped;
+	CallbackIntCounter*	otlpFailed;
+	CallbackIntGauge*	pixelPoolLarge;
+	CallbackIntGauge*	pixelPoolThp;
+	CallbackIntGauge*	peakRss;
+	CallbackIntGauge*	rss;
+	CallbackIntGauge*	heapAllocated;
+	CallbackIntGauge*	heapFree;
+	CallbackIntGauge*	handles;
+	CallbackIntGauge*	brownoutActive;
+	CallbackIntCounter*	brownoutEntries;
+	CallbackIntGauge*	idleTrimmed;
+	CallbackIntCounter*	idleTrims;
+	CallbackIntGauge*	idleReleased;
+	CallbackIntGauge*	idleRestore;
+	CallbackIntGauge*	idleWakeRequest;
+	CallbackIntGauge*	poolParked;
+	CallbackIntGauge*	poolActive;
+	CallbackIntGauge*	poolSpares;
+	CallbackIntCounter*	poolGrows;
+	CallbackIntCounter*	poolShrinks;
+	CallbackIntGauge*	proactorConnections;
+	CallbackIntGauge*	batchWindow;
+	CallbackIntGauge*	batchTarget;
+	CallbackIntGauge*	batchRate;
+	CallbackIntGauge*	batchP99;
+	CallbackIntGauge*	poolInstanceRss;
+	CallbackIntCounter*	watchdogReplaced;
+	CallbackIntGauge*	watchdogAbandoned;
+	Gauge*				backendInfo;
+	Gauge*				cores;
+	Gauge*				backendRuntime;
+};
+
+static MiMetrics* lv_pMetrics = NULL;
+static bool lv_bStageCpu = false;
+static std::atomic<const Poco::Net::TCPServer*> lv_pServers[MI_LISTENERS_MAX];
+static std::atomic<size_t> lv_nDecodePeak(0);
+
+static int server_value(int (Poco::Net::TCPServer::*p_fn)() const)
+{
+	int n = 0;
+	for (int i = 0; i < MI_LISTENERS_MAX; i++) {
+		const Poco::Net::TCPServer* p = lv_pServers[i].load(std::memory_order_acquire);
+		if (p != NULL) n += (p->*p_fn)();
+	}
+	return n;
+}
+
+//. [0] "none", then one label set per tenant.
+static void tenant_cost_samples(const std::vector<std::string>& p_vNames)
+{
+	lv_pMetrics->tenantCostSample.clear();
+	for (size_t i = 0; i <= p_vNames.size(); i++) {
+		const std::string& name = i == 0 ? std::string("none") : p_vNames[i - 1];
+		TenantCostSamples s;
+		s.decode = &lv_pMetrics->tenantDecode->labels({ name });
+		s.infer = &lv_pMetrics->tenantInfer->labels({ name });
+		s.bytes = &lv_pMetrics->tenantBytes->labels({ name });
+		for (int st = 0; st < MI_STAGE_COUNT; st++) s.stages[st] = &lv_pMetrics->tenantStages->labels({ name, lv_szStages[st] });
+		lv_pMetrics->tenantCostSample.push_back(s);
+	}
+}
+
+void mi_metrics_init(bool p_bStageCpu)
+{
+	if (lv_pMetrics != NULL) return;
+
+	//. seconds, 1 ms .. 10 s : the bounds of the core histograms.
+	int nBounds = 0;
+	const double* pBounds = mi_stats_bounds(&nBounds);
+	const std::vector<double> buckets(pBounds, pBounds + nBounds);
+
+	//. the per-request series are recorded by the statistics core, without a shared lock.
+	MiMetrics* m = new MiMetrics;
+	m->request = new CoreHistogram("mi_request_duration_seconds", "Handler time of liveness API requests", "endpoint", MI_STATS_ENDPOINT,
+		label_values(lv_szEndpoints, MI_EP_COUNT));
+	m->stage = new CoreHistogram("mi_stage_duration_seconds", "Time spent per request stage", "stage", MI_STATS_STAGE, label_values(lv_szStages, MI_STAGE_COUNT));
+	m->license = new Histogram("mi_license_check_duration_seconds");
+	m->license->help("License file read and validation time").buckets(buckets);
+	m->licenseStatus = new Gauge("mi_license_state");
+	m->licenseStatus->help("License state : 0 none, 1 valid, 2 grace, 3 expired");
+	m->licenseStatus->set((double)g_License.status_code());
+	m->licenseTransitions = new Counter("mi_license_transitions_total");
+	m->licenseTransitions->help("License state changes by the state entered").labelNames({ "state" });
+	for (int i = 0; i < MI_LICENSE_COUNT; i++) m->licenseTransitionsSample[i] = &m->licenseTransitions->labels({ mi_license_status_name(i) });
+	std::vector<std::vector<std::string>> vStatus, vCalls;
+	for (int s = 0; s <= LD_STATUS_COUNT; s++) vStatus.push_back({ s < LD_STATUS_COUNT ? face_sdk_status_name(s) : "OTHER" });
+	m->status = new CoreCounter("mi_sdk_status_total", "FaceSDK results by STATUS code", { "status" }, vStatus);
+	std::vector<std::string> vCallNames;
+	for (int c = 0; c < MI_SDK_CALL_COUNT; c++) {
+		vCallNames.push_back(mi_sdk_call_name(c));
+		for (int s = 0; s <= LD_STATUS_COUNT; s++) vCalls.push_back({ mi_sdk_call_name(c), vStatus[s][0] });
+	}
+	m->sdkCall = new CoreHistogram("mi_sdk_call_duration_seconds", "Time of the FaceSDK calls on the request path", "call", MI_STATS_SDK_CALL, vCallNames);
+	m->sdkCalls = new CoreCounter("mi_sdk_calls_total", "FaceSDK call outcomes by entry point and STATUS code", { "call", "status" }, vCalls, 1.0, true);
+	m->rejected = new Counter("mi_admission_rejected_total");
+	m->rejected->help("Inference requests answered with 503 by admission control").labelNames({ "reason" });
+	m->cancelled = new Counter("mi_cancelled_total");
+	m->cancelled->help("Requests whose work was dropped because the client had disconnected").labelNames({ "at" });
+	m->gated = new Counter("mi_gate_rejected_total");
+	m->gated->help("Images rejected before liveness by the detection / quality gate").labelNames({ "stage" });
+	m->prefiltered = new Counter("mi_prefilter_images_total");
+	m->prefiltered->help("Images judged by the blur / darkness prefilter, audited rejections included").labelNames({ "result" });
+	m->prefilterAgreement = new Counter("mi_prefilter_agreement_total");
+	m->prefilterAgreement->help("Prefiltered images also checked by the SDK, by both answers").labelNames({ "prefilter", "sdk" });
+	m->decoded = new Counter("mi_decode_scaled_total");
+	m->decoded->help("JPEG uploads decoded at a reduced DCT scale").labelNames({ "scale" });
+	m->upright = new Counter("mi_decode_upright_total");
+	m->upright->help("Decoded uploads turned upright from their EXIF orientation").labelNames({ "orientation" });
+	m->decodeFormats = new Counter("mi_decode_formats_total");
+	m->decodeFormats->help("Uploads in a format the SDK does not read, decoded by the server ([decode] formats)").labelNames({ "format", "result" });
+	m->watchdogTimeouts = new Counter("mi_watchdog_timeouts_total");
+	m->watchdogTimeouts->help("Requests that ran out of a [watchdog] stage limit").labelNames({ "stage" });
+	m->degraded = new Counter("mi_degraded_total");
+	m->degraded->help("Optional steps skipped because the request was short of its deadline, or served in brownout").labelNames({ "step" });
+	m->compressed = new Counter("mi_response_compress_bytes_total");
+	m->compressed->help("Response body bytes before (in) and after (out) compression").labelNames({ "direction" });
+	m->streamDropped = new Counter("mi_stream_dropped_frames_total");
+	m->streamDropped->help("WebSocket frames replaced by a newer frame before they were checked");
+	m->ingestPauses = new Counter("mi_ingest_pauses_total");
+	m->ingestPauses->help("Times the reactors stopped reading new requests at the ingest high-water mark");
+	m->ingestBytes = new CallbackIntGauge("mi_ingest_bytes", "Request bodies held by the reactors (receiving, queued, being checked)",
+		[]() { return (Poco::Int64)mi_reactor_ingest_bytes(); });
+	m->ingestPaused = new CallbackIntGauge("mi_ingest_paused_connections", "Connections whose reads are paused by ingest flow control",
+		[]() { return (Poco::Int64)mi_reactor_paused(); });
+	m->accessDropped = new Counter("mi_access_log_dropped_total");
+	m->accessDropped->help("Access log records dropped because the writer fell behind");
+	m->coalesced = new Counter("mi_coalesced_requests_total");
+	m->coalesced->help("Requests answered with the outcome of an identical upload already being checked");
+	m->auditDropped = new Counter("mi_audit_dropped_total");
+	m->auditDropped->help("Audit rows dropped because the queue was full (database slow or unreachable)");
+	m->tenant = new Counter("mi_tenant_requests_total");
+	m->tenant->help("Inference requests per tenant and admission result").labelNames({ "tenant", "result" });
+	m->tenantDecode = new Counter("mi_tenant_decode_cpu_seconds_total");
+	m->tenantDecode->help("Thread CPU spent decoding the uploads of each tenant").labelNames({ "tenant" });
+	m->tenantInfer = new Counter("mi_tenant_inference_seconds_total");
+	m->tenantInfer->help("SDK inference time charged to each tenant, batches split per image").labelNames({ "tenant" });
+	m->tenantBytes = new Counter("mi_tenant_bytes_total");
+	m->tenantBytes->help("Declared upload bytes of each tenant").labelNames({ "tenant" });
+	m->tenantStages = new Counter("mi_tenant_stage_requests_total");
+	m->tenantStages->help("Requests of each tenant that ran a stage").labelNames({ "tenant", "stage" });
+	m->deviceBusy = new Counter("mi_device_busy_seconds_total");
+	m->deviceBusy->help("Time spent in checks per inference device, rate / pipelines = utilization").labelNames({ "device" });
+	m->deviceCalls = new Counter("mi_device_calls_total");
+	m->deviceCalls->help("Checks (single images or batches) per inference device").labelNames({ "device" });
+	m->batchBucketCalls = new Counter("mi_batch_bucket_calls_total");
+	m->batchBucketCalls->help("Micro-batch SDK calls per [batch] buckets shape").labelNames({ "size" });
+	m->batchPadded = new Counter("mi_batch_padded_images_total");
+	m->batchPadded->help("Repeated images added to fill micro-batch calls up to a bucket size");
+	m->batchDuplicates = new Counter("mi_batch_duplicates_total");
+	m->batchDuplicates->help("Images of a batch answered from an identical image of the same batch ([batch] dedup)").labelNames({ "path" });
+	for (int i = 0; i < MI_DEDUP_COUNT; i++) m->batchDuplicatesSample[i] = &m->batchDuplicates->labels({ mi_dedup_path_name(i) });
+	m->deviceInflight = new Gauge("mi_device_inflight");
+	m->deviceInflight->help("Checks running or waiting per inference device").labelNames({ "device" });
+	m->process = new ProcessCollector();
+	m->startup = new StartupMetric();
+	m->saturation = new SaturationMetric();
+
+	std::vector<std::vector<std::string>> vStages;
+	for (int i = 0; i < MI_STAGE_COUNT; i++) vStages.push_back({ lv_szStages[i] });
+	m->stageCpu = new CoreCounter("mi_stage_cpu_seconds_total", "Thread CPU time spent per request stage", { "stage" }, vStages, 1e-6);
+	for (int i = 0; i < MI_REJECT_COUNT; i++) m->rejectedSample[i] = &m->rejected->labels({ lv_szRejects[i] });
+	for (int i = 0; i < MI_CANCEL_COUNT; i++) m->cancelledSample[i] = &m->cancelled->labels({ lv_szCancels[i] });
+	for (int i = 0; i < MI_GATE_COUNT; i++) m->gatedSample[i] = &m->gated->labels({ mi_gate_stage_name((GateStage)i) });
+	for (int i = 0; i < MI_PREFILTER_COUNT; i++) m->prefilteredSample[i] = &m->prefiltered->labels({ mi_prefilter_outcome_name(i) });
+	for (int i = 0; i < MI_PREFILTER_SDK_COUNT; i++) {
+		m->prefilterAgreementSample[0][i] = &m->prefilterAgreement->labels({ "pass", mi_prefilter_sdk_name(i) });
+		m->prefilterAgreementSample[1][i] = &m->prefilterAgreement->labels({ "reject", mi_prefilter_sdk_name(i) });
+	}
+	m->phash = new Counter("mi_phash_lookups_total");
+	m->phash->help("Face crops looked up in the near-duplicate index").labelNames({ "result" });
+	for (int i = 0; i < MI_PHASH_COUNT; i++) m->phashSample[i] = &m->phash->labels({ mi_phash_outcome_name(i) });
+	m->phashEntries = new CallbackIntGauge("mi_phash_entries", "Face crop hashes in the near-duplicate index",
+		[]() { return (Poco::Int64)mi_phash_entries(); });
+	m->shadow = new Counter("mi_shadow_checks_total");
+	m->shadow->help("Images replayed on the shadow engine by verdict agreement, and dropped samples").labelNames({ "result" });
+	m->shadowSample[0] = &m->shadow->labels({ "agree" });
+	m->shadowSample[1] = &m->shadow->labels({ "disagree" });
+	m->shadowSample[2] = &m->shadow->labels({ "dropped" });
+	m->shadowDuration = new Histogram("mi_shadow_duration_seconds");
+	m->shadowDuration->help("Time of the sampled calls on the primary and the shadow engine").labelNames({ "pipeline" }).buckets(buckets);
+	m->shadowDurationSample[0] = &m->shadowDuration->labels({ "primary" });
+	m->shadowDurationSample[1] = &m->shadowDuration->labels({ "shadow" });
+	m->shadowQueued = new CallbackIntGauge("mi_shadow_queued", "Samples waiting for the shadow engine",
+		[]() { return (Poco::Int64)mi_shadow_queued(); });
+	std::vector<std::vector<std::string>> vVerdicts;
+	for (int i = 0; i < MI_VERDICT_COUNT; i++) vVerdicts.push_back({ mi_verdict_name(i) });
+	m->verdicts = new CoreCounter("mi_verdicts_total", "Answered images by verdict", { "verdict" }, vVerdicts);
+	m->imageDecodes = new CoreCounter("mi_image_decodes_total", "Uploads decoded, repeat = decoded again within the same request",
+		{ "decode" }, { { "first" }, { "repeat" } });
+	m->uncertain = new Counter("mi_verdict_uncertain_total");
+	m->uncertain->help("Liveness answers within the uncertain band : answered as is, or sequences fused again").labelNames({ "action" });
+	m->uncertainSample[0] = &m->uncertain->labels({ "reported" });
+	m->uncertainSample[1] = &m->uncertain->labels({ "rechecked" });
+	m->cascade = new Counter("mi_cascade_checks_total");
+	m->cascade->help("Images answered by the first-pass cascade pipeline, or escalated to the main one").labelNames({ "result" });
+	m->cascadeSample[0] = &m->cascade->labels({ "accepted" });
+	m->cascadeSample[1] = &m->cascade->labels({ "escalated" });
+	m->cascadeSeconds = new Counter("mi_cascade_seconds_total");
+	m->cascadeSeconds->help("Estimated main-pipeline time saved on accepted images, and first-pass time spent on escalated ones").labelNames({ "kind" });
+	m->cascadeSecondsSample[0] = &m->cascadeSeconds->labels({ "saved" });
+	m->cascadeSecondsSample[1] = &m->cascadeSeconds->labels({ "spent" });
+	m->cascadeDuration = new Histogram("mi_cascade_duration_seconds");
+	m->cascadeDuration->help("Time of the cascade passes").labelNames({ "pass" }).buckets(buckets);
+	m->cascadeDurationSample[0] = &m->cascadeDuration->labels({ "first" });
+	m->cascadeDurationSample[1] = &m->cascadeDuration->labels({ "full" });
+	m->progressive = new Counter("mi_progressive_uploads_total");
+	m->progressive->help("Uploads whose JPEG decode started while the body was received, by outcome").labelNames({ "result" });
+	for (int i = 0; i < MI_PROGRESSIVE_COUNT; i++) m->progressiveSample[i] = &m->progressive->labels({ mi_progressive_outcome_name(i) });
+	m->sessionEvents = new Counter("mi_session_events_total");
+	m->sessionEvents->help("Multi-frame session store : frames stored, sessions fused, expired, evicted, frames slid out").labelNames({ "event" });
+	for (int i = 0; i < MI_SESSION_COUNT; i++) m->sessionEventsSample[i] = &m->sessionEvents->labels({ mi_session_event_name(i) });
+	m->sessionActive = new CallbackIntGauge("mi_session_active", "Multi-frame sessions holding frames",
+		[]() { return (Poco::Int64)(g_pSessionStore != NULL ? g_pSessionStore->sessions() : 0); });
+	m->sessionBytes = new CallbackIntGauge("mi_session_bytes", "Decoded frames held by the session store",
+		[]() { return (Poco::Int64)(g_pSessionStore != NULL ? g_pSessionStore->bytes() : 0); });
+	m->burstFrames = new Counter("mi_burst_frames_total");
+	m->burstFrames->help("Burst frames checked for liveness after quality ranking, or skipped").labelNames({ "outcome" });
+	m->burstFramesSample[0] = &m->burstFrames->labels({ "checked" });
+	m->burstFramesSample[1] = &m->burstFrames->labels({ "skipped" });
+	m->faces = new Counter("mi_faces_total");
+	m->faces->help("Faces of group photos checked for liveness in one batch, or dropped past faces.max_faces").labelNames({ "outcome" });
+	m->facesSample[0] = &m->faces->labels({ "checked" });
+	m->facesSample[1] = &m->faces->labels({ "dropped" });
+	m->onboardOverlap = new Counter("mi_onboard_overlap_seconds_total");
+	m->onboardOverlap->help("Time onboarding requests saved by checking the selfie and the ID portrait side by side");
+	m->videoFrames = new Counter("mi_video_frames_total");
+	m->videoFrames->help("Frames decoded from video uploads, key frames or the frames between them").labelNames({ "kind" });
+	m->videoFramesSample[0] = &m->videoFrames->labels({ "key" });
+	m->videoFramesSample[1] = &m->videoFrames->labels({ "delta" });
+	m->cameraFrames = new Counter("mi_camera_frames_total");
+	m->cameraFrames->help("Frames read from pulled camera streams : dropped between looks, screened out by the prefilter or the quality gate, checked").labelNames({ "outcome" });
+	for (int i = 0; i < MI_CAMERA_COUNT; i++) m->cameraFramesSample[i] = &m->cameraFrames->labels({ mi_camera_outcome_name(i) });
+	m->cameraConnected = new CallbackIntGauge("mi_camera_connected", "Pulled camera streams open right now",
+		[]() { return (Poco::Int64)mi_camera_connected(); });
+	m->precision = new Counter("mi_precision_checks_total");
+	m->precision->help("Checks answered by each precision pool, main = the tenants not routed").labelNames({ "mode" });
+	for (const std::string& mode : mi_precision_modes()) m->precisionSample.push_back(&m->precision->labels({ mode }));
+	m->fetch = new Counter("mi_fetch_total");
+	m->fetch->help("Images fetched from a URL for check_liveness_url, by result").labelNames({ "result" });
+	for (int i = 0; i < MI_FETCH_COUNT; i++) m->fetchSample[i] = &m->fetch->labels({ mi_fetch_result_name(i) });
+	m->fetchConnections = new CallbackIntCounter("mi_fetch_connections_total", "Connections opened to fetch images, the other fetches reused a kept one",
+		[]() { return (Poco::UInt64)mi_fetch_connections(); });
+	m->fetchIdle = new CallbackIntGauge("mi_fetch_idle_connections", "Fetch connections kept alive for reuse",
+		[]() { return (Poco::Int64)mi_fetch_idle(); });
+	m->tlsHandshakes = new Counter("mi_tls_handshakes_total");
+	m->tlsHandshakes->help("TLS handshakes on tls.port, full, resumed from a ticket / the session cache, or failed").labelNames({ "result" });
+	m->tlsDuration = new Histogram("mi_tls_handshake_duration_seconds");
+	m->tlsDuration->help("Server time of the TLS handshakes").labelNames({ "result" }).buckets(buckets);
+	for (int i = 0; i < MI_TLS_COUNT; i++) {
+		m->tlsHandshakesSample[i] = &m->tlsHandshakes->labels({ mi_tls_outcome_name(i) });
+		m->tlsDurationSample[i] = &m->tlsDuration->labels({ mi_tls_outcome_name(i) });
+	}
+	m->healthSelftests = new Counter("mi_health_selftests_total");
+	m->healthSelftests->help("Background self-tests behind /health, passed, failed or skipped for recent traffic").labelNames({ "result" });
+	for (int i = 0; i < MI_HEALTH_SELFTEST_COUNT; i++) m->healthSelftestsSample[i] = &m->healthSelftests->labels({ mi_health_selftest_name(i) });
+	m->generationChecks = new Counter("mi_generation_checks_total");
+	m->generationChecks->help("Images checked per pipeline generation role, by outcome").labelNames({ "role", "result" });
+	m->generationDuration = new Histogram("mi_generation_duration_seconds");
+	m->generationDuration->help("Liveness call time per pipeline generation role").labelNames({ "role" }).buckets(buckets);
+	for (int r = 0; r < 2; r++) {
+		const char* pszRole = r == 0 ? "current" : "canary";
+		m->generationChecksSample[r][0] = &m->generationChecks->labels({ pszRole, "ok" });
+		m->generationChecksSample[r][1] = &m->generationChecks->labels({ pszRole, "rejected" });
+		m->generationChecksSample[r][2] = &m->generationChecks->labels({ pszRole, "error" });
+		m->generationDurationSample[r] = &m->generationDuration->labels({ pszRole });
+	}
+	m->canaryGeneration = new CallbackIntGauge("mi_canary_generation", "Pipeline generation running as canary, 0 = none",
+		[]() { return (Poco::Int64)g_Supervisor.canary_generation(); });
+	m->canaryPercent = new CallbackIntGauge("mi_canary_percent", "Share of the checks routed to the canary generation",
+		[]() { return (Poco::Int64)g_Supervisor.canary_percent(); });
+	const char* szScales[4] = { "1/2", "1/4", "1/8", "other" };
+	for (int i = 0; i < 4; i++) m->decodedSample[i] = &m->decoded->labels({ szScales[i] });
+	m->uprightSample[0] = m->uprightSample[1] = NULL;
+	for (int i = 2; i <= 8; i++) m->uprightSample[i] = &m->upright->labels({ std::to_string(i) });
+	for (int i = 0; i < MI_CODEC_COUNT; i++) {
+		m->decodeFormatSample[i][0] = &m->decodeFormats->labels({ mi_codec_name(i), "ok" });
+		m->decodeFormatSample[i][1] = &m->decodeFormats->labels({ mi_codec_name(i), "error" });
+	}
+	for (int i = 0; i < MI_WATCH_COUNT; i++) m->watchdogTimeoutSample[i] = &m->watchdogTimeouts->labels({ mi_watch_stage_name(i) });
+	for (int i = 0; i < MI_DEGRADE_COUNT; i++) m->degradedSample[i] = &m->degraded->labels({ mi_degrade_step_name(i) });
+	m->compressedSample[0] = &m->compressed->labels({ "in" });
+	m->compressedSample[1] = &m->compressed->labels({ "out" });
+	for (int i = 0; i < MI_DEVICE_COUNT; i++) {
+		m->deviceBusySample[i] = &m->deviceBusy->labels({ mi_device_name((MiDevice)i) });
+		m->deviceCallsSample[i] = &m->deviceCalls->labels({ mi_device_name((MiDevice)i) });
+		m->deviceInflightSample[i] = &m->deviceInflight->labels({ mi_device_name((MiDevice)i) });
+	}
+	m->stageQueue = new Gauge("mi_stage_queue_depth");
+	m->stageQueue->help("Requests waiting for each stage of the stage-pipelined mode").labelNames({ "stage" });
+	for (int i = 0; i < MI_PIPE_COUNT; i++) {
+		m->stageQueueSample[i] = &m->stageQueue->labels({ mi_pipe_stage_name(i) });
+	}
+
+	m->httpQueued = new CallbackIntGauge("mi_http_queued_connections", "Connections waiting for a worker thread",
+		[]() { return (Poco::Int64)server_value(&Poco::Net::TCPServer::queuedConnections); });
+	m->httpConnections = new CallbackIntGauge("mi_http_current_connections", "Connections being served",
+		[]() { return (Poco::Int64)server_value(&Poco::Net::TCPServer::currentConnections); });
+	m->httpThreads = new CallbackIntGauge("mi_http_worker_threads", "Active HTTP worker threads",
+		[]() { return (Poco::Int64)server_value(&Poco::Net::TCPServer::currentThreads); });
+	m->httpRefused = new CallbackIntCounter("mi_http_refused_connections_total", "Connections refused because the queue was full",
+		[]() { return (Poco::UInt64)server_value(&Poco::Net::TCPServer::refusedConnections); });
+	m->httpAccepted = new CallbackIntCounter("mi_http_connections_total", "Connections accepted and handed to a worker thread",
+		[]() { return (Poco::UInt64)server_value(&Poco::Net::TCPServer::totalConnections); });
+	m->httpMaxThreads = new CallbackIntGauge("mi_http_max_threads", "HTTP worker threads the server may run (max_threads)",
+		[]() { return (Poco::Int64)server_value(&Poco::Net::TCPServer::maxThreads); });
+	m->httpAcceptWait = new Histogram("mi_http_accept_wait_seconds");
+	m->httpAcceptWait->help("Time an accepted connection waited in the queue for a worker thread").buckets(buckets);
+
+	m->generation = new CallbackIntGauge("mi_pipeline_generation", "Pipeline generation serving requests",
+		[]() { return (Poco::Int64)g_Supervisor.generation(); });
+
+	m->decodePeak = new CallbackIntGauge("mi_decode_peak_buffer_bytes", "Largest pixel buffer of a DCT-scaled decode",
+		[]() { return (Poco::Int64)lv_nDecodePeak.load(std::memory_order_relaxed); });
+
+	m->streams = new CallbackIntGauge("mi_stream_sessions", "Open WebSocket liveness streams",
+		[]() { return (Poco::Int64)mi_stream_active(); });
+
+	m->memoryBudget = new CallbackIntGauge("mi_memory_budget_bytes", "Budget of decoded images, 0 = none",
+		[]() { return (Poco::Int64)mi_membudget_capacity(); });
+	m->memoryUsed = new CallbackIntGauge("mi_memory_used_bytes", "Decoded image bytes admitted by the budget",
+		[]() { return (Poco::Int64)mi_membudget_used(); });
+	m->memoryPeak = new CallbackIntGauge("mi_memory_peak_bytes", "Largest mi_memory_used_bytes since start",
+		[]() { return (Poco::Int64)mi_membudget_peak(); });
+	m->memoryWaiting = new CallbackIntGauge("mi_memory_waiting_decodes", "Decodes waiting for budget",
+		[]() { return (Poco::Int64)mi_membudget_waiting(); });
+	m->auditQueued = new CallbackIntGauge("mi_audit_queued_rows", "Audit rows waiting for the database",
+		[]() { return (Poco::Int64)mi_audit_queued(); });
+	m->executorThreads = new CallbackIntGauge("mi_executor_threads", "Worker threads of the batch decode executor, 0 = disabled",
+		[]() { return (Poco::Int64)(g_pExecutor != NULL ? g_pExecutor->threads() : 0); });
+	m->executorSteals = new CallbackIntCounter("mi_executor_steals_total", "Executor tasks taken from another worker's queue",
+		[]() { return (Poco::UInt64)(g_pExecutor != NULL ? g_pExecutor->steals() : 0); });
+	m->limiterLimit = new CallbackIntGauge("mi_limiter_limit", "Pipeline calls allowed in flight by the adaptive limiter, 0 = disabled",
+		[]() { return (Poco::Int64)mi_limiter_limit(); });
+	m->limiterInflight = new CallbackIntGauge("mi_limiter_inflight", "Pipeline calls holding a limiter permit",
+		[]() { return (Poco::Int64)mi_limiter_inflight(); });
+	m->limiterWaiting = new CallbackIntGauge("mi_limiter_waiting", "Pipeline calls waiting for a limiter permit",
+		[]() { return (Poco::Int64)mi_limiter_waiting(); });
+	m->limiterNoLoad = new CallbackIntGauge("mi_limiter_noload_us", "Pipeline call latency without queueing, per image",
+		[]() { return (Poco::Int64)mi_limiter_noload_us(); });
+	m->limiterOversubscribed = new CallbackIntCounter("mi_limiter_oversubscribed_windows_total", "Limiter windows that found the SDK oversubscribed and lowered the limit",
+		[]() { return (Poco::UInt64)mi_limiter_oversubscribed(); });
+	m->pixelPoolBytes = new CallbackIntGauge("mi_pixel_pool_bytes", "Free pixel buffer bytes kept for reuse",
+		[]() { return (Poco::Int64)mi_pixel_pool_bytes(); });
+	m->pixelPoolHits = new CallbackIntCounter("mi_pixel_pool_hits_total", "Pixel buffers handed out from the pool",
+		[]() { return (Poco::UInt64)mi_pixel_pool_hits(); });
+	m->pixelPoolMisses = new CallbackIntCounter("mi_pixel_pool_misses_total", "Pixel buffers of a pooled size class allocated from the heap",
+		[]() { return (Poco::UInt64)mi_pixel_pool_misses(); });
+	m->clusterErrors = new CallbackIntCounter("mi_cluster_announce_errors_total", "Cluster announcements that could not be sent",
+		[]() { return (Poco::UInt64)mi_cluster_errors(); });
+	m->captureRecords = new CallbackIntCounter("mi_capture_records_total", "Requests written to the capture file",
+		[]() { return (Poco::UInt64)mi_capture_records(); });
+	m->captureDropped = new CallbackIntCounter("mi_capture_dropped_total", "Sampled requests dropped because the capture queue was full",
+		[]() { return (Poco::UInt64)mi_capture_dropped(); });
+	m->otlpExported = new CallbackIntCounter("mi_otlp_spans_exported_total", "Trace spans posted to the OTLP collector",
+		[]() { return (Poco::UInt64)mi_otlp_exported(); });
+	m->otlpDropped = new CallbackIntCounter("mi_otlp_spans_dropped_total", "Trace spans dropped because the OTLP queue was full",
+		[]() { return (Poco::UInt64)mi_otlp_dropped(); });
+	m->otlpFailed = new CallbackIntCounter("mi_otlp_spans_failed_total", "Trace spans lost with a failed OTLP post",
+		[]() { return (Poco::UInt64)mi_otlp_failed(); });
+	m->pixelPoolLarge = new CallbackIntGauge("mi_pixel_pool_large_page_buffers", "Pixel buffers backed by MEM_LARGE_PAGES / MAP_HUGETLB",
+		[]() { return (Poco::Int64)mi_pixel_pool_large_buffers(); });
+	m->pixelPoolThp = new CallbackIntGauge("mi_pixel_pool_thp_buffers", "Pixel buffers advised for transparent huge pages (Linux)",
+		[]() { return (Poco::Int64)mi_pixel_pool_thp_buffers(); });
+	m->peakRss = new CallbackIntGauge("mi_process_peak_rss_bytes", "Largest resident set of the process since start",
+		[]() { return (Poco::Int64)mi_peak_rss(); });
+	m->rss = new CallbackIntGauge("mi_process_rss_bytes", "Resident set of the process",
+		[]() { return (Poco::Int64)mi_rss(); });
+	m->heapAllocated = new CallbackIntGauge("mi_process_heap_allocated_bytes", "C heap bytes handed out, -1 = unknown",
+		[]() { size_t a = 0, f = 0; return mi_heap_stats(&a, &f) ? (Poco::Int64)a : (Poco::Int64)-1; });
+	m->heapFree = new CallbackIntGauge("mi_process_heap_free_bytes", "C heap bytes held free (fragmentation when it grows), -1 = unknown",
+		[]() { size_t a = 0, f = 0; return mi_heap_stats(&a, &f) ? (Poco::Int64)f : (Poco::Int64)-1; });
+	m->handles = new CallbackIntGauge("mi_process_handles", "Open handles (Windows) / file descriptors (Linux) of the process",
+		[]() { return (Poco::Int64)mi_handle_count(); });
+	m->brownoutActive = new CallbackIntGauge("mi_brownout_active", "1 while the server runs in [brownout] mode",
+		[]() { return (Poco::Int64)(mi_brownout_active() ? 1 : 0); });
+	m->brownoutEntries = new CallbackIntCounter("mi_brownout_entries_total", "Times the server entered brownout mode",
+		[]() { return (Poco::UInt64)mi_brownout_entries(); });
+	m->idleTrimmed = new CallbackIntGauge("mi_idle_trimmed", "1 while the server sits trimmed after [idle] after_sec without requests",
+		[]() { return (Poco::Int64)(mi_idle_trimmed() ? 1 : 0); });
+	m->idleTrims = new CallbackIntCounter("mi_idle_trims_total", "Idle trims of pools, caches and heaps",
+		[]() { return (Poco::UInt64)mi_idle_trims(); });
+	m->idleReleased = new CallbackIntGauge("mi_idle_released_bytes", "Resident bytes released by the last idle trim",
+		[]() { return (Poco::Int64)mi_idle_released_bytes(); });
+	m->idleRestore = new CallbackIntGauge("mi_idle_restore_milliseconds", "Time to recreate the parked pipelines at the last wake, -1 = none yet",
+		[]() { return (Poco::Int64)mi_idle_restore_ms(); });
+	m->idleWakeRequest = new CallbackIntGauge("mi_idle_wake_request_milliseconds", "Duration of the request that woke the server from the last trim, -1 = none yet",
+		[]() { return (Poco::Int64)mi_idle_wake_request_ms(); });
+	m->poolParked = new CallbackIntGauge("mi_pool_parked_slots", "Pipeline pool slots parked by the idle trim",
+		[]() { return (Poco::Int64)(g_pPool != NULL ? g_pPool->parked() : 0); });
+	m->poolActive = new CallbackIntGauge("mi_pool_active_slots", "Pipeline pool slots in service",
+		[]() { return (Poco::Int64)(g_pPool != NULL ? g_pPool->active() : 1); });
+	m->poolSpares = new CallbackIntGauge("mi_pool_warm_spares", "Parked pipeline pool slots holding a loaded pipeline",
+		[]() { return (Poco::Int64)(g_pPool != NULL ? g_pPool->spares() : 0); });
+	m->poolGrows = new CallbackIntCounter("mi_pool_grows_total", "Slots the elastic pool put in service under load",
+		[]() { return (Poco::UInt64)(g_pPool != NULL ? g_pPool->grows() : 0); });
+	m->poolShrinks = new CallbackIntCounter("mi_pool_shrinks_total", "Idle slots the elastic pool parked",
+		[]() { return (Poco::UInt64)(g_pPool != NULL ? g_pPool->shrinks() : 0); });
+	m->proactorConnections = new CallbackIntGauge("mi_proactor_connections", "Client connections open on the proactors (server.mode = proactor)",
+		[]() { return (Poco::Int64)mi_proactor_connections(); });
+	m->batchWindow = new CallbackIntGauge("mi_batch_window_microseconds", "Longest wait of the oldest image of a micro-batch",
+		[]() { return (Poco::Int64)(g_pBatcher != NULL ? g_pBatcher->window().window_us() : 0); });
+	m->batchTarget = new CallbackIntGauge("mi_batch_target_size", "Images at which a micro-batch is dispatched without waiting",
+		[]() { return (Poco::Int64)(g_pBatcher != NULL ? g_pBatcher->window().target_size() : 0); });
+	m->batchRate = new CallbackIntGauge("mi_batch_arrivals_per_second", "Arrival rate of images at the micro-batcher, as seen by [batch] adaptive",
+		[]() { return (Poco::Int64)(g_pBatcher != NULL ? g_pBatcher->window().arrivals_per_sec() : 0); });
+	m->batchP99 = new CallbackIntGauge("mi_batch_p99_microseconds", "p99 of an image's time in the micro-batcher over the last adapt_ms, as seen by [batch] adaptive",
+		[]() { return (Poco::Int64)(g_pBatcher != NULL ? g_pBatcher->window().p99_us() : 0); });
+	m->poolInstanceRss = new CallbackIntGauge("mi_pool_instance_rss_bytes", "Resident memory each pipeline pool instance beyond the first added at creation",
+		[]() { return (Poco::Int64)(g_pPool != NULL ? g_pPool->instance_rss() : 0); });
+	m->watchdogReplaced = new CallbackIntCounter("mi_watchdog_replaced_total", "Pipelines replaced after a liveness call stuck past [watchdog] liveness_ms",
+		[]() { return (Poco::UInt64)mi_watchdog_replaced(); });
+	m->watchdogAbandoned = new CallbackIntGauge("mi_watchdog_abandoned_calls", "Liveness calls given up by their request and still running in the SDK",
+		[]() { return (Poco::Int64)mi_watchdog_abandoned(); });
+
+	m->cores = new Gauge("mi_cores_processors");
+	m->cores->help("Processors of each [cores] set, 0 = no partition").labelNames({ "set" });
+	for (int i = 0; i < MI_CORES_SET_COUNT; i++) m->cores->labels({ mi_cores_set_name(i) }).set((double)mi_cores_count((MiCoreSet)i));
+
+	m->backendInfo = new Gauge("mi_backend_info");
+	m->backendInfo->help("Inference engine and runtime profile in use").labelNames({ "engine", "profile" });
+	m->backendRuntime = new Gauge("mi_backend_runtime");
+	m->backendRuntime->help("RuntimeConfiguration of the inference engine, 0 = engine default").labelNames({ "setting" });
+
+	lv_bStageCpu = p_bStageCpu;
+	lv_pMetrics = m;
+	//. without [tenants] every request is charged to "none".
+	if (mi_cost_enabled()) tenant_cost_samples(std::vector<std::string>());
+}
+
+const char* mi_metrics_stage_name(MiStage p_stage)
+{
+	return lv_szStages[p_stage];
+}
+
+const char* mi_metrics_endpoint_name(MiEndpoint p_ep)
+{
+	return lv_szEndpoints[p_ep];
+}
+
+void mi_metrics_bind_server(const Poco::Net::TCPServer* p_pServer, int p_nListener)
+{
+	if (p_nListener >= 0 && p_nListener < MI_LISTENERS_MAX) lv_pServers[p_nListener].store(p_pServer, std::memory_order_release);
+}
+
+int mi_metrics_http_queued()
+{
+	return server_value(&Poco::Net::TCPServer::queuedConnections);
+}
+
+void mi_metrics_accept_wait(double p_dSec)
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->httpAcceptWait->observe(p_dSec);
+}
+
+static thread_local bool lv_bMuted = false;
+
+void mi_metrics_stage(MiStage p_stage, double p_dSec)
+{
+	if (!lv_bMuted) mi_stats_stage(p_stage, p_dSec);
+}
+
+void mi_metrics_mute_stages()
+{
+	lv_bMuted = true;
+}
+
+bool mi_metrics_stage_cpu_enabled()
+{
+	return lv_bStageCpu && !lv_bMuted;
+}
+
+void mi_metrics_stage_cpu(MiStage p_stage, double p_dCpuSec)
+{
+	if (lv_pMetrics != NULL && p_dCpuSec > 0) mi_stats_add(lv_pMetrics->stageCpu->id(p_stage), (uint64_t)(p_dCpuSec * 1e6));
+}
+
+void mi_metrics_request(MiEndpoint p_ep, double p_dSec)
+{
+	mi_startup_inference();
+	mi_stats_request(p_ep, p_dSec);
+}
+
+void mi_metrics_license(double p_dSec)
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->license->observe(p_dSec);
+}
+
+void mi_metrics_license_status(int p_nStatus)
+{
+	if (lv_pMetrics == NULL || p_nStatus < 0 || p_nStatus >= MI_LICENSE_COUNT) return;
+	lv_pMetrics->licenseStatus->set((double)p_nStatus);
+	lv_pMetrics->licenseTransitionsSample[p_nStatus]->inc();
+}
+
+void mi_metrics_admission_reject(MiReject p_reason)
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->rejectedSample[p_reason]->inc();
+}
+
+void mi_metrics_cancel(int p_nAt)
+{
+	if (lv_pMetrics != NULL && p_nAt >= 0 && p_nAt < MI_CANCEL_COUNT) lv_pMetrics->cancelledSample[p_nAt]->inc();
+}
+
+void mi_metrics_gate_reject(GateStage p_stage)
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->gatedSample[p_stage]->inc();
+}
+
+void mi_metrics_prefilter(int p_nOutcome)
+{
+	if (lv_pMetrics != NULL && p_nOutcome >= 0 && p_nOutcome < MI_PREFILTER_COUNT) lv_pMetrics->prefilteredSample[p_nOutcome]->inc();
+}
+
+void mi_metrics_prefilter_agreement(bool p_bReject, int p_nSdk)
+{
+	if (lv_pMetrics != NULL && p_nSdk >= 0 && p_nSdk < MI_PREFILTER_SDK_COUNT) lv_pMetrics->prefilterAgreementSample[p_bReject ? 1 : 0][p_nSdk]->inc();
+}
+
+void mi_metrics_phash(int p_nOutcome)
+{
+	if (lv_pMetrics != NULL && p_nOutcome >= 0 && p_nOutcome < MI_PHASH_COUNT) lv_pMetrics->phashSample[p_nOutcome]->inc();
+}
+
+void mi_metrics_shadow(double p_dPrimarySec, double p_dShadowSec, int p_nAgree, int p_nDisagree)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->shadowDurationSample[0]->observe(p_dPrimarySec);
+	lv_pMetrics->shadowDurationSample[1]->observe(p_dShadowSec);
+	if (p_nAgree > 0) lv_pMetrics->shadowSample[0]->inc(p_nAgree);
+	if (p_nDisagree > 0) lv_pMetrics->shadowSample[1]->inc(p_nDisagree);
+}
+
+void mi_metrics_generation(bool p_bCanary, double p_dSec, const int* p_pErrors, size_t p_nCount)
+{
+	if (lv_pMetrics == NULL) return;
+	int r = p_bCanary ? 1 : 0;
+	lv_pMetrics->generationDurationSample[r]->observe(p_dSec);
+	for (size_t i = 0; i < p_nCount; i++) {
+		//. a rejected image is an answer, a license or internal failure is not.
+		int err = p_pErrors != NULL ? p_pErrors[i] : OK;
+		lv_pMetrics->generationChecksSample[r][err == OK ? 0 : (err == LICENSE_ERROR || err == UNKNOWN) ? 2 : 1]->inc();
+	}
+}
+
+void mi_metrics_shadow_dropped()
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->shadowSample[2]->inc();
+}
+
+void mi_metrics_verdict(int p_nVerdict, bool p_bUncertain)
+{
+	if (lv_pMetrics == NULL || p_nVerdict < 0 || p_nVerdict >= MI_VERDICT_COUNT) return;
+	mi_stats_add(lv_pMetrics->verdicts->id(p_nVerdict));
+	if (p_bUncertain) lv_pMetrics->uncertainSample[0]->inc();
+}
+
+void mi_metrics_verdict_recheck()
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->uncertainSample[1]->inc();
+}
+
+void mi_metrics_cascade(bool p_bEscalated, double p_dFirstSec, double p_dFullSec)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->cascadeSample[p_bEscalated ? 1 : 0]->inc();
+	lv_pMetrics->cascadeDurationSample[0]->observe(p_dFirstSec);
+	if (p_bEscalated) {
+		lv_pMetrics->cascadeDurationSample[1]->observe(p_dFullSec);
+		lv_pMetrics->cascadeSecondsSample[1]->inc(p_dFirstSec);
+	}
+	else if (p_dFullSec > p_dFirstSec) lv_pMetrics->cascadeSecondsSample[0]->inc(p_dFullSec - p_dFirstSec);
+}
+
+void mi_metrics_progressive(int p_nOutcome)
+{
+	if (lv_pMetrics != NULL && p_nOutcome >= 0 && p_nOutcome < MI_PROGRESSIVE_COUNT) lv_pMetrics->progressiveSample[p_nOutcome]->inc();
+}
+
+void mi_metrics_session(int p_nEvent)
+{
+	if (lv_pMetrics != NULL && p_nEvent >= 0 && p_nEvent < MI_SESSION_COUNT) lv_pMetrics->sessionEventsSample[p_nEvent]->inc();
+}
+
+void mi_metrics_burst(size_t p_nChecked, size_t p_nSkipped)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->burstFramesSample[0]->inc((double)p_nChecked);
+	lv_pMetrics->burstFramesSample[1]->inc((double)p_nSkipped);
+}
+
+void mi_metrics_faces(size_t p_nChecked, size_t p_nDropped)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->facesSample[0]->inc((double)p_nChecked);
+	lv_pMetrics->facesSample[1]->inc((double)p_nDropped);
+}
+
+void mi_metrics_onboard_overlap(double p_dSec)
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->onboardOverlap->inc(p_dSec);
+}
+
+void mi_metrics_video_frames(size_t p_nKey, size_t p_nDelta)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->videoFramesSample[0]->inc((double)p_nKey);
+	lv_pMetrics->videoFramesSample[1]->inc((double)p_nDelta);
+}
+
+void mi_metrics_camera(int p_nOutcome)
+{
+	if (lv_pMetrics != NULL && p_nOutcome >= 0 && p_nOutcome < MI_CAMERA_COUNT) lv_pMetrics->cameraFramesSample[p_nOutcome]->inc();
+}
+
+void mi_metrics_precision(int p_nMode)
+{
+	if (lv_pMetrics != NULL && p_nMode >= 0 && (size_t)p_nMode < lv_pMetrics->precisionSample.size()) lv_pMetrics->precisionSample[p_nMode]->inc();
+}
+
+void mi_metrics_fetch(int p_nResult)
+{
+	if (lv_pMetrics != NULL && p_nResult >= 0 && p_nResult < MI_FETCH_COUNT) lv_pMetrics->fetchSample[p_nResult]->inc();
+}
+
+void mi_metrics_tls(int p_nOutcome, double p_dSec)
+{
+	if (lv_pMetrics == NULL || p_nOutcome < 0 || p_nOutcome >= MI_TLS_COUNT) return;
+	lv_pMetrics->tlsHandshakesSample[p_nOutcome]->inc();
+	lv_pMetrics->tlsDurationSample[p_nOutcome]->observe(p_dSec);
+}
+
+void mi_metrics_health_selftest(int p_nResult)
+{
+	if (lv_pMetrics != NULL && p_nResult >= 0 && p_nResult < MI_HEALTH_SELFTEST_COUNT) lv_pMetrics->healthSelftestsSample[p_nResult]->inc();
+}
+
+void mi_metrics_image_decode(bool p_bRepeat)
+{
+	if (lv_pMetrics != NULL) mi_stats_add(lv_pMetrics->imageDecodes->id(p_bRepeat ? 1 : 0));
+}
+
+void mi_metrics_decode(int p_nScale, size_t p_nBytes)
+{
+	size_t peak = lv_nDecodePeak.load(std::memory_order_relaxed);
+	while (p_nBytes > peak && !lv_nDecodePeak.compare_exchange_weak(peak, p_nBytes, std::memory_order_relaxed)) {}
+	if (lv_pMetrics == NULL) return;
+	int idx = p_nScale == 2 ? 0 : p_nScale == 4 ? 1 : p_nScale == 8 ? 2 : 3;
+	lv_pMetrics->decodedSample[idx]->inc();
+}
+
+void mi_metrics_upright(int p_nOrientation)
+{
+	if (lv_pMetrics != NULL && p_nOrientation >= 2 && p_nOrientation <= 8) lv_pMetrics->uprightSample[p_nOrientation]->inc();
+}
+
+void mi_metrics_decode_format(int p_nFormat, bool p_bOk)
+{
+	if (lv_pMetrics != NULL && p_nFormat >= 0 && p_nFormat < MI_CODEC_COUNT) lv_pMetrics->decodeFormatSample[p_nFormat][p_bOk ? 0 : 1]->inc();
+}
+
+void mi_metrics_watchdog_timeout(int p_nStage)
+{
+	if (lv_pMetrics != NULL && p_nStage >= 0 && p_nStage < MI_WATCH_COUNT) lv_pMetrics->watchdogTimeoutSample[p_nStage]->inc();
+}
+
+void mi_metrics_degrade(int p_nStep)
+{
+	if (lv_pMetrics != NULL && p_nStep >= 0 && p_nStep < MI_DEGRADE_COUNT) lv_pMetrics->degradedSample[p_nStep]->inc();
+}
+
+void mi_metrics_tenants(const std::vector<std::string>& p_vNames)
+{
+	if (lv_pMetrics == NULL) return;
+	if (mi_cost_enabled()) tenant_cost_samples(p_vNames);
+	static const char* szResults[MI_TENANT_RESULT_COUNT] = { "admitted", "rate_limited", "concurrency", "unauthorized" };
+	lv_pMetrics->tenantSample.clear();
+	for (size_t i = 0; i <= p_vNames.size(); i++) {
+		const std::string& name = i == 0 ? std::string("unknown") : p_vNames[i - 1];
+		std::array<CounterSample*, MI_TENANT_RESULT_COUNT> samples;
+		for (int r = 0; r < MI_TENANT_RESULT_COUNT; r++) samples[r] = &lv_pMetrics->tenant->labels({ name, szResults[r] });
+		lv_pMetrics->tenantSample.push_back(samples);
+	}
+}
+
+void mi_metrics_tenant(int p_nTenant, int p_nResult)
+{
+	if (lv_pMetrics == NULL || (size_t)(p_nTenant + 1) >= lv_pMetrics->tenantSample.size()) return;
+	lv_pMetrics->tenantSample[p_nTenant + 1][p_nResult]->inc();
+}
+
+void mi_metrics_tenant_cost(int p_nTenant, double p_dDecodeCpuSec, double p_dInferSec, uint64_t p_nBytes, unsigned p_nStages)
+{
+	if (lv_pMetrics == NULL || (size_t)(p_nTenant + 1) >= lv_pMetrics->tenantCostSample.size()) return;
+	TenantCostSamples& s = lv_pMetrics->tenantCostSample[p_nTenant + 1];
+	if (p_dDecodeCpuSec > 0) s.decode->inc(p_dDecodeCpuSec);
+	if (p_dInferSec > 0) s.infer->inc(p_dInferSec);
+	if (p_nBytes > 0) s.bytes->inc((double)p_nBytes);
+	for (int i = 0; i < MI_STAGE_COUNT; i++) {
+		if (p_nStages & (1u << i)) s.stages[i]->inc();
+	}
+}
+
+void mi_metrics_ingest_pause()
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->ingestPauses->inc();
+}
+
+void mi_metrics_stream_drop()
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->streamDropped->inc();
+}
+
+void mi_metrics_access_drop()
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->accessDropped->inc();
+}
+
+void mi_metrics_coalesced()
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->coalesced->inc();
+}
+
+void mi_metrics_audit_drop()
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->auditDropped->inc();
+}
+
+void mi_metrics_compress(size_t p_nIn, size_t p_nOut)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->compressedSample[0]->inc((double)p_nIn);
+	lv_pMetrics->compressedSample[1]->inc((double)p_nOut);
+}
+
+void mi_metrics_backend(const std::string& p_strEngine, const std::string& p_strProfile, int p_nWorkerThreads, int p_nBackendThreads, int p_nBackendInvocations)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->backendInfo->labels({ p_strEngine, p_strProfile.empty() ? "default" : p_strProfile }).set(1.0);
+	lv_pMetrics->backendRuntime->labels({ "worker_threads" }).set((double)p_nWorkerThreads);
+	lv_pMetrics->backendRuntime->labels({ "backend_threads" }).set((double)p_nBackendThreads);
+	lv_pMetrics->backendRuntime->labels({ "backend_invocations" }).set((double)p_nBackendInvocations);
+}
+
+void mi_metrics_device_call(int p_nDevice, double p_dSec)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->deviceBusySample[p_nDevice]->inc(p_dSec);
+	lv_pMetrics->deviceCallsSample[p_nDevice]->inc();
+}
+
+void mi_metrics_batch_buckets(const std::vector<int>& p_vSizes)
+{
+	if (lv_pMetrics == NULL) return;
+	lv_pMetrics->batchBucketSample.clear();
+	for (int n : p_vSizes) lv_pMetrics->batchBucketSample.push_back(std::make_pair(n, &lv_pMetrics->batchBucketCalls->labels({ std::to_string(n) })));
+}
+
+void mi_metrics_batch_bucket(int p_nSize, int p_nPadded)
+{
+	if (lv_pMetrics == NULL) return;
+	for (const std::pair<int, CounterSample*>& s : lv_pMetrics->batchBucketSample) {
+		if (s.first == p_nSize) s.second->inc();
+	}
+	if (p_nPadded > 0) lv_pMetrics->batchPadded->inc((double)p_nPadded);
+}
+
+void mi_metrics_batch_duplicates(int p_nPath, size_t p_nCount)
+{
+	if (lv_pMetrics != NULL && p_nPath >= 0 && p_nPath < MI_DEDUP_COUNT) lv_pMetrics->batchDuplicatesSample[p_nPath]->inc((double)p_nCount);
+}
+
+void mi_metrics_device_inflight(int p_nDevice, int p_nCalls)
+{
+	if (lv_pMetrics != NULL) lv_pMetrics->deviceInflightSample[p_nDevice]->set((double)p_nCalls);
+}
+
+void mi_metrics_stage_queue(int p_nStage, int p_nDepth)
+{
+	if (lv_pMetrics != NULL && p_nStage >= 0 && p_nStage < MI_PIPE_COUNT) lv_pMetrics->stageQueueSample[p_nStage]->set((double)p_nDepth);
+}
+
+void mi_metrics_status(int p_nStatus)
+{
+	if (lv_pMetrics == NULL) return;
+	int idx = (p_nStatus >= 0 && p_nStatus < LD_STATUS_COUNT) ? p_nStatus : LD_STATUS_COUNT;
+	mi_stats_add(lv_pMetrics->status->id(idx));
+}
+
+void mi_metrics_sdk_call(int p_nCall, double p_dSec, const int* p_pErrors, char* const* p_ppszMsgs, size_t p_nCount)
+{
+	if (lv_pMetrics == NULL || p_nCall < 0 || p_nCall >= MI_SDK_CALL_COUNT) return;
+	mi_stats_observe(MI_STATS_SDK_CALL, p_nCall, p_dSec);
+	for (size_t i = 0; i < p_nCount; i++) {
+		int err = face_sdk_status(p_pErrors != NULL ? p_pErrors[i] : OK, p_ppszMsgs != NULL ? p_ppszMsgs[i] : NULL);
+		int idx = (err >= 0 && err < LD_STATUS_COUNT) ? err : LD_STATUS_COUNT;
+		mi_stats_add(lv_pMetrics->sdkCalls->id(p_nCall * (LD_STATUS_COUNT + 1) + idx));
+	}
+}
+
+void mi_metrics_handle(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response)
+{
+	if (lv_pMetrics == NULL) {
+		p_response.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+		p_response.setContentType("text/plain");
+		p_response.sendBuffer("metrics disabled", 16);
+		return;
+	}
+	//. the core totals as of this scrape.
+	mi_stats_collect();
+	MetricsRequestHandler handler;
+	handler.handleRequest(p_request, p_response);
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "MiAccessLog.h"
+#include "MiAlloc.h"
+#include "MiCost.h"
+#include "MiGate.h"
+#include "MiIdle.h"
+#include "MiPlatform.h"
+#include "MiTrace.h"
+#include "Poco/Net/TCPServer.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+//. Prometheus metrics (Poco::Prometheus default registry), served on GD_API_METRICS.
+//. Every call is a no-op until mi_metrics_init has run, so [metrics] enable = false
+//. costs nothing on the request path.
+
+enum MiStage {
+	MI_STAGE_INGEST = 0,		//. body read + multipart / base64 decode (streamed together)
+	MI_STAGE_IMAGE_CREATE,		//. image_create_bytes
+	MI_STAGE_LIVENESS,			//. pipeline call incl. batching wait and license retry
+	MI_STAGE_SERIALIZE,			//. JSON stringify
+	MI_STAGE_SEND,				//. response write
+	MI_STAGE_CROP,				//. face-crop fast path (scaled decode + detect + resize), see MiFaceCrop.h
+	MI_STAGE_GATE,				//. detection / quality gate before liveness, see MiGate.h
+	MI_STAGE_DECODE,			//. DCT-scaled JPEG decode, see MiDecode.h; sampled video frames, see MiVideo.h
+	MI_STAGE_COMPRESS,			//. gzip / deflate of the response body, see MiCompress.h
+	MI_STAGE_ANALYZE,			//. GD_API_ANALYZE face detection, see MiAnalyze.h
+	MI_STAGE_DETECT,			//. GD_API_DETECT batch detection, see MiDetect.h
+	MI_STAGE_QUALITY,			//. GD_API_QUALITY batch quality check, see MiQuality.h
+	MI_STAGE_CONVERT,			//. NV12 / I420 to BGR of a full pixel upload (MiColor.h), upright turn of a decoded one (MiOrient.h)
+	MI_STAGE_PREFILTER,			//. blur / darkness prefilter before the SDK, see MiPrefilter.h
+	MI_STAGE_COUNT
+};
+
+enum MiEndpoint {
+	MI_EP_CHECK = 0,
+	MI_EP_CHECK_BASE64,
+	MI_EP_BATCH,
+	MI_EP_SEQUENCE,
+	MI_EP_PIXELS,
+	MI_EP_BINARY,				//. MiBinaryServer frames
+	MI_EP_STREAM,				//. GD_API_STREAM frames, see MiStream.h
+	MI_EP_JOBS,					//. GD_API_JOBS submissions, see MiJobs.h
+	MI_EP_SHM,					//. GD_API_SHM, see MiShm.h
+	MI_EP_ANALYZE,				//. GD_API_ANALYZE, see MiAnalyze.h
+	MI_EP_DETECT,				//. GD_API_DETECT, see MiDetect.h
+	MI_EP_QUALITY,				//. GD_API_QUALITY, see MiQuality.h
+	MI_EP_SESSION,				//. GD_API_SESSION, see MiSession.h
+	MI_EP_CHECK_RAW,			//. GD_API_FULL_PROCESS_RAW
+	MI_EP_CHECK_URL,			//. GD_API_FULL_PROCESS_URL
+	MI_EP_BURST,				//. GD_API_BURST
+	MI_EP_FACES,				//. GD_API_FACES, see MiFaces.h
+	MI_EP_ONBOARD,				//. GD_API_ONBOARD, see MiOnboard.h
+	MI_EP_VIDEO,				//. GD_API_VIDEO, see MiVideo.h
+	MI_EP_COUNT
+};
+
+enum MiReject {
+	MI_REJECT_OVERLOAD = 0,		//. estimated wait beyond the deadline / max_wait_ms
+	MI_REJECT_EXPIRED,			//. deadline passed before inference started
+	MI_REJECT_COUNT
+};
+
+//. where work for a request whose client had disconnected was dropped, see MiContext.h
+enum MiCancel {
+	MI_CANCEL_ADMISSION = 0,	//. after its wait for a worker, before the handler ran
+	MI_CANCEL_DISPATCH,			//. before an SDK call of the handler
+	MI_CANCEL_BATCH,			//. taken out of a micro-batch (MiBatcher.h)
+	MI_CANCEL_COUNT
+};
+
+//. p_bStageCpu also charges the thread CPU time of every stage to mi_stage_cpu_seconds_total.
+void mi_metrics_init(bool p_bStageCpu = true);
+
+//. span name of a stage / label of an endpoint (string literals).
+const char* mi_metrics_stage_name(MiStage p_stage);
+const char* mi_metrics_endpoint_name(MiEndpoint p_ep);
+
+//. exposes the server's queue / connection / thread counters as gauges (threads in use
+//. against max_threads, connections queued, served, accepted and refused), summed over
+//. the server.listeners (p_nListener < MI_LISTENERS_MAX); NULL unbinds.
+void mi_metrics_bind_server(const Poco::Net::TCPServer* p_pServer, int p_nListener = 0);
+//. connections waiting for a worker thread of the bound server, 0 when none is bound.
+int mi_metrics_http_queued();
+//. time from accept until a worker thread took the connection, see AcceptStamp (MiConnection.h).
+void mi_metrics_accept_wait(double p_dSec);
+
+void mi_metrics_stage(MiStage p_stage, double p_dSec);
+//. stage timings of the calling thread are not recorded from now on (MiShadow.h worker).
+void mi_metrics_mute_stages();
+//. true when StageTimer should read the thread CPU clock.
+bool mi_metrics_stage_cpu_enabled();
+//. p_dCpuSec of CPU the timing thread spent in one p_stage.
+void mi_metrics_stage_cpu(MiStage p_stage, double p_dCpuSec);
+void mi_metrics_request(MiEndpoint p_ep, double p_dSec);
+void mi_metrics_license(double p_dSec);
+//. the license refresher entered p_nStatus, a MiLicense.h LicenseStatus.
+void mi_metrics_license_status(int p_nStatus);
+void mi_metrics_admission_reject(MiReject p_reason);
+//. one request dropped at p_nAt (a MiCancel) because its client went away.
+void mi_metrics_cancel(int p_nAt);
+//. one image stopped by the gate before liveness.
+void mi_metrics_gate_reject(GateStage p_stage);
+//. one image judged by the prefilter, p_nOutcome a MiPrefilter.h PrefilterOutcome.
+void mi_metrics_prefilter(int p_nOutcome);
+//. one prefiltered image the SDK also checked : p_bReject the prefilter's answer, p_nSdk a PrefilterSdk.
+void mi_metrics_prefilter_agreement(bool p_bReject, int p_nSdk);
+//. one liveness call of p_nCount images on the current (p_bCanary = false) or the canary
+//. generation, see MiSupervisor.h; p_pErrors their STATUS.
+void mi_metrics_generation(bool p_bCanary, double p_dSec, const int* p_pErrors, size_t p_nCount);
+//. one face crop looked up in the near-duplicate index, p_nOutcome a MiPhash.h PhashOutcome.
+void mi_metrics_phash(int p_nOutcome);
+//. one sampled call replayed on the shadow engine, p_nAgree / p_nDisagree of its images by verdict.
+void mi_metrics_shadow(double p_dPrimarySec, double p_dShadowSec, int p_nAgree, int p_nDisagree);
+//. one sample dropped on a full shadow queue.
+void mi_metrics_shadow_dropped();
+//. one answered image, p_nVerdict a Verdict (MiVerdict.h), p_bUncertain within the uncertain band.
+void mi_metrics_verdict(int p_nVerdict, bool p_bUncertain);
+//. a sequence fused over all its frames because its last frame alone was uncertain.
+void mi_metrics_verdict_recheck();
+//. one image on the blueprint cascade (MiBlueprint.h) : p_dFirstSec on the first-pass pipeline,
+//. p_dFullSec on the main one when p_bEscalated, else the estimate of what it would have taken.
+void mi_metrics_cascade(bool p_bEscalated, double p_dFirstSec, double p_dFullSec);
+//. one upload decoded while it was received, p_nOutcome a MiProgressive.h ProgressiveOutcome.
+void mi_metrics_progressive(int p_nOutcome);
+//. one event of the multi-frame session store, p_nEvent a MiSession.h SessionEvent.
+void mi_metrics_session(int p_nEvent);
+//. one burst (MiBurst.h) : p_nChecked frames got a liveness check, p_nSkipped did not.
+void mi_metrics_burst(size_t p_nChecked, size_t p_nSkipped);
+//. one group photo (MiFaces.h) : p_nChecked faces got a liveness check, p_nDropped were past max_faces.
+void mi_metrics_faces(size_t p_nChecked, size_t p_nDropped);
+//. one onboarding request (MiOnboard.h) : p_dSec of the selfie and portrait checks ran side by side.
+void mi_metrics_onboard_overlap(double p_dSec);
+//. frames decoded from one video upload (MiVideo.h) : p_nKey key frames, p_nDelta others.
+void mi_metrics_video_frames(size_t p_nKey, size_t p_nDelta);
+//. one frame of a pulled camera stream, p_nOutcome a MiCamera.h CameraOutcome.
+void mi_metrics_camera(int p_nOutcome);
+//. one check routed by MiPrecision.h, p_nMode a mi_precision_modes index.
+void mi_metrics_precision(int p_nMode);
+//. one image fetched for GD_API_FULL_PROCESS_URL, p_nResult a MiFetch.h FetchResult.
+void mi_metrics_fetch(int p_nResult);
+//. one TLS handshake of p_dSec on tls.port, p_nOutcome a MiTls.h TlsOutcome.
+void mi_metrics_tls(int p_nOutcome, double p_dSec);
+//. one run of the GD_API_HEALTH self-test, p_nResult a MiHealth.h HealthSelfTest.
+void mi_metrics_health_selftest(int p_nResult);
+//. one decode of an upload (MiImage.h); p_bRepeat : its request had decoded it before.
+void mi_metrics_image_decode(bool p_bRepeat);
+//. one DCT-scaled decode at 1/p_nScale producing p_nBytes of pixels.
+void mi_metrics_decode(int p_nScale, size_t p_nBytes);
+//. optional step p_nStep (bit index of a MiContext.h DegradeStep) skipped for a deadline.
+void mi_metrics_degrade(int p_nStep);
+//. one decoded upload turned upright from EXIF orientation p_nOrientation (2 .. 8).
+void mi_metrics_upright(int p_nOrientation);
+//. one upload decoded by the server (MiCodecs.h), p_nFormat a CodecFormat.
+void mi_metrics_decode_format(int p_nFormat, bool p_bOk);
+//. one request over a [watchdog] limit, p_nStage a MiWatchdog.h WatchStage.
+void mi_metrics_watchdog_timeout(int p_nStage);
+//. one sample set per tenant of MiTenants.h, call once after mi_metrics_init.
+void mi_metrics_tenants(const std::vector<std::string>& p_vNames);
+//. one inference request of tenant p_nTenant (-1 = unknown key), p_nResult a TenantResult.
+void mi_metrics_tenant(int p_nTenant, int p_nResult);
+//. cost of one request of tenant p_nTenant (-1 = none), see MiCost.h; p_nStages are MiStage bits.
+void mi_metrics_tenant_cost(int p_nTenant, double p_dDecodeCpuSec, double p_dInferSec, uint64_t p_nBytes, unsigned p_nStages);
+//. the reactors stopped reading new requests at the ingest high-water mark (MiReactorServer.h).
+void mi_metrics_ingest_pause();
+//. a stream frame replaced by a newer one before it was checked.
+void mi_metrics_stream_drop();
+//. an access log record dropped because the writer had not drained its thread's ring.
+void mi_metrics_access_drop();
+//. a request answered with the outcome of an identical one in flight, see MiCoalesce.h
+void mi_metrics_coalesced();
+//. an audit row that did not fit the queue, see MiAudit.h
+void mi_metrics_audit_drop();
+//. one compressed response body, p_nIn bytes before and p_nOut after.
+void mi_metrics_compress(size_t p_nIn, size_t p_nOut);
+//. mi_backend_info{engine, profile} = 1 and the runtime thread settings as gauges.
+void mi_metrics_backend(const std::string& p_strEngine, const std::string& p_strProfile, int p_nWorkerThreads, int p_nBackendThreads, int p_nBackendInvocations);
+//. one check on device p_nDevice (MiDevice.h) that took p_dSec, and its calls in flight.
+void mi_metrics_device_call(int p_nDevice, double p_dSec);
+void mi_metrics_device_inflight(int p_nDevice, int p_nCalls);
+//. one sample per [batch] buckets size (MiBuckets.h), call once after mi_metrics_init.
+void mi_metrics_batch_buckets(const std::vector<int>& p_vSizes);
+//. one micro-batch call of bucket p_nSize holding p_nPadded repeated images.
+void mi_metrics_batch_bucket(int p_nSize, int p_nPadded);
+//. p_nCount images of a batch answered from an equal one, p_nPath a MiDedup.h DedupPath.
+void mi_metrics_batch_duplicates(int p_nPath, size_t p_nCount);
+//. requests waiting for PipeStage p_nStage, see MiStages.h
+void mi_metrics_stage_queue(int p_nStage, int p_nDepth);
+//. one SDK outcome, p_nStatus is a STATUS value (OK included).
+void mi_metrics_status(int p_nStatus);
+//. one SdkCall (MiSdkCall.h) of p_dSec with p_nCount outcomes (err, msg pairs).
+void mi_metrics_sdk_call(int p_nCall, double p_dSec, const int* p_pErrors, char* const* p_ppszMsgs, size_t p_nCount);
+
+//. writes the text exposition format.
+void mi_metrics_handle(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response);
+
+//. measures one stage from construction to stop() or destruction and charges the thread's
+//. allocations to it meanwhile (GD_ALLOC_COUNT, MiAlloc.h); with stage CPU on,
+//. also the CPU the constructing thread spent in it (work handed to other threads, e.g.
+//. the infer stage of MiStages.h, is charged where it runs); with [cost], the stage and its
+//. CPU go to the request's cost too (MiCost.h).
+class StageTimer {
+public:
+	explicit StageTimer(MiStage p_stage)
+		: m_stage(p_stage), m_bDone(false), m_nCpuNs(mi_metrics_stage_cpu_enabled() || mi_cost_enabled() ? mi_thread_cpu_ns() : 0), m_nAllocTag(mi_alloc_stage(p_stage)),
+		m_start(std::chrono::steady_clock::now()) {}
+	~StageTimer() { stop(); }
+
+	void stop()
+	{
+		if (m_bDone) return;
+		m_bDone = true;
+		mi_alloc_stage(m_nAllocTag);
+		auto end = std::chrono::steady_clock::now();
+		double sec = std::chrono::duration<double>(end - m_start).count();
+		uint64_t nCpuNs = m_nCpuNs != 0 ? mi_thread_cpu_ns() - m_nCpuNs : 0;
+		if (nCpuNs != 0 && mi_metrics_stage_cpu_enabled()) mi_metrics_stage_cpu(m_stage, (double)nCpuNs * 1e-9);
+		mi_cost_stage(m_stage, nCpuNs);
+		mi_metrics_stage(m_stage, sec);
+		mi_access_log_stage(m_stage, sec);
+		mi_trace_record(mi_metrics_stage_name(m_stage), m_start, end);
+	}
+
+private:
+	MiStage									m_stage;
+	bool									m_bDone;
+	uint64_t								m_nCpuNs;		//. thread CPU at the start, 0 = not measured
+	int										m_nAllocTag;	//. stage charged with allocations before, see MiAlloc.h
+	std::chrono::steady_clock::time_point	m_start;
+};
+
+//. total handler time of one API request; also scopes the trace of a request without a
+//. context (the context's own ends with its RequestScope) and its allocation count.
+class RequestTimer {
+public:
+	explicit RequestTimer(MiEndpoint p_ep) : m_ep(p_ep), m_start(std::chrono::steady_clock::now()), m_bWoke(mi_idle_request())
+	{
+		mi_access_log_endpoint(m_ep);
+		mi_trace_request_begin();
+		mi_alloc_request_begin();
+	}
+	~RequestTimer()
+	{
+		mi_alloc_request_end();
+		auto end = std::chrono::steady_clock::now();
+		mi_metrics_request(m_ep, std::chrono::duration<double>(end - m_start).count());
+		if (m_bWoke) mi_idle_woken(std::chrono::duration<double>(end - m_start).count());
+		mi_trace_request_end();
+	}
+
+private:
+	MiEndpoint								m_ep;
+	std::chrono::steady_clock::time_point	m_start;
+	bool									m_bWoke;	//. first request after an idle trim, MiIdle.h
+};
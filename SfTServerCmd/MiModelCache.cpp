@@ -0,0 +1,107 @@
+#include "MiModelCache.h"
+#include "MiConf.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Environment.h"
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include <idliveface/idliveface.h>
+#include <fstream>
+#include <iostream>
+
+static std::string			lv_strDir;
+static MiModelCacheStats	lv_atInit = { 0, 0 };
+
+static std::string stamp_path(const std::string& p_strDir)
+{
+	return Poco::Path(p_strDir, GD_MODEL_CACHE_STAMP).toString();
+}
+
+static std::string read_stamp(const std::string& p_strDir)
+{
+	std::string strVersion;
+	std::ifstream in(stamp_path(p_strDir));
+	if (in) std::getline(in, strVersion);
+	return strVersion;
+}
+
+//. everything but the stamp; OpenVINO names its blobs by hash, there is nothing to keep.
+static void purge(const std::string& p_strDir)
+{
+	std::string strStamp = stamp_path(p_strDir);
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(p_strDir); it != end; ++it) {
+		if (it->path() == strStamp) continue;
+		try {
+			it->remove(true);
+		}
+		catch (const Poco::Exception& ex) {
+			std::cout << "OpenVINO cache : cannot remove " << it->path() << " : " << ex.displayText() << std::endl;
+		}
+	}
+}
+
+bool mi_model_cache_init(const std::string& p_strDir)
+{
+	lv_strDir.clear();
+	if (p_strDir.empty()) return false;
+
+	std::string strRelease = idliveface::GetReleaseInfo().version;
+	try {
+		Poco::File(p_strDir).createDirectories();
+		std::string strStamp = read_stamp(p_strDir);
+		if (strStamp != strRelease) {
+			if (!strStamp.empty()) std::cout << "OpenVINO cache " << p_strDir << " : compiled by " << strStamp << ", purged for " << strRelease << std::endl;
+			purge(p_strDir);
+			std::ofstream out(stamp_path(p_strDir));
+			out << strRelease << std::endl;
+			if (!out) throw Poco::WriteFileException(stamp_path(p_strDir));
+		}
+	}
+	catch (const Poco::Exception& ex) {
+		std::cout << "OpenVINO cache " << p_strDir << " : " << ex.displayText() << ", compiling on every start" << std::endl;
+		return false;
+	}
+
+	lv_strDir = p_strDir;
+	lv_atInit = mi_model_cache_stats(p_strDir);
+	Poco::Environment::set("FACESDK_OV_CACHE_DIR", p_strDir);
+	return true;
+}
+
+const std::string& mi_model_cache_dir()
+{
+	return lv_strDir;
+}
+
+static void add_stats(const Poco::File& p_dir, const std::string& p_strStamp, MiModelCacheStats& p_stats)
+{
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(p_dir); it != end; ++it) {
+		if (it->isDirectory()) add_stats(*it, p_strStamp, p_stats);
+		else if (it->path() != p_strStamp) {
+			p_stats.blobs++;
+			p_stats.bytes += it->getSize();
+		}
+	}
+}
+
+MiModelCacheStats mi_model_cache_stats(const std::string& p_strDir)
+{
+	MiModelCacheStats stats = { 0, 0 };
+	try {
+		if (!p_strDir.empty()) add_stats(Poco::File(p_strDir), stamp_path(p_strDir), stats);
+	}
+	catch (const Poco::Exception&) {
+	}
+	return stats;
+}
+
+void mi_model_cache_report()
+{
+	if (lv_strDir.empty()) return;
+	MiModelCacheStats now = mi_model_cache_stats(lv_strDir);
+	int added = now.blobs - lv_atInit.blobs;
+	std::cout << "OpenVINO cache " << lv_strDir << " : " << now.blobs << " blobs, " << now.bytes / (1024 * 1024) << " MB, "
+		<< (added > 0 ? "compiled " + std::to_string(added) + " new" : std::string("all loaded from cache")) << std::endl;
+}
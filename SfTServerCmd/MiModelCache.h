@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+//. OpenVINO compiled-model cache (sdk.ov_cache_dir). Compiling the networks is most of the
+//. time to ready; with a cache directory OpenVINO writes the compiled blobs on the first
+//. start and maps them on later ones. The legacy pipelines get it through
+//. FACESDK_OV_CACHE_DIR, the blueprint backend through RuntimeConfiguration::parameters
+//. (GD_MODEL_CACHE_PARAMETER, unless backend.parameters sets it).
+//. Blobs are only valid for the SDK build that compiled them : GD_MODEL_CACHE_STAMP records
+//. GetReleaseInfo().version and a directory stamped by another release is emptied.
+
+struct MiModelCacheStats {
+	int			blobs;
+	uint64_t	bytes;
+};
+
+//. before the dll loads : creates and validates p_strDir and exports FACESDK_OV_CACHE_DIR.
+//. false when p_strDir is empty or unusable, the SDK then compiles on every start.
+bool mi_model_cache_init(const std::string& p_strDir);
+
+//. the validated directory, empty when the cache is off.
+const std::string& mi_model_cache_dir();
+
+//. blobs under p_strDir (the stamp excluded).
+MiModelCacheStats mi_model_cache_stats(const std::string& p_strDir);
+
+//. once the pipelines are built : logs whether they were loaded from the cache or compiled into it.
+void mi_model_cache_report();
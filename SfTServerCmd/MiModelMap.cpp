@@ -0,0 +1,81 @@
+#include "MiModelMap.h"
+#include "MiModelCache.h"
+#include "MiPlatform.h"
+#include "MiSettings.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static MiModelMapStats		lv_stats = { 0, 0, 0, 0, 0, false };
+
+static void add_files(const Poco::File& p_dir, MiModelMapStats& p_stats)
+{
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(p_dir); it != end; ++it) {
+		if (it->isDirectory()) add_files(*it, p_stats);
+		else {
+			p_stats.files++;
+			p_stats.diskBytes += it->getSize();
+		}
+	}
+}
+
+//. the directories the engines read their models from, each once.
+static std::vector<std::string> model_dirs()
+{
+	std::vector<std::string> vDirs;
+	const std::string* candidates[] = { &g_Settings.configDir, &g_Settings.backendDataDir, &g_Settings.shadowDataDir, &mi_model_cache_dir() };
+	for (const std::string* p : candidates) {
+		if (p->empty()) continue;
+		std::string strDir;
+		try {
+			strDir = Poco::Path(*p).makeAbsolute().makeDirectory().toString();
+		}
+		catch (const Poco::Exception&) {
+			continue;
+		}
+		bool bSeen = false;
+		for (auto& d : vDirs) bSeen = bSeen || d == strDir;
+		if (!bSeen) vDirs.push_back(strDir);
+	}
+	return vDirs;
+}
+
+void mi_model_map_report()
+{
+	MiModelMapStats stats = { 0, 0, 0, 0, 0, true };
+	for (auto& strDir : model_dirs()) {
+		try {
+			Poco::File dir(strDir);
+			if (!dir.exists() || !dir.isDirectory()) continue;
+			add_files(dir, stats);
+		}
+		catch (const Poco::Exception& ex) {
+			std::cout << "Model map : " << strDir << " : " << ex.displayText() << std::endl;
+			continue;
+		}
+		int nFiles = 0;
+		stats.sharedBytes += mi_mapped_resident(strDir, &nFiles);
+		stats.mappedFiles += nFiles;
+	}
+	stats.rss = mi_rss();
+	lv_stats = stats;
+
+	std::cout << "Model map : " << stats.mappedFiles << " of " << stats.files << " model files mapped, "
+		<< (stats.sharedBytes >> 20) << " MB resident and shared of " << (stats.diskBytes >> 20) << " MB on disk, process resident "
+		<< (stats.rss >> 20) << " MB" << std::endl;
+	if (stats.sharedBytes > 0) std::cout << "Model map : every further worker on this host adds ~" << ((stats.rss - std::min(stats.rss, stats.sharedBytes)) >> 20)
+		<< " MB instead of " << (stats.rss >> 20) << " MB" << std::endl;
+	else if (stats.files > 0) std::cout << "Model map : the models were read into private memory, every worker holds its own copy"
+		<< (g_Settings.modelMmap ? "" : " (sdk.mmap_models is off)") << std::endl;
+}
+
+MiModelMapStats mi_model_map_stats()
+{
+	return lv_stats;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+//. Model files shared across worker processes ([sdk] mmap_models). With mi_id_svc running
+//. several workers on a host, every worker holding its own copy of the networks costs the
+//. model size again per worker. Mapped read-only, the files stay in the OS file cache and
+//. all workers map the same physical pages.
+//. - blueprint engine : the GD_MODEL_MMAP_PARAMETER runtime parameter (OpenVINO maps the IR
+//.   weights and the compiled blobs of sdk.ov_cache_dir instead of reading them into the
+//.   heap); mmap_models = false turns it off, backend.parameters overrides both.
+//. - legacy pipelines : the SDK reads its data itself, mapped or not as its OpenVINO does.
+//. Once the engines are built mi_model_map_report measures what is actually shared : the
+//. resident pages of file mappings under sdk.config_dir, backend.data_dir, shadow.data_dir
+//. and sdk.ov_cache_dir. That is the resident set every further worker on the host does
+//. not add, logged and exported as mi_startup_model_bytes{kind}.
+
+struct MiModelMapStats {
+	int			files;			//. model files on disk
+	int			mappedFiles;	//. of them mapped by this process
+	uint64_t	diskBytes;
+	uint64_t	sharedBytes;	//. resident pages of the mapped files
+	uint64_t	rss;			//. resident set of the process when measured
+	bool		measured;
+};
+
+//. after the engines are built : measures and logs the mapped model files.
+void mi_model_map_report();
+
+//. the last report, measured = false before it.
+MiModelMapStats mi_model_map_stats();
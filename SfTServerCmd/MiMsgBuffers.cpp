@@ -0,0 +1,35 @@
+#include "MiMsgBuffers.h"
+#include "MiConf.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <facesdk/FaceSDK_C_Api.h>
+
+struct MsgLevel {
+	std::unique_ptr<char[]>	bytes;
+	std::vector<char*>		msgs;
+};
+
+//. moving a level keeps its buffers and pointer array where they are.
+static thread_local std::vector<MsgLevel>	lv_vLevels;
+static thread_local size_t					lv_nDepth = 0;
+
+MsgBuffers::MsgBuffers(size_t p_nCount)
+	: m_nCount(p_nCount)
+{
+	if (lv_vLevels.size() <= lv_nDepth) lv_vLevels.resize(lv_nDepth + 1);
+	MsgLevel& level = lv_vLevels[lv_nDepth++];
+	if (level.msgs.size() < p_nCount) {
+		size_t nCap = std::max(p_nCount, (size_t)GD_MSG_BUFFERS_PER_LEVEL);
+		level.bytes.reset(new char[nCap * MESSAGE_BUFFER_SIZE]);
+		level.msgs.resize(nCap);
+		for (size_t i = 0; i < nCap; i++) level.msgs[i] = &level.bytes[i * MESSAGE_BUFFER_SIZE];
+	}
+	for (size_t i = 0; i < p_nCount; i++) level.msgs[i][0] = '\0';
+	m_ppMsgs = level.msgs.data();
+}
+
+MsgBuffers::~MsgBuffers()
+{
+	lv_nDepth--;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+
+//. Message buffers of the FaceSDK calls. Every err / msg out-parameter takes a buffer of
+//. MESSAGE_BUFFER_SIZE bytes (the size mi_settings_apply_sdk gives set_message_buffer_size),
+//. and the batch calls a char** of one per image. MsgBuffers leases them from the calling
+//. thread instead of a fresh n * MESSAGE_BUFFER_SIZE zeroed block per call : each nesting
+//. level of a thread holds one array, sized for GD_MSG_BUFFERS_PER_LEVEL images the first
+//. time and grown only by a larger batch, so a worker allocates them once.
+//. Only the first byte of each buffer is cleared; the SDK writes the text of a failed
+//. call, and a message is read (JSON, job results) only where err is not OK.
+//. Leases of a thread must end in reverse order, which scoped objects do.
+
+class MsgBuffers {
+public:
+	explicit MsgBuffers(size_t p_nCount);
+	~MsgBuffers();
+
+	char** data() { return m_ppMsgs; }
+	char* operator[](size_t p_nIndex) { return m_ppMsgs[p_nIndex]; }
+	size_t size() const { return m_nCount; }
+
+private:
+	MsgBuffers(const MsgBuffers&) = delete;
+	MsgBuffers& operator=(const MsgBuffers&) = delete;
+
+	char**	m_ppMsgs;
+	size_t	m_nCount;
+};
@@ -0,0 +1,270 @@
+#include "MiMultipart.h"
+#include "MiConf.h"
+#include "MiHash.h"
+#include <string.h>
+
+//. a file part is read this much at a time into its buffer : small enough that the
+//. bytes are still in cache when the delimiter search runs over them.
+#define LD_FILE_CHUNK		(256 * 1024)
+#define LD_HEADER_CHUNK		(16 * 1024)
+
+static bool iequals(const char* p_a, size_t p_nLen, const char* p_b)
+{
+	if (strlen(p_b) != p_nLen) return false;
+	for (size_t i = 0; i < p_nLen; i++) {
+		char a = p_a[i], b = p_b[i];
+		if (a >= 'A' && a <= 'Z') a = (char)(a - 'A' + 'a');
+		if (b >= 'A' && b <= 'Z') b = (char)(b - 'A' + 'a');
+		if (a != b) return false;
+	}
+	return true;
+}
+
+//. first full delimiter in [p_p, p_end), NULL when none.
+static const char* find_delim(const char* p_p, const char* p_end, const std::string& p_strDelim)
+{
+	size_t len = p_strDelim.size();
+	while ((size_t)(p_end - p_p) >= len) {
+		const char* c = (const char*)memchr(p_p, '\r', (size_t)(p_end - p_p) - len + 1);
+		if (c == NULL) return NULL;
+		if (memcmp(c, p_strDelim.data(), len) == 0) return c;
+		p_p = c + 1;
+	}
+	return NULL;
+}
+
+//. value of parameter p_pszName in a "form-data; name=\"x\"; filename=\"y\"" header value.
+static bool header_param(const std::string& p_strValue, const char* p_pszName, std::string& p_strOut)
+{
+	size_t pos = 0;
+	while (pos < p_strValue.size()) {
+		size_t end = pos;
+		bool bQuoted = false;
+		while (end < p_strValue.size() && (bQuoted || p_strValue[end] != ';')) {
+			if (p_strValue[end] == '"') bQuoted = !bQuoted;
+			end++;
+		}
+		size_t eq = p_strValue.find('=', pos);
+		if (eq != std::string::npos && eq < end) {
+			size_t k0 = pos, k1 = eq;
+			while (k0 < k1 && (p_strValue[k0] == ' ' || p_strValue[k0] == '\t')) k0++;
+			while (k1 > k0 && (p_strValue[k1 - 1] == ' ' || p_strValue[k1 - 1] == '\t')) k1--;
+			if (iequals(p_strValue.data() + k0, k1 - k0, p_pszName)) {
+				size_t v0 = eq + 1, v1 = end;
+				while (v0 < v1 && (p_strValue[v0] == ' ' || p_strValue[v0] == '\t')) v0++;
+				while (v1 > v0 && (p_strValue[v1 - 1] == ' ' || p_strValue[v1 - 1] == '\t')) v1--;
+				if (v1 - v0 >= 2 && p_strValue[v0] == '"' && p_strValue[v1 - 1] == '"') { v0++; v1--; }
+				p_strOut.assign(p_strValue, v0, v1 - v0);
+				return true;
+			}
+		}
+		pos = end + 1;
+	}
+	return false;
+}
+
+bool mi_multipart_boundary(const std::string& p_strContentType, std::string& p_strBoundary)
+{
+	size_t semi = p_strContentType.find(';');
+	if (semi == std::string::npos) return false;
+	if (!header_param(p_strContentType.substr(semi + 1), "boundary", p_strBoundary)) return false;
+	return !p_strBoundary.empty() && p_strBoundary.size() <= GD_MULTIPART_BOUNDARY_MAX;
+}
+
+//. the body as it is scanned : m_strBuf[m_nPos..] holds bytes read but not consumed.
+class MultipartScanner {
+public:
+	MultipartScanner(std::istream& p_in, const std::string& p_strBoundary, MultipartSink& p_sink, std::string& p_strErr)
+		: m_in(p_in), m_strDelim("\r\n--" + p_strBoundary), m_sink(p_sink), m_strErr(p_strErr), m_nPos(0), m_nFiles(0)
+	{
+		//. the first delimiter has no line break before it.
+		m_strBuf = "\r\n";
+	}
+
+	bool run()
+	{
+		if (!read_part(NULL, 0)) return fail("no multipart boundary");
+		while (true) {
+			if (!need(2)) return fail("truncated multipart body");
+			if (m_strBuf.compare(m_nPos, 2, "--") == 0) return true;		//. the epilogue is ignored
+			while (need(1) && (m_strBuf[m_nPos] == ' ' || m_strBuf[m_nPos] == '\t')) m_nPos++;
+			if (!need(2) || m_strBuf.compare(m_nPos, 2, "\r\n") != 0) return fail("malformed multipart boundary line");
+			m_nPos += 2;
+
+			std::string strDisposition;
+			if (!read_headers(strDisposition)) return false;
+			std::string strName, strFilename;
+			header_param(strDisposition, "name", strName);
+			if (header_param(strDisposition, "filename", strFilename)) {
+				std::string* pOut = strFilename.empty() ? NULL : m_sink.next(m_nFiles);
+				if (pOut == NULL) {
+					if (!strFilename.empty()) m_sink.overflow = true;
+					if (!read_part(NULL, 0)) return fail("unterminated multipart part");
+					continue;
+				}
+				m_nFiles++;
+				if (!read_file(*pOut)) return fail("unterminated multipart part");
+			}
+			else if (m_sink.fields != NULL) {
+				if (m_sink.fields->size() >= GD_MULTIPART_FIELDS_MAX) return fail("too many form fields");
+				std::string strValue;
+				if (!read_part(&strValue, GD_MULTIPART_FIELD_MAX)) return false;
+				(*m_sink.fields)[strName] = strValue;
+			}
+			else if (!read_part(NULL, 0)) {
+				return fail("unterminated multipart part");
+			}
+		}
+	}
+
+private:
+	bool fail(const char* p_pszWhy)
+	{
+		if (m_strErr.empty()) m_strErr = p_pszWhy;
+		return false;
+	}
+
+	//. reads more of the body into m_strBuf; false at its end.
+	bool fill()
+	{
+		if (m_nPos > 0 && m_nPos * 2 >= m_strBuf.size()) {
+			m_strBuf.erase(0, m_nPos);
+			m_nPos = 0;
+		}
+		size_t have = m_strBuf.size();
+		m_strBuf.resize(have + LD_HEADER_CHUNK);
+		m_in.read(&m_strBuf[have], LD_HEADER_CHUNK);
+		size_t n = (size_t)m_in.gcount();
+		m_strBuf.resize(have + n);
+		return n > 0;
+	}
+
+	bool need(size_t p_nBytes)
+	{
+		while (m_strBuf.size() - m_nPos < p_nBytes) {
+			if (!fill()) return false;
+		}
+		return true;
+	}
+
+	//. part headers up to the blank line; p_strDisposition gets the Content-Disposition value.
+	bool read_headers(std::string& p_strDisposition)
+	{
+		size_t end;
+		while (true) {
+			if (m_strBuf.size() - m_nPos >= 2 && m_strBuf.compare(m_nPos, 2, "\r\n") == 0) {
+				end = m_nPos;		//. no headers at all
+				break;
+			}
+			end = m_strBuf.find("\r\n\r\n", m_nPos);
+			if (end != std::string::npos) {
+				end += 2;
+				break;
+			}
+			if (m_strBuf.size() - m_nPos > GD_MULTIPART_HEADER_MAX) return fail("multipart part header too large");
+			if (!fill()) return fail("truncated multipart part header");
+		}
+		size_t line = m_nPos;
+		while (line < end) {
+			size_t eol = m_strBuf.find("\r\n", line);
+			size_t colon = m_strBuf.find(':', line);
+			if (colon != std::string::npos && colon < eol && iequals(m_strBuf.data() + line, colon - line, "Content-Disposition")) {
+				p_strDisposition.assign(m_strBuf, colon + 1, eol - colon - 1);
+			}
+			line = eol + 2;
+		}
+		m_nPos = end + 2;
+		return true;
+	}
+
+	//. part body up to the next delimiter into p_pOut (NULL = skipped), at most p_nMax bytes.
+	bool read_part(std::string* p_pOut, size_t p_nMax)
+	{
+		size_t keep = m_strDelim.size() - 1;
+		while (true) {
+			const char* b = m_strBuf.data() + m_nPos;
+			const char* e = m_strBuf.data() + m_strBuf.size();
+			const char* c = find_delim(b, e, m_strDelim);
+			size_t n = c != NULL ? (size_t)(c - b) : ((size_t)(e - b) > keep ? (size_t)(e - b) - keep : 0);
+			if (p_pOut != NULL) {
+				if (p_pOut->size() + n > p_nMax) return fail("form field too large");
+				p_pOut->append(b, n);
+			}
+			m_nPos += n;
+			if (c != NULL) {
+				m_nPos += m_strDelim.size();
+				return true;
+			}
+			if (!fill()) return p_pOut != NULL ? fail("unterminated multipart part") : false;
+		}
+	}
+
+	//. file part : read from the stream into p_out itself, the delimiter searched there.
+	bool read_file(std::string& p_out)
+	{
+		p_out.clear();
+		if (m_nFiles == 1 && m_sink.sizeHint > p_out.capacity()) p_out.reserve(m_sink.sizeHint);
+		bool bSniffed = !m_sink.sniff;
+		//. the bytes before a possible delimiter start are final, hashed as each chunk lands.
+		Hash64Stream hash;
+		size_t nHashed = 0;
+		auto fnHash = [&](size_t p_nUpTo) {
+			if (m_sink.hashes == NULL || p_nUpTo <= nHashed) return;
+			hash.update(p_out.data() + nHashed, p_nUpTo - nHashed);
+			nHashed = p_nUpTo;
+		};
+
+		const char* b = m_strBuf.data() + m_nPos;
+		const char* e = m_strBuf.data() + m_strBuf.size();
+		const char* c = find_delim(b, e, m_strDelim);
+		if (c != NULL) {
+			p_out.append(b, (size_t)(c - b));
+			m_nPos += (size_t)(c - b) + m_strDelim.size();
+			fnHash(p_out.size());
+			if (m_sink.hashes != NULL) m_sink.hashes->push_back(hash.digest());
+			if (!bSniffed) m_sink.sniff(p_out);
+			return true;
+		}
+		//. a delimiter cut by the end of the buffer is completed by the reads below.
+		p_out.append(b, (size_t)(e - b));
+		m_strBuf.clear();
+		m_nPos = 0;
+
+		size_t keep = m_strDelim.size() - 1;
+		while (true) {
+			if (!bSniffed) bSniffed = m_sink.sniff(p_out);
+			size_t from = p_out.size() > keep ? p_out.size() - keep : 0;
+			size_t have = p_out.size();
+			p_out.resize(have + LD_FILE_CHUNK);
+			m_in.read(&p_out[have], LD_FILE_CHUNK);
+			size_t n = (size_t)m_in.gcount();
+			p_out.resize(have + n);
+			c = find_delim(p_out.data() + from, p_out.data() + p_out.size(), m_strDelim);
+			if (c != NULL) {
+				size_t at = (size_t)(c - p_out.data());
+				m_strBuf.assign(p_out, at + m_strDelim.size(), std::string::npos);
+				p_out.resize(at);
+				fnHash(at);
+				if (m_sink.hashes != NULL) m_sink.hashes->push_back(hash.digest());
+				if (!bSniffed) m_sink.sniff(p_out);
+				return true;
+			}
+			if (n == 0) return false;
+			fnHash(p_out.size() > keep ? p_out.size() - keep : 0);
+		}
+	}
+
+	std::istream&		m_in;
+	std::string			m_strDelim;		//. CRLF "--" boundary
+	MultipartSink&		m_sink;
+	std::string&		m_strErr;
+	std::string			m_strBuf;
+	size_t				m_nPos;
+	size_t				m_nFiles;
+};
+
+bool mi_multipart_read(std::istream& p_in, const std::string& p_strBoundary, MultipartSink& p_sink, std::string& p_strErr)
+{
+	MultipartScanner scanner(p_in, p_strBoundary, p_sink, p_strErr);
+	return scanner.run();
+}
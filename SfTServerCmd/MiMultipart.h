@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+//. Single-pass multipart/form-data reader for the upload endpoints, replacing
+//. Poco::Net::HTMLForm + PartHandler + StreamCopier. A file part (filename in its
+//. Content-Disposition) is read from the body stream straight into the buffer its
+//. caller hands out (normally a pooled one) and the delimiter is searched in place,
+//. memchr (vectorized by the CRT) finding the CR candidates; only the bytes after a
+//. delimiter are copied back. Other fields are kept up to GD_MULTIPART_FIELD_MAX bytes
+//. each (GD_MULTIPART_FIELDS_MAX of them), or skipped when the caller wants none.
+
+//. boundary parameter of a multipart Content-Type, false when there is none.
+bool mi_multipart_boundary(const std::string& p_strContentType, std::string& p_strBoundary);
+
+struct MultipartSink {
+	//. buffer of file part p_nIndex, NULL skips the part (too many images).
+	std::function<std::string*(size_t)>			next;
+	//. called as a file part grows until it returns true; may throw to stop the upload.
+	std::function<bool(const std::string&)>		sniff;
+	//. other form fields, NULL = skipped.
+	std::map<std::string, std::string>*			fields;
+	//. expected body size (Content-Length), reserved in the first file buffer; 0 = unknown.
+	size_t										sizeHint;
+	//. out : mi_hash64 of every file part read into a buffer, in order, hashed chunk by
+	//. chunk as the part arrives (MiHash.h); NULL = not hashed.
+	std::vector<uint64_t>*						hashes;
+	//. out : a file part found no buffer.
+	bool										overflow;
+
+	MultipartSink() : fields(NULL), sizeHint(0), hashes(NULL), overflow(false) {}
+};
+
+//. reads the whole body; false with p_strErr when it is not well-formed multipart.
+bool mi_multipart_read(std::istream& p_in, const std::string& p_strBoundary, MultipartSink& p_sink, std::string& p_strErr);
@@ -0,0 +1,156 @@
+#include "MiNuma.h"
+#include "MiConf.h"
+#include <atomic>
+#include <string.h>
+#include <vector>
+
+static std::vector<MiAffinity>		lv_vNodes;		//. processors of each used node
+static std::vector<unsigned int>	lv_vNodeIds;	//. OS node number of lv_vNodes[i]
+static std::atomic<unsigned int>	lv_nNext(0);
+static thread_local bool			lv_bPinned = false;
+
+#ifdef _WIN32
+
+static void find_nodes()
+{
+	ULONG nHighest = 0;
+	if (!GetNumaHighestNodeNumber(&nHighest) || nHighest == 0) return;
+
+	for (ULONG n = 0; n <= nHighest && lv_vNodes.size() < GD_NUMA_MAX_NODES; n++) {
+		GROUP_AFFINITY ga;
+		memset(&ga, 0, sizeof(ga));
+		if (!GetNumaNodeProcessorMaskEx((USHORT)n, &ga) || ga.Mask == 0) continue;
+		lv_vNodes.push_back(ga);
+		lv_vNodeIds.push_back((unsigned int)n);
+	}
+}
+
+static bool current_os_node(unsigned int& p_nNode)
+{
+	PROCESSOR_NUMBER pn;
+	GetCurrentProcessorNumberEx(&pn);
+	USHORT node = 0;
+	if (!GetNumaProcessorNodeEx(&pn, &node)) return false;
+	p_nNode = node;
+	return true;
+}
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LD_SYSFS_MAX_NODES	64
+
+static std::vector<int>	lv_vCpuNode;	//. OS node of each processor, -1 = unknown
+
+//. "0-7,16-23" of /sys/devices/system/node/nodeN/cpulist.
+static bool read_cpulist(unsigned int p_nNode, MiAffinity& p_out)
+{
+	char szPath[64];
+	snprintf(szPath, sizeof(szPath), "/sys/devices/system/node/node%u/cpulist", p_nNode);
+	FILE* f = fopen(szPath, "r");
+	if (f == NULL) return false;
+	char szList[4096];
+	bool bRead = fgets(szList, sizeof(szList), f) != NULL;
+	fclose(f);
+	if (!bRead) return false;
+
+	CPU_ZERO(&p_out);
+	for (char* p = szList; *p >= '0' && *p <= '9'; ) {
+		long lo = strtol(p, &p, 10), hi = lo;
+		if (*p == '-') hi = strtol(p + 1, &p, 10);
+		for (long c = lo; c <= hi && c < CPU_SETSIZE; c++) CPU_SET((int)c, &p_out);
+		if (*p == ',') p++;
+	}
+	return CPU_COUNT(&p_out) > 0;
+}
+
+static void find_nodes()
+{
+	//. node numbers may have holes (offline or memory-only nodes).
+	std::vector<std::pair<unsigned int, MiAffinity>> vFound;
+	for (unsigned int n = 0; n < LD_SYSFS_MAX_NODES; n++) {
+		MiAffinity set;
+		if (read_cpulist(n, set)) vFound.push_back(std::make_pair(n, set));
+	}
+	if (vFound.size() < 2) return;
+
+	lv_vCpuNode.assign(CPU_SETSIZE, -1);
+	for (auto& f : vFound) {
+		for (int c = 0; c < CPU_SETSIZE; c++) {
+			if (CPU_ISSET(c, &f.second)) lv_vCpuNode[c] = (int)f.first;
+		}
+		if (lv_vNodes.size() < GD_NUMA_MAX_NODES) {
+			lv_vNodes.push_back(f.second);
+			lv_vNodeIds.push_back(f.first);
+		}
+	}
+}
+
+static bool current_os_node(unsigned int& p_nNode)
+{
+	int cpu = sched_getcpu();
+	if (cpu < 0 || cpu >= (int)lv_vCpuNode.size() || lv_vCpuNode[cpu] < 0) return false;
+	p_nNode = (unsigned int)lv_vCpuNode[cpu];
+	return true;
+}
+
+#endif
+
+void mi_numa_init(bool p_bEnable)
+{
+	lv_vNodes.clear();
+	lv_vNodeIds.clear();
+	if (!p_bEnable) return;
+
+	find_nodes();
+	//. a single populated node needs no placement.
+	if (lv_vNodes.size() < 2) {
+		lv_vNodes.clear();
+		lv_vNodeIds.clear();
+	}
+}
+
+bool mi_numa_enabled()
+{
+	return !lv_vNodes.empty();
+}
+
+int mi_numa_nodes()
+{
+	return lv_vNodes.empty() ? 1 : (int)lv_vNodes.size();
+}
+
+int mi_numa_current_node()
+{
+	if (lv_vNodes.empty()) return 0;
+
+	unsigned int node = 0;
+	if (!current_os_node(node)) return 0;
+	for (size_t i = 0; i < lv_vNodeIds.size(); i++) {
+		if (lv_vNodeIds[i] == node) return (int)i;
+	}
+	return 0;
+}
+
+void mi_numa_pin_thread()
+{
+	if (lv_bPinned || lv_vNodes.empty()) return;
+	lv_bPinned = true;
+	unsigned int node = lv_nNext.fetch_add(1, std::memory_order_relaxed) % (unsigned int)lv_vNodes.size();
+	mi_thread_set_affinity(lv_vNodes[node]);
+}
+
+NumaPin::NumaPin(int p_nNode)
+	: m_bPinned(false)
+{
+	memset(&m_prev, 0, sizeof(m_prev));
+	if (lv_vNodes.empty() || p_nNode < 0) return;
+	m_bPinned = mi_thread_set_affinity(lv_vNodes[p_nNode % lv_vNodes.size()], &m_prev);
+}
+
+NumaPin::~NumaPin()
+{
+	if (m_bPinned) mi_thread_set_affinity(m_prev);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "MiPlatform.h"
+
+//. NUMA placement ([numa] settings) for multi-socket hosts. When the machine has more
+//. than one node with processors :
+//. - every request thread (Poco pool, reactor inference workers) is pinned to one node on
+//.   its first request, round robin, and stays there;
+//. - pipeline pool slots are spread over the nodes, each created while the creating thread
+//.   runs on its node so the SDK's first-touch allocations land there, and a thread
+//.   borrows a slot of its own node first (MiPipelinePool.h);
+//. - upload buffers are reused from a free list per node (MiBufferPool.h), so a body is
+//.   written and read on the node that runs its inference;
+//. - OpenVINO binds its threads (sdk.ov_bind_threads = 1 unless set).
+//. With one node (or [numa] off) every call below is a no-op and node is always 0.
+//. Nodes come from the Win32 NUMA calls on Windows, from /sys/devices/system/node on Linux.
+
+void mi_numa_init(bool p_bEnable);
+bool mi_numa_enabled();
+int mi_numa_nodes();
+
+//. node of the processor the calling thread runs on, 0 when off.
+int mi_numa_current_node();
+
+//. pins the calling thread to the next node, round robin; once per thread.
+void mi_numa_pin_thread();
+
+//. pins the calling thread to p_nNode for the lifetime of the object, then restores it.
+class NumaPin {
+public:
+	explicit NumaPin(int p_nNode);
+	~NumaPin();
+
+private:
+	NumaPin(const NumaPin&) = delete;
+	NumaPin& operator=(const NumaPin&) = delete;
+
+	MiAffinity		m_prev;
+	bool			m_bPinned;
+};
@@ -0,0 +1,74 @@
+#include "MiOnboard.h"
+#include "MiExecutor.h"
+#include "MiLock.h"
+#include "MiMetrics.h"
+#include "MiQuality.h"
+#include <chrono>
+#include <exception>
+#include <memory>
+
+static bool		lv_bEnable = false;
+
+//. the portrait side of one request, shared with the worker that runs it.
+struct OnboardTask {
+	std::function<void()>	fn;
+	bool					done;
+	double					sec;
+	std::exception_ptr		error;
+	MI_MUTEX(mtx, "onboard.task");
+	MiCondition				cv;
+	OnboardTask() : done(false), sec(0) {}
+};
+
+void mi_onboard_init(bool p_bEnable)
+{
+	lv_bEnable = p_bEnable;
+}
+
+bool mi_onboard_enabled()
+{
+	return lv_bEnable && mi_quality_enabled();
+}
+
+void mi_onboard_run(const std::function<void()>& p_fnSelfie, const std::function<void()>& p_fnId)
+{
+	if (g_pExecutor == NULL) {
+		p_fnId();
+		p_fnSelfie();
+		return;
+	}
+	std::shared_ptr<OnboardTask> task = std::make_shared<OnboardTask>();
+	task->fn = p_fnId;
+	g_pExecutor->submit([task]() {
+		auto start = std::chrono::steady_clock::now();
+		try {
+			task->fn();
+		}
+		catch (...) {
+			task->error = std::current_exception();
+		}
+		MiLockGuard lock(task->mtx);
+		task->sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		task->done = true;
+		task->cv.notify_all();
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	std::exception_ptr selfieError;
+	try {
+		p_fnSelfie();
+	}
+	catch (...) {
+		selfieError = std::current_exception();
+	}
+	double dSelfie = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	{
+		//. the portrait side still reads the request's buffers, wait for it in any case.
+		MiUniqueLock lock(task->mtx);
+		task->cv.wait(lock, [&task] { return task->done; });
+	}
+	//. saved = the shorter side, which ran inside the longer one.
+	mi_metrics_onboard_overlap(dSelfie < task->sec ? dSelfie : task->sec);
+	if (selfieError) std::rethrow_exception(selfieError);
+	if (task->error) std::rethrow_exception(task->error);
+}
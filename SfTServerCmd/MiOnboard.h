@@ -0,0 +1,19 @@
+#pragma once
+
+#include <functional>
+
+//. Selfie plus ID portrait in one request for GD_API_ONBOARD ([onboard] settings, needs
+//. [quality]) : onboarding checks liveness on the selfie and the quality of the ID portrait,
+//. which took two sequential calls. Both images come in one body, the selfie first; the
+//. portrait's quality check (and its face boxes, with [detect]) runs on an executor worker
+//. (MiExecutor.h) on the quality / detect engines while the request thread runs the selfie
+//. through the liveness pipeline, so the request takes the longer of the two, not their sum.
+//. Without an executor the two run one after the other. mi_onboard_overlap_seconds_total
+//. on GD_API_METRICS is the time the overlap saved.
+
+void mi_onboard_init(bool p_bEnable);
+bool mi_onboard_enabled();
+
+//. p_fnId on an executor worker while p_fnSelfie runs on the calling thread; returns when
+//. both are done. An exception of p_fnId is rethrown here.
+void mi_onboard_run(const std::function<void()>& p_fnSelfie, const std::function<void()>& p_fnId);
@@ -0,0 +1,193 @@
+#include "MiOrient.h"
+#include "MiCpu.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_ORIENT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define LD_TARGET_SSSE3
+#else
+#define LD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#else
+#define LD_ORIENT_X86 0
+#endif
+
+//. source columns per strip of the transposing orientations : the destination rows
+//. written by one strip (3 bytes x strip x 4 rows per block row) stay in L1.
+#define LD_ORIENT_STRIP	64
+
+//. how an orientation maps a stored pixel (sx, sy) to the upright one.
+struct OrientMap {
+	bool	transpose;	//. 5 .. 8 : destination row from sx, column from sy
+	bool	rowRev;		//. destination row counted from the end
+	bool	colRev;		//. destination column counted from the end
+};
+
+static OrientMap orient_map(int p_nOrientation)
+{
+	OrientMap m;
+	m.transpose = p_nOrientation >= 5;
+	m.rowRev = p_nOrientation == 3 || p_nOrientation == 4 || p_nOrientation == 7 || p_nOrientation == 8;
+	m.colRev = p_nOrientation == 2 || p_nOrientation == 3 || p_nOrientation == 6 || p_nOrientation == 7;
+	return m;
+}
+
+void mi_orient_size(int p_nOrientation, int p_nWidth, int p_nHeight, int& p_nOutWidth, int& p_nOutHeight)
+{
+	bool bSwap = p_nOrientation >= 5 && p_nOrientation <= 8;
+	p_nOutWidth = bSwap ? p_nHeight : p_nWidth;
+	p_nOutHeight = bSwap ? p_nWidth : p_nHeight;
+}
+
+int mi_orient_inverse(int p_nOrientation)
+{
+	if (p_nOrientation == 6) return 8;
+	if (p_nOrientation == 8) return 6;
+	return p_nOrientation;
+}
+
+//. stored pixels [p_nX0, p_nX1) x [p_nY0, p_nY1) one by one (edges and the scalar build).
+static void transpose_scalar(const uint8_t* p_pSrc, int p_nWidth, int p_nHeight, size_t p_nSrcStride, const OrientMap& p_map,
+	uint8_t* p_pDst, size_t p_nDstStride, int p_nX0, int p_nX1, int p_nY0, int p_nY1)
+{
+	for (int sy = p_nY0; sy < p_nY1; sy++) {
+		const uint8_t* in = p_pSrc + (size_t)sy * p_nSrcStride;
+		size_t dx = (size_t)(p_map.colRev ? p_nHeight - 1 - sy : sy) * 3;
+		for (int sx = p_nX0; sx < p_nX1; sx++) {
+			uint8_t* out = p_pDst + (size_t)(p_map.rowRev ? p_nWidth - 1 - sx : sx) * p_nDstStride + dx;
+			out[0] = in[sx * 3];
+			out[1] = in[sx * 3 + 1];
+			out[2] = in[sx * 3 + 2];
+		}
+	}
+}
+
+static void mirror_row_scalar(const uint8_t* p_pIn, uint8_t* p_pOut, int p_nFrom, int p_nWidth)
+{
+	for (int sx = p_nFrom; sx < p_nWidth; sx++) {
+		uint8_t* out = p_pOut + (size_t)(p_nWidth - 1 - sx) * 3;
+		out[0] = p_pIn[sx * 3];
+		out[1] = p_pIn[sx * 3 + 1];
+		out[2] = p_pIn[sx * 3 + 2];
+	}
+}
+
+static void mirror_row_plain(const uint8_t* p_pIn, uint8_t* p_pOut, int p_nWidth)
+{
+	mirror_row_scalar(p_pIn, p_pOut, 0, p_nWidth);
+}
+
+static void transpose_plain(const uint8_t* p_pSrc, int p_nWidth, int p_nHeight, size_t p_nSrcStride, const OrientMap& p_map,
+	uint8_t* p_pDst, size_t p_nDstStride)
+{
+	for (int tx = 0; tx < p_nWidth; tx += LD_ORIENT_STRIP) {
+		int txEnd = tx + LD_ORIENT_STRIP < p_nWidth ? tx + LD_ORIENT_STRIP : p_nWidth;
+		transpose_scalar(p_pSrc, p_nWidth, p_nHeight, p_nSrcStride, p_map, p_pDst, p_nDstStride, tx, txEnd, 0, p_nHeight);
+	}
+}
+
+//. bound by bind_orient (MiCpu.h).
+typedef void (*MirrorRowFn)(const uint8_t* p_pIn, uint8_t* p_pOut, int p_nWidth);
+typedef void (*TransposeFn)(const uint8_t* p_pSrc, int p_nWidth, int p_nHeight, size_t p_nSrcStride, const OrientMap& p_map,
+	uint8_t* p_pDst, size_t p_nDstStride);
+static MirrorRowFn lv_fnMirrorRow = mirror_row_plain;
+static TransposeFn lv_fnTranspose = transpose_plain;
+
+#if LD_ORIENT_X86
+
+//. 4 pixels, 12 bytes : full loads / stores would touch the bytes after the row.
+LD_TARGET_SSSE3 static inline __m128i load12(const uint8_t* p_p)
+{
+	int tail;
+	memcpy(&tail, p_p + 8, 4);
+	return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p_p), _mm_cvtsi32_si128(tail));
+}
+
+LD_TARGET_SSSE3 static inline void store12(uint8_t* p_p, __m128i p_v)
+{
+	_mm_storel_epi64((__m128i*)p_p, p_v);
+	int tail = _mm_cvtsi128_si32(_mm_srli_si128(p_v, 8));
+	memcpy(p_p + 8, &tail, 4);
+}
+
+LD_TARGET_SSSE3 static void mirror_row_ssse3(const uint8_t* p_pIn, uint8_t* p_pOut, int p_nWidth)
+{
+	const __m128i rev = _mm_setr_epi8(9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2, -1, -1, -1, -1);
+	int sx = 0;
+	for (; sx + 4 <= p_nWidth; sx += 4) store12(p_pOut + (size_t)(p_nWidth - 4 - sx) * 3, _mm_shuffle_epi8(load12(p_pIn + (size_t)sx * 3), rev));
+	mirror_row_scalar(p_pIn, p_pOut, sx, p_nWidth);
+}
+
+//. 4 x 4 pixel blocks : rows widened to one pixel per 32-bit lane, transposed, packed back.
+LD_TARGET_SSSE3 static void transpose_ssse3(const uint8_t* p_pSrc, int p_nWidth, int p_nHeight, size_t p_nSrcStride, const OrientMap& p_map,
+	uint8_t* p_pDst, size_t p_nDstStride)
+{
+	const __m128i widen = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i pack = p_map.colRev ? _mm_setr_epi8(12, 13, 14, 8, 9, 10, 4, 5, 6, 0, 1, 2, -1, -1, -1, -1)
+		: _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	int w4 = p_nWidth & ~3, h4 = p_nHeight & ~3;
+	for (int tx = 0; tx < w4; tx += LD_ORIENT_STRIP) {
+		int txEnd = tx + LD_ORIENT_STRIP < w4 ? tx + LD_ORIENT_STRIP : w4;
+		for (int sy = 0; sy < h4; sy += 4) {
+			const uint8_t* in = p_pSrc + (size_t)sy * p_nSrcStride;
+			size_t dx = (size_t)(p_map.colRev ? p_nHeight - 4 - sy : sy) * 3;
+			for (int sx = tx; sx < txEnd; sx += 4) {
+				const uint8_t* p = in + (size_t)sx * 3;
+				__m128i r0 = _mm_shuffle_epi8(load12(p), widen);
+				__m128i r1 = _mm_shuffle_epi8(load12(p + p_nSrcStride), widen);
+				__m128i r2 = _mm_shuffle_epi8(load12(p + p_nSrcStride * 2), widen);
+				__m128i r3 = _mm_shuffle_epi8(load12(p + p_nSrcStride * 3), widen);
+				__m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpackhi_epi32(r0, r1);
+				__m128i t2 = _mm_unpacklo_epi32(r2, r3), t3 = _mm_unpackhi_epi32(r2, r3);
+				__m128i c[4] = { _mm_unpacklo_epi64(t0, t2), _mm_unpackhi_epi64(t0, t2), _mm_unpacklo_epi64(t1, t3), _mm_unpackhi_epi64(t1, t3) };
+				for (int k = 0; k < 4; k++) {
+					int row = p_map.rowRev ? p_nWidth - 1 - (sx + k) : sx + k;
+					store12(p_pDst + (size_t)row * p_nDstStride + dx, _mm_shuffle_epi8(c[k], pack));
+				}
+			}
+		}
+	}
+	transpose_scalar(p_pSrc, p_nWidth, p_nHeight, p_nSrcStride, p_map, p_pDst, p_nDstStride, w4, p_nWidth, 0, p_nHeight);
+	transpose_scalar(p_pSrc, p_nWidth, p_nHeight, p_nSrcStride, p_map, p_pDst, p_nDstStride, 0, w4, h4, p_nHeight);
+}
+
+#endif
+
+static void bind_orient(int p_nVariant)
+{
+	lv_fnMirrorRow = mirror_row_plain;
+	lv_fnTranspose = transpose_plain;
+#if LD_ORIENT_X86
+	if (p_nVariant == 1) {
+		lv_fnMirrorRow = mirror_row_ssse3;
+		lv_fnTranspose = transpose_ssse3;
+	}
+#else
+	(void)p_nVariant;
+#endif
+}
+
+static const char* const lv_szVariants[] = { "scalar", "ssse3" };
+static const uint32_t lv_nNeeds[] = { 0, MI_CPU_SSSE3 };
+static MiCpuKernel lv_kernel = { "orient", LD_ORIENT_X86 ? 2 : 1, lv_szVariants, lv_nNeeds, bind_orient, 0, 0 };
+static const bool lv_bRegistered = mi_cpu_register(&lv_kernel);
+
+bool mi_orient_bgr(const uint8_t* p_pSrc, int p_nWidth, int p_nHeight, size_t p_nSrcStride, int p_nOrientation, uint8_t* p_pDst, size_t p_nDstStride)
+{
+	if (p_nOrientation < 1 || p_nOrientation > 8) return false;
+	OrientMap map = orient_map(p_nOrientation);
+	if (map.transpose) {
+		lv_fnTranspose(p_pSrc, p_nWidth, p_nHeight, p_nSrcStride, map, p_pDst, p_nDstStride);
+		return true;
+	}
+
+	for (int sy = 0; sy < p_nHeight; sy++) {
+		const uint8_t* in = p_pSrc + (size_t)sy * p_nSrcStride;
+		uint8_t* out = p_pDst + (size_t)(map.rowRev ? p_nHeight - 1 - sy : sy) * p_nDstStride;
+		if (!map.colRev) memcpy(out, in, (size_t)p_nWidth * 3);
+		else lv_fnMirrorRow(in, out, p_nWidth);
+	}
+	return true;
+}
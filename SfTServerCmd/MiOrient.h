@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//. EXIF orientation applied to decoded BGR888 pixels, so the pipeline gets upright images
+//. and the SDK does not have to find the rotation itself (MiDecode.h). Orientation is the
+//. EXIF tag value of MiImageInfo.h : 1 upright, 2 mirrored, 3 180, 4 flipped, 5 transposed,
+//. 6 90 clockwise, 7 transversed, 8 90 counter-clockwise. Flips copy 4-pixel groups,
+//. 5 .. 8 transpose 4 x 4 pixel blocks in registers, both with SSSE3 when the CPU has it
+//. (MiCpu.h), column strips keeping the written rows in cache.
+
+//. size of the upright image : 5 .. 8 swap width and height.
+void mi_orient_size(int p_nOrientation, int p_nWidth, int p_nHeight, int& p_nOutWidth, int& p_nOutHeight);
+
+//. orientation whose EXIF tag turns an upright image into p_nOrientation's stored layout
+//. (6 <-> 8, the others undo themselves), for benchmarks producing rotated input.
+int mi_orient_inverse(int p_nOrientation);
+
+//. p_pSrc (p_nWidth x p_nHeight as stored) upright into p_pDst (mi_orient_size), which must
+//. not overlap p_pSrc. False for orientations outside 1 .. 8.
+bool mi_orient_bgr(const uint8_t* p_pSrc, int p_nWidth, int p_nHeight, size_t p_nSrcStride, int p_nOrientation, uint8_t* p_pDst, size_t p_nDstStride);
@@ -0,0 +1,250 @@
+#include "MiOtlp.h"
+#include "Poco/Exception.h"
+#include "Poco/URI.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/NullStream.h"
+#include "Poco/StreamCopier.h"
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define LD_OTLP_TIMEOUT_SEC		5
+
+static OtlpSettings								lv_settings;
+static Poco::URI								lv_uri;
+static std::atomic<bool>						lv_bEnabled(false);
+static std::mutex								lv_mtx;
+static std::condition_variable					lv_cv;
+static std::vector<OtlpSpan>					lv_vQueue;
+static bool										lv_bStop = false;
+static std::thread								lv_thread;
+static std::atomic<uint64_t>					lv_nExported(0);
+static std::atomic<uint64_t>					lv_nDropped(0);
+static std::atomic<uint64_t>					lv_nFailed(0);
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;		//. the spec allows lowercase only
+}
+
+static bool parse_hex(const char* p, int p_nDigits, uint64_t& p_nOut)
+{
+	p_nOut = 0;
+	for (int i = 0; i < p_nDigits; i++) {
+		int v = hex_value(p[i]);
+		if (v < 0) return false;
+		p_nOut = (p_nOut << 4) | (uint64_t)v;
+	}
+	return true;
+}
+
+bool mi_traceparent_parse(const std::string& p_strHeader, uint64_t& p_nTraceHi, uint64_t& p_nTraceLo, uint64_t& p_nParent, uint8_t& p_nFlags)
+{
+	const std::string& s = p_strHeader;
+	if (s.size() < MI_TRACEPARENT_LEN || s[2] != '-' || s[35] != '-' || s[52] != '-') return false;
+	uint64_t nVersion = 0, nFlags = 0;
+	if (!parse_hex(s.data(), 2, nVersion) || nVersion == 0xff) return false;
+	//. version 00 is exactly this long; later versions may append "-..." fields.
+	if (nVersion == 0 ? s.size() != MI_TRACEPARENT_LEN : s.size() > MI_TRACEPARENT_LEN && s[MI_TRACEPARENT_LEN] != '-') return false;
+	if (!parse_hex(s.data() + 3, 16, p_nTraceHi) || !parse_hex(s.data() + 19, 16, p_nTraceLo)) return false;
+	if (!parse_hex(s.data() + 36, 16, p_nParent) || !parse_hex(s.data() + 53, 2, nFlags)) return false;
+	if ((p_nTraceHi == 0 && p_nTraceLo == 0) || p_nParent == 0) return false;
+	p_nFlags = (uint8_t)nFlags;
+	return true;
+}
+
+void mi_traceparent_format(char* p_psz, size_t p_nSize, uint64_t p_nTraceHi, uint64_t p_nTraceLo, uint64_t p_nSpan, uint8_t p_nFlags)
+{
+	snprintf(p_psz, p_nSize, "00-%016llx%016llx-%016llx-%02x", (unsigned long long)p_nTraceHi, (unsigned long long)p_nTraceLo,
+		(unsigned long long)p_nSpan, (unsigned)p_nFlags);
+}
+
+uint64_t mi_trace_random_id()
+{
+	//. splitmix64 per thread, seeded once from the OS.
+	static thread_local uint64_t lv_nState = 0;
+	if (lv_nState == 0) {
+		std::random_device rd;
+		lv_nState = ((uint64_t)rd() << 32) ^ rd() ^ (uint64_t)(uintptr_t)&lv_nState
+			^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+	for (;;) {
+		uint64_t z = (lv_nState += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		z ^= z >> 31;
+		if (z != 0) return z;
+	}
+}
+
+int64_t mi_otlp_unix_ns(std::chrono::steady_clock::time_point p_t)
+{
+	//. one offset for the process : spans keep their steady order.
+	static const int64_t lv_nOffsetNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+		- std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(p_t.time_since_epoch()).count() + lv_nOffsetNs;
+}
+
+static void put_escaped(std::string& p_out, const std::string& p_str)
+{
+	for (char c : p_str) {
+		if (c == '"' || c == '\\') p_out.push_back('\\');
+		if ((unsigned char)c >= 0x20) p_out.push_back(c);
+	}
+}
+
+//. ExportTraceServiceRequest in the OTLP JSON mapping : ids as hex, times as decimal strings.
+static void build_request(const std::vector<OtlpSpan>& p_vSpans, std::string& p_out)
+{
+	char sz[96];
+	p_out.clear();
+	p_out.reserve(256 + p_vSpans.size() * 256);
+	p_out += "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\",\"value\":{\"stringValue\":\"";
+	put_escaped(p_out, lv_settings.service);
+	p_out += "\"}}]},\"scopeSpans\":[{\"scope\":{\"name\":\"idliveface\"},\"spans\":[";
+	for (size_t i = 0; i < p_vSpans.size(); i++) {
+		const OtlpSpan& s = p_vSpans[i];
+		if (i > 0) p_out.push_back(',');
+		snprintf(sz, sizeof(sz), "{\"traceId\":\"%016llx%016llx\",\"spanId\":\"%016llx\"", (unsigned long long)s.traceHi, (unsigned long long)s.traceLo, (unsigned long long)s.spanId);
+		p_out += sz;
+		if (s.parentId != 0) {
+			snprintf(sz, sizeof(sz), ",\"parentSpanId\":\"%016llx\"", (unsigned long long)s.parentId);
+			p_out += sz;
+		}
+		p_out += ",\"name\":\"";
+		put_escaped(p_out, s.name);
+		snprintf(sz, sizeof(sz), "\",\"kind\":%d,\"startTimeUnixNano\":\"%lld\",\"endTimeUnixNano\":\"%lld\"}", s.kind, (long long)s.startNs, (long long)s.endNs);
+		p_out += sz;
+	}
+	p_out += "]}]}]}";
+}
+
+static bool post(Poco::Net::HTTPClientSession& p_session, const std::string& p_strBody)
+{
+	try {
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST, lv_uri.getPathEtc().empty() ? "/" : lv_uri.getPathEtc(), Poco::Net::HTTPMessage::HTTP_1_1);
+		request.setKeepAlive(true);
+		request.setContentType("application/json");
+		request.setContentLength64((Poco::Int64)p_strBody.size());
+		p_session.sendRequest(request).write(p_strBody.data(), (std::streamsize)p_strBody.size());
+		Poco::Net::HTTPResponse response;
+		Poco::NullOutputStream discard;
+		Poco::StreamCopier::copyStream(p_session.receiveResponse(response), discard);
+		return response.getStatus() >= 200 && response.getStatus() < 300;
+	}
+	catch (Poco::Exception&) {
+		p_session.reset();
+		return false;
+	}
+}
+
+static void exporter()
+{
+	Poco::Net::HTTPClientSession session(lv_uri.getHost(), lv_uri.getPort());
+	session.setKeepAlive(true);
+	session.setTimeout(Poco::Timespan(LD_OTLP_TIMEOUT_SEC, 0));
+	std::vector<OtlpSpan> vBatch;
+	std::string strBody;
+	std::unique_lock<std::mutex> lock(lv_mtx);
+	for (;;) {
+		std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now() + std::chrono::milliseconds(lv_settings.intervalMs);
+		lv_cv.wait_until(lock, due, [] { return lv_bStop || lv_vQueue.size() >= (size_t)lv_settings.batch; });
+		bool bStop = lv_bStop;
+		while (!lv_vQueue.empty()) {
+			size_t n = std::min(lv_vQueue.size(), (size_t)lv_settings.batch);
+			vBatch.assign(lv_vQueue.begin(), lv_vQueue.begin() + (std::ptrdiff_t)n);
+			lv_vQueue.erase(lv_vQueue.begin(), lv_vQueue.begin() + (std::ptrdiff_t)n);
+			lock.unlock();
+			build_request(vBatch, strBody);
+			if (post(session, strBody)) lv_nExported.fetch_add(n, std::memory_order_relaxed);
+			else lv_nFailed.fetch_add(n, std::memory_order_relaxed);
+			lock.lock();
+			//. a full batch goes at once, the rest waits for its interval.
+			if (!bStop && lv_vQueue.size() < (size_t)lv_settings.batch) break;
+		}
+		if (bStop) return;
+	}
+}
+
+bool mi_otlp_start(const OtlpSettings& p_settings, std::string& p_strErr)
+{
+	try {
+		lv_uri = Poco::URI(p_settings.endpoint);
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		return false;
+	}
+	if (lv_uri.getScheme() != "http" || lv_uri.getHost().empty()) {
+		p_strErr = "endpoint must be http://host:port/path";
+		return false;
+	}
+	lv_settings = p_settings;
+	if (lv_settings.batch < 1) lv_settings.batch = 1;
+	if (lv_settings.intervalMs < 1) lv_settings.intervalMs = 1;
+	if (lv_settings.queue < lv_settings.batch) lv_settings.queue = lv_settings.batch;
+	lv_vQueue.reserve((size_t)lv_settings.queue);
+	lv_bStop = false;
+	lv_thread = std::thread(exporter);
+	lv_bEnabled.store(true, std::memory_order_release);
+	std::cout << "OTLP : spans to " << p_settings.endpoint << " as " << lv_settings.service << std::endl;
+	return true;
+}
+
+void mi_otlp_stop()
+{
+	if (!lv_bEnabled.exchange(false)) return;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	if (lv_thread.joinable()) lv_thread.join();
+}
+
+bool mi_otlp_enabled()
+{
+	return lv_bEnabled.load(std::memory_order_acquire);
+}
+
+void mi_otlp_export(const OtlpSpan& p_span)
+{
+	if (!mi_otlp_enabled()) return;
+	bool bWake = false;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtx);
+		if (lv_vQueue.size() >= (size_t)lv_settings.queue) {
+			lv_nDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		lv_vQueue.push_back(p_span);
+		bWake = lv_vQueue.size() == (size_t)lv_settings.batch;
+	}
+	if (bWake) lv_cv.notify_one();
+}
+
+uint64_t mi_otlp_exported()
+{
+	return lv_nExported.load(std::memory_order_relaxed);
+}
+
+uint64_t mi_otlp_dropped()
+{
+	return lv_nDropped.load(std::memory_order_relaxed);
+}
+
+uint64_t mi_otlp_failed()
+{
+	return lv_nFailed.load(std::memory_order_relaxed);
+}
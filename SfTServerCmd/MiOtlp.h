@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+//. W3C trace context and OTLP span export, shared by the server (MiTrace.h) and the
+//. mi_id_svc proxy, so one trace runs from the proxy's forward to the worker's SDK calls.
+//. traceparent is "00-<32 hex trace id>-<16 hex parent span id>-<2 hex flags>", flag 01 =
+//. sampled; other versions are read by the same leading fields as the spec asks.
+//. Spans go to a bounded queue (nothing blocks a request; a full queue drops and counts)
+//. that one exporter thread sends as OTLP/HTTP JSON (POST <endpoint>, normally
+//. http://collector:4318/v1/traces) every interval_ms or once batch spans are waiting.
+//. A failed POST loses its batch, counted. Plain http only.
+//. Self-contained on Poco::Net, no server headers : the proxy builds it as it is.
+
+#define MI_TRACEPARENT_HEADER	"traceparent"
+#define MI_TRACEPARENT_LEN		55
+#define MI_TRACE_FLAG_SAMPLED	0x01
+
+//. OTLP SpanKind
+enum OtlpKind {
+	MI_OTLP_INTERNAL = 1,
+	MI_OTLP_SERVER = 2,
+	MI_OTLP_CLIENT = 3
+};
+
+struct OtlpSpan {
+	uint64_t	traceHi;
+	uint64_t	traceLo;
+	uint64_t	spanId;
+	uint64_t	parentId;		//. 0 = root
+	const char*	name;			//. literal, only the pointer is queued
+	int			kind;			//. OtlpKind
+	int64_t		startNs;		//. unix time
+	int64_t		endNs;
+};
+
+struct OtlpSettings {
+	std::string	endpoint;		//. http://host:port/path
+	std::string	service;		//. service.name of the resource
+	int			batch;			//. spans per POST
+	int			intervalMs;		//. longest a span waits
+	int			queue;			//. spans waiting at most
+};
+
+//. false for a malformed header, an all-zero trace or parent id, or version ff.
+bool mi_traceparent_parse(const std::string& p_strHeader, uint64_t& p_nTraceHi, uint64_t& p_nTraceLo, uint64_t& p_nParent, uint8_t& p_nFlags);
+//. writes the header value (MI_TRACEPARENT_LEN characters + NUL) into p_psz.
+void mi_traceparent_format(char* p_psz, size_t p_nSize, uint64_t p_nTraceHi, uint64_t p_nTraceLo, uint64_t p_nSpan, uint8_t p_nFlags);
+//. random non-zero id (span ids, both halves of a trace id).
+uint64_t mi_trace_random_id();
+
+//. starts the exporter; false with the reason for an endpoint it cannot use.
+bool mi_otlp_start(const OtlpSettings& p_settings, std::string& p_strErr);
+//. sends what is queued and stops the thread.
+void mi_otlp_stop();
+bool mi_otlp_enabled();
+
+//. queues one finished span; never blocks.
+void mi_otlp_export(const OtlpSpan& p_span);
+//. unix nanoseconds of a steady clock point.
+int64_t mi_otlp_unix_ns(std::chrono::steady_clock::time_point p_t);
+
+//. spans posted, dropped on a full queue, lost with a failed POST.
+uint64_t mi_otlp_exported();
+uint64_t mi_otlp_dropped();
+uint64_t mi_otlp_failed();
@@ -0,0 +1,280 @@
+#include "MiParquet.h"
+#include <string.h>
+
+#define LD_PARQUET_MAGIC		"PAR1"
+
+//. parquet.thrift values used here.
+enum {
+	LD_TYPE_INT64 = 2,
+	LD_TYPE_FLOAT = 4,
+	LD_TYPE_BYTE_ARRAY = 6,
+	LD_REPETITION_REQUIRED = 0,
+	LD_REPETITION_OPTIONAL = 1,
+	LD_CONVERTED_UTF8 = 0,
+	LD_ENCODING_PLAIN = 0,
+	LD_ENCODING_RLE = 3,
+	LD_CODEC_UNCOMPRESSED = 0,
+	LD_PAGE_DATA = 0
+};
+
+//. Thrift compact protocol, the subset the Parquet metadata needs.
+class CompactWriter {
+public:
+	enum {
+		T_I32 = 5,
+		T_I64 = 6,
+		T_BINARY = 8,
+		T_LIST = 9,
+		T_STRUCT = 12
+	};
+
+	explicit CompactWriter(std::string& p_out) : m_out(p_out), m_nLast(0) {}
+
+	void field_i32(int p_nId, int32_t p_n) { header(p_nId, T_I32); varint(zigzag(p_n)); }
+	void field_i64(int p_nId, int64_t p_n) { header(p_nId, T_I64); varint(zigzag(p_n)); }
+	void field_string(int p_nId, const std::string& p_str) { header(p_nId, T_BINARY); string(p_str); }
+	//. the elements follow : i32 / string values, or begin_struct ... end_struct each.
+	void field_list(int p_nId, int p_nElemType, size_t p_nSize)
+	{
+		header(p_nId, T_LIST);
+		if (p_nSize < 15) m_out.push_back((char)((p_nSize << 4) | p_nElemType));
+		else {
+			m_out.push_back((char)(0xF0 | p_nElemType));
+			varint(p_nSize);
+		}
+	}
+	void field_struct(int p_nId) { header(p_nId, T_STRUCT); begin_struct(); }
+	void begin_struct() { m_vStack.push_back(m_nLast); m_nLast = 0; }
+	void end_struct() { m_out.push_back(0); m_nLast = m_vStack.back(); m_vStack.pop_back(); }
+
+	void i32(int32_t p_n) { varint(zigzag(p_n)); }
+	void string(const std::string& p_str) { varint(p_str.size()); m_out.append(p_str); }
+	void stop() { m_out.push_back(0); }
+
+private:
+	static uint64_t zigzag(int64_t p_n) { return ((uint64_t)p_n << 1) ^ (uint64_t)(p_n >> 63); }
+	void varint(uint64_t p_n)
+	{
+		while (p_n >= 0x80) {
+			m_out.push_back((char)(p_n | 0x80));
+			p_n >>= 7;
+		}
+		m_out.push_back((char)p_n);
+	}
+	void header(int p_nId, int p_nType)
+	{
+		int nDelta = p_nId - m_nLast;
+		if (nDelta > 0 && nDelta <= 15) m_out.push_back((char)((nDelta << 4) | p_nType));
+		else {
+			m_out.push_back((char)p_nType);
+			varint(zigzag(p_nId));
+		}
+		m_nLast = p_nId;
+	}
+
+	std::string&		m_out;
+	int					m_nLast;
+	std::vector<int>	m_vStack;
+};
+
+static void put_le32(std::string& p_out, uint32_t p_n)
+{
+	char b[4] = { (char)p_n, (char)(p_n >> 8), (char)(p_n >> 16), (char)(p_n >> 24) };
+	p_out.append(b, 4);
+}
+
+static int physical_type(ParquetType p_type)
+{
+	return p_type == MI_PARQUET_INT64 ? LD_TYPE_INT64 : p_type == MI_PARQUET_FLOAT ? LD_TYPE_FLOAT : LD_TYPE_BYTE_ARRAY;
+}
+
+//. definition levels of bit width 1 as bit-packed runs of the RLE / bit-packing hybrid,
+//. behind their 4-byte length.
+static void put_levels(std::string& p_out, const std::vector<uint8_t>& p_vPresent)
+{
+	std::string levels;
+	size_t nGroups = (p_vPresent.size() + 7) / 8;
+	//. one run for the page : its header is the group count, a ULEB128 varint.
+	uint64_t nHeader = ((uint64_t)nGroups << 1) | 1;
+	while (nHeader >= 0x80) {
+		levels.push_back((char)(nHeader | 0x80));
+		nHeader >>= 7;
+	}
+	levels.push_back((char)nHeader);
+	size_t nFirst = levels.size();
+	levels.resize(nFirst + nGroups, 0);
+	for (size_t i = 0; i < p_vPresent.size(); i++) {
+		if (p_vPresent[i]) levels[nFirst + i / 8] |= (char)(1 << (i % 8));
+	}
+	put_le32(p_out, (uint32_t)levels.size());
+	p_out.append(levels);
+}
+
+ParquetWriter::ParquetWriter(const std::vector<ParquetColumn>& p_vColumns)
+	: m_nOffset(0), m_nRows(0), m_nTotalRows(0), m_bFailed(false), m_bClosed(false)
+{
+	m_vColumns.resize(p_vColumns.size());
+	for (size_t i = 0; i < p_vColumns.size(); i++) m_vColumns[i].def = p_vColumns[i];
+}
+
+ParquetWriter::~ParquetWriter()
+{
+	if (m_out.is_open() && !m_bClosed) close();
+}
+
+bool ParquetWriter::open(const std::string& p_strPath)
+{
+	m_out.open(p_strPath, std::ios::binary | std::ios::trunc);
+	if (!m_out) return false;
+	return write(LD_PARQUET_MAGIC);
+}
+
+void ParquetWriter::put_int64(size_t p_nColumn, int64_t p_n)
+{
+	Column& c = m_vColumns[p_nColumn];
+	char b[8];
+	for (int i = 0; i < 8; i++) b[i] = (char)((uint64_t)p_n >> (8 * i));
+	c.values.append(b, 8);
+	if (c.def.optional) c.present.push_back(1);
+}
+
+void ParquetWriter::put_float(size_t p_nColumn, float p_f)
+{
+	Column& c = m_vColumns[p_nColumn];
+	uint32_t n;
+	memcpy(&n, &p_f, 4);
+	put_le32(c.values, n);
+	if (c.def.optional) c.present.push_back(1);
+}
+
+void ParquetWriter::put_string(size_t p_nColumn, const char* p_p, size_t p_nLen)
+{
+	Column& c = m_vColumns[p_nColumn];
+	put_le32(c.values, (uint32_t)p_nLen);
+	c.values.append(p_p, p_nLen);
+	if (c.def.optional) c.present.push_back(1);
+}
+
+void ParquetWriter::put_null(size_t p_nColumn)
+{
+	m_vColumns[p_nColumn].present.push_back(0);
+}
+
+bool ParquetWriter::write(const std::string& p_str)
+{
+	if (m_bFailed) return false;
+	m_out.write(p_str.data(), (std::streamsize)p_str.size());
+	if (!m_out) {
+		m_bFailed = true;
+		return false;
+	}
+	m_nOffset += (int64_t)p_str.size();
+	return true;
+}
+
+bool ParquetWriter::flush()
+{
+	if (m_bFailed) return false;
+	if (m_nRows == 0) return true;
+	RowGroup group;
+	group.bytes = 0;
+	group.rows = (int64_t)m_nRows;
+	std::string page, header;
+	for (Column& c : m_vColumns) {
+		page.clear();
+		if (c.def.optional) put_levels(page, c.present);
+		page.append(c.values);
+
+		header.clear();
+		CompactWriter w(header);
+		w.field_i32(1, LD_PAGE_DATA);
+		w.field_i32(2, (int32_t)page.size());
+		w.field_i32(3, (int32_t)page.size());
+		w.field_struct(5);
+		w.field_i32(1, (int32_t)m_nRows);
+		w.field_i32(2, LD_ENCODING_PLAIN);
+		w.field_i32(3, LD_ENCODING_RLE);
+		w.field_i32(4, LD_ENCODING_RLE);
+		w.end_struct();
+		w.stop();
+
+		Chunk chunk;
+		chunk.offset = m_nOffset;
+		chunk.size = (int64_t)(header.size() + page.size());
+		chunk.values = (int64_t)m_nRows;
+		if (!write(header) || !write(page)) return false;
+		group.chunks.push_back(chunk);
+		group.bytes += chunk.size;
+		c.values.clear();
+		c.present.clear();
+	}
+	m_vGroups.push_back(group);
+	m_nTotalRows += m_nRows;
+	m_nRows = 0;
+	return true;
+}
+
+void ParquetWriter::footer(std::string& p_out) const
+{
+	CompactWriter w(p_out);
+	w.field_i32(1, 1);
+	w.field_list(2, CompactWriter::T_STRUCT, m_vColumns.size() + 1);
+	w.begin_struct();
+	w.field_string(4, "schema");
+	w.field_i32(5, (int32_t)m_vColumns.size());
+	w.end_struct();
+	for (const Column& c : m_vColumns) {
+		w.begin_struct();
+		w.field_i32(1, physical_type(c.def.type));
+		w.field_i32(3, c.def.optional ? LD_REPETITION_OPTIONAL : LD_REPETITION_REQUIRED);
+		w.field_string(4, c.def.name);
+		if (c.def.type == MI_PARQUET_STRING) w.field_i32(6, LD_CONVERTED_UTF8);
+		w.end_struct();
+	}
+	w.field_i64(3, (int64_t)m_nTotalRows);
+	w.field_list(4, CompactWriter::T_STRUCT, m_vGroups.size());
+	for (const RowGroup& g : m_vGroups) {
+		w.begin_struct();
+		w.field_list(1, CompactWriter::T_STRUCT, g.chunks.size());
+		for (size_t i = 0; i < g.chunks.size(); i++) {
+			const Chunk& chunk = g.chunks[i];
+			const Column& c = m_vColumns[i];
+			w.begin_struct();
+			w.field_i64(2, chunk.offset);
+			w.field_struct(3);
+			w.field_i32(1, physical_type(c.def.type));
+			w.field_list(2, CompactWriter::T_I32, 2);
+			w.i32(LD_ENCODING_PLAIN);
+			w.i32(LD_ENCODING_RLE);
+			w.field_list(3, CompactWriter::T_BINARY, 1);
+			w.string(c.def.name);
+			w.field_i32(4, LD_CODEC_UNCOMPRESSED);
+			w.field_i64(5, chunk.values);
+			w.field_i64(6, chunk.size);
+			w.field_i64(7, chunk.size);
+			w.field_i64(9, chunk.offset);
+			w.end_struct();
+			w.end_struct();
+		}
+		w.field_i64(2, g.bytes);
+		w.field_i64(3, g.rows);
+		w.end_struct();
+	}
+	w.field_string(6, "SfTServerCmd");
+	w.stop();
+}
+
+bool ParquetWriter::close()
+{
+	if (m_bClosed) return !m_bFailed;
+	m_bClosed = true;
+	if (!flush()) return false;
+	std::string meta;
+	footer(meta);
+	uint32_t nLen = (uint32_t)meta.size();
+	put_le32(meta, nLen);
+	meta.append(LD_PARQUET_MAGIC);
+	if (!write(meta)) return false;
+	m_out.close();
+	return !m_out.fail();
+}
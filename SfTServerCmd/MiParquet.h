@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//. A flat Apache Parquet file written without the Arrow / parquet-cpp libraries : the
+//. columns a warehouse loads bulk results from (64-bit integers, floats, UTF-8 strings,
+//. each required or optional), rows buffered per column and written as one row group per
+//. flush() - one PLAIN data page per column, uncompressed, the definition levels of an
+//. optional column bit-packed - and the footer (Thrift compact FileMetaData) by close().
+//. Nothing is read back, so a file whose close() never ran has no footer and is unreadable.
+//. Not thread-safe : one writer thread owns it.
+
+enum ParquetType {
+	MI_PARQUET_INT64 = 0,
+	MI_PARQUET_FLOAT,
+	MI_PARQUET_STRING
+};
+
+struct ParquetColumn {
+	std::string		name;
+	ParquetType		type;
+	bool			optional;		//. may hold nulls
+};
+
+class ParquetWriter {
+public:
+	explicit ParquetWriter(const std::vector<ParquetColumn>& p_vColumns);
+	~ParquetWriter();
+
+	bool open(const std::string& p_strPath);
+
+	//. one value for every column, then end_row().
+	void put_int64(size_t p_nColumn, int64_t p_n);
+	void put_float(size_t p_nColumn, float p_f);
+	void put_string(size_t p_nColumn, const char* p_p, size_t p_nLen);
+	void put_string(size_t p_nColumn, const std::string& p_str) { put_string(p_nColumn, p_str.data(), p_str.size()); }
+	//. optional columns only.
+	void put_null(size_t p_nColumn);
+	void end_row() { m_nRows++; }
+
+	//. rows buffered for the next row group.
+	size_t rows() const { return m_nRows; }
+	uint64_t total_rows() const { return m_nTotalRows; }
+	//. the buffered rows as one row group; false once a write failed.
+	bool flush();
+	//. flush() and the footer.
+	bool close();
+
+private:
+	ParquetWriter(const ParquetWriter&) = delete;
+	ParquetWriter& operator=(const ParquetWriter&) = delete;
+
+	struct Column {
+		ParquetColumn			def;
+		std::string				values;		//. PLAIN encoded
+		std::vector<uint8_t>	present;	//. optional : 1 per row with a value
+	};
+	struct Chunk {
+		int64_t		offset;
+		int64_t		size;
+		int64_t		values;
+	};
+	struct RowGroup {
+		std::vector<Chunk>	chunks;
+		int64_t				bytes;
+		int64_t				rows;
+	};
+
+	bool write(const std::string& p_str);
+	void footer(std::string& p_out) const;
+
+	std::vector<Column>		m_vColumns;
+	std::vector<RowGroup>	m_vGroups;
+	std::ofstream			m_out;
+	int64_t					m_nOffset;
+	size_t					m_nRows;
+	uint64_t				m_nTotalRows;
+	bool					m_bFailed;
+	bool					m_bClosed;
+};
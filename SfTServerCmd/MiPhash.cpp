@@ -0,0 +1,236 @@
+#include "MiPhash.h"
+#include "MiResize.h"
+#include "MiLock.h"
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_PHASH_SSE 1		//. SSE2 is part of x64
+#include <emmintrin.h>
+#else
+#define LD_PHASH_SSE 0
+#endif
+
+#define LD_SIDE		32		//. gray image the DCT runs on
+#define LD_FREQ		8		//. lowest frequencies kept per axis
+#define LD_WORDS	4		//. 16-bit words of the multi-index
+
+static const char* lv_szOutcomes[MI_PHASH_COUNT] = { "miss", "flagged", "reused" };
+
+//. orthogonal DCT-II basis, LD_FREQ rows of LD_SIDE.
+struct DctTable {
+	float c[LD_FREQ][LD_SIDE];
+	DctTable() {
+		const double pi = 3.14159265358979323846;
+		for (int k = 0; k < LD_FREQ; k++) {
+			double scale = k == 0 ? sqrt(1.0 / LD_SIDE) : sqrt(2.0 / LD_SIDE);
+			for (int x = 0; x < LD_SIDE; x++) c[k][x] = (float)(scale * cos(pi * (2 * x + 1) * k / (2.0 * LD_SIDE)));
+		}
+	}
+};
+static const DctTable lv_dct;
+
+struct PhashEntry {
+	uint64_t								hash;
+	uint64_t								variant;
+	CPipelineResult_t						result;
+	std::chrono::steady_clock::time_point	expire;
+};
+
+static bool										lv_bEnable = false;
+static bool										lv_bReuse = false;
+static int										lv_nMaxDistance = 0;
+static size_t									lv_nMaxEntries = 0;
+static std::chrono::seconds						lv_ttl(0);
+static MI_MUTEX(lv_mtx, "phash");
+static std::vector<PhashEntry>					lv_vEntries;		//. ring, lv_nNext is overwritten next
+static size_t									lv_nNext = 0;
+static std::unordered_map<uint16_t, std::vector<uint32_t>>	lv_mapWords[LD_WORDS];
+
+static inline uint16_t word_of(uint64_t p_nHash, int p_nWord)
+{
+	return (uint16_t)(p_nHash >> (16 * p_nWord));
+}
+
+const char* mi_phash_outcome_name(int p_nOutcome)
+{
+	return p_nOutcome >= 0 && p_nOutcome < MI_PHASH_COUNT ? lv_szOutcomes[p_nOutcome] : "unknown";
+}
+
+void mi_phash_init(bool p_bEnable, bool p_bReuse, int p_nMaxDistance, size_t p_nMaxEntries, int p_nTtlSec)
+{
+	MiLockGuard lock(lv_mtx);
+	lv_bEnable = p_bEnable && p_nMaxEntries > 0;
+	lv_bReuse = p_bReuse;
+	//. beyond 7 bits a word may differ in two bits, which the probes do not cover.
+	lv_nMaxDistance = std::min(std::max(p_nMaxDistance, 0), 2 * LD_WORDS - 1);
+	lv_nMaxEntries = p_nMaxEntries;
+	lv_ttl = std::chrono::seconds(p_nTtlSec > 0 ? p_nTtlSec : 0);
+	lv_vEntries.clear();
+	lv_nNext = 0;
+	for (int w = 0; w < LD_WORDS; w++) lv_mapWords[w].clear();
+}
+
+void mi_phash_clear()
+{
+	MiLockGuard lock(lv_mtx);
+	lv_vEntries.clear();
+	lv_nNext = 0;
+	for (int w = 0; w < LD_WORDS; w++) lv_mapWords[w].clear();
+}
+
+bool mi_phash_enabled()
+{
+	return lv_bEnable;
+}
+
+bool mi_phash_reuse()
+{
+	return lv_bReuse;
+}
+
+size_t mi_phash_entries()
+{
+	MiLockGuard lock(lv_mtx);
+	return lv_vEntries.size();
+}
+
+int mi_phash_distance(uint64_t p_a, uint64_t p_b)
+{
+	uint64_t x = p_a ^ p_b;
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+uint64_t mi_phash_bgr(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, bool p_bRgb)
+{
+	uint8_t small[LD_SIDE * LD_SIDE * 3];
+	mi_resize_bgr(p_pPixels, p_nWidth, p_nHeight, p_nStride, small, LD_SIDE, LD_SIDE, LD_SIDE * 3);
+
+	//. BT.601 luma; the order of the outer channels is all RGB and BGR differ in.
+	float wFirst = p_bRgb ? 0.299f : 0.114f, wLast = p_bRgb ? 0.114f : 0.299f;
+	alignas(16) float gray[LD_SIDE * LD_SIDE];
+	for (int i = 0; i < LD_SIDE * LD_SIDE; i++) gray[i] = wFirst * small[i * 3] + 0.587f * small[i * 3 + 1] + wLast * small[i * 3 + 2];
+
+	//. rows : rowFreq[y][k] = sum over x of gray[y][x] * c[k][x].
+	alignas(16) float rowFreq[LD_SIDE][LD_FREQ];
+	for (int y = 0; y < LD_SIDE; y++) {
+		const float* g = gray + y * LD_SIDE;
+		for (int k = 0; k < LD_FREQ; k++) {
+#if LD_PHASH_SSE
+			__m128 acc = _mm_setzero_ps();
+			for (int x = 0; x < LD_SIDE; x += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(g + x), _mm_loadu_ps(&lv_dct.c[k][x])));
+			acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+			acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+			rowFreq[y][k] = _mm_cvtss_f32(acc);
+#else
+			float acc = 0;
+			for (int x = 0; x < LD_SIDE; x++) acc += g[x] * lv_dct.c[k][x];
+			rowFreq[y][k] = acc;
+#endif
+		}
+	}
+	//. columns : freq[v][k] = sum over y of c[v][y] * rowFreq[y][k], eight k at once.
+	float freq[LD_FREQ * LD_FREQ];
+	for (int v = 0; v < LD_FREQ; v++) {
+#if LD_PHASH_SSE
+		__m128 lo = _mm_setzero_ps(), hi = _mm_setzero_ps();
+		for (int y = 0; y < LD_SIDE; y++) {
+			__m128 cv = _mm_set1_ps(lv_dct.c[v][y]);
+			lo = _mm_add_ps(lo, _mm_mul_ps(cv, _mm_load_ps(&rowFreq[y][0])));
+			hi = _mm_add_ps(hi, _mm_mul_ps(cv, _mm_load_ps(&rowFreq[y][4])));
+		}
+		_mm_storeu_ps(&freq[v * LD_FREQ], lo);
+		_mm_storeu_ps(&freq[v * LD_FREQ + 4], hi);
+#else
+		for (int k = 0; k < LD_FREQ; k++) {
+			float acc = 0;
+			for (int y = 0; y < LD_SIDE; y++) acc += lv_dct.c[v][y] * rowFreq[y][k];
+			freq[v * LD_FREQ + k] = acc;
+		}
+#endif
+	}
+
+	//. median of the AC terms; the DC term (mean brightness) is left out of it.
+	float ac[LD_FREQ * LD_FREQ - 1];
+	std::copy(freq + 1, freq + LD_FREQ * LD_FREQ, ac);
+	std::nth_element(ac, ac + (LD_FREQ * LD_FREQ - 1) / 2, ac + LD_FREQ * LD_FREQ - 1);
+	float median = ac[(LD_FREQ * LD_FREQ - 1) / 2];
+
+	uint64_t hash = 0;
+	for (int i = 0; i < LD_FREQ * LD_FREQ; i++) {
+		if (freq[i] > median) hash |= (uint64_t)1 << i;
+	}
+	return hash;
+}
+
+bool mi_phash_find(uint64_t p_nHash, uint64_t p_nVariant, CPipelineResult_t* p_pResult, int* p_pDistance)
+{
+	if (!lv_bEnable) return false;
+	//. a word may differ in (distance / words) bits and still be the closest one.
+	int nFlips = lv_nMaxDistance / LD_WORDS;
+	auto now = std::chrono::steady_clock::now();
+	MiLockGuard lock(lv_mtx);
+	int best = lv_nMaxDistance + 1;
+	const PhashEntry* pBest = NULL;
+	for (int w = 0; w < LD_WORDS; w++) {
+		uint16_t word = word_of(p_nHash, w);
+		for (int b = -1; b < (nFlips > 0 ? 16 : 0); b++) {
+			auto it = lv_mapWords[w].find(b < 0 ? word : (uint16_t)(word ^ (1 << b)));
+			if (it == lv_mapWords[w].end()) continue;
+			for (uint32_t slot : it->second) {
+				const PhashEntry& e = lv_vEntries[slot];
+				if (e.variant != p_nVariant || e.expire <= now) continue;
+				int d = mi_phash_distance(e.hash, p_nHash);
+				if (d < best) {
+					best = d;
+					pBest = &e;
+				}
+			}
+		}
+	}
+	if (pBest == NULL) return false;
+	if (p_pResult != NULL) *p_pResult = pBest->result;
+	if (p_pDistance != NULL) *p_pDistance = best;
+	return true;
+}
+
+static void unlink_words(uint64_t p_nHash, uint32_t p_nSlot)
+{
+	for (int w = 0; w < LD_WORDS; w++) {
+		auto it = lv_mapWords[w].find(word_of(p_nHash, w));
+		if (it == lv_mapWords[w].end()) continue;
+		std::vector<uint32_t>& v = it->second;
+		v.erase(std::remove(v.begin(), v.end(), p_nSlot), v.end());
+		if (v.empty()) lv_mapWords[w].erase(it);
+	}
+}
+
+void mi_phash_insert(uint64_t p_nHash, uint64_t p_nVariant, const CPipelineResult_t& p_result)
+{
+	if (!lv_bEnable) return;
+	PhashEntry e;
+	e.hash = p_nHash;
+	e.variant = p_nVariant;
+	e.result = p_result;
+	e.expire = std::chrono::steady_clock::now() + lv_ttl;
+	MiLockGuard lock(lv_mtx);
+	uint32_t slot;
+	if (lv_vEntries.size() < lv_nMaxEntries) {
+		slot = (uint32_t)lv_vEntries.size();
+		lv_vEntries.push_back(e);
+	}
+	else {
+		//. the oldest entry makes room.
+		slot = (uint32_t)lv_nNext;
+		lv_nNext = (lv_nNext + 1) % lv_nMaxEntries;
+		unlink_words(lv_vEntries[slot].hash, slot);
+		lv_vEntries[slot] = e;
+	}
+	for (int w = 0; w < LD_WORDS; w++) lv_mapWords[w][word_of(p_nHash, w)].push_back(slot);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FaceSdkApi.h"
+
+//. Near-duplicate index of face crops ([phash] settings). The byte hash of the result
+//. cache (MiResultCache.h) misses the same selfie re-encoded by another client; this
+//. keys on what it shows instead : the 64-bit pHash of the face crop of the fast path
+//. (MiFaceCrop.h), i.e. the signs of the 8 x 8 lowest DCT frequencies of the crop scaled
+//. to 32 x 32 gray against their median. Recompression, rescaling and small colour
+//. shifts change few of its bits.
+//. Lookups find an earlier verdict within max_distance bits (Hamming) through a
+//. multi-index hash : the hash is cut into four 16-bit words, each a key of its own
+//. table, so an entry within 3 bits shares at least one word exactly and one within 7
+//. shares a word up to one bit (the 16 one-bit neighbours are probed too).
+//. mode = flag marks a near repeat (X-Near-Duplicate response header with the distance)
+//. and still runs the pipeline, mode = reuse answers it with the cached verdict when that is a
+//. rejection (spoofed, bad quality) : a presentation attack replaying a genuine selfie is exactly
+//. a near repeat of it, so genuine verdicts are never reused, only flagged.
+//. The scale-down is mi_resize_bgr, the DCT runs on SSE2 where there is one.
+//. mi_phash_lookups_total{result} and mi_phash_entries are on GD_API_METRICS.
+
+enum PhashOutcome {
+	MI_PHASH_MISS = 0,		//. nothing close enough
+	MI_PHASH_FLAGGED,		//. near repeat, checked again
+	MI_PHASH_REUSED,		//. near repeat, cached verdict returned
+	MI_PHASH_COUNT
+};
+
+const char* mi_phash_outcome_name(int p_nOutcome);
+
+void mi_phash_init(bool p_bEnable, bool p_bReuse, int p_nMaxDistance, size_t p_nMaxEntries, int p_nTtlSec);
+bool mi_phash_enabled();
+bool mi_phash_reuse();
+size_t mi_phash_entries();
+//. drops every entry : their verdicts came from a generation that was swapped out (MiSupervisor.h).
+void mi_phash_clear();
+
+//. pHash of packed 24-bit rows, BGR or (p_bRgb) RGB.
+uint64_t mi_phash_bgr(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, bool p_bRgb = false);
+//. bits in which two hashes differ.
+int mi_phash_distance(uint64_t p_a, uint64_t p_b);
+
+//. closest live entry of the same variant within max_distance; p_pDistance receives its distance.
+bool mi_phash_find(uint64_t p_nHash, uint64_t p_nVariant, CPipelineResult_t* p_pResult, int* p_pDistance);
+void mi_phash_insert(uint64_t p_nHash, uint64_t p_nVariant, const CPipelineResult_t& p_result);
@@ -0,0 +1,459 @@
+#include "MiPipelinePool.h"
+#include "MiConf.h"
+#include "MiIdle.h"
+#include "MiNuma.h"
+#include "MiSettings.h"
+#include "licenseproc.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+PipelinePool* g_pPool = NULL;
+
+static thread_local MiAffinity lv_prevAffinity;
+static thread_local bool lv_bRestoreAffinity = false;
+
+PipelinePool::PipelinePool()
+	: m_bShared(false), m_nParked(0), m_nSpares(0), m_nInstanceRss(0), m_bElastic(false), m_bElasticStop(false),
+	m_nAcquires(0), m_nWaitUs(0), m_nTickAcquires(0), m_nTickWaitUs(0), m_nGrows(0), m_nShrinks(0), m_nOrphans(0), m_nRetired(0), m_nWaiters(0)
+{
+}
+
+PipelinePool::~PipelinePool()
+{
+	destroy();
+}
+
+bool PipelinePool::create(int p_nCount, unsigned int p_nEngineThreads, int p_nCoresPerSlot, bool p_bShared, std::string& p_strErr, int p_nLoaded)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	if (p_nCount < 1) p_nCount = 1;
+	if (p_nLoaded <= 0 || p_nLoaded > p_nCount || p_bShared) p_nLoaded = p_nCount;
+	m_bShared = p_bShared;
+
+	if (p_nEngineThreads > 0) {
+		ThreadingLevel_t level = ENGINE;
+		face_sdk_api().set_num_threads(p_nEngineThreads, &level, &err, msg);
+	}
+
+	//. slot 0 reuses the pipeline setting_init already built.
+	std::unique_ptr<Slot> first(new Slot);
+	first->pipeline = g_Supervisor.current();
+	m_vSlots.push_back(std::move(first));
+
+	size_t nRssBefore = mi_rss();
+	if (p_nCount > 1 && !m_bShared) {
+		CInitConfig_t* config = face_sdk_api().config_create(g_Settings.configDir.c_str(), g_Settings.configName.c_str(), &err, msg);
+		if (config == NULL) {
+			p_strErr = msg;
+			return false;
+		}
+		m_config = std::make_shared<ConfigHandle>(config);
+	}
+	for (int i = 1; i < p_nCount; i++) {
+		int node = i % mi_numa_nodes();
+		std::unique_ptr<Slot> slot(new Slot);
+		slot->node = node;
+		if (m_bShared) {
+			slot->pipeline = m_vSlots[0]->pipeline;
+			m_vSlots.push_back(std::move(slot));
+			continue;
+		}
+		if (i >= p_nLoaded) {
+			//. elastic : loaded by the elastic thread when the load asks for it.
+			slot->busy = true;
+			slot->parked = true;
+			m_nParked++;
+			m_vSlots.push_back(std::move(slot));
+			continue;
+		}
+		//. first-touch : the engine's buffers are allocated on the node that will run it.
+		size_t nRss = mi_rss();
+		NumaPin pin(node);
+		CPipeline_t* p = face_sdk_api().pipeline_create(g_Settings.pipelineName.c_str(), m_config->config, &err, msg);
+		if (p == NULL) {
+			p_strErr = msg;
+			return false;
+		}
+		slot->pipeline = std::make_shared<PipelineHandle>(p, g_Supervisor.generation(), m_config);
+		m_vSlots.push_back(std::move(slot));
+		size_t nAfter = mi_rss();
+		std::cout << "Pipeline pool slot " << i << " : +" << (nAfter > nRss ? (nAfter - nRss) >> 20 : 0) << " MB resident" << std::endl;
+	}
+	size_t nRssAfter = mi_rss();
+	m_nInstanceRss = (p_nLoaded > 1 && nRssAfter > nRssBefore) ? (nRssAfter - nRssBefore) / (p_nLoaded - 1) : 0;
+	std::cout << "Pipeline pool : " << p_nCount << " slots on " << (m_bShared ? "one shared pipeline" : "a pipeline each") << ", ";
+	if (p_nLoaded < p_nCount) std::cout << p_nLoaded << " loaded, ";
+	std::cout << (m_nInstanceRss >> 20) << " MB resident per extra instance" << std::endl;
+
+	if (p_nCoresPerSlot > 0 && !mi_numa_enabled()) {
+		int nCores = (int)std::thread::hardware_concurrency();
+		for (size_t i = 0; i < m_vSlots.size(); i++) {
+			uint64_t mask = 0;
+			for (int c = 0; c < p_nCoresPerSlot; c++) {
+				int core = ((int)i * p_nCoresPerSlot + c) % (nCores > 0 ? nCores : 1);
+				if (core < 64) mask |= ((uint64_t)1 << core);
+			}
+			mi_affinity_from_mask(mask, m_vSlots[i]->affinity);
+			m_vSlots[i]->bPinned = mask != 0;
+		}
+	}
+	return true;
+}
+
+void PipelinePool::destroy()
+{
+	elastic_stop();
+	//. each pipeline goes with its last reference; slot 0 shares the supervisor's.
+	//. the config goes with the last pipeline built from it.
+	m_vSlots.clear();
+	m_config.reset();
+}
+
+bool PipelinePool::try_acquire(size_t p_nSlot)
+{
+	bool expected = false;
+	if (!m_vSlots[p_nSlot]->busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) return false;
+	m_vSlots[p_nSlot]->acquiredMs.store(mi_tick_ms());
+	if (m_vSlots[p_nSlot]->bPinned) {
+		lv_bRestoreAffinity = mi_thread_set_affinity(m_vSlots[p_nSlot]->affinity, &lv_prevAffinity);
+	}
+	return true;
+}
+
+int PipelinePool::try_any()
+{
+	size_t n = m_vSlots.size();
+	size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % n;
+	//. a slot of this thread's node, then any other.
+	if (mi_numa_enabled()) {
+		int node = mi_numa_current_node();
+		for (size_t k = 0; k < n; k++) {
+			size_t i = (start + k) % n;
+			if (m_vSlots[i]->node == node && try_acquire(i)) return (int)i;
+		}
+	}
+	for (size_t k = 0; k < n; k++) {
+		size_t i = (start + k) % n;
+		if (try_acquire(i)) return (int)i;
+	}
+	return -1;
+}
+
+int PipelinePool::acquire()
+{
+	return acquire(std::chrono::steady_clock::time_point::max());
+}
+
+int PipelinePool::acquire(std::chrono::steady_clock::time_point p_limit)
+{
+	int nSlot = try_any();
+	if (m_bElastic) m_nAcquires.fetch_add(1, std::memory_order_relaxed);
+	if (nSlot >= 0) return nSlot;
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		//. counted before the slots are looked at again : a release after that look sees the
+		//. waiter and notifies under m_mtxFree, so the wake-up cannot fall between the look and the wait.
+		m_nWaiters.fetch_add(1);
+		MiUniqueLock lock(m_mtxFree);
+		while ((nSlot = try_any()) < 0) {
+			if (p_limit == std::chrono::steady_clock::time_point::max()) m_cvFree.wait(lock);
+			else if (m_cvFree.wait_until(lock, p_limit) == std::cv_status::timeout) {
+				nSlot = try_any();
+				break;
+			}
+		}
+		m_nWaiters.fetch_sub(1);
+	}
+	if (m_bElastic) {
+		auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+		m_nWaitUs.fetch_add((uint64_t)waited.count(), std::memory_order_relaxed);
+	}
+	return nSlot;
+}
+
+void PipelinePool::release(int p_nSlot, uint32_t p_nLease)
+{
+	if (lv_bRestoreAffinity) {
+		mi_thread_set_affinity(lv_prevAffinity);
+		lv_bRestoreAffinity = false;
+	}
+	Slot& slot = *m_vSlots[p_nSlot];
+	//. retired while the call was stuck : the slot is someone else's now.
+	if (!slot.lease.compare_exchange_strong(p_nLease, p_nLease + 1)) {
+		m_nOrphans.fetch_sub(1, std::memory_order_relaxed);
+		return;
+	}
+	if (m_bElastic) slot.lastUseMs.store(mi_tick_ms(), std::memory_order_relaxed);
+	slot.acquiredMs.store(0);
+	slot.watched.store(false);
+	slot.busy.store(false, std::memory_order_release);
+	freed();
+}
+
+void PipelinePool::freed()
+{
+	//. pairs with the count in acquire : either it sees the free slot or this sees it waiting.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_nWaiters.load() == 0) return;
+	MiLockGuard lock(m_mtxFree);
+	m_cvFree.notify_one();
+}
+
+int PipelinePool::busy() const
+{
+	int n = 0;
+	for (auto& p : m_vSlots) n += p->busy.load(std::memory_order_relaxed) ? 1 : 0;
+	return n - m_nParked.load(std::memory_order_relaxed);
+}
+
+bool PipelinePool::park_slot(size_t p_nSlot, bool p_bKeepSpare)
+{
+	Slot& slot = *m_vSlots[p_nSlot];
+	bool expected = false;
+	if (slot.parked || !slot.busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) return false;
+	slot.parked = true;
+	m_nParked.fetch_add(1, std::memory_order_relaxed);
+	if (p_bKeepSpare) m_nSpares.fetch_add(1, std::memory_order_relaxed);
+	//. the instance goes with the last lease of it.
+	else std::atomic_store(&slot.pipeline, PipelineRef());
+	return true;
+}
+
+bool PipelinePool::load_slot(size_t p_nSlot)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	Slot& slot = *m_vSlots[p_nSlot];
+	if (std::atomic_load(&slot.pipeline)) return true;
+	ConfigRef config = std::atomic_load(&m_config);
+	NumaPin pin(slot.node);
+	CPipeline_t* p = config ? face_sdk_api().pipeline_create(g_Settings.pipelineName.c_str(), config->config, &err, msg) : NULL;
+	if (p == NULL) {
+		std::cout << "Pipeline pool slot " << p_nSlot << " not loaded : " << msg << std::endl;
+		return false;
+	}
+	std::atomic_store(&slot.pipeline, std::make_shared<PipelineHandle>(p, g_Supervisor.generation(), config));
+	if (slot.parked) m_nSpares.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool PipelinePool::open_slot(size_t p_nSlot)
+{
+	Slot& slot = *m_vSlots[p_nSlot];
+	if (!slot.parked || !load_slot(p_nSlot)) return false;
+	slot.parked = false;
+	m_nParked.fetch_sub(1, std::memory_order_relaxed);
+	m_nSpares.fetch_sub(1, std::memory_order_relaxed);
+	slot.lastUseMs.store(mi_tick_ms(), std::memory_order_relaxed);
+	slot.busy.store(false, std::memory_order_release);
+	freed();
+	return true;
+}
+
+int PipelinePool::park(int p_nKeep)
+{
+	if (m_bShared) return 0;
+	MiLockGuard lock(m_mtxResize);
+	int n = 0;
+	for (size_t i = std::max(p_nKeep, 1); i < m_vSlots.size(); i++) {
+		if (park_slot(i, false)) n++;
+	}
+	//. the warm spares go too.
+	for (size_t i = 1; i < m_vSlots.size(); i++) {
+		if (m_vSlots[i]->parked && std::atomic_load(&m_vSlots[i]->pipeline)) {
+			std::atomic_store(&m_vSlots[i]->pipeline, PipelineRef());
+			m_nSpares.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+	return n;
+}
+
+int PipelinePool::unpark()
+{
+	MiLockGuard lock(m_mtxResize);
+	int nTarget = m_bElastic ? m_elastic.minSlots : size();
+	int n = 0;
+	for (size_t i = 1; i < m_vSlots.size() && active() < nTarget; i++) {
+		if (open_slot(i)) n++;
+	}
+	return n;
+}
+
+int PipelinePool::retire_stuck(int p_nLimitMs)
+{
+	if (!replaceable() || p_nLimitMs <= 0) return 0;
+	MiLockGuard lock(m_mtxResize);
+	uint64_t nNow = mi_tick_ms();
+	int n = 0;
+	for (size_t i = 0; i < m_vSlots.size(); i++) {
+		Slot& slot = *m_vSlots[i];
+		//. the epoch first : a release or a new acquire after it fails the exchange below.
+		uint32_t nLease = slot.lease.load();
+		uint64_t nAcquired = slot.acquiredMs.load();
+		if (slot.parked || !slot.watched.load() || nAcquired == 0 || nNow - nAcquired <= (uint64_t)p_nLimitMs) continue;
+		if (!slot.lease.compare_exchange_strong(nLease, nLease + 1)) continue;
+		//. the slot stays busy, held here : the stuck call keeps the old instance until it returns.
+		m_nOrphans.fetch_add(1, std::memory_order_relaxed);
+		m_nRetired.fetch_add(1, std::memory_order_relaxed);
+		n++;
+		std::atomic_store(&slot.pipeline, PipelineRef());
+		slot.acquiredMs.store(0);
+		slot.watched.store(false);
+		if (!load_slot(i)) {
+			slot.parked = true;
+			m_nParked.fetch_add(1, std::memory_order_relaxed);
+			std::cout << "Pipeline pool slot " << i << " : stuck call after " << (nNow - nAcquired) << " ms, slot parked" << std::endl;
+			continue;
+		}
+		std::cout << "Pipeline pool slot " << i << " : stuck call after " << (nNow - nAcquired) << " ms, pipeline replaced" << std::endl;
+		slot.lastUseMs.store(mi_tick_ms(), std::memory_order_relaxed);
+		slot.busy.store(false, std::memory_order_release);
+		freed();
+	}
+	return n;
+}
+
+void PipelinePool::elastic_start(const PoolElastic& p_elastic)
+{
+	if (m_bShared || m_vSlots.size() < 2) return;
+	m_elastic = p_elastic;
+	m_elastic.minSlots = std::max(m_elastic.minSlots, 1);
+	m_elastic.spares = std::max(m_elastic.spares, 0);
+	m_nTickAcquires = m_nAcquires.load();
+	m_nTickWaitUs = m_nWaitUs.load();
+	for (auto& p : m_vSlots) p->lastUseMs = mi_tick_ms();
+	m_bElasticStop = false;
+	m_bElastic = true;
+	m_elasticThread = std::thread(&PipelinePool::elastic_loop, this);
+	std::cout << "Pipeline pool : elastic, " << m_elastic.minSlots << " to " << size() << " slots, grows past a "
+		<< m_elastic.waitMs << " ms mean wait, shrinks after " << m_elastic.idleSec << " s idle, "
+		<< m_elastic.spares << " warm spares" << std::endl;
+}
+
+void PipelinePool::elastic_stop()
+{
+	if (!m_elasticThread.joinable()) return;
+	{
+		MiLockGuard lock(m_mtxElastic);
+		m_bElasticStop = true;
+	}
+	m_cvElastic.notify_all();
+	m_elasticThread.join();
+}
+
+void PipelinePool::elastic_loop()
+{
+	MiUniqueLock lock(m_mtxElastic);
+	while (!m_bElasticStop) {
+		m_cvElastic.wait_for(lock, std::chrono::milliseconds(GD_POOL_ELASTIC_TICK_MS), [this] { return m_bElasticStop; });
+		if (m_bElasticStop) break;
+		lock.unlock();
+		elastic_tick();
+		lock.lock();
+	}
+}
+
+void PipelinePool::elastic_tick()
+{
+	uint64_t nAcquires = m_nAcquires.load(std::memory_order_relaxed), nWaitUs = m_nWaitUs.load(std::memory_order_relaxed);
+	uint64_t nTickAcquires = nAcquires - m_nTickAcquires, nTickWaitUs = nWaitUs - m_nTickWaitUs;
+	m_nTickAcquires = nAcquires;
+	m_nTickWaitUs = nWaitUs;
+	double dMeanWaitMs = nTickAcquires > 0 ? nTickWaitUs / 1000.0 / nTickAcquires : 0;
+
+	MiLockGuard lock(m_mtxResize);
+	//. the idle trim dropped the spares on purpose.
+	if (mi_idle_trimmed()) return;
+
+	bool bBuilt = false;
+	if (dMeanWaitMs > m_elastic.waitMs && active() < size()) {
+		//. a warm spare first, else the first parked slot, loaded here.
+		size_t nOpen = 0;
+		for (size_t i = 1; i < m_vSlots.size() && nOpen == 0; i++) {
+			if (m_vSlots[i]->parked && std::atomic_load(&m_vSlots[i]->pipeline)) nOpen = i;
+		}
+		for (size_t i = 1; i < m_vSlots.size() && nOpen == 0; i++) {
+			if (m_vSlots[i]->parked) nOpen = i;
+		}
+		if (nOpen > 0) {
+			bBuilt = !std::atomic_load(&m_vSlots[nOpen]->pipeline);
+			if (open_slot(nOpen)) {
+				m_nGrows.fetch_add(1, std::memory_order_relaxed);
+				std::cout << "Pipeline pool : grew to " << active() << " slots, mean wait " << dMeanWaitMs << " ms" << std::endl;
+			}
+		}
+	}
+	else if (active() > m_elastic.minSlots) {
+		//. the in-service slot idle the longest, beyond pool.size.
+		uint64_t nNow = mi_tick_ms(), nIdleMs = (uint64_t)std::max(m_elastic.idleSec, 0) * 1000;
+		size_t nPark = 0;
+		uint64_t nOldest = nNow;
+		for (size_t i = 1; i < m_vSlots.size(); i++) {
+			uint64_t nLast = m_vSlots[i]->lastUseMs.load(std::memory_order_relaxed);
+			if (!m_vSlots[i]->parked && nNow - nLast >= nIdleMs && nLast < nOldest) {
+				nPark = i;
+				nOldest = nLast;
+			}
+		}
+		if (nPark > 0 && park_slot(nPark, spares() < m_elastic.spares)) {
+			m_nShrinks.fetch_add(1, std::memory_order_relaxed);
+			std::cout << "Pipeline pool : shrank to " << active() << " slots" << std::endl;
+		}
+	}
+
+	//. one warm spare per tick, within max_size.
+	if (!bBuilt && spares() < m_elastic.spares && active() + spares() < size()) {
+		for (size_t i = 1; i < m_vSlots.size(); i++) {
+			if (m_vSlots[i]->parked && !std::atomic_load(&m_vSlots[i]->pipeline)) {
+				load_slot(i);
+				break;
+			}
+		}
+	}
+}
+
+bool PipelinePool::build(const PipelineRef& p_global, const ConfigRef& p_config, std::vector<PipelineRef>& p_vOut)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+	bool	all = true;
+
+	MiLockGuard lock(m_mtxResize);
+	ConfigRef config = p_config ? p_config : m_config;
+	p_vOut.clear();
+	p_vOut.push_back(p_global);
+	for (size_t i = 1; i < m_vSlots.size(); i++) {
+		if (m_bShared) {
+			p_vOut.push_back(p_global);
+			continue;
+		}
+		//. a parked slot without pipeline stays empty, elastic or idle.
+		if (m_vSlots[i]->parked && !get((int)i)) {
+			p_vOut.push_back(PipelineRef());
+			continue;
+		}
+		NumaPin pin(m_vSlots[i]->node);
+		CPipeline_t* p = face_sdk_api().pipeline_create(g_Settings.pipelineName.c_str(), config->config, &err, msg);
+		if (p == NULL) {
+			p_vOut.push_back(get((int)i));
+			all = false;
+			continue;
+		}
+		p_vOut.push_back(std::make_shared<PipelineHandle>(p, p_global->generation, config));
+	}
+	return all;
+}
+
+void PipelinePool::swap(const std::vector<PipelineRef>& p_vSlots, const ConfigRef& p_config)
+{
+	MiLockGuard lock(m_mtxResize);
+	for (size_t i = 0; i < m_vSlots.size() && i < p_vSlots.size(); i++) {
+		if (p_vSlots[i]) std::atomic_store(&m_vSlots[i]->pipeline, p_vSlots[i]);
+	}
+	if (p_config) std::atomic_store(&m_config, p_config);
+}
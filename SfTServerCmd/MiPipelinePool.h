@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MiPlatform.h"
+#include "FaceSdkApi.h"
+#include "MiLock.h"
+#include "MiSupervisor.h"
+
+//. Fixed set of CPipeline_t instances shared by the request threads.
+//. Slot 0 shares the supervisor's global pipeline, the remaining slots are created
+//. with pipeline_create from the same SDK config. Slots are borrowed by CAS on a
+//. per-slot flag, so the common path takes no lock. A lease keeps a reference to
+//. the slot's pipeline, so a rebuild can swap the slot while it is in use.
+//. Each pipeline_create loads its own copy of the model weights. With [pool] shared every
+//. slot holds the supervisor's pipeline instead : the weights are loaded once and the slots
+//. only bound the calls in flight, each running on one of the pipeline's execution streams
+//. (sdk.num_pipeline_execution_streams, by default pool.size then). The resident memory
+//. each extra instance added is logged at creation and is on GD_API_METRICS
+//. (mi_pool_instance_rss_bytes), so the two modes can be compared.
+//. Parked slots ([idle] pool_keep, [pool] elastic) stay marked busy so no request borrows
+//. them; a parked slot either has no pipeline or holds a warm spare, built and ready to be
+//. put in service at once. park / unpark / the elastic thread / build serialize on one lock.
+//.
+//. Elastic pool ([pool] elastic) : the pool has max_size slots, size of them loaded at start.
+//. Every GD_POOL_ELASTIC_TICK_MS the elastic thread compares the mean time an acquire waited
+//. for a free slot with elastic_wait_ms : above it one more slot goes in service (a warm spare
+//. when there is one, else built there), never beyond max_size. An in-service slot beyond
+//. size that nobody borrowed for elastic_idle_sec is parked, its pipeline kept as a warm spare
+//. while fewer than elastic_spares are held, dropped otherwise. Spares are built one per tick on
+//. the elastic thread, so a request never waits for a pipeline_create; none while the server
+//. is trimmed (MiIdle.h). Active slots, spares and resizes are on GD_API_METRICS.
+//.
+//. Stuck calls ([watchdog], MiWatchdog.h) : every lease has an epoch, and the watchdog thread
+//. retires a slot lent out for longer than liveness_ms by moving its epoch on. The stuck call
+//. keeps its reference to the old pipeline, which goes with it when the call returns; its
+//. release no longer matches the slot and is ignored (an orphaned lease). The slot gets a new
+//. pipeline and goes back in service.
+struct PoolElastic {
+	int		minSlots;		//. pool.size
+	int		maxSlots;		//. pool.max_size
+	int		waitMs;
+	int		idleSec;
+	int		spares;
+};
+
+class PipelinePool {
+public:
+	PipelinePool();
+	~PipelinePool();
+
+	//. p_nEngineThreads is applied with set_num_threads(..., ENGINE) before the extra
+	//. pipelines are created. p_nCoresPerSlot > 0 pins the borrowing thread of slot i
+	//. to cores [i * p_nCoresPerSlot, (i + 1) * p_nCoresPerSlot) while it holds the slot.
+	//. With NUMA placement (MiNuma.h) slot i belongs to node i % nodes instead : its
+	//. pipeline is created on that node and threads of the node borrow it first.
+	//. p_bShared : every slot on the one global pipeline, see above.
+	//. p_nLoaded > 0 creates the pipelines of the first p_nLoaded slots only, the others parked.
+	bool create(int p_nCount, unsigned int p_nEngineThreads, int p_nCoresPerSlot, bool p_bShared, std::string& p_strErr, int p_nLoaded = 0);
+	void destroy();
+
+	//. after create with p_nLoaded = p_elastic.minSlots; no-op for a shared pool.
+	void elastic_start(const PoolElastic& p_elastic);
+	void elastic_stop();
+
+	int acquire();
+	//. -1 when no slot came free before p_limit.
+	int acquire(std::chrono::steady_clock::time_point p_limit);
+
+	//. p_nLease : lease(p_nSlot) when it was acquired; ignored once the slot was retired.
+	void release(int p_nSlot, uint32_t p_nLease);
+	uint32_t lease(int p_nSlot) const { return m_vSlots[p_nSlot]->lease.load(); }
+	//. the slot is borrowed by a watched call (MiWatchdog.h) : retire_stuck may retire it.
+	void watch(int p_nSlot) { m_vSlots[p_nSlot]->watched.store(true); }
+	PipelineRef get(int p_nSlot) const { return std::atomic_load(&m_vSlots[p_nSlot]->pipeline); }
+	int size() const { return (int)m_vSlots.size(); }
+	//. slots lent out right now, a snapshot for GD_API_HEALTH.
+	int busy() const;
+	bool shared() const { return m_bShared; }
+	//. resident bytes added per instance beyond the first, measured by create.
+	size_t instance_rss() const { return m_nInstanceRss; }
+
+	//. idle trimming (MiIdle.h) : takes every slot from p_nKeep on out of service and drops
+	//. its pipeline and the warm spares, so only p_nKeep instances stay loaded; slots lent out
+	//. are left alone. No-op for a shared pool. Returns the slots parked.
+	int park(int p_nKeep);
+	//. creates the pipelines of the parked slots again and puts them back in service, up to
+	//. pool.size slots when elastic. Returns the slots restored.
+	int unpark();
+	int parked() const { return m_nParked.load(std::memory_order_relaxed); }
+	int active() const { return size() - parked(); }
+	int spares() const { return m_nSpares.load(std::memory_order_relaxed); }
+	uint64_t grows() const { return m_nGrows.load(std::memory_order_relaxed); }
+	uint64_t shrinks() const { return m_nShrinks.load(std::memory_order_relaxed); }
+
+	//. watchdog thread : retires every watched slot lent out for more than p_nLimitMs, see above. A slot
+	//. whose new pipeline cannot be built is parked. No-op for a shared pool, or one without its
+	//. own config (a single slot); returns the slots retired.
+	int retire_stuck(int p_nLimitMs);
+	//. false when retire_stuck cannot replace a pipeline : a stuck one is the supervisor's to rebuild.
+	bool replaceable() const { return !m_bShared && (bool)std::atomic_load(&m_config); }
+	//. leases of retired slots whose call has not returned yet.
+	int orphans() const { return m_nOrphans.load(std::memory_order_relaxed); }
+	uint64_t retired() const { return m_nRetired.load(std::memory_order_relaxed); }
+
+	//. supervisor thread : one pipeline per slot for the next generation, p_global for
+	//. slot 0 and the others created from p_config (NULL = the pool's config). A slot
+	//. that cannot be created keeps its current pipeline in p_vOut; returns false then.
+	bool build(const PipelineRef& p_global, const ConfigRef& p_config, std::vector<PipelineRef>& p_vOut);
+	//. installs what build returned (a NULL entry, for a parked slot without pipeline, keeps
+	//. the slot as it is); a non-NULL p_config becomes the pool's config.
+	void swap(const std::vector<PipelineRef>& p_vSlots, const ConfigRef& p_config);
+
+private:
+	bool try_acquire(size_t p_nSlot);
+	int try_any();
+	//. a slot came free (release, retire, unpark) : wakes a waiting acquire, if any.
+	void freed();
+	//. under m_mtxResize.
+	bool park_slot(size_t p_nSlot, bool p_bKeepSpare);
+	bool open_slot(size_t p_nSlot);
+	bool load_slot(size_t p_nSlot);
+	void elastic_tick();
+	void elastic_loop();
+
+	struct Slot {
+		std::atomic<bool>	busy;
+		PipelineRef			pipeline;		//. atomic_load / atomic_store
+		MiAffinity			affinity;		//. pool.cores_per_slot processors when bPinned
+		bool				bPinned;
+		int					node;			//. NUMA node, see MiNuma.h
+		bool				parked;			//. held busy out of service, see above; under m_mtxResize
+		std::atomic<uint64_t>	lastUseMs;	//. mi_tick_ms of the last release, elastic pools
+		std::atomic<uint64_t>	acquiredMs;	//. mi_tick_ms of the acquire while lent out, 0 = free
+		std::atomic<uint32_t>	lease;		//. epoch, moved on by each release and retire
+		std::atomic<bool>		watched;	//. see watch
+		Slot() : busy(false), bPinned(false), node(0), parked(false), lastUseMs(0), acquiredMs(0), lease(0), watched(false) {}
+	};
+
+	std::vector<std::unique_ptr<Slot>>	m_vSlots;
+	ConfigRef							m_config;		//. atomic_load / atomic_store
+	bool								m_bShared;
+	std::atomic<int>					m_nParked;
+	std::atomic<int>					m_nSpares;		//. parked slots holding a pipeline
+	size_t								m_nInstanceRss;
+
+	MI_MUTEX(m_mtxResize, "pipeline_pool.resize");
+	bool								m_bElastic;
+	PoolElastic							m_elastic;
+	std::thread							m_elasticThread;
+	MI_MUTEX(m_mtxElastic, "pipeline_pool.elastic");
+	MiCondition							m_cvElastic;
+	bool								m_bElasticStop;
+	std::atomic<uint64_t>				m_nAcquires;
+	std::atomic<uint64_t>				m_nWaitUs;		//. acquires that found no free slot
+	uint64_t							m_nTickAcquires;
+	uint64_t							m_nTickWaitUs;
+	std::atomic<uint64_t>				m_nGrows;
+	std::atomic<uint64_t>				m_nShrinks;
+	std::atomic<int>					m_nOrphans;
+	std::atomic<uint64_t>				m_nRetired;
+	//. acquire sleeps here when every slot is busy; a slot coming free wakes one waiter.
+	MI_MUTEX(m_mtxFree, "pipeline_pool.free");
+	MiCondition							m_cvFree;
+	std::atomic<int>					m_nWaiters;
+};
+
+//. RAII borrow of one pool slot.
+class PipelineLease {
+public:
+	explicit PipelineLease(PipelinePool* p_pPool) : m_pPool(p_pPool), m_nSlot(p_pPool->acquire()), m_nLease(p_pPool->lease(m_nSlot)), m_ref(p_pPool->get(m_nSlot)) {}
+	//. gives up at p_limit ([watchdog] queue_ms) : ok() is false then and there is no pipeline.
+	PipelineLease(PipelinePool* p_pPool, std::chrono::steady_clock::time_point p_limit) : m_pPool(p_pPool), m_nSlot(p_pPool->acquire(p_limit)), m_nLease(0)
+	{
+		if (m_nSlot >= 0) {
+			m_nLease = p_pPool->lease(m_nSlot);
+			m_ref = p_pPool->get(m_nSlot);
+		}
+	}
+	~PipelineLease() { if (m_nSlot >= 0) m_pPool->release(m_nSlot, m_nLease); }
+
+	bool ok() const { return m_nSlot >= 0; }
+	void watch() { m_pPool->watch(m_nSlot); }
+
+	CPipeline_t* pipeline() const { return m_ref->pipeline; }
+	const PipelineRef& ref() const { return m_ref; }
+
+private:
+	PipelineLease(const PipelineLease&) = delete;
+	PipelineLease& operator=(const PipelineLease&) = delete;
+
+	PipelinePool*	m_pPool;
+	int				m_nSlot;
+	uint32_t		m_nLease;
+	PipelineRef		m_ref;
+};
+
+extern PipelinePool* g_pPool;
@@ -0,0 +1,239 @@
+#include "MiPixelPool.h"
+#include "MiConf.h"
+#include "MiNuma.h"
+#include "MiPlatform.h"
+#include "MiLock.h"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+struct FreeBuf {
+	uint8_t*	p;
+	int			kind;			//. MiPageKind
+	uint64_t	releasedMs;
+};
+
+static MI_MUTEX(lv_mtx, "pixel_pool");
+static MiCondition						lv_cv;
+static std::thread						lv_trimmer;
+static bool								lv_bEnable = false;
+static bool								lv_bStop = false;
+static size_t							lv_nMaxBytes = 0;
+static uint64_t							lv_nIdleMs = 0;
+static std::vector<size_t>				lv_vClasses;	//. capacity of each class, ascending
+static std::vector<std::vector<FreeBuf>>	lv_vFree;		//. [node * classes + class], newest last
+static std::atomic<size_t>				lv_nHeld(0);
+static std::atomic<uint64_t>			lv_nHits(0);
+static std::atomic<uint64_t>			lv_nMisses(0);
+static size_t							lv_nLargePage = 0;		//. 0 = no large pages
+static std::atomic<int>					lv_nLarge(0);
+static std::atomic<int>					lv_nThp(0);
+
+//. a new block for a class of p_nCapacity bytes.
+static uint8_t* block_alloc(size_t p_nCapacity, int& p_nKind)
+{
+	p_nKind = MI_PAGES_SMALL;
+	if (lv_nLargePage > 0 && p_nCapacity >= GD_PIXEL_POOL_LARGE_MIN_BYTES) {
+		size_t nMap = (p_nCapacity + lv_nLargePage - 1) / lv_nLargePage * lv_nLargePage;
+		MiPageKind kind = MI_PAGES_SMALL;
+		uint8_t* p = (uint8_t*)mi_large_alloc(nMap, kind);
+		if (p != NULL) {
+			p_nKind = kind;
+			if (kind == MI_PAGES_LARGE) lv_nLarge++;
+			else lv_nThp++;
+			return p;
+		}
+	}
+	return (uint8_t*)mi_aligned_alloc(p_nCapacity > 0 ? p_nCapacity : 1, GD_PIXEL_POOL_ALIGN);
+}
+
+static void block_free(uint8_t* p_p, size_t p_nCapacity, int p_nKind)
+{
+	if (p_nKind == MI_PAGES_SMALL) {
+		mi_aligned_free(p_p);
+		return;
+	}
+	//. lv_nLargePage is kept by shutdown for the blocks still in use.
+	mi_large_free(p_p, (p_nCapacity + lv_nLargePage - 1) / lv_nLargePage * lv_nLargePage);
+	if (p_nKind == MI_PAGES_LARGE) lv_nLarge--;
+	else lv_nThp--;
+}
+
+//. class of a p_nSize buffer, -1 when it is not pooled.
+static int class_of(size_t p_nSize)
+{
+	if (p_nSize == 0 || lv_vClasses.empty() || p_nSize > lv_vClasses.back()) return -1;
+	return (int)(std::lower_bound(lv_vClasses.begin(), lv_vClasses.end(), p_nSize) - lv_vClasses.begin());
+}
+
+//. frees the buffers released longer than idle_sec ago; p_bAll frees every one.
+static void trim_locked(bool p_bAll)
+{
+	uint64_t now = mi_tick_ms();
+	for (size_t i = 0; i < lv_vFree.size(); i++) {
+		std::vector<FreeBuf>& vFree = lv_vFree[i];
+		size_t n = 0;
+		while (n < vFree.size() && (p_bAll || now - vFree[n].releasedMs >= lv_nIdleMs)) {
+			block_free(vFree[n].p, lv_vClasses[i % lv_vClasses.size()], vFree[n].kind);
+			lv_nHeld -= lv_vClasses[i % lv_vClasses.size()];
+			n++;
+		}
+		vFree.erase(vFree.begin(), vFree.begin() + n);
+	}
+}
+
+static void trimmer_loop()
+{
+	MiUniqueLock lock(lv_mtx);
+	uint64_t nPollMs = std::max<uint64_t>(lv_nIdleMs / 2, 1000);
+	while (!lv_bStop) {
+		lv_cv.wait_for(lock, std::chrono::milliseconds(nPollMs), [] { return lv_bStop; });
+		if (!lv_bStop) trim_locked(false);
+	}
+}
+
+void mi_pixel_pool_init(bool p_bEnable, size_t p_nMaxBytes, int p_nIdleSec, bool p_bLargePages)
+{
+	if (!p_bEnable || p_nMaxBytes == 0) return;
+	if (p_bLargePages) {
+		std::string strWhy;
+		lv_nLargePage = mi_large_pages_init(strWhy);
+		if (lv_nLargePage == 0) std::cout << "Pixel pool : no large pages, " << strWhy << std::endl;
+	}
+	MiLockGuard lock(lv_mtx);
+	lv_vClasses.clear();
+	//. quarter octaves : 1, 1.25, 1.5, 1.75, 2, 2.5 ... times the smallest class.
+	for (size_t base = GD_PIXEL_POOL_MIN_BYTES; base <= GD_PIXEL_POOL_MAX_BYTES / 2; base *= 2) {
+		if (lv_vClasses.empty()) lv_vClasses.push_back(base);
+		for (size_t q = 5; q <= 8; q++) lv_vClasses.push_back(base * q / 4);
+	}
+	lv_vFree.assign(lv_vClasses.size() * GD_NUMA_MAX_NODES, std::vector<FreeBuf>());
+	lv_nMaxBytes = p_nMaxBytes;
+	lv_nIdleMs = (uint64_t)(p_nIdleSec > 0 ? p_nIdleSec : 0) * 1000;
+	lv_bEnable = true;
+	lv_bStop = false;
+	if (lv_nIdleMs > 0) lv_trimmer = std::thread(trimmer_loop);
+}
+
+void mi_pixel_pool_shutdown()
+{
+	std::thread trimmer;
+	{
+		MiLockGuard lock(lv_mtx);
+		if (!lv_bEnable) return;
+		lv_bStop = true;
+		lv_bEnable = false;
+		trim_locked(true);
+		trimmer.swap(lv_trimmer);
+	}
+	lv_cv.notify_all();
+	if (trimmer.joinable()) trimmer.join();
+}
+
+size_t mi_pixel_pool_trim()
+{
+	MiLockGuard lock(lv_mtx);
+	size_t nBefore = lv_nHeld;
+	trim_locked(true);
+	return nBefore - lv_nHeld;
+}
+
+size_t mi_pixel_pool_bytes()
+{
+	return lv_nHeld.load();
+}
+
+uint64_t mi_pixel_pool_hits()
+{
+	return lv_nHits.load();
+}
+
+uint64_t mi_pixel_pool_misses()
+{
+	return lv_nMisses.load();
+}
+
+int mi_pixel_pool_large_buffers()
+{
+	return lv_nLarge.load();
+}
+
+int mi_pixel_pool_thp_buffers()
+{
+	return lv_nThp.load();
+}
+
+uint8_t* mi_pixel_alloc(size_t p_nSize, size_t& p_nCapacity, int& p_nKind)
+{
+	p_nCapacity = p_nSize;
+	p_nKind = MI_PAGES_SMALL;
+	bool bPooled = false;
+	if (p_nSize >= GD_PIXEL_POOL_MIN_BYTES) {
+		MiLockGuard lock(lv_mtx);
+		int cls = lv_bEnable ? class_of(p_nSize) : -1;
+		if (cls >= 0) {
+			p_nCapacity = lv_vClasses[cls];
+			std::vector<FreeBuf>& vFree = lv_vFree[(size_t)mi_numa_current_node() * lv_vClasses.size() + cls];
+			if (!vFree.empty()) {
+				uint8_t* p = vFree.back().p;
+				p_nKind = vFree.back().kind;
+				vFree.pop_back();
+				lv_nHeld -= p_nCapacity;
+				lv_nHits++;
+				return p;
+			}
+			lv_nMisses++;
+			bPooled = true;
+		}
+	}
+	//. a pooled class gets large pages when it is big enough.
+	uint8_t* p = bPooled ? block_alloc(p_nCapacity, p_nKind) : (uint8_t*)mi_aligned_alloc(p_nCapacity > 0 ? p_nCapacity : 1, GD_PIXEL_POOL_ALIGN);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void mi_pixel_free(uint8_t* p_p, size_t p_nCapacity, int p_nKind)
+{
+	if (p_p == NULL) return;
+	if (p_nCapacity >= GD_PIXEL_POOL_MIN_BYTES) {
+		MiLockGuard lock(lv_mtx);
+		int cls = lv_bEnable ? class_of(p_nCapacity) : -1;
+		//. only buffers of exactly a class size came from the pool.
+		if (cls >= 0 && lv_vClasses[cls] == p_nCapacity && lv_nHeld + p_nCapacity <= lv_nMaxBytes) {
+			FreeBuf buf = { p_p, p_nKind, mi_tick_ms() };
+			lv_vFree[(size_t)mi_numa_current_node() * lv_vClasses.size() + cls].push_back(buf);
+			lv_nHeld += p_nCapacity;
+			return;
+		}
+	}
+	block_free(p_p, p_nCapacity, p_nKind);
+}
+
+void PixelBuffer::resize(size_t p_nSize)
+{
+	if (p_nSize <= m_nCapacity) {
+		m_nSize = p_nSize;
+		return;
+	}
+	size_t nCapacity = 0;
+	int nKind = 0;
+	uint8_t* p = mi_pixel_alloc(p_nSize, nCapacity, nKind);
+	if (m_nSize > 0) memcpy(p, m_p, m_nSize);
+	if (m_p != NULL) mi_pixel_free(m_p, m_nCapacity, m_nKind);
+	m_p = p;
+	m_nSize = p_nSize;
+	m_nCapacity = nCapacity;
+	m_nKind = nKind;
+}
+
+void PixelBuffer::swap(PixelBuffer& p_other)
+{
+	std::swap(m_p, p_other.m_p);
+	std::swap(m_nSize, p_other.m_nSize);
+	std::swap(m_nCapacity, p_other.m_nCapacity);
+	std::swap(m_nKind, p_other.m_nKind);
+}
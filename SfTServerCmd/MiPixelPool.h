@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//. Size-class pool of the pixel buffers the server fills itself before image_create_pixels
+//. ([pixel_pool] settings) : scaled JPEG decodes, face crops, YUV conversions. These are
+//. multi-MB and of about the same size request after request, so a buffer freed by one
+//. request is handed to the next one whose size falls in its class instead of going back
+//. to the heap, which would return it to the OS and fault its pages in again.
+//. Classes start at GD_PIXEL_POOL_MIN_BYTES and grow by quarter octaves (at most 25 % slack);
+//. smaller buffers are plain allocations. Every buffer is GD_PIXEL_POOL_ALIGN aligned for
+//. the SIMD kernels. Free buffers are kept per NUMA node (MiNuma.h), up to max_mb in all,
+//. and freed after idle_sec unused. Before mi_pixel_pool_init (SdkBench) and after
+//. mi_pixel_pool_shutdown buffers come from the heap and go back to it.
+//. With large_pages, pooled buffers of GD_PIXEL_POOL_LARGE_MIN_BYTES and more are backed
+//. by large pages (MiPlatform.h : MEM_LARGE_PAGES, MAP_HUGETLB, else THP on Linux), so the
+//. decode and resize loops over a 36 MB frame touch a few dozen TLB entries instead of
+//. thousands; when the OS refuses, they are ordinary allocations.
+//. mi_pixel_pool_bytes, hits / misses, the large-page buffer counts and
+//. mi_process_peak_rss_bytes are on GD_API_METRICS.
+
+void mi_pixel_pool_init(bool p_bEnable, size_t p_nMaxBytes, int p_nIdleSec, bool p_bLargePages);
+void mi_pixel_pool_shutdown();
+
+//. frees every free buffer now (idle trimming, MiIdle.h), returns the bytes released.
+size_t mi_pixel_pool_trim();
+//. free bytes held by the pool.
+size_t mi_pixel_pool_bytes();
+uint64_t mi_pixel_pool_hits();
+uint64_t mi_pixel_pool_misses();
+//. live buffers (in use or free) on explicit large pages, on advised transparent huge pages.
+int mi_pixel_pool_large_buffers();
+int mi_pixel_pool_thp_buffers();
+
+//. at least p_nSize bytes, p_nCapacity and p_nKind (MiPageKind) receive the size actually
+//. allocated and its backing. Throws std::bad_alloc.
+uint8_t* mi_pixel_alloc(size_t p_nSize, size_t& p_nCapacity, int& p_nKind);
+//. p_nCapacity and p_nKind as returned by mi_pixel_alloc.
+void mi_pixel_free(uint8_t* p_p, size_t p_nCapacity, int p_nKind);
+
+//. the std::vector<uint8_t> subset the pixel paths use, backed by the pool. Unlike a
+//. vector, bytes added by resize are not initialized.
+class PixelBuffer {
+public:
+	PixelBuffer() : m_p(NULL), m_nSize(0), m_nCapacity(0), m_nKind(0) {}
+	explicit PixelBuffer(size_t p_nSize) : m_p(NULL), m_nSize(0), m_nCapacity(0), m_nKind(0) { resize(p_nSize); }
+	~PixelBuffer() { if (m_p != NULL) mi_pixel_free(m_p, m_nCapacity, m_nKind); }
+
+	PixelBuffer(PixelBuffer&& p_other) : m_p(p_other.m_p), m_nSize(p_other.m_nSize), m_nCapacity(p_other.m_nCapacity), m_nKind(p_other.m_nKind)
+	{
+		p_other.m_p = NULL;
+		p_other.m_nSize = p_other.m_nCapacity = 0;
+		p_other.m_nKind = 0;
+	}
+	PixelBuffer& operator=(PixelBuffer&& p_other)
+	{
+		swap(p_other);
+		return *this;
+	}
+
+	//. keeps the first min(size(), p_nSize) bytes.
+	void resize(size_t p_nSize);
+	void swap(PixelBuffer& p_other);
+
+	uint8_t* data() { return m_p; }
+	const uint8_t* data() const { return m_p; }
+	size_t size() const { return m_nSize; }
+	bool empty() const { return m_nSize == 0; }
+	uint8_t& operator[](size_t p_nIndex) { return m_p[p_nIndex]; }
+	const uint8_t& operator[](size_t p_nIndex) const { return m_p[p_nIndex]; }
+
+private:
+	PixelBuffer(const PixelBuffer&) = delete;
+	PixelBuffer& operator=(const PixelBuffer&) = delete;
+
+	uint8_t*	m_p;
+	size_t		m_nSize;
+	size_t		m_nCapacity;
+	int			m_nKind;
+};
@@ -0,0 +1,518 @@
+#include "MiPlatform.h"
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+#ifdef _WIN32
+
+#include <malloc.h>
+#include <psapi.h>		//. GetProcessMemoryInfo, K32 export of kernel32
+
+MiModule mi_module_open(const char* p_pszPath)
+{
+	return LoadLibraryA(p_pszPath);
+}
+
+void mi_module_close(MiModule p_hModule)
+{
+	if (p_hModule != NULL) FreeLibrary(p_hModule);
+}
+
+void* mi_module_symbol(MiModule p_hModule, const char* p_pszName)
+{
+	return p_hModule != NULL ? (void*)GetProcAddress(p_hModule, p_pszName) : NULL;
+}
+
+std::string mi_module_path(MiModule p_hModule)
+{
+	char szPath[MAX_PATH];
+	if (p_hModule == NULL || GetModuleFileNameA(p_hModule, szPath, MAX_PATH) == 0) return std::string();
+	return szPath;
+}
+
+std::string mi_module_version(MiModule p_hModule)
+{
+	std::string strPath = mi_module_path(p_hModule);
+	if (strPath.empty()) return std::string();
+	DWORD dwHandle = 0;
+	DWORD dwSize = GetFileVersionInfoSizeA(strPath.c_str(), &dwHandle);
+	if (dwSize == 0) return std::string();
+	std::vector<char> vInfo(dwSize);
+	VS_FIXEDFILEINFO* pFixed = NULL;
+	UINT nLen = 0;
+	if (!GetFileVersionInfoA(strPath.c_str(), 0, dwSize, vInfo.data()) || !VerQueryValueA(vInfo.data(), "\\", (LPVOID*)&pFixed, &nLen) || pFixed == NULL) return std::string();
+	char szVersion[64];
+	snprintf(szVersion, sizeof(szVersion), "%u.%u.%u.%u", HIWORD(pFixed->dwFileVersionMS), LOWORD(pFixed->dwFileVersionMS), HIWORD(pFixed->dwFileVersionLS), LOWORD(pFixed->dwFileVersionLS));
+	return szVersion;
+}
+
+uint64_t mi_tick_ms()
+{
+	return GetTickCount64();
+}
+
+void mi_sleep_ms(unsigned int p_nMs)
+{
+	Sleep(p_nMs);
+}
+
+bool mi_localtime(time_t p_t, struct tm* p_pOut)
+{
+	return localtime_s(p_pOut, &p_t) == 0;
+}
+
+int mi_stricmp(const char* p_pszA, const char* p_pszB)
+{
+	return _stricmp(p_pszA, p_pszB);
+}
+
+uint32_t mi_thread_id()
+{
+	return (uint32_t)GetCurrentThreadId();
+}
+
+bool mi_thread_set_background()
+{
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST) != 0;
+}
+
+uint64_t mi_thread_cpu_ns()
+{
+	FILETIME tCreate, tExit, tKernel, tUser;
+	if (!GetThreadTimes(GetCurrentThread(), &tCreate, &tExit, &tKernel, &tUser)) return 0;
+	uint64_t k = ((uint64_t)tKernel.dwHighDateTime << 32) | tKernel.dwLowDateTime;
+	uint64_t u = ((uint64_t)tUser.dwHighDateTime << 32) | tUser.dwLowDateTime;
+	return (k + u) * 100;
+}
+
+uint64_t mi_process_cpu_ns()
+{
+	FILETIME tCreate, tExit, tKernel, tUser;
+	if (!GetProcessTimes(GetCurrentProcess(), &tCreate, &tExit, &tKernel, &tUser)) return 0;
+	uint64_t k = ((uint64_t)tKernel.dwHighDateTime << 32) | tKernel.dwLowDateTime;
+	uint64_t u = ((uint64_t)tUser.dwHighDateTime << 32) | tUser.dwLowDateTime;
+	return (k + u) * 100;
+}
+
+void mi_affinity_from_mask(uint64_t p_nMask, MiAffinity& p_out)
+{
+	memset(&p_out, 0, sizeof(p_out));
+	p_out.Mask = (KAFFINITY)p_nMask;
+}
+
+uint64_t mi_process_affinity_mask()
+{
+	DWORD_PTR nProcess = 0, nSystem = 0;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &nProcess, &nSystem)) return 0;
+	return (uint64_t)nProcess;
+}
+
+bool mi_thread_set_affinity(const MiAffinity& p_affinity, MiAffinity* p_pPrev)
+{
+	return SetThreadGroupAffinity(GetCurrentThread(), &p_affinity, p_pPrev) != 0;
+}
+
+void* mi_aligned_alloc(size_t p_nSize, size_t p_nAlign)
+{
+	return _aligned_malloc(p_nSize, p_nAlign);
+}
+
+void mi_aligned_free(void* p_p)
+{
+	_aligned_free(p_p);
+}
+
+size_t mi_peak_rss()
+{
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+	return pmc.PeakWorkingSetSize;
+}
+
+size_t mi_rss()
+{
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+	return pmc.WorkingSetSize;
+}
+
+size_t mi_mapped_resident(const std::string& p_strDir, int* p_pFiles)
+{
+	*p_pFiles = 0;
+	//. GetMappedFileName names files by device : \Device\HarddiskVolume3\models\...
+	char szFull[MAX_PATH], szDevice[MAX_PATH];
+	DWORD nFull = GetFullPathNameA(p_strDir.c_str(), MAX_PATH, szFull, NULL);
+	if (nFull == 0 || nFull >= MAX_PATH || szFull[1] != ':') return 0;
+	char szDrive[3] = { szFull[0], ':', 0 };
+	if (QueryDosDeviceA(szDrive, szDevice, MAX_PATH) == 0) return 0;
+	std::string strPrefix = std::string(szDevice) + (szFull + 2);
+	if (strPrefix.back() != '\\') strPrefix += '\\';
+
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	HANDLE hProcess = GetCurrentProcess();
+	std::set<std::string> files;
+	std::vector<PSAPI_WORKING_SET_EX_INFORMATION> vPages;
+	size_t nResident = 0;
+	MEMORY_BASIC_INFORMATION mbi;
+	for (char* p = (char*)si.lpMinimumApplicationAddress; p < (char*)si.lpMaximumApplicationAddress; p = (char*)mbi.BaseAddress + mbi.RegionSize) {
+		if (VirtualQuery(p, &mbi, sizeof(mbi)) == 0) break;
+		if (mbi.State != MEM_COMMIT || mbi.Type != MEM_MAPPED || (mbi.Protect & (PAGE_READWRITE | PAGE_EXECUTE_READWRITE)) != 0) continue;
+		char szName[MAX_PATH];
+		if (GetMappedFileNameA(hProcess, mbi.BaseAddress, szName, MAX_PATH) == 0 || _strnicmp(szName, strPrefix.c_str(), strPrefix.size()) != 0) continue;
+		files.insert(szName);
+		//. the working set : pages of the region that are resident now.
+		vPages.resize(mbi.RegionSize / si.dwPageSize);
+		for (size_t i = 0; i < vPages.size(); i++) vPages[i].VirtualAddress = (char*)mbi.BaseAddress + i * si.dwPageSize;
+		if (!QueryWorkingSetEx(hProcess, vPages.data(), (DWORD)(vPages.size() * sizeof(vPages[0])))) continue;
+		for (auto& page : vPages) if (page.VirtualAttributes.Valid) nResident += si.dwPageSize;
+	}
+	*p_pFiles = (int)files.size();
+	return nResident;
+}
+
+bool mi_heap_stats(size_t* p_pAllocated, size_t* p_pFree)
+{
+	//. the UCRT allocates from the process heap.
+	HEAP_SUMMARY hs;
+	memset(&hs, 0, sizeof(hs));
+	hs.cb = sizeof(hs);
+	if (HeapSummary(GetProcessHeap(), 0, &hs) == FALSE) return false;
+	*p_pAllocated = hs.cbAllocated;
+	*p_pFree = hs.cbCommitted > hs.cbAllocated ? hs.cbCommitted - hs.cbAllocated : 0;
+	return true;
+}
+
+int mi_handle_count()
+{
+	DWORD nHandles = 0;
+	return GetProcessHandleCount(GetCurrentProcess(), &nHandles) ? (int)nHandles : -1;
+}
+
+void mi_trim_working_set()
+{
+	_heapmin();
+	HeapCompact(GetProcessHeap(), 0);
+	SetProcessWorkingSetSize(GetCurrentProcess(), (SIZE_T)-1, (SIZE_T)-1);
+}
+
+size_t mi_large_pages_init(std::string& p_strWhy)
+{
+	size_t nPage = GetLargePageMinimum();
+	if (nPage == 0) {
+		p_strWhy = "no large page support";
+		return 0;
+	}
+	HANDLE hToken = NULL;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken)) {
+		p_strWhy = "OpenProcessToken failed";
+		return 0;
+	}
+	TOKEN_PRIVILEGES tp;
+	tp.PrivilegeCount = 1;
+	tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool bOk = LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &tp.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(hToken, FALSE, &tp, 0, NULL, NULL)
+		&& GetLastError() == ERROR_SUCCESS;		//. ERROR_NOT_ALL_ASSIGNED : the account lacks the right
+	CloseHandle(hToken);
+	if (!bOk) {
+		p_strWhy = "the account lacks \"Lock pages in memory\" (SeLockMemoryPrivilege)";
+		return 0;
+	}
+	return nPage;
+}
+
+void* mi_large_alloc(size_t p_nSize, MiPageKind& p_kind)
+{
+	void* p = VirtualAlloc(NULL, p_nSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	p_kind = p != NULL ? MI_PAGES_LARGE : MI_PAGES_SMALL;
+	return p;
+}
+
+void mi_large_free(void* p_p, size_t)
+{
+	VirtualFree(p_p, 0, MEM_RELEASE);
+}
+
+#else
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <link.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+MiModule mi_module_open(const char* p_pszPath)
+{
+	return dlopen(p_pszPath, RTLD_NOW | RTLD_LOCAL);
+}
+
+void mi_module_close(MiModule p_hModule)
+{
+	if (p_hModule != NULL) dlclose(p_hModule);
+}
+
+void* mi_module_symbol(MiModule p_hModule, const char* p_pszName)
+{
+	return p_hModule != NULL ? dlsym(p_hModule, p_pszName) : NULL;
+}
+
+std::string mi_module_path(MiModule p_hModule)
+{
+	struct link_map* pMap = NULL;
+	if (p_hModule == NULL || dlinfo(p_hModule, RTLD_DI_LINKMAP, &pMap) != 0 || pMap == NULL || pMap->l_name == NULL) return std::string();
+	return pMap->l_name;
+}
+
+std::string mi_module_version(MiModule p_hModule)
+{
+	//. libidliveface.so -> libidliveface.so.1 -> libidliveface.so.1.10.0
+	std::string strPath = mi_module_path(p_hModule);
+	char szReal[PATH_MAX];
+	if (strPath.empty() || realpath(strPath.c_str(), szReal) == NULL) return std::string();
+	const char* p = strstr(szReal, ".so.");
+	return p != NULL ? std::string(p + 4) : std::string();
+}
+
+uint64_t mi_tick_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void mi_sleep_ms(unsigned int p_nMs)
+{
+	struct timespec ts;
+	ts.tv_sec = p_nMs / 1000;
+	ts.tv_nsec = (long)(p_nMs % 1000) * 1000000;
+	while (nanosleep(&ts, &ts) != 0) {
+	}
+}
+
+bool mi_localtime(time_t p_t, struct tm* p_pOut)
+{
+	return localtime_r(&p_t, p_pOut) != NULL;
+}
+
+int mi_stricmp(const char* p_pszA, const char* p_pszB)
+{
+	return strcasecmp(p_pszA, p_pszB);
+}
+
+uint32_t mi_thread_id()
+{
+	return (uint32_t)syscall(SYS_gettid);
+}
+
+bool mi_thread_set_background()
+{
+	//. Linux keeps a nice value per thread, PRIO_PROCESS with a tid sets only that one.
+	return setpriority(PRIO_PROCESS, (id_t)mi_thread_id(), 19) == 0;
+}
+
+uint64_t mi_thread_cpu_ns()
+{
+	struct timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t mi_process_cpu_ns()
+{
+	struct timespec ts;
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void mi_affinity_from_mask(uint64_t p_nMask, MiAffinity& p_out)
+{
+	CPU_ZERO(&p_out);
+	for (int i = 0; i < 64; i++) {
+		if (p_nMask & ((uint64_t)1 << i)) CPU_SET(i, &p_out);
+	}
+}
+
+uint64_t mi_process_affinity_mask()
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+	uint64_t nMask = 0;
+	for (int i = 0; i < 64; i++) {
+		if (CPU_ISSET(i, &set)) nMask |= (uint64_t)1 << i;
+	}
+	return nMask;
+}
+
+bool mi_thread_set_affinity(const MiAffinity& p_affinity, MiAffinity* p_pPrev)
+{
+	pthread_t self = pthread_self();
+	if (p_pPrev != NULL && pthread_getaffinity_np(self, sizeof(MiAffinity), p_pPrev) != 0) return false;
+	return pthread_setaffinity_np(self, sizeof(MiAffinity), &p_affinity) == 0;
+}
+
+void* mi_aligned_alloc(size_t p_nSize, size_t p_nAlign)
+{
+	void* p = NULL;
+	if (p_nAlign < sizeof(void*)) p_nAlign = sizeof(void*);
+	return posix_memalign(&p, p_nAlign, p_nSize) == 0 ? p : NULL;
+}
+
+void mi_aligned_free(void* p_p)
+{
+	free(p_p);
+}
+
+size_t mi_peak_rss()
+{
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+	return (size_t)ru.ru_maxrss * 1024;		//. kilobytes on Linux
+}
+
+size_t mi_rss()
+{
+	//. statm : size resident shared text lib data dt, in pages.
+	unsigned long nSize = 0, nResident = 0;
+	FILE* f = fopen("/proc/self/statm", "r");
+	if (f == NULL) return 0;
+	int n = fscanf(f, "%lu %lu", &nSize, &nResident);
+	fclose(f);
+	return n == 2 ? (size_t)nResident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+size_t mi_mapped_resident(const std::string& p_strDir, int* p_pFiles)
+{
+	*p_pFiles = 0;
+	char szReal[PATH_MAX];
+	if (realpath(p_strDir.c_str(), szReal) == NULL) return 0;
+	std::string strPrefix = szReal;
+	if (strPrefix.back() != '/') strPrefix += '/';
+
+	//. smaps : a "start-end perms offset dev inode path" line per mapping, then its
+	//. "Key: value kB" lines, Rss among them.
+	FILE* f = fopen("/proc/self/smaps", "r");
+	if (f == NULL) return 0;
+	std::set<std::string> files;
+	size_t nResident = 0;
+	bool bMatch = false;
+	char szLine[PATH_MAX + 128];
+	while (fgets(szLine, sizeof(szLine), f) != NULL) {
+		unsigned long nStart, nEnd, nKb;
+		char szPerms[8];
+		int nPath = 0;
+		if (sscanf(szLine, "%lx-%lx %7s %*s %*s %*s %n", &nStart, &nEnd, szPerms, &nPath) == 3 && nPath > 0) {
+			char* pszPath = szLine + nPath;
+			pszPath[strcspn(pszPath, "\n")] = 0;
+			bMatch = szPerms[1] != 'w' && strncmp(pszPath, strPrefix.c_str(), strPrefix.size()) == 0;
+			if (bMatch) files.insert(pszPath);
+		}
+		else if (bMatch && sscanf(szLine, "Rss: %lu kB", &nKb) == 1) nResident += (size_t)nKb * 1024;
+	}
+	fclose(f);
+	*p_pFiles = (int)files.size();
+	return nResident;
+}
+
+bool mi_heap_stats(size_t* p_pAllocated, size_t* p_pFree)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 mi = mallinfo2();
+	*p_pAllocated = mi.uordblks + mi.hblkhd;
+	*p_pFree = mi.fordblks;
+	return true;
+#elif defined(__GLIBC__)
+	//. int fields, they wrap beyond 2 GB.
+	struct mallinfo mi = mallinfo();
+	*p_pAllocated = (size_t)(unsigned)mi.uordblks + (size_t)(unsigned)mi.hblkhd;
+	*p_pFree = (size_t)(unsigned)mi.fordblks;
+	return true;
+#else
+	(void)p_pAllocated;
+	(void)p_pFree;
+	return false;
+#endif
+}
+
+int mi_handle_count()
+{
+	DIR* d = opendir("/proc/self/fd");
+	if (d == NULL) return -1;
+	int n = 0;
+	while (struct dirent* e = readdir(d)) {
+		if (e->d_name[0] != '.') n++;
+	}
+	closedir(d);
+	return n - 1;		//. the descriptor opendir holds
+}
+
+void mi_trim_working_set()
+{
+#if defined(__GLIBC__)
+	malloc_trim(0);
+#endif
+}
+
+static size_t lv_nHugePage = 0;
+
+size_t mi_large_pages_init(std::string& p_strWhy)
+{
+	//. Hugepagesize of /proc/meminfo, the size MAP_HUGETLB maps without a size flag.
+	lv_nHugePage = 0;
+	FILE* f = fopen("/proc/meminfo", "r");
+	if (f != NULL) {
+		char szLine[128];
+		unsigned long nKb = 0;
+		while (fgets(szLine, sizeof(szLine), f) != NULL) {
+			if (sscanf(szLine, "Hugepagesize: %lu kB", &nKb) == 1) {
+				lv_nHugePage = (size_t)nKb * 1024;
+				break;
+			}
+		}
+		fclose(f);
+	}
+	if (lv_nHugePage == 0) p_strWhy = "no Hugepagesize in /proc/meminfo";
+	return lv_nHugePage;
+}
+
+void* mi_large_alloc(size_t p_nSize, MiPageKind& p_kind)
+{
+	p_kind = MI_PAGES_SMALL;
+	if (lv_nHugePage == 0) return NULL;
+	//. reserved huge pages (vm.nr_hugepages) first.
+	void* p = mmap(NULL, p_nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p != MAP_FAILED) {
+		p_kind = MI_PAGES_LARGE;
+		return p;
+	}
+	//. else a huge-page aligned mapping for THP : map one page more and cut the ends off.
+	size_t nMap = p_nSize + lv_nHugePage;
+	char* base = (char*)mmap(NULL, nMap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == (char*)MAP_FAILED) return NULL;
+	char* q = (char*)(((uintptr_t)base + lv_nHugePage - 1) & ~(uintptr_t)(lv_nHugePage - 1));
+	if (q > base) munmap(base, (size_t)(q - base));
+	if (q + p_nSize < base + nMap) munmap(q + p_nSize, (size_t)(base + nMap - (q + p_nSize)));
+	if (madvise(q, p_nSize, MADV_HUGEPAGE) != 0) {
+		//. no THP in this kernel : the caller allocates normally.
+		munmap(q, p_nSize);
+		return NULL;
+	}
+	p_kind = MI_PAGES_TRANSPARENT;
+	return q;
+}
+
+void mi_large_free(void* p_p, size_t p_nSize)
+{
+	munmap(p_p, p_nSize);
+}
+
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+
+//. OS layer : the Win32 calls the server cannot do through the standard library or Poco,
+//. with their POSIX equivalents for the Linux build (CMakeLists.txt). Threads, locks and
+//. sockets are std:: / Poco already; the Poco reactor polls with epoll on Linux.
+
+#ifdef _WIN32
+#include <windows.h>
+#define MI_HAS_WIC		1			//. WIC decode paths (MiWic.h)
+#define MI_HAS_MF		1			//. Media Foundation video decode (MiVideo.h)
+typedef HMODULE			MiModule;
+typedef GROUP_AFFINITY	MiAffinity;	//. processors a thread may run on
+#else
+#include <sched.h>
+#define MI_HAS_WIC		0
+#define MI_HAS_MF		0
+typedef void*			MiModule;
+typedef cpu_set_t		MiAffinity;
+typedef long long		INT64;		//. license record (MiKeyMgr.h)
+#endif
+
+//. shared library : LoadLibrary / dlopen, NULL when it cannot be loaded.
+MiModule mi_module_open(const char* p_pszPath);
+void mi_module_close(MiModule p_hModule);
+void* mi_module_symbol(MiModule p_hModule, const char* p_pszName);
+//. file the module was loaded from, empty when unknown.
+std::string mi_module_path(MiModule p_hModule);
+//. "1.2.3.4" from the version resource on Windows, from the ".so.1.2.3" name the module
+//. resolves to on Linux. Empty when there is none.
+std::string mi_module_version(MiModule p_hModule);
+
+//. monotonic milliseconds.
+uint64_t mi_tick_ms();
+void mi_sleep_ms(unsigned int p_nMs);
+//. local time of p_t, false when it cannot be converted.
+bool mi_localtime(time_t p_t, struct tm* p_pOut);
+int mi_stricmp(const char* p_pszA, const char* p_pszB);
+//. OS thread id, what debuggers and perf tools show.
+uint32_t mi_thread_id();
+//. CPU time (user + kernel) of the calling thread in ns. GetThreadTimes advances in
+//. scheduler ticks (15.6 ms by default), so only sums over many calls are meaningful there.
+uint64_t mi_thread_cpu_ns();
+//. CPU time (user + kernel) of every thread of the process in ns, same granularity.
+uint64_t mi_process_cpu_ns();
+
+//. processors 0..63 of p_nMask (processor group 0 on Windows).
+void mi_affinity_from_mask(uint64_t p_nMask, MiAffinity& p_out);
+//. processors 0..63 the process may run on, 0 when unknown.
+uint64_t mi_process_affinity_mask();
+//. pins the calling thread; p_pPrev (optional) receives the affinity it had.
+bool mi_thread_set_affinity(const MiAffinity& p_affinity, MiAffinity* p_pPrev = NULL);
+//. lowest scheduling priority for the calling thread (THREAD_PRIORITY_LOWEST, nice 19);
+//. on Linux the threads it creates afterwards inherit it.
+bool mi_thread_set_background();
+
+//. p_nSize bytes aligned to p_nAlign (a power of two), NULL when out of memory.
+void* mi_aligned_alloc(size_t p_nSize, size_t p_nAlign);
+void mi_aligned_free(void* p_p);
+//. largest resident set of the process since start (peak working set on Windows), 0 when unknown.
+size_t mi_peak_rss();
+//. resident set of the process now (working set on Windows), 0 when unknown.
+size_t mi_rss();
+//. resident bytes of the read-only file mappings of the process whose file lies under
+//. p_strDir : pages in the OS file cache that every process mapping the same files shares.
+//. p_pFiles receives the number of such files. 0 when none or unknown.
+size_t mi_mapped_resident(const std::string& p_strDir, int* p_pFiles);
+//. the C heap : bytes handed out and bytes it holds free (HeapSummary of the process heap
+//. on Windows, mallinfo on Linux); false when unknown. Free bytes that keep growing while
+//. the allocated ones do not are fragmentation.
+bool mi_heap_stats(size_t* p_pAllocated, size_t* p_pFree);
+//. open handles (Windows) / file descriptors (Linux) of the process, -1 when unknown.
+int mi_handle_count();
+//. gives the free pages of the C heap back to the OS (malloc_trim on Linux, HeapCompact and
+//. an emptied working set on Windows, whose pages fault back in as they are touched).
+void mi_trim_working_set();
+
+//. backing of a mi_large_alloc block.
+enum MiPageKind {
+	MI_PAGES_SMALL = 0,		//. not from mi_large_alloc
+	MI_PAGES_LARGE,			//. MEM_LARGE_PAGES (Windows) / MAP_HUGETLB (Linux)
+	MI_PAGES_TRANSPARENT	//. Linux mapping advised MADV_HUGEPAGE, the kernel backs it when it can
+};
+
+//. large-page allocation : enables SeLockMemoryPrivilege on Windows (the account needs
+//. "Lock pages in memory") and reads the huge page size. Returns the large page size,
+//. 0 with p_strWhy when mi_large_alloc cannot be used.
+size_t mi_large_pages_init(std::string& p_strWhy);
+//. p_nSize bytes (a multiple of the large page size) on large pages, else transparent
+//. huge pages on Linux; NULL when neither is available (the caller allocates normally).
+void* mi_large_alloc(size_t p_nSize, MiPageKind& p_kind);
+void mi_large_free(void* p_p, size_t p_nSize);
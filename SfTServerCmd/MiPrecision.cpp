@@ -0,0 +1,166 @@
+#include "MiPrecision.h"
+#include "MiBlueprint.h"
+#include "MiConf.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "MiSettings.h"
+#include "MiTenants.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include <iostream>
+#include <memory>
+
+static std::vector<std::string>		lv_vModes(1, "main");
+static std::vector<int>				lv_vTenantPool;		//. by tenant index, -1 = main
+
+//. the runtime hint of p_strPrecision, empty for int8; false when it is unknown.
+static bool precision_hint(const std::string& p_strPrecision, std::string& p_strHint)
+{
+	if (p_strPrecision == "fp32") p_strHint = "f32";
+	else if (p_strPrecision == "bf16") p_strHint = "bf16";
+	else if (p_strPrecision == "fp16") p_strHint = "f16";
+	else if (p_strPrecision == "int8") p_strHint.clear();
+	else return false;
+	return true;
+}
+
+//. the [backend] values with the fields of one mode; false when a field is unknown.
+static bool mode_settings(const std::string& p_strName, const std::string& p_strFields, BlueprintSettings& p_settings)
+{
+	p_settings = mi_blueprint_settings();
+	p_settings.cascadePipeline.clear();
+	std::string strPrecision;
+	Poco::StringTokenizer fields(p_strFields, ";", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& f : fields) {
+		size_t eq = f.find('=');
+		if (eq == std::string::npos) return false;
+		std::string key = Poco::toLower(Poco::trim(f.substr(0, eq)));
+		std::string value = Poco::trim(f.substr(eq + 1));
+		if (key == "precision") strPrecision = Poco::toLower(value);
+		else if (key == "pipeline") p_settings.pipeline = value;
+		else if (key == "profile") p_settings.profile = value;
+		//. '+' between the pairs, the [backend] parameters keep their ','.
+		else if (key == "parameters") p_settings.parameters += "," + Poco::replace(value, "+", ",");
+		else return false;
+	}
+	if (strPrecision.empty()) return true;
+	std::string strHint;
+	if (!precision_hint(strPrecision, strHint)) return false;
+	if (!strHint.empty()) p_settings.parameters += std::string(",") + GD_PRECISION_PARAMETER + "=" + strHint;
+	else if (p_settings.pipeline.empty() || p_settings.pipeline == g_Settings.backendPipeline)
+		std::cout << "Precision : mode " << p_strName << " : int8 needs the pipeline of a quantized model" << std::endl;
+	return true;
+}
+
+class PrecisionBackend : public InferenceBackend {
+public:
+	PrecisionBackend(InferenceBackend* p_pPrimary, std::vector<std::unique_ptr<InferenceBackend>>& p_vPools)
+		: m_pPrimary(p_pPrimary)
+	{
+		m_vPools.swap(p_vPools);
+	}
+
+	const char* name() const override { return m_pPrimary->name(); }
+
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		return pick()->check(p_pData, p_nLen, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		return pick()->check_pixels(p_pPixels, p_nWidth, p_nHeight, p_encoding, p_pMeta, p_pErr, p_pszMsg);
+	}
+
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override
+	{
+		pick()->check_batch(p_vData, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+	}
+
+	void warm_up(int p_nIterations) override
+	{
+		m_pPrimary->warm_up(p_nIterations);
+		for (auto& p : m_vPools) if (p) p->warm_up(p_nIterations);
+	}
+
+	BackendRuntime runtime() const override { return m_pPrimary->runtime(); }
+
+private:
+	//. the pool of the request's tenant, the main engine otherwise.
+	InferenceBackend* pick()
+	{
+		int pool = mi_precision_mode() - 1;
+		mi_metrics_precision(pool + 1);
+		return pool >= 0 ? m_vPools[pool].get() : m_pPrimary.get();
+	}
+
+	std::unique_ptr<InferenceBackend>				m_pPrimary;
+	std::vector<std::unique_ptr<InferenceBackend>>	m_vPools;		//. by mode, NULL = not built
+};
+
+InferenceBackend* mi_precision_backend(InferenceBackend* p_pPrimary, const std::string& p_strModes, const std::string& p_strTenants, std::string& p_strErr)
+{
+	std::vector<std::string> vNames;
+	std::vector<std::unique_ptr<InferenceBackend>> vPools;
+	size_t nBuilt = 0;
+	Poco::StringTokenizer items(p_strModes, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : items) {
+		size_t colon = item.find(':');
+		std::string strName = Poco::trim(item.substr(0, colon));
+		BlueprintSettings settings;
+		std::unique_ptr<InferenceBackend> p;
+		if (!mode_settings(strName, colon != std::string::npos ? item.substr(colon + 1) : std::string(), settings)) {
+			std::cout << "Precision : mode " << strName << " : unknown field or precision, left out" << std::endl;
+		}
+		else {
+			std::string strErr;
+			p.reset(mi_backend_create("blueprint", settings, strErr));
+			if (!p) std::cout << "Precision : mode " << strName << " : " << strErr << ", left out" << std::endl;
+			else nBuilt++;
+		}
+		vNames.push_back(strName);
+		vPools.push_back(std::move(p));
+	}
+	if (nBuilt == 0) {
+		p_strErr = vNames.empty() ? "no modes" : "no mode could be built";
+		return p_pPrimary;
+	}
+
+	const std::vector<std::string>& vTenants = mi_tenant_names();
+	std::vector<int> vTenantPool(vTenants.size(), -1);
+	Poco::StringTokenizer tenants(p_strTenants, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : tenants) {
+		Poco::StringTokenizer f(item, ":", Poco::StringTokenizer::TOK_TRIM);
+		size_t idx = 0;
+		while (idx < vTenants.size() && vTenants[idx] != f[0]) idx++;
+		if (idx == vTenants.size()) {
+			std::cout << "Precision : no tenant " << f[0] << " in [tenants] list" << std::endl;
+			continue;
+		}
+		size_t mode = 0;
+		while (mode < vNames.size() && (f.count() < 2 || vNames[mode] != f[1])) mode++;
+		if (mode == vNames.size() || !vPools[mode]) {
+			std::cout << "Precision : tenant " << f[0] << " : no such mode, main engine" << std::endl;
+			continue;
+		}
+		vTenantPool[idx] = (int)mode;
+	}
+
+	lv_vModes.resize(1);
+	lv_vModes.insert(lv_vModes.end(), vNames.begin(), vNames.end());
+	lv_vTenantPool.swap(vTenantPool);
+	std::cout << "Precision : " << nBuilt << " of " << vNames.size() << " modes built" << std::endl;
+	return new PrecisionBackend(p_pPrimary, vPools);
+}
+
+const std::vector<std::string>& mi_precision_modes()
+{
+	return lv_vModes;
+}
+
+int mi_precision_mode()
+{
+	RequestContext* ctx = mi_context();
+	int tenant = ctx != NULL ? ctx->tenant : -1;
+	return tenant >= 0 && (size_t)tenant < lv_vTenantPool.size() ? lv_vTenantPool[tenant] + 1 : 0;
+}
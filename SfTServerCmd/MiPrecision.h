@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include "MiBackend.h"
+
+//. Precision pools ([precision] settings) : named variants of the blueprint engine, each
+//. its own Blueprint and FaceAnalyzer, and tenants routed to one of them - e.g. a "fast"
+//. pool in BF16 (AMX on Sapphire Rapids) or an INT8 pipeline, and an "accurate" one in FP32.
+//. - modes : "name:precision=bf16;pipeline=...;parameters=k=v+k=v;profile=..., ..."
+//.   precision fp32 / bf16 / fp16 sets the GD_PRECISION_PARAMETER runtime parameter
+//.   (RuntimeConfiguration::parameters); int8 has no runtime hint and needs the pipeline of
+//.   a quantized model (one of GetAvailablePipelines). The other keys override the
+//.   [backend] values of that pool; its cascade is off.
+//. - tenants : "tenant:mode, ..." by [tenants] name; other tenants stay on the main engine.
+//. The pools answer g_pBackend calls (check, check_pixels, check_batch); the legacy batch
+//. and sequence paths keep the main pipelines. A pool that cannot be built is left out and
+//. its tenants stay on the main engine.
+//. To quantify a mode : LivenessBench --api-key of a tenant on it against one on the main
+//. engine, then BenchDiff for the latency; [shadow] with the mode's parameters for the
+//. verdict agreement on real traffic. mi_precision_checks_total{mode} on GD_API_METRICS.
+
+//. p_pPrimary with the tenants of the modes routed to their pools; takes ownership.
+//. p_pPrimary itself, and p_strErr set, when no mode could be built.
+InferenceBackend* mi_precision_backend(InferenceBackend* p_pPrimary, const std::string& p_strModes, const std::string& p_strTenants, std::string& p_strErr);
+
+//. mode names by index, [0] = "main" (requests not routed).
+const std::vector<std::string>& mi_precision_modes();
+
+//. mode index (mi_precision_modes) of the pool that checks the current request, 0 = main engine.
+int mi_precision_mode();
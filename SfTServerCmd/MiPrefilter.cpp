@@ -0,0 +1,174 @@
+#include "MiPrefilter.h"
+#include "MiCpu.h"
+#include <string.h>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_PREFILTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define LD_TARGET_AVX2
+#else
+#define LD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define LD_PREFILTER_X86 0
+#endif
+
+//. longest gray side : the per-row 32-bit lane sums of squared Laplacians stay exact.
+#define LD_PREFILTER_SIDE_MAX	1024
+
+static const char* lv_szOutcomes[MI_PREFILTER_COUNT] = { "pass", "blur", "dark", "skipped" };
+static const char* lv_szSdk[MI_PREFILTER_SDK_COUNT] = { "usable", "bad_quality", "rejected" };
+
+//. sum and sum of squares of the Laplacian over cells 1 .. w - 2 of gray row p_pRow.
+typedef void (*LaplacianRowFn)(const uint8_t* p_pUp, const uint8_t* p_pRow, const uint8_t* p_pDown, int p_nWidth, int64_t& p_nSum, uint64_t& p_nSumSq);
+
+static inline int laplacian_at(const uint8_t* p_pUp, const uint8_t* p_pRow, const uint8_t* p_pDown, int x)
+{
+	return 4 * (int)p_pRow[x] - (int)p_pRow[x - 1] - (int)p_pRow[x + 1] - (int)p_pUp[x] - (int)p_pDown[x];
+}
+
+static void laplacian_row_scalar(const uint8_t* p_pUp, const uint8_t* p_pRow, const uint8_t* p_pDown, int p_nWidth, int64_t& p_nSum, uint64_t& p_nSumSq)
+{
+	for (int x = 1; x < p_nWidth - 1; x++) {
+		int l = laplacian_at(p_pUp, p_pRow, p_pDown, x);
+		p_nSum += l;
+		p_nSumSq += (uint64_t)(l * l);
+	}
+}
+
+#if LD_PREFILTER_X86
+
+LD_TARGET_AVX2 static inline __m256i load16(const uint8_t* p)
+{
+	return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+}
+
+//. 16 cells per step as int16 (|l| <= 1020), pair sums by madd into 32-bit lanes.
+LD_TARGET_AVX2 static void laplacian_row_avx2(const uint8_t* p_pUp, const uint8_t* p_pRow, const uint8_t* p_pDown, int p_nWidth, int64_t& p_nSum, uint64_t& p_nSumSq)
+{
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+	__m256i sq = _mm256_setzero_si256();
+	int x = 1;
+	for (; x + 16 <= p_nWidth - 1; x += 16) {
+		__m256i c = _mm256_slli_epi16(load16(p_pRow + x), 2);
+		__m256i n = _mm256_add_epi16(_mm256_add_epi16(load16(p_pRow + x - 1), load16(p_pRow + x + 1)), _mm256_add_epi16(load16(p_pUp + x), load16(p_pDown + x)));
+		__m256i l = _mm256_sub_epi16(c, n);
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(l, ones));
+		sq = _mm256_add_epi32(sq, _mm256_madd_epi16(l, l));
+	}
+	alignas(32) int32_t s[8], q[8];
+	_mm256_store_si256((__m256i*)s, sum);
+	_mm256_store_si256((__m256i*)q, sq);
+	for (int i = 0; i < 8; i++) {
+		p_nSum += s[i];
+		p_nSumSq += (uint64_t)(uint32_t)q[i];
+	}
+	for (; x < p_nWidth - 1; x++) {
+		int l = laplacian_at(p_pUp, p_pRow, p_pDown, x);
+		p_nSum += l;
+		p_nSumSq += (uint64_t)(l * l);
+	}
+}
+
+#endif
+
+static LaplacianRowFn lv_fnRow = laplacian_row_scalar;
+
+static void bind_prefilter(int p_nVariant)
+{
+	lv_fnRow = laplacian_row_scalar;
+#if LD_PREFILTER_X86
+	if (p_nVariant == 1) lv_fnRow = laplacian_row_avx2;
+#else
+	(void)p_nVariant;
+#endif
+}
+
+static const char* const lv_szVariants[] = { "scalar", "avx2" };
+static const uint32_t lv_nNeeds[] = { 0, MI_CPU_AVX2 };
+static MiCpuKernel lv_kernel = { "prefilter", LD_PREFILTER_X86 ? 2 : 1, lv_szVariants, lv_nNeeds, bind_prefilter, 0, 0 };
+static const bool lv_bRegistered = mi_cpu_register(&lv_kernel);
+
+//. luma * 256 of one pixel, p_nR / p_nB the byte offsets of red and blue.
+static inline uint32_t luma256(const uint8_t* p, int p_nR, int p_nB)
+{
+	return 77u * p[p_nR] + 150u * p[1] + 29u * p[p_nB];
+}
+
+bool mi_prefilter_measure(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding,
+	int p_nSide, int p_nDarkLevel, PrefilterStats& p_stats)
+{
+	if (p_nSide > LD_PREFILTER_SIDE_MAX) p_nSide = LD_PREFILTER_SIDE_MAX;
+	if (p_nSide < 3) p_nSide = 3;
+	int nLong = p_nWidth > p_nHeight ? p_nWidth : p_nHeight;
+	int k = (nLong + p_nSide - 1) / p_nSide;
+	if (k < 1) k = 1;
+	int w = p_nWidth / k, h = p_nHeight / k;
+	memset(&p_stats, 0, sizeof(p_stats));
+	p_stats.width = w;
+	p_stats.height = h;
+	if (w < 3 || h < 3) return false;
+
+	int nR = p_encoding == RGB888 ? 0 : 2, nB = 2 - nR;
+	//. the cell's 2 x 2 centre pixels, or the pixel itself when nothing is reduced.
+	int nOff = k > 1 ? k / 2 - 1 : 0;
+	static thread_local std::vector<uint8_t> lv_vGray;
+	lv_vGray.resize((size_t)w * h);
+	uint8_t* gray = lv_vGray.data();
+	uint64_t nLuma = 0;
+	for (int y = 0; y < h; y++) {
+		const uint8_t* r0 = p_pPixels + (size_t)(y * k + nOff) * p_nStride;
+		const uint8_t* r1 = k > 1 ? r0 + p_nStride : r0;
+		uint8_t* out = gray + (size_t)y * w;
+		for (int x = 0; x < w; x++) {
+			size_t at = (size_t)(x * k + nOff) * 3;
+			uint32_t v;
+			if (k > 1) v = (luma256(r0 + at, nR, nB) + luma256(r0 + at + 3, nR, nB) + luma256(r1 + at, nR, nB) + luma256(r1 + at + 3, nR, nB) + 512) >> 10;
+			else v = (luma256(r0 + at, nR, nB) + 128) >> 8;
+			out[x] = (uint8_t)v;
+			p_stats.histogram[v]++;
+			nLuma += v;
+		}
+	}
+	size_t nCells = (size_t)w * h;
+	uint64_t nDark = 0;
+	for (int i = 0; i < p_nDarkLevel && i < 256; i++) nDark += p_stats.histogram[i];
+	p_stats.darkPercent = 100.0 * (double)nDark / (double)nCells;
+	p_stats.meanLuma = (double)nLuma / (double)nCells;
+
+	int64_t nSum = 0;
+	uint64_t nSumSq = 0;
+	for (int y = 1; y < h - 1; y++) {
+		const uint8_t* row = gray + (size_t)y * w;
+		lv_fnRow(row - w, row, row + w, w, nSum, nSumSq);
+	}
+	double n = (double)(w - 2) * (double)(h - 2);
+	double mean = (double)nSum / n;
+	p_stats.sharpness = (double)nSumSq / n - mean * mean;
+	return true;
+}
+
+PrefilterOutcome mi_prefilter_judge(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding,
+	const PrefilterThresholds& p_thresholds, PrefilterStats* p_pStats)
+{
+	PrefilterStats local;
+	PrefilterStats& stats = p_pStats != NULL ? *p_pStats : local;
+	if (!mi_prefilter_measure(p_pPixels, p_nWidth, p_nHeight, p_nStride, p_encoding, p_thresholds.side, p_thresholds.darkLevel, stats)) return MI_PREFILTER_SKIPPED;
+	//. a dark capture has no edges either : darkness is the more useful answer.
+	if (p_thresholds.darkPercent > 0 && stats.darkPercent > p_thresholds.darkPercent) return MI_PREFILTER_DARK;
+	if (p_thresholds.minSharpness > 0 && stats.sharpness < p_thresholds.minSharpness) return MI_PREFILTER_BLUR;
+	return MI_PREFILTER_PASS;
+}
+
+const char* mi_prefilter_outcome_name(int p_nOutcome)
+{
+	return p_nOutcome >= 0 && p_nOutcome < MI_PREFILTER_COUNT ? lv_szOutcomes[p_nOutcome] : "unknown";
+}
+
+const char* mi_prefilter_sdk_name(int p_nSdk)
+{
+	return p_nSdk >= 0 && p_nSdk < MI_PREFILTER_SDK_COUNT ? lv_szSdk[p_nSdk] : "unknown";
+}
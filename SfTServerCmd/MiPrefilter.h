@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <facesdk/FaceSDK_C_Api.h>
+
+//. Blur / darkness prefilter ([prefilter] settings) : hopeless captures are answered
+//. "bad quality" before any SDK call. The pixels are reduced to a gray copy of at most
+//. side pixels on the long side (each cell the average of the 2 x 2 pixels at its centre,
+//. BT.601 luma), whose luma histogram gives the share of dark pixels and whose 4-neighbour
+//. Laplacian variance measures sharpness : a blurred or defocused capture has few edges
+//. left. The Laplacian is the dispatched kernel (MiCpu.h) : AVX2 (16 cells per step) or
+//. scalar, both exact integer sums. A 256 cell copy takes well under a millisecond.
+//. Only images whose pixels the server holds are screened (check_pixels : face crops,
+//. DCT-scaled decodes, pixel uploads); uploads the SDK decodes itself are not.
+//. The backend wrapper is mi_prefilter_backend (MiBackend.h).
+
+enum PrefilterOutcome {
+	MI_PREFILTER_PASS = 0,
+	MI_PREFILTER_BLUR,			//. sharpness below min_sharpness
+	MI_PREFILTER_DARK,			//. more than dark_percent of the cells below dark_level
+	MI_PREFILTER_SKIPPED,		//. too small to measure
+	MI_PREFILTER_COUNT
+};
+
+//. what the SDK made of an image the prefilter also judged (mi_prefilter_agreement_total).
+enum PrefilterSdk {
+	MI_PREFILTER_SDK_USABLE = 0,		//. any verdict but bad quality
+	MI_PREFILTER_SDK_BAD_QUALITY,
+	MI_PREFILTER_SDK_REJECTED,			//. a STATUS other than OK (no face, too small ...)
+	MI_PREFILTER_SDK_COUNT
+};
+
+struct PrefilterStats {
+	int			width;			//. gray copy
+	int			height;
+	double		sharpness;		//. variance of the Laplacian
+	double		darkPercent;	//. cells below the dark level
+	double		meanLuma;
+	uint32_t	histogram[256];
+};
+
+struct PrefilterThresholds {
+	int			side;			//. long side of the gray copy
+	double		minSharpness;	//. <= 0 = no blur check
+	int			darkLevel;
+	double		darkPercent;	//. <= 0 = no darkness check
+};
+
+//. measures p_nWidth x p_nHeight packed 24-bit pixels; false when the gray copy would
+//. be smaller than 3 x 3.
+bool mi_prefilter_measure(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding,
+	int p_nSide, int p_nDarkLevel, PrefilterStats& p_stats);
+
+//. measure and judge in one; p_pStats receives the measures when not NULL.
+PrefilterOutcome mi_prefilter_judge(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, size_t p_nStride, COLOR_ENCODING_t p_encoding,
+	const PrefilterThresholds& p_thresholds, PrefilterStats* p_pStats = NULL);
+
+const char* mi_prefilter_outcome_name(int p_nOutcome);
+const char* mi_prefilter_sdk_name(int p_nSdk);
@@ -0,0 +1,628 @@
+#include "MiProactorServer.h"
+#include "MIServer.h"
+#include "MiAdmission.h"
+#include "MiConnection.h"
+#include "MiCores.h"
+#include "MiReactorHttp.h"
+#include "MiStages.h"
+#include "MiWorkerPool.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/SocketProactor.h"
+#include "Poco/Thread.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define LD_MAX_HEADER		(64 * 1024)
+#define LD_READ_CHUNK		(256 * 1024)
+#define LD_BUFFERS_KEPT		64			//. read buffers the pool keeps for requests to come
+#define LD_SWEEP_MS			250			//. timeouts and closed peers
+
+typedef SocketProactor::Buffer ProactorBuffer;
+
+struct ProactorJob {
+	ReactorServerResponse	response;
+	ReactorServerRequest	request;
+	std::chrono::steady_clock::time_point	arrival;	//. header received
+	ProactorJob(const SocketAddress& p_client, const SocketAddress& p_server, const HTTPServerParams& p_params)
+		: request(response, p_client, p_server, p_params) {}
+};
+
+static HTTPServerParams::Ptr lv_pParams;
+static std::atomic<size_t> lv_nConnections(0);
+//. requests whose header arrived and whose body is still being received.
+static std::atomic<int> lv_nReceiving(0);
+
+static void receiving(int p_nDelta)
+{
+	mi_stage_depth(MI_PIPE_RECEIVE, lv_nReceiving.fetch_add(p_nDelta) + p_nDelta);
+}
+
+//. read buffers of the requests being received; an idle connection has none.
+static std::mutex lv_mtxBuffers;
+static std::vector<ProactorBuffer*> lv_vBuffers;	//. guarded by lv_mtxBuffers
+
+static ProactorBuffer* buffer_acquire()
+{
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxBuffers);
+		if (!lv_vBuffers.empty()) {
+			ProactorBuffer* p = lv_vBuffers.back();
+			lv_vBuffers.pop_back();
+			return p;
+		}
+	}
+	ProactorBuffer* p = new ProactorBuffer;
+	p->reserve(LD_READ_CHUNK);
+	return p;
+}
+
+static void buffer_release(ProactorBuffer* p_pBuf)
+{
+	if (p_pBuf == NULL) return;
+	p_pBuf->clear();
+	//. the proactor sizes a read to what the socket has; a burst must not stay pinned.
+	if (p_pBuf->capacity() > 4 * LD_READ_CHUNK) {
+		ProactorBuffer().swap(*p_pBuf);
+		p_pBuf->reserve(LD_READ_CHUNK);
+	}
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxBuffers);
+		if (lv_vBuffers.size() < LD_BUFFERS_KEPT) {
+			lv_vBuffers.push_back(p_pBuf);
+			return;
+		}
+	}
+	delete p_pBuf;
+}
+
+//. short checks that have their own worker pool, see MiQuality.h
+static WorkerPool* lv_pQualityPool = NULL;
+
+class ProactorConnection;
+
+//. one proactor and its thread on the [cores] io processors, with the connections it
+//. serves for the timeout sweep.
+class IoProactor : public Poco::Runnable {
+public:
+	IoProactor() : proactor(Poco::Timespan(0, LD_SWEEP_MS * 1000)) {}
+	void run() override
+	{
+		mi_cores_pin(MI_CORES_IO);
+		proactor.run();
+	}
+
+	SocketProactor											proactor;
+	Poco::Thread											thread;
+	std::mutex												mtx;
+	std::vector<std::weak_ptr<ProactorConnection>>			conns;		//. guarded by mtx
+};
+
+//. One client connection. Every member is guarded by m_mtx : completions, the worker
+//. that finishes a request and the sweep all touch it. At most one read or send is
+//. posted at a time, and its completion holds a shared_ptr, so the buffer it fills
+//. outlives it. Closing shuts the socket down first : a posted read then completes
+//. (with nothing), and only the last completion closes the descriptor, so a stale
+//. handler never sees a reused one.
+class ProactorConnection : public std::enable_shared_from_this<ProactorConnection> {
+public:
+	ProactorConnection(const StreamSocket& p_socket, IoProactor& p_io)
+		: m_socket(p_socket), m_io(p_io), m_pRead(NULL)
+		, m_nBodyLen(0), m_nOutPos(0), m_nRequests(0)
+		, m_bPosted(false), m_bBusy(false), m_bKeep(false), m_bClosed(false)
+	{
+		m_client = m_socket.peerAddress();
+		m_server = m_socket.address();
+		m_socket.setBlocking(false);
+		mi_socket_tune(m_socket);
+		m_tActivity = std::chrono::steady_clock::now();
+		lv_nConnections++;
+	}
+
+	~ProactorConnection()
+	{
+		buffer_release(m_pRead);
+		lv_nConnections--;
+	}
+
+	//. accept thread : registers the socket and posts the first read.
+	void start()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_io.proactor.addSocket(m_socket, SocketProactor::POLL_READ | SocketProactor::POLL_ERROR);
+		post_receive();
+	}
+
+	//. worker thread : sends the serialized response.
+	void complete(std::string&& p_strOut, bool p_bKeepAlive)
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if (m_bClosed) return;
+		send(std::move(p_strOut), p_bKeepAlive);
+	}
+
+	//. sweep : closes on the request / keep-alive timeouts and on a peer that went away
+	//. while idle (its posted read may see no bytes to complete with).
+	void sweep(std::chrono::steady_clock::time_point p_now)
+	{
+		bool bClose = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if (m_bClosed || m_bBusy || !m_strOut.empty()) return;
+			bool bStarted = m_pJob || !m_strIn.empty();
+			int limitSec = bStarted ? g_Settings.timeoutSec : g_Settings.keepAliveTimeoutSec;
+			bClose = p_now - m_tActivity > std::chrono::seconds(limitSec) || (!bStarted && mi_socket_closed(m_socket));
+		}
+		if (bClose) close();
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if (m_bClosed) return;
+		m_bClosed = true;
+		try {
+			m_socket.shutdown();
+		}
+		catch (Poco::Exception&) {
+		}
+		if (m_pJob) {
+			m_pJob.reset();
+			receiving(-1);
+		}
+		if (!m_bPosted) release();
+	}
+
+private:
+	//. a request handed to a worker that ends without complete (an exception, which the
+	//. pool swallows) : answers 500 and closes, instead of leaving the connection busy,
+	//. which the sweep skips.
+	class Unanswered {
+	public:
+		explicit Unanswered(const std::shared_ptr<ProactorConnection>& p_pConn) : m_pConn(p_pConn) {}
+		~Unanswered() { if (m_pConn) m_pConn->fail(); }
+		void dismiss() { m_pConn.reset(); }
+	private:
+		std::shared_ptr<ProactorConnection>	m_pConn;
+	};
+
+	//. m_bBusy stays set until the response is sent, so an answer already on its way is left alone.
+	void fail()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if (m_bClosed || !m_bBusy || !m_strOut.empty()) return;
+		m_strIn.clear();
+		reply(HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, false);
+	}
+
+	//. m_mtx must be held : one read, into the pooled buffer while a request is under way.
+	void post_receive()
+	{
+		bool bStarted = m_pJob || !m_strIn.empty();
+		if (bStarted && m_pRead == NULL) m_pRead = buffer_acquire();
+		if (!bStarted && m_pRead != NULL) {
+			buffer_release(m_pRead);
+			m_pRead = NULL;
+		}
+		ProactorBuffer& buf = m_pRead != NULL ? *m_pRead : m_idle;
+		buf.clear();
+		m_bPosted = true;
+		std::shared_ptr<ProactorConnection> self = shared_from_this();
+		m_io.proactor.addReceive(m_socket, buf, [self](const std::error_code& p_err, int p_nBytes) { self->onReceive(p_err, p_nBytes); });
+	}
+
+	void onReceive(const std::error_code& p_err, int p_nBytes)
+	{
+		bool bClose = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bPosted = false;
+			if (m_bClosed) {
+				release();
+				return;
+			}
+			if (p_err || p_nBytes <= 0) bClose = true;
+			else {
+				ProactorBuffer& buf = m_pRead != NULL ? *m_pRead : m_idle;
+				const char* p = (const char*)buf.data();
+				size_t n = std::min((size_t)p_nBytes, buf.size());
+				//. once the header is parsed the body is received in place.
+				if (m_pJob && m_pJob->request.body().size() < m_nBodyLen) {
+					std::string& body = m_pJob->request.body();
+					size_t take = std::min(n, m_nBodyLen - body.size());
+					body.append(p, take);
+					p += take;
+					n -= take;
+				}
+				m_strIn.append(p, n);
+				//. what an idle read was sized to is not kept.
+				if (m_pRead == NULL) ProactorBuffer().swap(m_idle);
+				else buf.clear();
+				m_tActivity = std::chrono::steady_clock::now();
+				bClose = !parse();
+				if (!bClose && !m_bBusy && m_strOut.empty()) post_receive();
+			}
+		}
+		if (bClose) close();
+	}
+
+	void onSend(const std::error_code& p_err, int p_nBytes)
+	{
+		bool bClose = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bPosted = false;
+			if (m_bClosed) {
+				release();
+				return;
+			}
+			if (p_err || p_nBytes <= 0) bClose = true;
+			else {
+				m_nOutPos += p_nBytes;
+				m_tActivity = std::chrono::steady_clock::now();
+				if (m_nOutPos < m_strOut.size()) post_send();
+				else {
+					m_io.proactor.updateSocket(m_socket, SocketProactor::POLL_READ | SocketProactor::POLL_ERROR);
+					m_strOut.clear();
+					m_nOutPos = 0;
+					m_bBusy = false;
+					if (!m_bKeep) bClose = true;
+					else {
+						//. a pipelined request may already be buffered.
+						bClose = !parse();
+						if (!bClose && !m_bBusy && m_strOut.empty()) post_receive();
+					}
+				}
+			}
+		}
+		if (bClose) close();
+	}
+
+	//. m_mtx must be held.
+	void send(std::string&& p_strOut, bool p_bKeepAlive)
+	{
+		m_strOut = std::move(p_strOut);
+		m_nOutPos = 0;
+		m_bKeep = p_bKeepAlive;
+		m_io.proactor.updateSocket(m_socket, SocketProactor::POLL_WRITE | SocketProactor::POLL_ERROR);
+		post_send();
+	}
+
+	//. m_mtx must be held : the rest of m_strOut, which a send may take part of.
+	void post_send()
+	{
+		ProactorBuffer out(m_strOut.begin() + m_nOutPos, m_strOut.end());
+		m_bPosted = true;
+		std::shared_ptr<ProactorConnection> self = shared_from_this();
+		m_io.proactor.addSend(m_socket, std::move(out), [self](const std::error_code& p_err, int p_nBytes) { self->onSend(p_err, p_nBytes); });
+	}
+
+	//. parses whatever is buffered and submits a complete request. m_mtx must be held.
+	//. Returns false when the connection has to be closed.
+	bool parse()
+	{
+		if (m_bBusy || !m_strOut.empty()) return true;
+
+		if (!m_pJob) {
+			size_t pos = m_strIn.find("\r\n\r\n");
+			if (pos == std::string::npos) {
+				if (m_strIn.size() > LD_MAX_HEADER) reply(HTTPResponse::HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE, false);
+				return true;
+			}
+			size_t headerLen = pos + 4;
+
+			m_pJob.reset(new ProactorJob(m_client, m_server, *lv_pParams));
+			m_pJob->request.set_socket(&m_socket);
+			receiving(1);
+			ReactorServerRequest& req = m_pJob->request;
+			try {
+				Poco::MemoryInputStream in(m_strIn.data(), headerLen);
+				req.read(in);
+			}
+			catch (Poco::Exception&) {
+				reply(HTTPResponse::HTTP_BAD_REQUEST, false);
+				return true;
+			}
+			if (req.getChunkedTransferEncoding()) {
+				reply(HTTPResponse::HTTP_LENGTH_REQUIRED, false);
+				return true;
+			}
+			std::streamsize len = req.hasContentLength() ? req.getContentLength() : 0;
+			if (len < 0 || len > (std::streamsize)mi_config().maxBodyMb * 1024 * 1024) {
+				reply(HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE, false);
+				return true;
+			}
+			m_nBodyLen = (size_t)len;
+			m_pJob->arrival = std::chrono::steady_clock::now();
+
+			//. refuse before the body is uploaded when the queue cannot meet the deadline.
+			int retryAfter = 0;
+			int lane = g_Settings.lanesEnable ? mi_lane_of(req) : MI_LANE_INTERACTIVE;
+			int status = 0;
+			if (mi_is_inference_path(req.getURI()) && !mi_tenant_precheck(req, &status, &retryAfter)) {
+				reply((HTTPResponse::HTTPStatus)status, false, retryAfter);
+				return true;
+			}
+			if (mi_is_inference_path(req.getURI()) && !mi_admission_precheck(req, g_pWorkerPool->queued(lane), &retryAfter)) {
+				reply(HTTPResponse::HTTP_SERVICE_UNAVAILABLE, false, retryAfter);
+				return true;
+			}
+
+			size_t take = std::min(m_strIn.size() - headerLen, m_nBodyLen);
+			req.body().reserve(m_nBodyLen);
+			req.body().assign(m_strIn, headerLen, take);
+			m_strIn.erase(0, headerLen + take);
+
+			if (req.body().size() < m_nBodyLen && Poco::icompare(req.get("Expect", ""), "100-continue") == 0) {
+				static const char szContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+				try {
+					m_socket.sendBytes(szContinue, sizeof(szContinue) - 1);
+				}
+				catch (Poco::Exception&) {
+					return false;
+				}
+			}
+		}
+
+		ReactorServerRequest& req = m_pJob->request;
+		if (req.body().size() < m_nBodyLen) return true;
+
+		bool bKeep = g_Settings.keepAlive && req.getKeepAlive();
+		m_nRequests++;
+		if (g_Settings.maxKeepAliveRequests > 0 && m_nRequests >= g_Settings.maxKeepAliveRequests) bKeep = false;
+
+		req.open_body();
+		std::shared_ptr<ProactorJob> job(m_pJob.release());
+		receiving(-1);
+		//. the body is complete : the read buffer goes back before the request waits for a worker.
+		if (m_strIn.empty()) {
+			buffer_release(m_pRead);
+			m_pRead = NULL;
+		}
+		std::shared_ptr<ProactorConnection> self = shared_from_this();
+		bool bHead = req.getMethod() == HTTPRequest::HTTP_HEAD;
+		int lane = g_Settings.lanesEnable ? mi_lane_of(req) : MI_LANE_INTERACTIVE;
+		bool bCharged = mi_is_inference_path(req.getURI());
+		WorkerPool* pPool = (lv_pQualityPool != NULL && mi_is_quality_path(req.getURI())) ? lv_pQualityPool : g_pWorkerPool;
+		bool bQueued = pPool->submit([self, job, bKeep, bHead, bCharged]() {
+			Unanswered unanswered(self);
+			mi_stage_depth(MI_PIPE_DECODE, g_pWorkerPool->queued());
+			MyRequestHandler handler;
+			{
+				WorkerRequestScope scope(job->arrival, bCharged);
+				handler.handleRequest(job->request, job->response);
+			}
+			//. this thread goes on with the next request while a send thread serializes.
+			unanswered.dismiss();
+			mi_stage_send([self, job, bKeep, bHead]() {
+				Unanswered unsent(self);
+				self->complete(job->response.serialize(bKeep, bHead), bKeep);
+				unsent.dismiss();
+			});
+		}, lane);
+		if (!bQueued) {
+			reply(HTTPResponse::HTTP_SERVICE_UNAVAILABLE, bKeep, 1);
+			return true;
+		}
+		mi_stage_depth(MI_PIPE_DECODE, g_pWorkerPool->queued());
+
+		//. nothing is posted while the request is in flight, the response send resumes the reads.
+		m_bBusy = true;
+		m_io.proactor.updateSocket(m_socket, SocketProactor::POLL_ERROR);
+		return true;
+	}
+
+	//. answers without a worker. m_mtx must be held.
+	void reply(HTTPResponse::HTTPStatus p_status, bool p_bKeepAlive, int p_nRetryAfterSec = 0)
+	{
+		ReactorServerResponse resp;
+		resp.setStatusAndReason(p_status);
+		if (p_nRetryAfterSec > 0) resp.set("Retry-After", std::to_string(p_nRetryAfterSec));
+		mi_headers_apply(resp, MI_HEADERS_TEXT);
+		resp.send() << resp.getReason();
+		if (m_pJob) {
+			m_pJob.reset();
+			receiving(-1);
+		}
+		send(resp.serialize(p_bKeepAlive, false), p_bKeepAlive);
+	}
+
+	//. m_mtx must be held and nothing posted : the descriptor can go.
+	void release()
+	{
+		try {
+			m_io.proactor.removeSocket(m_socket);
+		}
+		catch (Poco::Exception&) {
+		}
+		m_socket.close();
+		buffer_release(m_pRead);
+		m_pRead = NULL;
+	}
+
+	StreamSocket											m_socket;
+	IoProactor&												m_io;
+	SocketAddress											m_client;
+	SocketAddress											m_server;
+
+	std::mutex												m_mtx;
+	ProactorBuffer											m_idle;			//. read between requests, empty until bytes arrive
+	ProactorBuffer*											m_pRead;		//. pooled read of a request under way
+	std::string												m_strIn;		//. header bytes and pipelined input
+	std::unique_ptr<ProactorJob>							m_pJob;			//. request being received
+	size_t													m_nBodyLen;
+	std::string												m_strOut;
+	size_t													m_nOutPos;
+	int														m_nRequests;
+	bool													m_bPosted;		//. a read or send is posted
+	bool													m_bBusy;		//. request handed to a worker
+	bool													m_bKeep;
+	bool													m_bClosed;
+	std::chrono::steady_clock::time_point					m_tActivity;
+};
+
+size_t mi_proactor_connections()
+{
+	return lv_nConnections.load();
+}
+
+static std::vector<IoProactor*>	lv_vIo;
+static std::vector<ServerSocket*>	lv_vSockets;				//. server.listeners, see MiConnection.h
+static ServerSocket*			lv_pLocalSocket = NULL;		//. server.local_socket
+static std::atomic<bool>		lv_bStop(false);
+static std::vector<std::thread>	lv_vAccept;
+static std::atomic<size_t>		lv_nNext(0);				//. proactor of the next connection
+
+static void accept_one(ServerSocket& p_socket)
+{
+	if (!p_socket.poll(Poco::Timespan(0, LD_SWEEP_MS * 1000 / 2), Socket::SELECT_READ)) return;
+	try {
+		StreamSocket s = p_socket.acceptConnection();
+		IoProactor& io = *lv_vIo[lv_nNext++ % lv_vIo.size()];
+		std::shared_ptr<ProactorConnection> conn = std::make_shared<ProactorConnection>(s, io);
+		{
+			std::lock_guard<std::mutex> lock(io.mtx);
+			io.conns.push_back(conn);
+		}
+		conn->start();
+	}
+	catch (Poco::Exception& ex) {
+		cout << "Proactor accept : " << ex.displayText() << endl;
+	}
+}
+
+static void sweep()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (IoProactor* io : lv_vIo) {
+		std::vector<std::shared_ptr<ProactorConnection>> v;
+		{
+			std::lock_guard<std::mutex> lock(io->mtx);
+			size_t keep = 0;
+			for (size_t i = 0; i < io->conns.size(); i++) {
+				std::shared_ptr<ProactorConnection> p = io->conns[i].lock();
+				if (!p) continue;
+				io->conns[keep++] = io->conns[i];
+				v.push_back(p);
+			}
+			io->conns.resize(keep);
+		}
+		for (auto& p : v) p->sweep(now);
+	}
+}
+
+//. accepts on listen socket p_nListener; the first thread also takes the local socket and
+//. sweeps the connections every LD_SWEEP_MS.
+static void accept_loop(size_t p_nListener)
+{
+	std::chrono::steady_clock::time_point lastSweep = std::chrono::steady_clock::now();
+	while (!lv_bStop.load()) {
+		accept_one(*lv_vSockets[p_nListener]);
+		if (p_nListener > 0) continue;
+		if (lv_pLocalSocket != NULL) accept_one(*lv_pLocalSocket);
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - lastSweep >= std::chrono::milliseconds(LD_SWEEP_MS)) {
+			sweep();
+			lastSweep = now;
+		}
+	}
+}
+
+bool mi_proactor_start(std::string& p_strErr)
+{
+	try {
+		lv_pParams = new HTTPServerParams;
+		lv_pParams->setKeepAlive(g_Settings.keepAlive);
+		lv_pParams->setMaxKeepAliveRequests(g_Settings.maxKeepAliveRequests);
+		lv_pParams->setKeepAliveTimeout(Poco::Timespan(g_Settings.keepAliveTimeoutSec, 0));
+		lv_pParams->setTimeout(Poco::Timespan(g_Settings.timeoutSec, 0));
+
+		g_pWorkerPool = new WorkerPool(g_Settings.inferenceWorkers, g_Settings.inferenceQueue);
+		g_pWorkerPool->start();
+		if (g_Settings.qualityEnable && g_Settings.qualityWorkers > 0) {
+			lv_pQualityPool = new WorkerPool(g_Settings.qualityWorkers, g_Settings.qualityQueue);
+			lv_pQualityPool->start();
+		}
+
+		for (int i = 0; i < mi_listeners(); i++) lv_vSockets.push_back(new ServerSocket(mi_listen_socket()));
+		if (!g_Settings.localSocket.empty()) lv_pLocalSocket = new ServerSocket(mi_local_listen_socket());
+		int nIo = g_Settings.ioThreads > 0 ? g_Settings.ioThreads : 1;
+		for (int i = 0; i < nIo; i++) {
+			IoProactor* io = new IoProactor;
+			lv_vIo.push_back(io);
+			io->thread.setName("MiProactor");
+			io->thread.start(*io);
+		}
+		lv_bStop.store(false);
+		for (size_t i = 0; i < lv_vSockets.size(); i++) lv_vAccept.emplace_back(accept_loop, i);
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		mi_proactor_stop();
+		return false;
+	}
+	return true;
+}
+
+void mi_proactor_drain(int p_nSec)
+{
+	if (g_pWorkerPool == NULL) return;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(p_nSec);
+	while ((g_pWorkerPool->pending() > 0 || (lv_pQualityPool != NULL && lv_pQualityPool->pending() > 0) || mi_stages_pending() > 0) && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
+
+void mi_proactor_stop()
+{
+	lv_bStop.store(true);
+	for (auto& t : lv_vAccept) t.join();
+	lv_vAccept.clear();
+	//. shut every connection down while the proactors still deliver the completions.
+	for (IoProactor* io : lv_vIo) {
+		std::vector<std::weak_ptr<ProactorConnection>> v;
+		{
+			std::lock_guard<std::mutex> lock(io->mtx);
+			v.swap(io->conns);
+		}
+		for (auto& w : v) {
+			std::shared_ptr<ProactorConnection> p = w.lock();
+			if (p) p->close();
+		}
+	}
+	for (IoProactor* io : lv_vIo) {
+		io->proactor.stop();
+		io->proactor.wakeUp();
+		if (io->thread.isRunning()) io->thread.join();
+		delete io;
+	}
+	lv_vIo.clear();
+	for (ServerSocket* p : lv_vSockets) delete p;
+	lv_vSockets.clear();
+	if (lv_pLocalSocket != NULL) {
+		delete lv_pLocalSocket;
+		lv_pLocalSocket = NULL;
+		mi_local_socket_remove();
+	}
+
+	if (g_pWorkerPool != NULL) {
+		g_pWorkerPool->stop();
+		delete g_pWorkerPool;
+		g_pWorkerPool = NULL;
+	}
+	if (lv_pQualityPool != NULL) {
+		lv_pQualityPool->stop();
+		delete lv_pQualityPool;
+		lv_pQualityPool = NULL;
+	}
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxBuffers);
+		for (ProactorBuffer* p : lv_vBuffers) delete p;
+		lv_vBuffers.clear();
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+//. Alternative front end (server.mode = proactor) : connections are spread over
+//. server.io_threads Poco SocketProactors, which post reads and sends and call back on
+//. completion (on Windows the poll set under them is wepoll, i.e. AFD polling on an I/O
+//. completion port). A connection between requests holds no buffer and no thread : its
+//. posted read has an empty buffer that is only sized when bytes arrive, so idle
+//. keep-alive connections cost a socket and a small object each. Once a request has
+//. started, reads go into a buffer from a small shared pool until the body is complete;
+//. complete requests go to g_pWorkerPool as in reactor mode, with the same routes,
+//. tenant and admission prechecks and lanes.
+//. Limits : Content-Length bodies only (chunked uploads get 411), bodies above
+//. server.max_body_mb get 413, a full inference queue gets 503. No progressive decode and
+//. no ingest flow control ([decode] progressive, [server] ingest_* are reactor only).
+//. LivenessBench --idle measures the connections this holds against server.mode = classic.
+
+//. opens the listen sockets and starts the proactors, an accept thread per server.listeners
+//. socket and the worker pool.
+bool mi_proactor_start(std::string& p_strErr);
+void mi_proactor_stop();
+//. waits up to p_nSec for the worker pool to answer every request it holds; the
+//. proactors keep running so the answers still go out. Call before mi_proactor_stop.
+void mi_proactor_drain(int p_nSec);
+
+//. open client connections, for GD_API_METRICS.
+size_t mi_proactor_connections();
@@ -0,0 +1,221 @@
+#include "MiProfile.h"
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static std::mutex lv_mtx;
+
+#ifdef _WIN32
+
+#include <windows.h>
+#include <tlhelp32.h>
+#include <dbghelp.h>
+
+#define LD_MAX_FRAMES	128
+
+#if defined(_M_X64)
+//. walks a suspended thread's stack with the unwind tables. Nothing here allocates :
+//. the thread may hold the heap lock. A bad stack ends the walk instead of the process.
+static int unwind(CONTEXT& p_ctx, DWORD64* p_pFrames, int p_nMax)
+{
+	int n = 0;
+	__try {
+		while (n < p_nMax && p_ctx.Rip != 0) {
+			p_pFrames[n++] = p_ctx.Rip;
+			DWORD64 base = 0;
+			PRUNTIME_FUNCTION pFn = RtlLookupFunctionEntry(p_ctx.Rip, &base, NULL);
+			if (pFn == NULL) {
+				//. leaf function : the return address is on top of the stack.
+				p_ctx.Rip = *(DWORD64*)p_ctx.Rsp;
+				p_ctx.Rsp += 8;
+			}
+			else {
+				PVOID pHandler = NULL;
+				DWORD64 frame = 0;
+				RtlVirtualUnwind(UNW_FLAG_NHANDLER, base, p_ctx.Rip, pFn, &p_ctx, &pHandler, &frame, NULL);
+			}
+		}
+	}
+	__except (EXCEPTION_EXECUTE_HANDLER) {
+	}
+	return n;
+}
+#endif
+
+static std::string symbol_of(HANDLE p_hProc, DWORD64 p_nAddr)
+{
+	char buf[sizeof(SYMBOL_INFO) + 256];
+	SYMBOL_INFO* pSym = (SYMBOL_INFO*)buf;
+	memset(buf, 0, sizeof(buf));
+	pSym->SizeOfStruct = sizeof(SYMBOL_INFO);
+	pSym->MaxNameLen = 255;
+	IMAGEHLP_MODULE64 mod;
+	memset(&mod, 0, sizeof(mod));
+	mod.SizeOfStruct = sizeof(mod);
+	std::string strModule = SymGetModuleInfo64(p_hProc, p_nAddr, &mod) ? std::string(mod.ModuleName) + "!" : std::string();
+	DWORD64 disp = 0;
+	if (SymFromAddr(p_hProc, p_nAddr, &disp, pSym)) return strModule + pSym->Name;
+	char szAddr[32];
+	snprintf(szAddr, sizeof(szAddr), "0x%llx", (unsigned long long)p_nAddr);
+	return strModule + szAddr;
+}
+
+static bool capture(int p_nSeconds, int p_nHz, std::string& p_strOut, std::string& p_strErr)
+{
+#if defined(_M_X64)
+	DWORD pid = GetCurrentProcessId(), self = GetCurrentThreadId();
+	std::map<std::vector<DWORD64>, uint64_t> stacks;
+	std::map<DWORD, ULONG64> cycles;			//. per thread at its last sample
+	DWORD64 frames[LD_MAX_FRAMES];
+
+	auto period = std::chrono::microseconds(1000000 / p_nHz);
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(p_nSeconds);
+	for (auto next = std::chrono::steady_clock::now(); next < end; next += period) {
+		std::this_thread::sleep_until(next);
+		HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+		if (hSnap == INVALID_HANDLE_VALUE) continue;
+		THREADENTRY32 te;
+		te.dwSize = sizeof(te);
+		for (BOOL ok = Thread32First(hSnap, &te); ok; ok = Thread32Next(hSnap, &te)) {
+			if (te.th32OwnerProcessID != pid || te.th32ThreadID == self) continue;
+			HANDLE hThread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, te.th32ThreadID);
+			if (hThread == NULL) continue;
+			//. a thread that ran no cycles since its last sample is waiting, not on a CPU.
+			ULONG64 nCycles = 0;
+			QueryThreadCycleTime(hThread, &nCycles);
+			ULONG64& last = cycles[te.th32ThreadID];
+			bool bRan = nCycles != last;
+			last = nCycles;
+			int n = 0;
+			if (bRan && SuspendThread(hThread) != (DWORD)-1) {
+				CONTEXT ctx;
+				memset(&ctx, 0, sizeof(ctx));
+				ctx.ContextFlags = CONTEXT_FULL;
+				if (GetThreadContext(hThread, &ctx)) n = unwind(ctx, frames, LD_MAX_FRAMES);
+				ResumeThread(hThread);
+			}
+			CloseHandle(hThread);
+			if (n > 0) stacks[std::vector<DWORD64>(frames, frames + n)]++;
+		}
+		CloseHandle(hSnap);
+	}
+
+	HANDLE hProc = GetCurrentProcess();
+	static bool lv_bSymbols = false;
+	if (!lv_bSymbols) {
+		SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+		lv_bSymbols = SymInitialize(hProc, NULL, TRUE) != FALSE;
+	}
+	//. the SDK and its plugins were loaded after SymInitialize.
+	if (lv_bSymbols) SymRefreshModuleList(hProc);
+
+	std::map<DWORD64, std::string> names;
+	std::map<std::string, uint64_t> collapsed;
+	for (auto& s : stacks) {
+		std::string strKey = "IDLiveFaceCmd";
+		for (auto it = s.first.rbegin(); it != s.first.rend(); ++it) {
+			auto found = names.find(*it);
+			if (found == names.end()) found = names.emplace(*it, lv_bSymbols ? symbol_of(hProc, *it) : std::to_string(*it)).first;
+			strKey += ';';
+			strKey += found->second;
+		}
+		collapsed[strKey] += s.second;
+	}
+	for (auto& c : collapsed) p_strOut += c.first + " " + std::to_string(c.second) + "\n";
+	return true;
+#else
+	p_strErr = "the Windows sampler supports x64 only";
+	return false;
+#endif
+}
+
+#else
+
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Pipe.h"
+#include "Poco/PipeStream.h"
+#include "Poco/Process.h"
+#include "Poco/String.h"
+
+//. perf script -F comm,ip,sym : a "comm" line, then one "ip sym" line per frame from the
+//. leaf up, then an empty line.
+static void collapse(std::istream& p_in, std::string& p_strOut)
+{
+	std::map<std::string, uint64_t> collapsed;
+	std::string strComm;
+	std::vector<std::string> frames;
+	bool bSample = false;
+	auto flush = [&]() {
+		if (bSample) {
+			std::string strKey = strComm;
+			for (auto it = frames.rbegin(); it != frames.rend(); ++it) strKey += ";" + *it;
+			collapsed[strKey]++;
+		}
+		bSample = false;
+		frames.clear();
+	};
+	std::string line;
+	while (std::getline(p_in, line)) {
+		if (Poco::trim(line).empty()) {
+			flush();
+		}
+		else if (line[0] != ' ' && line[0] != '\t') {
+			flush();
+			strComm = Poco::trim(line);
+			bSample = true;
+		}
+		else {
+			std::string strFrame = Poco::trim(line);
+			size_t sp = strFrame.find(' ');
+			frames.push_back(sp == std::string::npos ? strFrame : Poco::trim(strFrame.substr(sp + 1)));
+		}
+	}
+	flush();
+	for (auto& c : collapsed) p_strOut += c.first + " " + std::to_string(c.second) + "\n";
+}
+
+static bool capture(int p_nSeconds, int p_nHz, std::string& p_strOut, std::string& p_strErr)
+{
+	std::string strPid = std::to_string(Poco::Process::id());
+	std::string strData = Poco::Path::temp() + "mi_profile_" + strPid + ".data";
+	try {
+		Poco::Process::Args record = { "record", "-q", "-F", std::to_string(p_nHz), "-g", "-p", strPid, "-o", strData, "--", "sleep", std::to_string(p_nSeconds) };
+		int rc = Poco::Process::launch("perf", record).wait();
+		if (rc != 0) {
+			p_strErr = "perf record exited with " + std::to_string(rc) + " (perf installed, kernel.perf_event_paranoid allows it?)";
+			Poco::File(strData).remove();
+			return false;
+		}
+		Poco::Pipe outPipe;
+		Poco::Process::Args script = { "script", "-i", strData, "-F", "comm,ip,sym" };
+		Poco::ProcessHandle ph = Poco::Process::launch("perf", script, NULL, &outPipe, NULL);
+		Poco::PipeInputStream istr(outPipe);
+		collapse(istr, p_strOut);
+		ph.wait();
+		Poco::File(strData).remove();
+		return true;
+	}
+	catch (const Poco::Exception& e) {
+		p_strErr = "perf : " + e.displayText();
+		try { Poco::File(strData).remove(); } catch (...) {}
+		return false;
+	}
+}
+
+#endif
+
+bool mi_profile_capture(int p_nSeconds, int p_nHz, std::string& p_strOut, std::string& p_strErr)
+{
+	std::unique_lock<std::mutex> lock(lv_mtx, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		p_strErr = "a profile is already being taken";
+		return false;
+	}
+	p_strOut.clear();
+	return capture(p_nSeconds > 0 ? p_nSeconds : 1, p_nHz > 0 ? p_nHz : 1, p_strOut, p_strErr);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+//. Sampling CPU profile of the whole server for GD_API_PROFILE ([profile] settings),
+//. returned as collapsed stacks : one "root;caller;...;leaf count" line per distinct
+//. stack, the input of flamegraph.pl, speedscope or inferno.
+//. - Linux : perf record -g on this process for the duration, then perf script, so perf
+//.   must be installed and perf_event_paranoid must allow it.
+//. - Windows (x64) : an in-process sampler; p_nHz times a second every other thread of
+//.   the process that used CPU since the last tick is suspended, its stack unwound from
+//.   the x64 unwind tables (no allocation while the thread is stopped) and resumed. The
+//.   frames are named through dbghelp afterwards. Sleep granularity caps the rate at
+//.   about 64 Hz unless the timer resolution was raised.
+//. One profile runs at a time; the calling thread is blocked for p_nSeconds.
+
+//. false and p_strErr when no profile could be taken.
+bool mi_profile_capture(int p_nSeconds, int p_nHz, std::string& p_strOut, std::string& p_strErr);
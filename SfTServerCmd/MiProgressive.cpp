@@ -0,0 +1,280 @@
+#include "MiProgressive.h"
+#include "MiConf.h"
+#include "MiFaceCrop.h"
+#include "MiImageInfo.h"
+#include "MiMetrics.h"
+#include "MiSettings.h"
+#include "MiWorkerPool.h"
+#include "Poco/String.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#if MI_HAS_WIC
+#include "MiWic.h"
+#endif
+
+static const char* lv_szOutcomes[MI_PROGRESSIVE_COUNT] = { "used", "fallback", "busy" };
+
+enum ProgressiveState {
+	MI_PROG_SCAN = 0,		//. looking for the header of the first file part
+	MI_PROG_SNIFF,			//. copying its bytes until the image header is known
+	MI_PROG_DECODE,			//. decode task submitted
+	MI_PROG_OFF				//. not taken, the handler decodes as usual
+};
+
+struct ProgressiveUpload {
+	std::mutex					mtx;
+	std::condition_variable		cv;
+	ProgressiveState			state;
+	size_t						bodyLen;
+	size_t						scan;		//. body offset the part header search resumes at
+	size_t						part;		//. body offset of the file part's first byte
+	std::unique_ptr<uint8_t[]>	data;		//. body from part on; bytes below have never change
+	size_t						size;		//. bodyLen - part
+	size_t						have;
+	bool						aborted;
+	bool						finished;	//. decode task done, ok / frame valid
+	bool						ok;
+	DecodedFrame				frame;
+
+	explicit ProgressiveUpload(size_t p_nBodyLen)
+		: state(MI_PROG_SCAN), bodyLen(p_nBodyLen), scan(0), part(0), size(0), have(0), aborted(false), finished(false), ok(false) {}
+};
+
+static bool			lv_bEnable = false;
+static size_t		lv_nMinBytes = 0;
+static WorkerPool*	lv_pPool = NULL;
+static thread_local std::shared_ptr<ProgressiveUpload>	lv_pCurrent;
+
+const char* mi_progressive_outcome_name(int p_nOutcome)
+{
+	return p_nOutcome >= 0 && p_nOutcome < MI_PROGRESSIVE_COUNT ? lv_szOutcomes[p_nOutcome] : "unknown";
+}
+
+void mi_progressive_init(bool p_bEnable, size_t p_nMinBytes, int p_nThreads)
+{
+#if MI_HAS_WIC
+	if (!p_bEnable || p_nThreads <= 0) return;
+	lv_nMinBytes = p_nMinBytes;
+	//. one slot per thread : an upload that finds none is decoded after its body.
+	lv_pPool = new WorkerPool(p_nThreads, p_nThreads);
+	lv_pPool->start();
+	lv_bEnable = true;
+#endif
+}
+
+void mi_progressive_stop()
+{
+	lv_bEnable = false;
+	if (lv_pPool != NULL) {
+		lv_pPool->stop();
+		delete lv_pPool;
+		lv_pPool = NULL;
+	}
+}
+
+#if MI_HAS_WIC
+//. read-only view of an upload's file part as it arrives; WIC calls Read / Seek / Stat only.
+//. Lives on the decode thread's stack, the decoder holding it is released before it.
+class ProgressiveStream : public IStream {
+public:
+	explicit ProgressiveStream(ProgressiveUpload& p_upload) : m_upload(p_upload), m_nPos(0) {}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID p_riid, void** p_ppv) override
+	{
+		if (IsEqualIID(p_riid, IID_IUnknown) || IsEqualIID(p_riid, IID_ISequentialStream) || IsEqualIID(p_riid, IID_IStream)) {
+			*p_ppv = static_cast<IStream*>(this);
+			return S_OK;
+		}
+		*p_ppv = NULL;
+		return E_NOINTERFACE;
+	}
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	//. waits for the bytes up to the server timeout; a cut or dropped upload fails the decode.
+	HRESULT STDMETHODCALLTYPE Read(void* p_pv, ULONG p_cb, ULONG* p_pcbRead) override
+	{
+		if (p_pcbRead != NULL) *p_pcbRead = 0;
+		if (m_nPos >= m_upload.size) return S_FALSE;
+		size_t want = m_nPos + p_cb < m_upload.size ? m_nPos + p_cb : m_upload.size;
+		size_t have = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_upload.mtx);
+			m_upload.cv.wait_for(lock, std::chrono::seconds(g_Settings.timeoutSec), [&]() { return m_upload.have >= want || m_upload.aborted; });
+			if (m_upload.aborted) return STG_E_READFAULT;
+			have = m_upload.have;
+		}
+		size_t n = have > m_nPos ? (have < want ? have : want) - m_nPos : 0;
+		if (n < want - m_nPos) return STG_E_READFAULT;
+		if (n > 0) memcpy(p_pv, m_upload.data.get() + m_nPos, n);
+		m_nPos += n;
+		if (p_pcbRead != NULL) *p_pcbRead = (ULONG)n;
+		return n < p_cb ? S_FALSE : S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER p_move, DWORD p_dwOrigin, ULARGE_INTEGER* p_pNewPos) override
+	{
+		long long base = p_dwOrigin == STREAM_SEEK_SET ? 0 : p_dwOrigin == STREAM_SEEK_CUR ? (long long)m_nPos : (long long)m_upload.size;
+		long long pos = base + p_move.QuadPart;
+		if (pos < 0) return STG_E_INVALIDFUNCTION;
+		m_nPos = (size_t)pos;
+		if (p_pNewPos != NULL) p_pNewPos->QuadPart = (ULONGLONG)pos;
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE Stat(STATSTG* p_pStat, DWORD) override
+	{
+		memset(p_pStat, 0, sizeof(*p_pStat));
+		p_pStat->type = STGTY_STREAM;
+		p_pStat->cbSize.QuadPart = (ULONGLONG)m_upload.size;
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE Write(const void*, ULONG, ULONG*) override { return STG_E_ACCESSDENIED; }
+	HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE CopyTo(IStream*, ULARGE_INTEGER, ULARGE_INTEGER*, ULARGE_INTEGER*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE Commit(DWORD) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE Revert() override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE LockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE UnlockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE Clone(IStream**) override { return E_NOTIMPL; }
+
+private:
+	ProgressiveUpload&	m_upload;
+	size_t				m_nPos;
+};
+
+static void decode_task(const std::shared_ptr<ProgressiveUpload>& p_pUpload, const ImageInfo& p_info)
+{
+	DecodedFrame frame;
+	bool ok = false;
+	{
+		ProgressiveStream stream(*p_pUpload);
+		ok = mi_decode_jpeg_stream(&stream, p_info, frame);
+	}
+	std::lock_guard<std::mutex> lock(p_pUpload->mtx);
+	p_pUpload->frame.pixels.swap(frame.pixels);
+	p_pUpload->frame.width = frame.width;
+	p_pUpload->frame.height = frame.height;
+	p_pUpload->frame.scale = frame.scale;
+	p_pUpload->frame.orientation = frame.orientation;
+	p_pUpload->ok = ok;
+	p_pUpload->finished = true;
+	p_pUpload->cv.notify_all();
+}
+#endif
+
+std::shared_ptr<ProgressiveUpload> mi_progressive_begin(const Poco::Net::HTTPRequest& p_request, size_t p_nBodyLen)
+{
+	std::shared_ptr<ProgressiveUpload> p;
+	//. a [crop] upload is decoded by the crop path, a compressed body would have to be inflated first.
+	if (!lv_bEnable || p_nBodyLen < lv_nMinBytes || !mi_decode_enabled() || mi_crop_enabled()) return p;
+	const std::string& uri = p_request.getURI();
+	if (uri.compare(0, uri.find('?'), GD_API_FULL_PROCESS) != 0) return p;
+	if (Poco::icompare(p_request.getContentType(), 0, 19, "multipart/form-data") != 0 || p_request.has("Content-Encoding")) return p;
+	p.reset(new ProgressiveUpload(p_nBodyLen));
+	return p;
+}
+
+void mi_progressive_feed(const std::shared_ptr<ProgressiveUpload>& p_pUpload, const std::string& p_strBody)
+{
+#if MI_HAS_WIC
+	ProgressiveUpload& u = *p_pUpload;
+	if (u.state == MI_PROG_OFF) return;
+
+	if (u.state == MI_PROG_SCAN) {
+		//. the first part with a filename is the image, as read_multipart_image takes it.
+		size_t f = p_strBody.find("filename=", u.scan);
+		size_t end = f == std::string::npos ? std::string::npos : p_strBody.find("\r\n\r\n", f);
+		if (end == std::string::npos) {
+			if (p_strBody.size() > GD_IMAGE_SNIFF_MAX_BYTES) u.state = MI_PROG_OFF;
+			else if (f != std::string::npos) u.scan = f;
+			else u.scan = p_strBody.size() > 9 ? p_strBody.size() - 9 : 0;
+			return;
+		}
+		u.part = end + 4;
+		u.size = u.bodyLen > u.part ? u.bodyLen - u.part : 0;
+		if (u.size == 0) {
+			u.state = MI_PROG_OFF;
+			return;
+		}
+		u.data.reset(new uint8_t[u.size]);
+		u.state = MI_PROG_SNIFF;
+	}
+
+	//. only the reactor writes, past have : the decode thread reads below it.
+	size_t avail = p_strBody.size() > u.part ? p_strBody.size() - u.part : 0;
+	if (avail > u.size) avail = u.size;
+	size_t from = 0;
+	{
+		std::lock_guard<std::mutex> lock(u.mtx);
+		from = u.have;
+	}
+	if (avail <= from) return;
+	memcpy(u.data.get() + from, p_strBody.data() + u.part + from, avail - from);
+	{
+		std::lock_guard<std::mutex> lock(u.mtx);
+		u.have = avail;
+	}
+	u.cv.notify_all();
+
+	if (u.state == MI_PROG_SNIFF) {
+		ImageInfo info;
+		if (!mi_image_info(u.data.get(), avail, info)) {
+			if (avail >= GD_IMAGE_SNIFF_MAX_BYTES || avail == u.size) {
+				u.state = MI_PROG_OFF;
+				mi_metrics_progressive(MI_PROGRESSIVE_FALLBACK);
+			}
+			return;
+		}
+		if (info.format != MI_IMAGE_JPEG) {
+			u.state = MI_PROG_OFF;
+			mi_metrics_progressive(MI_PROGRESSIVE_FALLBACK);
+			return;
+		}
+		std::shared_ptr<ProgressiveUpload> pUpload = p_pUpload;
+		if (lv_pPool == NULL || !lv_pPool->submit([pUpload, info]() { decode_task(pUpload, info); })) {
+			u.state = MI_PROG_OFF;
+			mi_metrics_progressive(MI_PROGRESSIVE_BUSY);
+			return;
+		}
+		u.state = MI_PROG_DECODE;
+	}
+#endif
+}
+
+void mi_progressive_abort(ProgressiveUpload& p_upload)
+{
+	{
+		std::lock_guard<std::mutex> lock(p_upload.mtx);
+		p_upload.aborted = true;
+	}
+	p_upload.cv.notify_all();
+}
+
+void mi_progressive_set(const std::shared_ptr<ProgressiveUpload>& p_pUpload)
+{
+	lv_pCurrent = p_pUpload;
+}
+
+bool mi_progressive_take(const std::string& p_strImage, DecodedFrame& p_out)
+{
+	std::shared_ptr<ProgressiveUpload> p = lv_pCurrent;
+	//. state is only written by the reactor, which is done with the body by now.
+	if (!p || p->state != MI_PROG_DECODE || p_strImage.empty()) return false;
+	std::unique_lock<std::mutex> lock(p->mtx);
+	//. the body is in, what is left of the decode is the tail of the frame.
+	p->cv.wait(lock, [&]() { return p->finished; });
+	bool bSame = p->ok && p_strImage.size() <= p->have && memcmp(p_strImage.data(), p->data.get(), p_strImage.size()) == 0;
+	mi_metrics_progressive(bSame ? MI_PROGRESSIVE_USED : MI_PROGRESSIVE_FALLBACK);
+	if (!bSame) return false;
+	p_out.pixels.swap(p->frame.pixels);
+	p_out.width = p->frame.width;
+	p_out.height = p->frame.height;
+	p_out.scale = p->frame.scale;
+	p_out.orientation = p->frame.orientation;
+	p->ok = false;
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "MiDecode.h"
+#include "Poco/Net/HTTPRequest.h"
+
+//. Progressive ingestion on the reactor front end ([decode] progressive) : a large multipart
+//. upload to GD_API_FULL_PROCESS starts its scaled JPEG decode (MiDecode.h) while the body
+//. is still arriving. The reactor copies the bytes of the first file part as they come in;
+//. a decode thread ([decode] progressive_threads) reads them through a stream whose Read
+//. waits for the next chunk, so the scanlines are decoded as the upload delivers them and
+//. the frame is mostly done when the last byte lands. The handler takes the frame only when
+//. it was decoded from the very file part it parsed itself; anything else (another format,
+//. a JPEG the scaled decode would not take, all decode threads busy, [crop] on) goes the
+//. usual way after the body. Windows (WIC) only, a no-op elsewhere.
+
+struct ProgressiveUpload;
+
+enum ProgressiveOutcome {
+	MI_PROGRESSIVE_USED = 0,		//. the handler took the frame
+	MI_PROGRESSIVE_FALLBACK,		//. not a JPEG the scaled decode takes, or the decode failed
+	MI_PROGRESSIVE_BUSY,			//. every decode thread taken, decoded after the body
+	MI_PROGRESSIVE_COUNT
+};
+
+const char* mi_progressive_outcome_name(int p_nOutcome);
+
+void mi_progressive_init(bool p_bEnable, size_t p_nMinBytes, int p_nThreads);
+void mi_progressive_stop();
+
+//. reactor thread, header parsed : the upload's state, NULL when it does not qualify.
+std::shared_ptr<ProgressiveUpload> mi_progressive_begin(const Poco::Net::HTTPRequest& p_request, size_t p_nBodyLen);
+//. reactor thread : p_strBody is the body received so far.
+void mi_progressive_feed(const std::shared_ptr<ProgressiveUpload>& p_pUpload, const std::string& p_strBody);
+//. the connection dropped the request; a decode waiting for bytes gives up.
+void mi_progressive_abort(ProgressiveUpload& p_upload);
+
+//. worker thread : the upload of the request handled next on this thread, NULL clears.
+void mi_progressive_set(const std::shared_ptr<ProgressiveUpload>& p_pUpload);
+//. handler : the frame decoded while p_strImage was received; false = decode it as usual.
+bool mi_progressive_take(const std::string& p_strImage, DecodedFrame& p_out);
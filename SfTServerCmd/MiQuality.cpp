@@ -0,0 +1,137 @@
+#include "MiQuality.h"
+#include "MiLazyPool.h"
+#include "MiMetrics.h"
+#include "MiResultJson.h"
+#include "MiSdkCall.h"
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+
+static CInitConfig_t*	lv_pConfig = NULL;
+static LazyPool*		lv_pPool = NULL;
+
+static bool build_engines(const std::string& p_strConfigDir, const std::string& p_strConfigName, const QualitySettings& p_settings, std::vector<void*>& p_vEngines, std::string& p_strErr)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+	int		nEngines = p_settings.engines < 1 ? 1 : p_settings.engines;
+
+	lv_pConfig = face_sdk_api().config_create(p_strConfigDir.c_str(), p_strConfigName.c_str(), &err, msg);
+	if (lv_pConfig == NULL) {
+		p_strErr = msg;
+		return false;
+	}
+	for (int i = 0; i < nEngines; i++) {
+		CQualityEngine_t* pEngine = face_sdk_api().quality_create(p_settings.engine.c_str(), lv_pConfig, &err, msg);
+		if (pEngine == NULL) {
+			p_strErr = msg;
+			break;
+		}
+		p_vEngines.push_back(pEngine);
+	}
+	if ((int)p_vEngines.size() == nEngines) return true;
+	for (void* p : p_vEngines) face_sdk_api().quality_destroy((CQualityEngine_t*)p);
+	p_vEngines.clear();
+	face_sdk_api().config_destroy(lv_pConfig);
+	lv_pConfig = NULL;
+	return false;
+}
+
+static void release_engines(std::vector<void*>& p_vEngines)
+{
+	for (void* p : p_vEngines) face_sdk_api().quality_destroy((CQualityEngine_t*)p);
+	if (lv_pConfig != NULL) face_sdk_api().config_destroy(lv_pConfig);
+	lv_pConfig = NULL;
+}
+
+bool mi_quality_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const QualitySettings& p_settings, std::string& p_strErr)
+{
+	LazyPool::BuildFn build = [=](std::vector<void*>& p_vEngines, std::string& p_strBuildErr) {
+		return build_engines(p_strConfigDir, p_strConfigName, p_settings, p_vEngines, p_strBuildErr);
+	};
+	lv_pPool = new LazyPool("quality", build, release_engines, p_settings.idleEvictMs);
+	if (p_settings.lazy || lv_pPool->build(p_strErr)) return true;
+	mi_quality_shutdown();
+	return false;
+}
+
+void mi_quality_shutdown()
+{
+	delete lv_pPool;
+	lv_pPool = NULL;
+}
+
+bool mi_quality_enabled()
+{
+	return lv_pPool != NULL;
+}
+
+void mi_quality_scores(const CImage_t** p_ppImages, size_t p_nCount, float* p_pScores, bool* p_pUsable, int* p_pErrors, char** p_ppszMsgs)
+{
+	//. the SDK gets the decoded images only, packed; vSlot maps them back.
+	std::vector<const CImage_t*> vImages;
+	std::vector<size_t> vSlot;
+	for (size_t i = 0; i < p_nCount; i++) {
+		p_pScores[i] = 0;
+		p_pUsable[i] = false;
+		if (p_ppImages[i] == NULL) continue;
+		vImages.push_back(p_ppImages[i]);
+		vSlot.push_back(i);
+	}
+	size_t n = vImages.size();
+	if (n == 0) return;
+	std::vector<int> vErrors(n, OK);
+	std::vector<char*> vMsgs(n);
+	for (size_t k = 0; k < n; k++) vMsgs[k] = p_ppszMsgs[vSlot[k]];
+
+	CQualityResult_t* pResults = NULL;
+	{
+		StageTimer tQuality(MI_STAGE_QUALITY);
+		LazyLease<CQualityEngine_t> lease(*lv_pPool);
+		if (lease.get() == NULL) {
+			for (size_t k = 0; k < n; k++) {
+				vErrors[k] = UNKNOWN;
+				snprintf(vMsgs[k], MESSAGE_BUFFER_SIZE, "%s", lease.error().c_str());
+			}
+		}
+		else pResults = FaceSdk::check_quality_batch(lease.get(), vImages.data(), n, vErrors.data(), vMsgs.data());
+	}
+	for (size_t k = 0; k < n; k++) {
+		size_t i = vSlot[k];
+		p_pErrors[i] = (pResults == NULL && vErrors[k] == OK) ? UNKNOWN : vErrors[k];
+		if (pResults != NULL && p_pErrors[i] == OK) {
+			p_pScores[i] = pResults[k].score;
+			p_pUsable[i] = pResults[k].ok && pResults[k].class_;
+		}
+	}
+	if (pResults != NULL) face_sdk_api().CQualityResult_destroy_array(pResults);
+}
+
+void mi_quality_batch_json(ArenaString& p_out, const CImage_t** p_ppImages, size_t p_nCount, int* p_pErrors, char** p_ppszMsgs)
+{
+	std::vector<float> vScores(p_nCount);
+	std::unique_ptr<bool[]> pUsable(new bool[p_nCount]);
+	mi_quality_scores(p_ppImages, p_nCount, vScores.data(), pUsable.get(), p_pErrors, p_ppszMsgs);
+
+	p_out.push_back('[');
+	for (size_t i = 0; i < p_nCount; i++) {
+		if (i > 0) p_out.push_back(',');
+		p_out.append("{\"index\":");
+		mi_json_put_int(p_out, (int)i);
+		p_out.append(",\"status\":");
+		mi_json_put_string(p_out, face_sdk_status_name(p_pErrors[i]));
+		if (p_pErrors[i] != OK) {
+			p_out.append(",\"message\":");
+			mi_json_put_string(p_out, p_ppszMsgs[i]);
+		}
+		else if (p_ppImages[i] != NULL) {
+			p_out.append(",\"usable\":");
+			p_out.append(pUsable[i] ? "true" : "false");
+			p_out.append(",\"score\":");
+			mi_json_put_float(p_out, vScores[i]);
+		}
+		p_out.push_back('}');
+	}
+	p_out.push_back(']');
+}
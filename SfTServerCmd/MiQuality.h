@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include "FaceSdkApi.h"
+#include "MiArena.h"
+
+//. Quality-only checks for GD_API_QUALITY ([quality] settings) : "is this capture usable?"
+//. before the client uploads for liveness. The images of one request go to a quality_create
+//. engine in one check_quality_batch call, released with CQualityResult_destroy_array.
+//. The engines are a pool of their own and never take a lane permit; in reactor mode the
+//. requests also run on their own small worker pool (quality.workers), so these short
+//. checks do not queue behind liveness requests. With lazy the engines are built on the
+//. first request (MiLazyPool.h).
+
+struct QualitySettings {
+	int			engines;		//. quality engines shared by the request threads
+	std::string	engine;			//. quality_create name
+	bool		lazy;			//. built on the first request, see MiLazyPool.h
+	int			idleEvictMs;	//. 0 = kept until shutdown
+};
+
+bool mi_quality_init(const std::string& p_strConfigDir, const std::string& p_strConfigName, const QualitySettings& p_settings, std::string& p_strErr);
+void mi_quality_shutdown();
+bool mi_quality_enabled();
+
+//. quality score and usable flag of p_nCount images in one check_quality_batch call; NULL
+//. entries and failed images keep score 0, not usable, their STATUS in p_pErrors / p_ppszMsgs.
+void mi_quality_scores(const CImage_t** p_ppImages, size_t p_nCount, float* p_pScores, bool* p_pUsable, int* p_pErrors, char** p_ppszMsgs);
+
+//. appends [{"index":0,"status":"OK","usable":true,"score":0.8}, ...] for p_nCount images.
+//. NULL entries keep the STATUS already in p_pErrors / p_ppszMsgs (decode failures).
+void mi_quality_batch_json(ArenaString& p_out, const CImage_t** p_ppImages, size_t p_nCount, int* p_pErrors, char** p_ppszMsgs);
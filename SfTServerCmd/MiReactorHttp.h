@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "MiAdmission.h"
+#include "MiConf.h"
+#include "MiHeaders.h"
+#include "MiTenants.h"
+#include "Poco/Exception.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/StreamSocket.h"
+
+//. Request / response pair of the front ends that receive whole requests themselves and
+//. run MyRequestHandler on a worker (MiReactorServer.h, MiHttp2Server.h).
+
+//. request fully buffered by the reactor; the body is read back through stream().
+class ReactorServerRequest : public Poco::Net::HTTPServerRequest {
+public:
+	ReactorServerRequest(Poco::Net::HTTPServerResponse& p_response, const Poco::Net::SocketAddress& p_client, const Poco::Net::SocketAddress& p_server, const Poco::Net::HTTPServerParams& p_params)
+		: m_response(p_response), m_client(p_client), m_server(p_server), m_params(p_params), m_pSocket(NULL) {}
+
+	std::string& body() { return m_strBody; }
+	//. the reactor's connection, probed for a disconnect (MiConnection.h); NULL for HTTP/2.
+	void set_socket(Poco::Net::StreamSocket* p_pSocket) { m_pSocket = p_pSocket; }
+	Poco::Net::StreamSocket* socket() const { return m_pSocket; }
+	void open_body() { m_pStream.reset(new Poco::MemoryInputStream(m_strBody.data(), m_strBody.size())); }
+
+	std::istream& stream() override { return *m_pStream; }
+	const Poco::Net::SocketAddress& clientAddress() const override { return m_client; }
+	const Poco::Net::SocketAddress& serverAddress() const override { return m_server; }
+	const Poco::Net::HTTPServerParams& serverParams() const override { return m_params; }
+	Poco::Net::HTTPServerResponse& response() const override { return m_response; }
+	bool secure() const override { return false; }
+
+private:
+	Poco::Net::HTTPServerResponse&				m_response;
+	Poco::Net::SocketAddress					m_client;
+	Poco::Net::SocketAddress					m_server;
+	const Poco::Net::HTTPServerParams&			m_params;
+	std::string									m_strBody;
+	std::unique_ptr<Poco::MemoryInputStream>	m_pStream;
+	Poco::Net::StreamSocket*					m_pSocket;
+};
+
+//. response collected in memory and written back by the reactor.
+//. Header blocks (MiHeaders.h) are not copied : the static text is appended to the head.
+class ReactorServerResponse : public Poco::Net::HTTPServerResponse, public HeaderBlockSink {
+public:
+	ReactorServerResponse() : m_pBlock(NULL), m_bSent(false) {}
+
+	void set_header_block(const std::string& p_strBlock) override { m_pBlock = &p_strBlock; }
+
+	void sendContinue() override {}
+	std::ostream& send() override { m_bSent = true; return m_body; }
+	void sendFile(const std::string& p_strPath, const std::string& p_strMediaType) override {
+		std::ifstream in(p_strPath, std::ios::binary);
+		if (!in) throw Poco::FileNotFoundException(p_strPath);
+		setContentType(p_strMediaType);
+		send() << in.rdbuf();
+	}
+	void sendBuffer(const void* p_pBuffer, std::size_t p_nLength) override { send().write((const char*)p_pBuffer, p_nLength); }
+	void redirect(const std::string& p_strUri, HTTPStatus p_status) override {
+		setStatusAndReason(p_status);
+		set("Location", p_strUri);
+		send();
+	}
+	void requireAuthentication(const std::string& p_strRealm) override {
+		setStatusAndReason(HTTP_UNAUTHORIZED);
+		set("WWW-Authenticate", "Basic realm=\"" + p_strRealm + "\"");
+		send();
+	}
+	bool sent() const override { return m_bSent; }
+
+	//. for front ends that frame the head themselves (MiHttp2Server.h).
+	const std::string* header_block() const { return m_pBlock; }
+	std::string body() const { return m_body.str(); }
+
+	//. status line, headers and body as one buffer.
+	std::string serialize(bool p_bKeepAlive, bool p_bHead) {
+		std::string strBody = m_body.str();
+		setChunkedTransferEncoding(false);
+		setContentLength((std::streamsize)strBody.size());
+		setKeepAlive(p_bKeepAlive);
+		std::ostringstream head;
+		write(head);
+		std::string out = head.str();
+		//. before the blank line that ends the head.
+		if (m_pBlock != NULL) out.insert(out.size() - 2, *m_pBlock);
+		if (!p_bHead) out += strBody;
+		return out;
+	}
+
+private:
+	std::ostringstream	m_body;
+	const std::string*	m_pBlock;
+	bool				m_bSent;
+};
+
+//. endpoints that reach the SDK and go through admission control.
+inline bool mi_is_inference_path(const std::string& p_strUri)
+{
+	std::string path = p_strUri.substr(0, p_strUri.find('?'));
+	return path == GD_API_FULL_PROCESS || path == GD_API_FULL_PROCESS_BASE64 || path == GD_API_FULL_PROCESS_RAW || path == GD_API_FULL_PROCESS_URL || path == GD_API_BATCH || path == GD_API_SEQUENCE || path == GD_API_BURST || path == GD_API_FACES || path == GD_API_ONBOARD || path == GD_API_VIDEO || path == GD_API_PIXELS;
+}
+
+//. short checks that have their own worker pool, see MiQuality.h
+inline bool mi_is_quality_path(const std::string& p_strUri)
+{
+	return p_strUri.compare(0, p_strUri.find('?'), GD_API_QUALITY) == 0;
+}
+
+//. worker side of a request the front end admitted : its arrival and tenant precharge are
+//. this thread's until the scope ends, also when the handler throws (the pool swallows it),
+//. so they never carry over to the thread's next request.
+class WorkerRequestScope {
+public:
+	WorkerRequestScope(std::chrono::steady_clock::time_point p_tArrival, bool p_bCharged)
+	{
+		mi_admission_set_arrival(p_tArrival);
+		mi_tenant_set_precharged(p_bCharged);
+	}
+	~WorkerRequestScope()
+	{
+		mi_tenant_set_precharged(false);
+		mi_admission_set_arrival(std::chrono::steady_clock::time_point());
+	}
+	WorkerRequestScope(const WorkerRequestScope&) = delete;
+	WorkerRequestScope& operator=(const WorkerRequestScope&) = delete;
+};
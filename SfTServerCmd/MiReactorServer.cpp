@@ -0,0 +1,578 @@
+#include "MiReactorServer.h"
+#include "MIServer.h"
+#include "MiAdmission.h"
+#include "MiConnection.h"
+#include "MiCores.h"
+#include "MiMetrics.h"
+#include "MiProgressive.h"
+#include "MiReactorHttp.h"
+#include "MiStages.h"
+#include "MiWorkerPool.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/NObserver.h"
+#include "Poco/Net/ParallelSocketAcceptor.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/SocketNotification.h"
+#include "Poco/Net/SocketReactor.h"
+#include "Poco/Thread.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define LD_MAX_HEADER		(64 * 1024)
+#define LD_READ_CHUNK		(256 * 1024)
+
+static void ingest_hold(size_t p_nBytes);
+static void ingest_release(size_t p_nBytes);
+
+struct ReactorJob {
+	ReactorServerResponse	response;
+	ReactorServerRequest	request;
+	std::chrono::steady_clock::time_point	arrival;	//. header received
+	std::shared_ptr<ProgressiveUpload>		upload;		//. decode started while receiving, see MiProgressive.h
+	size_t					held;		//. body bytes counted by flow control
+	ReactorJob(const SocketAddress& p_client, const SocketAddress& p_server, const HTTPServerParams& p_params)
+		: request(response, p_client, p_server, p_params), held(0) {}
+	~ReactorJob()
+	{
+		if (upload) mi_progressive_abort(*upload);
+		ingest_release(held);
+	}
+	void hold(size_t p_nBytes) { held = p_nBytes; ingest_hold(held); }
+};
+
+static HTTPServerParams::Ptr lv_pParams;
+//. requests whose header arrived and whose body is still being received.
+static std::atomic<int> lv_nReceiving(0);
+
+static void receiving(int p_nDelta)
+{
+	mi_stage_depth(MI_PIPE_RECEIVE, lv_nReceiving.fetch_add(p_nDelta) + p_nDelta);
+}
+
+//. flow control, see MiReactorServer.h
+class ReactorConnection;
+static size_t lv_nIngestHigh = 0;			//. bytes, 0 = no byte mark
+static size_t lv_nIngestLow = 0;
+static int lv_nQueuedHigh = 0;				//. requests waiting for a worker, 0 = no queue mark
+static std::atomic<size_t> lv_nIngest(0);
+static std::atomic<bool> lv_bPaused(false);
+static std::mutex lv_mtxPaused;
+static std::vector<std::weak_ptr<ReactorConnection>> lv_vPaused;	//. guarded by lv_mtxPaused
+
+static int queued()
+{
+	return g_pWorkerPool != NULL ? g_pWorkerPool->queued() : 0;
+}
+
+static void ingest_hold(size_t p_nBytes)
+{
+	lv_nIngest.fetch_add(p_nBytes);
+	if (lv_bPaused.load()) return;
+	bool bHigh = (lv_nIngestHigh > 0 && lv_nIngest.load() > lv_nIngestHigh) || (lv_nQueuedHigh > 0 && queued() >= lv_nQueuedHigh);
+	if (bHigh && !lv_bPaused.exchange(true)) mi_metrics_ingest_pause();
+}
+
+static void resume_paused();
+
+static void ingest_release(size_t p_nBytes)
+{
+	lv_nIngest.fetch_sub(p_nBytes);
+	if (lv_bPaused.load()) resume_paused();
+}
+
+//. true when reads are paused and p_pConn is now on the list to resume; its m_mtx is held.
+static bool ingest_park(const std::shared_ptr<ReactorConnection>& p_pConn)
+{
+	std::lock_guard<std::mutex> lock(lv_mtxPaused);
+	if (!lv_bPaused.load()) return false;
+	lv_vPaused.push_back(p_pConn);
+	return true;
+}
+
+//. short checks that have their own worker pool, see MiQuality.h
+static WorkerPool* lv_pQualityPool = NULL;
+
+//. One client connection. Every member is guarded by m_mtx : reactor callbacks and
+//. the worker that finishes a request both touch it. The connection only closes on
+//. its reactor thread; a worker still holding a job keeps the object alive through
+//. the shared_ptr and finds it closed.
+class ReactorConnection {
+public:
+	ReactorConnection(StreamSocket& p_socket, SocketReactor& p_reactor)
+		: m_socket(p_socket), m_reactor(p_reactor)
+		, m_readable(*this, &ReactorConnection::onReadable)
+		, m_writable(*this, &ReactorConnection::onWritable)
+		, m_timeout(*this, &ReactorConnection::onTimeout)
+		, m_error(*this, &ReactorConnection::onError)
+		, m_shutdown(*this, &ReactorConnection::onShutdown)
+		, m_nBodyLen(0), m_nOutPos(0), m_nRequests(0)
+		, m_bBusy(false), m_bKeep(false), m_bClosed(false), m_bPaused(false)
+	{
+		m_self.reset(this);
+		m_client = m_socket.peerAddress();
+		m_server = m_socket.address();
+		m_socket.setBlocking(false);
+		mi_socket_tune(m_socket);
+		m_tActivity = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_reactor.addEventHandler(m_socket, m_readable);
+		m_reactor.addEventHandler(m_socket, m_timeout);
+		m_reactor.addEventHandler(m_socket, m_error);
+		m_reactor.addEventHandler(m_socket, m_shutdown);
+	}
+
+	//. any thread : polls the socket again after a pause of the reads.
+	void resume()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if (m_bClosed || !m_bPaused) return;
+		m_bPaused = false;
+		m_tActivity = std::chrono::steady_clock::now();
+		m_reactor.addEventHandler(m_socket, m_readable);
+	}
+
+	//. worker thread : hands the serialized response to the reactor.
+	void complete(std::string&& p_strOut, bool p_bKeepAlive)
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if (m_bClosed) return;
+		m_strOut = std::move(p_strOut);
+		m_nOutPos = 0;
+		m_bKeep = p_bKeepAlive;
+		m_reactor.addEventHandler(m_socket, m_writable);
+	}
+
+private:
+	//. a request handed to a worker that ends without complete (an exception, which the
+	//. pool swallows) : answers 500 and closes, instead of leaving the connection busy,
+	//. which onTimeout skips.
+	class Unanswered {
+	public:
+		explicit Unanswered(const std::shared_ptr<ReactorConnection>& p_pConn) : m_pConn(p_pConn) {}
+		~Unanswered() { if (m_pConn) m_pConn->fail(); }
+		void dismiss() { m_pConn.reset(); }
+	private:
+		std::shared_ptr<ReactorConnection>	m_pConn;
+	};
+
+	void fail()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		if (m_bClosed || !m_bBusy) return;
+		m_bBusy = false;
+		reply(HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, false);
+	}
+
+	void onReadable(const AutoPtr<ReadableNotification>&)
+	{
+		bool bClose = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if (m_bClosed || m_bBusy || m_bPaused) return;
+			//. between requests only : a body being received is counted already and must arrive.
+			if (!m_pJob && lv_bPaused.load() && ingest_park(m_self)) {
+				m_bPaused = true;
+				m_reactor.removeEventHandler(m_socket, m_readable);
+				return;
+			}
+
+			//. once the header is parsed the body is received in place.
+			std::string& dst = (m_pJob && m_pJob->request.body().size() < m_nBodyLen) ? m_pJob->request.body() : m_strIn;
+			size_t room = (&dst == &m_strIn) ? LD_MAX_HEADER : std::min<size_t>(m_nBodyLen - dst.size(), LD_READ_CHUNK);
+			size_t have = dst.size();
+			dst.resize(have + room);
+			int n = 0;
+			try {
+				n = m_socket.receiveBytes(&dst[have], (int)room);
+			}
+			catch (Poco::Exception&) {
+				n = 0;
+			}
+			dst.resize(have + (n > 0 ? n : 0));
+			if (n == 0) bClose = true;
+			else if (n > 0) {
+				m_tActivity = std::chrono::steady_clock::now();
+				bClose = !parse();
+			}
+		}
+		if (bClose) close();
+	}
+
+	void onWritable(const AutoPtr<WritableNotification>&)
+	{
+		bool bClose = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if (m_bClosed) return;
+			while (m_nOutPos < m_strOut.size()) {
+				int n = -1;
+				try {
+					n = m_socket.sendBytes(m_strOut.data() + m_nOutPos, (int)(m_strOut.size() - m_nOutPos));
+				}
+				catch (Poco::Exception&) {
+					bClose = true;
+				}
+				if (n <= 0) break;
+				m_nOutPos += n;
+			}
+			if (!bClose && m_nOutPos >= m_strOut.size()) {
+				m_reactor.removeEventHandler(m_socket, m_writable);
+				m_strOut.clear();
+				m_nOutPos = 0;
+				m_tActivity = std::chrono::steady_clock::now();
+				if (!m_bKeep) bClose = true;
+				else {
+					if (m_bBusy) {
+						m_bBusy = false;
+						m_reactor.addEventHandler(m_socket, m_readable);
+					}
+					//. a pipelined request may already be buffered.
+					bClose = !parse();
+				}
+			}
+		}
+		if (bClose) close();
+	}
+
+	void onTimeout(const AutoPtr<TimeoutNotification>&)
+	{
+		bool bClose = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if (m_bClosed || m_bBusy || m_bPaused) return;
+			int limitSec = (m_pJob || !m_strIn.empty()) ? g_Settings.timeoutSec : g_Settings.keepAliveTimeoutSec;
+			bClose = std::chrono::steady_clock::now() - m_tActivity > std::chrono::seconds(limitSec);
+		}
+		if (bClose) close();
+	}
+
+	void onError(const AutoPtr<ErrorNotification>&) { close(); }
+	void onShutdown(const AutoPtr<ShutdownNotification>&) { close(); }
+
+	//. parses whatever is buffered and submits a complete request. m_mtx must be held.
+	//. Returns false when the connection has to be closed.
+	bool parse()
+	{
+		if (m_bBusy || !m_strOut.empty()) return true;
+
+		if (!m_pJob) {
+			size_t pos = m_strIn.find("\r\n\r\n");
+			if (pos == std::string::npos) {
+				if (m_strIn.size() > LD_MAX_HEADER) reply(HTTPResponse::HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE, false);
+				return true;
+			}
+			size_t headerLen = pos + 4;
+
+			m_pJob.reset(new ReactorJob(m_client, m_server, *lv_pParams));
+			m_pJob->request.set_socket(&m_socket);
+			receiving(1);
+			ReactorServerRequest& req = m_pJob->request;
+			try {
+				Poco::MemoryInputStream in(m_strIn.data(), headerLen);
+				req.read(in);
+			}
+			catch (Poco::Exception&) {
+				reply(HTTPResponse::HTTP_BAD_REQUEST, false);
+				return true;
+			}
+			if (req.getChunkedTransferEncoding()) {
+				reply(HTTPResponse::HTTP_LENGTH_REQUIRED, false);
+				return true;
+			}
+			std::streamsize len = req.hasContentLength() ? req.getContentLength() : 0;
+			if (len < 0 || len > (std::streamsize)mi_config().maxBodyMb * 1024 * 1024) {
+				reply(HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE, false);
+				return true;
+			}
+			m_nBodyLen = (size_t)len;
+			m_pJob->arrival = std::chrono::steady_clock::now();
+
+			//. refuse before the body is uploaded when the queue cannot meet the deadline.
+			int retryAfter = 0;
+			int lane = g_Settings.lanesEnable ? mi_lane_of(req) : MI_LANE_INTERACTIVE;
+			int status = 0;
+			if (mi_is_inference_path(req.getURI()) && !mi_tenant_precheck(req, &status, &retryAfter)) {
+				reply((HTTPResponse::HTTPStatus)status, false, retryAfter);
+				return true;
+			}
+			if (mi_is_inference_path(req.getURI()) && !mi_admission_precheck(req, g_pWorkerPool->queued(lane), &retryAfter)) {
+				reply(HTTPResponse::HTTP_SERVICE_UNAVAILABLE, false, retryAfter);
+				return true;
+			}
+
+			m_pJob->hold(m_nBodyLen);
+			m_pJob->upload = mi_progressive_begin(req, m_nBodyLen);
+			size_t take = std::min(m_strIn.size() - headerLen, m_nBodyLen);
+			req.body().reserve(m_nBodyLen);
+			req.body().assign(m_strIn, headerLen, take);
+			m_strIn.erase(0, headerLen + take);
+
+			if (req.body().size() < m_nBodyLen && Poco::icompare(req.get("Expect", ""), "100-continue") == 0) {
+				static const char szContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+				try {
+					m_socket.sendBytes(szContinue, sizeof(szContinue) - 1);
+				}
+				catch (Poco::Exception&) {
+					return false;
+				}
+			}
+		}
+
+		ReactorServerRequest& req = m_pJob->request;
+		if (m_pJob->upload) mi_progressive_feed(m_pJob->upload, req.body());
+		if (req.body().size() < m_nBodyLen) return true;
+
+		bool bKeep = g_Settings.keepAlive && req.getKeepAlive();
+		m_nRequests++;
+		if (g_Settings.maxKeepAliveRequests > 0 && m_nRequests >= g_Settings.maxKeepAliveRequests) bKeep = false;
+
+		req.open_body();
+		std::shared_ptr<ReactorJob> job(m_pJob.release());
+		receiving(-1);
+		std::shared_ptr<ReactorConnection> self = m_self;
+		bool bHead = req.getMethod() == HTTPRequest::HTTP_HEAD;
+		int lane = g_Settings.lanesEnable ? mi_lane_of(req) : MI_LANE_INTERACTIVE;
+		bool bCharged = mi_is_inference_path(req.getURI());
+		WorkerPool* pPool = (lv_pQualityPool != NULL && mi_is_quality_path(req.getURI())) ? lv_pQualityPool : g_pWorkerPool;
+		bool bQueued = pPool->submit([self, job, bKeep, bHead, bCharged]() {
+			Unanswered unanswered(self);
+			mi_stage_depth(MI_PIPE_DECODE, g_pWorkerPool->queued());
+			MyRequestHandler handler;
+			{
+				WorkerRequestScope scope(job->arrival, bCharged);
+				mi_progressive_set(job->upload);
+				handler.handleRequest(job->request, job->response);
+				mi_progressive_set(std::shared_ptr<ProgressiveUpload>());
+			}
+			//. this thread goes on with the next request while a send thread serializes.
+			unanswered.dismiss();
+			mi_stage_send([self, job, bKeep, bHead]() {
+				Unanswered unsent(self);
+				self->complete(job->response.serialize(bKeep, bHead), bKeep);
+				unsent.dismiss();
+			});
+		}, lane);
+		if (!bQueued) {
+			reply(HTTPResponse::HTTP_SERVICE_UNAVAILABLE, bKeep, 1);
+			return true;
+		}
+		mi_stage_depth(MI_PIPE_DECODE, g_pWorkerPool->queued());
+
+		//. no reads while the request is in flight, resumed by onWritable.
+		m_bBusy = true;
+		m_reactor.removeEventHandler(m_socket, m_readable);
+		return true;
+	}
+
+	//. answers without a worker. m_mtx must be held. Without keep-alive nothing more is read :
+	//. the connection closes once the answer is sent.
+	void reply(HTTPResponse::HTTPStatus p_status, bool p_bKeepAlive, int p_nRetryAfterSec = 0)
+	{
+		if (!p_bKeepAlive) {
+			m_reactor.removeEventHandler(m_socket, m_readable);
+			m_strIn.clear();
+			m_strIn.shrink_to_fit();
+		}
+		ReactorServerResponse resp;
+		resp.setStatusAndReason(p_status);
+		if (p_nRetryAfterSec > 0) resp.set("Retry-After", std::to_string(p_nRetryAfterSec));
+		mi_headers_apply(resp, MI_HEADERS_TEXT);
+		resp.send() << resp.getReason();
+		m_strOut = resp.serialize(p_bKeepAlive, false);
+		m_nOutPos = 0;
+		m_bKeep = p_bKeepAlive;
+		if (m_pJob) {
+			m_pJob.reset();
+			receiving(-1);
+		}
+		m_reactor.addEventHandler(m_socket, m_writable);
+	}
+
+	//. reactor thread only; may delete this, so it must be the last call.
+	void close()
+	{
+		std::shared_ptr<ReactorConnection> self;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if (m_bClosed) return;
+			m_bClosed = true;
+			m_reactor.removeEventHandler(m_socket, m_readable);
+			m_reactor.removeEventHandler(m_socket, m_writable);
+			m_reactor.removeEventHandler(m_socket, m_timeout);
+			m_reactor.removeEventHandler(m_socket, m_error);
+			m_reactor.removeEventHandler(m_socket, m_shutdown);
+			try {
+				m_socket.shutdown();
+			}
+			catch (Poco::Exception&) {
+			}
+			m_socket.close();
+			if (m_pJob) {
+				m_pJob.reset();
+				receiving(-1);
+			}
+			self.swap(m_self);
+		}
+	}
+
+	StreamSocket											m_socket;
+	SocketReactor&											m_reactor;
+	std::shared_ptr<ReactorConnection>						m_self;
+	SocketAddress											m_client;
+	SocketAddress											m_server;
+
+	Poco::NObserver<ReactorConnection, ReadableNotification>	m_readable;
+	Poco::NObserver<ReactorConnection, WritableNotification>	m_writable;
+	Poco::NObserver<ReactorConnection, TimeoutNotification>		m_timeout;
+	Poco::NObserver<ReactorConnection, ErrorNotification>		m_error;
+	Poco::NObserver<ReactorConnection, ShutdownNotification>	m_shutdown;
+
+	std::mutex												m_mtx;
+	std::string												m_strIn;		//. header bytes and pipelined input
+	std::unique_ptr<ReactorJob>								m_pJob;			//. request being received
+	size_t													m_nBodyLen;
+	std::string												m_strOut;
+	size_t													m_nOutPos;
+	int														m_nRequests;
+	bool													m_bBusy;		//. request handed to a worker
+	bool													m_bKeep;
+	bool													m_bClosed;
+	bool													m_bPaused;		//. reads stopped by flow control
+	std::chrono::steady_clock::time_point					m_tActivity;
+};
+
+//. may run with the m_mtx of the connection dropping a job held : paused connections have
+//. no job, so that is never one of the locks resume() takes.
+static void resume_paused()
+{
+	std::vector<std::weak_ptr<ReactorConnection>> v;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxPaused);
+		if (!lv_bPaused.load()) return;
+		bool bLow = (lv_nIngestHigh == 0 || lv_nIngest.load() <= lv_nIngestLow) && (lv_nQueuedHigh == 0 || queued() <= lv_nQueuedHigh / 2);
+		if (!bLow) return;
+		lv_bPaused.store(false);
+		v.swap(lv_vPaused);
+	}
+	for (auto& w : v) {
+		std::shared_ptr<ReactorConnection> p = w.lock();
+		if (p) p->resume();
+	}
+}
+
+size_t mi_reactor_ingest_bytes()
+{
+	return lv_nIngest.load();
+}
+
+size_t mi_reactor_paused()
+{
+	std::lock_guard<std::mutex> lock(lv_mtxPaused);
+	return lv_vPaused.size();
+}
+
+//. a reactor thread on the [cores] io processors.
+class IoReactor : public SocketReactor {
+public:
+	void run() override
+	{
+		mi_cores_pin(MI_CORES_IO);
+		SocketReactor::run();
+	}
+};
+
+typedef ParallelSocketAcceptor<ReactorConnection, IoReactor> ReactorAcceptor;
+
+static ServerSocket*		lv_pSocket = NULL;
+static IoReactor*			lv_pReactor = NULL;
+static ReactorAcceptor*		lv_pAcceptor = NULL;
+static ServerSocket*		lv_pLocalSocket = NULL;		//. server.local_socket
+static ReactorAcceptor*		lv_pLocalAcceptor = NULL;
+static Poco::Thread			lv_thread;
+
+bool mi_reactor_start(std::string& p_strErr)
+{
+	try {
+		lv_pParams = new HTTPServerParams;
+		lv_pParams->setKeepAlive(g_Settings.keepAlive);
+		lv_pParams->setMaxKeepAliveRequests(g_Settings.maxKeepAliveRequests);
+		lv_pParams->setKeepAliveTimeout(Poco::Timespan(g_Settings.keepAliveTimeoutSec, 0));
+		lv_pParams->setTimeout(Poco::Timespan(g_Settings.timeoutSec, 0));
+
+		lv_nIngestHigh = g_Settings.ingestHighMb > 0 ? (size_t)g_Settings.ingestHighMb * 1024 * 1024 : 0;
+		lv_nIngestLow = std::min(lv_nIngestHigh, (size_t)std::max(g_Settings.ingestLowMb, 0) * 1024 * 1024);
+		lv_nQueuedHigh = std::max(g_Settings.ingestHighQueued, 0);
+		g_pWorkerPool = new WorkerPool(g_Settings.inferenceWorkers, g_Settings.inferenceQueue);
+		g_pWorkerPool->start();
+		if (g_Settings.qualityEnable && g_Settings.qualityWorkers > 0) {
+			lv_pQualityPool = new WorkerPool(g_Settings.qualityWorkers, g_Settings.qualityQueue);
+			lv_pQualityPool->start();
+		}
+
+		mi_progressive_init(g_Settings.decodeProgressive, (size_t)g_Settings.decodeProgressiveMinKb * 1024, g_Settings.decodeProgressiveThreads);
+		lv_pSocket = new ServerSocket(mi_listen_socket());
+		lv_pReactor = new IoReactor;
+		lv_pAcceptor = new ReactorAcceptor(*lv_pSocket, *lv_pReactor, g_Settings.ioThreads > 0 ? g_Settings.ioThreads : 1, "MiReactor");
+		if (!g_Settings.localSocket.empty()) {
+			lv_pLocalSocket = new ServerSocket(mi_local_listen_socket());
+			lv_pLocalAcceptor = new ReactorAcceptor(*lv_pLocalSocket, *lv_pReactor, g_Settings.ioThreads > 0 ? g_Settings.ioThreads : 1, "MiReactorLocal");
+		}
+		lv_thread.start(*lv_pReactor);
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		mi_reactor_stop();
+		return false;
+	}
+	return true;
+}
+
+void mi_reactor_drain(int p_nSec)
+{
+	if (g_pWorkerPool == NULL) return;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(p_nSec);
+	while ((g_pWorkerPool->pending() > 0 || (lv_pQualityPool != NULL && lv_pQualityPool->pending() > 0) || mi_stages_pending() > 0) && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
+
+void mi_reactor_stop()
+{
+	if (lv_pReactor != NULL) {
+		lv_pReactor->stop();
+		if (lv_thread.isRunning()) lv_thread.join();
+	}
+	//. the acceptor owns the connection reactors; deleting it shuts the connections down.
+	delete lv_pAcceptor;
+	lv_pAcceptor = NULL;
+	delete lv_pLocalAcceptor;
+	lv_pLocalAcceptor = NULL;
+	delete lv_pReactor;
+	lv_pReactor = NULL;
+	delete lv_pSocket;
+	lv_pSocket = NULL;
+	if (lv_pLocalSocket != NULL) {
+		delete lv_pLocalSocket;
+		lv_pLocalSocket = NULL;
+		mi_local_socket_remove();
+	}
+	//. the connections are gone, no decode waits for bytes any more.
+	mi_progressive_stop();
+
+	if (g_pWorkerPool != NULL) {
+		g_pWorkerPool->stop();
+		delete g_pWorkerPool;
+		g_pWorkerPool = NULL;
+	}
+	if (lv_pQualityPool != NULL) {
+		lv_pQualityPool->stop();
+		delete lv_pQualityPool;
+		lv_pQualityPool = NULL;
+	}
+}
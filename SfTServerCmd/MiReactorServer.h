@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+//. Alternative front end (server.mode = reactor) : connections are multiplexed on
+//. server.io_threads Poco SocketReactors which receive headers and bodies without
+//. blocking. Only complete requests are passed to g_pWorkerPool, where the usual
+//. MyRequestHandler routes run against the buffered request.
+//. Limits : Content-Length bodies only (chunked uploads get 411), bodies above
+//. server.max_body_mb get 413, a full inference queue gets 503.
+//. With [stages] enable the workers are the decode stage of MiStages.h : pipeline calls
+//. and response serialization go to their own threads.
+//. With [decode] progressive large JPEG uploads are decoded while they arrive, see MiProgressive.h
+//. Flow control ([server] ingest_*) : every request holds the size of its body from the
+//. header until its response is handed back. Past the high-water mark (bytes held, or
+//. requests waiting for a worker) connections stop being polled for new requests, so the
+//. sockets and the clients buffer them instead of the heap; under the low-water mark they
+//. are polled again. A body already announced is still received, which keeps the requests
+//. that will release memory moving.
+
+//. opens the listen socket and starts the reactors and the worker pool.
+bool mi_reactor_start(std::string& p_strErr);
+void mi_reactor_stop();
+//. waits up to p_nSec for the worker pool to answer every request it holds; the
+//. reactors keep running so the answers still go out. Call before mi_reactor_stop.
+void mi_reactor_drain(int p_nSec);
+
+//. request bodies held and connections paused by flow control, for GD_API_METRICS.
+size_t mi_reactor_ingest_bytes();
+size_t mi_reactor_paused();
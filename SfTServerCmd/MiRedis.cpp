@@ -0,0 +1,212 @@
+#include "MiRedis.h"
+#include "MiConf.h"
+#include "MiSettings.h"
+#include "Poco/ObjectPool.h"
+#include "Poco/Redis/Command.h"
+#include "Poco/Redis/Exception.h"
+#include "Poco/Redis/Type.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using Poco::Redis::Array;
+using Poco::Redis::BulkString;
+using Poco::Redis::Client;
+using Poco::Redis::Command;
+
+//. opens connections with the configured timeouts; broken ones fail validation.
+class RedisFactory {
+public:
+	RedisFactory(const std::string& p_strHost, int p_nPort, int p_nTimeoutMs)
+		: m_address(p_strHost, (Poco::UInt16)p_nPort), m_timeout((Poco::Timespan::TimeDiff)p_nTimeoutMs * 1000) {}
+
+	Client::Ptr createObject()
+	{
+		Client::Ptr pClient = new Client;
+		pClient->connect(m_address, m_timeout);
+		pClient->setReceiveTimeout(m_timeout);
+		return pClient;
+	}
+	bool validateObject(Client::Ptr p_pClient) { return p_pClient->isConnected(); }
+	void activateObject(Client::Ptr) {}
+	void deactivateObject(Client::Ptr) {}
+	void destroyObject(Client::Ptr p_pClient)
+	{
+		try {
+			p_pClient->disconnect();
+		}
+		catch (Poco::Exception&) {
+		}
+	}
+private:
+	Poco::Net::SocketAddress	m_address;
+	Poco::Timespan				m_timeout;
+};
+
+typedef Poco::ObjectPool<Client, Client::Ptr, RedisFactory> RedisPool;
+
+static RedisPool*	lv_pPool = NULL;
+static std::string	lv_strPrefix;
+static long			lv_nTimeoutMs = 50;
+
+bool mi_redis_init(const std::string& p_strHost, int p_nPort, int p_nPoolSize, int p_nTimeoutMs, const std::string& p_strPrefix, std::string& p_strErr)
+{
+	if (p_nPoolSize < 1) p_nPoolSize = 1;
+	lv_strPrefix = p_strPrefix;
+	lv_nTimeoutMs = p_nTimeoutMs > 0 ? p_nTimeoutMs : 50;
+	lv_pPool = new RedisPool(RedisFactory(p_strHost, p_nPort, (int)lv_nTimeoutMs), 1, (std::size_t)p_nPoolSize);
+
+	//. a first PING tells the operator at startup; later outages are ridden out.
+	try {
+		RedisConn conn;
+		std::vector<Array> cmds(1, Command::ping());
+		if (conn.valid()) conn.pipeline(cmds);
+	}
+	catch (Poco::Exception& ex) {
+		p_strErr = ex.displayText();
+		return false;
+	}
+	return true;
+}
+
+void mi_redis_shutdown()
+{
+	delete lv_pPool;
+	lv_pPool = NULL;
+}
+
+bool mi_redis_enabled()
+{
+	return lv_pPool != NULL;
+}
+
+std::string mi_redis_key(const char* p_pszKind, const std::string& p_strId)
+{
+	std::string strKey;
+	strKey.reserve(lv_strPrefix.size() + 16 + p_strId.size());
+	strKey += lv_strPrefix;
+	strKey += p_pszKind;
+	strKey += p_strId;
+	return strKey;
+}
+
+RedisConn::RedisConn() : m_bBroken(false)
+{
+	if (lv_pPool == NULL) return;
+	try {
+		m_pClient = lv_pPool->borrowObject(lv_nTimeoutMs);
+	}
+	catch (Poco::Exception&) {
+		//. connect failed; the caller sees !valid().
+	}
+}
+
+RedisConn::~RedisConn()
+{
+	if (m_pClient.isNull()) return;
+	if (m_bBroken) m_pClient->disconnect();
+	lv_pPool->returnObject(m_pClient);
+}
+
+Array RedisConn::pipeline(const std::vector<Array>& p_vCommands)
+{
+	try {
+		return m_pClient->sendCommands(p_vCommands);
+	}
+	catch (Poco::Exception&) {
+		//. a half-read pipeline leaves replies on the wire.
+		m_bBroken = true;
+		throw;
+	}
+}
+
+static std::string cache_id(const ResultKey& p_key)
+{
+	//. the SHA-256, not the XXH64 : the nodes share verdicts by it (MiResultCache.h).
+	char sz[2 * MI_DIGEST_SIZE + 40];
+	for (int i = 0; i < MI_DIGEST_SIZE; i++) snprintf(sz + 2 * i, 3, "%02x", p_key.digest[i]);
+	snprintf(sz + 2 * MI_DIGEST_SIZE, sizeof(sz) - 2 * MI_DIGEST_SIZE, "%016llx%llx", (unsigned long long)p_key.size, (unsigned long long)p_key.variant);
+	return sz;
+}
+
+//. CPipelineResult_t is plain data and every node runs the same build.
+static bool decode_result(const Array& p_replies, size_t p_nIndex, CPipelineResult_t* p_pResult)
+{
+	if (p_replies.getType(p_nIndex) != Poco::Redis::RedisTypeTraits<BulkString>::TypeId) return false;
+	BulkString value = p_replies.get<BulkString>(p_nIndex);
+	if (value.isNull() || value.value().size() != sizeof(CPipelineResult_t)) return false;
+	memcpy(p_pResult, value.value().data(), sizeof(CPipelineResult_t));
+	return true;
+}
+
+RedisClaim mi_redis_cache_claim(const ResultKey& p_key, CPipelineResult_t* p_pResult)
+{
+	RedisConn conn;
+	if (!conn.valid()) return MI_REDIS_OFF;
+	std::string strId = cache_id(p_key);
+	try {
+		std::vector<Array> cmds;
+		cmds.push_back(Command::get(mi_redis_key("res:", strId)));
+		cmds.push_back(Command::set(mi_redis_key("claim:", strId), "1", false, Poco::Timespan((Poco::Timespan::TimeDiff)g_Settings.redisClaimMs * 1000)));
+		Array replies = conn.pipeline(cmds);
+		if (decode_result(replies, 0, p_pResult)) return MI_REDIS_HIT;
+		//. SET NX answers OK when it set the key, nil when another node holds it.
+		if (replies.getType(1) == Poco::Redis::RedisTypeTraits<std::string>::TypeId) return MI_REDIS_CLAIMED;
+		return MI_REDIS_BUSY;
+	}
+	catch (Poco::Exception&) {
+		return MI_REDIS_OFF;
+	}
+}
+
+bool mi_redis_cache_wait(const ResultKey& p_key, CPipelineResult_t* p_pResult)
+{
+	std::string strKey = mi_redis_key("res:", cache_id(p_key));
+	std::string strClaim = mi_redis_key("claim:", cache_id(p_key));
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_Settings.redisClaimMs);
+	while (std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(GD_REDIS_POLL_MS));
+		RedisConn conn;
+		if (!conn.valid()) return false;
+		try {
+			std::vector<Array> cmds;
+			cmds.push_back(Command::get(strKey));
+			cmds.push_back(Command::exists(strClaim));
+			Array replies = conn.pipeline(cmds);
+			if (decode_result(replies, 0, p_pResult)) return true;
+			//. the other node gave up without a verdict.
+			if (replies.get<Poco::Int64>(1) == 0) return false;
+		}
+		catch (Poco::Exception&) {
+			return false;
+		}
+	}
+	return false;
+}
+
+void mi_redis_cache_put(const ResultKey& p_key, const CPipelineResult_t& p_result)
+{
+	RedisConn conn;
+	if (!conn.valid()) return;
+	std::string strId = cache_id(p_key);
+	try {
+		std::vector<Array> cmds;
+		cmds.push_back(Command::set(mi_redis_key("res:", strId), std::string((const char*)&p_result, sizeof(p_result)), true, Poco::Timespan(g_Settings.cacheTtlSec, 0)));
+		cmds.push_back(Command::del(mi_redis_key("claim:", strId)));
+		conn.pipeline(cmds);
+	}
+	catch (Poco::Exception&) {
+	}
+}
+
+void mi_redis_cache_release(const ResultKey& p_key)
+{
+	RedisConn conn;
+	if (!conn.valid()) return;
+	try {
+		std::vector<Array> cmds(1, Command::del(mi_redis_key("claim:", cache_id(p_key))));
+		conn.pipeline(cmds);
+	}
+	catch (Poco::Exception&) {
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiResultCache.h"
+#include "Poco/Redis/Array.h"
+#include "Poco/Redis/Client.h"
+
+//. Shared tier ([redis]) for the nodes behind one load balancer : the result cache
+//. falls back to Redis after a local miss, and the async jobs (MiJobs.h) can be queued
+//. in Redis so any node drains them. Connections come from a Poco::ObjectPool; the
+//. commands of one operation go out in one pipelined round trip.
+//. A Redis that is down or slow never fails a request : the calls report a miss and
+//. the check runs locally.
+
+bool mi_redis_init(const std::string& p_strHost, int p_nPort, int p_nPoolSize, int p_nTimeoutMs, const std::string& p_strPrefix, std::string& p_strErr);
+void mi_redis_shutdown();
+bool mi_redis_enabled();
+
+//. p_strPrefix + p_pszKind + p_strId, e.g. "mi:job:<id>".
+std::string mi_redis_key(const char* p_pszKind, const std::string& p_strId);
+
+//. Borrowed pool connection. A connection that failed is dropped on release and the
+//. pool opens a fresh one for the next borrower.
+class RedisConn {
+public:
+	RedisConn();
+	~RedisConn();
+
+	bool valid() const { return !m_pClient.isNull(); }
+	//. sends every command, then reads every reply (Redis errors stay in the array).
+	//. Throws on connection errors after marking the connection broken.
+	Poco::Redis::Array pipeline(const std::vector<Poco::Redis::Array>& p_vCommands);
+
+	RedisConn(const RedisConn&) = delete;
+	RedisConn& operator=(const RedisConn&) = delete;
+private:
+	Poco::Redis::Client::Ptr	m_pClient;
+	bool						m_bBroken;
+};
+
+//. result cache tier, keyed like ResultCache.
+enum RedisClaim {
+	MI_REDIS_OFF = 0,		//. no Redis tier or it failed : check locally
+	MI_REDIS_HIT,			//. p_pResult holds the shared verdict
+	MI_REDIS_CLAIMED,		//. this node checks the image and must put or release
+	MI_REDIS_BUSY			//. another node is checking the same image
+};
+
+//. one round trip : GET of the result and SET NX of the claim.
+RedisClaim mi_redis_cache_claim(const ResultKey& p_key, CPipelineResult_t* p_pResult);
+//. after MI_REDIS_BUSY : polls for the other node's verdict for up to redis.claim_ms.
+bool mi_redis_cache_wait(const ResultKey& p_key, CPipelineResult_t* p_pResult);
+//. stores the verdict for cache.ttl_sec and drops the claim.
+void mi_redis_cache_put(const ResultKey& p_key, const CPipelineResult_t& p_result);
+//. drops the claim without a verdict (failed check).
+void mi_redis_cache_release(const ResultKey& p_key);
@@ -0,0 +1,150 @@
+#include "MiRequestProfile.h"
+#include "MiConf.h"
+#include "MiConnection.h"
+#include "MiContext.h"
+#include "MiCost.h"
+#include "Poco/URI.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+
+using namespace std::chrono;
+
+static bool				lv_bEnabled = false;
+static std::string		lv_strKey;
+
+void mi_request_profile_init(bool p_bEnable, const std::string& p_strAdminKey)
+{
+	lv_bEnabled = p_bEnable;
+	lv_strKey = p_strAdminKey;
+}
+
+//. the whole key compared, so the time taken does not tell how much of it matched.
+static bool key_matches(const std::string& p_strKey)
+{
+	if (p_strKey.size() != lv_strKey.size()) return false;
+	unsigned char diff = 0;
+	for (size_t i = 0; i < p_strKey.size(); i++) diff |= (unsigned char)(p_strKey[i] ^ lv_strKey[i]);
+	return diff == 0;
+}
+
+static bool asked(const Poco::Net::HTTPServerRequest& p_request)
+{
+	const std::string& uri = p_request.getURI();
+	if (uri.find(GD_REQUEST_PROFILE_PARAM "=") == std::string::npos) return false;
+	try {
+		Poco::URI::QueryParameters params = Poco::URI(uri).getQueryParameters();
+		for (auto& p : params) {
+			if (p.first == GD_REQUEST_PROFILE_PARAM) return p.second == "1" || p.second == "true";
+		}
+	}
+	catch (const Poco::Exception&) {
+	}
+	return false;
+}
+
+void mi_request_profile_begin(RequestContext& p_ctx, const Poco::Net::HTTPServerRequest& p_request, steady_clock::time_point p_arrival)
+{
+	if (!lv_bEnabled || !asked(p_request)) return;
+	if (lv_strKey.empty() ? !mi_local_client(p_request.clientAddress()) : !key_matches(p_request.get(GD_REQUEST_PROFILE_KEY_HEADER, std::string()))) return;
+
+	steady_clock::time_point now = steady_clock::now();
+	p_ctx.profile.reset(new RequestProfile);
+	p_ctx.profile->start = p_arrival != steady_clock::time_point() && p_arrival < now ? p_arrival : now;
+	p_ctx.profile->spans.reserve(32);
+	if (p_ctx.profile->start < now) mi_request_profile_record(*p_ctx.profile, "queue", p_ctx.profile->start, now);
+}
+
+void mi_request_profile_record(RequestProfile& p_profile, const char* p_pszName, steady_clock::time_point p_start, steady_clock::time_point p_end)
+{
+	ProfileSpan span;
+	span.name = p_pszName;
+	span.startUs = duration_cast<microseconds>(p_start - p_profile.start).count();
+	span.durUs = duration_cast<microseconds>(p_end - p_start).count();
+	std::lock_guard<std::mutex> lock(p_profile.mtx);
+	if (p_profile.spans.size() < GD_REQUEST_PROFILE_MAX_SPANS) p_profile.spans.push_back(span);
+}
+
+void mi_request_profile_batch(size_t p_nImages)
+{
+	RequestContext* ctx = mi_context();
+	if (ctx != NULL && ctx->profile) ctx->profile->batchSize.store((int)p_nImages, std::memory_order_relaxed);
+}
+
+//. the spans in order of their start, and their sums by name in order of first appearance.
+static void snapshot(RequestProfile& p_profile, std::vector<ProfileSpan>& p_vSpans, std::vector<std::pair<const char*, int64_t>>& p_vSums)
+{
+	{
+		std::lock_guard<std::mutex> lock(p_profile.mtx);
+		p_vSpans = p_profile.spans;
+	}
+	for (size_t i = 1; i < p_vSpans.size(); i++) {
+		ProfileSpan s = p_vSpans[i];
+		size_t j = i;
+		for (; j > 0 && p_vSpans[j - 1].startUs > s.startUs; j--) p_vSpans[j] = p_vSpans[j - 1];
+		p_vSpans[j] = s;
+	}
+	for (auto& s : p_vSpans) {
+		size_t k = 0;
+		while (k < p_vSums.size() && strcmp(p_vSums[k].first, s.name) != 0) k++;
+		if (k == p_vSums.size()) p_vSums.push_back(std::make_pair(s.name, (int64_t)0));
+		p_vSums[k].second += s.durUs;
+	}
+}
+
+std::string mi_request_profile_header(const RequestContext& p_ctx)
+{
+	if (!p_ctx.profile) return std::string();
+	std::vector<ProfileSpan> vSpans;
+	std::vector<std::pair<const char*, int64_t>> vSums;
+	snapshot(*p_ctx.profile, vSpans, vSums);
+	std::string strOut;
+	char sz[96];
+	for (auto& s : vSums) {
+		snprintf(sz, sizeof(sz), "%s;dur=%.2f, ", s.first, s.second * 1e-3);
+		strOut += sz;
+	}
+	snprintf(sz, sizeof(sz), "total;dur=%.2f", duration<double, std::milli>(steady_clock::now() - p_ctx.profile->start).count());
+	strOut += sz;
+	return strOut;
+}
+
+bool mi_request_profile_body(const RequestContext& p_ctx, const char* p_pData, size_t p_nLength, std::string& p_strOut)
+{
+	if (!p_ctx.profile) return false;
+	size_t first = 0, last = p_nLength;
+	while (first < p_nLength && isspace((unsigned char)p_pData[first])) first++;
+	while (last > first && isspace((unsigned char)p_pData[last - 1])) last--;
+	if (last - first < 2 || p_pData[first] != '{' || p_pData[last - 1] != '}') return false;
+	bool bEmpty = true;
+	for (size_t i = first + 1; i < last - 1 && bEmpty; i++) bEmpty = isspace((unsigned char)p_pData[i]) != 0;
+
+	std::vector<ProfileSpan> vSpans;
+	std::vector<std::pair<const char*, int64_t>> vSums;
+	snapshot(*p_ctx.profile, vSpans, vSums);
+	char sz[160];
+	snprintf(sz, sizeof(sz), "%s\"profile\":{\"total_ms\":%.3f,\"batch_size\":%d,\"spans\":[", bEmpty ? "" : ",",
+		duration<double, std::milli>(steady_clock::now() - p_ctx.profile->start).count(), p_ctx.profile->batchSize.load(std::memory_order_relaxed));
+	std::string strProfile = sz;
+	for (size_t i = 0; i < vSpans.size(); i++) {
+		snprintf(sz, sizeof(sz), "%s{\"name\":\"%s\",\"start_ms\":%.3f,\"dur_ms\":%.3f}", i > 0 ? "," : "", vSpans[i].name,
+			vSpans[i].startUs * 1e-3, vSpans[i].durUs * 1e-3);
+		strProfile += sz;
+	}
+	strProfile += "]";
+	if (mi_cost_enabled()) {
+		const RequestCost& c = p_ctx.cost;
+		snprintf(sz, sizeof(sz), ",\"cost\":{\"decode_cpu_ms\":%.3f,\"infer_ms\":%.3f,\"bytes\":%llu}",
+			c.decodeCpuNs.load(std::memory_order_relaxed) * 1e-6, c.inferNs.load(std::memory_order_relaxed) * 1e-6,
+			(unsigned long long)c.bytes.load(std::memory_order_relaxed));
+		strProfile += sz;
+	}
+	strProfile += "}";
+
+	p_strOut.reserve(p_nLength + strProfile.size());
+	p_strOut.assign(p_pData, last - 1);
+	p_strOut += strProfile;
+	p_strOut.append(p_pData + last - 1, p_nLength - (last - 1));
+	return true;
+}
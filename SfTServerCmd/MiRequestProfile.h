@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Poco/Net/HTTPServerRequest.h"
+
+struct RequestContext;
+
+//. Debug profile of one request ([request_profile] settings) : where a partner's latency goes,
+//. without access to the server's logs. A request with ?profile=1 and the admin_key in
+//. GD_REQUEST_PROFILE_KEY_HEADER (from a loopback client when no key is set) keeps every span
+//. the trace would record for it (mi_trace_record, MiTrace.h), sampled or not : the wait for a
+//. worker ("queue"), the stages (ingest is the body read; image_create, decode, crop, convert
+//. the decode), each SDK call by its entry point (MiSdkCall.h), the batcher's hold and call
+//. ("batch_queue", "batch_call"), serialize; and the images of the SDK call that checked it.
+//. The response has them
+//. - in GD_COST_HEADER, summed by name, in place of the [cost] metrics :
+//.   Server-Timing: queue;dur=0.21, ingest;dur=1.02, image_create;dur=3.40, pipeline_check_liveness;dur=41.87, serialize;dur=0.05, total;dur=47.10
+//. - in a JSON body, as a "profile" member of the top-level object (mi_send_body) :
+//.   {"total_ms":47.2,"batch_size":4,"spans":[{"name":"queue","start_ms":0,"dur_ms":0.21}, ...]}
+//.   with the [cost] figures as "cost" when it is on. CBOR, MessagePack and JSON arrays get the
+//.   header only.
+//. Spans are timed from the arrival of the request; only the threads holding its context record
+//. (the request thread, ContextBorrow). Send and compress come after the body and are not in it.
+//. A request not allowed to is served as usual, the parameter ignored.
+
+struct ProfileSpan {
+	const char*		name;			//. string literal, see mi_trace_record
+	int64_t			startUs;		//. from the arrival of the request
+	int64_t			durUs;
+};
+
+struct RequestProfile {
+	std::chrono::steady_clock::time_point	start;
+	std::mutex								mtx;		//. spans
+	std::vector<ProfileSpan>				spans;		//. at most GD_REQUEST_PROFILE_MAX_SPANS
+	std::atomic<int>						batchSize;	//. images of the last SDK call, 0 = none
+
+	RequestProfile() : batchSize(0) {}
+};
+
+//. p_strAdminKey empty : loopback clients only.
+void mi_request_profile_init(bool p_bEnable, const std::string& p_strAdminKey);
+
+//. RequestScope : a RequestProfile on p_ctx when p_request asks for one and may; p_arrival as
+//. for mi_trace_begin, the wait from it is the "queue" span.
+void mi_request_profile_begin(RequestContext& p_ctx, const Poco::Net::HTTPServerRequest& p_request, std::chrono::steady_clock::time_point p_arrival);
+
+//. one span of the profiled request, from mi_trace_record.
+void mi_request_profile_record(RequestProfile& p_profile, const char* p_pszName, std::chrono::steady_clock::time_point p_start, std::chrono::steady_clock::time_point p_end);
+
+//. p_nImages checked by the SDK call that served the current request, no-op when not profiled.
+void mi_request_profile_batch(size_t p_nImages);
+
+//. GD_COST_HEADER value of the profile of p_ctx so far, empty when it has none.
+std::string mi_request_profile_header(const RequestContext& p_ctx);
+
+//. p_pData, a JSON object, with the "profile" member of p_ctx appended into p_strOut; false when
+//. p_ctx has no profile or the body is not a JSON object.
+bool mi_request_profile_body(const RequestContext& p_ctx, const char* p_pData, size_t p_nLength, std::string& p_strOut);
@@ -0,0 +1,155 @@
+#include "MiResize.h"
+#include "MiCpu.h"
+#include <string.h>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_RESIZE_SSE2 1
+#include <emmintrin.h>
+#else
+#define LD_RESIZE_SSE2 0
+#endif
+
+//. SSE2 is part of x64 : one variant, registered for the startup log and the benchmark.
+static void bind_resize(int)
+{
+}
+
+static const char* const lv_szVariants[] = { LD_RESIZE_SSE2 ? "sse2" : "scalar" };
+static const uint32_t lv_nNeeds[] = { 0 };
+static MiCpuKernel lv_kernel = { "resize", 1, lv_szVariants, lv_nNeeds, bind_resize, 0, 0 };
+static const bool lv_bRegistered = mi_cpu_register(&lv_kernel);
+
+//. p_pAcc[i] += p_pRow[i] for p_nLen bytes.
+static void accumulate_row(uint16_t* p_pAcc, const uint8_t* p_pRow, size_t p_nLen)
+{
+	size_t i = 0;
+#if LD_RESIZE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= p_nLen; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(p_pRow + i));
+		__m128i lo = _mm_loadu_si128((const __m128i*)(p_pAcc + i));
+		__m128i hi = _mm_loadu_si128((const __m128i*)(p_pAcc + i + 8));
+		_mm_storeu_si128((__m128i*)(p_pAcc + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero)));
+		_mm_storeu_si128((__m128i*)(p_pAcc + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero)));
+	}
+#endif
+	for (; i < p_nLen; i++) p_pAcc[i] += p_pRow[i];
+}
+
+//. area average by p_nK in both directions; output is (w / k) x (h / k).
+static void box_reduce(const uint8_t* p_pSrc, int p_nW, int p_nH, size_t p_nStride, int p_nK, std::vector<uint8_t>& p_vOut, int& p_nOutW, int& p_nOutH)
+{
+	p_nOutW = p_nW / p_nK;
+	p_nOutH = p_nH / p_nK;
+	size_t rowLen = (size_t)p_nOutW * p_nK * 3;
+	p_vOut.resize((size_t)p_nOutW * p_nOutH * 3);
+	//. p_nK <= 257 keeps the vertical sums inside 16 bits.
+	std::vector<uint16_t> acc(rowLen);
+	const uint32_t area = (uint32_t)p_nK * p_nK;
+
+	for (int oy = 0; oy < p_nOutH; oy++) {
+		memset(acc.data(), 0, rowLen * sizeof(uint16_t));
+		for (int k = 0; k < p_nK; k++) accumulate_row(acc.data(), p_pSrc + (size_t)(oy * p_nK + k) * p_nStride, rowLen);
+
+		uint8_t* out = &p_vOut[(size_t)oy * p_nOutW * 3];
+		for (int ox = 0; ox < p_nOutW; ox++) {
+			uint32_t s0 = 0, s1 = 0, s2 = 0;
+			const uint16_t* a = &acc[(size_t)ox * p_nK * 3];
+			for (int k = 0; k < p_nK; k++, a += 3) {
+				s0 += a[0]; s1 += a[1]; s2 += a[2];
+			}
+			out[ox * 3 + 0] = (uint8_t)((s0 + area / 2) / area);
+			out[ox * 3 + 1] = (uint8_t)((s1 + area / 2) / area);
+			out[ox * 3 + 2] = (uint8_t)((s2 + area / 2) / area);
+		}
+	}
+}
+
+//. p_pOut = (p_pA * (128 - p_nFy) + p_pB * p_nFy + rounding) >> 14 on rows of
+//. 1.7 fixed point (source value * 128), so each product pair fits one pmaddwd.
+static void blend_rows(const int16_t* p_pA, const int16_t* p_pB, int p_nFy, uint8_t* p_pOut, size_t p_nLen)
+{
+	size_t i = 0;
+#if LD_RESIZE_SSE2
+	const __m128i w = _mm_set1_epi32((p_nFy << 16) | (128 - p_nFy));
+	const __m128i round = _mm_set1_epi32(1 << 13);
+	for (; i + 16 <= p_nLen; i += 16) {
+		__m128i a0 = _mm_loadu_si128((const __m128i*)(p_pA + i));
+		__m128i b0 = _mm_loadu_si128((const __m128i*)(p_pB + i));
+		__m128i a1 = _mm_loadu_si128((const __m128i*)(p_pA + i + 8));
+		__m128i b1 = _mm_loadu_si128((const __m128i*)(p_pB + i + 8));
+		__m128i r0 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a0, b0), w), round), 14);
+		__m128i r1 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a0, b0), w), round), 14);
+		__m128i r2 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a1, b1), w), round), 14);
+		__m128i r3 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a1, b1), w), round), 14);
+		_mm_storeu_si128((__m128i*)(p_pOut + i), _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+	}
+#endif
+	for (; i < p_nLen; i++) {
+		p_pOut[i] = (uint8_t)((p_pA[i] * (128 - p_nFy) + p_pB[i] * p_nFy + (1 << 13)) >> 14);
+	}
+}
+
+static void bilinear(const uint8_t* p_pSrc, int p_nSrcW, int p_nSrcH, size_t p_nSrcStride,
+	uint8_t* p_pDst, int p_nDstW, int p_nDstH, size_t p_nDstStride)
+{
+	//. horizontal taps, 7-bit fractions, pixel centres aligned.
+	std::vector<int> x0(p_nDstW);
+	std::vector<int> fx(p_nDstW);
+	for (int x = 0; x < p_nDstW; x++) {
+		double sx = (x + 0.5) * p_nSrcW / p_nDstW - 0.5;
+		if (sx < 0) sx = 0;
+		int ix = (int)sx;
+		if (ix >= p_nSrcW - 1) { ix = p_nSrcW - 1; sx = ix; }
+		x0[x] = ix;
+		fx[x] = (int)((sx - ix) * 128 + 0.5);
+	}
+
+	size_t rowLen = (size_t)p_nDstW * 3;
+	std::vector<int16_t> rowA(rowLen), rowB(rowLen);
+	int cachedA = -1, cachedB = -1;
+	auto hpass = [&](int p_nY, int16_t* p_pOut) {
+		const uint8_t* row = p_pSrc + (size_t)p_nY * p_nSrcStride;
+		for (int x = 0; x < p_nDstW; x++) {
+			const uint8_t* a = row + (size_t)x0[x] * 3;
+			const uint8_t* b = x0[x] + 1 < p_nSrcW ? a + 3 : a;
+			int w = fx[x];
+			for (int c = 0; c < 3; c++) p_pOut[x * 3 + c] = (int16_t)(a[c] * (128 - w) + b[c] * w);
+		}
+	};
+
+	for (int y = 0; y < p_nDstH; y++) {
+		double sy = (y + 0.5) * p_nSrcH / p_nDstH - 0.5;
+		if (sy < 0) sy = 0;
+		int iy = (int)sy;
+		if (iy >= p_nSrcH - 1) { iy = p_nSrcH - 1; sy = iy; }
+		int iy1 = iy + 1 < p_nSrcH ? iy + 1 : iy;
+		int fy = (int)((sy - iy) * 128 + 0.5);
+
+		//. consecutive output rows mostly share their source rows.
+		if (cachedA != iy) {
+			if (cachedB == iy) { rowA.swap(rowB); cachedA = iy; cachedB = -1; }
+			else { hpass(iy, rowA.data()); cachedA = iy; }
+		}
+		if (cachedB != iy1) { hpass(iy1, rowB.data()); cachedB = iy1; }
+		blend_rows(rowA.data(), rowB.data(), fy, p_pDst + (size_t)y * p_nDstStride, rowLen);
+	}
+}
+
+void mi_resize_bgr(const uint8_t* p_pSrc, int p_nSrcW, int p_nSrcH, size_t p_nSrcStride,
+	uint8_t* p_pDst, int p_nDstW, int p_nDstH, size_t p_nDstStride)
+{
+	if (p_nSrcW <= 0 || p_nSrcH <= 0 || p_nDstW <= 0 || p_nDstH <= 0) return;
+
+	int k = p_nSrcW / p_nDstW < p_nSrcH / p_nDstH ? p_nSrcW / p_nDstW : p_nSrcH / p_nDstH;
+	if (k > 257) k = 257;
+	if (k >= 2) {
+		std::vector<uint8_t> reduced;
+		int w = 0, h = 0;
+		box_reduce(p_pSrc, p_nSrcW, p_nSrcH, p_nSrcStride, k, reduced, w, h);
+		bilinear(reduced.data(), w, h, (size_t)w * 3, p_pDst, p_nDstW, p_nDstH, p_nDstStride);
+		return;
+	}
+	bilinear(p_pSrc, p_nSrcW, p_nSrcH, p_nSrcStride, p_pDst, p_nDstW, p_nDstH, p_nDstStride);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//. Downscales a packed 24-bit (BGR or RGB) image. Integer factors are removed with
+//. a box filter first (area average, no aliasing on 12 MP sources), the remaining
+//. fraction is bilinear. Row sums and the vertical blend run on SSE2.
+//. p_nSrcStride / p_nDstStride are in bytes; upscaling falls back to bilinear only.
+void mi_resize_bgr(const uint8_t* p_pSrc, int p_nSrcW, int p_nSrcH, size_t p_nSrcStride,
+	uint8_t* p_pDst, int p_nDstW, int p_nDstH, size_t p_nDstStride);
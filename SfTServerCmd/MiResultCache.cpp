@@ -0,0 +1,52 @@
+#include "MiResultCache.h"
+#include "MiHash.h"
+#include "MiMeta.h"
+#include "MiPrecision.h"
+#include "MiValidation.h"
+
+ResultCache* g_pResultCache = NULL;
+
+//. slot of the open-addressing table (kept at most half full) per entry, close enough for the memory cap.
+#define LD_ENTRY_COST	(2 * (sizeof(ResultKey) + sizeof(CPipelineResult_t) + 32))
+
+ResultCache::ResultCache(size_t p_nMaxBytes, unsigned int p_nTtlSec, int p_nShards)
+	: m_map(p_nMaxBytes / LD_ENTRY_COST, p_nShards), m_ttl(p_nTtlSec), m_nHits(0), m_nMisses(0)
+{
+}
+
+uint64_t mi_result_variant(const CMeta_t* p_pMeta)
+{
+	//. bits 0-15 meta, 16-23 precision mode, 24-39 validation profile + 1.
+	return (uint64_t)(mi_meta_index(p_pMeta) & 0xFFFF) | ((uint64_t)(mi_precision_mode() & 0xFF) << 16)
+		| ((uint64_t)((mi_validation_profile() + 1) & 0xFFFF) << 24);
+}
+
+ResultKey ResultCache::make_key(const void* p_pData, size_t p_nLen, uint64_t p_nVariant)
+{
+	return make_key(p_pData, p_nLen, mi_hash64(p_pData, p_nLen), p_nVariant);
+}
+
+ResultKey ResultCache::make_key(const void* p_pData, size_t p_nLen, uint64_t p_nHash, uint64_t p_nVariant)
+{
+	ResultKey key;
+	key.hash = p_nHash;
+	key.size = p_nLen;
+	key.variant = p_nVariant;
+	mi_digest256(p_pData, p_nLen, key.digest);
+	return key;
+}
+
+bool ResultCache::find(const ResultKey& p_key, CPipelineResult_t* p_pResult)
+{
+	if (m_map.find(p_key, *p_pResult)) {
+		m_nHits.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+	m_nMisses.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void ResultCache::insert(const ResultKey& p_key, const CPipelineResult_t& p_result)
+{
+	m_map.insert(p_key, p_result, m_ttl);
+}
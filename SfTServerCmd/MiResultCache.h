@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string.h>
+#include "FaceSdkApi.h"
+#include "MiHash.h"
+#include "MiShardedMap.h"
+
+//. Key of one cached verdict : content hash of the decoded upload, its size and
+//. everything else that changes the result (mi_result_variant).
+//. The XXH64 only places the key; equal keys need the SHA-256 of the upload to match too, so a
+//. crafted XXH64 collision with a genuine upload does not get its verdict.
+struct ResultKey {
+	uint64_t	hash;
+	uint64_t	size;
+	uint64_t	variant;
+	uint8_t		digest[MI_DIGEST_SIZE];
+	bool operator==(const ResultKey& o) const
+	{
+		return hash == o.hash && size == o.size && variant == o.variant && memcmp(digest, o.digest, MI_DIGEST_SIZE) == 0;
+	}
+};
+
+struct ResultKeyHash {
+	size_t operator()(const ResultKey& k) const { return (size_t)(k.hash ^ (k.variant * 0x9E3779B97F4A7C15ULL)); }
+};
+
+//. Bounded cache of successful liveness results so client retries of the same image
+//. skip the pipeline, on ShardedMap (MiShardedMap.h) : a lock per shard, entries expire
+//. after the TTL and CLOCK eviction makes room when the memory cap is reached.
+class ResultCache {
+public:
+	ResultCache(size_t p_nMaxBytes, unsigned int p_nTtlSec, int p_nShards);
+
+	bool find(const ResultKey& p_key, CPipelineResult_t* p_pResult);
+	void insert(const ResultKey& p_key, const CPipelineResult_t& p_result);
+	void clear() { m_map.clear(); }
+	//. drops the expired entries, returns how many.
+	size_t compact() { return m_map.purge_expired(); }
+
+	static ResultKey make_key(const void* p_pData, size_t p_nLen, uint64_t p_nVariant = 0);
+	//. the key of an upload whose mi_hash64 p_nHash was taken while it was read (MiHash.h).
+	static ResultKey make_key(const void* p_pData, size_t p_nLen, uint64_t p_nHash, uint64_t p_nVariant);
+
+	uint64_t hits() const { return m_nHits.load(std::memory_order_relaxed); }
+	uint64_t misses() const { return m_nMisses.load(std::memory_order_relaxed); }
+	uint64_t evictions() const { return m_map.evictions(); }
+	size_t entries() const { return m_map.size(); }
+	size_t max_entries() const { return m_map.capacity(); }
+
+private:
+	ShardedMap<ResultKey, CPipelineResult_t, ResultKeyHash>	m_map;
+	std::chrono::seconds				m_ttl;
+
+	std::atomic<uint64_t>				m_nHits;
+	std::atomic<uint64_t>				m_nMisses;
+};
+
+//. ResultKey::variant of the current request : what besides the upload changes its result, the
+//. meta (mi_meta_index), the precision pool that checks it (mi_precision_mode) and its tenant's
+//. validation profile (mi_validation_profile) : a result a profile let through is not served to
+//. tenants whose validations would reject the same image. The model is not in it : the cache is
+//. cleared when the supervisor swaps a generation, and results of the [reload] canary
+//. (RequestContext::canary) or of a check that outlived its generation are not stored.
+uint64_t mi_result_variant(const CMeta_t* p_pMeta);
+
+extern ResultCache* g_pResultCache;
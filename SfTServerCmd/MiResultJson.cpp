@@ -0,0 +1,365 @@
+#include "MiResultJson.h"
+#include "MiAccessLog.h"
+#include "MiAudit.h"
+#include "MiContext.h"
+#include "MiMetrics.h"
+#include "MiConf.h"
+#include "MiVerdict.h"
+#include "Poco/String.h"
+#include <algorithm>
+#include <charconv>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//. shortest round-trip text, as Poco's floatToStr; non-finite values are not JSON.
+void mi_json_put_float(ArenaString& p_out, float p_f)
+{
+	if (!isfinite(p_f)) {
+		p_out.append("null", 4);
+		return;
+	}
+	char buf[32];
+	std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), p_f);
+	p_out.append(buf, (size_t)(r.ptr - buf));
+}
+
+void mi_json_put_int(ArenaString& p_out, int p_n)
+{
+	char buf[16];
+	std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), p_n);
+	p_out.append(buf, (size_t)(r.ptr - buf));
+}
+
+void mi_json_put_string(ArenaString& p_out, const char* p_psz)
+{
+	static const char hex[] = "0123456789abcdef";
+	p_out.push_back('"');
+	for (const unsigned char* p = (const unsigned char*)p_psz; *p != 0; p++) {
+		switch (*p) {
+		case '"':	p_out.append("\\\"", 2); break;
+		case '\\':	p_out.append("\\\\", 2); break;
+		case '\n':	p_out.append("\\n", 2); break;
+		case '\r':	p_out.append("\\r", 2); break;
+		case '\t':	p_out.append("\\t", 2); break;
+		default:
+			if (*p < 0x20) {
+				char esc[6] = { '\\', 'u', '0', '0', hex[*p >> 4], hex[*p & 15] };
+				p_out.append(esc, 6);
+			}
+			else {
+				p_out.push_back((char)*p);
+			}
+		}
+	}
+	p_out.push_back('"');
+}
+
+//. ,"key": with the separator when the object already has a member.
+template <size_t N>
+static void put_key(ArenaString& p_out, const char (&p_key)[N], bool& p_bFirst)
+{
+	if (!p_bFirst) p_out.push_back(',');
+	p_bFirst = false;
+	p_out.push_back('"');
+	p_out.append(p_key, N - 1);
+	p_out.append("\":", 2);
+}
+
+static void put_be16(ArenaString& p_out, uint16_t p_n)
+{
+	char b[2] = { (char)(p_n >> 8), (char)p_n };
+	p_out.append(b, 2);
+}
+
+static void put_be32(ArenaString& p_out, uint32_t p_n)
+{
+	char b[4] = { (char)(p_n >> 24), (char)(p_n >> 16), (char)(p_n >> 8), (char)p_n };
+	p_out.append(b, 4);
+}
+
+//. The writers of one flat map per result, one per ResultEncoding : begin, key / value
+//. pairs, end. The binary maps are opened with a 16-bit pair count patched by end().
+
+class JsonWriter {
+public:
+	explicit JsonWriter(ArenaString& p_out) : m_out(p_out), m_bFirst(true) {}
+	void begin() { m_out.push_back('{'); }
+	template <size_t N>
+	void key(const char (&p_key)[N]) { put_key(m_out, p_key, m_bFirst); }
+	void put_float(float p_f) { mi_json_put_float(m_out, p_f); }
+	void put_int(int p_n) { mi_json_put_int(m_out, p_n); }
+	void put_string(const char* p_psz) { mi_json_put_string(m_out, p_psz); }
+	void put_bool(bool p_b) { p_b ? m_out.append("true", 4) : m_out.append("false", 5); }
+	void end() { m_out.push_back('}'); }
+
+private:
+	ArenaString&	m_out;
+	bool			m_bFirst;
+};
+
+class CborWriter {
+public:
+	explicit CborWriter(ArenaString& p_out) : m_out(p_out), m_nAt(0), m_nPairs(0) {}
+	void begin()
+	{
+		m_nAt = m_out.size();
+		m_out.push_back((char)0xb9);		//. map, 16-bit count
+		put_be16(m_out, 0);
+	}
+	template <size_t N>
+	void key(const char (&p_key)[N])
+	{
+		m_nPairs++;
+		head(3, N - 1);
+		m_out.append(p_key, N - 1);
+	}
+	void put_float(float p_f)
+	{
+		if (!isfinite(p_f)) {
+			m_out.push_back((char)0xf6);	//. null
+			return;
+		}
+		uint32_t n;
+		memcpy(&n, &p_f, 4);
+		m_out.push_back((char)0xfa);
+		put_be32(m_out, n);
+	}
+	void put_int(int p_n) { p_n >= 0 ? head(0, (uint32_t)p_n) : head(1, (uint32_t)(-1 - (int64_t)p_n)); }
+	void put_string(const char* p_psz)
+	{
+		size_t n = strlen(p_psz);
+		head(3, (uint32_t)n);
+		m_out.append(p_psz, n);
+	}
+	void put_bool(bool p_b) { m_out.push_back((char)(p_b ? 0xf5 : 0xf4)); }
+	void end()
+	{
+		m_out[m_nAt + 1] = (char)(m_nPairs >> 8);
+		m_out[m_nAt + 2] = (char)m_nPairs;
+	}
+
+private:
+	//. major type and argument in the shortest form.
+	void head(int p_nMajor, uint32_t p_n)
+	{
+		char m = (char)(p_nMajor << 5);
+		if (p_n < 24) m_out.push_back((char)(m | (char)p_n));
+		else if (p_n < 0x100) {
+			m_out.push_back((char)(m | 24));
+			m_out.push_back((char)p_n);
+		}
+		else if (p_n < 0x10000) {
+			m_out.push_back((char)(m | 25));
+			put_be16(m_out, (uint16_t)p_n);
+		}
+		else {
+			m_out.push_back((char)(m | 26));
+			put_be32(m_out, p_n);
+		}
+	}
+
+	ArenaString&	m_out;
+	size_t			m_nAt;
+	unsigned		m_nPairs;
+};
+
+class MsgpackWriter {
+public:
+	explicit MsgpackWriter(ArenaString& p_out) : m_out(p_out), m_nAt(0), m_nPairs(0) {}
+	void begin()
+	{
+		m_nAt = m_out.size();
+		m_out.push_back((char)0xde);		//. map 16
+		put_be16(m_out, 0);
+	}
+	template <size_t N>
+	void key(const char (&p_key)[N])
+	{
+		m_nPairs++;
+		string(p_key, N - 1);
+	}
+	void put_float(float p_f)
+	{
+		if (!isfinite(p_f)) {
+			m_out.push_back((char)0xc0);	//. nil
+			return;
+		}
+		uint32_t n;
+		memcpy(&n, &p_f, 4);
+		m_out.push_back((char)0xca);
+		put_be32(m_out, n);
+	}
+	void put_int(int p_n)
+	{
+		if (p_n >= -32 && p_n < 128) m_out.push_back((char)p_n);		//. positive / negative fixint
+		else {
+			m_out.push_back((char)0xd2);	//. int 32
+			put_be32(m_out, (uint32_t)p_n);
+		}
+	}
+	void put_string(const char* p_psz) { string(p_psz, strlen(p_psz)); }
+	void put_bool(bool p_b) { m_out.push_back((char)(p_b ? 0xc3 : 0xc2)); }
+	void end()
+	{
+		m_out[m_nAt + 1] = (char)(m_nPairs >> 8);
+		m_out[m_nAt + 2] = (char)m_nPairs;
+	}
+
+private:
+	void string(const char* p_p, size_t p_nLen)
+	{
+		if (p_nLen < 32) m_out.push_back((char)(0xa0 | p_nLen));
+		else if (p_nLen < 0x100) {
+			m_out.push_back((char)0xd9);
+			m_out.push_back((char)p_nLen);
+		}
+		else {
+			m_out.push_back((char)0xda);
+			put_be16(m_out, (uint16_t)std::min(p_nLen, (size_t)0xffff));
+			p_nLen = std::min(p_nLen, (size_t)0xffff);
+		}
+		m_out.append(p_p, p_nLen);
+	}
+
+	ArenaString&	m_out;
+	size_t			m_nAt;
+	unsigned		m_nPairs;
+};
+
+const char* mi_result_verdict(const CPipelineResult_t& p_result, int p_nErr)
+{
+	return mi_verdict_name(mi_verdict_of(mi_verdict_policy(), p_result, p_nErr));
+}
+
+//. keys in std::map order, as Poco::JSON::Object wrote them.
+struct LegacySchema {
+	template <typename Writer>
+	static void write(Writer& p_w, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra)
+	{
+		GateStage stage = mi_gate_stage(p_result, p_nErr);
+		p_w.begin();
+		if (p_extra.error >= 0) { p_w.key("error "); p_w.put_int(p_extra.error); }
+		if (p_extra.frames >= 0) { p_w.key("frames "); p_w.put_int(p_extra.frames); }
+		if (p_extra.index >= 0) { p_w.key("index "); p_w.put_int(p_extra.index); }
+		//. the text does not depend on STATUS, a rejected image reads as its liveness answer.
+		const VerdictPolicy& policy = mi_verdict_policy();
+		p_w.key("liveness result ");
+		if (stage == MI_GATE_QUALITY || p_result.quality_result.score < policy.qualityMin) p_w.put_string("Image has a bad quality");
+		else if (p_result.liveness_result.probability >= policy.genuineMin) p_w.put_string("Image is genuine");
+		else p_w.put_string("Image is spoofed");
+		p_w.key("probability "); p_w.put_float(p_result.liveness_result.probability);
+		p_w.key("quality "); p_w.put_float(p_result.quality_result.score);
+		p_w.key("score "); p_w.put_float(p_result.liveness_result.score);
+		p_w.key("stage "); p_w.put_string(mi_gate_stage_name(stage));
+		p_w.key("state "); p_w.put_string(p_nErr == OK ? "OK" : p_pszMsg);
+		p_w.end();
+	}
+};
+
+struct V2Schema {
+	template <typename Writer>
+	static void write(Writer& p_w, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra)
+	{
+		GateStage stage = mi_gate_stage(p_result, p_nErr);
+		p_w.begin();
+		if (p_extra.index >= 0) { p_w.key("index"); p_w.put_int(p_extra.index); }
+		p_w.key("verdict");
+		p_w.put_string(p_extra.verdict >= 0 ? mi_verdict_name(p_extra.verdict) : mi_result_verdict(p_result, p_nErr));
+		p_w.key("probability"); p_w.put_float(p_result.liveness_result.probability);
+		p_w.key("score"); p_w.put_float(p_result.liveness_result.score);
+		p_w.key("quality"); p_w.put_float(p_result.quality_result.score);
+		p_w.key("stage"); p_w.put_string(mi_gate_stage_name(stage));
+		if (p_extra.frames >= 0) { p_w.key("frames"); p_w.put_int(p_extra.frames); }
+		RequestContext* ctx = mi_context();
+		if (ctx != NULL && ctx->degraded != 0) { p_w.key("degraded"); p_w.put_bool(true); }
+		p_w.key("status"); p_w.put_string(face_sdk_status_name(p_nErr));
+		if (p_nErr != OK) { p_w.key("message"); p_w.put_string(p_pszMsg); }
+		p_w.end();
+	}
+};
+
+template <typename Schema>
+void mi_json_result(ArenaString& p_out, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra)
+{
+	JsonWriter w(p_out);
+	Schema::write(w, p_result, p_nErr, p_pszMsg, p_extra);
+}
+
+template void mi_json_result<LegacySchema>(ArenaString&, const CPipelineResult_t&, int, const char*, const ResultExtra&);
+template void mi_json_result<V2Schema>(ArenaString&, const CPipelineResult_t&, int, const char*, const ResultExtra&);
+
+template <typename Schema>
+static void encode_result(ResultEncoding p_encoding, ArenaString& p_out, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra)
+{
+	if (p_encoding == MI_ENCODING_CBOR) {
+		CborWriter w(p_out);
+		Schema::write(w, p_result, p_nErr, p_pszMsg, p_extra);
+	}
+	else if (p_encoding == MI_ENCODING_MSGPACK) {
+		MsgpackWriter w(p_out);
+		Schema::write(w, p_result, p_nErr, p_pszMsg, p_extra);
+	}
+	else {
+		JsonWriter w(p_out);
+		Schema::write(w, p_result, p_nErr, p_pszMsg, p_extra);
+	}
+}
+
+void mi_result_body(ResultSchema p_schema, ResultEncoding p_encoding, ArenaString& p_out, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg,
+	const ResultExtra& p_extra)
+{
+	Verdict verdict = (Verdict)p_extra.verdict;
+	bool bUncertain = p_extra.uncertain > 0;
+	if (p_extra.verdict < 0) {
+		const VerdictPolicy& policy = mi_verdict_policy();
+		verdict = mi_verdict_of(policy, p_result, p_nErr);
+		bUncertain = mi_verdict_uncertain(policy, p_result, p_nErr);
+	}
+	mi_metrics_verdict(verdict, bUncertain);
+	const char* pszVerdict = mi_verdict_name(verdict);
+	mi_access_log_result(pszVerdict, p_nErr);
+	mi_audit_result(p_result, p_nErr, pszVerdict);
+	if (p_schema == MI_SCHEMA_V2) encode_result<V2Schema>(p_encoding, p_out, p_result, p_nErr, p_pszMsg, p_extra);
+	else encode_result<LegacySchema>(p_encoding, p_out, p_result, p_nErr, p_pszMsg, p_extra);
+}
+
+void mi_json_result(ResultSchema p_schema, ArenaString& p_out, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra)
+{
+	mi_result_body(p_schema, MI_ENCODING_JSON, p_out, p_result, p_nErr, p_pszMsg, p_extra);
+}
+
+ResultEncoding mi_result_encoding(const std::string& p_strAccept)
+{
+	size_t at = 0;
+	while (at < p_strAccept.size()) {
+		size_t end = p_strAccept.find(',', at);
+		if (end == std::string::npos) end = p_strAccept.size();
+		std::string item = Poco::toLower(Poco::trim(p_strAccept.substr(at, end - at)));
+		at = end + 1;
+		size_t semi = item.find(';');
+		std::string type = Poco::trim(item.substr(0, semi));
+		//. "q=0" : not acceptable.
+		if (semi != std::string::npos) {
+			std::string params = item.substr(semi + 1);
+			size_t q = params.find("q=");
+			if (q != std::string::npos && atof(params.c_str() + q + 2) <= 0.0) continue;
+		}
+		if (type == GD_CBOR_TYPE) return MI_ENCODING_CBOR;
+		if (type == GD_MSGPACK_TYPE || type == "application/x-msgpack" || type == "application/vnd.msgpack") return MI_ENCODING_MSGPACK;
+		if (type == "application/json") return MI_ENCODING_JSON;
+	}
+	return MI_ENCODING_JSON;
+}
+
+HeaderBlock mi_result_headers(ResultEncoding p_encoding)
+{
+	return p_encoding == MI_ENCODING_CBOR ? MI_HEADERS_CBOR : p_encoding == MI_ENCODING_MSGPACK ? MI_HEADERS_MSGPACK : MI_HEADERS_JSON;
+}
+
+ResultSchema mi_result_schema(const std::string& p_strName, ResultSchema p_default)
+{
+	if (p_strName == "v2" || p_strName == "2") return MI_SCHEMA_V2;
+	if (p_strName == "legacy" || p_strName == "1") return MI_SCHEMA_LEGACY;
+	return p_default;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include "FaceSdkApi.h"
+#include "MiArena.h"
+#include "MiGate.h"
+#include "MiHeaders.h"
+
+//. Liveness result JSON written straight into an arena string, no Poco::JSON::Object,
+//. no ostringstream : the body is formatted once with std::to_chars and handed to
+//. HTTPServerResponse::sendBuffer, which sets Content-Length itself.
+//. Two schemas, chosen per request (GD_RESPONSE_SCHEMA_HEADER) or by [response] schema :
+//. - legacy : the historical keys with trailing spaces ("score ", "liveness result " ...)
+//.            in the sorted order Poco::JSON::Object produced, byte compatible for clients.
+//. - v2     : {"verdict":"genuine","probability":0.92,"score":0.85,"quality":0.78,
+//.             "stage":"liveness","status":"OK"}; verdict genuine / spoofed / bad_quality,
+//.             "rejected" with the STATUS name in status and "message" when status is not OK;
+//.             "degraded":true when the request skipped optional steps (MiContext.h).
+//. The same schemas are written through one templated writer per body encoding, chosen by
+//. the Accept of the request (mi_result_encoding) : JSON, CBOR (RFC 8949, GD_CBOR_TYPE) or
+//. MessagePack (GD_MSGPACK_TYPE, also application/x-msgpack and application/vnd.msgpack).
+//. A binary result is one map with the JSON keys and values : floats as float32, a
+//. non-finite one as null / nil, integers in their shortest form. Lists of results see
+//. MiResultStream.h. Bodies that wrap results in other JSON (faces, frames, onboarding,
+//. jobs) and the WebSocket frames stay JSON.
+
+enum ResultSchema {
+	MI_SCHEMA_LEGACY = 0,
+	MI_SCHEMA_V2
+};
+
+enum ResultEncoding {
+	MI_ENCODING_JSON = 0,
+	MI_ENCODING_CBOR,
+	MI_ENCODING_MSGPACK
+};
+
+//. optional per-item fields, < 0 = absent.
+struct ResultExtra {
+	int		index;		//. batch position
+	int		error;		//. batch STATUS
+	int		frames;		//. sequence length
+	int		verdict;	//. Verdict already computed for the batch (MiVerdictBatch.h)
+	int		uncertain;	//. with verdict : 1 within the uncertain band
+	ResultExtra() : index(-1), error(-1), frames(-1), verdict(-1), uncertain(-1) {}
+};
+
+struct LegacySchema;
+struct V2Schema;
+
+//. "genuine" / "spoofed" / "bad_quality" / "rejected" (string literals), the v2 verdict.
+const char* mi_result_verdict(const CPipelineResult_t& p_result, int p_nErr);
+
+//. appends one result object to p_out; the schema-independent call also reports the
+//. verdict to the access log (MiAccessLog.h).
+template <typename Schema>
+void mi_json_result(ArenaString& p_out, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra = ResultExtra());
+
+void mi_json_result(ResultSchema p_schema, ArenaString& p_out, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra = ResultExtra());
+
+//. mi_json_result in p_encoding.
+void mi_result_body(ResultSchema p_schema, ResultEncoding p_encoding, ArenaString& p_out, const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg,
+	const ResultExtra& p_extra = ResultExtra());
+
+//. the first encoding of an Accept header value the server writes (q=0 excluded), JSON
+//. when none is listed before application/json or the header is empty.
+ResultEncoding mi_result_encoding(const std::string& p_strAccept);
+
+//. MI_HEADERS_JSON / MI_HEADERS_CBOR / MI_HEADERS_MSGPACK.
+HeaderBlock mi_result_headers(ResultEncoding p_encoding);
+
+//. JSON values for other writers of arena bodies (MiAnalyze.h ...) : floats in the shortest
+//. round-trip text (null when not finite), strings quoted and escaped.
+void mi_json_put_float(ArenaString& p_out, float p_f);
+void mi_json_put_int(ArenaString& p_out, int p_n);
+void mi_json_put_string(ArenaString& p_out, const char* p_psz);
+
+//. "legacy" / "v2" ("1" / "2"), p_default for anything else.
+ResultSchema mi_result_schema(const std::string& p_strName, ResultSchema p_default);
@@ -0,0 +1,70 @@
+#include "MiResultStream.h"
+#include "MiCompress.h"
+#include "MiConf.h"
+#include "MiHeaders.h"
+
+//. CBOR / MessagePack array heads : a 32-bit count patched by finish(), CBOR's open-ended one.
+#define LD_CBOR_ARRAY32			((char)0x9a)
+#define LD_CBOR_ARRAY_OPEN		((char)0x9f)
+#define LD_CBOR_BREAK			((char)0xff)
+#define LD_MSGPACK_ARRAY32		((char)0xdd)
+
+ResultStream::ResultStream(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, ResultSchema p_schema, ResultEncoding p_encoding, bool p_bStream,
+	bool p_bNdjson, size_t p_nReserve)
+	: m_request(p_request), m_response(p_response), m_schema(p_schema), m_encoding(p_encoding), m_bStream(p_bStream), m_bNdjson(p_bNdjson && p_encoding == MI_ENCODING_JSON),
+	m_nCount(0), m_pOut(NULL)
+{
+	m_out.reserve(p_nReserve * GD_RESULT_JSON_RESERVE + 5);
+	m_response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+	if (m_encoding != MI_ENCODING_JSON) {
+		mi_headers_apply(m_response, mi_result_headers(m_encoding));
+		if (m_encoding == MI_ENCODING_CBOR && m_bStream) m_out.push_back(LD_CBOR_ARRAY_OPEN);
+		else if (!m_bStream) {
+			m_out.push_back(m_encoding == MI_ENCODING_CBOR ? LD_CBOR_ARRAY32 : LD_MSGPACK_ARRAY32);
+			m_out.append(4, '\0');
+		}
+	}
+	else if (m_bNdjson) {
+		//. the JSON block carries its own Content-Type.
+		mi_headers_apply(m_response, MI_HEADERS_CORS);
+		m_response.setContentType(GD_NDJSON_TYPE);
+	}
+	else {
+		mi_headers_apply(m_response, MI_HEADERS_JSON);
+		m_out.push_back('[');
+	}
+}
+
+void ResultStream::put(const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra)
+{
+	if (m_encoding == MI_ENCODING_JSON && !m_bNdjson && m_nCount > 0) m_out.push_back(',');
+	mi_result_body(m_schema, m_encoding, m_out, p_result, p_nErr, p_pszMsg, p_extra);
+	if (m_bNdjson) m_out.push_back('\n');
+	m_nCount++;
+}
+
+void ResultStream::flush()
+{
+	if (!m_bStream || m_out.empty()) return;
+	if (m_pOut == NULL) m_pOut = &mi_send_stream(m_request, m_response, m_pDeflater);
+	m_pOut->write(m_out.data(), (std::streamsize)m_out.size());
+	//. through the deflater (sync flush) into the chunked stream, one chunk.
+	m_pOut->flush();
+	m_out.clear();
+}
+
+void ResultStream::finish()
+{
+	if (m_encoding == MI_ENCODING_CBOR && m_bStream) m_out.push_back(LD_CBOR_BREAK);
+	else if (m_encoding != MI_ENCODING_JSON && !m_bStream) {
+		//. the head is still at the front : a buffered body is sent whole.
+		for (int i = 0; i < 4; i++) m_out[1 + i] = (char)(m_nCount >> (24 - 8 * i));
+	}
+	else if (!m_bNdjson && m_encoding == MI_ENCODING_JSON) m_out.push_back(']');
+	if (!m_bStream) {
+		mi_send_body(m_request, m_response, m_out.data(), m_out.size());
+		return;
+	}
+	flush();
+	if (m_pDeflater) m_pDeflater->close();
+}
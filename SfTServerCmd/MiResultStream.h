@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include "FaceSdkApi.h"
+#include "MiArena.h"
+#include "MiResultJson.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+//. Body of a list of results (GD_API_BATCH) : a JSON array, or with NDJSON (Accept:
+//. GD_NDJSON_TYPE) one result object per line. A buffered body is formatted whole and
+//. sent once with Content-Length (mi_send_body). A streamed one goes out with chunked
+//. transfer encoding (mi_send_stream) at every flush, so the results of each step of a
+//. large batch leave as soon as it is checked and only one step is ever held : the first
+//. answers do not wait for the last images, and memory does not grow with the batch.
+//. Compressed streams are sync-flushed with each chunk. Once the first chunk is out the
+//. status is sent, a failure later ends the body short (unterminated array / missing
+//. lines), which clients see as a truncated response.
+//. In CBOR (MiResultJson.h encodings) the list is an array : a counted one when buffered,
+//. an indefinite-length one when streamed. In MessagePack a buffered list is an array, a
+//. streamed one the result maps one after another (MessagePack has no open-ended array),
+//. read like NDJSON. NDJSON applies to JSON only.
+//. The reactor and HTTP/2 front ends collect the response and send it whole
+//. (ReactorServerResponse), streaming only bounds the batch held there.
+
+class ResultStream {
+public:
+	//. sets status 200 and the content type.
+	ResultStream(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, ResultSchema p_schema, ResultEncoding p_encoding, bool p_bStream,
+		bool p_bNdjson, size_t p_nReserve);
+
+	void put(const CPipelineResult_t& p_result, int p_nErr, const char* p_pszMsg, const ResultExtra& p_extra);
+	//. streamed : sends the results put since the last flush, with the head the first time.
+	void flush();
+	//. ends the body; buffered, sends it.
+	void finish();
+
+private:
+	ResultStream(const ResultStream&) = delete;
+	ResultStream& operator=(const ResultStream&) = delete;
+
+	Poco::Net::HTTPServerRequest&					m_request;
+	Poco::Net::HTTPServerResponse&					m_response;
+	ResultSchema									m_schema;
+	ResultEncoding									m_encoding;
+	bool											m_bStream;
+	bool											m_bNdjson;
+	size_t											m_nCount;		//. results put
+	ArenaString										m_out;
+	std::ostream*									m_pOut;			//. once streaming started
+	std::unique_ptr<Poco::DeflatingOutputStream>	m_pDeflater;
+};
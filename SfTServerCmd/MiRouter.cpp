@@ -0,0 +1,83 @@
+#include "MiRouter.h"
+#include "MiHash.h"
+#include <string.h>
+
+Router g_Router;
+
+static const char* lv_szMethods[RM_COUNT] = { "GET", "POST", "PUT", "DELETE", "OPTIONS", "HEAD" };
+
+int Router::method_index(const std::string& p_strMethod)
+{
+	for (int i = 0; i < RM_COUNT; i++) {
+		if (p_strMethod.compare(lv_szMethods[i]) == 0) return i;
+	}
+	return -1;
+}
+
+size_t RoutePathHash::operator()(const RoutePath& p_path) const
+{
+	return (size_t)mi_hash64(p_path.data, p_path.size);
+}
+
+RoutePath Router::path_of(const std::string& p_strUri)
+{
+	size_t len = p_strUri.find_first_of("?#");
+	if (len == std::string::npos) len = p_strUri.size();
+	return RoutePath(p_strUri.data(), len);
+}
+
+void Router::add(const char* p_pszMethod, const std::string& p_strPath, RouteFn p_fn)
+{
+	auto it = m_routes.find(RoutePath(p_strPath));
+	if (it == m_routes.end()) {
+		m_paths.push_back(p_strPath);
+		it = m_routes.emplace(RoutePath(m_paths.back()), Entry()).first;
+		if (p_strPath.size() >= 2 && p_strPath.compare(p_strPath.size() - 2, 2, "/*") == 0) {
+			m_prefixes.push_back(std::make_pair(p_strPath.substr(0, p_strPath.size() - 1), &it->second));
+		}
+	}
+
+	if (strcmp(p_pszMethod, "*") == 0) {
+		for (int i = 0; i < RM_COUNT; i++) it->second.fn[i] = p_fn;
+		return;
+	}
+	int idx = method_index(p_pszMethod);
+	if (idx >= 0) it->second.fn[idx] = p_fn;
+}
+
+const Router::Entry* Router::entry_of(const std::string& p_strUri) const
+{
+	RoutePath path = path_of(p_strUri);
+	auto it = m_routes.find(path);
+	if (it != m_routes.end()) return &it->second;
+
+	for (size_t i = 0; i < m_prefixes.size(); i++) {
+		const std::string& prefix = m_prefixes[i].first;
+		if (path.size > prefix.size() && memcmp(path.data, prefix.data(), prefix.size()) == 0) return m_prefixes[i].second;
+	}
+	return NULL;
+}
+
+RouteFn Router::find(const std::string& p_strMethod, const std::string& p_strUri, bool* p_pbPathKnown) const
+{
+	const Entry* pEntry = entry_of(p_strUri);
+	if (p_pbPathKnown != NULL) *p_pbPathKnown = (pEntry != NULL);
+	if (pEntry == NULL) return NULL;
+
+	int idx = method_index(p_strMethod);
+	return idx >= 0 ? pEntry->fn[idx] : NULL;
+}
+
+std::string Router::allowed(const std::string& p_strUri) const
+{
+	std::string strOut;
+	const Entry* pEntry = entry_of(p_strUri);
+	if (pEntry == NULL) return strOut;
+
+	for (int i = 0; i < RM_COUNT; i++) {
+		if (pEntry->fn[i] == NULL) continue;
+		if (!strOut.empty()) strOut += ", ";
+		strOut += lv_szMethods[i];
+	}
+	return strOut;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <deque>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+class MyRequestHandler;
+
+//. route target : a stateless function handed the per-connection handler object.
+typedef void (*RouteFn)(MyRequestHandler& p_handler, Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response);
+
+enum RouteMethod {
+	RM_GET = 0,
+	RM_POST,
+	RM_PUT,
+	RM_DELETE,
+	RM_OPTIONS,
+	RM_HEAD,
+	RM_COUNT
+};
+
+//. a path inside a string the caller keeps alive (C++14, no std::string_view).
+struct RoutePath {
+	const char*	data;
+	size_t		size;
+	RoutePath(const char* p_pData, size_t p_nSize) : data(p_pData), size(p_nSize) {}
+	explicit RoutePath(const std::string& p_str) : data(p_str.data()), size(p_str.size()) {}
+	bool operator==(const RoutePath& p_other) const { return size == p_other.size && memcmp(data, p_other.data, size) == 0; }
+	std::string str() const { return std::string(data, size); }
+};
+
+struct RoutePathHash {
+	size_t operator()(const RoutePath& p_path) const;
+};
+
+//. method + path -> handler table, filled once at startup and read-only afterwards.
+//. Lookup hashes the path part of the URI in place (the query string is ignored)
+//. and indexes the method, so dispatch costs one hash probe and no allocation.
+//. A path ending in "/*" matches every path below it ("/api/jobs/*" : "/api/jobs/<id>"),
+//. tried in registration order after the exact paths.
+class Router {
+public:
+	//. p_pszMethod "*" registers the handler for every method.
+	void add(const char* p_pszMethod, const std::string& p_strPath, RouteFn p_fn);
+
+	//. NULL when nothing matches; *p_pbPathKnown tells a wrong method (405) from an unknown path (404).
+	RouteFn find(const std::string& p_strMethod, const std::string& p_strUri, bool* p_pbPathKnown = NULL) const;
+
+	//. "GET, POST" style list of the methods registered for p_strUri.
+	std::string allowed(const std::string& p_strUri) const;
+
+	static int method_index(const std::string& p_strMethod);
+	//. URI without query and fragment.
+	static RoutePath path_of(const std::string& p_strUri);
+
+private:
+	struct Entry {
+		RouteFn fn[RM_COUNT];
+		Entry() { for (int i = 0; i < RM_COUNT; i++) fn[i] = NULL; }
+	};
+
+	const Entry* entry_of(const std::string& p_strUri) const;
+
+	std::deque<std::string>							m_paths;	//. stable storage behind the map keys
+	std::unordered_map<RoutePath, Entry, RoutePathHash>	m_routes;
+	std::vector<std::pair<std::string, const Entry*>>	m_prefixes;	//. "/api/jobs/" of "/api/jobs/*" (map nodes do not move)
+};
+
+extern Router g_Router;
@@ -0,0 +1,77 @@
+#include "MiSaturation.h"
+#include "MiAdmission.h"
+#include "MiBrownout.h"
+#include "MiConf.h"
+#include "MiLock.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static bool				lv_bEnable = false;
+static int				lv_nSlots = 1;
+static double			lv_dSloMs = 0;
+static double			lv_dAlpha = 1;
+static MI_MUTEX(lv_mtx, "saturation");
+static MiCondition		lv_cv;
+static bool				lv_bStop = false;
+static std::thread		lv_thread;
+//. under lv_mtx.
+static double			lv_dUtilization = 0;
+static double			lv_dQueueWaitMs = 0;
+static int				lv_nInflight = 0;
+
+static void saturation_loop()
+{
+	MiUniqueLock lock(lv_mtx);
+	while (!lv_bStop) {
+		lv_cv.wait_for(lock, std::chrono::milliseconds(GD_SATURATION_TICK_MS), [] { return lv_bStop; });
+		if (lv_bStop) break;
+		int nInflight = mi_admission_inflight();
+		double dUtilization = (double)std::min(nInflight, lv_nSlots) / lv_nSlots;
+		double dQueueWaitMs = mi_admission_service_us() / 1000.0 * std::max(nInflight - lv_nSlots, 0) / lv_nSlots;
+		lv_dUtilization += lv_dAlpha * (dUtilization - lv_dUtilization);
+		lv_dQueueWaitMs += lv_dAlpha * (dQueueWaitMs - lv_dQueueWaitMs);
+		lv_nInflight = nInflight;
+		mi_brownout_update(lv_dUtilization + lv_dQueueWaitMs / lv_dSloMs);
+	}
+}
+
+void mi_saturation_init(bool p_bEnable, int p_nSlots, int p_nSloMs, int p_nWindowSec)
+{
+	if (!p_bEnable) return;
+	lv_nSlots = std::max(p_nSlots, 1);
+	lv_dSloMs = std::max(p_nSloMs, 1);
+	//. EWMA whose time constant is the window.
+	lv_dAlpha = std::min(1.0, (double)GD_SATURATION_TICK_MS / (std::max(p_nWindowSec, 1) * 1000.0));
+	lv_bStop = false;
+	lv_bEnable = true;
+	lv_thread = std::thread(saturation_loop);
+}
+
+void mi_saturation_shutdown()
+{
+	if (!lv_bEnable) return;
+	{
+		MiLockGuard lock(lv_mtx);
+		lv_bStop = true;
+	}
+	lv_cv.notify_all();
+	if (lv_thread.joinable()) lv_thread.join();
+	lv_bEnable = false;
+}
+
+bool mi_saturation_enabled()
+{
+	return lv_bEnable;
+}
+
+void mi_saturation_get(SaturationSample& p_out)
+{
+	MiLockGuard lock(lv_mtx);
+	p_out.utilization = lv_dUtilization;
+	p_out.queueWaitMs = lv_dQueueWaitMs;
+	p_out.sloMs = lv_dSloMs;
+	p_out.saturation = lv_dUtilization + (lv_dSloMs > 0 ? lv_dQueueWaitMs / lv_dSloMs : 0);
+	p_out.slots = lv_nSlots;
+	p_out.inflight = lv_nInflight;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+//. Saturation signal for autoscalers ([saturation] settings). CPU is a poor one here : the
+//. OpenVINO threads spin while they wait for work, so an idle node can read busy. Instead,
+//. every GD_SATURATION_TICK_MS, from the admitted inference requests in flight (MiAdmission.h)
+//. against the inference slots (admission.concurrency, else the workers) :
+//.   utilization = min(inflight, slots) / slots
+//.   queue wait  = handler time (EWMA) * max(inflight - slots, 0) / slots
+//.   saturation  = utilization + queue wait / slo_ms
+//. each smoothed over window_sec. Below 1 the node has free slots; at 1 every slot is busy
+//. and nothing waits; above 1 requests queue, 2 = they wait a whole SLO. An HPA target of
+//. 0.8 to 1 scales before the queue eats the SLO.
+//. On GD_API_METRICS as mi_saturation, mi_saturation_utilization and
+//. mi_saturation_queue_wait_seconds; GD_API_SATURATION returns the same as a small JSON
+//. object for custom-metrics adapters that poll an HTTP endpoint (KEDA metrics-api ...).
+
+struct SaturationSample {
+	double	saturation;
+	double	utilization;
+	double	queueWaitMs;
+	double	sloMs;
+	int		slots;
+	int		inflight;		//. last sample, not smoothed
+};
+
+void mi_saturation_init(bool p_bEnable, int p_nSlots, int p_nSloMs, int p_nWindowSec);
+void mi_saturation_shutdown();
+bool mi_saturation_enabled();
+
+void mi_saturation_get(SaturationSample& p_out);
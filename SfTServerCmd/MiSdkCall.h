@@ -0,0 +1,173 @@
+#pragma once
+
+#include <stddef.h>
+#include <chrono>
+#include "FaceSdkApi.h"
+#include "MiConf.h"
+#include "MiMetrics.h"
+
+//. Instrumented facade of the FaceSDK calls on the request path. FaceSdk::x has the
+//. signature of face_sdk_api().x and calls it; the Policy decides what happens around it :
+//. - SdkCallsTimed : mi_sdk_call_duration_seconds{call} and mi_sdk_calls_total{call, status}
+//.   on GD_API_METRICS, the status taken from the err out-parameters as STATUS values
+//.   (face_sdk_status, so a license failure counts as LICENSE_ERROR whatever code it came with),
+//.   the inference time of the request with [cost] (MiCost.h), and a span of the call in
+//.   the request's trace (MiTrace.h), named by mi_sdk_call_name.
+//. - SdkCallsPlain : nothing; every wrapper inlines to the bare call through face_sdk_api().
+//. GD_SDK_INSTRUMENT picks the policy at compile time (cmake -DMI_SDK_INSTRUMENT=OFF).
+//. Engine / pipeline creation, destroys and settings calls stay on face_sdk_api().
+//. SdkCallScope times calls that have no FaceSdk wrapper (the facesdk:: C++ API).
+
+enum SdkCall {
+	MI_SDK_IMAGE_CREATE_BYTES = 0,
+	MI_SDK_IMAGE_CREATE_PATH,
+	MI_SDK_IMAGE_CREATE_PIXELS,
+	MI_SDK_CHECK_LIVENESS,
+	MI_SDK_CHECK_LIVENESS_BATCH,			//. one sequence (CImageBatch_t)
+	MI_SDK_CHECK_LIVENESS_BATCH2,			//. independent images
+	MI_SDK_DETECT,
+	MI_SDK_DETECT_BATCH,
+	MI_SDK_DETECT_BOXES,
+	MI_SDK_DETECT_BOXES_BATCH,
+	MI_SDK_CHECK_QUALITY,
+	MI_SDK_CHECK_QUALITY_BATCH,
+	MI_SDK_CPP_CREATE_IMAGE,				//. facesdk:: C++ API, see MiCppBackend.h
+	MI_SDK_CPP_CHECK_LIVENESS,
+	MI_SDK_CPP_CHECK_LIVENESS_BATCH,
+	MI_SDK_CALL_COUNT
+};
+
+//. entry point name of a SdkCall.
+const char* mi_sdk_call_name(int p_nCall);
+
+struct SdkCallsPlain {
+	struct Scope {
+		explicit Scope(SdkCall) {}
+		void done(const int*, char* const*, size_t) {}
+	};
+};
+
+struct SdkCallsTimed {
+	class Scope {
+	public:
+		explicit Scope(SdkCall p_call) : m_call(p_call), m_start(std::chrono::steady_clock::now()) {}
+		void done(const int* p_pErrors, char* const* p_ppszMsgs, size_t p_nCount)
+		{
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			double sec = std::chrono::duration<double>(end - m_start).count();
+			mi_trace_record(mi_sdk_call_name(m_call), m_start, end);
+			mi_metrics_sdk_call(m_call, sec, p_pErrors, p_ppszMsgs, p_nCount);
+			mi_cost_sdk_call(m_call, sec);
+		}
+	private:
+		SdkCall									m_call;
+		std::chrono::steady_clock::time_point	m_start;
+	};
+};
+
+template <class Policy>
+struct FaceSdkCalls {
+	static CImage_t* image_create_bytes(const uint8_t* bytes, size_t size, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_IMAGE_CREATE_BYTES);
+		CImage_t* p = face_sdk_api().image_create_bytes(bytes, size, err, msg);
+		scope.done(err, &msg, 1);
+		return p;
+	}
+
+	static CImage_t* image_create_path(const char* path, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_IMAGE_CREATE_PATH);
+		CImage_t* p = face_sdk_api().image_create_path(path, err, msg);
+		scope.done(err, &msg, 1);
+		return p;
+	}
+
+	static CImage_t* image_create_pixels(const uint8_t* data, size_t rows, size_t cols, COLOR_ENCODING_t format, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_IMAGE_CREATE_PIXELS);
+		CImage_t* p = face_sdk_api().image_create_pixels(data, rows, cols, format, err, msg);
+		scope.done(err, &msg, 1);
+		return p;
+	}
+
+	static CPipelineResult_t pipeline_check_liveness(const CPipeline_t* engine, const CImage_t* image, const CMeta_t* meta, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_CHECK_LIVENESS);
+		CPipelineResult_t r = face_sdk_api().pipeline_check_liveness(engine, image, meta, err, msg);
+		scope.done(err, &msg, 1);
+		return r;
+	}
+
+	static CPipelineResult_t pipeline_check_liveness_batch(const CPipeline_t* engine, const CImageBatch_t* image_batch, const CMeta_t* meta, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_CHECK_LIVENESS_BATCH);
+		CPipelineResult_t r = face_sdk_api().pipeline_check_liveness_batch(engine, image_batch, meta, err, msg);
+		scope.done(err, &msg, 1);
+		return r;
+	}
+
+	static CPipelineResult_t* pipeline_check_liveness_batch2(const CPipeline_t* engine, const CImage_t** images, size_t num_images, const CMeta_t* meta, int* errors, char** msg)
+	{
+		typename Policy::Scope scope(MI_SDK_CHECK_LIVENESS_BATCH2);
+		CPipelineResult_t* p = face_sdk_api().pipeline_check_liveness_batch2(engine, images, num_images, meta, errors, msg);
+		scope.done(errors, msg, num_images);
+		return p;
+	}
+
+	static CDetectionResult_t* detect(const CDetectEngine_t* engine, const CImage_t* image, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_DETECT);
+		CDetectionResult_t* p = face_sdk_api().detect(engine, image, err, msg);
+		scope.done(err, &msg, 1);
+		return p;
+	}
+
+	static CDetectionResult_t* detect_batch(const CDetectEngine_t* engine, const CImage_t** images, size_t num_images, int* errors, char** msg)
+	{
+		typename Policy::Scope scope(MI_SDK_DETECT_BATCH);
+		CDetectionResult_t* p = face_sdk_api().detect_batch(engine, images, num_images, errors, msg);
+		scope.done(errors, msg, num_images);
+		return p;
+	}
+
+	static CBoundingBoxes_t* detect_only_bounding_box(const CDetectEngine_t* engine, const CImage_t* image, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_DETECT_BOXES);
+		CBoundingBoxes_t* p = face_sdk_api().detect_only_bounding_box(engine, image, err, msg);
+		scope.done(err, &msg, 1);
+		return p;
+	}
+
+	static CBoundingBoxes_t* detect_only_bounding_box_batch(const CDetectEngine_t* engine, const CImage_t** images, size_t num_images, int* errors, char** msg)
+	{
+		typename Policy::Scope scope(MI_SDK_DETECT_BOXES_BATCH);
+		CBoundingBoxes_t* p = face_sdk_api().detect_only_bounding_box_batch(engine, images, num_images, errors, msg);
+		scope.done(errors, msg, num_images);
+		return p;
+	}
+
+	static CQualityResult_t check_quality(const CQualityEngine_t* engine, const CImage_t* image, int* err, char* msg)
+	{
+		typename Policy::Scope scope(MI_SDK_CHECK_QUALITY);
+		CQualityResult_t r = face_sdk_api().check_quality(engine, image, err, msg);
+		scope.done(err, &msg, 1);
+		return r;
+	}
+
+	static CQualityResult_t* check_quality_batch(const CQualityEngine_t* engine, const CImage_t** images, size_t num_images, int* errors, char** msg)
+	{
+		typename Policy::Scope scope(MI_SDK_CHECK_QUALITY_BATCH);
+		CQualityResult_t* p = face_sdk_api().check_quality_batch(engine, images, num_images, errors, msg);
+		scope.done(errors, msg, num_images);
+		return p;
+	}
+};
+
+#if GD_SDK_INSTRUMENT
+typedef FaceSdkCalls<SdkCallsTimed> FaceSdk;
+typedef SdkCallsTimed::Scope SdkCallScope;
+#else
+typedef FaceSdkCalls<SdkCallsPlain> FaceSdk;
+typedef SdkCallsPlain::Scope SdkCallScope;
+#endif
@@ -0,0 +1,170 @@
+#include "MiSession.h"
+#include "MiHash.h"
+#include "MiMetrics.h"
+
+SessionStore* g_pSessionStore = NULL;
+
+//. list node + hash node + id, on top of the frames' decoded bytes.
+#define LD_SESSION_COST		(sizeof(Session) + 96)
+
+static const char* lv_szEvents[MI_SESSION_COUNT] = { "frame", "fused", "expired", "evicted", "slid" };
+
+const char* mi_session_event_name(int p_nEvent)
+{
+	return p_nEvent >= 0 && p_nEvent < MI_SESSION_COUNT ? lv_szEvents[p_nEvent] : "unknown";
+}
+
+static void destroy_frames(std::vector<SessionFrame>& p_vFrames)
+{
+	for (size_t i = 0; i < p_vFrames.size(); i++) {
+		if (p_vFrames[i].image != NULL) face_sdk_api().image_destroy(p_vFrames[i].image);
+	}
+	p_vFrames.clear();
+}
+
+SessionStore::SessionStore(size_t p_nMaxBytes, int p_nMaxSessions, unsigned int p_nTtlSec, int p_nMaxFrames, int p_nShards)
+	: m_ttl(p_nTtlSec), m_nBytes(0)
+{
+	if (p_nShards < 1) p_nShards = 1;
+	for (int i = 0; i < p_nShards; i++) m_vShards.emplace_back(new Shard);
+	for (int i = 0; i < MI_SESSION_COUNT; i++) m_nEvents[i] = 0;
+
+	m_nMaxBytesPerShard = p_nMaxBytes / p_nShards;
+	m_nMaxSessionsPerShard = p_nMaxSessions > 0 ? (size_t)(p_nMaxSessions + p_nShards - 1) / p_nShards : 1;
+	m_nMaxFrames = p_nMaxFrames > 0 ? (size_t)p_nMaxFrames : 1;
+}
+
+SessionStore::~SessionStore()
+{
+	for (auto& p : m_vShards) {
+		MiLockGuard lock(p->mtx);
+		for (auto& s : p->lru) destroy_frames(s.frames);
+		p->lru.clear();
+		p->map.clear();
+	}
+}
+
+SessionStore::Shard& SessionStore::shard_of(const std::string& p_strId)
+{
+	return *m_vShards[mi_hash64(p_strId.data(), p_strId.size()) % m_vShards.size()];
+}
+
+void SessionStore::count(SessionEvent p_event, uint64_t p_nCount)
+{
+	m_nEvents[p_event].fetch_add(p_nCount, std::memory_order_relaxed);
+	for (uint64_t i = 0; i < p_nCount; i++) mi_metrics_session(p_event);
+}
+
+void SessionStore::drop_back(Shard& p_shard, std::vector<SessionFrame>& p_vDrop)
+{
+	Session& s = p_shard.lru.back();
+	p_shard.bytes -= s.bytes;
+	m_nBytes.fetch_sub((int64_t)s.bytes, std::memory_order_relaxed);
+	p_vDrop.insert(p_vDrop.end(), s.frames.begin(), s.frames.end());
+	p_shard.map.erase(s.id);
+	p_shard.lru.pop_back();
+}
+
+size_t SessionStore::add(const std::string& p_strId, const SessionFrame& p_frame)
+{
+	Shard& sh = shard_of(p_strId);
+	auto now = std::chrono::steady_clock::now();
+	std::vector<SessionFrame> vDrop;		//. destroyed after the lock is released
+	size_t nFrames = 0;
+	uint64_t nExpired = 0, nEvicted = 0, nSlid = 0;
+	{
+		MiLockGuard lock(sh.mtx);
+		Session* pSession = NULL;
+		auto it = sh.map.find(p_strId);
+		if (it != sh.map.end()) {
+			sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+			pSession = &*it->second;
+		}
+
+		//. the least recently fed sessions sit at the back, the expired ones among them.
+		while (!sh.lru.empty() && &sh.lru.back() != pSession && sh.lru.back().expire <= now) {
+			drop_back(sh, vDrop);
+			nExpired++;
+		}
+		if (pSession != NULL && pSession->expire <= now) {
+			//. expired but fed again : a fresh capture under the same id.
+			vDrop.insert(vDrop.end(), pSession->frames.begin(), pSession->frames.end());
+			sh.bytes -= pSession->bytes;
+			m_nBytes.fetch_sub((int64_t)pSession->bytes, std::memory_order_relaxed);
+			pSession->frames.clear();
+			pSession->bytes = LD_SESSION_COST;
+			sh.bytes += LD_SESSION_COST;
+			m_nBytes.fetch_add((int64_t)LD_SESSION_COST, std::memory_order_relaxed);
+			nExpired++;
+		}
+		if (pSession == NULL) {
+			Session s;
+			s.id = p_strId;
+			s.bytes = LD_SESSION_COST;
+			sh.lru.push_front(s);
+			sh.map[p_strId] = sh.lru.begin();
+			pSession = &sh.lru.front();
+			sh.bytes += LD_SESSION_COST;
+			m_nBytes.fetch_add((int64_t)LD_SESSION_COST, std::memory_order_relaxed);
+		}
+
+		pSession->frames.push_back(p_frame);
+		pSession->bytes += p_frame.bytes;
+		pSession->expire = now + m_ttl;
+		sh.bytes += p_frame.bytes;
+		m_nBytes.fetch_add((int64_t)p_frame.bytes, std::memory_order_relaxed);
+		while (pSession->frames.size() > m_nMaxFrames) {
+			SessionFrame& old = pSession->frames.front();
+			pSession->bytes -= old.bytes;
+			sh.bytes -= old.bytes;
+			m_nBytes.fetch_sub((int64_t)old.bytes, std::memory_order_relaxed);
+			vDrop.push_back(old);
+			pSession->frames.erase(pSession->frames.begin());
+			nSlid++;
+		}
+		nFrames = pSession->frames.size();
+
+		//. over the shard's share : the others go first, the session being fed stays.
+		while (sh.lru.size() > 1 && (sh.bytes > m_nMaxBytesPerShard || sh.lru.size() > m_nMaxSessionsPerShard)) {
+			drop_back(sh, vDrop);
+			nEvicted++;
+		}
+	}
+	destroy_frames(vDrop);
+	count(MI_SESSION_FRAME);
+	if (nExpired > 0) count(MI_SESSION_EXPIRED, nExpired);
+	if (nEvicted > 0) count(MI_SESSION_EVICTED, nEvicted);
+	if (nSlid > 0) count(MI_SESSION_SLID, nSlid);
+	return nFrames;
+}
+
+bool SessionStore::take(const std::string& p_strId, std::vector<SessionFrame>& p_vOut)
+{
+	Shard& sh = shard_of(p_strId);
+	bool bExpired = false;
+	{
+		MiLockGuard lock(sh.mtx);
+		auto it = sh.map.find(p_strId);
+		if (it == sh.map.end()) return false;
+		Session& s = *it->second;
+		bExpired = s.expire <= std::chrono::steady_clock::now();
+		if (bExpired) destroy_frames(s.frames);
+		else p_vOut.swap(s.frames);
+		sh.bytes -= s.bytes;
+		m_nBytes.fetch_sub((int64_t)s.bytes, std::memory_order_relaxed);
+		sh.lru.erase(it->second);
+		sh.map.erase(it);
+	}
+	count(bExpired ? MI_SESSION_EXPIRED : MI_SESSION_FUSED);
+	return !bExpired;
+}
+
+size_t SessionStore::sessions() const
+{
+	size_t n = 0;
+	for (auto& p : m_vShards) {
+		MiLockGuard lock(p->mtx);
+		n += p->map.size();
+	}
+	return n;
+}
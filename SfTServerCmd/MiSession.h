@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FaceSdkApi.h"
+#include "MiLock.h"
+
+//. Frames of one multi-frame capture sent in separate requests (GD_API_SESSION, keyed on
+//. GD_SESSION_HEADER) : each frame is decoded as it arrives and its CImage_t held here
+//. until the session has session.frames of them or a request marks the last one; then
+//. all of them are fused in one mi_check_liveness_sequence call.
+//. Sharded like ResultCache, one lock and LRU list per shard. A session expires
+//. session.ttl_sec after its last frame; a shard over its share of session.max_mb or
+//. session.max_sessions drops its least recently fed sessions; a session past
+//. session.max_frames drops its oldest frame. Expired sessions are swept on every add.
+
+struct SessionFrame {
+	CImage_t*	image;
+	uint64_t	timestamp;		//. ms, 0 = none
+	size_t		bytes;			//. decoded size estimate, see MiMemBudget.h
+};
+
+enum SessionEvent {
+	MI_SESSION_FRAME = 0,		//. frame stored
+	MI_SESSION_FUSED,			//. session checked and closed
+	MI_SESSION_EXPIRED,			//. dropped after ttl_sec without a frame
+	MI_SESSION_EVICTED,			//. dropped for max_mb / max_sessions
+	MI_SESSION_SLID,			//. oldest frame dropped past max_frames
+	MI_SESSION_COUNT
+};
+
+//. metric label of a SessionEvent.
+const char* mi_session_event_name(int p_nEvent);
+
+class SessionStore {
+public:
+	SessionStore(size_t p_nMaxBytes, int p_nMaxSessions, unsigned int p_nTtlSec, int p_nMaxFrames, int p_nShards);
+	~SessionStore();
+
+	//. stores p_frame (the store owns its image from now on); the frames held for the
+	//. session afterwards.
+	size_t add(const std::string& p_strId, const SessionFrame& p_frame);
+	//. removes the session, its frames oldest first go to p_vOut (the caller destroys them).
+	bool take(const std::string& p_strId, std::vector<SessionFrame>& p_vOut);
+
+	size_t sessions() const;
+	size_t bytes() const { return (size_t)m_nBytes.load(std::memory_order_relaxed); }
+	uint64_t events(SessionEvent p_event) const { return m_nEvents[p_event].load(std::memory_order_relaxed); }
+
+private:
+	struct Session {
+		std::string								id;
+		std::vector<SessionFrame>				frames;
+		size_t									bytes;
+		std::chrono::steady_clock::time_point	expire;
+	};
+	typedef std::list<Session> SessionList;
+
+	struct Shard {
+		MI_MUTEX(mtx, "session");
+		SessionList											lru;	//. front = most recently fed
+		std::unordered_map<std::string, SessionList::iterator>	map;
+		size_t												bytes;
+		Shard() : bytes(0) {}
+	};
+
+	Shard& shard_of(const std::string& p_strId);
+	//. unlinks the back session of p_shard (lock held), its frames go to p_vDrop.
+	void drop_back(Shard& p_shard, std::vector<SessionFrame>& p_vDrop);
+	void count(SessionEvent p_event, uint64_t p_nCount = 1);
+
+	std::vector<std::unique_ptr<Shard>>	m_vShards;
+	size_t								m_nMaxBytesPerShard;
+	size_t								m_nMaxSessionsPerShard;
+	size_t								m_nMaxFrames;
+	std::chrono::seconds				m_ttl;
+	std::atomic<int64_t>				m_nBytes;
+	std::atomic<uint64_t>				m_nEvents[MI_SESSION_COUNT];
+};
+
+extern SessionStore* g_pSessionStore;
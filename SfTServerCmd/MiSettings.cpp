@@ -0,0 +1,583 @@
+#include "MiSettings.h"
+#include "MiConf.h"
+#include "MiBuckets.h"
+#include "FaceSdkApi.h"
+#include "MiModelCache.h"
+#include "MiWait.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/Environment.h"
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/Util/IniFileConfiguration.h"
+#include "Poco/Util/JSONConfiguration.h"
+#include <iostream>
+
+using Poco::AutoPtr;
+using Poco::Util::AbstractConfiguration;
+
+MiSettings g_Settings;
+
+static std::string env_name(const std::string& p_strKey)
+{
+	std::string name = "MI_" + Poco::toUpper(p_strKey);
+	Poco::replaceInPlace(name, ".", "_");
+	return name;
+}
+
+static std::string get_string(AbstractConfiguration* p_pCfg, const std::string& p_strKey, const std::string& p_strDef)
+{
+	std::string env = env_name(p_strKey);
+	if (Poco::Environment::has(env)) return Poco::Environment::get(env);
+	if (p_pCfg != NULL) return p_pCfg->getString(p_strKey, p_strDef);
+	return p_strDef;
+}
+
+static int get_int(AbstractConfiguration* p_pCfg, const std::string& p_strKey, int p_nDef)
+{
+	int n = p_nDef;
+	std::string s = get_string(p_pCfg, p_strKey, "");
+	if (!s.empty() && !Poco::NumberParser::tryParse(s, n)) {
+		std::cout << "Config : invalid integer for " << p_strKey << " : " << s << std::endl;
+		n = p_nDef;
+	}
+	return n;
+}
+
+static double get_double(AbstractConfiguration* p_pCfg, const std::string& p_strKey, double p_dDef)
+{
+	double d = p_dDef;
+	std::string s = get_string(p_pCfg, p_strKey, "");
+	if (!s.empty() && !Poco::NumberParser::tryParseFloat(s, d)) {
+		std::cout << "Config : invalid number for " << p_strKey << " : " << s << std::endl;
+		d = p_dDef;
+	}
+	return d;
+}
+
+static bool get_bool(AbstractConfiguration* p_pCfg, const std::string& p_strKey, bool p_bDef)
+{
+	bool b = p_bDef;
+	std::string s = get_string(p_pCfg, p_strKey, "");
+	if (!s.empty() && !Poco::NumberParser::tryParseBool(s, b)) {
+		std::cout << "Config : invalid boolean for " << p_strKey << " : " << s << std::endl;
+		b = p_bDef;
+	}
+	return b;
+}
+
+void mi_settings_load(const std::string& p_strPath)
+{
+	std::string strErr;
+	mi_settings_read(p_strPath, g_Settings, strErr);
+}
+
+bool mi_settings_read(const std::string& p_strPath, MiSettings& p_out, std::string& p_strErr)
+{
+	bool bOk = true;
+	std::string path = p_strPath;
+	if (path.empty() && Poco::Environment::has("MI_CONFIG")) path = Poco::Environment::get("MI_CONFIG");
+	if (path.empty() && Poco::File(GD_CONFIG_FILE_INI).exists()) path = GD_CONFIG_FILE_INI;
+	if (path.empty() && Poco::File(GD_CONFIG_FILE_JSON).exists()) path = GD_CONFIG_FILE_JSON;
+
+	AutoPtr<AbstractConfiguration> cfg;
+	try {
+		if (!path.empty()) {
+			if (Poco::icompare(path.substr(path.find_last_of('.') + 1), "json") == 0) {
+				cfg = new Poco::Util::JSONConfiguration(path);
+			}
+			else {
+				cfg = new Poco::Util::IniFileConfiguration(path);
+			}
+		}
+	}
+	catch (const Poco::Exception& ex) {
+		std::cout << "Config : cannot read " << path << " : " << ex.displayText() << std::endl;
+		p_strErr = path + " : " + ex.displayText();
+		bOk = false;
+		cfg = NULL;
+		path.clear();
+	}
+	AbstractConfiguration* p = cfg.get();
+
+	MiSettings& s = p_out;
+	s.source = path;
+
+	s.port = get_int(p, "server.port", GD_PORT_IN);
+	s.maxThreads = get_int(p, "server.max_threads", 16);
+	s.maxQueued = get_int(p, "server.max_queued", 100);
+	s.keepAlive = get_bool(p, "server.keep_alive", true);
+	s.maxKeepAliveRequests = get_int(p, "server.max_keep_alive_requests", 0);
+	s.keepAliveTimeoutSec = get_int(p, "server.keep_alive_timeout_sec", 10);
+	s.timeoutSec = get_int(p, "server.timeout_sec", 60);
+	s.threadIdleSec = get_int(p, "server.thread_idle_sec", 10);
+	s.tcpNoDelay = get_bool(p, "server.tcp_nodelay", GD_SERVER_TCP_NODELAY != 0);
+	s.sendBufferKb = get_int(p, "server.send_buffer_kb", 0);
+	s.recvBufferKb = get_int(p, "server.recv_buffer_kb", 0);
+	s.listenBacklog = get_int(p, "server.listen_backlog", GD_SERVER_LISTEN_BACKLOG);
+	s.reusePort = get_bool(p, "server.reuse_port", GD_SERVER_REUSE_PORT != 0);
+	s.listeners = get_int(p, "server.listeners", GD_SERVER_LISTENERS);
+	s.localSocket = get_string(p, "server.local_socket", "");
+	s.serverMode = Poco::toLower(get_string(p, "server.mode", GD_SERVER_MODE));
+	s.ioThreads = get_int(p, "server.io_threads", GD_SERVER_IO_THREADS);
+	s.inferenceWorkers = get_int(p, "server.inference_workers", GD_SERVER_WORKERS);
+	s.inferenceQueue = get_int(p, "server.inference_queue", GD_SERVER_QUEUE);
+	s.ingestHighMb = get_int(p, "server.ingest_high_mb", GD_SERVER_INGEST_HIGH_MB);
+	s.ingestLowMb = get_int(p, "server.ingest_low_mb", GD_SERVER_INGEST_LOW_MB);
+	s.ingestHighQueued = get_int(p, "server.ingest_high_queued", 0);
+	s.maxBodyMb = get_int(p, "server.max_body_mb", GD_SERVER_MAX_BODY_MB);
+	s.cancelOnDisconnect = get_bool(p, "server.cancel_on_disconnect", false);
+	s.maxImageSide = get_int(p, "server.max_image_side", GD_SERVER_MAX_IMAGE_SIDE);
+	s.maxImageMpix = get_int(p, "server.max_image_mpix", GD_SERVER_MAX_IMAGE_MPIX);
+	s.minImageSide = get_int(p, "server.min_image_side", GD_SERVER_MIN_IMAGE_SIDE);
+	s.drainSec = get_int(p, "server.drain_sec", GD_SERVER_DRAIN_SEC);
+
+	s.numThreadsPipeline = get_int(p, "sdk.num_threads_pipeline", -1);
+	s.numThreadsEngine = get_int(p, "sdk.num_threads_engine", -1);
+	s.numThreadsOperator = get_int(p, "sdk.num_threads_operator", -1);
+	s.ovNumThroughputStreams = get_int(p, "sdk.ov_num_throughput_streams", -2);
+	s.ovBindThreads = get_int(p, "sdk.ov_bind_threads", -1);
+	s.ovMaxBatchSize = get_int(p, "sdk.ov_max_batch_size", -1);
+	s.numPipelineExecutionStreams = get_int(p, "sdk.num_pipeline_execution_streams", -1);
+	s.enableLogging = get_int(p, "sdk.enable_logging", -1);
+	s.ovCacheDir = get_string(p, "sdk.ov_cache_dir", "");
+	s.modelMmap = get_bool(p, "sdk.mmap_models", GD_MODEL_MMAP);
+	s.waitPolicy = Poco::toLower(get_string(p, "sdk.wait_policy", GD_WAIT_POLICY));
+	s.tbbMaxThreads = get_int(p, "sdk.tbb_max_threads", GD_WAIT_TBB_MAX_THREADS);
+	s.configDir = get_string(p, "sdk.config_dir", GD_SDK_CONFIG_DIR);
+	s.configName = get_string(p, "sdk.config_name", GD_SDK_CONFIG_NAME);
+	s.pipelineName = get_string(p, "sdk.pipeline_name", GD_SDK_PIPELINE_NAME);
+
+	s.batchEnable = get_bool(p, "batch.enable", GD_BATCH_ENABLE != 0);
+	s.batchMaxSize = get_int(p, "batch.max_size", GD_BATCH_MAX_SIZE);
+	s.batchMaxWaitMs = get_int(p, "batch.max_wait_ms", GD_BATCH_MAX_WAIT_MS);
+	s.batchWorkers = get_int(p, "batch.workers", GD_BATCH_WORKERS);
+	s.batchAdaptive = get_bool(p, "batch.adaptive", GD_BATCH_ADAPTIVE != 0);
+	s.batchP99Ms = get_int(p, "batch.p99_ms", GD_BATCH_P99_MS);
+	s.batchAdaptMs = get_int(p, "batch.adapt_ms", GD_BATCH_ADAPT_MS);
+	s.batchBuckets = get_string(p, "batch.buckets", GD_BATCH_BUCKETS);
+	s.batchOrder = Poco::toLower(get_string(p, "batch.order", GD_BATCH_ORDER));
+	s.batchStarveMs = get_int(p, "batch.starve_ms", GD_BATCH_STARVE_MS);
+	s.batchDedup = get_bool(p, "batch.dedup", GD_BATCH_DEDUP != 0);
+
+	s.poolSize = get_int(p, "pool.size", GD_POOL_SIZE);
+	s.poolEngineThreads = get_int(p, "pool.engine_threads", GD_POOL_ENGINE_THREADS);
+	s.poolCoresPerSlot = get_int(p, "pool.cores_per_slot", GD_POOL_CORES_PER_SLOT);
+	s.poolShared = get_bool(p, "pool.shared", GD_POOL_SHARED != 0);
+	s.poolElastic = get_bool(p, "pool.elastic", GD_POOL_ELASTIC != 0);
+	s.poolMaxSize = get_int(p, "pool.max_size", GD_POOL_MAX_SIZE);
+	s.poolElasticWaitMs = get_int(p, "pool.elastic_wait_ms", GD_POOL_ELASTIC_WAIT_MS);
+	s.poolElasticIdleSec = get_int(p, "pool.elastic_idle_sec", GD_POOL_ELASTIC_IDLE_SEC);
+	s.poolElasticSpares = get_int(p, "pool.elastic_spares", GD_POOL_ELASTIC_SPARES);
+	s.executorEnable = get_bool(p, "executor.enable", GD_EXECUTOR_ENABLE != 0);
+	s.executorThreads = get_int(p, "executor.threads", GD_EXECUTOR_THREADS);
+	s.limiterEnable = get_bool(p, "limiter.enable", GD_LIMITER_ENABLE != 0);
+	s.limiterMin = get_int(p, "limiter.min_limit", GD_LIMITER_MIN);
+	s.limiterMax = get_int(p, "limiter.max_limit", GD_LIMITER_MAX);
+	s.limiterInitial = get_int(p, "limiter.initial_limit", GD_LIMITER_INITIAL);
+	s.limiterWindowMs = get_int(p, "limiter.window_ms", GD_LIMITER_WINDOW_MS);
+	s.stagesEnable = get_bool(p, "stages.enable", GD_STAGES_ENABLE != 0);
+	s.stagesInferThreads = get_int(p, "stages.infer_threads", GD_STAGES_INFER_THREADS);
+	s.stagesInferQueue = get_int(p, "stages.infer_queue", GD_STAGES_INFER_QUEUE);
+	s.stagesSendThreads = get_int(p, "stages.send_threads", GD_STAGES_SEND_THREADS);
+	s.stagesSendQueue = get_int(p, "stages.send_queue", GD_STAGES_SEND_QUEUE);
+
+	s.numaEnable = get_bool(p, "numa.enable", GD_NUMA_ENABLE != 0);
+	s.coresEnable = get_bool(p, "cores.enable", GD_CORES_ENABLE);
+	s.coresIo = get_int(p, "cores.io", GD_CORES_IO);
+
+	s.pixelPoolEnable = get_bool(p, "pixel_pool.enable", GD_PIXEL_POOL_ENABLE != 0);
+	s.pixelPoolMaxMb = get_int(p, "pixel_pool.max_mb", GD_PIXEL_POOL_MAX_MB);
+	s.pixelPoolIdleSec = get_int(p, "pixel_pool.idle_sec", GD_PIXEL_POOL_IDLE_S);
+	s.pixelPoolLargePages = get_bool(p, "pixel_pool.large_pages", GD_PIXEL_POOL_LARGE_PAGES != 0);
+	s.idleEnable = get_bool(p, "idle.enable", GD_IDLE_ENABLE != 0);
+	s.idleAfterSec = get_int(p, "idle.after_sec", GD_IDLE_AFTER_SEC);
+	s.idlePoolKeep = get_int(p, "idle.pool_keep", GD_IDLE_POOL_KEEP);
+
+	s.memoryBudgetMb = get_int(p, "memory.budget_mb", GD_MEMORY_BUDGET_MB);
+
+	s.cacheEnable = get_bool(p, "cache.enable", GD_CACHE_ENABLE != 0);
+	s.cacheTtlSec = get_int(p, "cache.ttl_sec", GD_CACHE_TTL_SEC);
+	s.cacheMaxMb = get_int(p, "cache.max_mb", GD_CACHE_MAX_MB);
+	s.cacheShards = get_int(p, "cache.shards", GD_CACHE_SHARDS);
+	s.cacheCoalesce = get_bool(p, "cache.coalesce", GD_CACHE_COALESCE != 0);
+
+	s.sessionEnable = get_bool(p, "session.enable", GD_SESSION_ENABLE);
+	s.sessionFrames = get_int(p, "session.frames", GD_SESSION_FRAMES);
+	s.sessionMaxFrames = get_int(p, "session.max_frames", GD_SESSION_MAX_FRAMES);
+	s.sessionTtlSec = get_int(p, "session.ttl_sec", GD_SESSION_TTL_SEC);
+	s.sessionMaxMb = get_int(p, "session.max_mb", GD_SESSION_MAX_MB);
+	s.sessionMaxSessions = get_int(p, "session.max_sessions", GD_SESSION_MAX_SESSIONS);
+	s.sessionShards = get_int(p, "session.shards", GD_SESSION_SHARDS);
+
+	s.phashEnable = get_bool(p, "phash.enable", GD_PHASH_ENABLE != 0);
+	s.phashMode = Poco::toLower(get_string(p, "phash.mode", GD_PHASH_MODE));
+	s.phashMaxDistance = get_int(p, "phash.max_distance", GD_PHASH_MAX_DISTANCE);
+	s.phashMaxEntries = get_int(p, "phash.max_entries", GD_PHASH_MAX_ENTRIES);
+	s.phashTtlSec = get_int(p, "phash.ttl_sec", GD_PHASH_TTL_SEC);
+
+	s.streamFusionFrames = get_int(p, "stream.fusion_frames", GD_STREAM_FUSION_FRAMES);
+	s.streamIdleSec = get_int(p, "stream.idle_sec", GD_STREAM_IDLE_SEC);
+
+	s.shmEnable = get_bool(p, "shm.enable", GD_SHM_ENABLE);
+
+	s.jobsEnable = get_bool(p, "jobs.enable", GD_JOBS_ENABLE);
+	s.jobsDir = get_string(p, "jobs.dir", GD_JOBS_DIR);
+	s.jobsMaxQueued = get_int(p, "jobs.max_queued", GD_JOBS_MAX_QUEUED);
+	s.jobsBatchSize = get_int(p, "jobs.batch_size", GD_JOBS_BATCH_SIZE);
+	s.jobsRetentionSec = get_int(p, "jobs.retention_sec", GD_JOBS_RETENTION_SEC);
+
+	s.redisEnable = get_bool(p, "redis.enable", GD_REDIS_ENABLE);
+	s.redisHost = get_string(p, "redis.host", GD_REDIS_HOST);
+	s.redisPort = get_int(p, "redis.port", GD_REDIS_PORT);
+	s.redisPool = get_int(p, "redis.pool", GD_REDIS_POOL);
+	s.redisTimeoutMs = get_int(p, "redis.timeout_ms", GD_REDIS_TIMEOUT_MS);
+	s.redisPrefix = get_string(p, "redis.prefix", GD_REDIS_PREFIX);
+	s.redisCache = get_bool(p, "redis.cache", GD_REDIS_CACHE);
+	s.redisJobs = get_bool(p, "redis.jobs", GD_REDIS_JOBS);
+	s.redisClaimMs = get_int(p, "redis.claim_ms", GD_REDIS_CLAIM_MS);
+	s.clusterEnable = get_bool(p, "cluster.enable", GD_CLUSTER_ENABLE);
+	s.clusterTransport = get_string(p, "cluster.transport", GD_CLUSTER_TRANSPORT);
+	s.clusterNode = get_string(p, "cluster.node", GD_CLUSTER_NODE);
+	s.clusterPeers = get_string(p, "cluster.peers", GD_CLUSTER_PEERS);
+	s.clusterIntervalMs = get_int(p, "cluster.interval_ms", GD_CLUSTER_INTERVAL_MS);
+
+	s.binaryEnable = get_bool(p, "binary.enable", GD_BINARY_ENABLE);
+	s.binaryPort = get_int(p, "binary.port", GD_BINARY_PORT);
+	s.binaryWorkers = get_int(p, "binary.workers", GD_BINARY_WORKERS);
+	s.binaryQueue = get_int(p, "binary.queue", GD_BINARY_QUEUE);
+	s.binaryMaxInflight = get_int(p, "binary.max_inflight", GD_BINARY_MAX_INFLIGHT);
+	s.binaryMaxConnections = get_int(p, "binary.max_connections", GD_BINARY_MAX_CONNECTIONS);
+
+	s.http2Enable = get_bool(p, "http2.enable", GD_HTTP2_ENABLE);
+	s.http2Port = get_int(p, "http2.port", GD_HTTP2_PORT);
+	s.http2MaxConnections = get_int(p, "http2.max_connections", GD_HTTP2_MAX_CONNECTIONS);
+	s.http2MaxStreams = get_int(p, "http2.max_streams", GD_HTTP2_MAX_STREAMS);
+	s.http2WindowKb = get_int(p, "http2.window_kb", GD_HTTP2_WINDOW_KB);
+	s.http2Workers = get_int(p, "http2.workers", 0);
+
+	s.tlsEnable = get_bool(p, "tls.enable", GD_TLS_ENABLE);
+	s.tlsPort = get_int(p, "tls.port", GD_TLS_PORT);
+	s.tlsCert = get_string(p, "tls.cert", "");
+	s.tlsKey = get_string(p, "tls.key", "");
+	s.tlsCiphers = get_string(p, "tls.ciphers", "");
+	s.tlsSessionCache = get_int(p, "tls.session_cache", GD_TLS_SESSION_CACHE);
+	s.tlsSessionTimeoutSec = get_int(p, "tls.session_timeout_sec", GD_TLS_SESSION_TIMEOUT_SEC);
+	s.tlsTickets = get_bool(p, "tls.tickets", GD_TLS_TICKETS);
+	s.tlsHandshakeSec = get_int(p, "tls.handshake_sec", GD_TLS_HANDSHAKE_SEC);
+	s.fetchEnable = get_bool(p, "fetch.enable", GD_FETCH_ENABLE);
+	s.fetchHosts = get_string(p, "fetch.hosts", "");
+	s.fetchMaxMb = get_int(p, "fetch.max_mb", GD_FETCH_MAX_MB);
+	s.fetchTimeoutMs = get_int(p, "fetch.timeout_ms", GD_FETCH_TIMEOUT_MS);
+	s.fetchKeepAlive = get_int(p, "fetch.keep_alive", GD_FETCH_KEEP_ALIVE);
+	s.fetchIdleSec = get_int(p, "fetch.idle_sec", GD_FETCH_IDLE_SEC);
+
+	s.compressEnable = get_bool(p, "compress.enable", GD_COMPRESS_ENABLE);
+	s.compressMinBytes = get_int(p, "compress.min_bytes", GD_COMPRESS_MIN_BYTES);
+	s.compressLevel = get_int(p, "compress.level", GD_COMPRESS_LEVEL);
+
+	s.corsAllowOrigin = get_string(p, "cors.allow_origin", GD_CORS_ALLOW_ORIGIN);
+	s.corsAllowHeaders = get_string(p, "cors.allow_headers", GD_CORS_ALLOW_HEADERS);
+	s.corsMaxAgeSec = get_int(p, "cors.max_age_sec", GD_CORS_MAX_AGE_SEC);
+
+	s.responseSchema = Poco::toLower(get_string(p, "response.schema", GD_RESPONSE_SCHEMA));
+	s.responseStreamImages = get_int(p, "response.stream_images", GD_RESPONSE_STREAM_IMAGES);
+	s.responseStreamMax = get_int(p, "response.stream_max_images", GD_RESPONSE_STREAM_MAX);
+
+	s.verdictQualityMin = get_double(p, "verdict.quality_min", GD_VERDICT_QUALITY_MIN);
+	s.verdictGenuineMin = get_double(p, "verdict.genuine_min", GD_VERDICT_GENUINE_MIN);
+	s.verdictUncertainBand = get_double(p, "verdict.uncertain_band", 0);
+	s.verdictDomain = get_string(p, "verdict.domain", "");
+	s.verdictTolerance = get_string(p, "verdict.tolerance", "");
+	s.verdictTenants = get_string(p, "verdict.tenants", "");
+
+	s.validationProfiles = get_string(p, "validation.profiles", "");
+	s.validationTenants = get_string(p, "validation.tenants", "");
+	s.validationPool = get_int(p, "validation.pool", GD_VALIDATION_POOL);
+
+	s.metricsEnable = get_bool(p, "metrics.enable", GD_METRICS_ENABLE != 0);
+	s.metricsStageCpu = get_bool(p, "metrics.stage_cpu", GD_METRICS_STAGE_CPU != 0);
+
+	s.statsEnable = get_bool(p, "stats.enable", GD_STATS_ENABLE != 0);
+	s.statsSlotSec = get_int(p, "stats.slot_sec", GD_STATS_SLOT_SEC);
+	s.statsAllocations = get_bool(p, "stats.allocations", GD_STATS_ALLOCATIONS != 0);
+
+	s.traceSampleEvery = get_int(p, "trace.sample_every", GD_TRACE_SAMPLE_EVERY);
+	s.traceFollowParent = get_bool(p, "trace.follow_parent", GD_TRACE_FOLLOW_PARENT != 0);
+	s.traceOtlpEndpoint = get_string(p, "trace.otlp_endpoint", GD_TRACE_OTLP_ENDPOINT);
+	s.traceOtlpService = get_string(p, "trace.otlp_service", GD_TRACE_OTLP_SERVICE);
+	s.traceOtlpBatch = get_int(p, "trace.otlp_batch", GD_TRACE_OTLP_BATCH);
+	s.traceOtlpIntervalMs = get_int(p, "trace.otlp_interval_ms", GD_TRACE_OTLP_INTERVAL_MS);
+	s.traceOtlpQueue = get_int(p, "trace.otlp_queue", GD_TRACE_OTLP_QUEUE);
+
+	s.profileEnable = get_bool(p, "profile.enable", false);
+	s.profileMaxSeconds = get_int(p, "profile.max_seconds", GD_PROFILE_MAX_SECONDS);
+	s.profileHz = get_int(p, "profile.hz", GD_PROFILE_HZ);
+	s.profileAllowRemote = get_bool(p, "profile.allow_remote", false);
+
+	s.accessLogEnable = get_bool(p, "access_log.enable", GD_ACCESS_LOG_ENABLE != 0);
+	s.accessLogPath = get_string(p, "access_log.path", GD_ACCESS_LOG_PATH);
+	s.accessLogRotation = get_string(p, "access_log.rotation", GD_ACCESS_LOG_ROTATION);
+	s.accessLogPurgeCount = get_int(p, "access_log.purge_count", GD_ACCESS_LOG_PURGE_COUNT);
+	s.accessLogSampleEvery = get_int(p, "access_log.sample_every", GD_ACCESS_LOG_SAMPLE_EVERY);
+	s.accessLogErrors = get_bool(p, "access_log.errors", GD_ACCESS_LOG_ERRORS != 0);
+	s.accessLogSummarySec = get_int(p, "access_log.summary_sec", GD_ACCESS_LOG_SUMMARY_SEC);
+	s.captureEnable = get_bool(p, "capture.enable", GD_CAPTURE_ENABLE != 0);
+	s.capturePath = get_string(p, "capture.path", GD_CAPTURE_PATH);
+	s.captureSampleEvery = get_int(p, "capture.sample_every", GD_CAPTURE_SAMPLE_EVERY);
+	s.captureBody = get_bool(p, "capture.body", GD_CAPTURE_BODY != 0);
+	s.captureMaxBodyKb = get_int(p, "capture.max_body_kb", GD_CAPTURE_MAX_BODY_KB);
+	s.captureMaxMb = get_int(p, "capture.max_mb", GD_CAPTURE_MAX_MB);
+	s.captureQueueMb = get_int(p, "capture.queue_mb", GD_CAPTURE_QUEUE_MB);
+	s.captureRedact = get_string(p, "capture.redact", "");
+	s.costEnable = get_bool(p, "cost.enable", GD_COST_ENABLE != 0);
+	s.costHeader = get_bool(p, "cost.header", GD_COST_HEADER_ENABLE != 0);
+	s.requestProfileEnable = get_bool(p, "request_profile.enable", GD_REQUEST_PROFILE_ENABLE != 0);
+	s.requestProfileAdminKey = get_string(p, "request_profile.admin_key", "");
+
+	s.auditEnable = get_bool(p, "audit.enable", GD_AUDIT_ENABLE != 0);
+	s.auditSink = Poco::toLower(get_string(p, "audit.sink", GD_AUDIT_SINK));
+	s.auditConnect = get_string(p, "audit.connect", GD_AUDIT_CONNECT);
+	s.auditTable = get_string(p, "audit.table", GD_AUDIT_TABLE);
+	s.auditBatchRows = get_int(p, "audit.batch_rows", GD_AUDIT_BATCH_ROWS);
+	s.auditFlushMs = get_int(p, "audit.flush_ms", GD_AUDIT_FLUSH_MS);
+	s.auditQueueRows = get_int(p, "audit.queue_rows", GD_AUDIT_QUEUE_ROWS);
+
+	s.admissionEnable = get_bool(p, "admission.enable", GD_ADMISSION_ENABLE != 0);
+	s.admissionMaxWaitMs = get_int(p, "admission.max_wait_ms", GD_ADMISSION_MAX_WAIT_MS);
+	s.admissionDefaultDeadlineMs = get_int(p, "admission.default_deadline_ms", GD_ADMISSION_DEFAULT_DEADLINE_MS);
+	s.admissionConcurrency = get_int(p, "admission.concurrency", GD_ADMISSION_CONCURRENCY);
+	s.admissionDegradeMs = get_int(p, "admission.degrade_ms", GD_ADMISSION_DEGRADE_MS);
+	s.watchdogEnable = get_bool(p, "watchdog.enable", GD_WATCHDOG_ENABLE != 0);
+	s.watchdogDecodeMs = get_int(p, "watchdog.decode_ms", GD_WATCHDOG_DECODE_MS);
+	s.watchdogQueueMs = get_int(p, "watchdog.queue_ms", GD_WATCHDOG_QUEUE_MS);
+	s.watchdogLivenessMs = get_int(p, "watchdog.liveness_ms", GD_WATCHDOG_LIVENESS_MS);
+	s.watchdogThreads = get_int(p, "watchdog.threads", GD_WATCHDOG_THREADS);
+	s.saturationEnable = get_bool(p, "saturation.enable", GD_SATURATION_ENABLE != 0);
+	s.saturationSloMs = get_int(p, "saturation.slo_ms", GD_SATURATION_SLO_MS);
+	s.saturationWindowSec = get_int(p, "saturation.window_sec", GD_SATURATION_WINDOW_SEC);
+	s.brownoutEnable = get_bool(p, "brownout.enable", GD_BROWNOUT_ENABLE != 0);
+	s.brownoutEnter = get_double(p, "brownout.enter", GD_BROWNOUT_ENTER);
+	s.brownoutExit = get_double(p, "brownout.exit", GD_BROWNOUT_EXIT);
+	s.brownoutHoldSec = get_int(p, "brownout.hold_sec", GD_BROWNOUT_HOLD_SEC);
+	s.brownoutBatchWaitMs = get_int(p, "brownout.batch_wait_ms", GD_BROWNOUT_BATCH_WAIT_MS);
+	s.brownoutAnalyzeEngines = get_int(p, "brownout.analyze_engines", GD_BROWNOUT_ANALYZE_ENGINES);
+
+	s.lanesEnable = get_bool(p, "lanes.enable", GD_LANE_ENABLE != 0);
+	s.laneWeightInteractive = get_int(p, "lanes.weight_interactive", GD_LANE_WEIGHT_INTERACTIVE);
+	s.laneWeightBulk = get_int(p, "lanes.weight_bulk", GD_LANE_WEIGHT_BULK);
+	s.laneBulkKeys = get_string(p, "lanes.bulk_keys", "");
+	s.lanePermits = get_int(p, "lanes.permits", GD_LANE_PERMITS);
+
+	s.tenantsEnable = get_bool(p, "tenants.enable", GD_TENANTS_ENABLE);
+	s.tenantsRequireKey = get_bool(p, "tenants.require_key", GD_TENANTS_REQUIRE_KEY);
+	s.tenantsDefaultRate = get_int(p, "tenants.default_rate", GD_TENANTS_RATE);
+	s.tenantsDefaultBurst = get_int(p, "tenants.default_burst", GD_TENANTS_BURST);
+	s.tenantsDefaultConcurrency = get_int(p, "tenants.default_concurrency", GD_TENANTS_CONCURRENCY);
+	s.tenantsList = get_string(p, "tenants.list", "");
+
+	s.metaDefault = get_string(p, "meta.default", GD_META_DEFAULT);
+	s.metaTenants = get_string(p, "meta.tenants", GD_META_TENANTS);
+
+	s.warmupEnable = get_bool(p, "warmup.enable", GD_WARMUP_ENABLE != 0);
+	s.warmupIterations = get_int(p, "warmup.iterations", GD_WARMUP_ITERATIONS);
+	s.warmupImage = get_string(p, "warmup.image", "");
+	s.warmupBatchSizes = get_string(p, "warmup.batch_sizes", "");
+
+	s.healthSelftestSec = get_int(p, "health.selftest_sec", GD_HEALTH_SELFTEST_SEC);
+	s.healthFailAfter = get_int(p, "health.fail_after", GD_HEALTH_FAIL_AFTER);
+
+	s.backendEngine = Poco::toLower(get_string(p, "backend.engine", GD_BACKEND_ENGINE));
+	s.backendDataDir = get_string(p, "backend.data_dir", "");
+	s.backendPipeline = get_string(p, "backend.pipeline", "");
+	s.backendProfile = Poco::toLower(get_string(p, "backend.profile", GD_BACKEND_PROFILE));
+	s.backendParameters = get_string(p, "backend.parameters", "");
+	s.backendCpuCores = get_int(p, "backend.cpu_cores", 0);
+	s.backendWorkerThreads = get_int(p, "backend.worker_threads", 0);
+	s.backendThreads = get_int(p, "backend.backend_threads", 0);
+	s.backendInvocations = get_int(p, "backend.backend_invocations", 0);
+	s.backendCascadePipeline = get_string(p, "backend.cascade_pipeline", "");
+	s.backendCascadeMargin = get_double(p, "backend.cascade_margin", GD_BACKEND_CASCADE_MARGIN);
+
+	s.precisionEnable = get_bool(p, "precision.enable", GD_PRECISION_ENABLE != 0);
+	s.precisionModes = get_string(p, "precision.modes", "");
+	s.precisionTenants = get_string(p, "precision.tenants", "");
+
+	s.shadowEnable = get_bool(p, "shadow.enable", GD_SHADOW_ENABLE != 0);
+	s.shadowEngine = Poco::toLower(get_string(p, "shadow.engine", GD_SHADOW_ENGINE));
+	s.shadowSamplePercent = get_double(p, "shadow.sample_percent", GD_SHADOW_SAMPLE_PERCENT);
+	s.shadowQueue = get_int(p, "shadow.queue", GD_SHADOW_QUEUE);
+	s.shadowDataDir = get_string(p, "shadow.data_dir", "");
+	s.shadowPipeline = get_string(p, "shadow.pipeline", "");
+	s.shadowProfile = Poco::toLower(get_string(p, "shadow.profile", ""));
+	s.shadowParameters = get_string(p, "shadow.parameters", "");
+	s.shadowCpuCores = get_int(p, "shadow.cpu_cores", 0);
+	s.shadowWorkerThreads = get_int(p, "shadow.worker_threads", 0);
+	s.shadowThreads = get_int(p, "shadow.backend_threads", 0);
+	s.shadowInvocations = get_int(p, "shadow.backend_invocations", 0);
+
+	s.deviceGpu = get_bool(p, "device.gpu", GD_DEVICE_GPU != 0);
+	s.deviceGpuConfig = get_string(p, "device.gpu_config", GD_DEVICE_GPU_CONFIG);
+	s.deviceGpuPipelines = get_int(p, "device.gpu_pipelines", GD_DEVICE_GPU_PIPELINES);
+	s.deviceGpuMinBatch = get_int(p, "device.gpu_min_batch", GD_DEVICE_GPU_MIN_BATCH);
+	s.deviceGpuMaxQueue = get_int(p, "device.gpu_max_queue", GD_DEVICE_GPU_MAX_QUEUE);
+	s.deviceCpuBusy = get_int(p, "device.cpu_busy", GD_DEVICE_CPU_BUSY);
+	s.deviceGpuLazy = get_bool(p, "device.gpu_lazy", GD_DEVICE_GPU_LAZY != 0);
+	s.deviceGpuIdleEvictS = get_int(p, "device.gpu_idle_evict_s", GD_DEVICE_GPU_IDLE_EVICT_S);
+
+	s.cropEnable = get_bool(p, "crop.enable", GD_CROP_ENABLE != 0);
+	s.cropMargin = get_double(p, "crop.margin", GD_CROP_MARGIN);
+	s.cropTargetSize = get_int(p, "crop.target_size", GD_CROP_TARGET_SIZE);
+	s.cropMinImageSide = get_int(p, "crop.min_image_side", GD_CROP_MIN_IMAGE_SIDE);
+	s.cropDetectSide = get_int(p, "crop.detect_side", GD_CROP_DETECT_SIDE);
+	s.cropDetectors = get_int(p, "crop.detectors", GD_CROP_DETECTORS);
+	s.cropDetector = get_string(p, "crop.detector", GD_CROP_DETECTOR);
+
+	s.decodeEnable = get_bool(p, "decode.enable", GD_DECODE_ENABLE != 0);
+	s.decodeTargetSide = get_int(p, "decode.target_side", GD_DECODE_TARGET_SIDE);
+	s.decodeUpright = get_bool(p, "decode.upright", GD_DECODE_UPRIGHT != 0);
+	s.decodeProgressive = get_bool(p, "decode.progressive", GD_DECODE_PROGRESSIVE != 0);
+	s.decodeProgressiveMinKb = get_int(p, "decode.progressive_min_kb", GD_DECODE_PROGRESSIVE_MIN_KB);
+	s.decodeProgressiveThreads = get_int(p, "decode.progressive_threads", GD_DECODE_PROGRESSIVE_THREADS);
+	s.decodeFormats = get_string(p, "decode.formats", GD_DECODE_FORMATS);
+
+	s.gateEnable = get_bool(p, "gate.enable", GD_GATE_ENABLE != 0);
+	s.gateMaxFaces = get_int(p, "gate.max_faces", GD_GATE_MAX_FACES);
+	s.gateMinQuality = get_double(p, "gate.min_quality", GD_GATE_MIN_QUALITY);
+	s.gateEngines = get_int(p, "gate.engines", GD_GATE_ENGINES);
+	s.gateDetector = get_string(p, "gate.detector", GD_GATE_DETECTOR);
+	s.gateQuality = get_string(p, "gate.quality", GD_GATE_QUALITY);
+
+	s.prefilterEnable = get_bool(p, "prefilter.enable", GD_PREFILTER_ENABLE != 0);
+	s.prefilterSide = get_int(p, "prefilter.side", GD_PREFILTER_SIDE);
+	s.prefilterMinSharpness = get_double(p, "prefilter.min_sharpness", GD_PREFILTER_MIN_SHARPNESS);
+	s.prefilterDarkLevel = get_int(p, "prefilter.dark_level", GD_PREFILTER_DARK_LEVEL);
+	s.prefilterDarkPercent = get_double(p, "prefilter.dark_percent", GD_PREFILTER_DARK_PERCENT);
+	s.prefilterAuditPercent = get_double(p, "prefilter.audit_percent", GD_PREFILTER_AUDIT_PERCENT);
+
+	s.analyzeEnable = get_bool(p, "analyze.enable", GD_ANALYZE_ENABLE != 0);
+	s.analyzeEngines = get_int(p, "analyze.engines", GD_ANALYZE_ENGINES);
+	s.analyzeDetector = get_string(p, "analyze.detector", GD_ANALYZE_DETECTOR);
+	s.analyzeOcclusion = get_bool(p, "analyze.occlusion", GD_ANALYZE_OCCLUSION != 0);
+	s.analyzeClosedEyes = get_bool(p, "analyze.closed_eyes", GD_ANALYZE_CLOSED_EYES != 0);
+
+	s.detectEnable = get_bool(p, "detect.enable", GD_DETECT_ENABLE != 0);
+	s.detectEngines = get_int(p, "detect.engines", GD_DETECT_ENGINES);
+	s.detectDetector = get_string(p, "detect.detector", GD_DETECT_DETECTOR);
+	s.detectLazy = get_bool(p, "detect.lazy", GD_DETECT_LAZY != 0);
+	s.detectIdleEvictS = get_int(p, "detect.idle_evict_s", GD_DETECT_IDLE_EVICT_S);
+
+	s.qualityEnable = get_bool(p, "quality.enable", GD_QUALITY_ENABLE != 0);
+	s.qualityEngines = get_int(p, "quality.engines", GD_QUALITY_ENGINES);
+	s.qualityEngine = get_string(p, "quality.engine", GD_QUALITY_ENGINE);
+	s.qualityLazy = get_bool(p, "quality.lazy", GD_QUALITY_LAZY != 0);
+	s.qualityIdleEvictS = get_int(p, "quality.idle_evict_s", GD_QUALITY_IDLE_EVICT_S);
+	s.qualityWorkers = get_int(p, "quality.workers", GD_QUALITY_WORKERS);
+	s.qualityQueue = get_int(p, "quality.queue", GD_QUALITY_QUEUE);
+	s.burstEnable = get_bool(p, "burst.enable", GD_BURST_ENABLE != 0);
+	s.burstTopK = get_int(p, "burst.top_k", GD_BURST_TOP_K);
+	s.burstSizeWeight = get_double(p, "burst.size_weight", GD_BURST_SIZE_WEIGHT);
+	s.burstFaceSize = get_bool(p, "burst.face_size", GD_BURST_FACE_SIZE != 0);
+	s.burstFused = get_bool(p, "burst.fused", GD_BURST_FUSED != 0);
+	s.facesEnable = get_bool(p, "faces.enable", GD_FACES_ENABLE != 0);
+	s.facesMax = get_int(p, "faces.max_faces", GD_FACES_MAX);
+	s.onboardEnable = get_bool(p, "onboard.enable", GD_ONBOARD_ENABLE != 0);
+	s.videoEnable = get_bool(p, "video.enable", GD_VIDEO_ENABLE != 0);
+	s.videoSampling = Poco::toLower(get_string(p, "video.sampling", GD_VIDEO_SAMPLING));
+	s.videoEveryN = get_int(p, "video.every_n", GD_VIDEO_EVERY_N);
+	s.videoIntervalMs = get_int(p, "video.interval_ms", GD_VIDEO_INTERVAL_MS);
+	s.videoMaxFrames = get_int(p, "video.max_frames", GD_VIDEO_MAX_FRAMES);
+	s.videoMaxSeconds = get_int(p, "video.max_seconds", GD_VIDEO_MAX_SECONDS);
+	s.videoHardware = get_bool(p, "video.hardware", GD_VIDEO_HARDWARE != 0);
+
+	s.cameraEnable = get_bool(p, "camera.enable", GD_CAMERA_ENABLE != 0);
+	s.cameraUrls = get_string(p, "camera.urls", GD_CAMERA_URLS);
+	s.cameraWebhook = get_string(p, "camera.webhook", GD_CAMERA_WEBHOOK);
+	s.cameraIntervalMs = get_int(p, "camera.interval_ms", GD_CAMERA_INTERVAL_MS);
+	s.cameraSide = get_int(p, "camera.side", GD_CAMERA_SIDE);
+	s.cameraMinQuality = get_double(p, "camera.min_quality", GD_CAMERA_MIN_QUALITY);
+	s.cameraCooldownMs = get_int(p, "camera.cooldown_ms", GD_CAMERA_COOLDOWN_MS);
+	s.cameraReconnectMs = get_int(p, "camera.reconnect_ms", GD_CAMERA_RECONNECT_MS);
+	s.cameraHardware = get_bool(p, "camera.hardware", GD_CAMERA_HARDWARE != 0);
+
+	s.reloadWatch = get_bool(p, "reload.watch", GD_RELOAD_WATCH != 0);
+	s.reloadWatchDir = get_string(p, "reload.watch_dir", "");
+	s.reloadDebounceMs = get_int(p, "reload.debounce_ms", GD_RELOAD_DEBOUNCE_MS);
+	s.reloadAllowRemote = get_bool(p, "reload.allow_remote", false);
+	s.reloadCanaryPercent = get_int(p, "reload.canary_percent", GD_RELOAD_CANARY_PERCENT);
+
+	s.autotuneEnable = get_bool(p, "autotune.enable", GD_AUTOTUNE_ENABLE != 0);
+	s.autotuneFile = get_string(p, "autotune.file", GD_AUTOTUNE_FILE);
+	s.autotuneDurationMs = get_int(p, "autotune.duration_ms", GD_AUTOTUNE_DURATION_MS);
+	s.autotuneP99Ms = get_int(p, "autotune.p99_ms", GD_AUTOTUNE_P99_MS);
+	s.autotuneEngineThreads = get_string(p, "autotune.engine_threads", GD_AUTOTUNE_ENGINE_THREADS);
+	s.autotuneOvStreams = get_string(p, "autotune.ov_streams", GD_AUTOTUNE_OV_STREAMS);
+	s.autotuneExecutionStreams = get_string(p, "autotune.execution_streams", GD_AUTOTUNE_EXECUTION_STREAMS);
+	s.autotunePoolSizes = get_string(p, "autotune.pool_sizes", GD_AUTOTUNE_POOL_SIZES);
+
+	s.licenseMaxPollSec = get_int(p, "license.max_poll_sec", GD_LICENSE_MAX_POLL_SEC);
+	s.licenseBackoffMinMs = get_int(p, "license.backoff_min_ms", GD_LICENSE_BACKOFF_MIN_MS);
+	s.licenseBackoffMaxMs = get_int(p, "license.backoff_max_ms", GD_LICENSE_BACKOFF_MAX_MS);
+	s.licenseGraceSec = get_int(p, "license.grace_sec", GD_LICENSE_GRACE_SEC);
+
+	//. the batcher sizes OpenVINO for its batches unless told otherwise.
+	//. with buckets no call is larger than the largest of them.
+	if (s.ovMaxBatchSize < 0 && s.batchEnable && s.batchMaxSize > 1) {
+		BatchBuckets buckets;
+		buckets.init(s.batchBuckets, s.batchMaxSize);
+		s.ovMaxBatchSize = buckets.enabled() ? buckets.largest() : s.batchMaxSize;
+	}
+	//. a shared pool runs its slots' calls on the one pipeline's execution streams.
+	if (s.numPipelineExecutionStreams < 0 && s.poolShared && s.poolSize > 1) s.numPipelineExecutionStreams = s.poolSize;
+	//. NUMA placement keeps OpenVINO's threads where it pins them.
+	if (s.ovBindThreads < 0 && s.numaEnable) s.ovBindThreads = 1;
+	//. unpinned threads leave their cores to other work while they sleep.
+	if (s.ovBindThreads < 0 && s.waitPolicy == "passive") s.ovBindThreads = 0;
+	return bOk;
+}
+
+static void export_env(const char* p_pszName, int p_nValue, int p_nUnset)
+{
+	if (p_nValue != p_nUnset) Poco::Environment::set(p_pszName, std::to_string(p_nValue));
+}
+
+void mi_settings_export_sdk_env()
+{
+	const MiSettings& s = g_Settings;
+	export_env("FACESDK_NUM_THREADS_PIPELINE", s.numThreadsPipeline, -1);
+	export_env("FACESDK_NUM_THREADS_ENGINE", s.numThreadsEngine, -1);
+	export_env("FACESDK_NUM_THREADS_OPERATOR", s.numThreadsOperator, -1);
+	export_env("FACESDK_OV_NUM_THROUGHPUT_STREAMS", s.ovNumThroughputStreams, -2);
+	export_env("FACESDK_OV_BIND_THREADS", s.ovBindThreads, -1);
+	export_env("FACESDK_OV_MAX_BATCH_SIZE", s.ovMaxBatchSize, -1);
+	export_env("FACESDK_NUM_PIPELINE_EXECUTION_STREAMS", s.numPipelineExecutionStreams, -1);
+	export_env("FACESDK_ENABLE_LOGGING", s.enableLogging, -1);
+	//. OpenVINO writes the compiled blobs there on the first start and maps them afterwards.
+	mi_model_cache_init(s.ovCacheDir);
+	mi_wait_init(s.waitPolicy, s.tbbMaxThreads);
+}
+
+void mi_settings_apply_sdk()
+{
+	const MiSettings& s = g_Settings;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int err = OK;
+
+	if (s.numThreadsPipeline >= 0) { ThreadingLevel_t l = PIPELINE; face_sdk_api().set_num_threads(s.numThreadsPipeline, &l, &err, msg); }
+	if (s.numThreadsEngine >= 0) { ThreadingLevel_t l = ENGINE; face_sdk_api().set_num_threads(s.numThreadsEngine, &l, &err, msg); }
+	if (s.numThreadsOperator >= 0) { ThreadingLevel_t l = OPERATOR; face_sdk_api().set_num_threads(s.numThreadsOperator, &l, &err, msg); }
+	if (s.ovNumThroughputStreams >= -1) face_sdk_api().set_ov_num_throughput_streams(s.ovNumThroughputStreams);
+	if (s.ovBindThreads >= 0) face_sdk_api().set_ov_bind_threads(s.ovBindThreads != 0);
+	if (s.ovMaxBatchSize >= 0) face_sdk_api().set_ov_max_batch_size(s.ovMaxBatchSize);
+	if (s.numPipelineExecutionStreams >= 0) face_sdk_api().set_num_pipeline_execution_streams(s.numPipelineExecutionStreams);
+	if (s.enableLogging >= 0) face_sdk_api().set_enable_logging(s.enableLogging != 0);
+	//. every buffer handed to the SDK is that size, see MiMsgBuffers.h
+	face_sdk_api().set_message_buffer_size(MESSAGE_BUFFER_SIZE);
+}
+
+bool mi_settings_worker_pool()
+{
+	return g_Settings.serverMode == "reactor" || g_Settings.serverMode == "proactor";
+}
@@ -0,0 +1,529 @@
+#pragma once
+
+#include <string>
+
+//. Runtime settings read at startup from IDLiveFaceCmd.ini / IDLiveFaceCmd.json
+//. (or the file named by MI_CONFIG). Every key can be overridden by an environment
+//. variable MI_<SECTION>_<KEY>, e.g. MI_SERVER_MAX_THREADS=32.
+//. Defaults are the compile-time values from MiConf.h.
+struct MiSettings {
+	//. [server] : Poco HTTPServerParams
+	int				port;
+	int				maxThreads;
+	int				maxQueued;
+	bool			keepAlive;
+	int				maxKeepAliveRequests;
+	int				keepAliveTimeoutSec;
+	int				timeoutSec;
+	int				threadIdleSec;
+	bool			tcpNoDelay;
+	int				sendBufferKb;		//. SO_SNDBUF, 0 = OS default
+	int				recvBufferKb;		//. SO_RCVBUF, 0 = OS default
+	int				listenBacklog;
+	bool			reusePort;			//. SO_REUSEPORT, see MiConnection.h
+	int				listeners;			//. listen sockets (accept threads) on port, 1 .. MI_LISTENERS_MAX
+	std::string		localSocket;		//. Unix domain socket path served next to port, empty = none
+	std::string		serverMode;			//. "classic", "reactor" or "proactor"
+	int				ioThreads;
+	int				inferenceWorkers;
+	int				inferenceQueue;
+	int				ingestHighMb;		//. reactor flow control, see MiReactorServer.h; 0 = off
+	int				ingestLowMb;
+	int				ingestHighQueued;	//. requests waiting for a worker, 0 = off
+	int				maxBodyMb;
+	int				maxImageSide;		//. from the image header, 0 = no limit
+	int				maxImageMpix;
+	int				minImageSide;
+	int				drainSec;			//. graceful shutdown deadline
+	bool			cancelOnDisconnect;	//. drop the work of requests whose client left, see MiContext.h
+
+	//. [sdk] : applied before the FaceSDK dll builds its first pipeline. -1 keeps the SDK default.
+	int				numThreadsPipeline;
+	int				numThreadsEngine;
+	int				numThreadsOperator;
+	int				ovNumThroughputStreams;
+	int				ovBindThreads;
+	int				ovMaxBatchSize;
+	int				numPipelineExecutionStreams;
+	int				enableLogging;
+	std::string		ovCacheDir;			//. OpenVINO compiled-model cache, empty = off
+	bool			modelMmap;			//. model files mapped read-only, see MiModelMap.h
+	std::string		waitPolicy;			//. active / passive, see MiWait.h
+	int				tbbMaxThreads;		//. 0 = TBB default
+	std::string		configDir;
+	std::string		configName;
+	std::string		pipelineName;
+
+	//. [batch] : micro-batcher
+	bool			batchEnable;
+	int				batchMaxSize;
+	int				batchMaxWaitMs;
+	int				batchWorkers;
+	bool			batchAdaptive;		//. see MiBatchWindow.h
+	int				batchP99Ms;
+	int				batchAdaptMs;
+	std::string		batchBuckets;		//. see MiBuckets.h, empty = one call per batch
+	std::string		batchOrder;			//. "fifo" / "edf", see MiBatcher.h
+	int				batchStarveMs;
+	bool			batchDedup;			//. see MiDedup.h
+
+	//. [pool] : pipeline pool
+	int				poolSize;
+	int				poolEngineThreads;
+	int				poolCoresPerSlot;
+	bool			poolShared;			//. see MiPipelinePool.h
+	bool			poolElastic;		//. pool.size to pool.max_size slots with the load
+	int				poolMaxSize;
+	int				poolElasticWaitMs;
+	int				poolElasticIdleSec;
+	int				poolElasticSpares;
+
+	//. [executor] : work-stealing pool of the batch decodes, see MiExecutor.h
+	bool			executorEnable;
+	int				executorThreads;
+
+	//. [limiter] : adaptive limit of the pipeline calls in flight, see MiLimiter.h
+	bool			limiterEnable;
+	int				limiterMin;
+	int				limiterMax;
+	int				limiterInitial;
+	int				limiterWindowMs;
+
+	//. [stages] : stage-pipelined execution, see MiStages.h
+	bool			stagesEnable;
+	int				stagesInferThreads;
+	int				stagesInferQueue;
+	int				stagesSendThreads;
+	int				stagesSendQueue;
+
+	//. [numa] : node placement, see MiNuma.h
+	bool			numaEnable;
+
+	//. [cores] : io / inference core partition, see MiCores.h
+	bool			coresEnable;
+	int				coresIo;
+
+	//. [pixel_pool] : reused pixel buffers, see MiPixelPool.h
+	bool			pixelPoolEnable;
+	int				pixelPoolMaxMb;
+	int				pixelPoolIdleSec;
+	bool			pixelPoolLargePages;
+
+	//. [idle] : trimming after a quiet period, see MiIdle.h
+	bool			idleEnable;
+	int				idleAfterSec;
+	int				idlePoolKeep;
+
+	//. [memory] : decoded image budget, see MiMemBudget.h
+	int				memoryBudgetMb;
+
+	//. [cache] : result cache
+	bool			cacheEnable;
+	int				cacheTtlSec;
+	int				cacheMaxMb;
+	int				cacheShards;
+	bool			cacheCoalesce;		//. see MiCoalesce.h
+
+	//. [session] : multi-frame sessions over several requests, see MiSession.h
+	bool			sessionEnable;
+	int				sessionFrames;
+	int				sessionMaxFrames;
+	int				sessionTtlSec;
+	int				sessionMaxMb;
+	int				sessionMaxSessions;
+	int				sessionShards;
+
+	//. [phash] : near-duplicate index of face crops, see MiPhash.h
+	bool			phashEnable;
+	std::string		phashMode;
+	int				phashMaxDistance;
+	int				phashMaxEntries;
+	int				phashTtlSec;
+
+	//. [stream] : WebSocket camera feeds
+	int				streamFusionFrames;
+	int				streamIdleSec;
+
+	//. [shm] : shared-memory ingestion
+	bool			shmEnable;
+
+	//. [jobs] : asynchronous checks
+	bool			jobsEnable;
+	std::string		jobsDir;
+	int				jobsMaxQueued;
+	int				jobsBatchSize;
+	int				jobsRetentionSec;
+
+	//. [redis] : shared cache / job queue, see MiRedis.h
+	bool			redisEnable;
+	std::string		redisHost;
+	int				redisPort;
+	int				redisPool;
+	int				redisTimeoutMs;
+	std::string		redisPrefix;
+	bool			redisCache;
+	bool			redisJobs;
+	int				redisClaimMs;
+
+	//. [cluster] : capacity announcements for the proxy, see MiCluster.h
+	bool			clusterEnable;
+	std::string		clusterTransport;
+	std::string		clusterNode;
+	std::string		clusterPeers;
+	int				clusterIntervalMs;
+
+	//. [binary] : framed TCP protocol
+	bool			binaryEnable;
+	int				binaryPort;
+	int				binaryWorkers;
+	int				binaryQueue;
+	int				binaryMaxInflight;
+	int				binaryMaxConnections;
+
+	//. [http2] : h2c front end, see MiHttp2Server.h
+	bool			http2Enable;
+	int				http2Port;
+	int				http2MaxConnections;
+	int				http2MaxStreams;		//. SETTINGS_MAX_CONCURRENT_STREAMS per connection
+	int				http2WindowKb;			//. initial stream and connection window
+	int				http2Workers;			//. own pool in classic mode, 0 = server.inference_workers
+
+	//. [tls] : HTTPS listener, see MiTls.h
+	bool			tlsEnable;
+	int				tlsPort;
+	std::string		tlsCert;				//. PEM chain, leaf first
+	std::string		tlsKey;					//. PEM private key
+	std::string		tlsCiphers;				//. TLS 1.2 cipher list, empty = by CPU (AES-NI or ChaCha first)
+	int				tlsSessionCache;		//. server session cache entries, 0 = off
+	int				tlsSessionTimeoutSec;	//. lifetime of a cached session / ticket
+	bool			tlsTickets;
+	int				tlsHandshakeSec;		//. a client must finish the handshake within this
+
+	//. [fetch] : image URLs fetched by the server, see MiFetch.h
+	bool			fetchEnable;
+	std::string		fetchHosts;				//. allow-list, "name" or "*.suffix", comma-separated
+	int				fetchMaxMb;
+	int				fetchTimeoutMs;
+	int				fetchKeepAlive;			//. idle connections kept per host
+	int				fetchIdleSec;
+
+	//. [compress] : gzip / deflate responses
+	bool			compressEnable;
+	int				compressMinBytes;
+	int				compressLevel;
+
+	//. [cors] : fixed response headers, see MiHeaders.h
+	std::string		corsAllowOrigin;
+	std::string		corsAllowHeaders;
+	int				corsMaxAgeSec;
+
+	//. [response] : result JSON
+	std::string		responseSchema;
+	int				responseStreamImages;	//. GD_API_BATCH step, see MiResultStream.h; 0 = one body
+	int				responseStreamMax;		//. images of a streamed GD_API_BATCH
+
+	//. [verdict] : thresholds per tenant, see MiVerdict.h
+	double			verdictQualityMin;
+	double			verdictGenuineMin;
+	double			verdictUncertainBand;
+	std::string		verdictDomain;
+	std::string		verdictTolerance;
+	std::string		verdictTenants;		//. "tenant:genuine_min:quality_min:uncertain_band:domain:tolerance,..."
+
+	//. [validation] : validation profiles per tenant, see MiValidation.h
+	std::string		validationProfiles;	//. "name:suppress=a+b;key=value;...,..."
+	std::string		validationTenants;	//. "tenant:profile,..."
+	int				validationPool;		//. blueprint analyzers over all profiles
+
+	//. [metrics] : Prometheus endpoint
+	bool			metricsEnable;
+	bool			metricsStageCpu;	//. mi_stage_cpu_seconds_total
+
+	//. [stats] : rolling SLO windows on GD_API_STATS
+	bool			statsEnable;
+	int				statsSlotSec;
+	bool			statsAllocations;	//. per-request allocation counts, GD_ALLOC_COUNT builds (MiAlloc.h)
+
+	//. [trace] : sampled request spans
+	int				traceSampleEvery;
+	bool			traceFollowParent;
+	std::string		traceOtlpEndpoint;
+	std::string		traceOtlpService;
+	int				traceOtlpBatch;
+	int				traceOtlpIntervalMs;
+	int				traceOtlpQueue;
+
+	//. [profile] : GD_API_PROFILE, see MiProfile.h
+	bool			profileEnable;
+	int				profileMaxSeconds;
+	int				profileHz;
+	bool			profileAllowRemote;
+
+	//. [access_log] : JSON-lines request log, see MiAccessLog.h
+	bool			accessLogEnable;
+	std::string		accessLogPath;
+	std::string		accessLogRotation;
+	int				accessLogPurgeCount;
+	int				accessLogSampleEvery;
+	bool			accessLogErrors;
+	int				accessLogSummarySec;
+
+	//. [capture] : sampled requests for replay, see MiCapture.h
+	bool			captureEnable;
+	std::string		capturePath;
+	int				captureSampleEvery;
+	bool			captureBody;
+	int				captureMaxBodyKb;
+	int				captureMaxMb;
+	int				captureQueueMb;
+	std::string		captureRedact;		//. more header names, "name, name, ..."
+
+	//. [cost] : per-request cost and per-tenant totals, see MiCost.h
+	bool			costEnable;
+	bool			costHeader;
+
+	//. [request_profile] : per-request debug profile, see MiRequestProfile.h
+	bool			requestProfileEnable;
+	std::string		requestProfileAdminKey;	//. empty = loopback clients only
+
+	//. [audit] : verdict rows in a SQL database or MongoDB, see MiAudit.h
+	bool			auditEnable;
+	std::string		auditSink;			//. odbc | mongodb
+	std::string		auditConnect;
+	std::string		auditTable;
+	int				auditBatchRows;
+	int				auditFlushMs;
+	int				auditQueueRows;
+
+	//. [admission] : load shedding
+	bool			admissionEnable;
+	int				admissionMaxWaitMs;
+	int				admissionDefaultDeadlineMs;
+	int				admissionConcurrency;
+	int				admissionDegradeMs;
+
+	//. [watchdog] : per-stage timeouts, see MiWatchdog.h
+	bool			watchdogEnable;
+	int				watchdogDecodeMs;
+	int				watchdogQueueMs;
+	int				watchdogLivenessMs;
+	int				watchdogThreads;
+
+	//. [saturation] : autoscaling signal, see MiSaturation.h
+	bool			saturationEnable;
+	int				saturationSloMs;
+	int				saturationWindowSec;
+
+	//. [brownout] : cheaper serving while saturated, see MiBrownout.h
+	bool			brownoutEnable;
+	double			brownoutEnter;
+	double			brownoutExit;
+	int				brownoutHoldSec;
+	int				brownoutBatchWaitMs;
+	int				brownoutAnalyzeEngines;
+
+	//. [lanes] : interactive / bulk scheduling
+	bool			lanesEnable;
+	int				laneWeightInteractive;
+	int				laneWeightBulk;
+	std::string		laneBulkKeys;
+	int				lanePermits;
+
+	//. [tenants] : API keys, rate limits, concurrency caps
+	bool			tenantsEnable;
+	bool			tenantsRequireKey;
+	int				tenantsDefaultRate;
+	int				tenantsDefaultBurst;
+	int				tenantsDefaultConcurrency;
+	std::string		tenantsList;		//. "name:key:rate:burst:concurrency,..."
+
+	//. [meta] : calibration per request / tenant
+	std::string		metaDefault;
+	std::string		metaTenants;
+
+	//. [warmup] : dummy inferences before ready
+	bool			warmupEnable;
+	int				warmupIterations;
+	std::string		warmupImage;		//. empty = synthetic frame
+	std::string		warmupBatchSizes;	//. e.g. "1,4,8", empty = derived from [batch]
+
+	//. [health] : GD_API_HEALTH, see MiHealth.h
+	int				healthSelftestSec;		//. 0 = off
+	int				healthFailAfter;
+
+	//. [backend] : inference engine, see MiBackend.h
+	std::string		backendEngine;			//. "legacy" / "blueprint" / "cpp"
+	std::string		backendDataDir;			//. blueprint init data, empty = sdk.config_dir
+	std::string		backendPipeline;		//. blueprint pipeline, empty = its default
+	std::string		backendProfile;			//. "latency" / "throughput", empty = SDK defaults
+	std::string		backendParameters;		//. RuntimeConfiguration::parameters, "k=v,k=v"
+	int				backendCpuCores;		//. CreateRuntimeConfiguration, 0 = all
+	int				backendWorkerThreads;	//. RuntimeConfiguration overrides, 0 = from cpu_cores
+	int				backendThreads;
+	int				backendInvocations;
+	std::string		backendCascadePipeline;	//. first-pass pipeline, empty = off, "auto" = fastest other
+	double			backendCascadeMargin;	//. escalate within this distance of verdict.genuine_min
+
+	//. [precision] : blueprint pools per precision, by tenant, see MiPrecision.h
+	bool			precisionEnable;
+	std::string		precisionModes;
+	std::string		precisionTenants;
+
+	//. [shadow] : sampled checks repeated on a second engine, see MiShadow.h
+	bool			shadowEnable;
+	std::string		shadowEngine;
+	double			shadowSamplePercent;
+	int				shadowQueue;
+	std::string		shadowDataDir;			//. empty / 0 = the [backend] value
+	std::string		shadowPipeline;
+	std::string		shadowProfile;			//. "default" = SDK defaults
+	std::string		shadowParameters;
+	int				shadowCpuCores;
+	int				shadowWorkerThreads;
+	int				shadowThreads;
+	int				shadowInvocations;
+
+	//. [device] : CPU + GPU dispatch, see MiDevice.h
+	bool			deviceGpu;
+	std::string		deviceGpuConfig;
+	int				deviceGpuPipelines;
+	int				deviceGpuMinBatch;
+	int				deviceGpuMaxQueue;
+	int				deviceCpuBusy;
+	bool			deviceGpuLazy;		//. see MiLazyPool.h
+	int				deviceGpuIdleEvictS;
+
+	//. [crop] : face-crop fast path
+	bool			cropEnable;
+	double			cropMargin;
+	int				cropTargetSize;
+	int				cropMinImageSide;
+	int				cropDetectSide;
+	int				cropDetectors;
+	std::string		cropDetector;
+
+	//. [decode] : DCT-scaled JPEG decode
+	bool			decodeEnable;
+	int				decodeTargetSide;
+	bool			decodeUpright;
+	bool			decodeProgressive;			//. reactor mode : decode while the upload arrives, see MiProgressive.h
+	int				decodeProgressiveMinKb;
+	int				decodeProgressiveThreads;
+	std::string		decodeFormats;				//. decoded by the server, see MiCodecs.h
+
+	//. [gate] : early rejection before liveness
+	bool			gateEnable;
+	int				gateMaxFaces;
+	double			gateMinQuality;
+	int				gateEngines;
+	std::string		gateDetector;
+	std::string		gateQuality;
+
+	//. [prefilter] : blur / darkness rejection before the SDK, see MiPrefilter.h
+	bool			prefilterEnable;
+	int				prefilterSide;
+	double			prefilterMinSharpness;
+	int				prefilterDarkLevel;
+	double			prefilterDarkPercent;
+	double			prefilterAuditPercent;
+
+	//. [analyze] : per-face analysis endpoint
+	bool			analyzeEnable;
+	int				analyzeEngines;
+	std::string		analyzeDetector;
+	bool			analyzeOcclusion;
+	bool			analyzeClosedEyes;
+
+	//. [detect] : detection-only batches
+	bool			detectEnable;
+	int				detectEngines;
+	std::string		detectDetector;
+	bool			detectLazy;
+	int				detectIdleEvictS;
+
+	//. [quality] : quality-only batches
+	bool			qualityEnable;
+	int				qualityEngines;
+	std::string		qualityEngine;
+	bool			qualityLazy;
+	int				qualityIdleEvictS;
+	int				qualityWorkers;		//. reactor mode worker pool
+	int				qualityQueue;
+
+	//. [burst] : best-frame selection, see MiBurst.h
+	bool			burstEnable;
+	int				burstTopK;
+	double			burstSizeWeight;
+	bool			burstFaceSize;
+	bool			burstFused;
+
+	//. [faces] : per-face liveness of a group photo, see MiFaces.h
+	bool			facesEnable;
+	int				facesMax;
+
+	//. [onboard] : selfie plus ID portrait, see MiOnboard.h
+	bool			onboardEnable;
+
+	//. [video] : sampled frames of a video upload, see MiVideo.h
+	bool			videoEnable;
+	std::string		videoSampling;		//. keyframes | every_n
+	int				videoEveryN;
+	int				videoIntervalMs;
+	int				videoMaxFrames;
+	int				videoMaxSeconds;
+	bool			videoHardware;
+
+	//. [camera] : pulled camera streams, see MiCamera.h
+	bool			cameraEnable;
+	std::string		cameraUrls;
+	std::string		cameraWebhook;
+	int				cameraIntervalMs;
+	int				cameraSide;
+	double			cameraMinQuality;
+	int				cameraCooldownMs;
+	int				cameraReconnectMs;
+	bool			cameraHardware;
+
+	//. [reload] : new pipeline generation from the SDK data
+	bool			reloadWatch;
+	std::string		reloadWatchDir;		//. empty = sdk.config_dir
+	int				reloadDebounceMs;
+	bool			reloadAllowRemote;	//. GD_API_ADMIN_RELOAD from other hosts than loopback
+	int				reloadCanaryPercent;	//. > 0 : a reload builds a canary generation, see MiSupervisor.h
+
+	//. [autotune] : startup sweep of the threading knobs, see MiAutoTune.h
+	bool			autotuneEnable;
+	std::string		autotuneFile;
+	int				autotuneDurationMs;
+	double			autotuneP99Ms;
+	std::string		autotuneEngineThreads;		//. candidates, "0,2,4"; empty = not tuned
+	std::string		autotuneOvStreams;
+	std::string		autotuneExecutionStreams;
+	std::string		autotunePoolSizes;
+
+	//. [license] : refresher schedule, see MiLicense.h
+	int				licenseMaxPollSec;
+	int				licenseBackoffMinMs;
+	int				licenseBackoffMaxMs;
+	int				licenseGraceSec;		//. 0 = a failed read stops the traffic at once
+
+	std::string		source;		//. file the settings were read from, empty when only defaults
+};
+
+extern MiSettings g_Settings;
+
+//. Loads g_Settings. p_strPath empty means MI_CONFIG, then IDLiveFaceCmd.ini, then IDLiveFaceCmd.json.
+void mi_settings_load(const std::string& p_strPath = "");
+//. reads the settings the same way into p_out (a reload, see MiConfig.h); false with the
+//. reason when the file cannot be parsed, p_out then holds the defaults.
+bool mi_settings_read(const std::string& p_strPath, MiSettings& p_out, std::string& p_strErr);
+
+//. Exports the [sdk] values as FACESDK_* environment variables so they take effect when
+//. setting_init loads the dll. Call before setting_init.
+void mi_settings_export_sdk_env();
+
+//. Applies the [sdk] values through face_sdk_api() setters (after the dll is loaded).
+void mi_settings_apply_sdk();
+
+//. server.mode reactor or proactor : io threads receive whole requests and g_pWorkerPool runs them.
+bool mi_settings_worker_pool();
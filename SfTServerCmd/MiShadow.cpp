@@ -0,0 +1,240 @@
+#include "MiShadow.h"
+#include "MiBrownout.h"
+#include "MiMetrics.h"
+#include "MiMsgBuffers.h"
+#include "MiPlatform.h"
+#include "MiResultJson.h"
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+enum ShadowKind {
+	LD_KIND_ENCODED = 0,
+	LD_KIND_PIXELS,
+	LD_KIND_BATCH
+};
+
+//. one sampled call, with the primary's answer.
+struct ShadowJob {
+	int								kind;
+	std::vector<std::string>		data;			//. one upload, or the batch
+	std::string						pixels;
+	int								width;
+	int								height;
+	COLOR_ENCODING_t				encoding;
+	const CMeta_t*					pMeta;			//. MiMeta.h entry, never freed
+	std::vector<CPipelineResult_t>	results;
+	std::vector<int>				errors;
+	double							primarySec;
+};
+
+static std::atomic<int> lv_nQueued(0);
+
+int mi_shadow_queued()
+{
+	return lv_nQueued.load(std::memory_order_relaxed);
+}
+
+class ShadowBackend : public InferenceBackend {
+public:
+	ShadowBackend(InferenceBackend* p_pPrimary, const ShadowSettings& p_settings)
+		: m_pPrimary(p_pPrimary), m_settings(p_settings), m_nSampleMilli((uint64_t)(p_settings.samplePercent * 1000 + 0.5)),
+		m_nCalls(0), m_bReady(false), m_bStop(false)
+	{
+		m_worker = std::thread(&ShadowBackend::run, this);
+	}
+
+	~ShadowBackend()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bStop = true;
+		}
+		m_cv.notify_all();
+		if (m_worker.joinable()) m_worker.join();
+		lv_nQueued = 0;
+		delete m_pPrimary;
+	}
+
+	const char* name() const override { return m_pPrimary->name(); }
+
+	CPipelineResult_t check(const uint8_t* p_pData, size_t p_nLen, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		bool bSample = sample();
+		auto start = std::chrono::steady_clock::now();
+		CPipelineResult_t result = m_pPrimary->check(p_pData, p_nLen, p_pMeta, p_pErr, p_pszMsg);
+		if (bSample) {
+			std::unique_ptr<ShadowJob> pJob = new_job(LD_KIND_ENCODED, p_pMeta, start);
+			pJob->data.push_back(std::string((const char*)p_pData, p_nLen));
+			pJob->results.push_back(result);
+			pJob->errors.push_back(*p_pErr);
+			offer(std::move(pJob));
+		}
+		return result;
+	}
+
+	CPipelineResult_t check_pixels(const uint8_t* p_pPixels, int p_nWidth, int p_nHeight, COLOR_ENCODING_t p_encoding, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg) override
+	{
+		bool bSample = sample();
+		auto start = std::chrono::steady_clock::now();
+		CPipelineResult_t result = m_pPrimary->check_pixels(p_pPixels, p_nWidth, p_nHeight, p_encoding, p_pMeta, p_pErr, p_pszMsg);
+		if (bSample) {
+			std::unique_ptr<ShadowJob> pJob = new_job(LD_KIND_PIXELS, p_pMeta, start);
+			pJob->pixels.assign((const char*)p_pPixels, (size_t)p_nWidth * (size_t)p_nHeight * 3);
+			pJob->width = p_nWidth;
+			pJob->height = p_nHeight;
+			pJob->encoding = p_encoding;
+			pJob->results.push_back(result);
+			pJob->errors.push_back(*p_pErr);
+			offer(std::move(pJob));
+		}
+		return result;
+	}
+
+	void check_batch(const std::vector<const std::string*>& p_vData, const CMeta_t* p_pMeta, CPipelineResult_t* p_pResults, int* p_pErrors, char** p_ppszMsgs) override
+	{
+		bool bSample = sample();
+		auto start = std::chrono::steady_clock::now();
+		m_pPrimary->check_batch(p_vData, p_pMeta, p_pResults, p_pErrors, p_ppszMsgs);
+		if (bSample) {
+			std::unique_ptr<ShadowJob> pJob = new_job(LD_KIND_BATCH, p_pMeta, start);
+			for (const std::string* pData : p_vData) pJob->data.push_back(*pData);
+			pJob->results.assign(p_pResults, p_pResults + p_vData.size());
+			pJob->errors.assign(p_pErrors, p_pErrors + p_vData.size());
+			offer(std::move(pJob));
+		}
+	}
+
+	void warm_up(int p_nIterations) override { m_pPrimary->warm_up(p_nIterations); }
+	BackendRuntime runtime() const override { return m_pPrimary->runtime(); }
+
+private:
+	//. every call advances the count, a sample is taken each time it crosses another 100 %.
+	bool sample()
+	{
+		if (!m_bReady.load(std::memory_order_relaxed) || mi_brownout_active()) return false;
+		uint64_t n = m_nCalls.fetch_add(1, std::memory_order_relaxed);
+		if ((n + 1) * m_nSampleMilli / 100000 == n * m_nSampleMilli / 100000) return false;
+		if (lv_nQueued.load(std::memory_order_relaxed) >= m_settings.queue) {
+			//. nothing is copied for a sample the queue has no room for.
+			mi_metrics_shadow_dropped();
+			return false;
+		}
+		return true;
+	}
+
+	std::unique_ptr<ShadowJob> new_job(int p_nKind, const CMeta_t* p_pMeta, std::chrono::steady_clock::time_point p_start)
+	{
+		std::unique_ptr<ShadowJob> pJob(new ShadowJob);
+		pJob->kind = p_nKind;
+		pJob->width = pJob->height = 0;
+		pJob->encoding = BGR888;
+		pJob->pMeta = p_pMeta;
+		pJob->primarySec = std::chrono::duration<double>(std::chrono::steady_clock::now() - p_start).count();
+		return pJob;
+	}
+
+	void offer(std::unique_ptr<ShadowJob> p_pJob)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if ((int)m_queue.size() >= m_settings.queue) {
+				mi_metrics_shadow_dropped();
+				return;
+			}
+			m_queue.push_back(std::move(p_pJob));
+			lv_nQueued = (int)m_queue.size();
+		}
+		m_cv.notify_one();
+	}
+
+	void run()
+	{
+		mi_thread_set_background();
+		mi_metrics_mute_stages();
+
+		std::string strErr;
+		std::unique_ptr<InferenceBackend> pShadow(mi_backend_create(m_settings.engine, m_settings.blueprint, strErr));
+		if (!pShadow) {
+			std::cout << "Shadow : " << m_settings.engine << " unavailable : " << strErr << std::endl;
+			return;
+		}
+		pShadow->warm_up(1);
+		std::cout << "Shadow : " << pShadow->name() << ", " << m_settings.samplePercent << " % of the checks" << std::endl;
+		m_bReady = true;
+
+		std::unique_lock<std::mutex> lock(m_mtx);
+		while (true) {
+			m_cv.wait(lock, [this] { return m_bStop || !m_queue.empty(); });
+			if (m_bStop) break;
+			std::unique_ptr<ShadowJob> pJob = std::move(m_queue.front());
+			m_queue.pop_front();
+			lv_nQueued = (int)m_queue.size();
+			lock.unlock();
+			replay(pShadow.get(), *pJob);
+			lock.lock();
+		}
+		m_bReady = false;
+		m_queue.clear();
+	}
+
+	void replay(InferenceBackend* p_pShadow, const ShadowJob& p_job)
+	{
+		size_t n = p_job.results.size();
+		std::vector<CPipelineResult_t> results(n);
+		std::vector<int> errors(n, OK);
+		MsgBuffers msgs(n);
+
+		auto start = std::chrono::steady_clock::now();
+		if (p_job.kind == LD_KIND_ENCODED) {
+			results[0] = p_pShadow->check((const uint8_t*)p_job.data[0].data(), p_job.data[0].size(), p_job.pMeta, &errors[0], msgs[0]);
+		}
+		else if (p_job.kind == LD_KIND_PIXELS) {
+			results[0] = p_pShadow->check_pixels((const uint8_t*)p_job.pixels.data(), p_job.width, p_job.height, p_job.encoding, p_job.pMeta, &errors[0], msgs[0]);
+		}
+		else {
+			std::vector<const std::string*> vData;
+			for (size_t i = 0; i < n; i++) vData.push_back(&p_job.data[i]);
+			p_pShadow->check_batch(vData, p_job.pMeta, results.data(), errors.data(), msgs.data());
+		}
+		double shadowSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		int nAgree = 0;
+		for (size_t i = 0; i < n; i++) {
+			if (strcmp(mi_result_verdict(results[i], errors[i]), mi_result_verdict(p_job.results[i], p_job.errors[i])) == 0) nAgree++;
+		}
+		mi_metrics_shadow(p_job.primarySec, shadowSec, nAgree, (int)n - nAgree);
+	}
+
+	InferenceBackend*						m_pPrimary;
+	ShadowSettings							m_settings;
+	uint64_t								m_nSampleMilli;		//. thousandths of a percent
+	std::atomic<uint64_t>					m_nCalls;
+	std::atomic<bool>						m_bReady;			//. shadow built, sampling on
+	bool									m_bStop;
+	std::mutex								m_mtx;
+	std::condition_variable					m_cv;
+	std::deque<std::unique_ptr<ShadowJob>>	m_queue;
+	std::thread								m_worker;
+};
+
+InferenceBackend* mi_shadow_backend(InferenceBackend* p_pPrimary, const ShadowSettings& p_settings, std::string& p_strErr)
+{
+	if (p_settings.samplePercent <= 0 || p_settings.queue <= 0) {
+		p_strErr = "nothing sampled";
+		return p_pPrimary;
+	}
+	if (p_settings.engine != "blueprint" && strcmp(p_pPrimary->name(), "blueprint") != 0) {
+		p_strErr = "a legacy shadow of a legacy backend shares its pipelines";
+		return p_pPrimary;
+	}
+	ShadowSettings settings = p_settings;
+	if (settings.samplePercent > 100) settings.samplePercent = 100;
+	return new ShadowBackend(p_pPrimary, settings);
+}
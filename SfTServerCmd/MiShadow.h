@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include "MiBackend.h"
+#include "MiBlueprint.h"
+
+//. Shadow traffic ([shadow] settings) : sample_percent of the checks are repeated on a
+//. second engine after the primary answered, to compare a new SDK data set, pipeline or
+//. RuntimeConfiguration under real load before switching to it. The wrapper copies the
+//. sampled upload (or pixels, or batch) with the primary verdict into a queue of at most
+//. queue entries; one worker thread at the lowest OS priority (mi_thread_set_background,
+//. which the blueprint threads it builds inherit on Linux) runs them on the shadow and
+//. records both latencies and whether the verdicts (mi_result_verdict) agree. A full
+//. queue drops the sample, so the primary never waits for the shadow. The response is
+//. always the primary's.
+//. The shadow is blueprint (or legacy behind a blueprint primary); its [shadow] values
+//. left empty / 0 take the [backend] ones. A legacy shadow of a legacy primary would
+//. run on the same pipelines and is refused.
+//. mi_shadow_checks_total{result}, mi_shadow_duration_seconds{pipeline} and
+//. mi_shadow_queued are on GD_API_METRICS.
+
+struct ShadowSettings {
+	std::string			engine;
+	double				samplePercent;
+	int					queue;
+	BlueprintSettings	blueprint;
+	ShadowSettings() : samplePercent(0), queue(0) {}
+};
+
+//. p_pPrimary with sampled checks mirrored to the shadow; takes ownership. p_pPrimary
+//. itself, and p_strErr set, when the shadow cannot be used.
+InferenceBackend* mi_shadow_backend(InferenceBackend* p_pPrimary, const ShadowSettings& p_settings, std::string& p_strErr);
+
+//. samples waiting for the shadow.
+int mi_shadow_queued();
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "MiLock.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+//. Concurrent hash map for the shared-state features (result cache, sessions, per-key
+//. limits) : a power of two of shards, each behind its own mutex on its own cache line,
+//. each an open-addressing table (linear probing, backward-shift erase, no tombstones)
+//. kept at most half full. A shard holds up to its share of p_nCapacity; when full, an
+//. insert evicts by CLOCK : the hand clears the reference bit a hit has set and takes
+//. the first entry whose bit is already clear (or that has expired) - an LRU
+//. approximation that never reorders anything on a hit, so find() stays a short probe
+//. with no list splice. Entries may carry a time to live; expired ones read as absent.
+//. Without eviction a full shard refuses the insert.
+//. K and V are copied in and out under the shard lock, both default constructible.
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ShardedMap {
+public:
+	typedef std::chrono::steady_clock		Clock;
+
+	ShardedMap(size_t p_nCapacity, int p_nShards, bool p_bEvict = true)
+		: m_bEvict(p_bEvict), m_nEvictions(0)
+	{
+		size_t nShards = 1;
+		while ((int)nShards < p_nShards && nShards < 1024) nShards <<= 1;
+		m_nShardMask = nShards - 1;
+		m_nPerShard = p_nCapacity / nShards > 0 ? p_nCapacity / nShards : 1;
+		size_t nSlots = 2;
+		while (nSlots < m_nPerShard * 2) nSlots <<= 1;
+		for (size_t i = 0; i < nShards; i++) m_vShards.emplace_back(new Shard(nSlots));
+	}
+
+	//. copies the live value of p_key to p_out.
+	bool find(const K& p_key, V& p_out)
+	{
+		uint64_t h = mix(m_hash(p_key));
+		Shard& s = shard_of(h);
+		MiLockGuard lock(s.mtx);
+		size_t i = locate(s, p_key, h);
+		if (i == npos) return false;
+		Slot& slot = s.slots[i];
+		if (expired(slot, Clock::now())) {
+			erase_at(s, i);
+			return false;
+		}
+		slot.ref = 1;
+		p_out = slot.value;
+		return true;
+	}
+
+	//. inserts or replaces; p_ttl zero = no expiry. False only for a full shard without eviction.
+	bool insert(const K& p_key, const V& p_value, Clock::duration p_ttl = Clock::duration::zero())
+	{
+		uint64_t h = mix(m_hash(p_key));
+		Shard& s = shard_of(h);
+		auto now = Clock::now();
+		MiLockGuard lock(s.mtx);
+		size_t i = locate(s, p_key, h);
+		if (i == npos) {
+			if (s.count >= m_nPerShard && !evict_one(s, now)) return false;
+			i = s.home(h);
+			while (s.slots[i].used) i = (i + 1) & s.mask;
+			s.slots[i].used = true;
+			s.slots[i].key = p_key;
+			s.slots[i].hash = h;
+			s.count++;
+		}
+		Slot& slot = s.slots[i];
+		slot.value = p_value;
+		slot.ref = 1;
+		slot.expire = p_ttl > Clock::duration::zero() ? now + p_ttl : Clock::time_point::max();
+		return true;
+	}
+
+	//. runs p_fn(V&) on the live value of p_key under the shard lock, inserting V()
+	//. first when absent (and there is room); returns what p_fn returns, false if no room.
+	template <typename F>
+	bool update(const K& p_key, F p_fn, Clock::duration p_ttl = Clock::duration::zero())
+	{
+		uint64_t h = mix(m_hash(p_key));
+		Shard& s = shard_of(h);
+		auto now = Clock::now();
+		MiLockGuard lock(s.mtx);
+		size_t i = locate(s, p_key, h);
+		if (i != npos && expired(s.slots[i], now)) {
+			erase_at(s, i);
+			i = npos;
+		}
+		if (i == npos) {
+			if (s.count >= m_nPerShard && !evict_one(s, now)) return false;
+			i = s.home(h);
+			while (s.slots[i].used) i = (i + 1) & s.mask;
+			Slot& fresh = s.slots[i];
+			fresh.used = true;
+			fresh.key = p_key;
+			fresh.hash = h;
+			fresh.value = V();
+			fresh.expire = p_ttl > Clock::duration::zero() ? now + p_ttl : Clock::time_point::max();
+			s.count++;
+		}
+		s.slots[i].ref = 1;
+		return p_fn(s.slots[i].value);
+	}
+
+	bool erase(const K& p_key)
+	{
+		uint64_t h = mix(m_hash(p_key));
+		Shard& s = shard_of(h);
+		MiLockGuard lock(s.mtx);
+		size_t i = locate(s, p_key, h);
+		if (i == npos) return false;
+		erase_at(s, i);
+		return true;
+	}
+
+	void clear()
+	{
+		for (auto& p : m_vShards) {
+			MiLockGuard lock(p->mtx);
+			for (auto& slot : p->slots) slot = Slot();
+			p->count = 0;
+		}
+	}
+
+	//. reclaims the expired entries now instead of on their next probe; returns how many.
+	size_t purge_expired()
+	{
+		size_t n = 0;
+		Clock::time_point now = Clock::now();
+		for (auto& p : m_vShards) {
+			MiLockGuard lock(p->mtx);
+			for (size_t i = 0; i < p->slots.size(); i++) {
+				//. erase_at may shift a later entry into i.
+				while (p->slots[i].used && expired(p->slots[i], now)) {
+					erase_at(*p, i);
+					n++;
+				}
+			}
+		}
+		return n;
+	}
+
+	//. entries held, expired ones not yet reclaimed included.
+	size_t size() const
+	{
+		size_t n = 0;
+		for (auto& p : m_vShards) {
+			MiLockGuard lock(p->mtx);
+			n += p->count;
+		}
+		return n;
+	}
+	size_t capacity() const { return m_nPerShard * m_vShards.size(); }
+	uint64_t evictions() const { return m_nEvictions.load(std::memory_order_relaxed); }
+
+private:
+	static const size_t npos = (size_t)-1;
+
+	struct Slot {
+		K					key;
+		V					value;
+		uint64_t			hash;
+		Clock::time_point	expire;
+		bool				used;
+		uint8_t				ref;		//. CLOCK reference bit
+		Slot() : hash(0), expire(Clock::time_point::max()), used(false), ref(0) {}
+	};
+
+	struct alignas(64) Shard {
+		mutable MI_MUTEX(mtx, "sharded_map");
+		std::vector<Slot>	slots;
+		size_t				mask;
+		size_t				count;
+		size_t				hand;		//. CLOCK position
+		explicit Shard(size_t p_nSlots) : slots(p_nSlots), mask(p_nSlots - 1), count(0), hand(0) {}
+		//. the low bits pick the slot, the high bits picked the shard.
+		size_t home(uint64_t p_nHash) const { return (size_t)p_nHash & mask; }
+	};
+
+	//. fmix64 : std::hash of an integer is the identity on common libraries.
+	static uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+	Shard& shard_of(uint64_t p_nHash) { return *m_vShards[(size_t)(p_nHash >> 48) & m_nShardMask]; }
+	static bool expired(const Slot& p_slot, Clock::time_point p_now) { return p_slot.expire <= p_now; }
+
+	size_t locate(Shard& p_s, const K& p_key, uint64_t p_nHash) const
+	{
+		for (size_t i = p_s.home(p_nHash); p_s.slots[i].used; i = (i + 1) & p_s.mask) {
+			if (p_s.slots[i].hash == p_nHash && p_s.slots[i].key == p_key) return i;
+		}
+		return npos;
+	}
+
+	//. backward shift : pulls later entries of the probe run into the hole.
+	void erase_at(Shard& p_s, size_t p_nAt)
+	{
+		size_t hole = p_nAt;
+		for (size_t i = (hole + 1) & p_s.mask; p_s.slots[i].used; i = (i + 1) & p_s.mask) {
+			size_t home = p_s.home(p_s.slots[i].hash);
+			//. the entry may fill the hole when its home does not lie in (hole, i].
+			if (((i - home) & p_s.mask) >= ((i - hole) & p_s.mask)) {
+				p_s.slots[hole] = std::move(p_s.slots[i]);
+				hole = i;
+			}
+		}
+		p_s.slots[hole] = Slot();
+		p_s.count--;
+	}
+
+	bool evict_one(Shard& p_s, Clock::time_point p_now)
+	{
+		if (!m_bEvict || p_s.count == 0) return false;
+		//. two sweeps at most : the first clears every bit it passes.
+		for (size_t n = 0; n < p_s.slots.size() * 2; n++) {
+			size_t i = p_s.hand;
+			p_s.hand = (p_s.hand + 1) & p_s.mask;
+			Slot& slot = p_s.slots[i];
+			if (!slot.used) continue;
+			if (slot.ref != 0 && !expired(slot, p_now)) {
+				slot.ref = 0;
+				continue;
+			}
+			erase_at(p_s, i);
+			m_nEvictions.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	Hash								m_hash;
+	std::vector<std::unique_ptr<Shard>>	m_vShards;
+	size_t								m_nShardMask;
+	size_t								m_nPerShard;
+	bool								m_bEvict;
+	std::atomic<uint64_t>				m_nEvictions;
+};
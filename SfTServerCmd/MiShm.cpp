@@ -0,0 +1,114 @@
+#include "MiShm.h"
+#include "MiConf.h"
+#include "Poco/Exception.h"
+#include "Poco/SharedMemory.h"
+#include "MiLock.h"
+#include <map>
+#include <memory>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+//. the segment as Poco::SharedMemory opens it ("/" + name), to read its current size.
+struct ShmFd {
+	int		fd;
+	explicit ShmFd(const std::string& p_strName) : fd(shm_open(("/" + p_strName).c_str(), O_RDONLY, 0)) {}
+	~ShmFd() { if (fd >= 0) close(fd); }
+	//. bytes the segment has now, -1 when it cannot be read.
+	long long bytes() const
+	{
+		struct stat st;
+		return fd >= 0 && fstat(fd, &st) == 0 ? (long long)st.st_size : -1;
+	}
+};
+#endif
+
+struct ShmSegment {
+	size_t								size;
+	std::unique_ptr<Poco::SharedMemory>	mem;
+#ifndef _WIN32
+	std::unique_ptr<ShmFd>				fd;
+#endif
+};
+
+//. a mapping past the end of a POSIX segment maps, and SIGBUSes on the first read : the size
+//. the client sent must fit what the segment holds. On Windows MapViewOfFile refuses it.
+static bool fits(const ShmSegment& p_seg, size_t p_nSize, std::string& p_strErr)
+{
+#ifndef _WIN32
+	long long nBytes = p_seg.fd->bytes();
+	if (nBytes < 0) {
+		p_strErr = "segment not found";
+		return false;
+	}
+	if ((unsigned long long)nBytes < p_nSize) {
+		p_strErr = "segment smaller than its size";
+		return false;
+	}
+#endif
+	return true;
+}
+
+static bool								lv_bEnabled = false;
+static MI_MUTEX(lv_mtx, "shm");
+static std::map<std::string, ShmSegment>	lv_mapSegments;
+
+void mi_shm_init(bool p_bEnable)
+{
+	lv_bEnabled = p_bEnable;
+}
+
+bool mi_shm_enabled()
+{
+	return lv_bEnabled;
+}
+
+const uint8_t* mi_shm_view(const std::string& p_strName, size_t p_nSize, size_t p_nOffset, size_t p_nLength, std::string& p_strErr)
+{
+	if (p_strName.compare(0, strlen(GD_SHM_PREFIX), GD_SHM_PREFIX) != 0) {
+		p_strErr = "segment name outside " GD_SHM_PREFIX;
+		return NULL;
+	}
+	if (p_nLength == 0 || p_nOffset > p_nSize || p_nLength > p_nSize - p_nOffset) {
+		p_strErr = "slot outside the segment";
+		return NULL;
+	}
+
+	MiLockGuard lock(lv_mtx);
+	auto it = lv_mapSegments.find(p_strName);
+	if (it == lv_mapSegments.end()) {
+		ShmSegment seg;
+		seg.size = p_nSize;
+#ifndef _WIN32
+		seg.fd.reset(new ShmFd(p_strName));
+		if (!fits(seg, p_nSize, p_strErr)) return NULL;
+#endif
+		try {
+			//. server = false : the proxy owns the segment, closing it here must not unlink it.
+			seg.mem.reset(new Poco::SharedMemory(p_strName, p_nSize, Poco::SharedMemory::AM_READ, 0, false));
+		}
+		catch (Poco::Exception& ex) {
+			p_strErr = ex.displayText();
+			return NULL;
+		}
+		it = lv_mapSegments.emplace(p_strName, std::move(seg)).first;
+	}
+	if (it->second.size != p_nSize) {
+		p_strErr = "segment size changed";
+		return NULL;
+	}
+	//. the proxy may have truncated it since it was mapped.
+	if (!fits(it->second, p_nSize, p_strErr)) return NULL;
+	return (const uint8_t*)it->second.mem->begin() + p_nOffset;
+}
+
+void mi_shm_shutdown()
+{
+	MiLockGuard lock(lv_mtx);
+	lv_mapSegments.clear();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//. Shared-memory ingestion for a co-located front proxy (mi_id_svc) : the proxy writes
+//. the uploaded image once into a slot of a named segment it owns and sends
+//. GD_API_SHM with the slot in GD_SHM_HEADER_* and an empty body; the check decodes
+//. straight from the mapping with image_create_bytes. The proxy keeps the slot until
+//. the response arrives, so no other synchronisation is needed.
+//. Loopback clients only and segment names under GD_SHM_PREFIX only; everything else
+//. keeps using the HTTP endpoints.
+
+void mi_shm_init(bool p_bEnable);
+bool mi_shm_enabled();
+
+//. read-only view of [p_nOffset, p_nOffset + p_nLength) in segment p_strName of
+//. p_nSize bytes, mapped on first use and kept. NULL with p_strErr on a bad reference,
+//. also when the segment holds fewer than p_nSize bytes.
+const uint8_t* mi_shm_view(const std::string& p_strName, size_t p_nSize, size_t p_nOffset, size_t p_nLength, std::string& p_strErr);
+
+void mi_shm_shutdown();
@@ -0,0 +1,183 @@
+#include "MiStages.h"
+#include "MiContext.h"
+#include "MiCores.h"
+#include "MiMetrics.h"
+#include "MiPipelinePool.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const char* lv_szStages[MI_PIPE_COUNT] = { "receive", "decode", "infer", "send" };
+
+//. one thread group behind a bounded queue.
+class StageQueue {
+public:
+	StageQueue(PipeStage p_stage, int p_nThreads, int p_nCapacity)
+		: m_stage(p_stage)
+		, m_nCapacity(p_nCapacity > 0 ? p_nCapacity : 1)
+		, m_nRunning(0)
+		, m_bStop(false)
+	{
+		for (int i = 0; i < (p_nThreads > 0 ? p_nThreads : 1); i++) {
+			m_threads.emplace_back(&StageQueue::run, this);
+		}
+	}
+
+	~StageQueue() { stop(); }
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bStop = true;
+		}
+		m_cvWork.notify_all();
+		m_cvRoom.notify_all();
+		for (auto& t : m_threads) {
+			if (t.joinable()) t.join();
+		}
+		m_threads.clear();
+	}
+
+	//. blocks while the queue is full; false once stopped (the caller runs p_fn itself).
+	bool post(std::function<void()>& p_fn)
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+		m_cvRoom.wait(lock, [this] { return m_bStop || (int)m_queue.size() < m_nCapacity; });
+		if (m_bStop) return false;
+		m_queue.push_back(std::move(p_fn));
+		mi_metrics_stage_queue(m_stage, (int)m_queue.size());
+		lock.unlock();
+		m_cvWork.notify_one();
+		return true;
+	}
+
+	int pending()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		return (int)m_queue.size() + m_nRunning;
+	}
+
+	bool on_worker() const { return lv_pOwner == this; }
+
+private:
+	void run()
+	{
+		lv_pOwner = this;
+		mi_cores_pin(m_stage == MI_PIPE_SEND ? MI_CORES_IO : MI_CORES_INFERENCE);
+		std::unique_lock<std::mutex> lock(m_mtx);
+		while (true) {
+			m_cvWork.wait(lock, [this] { return m_bStop || !m_queue.empty(); });
+			//. queued work is finished before the threads leave.
+			if (m_queue.empty()) break;
+			std::function<void()> fn = std::move(m_queue.front());
+			m_queue.pop_front();
+			mi_metrics_stage_queue(m_stage, (int)m_queue.size());
+			m_nRunning++;
+			lock.unlock();
+			m_cvRoom.notify_one();
+			fn();
+			lock.lock();
+			m_nRunning--;
+		}
+		lv_pOwner = NULL;
+	}
+
+	static thread_local const StageQueue*	lv_pOwner;
+
+	PipeStage								m_stage;
+	int										m_nCapacity;
+	int										m_nRunning;
+	bool									m_bStop;
+	std::mutex								m_mtx;
+	std::condition_variable					m_cvWork;
+	std::condition_variable					m_cvRoom;
+	std::deque<std::function<void()>>		m_queue;
+	std::vector<std::thread>				m_threads;
+};
+
+thread_local const StageQueue* StageQueue::lv_pOwner = NULL;
+
+static StageQueue*	lv_pInfer = NULL;
+static StageQueue*	lv_pSend = NULL;
+
+const char* mi_pipe_stage_name(int p_nStage)
+{
+	return p_nStage >= 0 && p_nStage < MI_PIPE_COUNT ? lv_szStages[p_nStage] : "unknown";
+}
+
+void mi_stages_start(int p_nInferThreads, int p_nInferQueue, int p_nSendThreads, int p_nSendQueue)
+{
+	int nInfer = p_nInferThreads > 0 ? p_nInferThreads : (g_pPool != NULL ? g_pPool->size() : 1);
+	lv_pInfer = new StageQueue(MI_PIPE_INFER, nInfer, p_nInferQueue);
+	if (p_nSendThreads > 0) lv_pSend = new StageQueue(MI_PIPE_SEND, p_nSendThreads, p_nSendQueue);
+}
+
+void mi_stages_stop()
+{
+	//. sends first : their requests have finished inferring.
+	if (lv_pSend != NULL) {
+		lv_pSend->stop();
+		delete lv_pSend;
+		lv_pSend = NULL;
+	}
+	if (lv_pInfer != NULL) {
+		lv_pInfer->stop();
+		delete lv_pInfer;
+		lv_pInfer = NULL;
+	}
+}
+
+int mi_stages_pending()
+{
+	int n = 0;
+	if (lv_pInfer != NULL) n += lv_pInfer->pending();
+	if (lv_pSend != NULL) n += lv_pSend->pending();
+	return n;
+}
+
+void mi_stage_infer(const std::function<void()>& p_fn)
+{
+	StageQueue* q = lv_pInfer;
+	if (q == NULL || q->on_worker()) {
+		p_fn();
+		return;
+	}
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool bDone = false;
+	std::exception_ptr error;
+	RequestContext* ctx = mi_context();
+	std::function<void()> call = [&]() {
+		try {
+			ContextBorrow borrow(ctx);
+			p_fn();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		std::lock_guard<std::mutex> lock(mtx);
+		bDone = true;
+		cv.notify_one();
+	};
+	if (!q->post(call)) {
+		p_fn();
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mtx);
+	cv.wait(lock, [&bDone] { return bDone; });
+	if (error) std::rethrow_exception(error);
+}
+
+void mi_stage_send(std::function<void()> p_fn)
+{
+	if (lv_pSend == NULL || !lv_pSend->post(p_fn)) p_fn();
+}
+
+void mi_stage_depth(PipeStage p_stage, int p_nDepth)
+{
+	mi_metrics_stage_queue(p_stage, p_nDepth);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+
+//. Stage-pipelined execution ([stages] settings) : the steps of a request run on their
+//. own thread groups joined by bounded queues, so the CPU-heavy decode of the next
+//. requests overlaps the OpenVINO inference of the current ones instead of each thread
+//. doing receive -> decode -> infer -> send in turn.
+//.   receive : the reactors (server.mode = reactor) buffer header and body;
+//.   decode  : server.inference_workers (reactor) or the Poco threads (classic) read the
+//.             body, decode and preprocess, and write the JSON;
+//.   infer   : infer_threads run the pipeline calls of MiInference.h, a decode thread waits
+//.             for its own call while the others go on with the following requests;
+//.   send    : send_threads serialize the responses for the reactors (reactor mode).
+//. A full queue blocks the stage before it, which is how back pressure reaches admission.
+//. mi_stage_queue_depth{stage} on /metrics shows the requests waiting for each stage.
+
+enum PipeStage {
+	MI_PIPE_RECEIVE = 0,	//. bodies being received
+	MI_PIPE_DECODE,			//. complete requests waiting for a decode thread
+	MI_PIPE_INFER,			//. pipeline calls waiting for an inference thread
+	MI_PIPE_SEND,			//. responses waiting to be serialized
+	MI_PIPE_COUNT
+};
+
+const char* mi_pipe_stage_name(int p_nStage);
+
+//. p_nInferThreads <= 0 = one per pipeline of the pool. Until this has run every stage
+//. runs on the calling thread ([stages] enable = false).
+void mi_stages_start(int p_nInferThreads, int p_nInferQueue, int p_nSendThreads, int p_nSendQueue);
+//. finishes the queued work, then joins the threads.
+void mi_stages_stop();
+//. queued or running work of the infer and send stages.
+int mi_stages_pending();
+
+//. runs p_fn on an inference thread with the caller's request context (MiContext.h)
+//. and returns when it has; inline without the infer stage or from an inference thread.
+void mi_stage_infer(const std::function<void()>& p_fn);
+
+//. queues p_fn on a send thread, inline without the send stage.
+void mi_stage_send(std::function<void()> p_fn);
+
+//. depth p_nDepth of a stage queue owned elsewhere (receive, decode).
+void mi_stage_depth(PipeStage p_stage, int p_nDepth);
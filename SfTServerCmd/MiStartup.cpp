@@ -0,0 +1,119 @@
+#include "MiStartup.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+struct StartupPhase {
+	const char*	name;
+	long long	ms;
+};
+
+static std::mutex								lv_mtx;
+static std::chrono::steady_clock::time_point	lv_start = std::chrono::steady_clock::now();
+static std::chrono::steady_clock::time_point	lv_last = lv_start;
+static std::vector<StartupPhase>				lv_vPhases;
+static bool										lv_bListening = false;
+static bool										lv_bWarm = false;
+static bool										lv_bReady = false;
+static long long								lv_nListenMs = -1;
+static long long								lv_nReadyMs = -1;
+static long long								lv_nFirstMs = -1;
+static std::atomic<bool>						lv_bServed(false);
+
+static long long ms_since(std::chrono::steady_clock::time_point p_t, std::chrono::steady_clock::time_point p_now)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(p_now - p_t).count();
+}
+
+//. caller holds lv_mtx.
+static StartupPhase end_phase(const char* p_pszPhase)
+{
+	auto now = std::chrono::steady_clock::now();
+	StartupPhase phase = { p_pszPhase, ms_since(lv_last, now) };
+	lv_last = now;
+	lv_vPhases.push_back(phase);
+	return phase;
+}
+
+static std::string summary_locked()
+{
+	std::ostringstream ss;
+	ss << ms_since(lv_start, std::chrono::steady_clock::now()) << " ms (";
+	for (size_t i = 0; i < lv_vPhases.size(); i++) ss << (i > 0 ? ", " : "") << lv_vPhases[i].name << " " << lv_vPhases[i].ms;
+	ss << ")";
+	return ss.str();
+}
+
+void mi_startup_begin()
+{
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	lv_start = lv_last = std::chrono::steady_clock::now();
+	lv_vPhases.clear();
+	lv_bListening = lv_bWarm = lv_bReady = false;
+	lv_nListenMs = lv_nReadyMs = lv_nFirstMs = -1;
+	lv_bServed.store(false, std::memory_order_relaxed);
+}
+
+void mi_startup_phase(const char* p_pszPhase)
+{
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	if (lv_bReady) return;
+	StartupPhase phase = end_phase(p_pszPhase);
+	std::cout << "Startup : " << phase.name << " " << phase.ms << " ms" << std::endl;
+}
+
+//. caller holds lv_mtx.
+static void log_ready()
+{
+	lv_bReady = true;
+	lv_nReadyMs = ms_since(lv_start, std::chrono::steady_clock::now());
+	std::cout << "Startup : ready in " << summary_locked() << std::endl;
+}
+
+void mi_startup_listening()
+{
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	if (lv_bListening) return;
+	lv_bListening = true;
+	StartupPhase phase = end_phase("listen");
+	lv_nListenMs = ms_since(lv_start, lv_last);
+	std::cout << "Startup : " << phase.name << " " << phase.ms << " ms" << std::endl;
+	if (lv_bWarm) log_ready();
+}
+
+void mi_startup_warm()
+{
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	if (lv_bWarm) return;
+	lv_bWarm = true;
+	if (!lv_bListening) return;
+	end_phase("warmup");
+	log_ready();
+}
+
+std::string mi_startup_summary()
+{
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	return summary_locked();
+}
+
+void mi_startup_inference()
+{
+	if (lv_bServed.load(std::memory_order_relaxed) || lv_bServed.exchange(true)) return;
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	lv_nFirstMs = ms_since(lv_start, std::chrono::steady_clock::now());
+	std::cout << "Startup : first inference " << lv_nFirstMs << " ms after start" << std::endl;
+}
+
+void mi_startup_times(StartupTimes& p_times)
+{
+	std::lock_guard<std::mutex> lock(lv_mtx);
+	p_times.phases.clear();
+	for (const StartupPhase& phase : lv_vPhases) p_times.phases.push_back(std::make_pair(phase.name, (double)phase.ms / 1000.0));
+	p_times.listen = lv_nListenMs < 0 ? -1.0 : (double)lv_nListenMs / 1000.0;
+	p_times.ready = lv_nReadyMs < 0 ? -1.0 : (double)lv_nReadyMs / 1000.0;
+	p_times.firstInference = lv_nFirstMs < 0 ? -1.0 : (double)lv_nFirstMs / 1000.0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+//. Startup phase timings. main and launch mark the end of each phase
+//. (settings, sdk_load, pipeline_pool, engines, ...); every mark logs the time spent in
+//. the phase. Once the server listens and the warm-up has finished, the time from process
+//. start to ready is logged with the whole breakdown :
+//.   Startup : ready in 4210 ms (settings 3, sdk_load 2870, pipeline_pool 910, ..., warmup 390)
+//. Phases are measured on the steady clock from mi_startup_begin. The first answered API
+//. request ends the boot as autoscaling sees it :
+//.   Startup : first inference 5120 ms after start
+//. All of it is on GD_API_METRICS too : mi_startup_phase_seconds{phase} and
+//. mi_startup_seconds{milestone = listen, ready, first_inference}.
+
+//. first statement of main.
+void mi_startup_begin();
+
+//. ends the running phase; p_pszPhase must be a string literal.
+void mi_startup_phase(const char* p_pszPhase);
+
+//. the two halves of ready : the server accepts connections (ends the "listen" phase),
+//. the warm-up thread is done (at once without [warmup]). Whichever comes second logs the
+//. summary; a warm-up finishing last ends a "warmup" phase first.
+void mi_startup_listening();
+void mi_startup_warm();
+
+//. one API request was answered (RequestTimer, MiMetrics.h); a relaxed load after the first.
+void mi_startup_inference();
+
+struct StartupTimes {
+	std::vector<std::pair<const char*, double>>	phases;		//. seconds, in order
+	double										listen;		//. seconds from start, -1 = not yet
+	double										ready;
+	double										firstInference;
+};
+
+//. the phases ended so far and the milestones reached.
+void mi_startup_times(StartupTimes& p_times);
+
+//. summary so far, for logs of modes that never become ready.
+std::string mi_startup_summary();
@@ -0,0 +1,463 @@
+#include "MiStats.h"
+#include "MiAlloc.h"
+#include "MiMetrics.h"
+#include "MiResultJson.h"
+#include "MiSdkCall.h"
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define LD_STATS_SUB_BITS	4
+#define LD_STATS_SUB		(1 << LD_STATS_SUB_BITS)
+#define LD_STATS_BUCKETS	400			//. up to 2^27 us
+#define LD_STATS_BOUNDS		13
+#define LD_STATS_COUNTERS	512
+//. endpoints and stages are kept by slot for the windows; the FaceSDK calls only in the totals.
+#define LD_STATS_WINDOWED	(MI_EP_COUNT + MI_STAGE_COUNT)
+#define LD_STATS_SERIES		(LD_STATS_WINDOWED + MI_SDK_CALL_COUNT)
+
+static const double lv_dBounds[LD_STATS_BOUNDS] = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0 };
+static const int lv_nGroupBase[MI_STATS_GROUP_COUNT + 1] = { 0, MI_EP_COUNT, LD_STATS_WINDOWED, LD_STATS_SERIES };
+
+//. one histogram of the shard of a thread : only that thread adds, the collector exchanges.
+struct alignas(64) StatsSeries {
+	std::atomic<uint32_t>	count;
+	std::atomic<uint32_t>	errors;
+	std::atomic<uint64_t>	sumUs;
+	std::atomic<uint32_t>	le[LD_STATS_BOUNDS + 1];
+	std::atomic<uint32_t>	buckets[LD_STATS_BUCKETS];
+};
+
+struct StatsShard {
+	StatsSeries							series[LD_STATS_SERIES];
+	alignas(64) std::atomic<uint64_t>	counters[LD_STATS_COUNTERS];
+	std::atomic<bool>					free;
+	StatsShard() : free(false)
+	{
+		for (int s = 0; s < LD_STATS_SERIES; s++) {
+			StatsSeries& r = series[s];
+			r.count.store(0, std::memory_order_relaxed);
+			r.errors.store(0, std::memory_order_relaxed);
+			r.sumUs.store(0, std::memory_order_relaxed);
+			for (int b = 0; b <= LD_STATS_BOUNDS; b++) r.le[b].store(0, std::memory_order_relaxed);
+			for (int b = 0; b < LD_STATS_BUCKETS; b++) r.buckets[b].store(0, std::memory_order_relaxed);
+		}
+		for (int c = 0; c < LD_STATS_COUNTERS; c++) counters[c].store(0, std::memory_order_relaxed);
+	}
+};
+
+//. one ring slot, merged; written and read under lv_mtxMerge only.
+struct StatsSlot {
+	int64_t		index;			//. slot number since lv_start, -1 = empty
+	uint32_t	count[LD_STATS_WINDOWED];
+	uint32_t	errors[LD_STATS_WINDOWED];
+	uint32_t	buckets[LD_STATS_WINDOWED][LD_STATS_BUCKETS];
+};
+
+//. since the start, for /metrics; under lv_mtxMerge.
+struct StatsTotal {
+	uint64_t	count;
+	uint64_t	sumUs;
+	uint64_t	le[LD_STATS_BOUNDS + 1];	//. per bucket, not cumulative
+};
+
+static const int								lv_nWindows[] = { 60, 300, 900 };
+static const char* const						lv_szWindows[] = { "1m", "5m", "15m" };
+
+static std::atomic<bool>						lv_bEnabled(false);
+static std::atomic<int>							lv_nCounters(0);		//. reserved
+static int										lv_nSlotSec = 10;
+static std::chrono::steady_clock::time_point	lv_start;
+static std::mutex								lv_mtxShards;		//. shard registration and takeover only
+static std::vector<std::unique_ptr<StatsShard>>	lv_vShards;
+static std::mutex								lv_mtxMerge;
+static std::vector<StatsSlot>					lv_vSlots;
+static StatsTotal								lv_totals[LD_STATS_SERIES];
+static uint64_t									lv_nCounterTotals[LD_STATS_COUNTERS];
+static std::thread								lv_collector;
+static std::mutex								lv_mtxCollector;
+static std::condition_variable					lv_cvCollector;
+static bool										lv_bStop = false;
+
+//. hands the shard over to the next thread when this one ends.
+struct ShardHolder {
+	StatsShard*	p;
+	ShardHolder() : p(NULL) {}
+	~ShardHolder() { if (p != NULL) p->free.store(true, std::memory_order_release); }
+};
+
+static thread_local ShardHolder					lv_shard;
+static thread_local int							lv_nLastEndpoint = -1;
+
+static StatsShard* thread_shard()
+{
+	if (lv_shard.p == NULL) {
+		std::lock_guard<std::mutex> lock(lv_mtxShards);
+		for (size_t i = 0; i < lv_vShards.size() && lv_shard.p == NULL; i++) {
+			bool bFree = true;
+			if (lv_vShards[i]->free.compare_exchange_strong(bFree, false)) lv_shard.p = lv_vShards[i].get();
+		}
+		if (lv_shard.p == NULL) {
+			lv_vShards.emplace_back(new StatsShard);
+			lv_shard.p = lv_vShards.back().get();
+		}
+	}
+	return lv_shard.p;
+}
+
+static inline int bucket_of(uint64_t p_nUs)
+{
+	if (p_nUs < LD_STATS_SUB) return (int)p_nUs;
+	int nMsb = 63;
+	while ((p_nUs >> nMsb) == 0) nMsb--;
+	int e = nMsb - LD_STATS_SUB_BITS;
+	int n = LD_STATS_SUB + e * LD_STATS_SUB + (int)((p_nUs >> e) & (LD_STATS_SUB - 1));
+	return n < LD_STATS_BUCKETS ? n : LD_STATS_BUCKETS - 1;
+}
+
+//. middle of bucket p_n, in microseconds.
+static double bucket_value(int p_n)
+{
+	if (p_n < LD_STATS_SUB) return (double)p_n + 0.5;
+	int e = (p_n - LD_STATS_SUB) / LD_STATS_SUB;
+	int sub = (p_n - LD_STATS_SUB) % LD_STATS_SUB;
+	double dLow = (double)((uint64_t)(LD_STATS_SUB + sub) << e);
+	return dLow + (double)((uint64_t)1 << e) / 2;
+}
+
+static void record(int p_nSeries, double p_dSec)
+{
+	StatsSeries& s = thread_shard()->series[p_nSeries];
+	uint64_t nUs = p_dSec > 0 ? (uint64_t)(p_dSec * 1e6) : 0;
+	int nLe = 0;
+	while (nLe < LD_STATS_BOUNDS && p_dSec > lv_dBounds[nLe]) nLe++;
+	s.le[nLe].fetch_add(1, std::memory_order_relaxed);
+	s.buckets[bucket_of(nUs)].fetch_add(1, std::memory_order_relaxed);
+	s.sumUs.fetch_add(nUs, std::memory_order_relaxed);
+	//. after the buckets : a drain that sees the count has the buckets too, or gets them next time.
+	s.count.fetch_add(1, std::memory_order_release);
+}
+
+static int64_t slot_now(double* p_pElapsed = NULL)
+{
+	double d = std::chrono::duration<double>(std::chrono::steady_clock::now() - lv_start).count();
+	if (p_pElapsed != NULL) *p_pElapsed = d;
+	return (int64_t)(d / lv_nSlotSec);
+}
+
+//. under lv_mtxMerge : every shard into the current slot and the totals.
+static void drain()
+{
+	int64_t nNow = slot_now();
+	StatsSlot& slot = lv_vSlots[(size_t)(nNow % (int64_t)lv_vSlots.size())];
+	if (slot.index != nNow) {
+		memset(&slot, 0, sizeof(slot));
+		slot.index = nNow;
+	}
+	int nCounters = lv_nCounters.load(std::memory_order_acquire);
+	if (nCounters > LD_STATS_COUNTERS) nCounters = LD_STATS_COUNTERS;
+	std::lock_guard<std::mutex> lock(lv_mtxShards);
+	for (size_t i = 0; i < lv_vShards.size(); i++) {
+		StatsShard& shard = *lv_vShards[i];
+		for (int c = 0; c < nCounters; c++) {
+			if (shard.counters[c].load(std::memory_order_relaxed) != 0) lv_nCounterTotals[c] += shard.counters[c].exchange(0, std::memory_order_relaxed);
+		}
+		for (int s = 0; s < LD_STATS_SERIES; s++) {
+			StatsSeries& series = shard.series[s];
+			uint32_t nErrors = series.errors.exchange(0, std::memory_order_relaxed);
+			uint32_t n = series.count.exchange(0, std::memory_order_acquire);
+			if (s < LD_STATS_WINDOWED) slot.errors[s] += nErrors;
+			if (n == 0) continue;
+			StatsTotal& total = lv_totals[s];
+			total.count += n;
+			total.sumUs += series.sumUs.exchange(0, std::memory_order_relaxed);
+			for (int b = 0; b <= LD_STATS_BOUNDS; b++) {
+				if (series.le[b].load(std::memory_order_relaxed) != 0) total.le[b] += series.le[b].exchange(0, std::memory_order_relaxed);
+			}
+			if (s < LD_STATS_WINDOWED) slot.count[s] += n;
+			for (int b = 0; b < LD_STATS_BUCKETS; b++) {
+				if (series.buckets[b].load(std::memory_order_relaxed) == 0) continue;
+				uint32_t nBucket = series.buckets[b].exchange(0, std::memory_order_relaxed);
+				if (s < LD_STATS_WINDOWED) slot.buckets[s][b] += nBucket;
+			}
+		}
+	}
+}
+
+static void collector_loop()
+{
+	std::unique_lock<std::mutex> lock(lv_mtxCollector);
+	while (!lv_bStop) {
+		//. just after the next slot boundary, so a slot is drained into itself.
+		double dElapsed = 0;
+		int64_t nNext = slot_now(&dElapsed) + 1;
+		double dWait = (double)nNext * lv_nSlotSec - dElapsed + 0.05;
+		lv_cvCollector.wait_for(lock, std::chrono::duration<double>(dWait));
+		if (lv_bStop) break;
+		lock.unlock();
+		{
+			std::lock_guard<std::mutex> merge(lv_mtxMerge);
+			drain();
+		}
+		lock.lock();
+	}
+}
+
+void mi_stats_init(int p_nSlotSec)
+{
+	if (lv_bEnabled.load()) return;
+	lv_nSlotSec = p_nSlotSec < 1 ? 1 : p_nSlotSec > 60 ? 60 : p_nSlotSec;
+	lv_start = std::chrono::steady_clock::now();
+	//. the 15m window, the slot in progress included.
+	size_t nSlots = (size_t)((lv_nWindows[2] + lv_nSlotSec - 1) / lv_nSlotSec) + 1;
+	lv_vSlots.assign(nSlots, StatsSlot());
+	for (size_t i = 0; i < nSlots; i++) lv_vSlots[i].index = -1;
+	lv_bStop = false;
+	lv_collector = std::thread(collector_loop);
+	lv_bEnabled.store(true, std::memory_order_release);
+}
+
+void mi_stats_shutdown()
+{
+	if (!lv_bEnabled.exchange(false)) return;
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxCollector);
+		lv_bStop = true;
+	}
+	lv_cvCollector.notify_one();
+	if (lv_collector.joinable()) lv_collector.join();
+}
+
+void mi_stats_observe(MiStatsGroup p_group, int p_nIndex, double p_dSec)
+{
+	if (!lv_bEnabled.load(std::memory_order_relaxed) || p_group < 0 || p_group >= MI_STATS_GROUP_COUNT) return;
+	int nSeries = lv_nGroupBase[p_group] + p_nIndex;
+	if (p_nIndex < 0 || nSeries >= lv_nGroupBase[p_group + 1]) return;
+	record(nSeries, p_dSec);
+}
+
+void mi_stats_request(int p_nEndpoint, double p_dSec)
+{
+	if (!lv_bEnabled.load(std::memory_order_relaxed) || p_nEndpoint < 0 || p_nEndpoint >= MI_EP_COUNT) return;
+	record(p_nEndpoint, p_dSec);
+	lv_nLastEndpoint = p_nEndpoint;
+}
+
+void mi_stats_stage(int p_nStage, double p_dSec)
+{
+	mi_stats_observe(MI_STATS_STAGE, p_nStage, p_dSec);
+}
+
+void mi_stats_status(int p_nStatus)
+{
+	int nEndpoint = lv_nLastEndpoint;
+	lv_nLastEndpoint = -1;
+	if (nEndpoint < 0 || p_nStatus < 500 || !lv_bEnabled.load(std::memory_order_relaxed)) return;
+	thread_shard()->series[nEndpoint].errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+int mi_stats_counters(int p_nCount)
+{
+	int nFirst = lv_nCounters.fetch_add(p_nCount);
+	if (nFirst + p_nCount > LD_STATS_COUNTERS) return -1;
+	return nFirst;
+}
+
+void mi_stats_add(int p_nCounter, uint64_t p_n)
+{
+	if (!lv_bEnabled.load(std::memory_order_relaxed) || p_nCounter < 0 || p_nCounter >= LD_STATS_COUNTERS) return;
+	thread_shard()->counters[p_nCounter].fetch_add(p_n, std::memory_order_relaxed);
+}
+
+const double* mi_stats_bounds(int* p_pCount)
+{
+	*p_pCount = LD_STATS_BOUNDS;
+	return lv_dBounds;
+}
+
+void mi_stats_collect()
+{
+	if (!lv_bEnabled.load(std::memory_order_acquire)) return;
+	std::lock_guard<std::mutex> lock(lv_mtxMerge);
+	drain();
+}
+
+void mi_stats_histogram(MiStatsGroup p_group, int p_nIndex, StatsHistogram& p_out)
+{
+	memset(&p_out, 0, sizeof(p_out));
+	if (p_group < 0 || p_group >= MI_STATS_GROUP_COUNT) return;
+	int nSeries = lv_nGroupBase[p_group] + p_nIndex;
+	if (p_nIndex < 0 || nSeries >= lv_nGroupBase[p_group + 1]) return;
+	std::lock_guard<std::mutex> lock(lv_mtxMerge);
+	const StatsTotal& total = lv_totals[nSeries];
+	p_out.count = total.count;
+	p_out.sum = (double)total.sumUs / 1e6;
+	uint64_t n = 0;
+	for (int b = 0; b <= LD_STATS_BOUNDS; b++) {
+		n += total.le[b];
+		p_out.le[b] = n;
+	}
+}
+
+uint64_t mi_stats_counter(int p_nCounter)
+{
+	if (p_nCounter < 0 || p_nCounter >= LD_STATS_COUNTERS) return 0;
+	std::lock_guard<std::mutex> lock(lv_mtxMerge);
+	return lv_nCounterTotals[p_nCounter];
+}
+
+static void put_u64(ArenaString& p_out, uint64_t p_n)
+{
+	char buf[24];
+	std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), p_n);
+	p_out.append(buf, (size_t)(r.ptr - buf));
+}
+
+static void put_key(ArenaString& p_out, const char* p_pszKey)
+{
+	mi_json_put_string(p_out, p_pszKey);
+	p_out.push_back(':');
+}
+
+//. the value at quantile p_dQ of p_pBuckets, in milliseconds.
+static float quantile_ms(const uint64_t* p_pBuckets, uint64_t p_nCount, double p_dQ)
+{
+	uint64_t nRank = (uint64_t)(p_dQ * (double)p_nCount);
+	if (nRank >= p_nCount) nRank = p_nCount - 1;
+	uint64_t nSeen = 0;
+	for (int b = 0; b < LD_STATS_BUCKETS; b++) {
+		nSeen += p_pBuckets[b];
+		if (nSeen > nRank) return (float)(bucket_value(b) / 1000.0);
+	}
+	return (float)(bucket_value(LD_STATS_BUCKETS - 1) / 1000.0);
+}
+
+static void put_series(ArenaString& p_out, const char* p_pszGroup, int p_nFrom, int p_nTo, const char* (*p_fnName)(int),
+	const std::vector<const StatsSlot*>& p_vSlots, double p_dSec, bool p_bRequests)
+{
+	static const double dQ[] = { 0.50, 0.95, 0.99 };
+	static const char* const szQ[] = { "p50_ms", "p95_ms", "p99_ms" };
+	uint64_t buckets[LD_STATS_BUCKETS];
+	put_key(p_out, p_pszGroup);
+	p_out.push_back('{');
+	bool bFirst = true;
+	for (int s = p_nFrom; s < p_nTo; s++) {
+		uint64_t nCount = 0, nErrors = 0;
+		for (size_t i = 0; i < p_vSlots.size(); i++) {
+			nCount += p_vSlots[i]->count[s];
+			nErrors += p_vSlots[i]->errors[s];
+		}
+		if (nCount == 0) continue;
+		memset(buckets, 0, sizeof(buckets));
+		for (size_t i = 0; i < p_vSlots.size(); i++) {
+			for (int b = 0; b < LD_STATS_BUCKETS; b++) buckets[b] += p_vSlots[i]->buckets[s][b];
+		}
+		if (!bFirst) p_out.push_back(',');
+		bFirst = false;
+		put_key(p_out, p_fnName(s - p_nFrom));
+		p_out.push_back('{');
+		put_key(p_out, p_bRequests ? "requests" : "count");
+		put_u64(p_out, nCount);
+		p_out.push_back(',');
+		put_key(p_out, "rps");
+		mi_json_put_float(p_out, (float)((double)nCount / p_dSec));
+		if (p_bRequests) {
+			p_out.push_back(',');
+			put_key(p_out, "errors");
+			put_u64(p_out, nErrors);
+			p_out.push_back(',');
+			put_key(p_out, "error_rate");
+			mi_json_put_float(p_out, (float)((double)nErrors / (double)nCount));
+		}
+		for (int q = 0; q < 3; q++) {
+			p_out.push_back(',');
+			put_key(p_out, szQ[q]);
+			mi_json_put_float(p_out, quantile_ms(buckets, nCount, dQ[q]));
+		}
+		p_out.push_back('}');
+	}
+	p_out.push_back('}');
+}
+
+static const char* endpoint_name(int p_n) { return mi_metrics_endpoint_name((MiEndpoint)p_n); }
+static const char* stage_name(int p_n) { return mi_metrics_stage_name((MiStage)p_n); }
+
+//. under lv_mtxMerge : the slots numbered p_nFrom .. p_nTo - 1.
+static void window_slots(int64_t p_nFrom, int64_t p_nTo, std::vector<const StatsSlot*>& p_vSlots)
+{
+	p_vSlots.clear();
+	for (size_t i = 0; i < lv_vSlots.size(); i++) {
+		if (lv_vSlots[i].index >= 0 && lv_vSlots[i].index >= p_nFrom && lv_vSlots[i].index < p_nTo) p_vSlots.push_back(&lv_vSlots[i]);
+	}
+}
+
+void mi_stats_json(ArenaString& p_out)
+{
+	p_out.push_back('{');
+	if (!lv_bEnabled.load(std::memory_order_acquire)) {
+		p_out.push_back('}');
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(lv_mtxMerge);
+		drain();
+		double dElapsed = 0;
+		int64_t nNow = slot_now(&dElapsed);
+		put_key(p_out, "uptime_sec");
+		put_u64(p_out, (uint64_t)dElapsed);
+		p_out.push_back(',');
+		put_key(p_out, "slot_sec");
+		put_u64(p_out, (uint64_t)lv_nSlotSec);
+		p_out.push_back(',');
+		put_key(p_out, "windows");
+		p_out.push_back('{');
+		std::vector<const StatsSlot*> vSlots;
+		for (int w = 0; w < 3; w++) {
+			//. whole slots back from the one in progress; the span covered sets the rates.
+			int64_t nSlots = (lv_nWindows[w] + lv_nSlotSec - 1) / lv_nSlotSec;
+			double dSec = (double)(nSlots - 1) * lv_nSlotSec + (dElapsed - (double)nNow * lv_nSlotSec);
+			if (dSec > dElapsed) dSec = dElapsed;
+			if (dSec < 1) dSec = 1;
+			window_slots(nNow - nSlots + 1, nNow + 1, vSlots);
+			if (w > 0) p_out.push_back(',');
+			put_key(p_out, lv_szWindows[w]);
+			p_out.push_back('{');
+			put_key(p_out, "seconds");
+			mi_json_put_float(p_out, (float)dSec);
+			p_out.push_back(',');
+			put_series(p_out, "endpoints", 0, MI_EP_COUNT, endpoint_name, vSlots, dSec, true);
+			p_out.push_back(',');
+			put_series(p_out, "stages", MI_EP_COUNT, LD_STATS_WINDOWED, stage_name, vSlots, dSec, false);
+			p_out.push_back('}');
+		}
+		p_out.push_back('}');
+	}
+	//. reads the core counters, which take lv_mtxMerge themselves.
+	mi_alloc_json(p_out);
+	p_out.push_back('}');
+}
+
+void mi_stats_summary(std::string& p_line, int p_nSec)
+{
+	ArenaString out;
+	if (lv_bEnabled.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(lv_mtxMerge);
+		drain();
+		int64_t nNow = slot_now();
+		int64_t nSlots = (p_nSec + lv_nSlotSec - 1) / lv_nSlotSec;
+		if (nSlots < 1) nSlots = 1;
+		std::vector<const StatsSlot*> vSlots;
+		window_slots(nNow - nSlots, nNow, vSlots);
+		put_series(out, "endpoints", 0, MI_EP_COUNT, endpoint_name, vSlots, (double)(nSlots * lv_nSlotSec), true);
+	}
+	else {
+		out = "\"endpoints\":{}";
+	}
+	p_line.append(out.data(), out.size());
+}
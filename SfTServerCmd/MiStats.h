@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include "MiArena.h"
+
+//. Statistics core : the one recording path behind GD_API_METRICS (the request, stage and
+//. FaceSDK call histograms and the per-request counters), GD_API_STATS and the access-log
+//. summary lines, so the 16+ request threads never meet on a shared sample.
+//. Each thread records into its own shard : cache-line aligned series of log-linear (HDR
+//. style) histograms in microseconds, 16 sub-buckets per power of two (6% wide) up to 134 s,
+//. plus the Prometheus le buckets of mi_stats_bounds, and a block of counters. Recording is a
+//. few relaxed atomic adds on lines no other thread writes. A collector thread drains the
+//. shards every slot into running totals (for /metrics) and a ring of 15 minutes of slots
+//. (for the windows); every read drains once more so it sees up to the call. Shards outlive
+//. their threads and are taken over by the next thread.
+//. GD_API_STATS : per endpoint the requests, rps, error rate (status >= 500) and p50 / p95 /
+//. p99, per stage the count and the same quantiles, over rolling 1m / 5m / 15m windows.
+
+enum MiStatsGroup {
+	MI_STATS_ENDPOINT = 0,		//. MiEndpoint (MiMetrics.h)
+	MI_STATS_STAGE,				//. MiStage
+	MI_STATS_SDK_CALL,			//. SdkCall (MiSdkCall.h)
+	MI_STATS_GROUP_COUNT
+};
+
+//. p_nSlotSec : width of a ring slot, the granularity of the windows.
+void mi_stats_init(int p_nSlotSec);
+void mi_stats_shutdown();
+
+//. any thread, no lock; no-ops before mi_stats_init.
+void mi_stats_observe(MiStatsGroup p_group, int p_nIndex, double p_dSec);
+void mi_stats_request(int p_nEndpoint, double p_dSec);
+void mi_stats_stage(int p_nStage, double p_dSec);
+//. the HTTP status of the request last recorded by mi_stats_request on this thread.
+void mi_stats_status(int p_nStatus);
+//. reserves p_nCount consecutive counters and returns the first id, -1 when the block is full.
+int mi_stats_counters(int p_nCount);
+void mi_stats_add(int p_nCounter, uint64_t p_n = 1);
+
+//. le bounds (seconds) of the cumulative histograms, without +Inf.
+const double* mi_stats_bounds(int* p_pCount);
+struct StatsHistogram {
+	uint64_t	count;
+	double		sum;			//. seconds
+	uint64_t	le[16];			//. cumulative per bound, [bounds] = +Inf
+};
+//. drains the shards : the totals below are then current.
+void mi_stats_collect();
+void mi_stats_histogram(MiStatsGroup p_group, int p_nIndex, StatsHistogram& p_out);
+uint64_t mi_stats_counter(int p_nCounter);
+
+//. {"uptime_sec","slot_sec","windows":{"1m":{"seconds","endpoints":{...},"stages":{...}},...}}
+//. and "allocations":{...} since start with allocation counting (MiAlloc.h).
+void mi_stats_json(ArenaString& p_out);
+//. appends "endpoints":{...} of the slots completed in the last p_nSec, for an access-log summary.
+void mi_stats_summary(std::string& p_line, int p_nSec);
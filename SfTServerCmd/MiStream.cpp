@@ -0,0 +1,224 @@
+#include "MiStream.h"
+#include "MiBackend.h"
+#include "MiConf.h"
+#include "MiConfig.h"
+#include "MiImage.h"
+#include "MiInference.h"
+#include "MiLanes.h"
+#include "MiLicense.h"
+#include "MiMeta.h"
+#include "MiMetrics.h"
+#include "MiSdkCall.h"
+#include "MiSettings.h"
+#include "Poco/Buffer.h"
+#include "Poco/NumberParser.h"
+#include "Poco/URI.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Net/WebSocket.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using Poco::Net::WebSocket;
+
+static std::atomic<int> lv_nActive(0);
+
+int mi_stream_active()
+{
+	return lv_nActive.load(std::memory_order_relaxed);
+}
+
+//. one session : the handler thread receives, the checker thread evaluates the newest frame.
+class StreamSession {
+public:
+	StreamSession(WebSocket& p_ws, ResultSchema p_schema, const CMeta_t* p_pMeta, int p_nFusion)
+		: m_ws(p_ws), m_schema(p_schema), m_pMeta(p_pMeta), m_nFusion(p_nFusion), m_nSeq(-1), m_bPending(false), m_bStop(false) {}
+
+	~StreamSession()
+	{
+		for (size_t i = 0; i < m_window.size(); i++) face_sdk_api().image_destroy(m_window[i]);
+	}
+
+	void run()
+	{
+		std::thread checker(&StreamSession::check_loop, this);
+		try {
+			receive_loop();
+		}
+		catch (Poco::Exception&) {
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bStop = true;
+		}
+		m_cv.notify_all();
+		checker.join();
+	}
+
+private:
+	void receive_loop()
+	{
+		auto tStart = std::chrono::steady_clock::now();
+		Poco::Buffer<char> buf(0);
+		for (;;) {
+			int flags = 0;
+			buf.resize(0);
+			int n = m_ws.receiveFrame(buf, flags);
+			int op = flags & WebSocket::FRAME_OP_BITMASK;
+			if (n == 0 && flags == 0) return;
+			if (op == WebSocket::FRAME_OP_CLOSE) {
+				send(buf.begin(), n, WebSocket::FRAME_FLAG_FIN | WebSocket::FRAME_OP_CLOSE);
+				return;
+			}
+			if (op == WebSocket::FRAME_OP_PING) {
+				send(buf.begin(), n, WebSocket::FRAME_FLAG_FIN | WebSocket::FRAME_OP_PONG);
+				continue;
+			}
+			if (op != WebSocket::FRAME_OP_BINARY || n <= 0) continue;
+
+			uint64_t ts = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - tStart).count();
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if (m_bPending) mi_metrics_stream_drop();
+			m_latest.assign(buf.begin(), (size_t)n);
+			m_nLatestTs = ts;
+			m_nSeq++;
+			m_bPending = true;
+			m_cv.notify_one();
+		}
+	}
+
+	void check_loop()
+	{
+		std::string frame;
+		for (;;) {
+			int64_t seq;
+			uint64_t ts;
+			{
+				std::unique_lock<std::mutex> lock(m_mtx);
+				m_cv.wait(lock, [this]() { return m_bStop || m_bPending; });
+				if (m_bStop) return;
+				frame.swap(m_latest);
+				seq = m_nSeq;
+				ts = m_nLatestTs;
+				m_bPending = false;
+			}
+
+			char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+			int err = OK;
+			ResultExtra extra;
+			extra.index = (int)seq;
+			CPipelineResult_t result;
+			memset(&result, 0, sizeof(result));
+			try {
+				RequestTimer reqTimer(MI_EP_STREAM);
+				LanePermit permit(MI_LANE_INTERACTIVE);
+				if (m_nFusion > 1) {
+					result = check_fused(frame, ts, &err, msg);
+					extra.frames = (int)m_window.size();
+				}
+				else {
+					result = g_pBackend->check((const uint8_t*)frame.data(), frame.size(), m_pMeta, &err, msg);
+				}
+				mi_metrics_status(err);
+			}
+			catch (Poco::Exception& ex) {
+				//. plain text like the 409 bodies of the HTTP endpoints.
+				const std::string& text = ex.displayText();
+				if (!send(text.data(), (int)text.size(), WebSocket::FRAME_TEXT)) return;
+				continue;
+			}
+
+			ArenaString out;
+			out.reserve(GD_RESULT_JSON_RESERVE);
+			mi_json_result(m_schema, out, result, err, msg, extra);
+			if (!send(out.data(), (int)out.size(), WebSocket::FRAME_TEXT)) return;
+		}
+	}
+
+	//. adds the frame to the window (dropping the oldest) and fuses the window.
+	CPipelineResult_t check_fused(const std::string& p_strFrame, uint64_t p_nTs, int* p_pErr, char* p_pszMsg)
+	{
+		CPipelineResult_t result;
+		memset(&result, 0, sizeof(result));
+		StageTimer tCreate(MI_STAGE_IMAGE_CREATE);
+		mi_image_count_decode(NULL);
+		CImage_t* image = FaceSdk::image_create_bytes((const uint8_t*)p_strFrame.data(), p_strFrame.size(), p_pErr, p_pszMsg);
+		tCreate.stop();
+		if (image == NULL) return result;
+
+		m_window.push_back(image);
+		m_timestamps.push_back(p_nTs);
+		if ((int)m_window.size() > m_nFusion) {
+			face_sdk_api().image_destroy(m_window.front());
+			m_window.pop_front();
+			m_timestamps.pop_front();
+		}
+
+		std::vector<CImage_t*> images(m_window.begin(), m_window.end());
+		std::vector<uint64_t> timestamps(m_timestamps.begin(), m_timestamps.end());
+		StageTimer tLiveness(MI_STAGE_LIVENESS);
+		return mi_check_liveness_sequence(images.data(), images.size(), timestamps.data(), m_pMeta, p_pErr, p_pszMsg);
+	}
+
+	bool send(const void* p_pData, int p_nLen, int p_nFlags)
+	{
+		std::lock_guard<std::mutex> lock(m_sendMtx);
+		try {
+			m_ws.sendFrame(p_pData, p_nLen, p_nFlags);
+			return true;
+		}
+		catch (Poco::Exception&) {
+			return false;
+		}
+	}
+
+	WebSocket&					m_ws;
+	ResultSchema				m_schema;
+	const CMeta_t*				m_pMeta;
+	int							m_nFusion;
+
+	std::mutex					m_mtx;
+	std::condition_variable		m_cv;
+	std::string					m_latest;		//. newest frame not yet checked
+	uint64_t					m_nLatestTs;
+	int64_t						m_nSeq;
+	bool						m_bPending;
+	bool						m_bStop;
+
+	std::mutex					m_sendMtx;
+
+	//. checker thread only
+	std::deque<CImage_t*>		m_window;
+	std::deque<uint64_t>		m_timestamps;
+};
+
+void mi_stream_serve(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, ResultSchema p_schema)
+{
+	int nFusion = g_Settings.streamFusionFrames;
+	Poco::URI uri(p_request.getURI());
+	Poco::URI::QueryParameters params = uri.getQueryParameters();
+	for (size_t i = 0; i < params.size(); i++) {
+		if (params[i].first == "fusion") Poco::NumberParser::tryParse(params[i].second, nFusion);
+	}
+	if (nFusion > GD_STREAM_FUSION_MAX) nFusion = GD_STREAM_FUSION_MAX;
+
+	//. throws WebSocketException (answered by the caller) when the upgrade is not valid.
+	WebSocket ws(p_request, p_response);
+	ws.setMaxPayloadSize(mi_config().maxBodyMb * 1024 * 1024);
+	ws.setReceiveTimeout(Poco::Timespan(g_Settings.streamIdleSec, 0));
+
+	lv_nActive.fetch_add(1, std::memory_order_relaxed);
+	{
+		StreamSession session(ws, p_schema, mi_meta_of(p_request), nFusion);
+		session.run();
+	}
+	lv_nActive.fetch_sub(1, std::memory_order_relaxed);
+	try {
+		ws.shutdown();
+	}
+	catch (Poco::Exception&) {
+	}
+}
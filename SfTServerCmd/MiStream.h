@@ -0,0 +1,23 @@
+#pragma once
+
+#include "MiResultJson.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+//. GD_API_STREAM : WebSocket for continuous camera feeds ([stream]). The client sends
+//. every frame (JPEG / PNG ...) as one binary message and gets one text message with
+//. the result JSON per frame the server evaluated; "index" is the frame number.
+//. A failed check sends the error text instead of a result.
+//. Frames that arrive while a check runs replace each other : only the newest one is
+//. checked next, the others are dropped (mi_stream_dropped_frames_total) so the
+//. verdicts never lag behind the camera.
+//. With ?fusion=N (or stream.fusion_frames) every verdict fuses the last N checked
+//. frames with pipeline_check_liveness_batch, "frames" tells how many were used;
+//. fusion runs on the legacy API whatever [backend] engine says.
+//. Classic server mode only : the reactor buffers responses and cannot hand over its socket.
+
+//. runs the whole session on the handler thread; returns when the client closes.
+void mi_stream_serve(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response, ResultSchema p_schema);
+
+//. sessions open right now.
+int mi_stream_active();
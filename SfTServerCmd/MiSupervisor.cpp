@@ -0,0 +1,287 @@
+#include "MiSupervisor.h"
+#include "MiPhash.h"
+#include "MiPipelinePool.h"
+#include "MiResultCache.h"
+#include "MiSettings.h"
+#include "MiWarmup.h"
+#include "licenseproc.h"
+#include "Poco/Delegate.h"
+#include "Poco/File.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+PipelineSupervisor g_Supervisor;
+
+PipelineSupervisor::PipelineSupervisor()
+	: m_nGeneration(1), m_nRequested(0), m_bReload(false), m_bPromote(false), m_nCanaryGeneration(0), m_nCanaryPercent(0), m_nCanaryCalls(0),
+	m_bBusy(false), m_bStop(false)
+{
+}
+
+void PipelineSupervisor::start()
+{
+	MiLockGuard lock(m_mtx);
+	if (m_thread.joinable()) return;
+	std::atomic_store(&m_current, std::make_shared<PipelineHandle>(g_pPipeline, m_nGeneration.load()));
+	m_bStop = false;
+	m_nCanaryPercent = std::min(std::max(g_Settings.reloadCanaryPercent, 0), 100);
+	m_thread = std::thread(&PipelineSupervisor::run, this);
+
+	if (g_Settings.reloadWatch) {
+		std::string dir = g_Settings.reloadWatchDir.empty() ? g_Settings.configDir : g_Settings.reloadWatchDir;
+		try {
+			if (Poco::File(dir).isDirectory()) {
+				m_pWatcher.reset(new Poco::DirectoryWatcher(dir,
+					Poco::DirectoryWatcher::DW_ITEM_ADDED | Poco::DirectoryWatcher::DW_ITEM_MODIFIED | Poco::DirectoryWatcher::DW_ITEM_MOVED_TO));
+				m_pWatcher->itemAdded += Poco::delegate(this, &PipelineSupervisor::on_dir_event);
+				m_pWatcher->itemModified += Poco::delegate(this, &PipelineSupervisor::on_dir_event);
+				m_pWatcher->itemMovedTo += Poco::delegate(this, &PipelineSupervisor::on_dir_event);
+				std::cout << "Reload : watching " << dir << std::endl;
+			}
+			else {
+				std::cout << "Reload : " << dir << " is not a directory, watcher disabled" << std::endl;
+			}
+		}
+		catch (const Poco::Exception& e) {
+			std::cout << "Reload : cannot watch " << dir << " : " << e.displayText() << std::endl;
+		}
+	}
+}
+
+void PipelineSupervisor::stop()
+{
+	m_pWatcher.reset();
+	{
+		MiLockGuard lock(m_mtx);
+		m_bStop = true;
+	}
+	m_cv.notify_all();
+	if (m_thread.joinable()) m_thread.join();
+	rollback();
+	std::atomic_store(&m_current, PipelineRef());
+	g_pPipeline = NULL;
+}
+
+void PipelineSupervisor::report(const PipelineRef& p_used)
+{
+	if (p_used && p_used->generation == m_nCanaryGeneration) {
+		std::cout << "Canary generation " << p_used->generation << " had a license error, rolled back" << std::endl;
+		rollback();
+		return;
+	}
+	{
+		MiLockGuard lock(m_mtx);
+		//. a reference from an older generation is already being replaced.
+		if (!p_used || p_used->generation != m_nGeneration || m_nRequested == m_nGeneration) return;
+		m_nRequested = m_nGeneration;
+	}
+	m_cv.notify_all();
+}
+
+void PipelineSupervisor::reload(int p_nDelayMs)
+{
+	{
+		MiLockGuard lock(m_mtx);
+		m_bReload = true;
+		m_tReloadAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(p_nDelayMs > 0 ? p_nDelayMs : 0);
+	}
+	m_cv.notify_all();
+}
+
+PipelineRef PipelineSupervisor::canary()
+{
+	if (m_nCanaryGeneration.load(std::memory_order_relaxed) == 0) return PipelineRef();
+	uint64_t pct = (uint64_t)m_nCanaryPercent.load(std::memory_order_relaxed);
+	uint64_t n = m_nCanaryCalls.fetch_add(1, std::memory_order_relaxed);
+	//. every call advances the count, the canary gets one each time it crosses another 100 %.
+	if ((n + 1) * pct / 100 == n * pct / 100) return PipelineRef();
+	return std::atomic_load(&m_canary);
+}
+
+void PipelineSupervisor::set_canary_percent(int p_nPercent)
+{
+	m_nCanaryPercent = std::min(std::max(p_nPercent, 0), 100);
+}
+
+void PipelineSupervisor::promote()
+{
+	{
+		MiLockGuard lock(m_mtx);
+		m_bPromote = true;
+	}
+	m_cv.notify_all();
+}
+
+void PipelineSupervisor::rollback()
+{
+	m_nCanaryGeneration = 0;
+	std::atomic_store(&m_canary, PipelineRef());
+}
+
+bool PipelineSupervisor::reloading()
+{
+	MiLockGuard lock(m_mtx);
+	return m_bReload || m_bPromote || m_bBusy;
+}
+
+std::string PipelineSupervisor::last_error()
+{
+	MiLockGuard lock(m_mtx);
+	return m_strLastError;
+}
+
+void PipelineSupervisor::on_dir_event(const void* p_pSender, const Poco::DirectoryWatcher::DirectoryEvent& p_event)
+{
+	//. an SDK data drop writes several files; wait for it to settle.
+	reload(g_Settings.reloadDebounceMs);
+}
+
+void PipelineSupervisor::run()
+{
+	MiUniqueLock lock(m_mtx);
+	while (!m_bStop) {
+		bool license = (m_nRequested == m_nGeneration);
+		bool reload = m_bReload && std::chrono::steady_clock::now() >= m_tReloadAt;
+		if (!license && !reload && m_bPromote) {
+			m_bPromote = false;
+			m_bBusy = true;
+			lock.unlock();
+			promote_canary();
+			lock.lock();
+			m_bBusy = false;
+			continue;
+		}
+		if (!license && !reload) {
+			if (m_bReload) m_cv.wait_until(lock, m_tReloadAt);
+			else m_cv.wait(lock);
+			continue;
+		}
+		//. a license rebuild is served first; a reload is not consumed by it.
+		if (!license) m_bReload = false;
+		m_bBusy = true;
+		lock.unlock();
+		bool ok = rebuild(!license);
+		lock.lock();
+		m_bBusy = false;
+		//. a failed license rebuild waits for the next report.
+		if (license && !ok) m_nRequested = 0;
+	}
+}
+
+bool PipelineSupervisor::rebuild(bool p_bReload)
+{
+	char	msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	int		err = OK;
+
+	auto start = std::chrono::steady_clock::now();
+	//. a canary holds the number after the generation until it is promoted or replaced.
+	unsigned int next = std::max(m_nGeneration.load(), m_nCanaryGeneration.load()) + 1;
+	ConfigRef config;
+	PipelineRef global;
+
+	if (p_bReload) {
+		//. the new generation reads the SDK data again and owns its config.
+		CInitConfig_t* c = face_sdk_api().config_create(g_Settings.configDir.c_str(), g_Settings.configName.c_str(), &err, msg);
+		if (c == NULL) {
+			MiLockGuard lock(m_mtx);
+			m_strLastError = std::string("config_create : ") + msg;
+			std::cout << "Reload failed, generation " << m_nGeneration << " kept : " << m_strLastError << std::endl;
+			return false;
+		}
+		config = std::make_shared<ConfigHandle>(c);
+		CPipeline_t* p = face_sdk_api().pipeline_create(g_Settings.pipelineName.c_str(), config->config, &err, msg);
+		if (p == NULL) {
+			MiLockGuard lock(m_mtx);
+			m_strLastError = std::string("pipeline_create : ") + msg;
+			std::cout << "Reload failed, generation " << m_nGeneration << " kept : " << m_strLastError << std::endl;
+			return false;
+		}
+		global = std::make_shared<PipelineHandle>(p, next, config);
+
+		if (m_nCanaryPercent > 0) {
+			mi_warmup_pipelines(std::vector<CPipeline_t*>(1, p));
+			std::atomic_store(&m_canary, global);
+			m_nCanaryGeneration = next;
+			{
+				MiLockGuard lock(m_mtx);
+				m_strLastError.clear();
+			}
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "Pipeline generation " << next << " built as canary for " << m_nCanaryPercent << " % of the checks in " << ms << " ms" << std::endl;
+			return true;
+		}
+		//. reloaded with canaries off, a canary left from before goes.
+		rollback();
+	}
+	else {
+		//. setting_init reinstalls the license and builds a fresh g_pPipeline; the old
+		//. instance stays alive in the handles still held by requests. Those handles are its
+		//. only owner : setting_init starts from NULL, so it cannot release or reuse it.
+		PipelineRef old = current();
+		g_pPipeline = NULL;
+		setting_init(1);
+		face_sdk_api_refresh();
+		if (g_pPipeline == NULL || (old && g_pPipeline == old->pipeline)) {
+			g_pPipeline = old ? old->pipeline : NULL;
+			return false;
+		}
+		global = std::make_shared<PipelineHandle>(g_pPipeline, next);
+	}
+
+	if (!install(global, config, p_bReload)) return false;
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Pipeline generation " << next << (p_bReload ? " reloaded" : " rebuilt after license error") << " in " << ms << " ms" << std::endl;
+	return true;
+}
+
+bool PipelineSupervisor::install(const PipelineRef& p_global, const ConfigRef& p_config, bool p_bAll)
+{
+	unsigned int next = p_global->generation;
+	std::vector<PipelineRef> slots;
+	if (g_pPool != NULL) {
+		//. a reload is all or nothing; a license rebuild keeps a slot that cannot be rebuilt.
+		if (!g_pPool->build(p_global, p_config, slots) && p_bAll) {
+			MiLockGuard lock(m_mtx);
+			m_strLastError = "pipeline_create failed for a pool slot";
+			std::cout << "Reload failed, generation " << m_nGeneration << " kept : " << m_strLastError << std::endl;
+			return false;
+		}
+	}
+	else {
+		slots.push_back(p_global);
+	}
+
+	//. the new instances take their first-inference cost here, not on live traffic.
+	std::vector<CPipeline_t*> fresh;
+	for (auto& ref : slots) if (ref && ref->generation == next && !(ref == p_global && next == m_nCanaryGeneration)) fresh.push_back(ref->pipeline);
+	mi_warmup_pipelines(fresh);
+
+	if (g_pPool != NULL) g_pPool->swap(slots, p_config);
+	std::atomic_store(&m_current, p_global);
+	g_pPipeline = p_global->pipeline;
+	{
+		MiLockGuard lock(m_mtx);
+		m_nGeneration = next;
+		if (p_bAll) m_strLastError.clear();
+	}
+	//. verdicts of the old generation are not served for the rest of their TTL; checks still
+	//. running on it see the generation change and do not store theirs (MIServer.cpp).
+	if (g_pResultCache != NULL) g_pResultCache->clear();
+	mi_phash_clear();
+	return true;
+}
+
+bool PipelineSupervisor::promote_canary()
+{
+	auto start = std::chrono::steady_clock::now();
+	PipelineRef canary = std::atomic_load(&m_canary);
+	if (!canary) return false;
+	//. the canary keeps its share of the checks until the generation is swapped.
+	if (!install(canary, canary->config, true)) return false;
+	if (m_nCanaryGeneration == canary->generation) rollback();
+
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Pipeline generation " << canary->generation << " promoted from canary in " << ms << " ms" << std::endl;
+	return true;
+}
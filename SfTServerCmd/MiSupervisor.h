@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include "FaceSdkApi.h"
+#include "Poco/DirectoryWatcher.h"
+#include "MiLock.h"
+
+//. CInitConfig_t shared by the pipelines built from it.
+struct ConfigHandle {
+	CInitConfig_t*	config;
+
+	explicit ConfigHandle(CInitConfig_t* p_pConfig) : config(p_pConfig) {}
+	~ConfigHandle() { if (config != NULL) face_sdk_api().config_destroy(config); }
+};
+typedef std::shared_ptr<ConfigHandle> ConfigRef;
+
+//. One CPipeline_t shared by reference. The pipeline is destroyed with the last
+//. reference, so a replaced instance lives until its in-flight inferences drain.
+struct PipelineHandle {
+	CPipeline_t*	pipeline;
+	unsigned int	generation;		//. rebuild count it was built in
+	ConfigRef		config;			//. NULL for the pipeline built by setting_init
+
+	PipelineHandle(CPipeline_t* p_pPipeline, unsigned int p_nGeneration, const ConfigRef& p_config = ConfigRef())
+		: pipeline(p_pPipeline), generation(p_nGeneration), config(p_config) {}
+	~PipelineHandle() { if (pipeline != NULL) face_sdk_api().pipeline_destroy(pipeline); }
+};
+typedef std::shared_ptr<PipelineHandle> PipelineRef;
+
+//. Owns the current generation of pipelines (the global one and the pool slots) and
+//. replaces it off the request path :
+//. - license error : a request reports the pipeline it used and returns; the rebuild
+//.   goes through setting_init.
+//. - reload (GD_API_ADMIN_RELOAD or the [reload] directory watcher) : a new
+//.   CInitConfig_t is read from sdk.config_dir / sdk.config_name.
+//. Every new generation is built and warmed up on the supervisor thread, then swapped
+//. in atomically; old instances are destroyed by their last user.
+//. Canary ([reload] canary_percent > 0) : a reload does not replace the generation but
+//. builds the new one as a single canary pipeline next to it, and canary() hands it to
+//. that share of the checks (MiInference.h), which run on it alone, outside the batcher
+//. and the pool. promote() makes it the generation (the pool slots are built from its
+//. config then), rollback() drops it, and so does a license error on it; a later reload
+//. replaces it. The percentage can be changed on GD_API_ADMIN_RELOAD to ramp it up.
+//. mi_generation_checks_total / mi_generation_duration_seconds{role} compare the two.
+class PipelineSupervisor {
+public:
+	PipelineSupervisor();
+
+	//. takes ownership of g_pPipeline built by setting_init : from here on the handles
+	//. (m_current, pool slot 0 shares it) are the only owner, g_pPipeline only a view.
+	void start();
+	void stop();
+
+	PipelineRef current() const { return std::atomic_load(&m_current); }
+	unsigned int generation() const { return m_nGeneration; }
+
+	//. p_used returned a license error. Rebuilds once per generation, never blocks.
+	void report(const PipelineRef& p_used);
+
+	//. schedules a reload p_nDelayMs from now; later calls inside the delay push it back.
+	void reload(int p_nDelayMs = 0);
+
+	//. the canary for a call that is routed to it, else NULL. One relaxed load without a canary.
+	PipelineRef canary();
+	unsigned int canary_generation() const { return m_nCanaryGeneration; }
+	int canary_percent() const { return m_nCanaryPercent; }
+	void set_canary_percent(int p_nPercent);
+	//. the canary becomes the generation, on the supervisor thread.
+	void promote();
+	void rollback();
+
+	bool reloading();
+	std::string last_error();
+
+private:
+	void run();
+	bool rebuild(bool p_bReload);
+	//. pool slots for p_global, warm-up and swap; p_bAll fails when a slot cannot be built.
+	bool install(const PipelineRef& p_global, const ConfigRef& p_config, bool p_bAll);
+	bool promote_canary();
+	void on_dir_event(const void* p_pSender, const Poco::DirectoryWatcher::DirectoryEvent& p_event);
+
+	PipelineRef					m_current;
+	std::atomic<unsigned int>	m_nGeneration;
+	unsigned int				m_nRequested;		//. generation reported broken, 0 = none
+	bool						m_bReload;
+	bool						m_bPromote;
+	PipelineRef					m_canary;			//. atomic_load / atomic_store
+	std::atomic<unsigned int>	m_nCanaryGeneration;	//. 0 = no canary
+	std::atomic<int>			m_nCanaryPercent;
+	std::atomic<uint64_t>		m_nCanaryCalls;
+	bool						m_bBusy;
+	bool						m_bStop;
+	std::chrono::steady_clock::time_point m_tReloadAt;
+	std::string					m_strLastError;
+
+	MI_MUTEX(m_mtx, "supervisor");
+	MiCondition					m_cv;
+	std::thread					m_thread;
+	std::unique_ptr<Poco::DirectoryWatcher> m_pWatcher;
+};
+
+extern PipelineSupervisor g_Supervisor;
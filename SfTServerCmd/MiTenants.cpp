@@ -0,0 +1,225 @@
+#include "MiTenants.h"
+#include "MiConf.h"
+#include "MiContext.h"
+#include "MiHeaders.h"
+#include "MiMetrics.h"
+#include "Poco/NumberParser.h"
+#include "Poco/StringTokenizer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#define LD_TOKEN		1000000LL		//. one request in bucket units
+#define LD_MAX_SHARDS	16
+
+//. one core's part of a bucket.
+struct alignas(64) BucketShard {
+	std::atomic<int64_t>	tokens;		//. LD_TOKEN units
+	std::atomic<int64_t>	last;		//. ns of the last refill
+};
+
+struct Tenant {
+	std::string				name;
+	int64_t					capacity;	//. per shard, LD_TOKEN units, 0 = no rate limit
+	double					perNs;		//. refill per shard, LD_TOKEN units per ns
+	int						retryAfterSec;
+	int						concurrency;	//. 0 = unlimited
+	std::atomic<int>		inflight;
+	std::unique_ptr<BucketShard[]>	shards;
+
+	Tenant() : capacity(0), perNs(0.0), retryAfterSec(1), concurrency(0), inflight(0) {}
+};
+
+static bool											lv_bEnabled = false;
+static bool											lv_bRequireKey = false;
+static int											lv_nShards = 1;
+static std::vector<std::unique_ptr<Tenant>>			lv_vTenants;		//. [0] = default
+static std::vector<std::string>						lv_vNames;
+static std::unordered_map<std::string, int>			lv_mapKeys;			//. X-Api-Key -> tenant
+static std::atomic<int>								lv_nNextShard(0);
+
+static thread_local int		lv_nShard = -1;
+static thread_local bool	lv_bPrecharged = false;
+
+static int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static Tenant* make_tenant(const std::string& p_strName, int p_nRate, int p_nBurst, int p_nConcurrency)
+{
+	Tenant* t = new Tenant;
+	t->name = p_strName;
+	t->concurrency = p_nConcurrency > 0 ? p_nConcurrency : 0;
+	if (p_nRate > 0) {
+		int burst = p_nBurst > 0 ? p_nBurst : p_nRate;
+		//. every shard holds at least one request.
+		t->capacity = std::max<int64_t>(LD_TOKEN, (int64_t)burst * LD_TOKEN / lv_nShards);
+		t->perNs = (double)p_nRate * LD_TOKEN / lv_nShards / 1e9;
+		t->retryAfterSec = std::max(1, (lv_nShards + p_nRate - 1) / p_nRate);
+	}
+	t->shards.reset(new BucketShard[lv_nShards]);
+	int64_t now = now_ns();
+	for (int i = 0; i < lv_nShards; i++) {
+		t->shards[i].tokens.store(t->capacity, std::memory_order_relaxed);
+		t->shards[i].last.store(now, std::memory_order_relaxed);
+	}
+	return t;
+}
+
+void mi_tenants_init(bool p_bRequireKey, int p_nRate, int p_nBurst, int p_nConcurrency, const std::string& p_strList)
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	lv_nShards = std::max(1, std::min<int>(cores > 0 ? (int)cores : 1, LD_MAX_SHARDS));
+	lv_bRequireKey = p_bRequireKey;
+	lv_vTenants.clear();
+	lv_vNames.clear();
+	lv_mapKeys.clear();
+	lv_vTenants.emplace_back(make_tenant("default", p_nRate, p_nBurst, p_nConcurrency));
+
+	Poco::StringTokenizer items(p_strList, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : items) {
+		Poco::StringTokenizer f(item, ":", Poco::StringTokenizer::TOK_TRIM);
+		if (f.count() < 2 || f[0].empty() || f[1].empty()) continue;
+		int rate = 0, burst = 0, conc = 0;
+		if (f.count() > 2) Poco::NumberParser::tryParse(f[2], rate);
+		if (f.count() > 3) Poco::NumberParser::tryParse(f[3], burst);
+		if (f.count() > 4) Poco::NumberParser::tryParse(f[4], conc);
+		//. several keys may name one tenant, the first line sets its limits.
+		int idx = -1;
+		for (size_t i = 1; i < lv_vTenants.size(); i++) {
+			if (lv_vTenants[i]->name == f[0]) idx = (int)i;
+		}
+		if (idx < 0) {
+			idx = (int)lv_vTenants.size();
+			lv_vTenants.emplace_back(make_tenant(f[0], rate, burst, conc));
+		}
+		lv_mapKeys[f[1]] = idx;
+	}
+	for (auto& t : lv_vTenants) lv_vNames.push_back(t->name);
+	mi_metrics_tenants(lv_vNames);
+	lv_bEnabled = true;
+}
+
+const std::vector<std::string>& mi_tenant_names()
+{
+	return lv_vNames;
+}
+
+//. -1 = unknown key while keys are required.
+static int tenant_of(const Poco::Net::HTTPRequest& p_request)
+{
+	const std::string& key = p_request.get(GD_LANE_KEY_HEADER, Poco::Net::HTTPMessage::EMPTY);
+	if (!key.empty()) {
+		auto it = lv_mapKeys.find(key);
+		if (it != lv_mapKeys.end()) return it->second;
+	}
+	return lv_bRequireKey ? -1 : 0;
+}
+
+static bool take_shard(Tenant& p_t, BucketShard& p_s, int64_t p_lNow)
+{
+	//. whoever moves last forward adds the tokens of the elapsed time.
+	int64_t last = p_s.last.load(std::memory_order_relaxed);
+	if (p_lNow > last && p_s.last.compare_exchange_strong(last, p_lNow, std::memory_order_relaxed)) {
+		int64_t add = (int64_t)((double)(p_lNow - last) * p_t.perNs);
+		int64_t cur = p_s.tokens.load(std::memory_order_relaxed);
+		while (add > 0 && cur < p_t.capacity && !p_s.tokens.compare_exchange_weak(cur, std::min(p_t.capacity, cur + add), std::memory_order_relaxed)) {}
+	}
+	int64_t cur = p_s.tokens.load(std::memory_order_relaxed);
+	while (cur >= LD_TOKEN) {
+		if (p_s.tokens.compare_exchange_weak(cur, cur - LD_TOKEN, std::memory_order_relaxed)) return true;
+	}
+	return false;
+}
+
+static bool take_token(Tenant& p_t)
+{
+	if (p_t.capacity == 0) return true;
+	if (lv_nShard < 0) lv_nShard = lv_nNextShard.fetch_add(1, std::memory_order_relaxed) % lv_nShards;
+	int64_t now = now_ns();
+	for (int i = 0; i < lv_nShards; i++) {
+		if (take_shard(p_t, p_t.shards[(lv_nShard + i) % lv_nShards], now)) return true;
+	}
+	return false;
+}
+
+//. p_nTenant resolved and rate charged; false with status / Retry-After.
+static bool charge(const Poco::Net::HTTPRequest& p_request, int* p_pTenant, int* p_pStatus, int* p_pRetryAfterSec)
+{
+	*p_pTenant = tenant_of(p_request);
+	*p_pRetryAfterSec = 0;
+	if (*p_pTenant < 0) {
+		mi_metrics_tenant(-1, MI_TENANT_UNAUTHORIZED);
+		*p_pStatus = Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED;
+		return false;
+	}
+	Tenant& t = *lv_vTenants[*p_pTenant];
+	if (!take_token(t)) {
+		mi_metrics_tenant(*p_pTenant, MI_TENANT_RATE_LIMITED);
+		*p_pStatus = Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS;
+		*p_pRetryAfterSec = t.retryAfterSec;
+		return false;
+	}
+	return true;
+}
+
+bool mi_tenant_precheck(const Poco::Net::HTTPRequest& p_request, int* p_pStatus, int* p_pRetryAfterSec)
+{
+	if (!lv_bEnabled) return true;
+	int tenant;
+	return charge(p_request, &tenant, p_pStatus, p_pRetryAfterSec);
+}
+
+void mi_tenant_set_precharged(bool p_bCharged)
+{
+	lv_bPrecharged = p_bCharged;
+}
+
+TenantTicket::TenantTicket(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response)
+	: m_nTenant(-1), m_bAdmitted(true)
+{
+	if (!lv_bEnabled) return;
+
+	int tenant = 0, status = 0, retryAfter = 0;
+	bool bPrecharged = lv_bPrecharged;
+	lv_bPrecharged = false;
+	if (bPrecharged) tenant = tenant_of(p_request);
+	else if (!charge(p_request, &tenant, &status, &retryAfter)) {
+		m_bAdmitted = false;
+	}
+
+	if (m_bAdmitted) {
+		Tenant& t = *lv_vTenants[tenant];
+		int n = t.inflight.fetch_add(1, std::memory_order_acq_rel);
+		if (t.concurrency > 0 && n >= t.concurrency) {
+			t.inflight.fetch_sub(1, std::memory_order_acq_rel);
+			mi_metrics_tenant(tenant, MI_TENANT_CONCURRENCY);
+			status = Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS;
+			retryAfter = 1;
+			m_bAdmitted = false;
+		}
+		else {
+			m_nTenant = tenant;
+			mi_metrics_tenant(tenant, MI_TENANT_ADMITTED);
+			RequestContext* ctx = mi_context();
+			if (ctx != NULL) ctx->tenant = tenant;
+		}
+	}
+	if (m_bAdmitted) return;
+
+	p_response.setStatus((Poco::Net::HTTPResponse::HTTPStatus)status);
+	mi_headers_apply(p_response, MI_HEADERS_TEXT);
+	if (retryAfter > 0) p_response.set("Retry-After", std::to_string(retryAfter));
+	p_response.setKeepAlive(false);
+	const std::string& reason = Poco::Net::HTTPResponse::getReasonForStatus((Poco::Net::HTTPResponse::HTTPStatus)status);
+	p_response.sendBuffer(reason.data(), reason.size());
+}
+
+TenantTicket::~TenantTicket()
+{
+	if (m_nTenant >= 0) lv_vTenants[m_nTenant]->inflight.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+//. Tenants on the inference endpoints ([tenants]) : an X-Api-Key names the tenant, each
+//. tenant has a token bucket (requests per second + burst) and a cap on its requests in
+//. flight. Refused requests get 401 (unknown key with require_key) or 429 + Retry-After
+//. from the route, before the body is read; the reactor already refuses them from the
+//. header, before the upload is received.
+//. The buckets are lock free and split in one shard per core : a request thread takes
+//. from its own shard and only looks at the others when that one is empty, so tenants
+//. at high rates do not serialize on one cache line.
+//. Keys without a tenant (and requests without a key) share the "default" tenant.
+
+enum TenantResult {
+	MI_TENANT_ADMITTED = 0,
+	MI_TENANT_RATE_LIMITED,
+	MI_TENANT_CONCURRENCY,
+	MI_TENANT_UNAUTHORIZED,
+	MI_TENANT_RESULT_COUNT
+};
+
+//. p_strList : "name:key:rate:burst:concurrency, ..." (0 = unlimited); the default
+//. tenant uses p_nRate / p_nBurst / p_nConcurrency. Until this has run every request passes.
+void mi_tenants_init(bool p_bRequireKey, int p_nRate, int p_nBurst, int p_nConcurrency, const std::string& p_strList);
+
+//. tenant names by index, [0] = "default".
+const std::vector<std::string>& mi_tenant_names();
+
+//. reactor mode : charges the rate of the request from its header alone.
+//. false with the HTTP status and Retry-After seconds when it is refused.
+bool mi_tenant_precheck(const Poco::Net::HTTPRequest& p_request, int* p_pStatus, int* p_pRetryAfterSec);
+
+//. reactor mode : the request handled next on this thread was charged by mi_tenant_precheck.
+void mi_tenant_set_precharged(bool p_bCharged);
+
+//. holds the tenant's concurrency slot for one inference request.
+//. A refused ticket has already sent its 401 / 429.
+class TenantTicket {
+public:
+	TenantTicket(Poco::Net::HTTPServerRequest& p_request, Poco::Net::HTTPServerResponse& p_response);
+	~TenantTicket();
+
+	bool admitted() const { return m_bAdmitted; }
+
+private:
+	TenantTicket(const TenantTicket&) = delete;
+	TenantTicket& operator=(const TenantTicket&) = delete;
+
+	int		m_nTenant;		//. holding a slot, -1 = none
+	bool	m_bAdmitted;
+};
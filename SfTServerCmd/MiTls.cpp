@@ -0,0 +1,261 @@
+#include "MiTls.h"
+#include "MiConf.h"
+#include "MiConnection.h"
+#include "MiCpu.h"
+#include "MiSettings.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Net/ServerSocketImpl.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/StreamSocketImpl.h"
+#include "Poco/Exception.h"
+#include <chrono>
+#if MI_HAS_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+//. from MiMetrics.h, which pulls in the FaceSDK C API : its ThreadingLevel ENGINE
+//. collides with OpenSSL's ENGINE typedef.
+void mi_metrics_tls(int p_nOutcome, double p_dSec);
+
+const char* mi_tls_outcome_name(int p_nOutcome)
+{
+	switch (p_nOutcome) {
+	case MI_TLS_FULL: return "full";
+	case MI_TLS_RESUMED: return "resumed";
+	case MI_TLS_FAILED: return "failed";
+	default: return "unknown";
+	}
+}
+
+#if MI_HAS_OPENSSL
+static SSL_CTX*		lv_pCtx = NULL;
+static bool			lv_bAesNi = false;
+
+//. TLS 1.3 suites and TLS 1.2 ECDHE AEAD ciphers, fastest on the CPU first.
+#define LD_SUITES_AES		"TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256"
+#define LD_SUITES_CHACHA	"TLS_CHACHA20_POLY1305_SHA256:TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384"
+#define LD_CIPHERS_AES		"ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305"
+#define LD_CIPHERS_CHACHA	"ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384"
+#define LD_SESSION_CONTEXT	"SfTServerCmd"
+
+static std::string ssl_error(const char* p_pszWhat)
+{
+	char szBuf[256] = { 0 };
+	unsigned long nErr = ERR_get_error();
+	ERR_clear_error();
+	if (nErr == 0) return p_pszWhat;
+	ERR_error_string_n(nErr, szBuf, sizeof(szBuf));
+	return std::string(p_pszWhat) + " : " + szBuf;
+}
+
+//. one accepted TLS connection; the handshake runs on the first I/O, in the connection
+//. thread, so the accept loop never waits on a slow client.
+class TlsStreamSocketImpl : public Poco::Net::StreamSocketImpl {
+public:
+	TlsStreamSocketImpl(poco_socket_t p_fd, SSL_CTX* p_pCtx)
+		: Poco::Net::StreamSocketImpl(p_fd), m_pSsl(SSL_new(p_pCtx)), m_bDone(false)
+	{
+		if (m_pSsl == NULL) throw Poco::Net::NetException(ssl_error("SSL_new"));
+		SSL_set_fd(m_pSsl, (int)p_fd);
+	}
+
+	int sendBytes(const void* p_pBuf, int p_nLen, int) override
+	{
+		handshake();
+		if (p_nLen <= 0) return 0;
+		int n = SSL_write(m_pSsl, p_pBuf, p_nLen);
+		if (n <= 0) fail("SSL_write", n);
+		return n;
+	}
+	int sendBytes(const Poco::Net::SocketBufVec&, int) override
+	{
+		throw Poco::NotImplementedException("TLS socket : scatter send");
+	}
+
+	int receiveBytes(void* p_pBuf, int p_nLen, int) override
+	{
+		handshake();
+		if (p_nLen <= 0) return 0;
+		wait_readable();
+		int n = SSL_read(m_pSsl, p_pBuf, p_nLen);
+		if (n > 0) return n;
+		int nErr = SSL_get_error(m_pSsl, n);
+		if (nErr == SSL_ERROR_ZERO_RETURN) return 0;		//. close_notify
+		fail("SSL_read", n);
+		return 0;
+	}
+	int receiveBytes(Poco::Net::SocketBufVec&, int) override
+	{
+		throw Poco::NotImplementedException("TLS socket : scatter receive");
+	}
+	int receiveBytes(Poco::Buffer<char>&, int, const Poco::Timespan&) override
+	{
+		throw Poco::NotImplementedException("TLS socket : buffer receive");
+	}
+
+	//. decrypted bytes already held by OpenSSL count as readable.
+	int available() override
+	{
+		return m_bDone ? SSL_pending(m_pSsl) : 0;
+	}
+	bool poll(const Poco::Timespan& p_timeout, int p_nMode) override
+	{
+		if ((p_nMode & SELECT_READ) != 0 && available() > 0) return true;
+		return Poco::Net::StreamSocketImpl::poll(p_timeout, p_nMode);
+	}
+	bool secure() const override { return true; }
+
+	void shutdown() override
+	{
+		if (m_bDone) SSL_shutdown(m_pSsl);
+		Poco::Net::StreamSocketImpl::shutdown();
+	}
+	void close() override
+	{
+		if (m_pSsl != NULL && m_bDone && sockfd() != POCO_INVALID_SOCKET) SSL_shutdown(m_pSsl);
+		Poco::Net::StreamSocketImpl::close();
+	}
+
+protected:
+	~TlsStreamSocketImpl() override
+	{
+		if (m_pSsl != NULL) SSL_free(m_pSsl);
+	}
+
+private:
+	void handshake()
+	{
+		if (m_bDone) return;
+		auto start = std::chrono::steady_clock::now();
+		int n = SSL_accept(m_pSsl);
+		double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (n != 1) {
+			mi_metrics_tls(MI_TLS_FAILED, sec);
+			fail("SSL_accept", n);
+		}
+		m_bDone = true;
+		mi_metrics_tls(SSL_session_reused(m_pSsl) ? MI_TLS_RESUMED : MI_TLS_FULL, sec);
+	}
+
+	//. the HTTP layer's receive timeout, kept when the reads are inside OpenSSL.
+	void wait_readable()
+	{
+		if (SSL_pending(m_pSsl) > 0) return;
+		Poco::Timespan timeout = getReceiveTimeout();
+		if (timeout.totalMicroseconds() > 0 && !Poco::Net::StreamSocketImpl::poll(timeout, SELECT_READ)) {
+			throw Poco::TimeoutException("TLS socket : receive");
+		}
+	}
+
+	void fail(const char* p_pszWhat, int p_nRet)
+	{
+		int nErr = SSL_get_error(m_pSsl, p_nRet);
+		if (nErr == SSL_ERROR_WANT_READ || nErr == SSL_ERROR_WANT_WRITE) {
+			ERR_clear_error();
+			throw Poco::TimeoutException(std::string("TLS socket : ") + p_pszWhat);
+		}
+		if (nErr == SSL_ERROR_SYSCALL && ERR_peek_error() == 0) {
+			throw Poco::Net::ConnectionResetException(std::string("TLS socket : ") + p_pszWhat);
+		}
+		throw Poco::Net::NetException(ssl_error(p_pszWhat));
+	}
+
+	SSL*	m_pSsl;
+	bool	m_bDone;		//. handshake complete
+};
+
+class TlsServerSocketImpl : public Poco::Net::ServerSocketImpl {
+public:
+	Poco::Net::SocketImpl* acceptConnection(Poco::Net::SocketAddress& p_clientAddr) override
+	{
+		char buffer[Poco::Net::SocketAddress::MAX_ADDRESS_LENGTH];
+		struct sockaddr* pSA = reinterpret_cast<struct sockaddr*>(buffer);
+		poco_socklen_t nSaLen = sizeof(buffer);
+		poco_socket_t fd;
+		do {
+			fd = ::accept(sockfd(), pSA, &nSaLen);
+		} while (fd == POCO_INVALID_SOCKET && lastError() == POCO_EINTR);
+		if (fd == POCO_INVALID_SOCKET) error();
+		p_clientAddr = Poco::Net::SocketAddress(pSA, nSaLen);
+		TlsStreamSocketImpl* pImpl = new TlsStreamSocketImpl(fd, lv_pCtx);
+		pImpl->setReceiveTimeout(Poco::Timespan(g_Settings.tlsHandshakeSec, 0));
+		return pImpl;
+	}
+};
+
+//. ServerSocket(SocketImpl*, bool) is protected.
+class TlsServerSocket : public Poco::Net::ServerSocket {
+public:
+	TlsServerSocket() : Poco::Net::ServerSocket(new TlsServerSocketImpl, true) {}
+};
+#endif
+
+bool mi_tls_init(std::string& p_strErr)
+{
+#if MI_HAS_OPENSSL
+	if (lv_pCtx != NULL) return true;
+	SSL_CTX* pCtx = SSL_CTX_new(TLS_server_method());
+	if (pCtx == NULL) {
+		p_strErr = ssl_error("SSL_CTX_new");
+		return false;
+	}
+	lv_bAesNi = mi_cpu_has(MI_CPU_AES);
+	std::string strCiphers = !g_Settings.tlsCiphers.empty() ? g_Settings.tlsCiphers : (lv_bAesNi ? LD_CIPHERS_AES : LD_CIPHERS_CHACHA);
+
+	SSL_CTX_set_min_proto_version(pCtx, TLS1_2_VERSION);
+	//. our order wins, except that a client preferring ChaCha (no AES hardware) keeps it.
+	long nOptions = SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_PRIORITIZE_CHACHA | SSL_OP_NO_COMPRESSION | SSL_OP_NO_RENEGOTIATION;
+	if (!g_Settings.tlsTickets) nOptions |= SSL_OP_NO_TICKET;
+	SSL_CTX_set_options(pCtx, nOptions);
+	SSL_CTX_set_mode(pCtx, SSL_MODE_RELEASE_BUFFERS);
+
+	//. resumption : server-side cache by session id, tickets by the default OpenSSL key.
+	SSL_CTX_set_session_id_context(pCtx, (const unsigned char*)LD_SESSION_CONTEXT, sizeof(LD_SESSION_CONTEXT) - 1);
+	SSL_CTX_set_session_cache_mode(pCtx, g_Settings.tlsSessionCache > 0 ? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+	if (g_Settings.tlsSessionCache > 0) SSL_CTX_sess_set_cache_size(pCtx, g_Settings.tlsSessionCache);
+	SSL_CTX_set_timeout(pCtx, g_Settings.tlsSessionTimeoutSec);
+	SSL_CTX_set_num_tickets(pCtx, g_Settings.tlsTickets ? 1 : 0);
+
+	if (SSL_CTX_set_ciphersuites(pCtx, lv_bAesNi ? LD_SUITES_AES : LD_SUITES_CHACHA) != 1
+		|| SSL_CTX_set_cipher_list(pCtx, strCiphers.c_str()) != 1) {
+		p_strErr = ssl_error("tls.ciphers");
+	}
+	else if (SSL_CTX_use_certificate_chain_file(pCtx, g_Settings.tlsCert.c_str()) != 1) {
+		p_strErr = ssl_error(("tls.cert " + g_Settings.tlsCert).c_str());
+	}
+	else if (SSL_CTX_use_PrivateKey_file(pCtx, g_Settings.tlsKey.c_str(), SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(pCtx) != 1) {
+		p_strErr = ssl_error(("tls.key " + g_Settings.tlsKey).c_str());
+	}
+	if (!p_strErr.empty()) {
+		SSL_CTX_free(pCtx);
+		return false;
+	}
+	lv_pCtx = pCtx;
+	return true;
+#else
+	p_strErr = "built without OpenSSL (MI_HAS_OPENSSL)";
+	return false;
+#endif
+}
+
+Poco::Net::ServerSocket mi_tls_listen_socket()
+{
+#if MI_HAS_OPENSSL
+	TlsServerSocket socket;
+	socket.bind(Poco::Net::SocketAddress(Poco::Net::IPAddress(), (Poco::UInt16)g_Settings.tlsPort), true, mi_reuse_port());
+	socket.listen(g_Settings.listenBacklog > 0 ? g_Settings.listenBacklog : 64);
+	return socket;
+#else
+	throw Poco::NotImplementedException("built without OpenSSL (MI_HAS_OPENSSL)");
+#endif
+}
+
+const char* mi_tls_cipher_order()
+{
+#if MI_HAS_OPENSSL
+	return lv_bAesNi ? "aes-ni" : "chacha";
+#else
+	return "none";
+#endif
+}
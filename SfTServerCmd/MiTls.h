@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include "Poco/Net/ServerSocket.h"
+
+//. TLS termination ([tls]) on OpenSSL : a second classic-mode listener on tls.port that
+//. serves the same routes as server.port over HTTPS. The vendored Poco carries no NetSSL,
+//. so the listening socket hands out stream sockets that run SSL_accept on their first
+//. read or write (in the connection thread) and then SSL_read / SSL_write underneath the
+//. HTTP session.
+//. Returning clients skip the key exchange : tickets (RFC 5077 / TLS 1.3 PSK) when
+//. tls.tickets is on, the server session cache (tls.session_cache entries) for clients
+//. that present a session id. The cipher order follows the CPU : AES-GCM first when it
+//. has AES-NI, ChaCha20-Poly1305 first otherwise (and for clients that prefer it).
+//. Builds without OpenSSL (MI_HAS_OPENSSL = 0) refuse to start the listener.
+
+enum TlsOutcome {
+	MI_TLS_FULL = 0,		//. full handshake
+	MI_TLS_RESUMED,			//. abbreviated, from a ticket or the session cache
+	MI_TLS_FAILED,			//. handshake error or timeout
+	MI_TLS_COUNT
+};
+
+//. metric label of a TlsOutcome.
+const char* mi_tls_outcome_name(int p_nOutcome);
+
+//. loads tls.cert / tls.key into the server context; call once before mi_tls_listen_socket.
+bool mi_tls_init(std::string& p_strErr);
+//. bound and listening on tls.port, accepting TLS connections.
+Poco::Net::ServerSocket mi_tls_listen_socket();
+//. cipher order in use, for the startup line ("aes-ni" or "chacha").
+const char* mi_tls_cipher_order();
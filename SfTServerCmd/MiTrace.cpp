@@ -0,0 +1,201 @@
+#include "MiTrace.h"
+#include "MiConf.h"
+#include "MiContext.h"
+#include "MiOtlp.h"
+#include "MiPlatform.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define LD_RING_SIZE	GD_TRACE_RING_SIZE
+
+struct TraceSlot {
+	std::atomic<uint64_t>	seq;		//. odd while the writer fills the slot
+	const char*				name;
+	uint64_t				req;
+	int64_t					startUs;
+	int64_t					durUs;
+	TraceSlot() : seq(0), name(NULL), req(0), startUs(0), durUs(0) {}
+};
+
+struct TraceRing {
+	uint32_t				tid;
+	std::atomic<uint64_t>	head;
+	TraceSlot				slots[LD_RING_SIZE];
+	TraceRing() : tid(0), head(0) {}
+};
+
+static std::atomic<int>						lv_nSampleEvery(0);
+static std::atomic<bool>					lv_bFollowParent(false);
+static std::atomic<uint64_t>				lv_nRequests(0);
+static std::mutex							lv_mtxRings;		//. ring registration and dump only
+static std::vector<std::unique_ptr<TraceRing>>	lv_vRings;
+static const std::chrono::steady_clock::time_point lv_epoch = std::chrono::steady_clock::now();
+
+static thread_local TraceRing*	lv_pRing = NULL;
+static thread_local TraceState	lv_local;			//. request without a context
+
+static int64_t to_us(std::chrono::steady_clock::time_point p_t)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(p_t - lv_epoch).count();
+}
+
+static TraceRing* thread_ring()
+{
+	if (lv_pRing == NULL) {
+		//. rings outlive their threads so a dump never sees a dangling one.
+		std::unique_ptr<TraceRing> p(new TraceRing);
+		p->tid = mi_thread_id();
+		std::lock_guard<std::mutex> lock(lv_mtxRings);
+		lv_pRing = p.get();
+		lv_vRings.push_back(std::move(p));
+	}
+	return lv_pRing;
+}
+
+//. trace of the request on this thread, NULL when it is not sampled.
+static TraceState* current()
+{
+	RequestContext* ctx = mi_context();
+	TraceState* t = ctx != NULL ? &ctx->trace : &lv_local;
+	return t->req != 0 ? t : NULL;
+}
+
+static void record(TraceState& p_trace, const char* p_pszName, uint64_t p_nSpan, uint64_t p_nParent, int p_nKind,
+	std::chrono::steady_clock::time_point p_start, std::chrono::steady_clock::time_point p_end)
+{
+	TraceRing* r = thread_ring();
+	uint64_t h = r->head.load(std::memory_order_relaxed);
+	TraceSlot& s = r->slots[h % LD_RING_SIZE];
+
+	uint64_t seq = s.seq.load(std::memory_order_relaxed);
+	s.seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	s.name = p_pszName;
+	s.req = p_trace.req;
+	s.startUs = to_us(p_start);
+	s.durUs = to_us(p_end) - s.startUs;
+	s.seq.store(seq + 2, std::memory_order_release);
+
+	r->head.store(h + 1, std::memory_order_release);
+
+	if (!mi_otlp_enabled()) return;
+	OtlpSpan span;
+	span.traceHi = p_trace.traceHi;
+	span.traceLo = p_trace.traceLo;
+	span.spanId = p_nSpan;
+	span.parentId = p_nParent;
+	span.name = p_pszName;
+	span.kind = p_nKind;
+	span.startNs = mi_otlp_unix_ns(p_start);
+	span.endNs = mi_otlp_unix_ns(p_end);
+	mi_otlp_export(span);
+}
+
+void mi_trace_init(int p_nSampleEvery, bool p_bFollowParent)
+{
+	lv_nSampleEvery.store(p_nSampleEvery > 0 ? p_nSampleEvery : 0, std::memory_order_relaxed);
+	lv_bFollowParent.store(p_bFollowParent, std::memory_order_relaxed);
+}
+
+void mi_trace_begin(TraceState& p_trace, const std::string& p_strParent, std::chrono::steady_clock::time_point p_arrival)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	p_trace = TraceState();
+	p_trace.start = p_arrival != std::chrono::steady_clock::time_point() && p_arrival < now ? p_arrival : now;
+	bool bParent = !p_strParent.empty() && mi_traceparent_parse(p_strParent, p_trace.traceHi, p_trace.traceLo, p_trace.parent, p_trace.flags);
+	//. a caller that traces this request is followed, the others take their turn.
+	bool bSampled = bParent && (p_trace.flags & MI_TRACE_FLAG_SAMPLED) != 0 && lv_bFollowParent.load(std::memory_order_relaxed);
+	int every = lv_nSampleEvery.load(std::memory_order_relaxed);
+	uint64_t n = 0;
+	if (every > 0 || bSampled) n = lv_nRequests.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (!bSampled && every > 0 && n % (uint64_t)every == 0) bSampled = true;
+	if (!bParent && !bSampled) return;
+
+	//. an unsampled caller's trace still goes on through us, its flags unchanged.
+	if (!bParent) {
+		p_trace.traceHi = mi_trace_random_id();
+		p_trace.traceLo = mi_trace_random_id();
+		p_trace.flags = MI_TRACE_FLAG_SAMPLED;
+	}
+	p_trace.span = mi_trace_random_id();
+	if (!bSampled) return;
+	p_trace.req = n;
+	if (p_trace.start < now) record(p_trace, "queue", mi_trace_random_id(), p_trace.span, MI_OTLP_INTERNAL, p_trace.start, now);
+}
+
+void mi_trace_end(TraceState& p_trace)
+{
+	if (p_trace.req == 0) return;
+	record(p_trace, "request", p_trace.span, p_trace.parent, MI_OTLP_SERVER, p_trace.start, std::chrono::steady_clock::now());
+	p_trace.req = 0;
+}
+
+void mi_trace_request_begin()
+{
+	if (mi_context() == NULL) mi_trace_begin(lv_local, std::string(), std::chrono::steady_clock::time_point());
+}
+
+void mi_trace_request_end()
+{
+	if (mi_context() == NULL) mi_trace_end(lv_local);
+}
+
+bool mi_trace_active()
+{
+	RequestContext* ctx = mi_context();
+	return current() != NULL || (ctx != NULL && ctx->profile);
+}
+
+bool mi_trace_parent(char* p_psz, size_t p_nSize)
+{
+	RequestContext* ctx = mi_context();
+	const TraceState& t = ctx != NULL ? ctx->trace : lv_local;
+	if (t.span == 0) return false;
+	mi_traceparent_format(p_psz, p_nSize, t.traceHi, t.traceLo, t.span, t.flags);
+	return true;
+}
+
+void mi_trace_record(const char* p_pszName, std::chrono::steady_clock::time_point p_start, std::chrono::steady_clock::time_point p_end)
+{
+	//. a profiled request keeps its spans, sampled or not (MiRequestProfile.h).
+	RequestContext* ctx = mi_context();
+	if (ctx != NULL && ctx->profile) mi_request_profile_record(*ctx->profile, p_pszName, p_start, p_end);
+	TraceState* t = current();
+	if (t != NULL) record(*t, p_pszName, mi_trace_random_id(), t->span, MI_OTLP_INTERNAL, p_start, p_end);
+}
+
+void mi_trace_dump(std::ostream& p_out, int p_nSeconds)
+{
+	int64_t nowUs = to_us(std::chrono::steady_clock::now());
+	int64_t fromUs = nowUs - (int64_t)p_nSeconds * 1000000;
+	bool bFirst = true;
+
+	p_out << "{\"traceEvents\":[";
+
+	std::lock_guard<std::mutex> lock(lv_mtxRings);
+	for (auto& pRing : lv_vRings) {
+		uint64_t head = pRing->head.load(std::memory_order_acquire);
+		uint64_t n = head < LD_RING_SIZE ? head : LD_RING_SIZE;
+		for (uint64_t i = head - n; i < head; i++) {
+			TraceSlot& s = pRing->slots[i % LD_RING_SIZE];
+			uint64_t seq1 = s.seq.load(std::memory_order_acquire);
+			if (seq1 & 1) continue;
+			const char* name = s.name;
+			uint64_t req = s.req;
+			int64_t startUs = s.startUs;
+			int64_t durUs = s.durUs;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (s.seq.load(std::memory_order_relaxed) != seq1 || name == NULL) continue;
+			if (startUs + durUs < fromUs) continue;
+
+			if (!bFirst) p_out << ",";
+			bFirst = false;
+			p_out << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << pRing->tid
+				<< ",\"ts\":" << startUs << ",\"dur\":" << durUs
+				<< ",\"args\":{\"req\":" << req << "}}";
+		}
+	}
+	p_out << "],\"displayTimeUnit\":\"ms\"}";
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+//. Sampled per-request span recorder.
+//. Each thread writes its spans into its own fixed ring (no lock, a per-slot
+//. sequence number lets the reader skip a slot being overwritten). One request in
+//. [trace] sample_every is recorded, and with follow_parent every request whose W3C
+//. traceparent (MiOtlp.h, set by the mi_id_svc proxy or any traced client) is sampled;
+//. GD_API_TRACE dumps the recent spans in Chrome trace-event JSON for chrome://tracing
+//. or Perfetto. With [trace] otlp_endpoint the spans are exported too : the request is a
+//. server span, child of the caller's span when it sent one, and the stages, the SDK calls
+//. (MiSdkCall.h), the wait from arrival to a worker ("queue") and the batcher's hold and
+//. call ("batch_queue", "batch_call", MiBatcher.h) are its children, so the time a request
+//. queued at a hop reads apart from the time it computed.
+//. The trace of a request lives in its context (RequestScope, MiContext.h), so spans
+//. recorded on threads lending it (ContextBorrow) belong to it as well.
+
+//. trace identity of one request.
+struct TraceState {
+	uint64_t								traceHi;
+	uint64_t								traceLo;
+	uint64_t								span;		//. server span of the request
+	uint64_t								parent;		//. caller's span, 0 = root
+	uint8_t									flags;
+	uint64_t								req;		//. sampled request number, 0 = not sampled
+	std::chrono::steady_clock::time_point	start;
+	TraceState() : traceHi(0), traceLo(0), span(0), parent(0), flags(0), req(0) {}
+};
+
+void mi_trace_init(int p_nSampleEvery, bool p_bFollowParent);
+
+//. RequestScope : decides whether the request is sampled from p_strParent (a traceparent,
+//. may be empty) and sample_every. A p_arrival before now (reactor / proactor / HTTP/2
+//. receipt) starts the request there and records the wait for a worker as "queue".
+void mi_trace_begin(TraceState& p_trace, const std::string& p_strParent, std::chrono::steady_clock::time_point p_arrival);
+//. records the request's server span.
+void mi_trace_end(TraceState& p_trace);
+
+//. starts / ends a request on a thread without a request context (binary frames).
+void mi_trace_request_begin();
+void mi_trace_request_end();
+
+bool mi_trace_active();
+
+//. traceparent naming the current request's server span as parent, for the calls it
+//. makes on; false when the request has no trace.
+bool mi_trace_parent(char* p_psz, size_t p_nSize);
+
+//. records [p_start, p_end) under p_pszName for the current request if it is sampled.
+//. p_pszName must be a string literal (only the pointer is stored).
+void mi_trace_record(const char* p_pszName, std::chrono::steady_clock::time_point p_start, std::chrono::steady_clock::time_point p_end);
+
+//. writes spans that ended in the last p_nSeconds as {"traceEvents": [...]}
+void mi_trace_dump(std::ostream& p_out, int p_nSeconds);
+
+//. scoped span.
+class TraceSpan {
+public:
+	explicit TraceSpan(const char* p_pszName) : m_pszName(p_pszName), m_bOn(mi_trace_active())
+	{
+		if (m_bOn) m_start = std::chrono::steady_clock::now();
+	}
+	~TraceSpan()
+	{
+		if (m_bOn) mi_trace_record(m_pszName, m_start, std::chrono::steady_clock::now());
+	}
+
+private:
+	const char*								m_pszName;
+	bool									m_bOn;
+	std::chrono::steady_clock::time_point	m_start;
+};
@@ -0,0 +1,104 @@
+#include "MiValidation.h"
+#include "MiContext.h"
+#include "MiTenants.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include <iostream>
+
+using namespace idliveface;
+
+static std::vector<ValidationProfile>	lv_vProfiles;
+static std::vector<int>					lv_vTenantProfile;		//. by tenant index, -1 = none
+
+static bool validation_of(const std::string& p_strName, Validation& p_v)
+{
+	if (p_strName == "face_occluded") p_v = Validation::kFaceOccluded;
+	else if (p_strName == "eyes_closed") p_v = Validation::kEyesClosed;
+	else if (p_strName == "dark_image") p_v = Validation::kDarkImage;
+	else return false;
+	return true;
+}
+
+//. one "key=value" of a profile; false for an unknown key or value.
+static bool apply_field(ValidationProfile& p_profile, const std::string& p_strKey, const std::string& p_strValue)
+{
+	CustomValidationParameters& c = p_profile.parameters;
+	if (p_strKey == "suppress") {
+		Poco::StringTokenizer tok(p_strValue, "+", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+		for (auto& t : tok) {
+			Validation v;
+			if (!validation_of(Poco::toLower(t), v)) return false;
+			p_profile.suppress.push_back(v);
+		}
+		return true;
+	}
+
+	int n = 0;
+	double d = 0;
+	if (p_strKey == "min_face_size" && Poco::NumberParser::tryParse(p_strValue, n)) c.min_face_size = n;
+	else if (p_strKey == "min_face_padding" && Poco::NumberParser::tryParse(p_strValue, n)) c.min_face_padding = n;
+	else if (p_strKey == "min_pupillary_distance" && Poco::NumberParser::tryParse(p_strValue, n)) c.min_pupillary_distance = n;
+	else if (p_strKey == "min_face_size_relative" && Poco::NumberParser::tryParseFloat(p_strValue, d)) c.min_face_size_relative = (float)d;
+	else if (p_strKey == "detectable_face_size_relative" && Poco::NumberParser::tryParseFloat(p_strValue, d)) c.detectable_face_size_relative = (float)d;
+	else if (p_strKey == "max_yaw" && Poco::NumberParser::tryParseFloat(p_strValue, d)) c.max_yaw = (float)d;
+	else if (p_strKey == "max_pitch" && Poco::NumberParser::tryParseFloat(p_strValue, d)) c.max_pitch = (float)d;
+	else if (p_strKey == "max_roll" && Poco::NumberParser::tryParseFloat(p_strValue, d)) c.max_roll = (float)d;
+	else return false;
+	return true;
+}
+
+void mi_validation_init(const std::string& p_strProfiles, const std::string& p_strTenants)
+{
+	std::vector<ValidationProfile> vProfiles;
+	Poco::StringTokenizer items(p_strProfiles, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : items) {
+		size_t colon = item.find(':');
+		ValidationProfile profile;
+		profile.name = Poco::trim(item.substr(0, colon));
+		if (colon != std::string::npos) {
+			Poco::StringTokenizer fields(item.substr(colon + 1), ";", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+			for (auto& f : fields) {
+				size_t eq = f.find('=');
+				std::string key = Poco::toLower(Poco::trim(f.substr(0, eq)));
+				if (eq == std::string::npos || !apply_field(profile, key, Poco::trim(f.substr(eq + 1))))
+					std::cout << "Validation : profile " << profile.name << " : ignoring " << f << std::endl;
+			}
+		}
+		vProfiles.push_back(profile);
+	}
+
+	const std::vector<std::string>& vNames = mi_tenant_names();
+	std::vector<int> vTenantProfile(vNames.size(), -1);
+	Poco::StringTokenizer tenants(p_strTenants, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : tenants) {
+		Poco::StringTokenizer f(item, ":", Poco::StringTokenizer::TOK_TRIM);
+		size_t idx = 0;
+		while (idx < vNames.size() && vNames[idx] != f[0]) idx++;
+		if (idx == vNames.size()) {
+			std::cout << "Validation : no tenant " << f[0] << " in [tenants] list" << std::endl;
+			continue;
+		}
+		size_t profile = 0;
+		while (profile < vProfiles.size() && (f.count() < 2 || vProfiles[profile].name != f[1])) profile++;
+		if (profile == vProfiles.size()) {
+			std::cout << "Validation : tenant " << f[0] << " : no such profile" << std::endl;
+			continue;
+		}
+		vTenantProfile[idx] = (int)profile;
+	}
+	lv_vProfiles.swap(vProfiles);
+	lv_vTenantProfile.swap(vTenantProfile);
+}
+
+int mi_validation_profile()
+{
+	RequestContext* ctx = mi_context();
+	int tenant = ctx != NULL ? ctx->tenant : -1;
+	return tenant >= 0 && (size_t)tenant < lv_vTenantProfile.size() ? lv_vTenantProfile[tenant] : -1;
+}
+
+const ValidationProfile& mi_validation_profile_at(int p_nProfile)
+{
+	return lv_vProfiles[p_nProfile];
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <idliveface/base_types.h>
+
+//. Validation profiles ([validation] settings) for tenants that pre-validate their captures
+//. on the device : a profile suppresses validations (idliveface::Blueprint::SuppressValidation)
+//. and overrides validation parameters (CustomValidationParameters). The blueprint backend
+//. (MiBlueprint.h) builds one FaceAnalyzer per profile on its first request and keeps at
+//. most pool of them over all profiles, least recently used out first; requests of tenants
+//. without a profile, and every request on the legacy engine, are not affected.
+//. - profiles : "name:suppress=eyes_closed+face_occluded;min_face_size=64;max_yaw=40, ..."
+//.   suppress takes face_occluded / eyes_closed / dark_image (the ones the SDK can turn off),
+//.   the other keys are the CustomValidationParameters fields.
+//. - tenants : "tenant:profile, ..." by [tenants] name.
+
+struct ValidationProfile {
+	std::string										name;
+	std::vector<idliveface::Validation>			suppress;
+	idliveface::CustomValidationParameters		parameters;
+};
+
+void mi_validation_init(const std::string& p_strProfiles, const std::string& p_strTenants);
+
+//. profile index of the tenant of the current request, -1 = none.
+int mi_validation_profile();
+
+//. p_nProfile from mi_validation_profile.
+const ValidationProfile& mi_validation_profile_at(int p_nProfile);
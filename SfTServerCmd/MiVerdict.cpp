@@ -0,0 +1,103 @@
+#include "MiVerdict.h"
+#include "MiConfig.h"
+#include "MiContext.h"
+#include "MiGate.h"
+#include "MiTenants.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+static const char* lv_szVerdicts[MI_VERDICT_COUNT] = { "genuine", "spoofed", "bad_quality", "rejected" };
+
+
+static int domain_of(const std::string& p_strName, int p_nDefault)
+{
+	std::string s = Poco::toLower(Poco::trim(p_strName));
+	if (s == "general") return 0;
+	if (s == "desktop") return 1;
+	if (!s.empty()) std::cout << "Verdict : unknown domain " << s << std::endl;
+	return p_nDefault;
+}
+
+static int tolerance_of(const std::string& p_strName, int p_nDefault)
+{
+	std::string s = Poco::toLower(Poco::trim(p_strName));
+	if (s == "regular") return 0;
+	if (s == "soft") return 1;
+	if (s == "hardened") return 2;
+	if (!s.empty()) std::cout << "Verdict : unknown tolerance " << s << std::endl;
+	return p_nDefault;
+}
+
+static VerdictPolicy make_policy(double p_dQualityMin, double p_dGenuineMin, double p_dBand, int p_nDomain, int p_nTolerance)
+{
+	VerdictPolicy p;
+	p.qualityMin = (float)p_dQualityMin;
+	p.genuineMin = (float)p_dGenuineMin;
+	double band = p_dBand > 0 ? p_dBand : 0;
+	p.uncertainLow = (float)(p_dGenuineMin - band);
+	p.uncertainHigh = (float)(p_dGenuineMin + band);
+	p.domain = p_nDomain;
+	p.tolerance = p_nTolerance;
+	return p;
+}
+
+std::vector<VerdictPolicy> mi_verdict_build(double p_dQualityMin, double p_dGenuineMin, double p_dBand, const std::string& p_strDomain, const std::string& p_strTolerance,
+	const std::string& p_strTenants)
+{
+	int domain = domain_of(p_strDomain, -1), tolerance = tolerance_of(p_strTolerance, -1);
+	const std::vector<std::string>& vNames = mi_tenant_names();
+	std::vector<VerdictPolicy> vPolicies(std::max<size_t>(vNames.size(), 1), make_policy(p_dQualityMin, p_dGenuineMin, p_dBand, domain, tolerance));
+
+	Poco::StringTokenizer items(p_strTenants, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (auto& item : items) {
+		Poco::StringTokenizer f(item, ":", Poco::StringTokenizer::TOK_TRIM);
+		size_t idx = 0;
+		while (idx < vNames.size() && vNames[idx] != f[0]) idx++;
+		if (idx == vNames.size()) {
+			std::cout << "Verdict : no tenant " << f[0] << " in [tenants] list" << std::endl;
+			continue;
+		}
+		double genuineMin = p_dGenuineMin, qualityMin = p_dQualityMin, band = p_dBand;
+		if (f.count() > 1 && !f[1].empty()) Poco::NumberParser::tryParseFloat(f[1], genuineMin);
+		if (f.count() > 2 && !f[2].empty()) Poco::NumberParser::tryParseFloat(f[2], qualityMin);
+		if (f.count() > 3 && !f[3].empty()) Poco::NumberParser::tryParseFloat(f[3], band);
+		vPolicies[idx] = make_policy(qualityMin, genuineMin, band,
+			f.count() > 4 ? domain_of(f[4], domain) : domain, f.count() > 5 ? tolerance_of(f[5], tolerance) : tolerance);
+	}
+	return vPolicies;
+}
+
+const VerdictPolicy& mi_verdict_policy()
+{
+	static const VerdictPolicy defaultPolicy;
+	const ConfigSnapshot* pConfig = mi_config_snapshot();
+	if (pConfig == NULL || pConfig->verdicts.empty()) return defaultPolicy;
+	const std::vector<VerdictPolicy>& v = pConfig->verdicts;
+	RequestContext* ctx = mi_context();
+	int tenant = ctx != NULL ? ctx->tenant : -1;
+	return v[tenant > 0 && (size_t)tenant < v.size() ? tenant : 0];
+}
+
+Verdict mi_verdict_of(const VerdictPolicy& p_policy, const CPipelineResult_t& p_result, int p_nErr)
+{
+	if (p_nErr != OK) return MI_VERDICT_REJECTED;
+	if (mi_gate_stage(p_result, p_nErr) == MI_GATE_QUALITY || p_result.quality_result.score < p_policy.qualityMin) return MI_VERDICT_BAD_QUALITY;
+	return p_result.liveness_result.probability >= p_policy.genuineMin ? MI_VERDICT_GENUINE : MI_VERDICT_SPOOFED;
+}
+
+bool mi_verdict_uncertain(const VerdictPolicy& p_policy, const CPipelineResult_t& p_result, int p_nErr)
+{
+	Verdict v = mi_verdict_of(p_policy, p_result, p_nErr);
+	if (v != MI_VERDICT_GENUINE && v != MI_VERDICT_SPOOFED) return false;
+	float p = p_result.liveness_result.probability;
+	return p >= p_policy.uncertainLow && p < p_policy.uncertainHigh;
+}
+
+const char* mi_verdict_name(int p_nVerdict)
+{
+	return p_nVerdict >= 0 && p_nVerdict < MI_VERDICT_COUNT ? lv_szVerdicts[p_nVerdict] : "unknown";
+}
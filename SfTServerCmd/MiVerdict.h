@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FaceSdkApi.h"
+
+//. Verdict policies ([verdict] settings) : the thresholds that turn a pipeline result
+//. into genuine / spoofed / bad_quality, per tenant (MiTenants.h). The settings are
+//. compiled by mi_verdict_build into one flat row per tenant index, so a request looks its
+//. policy up by the tenant TenantTicket put in its context, one array access.
+//. - quality_min / genuine_min : quality score below which the image has a bad quality,
+//.   liveness probability from which it is genuine (0.5 / 0.5, the historical values).
+//. - domain / tolerance : idliveface::Domain / Tolerance of the blueprint engine's
+//.   FaceAnalysisParameters (MiBlueprint.h); the legacy engine takes them from [meta].
+//. - uncertain_band : probabilities within the band around genuine_min are uncertain.
+//.   A sequence (GD_API_SEQUENCE) is then checked on its last frame first and fused over
+//.   all its frames only when that one is uncertain or fails; single images keep their
+//.   verdict and are counted, mi_verdict_uncertain_total{action} on GD_API_METRICS.
+
+enum Verdict {
+	MI_VERDICT_GENUINE = 0,
+	MI_VERDICT_SPOOFED,
+	MI_VERDICT_BAD_QUALITY,
+	MI_VERDICT_REJECTED,		//. STATUS not OK
+	MI_VERDICT_COUNT
+};
+
+struct VerdictPolicy {
+	float	qualityMin;
+	float	genuineMin;
+	float	uncertainLow;		//. [low, high) of the uncertain probabilities, empty = none
+	float	uncertainHigh;
+	int		domain;				//. idliveface::Domain, -1 = engine default
+	int		tolerance;			//. idliveface::Tolerance, -1 = engine default
+
+	VerdictPolicy() : qualityMin(0.5f), genuineMin(0.5f), uncertainLow(0.5f), uncertainHigh(0.5f), domain(-1), tolerance(-1) {}
+	bool has_band() const { return uncertainHigh > uncertainLow; }
+};
+
+//. p_strDomain "general" / "desktop", p_strTolerance "regular" / "soft" / "hardened", empty = engine
+//. default. p_strTenants : "tenant:genuine_min:quality_min:uncertain_band:domain:tolerance, ...",
+//. an empty field takes the [verdict] value; tenants are matched by name against mi_tenant_names.
+//. The rows by tenant index, kept in the configuration snapshot (MiConfig.h).
+std::vector<VerdictPolicy> mi_verdict_build(double p_dQualityMin, double p_dGenuineMin, double p_dBand, const std::string& p_strDomain, const std::string& p_strTolerance,
+	const std::string& p_strTenants);
+
+//. policy of the tenant of the current request from its configuration snapshot, the default
+//. one outside a request.
+const VerdictPolicy& mi_verdict_policy();
+
+Verdict mi_verdict_of(const VerdictPolicy& p_policy, const CPipelineResult_t& p_result, int p_nErr);
+//. a liveness answer within the uncertain band of p_policy.
+bool mi_verdict_uncertain(const VerdictPolicy& p_policy, const CPipelineResult_t& p_result, int p_nErr);
+
+//. "genuine" / "spoofed" / "bad_quality" / "rejected" (string literals).
+const char* mi_verdict_name(int p_nVerdict);
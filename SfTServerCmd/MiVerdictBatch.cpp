@@ -0,0 +1,135 @@
+#include "MiVerdictBatch.h"
+#include "MiCpu.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LD_VERDICT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define LD_TARGET_AVX2
+#else
+#define LD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define LD_VERDICT_X86 0
+#endif
+
+#define LD_VERDICT_TILE		256
+
+//. one tile of columns into verdicts / uncertain flags.
+typedef void (*VerdictTileFn)(const VerdictPolicy& p_policy, const float* p_pProb, const float* p_pQual, const int32_t* p_pForced, size_t p_nCount,
+	uint8_t* p_pVerdicts, uint8_t* p_pUncertain);
+
+static void verdict_tail(const VerdictPolicy& p_policy, const float* p_pProb, const float* p_pQual, const int32_t* p_pForced, size_t p_nFrom, size_t p_nCount,
+	uint8_t* p_pVerdicts, uint8_t* p_pUncertain)
+{
+	for (size_t i = p_nFrom; i < p_nCount; i++) {
+		float p = p_pProb[i];
+		int32_t base = p_pQual[i] < p_policy.qualityMin ? MI_VERDICT_BAD_QUALITY : p >= p_policy.genuineMin ? MI_VERDICT_GENUINE : MI_VERDICT_SPOOFED;
+		int32_t v = p_pForced[i] > base ? p_pForced[i] : base;
+		p_pVerdicts[i] = (uint8_t)v;
+		p_pUncertain[i] = v <= MI_VERDICT_SPOOFED && p >= p_policy.uncertainLow && p < p_policy.uncertainHigh ? 1 : 0;
+	}
+}
+
+static void verdict_scalar(const VerdictPolicy& p_policy, const float* p_pProb, const float* p_pQual, const int32_t* p_pForced, size_t p_nCount,
+	uint8_t* p_pVerdicts, uint8_t* p_pUncertain)
+{
+	verdict_tail(p_policy, p_pProb, p_pQual, p_pForced, 0, p_nCount, p_pVerdicts, p_pUncertain);
+}
+
+#if LD_VERDICT_X86
+
+//. 4 int32 lanes (0 .. 3) into 4 bytes.
+static inline void store4(uint8_t* p_pDst, __m128i p_v)
+{
+	__m128i w = _mm_packs_epi32(p_v, p_v);
+	int b = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+	memcpy(p_pDst, &b, 4);
+}
+
+static void verdict_sse2(const VerdictPolicy& p_policy, const float* p_pProb, const float* p_pQual, const int32_t* p_pForced, size_t p_nCount,
+	uint8_t* p_pVerdicts, uint8_t* p_pUncertain)
+{
+	const __m128 g = _mm_set1_ps(p_policy.genuineMin), q = _mm_set1_ps(p_policy.qualityMin);
+	const __m128 lo = _mm_set1_ps(p_policy.uncertainLow), hi = _mm_set1_ps(p_policy.uncertainHigh);
+	const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+	size_t i = 0;
+	for (; i + 4 <= p_nCount; i += 4) {
+		__m128 p = _mm_loadu_ps(p_pProb + i);
+		__m128i gen = _mm_castps_si128(_mm_cmpge_ps(p, g));
+		__m128i bad = _mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(p_pQual + i), q));
+		__m128i base = _mm_or_si128(_mm_and_si128(bad, two), _mm_andnot_si128(bad, _mm_andnot_si128(gen, one)));
+		//. lanes hold 0 .. 3 : the 16-bit max is the 32-bit one (SSE2 has no max_epi32).
+		__m128i v = _mm_max_epi16(_mm_loadu_si128((const __m128i*)(p_pForced + i)), base);
+		__m128i band = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(p, lo), _mm_cmplt_ps(p, hi)));
+		__m128i unc = _mm_and_si128(_mm_and_si128(band, _mm_cmplt_epi32(v, two)), one);
+		store4(p_pVerdicts + i, v);
+		store4(p_pUncertain + i, unc);
+	}
+	verdict_tail(p_policy, p_pProb, p_pQual, p_pForced, i, p_nCount, p_pVerdicts, p_pUncertain);
+}
+
+LD_TARGET_AVX2 static void verdict_avx2(const VerdictPolicy& p_policy, const float* p_pProb, const float* p_pQual, const int32_t* p_pForced, size_t p_nCount,
+	uint8_t* p_pVerdicts, uint8_t* p_pUncertain)
+{
+	const __m256 g = _mm256_set1_ps(p_policy.genuineMin), q = _mm256_set1_ps(p_policy.qualityMin);
+	const __m256 lo = _mm256_set1_ps(p_policy.uncertainLow), hi = _mm256_set1_ps(p_policy.uncertainHigh);
+	const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+	size_t i = 0;
+	for (; i + 8 <= p_nCount; i += 8) {
+		__m256 p = _mm256_loadu_ps(p_pProb + i);
+		__m256i gen = _mm256_castps_si256(_mm256_cmp_ps(p, g, _CMP_GE_OQ));
+		__m256i bad = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(p_pQual + i), q, _CMP_LT_OQ));
+		__m256i base = _mm256_blendv_epi8(_mm256_andnot_si256(gen, one), two, bad);
+		__m256i v = _mm256_max_epi32(_mm256_loadu_si256((const __m256i*)(p_pForced + i)), base);
+		__m256i band = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(p, lo, _CMP_GE_OQ), _mm256_cmp_ps(p, hi, _CMP_LT_OQ)));
+		__m256i unc = _mm256_and_si256(_mm256_and_si256(band, _mm256_cmpgt_epi32(two, v)), one);
+		//. packs work per 128-bit lane : pack the halves together instead.
+		__m128i w = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		_mm_storel_epi64((__m128i*)(p_pVerdicts + i), _mm_packus_epi16(w, w));
+		w = _mm_packs_epi32(_mm256_castsi256_si128(unc), _mm256_extracti128_si256(unc, 1));
+		_mm_storel_epi64((__m128i*)(p_pUncertain + i), _mm_packus_epi16(w, w));
+	}
+	verdict_tail(p_policy, p_pProb, p_pQual, p_pForced, i, p_nCount, p_pVerdicts, p_pUncertain);
+}
+
+#endif
+
+static VerdictTileFn lv_fnTile = verdict_scalar;
+
+static void bind_verdict(int p_nVariant)
+{
+	lv_fnTile = verdict_scalar;
+#if LD_VERDICT_X86
+	if (p_nVariant == 2) lv_fnTile = verdict_avx2;
+	else if (p_nVariant == 1) lv_fnTile = verdict_sse2;
+#else
+	(void)p_nVariant;
+#endif
+}
+
+static const char* const lv_szVariants[] = { "scalar", "sse2", "avx2" };
+static const uint32_t lv_nNeeds[] = { 0, MI_CPU_SSE2, MI_CPU_AVX2 };
+static MiCpuKernel lv_kernel = { "verdict", LD_VERDICT_X86 ? 3 : 1, lv_szVariants, lv_nNeeds, bind_verdict, 0, 0 };
+static const bool lv_bRegistered = mi_cpu_register(&lv_kernel);
+
+void mi_verdict_batch(const VerdictPolicy& p_policy, const CPipelineResult_t* p_pResults, const int* p_pErrors, size_t p_nCount,
+	uint8_t* p_pVerdicts, uint8_t* p_pUncertain)
+{
+	float prob[LD_VERDICT_TILE], qual[LD_VERDICT_TILE];
+	int32_t forced[LD_VERDICT_TILE];
+	uint8_t unc[LD_VERDICT_TILE];
+	for (size_t at = 0; at < p_nCount; at += LD_VERDICT_TILE) {
+		size_t n = p_nCount - at < LD_VERDICT_TILE ? p_nCount - at : LD_VERDICT_TILE;
+		for (size_t i = 0; i < n; i++) {
+			const CPipelineResult_t& r = p_pResults[at + i];
+			int err = p_pErrors[at + i];
+			prob[i] = r.liveness_result.probability;
+			qual[i] = r.quality_result.score;
+			//. the quality gate's rejection, as mi_gate_stage tells it.
+			forced[i] = err != OK ? MI_VERDICT_REJECTED : r.quality_result.ok && !r.liveness_result.ok ? MI_VERDICT_BAD_QUALITY : MI_VERDICT_GENUINE;
+		}
+		lv_fnTile(p_policy, prob, qual, forced, n, p_pVerdicts + at, p_pUncertain != NULL ? p_pUncertain + at : unc);
+	}
+}
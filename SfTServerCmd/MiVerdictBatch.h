@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "MiVerdict.h"
+
+//. Verdicts of a whole batch at once (GD_API_BATCH, --batch, jobs) ahead of serialization :
+//. the results are transposed tile by tile into float columns (probability, quality) and a
+//. forced-verdict column (rejected for a STATUS, bad_quality for the quality gate), then
+//. thresholded 8 (AVX2) or 4 (SSE2) lanes at a time through MiCpu.h :
+//.   verdict = max(forced, quality < quality_min ? bad_quality : probability >= genuine_min ? genuine : spoofed)
+//. The answers match mi_verdict_of / mi_verdict_uncertain element by element, NaN included
+//. (ordered compares are false, as in the scalar code). A 256-result tile keeps its
+//. columns in L1 and on the stack.
+
+//. p_pVerdicts[i] : Verdict of result i; p_pUncertain[i] (may be NULL) : 1 when it is within
+//. the uncertain band of p_policy.
+void mi_verdict_batch(const VerdictPolicy& p_policy, const CPipelineResult_t* p_pResults, const int* p_pErrors, size_t p_nCount,
+	uint8_t* p_pVerdicts, uint8_t* p_pUncertain);
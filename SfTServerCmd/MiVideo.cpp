@@ -0,0 +1,334 @@
+#include "MiVideo.h"
+#include "MiImageInfo.h"
+#include "MiMetrics.h"
+#include "MiPlatform.h"
+#if MI_HAS_MF
+#include "MiWic.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#endif
+#include <algorithm>
+#include <memory>
+#include <string.h>
+
+static bool				lv_bEnable = false;
+static VideoSettings	lv_settings;
+
+#if MI_HAS_MF
+//. 100 ns units of Media Foundation.
+static const LONGLONG	lv_nTicksPerMs = 10000;
+
+//. source reader on the upload buffer, decoding the first video stream to RGB32.
+struct VideoReader {
+	ComRef<IWICStream>		stream;
+	ComRef<IMFByteStream>	bytes;
+	ComRef<IMFSourceReader>	reader;
+	UINT32					width, height;
+	LONG					stride;			//. negative for bottom-up rows
+	LONGLONG				duration;		//. 0 = unknown
+	VideoReader() : width(0), height(0), stride(0), duration(0) {}
+};
+
+static bool reader_format(VideoReader& p_vr, std::string& p_strErr)
+{
+	ComRef<IMFMediaType> type;
+	if (FAILED(p_vr.reader->GetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, &type.p))) {
+		p_strErr = "no video format";
+		return false;
+	}
+	if (FAILED(MFGetAttributeSize(type.p, MF_MT_FRAME_SIZE, &p_vr.width, &p_vr.height)) || p_vr.width == 0 || p_vr.height == 0) {
+		p_strErr = "no video frame size";
+		return false;
+	}
+	UINT32 nStride = 0;
+	p_vr.stride = SUCCEEDED(type->GetUINT32(MF_MT_DEFAULT_STRIDE, &nStride)) ? (LONG)nStride : (LONG)p_vr.width * 4;
+	if (!mi_image_size_allowed((int)p_vr.width, (int)p_vr.height, p_strErr)) return false;
+	return true;
+}
+
+//. source reader options : RGB32 conversion, hardware decoder transforms when allowed.
+static bool reader_attributes(bool p_bHardware, ComRef<IMFAttributes>& p_attrs)
+{
+	if (FAILED(MFCreateAttributes(&p_attrs.p, 2))) return false;
+	p_attrs->SetUINT32(MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING, TRUE);
+	p_attrs->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, p_bHardware ? TRUE : FALSE);
+	return true;
+}
+
+//. first video stream only, decoded to RGB32.
+static bool reader_configure(VideoReader& p_vr, std::string& p_strErr)
+{
+	//. audio and the other streams are never demuxed.
+	p_vr.reader->SetStreamSelection((DWORD)MF_SOURCE_READER_ALL_STREAMS, FALSE);
+	if (FAILED(p_vr.reader->SetStreamSelection((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, TRUE))) {
+		p_strErr = "no video stream";
+		return false;
+	}
+	ComRef<IMFMediaType> type;
+	if (FAILED(MFCreateMediaType(&type.p))) {
+		p_strErr = "video cannot be read";
+		return false;
+	}
+	type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+	type->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_RGB32);
+	if (FAILED(p_vr.reader->SetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, NULL, type.p))) {
+		p_strErr = "unsupported video codec";
+		return false;
+	}
+	PROPVARIANT var;
+	PropVariantInit(&var);
+	if (SUCCEEDED(p_vr.reader->GetPresentationAttribute((DWORD)MF_SOURCE_READER_MEDIASOURCE, MF_PD_DURATION, &var)) && var.vt == VT_UI8) {
+		p_vr.duration = (LONGLONG)var.uhVal.QuadPart;
+	}
+	PropVariantClear(&var);
+	return reader_format(p_vr, p_strErr);
+}
+
+static bool reader_open(const uint8_t* p_pData, size_t p_nLen, const VideoSettings& p_settings, VideoReader& p_vr, std::string& p_strErr)
+{
+	//. the WIC stream wraps the buffer without a copy and joins the thread to the MTA.
+	IWICImagingFactory* factory = mi_wic_factory();
+	ComRef<IMFAttributes> attrs;
+	if (factory == NULL || p_nLen == 0 || p_nLen > 0xFFFFFFFFu
+		|| FAILED(factory->CreateStream(&p_vr.stream.p)) || FAILED(p_vr.stream->InitializeFromMemory((WICInProcPointer)p_pData, (DWORD)p_nLen))
+		|| FAILED(MFCreateMFByteStreamOnStream(p_vr.stream.p, &p_vr.bytes.p)) || !reader_attributes(p_settings.hardware, attrs)) {
+		p_strErr = "video cannot be read";
+		return false;
+	}
+	if (FAILED(MFCreateSourceReaderFromByteStream(p_vr.bytes.p, attrs.p, &p_vr.reader.p))) {
+		p_strErr = "unsupported video container";
+		return false;
+	}
+	return reader_configure(p_vr, p_strErr);
+}
+
+//. RGB32 sample to packed BGR.
+static bool sample_frame(const VideoReader& p_vr, IMFSample* p_pSample, LONGLONG p_nTime, VideoFrame& p_out)
+{
+	ComRef<IMFMediaBuffer> buffer;
+	if (FAILED(p_pSample->ConvertToContiguousBuffer(&buffer.p))) return false;
+
+	BYTE* pScan0 = NULL;
+	LONG nPitch = 0;
+	ComRef<IMF2DBuffer> buffer2d;
+	BYTE* pLocked = NULL;
+	bool b2d = SUCCEEDED(buffer->QueryInterface(IID_PPV_ARGS(&buffer2d.p))) && SUCCEEDED(buffer2d->Lock2D(&pScan0, &nPitch));
+	if (!b2d) {
+		DWORD nLen = 0;
+		if (FAILED(buffer->Lock(&pLocked, NULL, &nLen))) return false;
+		LONG nRow = p_vr.stride < 0 ? -p_vr.stride : p_vr.stride;
+		if ((size_t)nLen < (size_t)nRow * p_vr.height) {
+			buffer->Unlock();
+			return false;
+		}
+		nPitch = p_vr.stride;
+		pScan0 = nPitch < 0 ? pLocked + (size_t)nRow * (p_vr.height - 1) : pLocked;
+	}
+
+	p_out.width = (int)p_vr.width;
+	p_out.height = (int)p_vr.height;
+	p_out.pixels.resize((size_t)p_vr.width * p_vr.height * 3);
+	for (UINT32 y = 0; y < p_vr.height; y++) {
+		const BYTE* src = pScan0 + (ptrdiff_t)nPitch * (ptrdiff_t)y;
+		uint8_t* dst = p_out.pixels.data() + (size_t)y * p_vr.width * 3;
+		for (UINT32 x = 0; x < p_vr.width; x++, src += 4, dst += 3) {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+		}
+	}
+	if (b2d) buffer2d->Unlock2D();
+	else buffer->Unlock();
+
+	UINT32 nClean = 0;
+	p_out.key = SUCCEEDED(p_pSample->GetUINT32(MFSampleExtension_CleanPoint, &nClean)) && nClean != 0;
+	p_out.timestampMs = p_nTime > 0 ? (uint64_t)(p_nTime / lv_nTicksPerMs) : 0;
+	return true;
+}
+
+//. next decoded sample; false at the end of the stream or on an error (p_strErr set).
+static bool read_sample(VideoReader& p_vr, ComRef<IMFSample>& p_sample, LONGLONG* p_pTime, std::string& p_strErr)
+{
+	for (;;) {
+		DWORD nFlags = 0;
+		if (FAILED(p_vr.reader->ReadSample((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, NULL, &nFlags, p_pTime, &p_sample.p))) {
+			p_strErr = "video decode failed";
+			return false;
+		}
+		if (nFlags & (MF_SOURCE_READERF_ENDOFSTREAM | MF_SOURCE_READERF_ERROR)) return false;
+		if ((nFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED) && !reader_format(p_vr, p_strErr)) return false;
+		//. a stream gap has no sample.
+		if (p_sample.p != NULL) return true;
+	}
+}
+#endif
+
+struct VideoLive {
+#if MI_HAS_MF
+	VideoReader		vr;
+	bool			started;	//. MFStartup of this source
+	VideoLive() : started(false) {}
+#endif
+};
+
+VideoLive* mi_video_live_open(const std::string& p_strUrl, bool p_bHardware, std::string& p_strErr)
+{
+#if MI_HAS_MF
+	if (mi_wic_factory() == NULL || FAILED(MFStartup(MF_VERSION, MFSTARTUP_LITE))) {
+		p_strErr = "Media Foundation is unavailable";
+		return NULL;
+	}
+	std::unique_ptr<VideoLive> pLive(new VideoLive);
+	pLive->started = true;
+	ComRef<IMFAttributes> attrs;
+	std::wstring strUrl(p_strUrl.begin(), p_strUrl.end());
+	if (!reader_attributes(p_bHardware, attrs)) {
+		p_strErr = "video cannot be read";
+	}
+	else if (FAILED(MFCreateSourceReaderFromURL(strUrl.c_str(), attrs.p, &pLive->vr.reader.p))) {
+		p_strErr = "cannot open " + p_strUrl;
+	}
+	else if (reader_configure(pLive->vr, p_strErr)) {
+		return pLive.release();
+	}
+	mi_video_live_close(pLive.release());
+	return NULL;
+#else
+	(void)p_strUrl; (void)p_bHardware;
+	p_strErr = "rtsp needs Media Foundation (Windows builds)";
+	return NULL;
+#endif
+}
+
+bool mi_video_live_next(VideoLive* p_pLive, VideoFrame& p_out, std::string& p_strErr)
+{
+#if MI_HAS_MF
+	ComRef<IMFSample> sample;
+	LONGLONG nTime = 0;
+	if (!read_sample(p_pLive->vr, sample, &nTime, p_strErr)) {
+		if (p_strErr.empty()) p_strErr = "stream ended";
+		return false;
+	}
+	if (!sample_frame(p_pLive->vr, sample.p, nTime, p_out)) {
+		p_strErr = "frame cannot be read";
+		return false;
+	}
+	mi_metrics_video_frames(p_out.key ? 1 : 0, p_out.key ? 0 : 1);
+	return true;
+#else
+	(void)p_pLive; (void)p_out;
+	p_strErr = "rtsp needs Media Foundation (Windows builds)";
+	return false;
+#endif
+}
+
+void mi_video_live_close(VideoLive* p_pLive)
+{
+	if (p_pLive == NULL) return;
+#if MI_HAS_MF
+	bool bStarted = p_pLive->started;
+	delete p_pLive;
+	if (bStarted) MFShutdown();
+#else
+	delete p_pLive;
+#endif
+}
+
+bool mi_video_init(bool p_bEnable, const VideoSettings& p_settings, std::string& p_strErr)
+{
+	if (!p_bEnable) return true;
+	lv_settings = p_settings;
+	lv_settings.everyN = std::max(lv_settings.everyN, 1);
+	lv_settings.intervalMs = std::max(lv_settings.intervalMs, 1);
+	lv_settings.maxFrames = std::max(lv_settings.maxFrames, 1);
+	lv_settings.maxSeconds = std::max(lv_settings.maxSeconds, 1);
+#if MI_HAS_MF
+	if (mi_wic_factory() == NULL || FAILED(MFStartup(MF_VERSION, MFSTARTUP_LITE))) {
+		p_strErr = "Media Foundation is unavailable";
+		return false;
+	}
+	lv_bEnable = true;
+	return true;
+#else
+	p_strErr = "video decode needs Media Foundation (Windows builds)";
+	return false;
+#endif
+}
+
+void mi_video_shutdown()
+{
+	if (!lv_bEnable) return;
+#if MI_HAS_MF
+	MFShutdown();
+#endif
+	lv_bEnable = false;
+}
+
+bool mi_video_enabled()
+{
+	return lv_bEnable;
+}
+
+const VideoSettings& mi_video_settings()
+{
+	return lv_settings;
+}
+
+bool mi_video_frames(const uint8_t* p_pData, size_t p_nLen, const VideoSettings& p_settings, std::vector<VideoFrame>& p_vOut, std::string& p_strErr)
+{
+	p_vOut.clear();
+#if MI_HAS_MF
+	VideoReader vr;
+	if (!reader_open(p_pData, p_nLen, p_settings, vr, p_strErr)) return false;
+
+	LONGLONG nEnd = (LONGLONG)p_settings.maxSeconds * 1000 * lv_nTicksPerMs;
+	if (vr.duration > 0 && vr.duration < nEnd) nEnd = vr.duration;
+	size_t nMax = (size_t)p_settings.maxFrames;
+	size_t nKey = 0;
+	if (p_settings.keyframes) {
+		//. every seek lands on a key frame; sparse key frames give the same one twice.
+		LONGLONG nStep = (LONGLONG)p_settings.intervalMs * lv_nTicksPerMs;
+		LONGLONG nLast = -1;
+		for (LONGLONG t = 0; t < nEnd && p_vOut.size() < nMax; t += nStep) {
+			PROPVARIANT pos;
+			PropVariantInit(&pos);
+			pos.vt = VT_I8;
+			pos.hVal.QuadPart = t;
+			HRESULT hr = vr.reader->SetCurrentPosition(GUID_NULL, pos);
+			PropVariantClear(&pos);
+			if (FAILED(hr)) break;
+			ComRef<IMFSample> sample;
+			LONGLONG nTime = 0;
+			if (!read_sample(vr, sample, &nTime, p_strErr)) break;
+			if (nTime <= nLast) continue;
+			nLast = nTime;
+			p_vOut.emplace_back();
+			if (!sample_frame(vr, sample.p, nTime, p_vOut.back())) p_vOut.pop_back();
+		}
+	}
+	else {
+		for (size_t nIndex = 0; p_vOut.size() < nMax; nIndex++) {
+			ComRef<IMFSample> sample;
+			LONGLONG nTime = 0;
+			if (!read_sample(vr, sample, &nTime, p_strErr) || nTime >= nEnd) break;
+			if (nIndex % (size_t)p_settings.everyN != 0) continue;
+			p_vOut.emplace_back();
+			if (!sample_frame(vr, sample.p, nTime, p_vOut.back())) p_vOut.pop_back();
+		}
+	}
+	for (const VideoFrame& f : p_vOut) nKey += f.key ? 1 : 0;
+	mi_metrics_video_frames(nKey, p_vOut.size() - nKey);
+	if (p_vOut.empty()) {
+		if (p_strErr.empty()) p_strErr = "no video frame decoded";
+		return false;
+	}
+	p_strErr.clear();
+	return true;
+#else
+	(void)p_pData; (void)p_nLen; (void)p_settings;
+	p_strErr = "video decode needs Media Foundation (Windows builds)";
+	return false;
+#endif
+}
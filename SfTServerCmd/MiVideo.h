@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "MiPixelPool.h"
+
+//. Sampled frames of a short video selfie for GD_API_VIDEO ([video] settings). The container
+//. (MP4 / MOV ...) is demuxed by a Media Foundation source reader straight from the upload
+//. buffer and only the sampled frames are decoded, never the whole clip :
+//.   keyframes : the reader seeks every interval_ms and takes the frame it lands on, the key
+//.               frame at or before that point, so only key frames reach the decoder;
+//.   every_n   : every Nth frame of the stream, reading stops once max_frames are taken.
+//. Both stop at max_frames and max_seconds of the clip. With hardware, the decoder may be a
+//. hardware transform (MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS); the frames come out as
+//. packed BGR with their presentation time, which image_create_pixels / image_batch_create
+//. take for temporal liveness.
+//. Builds without Media Foundation (Linux) answer the endpoint with 501.
+//. mi_video_frames_total{kind=key|delta} on GD_API_METRICS counts the decoded frames.
+
+struct VideoSettings {
+	bool	keyframes;		//. false = every_n
+	int		everyN;
+	int		intervalMs;		//. keyframes : seek step
+	int		maxFrames;
+	int		maxSeconds;		//. of the clip, later frames are not read
+	bool	hardware;
+};
+
+struct VideoFrame {
+	PixelBuffer		pixels;			//. packed BGR rows
+	int				width;
+	int				height;
+	uint64_t		timestampMs;	//. presentation time
+	bool			key;
+	VideoFrame() : width(0), height(0), timestampMs(0), key(false) {}
+};
+
+bool mi_video_init(bool p_bEnable, const VideoSettings& p_settings, std::string& p_strErr);
+void mi_video_shutdown();
+bool mi_video_enabled();
+const VideoSettings& mi_video_settings();
+
+//. the sampled frames of the clip in p_pData, p_settings with the request's overrides;
+//. false with p_strErr when the container or its video stream cannot be read.
+bool mi_video_frames(const uint8_t* p_pData, size_t p_nLen, const VideoSettings& p_settings, std::vector<VideoFrame>& p_vOut, std::string& p_strErr);
+
+//. live source (rtsp:// camera, MiCamera.h) read one decoded frame at a time, apart from the
+//. [video] endpoint settings. NULL / false with p_strErr when it cannot be opened or has ended.
+struct VideoLive;
+VideoLive* mi_video_live_open(const std::string& p_strUrl, bool p_bHardware, std::string& p_strErr);
+bool mi_video_live_next(VideoLive* p_pLive, VideoFrame& p_out, std::string& p_strErr);
+void mi_video_live_close(VideoLive* p_pLive);
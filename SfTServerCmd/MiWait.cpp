@@ -0,0 +1,45 @@
+#include "MiWait.h"
+#include "MiConf.h"
+#include "Poco/Environment.h"
+#if MI_HAS_TBB
+#include <oneapi/tbb/global_control.h>
+#endif
+#include <iostream>
+#include <memory>
+
+static bool		lv_bPassive = false;
+#if MI_HAS_TBB
+//. kept for the process lifetime : the limit ends with the object.
+static std::unique_ptr<tbb::global_control>	lv_pTbbLimit;
+#endif
+
+//. a value the operator put in the environment wins.
+static void set_default_env(const char* p_pszName, const char* p_pszValue)
+{
+	if (!Poco::Environment::has(p_pszName)) Poco::Environment::set(p_pszName, p_pszValue);
+}
+
+void mi_wait_init(const std::string& p_strPolicy, int p_nTbbMaxThreads)
+{
+	lv_bPassive = p_strPolicy == "passive";
+	if (!lv_bPassive && p_strPolicy != "active") std::cout << "Wait policy : unknown " << p_strPolicy << ", active" << std::endl;
+	if (lv_bPassive) {
+		set_default_env("OMP_WAIT_POLICY", "PASSIVE");
+		set_default_env("KMP_BLOCKTIME", "0");
+	}
+	std::cout << "Wait policy : " << (lv_bPassive ? "passive" : "active");
+	if (p_nTbbMaxThreads > 0) {
+#if MI_HAS_TBB
+		lv_pTbbLimit.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism, (size_t)p_nTbbMaxThreads));
+		std::cout << ", TBB workers <= " << p_nTbbMaxThreads;
+#else
+		std::cout << ", tbb_max_threads ignored (build without MI_TBB)";
+#endif
+	}
+	std::cout << std::endl;
+}
+
+bool mi_wait_passive()
+{
+	return lv_bPassive;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+//. How the SDK's inference threads wait for work ([sdk] wait_policy, tbb_max_threads).
+//. OpenVINO runs its inference on TBB arenas (tbb12.dll / libtbb.so.12), or on OpenMP in
+//. some builds; a worker keeps spinning for a while after its last task before it sleeps,
+//. so between bursts a node burns cores it does not use, bills them and takes them from the
+//. services beside it. The first request after a pause finds those threads awake.
+//. - active : the runtime defaults, the lowest latency after a pause.
+//. - passive : OpenMP workers sleep at once (OMP_WAIT_POLICY=PASSIVE, KMP_BLOCKTIME=0, unless
+//.   the environment sets them), the OpenVINO threads are not pinned (sdk.ov_bind_threads 0
+//.   unless set, CPU_BIND_THREAD=NO for the blueprint engine) so the OS can give their cores
+//.   to other work. The next request pays the wake-up.
+//. - tbb_max_threads > 0 : tbb::global_control max_allowed_parallelism, the TBB workers of
+//.   every arena of the process together; the per-arena sizes stay the num_threads_* and
+//.   backend.cpu_cores values. Needs a build linked to the TBB the SDK ships (CMake MI_TBB,
+//.   or MI_HAS_TBB=1 and tbb12.lib in the Visual Studio project).
+//. SdkBench --wait-policy active|passive --idle-gaps 10,100,1000 measures the idle CPU of
+//. each gap against the latency of the check after it.
+
+//. before the SDK loads : its runtimes read the environment once. Prints the policy.
+void mi_wait_init(const std::string& p_strPolicy, int p_nTbbMaxThreads);
+bool mi_wait_passive();
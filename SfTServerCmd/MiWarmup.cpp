@@ -0,0 +1,202 @@
+#include "MiWarmup.h"
+#include "FaceSdkApi.h"
+#include "MiBackend.h"
+#include "MiBatcher.h"
+#include "MiMsgBuffers.h"
+#include "MiPipelinePool.h"
+#include "MiSettings.h"
+#include "MiStartup.h"
+#include "MiSupervisor.h"
+#include "Poco/NumberParser.h"
+#include "Poco/StringTokenizer.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+static std::atomic<bool>	lv_bReady(false);
+static std::atomic<bool>	lv_bDraining(false);
+static std::atomic<bool>	lv_bStop(false);
+static std::thread			lv_thread;
+
+//. [warmup] image, else a synthetic frame; a real face also exercises the liveness
+//. models behind the detector.
+CImage_t* mi_warmup_image()
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+
+	if (!g_Settings.warmupImage.empty()) {
+		std::ifstream in(g_Settings.warmupImage, std::ios::binary);
+		std::ostringstream ss;
+		ss << in.rdbuf();
+		std::string data = ss.str();
+		if (!data.empty()) {
+			CImage_t* image = face_sdk_api().image_create_bytes((const uint8_t*)data.data(), data.size(), &err, msg);
+			if (image != NULL) return image;
+		}
+		std::cout << "Warm-up : cannot use " << g_Settings.warmupImage << ", using a synthetic frame" << std::endl;
+	}
+
+	const size_t rows = 480, cols = 640;
+	std::vector<uint8_t> pixels(rows * cols * 3);
+	for (size_t r = 0; r < rows; r++) {
+		for (size_t c = 0; c < cols; c++) {
+			uint8_t v = (uint8_t)(64 + (r + c) % 128);
+			pixels[(r * cols + c) * 3 + 0] = v;
+			pixels[(r * cols + c) * 3 + 1] = v;
+			pixels[(r * cols + c) * 3 + 2] = v;
+		}
+	}
+	return face_sdk_api().image_create_pixels(pixels.data(), rows, cols, BGR888, &err, msg);
+}
+
+static std::vector<int> warmup_batch_sizes()
+{
+	std::vector<int> v;
+	if (!g_Settings.warmupBatchSizes.empty()) {
+		Poco::StringTokenizer tok(g_Settings.warmupBatchSizes, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+		for (auto& t : tok) {
+			int n = 0;
+			if (Poco::NumberParser::tryParse(t, n) && n > 0) v.push_back(n);
+		}
+		return v;
+	}
+	//. the batcher only makes calls of its buckets.
+	if (g_pBatcher != NULL && g_pBatcher->buckets().enabled()) return g_pBatcher->buckets().sizes();
+	//. 1, the powers of two the batcher can produce and its maximum.
+	v.push_back(1);
+	if (g_Settings.batchEnable) {
+		for (int n = 2; n < g_Settings.batchMaxSize; n *= 2) v.push_back(n);
+		if (g_Settings.batchMaxSize > 1) v.push_back(g_Settings.batchMaxSize);
+	}
+	return v;
+}
+
+static void warm_pipeline(CPipeline_t* p_pPipeline, const CImage_t* p_pImage, const std::vector<int>& p_vSizes, int p_nIterations)
+{
+	int err = OK;
+	char msg[MESSAGE_BUFFER_SIZE]; memset(msg, 0, sizeof(msg));
+	//. the bucket calls are timed for the batcher's plans, the fastest pass counts.
+	BatchBuckets* pBuckets = (g_pBatcher != NULL && g_pBatcher->buckets().enabled()) ? &g_pBatcher->buckets() : NULL;
+
+	for (int it = 0; it < p_nIterations && !lv_bStop; it++) {
+		for (int n : p_vSizes) {
+			if (n == 1 && pBuckets == NULL) {
+				face_sdk_api().pipeline_check_liveness(p_pPipeline, p_pImage, NULL, &err, msg);
+				continue;
+			}
+			std::vector<const CImage_t*> images(n, p_pImage);
+			std::vector<int> errors(n, OK);
+			MsgBuffers msgs(n);
+			auto start = std::chrono::steady_clock::now();
+			CPipelineResult_t* results = face_sdk_api().pipeline_check_liveness_batch2(p_pPipeline, images.data(), n, NULL, errors.data(), msgs.data());
+			if (pBuckets != NULL && results != NULL) pBuckets->measure(n, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			if (results != NULL) face_sdk_api().CPipelineResult_destroy_array(results);
+		}
+	}
+}
+
+static void warmup_run()
+{
+	auto start = std::chrono::steady_clock::now();
+	CImage_t* image = mi_warmup_image();
+	if (image != NULL) {
+		std::vector<int> sizes = warmup_batch_sizes();
+		if (g_pPool != NULL) {
+			//. hold every slot so each instance is warmed exactly once.
+			std::vector<std::unique_ptr<PipelineLease>> leases;
+			for (int i = 0; i < g_pPool->size(); i++) leases.emplace_back(new PipelineLease(g_pPool));
+			for (auto& lease : leases) warm_pipeline(lease->pipeline(), image, sizes, g_Settings.warmupIterations);
+		}
+		else {
+			PipelineRef ref = g_Supervisor.current();
+			if (ref && ref->pipeline != NULL) warm_pipeline(ref->pipeline, image, sizes, g_Settings.warmupIterations);
+		}
+		face_sdk_api().image_destroy(image);
+	}
+	else {
+		std::cout << "Warm-up : no image could be created, skipped" << std::endl;
+	}
+	if (g_pBackend != NULL && !lv_bStop) g_pBackend->warm_up(g_Settings.warmupIterations);
+
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Warm-up done in " << ms << " ms." << std::endl;
+	lv_bReady = true;
+	mi_startup_warm();
+}
+
+void mi_warmup_pipelines(const std::vector<CPipeline_t*>& p_vPipelines)
+{
+	if (!g_Settings.warmupEnable || g_Settings.warmupIterations <= 0 || p_vPipelines.empty()) return;
+
+	CImage_t* image = mi_warmup_image();
+	if (image == NULL) return;
+	std::vector<int> sizes = warmup_batch_sizes();
+	for (CPipeline_t* p : p_vPipelines) warm_pipeline(p, image, sizes, g_Settings.warmupIterations);
+	face_sdk_api().image_destroy(image);
+}
+
+bool mi_warmup_prepare(CPipeline_t* p_pPipeline)
+{
+	CImage_t* image = mi_warmup_image();
+	if (p_pPipeline == NULL || image == NULL) {
+		if (image != NULL) face_sdk_api().image_destroy(image);
+		std::cout << "Prepare : no pipeline or warm-up image" << std::endl;
+		return false;
+	}
+	//. one pass compiles (and caches) every batch shape, more only repeats it.
+	warm_pipeline(p_pPipeline, image, warmup_batch_sizes(), 1);
+	face_sdk_api().image_destroy(image);
+	mi_startup_phase("pipeline");
+
+	if (g_Settings.backendEngine != "legacy") {
+		std::string strErr;
+		InferenceBackend* pBackend = mi_backend_create(g_Settings.backendEngine, strErr);
+		if (pBackend == NULL) {
+			std::cout << "Prepare : backend " << g_Settings.backendEngine << " unavailable : " << strErr << std::endl;
+			return false;
+		}
+		pBackend->warm_up(1);
+		delete pBackend;
+		mi_startup_phase("backend");
+	}
+	return true;
+}
+
+void mi_warmup_start()
+{
+	if (!g_Settings.warmupEnable || g_Settings.warmupIterations <= 0) {
+		lv_bReady = true;
+		mi_startup_warm();
+		return;
+	}
+	lv_bStop = false;
+	lv_thread = std::thread(warmup_run);
+}
+
+void mi_warmup_stop()
+{
+	lv_bStop = true;
+	if (lv_thread.joinable()) lv_thread.join();
+	lv_bReady = false;
+}
+
+bool mi_ready()
+{
+	return lv_bReady.load(std::memory_order_acquire) && !lv_bDraining.load(std::memory_order_acquire);
+}
+
+void mi_ready_drain()
+{
+	lv_bDraining = true;
+}
+
+bool mi_draining()
+{
+	return lv_bDraining.load(std::memory_order_acquire);
+}
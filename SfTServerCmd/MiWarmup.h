@@ -0,0 +1,32 @@
+#pragma once
+
+//. Startup warm-up : runs [warmup] iterations dummy checks through every pipeline
+//. instance and batch size on a background thread, so OpenVINO graph compilation and
+//. lazy allocations happen before traffic arrives. GD_API_READY answers 200 only
+//. once it has finished (at once when [warmup] enable = false). With [batch] buckets the
+//. sizes are the buckets, each run as a batch call and timed for their cost (MiBuckets.h).
+
+#include <vector>
+#include "FaceSdkApi.h"
+
+void mi_warmup_start();
+void mi_warmup_stop();
+
+//. same warm-up on the calling thread, for pipelines not yet visible to requests
+//. (the supervisor's next generation). No-op when [warmup] is disabled.
+void mi_warmup_pipelines(const std::vector<CPipeline_t*>& p_vPipelines);
+
+//. SfTServerCmd --prepare : one warm-up pass over p_pPipeline and every batch size, then
+//. over the [backend] engine, on the calling thread and regardless of [warmup] enable.
+//. With sdk.ov_cache_dir set this leaves the compiled blobs for the next start.
+bool mi_warmup_prepare(CPipeline_t* p_pPipeline);
+
+//. [warmup] image, else a synthetic frame; the caller destroys it. NULL when neither works.
+CImage_t* mi_warmup_image();
+
+bool mi_ready();
+
+//. shutdown has begun : GD_API_READY answers 503 from now on so load balancers stop
+//. sending new requests while the ones in flight finish.
+void mi_ready_drain();
+bool mi_draining();
@@ -0,0 +1,329 @@
+#include "MiWatchdog.h"
+#include "MiBatcher.h"
+#include "MiConf.h"
+#include "MiCost.h"
+#include "MiLock.h"
+#include "MiMetrics.h"
+#include "MiPipelinePool.h"
+#include "MiSdkCall.h"
+#include "MiSupervisor.h"
+#include "MiTrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono;
+
+//. one liveness call handed to a watchdog thread; shared with the request until it gives up.
+struct WatchedCall {
+	ImageHandle				image;			//. keeps the pixels alive for an abandoned call
+	const CMeta_t*			meta;
+	WatchedLiveness			check;
+	CPipelineResult_t		result;
+	int						err;
+	char					msg[MESSAGE_BUFFER_SIZE];
+	int						timeout;		//. WatchStage met on the watchdog thread, -1 = none
+	//. the request's context as the call sees it : tenant routing, deadline, cost. A copy, not
+	//. the request's own, which is gone once an abandoned call returns.
+	RequestContext			ctx;
+	steady_clock::time_point	start;
+	steady_clock::time_point	end;
+	std::mutex				mtx;
+	std::condition_variable	cv;
+	bool					done;			//. under mtx
+	bool					abandoned;		//. under mtx
+	WatchedCall() : meta(NULL), err(OK), timeout(-1), done(false), abandoned(false)
+	{
+		memset(&result, 0, sizeof(result));
+		msg[0] = 0;
+	}
+};
+typedef std::shared_ptr<WatchedCall> WatchedCallRef;
+
+//. the watchdog threads, spawned on demand and detached : a stuck one cannot be joined. They
+//. hold the state themselves, so it outlives mi_watchdog_shutdown.
+struct WatchRunners {
+	std::mutex					mtx;
+	std::condition_variable		cv;
+	std::deque<WatchedCallRef>	queue;
+	int							threads = 0;
+	int							idle = 0;
+	int							max = 1;
+	bool						stop = false;
+};
+
+static const char*					lv_szStages[MI_WATCH_COUNT] = { "decode", "queue", "liveness" };
+static WatchdogSettings				lv_settings = { 0, 0, 0, 0 };
+static bool							lv_bEnabled = false;
+static std::shared_ptr<WatchRunners>	lv_pRunners;
+static std::atomic<int>				lv_nAbandoned(0);
+static std::atomic<uint64_t>		lv_nRebuilds(0);
+static std::atomic<unsigned int>	lv_nReported(0);	//. generation last reported stuck + 1
+static thread_local WatchedCall*	lv_pCall = NULL;
+
+static std::thread					lv_thread;
+static MI_MUTEX(lv_mtx, "watchdog");
+static MiCondition					lv_cv;
+static bool							lv_bStop = false;
+
+const char* mi_watch_stage_name(int p_nStage)
+{
+	return p_nStage >= 0 && p_nStage < MI_WATCH_COUNT ? lv_szStages[p_nStage] : "unknown";
+}
+
+static int stage_limit_ms(int p_nStage)
+{
+	switch (p_nStage) {
+	case MI_WATCH_DECODE: return lv_settings.decodeMs;
+	case MI_WATCH_QUEUE: return lv_settings.queueMs;
+	case MI_WATCH_LIVENESS: return lv_settings.livenessMs;
+	default: return 0;
+	}
+}
+
+static void watchdog_loop()
+{
+	MiUniqueLock lock(lv_mtx);
+	while (!lv_bStop) {
+		lv_cv.wait_for(lock, milliseconds(GD_WATCHDOG_TICK_MS), [] { return lv_bStop; });
+		if (lv_bStop) break;
+		lock.unlock();
+		if (g_pPool != NULL) g_pPool->retire_stuck(lv_settings.livenessMs);
+		lock.lock();
+	}
+}
+
+void mi_watchdog_init(const WatchdogSettings& p_settings)
+{
+	lv_settings = p_settings;
+	lv_settings.decodeMs = std::max(lv_settings.decodeMs, 0);
+	lv_settings.queueMs = std::max(lv_settings.queueMs, 0);
+	lv_settings.livenessMs = std::max(lv_settings.livenessMs, 0);
+	lv_pRunners = std::make_shared<WatchRunners>();
+	lv_pRunners->max = std::max(lv_settings.threads, 1);
+	lv_bEnabled = true;
+	if (lv_settings.livenessMs > 0) {
+		lv_bStop = false;
+		lv_thread = std::thread(watchdog_loop);
+	}
+	std::cout << "Watchdog : decode " << lv_settings.decodeMs << " ms, queue " << lv_settings.queueMs << " ms, liveness "
+		<< lv_settings.livenessMs << " ms (0 = no limit), " << lv_pRunners->max << " threads" << std::endl;
+}
+
+void mi_watchdog_shutdown()
+{
+	if (!lv_bEnabled) return;
+	lv_bEnabled = false;
+	if (lv_thread.joinable()) {
+		{
+			MiLockGuard lock(lv_mtx);
+			lv_bStop = true;
+		}
+		lv_cv.notify_all();
+		lv_thread.join();
+	}
+	std::shared_ptr<WatchRunners> runners = lv_pRunners;
+	{
+		std::lock_guard<std::mutex> lock(runners->mtx);
+		runners->stop = true;
+	}
+	runners->cv.notify_all();
+}
+
+bool mi_watchdog_enabled()
+{
+	return lv_bEnabled;
+}
+
+steady_clock::time_point mi_watchdog_queue_limit()
+{
+	if (!lv_bEnabled || lv_settings.queueMs == 0) return steady_clock::time_point::max();
+	return steady_clock::now() + milliseconds(lv_settings.queueMs);
+}
+
+void mi_watchdog_timeout(WatchStage p_stage, int* p_pErr, char* p_pszMsg, RequestContext* p_pCtx)
+{
+	*p_pErr = UNKNOWN;
+	snprintf(p_pszMsg, MESSAGE_BUFFER_SIZE, "%s timed out after %d ms", mi_watch_stage_name(p_stage), stage_limit_ms(p_stage));
+	mi_metrics_watchdog_timeout(p_stage);
+	//. on a watchdog thread the request is told when it collects the call.
+	if (p_pCtx == NULL && lv_pCall != NULL) lv_pCall->timeout = p_stage;
+	else if (p_pCtx != NULL || (p_pCtx = mi_context()) != NULL) p_pCtx->timeout = p_stage;
+}
+
+bool mi_watchdog_expired(WatchStage p_stage, steady_clock::time_point p_start, int* p_pErr, char* p_pszMsg, RequestContext* p_pCtx)
+{
+	int nLimit = lv_bEnabled ? stage_limit_ms(p_stage) : 0;
+	if (nLimit == 0 || steady_clock::now() - p_start <= milliseconds(nLimit)) return false;
+	mi_watchdog_timeout(p_stage, p_pErr, p_pszMsg, p_pCtx);
+	return true;
+}
+
+int mi_watchdog_timed_out()
+{
+	RequestContext* ctx = mi_context();
+	return ctx != NULL ? ctx->timeout : -1;
+}
+
+//. what the call reads of its request; no client (not probed), trace or profile.
+static void copy_context(const RequestContext& p_from, RequestContext& p_to)
+{
+	p_to.deadline = p_from.deadline;
+	p_to.tenant = p_from.tenant;
+	memcpy(p_to.traceId, p_from.traceId, sizeof(p_to.traceId));
+	p_to.degraded = p_from.degraded;
+	p_to.imageHash = p_from.imageHash;
+	p_to.imageSize = p_from.imageSize;
+	memcpy(p_to.imageDigest, p_from.imageDigest, sizeof(p_to.imageDigest));
+	p_to.config = p_from.config;
+}
+
+static void run_call(const WatchedCallRef& p_call)
+{
+	ContextBorrow borrow(&p_call->ctx);
+	lv_pCall = p_call.get();
+	p_call->start = steady_clock::now();
+	try {
+		const CImage_t* pImage = p_call->image ? p_call->image->get() : NULL;
+		p_call->result = p_call->check(pImage, p_call->meta, &p_call->err, p_call->msg);
+	}
+	catch (const std::exception& ex) {
+		p_call->err = UNKNOWN;
+		snprintf(p_call->msg, MESSAGE_BUFFER_SIZE, "%s", ex.what());
+	}
+	p_call->end = steady_clock::now();
+	lv_pCall = NULL;
+
+	bool bAbandoned;
+	{
+		std::lock_guard<std::mutex> lock(p_call->mtx);
+		p_call->done = true;
+		bAbandoned = p_call->abandoned;
+	}
+	p_call->cv.notify_one();
+	if (bAbandoned) {
+		lv_nAbandoned.fetch_sub(1, std::memory_order_relaxed);
+		std::cout << "Watchdog : abandoned liveness call returned after "
+			<< duration_cast<milliseconds>(p_call->end - p_call->start).count() << " ms" << std::endl;
+	}
+}
+
+static void runner_loop(std::shared_ptr<WatchRunners> p_runners)
+{
+	std::unique_lock<std::mutex> lock(p_runners->mtx);
+	for (;;) {
+		p_runners->idle++;
+		p_runners->cv.wait(lock, [&] { return p_runners->stop || !p_runners->queue.empty(); });
+		p_runners->idle--;
+		if (p_runners->queue.empty()) break;
+		WatchedCallRef call = p_runners->queue.front();
+		p_runners->queue.pop_front();
+		lock.unlock();
+		run_call(call);
+		call.reset();
+		lock.lock();
+	}
+	p_runners->threads--;
+}
+
+//. false when every watchdog thread is taken (stuck calls) or the watchdog stops.
+static bool post_call(const WatchedCallRef& p_call)
+{
+	std::shared_ptr<WatchRunners> runners = lv_pRunners;
+	{
+		std::lock_guard<std::mutex> lock(runners->mtx);
+		if (runners->stop) return false;
+		if (runners->idle <= (int)runners->queue.size()) {
+			if (runners->threads >= runners->max) return false;
+			runners->threads++;
+			std::thread(runner_loop, runners).detach();
+		}
+		runners->queue.push_back(p_call);
+	}
+	runners->cv.notify_one();
+	return true;
+}
+
+//. the pipeline the call was stuck on is the supervisor's when the pool cannot replace it.
+static void report_stuck()
+{
+	if (g_pPool != NULL && g_pPool->replaceable() && g_pBatcher == NULL) return;
+	PipelineRef ref = g_Supervisor.current();
+	if (!ref) return;
+	unsigned int nPrev = lv_nReported.exchange(ref->generation + 1);
+	if (nPrev == ref->generation + 1) return;
+	lv_nRebuilds.fetch_add(1, std::memory_order_relaxed);
+	std::cout << "Watchdog : stuck liveness call on generation " << ref->generation << ", rebuilding it" << std::endl;
+	g_Supervisor.report(ref);
+}
+
+CPipelineResult_t mi_watchdog_liveness(const ImageHandle& p_image, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg, const WatchedLiveness& p_fnCheck)
+{
+	const CImage_t* pImage = p_image ? p_image->get() : NULL;
+	if (!lv_bEnabled || lv_settings.livenessMs == 0) return p_fnCheck(pImage, p_pMeta, p_pErr, p_pszMsg);
+
+	RequestContext* ctx = mi_context();
+	WatchedCallRef call = std::make_shared<WatchedCall>();
+	call->image = p_image;
+	call->meta = p_pMeta;
+	call->check = p_fnCheck;
+	call->err = *p_pErr;
+	if (ctx != NULL) copy_context(*ctx, call->ctx);
+	if (!post_call(call)) {
+		//. every thread is held by a stuck call : an unwatched call here would be the next one.
+		mi_watchdog_timeout(MI_WATCH_LIVENESS, p_pErr, p_pszMsg);
+		snprintf(p_pszMsg, MESSAGE_BUFFER_SIZE, "liveness not started, all %d watchdog threads busy", lv_pRunners->max);
+		CPipelineResult_t result;
+		memset(&result, 0, sizeof(result));
+		return result;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(call->mtx);
+		if (!call->cv.wait_for(lock, milliseconds(lv_settings.livenessMs), [&] { return call->done; })) {
+			call->abandoned = true;
+			lock.unlock();
+			lv_nAbandoned.fetch_add(1, std::memory_order_relaxed);
+			mi_watchdog_timeout(MI_WATCH_LIVENESS, p_pErr, p_pszMsg);
+			report_stuck();
+			CPipelineResult_t result;
+			memset(&result, 0, sizeof(result));
+			return result;
+		}
+	}
+	*p_pErr = call->err;
+	memcpy(p_pszMsg, call->msg, MESSAGE_BUFFER_SIZE);
+	if (ctx != NULL) {
+		if (call->timeout >= 0) ctx->timeout = call->timeout;
+		if (call->ctx.canary) ctx->canary = true;
+		mi_cost_infer(ctx, call->ctx.cost.inferNs.load(std::memory_order_relaxed) * 1e-9);
+	}
+#if GD_SDK_INSTRUMENT
+	//. the copied context carries no trace.
+	mi_trace_record(mi_sdk_call_name(MI_SDK_CHECK_LIVENESS), call->start, call->end);
+#endif
+	if (g_pBatcher == NULL) mi_request_profile_batch(1);
+	return call->result;
+}
+
+int mi_watchdog_abandoned()
+{
+	return lv_nAbandoned.load(std::memory_order_relaxed);
+}
+
+uint64_t mi_watchdog_replaced()
+{
+	return lv_nRebuilds.load(std::memory_order_relaxed) + (g_pPool != NULL ? g_pPool->retired() : 0);
+}
+
+bool mi_watchdog_watched()
+{
+	return lv_pCall != NULL;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include "FaceSdkApi.h"
+#include "MiContext.h"
+#include "MiImage.h"
+
+//. Per-stage timeouts ([watchdog] settings) : one pathological image should not hold a request
+//. thread, and with a pool the pipeline it borrowed, for seconds.
+//. - decode_ms : the decode of the uploads (LegacyBackend). A single image whose decode went
+//.   over it is not checked; a batch stops decoding its remaining images.
+//. - queue_ms : the wait for a free pool slot (PipelineLease with a limit).
+//. - liveness_ms : the liveness call of a single-image check. The SDK cannot be interrupted, so
+//.   the call runs on a watchdog thread holding its own reference to the image; the request
+//.   waits for it at most that long, then answers and leaves the call behind (abandoned, its
+//.   result dropped when it returns). Every GD_WATCHDOG_TICK_MS the watchdog thread retires the
+//.   pool slots lent out for longer (PipelinePool::retire_stuck) : a new pipeline for the slot,
+//.   the stuck one destroyed by its call. Without a pool of its own (no pool, [pool] shared) the
+//.   stuck pipeline is the supervisor's, which rebuilds the generation as on a license error.
+//. A stage over its limit answers UNKNOWN with "<stage> timed out" and marks the request
+//. (RequestContext::timeout); the single-image endpoint sends 504 then. The watched call runs
+//. on a copy of the request context (tenant, deadline, configuration snapshot), which it keeps
+//. when abandoned : the batcher orders it by the deadline, the precision pools route it by the
+//. tenant. Its span, inference time and canary mark are added to the request when it returns
+//. in time. When every watchdog thread is held by a stuck call, a new call is not started and
+//. the request answers as timed out : checking it unwatched would risk the next stuck thread.
+//. mi_watchdog_timeouts_total{stage}, mi_watchdog_replaced_total and mi_watchdog_abandoned_calls
+//. on GD_API_METRICS.
+
+enum WatchStage {
+	MI_WATCH_DECODE = 0,
+	MI_WATCH_QUEUE,
+	MI_WATCH_LIVENESS,
+	MI_WATCH_COUNT
+};
+
+struct WatchdogSettings {
+	int		decodeMs;		//. 0 = no limit, for every stage
+	int		queueMs;
+	int		livenessMs;
+	int		threads;		//. watched calls running at once
+};
+
+const char* mi_watch_stage_name(int p_nStage);
+
+//. starts the watchdog thread; the stages stay unlimited until then.
+void mi_watchdog_init(const WatchdogSettings& p_settings);
+//. stops it; watched calls still stuck in the SDK are left to their threads.
+void mi_watchdog_shutdown();
+bool mi_watchdog_enabled();
+
+//. time by which a pool slot wait started now gives up, time_point::max() without queue_ms.
+std::chrono::steady_clock::time_point mi_watchdog_queue_limit();
+
+//. true when stage p_stage begun at p_start is over its limit : the timeout is recorded as by
+//. mi_watchdog_timeout. p_pCtx : the request, the current one when NULL (executor threads).
+bool mi_watchdog_expired(WatchStage p_stage, std::chrono::steady_clock::time_point p_start, int* p_pErr, char* p_pszMsg, RequestContext* p_pCtx = NULL);
+
+//. UNKNOWN and "<stage> timed out" into *p_pErr / p_pszMsg, counted, the request marked.
+void mi_watchdog_timeout(WatchStage p_stage, int* p_pErr, char* p_pszMsg, RequestContext* p_pCtx = NULL);
+
+//. the stage the current request timed out at, -1 = none.
+int mi_watchdog_timed_out();
+
+//. true on a watchdog thread running a call : the pool slot it borrows is watched (PipelineLease::watch).
+bool mi_watchdog_watched();
+
+typedef std::function<CPipelineResult_t(const CImage_t*, const CMeta_t*, int*, char*)> WatchedLiveness;
+
+//. p_fnCheck on a watchdog thread, waited for at most liveness_ms, see above; called here when
+//. liveness_ms is 0. p_pMeta must outlive the call (MiMeta.h entries do).
+CPipelineResult_t mi_watchdog_liveness(const ImageHandle& p_image, const CMeta_t* p_pMeta, int* p_pErr, char* p_pszMsg, const WatchedLiveness& p_fnCheck);
+
+//. watched calls abandoned by their request and still in the SDK.
+int mi_watchdog_abandoned();
+//. stuck pipelines replaced, pool slots and supervisor rebuilds.
+uint64_t mi_watchdog_replaced();
@@ -0,0 +1,61 @@
+#include "MiWic.h"
+#include <mutex>
+
+//. WIC needs COM on every thread that decodes; request threads join the MTA once.
+struct ComThread {
+	HRESULT hr;
+	ComThread() : hr(CoInitializeEx(NULL, COINIT_MULTITHREADED)) {}
+	~ComThread() { if (SUCCEEDED(hr)) CoUninitialize(); }
+	bool ok() const { return SUCCEEDED(hr) || hr == RPC_E_CHANGED_MODE; }
+};
+static thread_local ComThread	lv_com;
+static IWICImagingFactory*		lv_pFactory = NULL;
+static std::once_flag			lv_once;
+
+IWICImagingFactory* mi_wic_factory()
+{
+	if (!lv_com.ok()) return NULL;
+	std::call_once(lv_once, [] {
+		if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_IWICImagingFactory, (LPVOID*)&lv_pFactory))) lv_pFactory = NULL;
+	});
+	return lv_pFactory;
+}
+
+bool mi_wic_open(const uint8_t* p_pData, size_t p_nLen, ComRef<IWICStream>& p_stream, ComRef<IWICBitmapDecoder>& p_decoder, ComRef<IWICBitmapFrameDecode>& p_frame, bool* p_pbJpeg)
+{
+	IWICImagingFactory* factory = mi_wic_factory();
+	if (factory == NULL || p_nLen == 0 || p_nLen > 0xFFFFFFFFu) return false;
+	if (FAILED(factory->CreateStream(&p_stream.p))) return false;
+	if (FAILED(p_stream->InitializeFromMemory((WICInProcPointer)p_pData, (DWORD)p_nLen))) return false;
+	return mi_wic_open_stream(p_stream.p, p_decoder, p_frame, p_pbJpeg);
+}
+
+bool mi_wic_open_stream(IStream* p_pStream, ComRef<IWICBitmapDecoder>& p_decoder, ComRef<IWICBitmapFrameDecode>& p_frame, bool* p_pbJpeg)
+{
+	IWICImagingFactory* factory = mi_wic_factory();
+	if (factory == NULL) return false;
+	if (FAILED(factory->CreateDecoderFromStream(p_pStream, NULL, WICDecodeMetadataCacheOnDemand, &p_decoder.p))) return false;
+	if (FAILED(p_decoder->GetFrame(0, &p_frame.p))) return false;
+	if (p_pbJpeg != NULL) {
+		GUID container;
+		*p_pbJpeg = SUCCEEDED(p_decoder->GetContainerFormat(&container)) && IsEqualGUID(container, GUID_ContainerFormatJpeg);
+	}
+	return true;
+}
+
+int mi_wic_orientation(IWICBitmapFrameDecode* p_pFrame)
+{
+	ComRef<IWICMetadataQueryReader> query;
+	if (FAILED(p_pFrame->GetMetadataQueryReader(&query.p))) return 1;
+	PROPVARIANT v;
+	PropVariantInit(&v);
+	int orientation = 1;
+	if (SUCCEEDED(query->GetMetadataByName(L"/app1/ifd/{ushort=274}", &v)) && v.vt == VT_UI2 && v.uiVal >= 1 && v.uiVal <= 8) orientation = v.uiVal;
+	PropVariantClear(&v);
+	return orientation;
+}
+
+bool mi_wic_rotated(IWICBitmapFrameDecode* p_pFrame)
+{
+	return mi_wic_orientation(p_pFrame) > 1;
+}
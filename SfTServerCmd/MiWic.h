@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wincodec.h>
+
+//. Windows Imaging Component helpers shared by the decode paths that need pixels
+//. before the SDK sees the image (MiFaceCrop.h, MiDecode.h).
+
+//. COM released with its interface pointer.
+template <typename T>
+struct ComRef {
+	T* p;
+	ComRef() : p(NULL) {}
+	~ComRef() { if (p != NULL) p->Release(); }
+	T* operator->() const { return p; }
+private:
+	ComRef(const ComRef&) = delete;
+	ComRef& operator=(const ComRef&) = delete;
+};
+
+//. free-threaded factory, created on first use and kept for the process lifetime.
+//. Joins the calling thread to the MTA; NULL when WIC is unavailable.
+IWICImagingFactory* mi_wic_factory();
+
+//. first frame of an encoded upload. p_pbJpeg (optional) tells whether the container is JPEG.
+bool mi_wic_open(const uint8_t* p_pData, size_t p_nLen, ComRef<IWICStream>& p_stream, ComRef<IWICBitmapDecoder>& p_decoder, ComRef<IWICBitmapFrameDecode>& p_frame, bool* p_pbJpeg = NULL);
+//. the same from any stream, e.g. one still being received (MiProgressive.h).
+bool mi_wic_open_stream(IStream* p_pStream, ComRef<IWICBitmapDecoder>& p_decoder, ComRef<IWICBitmapFrameDecode>& p_frame, bool* p_pbJpeg = NULL);
+
+//. EXIF orientation of the frame, 1 (upright) when it has none. WIC hands out the pixels
+//. as stored : the SDK applies the orientation itself, pixels read here must be turned
+//. upright (MiOrient.h) or the upload left to the SDK.
+int mi_wic_orientation(IWICBitmapFrameDecode* p_pFrame);
+bool mi_wic_rotated(IWICBitmapFrameDecode* p_pFrame);
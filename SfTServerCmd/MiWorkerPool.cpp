@@ -0,0 +1,104 @@
+#include "MiWorkerPool.h"
+#include "MiCores.h"
+
+WorkerPool* g_pWorkerPool = NULL;
+
+WorkerPool::WorkerPool(int p_nThreads, int p_nCapacity)
+	: m_nThreads(p_nThreads > 0 ? p_nThreads : 1)
+	, m_nCapacity(p_nCapacity > 0 ? p_nCapacity : 1)
+	, m_bStop(false)
+	, m_nRunning(0)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+void WorkerPool::start()
+{
+	MiLockGuard lock(m_mtx);
+	if (!m_threads.empty()) return;
+	m_bStop = false;
+	for (int i = 0; i < m_nThreads; i++) {
+		m_threads.emplace_back(&WorkerPool::run, this);
+	}
+}
+
+void WorkerPool::stop()
+{
+	{
+		MiLockGuard lock(m_mtx);
+		m_bStop = true;
+	}
+	m_cv.notify_all();
+	for (auto& t : m_threads) {
+		if (t.joinable()) t.join();
+	}
+	m_threads.clear();
+}
+
+bool WorkerPool::submit(std::function<void()> p_fn, int p_nLane)
+{
+	{
+		MiLockGuard lock(m_mtx);
+		std::deque<std::function<void()>>& q = m_queues[p_nLane];
+		if (m_bStop || (int)q.size() >= m_nCapacity) return false;
+		q.push_back(std::move(p_fn));
+	}
+	m_cv.notify_one();
+	return true;
+}
+
+int WorkerPool::queued()
+{
+	MiLockGuard lock(m_mtx);
+	size_t n = 0;
+	for (int i = 0; i < MI_LANE_COUNT; i++) n += m_queues[i].size();
+	return (int)n;
+}
+
+int WorkerPool::pending()
+{
+	MiLockGuard lock(m_mtx);
+	size_t n = m_nRunning;
+	for (int i = 0; i < MI_LANE_COUNT; i++) n += m_queues[i].size();
+	return (int)n;
+}
+
+int WorkerPool::queued(int p_nLane)
+{
+	MiLockGuard lock(m_mtx);
+	return (int)m_queues[p_nLane].size();
+}
+
+void WorkerPool::run()
+{
+	mi_cores_pin(MI_CORES_INFERENCE);
+	bool bReady[MI_LANE_COUNT];
+	MiUniqueLock lock(m_mtx);
+	while (true) {
+		int lane = -1;
+		m_cv.wait(lock, [this, &bReady, &lane] {
+			if (m_bStop) return true;
+			for (int i = 0; i < MI_LANE_COUNT; i++) bReady[i] = !m_queues[i].empty();
+			lane = m_sched.pick(bReady);
+			return lane >= 0;
+		});
+		//. jobs still queued at stop are dropped, their connections are closed by the reactor.
+		if (m_bStop) break;
+
+		std::function<void()> fn = std::move(m_queues[lane].front());
+		m_queues[lane].pop_front();
+		m_nRunning++;
+		lock.unlock();
+		try {
+			fn();
+		}
+		catch (...) {
+		}
+		lock.lock();
+		m_nRunning--;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "MiLanes.h"
+#include "MiLock.h"
+
+//. Fixed set of inference threads fed from one bounded queue per lane. The reactor
+//. front end hands fully received requests here, so slow uploads never hold an
+//. inference thread. Idle workers take the next job from the lane LaneScheduler picks.
+class WorkerPool {
+public:
+	WorkerPool(int p_nThreads, int p_nCapacity);
+	~WorkerPool();
+
+	void start();
+	void stop();
+
+	//. queues p_fn on lane p_nLane. Returns false when that lane's queue is full or the
+	//. pool is stopped, the caller then answers the request itself.
+	bool submit(std::function<void()> p_fn, int p_nLane = MI_LANE_INTERACTIVE);
+
+	int queued();
+	int queued(int p_nLane);
+	//. queued plus running, 0 once the pool is idle.
+	int pending();
+	int threads() const { return m_nThreads; }
+	int capacity() const { return m_nCapacity; }
+
+private:
+	void run();
+
+	int									m_nThreads;
+	int									m_nCapacity;		//. per lane
+	bool								m_bStop;
+	int									m_nRunning;
+
+	MI_MUTEX(m_mtx, "worker_pool");
+	MiCondition							m_cv;
+	std::deque<std::function<void()>>	m_queues[MI_LANE_COUNT];
+	LaneScheduler						m_sched;
+	std::vector<std::thread>			m_threads;
+};
+
+extern WorkerPool* g_pWorkerPool;
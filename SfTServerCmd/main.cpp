@@ -1,15 +1,72 @@
 
 #include "MIServer.h"
 #include <stdio.h>
-#include <winsvc.h>
 #include "MiConf.h"
+#include "MiAlloc.h"
 #include "licenseproc.h"
+#include "FaceSdkApi.h"
+#include "MiSettings.h"
+#include "MiNuma.h"
+#include "MiCores.h"
+#include "MiAutoTune.h"
+#include "MiCpu.h"
+#include "MiBatchCli.h"
+#include "MiModelCache.h"
+#include "MiStartup.h"
+#include "MiWarmup.h"
+#include <string.h>
 
+extern CPipeline_t* g_pPipeline;
 
+int main(int argc, char* argv[]) {
 
-int main(char* argv, int argc) {
+    mi_startup_begin();
+    //. --prepare : build and warm the pipelines once, then exit. With sdk.ov_cache_dir set
+    //. this bakes the compiled models into a container image (docker/Dockerfile).
+    bool bPrepare = argc > 1 && strcmp(argv[1], "--prepare") == 0;
+    //. --batch <dir|manifest> ... : verdicts of an image archive to CSV / JSONL, see MiBatchCli.h
+    bool bBatch = argc > 1 && strcmp(argv[1], "--batch") == 0;
 
-    setting_init(1);
+    //. runtime settings; SDK threading knobs must be in the environment before the dll loads.
+    mi_settings_load();
+    bool bTuned = bPrepare || mi_autotune_load();
+    mi_settings_export_sdk_env();
+    mi_numa_init(g_Settings.numaEnable);
+    //. before any thread is started : they inherit the inference processors (Linux).
+    if (g_Settings.coresEnable && !mi_settings_worker_pool()) printf("cores.enable needs server.mode = reactor or proactor, core partition off\n");
+    else if (g_Settings.coresEnable && mi_numa_enabled()) printf("cores.enable does not combine with [numa], core partition off\n");
+    else mi_cores_init(g_Settings.coresEnable, g_Settings.coresIo);
+    mi_cpu_log();
+    mi_alloc_log();
+    mi_startup_phase("settings");
+
+    //. the global pipeline is pool slot 0, built on node 0.
+    {
+        NumaPin pin(0);
+        setting_init(1);
+    }
+
+    //. resolve every SDK entry point once; refuse to serve with a partial table.
+    const char* pszMissing = NULL;
+    if (face_sdk_api_publish(g_hFaceDll, &pszMissing) == false) {
+        printf("FaceSDK entry point not found : %s\n", pszMissing);
+        return 1;
+    }
+    mi_startup_phase("sdk_load");
+    mi_model_cache_report();
+    if (!bTuned) {
+        mi_autotune_run();
+        mi_startup_phase("autotune");
+    }
+    mi_settings_apply_sdk();
+
+    if (bPrepare) {
+        bool bOk = mi_warmup_prepare(g_pPipeline);
+        mi_model_cache_report();
+        printf("Prepare %s in %s\n", bOk ? "done" : "failed", mi_startup_summary().c_str());
+        return bOk ? 0 : 1;
+    }
+    if (bBatch) return mi_batch_main(argc, argv);
 
     //.
 	ClaHTTPServerWrapper app;
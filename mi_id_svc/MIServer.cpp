@@ -1,10 +1,531 @@
 #include "pch.h"
 #include "MIServer.h"
+#include "Poco/Environment.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/Process.h"
+#include "Poco/Redis/Client.h"
+#include "Poco/Redis/Command.h"
+#include <algorithm>
+#include <climits>
+#include <mutex>
+#include <sstream>
 //#include <atltime.h>
 
 ST_RESPONSE* lv_pstRes = NULL;
 #define LD_MAX_TRIAL_COUNT 100
 int lv_nTrialCount = 50 * 2;
+
+#define LD_UPSTREAMS_ENV			"MI_PROXY_UPSTREAMS"
+#define LD_UPSTREAMS_DEFAULT		"127.0.0.1:8080"
+#define LD_UPSTREAM_SESSIONS		16		//. kept-alive connections per server, also its cap of requests in flight
+#define LD_UPSTREAM_WAIT_MS			2000	//. wait for a free session before 503
+#define LD_UPSTREAM_TIMEOUT_SEC		60
+#define LD_UPSTREAM_KEEPALIVE_SEC	5		//. below the liveness server's keep_alive_timeout_sec
+#define LD_HEALTH_PATH				"/api/check_liveness_status"
+#define LD_HEALTH_INTERVAL_MS		1000
+#define LD_HEALTH_TIMEOUT_MS		500
+#define LD_EJECT_FAILS				3
+#define LD_SHM_ENV					"MI_PROXY_SHM"
+#define LD_SHM_PREFIX				"MiLiveIngest"		//. the workers map names under it only
+#define LD_SHM_SLOTS				16
+#define LD_SHM_SLOT_MB				8
+#define LD_SHM_API					"/api/check_liveness_shm"
+#define LD_AFFINITY_ENV				"MI_PROXY_AFFINITY"	//. "session" | "image", unset = least loaded
+#define LD_AFFINITY_SESSION			"X-Session-Id"		//. frames of one session, X-Request-Id of a retry otherwise
+#define LD_AFFINITY_RETRY			"X-Request-Id"
+#define LD_AFFINITY_BODY_MB			8		//. image affinity hashes uploads up to this size
+#define LD_RING_POINTS				128		//. ring points per server, evens out the key share
+#define LD_HEDGE_ENV				"MI_PROXY_HEDGE"		//. "1" = hedge slow checks
+#define LD_HEDGE_PCT_ENV			"MI_PROXY_HEDGE_PCT"	//. budget, percent of the requests
+#define LD_HEDGE_PCT_DEFAULT		5
+#define LD_HEDGE_WINDOW				1024	//. latencies the p95 is taken over
+#define LD_HEDGE_MIN_SAMPLES		64		//. no hedging before this many
+#define LD_HEDGE_RECOMPUTE			32		//. p95 refreshed every this many latencies
+#define LD_HEDGE_MIN_MS				10		//. floor of the hedge delay
+#define LD_HEDGE_BURST				10		//. hedges the budget can save up
+#define LD_HEDGE_BODY_MB			8		//. larger uploads are not buffered, not hedged
+#define LD_REGISTRY_ENV				"MI_PROXY_REGISTRY"	//. "redis://host:port[/prefix]" | "udp://port", unset = off
+#define LD_REGISTRY_PREFIX			"mi:"	//. the servers' redis.prefix
+#define LD_REGISTRY_HASH			"cluster"
+#define LD_REGISTRY_POLL_MS			250
+#define LD_REGISTRY_TIMEOUT_MS		200
+#define LD_REGISTRY_TTL_MS			5000	//. a report whose seq has not moved this long is stale
+#define LD_MAX_UPSTREAMS			64		//. configured plus announced servers
+#define LD_OTLP_ENV					"MI_PROXY_OTLP"			//. "http://collector:4318/v1/traces", unset = no export
+#define LD_OTLP_SERVICE_ENV			"MI_PROXY_OTLP_SERVICE"
+#define LD_OTLP_SERVICE_DEFAULT		"mi_id_svc"
+#define LD_OTLP_BATCH				512
+#define LD_OTLP_INTERVAL_MS			1000
+#define LD_OTLP_QUEUE				8192
+#define LD_TRACE_SAMPLE_ENV			"MI_PROXY_TRACE_SAMPLE"	//. start a sampled trace every N requests, 0 = never
+
+enum Affinity { AFFINITY_OFF = 0, AFFINITY_SESSION, AFFINITY_IMAGE };
+
+static Balancer			lv_balancer;
+static ShmRing			lv_shm;
+static std::once_flag	lv_onceBalancer;
+static Affinity			lv_affinity = AFFINITY_OFF;
+static HedgePolicy		lv_hedge;
+static int				lv_nTraceSample = 0;
+static std::atomic<unsigned int>	lv_nTraceCount(0);
+
+//. FNV-1a 64, never 0 (0 is "no key").
+static uint64_t affinity_hash(const void* p_pData, size_t p_nLen)
+{
+	const unsigned char* p = (const unsigned char*)p_pData;
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < p_nLen; i++) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	//. spreads the low-entropy keys (short ids) over the ring.
+	h ^= h >> 33; h *= 0xff51afd7ed558ccdULL; h ^= h >> 33;
+	return h != 0 ? h : 1;
+}
+
+static long long steady_ms()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//. slots the server has to spare now, INT_MIN without a fresh report of a ready server.
+static int spare_slots(const Upstream& p_upstream, long long p_lNowMs)
+{
+	long long lReported = p_upstream.reportedMs.load(std::memory_order_relaxed);
+	if (lReported == 0 || p_lNowMs - lReported > LD_REGISTRY_TTL_MS || !p_upstream.ready.load(std::memory_order_relaxed)) return INT_MIN;
+	//. what this proxy sent since the report is not in it yet.
+	int nSent = p_upstream.outstanding.load(std::memory_order_relaxed) - p_upstream.outstandingAtReport.load(std::memory_order_relaxed);
+	return p_upstream.spare.load(std::memory_order_relaxed) - std::max(nSent, 0);
+}
+
+ProxyTrace::ProxyTrace(const HTTPServerRequest& p_request) : m_nParent(0), m_nFlags(0), m_bOwner(true), m_start(std::chrono::steady_clock::now())
+{
+	if (!mi_traceparent_parse(p_request.get(MI_TRACEPARENT_HEADER, ""), m_nTraceHi, m_nTraceLo, m_nParent, m_nFlags)) {
+		m_nTraceHi = mi_trace_random_id();
+		m_nTraceLo = mi_trace_random_id();
+		m_nParent = 0;
+		m_nFlags = 0;
+		if (lv_nTraceSample > 0 && lv_nTraceCount.fetch_add(1, std::memory_order_relaxed) % (unsigned int)lv_nTraceSample == 0) m_nFlags = MI_TRACE_FLAG_SAMPLED;
+	}
+	m_nSpan = mi_trace_random_id();
+}
+
+ProxyTrace::ProxyTrace(const ProxyTrace& p_other) : m_nTraceHi(p_other.m_nTraceHi), m_nTraceLo(p_other.m_nTraceLo), m_nParent(p_other.m_nParent),
+	m_nSpan(p_other.m_nSpan), m_nFlags(p_other.m_nFlags), m_bOwner(false), m_start(p_other.m_start)
+{
+}
+
+ProxyTrace::~ProxyTrace()
+{
+	if (!m_bOwner || (m_nFlags & MI_TRACE_FLAG_SAMPLED) == 0 || !mi_otlp_enabled()) return;
+	OtlpSpan span = { m_nTraceHi, m_nTraceLo, m_nSpan, m_nParent, "proxy", MI_OTLP_SERVER, mi_otlp_unix_ns(m_start), mi_otlp_unix_ns(std::chrono::steady_clock::now()) };
+	mi_otlp_export(span);
+}
+
+std::string ProxyTrace::exchange(uint64_t& p_nSpan) const
+{
+	char sz[MI_TRACEPARENT_LEN + 1];
+	p_nSpan = mi_trace_random_id();
+	mi_traceparent_format(sz, sizeof(sz), m_nTraceHi, m_nTraceLo, p_nSpan, m_nFlags);
+	return sz;
+}
+
+void ProxyTrace::exchanged(uint64_t p_nSpan, std::chrono::steady_clock::time_point p_start) const
+{
+	if ((m_nFlags & MI_TRACE_FLAG_SAMPLED) == 0 || !mi_otlp_enabled()) return;
+	OtlpSpan span = { m_nTraceHi, m_nTraceLo, p_nSpan, m_nSpan, "upstream", MI_OTLP_CLIENT, mi_otlp_unix_ns(p_start), mi_otlp_unix_ns(std::chrono::steady_clock::now()) };
+	mi_otlp_export(span);
+}
+
+bool ShmRing::create(size_t p_nSlots, size_t p_nSlotSize)
+{
+	std::string strName = LD_SHM_PREFIX + std::to_string(Poco::Process::id());
+	try {
+		m_mem = Poco::SharedMemory(strName, p_nSlots * p_nSlotSize, Poco::SharedMemory::AM_WRITE);
+	}
+	catch (Poco::Exception& ex) {
+		cout << "Shared memory ingestion off : " << ex.displayText() << endl;
+		return false;
+	}
+	m_nSlots = p_nSlots;
+	m_nSlotSize = p_nSlotSize;
+	for (int i = (int)p_nSlots - 1; i >= 0; i--) m_vFree.push_back(i);
+	m_strName = strName;
+	return true;
+}
+
+int ShmRing::acquire()
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	if (m_vFree.empty()) return -1;
+	int nSlot = m_vFree.back();
+	m_vFree.pop_back();
+	return nSlot;
+}
+
+void ShmRing::release(int p_nSlot)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	m_vFree.push_back(p_nSlot);
+}
+
+void ShmPartHandler::handlePart(const MessageHeader& p_header, std::istream& p_stream)
+{
+	//. the reader skips what is left of the other parts.
+	if (m_bDone) return;
+	m_bDone = true;
+	p_stream.read(m_pSlot, (std::streamsize)m_nCapacity);
+	m_nLength = (size_t)p_stream.gcount();
+	if (p_stream.peek() != std::char_traits<char>::eof()) m_bOverflow = true;
+}
+
+Poco::SharedPtr<HTTPClientSession> UpstreamFactory::createObject()
+{
+	Poco::SharedPtr<HTTPClientSession> pSession = new HTTPClientSession(m_strHost, m_nPort);
+	pSession->setKeepAlive(true);
+	pSession->setTimeout(Poco::Timespan(LD_UPSTREAM_TIMEOUT_SEC, 0));
+	pSession->setKeepAliveTimeout(Poco::Timespan(LD_UPSTREAM_KEEPALIVE_SEC, 0));
+	return pSession;
+}
+
+Upstream::Upstream(const std::string& p_strHost, Poco::UInt16 p_nPort)
+	: name(p_strHost + ":" + std::to_string(p_nPort)), pool(UpstreamFactory(p_strHost, p_nPort), LD_UPSTREAM_SESSIONS, LD_UPSTREAM_SESSIONS),
+	  local(p_strHost == "127.0.0.1" || p_strHost == "localhost" || p_strHost == "::1"), outstanding(0), healthy(true), fails(0),
+	  spare(0), outstandingAtReport(0), ready(false), reportedMs(0), lastSeq(0)
+{
+}
+
+void Balancer::start(const std::string& p_strList, const std::string& p_strRegistry)
+{
+	//. never reallocated : pick() reads the servers while the registry thread appends.
+	m_vUpstreams.reserve(LD_MAX_UPSTREAMS);
+	std::string strList = p_strList.empty() ? LD_UPSTREAMS_DEFAULT : p_strList;
+	size_t pos = 0;
+	while (pos <= strList.size()) {
+		size_t end = strList.find(',', pos);
+		if (end == std::string::npos) end = strList.size();
+		std::string strItem = strList.substr(pos, end - pos);
+		size_t colon = strItem.rfind(':');
+		if (colon != std::string::npos && colon > 0) {
+			int nPort = atoi(strItem.c_str() + colon + 1);
+			if (nPort > 0 && nPort < 65536 && m_vUpstreams.size() < LD_MAX_UPSTREAMS) m_vUpstreams.emplace_back(new Upstream(strItem.substr(0, colon), (Poco::UInt16)nPort));
+		}
+		pos = end + 1;
+	}
+	if (m_vUpstreams.empty()) m_vUpstreams.emplace_back(new Upstream("127.0.0.1", 8080));
+	//. points from the server name : every proxy builds the same ring for the same list.
+	for (size_t i = 0; i < m_vUpstreams.size(); i++) {
+		for (int k = 0; k < LD_RING_POINTS; k++) {
+			std::string strPoint = m_vUpstreams[i]->name + "#" + std::to_string(k);
+			m_vRing.emplace_back(affinity_hash(strPoint.data(), strPoint.size()), (int)i);
+		}
+	}
+	std::sort(m_vRing.begin(), m_vRing.end());
+	m_nUpstreams.store(m_vUpstreams.size(), std::memory_order_release);
+	m_thread = std::thread(&Balancer::probe_loop, this);
+	if (!p_strRegistry.empty()) m_registry = std::thread(&Balancer::registry_loop, this, p_strRegistry);
+}
+
+void Balancer::stop()
+{
+	m_bStop = true;
+	if (m_thread.joinable()) m_thread.join();
+	if (m_registry.joinable()) m_registry.join();
+}
+
+Upstream* Balancer::add(const std::string& p_strName)
+{
+	size_t n = m_nUpstreams.load(std::memory_order_relaxed);
+	if (n >= LD_MAX_UPSTREAMS) return NULL;
+	size_t colon = p_strName.rfind(':');
+	if (colon == std::string::npos || colon == 0) return NULL;
+	int nPort = atoi(p_strName.c_str() + colon + 1);
+	if (nPort <= 0 || nPort >= 65536) return NULL;
+	m_vUpstreams.emplace_back(new Upstream(p_strName.substr(0, colon), (Poco::UInt16)nPort));
+	m_nUpstreams.store(n + 1, std::memory_order_release);
+	cout << "Upstream " << p_strName << " joined from the registry." << endl;
+	return m_vUpstreams[n].get();
+}
+
+void Balancer::report(const std::string& p_strLine)
+{
+	if (p_strLine.compare(0, 8, "mi-node ") != 0) return;
+	std::string strNode;
+	int nFree = 0, nQueue = 0;
+	bool bReady = false;
+	unsigned long long nSeq = 0;
+	std::istringstream fields(p_strLine.substr(8));
+	std::string strField;
+	while (fields >> strField) {
+		size_t eq = strField.find('=');
+		if (eq == std::string::npos) continue;
+		std::string strKey = strField.substr(0, eq);
+		const char* pszValue = strField.c_str() + eq + 1;
+		if (strKey == "node") strNode = pszValue;
+		else if (strKey == "free") nFree = atoi(pszValue);
+		else if (strKey == "queue") nQueue = atoi(pszValue);
+		else if (strKey == "ready") bReady = atoi(pszValue) != 0;
+		else if (strKey == "seq") nSeq = strtoull(pszValue, NULL, 10);
+	}
+	if (strNode.empty()) return;
+
+	Upstream* pUpstream = NULL;
+	size_t n = m_nUpstreams.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < n && pUpstream == NULL; i++) {
+		if (m_vUpstreams[i]->name == strNode) pUpstream = m_vUpstreams[i].get();
+	}
+	if (pUpstream == NULL) pUpstream = add(strNode);
+	//. the same line again (a Redis entry nobody refreshes) keeps its age.
+	if (pUpstream == NULL || nSeq == pUpstream->lastSeq) return;
+	pUpstream->lastSeq = nSeq;
+	pUpstream->spare.store(nFree - nQueue, std::memory_order_relaxed);
+	pUpstream->outstandingAtReport.store(pUpstream->outstanding.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	pUpstream->ready.store(bReady, std::memory_order_relaxed);
+	pUpstream->reportedMs.store(steady_ms(), std::memory_order_relaxed);
+}
+
+void Balancer::registry_loop(std::string p_strRegistry)
+{
+	if (p_strRegistry.compare(0, 6, "udp://") == 0) {
+		int nPort = atoi(p_strRegistry.c_str() + 6);
+		try {
+			DatagramSocket socket(SocketAddress("0.0.0.0", (Poco::UInt16)nPort), true);
+			socket.setReceiveTimeout(Poco::Timespan((Poco::Timespan::TimeDiff)LD_REGISTRY_TIMEOUT_MS * 1000));
+			cout << "Registry : node announcements on udp port " << nPort << endl;
+			char buffer[1024];
+			while (!m_bStop) {
+				try {
+					int nLen = socket.receiveBytes(buffer, sizeof(buffer));
+					if (nLen > 0) report(std::string(buffer, (size_t)nLen));
+				}
+				catch (Poco::TimeoutException&) {
+				}
+			}
+		}
+		catch (Poco::Exception& ex) {
+			cout << "Registry off : " << ex.displayText() << endl;
+		}
+		return;
+	}
+	if (p_strRegistry.compare(0, 8, "redis://") != 0) {
+		cout << "Registry off : unknown " << p_strRegistry << endl;
+		return;
+	}
+
+	std::string strAddress = p_strRegistry.substr(8);
+	std::string strHash = LD_REGISTRY_PREFIX;
+	size_t slash = strAddress.find('/');
+	if (slash != std::string::npos) {
+		strHash = strAddress.substr(slash + 1);
+		strAddress.resize(slash);
+	}
+	strHash += LD_REGISTRY_HASH;
+	cout << "Registry : polling " << strHash << " at " << strAddress << endl;
+
+	Poco::Redis::Client client;
+	Poco::Timespan timeout((Poco::Timespan::TimeDiff)LD_REGISTRY_TIMEOUT_MS * 1000);
+	while (!m_bStop) {
+		try {
+			if (!client.isConnected()) {
+				client.connect(SocketAddress(strAddress), timeout);
+				client.setReceiveTimeout(timeout);
+			}
+			//. field / value pairs : node, line.
+			Poco::Redis::Array reply = client.execute<Poco::Redis::Array>(Poco::Redis::Command::hgetall(strHash));
+			for (size_t i = 1; i < reply.size(); i += 2) {
+				Poco::Redis::BulkString line = reply.get<Poco::Redis::BulkString>(i);
+				if (!line.isNull()) report(line.value());
+			}
+		}
+		catch (Poco::Exception&) {
+			//. reports age out while Redis is away; reconnect on the next poll.
+			try {
+				client.disconnect();
+			}
+			catch (Poco::Exception&) {
+			}
+		}
+		for (int t = 0; t < LD_REGISTRY_POLL_MS / 50 && !m_bStop; t++) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
+
+Upstream* Balancer::pick(uint64_t p_nKey, const Upstream* p_pExclude)
+{
+	//. the key's owner, or the next healthy server clockwise with a session to spare.
+	if (p_nKey != 0 && !m_vRing.empty()) {
+		size_t nPoints = m_vRing.size();
+		size_t at = std::lower_bound(m_vRing.begin(), m_vRing.end(), std::make_pair(p_nKey, 0)) - m_vRing.begin();
+		for (size_t i = 0; i < nPoints; i++) {
+			Upstream* p = m_vUpstreams[m_vRing[(at + i) % nPoints].second].get();
+			if (p == p_pExclude) continue;
+			if (!p->healthy.load(std::memory_order_relaxed) || p->outstanding.load(std::memory_order_relaxed) >= LD_UPSTREAM_SESSIONS) continue;
+			p->outstanding.fetch_add(1, std::memory_order_relaxed);
+			return p;
+		}
+	}
+
+	size_t n = size();
+	size_t first = m_nNext.fetch_add(1, std::memory_order_relaxed) % n;
+	long long lNow = steady_ms();
+	Upstream* pBest = NULL;
+	Upstream* pAny = NULL;
+	Upstream* pRoom = NULL;
+	int nRoom = 0;
+	for (size_t i = 0; i < n; i++) {
+		Upstream* p = m_vUpstreams[(first + i) % n].get();
+		if (p == p_pExclude) continue;
+		int nOut = p->outstanding.load(std::memory_order_relaxed);
+		if (p->healthy.load(std::memory_order_relaxed)) {
+			int nSpare = spare_slots(*p, lNow);
+			if (nSpare > nRoom) {
+				nRoom = nSpare;
+				pRoom = p;
+			}
+		}
+		if (pAny == NULL || nOut < pAny->outstanding.load(std::memory_order_relaxed)) pAny = p;
+		if (!p->healthy.load(std::memory_order_relaxed)) continue;
+		if (pBest == NULL || nOut < pBest->outstanding.load(std::memory_order_relaxed)) pBest = p;
+	}
+	//. the most spare capacity the nodes reported, else the fewest in flight.
+	if (pRoom != NULL) pBest = pRoom;
+	if (pBest == NULL) pBest = pAny;
+	if (pBest == NULL) return NULL;
+	pBest->outstanding.fetch_add(1, std::memory_order_relaxed);
+	return pBest;
+}
+
+void Balancer::done(Upstream* p_pUpstream, bool p_bOk)
+{
+	p_pUpstream->outstanding.fetch_sub(1, std::memory_order_relaxed);
+	mark(*p_pUpstream, p_bOk);
+}
+
+void Balancer::mark(Upstream& p_upstream, bool p_bOk)
+{
+	if (p_bOk) {
+		p_upstream.fails = 0;
+		if (!p_upstream.healthy.exchange(true)) cout << "Upstream " << p_upstream.name << " back in rotation." << endl;
+		return;
+	}
+	if (++p_upstream.fails >= LD_EJECT_FAILS && p_upstream.healthy.exchange(false)) cout << "Upstream " << p_upstream.name << " ejected." << endl;
+}
+
+void Balancer::probe_loop()
+{
+	while (!m_bStop) {
+		for (size_t i = 0; i < size() && !m_bStop; i++) {
+			Upstream& upstream = *m_vUpstreams[i];
+			bool bOk = false;
+			try {
+				size_t colon = upstream.name.rfind(':');
+				HTTPClientSession session(upstream.name.substr(0, colon), (Poco::UInt16)atoi(upstream.name.c_str() + colon + 1));
+				session.setTimeout(Poco::Timespan((Poco::Timespan::TimeDiff)LD_HEALTH_TIMEOUT_MS * 1000));
+				HTTPRequest probe(HTTPRequest::HTTP_GET, LD_HEALTH_PATH, HTTPMessage::HTTP_1_1);
+				session.sendRequest(probe);
+				HTTPResponse probeResponse;
+				std::string strBody;
+				Poco::StreamCopier::copyToString(session.receiveResponse(probeResponse), strBody);
+				bOk = probeResponse.getStatus() == HTTPResponse::HTTP_OK;
+			}
+			catch (Poco::Exception&) {
+				bOk = false;
+			}
+			mark(upstream, bOk);
+		}
+		for (int t = 0; t < LD_HEALTH_INTERVAL_MS / 100 && !m_bStop; t++) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+}
+
+UpstreamLease::UpstreamLease(Balancer& p_balancer, uint64_t p_nKey, const Upstream* p_pExclude) : m_balancer(p_balancer), m_bOk(true)
+{
+	m_pUpstream = m_balancer.pick(p_nKey, p_pExclude);
+	if (m_pUpstream != NULL) m_pSession = m_pUpstream->pool.borrowObject(LD_UPSTREAM_WAIT_MS);
+}
+
+UpstreamLease::~UpstreamLease()
+{
+	if (m_pUpstream == NULL) return;
+	if (!m_pSession.isNull()) m_pUpstream->pool.returnObject(m_pSession);
+	m_balancer.done(m_pUpstream, m_bOk);
+}
+
+void HedgePolicy::request()
+{
+	int nCap = LD_HEDGE_BURST * 100;
+	int n = m_nTokens.load(std::memory_order_relaxed);
+	while (n < nCap && !m_nTokens.compare_exchange_weak(n, std::min(n + m_nPercent, nCap), std::memory_order_relaxed)) {}
+}
+
+bool HedgePolicy::take()
+{
+	int n = m_nTokens.load(std::memory_order_relaxed);
+	while (n >= 100) {
+		if (m_nTokens.compare_exchange_weak(n, n - 100, std::memory_order_relaxed)) return true;
+	}
+	return false;
+}
+
+void HedgePolicy::observe(unsigned int p_nMs)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	if (m_vWindow.size() < LD_HEDGE_WINDOW) m_vWindow.push_back(p_nMs);
+	else m_vWindow[m_nSamples % LD_HEDGE_WINDOW] = p_nMs;
+	m_nSamples++;
+	if (m_nSamples < LD_HEDGE_MIN_SAMPLES || m_nSamples % LD_HEDGE_RECOMPUTE != 0) return;
+	std::vector<unsigned int> v(m_vWindow);
+	size_t at = v.size() * 95 / 100;
+	std::nth_element(v.begin(), v.begin() + at, v.end());
+	m_nP95.store(std::max((int)v[at], LD_HEDGE_MIN_MS), std::memory_order_relaxed);
+}
+
+//. one exchange of a hedged request, on its own thread.
+static void hedge_attempt(std::shared_ptr<HedgeRace> p_pRace, int p_nIndex)
+{
+	HedgeAttempt& a = p_pRace->attempts[p_nIndex];
+	bool bOk = false;
+	uint64_t nSpan = 0;
+	auto start = std::chrono::steady_clock::now();
+	try {
+		HTTPClientSession& session = *a.lease->get();
+		HTTPRequest clientRequest(p_pRace->method, p_pRace->uri, HTTPMessage::HTTP_1_1);
+		clientRequest.setKeepAlive(true);
+		clientRequest.set(MI_TRACEPARENT_HEADER, p_pRace->trace.exchange(nSpan));
+		clientRequest.setContentType(p_pRace->contentType);
+		clientRequest.setContentLength64((Poco::Int64)p_pRace->body.size());
+		session.sendRequest(clientRequest).write(p_pRace->body.data(), (std::streamsize)p_pRace->body.size());
+
+		HTTPResponse clientResponse;
+		Poco::StreamCopier::copyToString64(session.receiveResponse(clientResponse), a.body);
+		a.status = clientResponse.getStatus();
+		a.contentType = clientResponse.getContentType();
+		if (!clientResponse.getKeepAlive()) a.lease->discard();
+		bOk = true;
+	}
+	catch (Poco::Exception& ex) {
+		a.error = ex.displayText();
+	}
+	if (nSpan != 0) p_pRace->trace.exchanged(nSpan, start);
+
+	std::unique_ptr<UpstreamLease> pLease;
+	{
+		std::lock_guard<std::mutex> lock(p_pRace->mtx);
+		a.done = true;
+		a.ok = bOk;
+		p_pRace->finished++;
+		if (bOk && p_pRace->winner < 0) {
+			p_pRace->winner = p_nIndex;
+			//. the other exchange is cut off; its thread still owns its lease.
+			HedgeAttempt& other = p_pRace->attempts[1 - p_nIndex];
+			if (other.lease && !other.done && other.lease->get() != NULL) other.lease->get()->abort();
+		}
+		//. cut off by the winner : not the server's fault.
+		if (!bOk && p_pRace->winner >= 0) a.lease->discard();
+		else if (!bOk) a.lease->fail();
+		pLease.swap(a.lease);
+	}
+	p_pRace->cv.notify_all();
+}
 /*
 void ClaHTTPServerWrapper::launch() {
 	
@@ -48,22 +569,195 @@ void MyRequestHandler::OnProcess(HTTPServerRequest& request, HTTPServerResponse&
 		}
 	}
 	std::string strUri = GD_API_PROCESS_INNER;
-	// Send the request to the target server
-	HTTPClientSession session("127.0.0.1", 8080);
-	HTTPRequest clientRequest(request.getMethod(), strUri, request.getVersion());
-	clientRequest.setContentType(request.getContentType());
-	clientRequest.setContentLength(request.getContentLength());
-	session.sendRequest(clientRequest) << request.stream().rdbuf();
-
-	// Receive the response from the target server
-	HTTPResponse clientResponse;
-	istream& clientResponseStream = session.receiveResponse(clientResponse);
-
-	// Forward the response to the client
-	response.setStatus(clientResponse.getStatus());
-	response.setContentType(clientResponse.getContentType());
-	response.setContentLength(clientResponse.getContentLength());
-	response.send() << clientResponseStream.rdbuf();
+	//. a kept-alive session from the pool; both bodies are copied through in chunks.
+	std::call_once(lv_onceBalancer, []() {
+		lv_balancer.start(Poco::Environment::get(LD_UPSTREAMS_ENV, ""), Poco::Environment::get(LD_REGISTRY_ENV, ""));
+		if (Poco::Environment::get(LD_SHM_ENV, "0") == "1") lv_shm.create(LD_SHM_SLOTS, (size_t)LD_SHM_SLOT_MB * 1024 * 1024);
+		std::string strAffinity = Poco::Environment::get(LD_AFFINITY_ENV, "");
+		if (strAffinity == "session") lv_affinity = AFFINITY_SESSION;
+		else if (strAffinity == "image") lv_affinity = AFFINITY_IMAGE;
+		if (Poco::Environment::get(LD_HEDGE_ENV, "0") == "1" && lv_balancer.size() > 1) {
+			lv_hedge.configure(std::max(atoi(Poco::Environment::get(LD_HEDGE_PCT_ENV, std::to_string(LD_HEDGE_PCT_DEFAULT)).c_str()), 0));
+		}
+		lv_nTraceSample = std::max(atoi(Poco::Environment::get(LD_TRACE_SAMPLE_ENV, "0").c_str()), 0);
+		std::string strOtlp = Poco::Environment::get(LD_OTLP_ENV, "");
+		if (!strOtlp.empty()) {
+			OtlpSettings otlp;
+			otlp.endpoint = strOtlp;
+			otlp.service = Poco::Environment::get(LD_OTLP_SERVICE_ENV, LD_OTLP_SERVICE_DEFAULT);
+			otlp.batch = LD_OTLP_BATCH;
+			otlp.intervalMs = LD_OTLP_INTERVAL_MS;
+			otlp.queue = LD_OTLP_QUEUE;
+			std::string strErr;
+			if (!mi_otlp_start(otlp, strErr)) cout << "OTLP export off : " << strErr << endl;
+		}
+	});
+	ProxyTrace trace(request);
+
+	//. affinity key : the session of a multi-frame client first, then the upload itself
+	//. (image, read here to hash it) or the id a retry repeats (session).
+	uint64_t nKey = 0;
+	std::string strBody;
+	std::istringstream bodyBuffer;
+	std::istream* pBody = &request.stream();
+	if (lv_affinity != AFFINITY_OFF) {
+		const std::string& strSession = request.get(LD_AFFINITY_SESSION, "");
+		if (!strSession.empty()) nKey = affinity_hash(strSession.data(), strSession.size());
+		else if (lv_affinity == AFFINITY_IMAGE) {
+			if (request.hasContentLength() && request.getContentLength64() <= (Poco::Int64)LD_AFFINITY_BODY_MB * 1024 * 1024) {
+				Poco::StreamCopier::copyToString64(request.stream(), strBody);
+				nKey = affinity_hash(strBody.data(), strBody.size());
+				bodyBuffer.str(strBody);
+				pBody = &bodyBuffer;
+			}
+		}
+		else {
+			const std::string& strRetry = request.get(LD_AFFINITY_RETRY, "");
+			if (!strRetry.empty()) nKey = affinity_hash(strRetry.data(), strRetry.size());
+		}
+	}
+	if (lv_hedge.enabled() && request.hasContentLength() && request.getContentLength64() <= (Poco::Int64)LD_HEDGE_BODY_MB * 1024 * 1024) {
+		if (pBody != &bodyBuffer) Poco::StreamCopier::copyToString64(request.stream(), strBody);
+		OnProcessHedged(request, strBody, response, nKey, trace);
+		return;
+	}
+
+	UpstreamLease lease(lv_balancer, nKey);
+	if (lease.get() == NULL) {
+		response.setStatus(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		response.setContentType("text/plain");
+		response.send() << "Upstream busy";
+		return;
+	}
+	if (lv_shm.enabled() && lease.upstream()->local && OnProcessShm(request, *pBody, response, lease, trace)) return;
+	HTTPClientSession& session = *lease.get();
+	uint64_t nSpan = 0;
+	auto start = std::chrono::steady_clock::now();
+	try {
+		HTTPRequest clientRequest(request.getMethod(), strUri, HTTPMessage::HTTP_1_1);
+		clientRequest.setKeepAlive(true);
+		clientRequest.set(MI_TRACEPARENT_HEADER, trace.exchange(nSpan));
+		clientRequest.setContentType(request.getContentType());
+		if (request.hasContentLength()) clientRequest.setContentLength64(request.getContentLength64());
+		else clientRequest.setChunkedTransferEncoding(true);
+		Poco::StreamCopier::copyStream64(*pBody, session.sendRequest(clientRequest));
+
+		// Receive the response from the target server
+		HTTPResponse clientResponse;
+		istream& clientResponseStream = session.receiveResponse(clientResponse);
+
+		// Forward the response to the client
+		response.setStatus(clientResponse.getStatus());
+		response.setContentType(clientResponse.getContentType());
+		if (clientResponse.hasContentLength()) response.setContentLength64(clientResponse.getContentLength64());
+		else response.setChunkedTransferEncoding(true);
+		Poco::StreamCopier::copyStream64(clientResponseStream, response.send());
+		trace.exchanged(nSpan, start);
+
+		//. an upstream that closes after this response cannot be reused.
+		if (!clientResponse.getKeepAlive()) lease.fail();
+	}
+	catch (Poco::Exception&) {
+		if (nSpan != 0) trace.exchanged(nSpan, start);
+		lease.fail();
+		throw;
+	}
+}
+
+void MyRequestHandler::OnProcessHedged(HTTPServerRequest& request, const std::string& p_strBody, HTTPServerResponse& response, uint64_t p_nKey, const ProxyTrace& trace)
+{
+	auto start = std::chrono::steady_clock::now();
+	lv_hedge.request();
+	std::shared_ptr<HedgeRace> pRace = std::make_shared<HedgeRace>(trace);
+	pRace->method = request.getMethod();
+	pRace->uri = GD_API_PROCESS_INNER;
+	pRace->contentType = request.getContentType();
+	pRace->body = p_strBody;
+	pRace->attempts[0].lease.reset(new UpstreamLease(lv_balancer, p_nKey));
+	if (pRace->attempts[0].lease->get() == NULL) {
+		response.setStatus(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		response.setContentType("text/plain");
+		response.send() << "Upstream busy";
+		return;
+	}
+	const Upstream* pFirst = pRace->attempts[0].lease->upstream();
+	pRace->started = 1;
+	std::thread(hedge_attempt, pRace, 0).detach();
+
+	std::unique_lock<std::mutex> lock(pRace->mtx);
+	int nDelay = lv_hedge.delay_ms();
+	auto answered = [&pRace]() { return pRace->winner >= 0 || pRace->finished == pRace->started; };
+	if (nDelay > 0 && !pRace->cv.wait_for(lock, std::chrono::milliseconds(nDelay), answered) && lv_hedge.take()) {
+		//. the key's next server on the ring, or the least loaded other one.
+		lock.unlock();
+		std::unique_ptr<UpstreamLease> pLease(new UpstreamLease(lv_balancer, p_nKey, pFirst));
+		lock.lock();
+		if (pLease->get() != NULL && pRace->winner < 0) {
+			pRace->attempts[1].lease.swap(pLease);
+			pRace->started = 2;
+			std::thread(hedge_attempt, pRace, 1).detach();
+		}
+	}
+	pRace->cv.wait(lock, answered);
+	if (pRace->winner < 0) throw Poco::IOException(pRace->attempts[pRace->started - 1].error);
+	HedgeAttempt& win = pRace->attempts[pRace->winner];
+	lock.unlock();
+	//. the winner is done with its fields, the loser never writes them after it lost.
+	lv_hedge.observe((unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+
+	response.setStatus((HTTPResponse::HTTPStatus)win.status);
+	response.setContentType(win.contentType);
+	response.setContentLength64((Poco::Int64)win.body.size());
+	response.send().write(win.body.data(), (std::streamsize)win.body.size());
+}
+
+bool MyRequestHandler::OnProcessShm(HTTPServerRequest& request, std::istream& body, HTTPServerResponse& response, UpstreamLease& lease, const ProxyTrace& trace)
+{
+	//. the whole upload must fit a slot, so nothing is consumed before we know it does.
+	if (request.getContentType().find("multipart/") == std::string::npos) return false;
+	if (!request.hasContentLength() || (size_t)request.getContentLength64() > lv_shm.slot_size()) return false;
+	int nSlot = lv_shm.acquire();
+	if (nSlot < 0) return false;
+
+	HTTPClientSession& session = *lease.get();
+	uint64_t nSpan = 0;
+	auto start = std::chrono::steady_clock::now();
+	try {
+		ShmPartHandler hPart(lv_shm.slot(nSlot), lv_shm.slot_size());
+		Poco::Net::HTMLForm form(request, body, hPart);
+		if (hPart.length() == 0 || hPart.overflow()) throw Poco::DataFormatException("no image in upload");
+
+		HTTPRequest clientRequest(HTTPRequest::HTTP_POST, LD_SHM_API, HTTPMessage::HTTP_1_1);
+		clientRequest.setKeepAlive(true);
+		clientRequest.set("X-Shm-Segment", lv_shm.name());
+		clientRequest.set("X-Shm-Size", std::to_string(lv_shm.size()));
+		clientRequest.set("X-Shm-Offset", std::to_string(lv_shm.slot_offset(nSlot)));
+		clientRequest.set("X-Shm-Length", std::to_string(hPart.length()));
+		clientRequest.set(MI_TRACEPARENT_HEADER, trace.exchange(nSpan));
+		clientRequest.setContentLength(0);
+		session.sendRequest(clientRequest);
+
+		HTTPResponse clientResponse;
+		istream& clientResponseStream = session.receiveResponse(clientResponse);
+
+		response.setStatus(clientResponse.getStatus());
+		response.setContentType(clientResponse.getContentType());
+		if (clientResponse.hasContentLength()) response.setContentLength64(clientResponse.getContentLength64());
+		else response.setChunkedTransferEncoding(true);
+		Poco::StreamCopier::copyStream64(clientResponseStream, response.send());
+		trace.exchanged(nSpan, start);
+		lv_shm.release(nSlot);
+
+		if (!clientResponse.getKeepAlive()) lease.fail();
+	}
+	catch (Poco::Exception&) {
+		//. a worker still reading the slot can only spoil the answer nobody waits for now.
+		if (nSpan != 0) trace.exchanged(nSpan, start);
+		lease.fail();
+		lv_shm.release(nSlot);
+		throw;
+	}
+	return true;
 }
 
 void MyRequestHandler::OnUnknown(HTTPServerRequest& request, HTTPServerResponse& response)
@@ -13,18 +13,276 @@
 // #include "Poco/Net/HTTPClientResponse.h"
 #include "Poco/StreamCopier.h"
 #include "Poco/Exception.h"
+#include "Poco/ObjectPool.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/SharedMemory.h"
+#include "Poco/Net/PartHandler.h"
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 #include "..\cmn\MiKeyMgr.h"
+#include "..\SfTServerCmd\MiOtlp.h"
 
 using namespace Poco::Net;
 //using namespace Poco::Util;
 using namespace std;
 
+//. keep-alive sessions to the liveness server, reused across proxied requests.
+//. A session that lost its connection (error, upstream closed it) fails validation
+//. on return and is dropped; the pool opens a new one on demand.
+class UpstreamFactory {
+public:
+	UpstreamFactory(const std::string& p_strHost, Poco::UInt16 p_nPort) : m_strHost(p_strHost), m_nPort(p_nPort) {}
+
+	Poco::SharedPtr<HTTPClientSession> createObject();
+	bool validateObject(Poco::SharedPtr<HTTPClientSession> p_pSession) { return p_pSession->connected(); }
+	void activateObject(Poco::SharedPtr<HTTPClientSession>) {}
+	void deactivateObject(Poco::SharedPtr<HTTPClientSession>) {}
+	void destroyObject(Poco::SharedPtr<HTTPClientSession> p_pSession) { p_pSession->reset(); }
+private:
+	std::string		m_strHost;
+	Poco::UInt16	m_nPort;
+};
+
+typedef Poco::ObjectPool<HTTPClientSession, Poco::SharedPtr<HTTPClientSession>, UpstreamFactory> UpstreamPool;
+
+//. one liveness server behind the proxy.
+struct Upstream {
+	std::string			name;			//. "host:port"
+	bool				local;			//. loopback : may read uploads from the shm ring
+	UpstreamPool		pool;
+	std::atomic<int>	outstanding;	//. proxied requests in flight
+	std::atomic<bool>	healthy;
+	std::atomic<int>	fails;			//. consecutive failed probes / exchanges
+	//. last capacity report of the node (MI_PROXY_REGISTRY), written by the registry thread.
+	std::atomic<int>	spare;			//. free slots minus its queue
+	std::atomic<int>	outstandingAtReport;
+	std::atomic<bool>	ready;
+	std::atomic<long long>	reportedMs;	//. steady clock when seq last moved, 0 = never
+	unsigned long long	lastSeq;
+
+	Upstream(const std::string& p_strHost, Poco::UInt16 p_nPort);
+};
+
+//. Spreads requests over the MI_PROXY_UPSTREAMS servers ("host:port,host:port", e.g. one
+//. liveness process per NUMA node or remote nodes) : each request goes to the healthy one
+//. with the fewest requests in flight. A thread probes every server's status endpoint;
+//. LD_EJECT_FAILS failures in a row (probes or proxied exchanges) eject it, one good
+//. probe brings it back. With every server ejected the least loaded one is used anyway.
+//. With MI_PROXY_AFFINITY a request that carries a key (session id or image hash) goes
+//. to its owner on a consistent-hash ring instead, so retries and the frames of one
+//. session meet the same result cache; only the keys of an ejected or saturated server
+//. move, to the next one on the ring. MI_PROXY_AFFINITY=session keys on X-Session-Id, else
+//. the X-Request-Id a retry repeats; =image on X-Session-Id, else a hash of the upload
+//. (read before forwarding, up to LD_AFFINITY_BODY_MB).
+//. With MI_PROXY_REGISTRY the liveness servers announce their capacity ([cluster] of the
+//. server, MiCluster.h) and a request without a key goes to the fresh, ready one with the
+//. most spare slots : free slots minus its queue, minus what this proxy sent it since the
+//. report. A server whose seq has not moved for LD_REGISTRY_TTL_MS, or with no slot to
+//. spare anywhere, falls back to the fewest-in-flight choice. Announced nodes missing from
+//. MI_PROXY_UPSTREAMS join the rotation (not the ring), up to LD_MAX_UPSTREAMS.
+//.   redis://host:port[/prefix] : polls HGETALL <prefix>cluster every LD_REGISTRY_POLL_MS
+//.   udp://port                 : receives the datagrams of the nodes' [cluster] peers
+class Balancer {
+public:
+	Balancer() : m_nUpstreams(0), m_nNext(0), m_bStop(false) {}
+	~Balancer() { stop(); }
+
+	void start(const std::string& p_strList, const std::string& p_strRegistry = "");
+	void stop();
+
+	//. counts the request in flight on the chosen server; release with done().
+	//. p_nKey 0 = no affinity (least loaded). p_pExclude is never chosen (the server a
+	//. hedged request already went to); NULL when no other server is left.
+	Upstream* pick(uint64_t p_nKey = 0, const Upstream* p_pExclude = NULL);
+	size_t size() const { return m_nUpstreams.load(std::memory_order_acquire); }
+	void done(Upstream* p_pUpstream, bool p_bOk);
+private:
+	void probe_loop();
+	void mark(Upstream& p_upstream, bool p_bOk);
+	void registry_loop(std::string p_strRegistry);
+	//. one "mi-node ..." line of a node.
+	void report(const std::string& p_strLine);
+	Upstream* add(const std::string& p_strName);
+
+	std::vector<std::unique_ptr<Upstream>>	m_vUpstreams;	//. reserved once, appended by the registry thread only
+	std::atomic<size_t>						m_nUpstreams;	//. published after the append
+	std::vector<std::pair<uint64_t, int>>	m_vRing;		//. (point, upstream index), sorted
+	std::atomic<unsigned int>				m_nNext;		//. rotates ties
+	std::atomic<bool>						m_bStop;
+	std::thread								m_thread;
+	std::thread								m_registry;
+};
+
+//. borrows a session of the least loaded server for one proxied exchange; fail() drops
+//. the session and counts a failure against the server, discard() only drops it (the
+//. losing attempt of a hedged request was cut off, the server did nothing wrong).
+class UpstreamLease {
+public:
+	explicit UpstreamLease(Balancer& p_balancer, uint64_t p_nKey = 0, const Upstream* p_pExclude = NULL);
+	~UpstreamLease();
+
+	HTTPClientSession* get() { return m_pSession.get(); }
+	Upstream* upstream() const { return m_pUpstream; }
+	void fail() { m_bOk = false; discard(); }
+	void discard() { if (!m_pSession.isNull()) m_pSession->reset(); }
+private:
+	Balancer&							m_balancer;
+	Upstream*							m_pUpstream;
+	Poco::SharedPtr<HTTPClientSession>	m_pSession;
+	bool								m_bOk;
+};
+
+//. Tail-latency hedging (MI_PROXY_HEDGE=1) : a proxied check with no answer after the
+//. p95 of the recent ones (LD_HEDGE_WINDOW latencies, at least LD_HEDGE_MIN_MS) is sent
+//. again to another healthy server; the first answer is forwarded and the other exchange
+//. is aborted. Hedges are paid from a budget that grows by MI_PROXY_HEDGE_PCT (5) percent
+//. of a hedge per proxied request, so at most that share of the requests is doubled even
+//. when a whole server stalls. Only uploads with a known length up to LD_HEDGE_BODY_MB
+//. are hedged, they are buffered to be sent twice; the shm path is not.
+class HedgePolicy {
+public:
+	HedgePolicy() : m_nPercent(0), m_nTokens(0), m_nSamples(0), m_nP95(0) {}
+
+	void configure(int p_nPercent) { m_nPercent = p_nPercent; }
+	bool enabled() const { return m_nPercent > 0; }
+
+	//. one proxied request : adds its share to the budget.
+	void request();
+	//. ms to wait for the first answer before hedging, 0 = too few latencies yet.
+	int delay_ms() const { return m_nP95.load(std::memory_order_relaxed); }
+	//. takes one hedge from the budget.
+	bool take();
+	//. latency of an answered request as the client saw it.
+	void observe(unsigned int p_nMs);
+private:
+	int							m_nPercent;
+	std::atomic<int>			m_nTokens;		//. hundredths of a hedge
+	std::mutex					m_mtx;
+	std::vector<unsigned int>	m_vWindow;		//. ring of the last LD_HEDGE_WINDOW latencies
+	size_t						m_nSamples;
+	std::atomic<int>			m_nP95;			//. ms, 0 = too few samples
+};
+
+//. W3C trace context through the proxy (MiOtlp.h) : a request continues the trace of its
+//. traceparent, or starts one (sampled one in MI_PROXY_TRACE_SAMPLE, 0 = only the ones a
+//. sampled traceparent asks for). Each exchange with a liveness server is a child span
+//. whose id goes upstream as the traceparent of the forwarded request, so the worker's
+//. request span hangs below it. Sampled spans ("proxy" server, "upstream" client) go to
+//. the MI_PROXY_OTLP collector; without one the header is still forwarded.
+//. The instance made from the request exports its span when it goes; copies (the attempt
+//. threads of a hedged request) only add exchanges.
+class ProxyTrace {
+public:
+	explicit ProxyTrace(const HTTPServerRequest& p_request);
+	ProxyTrace(const ProxyTrace& p_other);
+	~ProxyTrace();
+
+	//. a new exchange : its traceparent header and span id.
+	std::string exchange(uint64_t& p_nSpan) const;
+	//. the exchange p_nSpan, started at p_start, is over.
+	void exchanged(uint64_t p_nSpan, std::chrono::steady_clock::time_point p_start) const;
+private:
+	ProxyTrace& operator=(const ProxyTrace&) = delete;
+
+	uint64_t								m_nTraceHi;
+	uint64_t								m_nTraceLo;
+	uint64_t								m_nParent;		//. the caller's span, 0 = root
+	uint64_t								m_nSpan;
+	uint8_t									m_nFlags;
+	bool									m_bOwner;
+	std::chrono::steady_clock::time_point	m_start;
+};
+
+//. one of the (at most two) exchanges of a hedged request, see HedgeRace.
+struct HedgeAttempt {
+	std::unique_ptr<UpstreamLease>	lease;
+	bool							done;
+	bool							ok;
+	int								status;
+	std::string						contentType;
+	std::string						body;
+	std::string						error;
+	HedgeAttempt() : done(false), ok(false), status(0) {}
+};
+
+//. shared by the handler and the attempt threads; an aborted attempt may outlive the
+//. request, so it holds its own copy of what it sends.
+struct HedgeRace {
+	ProxyTrace				trace;
+	std::string				method;
+	std::string				uri;
+	std::string				contentType;
+	std::string				body;
+	std::mutex				mtx;
+	std::condition_variable	cv;
+	HedgeAttempt			attempts[2];
+	int						started;
+	int						finished;
+	int						winner;			//. -1 = no answer yet
+	explicit HedgeRace(const ProxyTrace& p_trace) : trace(p_trace), started(0), finished(0), winner(-1) {}
+};
+
+//. Uploads handed to local workers through shared memory (MI_PROXY_SHM=1) : a named
+//. segment of LD_SHM_SLOTS slots; the image part of a multipart upload is written once
+//. into a free slot and the worker reads it from there (its /api/check_liveness_shm,
+//. [shm] enable). A slot is free again once the worker has answered. Requests that do
+//. not fit a slot, find none free or go to a remote server use plain HTTP.
+class ShmRing {
+public:
+	ShmRing() : m_nSlotSize(0) {}
+
+	bool create(size_t p_nSlots, size_t p_nSlotSize);
+	bool enabled() const { return !m_strName.empty(); }
+
+	//. slot index, -1 when all are in use.
+	int acquire();
+	void release(int p_nSlot);
+
+	char* slot(int p_nSlot) { return m_mem.begin() + (size_t)p_nSlot * m_nSlotSize; }
+	size_t slot_offset(int p_nSlot) const { return (size_t)p_nSlot * m_nSlotSize; }
+	size_t slot_size() const { return m_nSlotSize; }
+	size_t size() const { return m_nSlotSize * m_nSlots; }
+	const std::string& name() const { return m_strName; }
+private:
+	std::string			m_strName;
+	size_t				m_nSlots;
+	size_t				m_nSlotSize;
+	Poco::SharedMemory	m_mem;
+	std::mutex			m_mtx;
+	std::vector<int>	m_vFree;
+};
+
+//. copies the first file part of a multipart upload into a ring slot.
+class ShmPartHandler : public Poco::Net::PartHandler {
+public:
+	ShmPartHandler(char* p_pSlot, size_t p_nCapacity) : m_pSlot(p_pSlot), m_nCapacity(p_nCapacity), m_nLength(0), m_bDone(false), m_bOverflow(false) {}
+
+	void handlePart(const MessageHeader& p_header, std::istream& p_stream) override;
+
+	size_t length() const { return m_nLength; }
+	bool overflow() const { return m_bOverflow; }
+private:
+	char*	m_pSlot;
+	size_t	m_nCapacity;
+	size_t	m_nLength;
+	bool	m_bDone;
+	bool	m_bOverflow;
+};
+
 // Define a request handler to handle incoming HTTP requests
 class MyRequestHandler : public HTTPRequestHandler {
 public:
 	void OnVersion(HTTPServerRequest& request, HTTPServerResponse& response);
 	void OnProcess(HTTPServerRequest& request, HTTPServerResponse& response);
+	//. OnProcess through the shm ring, the upload read from body; false when it must go by HTTP.
+	bool OnProcessShm(HTTPServerRequest& request, std::istream& body, HTTPServerResponse& response, UpstreamLease& lease, const ProxyTrace& trace);
+	//. OnProcess with hedging, the upload already buffered in p_strBody.
+	void OnProcessHedged(HTTPServerRequest& request, const std::string& p_strBody, HTTPServerResponse& response, uint64_t p_nKey, const ProxyTrace& trace);
 	void OnUnknown(HTTPServerRequest& request, HTTPServerResponse& response);
 	void OnNoLicense(HTTPServerRequest& request, HTTPServerResponse& response);
 public:
@@ -5,37 +5,104 @@
 #include <iostream>
 #include <wtypes.h>
 #include <stdio.h>
+#include <string>
 #include <winsvc.h>
 
 
 #define GD_SVC_NAME				L"M-id-svc"
 
+//. worker pool : MI_SVC_WORKERS copies of IDLiveFaceCmd.exe (default 1), worker i listens on
+//. MI_SVC_BASE_PORT + i (default 8092) and runs on its share of the CPUs.
+#define GD_WORKERS_ENV			L"MI_SVC_WORKERS"
+#define GD_BASE_PORT_ENV		L"MI_SVC_BASE_PORT"
+#define GD_UPSTREAMS_ENV		L"MI_PROXY_UPSTREAMS"	//. read by the proxy, see MIServer.h
+#define GD_WORKER_PORT_VAR		L"MI_SERVER_PORT="		//. IDLiveFaceCmd [server] port override
+#define LD_WORKERS_MAX			16
+#define LD_BASE_PORT			8092
+#define LD_STAGGER_MS			2000	//. between the first launches of the workers
+#define LD_BACKOFF_MIN_MS		1000
+#define LD_BACKOFF_MAX_MS		60000
+#define LD_STABLE_MS			30000	//. a worker that ran this long restarts without backoff
+#define LD_DRAIN_MS				30000	//. stop waits this long for the workers to drain (their server.drain_sec + exit)
+
+//. Job Object governance : every worker runs in a job of its own that holds it to its CPU
+//. share (JOB_OBJECT_LIMIT_AFFINITY), caps its CPU time at MI_SVC_JOB_CPU_PCT percent of
+//. the machine (hard cap, unset = none) and watches its committed memory against
+//. MI_SVC_JOB_MEMORY_MB (unset = none). Over the memory limit the worker is restarted
+//. gracefully : asked to drain, terminated after LD_DRAIN_MS; a hard limit of
+//. LD_JOB_HARD_PCT percent of it keeps a runaway from starving its neighbors meanwhile.
+//. CPU over the cap is throttled by the OS; an interval of LD_METRICS_MS spent at the cap
+//. counts as a cpu violation. Closing the service closes the jobs and kills what is left.
+//. Per worker counters go to the Prometheus text file MI_SVC_METRICS_FILE (default
+//. mi_id_svc.prom next to the exe) every LD_METRICS_MS, for a textfile collector.
+#define GD_JOB_CPU_ENV			L"MI_SVC_JOB_CPU_PCT"
+#define GD_JOB_MEMORY_ENV		L"MI_SVC_JOB_MEMORY_MB"
+#define GD_METRICS_FILE_ENV		L"MI_SVC_METRICS_FILE"
+#define LD_JOB_HARD_PCT			125
+#define LD_JOB_CPU_AT_CAP		95		//. percent of the cap an interval must reach to count
+#define LD_METRICS_MS			10000
+
+struct ST_WORKER {
+	int				nIndex;
+	int				nPort;
+	DWORD_PTR		dwAffinity;		//. 0 = all CPUs
+	HANDLE			hThread;
+	volatile HANDLE	hProcess;
+	volatile DWORD	dwPid;
+	HANDLE			hJob;			//. NULL = not governed
+	volatile LONG	bRestarting;	//. a graceful restart was asked at tRestart
+	ULONGLONG		tRestart;
+	volatile LONG	nExitRestarts;	//. the worker exited by itself
+	volatile LONG	nMemoryRestarts;
+	volatile LONG	nMemoryViolations;
+	volatile LONG	nCpuViolations;
+	ULONGLONG		nCpuLast;		//. job CPU time at the last sample, 100 ns
+};
+
 SERVICE_STATUS_HANDLE lv_hServiceStatus;
-HANDLE lv_thdService = NULL;
-HANDLE lv_hProcess = NULL;
+SERVICE_STATUS lv_serviceStatus;
+ST_WORKER lv_workers[LD_WORKERS_MAX];
+int lv_nWorkers = 0;
 
 BOOL	lv_ProcStop = FALSE;
 
+HANDLE	lv_hJobPort = NULL;			//. job notifications, completion key = worker index
+int		lv_nJobCpuPct = 0;
+int		lv_nJobMemoryMb = 0;
+wchar_t	lv_wszMetricsFile[MAX_PATH];
+
+//. pending states count their checkpoint up so the SCM sees progress.
+static void report_status(DWORD p_dwState, DWORD p_dwWaitHint)
+{
+	lv_serviceStatus.dwCurrentState = p_dwState;
+	lv_serviceStatus.dwWaitHint = p_dwWaitHint;
+	if (p_dwState == SERVICE_START_PENDING || p_dwState == SERVICE_STOP_PENDING) lv_serviceStatus.dwCheckPoint++;
+	else lv_serviceStatus.dwCheckPoint = 0;
+	SetServiceStatus(lv_hServiceStatus, &lv_serviceStatus);
+}
+
+//. same as Poco::Process::requestTermination : the worker's waitForTerminationRequest
+//. returns and it drains (server.drain_sec) before exiting.
+static void request_termination(DWORD p_dwPid)
+{
+	wchar_t wszName[32]; memset(wszName, 0, sizeof(wszName));
+	swprintf_s(wszName, 32, L"POCOTRM%08X", p_dwPid);
+	HANDLE hEvent = OpenEventW(EVENT_MODIFY_STATE, FALSE, wszName);
+	if (hEvent == NULL) return;
+	SetEvent(hEvent);
+	CloseHandle(hEvent);
+}
+
 // Service control handler function
 VOID WINAPI ServiceCtrlHandler(DWORD dwCtrl) {
 	switch (dwCtrl) {
 	case SERVICE_CONTROL_STOP:
-
+		//. RunService waits for the workers to drain and reports the progress.
 		lv_ProcStop = TRUE;
-		Sleep(2000);
-
-		// Stop the service
-		// Perform cleanup tasks here
-		// Notify service controller that the service has stopped
-		if (lv_hProcess != NULL) {
-			TerminateProcess(lv_hProcess, 0);
+		report_status(SERVICE_STOP_PENDING, LD_DRAIN_MS);
+		for (int i = 0; i < lv_nWorkers; i++) {
+			if (lv_workers[i].hProcess != NULL) request_termination(lv_workers[i].dwPid);
 		}
-		if (lv_thdService != NULL) {
-			TerminateThread(lv_thdService, 0);
-		}
-		SERVICE_STATUS serviceStatus;
-		serviceStatus.dwCurrentState = SERVICE_STOPPED;
-		SetServiceStatus(lv_hServiceStatus, &serviceStatus);
 		break;
 	default:
 		break;
@@ -144,7 +211,183 @@ Cleanup:
 }
 
 
-unsigned int TF_THREAD(void*) {
+//. the service environment plus the worker's port.
+static wchar_t* worker_environment(int p_nPort)
+{
+	wchar_t* pBase = GetEnvironmentStringsW();
+	size_t nBase = 0;
+	for (const wchar_t* p = pBase; *p != 0; p += wcslen(p) + 1) nBase += wcslen(p) + 1;
+
+	size_t nVar = wcslen(GD_WORKER_PORT_VAR) + 8;
+	wchar_t* pEnv = (wchar_t*)malloc((nBase + nVar + 2) * sizeof(wchar_t));
+	wchar_t* pOut = pEnv;
+	for (const wchar_t* p = pBase; *p != 0; p += wcslen(p) + 1) {
+		if (_wcsnicmp(p, GD_WORKER_PORT_VAR, wcslen(GD_WORKER_PORT_VAR)) == 0) continue;
+		wcscpy_s(pOut, wcslen(p) + 1, p);
+		pOut += wcslen(p) + 1;
+	}
+	swprintf_s(pOut, nVar, L"%s%d", GD_WORKER_PORT_VAR, p_nPort);
+	pOut += wcslen(pOut) + 1;
+	*pOut = 0;
+	FreeEnvironmentStringsW(pBase);
+	return pEnv;
+}
+
+//. sleeps p_dwMs unless the service stops meanwhile.
+static void wait_or_stop(DWORD p_dwMs)
+{
+	for (DWORD t = 0; t < p_dwMs && lv_ProcStop == FALSE; t += 100) Sleep(100);
+}
+
+//. the job of a worker : affinity, hard memory limit, CPU cap, notifications to lv_hJobPort.
+//. NULL when the job cannot be created, the worker then runs ungoverned.
+static HANDLE create_job(const ST_WORKER* p_pWorker)
+{
+	HANDLE hJob = CreateJobObject(NULL, NULL);
+	if (hJob == NULL) return NULL;
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits; memset(&limits, 0, sizeof(limits));
+	limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+	if (p_pWorker->dwAffinity != 0) {
+		limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_AFFINITY;
+		limits.BasicLimitInformation.Affinity = p_pWorker->dwAffinity;
+	}
+	if (lv_nJobMemoryMb > 0) {
+		limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+		limits.JobMemoryLimit = (SIZE_T)lv_nJobMemoryMb * 1024 * 1024 / 100 * LD_JOB_HARD_PCT;
+	}
+	JOBOBJECT_ASSOCIATE_COMPLETION_PORT port; memset(&port, 0, sizeof(port));
+	port.CompletionKey = (PVOID)(INT_PTR)p_pWorker->nIndex;
+	port.CompletionPort = lv_hJobPort;
+	if (!SetInformationJobObject(hJob, JobObjectExtendedLimitInformation, &limits, sizeof(limits))
+		|| !SetInformationJobObject(hJob, JobObjectAssociateCompletionPortInformation, &port, sizeof(port))) {
+		CloseHandle(hJob);
+		return NULL;
+	}
+	if (lv_nJobCpuPct > 0) {
+		JOBOBJECT_CPU_RATE_CONTROL_INFORMATION cpu; memset(&cpu, 0, sizeof(cpu));
+		cpu.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+		cpu.CpuRate = (DWORD)lv_nJobCpuPct * 100;		//. 1/100 percent of all processors
+		if (!SetInformationJobObject(hJob, JobObjectCpuRateControlInformation, &cpu, sizeof(cpu))) OutputDebugStringA("SfT---job cpu rate control failed\n");
+	}
+	return hJob;
+}
+
+//. the soft memory limit, set again for every process : it reports once, at MI_SVC_JOB_MEMORY_MB.
+static void arm_job_notifications(HANDLE p_hJob)
+{
+	if (lv_nJobMemoryMb <= 0) return;
+	JOBOBJECT_NOTIFICATION_LIMIT_INFORMATION notify; memset(&notify, 0, sizeof(notify));
+	notify.LimitFlags = JOB_OBJECT_LIMIT_JOB_MEMORY;
+	notify.JobMemoryLimit = (DWORD64)lv_nJobMemoryMb * 1024 * 1024;
+	SetInformationJobObject(p_hJob, JobObjectNotificationLimitInformation, &notify, sizeof(notify));
+}
+
+//. asks the worker to drain and exit; TF_JOBS terminates it after LD_DRAIN_MS.
+static void restart_gracefully(ST_WORKER* p_pWorker)
+{
+	//. only TF_JOBS asks and reads tRestart, so it is set before the flag without a race.
+	if (p_pWorker->hProcess == NULL || p_pWorker->bRestarting != 0) return;
+	p_pWorker->tRestart = GetTickCount64();
+	InterlockedExchange(&p_pWorker->bRestarting, 1);
+	request_termination(p_pWorker->dwPid);
+}
+
+static void append_metric(std::string& p_out, const char* p_pszName, const char* p_pszType, const char* p_pszHelp)
+{
+	p_out += std::string("# HELP ") + p_pszName + " " + p_pszHelp + "\n# TYPE " + p_pszName + " " + p_pszType + "\n";
+}
+
+//. the counters of every worker as a Prometheus text file, replaced in one move.
+static void write_metrics()
+{
+	if (lv_wszMetricsFile[0] == 0) return;
+	std::string out;
+	char szLine[160];
+	append_metric(out, "mi_svc_worker_restarts_total", "counter", "Worker restarts by reason : exit (by itself) or memory (over MI_SVC_JOB_MEMORY_MB)");
+	for (int i = 0; i < lv_nWorkers; i++) {
+		sprintf_s(szLine, "mi_svc_worker_restarts_total{worker=\"%d\",reason=\"exit\"} %ld\n", i, lv_workers[i].nExitRestarts); out += szLine;
+		sprintf_s(szLine, "mi_svc_worker_restarts_total{worker=\"%d\",reason=\"memory\"} %ld\n", i, lv_workers[i].nMemoryRestarts); out += szLine;
+	}
+	append_metric(out, "mi_svc_job_violations_total", "counter", "Job limit violations : memory over the limit, cpu intervals spent at the cap");
+	for (int i = 0; i < lv_nWorkers; i++) {
+		sprintf_s(szLine, "mi_svc_job_violations_total{worker=\"%d\",limit=\"memory\"} %ld\n", i, lv_workers[i].nMemoryViolations); out += szLine;
+		sprintf_s(szLine, "mi_svc_job_violations_total{worker=\"%d\",limit=\"cpu\"} %ld\n", i, lv_workers[i].nCpuViolations); out += szLine;
+	}
+	append_metric(out, "mi_svc_worker_cpu_seconds_total", "counter", "CPU time of the worker's job, restarts included");
+	for (int i = 0; i < lv_nWorkers; i++) {
+		sprintf_s(szLine, "mi_svc_worker_cpu_seconds_total{worker=\"%d\"} %.3f\n", i, lv_workers[i].nCpuLast / 1e7); out += szLine;
+	}
+	append_metric(out, "mi_svc_worker_peak_memory_bytes", "gauge", "Largest committed memory of the worker's job");
+	for (int i = 0; i < lv_nWorkers; i++) {
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits; memset(&limits, 0, sizeof(limits));
+		if (lv_workers[i].hJob == NULL || !QueryInformationJobObject(lv_workers[i].hJob, JobObjectExtendedLimitInformation, &limits, sizeof(limits), NULL)) continue;
+		sprintf_s(szLine, "mi_svc_worker_peak_memory_bytes{worker=\"%d\"} %llu\n", i, (unsigned long long)limits.PeakJobMemoryUsed); out += szLine;
+	}
+	append_metric(out, "mi_svc_job_cpu_rate_percent", "gauge", "CPU cap of each worker, percent of all processors, 0 = none");
+	sprintf_s(szLine, "mi_svc_job_cpu_rate_percent %d\n", lv_nJobCpuPct); out += szLine;
+	append_metric(out, "mi_svc_job_memory_limit_bytes", "gauge", "Memory above which a worker is restarted, 0 = none");
+	sprintf_s(szLine, "mi_svc_job_memory_limit_bytes %llu\n", (unsigned long long)lv_nJobMemoryMb * 1024 * 1024); out += szLine;
+
+	wchar_t wszTmp[MAX_PATH + 8];
+	swprintf_s(wszTmp, _countof(wszTmp), L"%s.tmp", lv_wszMetricsFile);
+	FILE* f = NULL;
+	if (_wfopen_s(&f, wszTmp, L"wb") != 0 || f == NULL) return;
+	bool bOk = fwrite(out.data(), 1, out.size(), f) == out.size();
+	fclose(f);
+	if (bOk) MoveFileExW(wszTmp, lv_wszMetricsFile, MOVEFILE_REPLACE_EXISTING);
+}
+
+//. CPU of every job since the last sample : an interval at the cap is a cpu violation.
+static void sample_cpu(ULONGLONG p_nElapsedMs)
+{
+	DWORD nCpus = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+	for (int i = 0; i < lv_nWorkers; i++) {
+		JOBOBJECT_BASIC_ACCOUNTING_INFORMATION acct; memset(&acct, 0, sizeof(acct));
+		if (lv_workers[i].hJob == NULL || !QueryInformationJobObject(lv_workers[i].hJob, JobObjectBasicAccountingInformation, &acct, sizeof(acct), NULL)) continue;
+		ULONGLONG nCpu = (ULONGLONG)acct.TotalUserTime.QuadPart + (ULONGLONG)acct.TotalKernelTime.QuadPart;
+		ULONGLONG nUsed = nCpu - lv_workers[i].nCpuLast;
+		lv_workers[i].nCpuLast = nCpu;
+		//. percent of all processors over the interval, in 100 ns units.
+		if (lv_nJobCpuPct > 0 && p_nElapsedMs > 0 && nUsed * 100 >= p_nElapsedMs * 10000 * nCpus * lv_nJobCpuPct * LD_JOB_CPU_AT_CAP / 100)
+			InterlockedIncrement(&lv_workers[i].nCpuViolations);
+	}
+}
+
+//. job notifications, graceful restarts running late, the metrics file.
+unsigned int TF_JOBS(void* p_pParam) {
+	volatile BOOL* pbDone = (volatile BOOL*)p_pParam;
+	ULONGLONG tSample = GetTickCount64();
+	while (*pbDone == FALSE) {
+		DWORD dwMsg = 0;
+		ULONG_PTR nKey = 0;
+		LPOVERLAPPED pOverlapped = NULL;
+		if (GetQueuedCompletionStatus(lv_hJobPort, &dwMsg, &nKey, &pOverlapped, 1000) && (int)nKey < lv_nWorkers) {
+			ST_WORKER* pWorker = &lv_workers[nKey];
+			//. the soft limit reports first; the hard one means allocations already fail.
+			if (dwMsg == JOB_OBJECT_MSG_NOTIFICATION_LIMIT || dwMsg == JOB_OBJECT_MSG_JOB_MEMORY_LIMIT) {
+				InterlockedIncrement(&pWorker->nMemoryViolations);
+				OutputDebugStringA("SfT---worker over its job memory limit, restarting\n");
+				if (lv_ProcStop == FALSE) restart_gracefully(pWorker);
+			}
+		}
+		ULONGLONG tNow = GetTickCount64();
+		for (int i = 0; i < lv_nWorkers; i++) {
+			HANDLE hProcess = lv_workers[i].hProcess;
+			if (hProcess != NULL && lv_workers[i].bRestarting != 0 && tNow - lv_workers[i].tRestart >= LD_DRAIN_MS) TerminateProcess(hProcess, 1);
+		}
+		if (tNow - tSample >= LD_METRICS_MS) {
+			sample_cpu(tNow - tSample);
+			tSample = tNow;
+			write_metrics();
+		}
+	}
+	write_metrics();
+	return 0;
+}
+
+//. runs one worker until the service stops, restarting it with exponential backoff.
+unsigned int TF_WORKER(void* p_pParam) {
+	ST_WORKER* pWorker = (ST_WORKER*)p_pParam;
 	wchar_t wszDir[MAX_PATH]; memset(wszDir, 0, sizeof(wszDir));
 	wchar_t wszPath[MAX_PATH]; memset(wszPath, 0, sizeof(wszPath));
 
@@ -153,21 +396,157 @@ unsigned int TF_THREAD(void*) {
 	if (pSlash != NULL) pSlash[0] = 0x0;
 	swprintf_s(wszPath, MAX_PATH, L"%s\\IDLiveFaceCmd.exe", wszDir);
 
-	STARTUPINFO info = { sizeof(info) };
-	PROCESS_INFORMATION processInfo;
-	CreateProcess(wszPath, NULL, NULL, NULL, TRUE, 0, NULL, wszDir, &info, &processInfo);
-
-	lv_hProcess = processInfo.hProcess;
-	if (lv_hProcess != INVALID_HANDLE_VALUE && lv_hProcess != NULL) {
-		WaitForSingleObject(lv_hProcess, INFINITE);
+	DWORD dwBackoff = LD_BACKOFF_MIN_MS;
+	wait_or_stop(pWorker->nIndex * LD_STAGGER_MS);
+	while (lv_ProcStop == FALSE) {
+		ULONGLONG tStart = GetTickCount64();
+		wchar_t* pEnv = worker_environment(pWorker->nPort);
+		STARTUPINFO info = { sizeof(info) };
+		PROCESS_INFORMATION processInfo;
+		memset(&processInfo, 0, sizeof(processInfo));
+		//. suspended until its affinity is set, so the SDK sizes its threads to the mask.
+		if (CreateProcess(wszPath, NULL, NULL, NULL, TRUE, CREATE_SUSPENDED | CREATE_UNICODE_ENVIRONMENT, pEnv, wszDir, &info, &processInfo)) {
+			//. the job sets the affinity; without one (or when it cannot take the worker) the process does.
+			if (pWorker->hJob == NULL || !AssignProcessToJobObject(pWorker->hJob, processInfo.hProcess)) {
+				if (pWorker->dwAffinity != 0) SetProcessAffinityMask(processInfo.hProcess, pWorker->dwAffinity);
+			}
+			else arm_job_notifications(pWorker->hJob);
+			pWorker->dwPid = processInfo.dwProcessId;
+			pWorker->hProcess = processInfo.hProcess;
+			ResumeThread(processInfo.hThread);
+			CloseHandle(processInfo.hThread);
+			WaitForSingleObject(processInfo.hProcess, INFINITE);
+			pWorker->hProcess = NULL;
+			CloseHandle(processInfo.hProcess);
+		}
+		free(pEnv);
+		if (lv_ProcStop != FALSE) break;
+
+		//. a restart the governance asked for comes back at once.
+		if (InterlockedExchange(&pWorker->bRestarting, 0) != 0) {
+			InterlockedIncrement(&pWorker->nMemoryRestarts);
+			dwBackoff = LD_BACKOFF_MIN_MS;
+			continue;
+		}
+		InterlockedIncrement(&pWorker->nExitRestarts);
+		if (GetTickCount64() - tStart >= LD_STABLE_MS) dwBackoff = LD_BACKOFF_MIN_MS;
+		//. workers that crash together come back one after another.
+		wait_or_stop(dwBackoff + pWorker->nIndex * (LD_BACKOFF_MIN_MS / 4));
+		dwBackoff = dwBackoff * 2 > LD_BACKOFF_MAX_MS ? LD_BACKOFF_MAX_MS : dwBackoff * 2;
 	}
 	return 0;
 }
 
+static int env_int(const wchar_t* p_wszName, int p_nDefault)
+{
+	wchar_t wszValue[32]; memset(wszValue, 0, sizeof(wszValue));
+	if (GetEnvironmentVariable(p_wszName, wszValue, 32) == 0) return p_nDefault;
+	int n = _wtoi(wszValue);
+	return n > 0 ? n : p_nDefault;
+}
+
+//. splits the CPUs of the process into lv_nWorkers contiguous masks.
+static void assign_affinity()
+{
+	DWORD_PTR dwProcess = 0, dwSystem = 0;
+	if (lv_nWorkers < 2 || !GetProcessAffinityMask(GetCurrentProcess(), &dwProcess, &dwSystem)) return;
+	int nCpus = 0;
+	int cpus[sizeof(DWORD_PTR) * 8];
+	for (int b = 0; b < (int)(sizeof(DWORD_PTR) * 8); b++) {
+		if (dwProcess & ((DWORD_PTR)1 << b)) cpus[nCpus++] = b;
+	}
+	if (nCpus < lv_nWorkers) return;
+	for (int i = 0; i < lv_nWorkers; i++) {
+		int from = nCpus * i / lv_nWorkers;
+		int to = nCpus * (i + 1) / lv_nWorkers;
+		DWORD_PTR dwMask = 0;
+		for (int c = from; c < to; c++) dwMask |= (DWORD_PTR)1 << cpus[c];
+		lv_workers[i].dwAffinity = dwMask;
+	}
+}
+
 void RunService() {
-	DWORD dwTID;
-	lv_thdService = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)TF_THREAD, NULL, 0, &dwTID);
-	WaitForSingleObject(lv_thdService, INFINITE);
+	lv_nWorkers = env_int(GD_WORKERS_ENV, 1);
+	if (lv_nWorkers > LD_WORKERS_MAX) lv_nWorkers = LD_WORKERS_MAX;
+	int nBasePort = env_int(GD_BASE_PORT_ENV, LD_BASE_PORT);
+
+	//. the proxy balances over exactly these workers.
+	wchar_t wszUpstreams[LD_WORKERS_MAX * 24]; memset(wszUpstreams, 0, sizeof(wszUpstreams));
+	for (int i = 0; i < lv_nWorkers; i++) {
+		lv_workers[i].nIndex = i;
+		lv_workers[i].nPort = nBasePort + i;
+		lv_workers[i].dwAffinity = 0;
+		lv_workers[i].hProcess = NULL;
+		lv_workers[i].dwPid = 0;
+		lv_workers[i].hJob = NULL;
+		lv_workers[i].bRestarting = 0;
+		lv_workers[i].tRestart = 0;
+		lv_workers[i].nExitRestarts = 0;
+		lv_workers[i].nMemoryRestarts = 0;
+		lv_workers[i].nMemoryViolations = 0;
+		lv_workers[i].nCpuViolations = 0;
+		lv_workers[i].nCpuLast = 0;
+		size_t len = wcslen(wszUpstreams);
+		swprintf_s(wszUpstreams + len, _countof(wszUpstreams) - len, L"%s127.0.0.1:%d", i > 0 ? L"," : L"", lv_workers[i].nPort);
+	}
+	SetEnvironmentVariable(GD_UPSTREAMS_ENV, wszUpstreams);
+	assign_affinity();
+
+	lv_nJobCpuPct = env_int(GD_JOB_CPU_ENV, 0);
+	if (lv_nJobCpuPct > 100) lv_nJobCpuPct = 100;
+	lv_nJobMemoryMb = env_int(GD_JOB_MEMORY_ENV, 0);
+	memset(lv_wszMetricsFile, 0, sizeof(lv_wszMetricsFile));
+	if (GetEnvironmentVariable(GD_METRICS_FILE_ENV, lv_wszMetricsFile, MAX_PATH) == 0) {
+		GetModuleFileName(NULL, lv_wszMetricsFile, MAX_PATH);
+		wchar_t* pSlash = wcsrchr(lv_wszMetricsFile, L'\\');
+		if (pSlash != NULL) swprintf_s(pSlash + 1, MAX_PATH - (pSlash + 1 - lv_wszMetricsFile), L"mi_id_svc.prom");
+		else lv_wszMetricsFile[0] = 0;
+	}
+	lv_hJobPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+	volatile BOOL bJobsDone = FALSE;
+	HANDLE hJobsThread = NULL;
+	if (lv_hJobPort != NULL) {
+		for (int i = 0; i < lv_nWorkers; i++) lv_workers[i].hJob = create_job(&lv_workers[i]);
+		DWORD dwTID;
+		hJobsThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)TF_JOBS, (void*)&bJobsDone, 0, &dwTID);
+	}
+
+	HANDLE hThreads[LD_WORKERS_MAX];
+	for (int i = 0; i < lv_nWorkers; i++) {
+		DWORD dwTID;
+		lv_workers[i].hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)TF_WORKER, &lv_workers[i], 0, &dwTID);
+		hThreads[i] = lv_workers[i].hThread;
+	}
+	//. on stop : ask again every second (a worker may not have been listening yet) and
+	//. terminate what is still running after LD_DRAIN_MS.
+	ULONGLONG tStop = 0;
+	while (WaitForMultipleObjects(lv_nWorkers, hThreads, TRUE, 1000) == WAIT_TIMEOUT) {
+		if (lv_ProcStop == FALSE) continue;
+		if (tStop == 0) tStop = GetTickCount64();
+		bool bLate = GetTickCount64() - tStop >= LD_DRAIN_MS;
+		report_status(SERVICE_STOP_PENDING, LD_DRAIN_MS);
+		for (int i = 0; i < lv_nWorkers; i++) {
+			HANDLE hProcess = lv_workers[i].hProcess;
+			if (hProcess == NULL) continue;
+			if (bLate) TerminateProcess(hProcess, 1);
+			else request_termination(lv_workers[i].dwPid);
+		}
+	}
+	for (int i = 0; i < lv_nWorkers; i++) {
+		lv_workers[i].hThread = NULL;
+		CloseHandle(hThreads[i]);
+	}
+	if (hJobsThread != NULL) {
+		bJobsDone = TRUE;
+		WaitForSingleObject(hJobsThread, INFINITE);
+		CloseHandle(hJobsThread);
+	}
+	for (int i = 0; i < lv_nWorkers; i++) {
+		if (lv_workers[i].hJob != NULL) CloseHandle(lv_workers[i].hJob);
+		lv_workers[i].hJob = NULL;
+	}
+	if (lv_hJobPort != NULL) CloseHandle(lv_hJobPort);
+	lv_hJobPort = NULL;
 }
 
 VOID WINAPI ServiceMain(DWORD argc, LPTSTR* argv) {
@@ -182,21 +561,17 @@ VOID WINAPI ServiceMain(DWORD argc, LPTSTR* argv) {
 	}
 
 	// Notify service controller that the service is starting
-	SERVICE_STATUS serviceStatus;
-	serviceStatus.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
-	serviceStatus.dwCurrentState = SERVICE_START_PENDING;
-	serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP;
-	serviceStatus.dwWin32ExitCode = NO_ERROR;
-	serviceStatus.dwServiceSpecificExitCode = 0;
-	serviceStatus.dwCheckPoint = 0;
-	serviceStatus.dwWaitHint = 0;
-	SetServiceStatus(lv_hServiceStatus, &serviceStatus);
+	lv_serviceStatus.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
+	lv_serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP;
+	lv_serviceStatus.dwWin32ExitCode = NO_ERROR;
+	lv_serviceStatus.dwServiceSpecificExitCode = 0;
+	lv_serviceStatus.dwCheckPoint = 0;
+	report_status(SERVICE_START_PENDING, 0);
 
 	// Perform initialization tasks here
 
 	// Notify service controller that the service is running
-	serviceStatus.dwCurrentState = SERVICE_RUNNING;
-	SetServiceStatus(lv_hServiceStatus, &serviceStatus);
+	report_status(SERVICE_RUNNING, 0);
 
 	while (lv_ProcStop == FALSE){
 		// Run the service
@@ -205,8 +580,7 @@ VOID WINAPI ServiceMain(DWORD argc, LPTSTR* argv) {
 	}
 
 	// Notify service controller that the service has stopped
-	serviceStatus.dwCurrentState = SERVICE_STOPPED;
-	SetServiceStatus(lv_hServiceStatus, &serviceStatus);
+	report_status(SERVICE_STOPPED, 0);
 }
 
 int main()